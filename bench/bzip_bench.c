@@ -0,0 +1,202 @@
+/*******************************************************************************
+ * BZIP_BENCH.C - Decompression Benchmark over the Real Cache Archives
+ *******************************************************************************
+ *
+ * Times bzip_decompress_into() on every bzip2 stream in data/archives/:
+ * the whole body of archives stored as one stream, and every individually
+ * compressed entry of the others. Each stream's output size is checked
+ * against the size recorded in the jagfile header, so a decoder change
+ * that breaks the format fails loudly instead of just looking fast.
+ *
+ * USAGE:
+ *   make bench
+ *   ./bin/bzip_bench [archive_dir] [iterations]     (defaults: data/archives 20)
+ *
+ * OUTPUT:
+ *   archive     streams   packed   unpacked   ms/iter   MB/s (unpacked)
+ *
+ ******************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "thirdparty/bzip.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static const char* const ARCHIVES[] = {
+    "config", "interface", "media", "models",
+    "sounds", "textures", "title", "wordenc"
+};
+
+#define ARCHIVE_COUNT (sizeof(ARCHIVES) / sizeof(ARCHIVES[0]))
+
+/*
+ * Stream - One bzip2 stream inside an archive file
+ */
+typedef struct {
+    const uint8_t* src;
+    uint32_t packed;
+    uint32_t unpacked;
+} Stream;
+
+static uint32_t read_u24(const uint8_t* p) {
+    return ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+}
+
+static uint8_t* read_file(const char* path, uint32_t* size) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return NULL;
+
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    uint8_t* data = len > 0 ? malloc((size_t)len) : NULL;
+    if (!data || fread(data, 1, (size_t)len, f) != (size_t)len) {
+        free(data);
+        fclose(f);
+        return NULL;
+    }
+
+    fclose(f);
+    *size = (uint32_t)len;
+    return data;
+}
+
+/*
+ * collect_streams - List the compressed streams of one jagfile
+ *
+ *   [unpacked:3][packed:3][body]
+ *   packed != unpacked: body is one stream
+ *   packed == unpacked: body is [count:2][hash:4 unpacked:3 packed:3]...[data],
+ *                       each entry with packed != unpacked is a stream
+ *
+ * @return  Stream count, or -1 if the file is malformed
+ */
+static int collect_streams(const uint8_t* data, uint32_t size, Stream* out, int max) {
+    if (size < 6) return -1;
+
+    uint32_t unpacked = read_u24(data);
+    uint32_t packed = read_u24(data + 3);
+
+    if (packed != unpacked) {
+        if (packed > size - 6 || max < 1) return -1;
+        out[0].src = data + 6;
+        out[0].packed = packed;
+        out[0].unpacked = unpacked;
+        return 1;
+    }
+
+    if (size < 8) return -1;
+    uint32_t count = ((uint32_t)data[6] << 8) | data[7];
+    uint32_t offset = 8 + count * 10;
+    if (offset > size) return -1;
+
+    int n = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        const uint8_t* e = data + 8 + i * 10;
+        uint32_t file_unpacked = read_u24(e + 4);
+        uint32_t file_packed = read_u24(e + 7);
+        if (file_packed > size - offset) return -1;
+
+        if (file_packed != file_unpacked) {
+            if (n == max) return -1;
+            out[n].src = data + offset;
+            out[n].packed = file_packed;
+            out[n].unpacked = file_unpacked;
+            n++;
+        }
+        offset += file_packed;
+    }
+    return n;
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+int main(int argc, char** argv) {
+    const char* dir = argc > 1 ? argv[1] : "data/archives";
+    int iterations = argc > 2 ? atoi(argv[2]) : 20;
+    if (iterations < 1) iterations = 1;
+
+    Stream streams[256];
+    double total_ms = 0;
+    uint64_t total_unpacked = 0;
+    int failures = 0;
+
+    printf("%-10s %7s %9s %9s %9s %8s\n",
+           "archive", "streams", "packed", "unpacked", "ms/iter", "MB/s");
+
+    for (size_t a = 0; a < ARCHIVE_COUNT; a++) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", dir, ARCHIVES[a]);
+
+        uint32_t size;
+        uint8_t* data = read_file(path, &size);
+        if (!data) {
+            fprintf(stderr, "WARNING: Cannot read %s\n", path);
+            continue;
+        }
+
+        int n = collect_streams(data, size, streams, 256);
+        if (n < 0) {
+            fprintf(stderr, "WARNING: Malformed archive %s\n", path);
+            free(data);
+            failures++;
+            continue;
+        }
+
+        uint32_t max_unpacked = 1;
+        uint64_t packed = 0, unpacked = 0;
+        for (int i = 0; i < n; i++) {
+            if (streams[i].unpacked > max_unpacked) max_unpacked = streams[i].unpacked;
+            packed += streams[i].packed;
+            unpacked += streams[i].unpacked;
+        }
+        uint8_t* out = malloc(max_unpacked);
+        if (!out) {
+            free(data);
+            return 1;
+        }
+
+        /* One untimed pass verifies sizes and warms caches */
+        for (int i = 0; i < n; i++) {
+            int got = bzip_decompress_into(out, (int)streams[i].unpacked,
+                                           streams[i].src, (int)streams[i].packed);
+            if (got != (int)streams[i].unpacked) {
+                fprintf(stderr, "FAIL: %s stream %d: got %d, expected %u\n",
+                        ARCHIVES[a], i, got, streams[i].unpacked);
+                failures++;
+            }
+        }
+
+        double start = now_ms();
+        for (int it = 0; it < iterations; it++) {
+            for (int i = 0; i < n; i++) {
+                bzip_decompress_into(out, (int)streams[i].unpacked,
+                                     streams[i].src, (int)streams[i].packed);
+            }
+        }
+        double ms = (now_ms() - start) / iterations;
+
+        printf("%-10s %7d %9llu %9llu %9.3f %8.1f\n", ARCHIVES[a], n,
+               (unsigned long long)packed, (unsigned long long)unpacked, ms,
+               ms > 0 ? unpacked / 1048576.0 / (ms / 1000.0) : 0.0);
+
+        total_ms += ms;
+        total_unpacked += unpacked;
+        free(out);
+        free(data);
+    }
+
+    printf("%-10s %7s %9s %9llu %9.3f %8.1f\n", "total", "", "",
+           (unsigned long long)total_unpacked, total_ms,
+           total_ms > 0 ? total_unpacked / 1048576.0 / (total_ms / 1000.0) : 0.0);
+
+    return failures ? 1 : 0;
+}
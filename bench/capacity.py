@@ -0,0 +1,409 @@
+#!/usr/bin/env python3
+"""
+CAPACITY.PY - End-to-End Capacity Benchmark and Release Gate
+
+Runs the real server against the headless bots (bench/loadbot.c) at
+stepped populations, in one or more crowd densities, and reports what
+each step cost:
+
+  tick p99         live server_tick() time, from the metrics histogram
+  replay p99       the same step's recorded traffic replayed without
+                   sockets (replay.h): a deterministic, per-build figure
+  bytes/player     bytes the server sent per online player per tick
+  heap, RSS        growth over the empty server, per online player
+  logins/s         loadbot's logins over its ramp, and failed logins
+
+EACH STEP:
+
+  rs225 --trace --record step.rec --metrics-port P  (fresh world)
+    │
+    ├─ loadbot --bots N --wander W    ramp at --rate, then hold
+    │     scrape /metrics after --settle s        ─┐ hold window:
+    │     scrape /metrics --hold s later          ─┘ deltas between them
+    │     SIGUSR2: trace-<tick>.json of the peak (trace.h)
+    │
+    ├─ SIGTERM, wait
+    └─ rs225 --replay step.rec        tick work p50 / p99 / max, digest
+
+DENSITY SCENARIOS (--scenarios):
+
+  dense   wander 2     everyone within a few tiles of the spawn:
+                       every bot sees every other (PLAYER_INFO worst case)
+  town    wander 10    a busy town square
+  spread  wander 40    players spread over ~80 x 80 tiles
+  NAME=W               any other radius
+
+GATE:
+
+  A step is GO when its live tick p99 is within --max-tick-p99-ms (half
+  the 600 ms tick by default, like tick_stats' budget), no more than
+  --max-login-failures logins failed, every bot logged in, and (when
+  set) bytes per player per tick stay within --max-bytes-per-tick.
+  The run is GO only if every step is; the exit code is 0 for GO and
+  1 for NO-GO, so `make capacity-bench` can gate a release.
+
+USAGE:
+
+  make capacity-bench                              (defaults below)
+  make capacity-bench CAPACITY_ARGS="--steps 100,500 --hold 30"
+  python3 bench/capacity.py --help
+
+OUTPUT (--out, default capacity/):
+
+  report.txt                 the table below and the verdict
+  <scenario>-<N>.server.log  server output for the step
+  <scenario>-<N>.bots.log    loadbot output for the step
+  <scenario>-<N>.trace.json  trace dump at the end of the hold window
+  <scenario>-<N>.rec         the recording (deleted after the replay
+                             unless --keep-recordings)
+
+  scenario  players  tick p99  replay p99  B/player/tick  heap KB/p  RSS KB/p  logins/s  fail  verdict
+  dense         200    9.0 ms      7.5 ms          143.0       29.3      34.3     200.4     0  GO
+  spread        200   24.6 ms      9.5 ms          179.5       29.3      34.4     199.9     0  GO
+
+NOTES:
+  The server listens on its fixed game port (43594), so nothing else may
+  be running there. Bots are saved like new players: their saves
+  (data/players/default/<prefix>*.sav) are removed before and after
+  each step. Thousands of bots need as many descriptors in both
+  processes (ulimit -n).
+
+Only the Python standard library is used.
+"""
+
+import argparse
+import glob
+import os
+import re
+import signal
+import subprocess
+import sys
+import time
+import urllib.request
+
+SAVE_DIR = "data/players/default"
+TICK_MS = 600
+
+SCENARIOS = {"dense": 2, "town": 10, "spread": 40}
+
+
+def parse_args():
+    p = argparse.ArgumentParser(description="Stepped-population capacity benchmark (see the file header).")
+    p.add_argument("--steps", default="100,250,500,1000,2000",
+                   help="bot counts, comma separated (100,250,500,1000,2000)")
+    p.add_argument("--scenarios", default="dense,spread",
+                   help="densities: dense, town, spread or NAME=WANDER (dense,spread)")
+    p.add_argument("--rate", type=int, default=200, help="bot connections per second (200)")
+    p.add_argument("--settle", type=int, default=10, help="seconds after the ramp before measuring (10)")
+    p.add_argument("--hold", type=int, default=60, help="measurement window in seconds (60)")
+    p.add_argument("--metrics-port", type=int, default=9464, help="server metrics port (9464)")
+    p.add_argument("--server", default="bin/rs225", help="server binary (bin/rs225)")
+    p.add_argument("--loadbot", default="bin/loadbot", help="bot binary (bin/loadbot)")
+    p.add_argument("--server-args", default="", help="extra server options, e.g. \"--net-thread\"")
+    p.add_argument("--prefix", default="cap", help="bot username prefix (cap)")
+    p.add_argument("--out", default="capacity", help="output directory (capacity)")
+    p.add_argument("--max-tick-p99-ms", type=float, default=TICK_MS / 2,
+                   help="GO limit on live tick p99 (300)")
+    p.add_argument("--max-login-failures", type=int, default=0, help="GO limit on failed logins (0)")
+    p.add_argument("--max-bytes-per-tick", type=float, default=0,
+                   help="GO limit on bytes per player per tick (0 = none)")
+    p.add_argument("--no-replay", action="store_true", help="do not record and replay each step")
+    p.add_argument("--keep-recordings", action="store_true", help="keep each step's .rec file")
+    return p.parse_args()
+
+
+def parse_scenarios(text):
+    scenarios = []
+    for item in text.split(","):
+        item = item.strip()
+        if not item:
+            continue
+        if "=" in item:
+            name, wander = item.split("=", 1)
+            scenarios.append((name, int(wander)))
+        elif item in SCENARIOS:
+            scenarios.append((item, SCENARIOS[item]))
+        else:
+            sys.exit("Unknown scenario '%s' (dense, town, spread or NAME=WANDER)" % item)
+    return scenarios
+
+
+# ---------------------------------------------------------------------------
+# Metrics
+# ---------------------------------------------------------------------------
+
+METRIC_LINE = re.compile(r'^([a-zA-Z_:][a-zA-Z0-9_:]*)(\{[^}]*\})?\s+(\S+)$')
+
+
+def scrape(port):
+    """Every sample of /metrics as {(name, labels): value}, or None."""
+    try:
+        body = urllib.request.urlopen("http://127.0.0.1:%d/metrics" % port, timeout=5).read().decode()
+    except OSError:
+        return None
+    samples = {}
+    for line in body.splitlines():
+        m = METRIC_LINE.match(line)
+        if m:
+            samples[(m.group(1), m.group(2) or "")] = float(m.group(3))
+    return samples
+
+
+def total(samples, name):
+    """Sum of a metric over all its labels."""
+    return sum(v for (n, _), v in samples.items() if n == name)
+
+
+def tick_buckets(samples):
+    """[(upper bound ms, cumulative count)] of the tick histogram, +Inf last."""
+    buckets = []
+    for (n, labels), v in samples.items():
+        if n != "rs225_tick_duration_seconds_bucket":
+            continue
+        le = re.search(r'le="([^"]+)"', labels).group(1)
+        bound = float("inf") if le == "+Inf" else float(le) * 1000
+        buckets.append((bound, v))
+    return sorted(buckets)
+
+
+def histogram_p99(before, after):
+    """p99 of the ticks between two scrapes, interpolated within its bucket."""
+    a = tick_buckets(after)
+    b = dict(tick_buckets(before))
+    counts = [(bound, cum - b.get(bound, 0)) for bound, cum in a]
+    if not counts or counts[-1][1] <= 0:
+        return None
+    rank = counts[-1][1] * 0.99
+    lower, below = 0.0, 0.0
+    for bound, cum in counts:
+        if cum >= rank:
+            if bound == float("inf"):
+                return lower                # Past the last bound: report it
+            inside = cum - below
+            return lower + (bound - lower) * ((rank - below) / inside if inside else 1.0)
+        lower, below = bound, cum
+    return lower
+
+
+# ---------------------------------------------------------------------------
+# One step
+# ---------------------------------------------------------------------------
+
+def remove_saves(prefix):
+    for path in glob.glob(os.path.join(SAVE_DIR, prefix + "*.sav")):
+        os.remove(path)
+
+
+def wait_for_metrics(port, server, seconds=60):
+    deadline = time.time() + seconds
+    while time.time() < deadline:
+        if server.poll() is not None:
+            return None
+        samples = scrape(port)
+        if samples:
+            return samples
+        time.sleep(0.5)
+    return None
+
+
+def stop(process, sig=signal.SIGTERM, seconds=60):
+    if process.poll() is not None:
+        return
+    process.send_signal(sig)
+    try:
+        process.wait(seconds)
+    except subprocess.TimeoutExpired:
+        process.kill()
+        process.wait()
+
+
+def grab(pattern, text, group=1, cast=float):
+    m = re.search(pattern, text, re.M)
+    return cast(m.group(group)) if m else None
+
+
+def run_step(args, scenario, wander, bots):
+    name = "%s-%d" % (scenario, bots)
+    base = os.path.join(args.out, name)
+    result = {"scenario": scenario, "bots": bots, "notes": []}
+    remove_saves(args.prefix)
+    for old in glob.glob("trace-*.json"):
+        os.remove(old)
+
+    server_cmd = [args.server, "--trace", "--metrics-port", str(args.metrics_port),
+                  "--session-grace", "0", "--checkpoint-ticks", "0"]
+    if not args.no_replay:
+        server_cmd += ["--record", base + ".rec"]
+    server_cmd += args.server_args.split()
+    server_log = open(base + ".server.log", "w")
+    server = subprocess.Popen(server_cmd, stdout=server_log, stderr=subprocess.STDOUT)
+    empty = wait_for_metrics(args.metrics_port, server)
+    if empty is None:
+        stop(server)
+        server_log.close()
+        result["notes"].append("server did not start (see %s.server.log)" % name)
+        return result
+
+    ramp = (bots + args.rate - 1) // args.rate
+    bot_cmd = [args.loadbot, "--bots", str(bots), "--rate", str(args.rate),
+               "--seconds", str(args.settle + args.hold + 5), "--wander", str(wander),
+               "--prefix", args.prefix]
+    bot_log = open(base + ".bots.log", "w")
+    loadbot = subprocess.Popen(bot_cmd, stdout=bot_log, stderr=subprocess.STDOUT)
+
+    time.sleep(ramp + args.settle)
+    first = scrape(args.metrics_port)
+    time.sleep(args.hold)
+    last = scrape(args.metrics_port)
+    server.send_signal(signal.SIGUSR2)      # Trace dump after the next tick
+    time.sleep(2)
+
+    try:
+        loadbot.wait(args.settle + args.hold + ramp + 60)
+    except subprocess.TimeoutExpired:
+        loadbot.kill()
+        loadbot.wait()
+    bot_log.close()
+    stop(server)
+    server_log.close()
+    remove_saves(args.prefix)
+
+    dumps = sorted(glob.glob("trace-*.json"), key=os.path.getmtime)
+    if dumps:
+        os.replace(dumps[-1], base + ".trace.json")
+        for extra in dumps[:-1]:
+            os.remove(extra)
+
+    if first and last:
+        online = total(last, "rs225_players_online")
+        ticks = total(last, "rs225_tick_duration_seconds_count") - total(first, "rs225_tick_duration_seconds_count")
+        sent = total(last, "rs225_sent_bytes_total") - total(first, "rs225_sent_bytes_total")
+        result["online"] = int(online)
+        result["tick_p99"] = histogram_p99(first, last)
+        if online > 0 and ticks > 0:
+            result["bytes_per_tick"] = sent / online / ticks
+        if online > 0:
+            result["heap_kb"] = (total(last, "rs225_heap_bytes") - total(empty, "rs225_heap_bytes")) / online / 1024
+            result["rss_kb"] = (total(last, "rs225_resident_bytes") - total(empty, "rs225_resident_bytes")) / online / 1024
+    else:
+        result["notes"].append("metrics scrape failed during the hold")
+
+    bot_text = open(base + ".bots.log").read()
+    result["logged_in"] = grab(r"^\d+ bots, (\d+) logged in", bot_text, cast=int)
+    result["failed"] = grab(r"logged in, (\d+) failed", bot_text, cast=int)
+    result["login_rate"] = grab(r"^login rate\s+([\d.]+)/s", bot_text)
+    result["jitter_p99"] = grab(r"^tick jitter\s+p50 [\d.]+\s+p99 ([\d.]+)", bot_text)
+
+    if not args.no_replay and os.path.exists(base + ".rec"):
+        replay = subprocess.run([args.server, "--replay", base + ".rec"],
+                                stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+        with open(base + ".replay.log", "w") as f:
+            f.write(replay.stdout)
+        result["replay_p99"] = grab(r"tick work ms: .*p99 ([\d.]+)", replay.stdout)
+        result["digest"] = grab(r"digest ([0-9a-f]+)", replay.stdout, cast=str)
+        if replay.returncode != 0:
+            result["notes"].append("replay failed (see %s.replay.log)" % name)
+        if not args.keep_recordings:
+            os.remove(base + ".rec")
+    return result
+
+
+# ---------------------------------------------------------------------------
+# Report
+# ---------------------------------------------------------------------------
+
+def verdict(args, r):
+    """(GO?, reasons)"""
+    reasons = list(r["notes"])
+    if r.get("tick_p99") is None:
+        reasons.append("no tick samples")
+    elif r["tick_p99"] > args.max_tick_p99_ms:
+        reasons.append("tick p99 %.1f ms > %.1f" % (r["tick_p99"], args.max_tick_p99_ms))
+    if r.get("failed") is None:
+        reasons.append("no loadbot summary")
+    elif r["failed"] > args.max_login_failures:
+        reasons.append("%d logins failed" % r["failed"])
+    if r.get("logged_in") is not None and r["logged_in"] < r["bots"] - args.max_login_failures:
+        reasons.append("%d of %d bots logged in" % (r["logged_in"], r["bots"]))
+    if args.max_bytes_per_tick and r.get("bytes_per_tick", 0) > args.max_bytes_per_tick:
+        reasons.append("%.0f bytes/player/tick > %.0f" % (r["bytes_per_tick"], args.max_bytes_per_tick))
+    return not reasons, reasons
+
+
+def cell(value, fmt):
+    return fmt % value if value is not None else "-"
+
+
+def report(args, results):
+    lines = []
+    lines.append("Capacity benchmark, %s" % time.strftime("%Y-%m-%d %H:%M:%S"))
+    lines.append("  steps %s, rate %d/s, settle %d s, hold %d s, server args '%s'"
+                 % (args.steps, args.rate, args.settle, args.hold, args.server_args))
+    lines.append("  gate: tick p99 <= %.1f ms, failed logins <= %d%s"
+                 % (args.max_tick_p99_ms, args.max_login_failures,
+                    ", bytes/player/tick <= %.0f" % args.max_bytes_per_tick if args.max_bytes_per_tick else ""))
+    lines.append("")
+    lines.append("scenario  players  tick p99  replay p99  B/player/tick  heap KB/p  RSS KB/p  logins/s  fail  verdict")
+    go_all = True
+    problems = []
+    for r in results:
+        go, reasons = verdict(args, r)
+        go_all = go_all and go
+        lines.append("%-8s %8s %9s %11s %14s %10s %9s %9s %5s  %s" % (
+            r["scenario"], r.get("online", "-"),
+            cell(r.get("tick_p99"), "%.1f ms"),
+            cell(r.get("replay_p99"), "%.1f ms"),
+            cell(r.get("bytes_per_tick"), "%.1f"),
+            cell(r.get("heap_kb"), "%.1f"),
+            cell(r.get("rss_kb"), "%.1f"),
+            cell(r.get("login_rate"), "%.1f"),
+            cell(r.get("failed"), "%d"),
+            "GO" if go else "NO-GO"))
+        for reason in reasons:
+            problems.append("  %s-%d: %s" % (r["scenario"], r["bots"], reason))
+    if problems:
+        lines.append("")
+        lines.extend(problems)
+    digests = ["  %s-%d: %s" % (r["scenario"], r["bots"], r["digest"]) for r in results if r.get("digest")]
+    if digests:
+        lines.append("")
+        lines.append("replay digests (equal across builds = same behaviour, replay.h):")
+        lines.extend(digests)
+    lines.append("")
+    lines.append("VERDICT: %s" % ("GO" if go_all else "NO-GO"))
+    text = "\n".join(lines) + "\n"
+    with open(os.path.join(args.out, "report.txt"), "w") as f:
+        f.write(text)
+    return text, go_all
+
+
+def main():
+    args = parse_args()
+    steps = [int(s) for s in args.steps.split(",") if s.strip()]
+    scenarios = parse_scenarios(args.scenarios)
+    for binary in (args.server, args.loadbot):
+        if not os.access(binary, os.X_OK):
+            sys.exit("%s not found: run make %s first" % (binary, "loadbot" if binary == args.loadbot else ""))
+    os.makedirs(args.out, exist_ok=True)
+
+    results = []
+    for scenario, wander in scenarios:
+        for bots in steps:
+            print("%s (wander %d), %d bots..." % (scenario, wander, bots), flush=True)
+            r = run_step(args, scenario, wander, bots)
+            results.append(r)
+            print("  online %s, tick p99 %s ms, %s bytes/player/tick, %s failed"
+                  % (r.get("online", "-"),
+                     "%.1f" % r["tick_p99"] if r.get("tick_p99") is not None else "-",
+                     "%.1f" % r["bytes_per_tick"] if r.get("bytes_per_tick") is not None else "-",
+                     r.get("failed", "-")), flush=True)
+
+    text, go = report(args, results)
+    print()
+    print(text, end="")
+    print("Report written to %s" % os.path.join(args.out, "report.txt"))
+    return 0 if go else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
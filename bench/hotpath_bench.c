@@ -0,0 +1,703 @@
+/*******************************************************************************
+ * HOTPATH_BENCH.C - Reproducible Microbenchmarks of the Tick's Hot Paths
+ *******************************************************************************
+ *
+ * Times the routines a busy tick spends its time in, on fixed inputs, and
+ * writes the results as one JSON document so two builds can be compared
+ * by a script instead of by eye:
+ *
+ *   buffer_write_bits        PLAYER_INFO-shaped field widths (1..11 bits)
+ *   isaac_get_next           one key at a time, and isaac_keys() batches
+ *   map_calculate_crc32      a 5000-byte packet and a 64 KB map file, on
+ *                            the backend crc32_backend() names
+ *   movement_naive_path      straight-line waypoints, no collision
+ *   pathfinder_find_tile     BFS over the real collision near Lumbridge
+ *                            (skipped when data/ cannot be loaded)
+ *   update_player            10 / 100 / 1000 players walking in a square
+ *                            of side 16 / 32 / 64 tiles, per viewer-tick
+ *   combat_tick              1000 / 4000 NPC pairs fighting, per pair-tick
+ *   player_save_roundtrip    serialize + player_load_buffer(), in memory
+ *   player_save_disk         player_save_write() + player_load_read()
+ *
+ * REPRODUCIBLE:
+ *   Every input comes from a fixed-seed xorshift generator, so each run
+ *   does the same work. A benchmark runs --repeat times; the median and
+ *   the fastest run are reported (the median for comparisons, the fastest
+ *   as the floor noise did not reach).
+ *
+ *   update_player times update_player_encode(), i.e. update_player()
+ *   without the commit: the synthetic players have no socket to flush to.
+ *   The world is stepped a few warmup ticks first so local lists are full
+ *   and each timed tick is a steady state, not a first sighting.
+ *
+ *   Results are checked where a wrong answer is cheap to detect (save
+ *   round-trips compare re-serialized bytes, the pathfinder counts found
+ *   paths), so a change that breaks a routine fails loudly instead of
+ *   just looking fast.
+ *
+ * USAGE:
+ *   make bench
+ *   ./bin/hotpath_bench [--repeat N] [--filter SUBSTRING] > results.json
+ *
+ *   --repeat N     runs per benchmark (default 7)
+ *   --filter S     only the groups with a result name containing S
+ *
+ * OUTPUT:
+ *   stdout  {"suite": "hotpath_bench", "repeat": N, "crc32_backend": ..., "results": [
+ *             {"name": ..., "params": {...}, "ops": ..., "ns_per_op":
+ *              {"median": ..., "min": ...}, "ops_per_s": ..., ...}, ...]}
+ *   stderr  one human-readable line per benchmark
+ *
+ ******************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "buffer.h"
+#include "cache.h"
+#include "combat.h"
+#include "def_store.h"
+#include "crc32.h"
+#include "isaac.h"
+#include "map.h"
+#include "map_store.h"
+#include "movement.h"
+#include "npc.h"
+#include "pathfinder.h"
+#include "player.h"
+#include "player_save.h"
+#include "server.h"
+#include "update.h"
+#include "world.h"
+#include "world_collision.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Defined by main.c in the server; the benchmark links everything else */
+GameServer* g_server = NULL;
+
+#define MAX_REPEAT   31
+#define MAX_RESULTS  32
+
+/* Centre of the synthetic populations (Lumbridge, inside one region) */
+#define AREA_X 3232
+#define AREA_Z 3232
+
+/*
+ * Result - One benchmark's timings and the JSON it contributes
+ */
+typedef struct {
+    char name[48];
+    char params[160];           /* JSON object members, without braces */
+    u64 ops;                    /* Operations per run */
+    double ns[MAX_REPEAT];      /* Per-run ns/op */
+    u32 runs;
+    double bytes_per_op;        /* Data processed or produced (0 = n/a) */
+    bool ok;                    /* Result check passed */
+} Result;
+
+static Result g_results[MAX_RESULTS];
+static u32 g_result_count;
+static u32 g_repeat = 7;
+static const char* g_filter;
+
+/* Keeps results the compiler could otherwise prove unused */
+static volatile u32 g_sink;
+
+static u64 now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+}
+
+/* xorshift32: fixed seeds, identical inputs on every run */
+static u32 rng_state;
+
+static void rng_seed(u32 seed) {
+    rng_state = seed ? seed : 1;
+}
+
+static u32 rng_next(void) {
+    u32 x = rng_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return rng_state = x;
+}
+
+static u32 rng_range(u32 n) {
+    return rng_next() % n;
+}
+
+static bool wanted(const char* name) {
+    return !g_filter || strstr(name, g_filter);
+}
+
+static Result* result_begin(const char* name, u64 ops) {
+    if (g_result_count == MAX_RESULTS) return NULL;
+    Result* r = &g_results[g_result_count++];
+    memset(r, 0, sizeof(*r));
+    snprintf(r->name, sizeof(r->name), "%s", name);
+    r->ops = ops;
+    r->ok = true;
+    return r;
+}
+
+static void result_add(Result* r, u64 elapsed_ns) {
+    if (r->runs < MAX_REPEAT) r->ns[r->runs++] = (double)elapsed_ns / (double)r->ops;
+}
+
+static int compare_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static double result_median(const Result* r) {
+    double sorted[MAX_REPEAT];
+    memcpy(sorted, r->ns, r->runs * sizeof(double));
+    qsort(sorted, r->runs, sizeof(double), compare_double);
+    return r->runs ? sorted[r->runs / 2] : 0;
+}
+
+static double result_min(const Result* r) {
+    double best = r->runs ? r->ns[0] : 0;
+    for (u32 i = 1; i < r->runs; i++) {
+        if (r->ns[i] < best) best = r->ns[i];
+    }
+    return best;
+}
+
+/*******************************************************************************
+ * BIT PACKING, CIPHER, CRC
+ ******************************************************************************/
+
+static void bench_write_bits(void) {
+    /* Widths as PLAYER_INFO writes them: flags, directions, PIDs, deltas */
+    static const u32 WIDTHS[] = { 1, 1, 2, 3, 3, 11, 5, 5, 1, 8, 1, 7, 2 };
+    enum { FIELDS = 4096, ROUNDS = 64 };
+    const u32 width_count = sizeof(WIDTHS) / sizeof(WIDTHS[0]);
+
+    Result* r = result_begin("buffer_write_bits", (u64)FIELDS * ROUNDS);
+    if (!r) return;
+    snprintf(r->params, sizeof(r->params), "\"fields_per_packet\": %u", FIELDS);
+
+    u32 values[FIELDS], widths[FIELDS];
+    u32 bits = 0;
+    rng_seed(0xB175);
+    for (u32 i = 0; i < FIELDS; i++) {
+        widths[i] = WIDTHS[i % width_count];
+        values[i] = rng_next() & ((1u << widths[i]) - 1);
+        bits += widths[i];
+    }
+    r->bytes_per_op = bits / 8.0 / FIELDS;
+
+    StreamBuffer* buf = buffer_create(bits / 8 + 64);
+    for (u32 run = 0; run < g_repeat; run++) {
+        u64 start = now_ns();
+        for (u32 round = 0; round < ROUNDS; round++) {
+            buffer_reset(buf);
+            buffer_start_bit_access(buf);
+            for (u32 i = 0; i < FIELDS; i++) {
+                buffer_write_bits(buf, widths[i], values[i]);
+            }
+            buffer_finish_bit_access(buf);
+            g_sink += buf->data[buf->position - 1];
+        }
+        result_add(r, now_ns() - start);
+    }
+    buffer_destroy(buf);
+}
+
+static void bench_isaac(void) {
+    static const u32 SEED[4] = { 0x12345678, 0x9ABCDEF0, 0x0F1E2D3C, 0x4B5A6978 };
+    enum { KEYS = 1 << 22, BATCH = 32 };
+    ISAACCipher cipher;
+
+    Result* r = result_begin("isaac_get_next", KEYS);
+    if (r) {
+        isaac_init(&cipher, SEED, 4);
+        for (u32 run = 0; run < g_repeat; run++) {
+            u32 acc = 0;
+            u64 start = now_ns();
+            for (u32 i = 0; i < KEYS; i++) acc += isaac_get_next(&cipher);
+            result_add(r, now_ns() - start);
+            g_sink += acc;
+        }
+    }
+
+    r = result_begin("isaac_keys", KEYS);
+    if (r) {
+        snprintf(r->params, sizeof(r->params), "\"batch\": %u", BATCH);
+        u32 keys[BATCH];
+        isaac_init(&cipher, SEED, 4);
+        for (u32 run = 0; run < g_repeat; run++) {
+            u64 start = now_ns();
+            for (u32 i = 0; i < KEYS; i += BATCH) {
+                isaac_keys(&cipher, keys, BATCH);
+                g_sink += keys[0];
+            }
+            result_add(r, now_ns() - start);
+        }
+    }
+}
+
+static void bench_crc32(void) {
+    static const u32 SIZES[] = { 5000, 65536 };
+    static const char* const LABELS[] = { "packet", "map_file" };
+
+    for (u32 s = 0; s < 2; s++) {
+        u32 size = SIZES[s];
+        u32 calls = (u32)(64u * 1024 * 1024 / size);   /* ~64 MB per run */
+        Result* r = result_begin("map_calculate_crc32", calls);
+        if (!r) return;
+        snprintf(r->params, sizeof(r->params), "\"bytes\": %u, \"shape\": \"%s\"",
+                 size, LABELS[s]);
+        r->bytes_per_op = size;
+
+        u8* data = malloc(size);
+        rng_seed(0xC4C + s);
+        for (u32 i = 0; i < size; i++) data[i] = (u8)rng_next();
+
+        for (u32 run = 0; run < g_repeat; run++) {
+            u64 start = now_ns();
+            for (u32 i = 0; i < calls; i++) g_sink += map_calculate_crc32(data, size);
+            result_add(r, now_ns() - start);
+        }
+        free(data);
+    }
+}
+
+/*******************************************************************************
+ * PATHS
+ ******************************************************************************/
+
+enum { PATH_PAIRS = 1024 };
+
+/* Source/destination pairs within 20 tiles of the Lumbridge spawn */
+static void make_path_pairs(u32* sx, u32* sz, u32* dx, u32* dz, u32 seed) {
+    rng_seed(seed);
+    for (u32 i = 0; i < PATH_PAIRS; i++) {
+        sx[i] = 3222 - 10 + rng_range(21);
+        sz[i] = 3218 - 10 + rng_range(21);
+        dx[i] = sx[i] - 20 + rng_range(41);
+        dz[i] = sz[i] - 20 + rng_range(41);
+    }
+}
+
+static void bench_naive_path(void) {
+    enum { CALLS = 200000 };
+    Result* r = result_begin("movement_naive_path", CALLS);
+    if (!r) return;
+    snprintf(r->params, sizeof(r->params), "\"max_distance\": 20");
+
+    static u32 sx[PATH_PAIRS], sz[PATH_PAIRS], dx[PATH_PAIRS], dz[PATH_PAIRS];
+    make_path_pairs(sx, sz, dx, dz, 0x9A7B);
+
+    MovementHandler handler;
+    movement_init(&handler);
+    for (u32 run = 0; run < g_repeat; run++) {
+        u64 start = now_ns();
+        for (u32 i = 0; i < CALLS; i++) {
+            u32 p = i & (PATH_PAIRS - 1);
+            movement_reset(&handler);
+            movement_naive_path(&handler, sx[p], sz[p], dx[p], dz[p]);
+            g_sink += movement_get_waypoint_count(&handler);
+        }
+        result_add(r, now_ns() - start);
+    }
+    movement_destroy(&handler);
+}
+
+/* World collision from data/, as server_init() builds it without a snapshot */
+static bool load_collision(void) {
+    g_cache = cache_create();
+    if (!g_cache || !cache_init(g_cache, "data")) return false;
+    g_map_store = map_store_create("data/maps");
+    if (!g_map_store) return false;
+    g_world_collision = world_collision_create(g_map_store, g_cache);
+    return g_world_collision != NULL;
+}
+
+static void bench_pathfinder(void) {
+    enum { CALLS = 4096 };
+
+    fprintf(stderr, "loading collision from data/ (not timed)...\n");
+    if (!load_collision()) {
+        fprintf(stderr, "pathfinder_find_tile: skipped, collision could not be built\n");
+        return;
+    }
+    Result* r = result_begin("pathfinder_find_tile", CALLS);
+    if (!r) return;
+
+    static u32 sx[PATH_PAIRS], sz[PATH_PAIRS], dx[PATH_PAIRS], dz[PATH_PAIRS];
+    make_path_pairs(sx, sz, dx, dz, 0x9A7B);
+
+    PathFinder* finder = pathfinder_create();
+    PathResult path;
+    u32 found = 0;
+    for (u32 run = 0; run < g_repeat; run++) {
+        found = 0;
+        u64 start = now_ns();
+        for (u32 i = 0; i < CALLS; i++) {
+            u32 p = i & (PATH_PAIRS - 1);
+            if (pathfinder_find_tile(finder, g_world_collision, 0, sx[p], sz[p], dx[p], dz[p],
+                                     true, &path) == PATH_FOUND) {
+                found++;
+            }
+        }
+        result_add(r, now_ns() - start);
+    }
+    snprintf(r->params, sizeof(r->params),
+             "\"max_distance\": 20, \"try_nearest\": true, \"found\": %u", found);
+    /* Open ground around the spawn: most pairs must be reachable */
+    r->ok = found > CALLS / 2;
+    pathfinder_destroy(finder);
+}
+
+/*******************************************************************************
+ * PLAYER_INFO
+ ******************************************************************************/
+
+/*
+ * bench_update_population - Time PLAYER_INFO for `count` players in a square
+ *
+ * Every tick each player that has stopped is sent to a random tile of the
+ * square (naive path), everyone steps (player_process_movement) and is
+ * refiled in the zone grid, then every viewer's packet is encoded and
+ * the tick ends as in world_process() (player_list_end_tick). Only
+ * the encoding is timed, over TICKS ticks per run.
+ */
+static void bench_update_population(u32 count, u32 side) {
+    enum { WARMUP = 5, TICKS = 10 };
+
+    World* world = world_create(MAX_PLAYERS);
+    Player* players = calloc(count, sizeof(Player));
+    PlayerConnection* conns = calloc(count, sizeof(PlayerConnection));
+    StreamBuffer* block = buffer_create(MAX_PACKET_SIZE);
+    if (!world || !players || !conns || !block) {
+        fprintf(stderr, "update_player: out of memory for %u players\n", count);
+        return;
+    }
+    g_world = world;
+
+    u32 x0 = AREA_X - side / 2, z0 = AREA_Z - side / 2;
+    rng_seed(0x0DA7 + count * 131 + side);
+    for (u32 i = 0; i < count; i++) {
+        Player* p = &players[i];
+        char username[16];
+        player_init(p, i, &conns[i]);
+        player_data_init(p);
+        position_init(&p->position, x0 + rng_range(side), z0 + rng_range(side), 0);
+        /* Loaded area centred on the square: no region change while walking */
+        p->origin_x = AREA_X;
+        p->origin_z = AREA_Z;
+        snprintf(username, sizeof(username), "bench%u", i);
+        world_register_player(world, p, username);
+        zone_grid_update(world->zone_grid, p->index, &p->position);
+    }
+
+    Result* r = result_begin("update_player", (u64)count * TICKS);
+    if (!r) goto done;
+    snprintf(r->params, sizeof(r->params), "\"players\": %u, \"area_side\": %u, "
+             "\"density_per_100_tiles\": %.2f", count, side, 100.0 * count / (side * side));
+
+    u64 bytes = 0, viewer_ticks = 0;
+    for (u32 run = 0; run < g_repeat; run++) {
+        u64 elapsed = 0;
+        for (u32 tick = 0; tick < WARMUP + TICKS; tick++) {
+            bool timed = tick >= WARMUP;
+            for (u32 i = 0; i < count; i++) {
+                Player* p = &players[i];
+                if (!movement_is_moving(&p->movement)) {
+                    movement_reset(&p->movement);
+                    movement_naive_path(&p->movement, position_x(&p->position), position_z(&p->position),
+                                        x0 + rng_range(side), z0 + rng_range(side));
+                }
+                player_process_movement(p);
+                if (p->primary_direction != -1) player_list_mark_changed(world->player_list, p);
+                zone_grid_update(world->zone_grid, p->index, &p->position);
+            }
+
+            u64 start = now_ns();
+            for (u32 i = 0; i < count; i++) {
+                Player* p = &players[i];
+                update_player_encode(p, world->player_tracking[p->index], world->player_list,
+                                     world->zone_grid, block);
+            }
+            if (timed) elapsed += now_ns() - start;
+
+            for (u32 i = 0; i < count; i++) {
+                Player* p = &players[i];
+                if (timed && run == 0) {
+                    bytes += p->conn->out_stream.position;
+                    viewer_ticks++;
+                }
+                buffer_reset(&p->conn->out_stream);
+            }
+            player_list_end_tick(world->player_list);
+        }
+        result_add(r, elapsed);
+    }
+    r->bytes_per_op = viewer_ticks ? (double)bytes / viewer_ticks : 0;
+
+done:
+    for (u32 i = 0; i < count; i++) {
+        if (players[i].state == PLAYER_STATE_LOGGED_IN) world_unregister_player(world, &players[i]);
+        movement_destroy(&players[i].movement);
+        player_free(&players[i]);
+    }
+    g_world = NULL;
+    world_destroy(world);
+    buffer_destroy(block);
+    free(players);
+    free(conns);
+}
+
+static void bench_update_player(void) {
+    static const u32 COUNTS[] = { 10, 100, 1000 };
+    static const u32 SIDES[] = { 16, 32, 64 };
+    for (u32 c = 0; c < 3; c++) {
+        for (u32 s = 0; s < 3; s++) bench_update_population(COUNTS[c], SIDES[s]);
+    }
+}
+
+/*******************************************************************************
+ * COMBAT
+ ******************************************************************************/
+
+/*
+ * bench_combat_pairs - Time `pairs` NPC fights per tick
+ *
+ * Pairs of Men stand next to each other in a grid and fight; a pair whose
+ * fight ended (one died) starts again once both are back from respawning.
+ * A tick is timer_wheel_advance(), which runs every swing and hit due,
+ * plus npc_system_end_tick(); restarting fights is not timed. ns/op is
+ * per pair per tick, so it includes the ticks a pair spends between
+ * swings.
+ */
+static void bench_combat_pairs(u32 pairs) {
+    enum { TICKS = 50, ROW = 40 };
+
+    g_defs = def_store_create(NULL);
+    g_timers = timer_wheel_create(4096, 0);
+    g_npcs = npc_system_create(MAX_NPCS);
+    g_combat = combat_system_create();
+    if (!g_defs || !g_timers || !g_npcs || !g_combat || !npc_system_init(g_npcs)) {
+        fprintf(stderr, "combat_tick: setup failed\n");
+        goto done;
+    }
+
+    u16* fighters = malloc(pairs * 2 * sizeof(u16));
+    u32 spawned = 0;
+    for (u32 i = 0; i < pairs && fighters; i++) {
+        u32 x = AREA_X - 60 + (i % ROW) * 3, z = AREA_Z - 60 + (i / ROW) * 2;
+        Npc* a = npc_spawn(g_npcs, 1, x, z, 0);
+        Npc* b = npc_spawn(g_npcs, 1, x + 1, z, 0);
+        if (!a || !b) break;
+        fighters[spawned * 2] = COMBAT_NPC(a->index);
+        fighters[spawned * 2 + 1] = COMBAT_NPC(b->index);
+        spawned++;
+    }
+
+    Result* r = result_begin("combat_tick", (u64)spawned * TICKS);
+    if (!r || spawned == 0) goto free_fighters;
+    snprintf(r->params, sizeof(r->params), "\"pairs\": %u", spawned);
+
+    u64 tick = 0, fighting = 0;
+    for (u32 run = 0; run <= g_repeat; run++) {   /* Run 0 warms up */
+        u64 elapsed = 0;
+        for (u32 t = 0; t < TICKS; t++) {
+            for (u32 i = 0; i < spawned; i++) {
+                u16 a = fighters[i * 2], b = fighters[i * 2 + 1];
+                if (g_combat->target[a] == COMBAT_NONE && g_combat->target[b] == COMBAT_NONE) {
+                    combat_attack(g_combat, a, b);
+                }
+            }
+            u64 start = now_ns();
+            timer_wheel_advance(g_timers, ++tick);
+            npc_system_end_tick(g_npcs);
+            elapsed += now_ns() - start;
+            if (run > 0) fighting += g_combat->fighting;
+        }
+        if (run > 0) result_add(r, elapsed);
+    }
+    /* Most of the fighters are fighting at any time */
+    r->ok = fighting > (u64)spawned * TICKS * g_repeat;
+
+free_fighters:
+    free(fighters);
+done:
+    combat_system_destroy(g_combat);
+    g_combat = NULL;
+    npc_system_destroy(g_npcs);
+    g_npcs = NULL;
+    timer_wheel_destroy(g_timers);
+    g_timers = NULL;
+    def_store_destroy(g_defs);
+    g_defs = NULL;
+}
+
+static void bench_combat(void) {
+    bench_combat_pairs(1000);
+    bench_combat_pairs(4000);
+}
+
+/*******************************************************************************
+ * SAVES
+ ******************************************************************************/
+
+/* A save with non-default values in every field the format stores */
+static void make_save_player(Player* p, PlayerConnection* conn) {
+    player_init(p, 0, conn);
+    player_data_init(p);
+    snprintf(p->username, sizeof(p->username), "hotpathbench");
+    position_init(&p->position, 3210, 3424, 0);
+    rng_seed(0x5A7E);
+    for (u32 i = 0; i < SKILL_COUNT; i++) {
+        p->experience[i] = rng_range(13000000);
+        p->levels[i] = (u8)(1 + rng_range(99));
+    }
+    p->playtime = rng_next();
+    p->last_login = 1700000000000ull + rng_range(1000000);
+}
+
+static void bench_save(void) {
+    static Player source, copy;
+    static PlayerConnection source_conn, copy_conn;
+    static u8 saved[PLAYER_SAVE_MAX_SIZE], again[PLAYER_SAVE_MAX_SIZE];
+    make_save_player(&source, &source_conn);
+    player_init(&copy, 1, &copy_conn);
+    size_t size = player_save_serialize(&source, saved);
+
+    enum { CALLS = 20000, DISK_CALLS = 200 };
+    Result* r = result_begin("player_save_roundtrip", CALLS);
+    if (r) {
+        snprintf(r->params, sizeof(r->params), "\"save_bytes\": %zu", size);
+        r->bytes_per_op = (double)size;
+        for (u32 run = 0; run < g_repeat; run++) {
+            u64 start = now_ns();
+            for (u32 i = 0; i < CALLS; i++) {
+                size_t n = player_save_serialize(&source, again);
+                player_load_buffer(&copy, again, (u32)n);
+            }
+            result_add(r, now_ns() - start);
+        }
+        /* The loaded copy must serialize to the same bytes */
+        size_t n = player_save_serialize(&copy, again);
+        r->ok = n == size && memcmp(saved, again, size) == 0;
+    }
+
+    r = result_begin("player_save_disk", DISK_CALLS);
+    if (r) {
+        snprintf(r->params, sizeof(r->params), "\"save_bytes\": %zu", size);
+        r->bytes_per_op = (double)size;
+        u32 got = 0;
+        for (u32 run = 0; run < g_repeat && r->ok; run++) {
+            u64 start = now_ns();
+            for (u32 i = 0; i < DISK_CALLS; i++) {
+                if (!player_save_write(source.username, saved, size) ||
+                    !player_load_read(source.username, again, sizeof(again), &got)) {
+                    r->ok = false;
+                    break;
+                }
+            }
+            result_add(r, now_ns() - start);
+        }
+        r->ok = r->ok && got == size && memcmp(saved, again, size) == 0;
+
+        char path[256];
+        if (player_get_save_path(source.username, path, sizeof(path)) > 0) unlink(path);
+    }
+    movement_destroy(&source.movement);
+    movement_destroy(&copy.movement);
+    player_free(&source);
+    player_free(&copy);
+}
+
+/*******************************************************************************
+ * REPORT
+ ******************************************************************************/
+
+static void print_json(FILE* out) {
+    fprintf(out, "{\n  \"suite\": \"hotpath_bench\",\n  \"repeat\": %u,\n"
+            "  \"crc32_backend\": \"%s\",\n  \"results\": [\n", g_repeat, crc32_backend());
+    for (u32 i = 0; i < g_result_count; i++) {
+        const Result* r = &g_results[i];
+        double median = result_median(r);
+        fprintf(out, "    {\"name\": \"%s\", \"params\": {%s}, \"ops\": %llu, "
+                "\"ns_per_op\": {\"median\": %.3f, \"min\": %.3f}, \"ops_per_s\": %.0f",
+                r->name, r->params, (unsigned long long)r->ops, median, result_min(r),
+                median > 0 ? 1e9 / median : 0.0);
+        if (r->bytes_per_op > 0) {
+            fprintf(out, ", \"bytes_per_op\": %.1f, \"mb_per_s\": %.1f", r->bytes_per_op,
+                    median > 0 ? r->bytes_per_op * 1e3 / median : 0.0);
+        }
+        fprintf(out, ", \"ok\": %s}%s\n", r->ok ? "true" : "false",
+                i + 1 < g_result_count ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+}
+
+static void print_summary(const Result* r) {
+    fprintf(stderr, "%-24s %12.1f ns/op  (min %10.1f)  %-4s {%s}\n", r->name, result_median(r),
+            result_min(r), r->ok ? "ok" : "FAIL", r->params);
+}
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            g_repeat = (u32)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            g_filter = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--repeat N] [--filter SUBSTRING]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (g_repeat < 1) g_repeat = 1;
+    if (g_repeat > MAX_REPEAT) g_repeat = MAX_REPEAT;
+
+    /* The server logs to stdout (registrations, loads): keep it for the JSON */
+    fflush(stdout);
+    FILE* json = fdopen(dup(STDOUT_FILENO), "w");
+    int null_fd = open("/dev/null", O_WRONLY);
+    if (!json || null_fd < 0) {
+        perror("hotpath_bench");
+        return 2;
+    }
+    dup2(null_fd, STDOUT_FILENO);
+    close(null_fd);
+
+    /* names: the results a group produces, matched against --filter */
+    struct {
+        const char* names;
+        void (*run)(void);
+    } benches[] = {
+        { "buffer_write_bits", bench_write_bits },
+        { "isaac_get_next isaac_keys", bench_isaac },
+        { "map_calculate_crc32", bench_crc32 },
+        { "movement_naive_path", bench_naive_path },
+        { "update_player", bench_update_player },
+        { "combat_tick", bench_combat },
+        { "player_save_roundtrip player_save_disk", bench_save },
+        { "pathfinder_find_tile", bench_pathfinder },
+    };
+
+    bool all_ok = true;
+    for (u32 b = 0; b < sizeof(benches) / sizeof(benches[0]); b++) {
+        if (!wanted(benches[b].names)) continue;
+        u32 first = g_result_count;
+        benches[b].run();
+        for (u32 i = first; i < g_result_count; i++) {
+            print_summary(&g_results[i]);
+            all_ok = all_ok && g_results[i].ok;
+        }
+    }
+
+    print_json(json);
+    fclose(json);
+    return all_ok ? 0 : 1;
+}
@@ -0,0 +1,726 @@
+/*******************************************************************************
+ * LOADBOT.C - Headless Scripted Bot Clients for Load Testing
+ *******************************************************************************
+ *
+ * Opens hundreds or thousands of game connections from one process, logs
+ * each in as its own bot and keeps it busy like a player: walking around
+ * its spawn, chatting, redesigning and streaming the map files its area
+ * needs. Meanwhile it measures what players would feel and what the
+ * server ships:
+ *
+ *   login latency   connect() to the login response byte
+ *   tick jitter     gap between PLAYER_INFO packets, minus the 600 ms tick
+ *   bandwidth       bytes received and sent, per second and per bot
+ *
+ * One thread, one epoll set, non-blocking sockets. Bots do not render or
+ * keep world state: server packets are framed with the client's size
+ * table (protocol.h) and ISAAC, and only LOAD_AREA and PLAYER_INFO are
+ * looked at. Everything else is counted and skipped, so a bot costs a
+ * few hundred bytes and the tool can outrun the server it is testing.
+ *
+ * BOT LIFECYCLE:
+ *
+ *   CONNECTING ─► SEED (8 bytes) ─► RESPONSE (1 byte) ─► INGAME
+ *        │          send login          2 = OK               │
+ *        └──────────────── refused / closed ─────────────────┴─► DONE
+ *
+ *   In game, each bot on its own randomized timers:
+ *     walk     MOVE_GAMECLICK to a tile near the spawn (server pathfinds)
+ *     chat     MESSAGE_PUBLIC
+ *     design   IF_PLAYERDESIGN (also once right after login)
+ *     maps     REBUILD_GETMAPS for every file in each LOAD_AREA
+ *
+ * USAGE:
+ *   make loadbot
+ *   ./bin/loadbot [options]
+ *
+ *     --host ADDR       server address           (127.0.0.1)
+ *     --port N          server port              (43594)
+ *     --bots N          connections              (100)
+ *     --rate N          new connections / second (50)
+ *     --seconds N       run time after the ramp  (30)
+ *     --prefix NAME     username prefix          (bot -> bot1, bot2, ...)
+ *     --wander N        walk targets: spawn +- N tiles (10); small
+ *                       values pack the bots into a crowd
+ *     --key PATH        RSA key to encrypt logins with, e = 65537
+ *                       (data/rsa.key; plaintext if the file is missing)
+ *     --walk-ms N       mean time between walks  (3000, 0 = never)
+ *     --chat-ms N       mean time between chats  (20000, 0 = never)
+ *     --design-ms N     mean time between designs (60000, 0 = only once)
+ *     --no-maps         do not request map files
+ *
+ *   The server saves each bot like any new player: point it at a scratch
+ *   data directory, or clear data/players afterwards.
+ *
+ *   Thousands of bots need as many file descriptors: the soft limit is
+ *   raised to the hard limit at start (ulimit -Hn).
+ *
+ * OUTPUT (every 5 seconds, then a summary):
+ *
+ *   time  online  logins  fail   rx KB/s  tx KB/s  jitter p50/p99/max ms
+ *     5s    250     250     0     812.4      3.1     0.2 / 1.4 / 2.0
+ *
+ ******************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "isaac.h"
+#include "protocol.h"
+#include "rsa_key.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Server opcodes the bots read (packets.h has the full list) */
+#define OP_PLAYER_INFO 184
+#define OP_LOAD_AREA 237
+
+/* Client opcodes the bots send */
+#define OP_MOVE_GAMECLICK 181
+#define OP_MESSAGE_PUBLIC 158
+#define OP_IF_PLAYERDESIGN 52
+#define OP_REBUILD_GETMAPS 150
+
+#define TICK_MS 600
+#define BOT_OUT_SIZE 2048           /* Unsent client bytes per bot */
+#define BOT_CAPTURE 512             /* Payload kept for LOAD_AREA */
+#define REPORT_MS 5000
+
+/* Jitter histogram: 100 us buckets up to 1 s, then one overflow bucket */
+#define JITTER_BUCKET_US 100
+#define JITTER_BUCKETS 10001
+
+typedef enum {
+    BOT_IDLE = 0,                   /* Not started yet */
+    BOT_CONNECTING,
+    BOT_SEED,                       /* Waiting for the 8 server seed bytes */
+    BOT_RESPONSE,                   /* Login sent, waiting for the code */
+    BOT_INGAME,
+    BOT_DONE
+} BotState;
+
+typedef struct {
+    i32 fd;
+    BotState state;
+    u32 id;
+    u32 rng;
+    u32 seeds[4];
+    ISAACCipher out_cipher;         /* Client opcodes (seeds) */
+    ISAACCipher in_cipher;          /* Server opcodes (seeds + 50) */
+    u64 connect_ns;
+    u32 seed_have;
+
+    /* Server packet framing (streamed: payloads are not kept) */
+    i32 opcode;                     /* Packet being read, or -1 */
+    u32 size_bytes;                 /* Length bytes still to read */
+    u32 remaining;                  /* Payload bytes still to read */
+    u8 capture[BOT_CAPTURE];
+    u32 captured;
+
+    /* Unsent output */
+    u8 out[BOT_OUT_SIZE];
+    u32 out_len;
+    bool want_write;
+
+    /* Script */
+    i32 spawn_x, spawn_z;
+    bool have_area;
+    u64 next_walk_ns, next_chat_ns, next_design_ns;
+    u64 last_info_ns;
+} Bot;
+
+typedef struct {
+    const char* host;
+    u16 port;
+    u32 bots;
+    u32 rate;
+    u32 seconds;
+    const char* prefix;
+    const char* key_path;
+    u32 walk_ms, chat_ms, design_ms;
+    u32 wander;                     /* Walk targets: spawn +- wander tiles */
+    bool maps;
+} Options;
+
+static Options g_opt = {
+    .host = "127.0.0.1", .port = 43594, .bots = 100, .rate = 50, .seconds = 30,
+    .prefix = "bot", .key_path = RSA_KEY_PATH,
+    .walk_ms = 3000, .chat_ms = 20000, .design_ms = 60000, .wander = 10, .maps = true,
+};
+
+static RsaKey* g_key;
+static i32 g_epoll;
+static struct sockaddr_in g_addr;
+
+/* Results */
+static u64 g_rx, g_tx;
+static u32 g_online, g_logins, g_failed;
+static u64 g_start_ns, g_last_login_ns;     /* Login throughput: first connect to last login */
+static u32* g_login_us;             /* One sample per successful login */
+static u64 g_jitter[JITTER_BUCKETS];
+static u64 g_jitter_count, g_jitter_max_us;
+static u32 g_login_codes[256];
+
+static u64 now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+}
+
+/* xorshift32: per-bot, so runs are reproducible bot by bot */
+static u32 bot_rand(Bot* b) {
+    b->rng ^= b->rng << 13;
+    b->rng ^= b->rng >> 17;
+    b->rng ^= b->rng << 5;
+    return b->rng;
+}
+
+/* Next time for a timer averaging mean_ms: uniform in [mean/2, 3*mean/2) */
+static u64 bot_next(Bot* b, u64 now, u32 mean_ms) {
+    if (mean_ms == 0) return ~0ull;
+    return now + ((u64)mean_ms / 2 + bot_rand(b) % mean_ms) * 1000000ull;
+}
+
+/*******************************************************************************
+ * OUTPUT
+ ******************************************************************************/
+
+static void bot_close(Bot* b, bool failed) {
+    if (b->fd >= 0) {
+        epoll_ctl(g_epoll, EPOLL_CTL_DEL, b->fd, NULL);
+        close(b->fd);
+        b->fd = -1;
+    }
+    if (b->state == BOT_INGAME) g_online--;
+    if (failed && b->state != BOT_INGAME) g_failed++;
+    b->state = BOT_DONE;
+}
+
+static void bot_watch(Bot* b, bool want_write) {
+    struct epoll_event ev;
+    ev.events = EPOLLIN | (want_write ? EPOLLOUT : 0);
+    ev.data.u32 = b->id;
+    epoll_ctl(g_epoll, EPOLL_CTL_MOD, b->fd, &ev);
+    b->want_write = want_write;
+}
+
+/* Send what is queued; watch for writability while some is left */
+static void bot_flush(Bot* b) {
+    u32 sent = 0;
+    while (sent < b->out_len) {
+        ssize_t n = send(b->fd, b->out + sent, b->out_len - sent, MSG_NOSIGNAL);
+        if (n > 0) {
+            sent += (u32)n;
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        bot_close(b, true);
+        return;
+    }
+    g_tx += sent;
+    memmove(b->out, b->out + sent, b->out_len - sent);
+    b->out_len -= sent;
+    if ((b->out_len > 0) != b->want_write) bot_watch(b, b->out_len > 0);
+}
+
+/* Room for a packet of at most n bytes (false: the bot is backed up, skip it) */
+static bool bot_room(Bot* b, u32 n) {
+    return b->out_len + n <= BOT_OUT_SIZE;
+}
+
+static void bot_p1(Bot* b, u32 v) { b->out[b->out_len++] = (u8)v; }
+
+static void bot_p2(Bot* b, u32 v) {
+    bot_p1(b, v >> 8);
+    bot_p1(b, v);
+}
+
+static void bot_opcode(Bot* b, u8 opcode) {
+    bot_p1(b, opcode + isaac_get_next(&b->out_cipher));
+}
+
+/*******************************************************************************
+ * SCRIPT
+ ******************************************************************************/
+
+/* Destination-only walk: the server pathfinds from the bot's position */
+static void bot_walk(Bot* b) {
+    if (!b->have_area || !bot_room(b, 7)) return;
+    i32 wander = (i32)g_opt.wander;
+    i32 x = b->spawn_x + (i32)(bot_rand(b) % (2 * g_opt.wander + 1)) - wander;
+    i32 z = b->spawn_z + (i32)(bot_rand(b) % (2 * g_opt.wander + 1)) - wander;
+    bot_opcode(b, OP_MOVE_GAMECLICK);
+    bot_p1(b, 5);
+    bot_p1(b, bot_rand(b) & 1);     /* ctrl: run */
+    bot_p2(b, (u32)x);
+    bot_p2(b, (u32)z);
+}
+
+/*
+ * Chat lines, packed in advance by bot_pack_chat(). Only letters from the
+ * first 13 of the client's wordpack table (etaoin hsrdlu) are used, so
+ * every character is one nibble.
+ */
+static const char* const CHAT_LINES[] = {
+    "hello there", "is the inn near", "i need a rest", "the tide is out", "red or older",
+};
+#define CHAT_LINE_COUNT (sizeof(CHAT_LINES) / sizeof(CHAT_LINES[0]))
+
+static u32 bot_pack_chat(const char* text, u8* out) {
+    static const char TABLE[] = "etaoin hsrdlu";
+    u32 len = 0;
+    i32 carry = -1;
+    for (const char* c = text; *c; c++) {
+        i32 index = (i32)(strchr(TABLE, *c) - TABLE);
+        if (carry < 0) {
+            carry = index;
+        } else {
+            out[len++] = (u8)((carry << 4) + index);
+            carry = -1;
+        }
+    }
+    if (carry >= 0) out[len++] = (u8)(carry << 4);
+    return len;
+}
+
+static void bot_chat(Bot* b) {
+    u8 packed[64];
+    u32 len = bot_pack_chat(CHAT_LINES[bot_rand(b) % CHAT_LINE_COUNT], packed);
+    if (!bot_room(b, len + 4)) return;
+    bot_opcode(b, OP_MESSAGE_PUBLIC);
+    bot_p1(b, len + 2);
+    bot_p1(b, bot_rand(b) % 12);    /* Colour */
+    bot_p1(b, 0);                   /* Effect */
+    memcpy(b->out + b->out_len, packed, len);
+    b->out_len += len;
+}
+
+/* The default male kits (the design screen's starting point), random colours */
+static void bot_design(Bot* b) {
+    static const u8 KITS[7] = { 0, 10, 18, 26, 33, 36, 42 };
+    static const u8 COLOUR_COUNTS[5] = { 12, 16, 16, 6, 8 };
+    if (!bot_room(b, 14)) return;
+    bot_opcode(b, OP_IF_PLAYERDESIGN);
+    bot_p1(b, 0);
+    for (u32 i = 0; i < 7; i++) bot_p1(b, KITS[i]);
+    for (u32 i = 0; i < 5; i++) bot_p1(b, bot_rand(b) % COLOUR_COUNTS[i]);
+}
+
+/*
+ * LOAD_AREA: [zone_x:2][zone_z:2] then [x][z][land_crc:4][loc_crc:4] per
+ * file. Remember the spawn and ask for every file that exists, as a
+ * client with an empty cache does.
+ */
+static void bot_load_area(Bot* b, const u8* p, u32 len) {
+    if (len < 4) return;
+    b->spawn_x = ((p[0] << 8) | p[1]) * 8 + 4;
+    b->spawn_z = ((p[2] << 8) | p[3]) * 8 + 4;
+    b->have_area = true;
+    if (!g_opt.maps) return;
+
+    u32 files = (len - 4) / 10;
+    if (files == 0 || !bot_room(b, 2 + files * 6)) return;
+    bot_opcode(b, OP_REBUILD_GETMAPS);
+    u32 length_at = b->out_len;
+    bot_p1(b, 0);
+    for (u32 i = 0; i < files; i++) {
+        const u8* f = p + 4 + i * 10;
+        bool land = f[2] | f[3] | f[4] | f[5];
+        bool loc = f[6] | f[7] | f[8] | f[9];
+        if (land) { bot_p1(b, 0); bot_p1(b, f[0]); bot_p1(b, f[1]); }
+        if (loc) { bot_p1(b, 1); bot_p1(b, f[0]); bot_p1(b, f[1]); }
+    }
+    b->out[length_at] = (u8)(b->out_len - length_at - 1);
+}
+
+/* PLAYER_INFO arrives once per tick: its spacing is the tick as felt */
+static void bot_player_info(Bot* b, u64 now) {
+    if (b->last_info_ns) {
+        u64 gap_us = (now - b->last_info_ns) / 1000;
+        u64 dev = gap_us > TICK_MS * 1000 ? gap_us - TICK_MS * 1000 : TICK_MS * 1000 - gap_us;
+        u64 bucket = dev / JITTER_BUCKET_US;
+        g_jitter[bucket < JITTER_BUCKETS - 1 ? bucket : JITTER_BUCKETS - 1]++;
+        g_jitter_count++;
+        if (dev > g_jitter_max_us) g_jitter_max_us = dev;
+    }
+    b->last_info_ns = now;
+}
+
+/*******************************************************************************
+ * INPUT
+ ******************************************************************************/
+
+static void bot_on_packet(Bot* b, u64 now) {
+    if (b->opcode == OP_PLAYER_INFO) {
+        bot_player_info(b, now);
+    } else if (b->opcode == OP_LOAD_AREA) {
+        bot_load_area(b, b->capture, b->captured);
+    }
+    b->opcode = -1;
+}
+
+/*
+ * bot_feed - Frame server packets out of a stream of game bytes
+ *
+ * Opcode, then 0-2 length bytes (SERVERPROT_SIZES), then the payload.
+ * Payloads are skipped, except LOAD_AREA's, which is kept in capture.
+ */
+static void bot_feed(Bot* b, const u8* data, u32 n, u64 now) {
+    while (n > 0) {
+        if (b->opcode < 0) {
+            b->opcode = (data[0] - isaac_get_next(&b->in_cipher)) & 0xFF;
+            i32 size = _Protocol.SERVERPROT_SIZES[b->opcode];
+            b->size_bytes = size == -1 ? 1 : size == -2 ? 2 : 0;
+            b->remaining = size > 0 ? (u32)size : 0;
+            b->captured = 0;
+            data++, n--;
+        } else if (b->size_bytes > 0) {
+            b->remaining = (b->remaining << 8) | data[0];
+            b->size_bytes--;
+            data++, n--;
+        } else {
+            u32 take = b->remaining < n ? b->remaining : n;
+            if (b->opcode == OP_LOAD_AREA) {
+                u32 keep = take < BOT_CAPTURE - b->captured ? take : BOT_CAPTURE - b->captured;
+                memcpy(b->capture + b->captured, data, keep);
+                b->captured += keep;
+            }
+            b->remaining -= take;
+            data += take, n -= take;
+        }
+        if (b->opcode >= 0 && b->size_bytes == 0 && b->remaining == 0) bot_on_packet(b, now);
+    }
+}
+
+/* Login header (login.c): type, length, version, memory, CRCs, RSA block */
+static void bot_send_login(Bot* b) {
+    u8 block[64];
+    u32 block_len = 0;
+    block[block_len++] = 10;
+    for (u32 i = 0; i < 5; i++) {
+        u32 v = i < 4 ? b->seeds[i] : b->id;  /* 4 seeds, then the UID */
+        block[block_len++] = (u8)(v >> 24);
+        block[block_len++] = (u8)(v >> 16);
+        block[block_len++] = (u8)(v >> 8);
+        block[block_len++] = (u8)v;
+    }
+    block_len += (u32)snprintf((char*)block + block_len, sizeof(block) - block_len,
+                               "%s%u\nloadbot\n", g_opt.prefix, b->id + 1);
+
+    u8 rsa[RSA_MAX_BYTES];
+    const u8* body = block;
+    u32 body_len = block_len;
+    if (g_key) {
+        i32 len = rsa_key_encrypt(g_key, 65537, block, block_len, rsa, sizeof(rsa));
+        if (len < 0) {
+            bot_close(b, true);
+            return;
+        }
+        body = rsa;
+        body_len = (u32)len;
+    }
+
+    bot_p1(b, 16);
+    bot_p1(b, 2 + 36 + 1 + body_len);
+    bot_p1(b, 225);
+    bot_p1(b, 0);
+    memset(b->out + b->out_len, 0, 36);
+    b->out_len += 36;
+    bot_p1(b, body_len);
+    memcpy(b->out + b->out_len, body, body_len);
+    b->out_len += body_len;
+    bot_flush(b);
+}
+
+static void bot_readable(Bot* b, u64 now) {
+    static u8 buf[65536];
+    for (;;) {
+        ssize_t n = recv(b->fd, buf, sizeof(buf), 0);
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+            bot_close(b, true);
+            return;
+        }
+        if (n < 0) return;
+        g_rx += (u64)n;
+
+        const u8* p = buf;
+        u32 left = (u32)n;
+        if (b->state == BOT_SEED) {
+            u32 take = 8 - b->seed_have < left ? 8 - b->seed_have : left;
+            b->seed_have += take;
+            p += take, left -= take;
+            if (b->seed_have < 8) continue;
+            b->state = BOT_RESPONSE;
+            bot_send_login(b);
+            if (b->state != BOT_RESPONSE) return;
+        }
+        if (b->state == BOT_RESPONSE && left > 0) {
+            u8 code = *p++;
+            left--;
+            g_login_codes[code]++;
+            if (code != 2) {
+                bot_close(b, true);
+                return;
+            }
+            g_login_us[g_logins++] = (u32)((now - b->connect_ns) / 1000);
+            g_last_login_ns = now;
+            g_online++;
+            b->state = BOT_INGAME;
+            b->next_walk_ns = bot_next(b, now, g_opt.walk_ms);
+            b->next_chat_ns = bot_next(b, now, g_opt.chat_ms);
+            b->next_design_ns = now;
+        }
+        if (b->state == BOT_INGAME && left > 0) bot_feed(b, p, left, now);
+    }
+}
+
+static void bot_start(Bot* b, u64 now) {
+    b->fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (b->fd < 0) {
+        bot_close(b, true);
+        return;
+    }
+    fcntl(b->fd, F_SETFL, fcntl(b->fd, F_GETFL) | O_NONBLOCK);
+    i32 one = 1;
+    setsockopt(b->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    b->connect_ns = now;
+    b->state = BOT_CONNECTING;
+    if (connect(b->fd, (struct sockaddr*)&g_addr, sizeof(g_addr)) < 0 && errno != EINPROGRESS) {
+        bot_close(b, true);
+        return;
+    }
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLOUT;
+    ev.data.u32 = b->id;
+    epoll_ctl(g_epoll, EPOLL_CTL_ADD, b->fd, &ev);
+    b->want_write = true;
+}
+
+static void bot_event(Bot* b, u32 events, u64 now) {
+    if (b->state == BOT_CONNECTING) {
+        i32 err = 0;
+        socklen_t len = sizeof(err);
+        getsockopt(b->fd, SOL_SOCKET, SO_ERROR, &err, &len);
+        if (err != 0 || (events & (EPOLLERR | EPOLLHUP))) {
+            bot_close(b, true);
+            return;
+        }
+        b->state = BOT_SEED;
+        bot_watch(b, false);
+    }
+    if (events & EPOLLIN) bot_readable(b, now);
+    if (b->fd >= 0 && (events & EPOLLOUT)) bot_flush(b);
+}
+
+/* Timed actions of an in-game bot */
+static void bot_script(Bot* b, u64 now) {
+    if (now >= b->next_design_ns) {
+        bot_design(b);
+        b->next_design_ns = bot_next(b, now, g_opt.design_ms);
+    }
+    if (now >= b->next_walk_ns) {
+        bot_walk(b);
+        b->next_walk_ns = bot_next(b, now, g_opt.walk_ms);
+    }
+    if (now >= b->next_chat_ns) {
+        bot_chat(b);
+        b->next_chat_ns = bot_next(b, now, g_opt.chat_ms);
+    }
+    if (b->out_len > 0 && !b->want_write) bot_flush(b);
+}
+
+/*******************************************************************************
+ * REPORTING
+ ******************************************************************************/
+
+/* Value below which pct% of the jitter samples fall, in ms */
+static double jitter_percentile(u32 pct) {
+    if (g_jitter_count == 0) return 0;
+    u64 rank = (g_jitter_count * pct + 99) / 100;
+    u64 seen = 0;
+    for (u32 i = 0; i < JITTER_BUCKETS; i++) {
+        seen += g_jitter[i];
+        if (seen >= rank) return (i + 1) * JITTER_BUCKET_US / 1000.0;
+    }
+    return g_jitter_max_us / 1000.0;
+}
+
+static int compare_u32(const void* a, const void* b) {
+    u32 x = *(const u32*)a;
+    u32 y = *(const u32*)b;
+    return (x > y) - (x < y);
+}
+
+static void report_line(double seconds, u64 rx, u64 tx, double window_s) {
+    printf("%5.0fs %7u %7u %5u %9.1f %8.1f   %.1f / %.1f / %.1f\n", seconds, g_online, g_logins,
+           g_failed, rx / 1024.0 / window_s, tx / 1024.0 / window_s, jitter_percentile(50),
+           jitter_percentile(99), g_jitter_max_us / 1000.0);
+    fflush(stdout);
+}
+
+static void report_summary(double seconds) {
+    printf("\n%u bots, %u logged in, %u failed", g_opt.bots, g_logins, g_failed);
+    for (u32 code = 0; code < 256; code++) {
+        if (code != 2 && g_login_codes[code]) printf(" (code %u: %u)", code, g_login_codes[code]);
+    }
+    printf("\n");
+
+    if (g_logins > 0) {
+        qsort(g_login_us, g_logins, sizeof(u32), compare_u32);
+        printf("login latency   p50 %.1f  p99 %.1f  max %.1f ms\n",
+               g_login_us[(g_logins * 50 + 99) / 100 - 1] / 1000.0,
+               g_login_us[(g_logins * 99 + 99) / 100 - 1] / 1000.0,
+               g_login_us[g_logins - 1] / 1000.0);
+        double ramp_s = (g_last_login_ns - g_start_ns) / 1e9;
+        printf("login rate      %.1f/s  (%u logins in %.1f s)\n",
+               ramp_s > 0 ? g_logins / ramp_s : 0.0, g_logins, ramp_s);
+    }
+    printf("tick jitter     p50 %.1f  p99 %.1f  max %.1f ms  (%llu PLAYER_INFO gaps)\n",
+           jitter_percentile(50), jitter_percentile(99), g_jitter_max_us / 1000.0,
+           (unsigned long long)g_jitter_count);
+    printf("bandwidth       rx %.1f KB/s  tx %.1f KB/s  (rx %.2f KB/s per bot)\n",
+           g_rx / 1024.0 / seconds, g_tx / 1024.0 / seconds,
+           g_logins ? g_rx / 1024.0 / seconds / g_logins : 0.0);
+}
+
+/*******************************************************************************
+ * MAIN
+ ******************************************************************************/
+
+static bool parse_options(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(arg, "--no-maps") == 0) {
+            g_opt.maps = false;
+            continue;
+        }
+        if (!value) {
+            fprintf(stderr, "Unknown or incomplete option: %s\n", arg);
+            return false;
+        }
+        i++;
+        if (strcmp(arg, "--host") == 0) g_opt.host = value;
+        else if (strcmp(arg, "--port") == 0) g_opt.port = (u16)atoi(value);
+        else if (strcmp(arg, "--bots") == 0) g_opt.bots = (u32)atoi(value);
+        else if (strcmp(arg, "--rate") == 0) g_opt.rate = (u32)atoi(value);
+        else if (strcmp(arg, "--seconds") == 0) g_opt.seconds = (u32)atoi(value);
+        else if (strcmp(arg, "--prefix") == 0) g_opt.prefix = value;
+        else if (strcmp(arg, "--key") == 0) g_opt.key_path = value;
+        else if (strcmp(arg, "--walk-ms") == 0) g_opt.walk_ms = (u32)atoi(value);
+        else if (strcmp(arg, "--chat-ms") == 0) g_opt.chat_ms = (u32)atoi(value);
+        else if (strcmp(arg, "--design-ms") == 0) g_opt.design_ms = (u32)atoi(value);
+        else if (strcmp(arg, "--wander") == 0) g_opt.wander = (u32)atoi(value);
+        else {
+            fprintf(stderr, "Unknown option: %s\n", arg);
+            return false;
+        }
+    }
+    if (g_opt.bots == 0 || g_opt.rate == 0) {
+        fprintf(stderr, "--bots and --rate must be positive\n");
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    if (!parse_options(argc, argv)) return 1;
+
+    memset(&g_addr, 0, sizeof(g_addr));
+    g_addr.sin_family = AF_INET;
+    g_addr.sin_port = htons(g_opt.port);
+    if (inet_pton(AF_INET, g_opt.host, &g_addr.sin_addr) != 1) {
+        fprintf(stderr, "Invalid address: %s\n", g_opt.host);
+        return 1;
+    }
+
+    /* One descriptor per bot */
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    g_key = rsa_key_load(g_opt.key_path);
+    Bot* bots = calloc(g_opt.bots, sizeof(Bot));
+    g_login_us = calloc(g_opt.bots, sizeof(u32));
+    g_epoll = epoll_create1(0);
+    if (!bots || !g_login_us || g_epoll < 0) {
+        fprintf(stderr, "Out of memory or epoll unavailable\n");
+        return 1;
+    }
+
+    u64 start = now_ns();
+    g_start_ns = start;
+    for (u32 i = 0; i < g_opt.bots; i++) {
+        Bot* b = &bots[i];
+        b->id = i;
+        b->fd = -1;
+        b->opcode = -1;
+        b->rng = (i + 1) * 2654435761u;
+        for (u32 s = 0; s < 4; s++) b->seeds[s] = bot_rand(b);
+        u32 in_seeds[4];
+        for (u32 s = 0; s < 4; s++) in_seeds[s] = b->seeds[s] + 50;
+        isaac_init(&b->out_cipher, b->seeds, 4);
+        isaac_init(&b->in_cipher, in_seeds, 4);
+    }
+
+    printf("%u bots -> %s:%u at %u/s for %u s after the ramp, %s logins\n", g_opt.bots,
+           g_opt.host, g_opt.port, g_opt.rate, g_opt.seconds, g_key ? "RSA" : "plaintext");
+    printf(" time  online  logins  fail   rx KB/s  tx KB/s   jitter p50 / p99 / max ms\n");
+
+    u32 started = 0;
+    u64 ramp_ns = (u64)g_opt.bots * 1000000000ull / g_opt.rate;
+    u64 end = start + ramp_ns + (u64)g_opt.seconds * 1000000000ull;
+    u64 next_report = start + REPORT_MS * 1000000ull;
+    u64 report_rx = 0, report_tx = 0;
+    struct epoll_event events[256];
+
+    for (;;) {
+        u64 now = now_ns();
+        if (now >= end) break;
+
+        /* Ramp: connections due by now at --rate per second */
+        u64 due = (now - start) * g_opt.rate / 1000000000ull + 1;
+        while (started < g_opt.bots && started < due) bot_start(&bots[started++], now);
+
+        i32 count = epoll_wait(g_epoll, events, 256, 5);
+        now = now_ns();
+        for (i32 e = 0; e < count; e++) {
+            Bot* b = &bots[events[e].data.u32];
+            if (b->fd >= 0) bot_event(b, events[e].events, now);
+        }
+        for (u32 i = 0; i < started; i++) {
+            if (bots[i].state == BOT_INGAME) bot_script(&bots[i], now);
+        }
+
+        if (now >= next_report) {
+            report_line((now - start) / 1e9, g_rx - report_rx, g_tx - report_tx, REPORT_MS / 1000.0);
+            report_rx = g_rx;
+            report_tx = g_tx;
+            next_report += REPORT_MS * 1000000ull;
+        }
+    }
+
+    report_summary((now_ns() - start) / 1e9);
+
+    for (u32 i = 0; i < g_opt.bots; i++) {
+        if (bots[i].fd >= 0) close(bots[i].fd);
+    }
+    close(g_epoll);
+    free(bots);
+    free(g_login_us);
+    rsa_key_free(g_key);
+    return g_failed ? 1 : 0;
+}
@@ -0,0 +1,383 @@
+/*******************************************************************************
+ * RENDER_BENCH.C - Headless Benchmark of the 3D Model Pipeline
+ *******************************************************************************
+ *
+ * The playground (src/entry/playground.c) draws one model in a window.
+ * This draws a fixed scene of real models from data/archives along a
+ * scripted camera path into an offscreen framebuffer, and reports where
+ * each frame's time went:
+ *
+ *   cull       model_draw's bounds tests and model_draw2's backface and
+ *              depth bucketing
+ *   transform  projecting every vertex to the screen
+ *   raster     priority sorting and drawing the faces (model_draw_face,
+ *              the triangle fillers and their span kernels)
+ *   frame      the whole frame: clearing plus the three above
+ *
+ * model.c is built a second time for this benchmark with
+ * -DMODEL_STAGE_TIMING, which switches a stage clock at each boundary; the
+ * client and server are built without it and pay nothing.
+ *
+ * REPRODUCIBLE:
+ *   Same models, same positions, same path on every run, and the palette
+ *   brightness jitter is seeded. The final framebuffer's FNV-1a hash is
+ *   printed: a renderer change that should not alter the picture must
+ *   keep it (on the same libc - the seeded jitter comes from rand()).
+ *   Frame times are reported as percentiles over the path, after one
+ *   untimed pass that loads every texture.
+ *
+ * USAGE:
+ *   make bench
+ *   ./bin/render_bench [--frames N] [--size WxH] [--lowmem] [--threads N]
+ *                      [--data DIR] [--ppm FILE] > results.json
+ *
+ *   make bench-gpu
+ *   ./bin/render_bench_gpu --gpu [...]
+ *
+ *   --frames N   frames along the path (default 240)
+ *   --size WxH   framebuffer (default 512x334, the client's viewport)
+ *   --lowmem     low memory textures (64x64) and jagged Gouraud shading
+ *   --threads N  bin triangles and rasterize on N threads (pix3d_bin.h)
+ *   --data DIR   directory holding models and textures (data/archives)
+ *   --ppm FILE   also write the final frame as an image
+ *   --gpu        draw through GL ES 2 on a surfaceless EGL context
+ *                (pix3d_gpu.h; render_bench_gpu only). The picture is
+ *                close to the software one, so its checksum differs
+ *
+ * OUTPUT:
+ *   stdout  {"suite": "render_bench", ..., "stages": {"frame": {"p50_us":
+ *            ..., "p90_us": ..., "p99_us": ..., "max_us": ..., "mean_us":
+ *            ...}, "cull": ..., "transform": ..., "raster": ...},
+ *            "checksum": "..."}
+ *   stderr  one human-readable line per stage
+ *
+ ******************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "model.h"
+#include "pix2d.h"
+#include "pix3d.h"
+#include "pix3d_bin.h"
+#include "pix3d_gpu.h"
+#include "pix3d_span.h"
+#include "jagfile.h"
+#include "defines.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef PIX3D_GPU
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+/* Defined by main.c in the server; the benchmark links everything else */
+void* g_server = NULL;
+
+extern Pix3D _Pix3D;
+extern ModelData _Model;
+
+/* Scene: a grid of models, GRID x GRID, SPACING apart */
+#define GRID 10
+#define SPACING 320
+#define ORBIT_RADIUS 2400
+
+#define STAGE_FRAME MODEL_STAGE_COUNT
+#define STAGES (MODEL_STAGE_COUNT + 1)
+
+static const char* STAGE_NAMES[STAGES] = { NULL, "cull", "transform", "raster", "frame" };
+
+typedef struct {
+    Model* model;
+    int x, z, yaw;
+} SceneModel;
+
+static SceneModel g_scene[GRID * GRID];
+static int g_scene_count;
+static int g_scene_faces;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * load_archive - Read a whole archive file and parse it
+ */
+static Jagfile* load_archive(const char* dir, const char* name) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "render_bench: cannot open %s\n", path);
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    int8_t* data = malloc(size);
+    if (!data || fread(data, 1, size, file) != (size_t)size) {
+        fprintf(stderr, "render_bench: cannot read %s\n", path);
+        fclose(file);
+        free(data);
+        return NULL;
+    }
+    fclose(file);
+    return jagfile_new(data, (int)size);
+}
+
+/*
+ * build_scene - Lit models on a grid: every 7th model id of 50..2000 faces
+ */
+static void build_scene(void) {
+    int id = 0;
+    while (g_scene_count < GRID * GRID && id < _Model.metadata_count) {
+        Metadata* meta = _Model.metadata[id];
+        if (meta && meta->face_count >= 50 && meta->face_count <= 2000) {
+            Model* model = model_from_id(id, false);
+            model_calculate_normals(model, 64, 850, -30, -50, -30, true, false);
+
+            SceneModel* s = &g_scene[g_scene_count];
+            s->model = model;
+            s->x = (g_scene_count % GRID) * SPACING;
+            s->z = (g_scene_count / GRID) * SPACING;
+            s->yaw = (g_scene_count * 411) & 2047;
+            g_scene_faces += model->face_count;
+            g_scene_count++;
+        }
+        id += 7;
+    }
+}
+
+/*
+ * draw_frame - One frame of the camera path (frame of frames)
+ *
+ * The camera orbits the grid's centre once, its pitch rocking between
+ * shallow and steep so near clipping and distant models both occur.
+ */
+static void draw_frame(int frame, int frames, bool binned, bool gpu) {
+    int yaw = frame * 2048 / frames & 2047;
+    int pitch = 160 + (_Pix3D.sin_table[frame * 4096 / frames & 2047] * 96 >> 16);
+    int sinYaw = _Pix3D.sin_table[yaw];
+    int cosYaw = _Pix3D.cos_table[yaw];
+    int sinPitch = _Pix3D.sin_table[pitch];
+    int cosPitch = _Pix3D.cos_table[pitch];
+
+    int centre = (GRID - 1) * SPACING / 2;
+    int horizontal = ORBIT_RADIUS * cosPitch >> 16;
+    int eyeX = centre + (horizontal * sinYaw >> 16);
+    int eyeY = -(ORBIT_RADIUS * sinPitch >> 16);
+    int eyeZ = centre - (horizontal * cosYaw >> 16);
+
+    pix2d_clear();
+    if (gpu) pix3d_gpu_begin();
+    if (binned) pix3d_bin_begin();
+    for (int i = 0; i < g_scene_count; i++) {
+        SceneModel* s = &g_scene[i];
+        model_draw(s->model, s->yaw, sinPitch, cosPitch, sinYaw, cosYaw, s->x - eyeX, -eyeY, s->z - eyeZ, 0);
+    }
+    if (binned) pix3d_bin_end();
+    if (gpu) pix3d_gpu_end();
+}
+
+#ifdef PIX3D_GPU
+static void* egl_proc(const char* name) {
+    return (void*)eglGetProcAddress(name);
+}
+
+/*
+ * gpu_context - A surfaceless GL ES 2 context (Mesa), drawn offscreen
+ */
+static bool gpu_context(void) {
+    PFNEGLGETPLATFORMDISPLAYEXTPROC platform_display =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    EGLDisplay display = platform_display ? platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL)
+                                          : eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL)) {
+        fprintf(stderr, "render_bench: no EGL display\n");
+        return false;
+    }
+    const EGLint config_attribs[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT, EGL_NONE };
+    const EGLint context_attribs[] = { EGL_CONTEXT_CLIENT_VERSION, 2, EGL_NONE };
+    EGLConfig config = NULL;
+    EGLint count = 0;
+    eglChooseConfig(display, config_attribs, &config, 1, &count);
+    eglBindAPI(EGL_OPENGL_ES_API);
+    EGLContext context = eglCreateContext(display, count > 0 ? config : NULL, EGL_NO_CONTEXT, context_attribs);
+    if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+        fprintf(stderr, "render_bench: no GL ES 2 context\n");
+        return false;
+    }
+    Pix3DGpuContext gpu = { egl_proc, NULL };
+    return pix3d_gpu_start(&gpu);
+}
+#endif
+
+static int compare_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile_us(const uint64_t* sorted, int count, int pct) {
+    int index = (count * pct + 99) / 100 - 1;
+    if (index < 0) index = 0;
+    if (index >= count) index = count - 1;
+    return sorted[index] / 1000.0;
+}
+
+int main(int argc, char** argv) {
+    int frames = 240;
+    int width = 512;
+    int height = 334;
+    int threads = 0;
+    bool lowmem = false;
+    bool gpu = false;
+    const char* data_dir = "data/archives";
+    const char* ppm = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frames = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc &&
+                   sscanf(argv[i + 1], "%dx%d", &width, &height) == 2) {
+            i++;
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--lowmem") == 0) {
+            lowmem = true;
+        } else if (strcmp(argv[i], "--data") == 0 && i + 1 < argc) {
+            data_dir = argv[++i];
+        } else if (strcmp(argv[i], "--ppm") == 0 && i + 1 < argc) {
+            ppm = argv[++i];
+#ifdef PIX3D_GPU
+        } else if (strcmp(argv[i], "--gpu") == 0) {
+            gpu = true;
+#endif
+        } else {
+            fprintf(stderr, "usage: %s [--frames N] [--size WxH] [--lowmem] [--threads N] [--data DIR] [--ppm FILE]"
+#ifdef PIX3D_GPU
+                            " [--gpu]"
+#endif
+                            "\n", argv[0]);
+            return 2;
+        }
+    }
+    if (frames < 1) frames = 1;
+    if (width < 64 || height < 64 || width > 8192 || height > 8192) {
+        fprintf(stderr, "render_bench: --size out of range\n");
+        return 2;
+    }
+
+    /* Loaders log to stdout: keep it for the JSON */
+    fflush(stdout);
+    FILE* json = fdopen(dup(STDOUT_FILENO), "w");
+    int null_fd = open("/dev/null", O_WRONLY);
+    if (!json || null_fd < 0) {
+        perror("render_bench");
+        return 2;
+    }
+    dup2(null_fd, STDOUT_FILENO);
+    close(null_fd);
+
+    _Pix3D.lowMemory = lowmem;
+    _Pix3D.jagged = lowmem;
+    model_init_global();
+    pix3d_init_global();
+
+    Jagfile* models = load_archive(data_dir, "models");
+    Jagfile* textures = load_archive(data_dir, "textures");
+    if (!models || !textures) return 2;
+    pix3d_unpack_textures(textures);
+    srand(1);
+    pix3d_set_brightness(0.8);
+    pix3d_init_pool(PIX3D_POOL_COUNT);
+    model_unpack(models);
+    build_scene();
+
+    int* pixels = calloc((size_t)width * height, sizeof(int));
+    pix2d_bind(width, height, pixels);
+    pix3d_init2d();
+    bool binned = threads > 1 && pix3d_bin_start(threads);
+#ifdef PIX3D_GPU
+    if (gpu && !gpu_context()) return 2;
+#endif
+
+    /* One untimed pass: textures expanded, caches warm */
+    for (int frame = 0; frame < frames; frame++) draw_frame(frame, frames, binned, gpu);
+
+    uint64_t* samples[STAGES];
+    for (int s = 0; s < STAGES; s++) samples[s] = calloc(frames, sizeof(uint64_t));
+
+    model_stage_clock(now_ns);
+    for (int frame = 0; frame < frames; frame++) {
+        uint64_t before[MODEL_STAGE_COUNT];
+        memcpy(before, g_model_stage_ns, sizeof(before));
+        uint64_t start = now_ns();
+        draw_frame(frame, frames, binned, gpu);
+        samples[STAGE_FRAME][frame] = now_ns() - start;
+        for (int s = MODEL_STAGE_CULL; s < MODEL_STAGE_COUNT; s++) {
+            samples[s][frame] = g_model_stage_ns[s] - before[s];
+        }
+    }
+    model_stage_clock(NULL);
+
+    uint64_t hash = 1469598103934665603ull;
+    for (long i = 0; i < (long)width * height; i++) {
+        hash ^= (uint32_t)pixels[i];
+        hash *= 1099511628211ull;
+    }
+
+    fprintf(json, "{\"suite\": \"render_bench\", \"frames\": %d, \"width\": %d, \"height\": %d, "
+                  "\"lowmem\": %s, \"span_backend\": \"%s\", \"render_threads\": %d, \"gpu\": %s, "
+                  "\"models\": %d, \"faces\": %d, \"stages\": {",
+            frames, width, height, lowmem ? "true" : "false", pix3d_span_backend(),
+            binned ? threads : 1, gpu ? "true" : "false", g_scene_count, g_scene_faces);
+    for (int s = MODEL_STAGE_CULL; s < STAGES; s++) {
+        uint64_t total = 0;
+        for (int f = 0; f < frames; f++) total += samples[s][f];
+        qsort(samples[s], frames, sizeof(uint64_t), compare_u64);
+        double p50 = percentile_us(samples[s], frames, 50);
+        double p90 = percentile_us(samples[s], frames, 90);
+        double p99 = percentile_us(samples[s], frames, 99);
+        double max = samples[s][frames - 1] / 1000.0;
+        double mean = total / 1000.0 / frames;
+
+        fprintf(json, "%s\"%s\": {\"p50_us\": %.1f, \"p90_us\": %.1f, \"p99_us\": %.1f, \"max_us\": %.1f, \"mean_us\": %.1f}",
+                s == MODEL_STAGE_CULL ? "" : ", ", STAGE_NAMES[s], p50, p90, p99, max, mean);
+        fprintf(stderr, "%-10s p50 %8.1f us  p90 %8.1f us  p99 %8.1f us  max %8.1f us\n",
+                STAGE_NAMES[s], p50, p90, p99, max);
+    }
+    fprintf(json, "}, \"checksum\": \"%016llx\"}\n", (unsigned long long)hash);
+    fprintf(stderr, "%d models, %d faces, %dx%d, %s spans, checksum %016llx\n", g_scene_count, g_scene_faces,
+            width, height, pix3d_span_backend(), (unsigned long long)hash);
+    fclose(json);
+
+    FILE* image = ppm ? fopen(ppm, "wb") : NULL;
+    if (image) {
+        fprintf(image, "P6\n%d %d\n255\n", width, height);
+        for (long i = 0; i < (long)width * height; i++) {
+            fputc(pixels[i] >> 16 & 0xff, image);
+            fputc(pixels[i] >> 8 & 0xff, image);
+            fputc(pixels[i] & 0xff, image);
+        }
+        fclose(image);
+    } else if (ppm) {
+        fprintf(stderr, "render_bench: cannot write %s\n", ppm);
+    }
+
+    if (binned) pix3d_bin_stop();
+    if (gpu) pix3d_gpu_stop();
+    for (int i = 0; i < g_scene_count; i++) model_free(g_scene[i].model);
+    for (int s = 0; s < STAGES; s++) free(samples[s]);
+    free(pixels);
+    jagfile_free(models);
+    jagfile_free(textures);
+    model_free_global();
+    pix3d_free_global();
+    return 0;
+}
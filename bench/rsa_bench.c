@@ -0,0 +1,201 @@
+/*******************************************************************************
+ * RSA_BENCH.C - Login Block Decryption Throughput
+ *******************************************************************************
+ *
+ * Times rsa_key_decrypt() (CRT + Montgomery, see src/rsa_key.h) on a
+ * login-shaped block, first on one thread and then on more threads up
+ * to every core, and reports logins per second per core.
+ *
+ * Every decryption is compared with the plaintext, so an arithmetic
+ * change that breaks the result fails loudly instead of just looking
+ * fast.
+ *
+ * USAGE:
+ *   make bench
+ *   ./bin/rsa_bench [key_file] [seconds]     (defaults: data/rsa.key 2)
+ *
+ *   Without a key file the built-in 512-bit test key below is used. It is
+ *   public: never deploy it.
+ *
+ * OUTPUT:
+ *   threads   logins/s   logins/s per core   us/login
+ *
+ ******************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "rsa_key.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_THREADS 64
+
+static const char TEST_KEY[] =
+    "# 512-bit test key (public, benchmarks only)\n"
+    "p = 103317681128566239249258449910145648193183400671076422161840022695216586167901\n"
+    "q = 109812474432945369905757223323261576594248094070574919601339197763628134255903\n"
+    "d = 36349380938216171995726952239707667562270226332616458207999824678421143472006"
+    "20789917931621957045383697245040570248042958863870758085641361966037006583273\n"
+    "e = 65537\n";
+
+typedef struct {
+    const RsaKey* key;
+    const u8* cipher;
+    u32 cipher_len;
+    const u8* plain;
+    u32 plain_len;
+    double seconds;
+    u64 ops;
+    bool ok;
+} Worker;
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void* worker_main(void* arg) {
+    Worker* w = (Worker*)arg;
+    u8 out[RSA_MAX_BYTES];
+    double end = now_s() + w->seconds;
+    w->ok = true;
+
+    /* Check in batches so the clock is not read per login */
+    while (now_s() < end) {
+        for (int i = 0; i < 64; i++) {
+            i32 len = rsa_key_decrypt(w->key, w->cipher, w->cipher_len, out, sizeof(out));
+            if (len != (i32)w->plain_len || memcmp(out, w->plain, w->plain_len) != 0) {
+                w->ok = false;
+            }
+        }
+        w->ops += 64;
+    }
+    return NULL;
+}
+
+/*
+ * run - Decrypt on n threads for the given time
+ *
+ * @return  Logins per second over all threads, or -1 on a wrong result
+ */
+static double run(Worker* proto, u32 threads) {
+    Worker workers[MAX_THREADS];
+    pthread_t handles[MAX_THREADS];
+
+    double start = now_s();
+    for (u32 t = 0; t < threads; t++) {
+        workers[t] = *proto;
+        pthread_create(&handles[t], NULL, worker_main, &workers[t]);
+    }
+    u64 ops = 0;
+    bool ok = true;
+    for (u32 t = 0; t < threads; t++) {
+        pthread_join(handles[t], NULL);
+        ops += workers[t].ops;
+        ok = ok && workers[t].ok;
+    }
+    double elapsed = now_s() - start;
+    return ok ? ops / elapsed : -1;
+}
+
+static char* read_text(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return NULL;
+    char* text = malloc(16385);
+    size_t len = text ? fread(text, 1, 16384, f) : 0;
+    fclose(f);
+    if (text) text[len] = '\0';
+    return text;
+}
+
+/*
+ * key_value - Copy the value of "name = value" out of key file text
+ */
+static bool key_value(const char* text, const char* name, char* out, size_t cap) {
+    size_t name_len = strlen(name);
+    for (const char* line = text; line; line = strchr(line, '\n'), line = line ? line + 1 : NULL) {
+        while (*line == ' ' || *line == '\t') line++;
+        if (strncmp(line, name, name_len) != 0) continue;
+        const char* s = line + name_len;
+        while (*s == ' ' || *s == '\t') s++;
+        if (*s != '=') continue;
+        s++;
+        size_t len = 0;
+        for (; *s && *s != '\n' && *s != '#' && len < cap - 1; s++) {
+            if (*s != ' ' && *s != '\t' && *s != '\r') out[len++] = *s;
+        }
+        out[len] = '\0';
+        return len > 0;
+    }
+    return false;
+}
+
+int main(int argc, char** argv) {
+    const char* path = argc > 1 ? argv[1] : RSA_KEY_PATH;
+    double seconds = argc > 2 ? atof(argv[2]) : 2.0;
+    if (seconds <= 0) seconds = 2.0;
+
+    char* text = read_text(path);
+    const char* key_text = text ? text : TEST_KEY;
+    RsaKey key;
+    if (!rsa_key_parse(&key, key_text)) {
+        fprintf(stderr, "Invalid key %s\n", text ? path : "(built-in)");
+        free(text);
+        return 1;
+    }
+    printf("key: %s (%u-bit modulus)\n", text ? path : "built-in test key", key.bits);
+
+    /* A login block: opcode 10, 4 seeds, uid, username, password */
+    u8 plain[64];
+    u32 plain_len = 0;
+    plain[plain_len++] = 10;
+    for (u32 i = 0; i < 20; i++) plain[plain_len++] = (u8)(i * 73 + 5);
+    memcpy(plain + plain_len, "benchuser\npassword123\n", 22);
+    plain_len += 22;
+
+    /* Encrypt it with the public exponent (65537 unless the file says) */
+    char e_text[16];
+    u32 e = key_value(key_text, "e", e_text, sizeof(e_text)) ? (u32)strtoul(e_text, NULL, 0) : 65537;
+    u8 cipher[RSA_MAX_BYTES];
+    i32 cipher_len = rsa_key_encrypt(&key, e, plain, plain_len, cipher, sizeof(cipher));
+    if (cipher_len < 0) {
+        fprintf(stderr, "Encryption failed\n");
+        free(text);
+        return 1;
+    }
+
+    Worker proto;
+    memset(&proto, 0, sizeof(proto));
+    proto.key = &key;
+    proto.cipher = cipher;
+    proto.cipher_len = (u32)cipher_len;
+    proto.plain = plain;
+    proto.plain_len = plain_len;
+    proto.seconds = seconds;
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    u32 max_threads = cpus > 0 ? (u32)cpus : 1;
+    if (max_threads > MAX_THREADS) max_threads = MAX_THREADS;
+
+    printf("%-8s %12s %20s %10s\n", "threads", "logins/s", "logins/s per core", "us/login");
+    int failures = 0;
+    /* 1, 2, 4, ... threads, then every core */
+    for (u32 threads = 1;; threads = threads * 2 < max_threads ? threads * 2 : max_threads) {
+        double rate = run(&proto, threads);
+        if (rate < 0) {
+            printf("%-8u WRONG RESULT\n", threads);
+            failures++;
+        } else {
+            printf("%-8u %12.0f %20.0f %10.1f\n", threads, rate, rate / threads, threads * 1e6 / rate);
+        }
+        if (threads == max_threads) break;
+    }
+
+    free(text);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,243 @@
+/*******************************************************************************
+ * ACCOUNT_REGISTRY.C - Shared Account Claims
+ *******************************************************************************
+ *
+ * See account_registry.h for when a claim is taken and freed.
+ *
+ ******************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE                 /* MAP_ANONYMOUS */
+
+#include "account_registry.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+AccountRegistry* g_account_registry = NULL;
+
+#ifndef _WIN32
+
+#include <errno.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+/* One account: empty when username[0] == '\0' */
+typedef struct {
+    char username[MAX_USERNAME_LENGTH + 1];     /* Lowercased */
+    u8 owner;                                   /* World index + 1 */
+    bool releasing;                             /* Logged out, save not yet on disk */
+} AccountClaim;
+
+struct AccountRegistry {
+    pthread_mutex_t mutex;                      /* PTHREAD_PROCESS_SHARED, robust */
+    size_t mapped_bytes;
+    u32 mask;                                   /* Capacity - 1 (power of two) */
+    AccountClaim claims[];
+};
+
+/* FNV-1a over the lowercased name; the table is probed from here */
+static u32 claim_home(const AccountRegistry* registry, const char* name) {
+    u32 hash = 2166136261u;
+    for (const char* p = name; *p; p++) hash = (hash ^ (u8)*p) * 16777619u;
+    return hash & registry->mask;
+}
+
+static void claim_key(const char* username, char* out) {
+    u32 i = 0;
+    for (; username[i] && i < MAX_USERNAME_LENGTH; i++) {
+        out[i] = (char)tolower((unsigned char)username[i]);
+    }
+    out[i] = '\0';
+}
+
+/* Slot holding name, or the empty slot where it would go */
+static u32 claim_find(const AccountRegistry* registry, const char* name) {
+    u32 slot = claim_home(registry, name);
+    while (registry->claims[slot].username[0] && strcmp(registry->claims[slot].username, name) != 0) {
+        slot = (slot + 1) & registry->mask;
+    }
+    return slot;
+}
+
+/* Empty a slot, shifting later entries of the probe run back (no tombstones) */
+static void claim_remove(AccountRegistry* registry, u32 slot) {
+    u32 hole = slot;
+    for (u32 i = (slot + 1) & registry->mask; registry->claims[i].username[0];
+         i = (i + 1) & registry->mask) {
+        u32 home = claim_home(registry, registry->claims[i].username);
+        /* Move it if the hole lies on its probe path (home .. i) */
+        if (((i - home) & registry->mask) >= ((i - hole) & registry->mask)) {
+            registry->claims[hole] = registry->claims[i];
+            hole = i;
+        }
+    }
+    registry->claims[hole].username[0] = '\0';
+}
+
+/* A world that died holding the lock leaves the table usable: keep going */
+static bool registry_lock(AccountRegistry* registry) {
+    int rc = pthread_mutex_lock(&registry->mutex);
+    if (rc == EOWNERDEAD) {
+        pthread_mutex_consistent(&registry->mutex);
+        return true;
+    }
+    return rc == 0;
+}
+
+AccountRegistry* account_registry_create(u32 worlds) {
+    /* At most half full with every world at MAX_PLAYERS */
+    u32 capacity = 1;
+    while (capacity < worlds * MAX_PLAYERS * 2) capacity <<= 1;
+    size_t bytes = sizeof(AccountRegistry) + (size_t)capacity * sizeof(AccountClaim);
+
+    void* memory = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        perror("mmap account registry");
+        return NULL;
+    }
+    AccountRegistry* registry = (AccountRegistry*)memory;  /* Zero-filled by mmap */
+    registry->mapped_bytes = bytes;
+    registry->mask = capacity - 1;
+
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    int rc = pthread_mutex_init(&registry->mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+    if (rc != 0) {
+        munmap(memory, bytes);
+        return NULL;
+    }
+    return registry;
+}
+
+void account_registry_destroy(AccountRegistry* registry) {
+    if (!registry) return;
+    pthread_mutex_destroy(&registry->mutex);
+    munmap(registry, registry->mapped_bytes);
+}
+
+bool account_registry_claim(AccountRegistry* registry, const char* username, u32 world) {
+    if (!registry || !username) return true;
+    char name[MAX_USERNAME_LENGTH + 1];
+    claim_key(username, name);
+    if (!registry_lock(registry)) return false;
+
+    AccountClaim* claim = &registry->claims[claim_find(registry, name)];
+    bool ok = true;
+    if (!claim->username[0]) {
+        memcpy(claim->username, name, sizeof(name));
+        claim->owner = (u8)(world + 1);
+        claim->releasing = false;
+    } else if (claim->owner == world + 1) {
+        claim->releasing = false;       /* Back in the same world: its own queue has the save */
+    } else {
+        ok = false;
+    }
+
+    pthread_mutex_unlock(&registry->mutex);
+    return ok;
+}
+
+/* Shared body of release / saved / drop */
+typedef enum { CLAIM_RELEASE, CLAIM_SAVED, CLAIM_DROP } ClaimChange;
+
+static void claim_change(AccountRegistry* registry, const char* username, u32 world, ClaimChange change) {
+    if (!registry || !username) return;
+    char name[MAX_USERNAME_LENGTH + 1];
+    claim_key(username, name);
+    if (!registry_lock(registry)) return;
+
+    u32 slot = claim_find(registry, name);
+    AccountClaim* claim = &registry->claims[slot];
+    if (claim->username[0] && claim->owner == world + 1) {
+        if (change == CLAIM_RELEASE) {
+            claim->releasing = true;
+        } else if (change == CLAIM_DROP || claim->releasing) {
+            claim_remove(registry, slot);
+        }
+    }
+    pthread_mutex_unlock(&registry->mutex);
+}
+
+void account_registry_release(AccountRegistry* registry, const char* username, u32 world) {
+    claim_change(registry, username, world, CLAIM_RELEASE);
+}
+
+void account_registry_saved(AccountRegistry* registry, const char* username, u32 world) {
+    claim_change(registry, username, world, CLAIM_SAVED);
+}
+
+void account_registry_drop(AccountRegistry* registry, const char* username, u32 world) {
+    claim_change(registry, username, world, CLAIM_DROP);
+}
+
+bool account_registry_transfer(AccountRegistry* registry, const char* username, u32 from, u32 to) {
+    if (!registry || !username) return true;
+    char name[MAX_USERNAME_LENGTH + 1];
+    claim_key(username, name);
+    if (!registry_lock(registry)) return false;
+
+    AccountClaim* claim = &registry->claims[claim_find(registry, name)];
+    bool ok = claim->username[0] && claim->owner == from + 1 && !claim->releasing;
+    if (ok) claim->owner = (u8)(to + 1);
+    pthread_mutex_unlock(&registry->mutex);
+    return ok;
+}
+
+u32 account_registry_drop_world(AccountRegistry* registry, u32 world) {
+    if (!registry || !registry_lock(registry)) return 0;
+    u32 dropped = 0;
+    u32 slot = 0;
+    while (slot <= registry->mask) {
+        AccountClaim* claim = &registry->claims[slot];
+        if (claim->username[0] && claim->owner == world + 1) {
+            claim_remove(registry, slot);   /* Something may shift into this slot */
+            dropped++;
+        } else {
+            slot++;
+        }
+    }
+    pthread_mutex_unlock(&registry->mutex);
+    return dropped;
+}
+
+#else /* _WIN32 */
+
+AccountRegistry* account_registry_create(u32 worlds) {
+    (void)worlds;
+    return NULL;
+}
+
+void account_registry_destroy(AccountRegistry* registry) { (void)registry; }
+
+bool account_registry_claim(AccountRegistry* registry, const char* username, u32 world) {
+    (void)registry; (void)username; (void)world;
+    return true;
+}
+
+void account_registry_release(AccountRegistry* registry, const char* username, u32 world) {
+    (void)registry; (void)username; (void)world;
+}
+
+void account_registry_saved(AccountRegistry* registry, const char* username, u32 world) {
+    (void)registry; (void)username; (void)world;
+}
+
+void account_registry_drop(AccountRegistry* registry, const char* username, u32 world) {
+    (void)registry; (void)username; (void)world;
+}
+
+bool account_registry_transfer(AccountRegistry* registry, const char* username, u32 from, u32 to) {
+    (void)registry; (void)username; (void)from; (void)to;
+    return true;
+}
+
+u32 account_registry_drop_world(AccountRegistry* registry, u32 world) {
+    (void)registry; (void)world;
+    return 0;
+}
+
+#endif /* _WIN32 */
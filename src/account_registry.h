@@ -0,0 +1,114 @@
+/*******************************************************************************
+ * ACCOUNT_REGISTRY.H - Which World Holds Each Account (shared across worlds)
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Shared memory between forked processes (MAP_SHARED | MAP_ANONYMOUS)
+ *   - Process-shared, robust mutexes (a dead holder does not wedge others)
+ *   - Ordering a handoff after a write: release only once the save is on disk
+ *
+ * THE PROBLEM:
+ *
+ * With several world processes on one host (supervisor.h) all reading
+ * and writing the same save directory, one account can log into two
+ * worlds at once, and a quick hop from world 1 to world 2 can load the
+ * save file before world 1's logout save has reached it:
+ *
+ *   world 1: logout → save queued ........... written
+ *   world 2:            login → read file ← stale
+ *
+ * Each world's save queue already gives read-your-writes within its own
+ * process (save_queue_lookup); nothing covers the gap between processes.
+ *
+ * THE SOLUTION - ONE TABLE IN SHARED MEMORY:
+ *
+ *   supervisor (before fork): account_registry_create()
+ *     → mmap(MAP_SHARED | MAP_ANONYMOUS), inherited by every world
+ *
+ *   username → { owner world, releasing }     (open addressing, by name)
+ *
+ *   login:   claim    free, or owned by this world  → ours, log in
+ *                     owned by another world       → "already online"
+ *   logout:  release  still ours, marked releasing  → others refused
+ *   written: saved    releasing and no newer save queued → free
+ *
+ *   A world that exits (or crashes) drops every claim it still holds.
+ *
+ * Claims are keyed by the username itself (lowercased), not a hash, so
+ * two names can never block each other.
+ *
+ * SINGLE WORLD:
+ *   g_account_registry stays NULL and every call is a no-op that
+ *   allows the login, exactly as before.
+ *
+ * PLATFORM:
+ *   POSIX only; on Windows account_registry_create() returns NULL.
+ *
+ ******************************************************************************/
+
+#ifndef ACCOUNT_REGISTRY_H
+#define ACCOUNT_REGISTRY_H
+
+#include "types.h"
+
+typedef struct AccountRegistry AccountRegistry;
+
+/* Shared registry (NULL when running a single world) */
+extern AccountRegistry* g_account_registry;
+
+/*
+ * account_registry_create - Map a registry for worlds × MAX_PLAYERS accounts
+ *
+ * @param worlds  World processes that will share it
+ * @return        Registry in shared memory, or NULL
+ *
+ * Must be called before the worlds are forked.
+ */
+AccountRegistry* account_registry_create(u32 worlds);
+
+void account_registry_destroy(AccountRegistry* registry);
+
+/*
+ * account_registry_claim - Take an account for a world at login
+ *
+ * @return  true if the account is free or already this world's
+ */
+bool account_registry_claim(AccountRegistry* registry, const char* username, u32 world);
+
+/*
+ * account_registry_release - Logged out; keep the claim until the save is written
+ */
+void account_registry_release(AccountRegistry* registry, const char* username, u32 world);
+
+/*
+ * account_registry_saved - A save reached disk (save writer thread)
+ *
+ * Frees the claim if it was released and this world owns it.
+ */
+void account_registry_saved(AccountRegistry* registry, const char* username, u32 world);
+
+/*
+ * account_registry_drop - Free a claim at once (login failed before entering)
+ */
+void account_registry_drop(AccountRegistry* registry, const char* username, u32 world);
+
+/*
+ * account_registry_transfer - Hand a held account to another world
+ *
+ * @return  true if from held it (and was not releasing); to now holds it
+ *
+ * A player crossing into a region another cluster node owns (cluster.h)
+ * keeps playing, so the claim moves without being freed: no login can
+ * slip in between.
+ */
+bool account_registry_transfer(AccountRegistry* registry, const char* username, u32 from, u32 to);
+
+/*
+ * account_registry_drop_world - Free every claim of a world that exited
+ *
+ * @return  Claims freed
+ */
+u32 account_registry_drop_world(AccountRegistry* registry, u32 world);
+
+#endif /* ACCOUNT_REGISTRY_H */
@@ -0,0 +1,276 @@
+/*******************************************************************************
+ * ACTIVATION.C - Mapsquare Activation Implementation
+ *******************************************************************************
+ *
+ * See activation.h for when squares activate and what deactivation keeps.
+ *
+ * Squares are found by key in a ProbeTable; the squares array only
+ * exists for the sweep, which visits every registered square. Both grow
+ * as spawns are registered at boot and stay fixed afterwards.
+ *
+ ******************************************************************************/
+
+#include "activation.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+ActivationMap* g_activation = NULL;
+
+static inline u16 square_key(u32 x, u32 z) {
+    return (u16)((x >> 6 & 0xFF) << 8 | (z >> 6 & 0xFF));
+}
+
+ActivationMap* activation_create(void) {
+    ActivationMap* map = (ActivationMap*)calloc(1, sizeof(ActivationMap));
+    if (!map) return NULL;
+
+    map->index = probetable_new(256);
+    if (!map->index) {
+        free(map);
+        return NULL;
+    }
+    return map;
+}
+
+void activation_destroy(ActivationMap* map) {
+    if (!map) return;
+    if (map->activations > 0) {
+        printf("Activation: %u squares, %llu activations, %llu deactivations\n",
+               map->square_count, (unsigned long long)map->activations,
+               (unsigned long long)map->deactivations);
+    }
+
+    for (u32 i = 0; i < map->square_count; i++) {
+        free(map->squares[i]->npcs);
+        free(map->squares[i]->locs);
+        free(map->squares[i]);
+    }
+    free(map->squares);
+    probetable_free(map->index);
+    free(map);
+}
+
+/*
+ * activation_square - The square holding (x, z), created if create is set
+ */
+static ActivationSquare* activation_square(ActivationMap* map, u32 x, u32 z, bool create) {
+    u16 key = square_key(x, z);
+    ActivationSquare* square = (ActivationSquare*)probetable_get(map->index, key);
+    if (square || !create) return square;
+
+    if (map->square_count == map->square_capacity) {
+        u32 capacity = map->square_capacity ? map->square_capacity * 2 : 64;
+        ActivationSquare** grown =
+            (ActivationSquare**)realloc(map->squares, capacity * sizeof(ActivationSquare*));
+        if (!grown) return NULL;
+        map->squares = grown;
+        map->square_capacity = capacity;
+    }
+
+    square = (ActivationSquare*)calloc(1, sizeof(ActivationSquare));
+    if (!square) return NULL;
+    square->square = key;
+    if (!probetable_put(map->index, key, square)) {
+        free(square);
+        return NULL;
+    }
+    map->squares[map->square_count++] = square;
+    return square;
+}
+
+/*
+ * grow - Make room for one more element of size bytes in *items
+ */
+static bool grow(void** items, u32 count, u32* capacity, size_t size) {
+    if (count < *capacity) return true;
+    u32 next = *capacity ? *capacity * 2 : 8;
+    void* grown = realloc(*items, next * size);
+    if (!grown) return false;
+    *items = grown;
+    *capacity = next;
+    return true;
+}
+
+/*
+ * spawn_npc - Materialize one registered NPC
+ */
+static void spawn_npc(ActivationNpc* entry) {
+    Npc* npc = npc_spawn(g_npcs, entry->npc_id, position_x(&entry->spawn),
+                         position_z(&entry->spawn), position_height(&entry->spawn));
+    entry->index = npc ? npc->index : ACTIVATION_NONE;
+}
+
+/*
+ * spawned_npc - The NPC still standing for entry, or NULL
+ *
+ * Something else may have despawned it and its slot been reused.
+ */
+static Npc* spawned_npc(const ActivationNpc* entry) {
+    if (entry->index == ACTIVATION_NONE) return NULL;
+    Npc* npc = npc_get_by_index(g_npcs, entry->index);
+    if (!npc || !npc->active || npc->npc_id != entry->npc_id ||
+        !position_equals(&npc->spawn_position, &entry->spawn)) {
+        return NULL;
+    }
+    return npc;
+}
+
+static void activate(ActivationMap* map, ActivationSquare* square, u64 tick) {
+    square->active = true;
+    square->last_seen = tick;
+    map->active_count++;
+    map->activations++;
+
+    for (u32 i = 0; i < square->npc_count; i++) {
+        spawn_npc(&square->npcs[i]);
+    }
+    for (u32 i = 0; i < square->loc_count; i++) {
+        ActivationLoc* loc = &square->locs[i];
+        if (loc->changed) continue;
+        loc->spawned = object_spawn(g_objects, loc->loc_id, position_x(&loc->position),
+                                    position_z(&loc->position), position_height(&loc->position),
+                                    loc->type, loc->rotation) != NULL;
+    }
+}
+
+static void deactivate(ActivationMap* map, ActivationSquare* square) {
+    square->active = false;
+    map->active_count--;
+    map->deactivations++;
+
+    for (u32 i = 0; i < square->npc_count; i++) {
+        Npc* npc = spawned_npc(&square->npcs[i]);
+        if (npc) npc_despawn(g_npcs, npc);
+        square->npcs[i].index = ACTIVATION_NONE;
+    }
+
+    /* A loc no longer as registered was changed in play: leave it be */
+    for (u32 i = 0; i < square->loc_count; i++) {
+        ActivationLoc* loc = &square->locs[i];
+        if (!loc->spawned) continue;
+        loc->spawned = false;
+
+        GameObject* object = object_get_at(g_objects, position_x(&loc->position),
+                                           position_z(&loc->position),
+                                           position_height(&loc->position), loc->type);
+        if (object && object->id == loc->loc_id && object->rotation == loc->rotation &&
+            !object->temporary) {
+            object_despawn(g_objects, object);
+        } else {
+            loc->changed = true;
+        }
+    }
+}
+
+bool activation_add_npc(ActivationMap* map, u16 npc_id, u32 x, u32 z, u32 level) {
+    if (!map) return npc_spawn(g_npcs, npc_id, x, z, level) != NULL;
+
+    ActivationSquare* square = activation_square(map, x, z, true);
+    if (!square || !grow((void**)&square->npcs, square->npc_count, &square->npc_capacity,
+                         sizeof(ActivationNpc))) {
+        return false;
+    }
+    ActivationNpc* entry = &square->npcs[square->npc_count++];
+    entry->npc_id = npc_id;
+    entry->index = ACTIVATION_NONE;
+    position_init(&entry->spawn, x, z, level);
+    if (square->active) spawn_npc(entry);
+    return true;
+}
+
+bool activation_add_loc(ActivationMap* map, u16 loc_id, u32 x, u32 z, u32 level,
+                        u8 type, u8 rotation) {
+    if (!map) return object_spawn(g_objects, loc_id, x, z, level, type, rotation) != NULL;
+
+    ActivationSquare* square = activation_square(map, x, z, true);
+    if (!square || !grow((void**)&square->locs, square->loc_count, &square->loc_capacity,
+                         sizeof(ActivationLoc))) {
+        return false;
+    }
+    ActivationLoc* loc = &square->locs[square->loc_count++];
+    memset(loc, 0, sizeof(ActivationLoc));
+    loc->loc_id = loc_id;
+    loc->type = type;
+    loc->rotation = rotation;
+    position_init(&loc->position, x, z, level);
+    if (square->active) {
+        loc->spawned = object_spawn(g_objects, loc_id, x, z, level, type, rotation) != NULL;
+    }
+    return true;
+}
+
+void activation_enter(ActivationMap* map, const Position* position, u64 tick) {
+    if (!map || !position) return;
+
+    /* Squares touched by the range box: one, two or four */
+    i32 x = (i32)position_x(position);
+    i32 z = (i32)position_z(position);
+    u32 min_x = (u32)(x > ACTIVATION_DISTANCE ? x - ACTIVATION_DISTANCE : 0) >> 6;
+    u32 min_z = (u32)(z > ACTIVATION_DISTANCE ? z - ACTIVATION_DISTANCE : 0) >> 6;
+    u32 max_x = (u32)(x + ACTIVATION_DISTANCE) >> 6;
+    u32 max_z = (u32)(z + ACTIVATION_DISTANCE) >> 6;
+
+    for (u32 sx = min_x; sx <= max_x; sx++) {
+        for (u32 sz = min_z; sz <= max_z; sz++) {
+            ActivationSquare* square = activation_square(map, sx << 6, sz << 6, false);
+            if (!square) continue;
+            if (square->active) {
+                square->last_seen = tick;
+            } else {
+                activate(map, square, tick);
+            }
+        }
+    }
+}
+
+/*
+ * square_in_use - A player in range of the square, or one of its NPCs awake?
+ *
+ * A wandering NPC can be seen from outside its square's range, and it
+ * stays awake while anyone is near it.
+ */
+static bool square_in_use(const ActivationSquare* square, const ZoneGrid* players) {
+    u16 found;
+    u32 centre_x = (u32)(square->square >> 8) * 64 + 32;
+    u32 centre_z = (u32)(square->square & 0xFF) * 64 + 32;
+    if (zone_grid_query(players, centre_x, centre_z, 32 + ACTIVATION_DISTANCE, &found, 1) > 0) {
+        return true;
+    }
+    for (u32 i = 0; i < square->npc_count; i++) {
+        const Npc* npc = spawned_npc(&square->npcs[i]);
+        if (npc && npc->awake) return true;
+    }
+    return false;
+}
+
+void activation_sweep(ActivationMap* map, const ZoneGrid* players, u64 tick) {
+    if (!map || !players || map->active_count == 0) return;
+    if (tick % ACTIVATION_SWEEP_TICKS != 0) return;
+
+    for (u32 i = 0; i < map->square_count; i++) {
+        ActivationSquare* square = map->squares[i];
+        if (!square->active) continue;
+        if (square_in_use(square, players)) {
+            square->last_seen = tick;
+        } else if (tick - square->last_seen >= ACTIVATION_IDLE_TICKS) {
+            deactivate(map, square);
+        }
+    }
+}
+
+Npc* activation_npc_for(ActivationMap* map, u16 npc_id, const Position* spawn) {
+    if (!map || !spawn) return NULL;
+
+    ActivationSquare* square = activation_square(map, position_x(spawn), position_z(spawn), false);
+    if (!square) return NULL;
+    if (!square->active) activate(map, square, 0);
+
+    for (u32 i = 0; i < square->npc_count; i++) {
+        const ActivationNpc* entry = &square->npcs[i];
+        if (entry->npc_id == npc_id && position_equals(&entry->spawn, spawn)) {
+            return spawned_npc(entry);
+        }
+    }
+    return NULL;
+}
@@ -0,0 +1,221 @@
+/*******************************************************************************
+ * ACTIVATION.H - Mapsquares Come Alive When Players Come Near
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Lazy instantiation: create entities where they are needed, when
+ *     they are needed
+ *   - A working set that follows the users (players) around the world
+ *   - Hysteresis: activate on approach, deactivate only after a quiet spell
+ *   - Separating static content (re-creatable) from dynamic changes
+ *
+ * THE PROBLEM:
+ *
+ * The world's spawn lists name every NPC and static loc in every
+ * mapsquare. Spawning them all at boot fills the NPC array with goblins
+ * in regions nobody has visited since the last restart:
+ *
+ *   boot ──→ 5000 NPCs spawned ──→ 5000 slots, zone entries, timers
+ *                                    │
+ *                                    └── 40 players online, all within
+ *                                        a dozen mapsquares
+ *
+ * Sleeping NPCs (npc.h) cost nothing per tick, but they still hold their
+ * slots, their zone grid entries and their respawn timers, and the NPC
+ * count the server can hold is spent on places without players.
+ *
+ * THE SOLUTION - REGISTER AT BOOT, MATERIALIZE ON APPROACH:
+ *
+ *   activation_add_npc() / activation_add_loc() only file the spawn
+ *   under its mapsquare (64x64 tiles). Entities appear when a player
+ *   first comes within ACTIVATION_DISTANCE of the square:
+ *
+ *     ┌────────┬────────┬────────┐   P = player; squares whose edge is
+ *     │        │        │        │   within ACTIVATION_DISTANCE tiles
+ *     │        │   A    │        │   of P are active (A): at most 4
+ *     ├────────┼────────┼────────┤
+ *     │        │   A  P │   A    │   a square with nothing registered
+ *     │        │        │        │   has no entry and costs nothing
+ *     ├────────┼────────┼────────┤
+ *     │        │        │        │
+ *     └────────┴────────┴────────┘
+ *
+ *   Entering a square costs its registered spawns (npc_spawn and
+ *   object_spawn each); checking is done when a player changes zone,
+ *   the same moment NPCs are woken (world.c).
+ *
+ * DEACTIVATION - AFTER A QUIET SPELL:
+ *   Every ACTIVATION_SWEEP_TICKS the active squares are checked against
+ *   the player zone grid. A square with no player within range, and no
+ *   NPC of its own awake, for ACTIVATION_IDLE_TICKS is put back:
+ *
+ *     its spawned NPCs ──────────────→ despawned (re-created fresh, full
+ *                                      health, at spawn, next time)
+ *     its static locs, unchanged ────→ despawned (re-created next time)
+ *     its static locs, changed ──────→ kept, and never re-created: the
+ *                                      change (a loc removed, another
+ *                                      in its place) outlives the square
+ *     ground items, temporary objects → untouched (their own timers)
+ *
+ *   The idle delay keeps a player walking along a square's edge from
+ *   spawning and despawning its NPCs every few steps.
+ *
+ * CHECKPOINTS:
+ *   checkpoint.h restores NPCs onto their spawns through
+ *   activation_npc_for(), which activates the spawn's square first, so a
+ *   restored NPC is where it was even though no player is online yet.
+ *
+ * THREAD SAFETY:
+ *   Game thread only.
+ *
+ ******************************************************************************/
+
+#ifndef ACTIVATION_H
+#define ACTIVATION_H
+
+#include "types.h"
+#include "position.h"
+#include "npc.h"
+#include "object.h"
+#include "zone_grid.h"
+#include "datastruct/probetable.h"
+#include <stdbool.h>
+
+/* A square activates when a player is this close to its edge (tiles):
+ * past NPC_WAKE_DISTANCE, so NPCs exist before they are woken */
+#define ACTIVATION_DISTANCE 32
+
+/* Ticks between deactivation sweeps (30 seconds) */
+#define ACTIVATION_SWEEP_TICKS 50
+
+/* Ticks a square stays active with nobody near (2 minutes) */
+#define ACTIVATION_IDLE_TICKS 200
+
+/* ActivationNpc.index while the spawn is not materialized */
+#define ACTIVATION_NONE 0xFFFF
+
+/*
+ * ActivationNpc - A registered NPC spawn
+ */
+typedef struct {
+    u16 npc_id;
+    u16 index;                  /* Spawned NPC, or ACTIVATION_NONE */
+    Position spawn;
+} ActivationNpc;
+
+/*
+ * ActivationLoc - A registered static loc
+ */
+typedef struct {
+    u16 loc_id;
+    u8 type;
+    u8 rotation;
+    Position position;
+    bool spawned;               /* In g_objects as registered */
+    bool changed;               /* Replaced or removed in play: never re-created */
+} ActivationLoc;
+
+/*
+ * ActivationSquare - Everything registered in one mapsquare
+ */
+typedef struct {
+    u16 square;                 /* mapsquare_x << 8 | mapsquare_z */
+    bool active;
+    u64 last_seen;              /* Tick a player was last in range */
+
+    ActivationNpc* npcs;
+    u32 npc_count;
+    u32 npc_capacity;
+
+    ActivationLoc* locs;
+    u32 loc_count;
+    u32 loc_capacity;
+} ActivationSquare;
+
+/*
+ * ActivationMap - Registered squares
+ */
+typedef struct {
+    ProbeTable* index;          /* square → ActivationSquare* */
+    ActivationSquare** squares; /* Every registered square, for sweeps */
+    u32 square_count;
+    u32 square_capacity;
+
+    u32 active_count;
+    u64 activations;
+    u64 deactivations;
+} ActivationMap;
+
+/*
+ * g_activation - The world's spawn registry, or NULL (spawns are made at
+ * once by the activation_add_* calls)
+ */
+extern ActivationMap* g_activation;
+
+/*
+ * activation_create - Empty registry
+ *
+ * @return  Map, or NULL on allocation failure
+ */
+ActivationMap* activation_create(void);
+
+/*
+ * activation_destroy - Free the registry (NULL-safe)
+ *
+ * Materialized NPCs and locs stay in their systems.
+ */
+void activation_destroy(ActivationMap* map);
+
+/*
+ * activation_add_npc - Register an NPC spawn under its mapsquare
+ *
+ * @param map  Registry; NULL spawns the NPC into g_npcs now
+ * @return     false if out of memory (or the immediate spawn failed)
+ */
+bool activation_add_npc(ActivationMap* map, u16 npc_id, u32 x, u32 z, u32 level);
+
+/*
+ * activation_add_loc - Register a static loc under its mapsquare
+ *
+ * @param map  Registry; NULL spawns the loc into g_objects now
+ * @return     false if out of memory (or the immediate spawn failed)
+ */
+bool activation_add_loc(ActivationMap* map, u16 loc_id, u32 x, u32 z, u32 level,
+                        u8 type, u8 rotation);
+
+/*
+ * activation_enter - A player is at position: activate the squares in range
+ *
+ * @param map       Registry (NULL: no-op)
+ * @param position  Player's position
+ * @param tick      Current tick (refreshes last_seen)
+ *
+ * COMPLEXITY: O(1) lookups (at most 4 squares), plus the spawns of any
+ *             square activated
+ */
+void activation_enter(ActivationMap* map, const Position* position, u64 tick);
+
+/*
+ * activation_sweep - Deactivate squares empty for ACTIVATION_IDLE_TICKS
+ *
+ * @param map      Registry (NULL: no-op)
+ * @param players  Player zone grid
+ * @param tick     Current tick; runs every ACTIVATION_SWEEP_TICKS
+ *
+ * COMPLEXITY: O(registered squares) on sweep ticks, O(1) otherwise
+ */
+void activation_sweep(ActivationMap* map, const ZoneGrid* players, u64 tick);
+
+/*
+ * activation_npc_for - The NPC materialized from a registered spawn
+ *
+ * @param map     Registry (NULL: returns NULL)
+ * @param npc_id  NPC type
+ * @param spawn   Spawn tile
+ * @return        The NPC (its square activated if it was not), or NULL
+ *                if no such spawn is registered
+ */
+Npc* activation_npc_for(ActivationMap* map, u16 npc_id, const Position* spawn);
+
+#endif /* ACTIVATION_H */
@@ -0,0 +1,216 @@
+/*******************************************************************************
+ * AGGRESSION.C - NPC Target Acquisition Driven by Player-Occupied Zones
+ *******************************************************************************
+ *
+ * See aggression.h for the design.
+ *
+ * ZONE TABLE:
+ *   Open addressing with linear probing. A slot belongs to this tick only
+ *   if its stamp is the current tick, so the table is never cleared: an
+ *   old slot reads as empty. marked[] lists this tick's slots so step 2
+ *   visits each zone once without scanning the table.
+ *
+ ******************************************************************************/
+
+#include "aggression.h"
+#include "combat.h"
+#include "player.h"
+#include "player_save.h"    /* SKILL_HITPOINTS */
+#include "constants.h"       /* MAX_NPCS */
+#include "mem_stats.h"
+#include <stdlib.h>
+#include <string.h>
+
+AggressionSystem* g_aggression = NULL;
+
+#define AGGRESSION_ZONE_KEY(level, zone_x, zone_z) \
+    (((u32)(level) << 28) | ((u32)(zone_x) << 14) | (u32)(zone_z))
+
+AggressionSystem* aggression_system_create(void) {
+    AggressionSystem* sys = mem_calloc(MEM_NPC, 1, sizeof(AggressionSystem));
+    if (!sys) return NULL;
+
+    sys->zones = mem_calloc(MEM_NPC, AGGRESSION_ZONE_SLOTS, sizeof(AggressionZone));
+    sys->marked = mem_alloc(MEM_NPC, AGGRESSION_ZONE_SLOTS * sizeof(u32));
+    sys->player_coord = mem_calloc(MEM_NPC, MAX_PLAYERS, sizeof(u32));
+    sys->player_seen = mem_calloc(MEM_NPC, MAX_PLAYERS, sizeof(u32));
+    sys->checked_tick = mem_calloc(MEM_NPC, MAX_NPCS, sizeof(u32));
+    sys->checked_coord = mem_calloc(MEM_NPC, MAX_NPCS, sizeof(u32));
+    sys->pids = mem_alloc(MEM_NPC, MAX_PLAYERS * sizeof(u16));
+    sys->coords = mem_alloc(MEM_NPC, POSITION_VIEW_ROUND(MAX_PLAYERS) * sizeof(u32));
+    if (!sys->zones || !sys->marked || !sys->player_coord || !sys->player_seen ||
+        !sys->checked_tick || !sys->checked_coord || !sys->pids || !sys->coords) {
+        aggression_system_destroy(sys);
+        return NULL;
+    }
+
+    /* Stamps and "seen" ticks start at 0: the first tick is 2, so nothing
+     * looks marked this tick or seen last tick */
+    sys->tick = 1;
+    return sys;
+}
+
+void aggression_system_destroy(AggressionSystem* sys) {
+    if (!sys) return;
+    mem_free(sys->zones);
+    mem_free(sys->marked);
+    mem_free(sys->player_coord);
+    mem_free(sys->player_seen);
+    mem_free(sys->checked_tick);
+    mem_free(sys->checked_coord);
+    mem_free(sys->pids);
+    mem_free(sys->coords);
+    mem_free(sys);
+}
+
+/*
+ * aggression_mark - Mark a zone for this tick (dirty if a player moved)
+ */
+static void aggression_mark(AggressionSystem* sys, u32 key, bool dirty) {
+    u32 mask = AGGRESSION_ZONE_SLOTS - 1;
+    u32 slot = ((key * 2654435761u) >> 17) & mask;
+    for (;;) {
+        AggressionZone* zone = &sys->zones[slot];
+        if (zone->stamp != sys->tick) {
+            /* Full only if every player marked 9 distinct zones past
+             * AGGRESSION_ZONE_SLOTS; then the zone is just not hunted */
+            if (sys->marked_count == AGGRESSION_ZONE_SLOTS - 1) return;
+            zone->key = key;
+            zone->stamp = sys->tick;
+            zone->dirty = dirty;
+            sys->marked[sys->marked_count++] = slot;
+            return;
+        }
+        if (zone->key == key) {
+            zone->dirty |= dirty;
+            return;
+        }
+        slot = (slot + 1) & mask;
+    }
+}
+
+/*
+ * aggression_mark_players - Step 1: zones any player could be hunted from
+ */
+static void aggression_mark_players(AggressionSystem* sys, PlayerList* list) {
+    for (u32 i = 0; i < list->count; i++) {
+        const Player* player = list->active[i];
+        u32 pid = player->index;
+
+        u32 coord = player->levels[SKILL_HITPOINTS] > 0
+                  ? position_view_coord(&player->position) : POSITION_VIEW_HIDDEN;
+        bool moved = coord != sys->player_coord[pid] || sys->player_seen[pid] != sys->tick - 1;
+        sys->player_coord[pid] = coord;
+        sys->player_seen[pid] = sys->tick;
+        if (coord == POSITION_VIEW_HIDDEN) continue;
+
+        u32 x = position_x(&player->position), z = position_z(&player->position);
+        u32 min_x = (x > AGGRESSION_RANGE ? x - AGGRESSION_RANGE : 0) >> 3;
+        u32 min_z = (z > AGGRESSION_RANGE ? z - AGGRESSION_RANGE : 0) >> 3;
+        u32 max_x = (x + AGGRESSION_RANGE) >> 3;
+        u32 max_z = (z + AGGRESSION_RANGE) >> 3;
+        for (u32 zx = min_x; zx <= max_x; zx++) {
+            for (u32 zz = min_z; zz <= max_z; zz++) {
+                aggression_mark(sys, AGGRESSION_ZONE_KEY(position_height(&player->position), zx, zz), moved);
+            }
+        }
+    }
+}
+
+/*
+ * aggression_gather - Players that could be in range of any tile of a zone
+ *
+ * @return  Number gathered into sys->pids / sys->coords
+ */
+static u32 aggression_gather(AggressionSystem* sys, const ZoneGrid* players,
+                             u32 zone_x, u32 zone_z) {
+    u32 count = zone_grid_query(players, zone_x * 8 + 4, zone_z * 8 + 4,
+                                AGGRESSION_RANGE + 4, sys->pids, MAX_PLAYERS);
+    for (u32 i = 0; i < count; i++) {
+        u16 pid = sys->pids[i];
+        sys->coords[i] = sys->player_seen[pid] == sys->tick
+                       ? sys->player_coord[pid] : POSITION_VIEW_HIDDEN;
+    }
+    return count;
+}
+
+/*
+ * aggression_pick - A random candidate whose bit is set in mask
+ */
+static u16 aggression_pick(const AggressionSystem* sys, const u64* mask, u32 found) {
+    u32 skip = (u32)rand() % found;
+    for (u32 w = 0;; w++) {
+        for (u64 bits = mask[w]; bits; bits &= bits - 1) {
+            if (skip-- == 0) return sys->pids[w * POSITION_VIEW_LANES + (u32)__builtin_ctzll(bits)];
+        }
+    }
+}
+
+/*
+ * aggression_hunt_zone - Step 2 and 3 for one marked zone
+ */
+static void aggression_hunt_zone(AggressionSystem* sys, NpcSystem* npcs,
+                                 const ZoneGrid* players, const AggressionZone* zone) {
+    u32 level = zone->key >> 28;
+    u32 zone_x = (zone->key >> 14) & 0x3fff;
+    u32 zone_z = zone->key & 0x3fff;
+
+    u16 filed[MAX_NPCS];
+    u32 npc_count = zone_grid_query(npcs->zones, zone_x * 8, zone_z * 8, 0, filed, MAX_NPCS);
+
+    u32 candidates = 0;
+    bool gathered = false;
+    u64 mask[POSITION_VIEW_ROUND(MAX_PLAYERS) / POSITION_VIEW_LANES];
+    for (u32 i = 0; i < npc_count; i++) {
+        Npc* npc = &npcs->npcs[filed[i]];
+        if (!npc->active || npc->hitpoints == 0 || npc->in_combat ||
+            position_height(&npc->position) != level) {
+            continue;
+        }
+        const NpcDefinition* def = npc_get_definition(npcs, npc->npc_id);
+        if (!def || !def->aggressive) continue;
+
+        /* Found no one last tick from this tile, and nobody moved near */
+        u32 coord = position_view_coord(&npc->position);
+        if (!zone->dirty && sys->checked_tick[npc->index] == sys->tick - 1 &&
+            sys->checked_coord[npc->index] == coord) {
+            sys->checked_tick[npc->index] = sys->tick;
+            sys->cached++;
+            continue;
+        }
+
+        if (!gathered) {
+            candidates = aggression_gather(sys, players, zone_x, zone_z);
+            gathered = true;
+        }
+        sys->hunted++;
+        u32 found = candidates ? position_view_mask(&npc->position, sys->coords, candidates,
+                                                    AGGRESSION_RANGE, mask) : 0;
+        if (found == 0) {
+            sys->checked_tick[npc->index] = sys->tick;
+            sys->checked_coord[npc->index] = coord;
+            continue;
+        }
+
+        u16 pid = aggression_pick(sys, mask, found);
+        if (combat_attack(g_combat, COMBAT_NPC(npc->index), COMBAT_PLAYER(pid))) {
+            sys->attacks++;
+        }
+    }
+}
+
+void aggression_process(AggressionSystem* sys, NpcSystem* npcs, PlayerList* list,
+                        const ZoneGrid* players) {
+    if (!sys || !npcs || !list || !players || !g_combat) return;
+
+    sys->tick++;
+    sys->marked_count = 0;
+    sys->hunted = 0;
+    sys->cached = 0;
+    sys->attacks = 0;
+
+    aggression_mark_players(sys, list);
+    for (u32 i = 0; i < sys->marked_count; i++) {
+        aggression_hunt_zone(sys, npcs, players, &sys->zones[sys->marked[i]]);
+    }
+}
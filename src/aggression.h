@@ -0,0 +1,148 @@
+/*******************************************************************************
+ * AGGRESSION.H - NPC Target Acquisition Driven by Player-Occupied Zones
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Inverting a search: start from the few players, not the many NPCs
+ *   - Deduplicating work per tick with a stamped hash table (no clearing)
+ *   - Batched range tests (position_view_mask) over a shared candidate list
+ *   - Result caching keyed on "nothing nearby changed"
+ *
+ * THE PROBLEM:
+ *
+ * An aggressive NPC attacks a player who comes within its hunt range.
+ * Asking every NPC every tick is what npc_process()'s old TODO suggested:
+ *
+ *   for each aggressive NPC (thousands):
+ *       for each player near it:  in range? attack
+ *
+ * Most NPCs stand in areas nobody is in, so almost every question has
+ * the same answer as last tick ("no one"), and the cost grows with the
+ * number of NPCs spawned rather than with where the players are.
+ *
+ * THE SOLUTION - FROM PLAYERS TO ZONES TO NPCS:
+ *
+ *   1. players    every logged-in player marks the 8x8 zones an NPC
+ *                 could hunt it from (its tile +- AGGRESSION_RANGE), as
+ *                 "dirty" if the player moved or just arrived
+ *
+ *                   ┌─────┬─────┬─────┐
+ *                   │     │ d   │     │   P moved: the zones its hunt
+ *                   ├─────┼─────┼─────┤   square touches are dirty (d)
+ *                   │     │ d P │ d   │
+ *                   └─────┴─────┴─────┘
+ *
+ *   2. zones      each marked zone (once, however many players marked it)
+ *                 lists its NPCs from the NPC zone grid; only aggressive,
+ *                 idle, living NPCs on the zone's level go on
+ *
+ *   3. NPCs       the players around the zone are gathered once; each NPC
+ *                 runs position_view_mask() over them (64 per word, no
+ *                 branch per player) and attacks a random one in range
+ *
+ * Zones nobody is near are never visited, so an NPC in an empty area
+ * costs nothing at all.
+ *
+ * CACHING:
+ *
+ * An NPC that found no one last tick, stands on the same tile and lives
+ * in a zone no player moved near this tick would find no one again: it
+ * is skipped without a kernel run. Players leaving cannot create a
+ * target, so only arrivals and moves mark zones dirty. A player whose
+ * state changes without moving (logs in on the spot, comes back to life)
+ * counts as an arrival.
+ *
+ * RULES (adapted to the 225 data):
+ *   - Hunt range is AGGRESSION_RANGE tiles on each axis for every NPC;
+ *     the cache's NPC configs carry no hunt range
+ *   - No combat level check yet: PLAYER_INFO still sends every player as
+ *     level 3, so "too strong to attack" would never apply
+ *   - Same level (height), target logged in with hitpoints left
+ *
+ * COMPLEXITY (per tick):
+ *   - players:   O(players), a few zone marks each
+ *   - zones:     O(marked zones + NPCs filed in them)
+ *   - kernel:    O(players near the zone / 64) words per uncached NPC
+ *   - memory:    ~64 KB stamped zone table, 8 bytes per player and NPC
+ *
+ * THREADS:
+ *   Game thread only (world_process(), after NPC movement).
+ *
+ ******************************************************************************/
+
+#ifndef AGGRESSION_H
+#define AGGRESSION_H
+
+#include "types.h"
+#include "npc.h"
+#include "player_list.h"
+#include "zone_grid.h"
+#include "position.h"
+
+/* Hunt range of an aggressive NPC, tiles on each axis */
+#define AGGRESSION_RANGE 5
+
+/* Zone table slots (power of two): every player marks at most 3x3
+ * zones, so MAX_PLAYERS players fill it a little over half */
+#define AGGRESSION_ZONE_SLOTS 32768
+
+/*
+ * AggressionZone - One zone marked this tick (stamp == current tick)
+ */
+typedef struct {
+    u32 key;                    /* level << 28 | zone_x << 14 | zone_z */
+    u32 stamp;                  /* Tick it was last marked */
+    bool dirty;                 /* A player near it moved or arrived */
+} AggressionZone;
+
+/*
+ * AggressionSystem - Zone table, per-tick lists and the per-NPC cache
+ */
+typedef struct {
+    u32 tick;
+
+    AggressionZone* zones;      /* AGGRESSION_ZONE_SLOTS, open addressing */
+    u32* marked;                /* Slots marked this tick, in mark order */
+    u32 marked_count;
+
+    /* Per player PID: packed position this tick (POSITION_VIEW_HIDDEN if
+     * it cannot be attacked) and the last tick it was seen */
+    u32* player_coord;
+    u32* player_seen;
+
+    /* Per NPC index: the tick and tile of its last empty hunt */
+    u32* checked_tick;
+    u32* checked_coord;
+
+    /* Scratch for one zone's surrounding players */
+    u16* pids;
+    u32* coords;                /* POSITION_VIEW_ROUND(MAX_PLAYERS) */
+
+    /* Last tick's work, for tuning */
+    u32 hunted;                 /* NPCs that ran the kernel */
+    u32 cached;                 /* NPCs skipped by the cache */
+    u32 attacks;                /* Fights started */
+} AggressionSystem;
+
+extern AggressionSystem* g_aggression;
+
+AggressionSystem* aggression_system_create(void);
+void aggression_system_destroy(AggressionSystem* sys);
+
+/*
+ * aggression_process - Let idle aggressive NPCs near players pick a target
+ *
+ * @param sys      Aggression state
+ * @param npcs     NPC system (its zone grid lists the NPCs per zone)
+ * @param list     Logged-in players
+ * @param players  World zone grid of the same players
+ *
+ * Call once per tick after NPC movement and before npc_update_prepare(),
+ * so an NPC that turns to its target does so in this tick's NPC_INFO.
+ * Fights start through combat_attack() on g_combat.
+ */
+void aggression_process(AggressionSystem* sys, NpcSystem* npcs, PlayerList* list,
+                        const ZoneGrid* players);
+
+#endif /* AGGRESSION_H */
@@ -8,84 +8,163 @@
 #include <3ds.h>
 #endif
 
+// heap block handed out past the end of an arena
+typedef union Overflow {
+    union Overflow *next;
+    int64_t align;
+    void *align_ptr;
+    double align_double;
+} Overflow;
+
 typedef struct {
     int8_t *data;
     int capacity;
     int used;
+    int peak;
+    Overflow *overflow;
+    int overflow_bytes;
+    int reported_peak;
 } BumpAllocator;
 
-static BumpAllocator alloc = {0};
-
-static void *bump_alloc(int size);
-
-int bump_allocator_used(void) {
-    return alloc.used;
-}
-
-int bump_allocator_capacity(void) {
-    return alloc.capacity;
-}
+static BumpAllocator arenas[ARENA_COUNT] = {0};
+static const char *ARENA_NAMES[ARENA_COUNT] = {"scene", "frame"};
 
-bool bump_allocator_init(int capacity) {
+bool arena_init(Arena arena, int capacity) {
+    BumpAllocator *alloc = &arenas[arena];
 #ifdef __3DS__
     // this large malloc fails on 3ds, so we use linearAlloc
     rs2_log("Free linear space: %d\n", linearSpaceFree());
-    alloc.data = linearAlloc(capacity * sizeof(int8_t));
+    alloc->data = linearAlloc(capacity * sizeof(int8_t));
     rs2_log("Free linear space: %d\n", linearSpaceFree());
-    if (alloc.data) {
-        memset(alloc.data, 0, capacity);
+    if (alloc->data) {
+        memset(alloc->data, 0, capacity);
     }
 #else
-    alloc.data = calloc(capacity, sizeof(int8_t));
+    alloc->data = calloc(capacity, sizeof(int8_t));
 #endif
-    if (!alloc.data) {
+    if (!alloc->data) {
         rs2_error("Failed to init allocator with size of: %d", capacity);
         return false;
     }
-    alloc.capacity = capacity;
-    alloc.used = 0;
+    alloc->capacity = capacity;
+    alloc->used = 0;
+    alloc->peak = 0;
+    alloc->reported_peak = 0;
     return true;
 }
 
-void bump_allocator_free(void) {
+static void arena_free_overflow(BumpAllocator *alloc) {
+    while (alloc->overflow) {
+        Overflow *next = alloc->overflow->next;
+        free(alloc->overflow);
+        alloc->overflow = next;
+    }
+    alloc->overflow_bytes = 0;
+}
+
+void arena_free(Arena arena) {
+    BumpAllocator *alloc = &arenas[arena];
+    arena_free_overflow(alloc);
 #ifdef __3DS__
-    linearFree(alloc.data);
+    linearFree(alloc->data);
+#else
+    free(alloc->data);
+#endif
+    alloc->data = NULL;
+    alloc->capacity = alloc->used = 0;
+}
+
+void arena_reset(Arena arena) {
+    BumpAllocator *alloc = &arenas[arena];
+    // the frame arena resets every frame: log an overflow only at a new peak
+    if (alloc->overflow_bytes > 0 && alloc->peak > alloc->reported_peak) {
+        alloc->reported_peak = alloc->peak;
+        rs2_log("Arena %s: %d bytes overflowed to the heap, peak %d of %d\n", ARENA_NAMES[arena], alloc->overflow_bytes, alloc->peak, alloc->capacity);
+    }
+    arena_free_overflow(alloc);
+    // bytes past used are still zero from the last reset
+    if (alloc->data) {
+        memset(alloc->data, 0, alloc->used);
+    }
+    alloc->used = 0;
+}
+
+void *arena_alloc(Arena arena, int size) {
+    BumpAllocator *alloc = &arenas[arena];
+    // use 4 byte alignment to save couple dozen KBs memory, confirm it works everywhere
+#if __SIZEOF_POINTER__ == 4
+    int aligned_ptr = alloc->used + 3 & ~3;
 #else
-    free(alloc.data);
+    int aligned_ptr = alloc->used + 7 & ~7;
 #endif
+    if (aligned_ptr + size <= alloc->capacity) {
+        void *next = alloc->data + aligned_ptr;
+        alloc->used = aligned_ptr + size;
+        if (alloc->used + alloc->overflow_bytes > alloc->peak) {
+            alloc->peak = alloc->used + alloc->overflow_bytes;
+        }
+        return next;
+    }
+
+    Overflow *block = calloc(1, sizeof(Overflow) + size);
+    if (!block) {
+        rs2_error("Arena %s full and out of heap: attempted %d bytes, capacity %d", ARENA_NAMES[arena], size, alloc->capacity);
+        return NULL;
+    }
+    block->next = alloc->overflow;
+    alloc->overflow = block;
+    alloc->overflow_bytes += size;
+    if (alloc->used + alloc->overflow_bytes > alloc->peak) {
+        alloc->peak = alloc->used + alloc->overflow_bytes;
+    }
+    return block + 1;
+}
+
+int arena_used(Arena arena) {
+    return arenas[arena].used + arenas[arena].overflow_bytes;
+}
+
+int arena_capacity(Arena arena) {
+    return arenas[arena].capacity;
+}
+
+int arena_peak(Arena arena) {
+    return arenas[arena].peak;
+}
+
+int arena_overflow(Arena arena) {
+    return arenas[arena].overflow_bytes;
+}
+
+int bump_allocator_used(void) {
+    return arena_used(ARENA_SCENE);
+}
+
+int bump_allocator_capacity(void) {
+    return arena_capacity(ARENA_SCENE);
+}
+
+bool bump_allocator_init(int capacity) {
+    return arena_init(ARENA_SCENE, capacity);
+}
+
+void bump_allocator_free(void) {
+    arena_free(ARENA_SCENE);
 }
 
 void bump_allocator_reset(void) {
     // rs2_log("Allocator reset: clearing caches (size %d)", alloc.used);
-    memset(alloc.data, 0, alloc.capacity);
-    alloc.used = 0;
+    arena_reset(ARENA_SCENE);
 }
 
 // returning malloc/calloc here effectively disables the allocator
 void *rs2_malloc(bool use_allocator, int size) {
     // return malloc(size);
-    return use_allocator ? bump_alloc(size) : malloc(size);
+    return use_allocator ? arena_alloc(ARENA_SCENE, size) : malloc(size);
 }
 
 void *rs2_calloc(bool use_allocator, int count, int size) {
     // return calloc(count, size);
     // allocator_reset already memsets, just move ptr
-    return use_allocator ? bump_alloc(count * size) : calloc(count, size);
-}
-
-static void *bump_alloc(int size) {
-    // use 4 byte alignment to save couple dozen KBs memory, confirm it works everywhere
-#if __SIZEOF_POINTER__ == 4
-    int aligned_ptr = alloc.used + 3 & ~3;
-#else
-    int aligned_ptr = alloc.used + 7 & ~7;
-#endif
-    if (aligned_ptr + size > alloc.capacity) {
-        rs2_error("Allocator full: this should never happen! attempted: %d, capacity: %d", alloc.used + size, alloc.capacity);
-        exit(1);
-    }
-
-    void *next = alloc.data + aligned_ptr;
-    alloc.used = aligned_ptr + size;
-    return next;
+    return use_allocator ? arena_alloc(ARENA_SCENE, count * size) : calloc(count, size);
 }
@@ -1,6 +1,40 @@
+#pragma once
+
 #include <stdbool.h>
 #include <stdint.h>
 
+// Bump arenas: allocation moves a pointer, and a reset drops everything at
+// once. Nothing in an arena is freed on its own.
+//
+//   ARENA_SCENE  cached models and scene locs (rs2_malloc with
+//                use_allocator); reset when the scene is rebuilt
+//   ARENA_FRAME  temporary locs of the entities drawn this frame; reset
+//                once the frame is drawn (world3d_clear_temporarylocs)
+//
+// Everything else lives on the heap for as long as it is needed.
+//
+// An arena that runs out hands out heap blocks instead (it used to exit),
+// and frees them at its next reset. A reset after an overflow logs the
+// peak - each time it is a new peak - so the arena can be sized up.
+typedef enum {
+    ARENA_SCENE,
+    ARENA_FRAME,
+    ARENA_COUNT
+} Arena;
+
+bool arena_init(Arena arena, int capacity);
+void arena_free(Arena arena);
+void arena_reset(Arena arena);
+// zeroed, or NULL if the heap is exhausted too
+void *arena_alloc(Arena arena, int size);
+int arena_used(Arena arena);
+int arena_capacity(Arena arena);
+// most used (overflow included) since the arena was initialized
+int arena_peak(Arena arena);
+// bytes taken from the heap since the last reset
+int arena_overflow(Arena arena);
+
+// ARENA_SCENE
 int bump_allocator_used(void);
 int bump_allocator_capacity(void);
 bool bump_allocator_init(int capacity);
@@ -0,0 +1,195 @@
+/*******************************************************************************
+ * ARCHIVE_CACHE.C - Unpacked Client Archives Kept Between Launches
+ *******************************************************************************
+ *
+ * See archive_cache.h for the entry format and when an entry is used.
+ *
+ * An entry is built or read whole into one buffer; its payload is moved
+ * to the front of that buffer and handed to jagfile_new_unpacked(),
+ * which owns it from then on (jagfile_free() frees it).
+ *
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "archive_cache.h"
+#include "packet.h"
+
+#ifdef __EMSCRIPTEN__
+#include <emscripten.h>
+#endif
+
+#if defined(_arch_dreamcast) || defined(NXDK) || defined(ANDROID) || (defined(__wasm) && !defined(__EMSCRIPTEN__))
+#define ARCHIVE_CACHE_NONE
+#endif
+
+#define ARCHIVE_CACHE_MAGIC 0x4a414755 /* "JAGU" */
+#define ARCHIVE_CACHE_HEADER 16
+
+#ifndef ARCHIVE_CACHE_NONE
+static void put4(int8_t *dst, int value) {
+    dst[0] = (int8_t)(value >> 24);
+    dst[1] = (int8_t)(value >> 16);
+    dst[2] = (int8_t)(value >> 8);
+    dst[3] = (int8_t)value;
+}
+
+static int get4(const int8_t *src) {
+    return (int)(((uint32_t)(uint8_t)src[0] << 24) | ((uint32_t)(uint8_t)src[1] << 16) |
+                 ((uint32_t)(uint8_t)src[2] << 8) | (uint32_t)(uint8_t)src[3]);
+}
+
+/*
+ * STORES - Whole entries by archive name
+ */
+#if defined(__EMSCRIPTEN__)
+static int8_t *store_get(const char *name, int *size) {
+    void *buffer = NULL;
+    int error = 0;
+    emscripten_idb_load("rs225", name, &buffer, size, &error);
+    return error ? NULL : buffer;
+}
+
+static void store_put(const char *name, int8_t *entry, int size) {
+    int error = 0;
+    emscripten_idb_store("rs225", name, entry, size, &error);
+}
+#else
+static void store_path(char *path, size_t size, const char *name) {
+    snprintf(path, size, "rom/cache/client/%s.unpacked", name);
+}
+
+static int8_t *store_get(const char *name, int *size) {
+    char path[512];
+    store_path(path, sizeof(path), name);
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return NULL;
+    }
+
+    int8_t header[ARCHIVE_CACHE_HEADER];
+    int8_t *entry = NULL;
+    if (fread(header, 1, sizeof(header), file) == sizeof(header)) {
+        int length = get4(header + 8);
+        if (length > 0 && length < (1 << 30)) {
+            entry = malloc(ARCHIVE_CACHE_HEADER + length);
+        }
+        if (entry && fread(entry + ARCHIVE_CACHE_HEADER, 1, length, file) == (size_t)length) {
+            memcpy(entry, header, sizeof(header));
+            *size = ARCHIVE_CACHE_HEADER + length;
+        } else {
+            free(entry);
+            entry = NULL;
+        }
+    }
+    fclose(file);
+    return entry;
+}
+
+static void store_put(const char *name, int8_t *entry, int size) {
+    char path[512];
+    char temp[520];
+    store_path(path, sizeof(path), name);
+    snprintf(temp, sizeof(temp), "%s.tmp", path);
+
+    /* Written aside, then renamed: a crash leaves the old entry or none */
+    FILE *file = fopen(temp, "wb");
+    if (!file) {
+        return;
+    }
+    bool written = fwrite(entry, 1, size, file) == (size_t)size;
+    written = fclose(file) == 0 && written;
+    if (!written || rename(temp, path) != 0) {
+        remove(temp);
+    }
+}
+#endif
+
+/*
+ * expand - Payload for a Jagfile: its index with packed = unpacked sizes,
+ * then every file decompressed
+ */
+static int8_t *expand(Jagfile *jagfile, int *length) {
+    int size = 2 + jagfile->file_count * 10;
+    for (int i = 0; i < jagfile->file_count; i++) {
+        size += jagfile->file_unpacked_size[i];
+    }
+    int8_t *entry = malloc(ARCHIVE_CACHE_HEADER + size);
+    if (!entry) {
+        return NULL;
+    }
+
+    int8_t *payload = entry + ARCHIVE_CACHE_HEADER;
+    payload[0] = (int8_t)(jagfile->file_count >> 8);
+    payload[1] = (int8_t)jagfile->file_count;
+    int pos = 2 + jagfile->file_count * 10;
+    for (int i = 0; i < jagfile->file_count; i++) {
+        int8_t *index = payload + 2 + i * 10;
+        int unpacked = jagfile->file_unpacked_size[i];
+        put4(index, jagfile->file_hash[i]);
+        for (int k = 0; k < 2; k++) {
+            index[4 + k * 3] = (int8_t)(unpacked >> 16);
+            index[5 + k * 3] = (int8_t)(unpacked >> 8);
+            index[6 + k * 3] = (int8_t)unpacked;
+        }
+        if (jagfile->is_compressed_whole) {
+            memcpy(payload + pos, jagfile->data + jagfile->file_offset[i], unpacked);
+        } else {
+            int8_t *file = jagfile_read_index(jagfile, i);
+            memcpy(payload + pos, file, unpacked);
+            free(file);
+        }
+        pos += unpacked;
+    }
+    *length = size;
+    return entry;
+}
+#endif
+
+Jagfile *archive_cache_load(const char *name, int crc) {
+#ifdef ARCHIVE_CACHE_NONE
+    (void)name, (void)crc;
+    return NULL;
+#else
+    int size = 0;
+    int8_t *entry = store_get(name, &size);
+    if (!entry) {
+        return NULL;
+    }
+
+    int length = size >= ARCHIVE_CACHE_HEADER ? get4(entry + 8) : -1;
+    if (length != size - ARCHIVE_CACHE_HEADER || length < 2 || get4(entry) != ARCHIVE_CACHE_MAGIC ||
+        get4(entry + 4) != crc || rs_crc32(entry + ARCHIVE_CACHE_HEADER, length) != get4(entry + 12)) {
+        free(entry);
+        return NULL;
+    }
+
+    memmove(entry, entry + ARCHIVE_CACHE_HEADER, length);
+    return jagfile_new_unpacked(entry, length);
+#endif
+}
+
+Jagfile *archive_cache_store(const char *name, int crc, Jagfile *jagfile) {
+#ifdef ARCHIVE_CACHE_NONE
+    (void)name, (void)crc;
+    return jagfile;
+#else
+    int length = 0;
+    int8_t *entry = expand(jagfile, &length);
+    if (!entry) {
+        return jagfile;
+    }
+    put4(entry, ARCHIVE_CACHE_MAGIC);
+    put4(entry + 4, crc);
+    put4(entry + 8, length);
+    put4(entry + 12, rs_crc32(entry + ARCHIVE_CACHE_HEADER, length));
+    store_put(name, entry, ARCHIVE_CACHE_HEADER + length);
+
+    /* The files are decompressed now: let the caller read these */
+    jagfile_free(jagfile);
+    memmove(entry, entry + ARCHIVE_CACHE_HEADER, length);
+    return jagfile_new_unpacked(entry, length);
+#endif
+}
@@ -0,0 +1,90 @@
+/*******************************************************************************
+ * ARCHIVE_CACHE.H - Unpacked Client Archives Kept Between Launches
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Content-keyed caching: the CRC that names a version is the cache key
+ *   - Caching the result of work (decompression), not only its input
+ *   - Validating a cache entry before trusting it (corrupt or stale files)
+ *   - One interface over different stores (files, IndexedDB)
+ *
+ * THE PROBLEM:
+ *
+ * client_load() fetches eight archives (title, config, interface, media,
+ * models, textures, wordenc, sounds) on every launch:
+ *
+ *   web:      GET /<name><crc> ×8 ── bzip2 every archive or every file
+ *   desktop:  read rom/cache/client/<name> ×8 ── bzip2 the same way
+ *
+ * The CRCs hardly ever change between launches, so the download (on a
+ * slow link, most of the startup) and the bzip2 work (most of the rest)
+ * produce the same bytes every time.
+ *
+ * THE SOLUTION - STORE THE UNPACKED ARCHIVE UNDER ITS CRC:
+ *
+ *   load_archive(name, crc)
+ *     archive_cache_load(name, crc) ── hit ──→ Jagfile, nothing fetched
+ *       │ miss                                 nothing decompressed
+ *       ▼
+ *     fetch / read, jagfile_new() (bzip2)
+ *     jagfile = archive_cache_store(name, crc, jagfile)  (if the bytes match crc)
+ *
+ * An entry holds the archive with every file already decompressed, in
+ * the same index layout (packed size = unpacked size), so a hit is one
+ * read and a CRC check; jagfile_new_unpacked() takes the bytes as they
+ * are:
+ *
+ *   [magic "JAGU"][crc of the source archive][payload length][payload crc]
+ *   payload: [file count:2][hash:4 size:3 size:3]... [file bytes]...
+ *
+ * VALIDATION:
+ *   An entry is used only if its key is the CRC the client asked for and
+ *   its payload still has the CRC recorded when it was written. A new
+ *   server version (other CRC) or a damaged entry is a miss; the archive
+ *   is fetched and the entry written again.
+ *
+ * STORES:
+ *   Emscripten   IndexedDB, database "rs225" (emscripten_idb_*, which
+ *                needs ASYNCIFY like emscripten_wget_data)
+ *   desktop      <archive file>.unpacked next to the archive
+ *   read-only    Dreamcast, Xbox and Android read their archives from
+ *                the disc or the APK: no cache (load and store do nothing)
+ *
+ * COST:
+ *   The first launch decompresses per-file archives (models, textures...)
+ *   up front instead of file by file as client_load() reads them: the
+ *   store hands back the unpacked archive, so the total stays the same.
+ *   Entries are bigger than the archives (4 MB for models' 1 MB).
+ *
+ ******************************************************************************/
+
+#ifndef ARCHIVE_CACHE_H
+#define ARCHIVE_CACHE_H
+
+#include "jagfile.h"
+
+/*
+ * archive_cache_load - An archive stored under this CRC
+ *
+ * @param name  Archive name ("config")
+ * @param crc   CRC the client expects (archive_checksum[])
+ * @return      Jagfile (free with jagfile_free), or NULL on a miss
+ */
+Jagfile *archive_cache_load(const char *name, int crc);
+
+/*
+ * archive_cache_store - Keep an archive for the next launch
+ *
+ * @param name     Archive name
+ * @param crc      CRC of the archive bytes jagfile was made from
+ * @param jagfile  Archive from jagfile_new(); freed unless returned
+ * @return         The same archive unpacked (its files were just
+ *                 decompressed for the entry, so reading them is a copy),
+ *                 or jagfile itself without a store or memory
+ *
+ * Failing to write is not an error: the next launch just misses.
+ */
+Jagfile *archive_cache_store(const char *name, int crc, Jagfile *jagfile);
+
+#endif /* ARCHIVE_CACHE_H */
@@ -0,0 +1,485 @@
+/*******************************************************************************
+ * ASSET_HTTP.C - Client Archives over HTTP, Sent Straight from the Page Cache
+ *******************************************************************************
+ *
+ * See asset_http.h for what is served and why.
+ *
+ * CONNECTION:
+ *
+ *   accept ──► read ──► complete head? ──► build head ──► send head
+ *                ▲                                           │
+ *                │          keep-alive: next buffered        ▼
+ *                └────────── request, or wait to read ◄── send body
+ *                                                         (sendfile)
+ *
+ *   Whatever arrives while a response is being sent is read into the
+ *   request buffer (a pipelined request, or the hangup), so a client
+ *   waiting on a full send buffer never leaves the socket readable with
+ *   nobody draining it.
+ *
+ * FILES:
+ *   data/archives/<name>, or data/<name> for the two archives (title,
+ *   wordenc) this tree keeps next to the others instead.
+ *
+ ******************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "asset_http.h"
+#include "mapped_file.h"
+#include "crc32.h"
+#include "tick_stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+
+u16 g_asset_http_port = 0;
+
+/* Archive names by CRC table entry, in the client's order (client.c) */
+static const char* ASSET_NAMES[ASSET_HTTP_ARCHIVES] = {
+    NULL, "title", "config", "interface", "media", "models", "textures", "wordenc", "sounds",
+};
+
+/*
+ * AssetFile - One archive, open for the server's lifetime
+ */
+typedef struct {
+    MappedFile view;                /* Read-only mapping (CRC, fallback body) */
+    i32 fd;                         /* For sendfile(), -1 without */
+    u32 crc;                        /* 0 = missing */
+} AssetFile;
+
+/*
+ * AssetClient - One HTTP connection
+ */
+typedef struct {
+    i32 fd;                         /* -1 = slot free */
+    u64 active;                     /* tick_stats_now() at accept or last response */
+    char request[2048];             /* Bytes read and not yet answered */
+    u32 request_len;
+
+    /* Response in progress */
+    bool responding;
+    bool keep_alive;                /* Read the next request after this one */
+    bool want_write;                /* Watching for writability */
+    char head[384];
+    u32 head_len;
+    u32 head_sent;
+    const AssetFile* file;          /* Body from a file, or */
+    const u8* body;                 /* ... from memory */
+    u32 body_sent;
+    u32 body_len;
+} AssetClient;
+
+static struct {
+    NetworkServer* network;
+    i32 listen_fd;
+    AssetFile files[ASSET_HTTP_ARCHIVES];
+    u8 crc_table[ASSET_HTTP_ARCHIVES * 4];
+    AssetClient clients[ASSET_HTTP_MAX_CLIENTS];
+} g_assets = { NULL, -1, { { { 0 }, 0, 0 } }, { 0 }, { { 0 } } };
+
+/*******************************************************************************
+ * ARCHIVES
+ ******************************************************************************/
+
+static void open_archive(AssetFile* file, const char* data_path, const char* name) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/archives/%s", data_path, name);
+    if (!mapped_file_open(&file->view, path)) {
+        snprintf(path, sizeof(path), "%s/%s", data_path, name);
+        if (!mapped_file_open(&file->view, path)) {
+            fprintf(stderr, "WARNING: Archive '%s' not found, serving 404\n", name);
+            return;
+        }
+    }
+
+    file->crc = crc32(file->view.data, file->view.size);
+#ifdef __linux__
+    file->fd = open(path, O_RDONLY);
+#endif
+}
+
+static void close_archives(void) {
+    for (u32 i = 0; i < ASSET_HTTP_ARCHIVES; i++) {
+        AssetFile* file = &g_assets.files[i];
+        mapped_file_close(&file->view);
+#ifndef _WIN32
+        if (file->fd >= 0) close(file->fd);
+#endif
+        memset(file, 0, sizeof(*file));
+        file->fd = -1;
+    }
+}
+
+/*
+ * find_archive - The archive a path names, and whether by its current CRC
+ *
+ * "config", "config-1494598746": the name, then optionally a signed CRC
+ * and nothing else.
+ */
+static const AssetFile* find_archive(const char* name, bool* versioned) {
+    for (u32 i = 1; i < ASSET_HTTP_ARCHIVES; i++) {
+        size_t len = strlen(ASSET_NAMES[i]);
+        if (strncmp(name, ASSET_NAMES[i], len) != 0) continue;
+
+        const char* suffix = name + len;
+        if (*suffix == '\0') {
+            *versioned = false;
+            return &g_assets.files[i];
+        }
+        const char* digit = suffix + (*suffix == '-');
+        if (*digit < '0' || *digit > '9') continue;
+        char* end;
+        long crc = strtol(suffix, &end, 10);
+        if (*end != '\0') continue;
+        *versioned = (u32)(i32)crc == g_assets.files[i].crc;
+        return &g_assets.files[i];
+    }
+    return NULL;
+}
+
+/*******************************************************************************
+ * REQUESTS
+ ******************************************************************************/
+
+/*
+ * header_has - Whether a (lowercased) head has a header containing value
+ */
+static bool header_has(const char* head, const char* name, const char* value) {
+    const char* line = strstr(head, name);
+    if (!line) return false;
+    const char* end = strchr(line + 1, '\n');
+    const char* found = strstr(line + strlen(name), value);
+    return found && (!end || found < end);
+}
+
+/*
+ * build_response - Status line and headers for one request head
+ *
+ * @param head  Request head, NUL-terminated, lowercased
+ */
+static void build_response(AssetClient* client, const char* head) {
+    bool get = strncmp(head, "get /", 5) == 0;
+    bool head_only = strncmp(head, "head /", 6) == 0;
+    const char* path = strchr(head, '/');
+    const char* line_end = strchr(head, '\n');
+
+    /* HTTP/1.1 stays open unless asked not to; HTTP/1.0 the other way */
+    client->keep_alive = line_end && strstr(head, " http/1.1") &&
+                         strstr(head, " http/1.1") < line_end;
+    if (header_has(head, "\nconnection:", "close")) client->keep_alive = false;
+    if (header_has(head, "\nconnection:", "keep-alive")) client->keep_alive = true;
+
+    char name[64];
+    u32 name_len = 0;
+    if (path) {
+        for (path++; *path && *path != ' ' && *path != '?' && *path != '\r'; path++) {
+            if (name_len + 1 == sizeof(name)) break;
+            name[name_len++] = *path;
+        }
+    }
+    name[name_len] = '\0';
+
+    const char* status = "404 Not Found";
+    const char* cache = NULL;
+    bool versioned = false;
+    const AssetFile* file = NULL;
+    const u8* body = NULL;
+    u32 body_len = 0;
+    u32 etag = 0;
+    if (!get && !head_only) {
+        status = "405 Method Not Allowed";
+        client->keep_alive = false;
+    } else if (strncmp(name, "crc", 3) == 0) {
+        /* The suffix is the client's cache buster; the table is never stored */
+        status = "200 OK";
+        cache = "no-store";
+        body = g_assets.crc_table;
+        body_len = sizeof(g_assets.crc_table);
+    } else if ((file = find_archive(name, &versioned)) != NULL && file->crc != 0) {
+        etag = file->crc;
+        cache = versioned ? "public, max-age=31536000, immutable" : "no-cache";
+        char tag[16];
+        snprintf(tag, sizeof(tag), "\"%08x\"", etag);
+        if (header_has(head, "\nif-none-match:", tag)) {
+            status = "304 Not Modified";
+            file = NULL;
+        } else {
+            status = "200 OK";
+            body_len = file->view.size;
+        }
+    } else {
+        file = NULL;
+    }
+
+    char etag_line[32] = "";
+    char cache_line[64] = "";
+    if (etag) snprintf(etag_line, sizeof(etag_line), "ETag: \"%08x\"\r\n", etag);
+    if (cache) snprintf(cache_line, sizeof(cache_line), "Cache-Control: %s\r\n", cache);
+    i32 len = snprintf(client->head, sizeof(client->head),
+                       "HTTP/1.1 %s\r\n"
+                       "Content-Type: application/octet-stream\r\n"
+                       "Content-Length: %u\r\n"
+                       "%s%s"
+                       "Access-Control-Allow-Origin: *\r\n"
+                       "Connection: %s\r\n\r\n",
+                       status, body_len, etag_line, cache_line,
+                       client->keep_alive ? "keep-alive" : "close");
+
+    client->responding = true;
+    client->head_len = len > 0 && (u32)len < sizeof(client->head) ? (u32)len : 0;
+    client->head_sent = 0;
+    client->file = head_only ? NULL : file;
+    client->body = head_only ? NULL : body;
+    client->body_len = head_only || client->head_len == 0 ? 0 : body_len;
+    client->body_sent = 0;
+}
+
+/*
+ * next_request - Start answering the first complete request buffered
+ *
+ * @return  false if no complete head has arrived yet
+ */
+static bool next_request(AssetClient* client) {
+    char* end = strstr(client->request, "\r\n\r\n");
+    u32 skip = 4;
+    if (!end) {
+        end = strstr(client->request, "\n\n");
+        skip = 2;
+    }
+    if (!end) return false;
+
+    /* Keep the last line's own line break: every line ends in '\n' */
+    end[skip / 2] = '\0';
+    for (char* c = client->request; *c; c++) {
+        if (*c >= 'A' && *c <= 'Z') *c = (char)(*c - 'A' + 'a');
+    }
+    build_response(client, client->request);
+
+    /* Keep what followed (a pipelined request) */
+    u32 used = (u32)(end - client->request) + skip;
+    client->request_len -= used;
+    memmove(client->request, client->request + used, client->request_len);
+    client->request[client->request_len] = '\0';
+    return true;
+}
+
+/*******************************************************************************
+ * CONNECTIONS
+ ******************************************************************************/
+
+static void client_close(AssetClient* client) {
+    if (client->fd < 0) return;
+    network_unwatch(g_assets.network, client->fd);
+    network_close_socket(client->fd);
+    client->fd = -1;
+    client->request_len = 0;
+    client->responding = false;
+    client->want_write = false;
+}
+
+/*
+ * send_bytes - send() without SIGPIPE, corking a head that a body follows
+ */
+static i32 send_bytes(i32 fd, const u8* data, u32 length, bool more) {
+#ifdef __linux__
+    return (i32)send(fd, data, length, MSG_NOSIGNAL | (more ? MSG_MORE : 0));
+#else
+    (void)more;
+    return network_send(fd, data, length);
+#endif
+}
+
+static i32 send_body(AssetClient* client) {
+    u32 remaining = client->body_len - client->body_sent;
+#ifdef __linux__
+    if (client->file && client->file->fd >= 0) {
+        off_t offset = (off_t)client->body_sent;
+        return (i32)sendfile(client->fd, client->file->fd, &offset, remaining);
+    }
+#endif
+    const u8* body = client->file ? client->file->view.data : client->body;
+    return send_bytes(client->fd, body + client->body_sent, remaining, false);
+}
+
+/*
+ * client_write - Send what the socket takes of the current response
+ *
+ * @return  true once the response is out and the connection stays open;
+ *          false if it must wait for writability or was closed
+ */
+static bool client_write(AssetClient* client, u32 token) {
+    while (client->head_sent < client->head_len || client->body_sent < client->body_len) {
+        i32 n = client->head_sent < client->head_len
+              ? send_bytes(client->fd, (const u8*)client->head + client->head_sent,
+                           client->head_len - client->head_sent, client->body_len > 0)
+              : send_body(client);
+        if (n > 0) {
+            if (client->head_sent < client->head_len) client->head_sent += (u32)n;
+            else client->body_sent += (u32)n;
+            continue;
+        }
+        if (n < 0 && network_would_block()) {
+            if (!client->want_write) {
+                client->want_write = network_watch(g_assets.network, client->fd, token, true);
+            }
+            return false;
+        }
+        client_close(client);
+        return false;
+    }
+
+    client->responding = false;
+    client->active = tick_stats_now();
+    if (client->head_len == 0 || !client->keep_alive) {
+        client_close(client);
+        return false;
+    }
+    if (client->want_write) {
+        network_watch(g_assets.network, client->fd, token, false);
+        client->want_write = false;
+    }
+    return true;
+}
+
+/*
+ * client_read - Take everything the socket has into the request buffer
+ *
+ * @return  false if the peer closed or failed, or has more unanswered
+ *          bytes queued than the buffer holds
+ */
+static bool client_read(AssetClient* client) {
+    for (;;) {
+        u32 room = sizeof(client->request) - 1 - client->request_len;
+        if (room == 0) return false;
+        i32 n = network_receive(client->fd, (u8*)client->request + client->request_len, room);
+        if (n > 0) {
+            client->request_len += (u32)n;
+            client->request[client->request_len] = '\0';
+            continue;
+        }
+        return n < 0 && network_would_block();
+    }
+}
+
+static void client_service(AssetClient* client, u32 token, bool readable) {
+    if (readable && !client_read(client)) {
+        client_close(client);
+        return;
+    }
+    for (;;) {
+        if (client->responding && !client_write(client, token)) return;
+        if (!next_request(client)) return;
+    }
+}
+
+static void accept_clients(void) {
+    u64 now = tick_stats_now();
+    for (;;) {
+        i32 fd = network_accept(g_assets.listen_fd);
+        if (fd < 0) return;
+
+        /* Drop idle keep-alive connections; refuse if every slot is busy */
+        AssetClient* slot = NULL;
+        for (u32 i = 0; i < ASSET_HTTP_MAX_CLIENTS; i++) {
+            AssetClient* client = &g_assets.clients[i];
+            if (client->fd >= 0 && !client->responding &&
+                now - client->active > (u64)ASSET_HTTP_IDLE_MS * 1000000) {
+                client_close(client);
+            }
+            if (client->fd < 0 && !slot) slot = client;
+        }
+        u32 token = slot ? ASSET_HTTP_TOKEN_BASE + 1 + (u32)(slot - g_assets.clients) : 0;
+        if (!slot || !network_watch(g_assets.network, fd, token, false)) {
+            network_close_socket(fd);
+            continue;
+        }
+        slot->fd = fd;
+        slot->active = now;
+        slot->request_len = 0;
+        slot->request[0] = '\0';
+        slot->responding = false;
+        slot->want_write = false;
+    }
+}
+
+/*******************************************************************************
+ * LIFECYCLE
+ ******************************************************************************/
+
+bool asset_http_listen(NetworkServer* network, u16 port, const char* data_path) {
+    for (u32 i = 0; i < ASSET_HTTP_MAX_CLIENTS; i++) g_assets.clients[i].fd = -1;
+
+    u32 found = 0;
+    for (u32 i = 0; i < ASSET_HTTP_ARCHIVES; i++) {
+        AssetFile* file = &g_assets.files[i];
+        file->fd = -1;
+        if (ASSET_NAMES[i]) open_archive(file, data_path, ASSET_NAMES[i]);
+        if (file->crc != 0) found++;
+
+        /* Big-endian, as the client's g4() reads them */
+        u8* entry = &g_assets.crc_table[i * 4];
+        entry[0] = (u8)(file->crc >> 24);
+        entry[1] = (u8)(file->crc >> 16);
+        entry[2] = (u8)(file->crc >> 8);
+        entry[3] = (u8)file->crc;
+    }
+
+    i32 fd = network_listen(port);
+    if (fd < 0) {
+        fprintf(stderr, "WARNING: Failed to open asset port %u\n", port);
+        close_archives();
+        return false;
+    }
+    if (!network_watch(network, fd, ASSET_HTTP_TOKEN_LISTENER, false)) {
+        fprintf(stderr, "WARNING: Failed to watch asset port %u\n", port);
+        network_close_socket(fd);
+        close_archives();
+        return false;
+    }
+#ifndef _WIN32
+    /* sendfile() has no MSG_NOSIGNAL: a browser leaving mid-file must not
+     * end the process */
+    signal(SIGPIPE, SIG_IGN);
+#endif
+    g_assets.network = network;
+    g_assets.listen_fd = fd;
+    printf("Assets on port %u (%u archives over HTTP)\n", port, found);
+    return true;
+}
+
+void asset_http_handle_event(const NetworkEvent* event) {
+    if (g_assets.listen_fd < 0) return;
+    if (event->token == ASSET_HTTP_TOKEN_LISTENER) {
+        accept_clients();
+        return;
+    }
+
+    u32 index = event->token - ASSET_HTTP_TOKEN_BASE - 1;
+    if (index >= ASSET_HTTP_MAX_CLIENTS) return;
+    AssetClient* client = &g_assets.clients[index];
+    if (client->fd < 0) return;
+    client_service(client, event->token, event->readable);
+}
+
+void asset_http_close(void) {
+    if (g_assets.listen_fd < 0) return;
+    for (u32 i = 0; i < ASSET_HTTP_MAX_CLIENTS; i++) {
+        client_close(&g_assets.clients[i]);
+    }
+    network_unwatch(g_assets.network, g_assets.listen_fd);
+    network_close_socket(g_assets.listen_fd);
+    g_assets.listen_fd = -1;
+    close_archives();
+}
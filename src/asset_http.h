@@ -0,0 +1,128 @@
+/*******************************************************************************
+ * ASSET_HTTP.H - Client Archives over HTTP, Sent Straight from the Page Cache
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Zero-copy file transfer: sendfile() from the page cache to the socket
+ *   - Content-addressed names and HTTP validators (ETag, If-None-Match)
+ *   - Persistent HTTP/1.1 connections (keep-alive, pipelined requests)
+ *   - A third protocol in the game's event set, next to metrics.h
+ *
+ * THE PROBLEM:
+ *
+ * The web client fetches its archives over HTTP before it ever opens the
+ * game socket (load_archive() → client_openurl() in src/entry/client.c):
+ *
+ *   GET /crc1234567          9 big-endian CRCs (36 bytes), random suffix
+ *   GET /title784449929      archive "title", named by its CRC
+ *   GET /config-1494598746   ... one request per archive
+ *
+ * Until now a separate web server served data/archives for that: one more
+ * service to deploy, configure and keep in step with the files the game
+ * server reads.
+ *
+ * THE SOLUTION - THE GAME SERVER ANSWERS ON ANOTHER PORT:
+ *
+ *   --http-port N     each archive is opened once at startup, its CRC
+ *                     taken from a read-only mapping (mapped_file.h)
+ *
+ *   request                   response
+ *   ───────────────────────   ─────────────────────────────────────────
+ *   /crc<anything>            the CRC table, never cached
+ *   /<name><current crc>      the archive, cacheable forever (the name
+ *                             changes when the bytes do)
+ *   /<name>[<other crc>]      the archive, revalidated every time
+ *   If-None-Match: "<crc>"    304 Not Modified, no body
+ *
+ * The body never passes through a user-space buffer:
+ *
+ *   read() + send():  disk → page cache → heap buffer → socket buffer
+ *   sendfile():       disk → page cache ─────────────→ socket buffer
+ *
+ * Where sendfile() is not available the body is sent from the mapped
+ * view, which still reads the page cache in place. Connections stay open
+ * for the next request (HTTP/1.1 keep-alive), so a client loading nine
+ * files pays for one TCP handshake.
+ *
+ * SERVED BY THE NETWORK LOOP:
+ *   Like metrics.h: the listener and its (at most ASSET_HTTP_MAX_CLIENTS)
+ *   connections are watched in the game's event set with tokens from
+ *   ASSET_HTTP_TOKEN_BASE up, and whichever loop waits on that set hands
+ *   their events to asset_http_handle_event(). A response the socket
+ *   cannot take at once is continued on writability.
+ *
+ * COMPLEXITY:
+ *   - startup:  one read of every archive (its CRC)
+ *   - request:  O(head bytes) to parse; the body costs no CPU copy
+ *   - memory:   ~1.5 KB per connection slot; archives live in the page
+ *               cache, shared with the game's own cache.h mappings
+ *
+ * CONFIGURATION:
+ *   --http-port N     serve on port N (off by default; world K of
+ *                     --worlds uses N + K)
+ *
+ * THREADS:
+ *   The thread that waits on the event set (server_run() or the network
+ *   thread) only.
+ *
+ ******************************************************************************/
+
+#ifndef ASSET_HTTP_H
+#define ASSET_HTTP_H
+
+#include "types.h"
+#include "network.h"
+#include <stdbool.h>
+
+/* Open connections at once (further connections are refused) */
+#define ASSET_HTTP_MAX_CLIENTS 32
+
+/* A connection quiet for this long is closed when a slot is needed */
+#define ASSET_HTTP_IDLE_MS 15000
+
+/* Event tokens: listener, then one per client (below metrics.h's) */
+#define ASSET_HTTP_TOKEN_BASE 0xFFFFFE00u
+#define ASSET_HTTP_TOKEN_LISTENER ASSET_HTTP_TOKEN_BASE
+
+/* Entries in the client's CRC table (entry 0 is unused and 0) */
+#define ASSET_HTTP_ARCHIVES 9
+
+/*
+ * g_asset_http_port - Port for the endpoint (0 = disabled, --http-port)
+ */
+extern u16 g_asset_http_port;
+
+/*
+ * asset_http_listen - Open the archives and the endpoint
+ *
+ * @param network    Game NetworkServer (already initialized)
+ * @param port       TCP port
+ * @param data_path  Directory holding archives/ (as for cache_init())
+ * @return           false (with a warning) if the port could not be bound
+ *
+ * A missing archive is served as 404 and has CRC 0 in the table. Call
+ * before the network thread starts, like metrics_listen().
+ */
+bool asset_http_listen(NetworkServer* network, u16 port, const char* data_path);
+
+/*
+ * asset_http_owns_token - true for the listener's and clients' tokens
+ */
+static inline bool asset_http_owns_token(u32 token) {
+    return token >= ASSET_HTTP_TOKEN_BASE && token <= ASSET_HTTP_TOKEN_BASE + ASSET_HTTP_MAX_CLIENTS;
+}
+
+/*
+ * asset_http_handle_event - Accept, read requests, or continue a response
+ *
+ * @param event  Event whose token asset_http_owns_token()
+ */
+void asset_http_handle_event(const NetworkEvent* event);
+
+/*
+ * asset_http_close - Close the listener, the connections and the archives
+ */
+void asset_http_close(void);
+
+#endif /* ASSET_HTTP_H */
@@ -0,0 +1,215 @@
+/*******************************************************************************
+ * ASSET_RELOAD.C - Reloading Maps Without a Restart Implementation
+ *******************************************************************************
+ *
+ * See asset_reload.h for the design.
+ *
+ * HAND-OFF:
+ *
+ *   game thread                       builder
+ *   ───────────                       ───────
+ *   state = BUILDING
+ *   pthread_create ─────────────────→ build maps, collision
+ *   (ticks)                           fill in the results
+ *   load state (acquire) == READY ←── store state = READY (release)
+ *   pthread_join, swap, state = IDLE
+ *
+ * The release/acquire pair orders the builder's writes before the game
+ * thread's reads; nothing else is shared, so no mutex is needed.
+ *
+ ******************************************************************************/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include "asset_reload.h"
+#include "cache.h"
+#include "instance.h"
+#include "map.h"
+#include "replay.h"
+#include "server_packets.h"
+#include "tick_stats.h"
+#include "world.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * count_changed_files - Files added, removed or changed between two stores
+ *
+ * As a client would notice: by presence and CRC, key by key.
+ */
+static u32 count_changed_files(const MapStore* before, const MapStore* after) {
+    u32 changed = 0;
+    for (u32 type = 0; type < MAP_FILE_TYPE_COUNT; type++) {
+        for (u32 key = 0; key < 256 * 256; key++) {
+            u16 a = before ? before->index[type][key] : MAP_STORE_NONE;
+            u16 b = after->index[type][key];
+            if (a == MAP_STORE_NONE && b == MAP_STORE_NONE) continue;
+            if (a == MAP_STORE_NONE || b == MAP_STORE_NONE ||
+                before->files[a].crc != after->files[b].crc) {
+                changed++;
+            }
+        }
+    }
+    return changed;
+}
+
+/*
+ * asset_reload_build - Everything the builder thread does
+ */
+static void asset_reload_build(AssetReload* reload) {
+    u64 start = tick_stats_now();
+    reload->maps = map_store_create("data/maps");
+    if (reload->maps) {
+        reload->collision = world_collision_create(reload->maps, g_cache);
+        reload->locs = static_locs_create(reload->maps);
+        reload->changed_files = count_changed_files(reload->base, reload->maps);
+    }
+    reload->build_ns = tick_stats_now() - start;
+    __atomic_store_n(&reload->state, ASSET_RELOAD_READY, __ATOMIC_RELEASE);
+}
+
+/*
+ * asset_reload_discard - Free a build that will not be swapped in
+ */
+static void asset_reload_discard(AssetReload* reload) {
+    static_locs_destroy(reload->locs);
+    world_collision_destroy(reload->collision);
+    map_store_destroy(reload->maps);
+    reload->locs = NULL;
+    reload->collision = NULL;
+    reload->maps = NULL;
+}
+
+/*
+ * asset_reload_tell - Message the player who asked, if still online
+ */
+static void asset_reload_tell(AssetReload* reload, const char* message) {
+    printf("Map reload: %s\n", message);
+    Player* player = reload->requester[0] ? world_get_player(g_world, reload->requester) : NULL;
+    if (player) send_player_message(player, message);
+}
+
+#ifndef _WIN32
+
+#include <pthread.h>
+#include <signal.h>
+
+static void* asset_reload_thread_main(void* arg) {
+    asset_reload_build((AssetReload*)arg);
+    return NULL;
+}
+
+bool asset_reload_start(AssetReload* reload, const char* requester) {
+    if (g_replay.replaying || !g_cache) return false;
+    if (__atomic_load_n(&reload->state, __ATOMIC_ACQUIRE) != ASSET_RELOAD_IDLE) return false;
+
+    pthread_t* thread = (pthread_t*)malloc(sizeof(pthread_t));
+    if (!thread) return false;
+
+    reload->base = g_map_store;
+    reload->maps = NULL;
+    reload->collision = NULL;
+    reload->locs = NULL;
+    reload->changed_files = 0;
+    reload->build_ns = 0;
+    snprintf(reload->requester, sizeof(reload->requester), "%s", requester ? requester : "");
+    reload->state = ASSET_RELOAD_BUILDING;
+
+    /* Signals stay on the game thread, as for the other pools */
+    sigset_t all, previous;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &previous);
+    int rc = pthread_create(thread, NULL, asset_reload_thread_main, reload);
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+    if (rc != 0) {
+        free(thread);
+        reload->state = ASSET_RELOAD_IDLE;
+        return false;
+    }
+    reload->thread = thread;
+    printf("Map reload: building from data/maps\n");
+    return true;
+}
+
+/*
+ * asset_reload_join - Reap the builder thread (state is READY)
+ */
+static void asset_reload_join(AssetReload* reload) {
+    pthread_join(*(pthread_t*)reload->thread, NULL);
+    free(reload->thread);
+    reload->thread = NULL;
+}
+
+#else /* _WIN32 */
+
+bool asset_reload_start(AssetReload* reload, const char* requester) {
+    (void)reload; (void)requester;
+    fprintf(stderr, "WARNING: Map reload not supported on this platform\n");
+    return false;
+}
+
+static void asset_reload_join(AssetReload* reload) {
+    (void)reload;
+}
+
+#endif /* _WIN32 */
+
+bool asset_reload_poll(AssetReload* reload, Player* players, u32 count) {
+    if (__atomic_load_n(&reload->state, __ATOMIC_ACQUIRE) != ASSET_RELOAD_READY) return false;
+    asset_reload_join(reload);
+
+    char line[96];
+    if (!reload->maps || !reload->collision || !reload->locs) {
+        asset_reload_discard(reload);
+        asset_reload_tell(reload, "Map reload failed, keeping the current maps.");
+        reload->state = ASSET_RELOAD_IDLE;
+        return false;
+    }
+
+    /* Between ticks: nothing is reading either of them right now */
+    MapStore* old_maps = g_map_store;
+    WorldCollision* old_collision = g_world_collision;
+    StaticLocs* old_locs = g_static_locs;
+    g_map_store = reload->maps;
+    g_world_collision = reload->collision;
+    g_static_locs = reload->locs;
+    
+    /* Instances point at pages of the old collision: share the new ones */
+    instance_system_rebind(g_instances, g_world_collision, old_collision);
+
+    /* Only clients whose last LOAD_AREA no longer matches */
+    u32 resent = 0;
+    for (u32 i = 0; i < count; i++) {
+        Player* player = &players[i];
+        if (player->state != PLAYER_STATE_LOGGED_IN) continue;
+        if (map_area_changed(player, old_maps, g_map_store)) {
+            player_reload_area(player);
+            resent++;
+        }
+    }
+
+    static_locs_destroy(old_locs);
+    world_collision_destroy(old_collision);
+    map_store_destroy(old_maps);
+    reload->maps = NULL;
+    reload->collision = NULL;
+    reload->locs = NULL;
+    reload->reloads++;
+
+    snprintf(line, sizeof(line), "Maps reloaded: %u files changed, %u players resent (%.0f ms).",
+             reload->changed_files, resent, (double)reload->build_ns / 1e6);
+    asset_reload_tell(reload, line);
+    reload->state = ASSET_RELOAD_IDLE;
+    return true;
+}
+
+void asset_reload_stop(AssetReload* reload) {
+    if (__atomic_load_n(&reload->state, __ATOMIC_ACQUIRE) == ASSET_RELOAD_IDLE) return;
+
+    /* The builder cannot be interrupted: wait for it, then drop its work */
+    asset_reload_join(reload);
+    asset_reload_discard(reload);
+    reload->state = ASSET_RELOAD_IDLE;
+}
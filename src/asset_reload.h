@@ -0,0 +1,142 @@
+/*******************************************************************************
+ * ASSET_RELOAD.H - Reloading Maps Without a Restart
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Building a replacement for immutable data off the hot thread
+ *   - Swapping it in with a pointer store at a tick boundary
+ *   - Telling only the clients whose view actually changed
+ *
+ * THE PROBLEM:
+ *
+ * The map store (map_store.h) and the world collision built from it are
+ * loaded once at startup. Changing a file under data/maps meant a
+ * restart, and with it a disconnect for everyone. Rebuilding them on the
+ * game thread would not do either: scanning, CRCing and chunking ~1450
+ * files and decoding their collision takes far longer than a tick.
+ *
+ * THE SOLUTION - BUILD ASIDE, SWAP BETWEEN TICKS:
+ *
+ *   ::reloadmaps (admin)
+ *
+ *   GAME THREAD                          BUILDER THREAD
+ *   asset_reload_start() ──────────────→ map_store_create("data/maps")
+ *   ticks go on with the old store       world_collision_create()
+ *     ...                                static_locs_create()
+ *                                        count files whose CRC changed
+ *   asset_reload_poll(), tick start  ←── READY
+ *     g_map_store = new
+ *     g_world_collision = new
+ *     g_static_locs = new
+ *     fresh LOAD_AREA where it changed
+ *     free the old store, collision and locs
+ *
+ * Both are immutable once built, so the builder needs no lock: it reads
+ * only the files, the current store (to compare CRCs) and the config
+ * archive, which nothing else reads after startup. The swap happens at
+ * the start of server_tick(), before packets are read, so a tick sees
+ * one store from start to finish.
+ *
+ * WHAT CLIENTS SEE:
+ *   A client is told the CRCs of its 3x3 area in LOAD_AREA and requests
+ *   the files it lacks. Players whose last LOAD_AREA lists a file that
+ *   changed (map_area_changed()) get a fresh LOAD_AREA at the swap; their
+ *   client fetches the new files and rebuilds the scene. Everyone else
+ *   keeps playing undisturbed: their files are the same in both stores.
+ *
+ *   Map transfers are paced over several ticks (map.h), but each queued
+ *   file remembers the CRC it started with and goes back to the store
+ *   for every tick's chunks. At the swap a transfer of an unchanged file
+ *   carries on from the new store (same bytes); one whose file changed
+ *   is dropped, and the fresh LOAD_AREA makes the client ask again. Bytes
+ *   already in a player's output were copied there, so the old store
+ *   can be freed at the swap itself.
+ *
+ * EDITING MAP FILES:
+ *   Replace files by rename (copy next to them, then mv over the old
+ *   name). The running store maps the current files (mapped_file.h);
+ *   rewriting one in place changes, or truncates, pages it still maps.
+ *
+ * NOT RELOADED:
+ *   Definitions (obj, npc, loc) come from the config archive and are
+ *   shared by the item, NPC and object systems and every live entity.
+ *   They still need a restart. The on-disk snapshot (snapshot.h) is not
+ *   rewritten; its fingerprint covers data/maps, so the next boot
+ *   rebuilds it from the new files.
+ *
+ * PLATFORM:
+ *   POSIX threads. On Windows asset_reload_start() fails.
+ *
+ ******************************************************************************/
+
+#ifndef ASSET_RELOAD_H
+#define ASSET_RELOAD_H
+
+#include "types.h"
+#include "player.h"
+#include "map_store.h"
+#include "world_collision.h"
+#include "static_locs.h"
+#include <stdbool.h>
+
+/*
+ * AssetReloadState - Where a reload is (read and written with __atomic)
+ */
+typedef enum {
+    ASSET_RELOAD_IDLE = 0,      /* Nothing running */
+    ASSET_RELOAD_BUILDING,      /* Builder thread at work */
+    ASSET_RELOAD_READY          /* Built (or failed), waiting for the swap */
+} AssetReloadState;
+
+/*
+ * AssetReload - One reload at a time, owned by the GameServer
+ *
+ * The builder writes maps, collision, changed_files and build_ns, then
+ * publishes READY; the game thread reads them only after seeing READY.
+ */
+typedef struct {
+    u32 state;                  /* AssetReloadState */
+    void* thread;               /* pthread_t */
+    const MapStore* base;       /* Store being replaced (compared, never freed here) */
+    MapStore* maps;             /* Built store, NULL on failure */
+    WorldCollision* collision;  /* Built collision, NULL on failure */
+    StaticLocs* locs;           /* Built static locs, NULL on failure */
+    u32 changed_files;          /* Files added, removed or with another CRC */
+    u64 build_ns;
+    char requester[MAX_USERNAME_LENGTH + 1];    /* Told the result, if online */
+    u64 reloads;                /* Swaps done */
+} AssetReload;
+
+/*
+ * asset_reload_start - Start building new maps and collision
+ *
+ * @param reload     Server's reload state
+ * @param requester  Username to tell the result (may be NULL)
+ * @return           false if a reload is already running, during a
+ *                   replay (replay.h: a swap at a wall-clock moment would
+ *                   change the output), or if the thread cannot start
+ */
+bool asset_reload_start(AssetReload* reload, const char* requester);
+
+/*
+ * asset_reload_poll - Swap in a finished build (start of server_tick)
+ *
+ * @param reload   Server's reload state
+ * @param players  Player slots (the server's players[])
+ * @param count    Number of slots
+ * @return         true if new maps were swapped in this call
+ *
+ * Sends a fresh LOAD_AREA to every logged-in player whose area changed,
+ * then frees the old store and collision. A failed build changes nothing.
+ *
+ * COMPLEXITY: O(1) while building; O(count) on the swap tick
+ */
+bool asset_reload_poll(AssetReload* reload, Player* players, u32 count);
+
+/*
+ * asset_reload_stop - Wait for a running build and discard it (shutdown)
+ */
+void asset_reload_stop(AssetReload* reload);
+
+#endif /* ASSET_RELOAD_H */
@@ -0,0 +1,150 @@
+/*******************************************************************************
+ * BROADCAST.C - Shared-Payload Sends to Many Players
+ *******************************************************************************
+ *
+ * See broadcast.h for why the payload is encoded once and copied.
+ *
+ ******************************************************************************/
+
+#include "broadcast.h"
+#include "packets.h"
+#include "player_list.h"
+#include "server_packets.h"
+#include "zone_grid.h"
+#include <string.h>
+
+StreamBuffer* broadcast_begin(Broadcast* b, u8 opcode) {
+    b->opcode = opcode;
+    b->size = ServerPacketSizes[opcode];
+    buffer_init_external(&b->payload, b->storage, sizeof(b->storage));
+    return &b->payload;
+}
+
+void broadcast_end(Broadcast* b) {
+    buffer_release(&b->payload);
+}
+
+/* Does the payload (after extra per-player bytes) fit the packet's frame? */
+static bool broadcast_fits_with(const Broadcast* b, u32 extra) {
+    u32 length = extra + b->payload.position;
+    if (b->size == -1) return length <= 0xFF;
+    if (b->size == -2) return length <= 0xFFFF;
+    return length == (u32)b->size;
+}
+
+static bool broadcast_fits(const Broadcast* b) {
+    return broadcast_fits_with(b, 0);
+}
+
+/* Frame + copy for one connection: everything but the payload is per player */
+static bool broadcast_write_prefixed(const Broadcast* b, Player* player,
+                                     const u8* prefix, u32 prefix_length) {
+    u32 length = b->payload.position;
+    ISAACCipher* enc = player->conn->out_cipher.initialized ? &player->conn->out_cipher : NULL;
+
+    StreamBuffer* out = player_out(player);
+    if (!buffer_reserve(out, 3 + prefix_length + length)) return false;
+    buffer_write_header(out, b->opcode, enc);
+    if (b->size == -1) {
+        buffer_put_u8(out, (u8)(prefix_length + length));
+    } else if (b->size == -2) {
+        buffer_put_u16(out, (u16)(prefix_length + length));
+    }
+    if (prefix_length > 0) {
+        memcpy(out->data + out->position, prefix, prefix_length);
+        out->position += prefix_length;
+    }
+    memcpy(out->data + out->position, b->payload.data, length);
+    out->position += length;
+
+    player_out_commit(player);
+    return true;
+}
+
+static bool broadcast_write(const Broadcast* b, Player* player) {
+    return broadcast_write_prefixed(b, player, NULL, 0);
+}
+
+static bool broadcast_wants(const Player* player) {
+    return player && player->socket_fd >= 0 && player->state == PLAYER_STATE_LOGGED_IN;
+}
+
+bool broadcast_send(const Broadcast* b, Player* player) {
+    if (!broadcast_wants(player) || !broadcast_fits(b)) return false;
+    return broadcast_write(b, player);
+}
+
+bool broadcast_send_prefixed(const Broadcast* b, Player* player, const u8* prefix, u32 length) {
+    if (!broadcast_wants(player) || !broadcast_fits_with(b, length)) return false;
+    return broadcast_write_prefixed(b, player, prefix, length);
+}
+
+u32 broadcast_world(const Broadcast* b, World* world) {
+    if (!world || !world->player_list || !broadcast_fits(b)) return 0;
+
+    PlayerList* list = world->player_list;
+    u32 sent = 0;
+    for (u32 i = 0; i < list->count; i++) {
+        Player* player = list->active[i];
+        if (broadcast_wants(player) && broadcast_write(b, player)) sent++;
+    }
+    return sent;
+}
+
+u32 broadcast_area(const Broadcast* b, World* world, const Position* center, u32 radius) {
+    if (!world || !world->player_list || !world->zone_grid || !center || !broadcast_fits(b)) {
+        return 0;
+    }
+
+    u16 candidates[MAX_PLAYERS];
+    u32 count = zone_grid_query(world->zone_grid, position_x(center), position_z(center), radius,
+                                candidates, MAX_PLAYERS);
+    u32 sent = 0;
+    for (u32 i = 0; i < count; i++) {
+        Player* player = player_list_get(world->player_list, candidates[i]);
+        if (!broadcast_wants(player) || !position_same_height(&player->position, center)) continue;
+
+        /* The grid returns whole zones: apply the exact square */
+        if (position_distance(&player->position, center) > radius) continue;
+        if (broadcast_write(b, player)) sent++;
+    }
+    return sent;
+}
+
+/* MESSAGE_GAME payload: the newline-terminated string */
+static void broadcast_message_begin(Broadcast* b, const char* msg) {
+    StreamBuffer* payload = broadcast_begin(b, SERVER_MESSAGE_GAME);
+    buffer_write_string(payload, msg);
+}
+
+u32 broadcast_message_world(World* world, const char* msg) {
+    if (!msg) return 0;
+    Broadcast b;
+    broadcast_message_begin(&b, msg);
+    u32 sent = broadcast_world(&b, world);
+    broadcast_end(&b);
+    return sent;
+}
+
+u32 broadcast_message_area(World* world, const Position* center, u32 radius, const char* msg) {
+    if (!msg) return 0;
+    Broadcast b;
+    broadcast_message_begin(&b, msg);
+    u32 sent = broadcast_area(&b, world, center, radius);
+    broadcast_end(&b);
+    return sent;
+}
+
+bool broadcast_container_begin(Broadcast* b, u16 component, const ItemContainer* container) {
+    u32 dirty_count = 0;
+    if (!container) return false;
+    item_container_dirty(container, &dirty_count);
+    if (dirty_count == 0) return false;
+
+    if (container_update_partial(container)) {
+        write_container_partial(broadcast_begin(b, SERVER_UPDATE_INV_PARTIAL), component, container);
+    } else {
+        write_container_full(broadcast_begin(b, SERVER_UPDATE_INV_FULL), component, container);
+    }
+    return true;
+}
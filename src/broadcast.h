@@ -0,0 +1,167 @@
+/*******************************************************************************
+ * BROADCAST.H - One Encode, Many Recipients
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Separating what is shared (the payload) from what is per-connection
+ *     (the ISAAC-encrypted opcode)
+ *   - Hoisting loop-invariant work out of a fan-out loop
+ *   - Range queries over the zone grid for area-wide sends
+ *
+ * THE PROBLEM:
+ *
+ * Every sender in server_packets.c builds its packet straight into one
+ * player's output arena. Telling 2000 players the same thing means
+ * building it 2000 times:
+ *
+ *   for each player (2000):
+ *       send_player_message(player, "System update in 60 seconds")
+ *         → header, length placeholder, string copy, length backfill
+ *
+ * Only the first byte differs between those 2000 packets: the opcode is
+ * encrypted with each connection's own ISAAC stream. The payload is the
+ * same bytes every time.
+ *
+ * THE SOLUTION - ENCODE THE PAYLOAD ONCE:
+ *
+ *   Broadcast b;
+ *   StreamBuffer* p = broadcast_begin(&b, SERVER_MESSAGE_GAME);
+ *   buffer_write_string(p, "System update in 60 seconds");   once
+ *   broadcast_world(&b, g_world);
+ *   broadcast_end(&b);
+ *
+ *   shared payload:  [S][y][s][t][e][m]...[\n]          encoded once
+ *
+ *   recipient A arena: ... [op ^ isaacA][len][payload copy]
+ *   recipient B arena: ... [op ^ isaacB][len][payload copy]
+ *                           └── per player ──┘└─ memcpy ─┘
+ *
+ * Per recipient that leaves one ISAAC step, the length prefix (known up
+ * front, so no placeholder and backfill) and one memcpy into the arena.
+ *
+ * WHY COPY AND NOT REFERENCE:
+ *   A connection's output is one contiguous arena sent with one send()
+ *   per flush (player_flush), or copied into the network thread's ring.
+ *   Either way the bytes end up contiguous, so a reference to the shared
+ *   payload would only move the same memcpy to flush time. Copying while
+ *   encoding keeps the arena, the profiler and the replay digest as they
+ *   are, and the Broadcast can live on the stack.
+ *
+ * PACKET FRAMING:
+ *   The frame (fixed, VAR_BYTE, VAR_SHORT) comes from the packet's size
+ *   in SERVER_PACKET_LIST. A payload that does not fit it (wrong fixed
+ *   size, over 255 bytes for VAR_BYTE) is not sent to anyone.
+ *
+ * THREADS:
+ *   Game thread only, like every other sender.
+ *
+ ******************************************************************************/
+
+#ifndef BROADCAST_H
+#define BROADCAST_H
+
+#include "types.h"
+#include "buffer.h"
+#include "player.h"
+#include "world.h"
+
+/* Payload bytes held inline; larger payloads spill to the heap */
+#define BROADCAST_INLINE_SIZE 256
+
+/*
+ * Broadcast - A packet payload encoded once for many recipients
+ *
+ * The payload buffer points into the struct itself: do not copy a
+ * Broadcast, pass it by pointer.
+ */
+typedef struct {
+    u8 opcode;                              /* SERVER_* opcode */
+    i8 size;                                /* ServerPacketSizes[]: -1 VAR_BYTE, -2 VAR_SHORT */
+    StreamBuffer payload;                   /* Shared payload bytes */
+    u8 storage[BROADCAST_INLINE_SIZE];
+} Broadcast;
+
+/*
+ * broadcast_begin - Start a broadcast and return its payload buffer
+ *
+ * @param b       Broadcast to initialize
+ * @param opcode  Server packet opcode
+ * @return        Buffer to write the payload into (no header)
+ */
+StreamBuffer* broadcast_begin(Broadcast* b, u8 opcode);
+
+/*
+ * broadcast_end - Free the payload if it spilled to the heap
+ */
+void broadcast_end(Broadcast* b);
+
+/*
+ * broadcast_send - Queue the broadcast for one player
+ *
+ * @param b       Finished broadcast
+ * @param player  Recipient (skipped unless logged in and connected)
+ * @return        true if the packet was queued
+ */
+bool broadcast_send(const Broadcast* b, Player* player);
+
+/*
+ * broadcast_send_prefixed - Queue the broadcast with per-player leading bytes
+ *
+ * @param b       Finished broadcast
+ * @param player  Recipient (skipped unless logged in and connected)
+ * @param prefix  Payload bytes that differ per recipient, written first
+ * @param length  Prefix length
+ * @return        true if the packet was queued
+ *
+ * For packets whose payload is shared but for a small viewer-relative
+ * header, like the scene-local zone corner of UPDATE_ZONE_PARTIAL_ENCLOSED
+ * (zone_update.h). The length prefix counts both parts.
+ */
+bool broadcast_send_prefixed(const Broadcast* b, Player* player, const u8* prefix, u32 length);
+
+/*
+ * broadcast_world - Queue the broadcast for every player online
+ *
+ * @return  Number of recipients
+ *
+ * COMPLEXITY: O(players online), one encode total
+ */
+u32 broadcast_world(const Broadcast* b, World* world);
+
+/*
+ * broadcast_area - Queue the broadcast for players near a position
+ *
+ * @param b       Finished broadcast
+ * @param world   World whose zone grid to search
+ * @param center  Center tile (only players on its height level)
+ * @param radius  Chebyshev distance in tiles (15 = view distance)
+ * @return        Number of recipients
+ *
+ * COMPLEXITY: O(zones in range + players filed there)
+ */
+u32 broadcast_area(const Broadcast* b, World* world, const Position* center, u32 radius);
+
+/*
+ * broadcast_message_world / broadcast_message_area - MESSAGE_GAME to many
+ *
+ * The broadcast form of send_player_message().
+ */
+u32 broadcast_message_world(World* world, const char* msg);
+u32 broadcast_message_area(World* world, const Position* center, u32 radius, const char* msg);
+
+/*
+ * broadcast_container_begin - Start an inventory update of a container
+ *
+ * @param b          Broadcast to initialize
+ * @param component  Inventory component showing the container
+ * @param container  Container whose dirty slots to encode
+ * @return           false, with b left untouched, if no slot is dirty
+ *
+ * UPDATE_INV_PARTIAL of the dirty slots, or UPDATE_INV_FULL when that is
+ * smaller (the choice send_container_update() makes). The dirty slots
+ * are not cleared: that is the caller's, once every viewer has it.
+ */
+bool broadcast_container_begin(Broadcast* b, u16 component, const ItemContainer* container);
+
+#endif /* BROADCAST_H */
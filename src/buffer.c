@@ -23,6 +23,9 @@
  ******************************************************************************/
 
 #include "buffer.h"
+#include "metrics.h"
+#include "mem_stats.h"
+#include "packet_profile.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -63,13 +66,13 @@
  */
 StreamBuffer* buffer_create(u32 capacity) {
     /* Allocate structure on heap */
-    StreamBuffer* buf = (StreamBuffer*)malloc(sizeof(StreamBuffer));
+    StreamBuffer* buf = (StreamBuffer*)mem_alloc(MEM_BUFFER, sizeof(StreamBuffer));
     if (!buf) return NULL;  /* Out of memory */
     
     /* Allocate data array */
-    buf->data = (u8*)malloc(capacity);
+    buf->data = (u8*)mem_alloc(MEM_BUFFER, capacity);
     if (!buf->data) { 
-        free(buf);  /* Clean up partial allocation */
+        mem_free(buf);  /* Clean up partial allocation */
         return NULL;
     }
     
@@ -80,9 +83,12 @@ StreamBuffer* buffer_create(u32 capacity) {
     buf->capacity     = capacity;
     buf->position     = 0;
     buf->bit_position = 0;
+    buf->bit_acc      = 0;
+    buf->bit_acc_count = 0;
     buf->cipher       = NULL;
     buf->var_len_pos  = 0;
     buf->var_len_kind = 0;
+    buf->owns_data    = true;
     
     return buf;
 }
@@ -109,8 +115,38 @@ StreamBuffer* buffer_create(u32 capacity) {
 void buffer_destroy(StreamBuffer* buf) {
     if (!buf) return;  /* NULL-safe */
     
-    free(buf->data);   /* Free data array first */
-    free(buf);         /* Then free struct */
+    if (buf->owns_data) {
+        mem_free(buf->data);   /* Free data array first (unless caller-owned) */
+    }
+    mem_free(buf);         /* Then free struct */
+}
+
+void buffer_init_external(StreamBuffer* buf, u8* storage, u32 capacity) {
+    if (!buf) return;
+    
+    buf->data         = storage;
+    buf->capacity     = storage ? capacity : 0;
+    buf->position     = 0;
+    buf->bit_position = 0;
+    buf->bit_acc      = 0;
+    buf->bit_acc_count = 0;
+    buf->cipher       = NULL;
+    buf->var_len_pos  = 0;
+    buf->var_len_kind = 0;
+    buf->owns_data    = false;  /* Never realloc/free caller memory */
+}
+
+void buffer_release(StreamBuffer* buf) {
+    if (!buf) return;
+    
+    if (buf->owns_data) {
+        mem_free(buf->data);
+    }
+    buffer_init_external(buf, NULL, 0);
+}
+
+void buffer_init_view(StreamBuffer* buf, const u8* data, u32 length) {
+    buffer_init_external(buf, (u8*)data, length);
 }
 
 /*
@@ -165,8 +201,11 @@ void buffer_reset(StreamBuffer* buf) {
     
     buf->position     = 0;
     buf->bit_position = 0;
+    buf->bit_acc      = 0;
+    buf->bit_acc_count = 0;
     buf->var_len_pos  = 0;
     buf->var_len_kind = 0;
+    buf->profile_opcode = 0;
 }
 
 /*******************************************************************************
@@ -305,9 +344,23 @@ static inline void ensure_capacity(StreamBuffer* buf, u32 need) {
         newcap <<= 1;  /* Equivalent to newcap *= 2, but faster */
     }
     
-    /* Attempt reallocation */
-    u8* nd = (u8*)realloc(buf->data, newcap);
+    /*
+     * Attempt reallocation
+     * 
+     * Caller-owned storage (buffer_init_external) cannot be realloc'd:
+     * copy it into a fresh heap block instead and take ownership of that.
+     */
+    u8* nd;
+    if (buf->owns_data) {
+        nd = (u8*)mem_realloc(MEM_BUFFER, buf->data, newcap);
+    } else {
+        nd = (u8*)mem_alloc(MEM_BUFFER, newcap);
+        if (nd && buf->data && oldcap > 0) {
+            memcpy(nd, buf->data, oldcap);
+        }
+    }
     if (!nd) return;  /* Out of memory - fail silently (original data intact) */
+    buf->owns_data = true;
     
     /* Update buffer fields */
     buf->data = nd;
@@ -317,6 +370,11 @@ static inline void ensure_capacity(StreamBuffer* buf, u32 need) {
     memset(buf->data + oldcap, 0, newcap - oldcap);
 }
 
+bool buffer_grow(StreamBuffer* buf, u32 length) {
+    ensure_capacity(buf, length);
+    return buf->position + length <= buf->capacity;
+}
+
 /*******************************************************************************
  * BYTE-LEVEL WRITE OPERATIONS
  ******************************************************************************/
@@ -713,6 +771,17 @@ u32 buffer_read_int(StreamBuffer* buf, ByteOrder order) {
  * 
  ******************************************************************************/
 
+/*
+ * ensure_bit_capacity - Make data[] at least end bytes long (internal helper)
+ * 
+ * ensure_capacity() measures from position, which stays at the start of
+ * the bit section until buffer_finish_bit_access(); bit writes know the
+ * absolute end they need instead.
+ */
+static inline void ensure_bit_capacity(StreamBuffer* buf, u32 end) {
+    if (end > buf->position) ensure_capacity(buf, end - buf->position);
+}
+
 /*
  * buffer_start_bit_access - Enter bit-level mode
  * 
@@ -728,6 +797,8 @@ u32 buffer_read_int(StreamBuffer* buf, ByteOrder order) {
  */
 void buffer_start_bit_access(StreamBuffer* buf) {
     buf->bit_position = buf->position * 8;
+    buf->bit_acc = 0;
+    buf->bit_acc_count = 0;
 }
 
 /*
@@ -751,9 +822,27 @@ void buffer_start_bit_access(StreamBuffer* buf) {
  *   bit_position = 15 → (15+7)/8 = 2
  *   bit_position = 16 → (16+7)/8 = 2
  * 
+ * FLUSH AND PADDING:
+ *   The 0-31 bits still in the accumulator are stored as whole bytes,
+ *   left-aligned, so the unused low bits of a final partial byte are
+ *   zero. (A reused arena still holds the previous packet's bytes, so
+ *   they must be written, not left alone.)
+ * 
  * COMPLEXITY: O(1) time
  */
 void buffer_finish_bit_access(StreamBuffer* buf) {
+    u32 count = buf->bit_acc_count;
+    if (count != 0) {
+        u32 bytes = (count + 7) >> 3;
+        u32 byte_pos = (buf->bit_position - count) >> 3;
+        ensure_bit_capacity(buf, byte_pos + bytes);
+        u64 aligned = buf->bit_acc << (bytes * 8 - count);
+        for (u32 i = 0; i < bytes; i++) {
+            buf->data[byte_pos + i] = (u8)(aligned >> ((bytes - 1 - i) * 8));
+        }
+        buf->bit_acc = 0;
+        buf->bit_acc_count = 0;
+    }
     buf->position = (buf->bit_position + 7) / 8;
 }
 
@@ -817,118 +906,52 @@ static const u32 BIT_MASK[33] = {
  * @param num_bits  Number of bits to write (1-32)
  * @param value     Value to encode (only lower num_bits are used)
  * 
- * ALGORITHM:
- *   This implements bit-level writing across byte boundaries
- *   
- *   Key concepts:
- *   1. byte_pos = which byte currently writing to
- *   2. bit_offset = how many bits left in current byte
- *   3. Write MSB-first (like big-endian for bits)
- * 
- * DETAILED EXAMPLE: Write 11 bits (value=0x5A3) at bit_position=13
- * 
- * Setup:
- *   value = 0x5A3 = 0b10110100011 (11 bits)
- *   bit_position = 13
- *   byte_pos = 13 >> 3 = 1  (writing to byte 1)
- *   bit_offset = 8 - (13 & 7) = 8 - 5 = 3  (3 bits left in byte 1)
- * 
- * Initial buffer state:
- *   Byte 0: [xxxx_xxxx]
- *   Byte 1: [xxxx_x???]  ← bit_position=13 points here (3 bits left)
- *                    ↑
- *               start here
- *   Byte 2: [????_????]
- *   Byte 3: [????_????]
- * 
- * Iteration 1: Write first 3 bits
- *   num_bits (11) > bit_offset (3), so split across bytes
- *   
- *   Extract top 3 bits: value >> (11-3) = 0x5A3 >> 8 = 0b101
- *   Mask to 3 bits: 0b101 & BIT_MASK[3] = 0b101
- *   
- *   Write to byte 1 (preserve upper 5 bits):
- *     Clear lower 3 bits:  byte[1] &= ~BIT_MASK[3] = byte[1] & 0xF8
- *     Set new bits:        byte[1] |= 0b101 = 0b00000101
- *   
- *   State after iteration 1:
- *     Byte 1: [xxxx_x101]  ← wrote 3 bits
- *     Remaining: 11 - 3 = 8 bits to write
- *     byte_pos++: now byte 2
- *     bit_offset = 8  (fresh byte)
- * 
- * Iteration 2: Write remaining 8 bits
- *   num_bits (8) == bit_offset (8), special case
- *   
- *   value & BIT_MASK[8] = 0xA3 & 0xFF = 0xA3 = 0b10100011
- *   
- *   Write entire byte:
- *     byte[2] = 0b10100011
- *   
- *   Final state:
- *     Byte 1: [xxxx_x101]  ← upper 3 bits of value
- *     Byte 2: [1010_0011]  ← lower 8 bits of value
- *     bit_position: 13 + 11 = 24
+ * ALGORITHM: 64-bit accumulator, 32-bit big-endian stores
+ * 
+ *   Fields are appended to the low end of bit_acc, MSB first:
+ * 
+ *     bit_acc = (bit_acc << num_bits) | value
+ * 
+ *   Once 32 or more bits are pending, the oldest 32 form the next word of
+ *   the stream and are stored as 4 bytes, big-endian. The section starts
+ *   on a byte boundary (buffer_start_bit_access) and every store is 32
+ *   bits, so stores are always whole bytes: no read-modify-write of a
+ *   partially filled byte, no per-byte loop.
+ * 
+ *   At most 31 bits stay pending and num_bits <= 32, so the accumulator
+ *   never holds more than 63 bits.
+ * 
+ * EXAMPLE: 1-bit flag, 2-bit type, 11-bit PID (0x5A3), 23 more bits
+ * 
+ *   write 1,  0b1         acc = 1                         count = 1
+ *   write 2,  0b11        acc = 0b111                     count = 3
+ *   write 11, 0x5A3       acc = 0b111_10110100011         count = 14
+ *   write 23, ...         count = 37 → store top 32 bits  count = 5
+ *                         data: [1111_0110][1000_11..]...
  * 
- * COMPLEXITY: O(num_bits) time (at most 5 byte writes for 32 bits)
+ *   The bytes are identical to writing each bit separately; only the
+ *   number of memory operations changes (1 store per 32 bits instead of
+ *   a masked read-modify-write per byte touched per field).
+ * 
+ * COMPLEXITY: O(1) time
  */
 void buffer_write_bits(StreamBuffer* buf, u32 num_bits, u32 value) {
-    /* Calculate byte and bit positions */
-    u32 byte_pos   = buf->bit_position >> 3;        /* Divide by 8 */
-    u32 bit_offset = 8 - (buf->bit_position & 7);   /* Modulo 8, then invert */
-    
-    /* Save for debug logging */
-    u32 initial_bit_pos  = buf->bit_position;
-    u32 initial_byte_pos = byte_pos;
-    u32 orig_num_bits    = num_bits;
-    
-    /* Advance bit cursor */
+    u32 count = buf->bit_acc_count + num_bits;
+    buf->bit_acc = (buf->bit_acc << num_bits) | (value & BIT_MASK[num_bits]);
     buf->bit_position += num_bits;
     
-    /* Ensure buffer has enough bytes for final bit position */
-    ensure_capacity(buf, ((buf->bit_position + 7) >> 3) - byte_pos);
-    
-    /* Write bits, potentially across multiple bytes */
-    while (num_bits > bit_offset) {
-        /* Case 1: Value spans current byte and next byte(s) */
-        
-        /* Clear lower bit_offset bits of current byte */
-        buf->data[byte_pos] &= ~BIT_MASK[bit_offset];
-        
-        /* Extract upper bit_offset bits of value and write to current byte */
-        buf->data[byte_pos] |= (u8)((value >> (num_bits - bit_offset)) & BIT_MASK[bit_offset]);
-        
-        byte_pos++;             /* Move to next byte */
-        num_bits -= bit_offset; /* Reduce remaining bits */
-        bit_offset = 8;         /* Next byte is fresh (8 bits available) */
-    }
-    
-    if (num_bits == bit_offset) {
-        /* Case 2: Remaining bits exactly fill current byte */
-        buf->data[byte_pos] &= ~BIT_MASK[bit_offset];
-        buf->data[byte_pos] |= (u8)(value & BIT_MASK[bit_offset]);
-    } else {
-        /* Case 3: Remaining bits fit within current byte (num_bits < bit_offset) */
-        
-        /* Calculate position of bits within byte */
-        u32 shift = bit_offset - num_bits;
-        
-        /* Clear the bit range for writing */
-        buf->data[byte_pos] &= ~(BIT_MASK[num_bits] << shift);
-        
-        /* Write bits at correct position */
-        buf->data[byte_pos] |= (u8)((value & BIT_MASK[num_bits]) << shift);
-    }
-    
-    /* Debug logging for player info packets (bits 24-70 are critical) */
-    if (initial_bit_pos >= 24 && initial_bit_pos <= 70) {
-        printf("DEBUG_BITS: write %u bits (value=%u) at bitpos=%u -> bytes[%u..%u]:",
-               orig_num_bits, value, initial_bit_pos, initial_byte_pos, byte_pos);
-        for (u32 i = initial_byte_pos; i <= byte_pos && i < 12; i++) {
-            printf(" %02X", buf->data[i]);
-        }
-        printf("\n");
+    if (count >= 32) {
+        count -= 32;
+        u32 word = (u32)(buf->bit_acc >> count);
+        u32 byte_pos = (buf->bit_position - count - 32) >> 3;
+        ensure_bit_capacity(buf, byte_pos + 4);
+        buf->data[byte_pos]     = (u8)(word >> 24);
+        buf->data[byte_pos + 1] = (u8)(word >> 16);
+        buf->data[byte_pos + 2] = (u8)(word >> 8);
+        buf->data[byte_pos + 3] = (u8)word;
+        buf->bit_acc &= ((u64)1 << count) - 1;
     }
+    buf->bit_acc_count = count;
 }
 
 /*
@@ -939,53 +962,35 @@ void buffer_write_bits(StreamBuffer* buf, u32 num_bits, u32 value) {
  * @return          Extracted value
  * 
  * ALGORITHM: Inverse of buffer_write_bits
- *   Accumulate bits from bytes, shifting and ORing
+ *   A field of up to 32 bits starting anywhere in a byte spans at most
+ *   5 bytes. Load them big-endian into a 64-bit window (missing bytes
+ *   past the end of data count as 0), shift the field's first bit to the
+ *   top, then shift it down to num_bits:
  * 
- * EXAMPLE: Read 11 bits starting at bit 13
+ *   EXAMPLE: Read 11 bits starting at bit 13
  * 
- * Initial state:
- *   Byte 1: [xxxx_x101]  bit_position=13 (3 bits available)
- *   Byte 2: [1010_0011]
- *   
- * Iteration 1: Read 3 bits from byte 1
- *   value = 0
- *   value <<= 3  (shift left by bit_offset)
- *   value |= byte[1] & 0b00000111  (mask lower 3 bits)
- *   value = 0b101
- *   num_bits = 11 - 3 = 8
- * 
- * Iteration 2: Read 8 bits from byte 2
- *   value <<= 8
- *   value = 0b10100000000
- *   value |= byte[2] & 0xFF
- *   value = 0b10110100011 = 0x5A3
- * 
- * COMPLEXITY: O(num_bits) time
+ *     byte_pos = 1, skip = 5
+ *     window = [xxxx_x101][1010_0011][...][...][...] 000...
+ *     window << 24 + 5  → 10110100011... at the top
+ *     >> (64 - 11)      → 0b10110100011 = 0x5A3
+ * 
+ * Reads are only used to check what the writer produced; the client does
+ * the real decoding.
+ * 
+ * COMPLEXITY: O(1) time
  */
 u32 buffer_read_bits(StreamBuffer* buf, u32 num_bits) {
-    u32 byte_pos   = buf->bit_position >> 3;
-    u32 bit_offset = 8 - (buf->bit_position & 7);
-    u32 value = 0;
-    
+    u32 byte_pos = buf->bit_position >> 3;
+    u32 skip = buf->bit_position & 7;
     buf->bit_position += num_bits;
     
-    /* Read bits from bytes, accumulating in value */
-    while (num_bits > bit_offset) {
-        value <<= bit_offset;  /* Make room for new bits */
-        value |= buf->data[byte_pos++] & (0xFF >> (8 - bit_offset));
-        num_bits -= bit_offset;
-        bit_offset = 8;
+    u64 window = 0;
+    for (u32 i = 0; i < 5; i++) {
+        u32 at = byte_pos + i;
+        window = (window << 8) | (at < buf->capacity ? buf->data[at] : 0);
     }
-    
-    if (num_bits == bit_offset) {
-        value <<= bit_offset;
-        value |= buf->data[byte_pos] & (0xFF >> (8 - bit_offset));
-    } else {
-        value <<= num_bits;
-        value |= (buf->data[byte_pos] >> (bit_offset - num_bits)) & (0xFF >> (8 - num_bits));
-    }
-    
-    return value;
+    window <<= 24 + skip;
+    return (u32)(window >> (64 - num_bits));
 }
 
 /*******************************************************************************
@@ -1025,6 +1030,8 @@ u32 buffer_read_bits(StreamBuffer* buf, u32 num_bits) {
  */
 void buffer_write_header(StreamBuffer* buf, u8 opcode, ISAACCipher* cipher) {
     u8 original_opcode = opcode;
+    metrics_add(&g_metrics.packets_out[opcode], 1);
+    if (g_packet_profile.enabled) packet_profile_out_begin(buf, opcode);
     
     /* Encrypt opcode if cipher is active */
     if (cipher && cipher->initialized) {
@@ -1033,8 +1040,8 @@ void buffer_write_header(StreamBuffer* buf, u8 opcode, ISAACCipher* cipher) {
         
         /* Debug logging for important packets */
         if (original_opcode == 237 || original_opcode == 184) {
-            printf("DEBUG: Encrypted opcode %u -> %u (ISAAC key=%u)\n", 
-                   original_opcode, opcode, key & 0xFF);
+            LOG_TRACE(LOG_PACKET, "Encrypted opcode %u -> %u (ISAAC key=%u)\n", 
+                      original_opcode, opcode, key & 0xFF);
         }
     }
     
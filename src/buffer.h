@@ -55,19 +55,25 @@
 #include <string.h>
 #include "types.h"
 #include "isaac.h"
+#include "log.h"
 
 /*******************************************************************************
  * STREAMBUFFER - Dynamic Byte Array with Bit-Level Access
  *******************************************************************************
  * 
  * FIELDS:
- *   data:         Pointer to heap-allocated byte array (dynamically resized)
+ *   data:         Byte array: heap (buffer_create), caller storage
+ *                 (buffer_init_external, BUFFER_ON_STACK) or someone
+ *                 else's bytes (buffer_init_view); owns_data tells which
  *   capacity:     Total allocated size in bytes
  *   position:     Current read/write cursor (byte offset)
  *   bit_position: Current bit offset (position * 8 + bit offset within byte)
+ *   bit_acc:      Accumulator holding the newest bits of a bit section until
+ *                 a whole 32-bit word can be stored (see buffer_write_bits)
  *   cipher:       Optional ISAAC cipher for encryption/decryption
  *   var_len_pos:  Position of length byte(s) for variable-length packets
  *   var_len_kind: Type of variable header (VAR_BYTE=1 byte, VAR_SHORT=2 bytes)
+ *   profile_*:    Packet being written, for the packet profiler
  * 
  * INVARIANTS:
  *   - 0 <= position <= capacity
@@ -85,12 +91,20 @@ typedef struct StreamBuffer {
     u32  capacity;        /* Total bytes allocated */
     u32  position;        /* Current read/write offset (bytes) */
     u32  bit_position;    /* Current bit offset (for bit packing) */
+    u64  bit_acc;         /* Bits written but not yet stored (bit mode) */
+    u32  bit_acc_count;   /* Number of valid low bits in bit_acc (0-31) */
     
     ISAACCipher* cipher;  /* Optional stream cipher for encryption */
     
     /* Variable-length packet bookkeeping */
     u32           var_len_pos;   /* Byte offset of length field */
     VarHeaderType var_len_kind;  /* VAR_BYTE (1) or VAR_SHORT (2), 0=none */
+    
+    bool owns_data;       /* data is heap memory this buffer may realloc/free */
+    
+    /* Open server packet while profiling (see packet_profile.h) */
+    u16  profile_opcode;  /* Opcode + 1, 0 = none */
+    u32  profile_start;   /* Byte offset of its header */
 } StreamBuffer;
 
 /*******************************************************************************
@@ -137,6 +151,81 @@ void buffer_destroy(StreamBuffer* buf);
  */
 void buffer_reset(StreamBuffer* buf);
 
+/*
+ * buffer_init_external - Wrap caller-owned memory as a StreamBuffer
+ * 
+ * @param buf       Buffer struct to initialize (stack, embedded in Player, ...)
+ * @param storage   Backing bytes (not copied, not freed by the buffer)
+ * @param capacity  Size of storage in bytes
+ * 
+ * USE CASES:
+ *   - Reusable arenas: PlayerConnection.out_stream over out_buffer
+ *   - Zero-copy reads use buffer_init_view() (const source)
+ *   - Scratch buffers on the stack (no malloc for small encodes)
+ * 
+ * GROWTH:
+ *   If a write needs more than capacity, the contents spill into a new
+ *   heap block (owns_data becomes true) and growth continues as usual.
+ *   The original storage is never written past its end or freed.
+ * 
+ * COMPLEXITY: O(1) time, no allocation
+ */
+void buffer_init_external(StreamBuffer* buf, u8* storage, u32 capacity);
+
+/*
+ * buffer_release - Free heap memory of a buffer whose struct is not heap
+ * 
+ * @param buf  Buffer initialized with buffer_init_external()
+ * 
+ * Frees data only if it spilled to the heap (owns_data), then leaves the
+ * buffer empty with no storage. Counterpart of buffer_destroy() for
+ * structs that live on the stack or inside another struct.
+ * 
+ * COMPLEXITY: O(1) time
+ */
+void buffer_release(StreamBuffer* buf);
+
+/*
+ * buffer_init_view - Read-only view over bytes owned by someone else
+ * 
+ * @param buf     Buffer struct to initialize (usually on the stack)
+ * @param data    Bytes to read (not copied, not freed, never written)
+ * @param length  Readable bytes; capacity and buffer_get_remaining() end here
+ * 
+ * For inbound payloads in in_buffer[], queued packet records, replay logs:
+ * the handler reads the bytes where they already are, instead of
+ * buffer_create() + buffer_write_bytes() + buffer_set_position(0):
+ * 
+ *   copy:  [in_buffer: ..payload..] ──memcpy──> [malloc'd buffer] → handler
+ *   view:  [in_buffer: ..payload..] ←── data ── StreamBuffer (stack) → handler
+ * 
+ * A view is for reading: the const is cast away once, here, so writing
+ * through it would modify the original bytes.
+ * 
+ * COMPLEXITY: O(1) time, no allocation, no release needed
+ */
+void buffer_init_view(StreamBuffer* buf, const u8* data, u32 length);
+
+/*
+ * BUFFER_ON_STACK - Declare a StreamBuffer backed by a local array
+ * 
+ * @param name  Variable name (name_storage holds the bytes)
+ * @param size  Stack bytes; writes beyond spill to the heap as usual
+ * 
+ *   BUFFER_ON_STACK(tmp, 128);           u8 tmp_storage[128];
+ *                                   ≡    StreamBuffer tmp;
+ *                                        buffer_init_external(&tmp, tmp_storage, 128);
+ *   buffer_write_byte(&tmp, 42);
+ *   buffer_release(&tmp);                Frees only if it spilled
+ * 
+ * For scratch encodes with a known typical size: no malloc/free per use,
+ * and still correct (just slower) when an encode outgrows the array.
+ */
+#define BUFFER_ON_STACK(name, size)                                    \
+    u8 name##_storage[size];                                           \
+    StreamBuffer name;                                                 \
+    buffer_init_external(&name, name##_storage, (u32)sizeof(name##_storage))
+
 /*******************************************************************************
  * CURSOR MANAGEMENT
  ******************************************************************************/
@@ -321,6 +410,132 @@ u16 buffer_read_short(StreamBuffer* buf, bool is_signed, ByteOrder order);
  */
 u32 buffer_read_int(StreamBuffer* buf, ByteOrder order);
 
+/*******************************************************************************
+ * VALIDATED PAYLOAD READS
+ * 
+ * A client packet has a known layout: IF_BUTTON is [component:2], a walk
+ * is [ctrl:1][x:2][z:2] then 2 bytes per step. Instead of trusting every
+ * read, a handler checks ONCE that the payload covers its layout, then
+ * decodes with the inline readers below, which do no checks at all:
+ * 
+ *   if (!buffer_require(buf, 5)) return;     One check: 5 bytes are there
+ *   u8  ctrl = buffer_get_u8(buf);           \
+ *   u16 x    = buffer_get_u16(buf);           > Inlined loads, no calls,
+ *   u16 z    = buffer_get_u16(buf);          /  no byte-order switch
+ * 
+ *   payload view:  [ctrl][x hi][x lo][z hi][z lo][dx][dz]...
+ *                   ↑ position                      capacity = length ↑
+ *                   buffer_require(buf, n): capacity - position >= n
+ * 
+ * A payload shorter than its layout is rejected up front (the framer
+ * only guarantees fixed lengths from PacketLengths[]; VAR_BYTE packets
+ * can be any size), so no handler ever reads past its view.
+ * 
+ * All multi-byte values are big-endian, the protocol's default.
+ ******************************************************************************/
+
+/*
+ * buffer_require - Check that a layout of length bytes is there to read
+ * 
+ * @param buf     Buffer (usually a buffer_init_view() payload)
+ * @param length  Bytes the caller is about to read with buffer_get_*()
+ * @return        true if position + length <= capacity
+ */
+static inline bool buffer_require(const StreamBuffer* buf, u32 length) {
+    return buf->position <= buf->capacity && buf->capacity - buf->position >= length;
+}
+
+/* Unchecked reads: only after buffer_require() covered them */
+static inline u8 buffer_get_u8(StreamBuffer* buf) {
+    return buf->data[buf->position++];
+}
+
+static inline i8 buffer_get_i8(StreamBuffer* buf) {
+    return (i8)buf->data[buf->position++];
+}
+
+static inline u16 buffer_get_u16(StreamBuffer* buf) {
+    const u8* p = buf->data + buf->position;
+    buf->position += 2;
+    return (u16)((p[0] << 8) | p[1]);
+}
+
+static inline u32 buffer_get_u32(StreamBuffer* buf) {
+    const u8* p = buf->data + buf->position;
+    buf->position += 4;
+    return ((u32)p[0] << 24) | ((u32)p[1] << 16) | ((u32)p[2] << 8) | p[3];
+}
+
+static inline u64 buffer_get_u64(StreamBuffer* buf) {
+    u64 high = buffer_get_u32(buf);
+    return high << 32 | buffer_get_u32(buf);
+}
+
+static inline void buffer_get_bytes(StreamBuffer* buf, u8* out, u32 length) {
+    memcpy(out, buf->data + buf->position, length);
+    buf->position += length;
+}
+
+/*******************************************************************************
+ * RESERVED PAYLOAD WRITES
+ *
+ * The mirror image of the reads above, for fixed-size server packets:
+ * make room for the whole packet once, then store without checks.
+ *
+ *   if (!buffer_reserve(out, 1 + 3)) return;  One capacity check
+ *   buffer_write_header(out, 167, cipher);    Opcode (its own check hits)
+ *   buffer_put_u16(out, 3213);                \ Inlined stores, no calls,
+ *   buffer_put_u8(out, 3);                    / no byte-order switch
+ *
+ * buffer_write_short/int() are each a call, a capacity check and an
+ * order switch; a 6-byte UPDATE_STAT made four of them.
+ ******************************************************************************/
+
+/*
+ * buffer_grow - Out-of-line slow path of buffer_reserve()
+ *
+ * @return  false if the buffer could not grow (out of memory)
+ */
+bool buffer_grow(StreamBuffer* buf, u32 length);
+
+/*
+ * buffer_reserve - Make room for length more bytes
+ *
+ * @param buf     Buffer to write to
+ * @param length  Bytes the caller is about to write with buffer_put_*()
+ * @return        true if position + length <= capacity afterwards
+ */
+static inline bool buffer_reserve(StreamBuffer* buf, u32 length) {
+    if (buf->position <= buf->capacity && buf->capacity - buf->position >= length) return true;
+    return buffer_grow(buf, length);
+}
+
+/* Unchecked writes: only after buffer_reserve() covered them */
+static inline void buffer_put_u8(StreamBuffer* buf, u8 value) {
+    buf->data[buf->position++] = value;
+}
+
+static inline void buffer_put_u16(StreamBuffer* buf, u16 value) {
+    u8* p = buf->data + buf->position;
+    p[0] = (u8)(value >> 8);
+    p[1] = (u8)value;
+    buf->position += 2;
+}
+
+static inline void buffer_put_u32(StreamBuffer* buf, u32 value) {
+    u8* p = buf->data + buf->position;
+    p[0] = (u8)(value >> 24);
+    p[1] = (u8)(value >> 16);
+    p[2] = (u8)(value >> 8);
+    p[3] = (u8)value;
+    buf->position += 4;
+}
+
+static inline void buffer_put_u64(StreamBuffer* buf, u64 value) {
+    buffer_put_u32(buf, (u32)(value >> 32));
+    buffer_put_u32(buf, (u32)value);
+}
+
 /*******************************************************************************
  * BIT-LEVEL ACCESS
  * 
@@ -338,6 +553,12 @@ u32 buffer_read_int(StreamBuffer* buf, ByteOrder order);
  *   2. buffer_write_bits(buf, 3, 5)   - Write 3 bits with value 5
  *   3. buffer_write_bits(buf, 11, 42) - Write 11 bits with value 42
  *   4. buffer_finish_bit_access(buf)  - Return to byte mode (rounds up position)
+ * 
+ * ACCUMULATOR:
+ *   Writes go into a 64-bit accumulator (bit_acc) and reach data[] a whole
+ *   big-endian 32-bit word at a time, so data[] is only complete after
+ *   buffer_finish_bit_access(). Do not read the bytes of an unfinished
+ *   bit section, and do not mix byte writes into one.
  ******************************************************************************/
 
 /*
@@ -377,18 +598,41 @@ void buffer_finish_bit_access(StreamBuffer* buf);
  *   └────────┴────────┴────────┘
  *   Write proceeds left-to-right, MSB first
  * 
- * COMPLEXITY: O(num_bits) time
+ * COMPLEXITY: O(1) time - a shift and an OR, plus one 4-byte store every
+ *             32 bits
  */
 void buffer_write_bits(StreamBuffer* buf, u32 num_bits, u32 value);
 
+/*
+ * bits_pack - Append a low field to an already packed high field
+ * 
+ * @param high      Fields written so far (MSB first)
+ * @param low_bits  Width of the next field
+ * @param low       Next field (lower low_bits used)
+ * @return          (high << low_bits) | low
+ * 
+ * Lets a caller write several small fields in one buffer_write_bits()
+ * call, e.g. a walk update [1][type:2][dir:3][update:1] as 7 bits:
+ * 
+ *   u32 walk = bits_pack(bits_pack(bits_pack(1, 2, 1), 3, dir), 1, update);
+ *   buffer_write_bits(out, 7, walk);
+ * 
+ * The output is identical to four separate writes. Keep the total at
+ * 32 bits or fewer.
+ */
+static inline u32 bits_pack(u32 high, u32 low_bits, u32 low) {
+    return (high << low_bits) | (low & ((1u << low_bits) - 1));
+}
+
 /*
  * buffer_read_bits - Read N-bit integer
  * 
  * @param buf       Buffer to read from
  * @param num_bits  Number of bits to read (1-32)
- * @return          Value extracted from bit stream
+ * @return          Value extracted from bit stream (bits past the end of
+ *                  data read as 0)
  * 
- * COMPLEXITY: O(num_bits) time
+ * COMPLEXITY: O(1) time - one 5-byte window load and two shifts
  */
 u32 buffer_read_bits(StreamBuffer* buf, u32 num_bits);
 
@@ -481,14 +725,14 @@ void buffer_finish_var_header(StreamBuffer* buf, VarHeaderType type);
  * @param payload_len  Size of payload in bytes
  * @param isaac_on     1 if ISAAC encryption enabled, 0 otherwise
  * 
- * OUTPUT FORMAT:
+ * OUTPUT FORMAT (--log=packet):
  *   [SEND] PLAYER_INFO op=184 hdr=varshort len=42 isaac=on
  * 
  * COMPLEXITY: O(1) time
  */
 static inline void dbg_log_send(const char* tag, int opcode, const char* hdr, int payload_len, int isaac_on) {
-    printf("[SEND] %s op=%d hdr=%s len=%d isaac=%s\n",
-           tag, opcode, hdr, payload_len, isaac_on ? "on" : "off");
+    LOG_TRACE(LOG_PACKET, "[SEND] %s op=%d hdr=%s len=%d isaac=%s\n",
+              tag, opcode, hdr, payload_len, isaac_on ? "on" : "off");
 }
 
 #endif /* BUFFER_H */
@@ -14,28 +14,14 @@
  *      - Memory-resident for low-latency retrieval
  *
  *   2. ENTRY MANAGEMENT:
- *      - Metadata tracking for each file in archives
- *      - Name-based lookup system
+ *      - Entry table parsed from each archive (jagfile format)
+ *      - Name-hash index for O(1) lookup by file name
  *      - Compression information storage
  *
- *   3. FUTURE ENHANCEMENTS:
- *      - Index file parsing (currently TODO)
- *      - Data decompression (currently TODO)
- *      - Hash table for O(1) lookup (currently O(n))
- *
- * IMPLEMENTATION STATUS:
- *
- *   IMPLEMENTED:
- *     - Cache system creation/destruction
- *     - Archive file loading
- *     - Basic retrieval (returns entire archive)
- *     - Memory management
- *
- *   TODO:
- *     - Parse .idx files to extract entry metadata
- *     - Implement file lookup by name
- *     - Add decompression support
- *     - Optimize lookup with hash table
+ *   3. DECOMPRESSION:
+ *      - Whole-compressed archives: decompressed once at load
+ *      - Per-entry compressed archives: decompressed on first request
+ *        and memoized, optionally bounded with LRU eviction
  *
  * MEMORY ARCHITECTURE:
  *
@@ -51,10 +37,10 @@
  *     - Contains entry arrays
  *     - Approximately 100 KB total
  *
- *   Tier 3: Archive data (heap)
+ *   Tier 3: Archive data (read-only file mapping)
  *     - Actual game asset data
- *     - Largest memory consumer
- *     - 50-200 MB typical
+ *     - Largest consumer of address space
+ *     - Backed by the OS page cache, shared across server processes
  *
  * ARCHIVE NAME MAPPING:
  *
@@ -75,6 +61,14 @@
  */
 
 #include "cache.h"
+#include "mapped_file.h"
+#include "thirdparty/bzip.h"
+#include "mem_stats.h"
+#include <ctype.h>
+#ifndef _WIN32
+#include <pthread.h>
+#include <unistd.h>
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -123,6 +117,8 @@ static const char* archive_names[CACHE_ARCHIVE_COUNT] = {
     "wordenc"
 };
 
+static void cache_release_archive(Archive* archive);
+
 /*
  *******************************************************************************
  * CACHE SYSTEM LIFECYCLE FUNCTIONS
@@ -162,7 +158,7 @@ static const char* archive_names[CACHE_ARCHIVE_COUNT] = {
  *   Pointer to new CacheSystem or NULL on failure
  */
 CacheSystem* cache_create() {
-    CacheSystem* cache = calloc(1, sizeof(CacheSystem));
+    CacheSystem* cache = mem_calloc(MEM_CACHE, 1, sizeof(CacheSystem));
     if (!cache) return NULL;
     
     cache->initialized = false;
@@ -176,11 +172,11 @@ CacheSystem* cache_create() {
  *
  * CLEANUP PROCESS:
  *
- *   For each archive:
- *     1. Check if entries array exists (non-NULL)
- *     2. If yes, free entries array
- *     3. Check if data buffer exists (non-NULL)
- *     4. If yes, free data buffer
+ *   For each archive (cache_release_archive):
+ *     1. Free every memoized decompressed entry
+ *     2. Free entries array and name-hash index
+ *     3. Free the whole-archive decompression buffer, if any
+ *     4. Unmap the data view
  *
  *   Finally:
  *     5. Free CacheSystem structure itself
@@ -188,8 +184,10 @@ CacheSystem* cache_create() {
  * MEMORY FREED:
  *
  *   Per archive:
- *     - entries array: entry_count * 76 bytes
- *     - data buffer: data_size bytes (could be MB)
+ *     - entries array: entry_count * sizeof(CacheEntry) bytes
+ *     - index: 4 bytes per slot (2-4 slots per entry)
+ *     - memos: uncompressed size of every file ever requested
+ *     - data view: data_size bytes of address space (could be MB)
  *
  *   Total:
  *     - Archive entries: approximately 100 KB
@@ -208,16 +206,10 @@ void cache_destroy(CacheSystem* cache) {
     if (!cache) return;
     
     for (i32 i = 0; i < CACHE_ARCHIVE_COUNT; i++) {
-        Archive* archive = &cache->archives[i];
-        if (archive->entries) {
-            free(archive->entries);
-        }
-        if (archive->data) {
-            free(archive->data);
-        }
+        cache_release_archive(&cache->archives[i]);
     }
     
-    free(cache);
+    mem_free(cache);
 }
 
 /*
@@ -229,19 +221,19 @@ void cache_destroy(CacheSystem* cache) {
 /*
  * FUNCTION: cache_init
  *
- * Initializes the cache system by loading all archives from disk.
+ * Initializes the cache system. Archives are NOT opened here: each one
+ * is opened on first access (cache_get_file) or by cache_warm().
  *
  * INITIALIZATION PROCESS:
  *
  *   For each archive type (0 to CACHE_ARCHIVE_COUNT-1):
  *     1. Get archive name from archive_names array
  *     2. Construct full path: "{data_path}/archives/{name}"
- *     3. Call cache_load_archive() to load files
- *     4. Log result (success or failure)
+ *     3. Record it; state = ARCHIVE_UNLOADED
  *
  *   After all archives:
- *     5. Set initialized flag to true
- *     6. Return success
+ *     4. Set initialized flag to true
+ *     5. Return success
  *
  * PATH CONSTRUCTION:
  *
@@ -255,22 +247,14 @@ void cache_destroy(CacheSystem* cache) {
  *
  *   If cache is NULL: return false immediately
  *   If cache already initialized: return false (prevent double-init)
- *   If individual archive fails: log warning but continue
+ *   Missing or malformed archives are reported when they are opened;
+ *   the archive is then marked ARCHIVE_FAILED and never retried
  *     - Non-critical archives can fail without stopping server
  *     - Server may run with partial cache for testing
  *
  * PERFORMANCE:
  *
- *   Time complexity: O(total file size)
- *   Typical time: 100-500 milliseconds for 100 MB
- *   I/O bound: limited by disk read speed
- *
- *   Breakdown per archive:
- *     - fopen: ~1-10 ms (depends on OS cache)
- *     - fseek/ftell: ~1 ms
- *     - malloc: ~1 ms
- *     - fread: ~10-100 ms (depends on file size)
- *     - fclose: ~1 ms
+ *   Time complexity: O(archives), no I/O at all
  *
  * PARAMETERS:
  *   cache     - Cache system to initialize
@@ -285,15 +269,10 @@ bool cache_init(CacheSystem* cache, const char* data_path) {
     printf("Initializing cache system from %s...\n", data_path);
     
     for (i32 i = 0; i < CACHE_ARCHIVE_COUNT; i++) {
-        char archive_path[512];
-        snprintf(archive_path, sizeof(archive_path), "%s/archives/%s", 
+        Archive* archive = &cache->archives[i];
+        snprintf(archive->path, sizeof(archive->path), "%s/archives/%s", 
                  data_path, archive_names[i]);
-        
-        if (cache_load_archive(&cache->archives[i], archive_path)) {
-            printf("Loaded archive: %s\n", archive_names[i]);
-        } else {
-            printf("Warning: Failed to load archive: %s\n", archive_names[i]);
-        }
+        archive->state = ARCHIVE_UNLOADED;
     }
     
     cache->initialized = true;
@@ -303,308 +282,544 @@ bool cache_init(CacheSystem* cache, const char* data_path) {
 /*
  * FUNCTION: cache_load_archive
  *
- * Loads a single archive file into memory.
+ * Maps a single archive file and builds its entry index.
+ *
+ * ARCHIVE FORMAT (jagfile, the format the client reads):
+ *
+ *   +----------------+----------------+-----------------------------+
+ *   | unpacked (u24) | packed (u24)   | body (packed bytes)         |
+ *   +----------------+----------------+-----------------------------+
  *
- * CURRENT IMPLEMENTATION:
+ *   packed != unpacked:  body is ONE bzip2 stream; the decompressed
+ *                        body holds the table and raw entry bytes
+ *   packed == unpacked:  body is stored as is; every entry is its own
+ *                        bzip2 stream
  *
- *   This is a simplified implementation that:
- *     1. Opens the archive file (treated as .dat file)
- *     2. Reads entire file into memory
- *     3. Creates single dummy entry for all data
+ *   Body:
+ *   +-------------+------------------------------------+-------------+
+ *   | count (u16) | count x [hash i32][unp u24][pk u24] | entry data  |
+ *   +-------------+------------------------------------+-------------+
  *
- *   Does NOT currently:
- *     - Parse .idx index file
- *     - Extract individual file entries
- *     - Support compression/decompression
+ *   Entry data follows the table back to back, so offsets are a running
+ *   sum of packed sizes. Names are not stored - only a hash of the name
+ *   (see cache_name_hash).
  *
  * LOADING PROCESS:
  *
- *   Step 1: Open file in binary read mode
- *     fopen(path, "rb")
- *     - "rb" = read, binary mode
- *     - Returns NULL if file doesn't exist
- *
- *   Step 2: Determine file size
- *     fseek(file, 0, SEEK_END) - seek to end
- *     ftell(file) - get position (= file size)
- *     fseek(file, 0, SEEK_SET) - seek back to start
- *
- *   Step 3: Allocate buffer
- *     malloc(file_size)
- *     - Exact size, no extra padding
- *     - Returns NULL if out of memory
- *
- *   Step 4: Read entire file
- *     fread(buffer, 1, file_size, file)
- *     - Reads file_size bytes
- *     - Returns number of bytes actually read
- *     - Should equal file_size on success
- *
- *   Step 5: Close file
- *     fclose(file)
- *     - Releases file handle
- *     - Flushes any buffers
- *
- *   Step 6: Store in Archive structure
- *     archive->data = buffer
- *     archive->data_size = file_size
+ *   Step 1: Map the file read-only
+ *     mapped_file_open(&archive->view, path)
+ *     - mmap() on POSIX, MapViewOfFile() on Windows
+ *     - Nothing is copied: the view IS the OS page cache, shared with
+ *       every other server process on the host that maps the same file
+ *     - Pages are faulted in lazily on first access
+ *     - Returns false if the file doesn't exist or is empty
+ *
+ *   Step 2: Store in Archive structure
+ *     archive->data = view.data   (read-only!)
+ *     archive->data_size = view.size
  *     archive->path = copy of path
  *
- *   Step 7: Create dummy entry (TODO: parse real entries)
- *     entry_count = 1
- *     entries[0].name = "data"
- *     entries[0].offset = 0
- *     entries[0].compressed_size = data_size
- *     entries[0].uncompressed_size = data_size
- *
- * FUTURE ENHANCEMENTS:
- *
- *   Full implementation should:
- *
- *     1. Open .idx file (index)
- *     2. Read entry count
- *     3. For each entry:
- *        a. Read name length
- *        b. Read name string
- *        c. Read data offset
- *        d. Read compressed size
- *        e. Read uncompressed size (if present)
- *     4. Allocate entries array
- *     5. Populate entry structures
- *     6. Open .dat file (data)
- *     7. Read into data buffer
- *
- *   Index file format:
- *     u32: entry_count
- *     For each entry:
- *       u16: name_length
- *       u8[name_length]: name
- *       u32: offset
- *       u32: compressed_size
- *       u32: uncompressed_size
+ *   Step 3: Parse the entry table (cache_parse_entries)
+ *     - Whole-compressed archives are decompressed once into
+ *       archive->unpacked (the only private copy ever made)
+ *     - Every offset and size is bounds-checked against the body
+ *
+ *   Step 4: Build the name-hash index (cache_build_index)
  *
  * ERROR HANDLING:
  *
- *   File doesn't exist:
- *     - fopen returns NULL
+ *   File doesn't exist, is empty or not a regular file:
+ *     - mapped_file_open returns false
  *     - Function returns false
  *
- *   File is empty or invalid:
- *     - ftell returns <= 0
- *     - Close file and return false
- *
- *   Out of memory:
- *     - malloc returns NULL
- *     - Close file and return false
+ *   Mapping fails (e.g. filesystem without mmap support):
+ *     - mapped_file_open falls back to reading into a heap buffer
+ *     - Function still succeeds
  *
- *   Read fails:
- *     - fread returns < file_size
- *     - Free allocated buffer
- *     - Close file and return false
+ *   Truncated or inconsistent table, or out of memory:
+ *     - Everything allocated so far is released
+ *     - Function returns false
  *
  * PARAMETERS:
  *   archive - Archive structure to populate
- *   path    - Path to archive file (without extension)
+ *   path    - Path to archive file
  *
  * RETURNS:
  *   true on success, false on any error
  */
-bool cache_load_archive(Archive* archive, const char* path) {
-    if (!archive || !path) return false;
-    
-    FILE* file = fopen(path, "rb");
-    if (!file) {
-        return false;
+static inline u32 read_u16_be(const u8* p) {
+    return ((u32)p[0] << 8) | p[1];
+}
+
+static inline u32 read_u24_be(const u8* p) {
+    return ((u32)p[0] << 16) | ((u32)p[1] << 8) | p[2];
+}
+
+static inline u32 read_u32_be(const u8* p) {
+    return ((u32)p[0] << 24) | ((u32)p[1] << 16) | ((u32)p[2] << 8) | p[3];
+}
+
+/*
+ * cache_name_hash - Hash a file name the way the client does
+ *
+ *   hash = hash * 61 + toupper(c) - 32   (32-bit wrap-around)
+ *
+ * Computed in u32 so the wrap-around is well defined; the bits are the
+ * same as the client's signed int.
+ */
+static u32 cache_name_hash(const char* name) {
+    u32 hash = 0;
+    for (; *name; name++) {
+        hash = hash * 61 + (u32)toupper((unsigned char)*name) - 32;
+    }
+    return hash;
+}
+
+/*
+ * cache_index_slot - First probe position for a name hash
+ *
+ * Name hashes of similar names differ mostly in their low bits, so they
+ * are mixed (Fibonacci hashing) before masking.
+ */
+static inline u32 cache_index_slot(u32 hash, u32 mask) {
+    return (hash * 2654435761u) & mask;
+}
+
+static bool cache_parse_entries(Archive* archive) {
+    if (archive->data_size < 6) return false;
+
+    u32 unpacked = read_u24_be(archive->data);
+    u32 packed = read_u24_be(archive->data + 3);
+    u32 pos;
+
+    if (packed != unpacked) {
+        if (packed > archive->data_size - 6 || unpacked == 0) return false;
+        archive->unpacked = mem_alloc(MEM_CACHE, unpacked);
+        if (!archive->unpacked) return false;
+        if (bzip_decompress_into(archive->unpacked, (int)unpacked,
+                                 archive->data + 6, (int)packed) != (int)unpacked) {
+            fprintf(stderr, "ERROR: Corrupt archive body in %s\n", archive->path);
+            return false;
+        }
+        archive->whole_compressed = true;
+        archive->content = archive->unpacked;
+        archive->content_size = unpacked;
+        pos = 0;
+    } else {
+        archive->whole_compressed = false;
+        archive->content = archive->data;
+        archive->content_size = archive->data_size;
+        pos = 6;
+    }
+
+    if (pos + 2 > archive->content_size) return false;
+    u32 count = read_u16_be(archive->content + pos);
+    pos += 2;
+    if (pos + count * 10 > archive->content_size) return false;
+
+    archive->entries = mem_calloc(MEM_CACHE, count ? count : 1, sizeof(CacheEntry));
+    if (!archive->entries) return false;
+    archive->entry_count = count;
+
+    u32 offset = pos + count * 10;
+    for (u32 i = 0; i < count; i++, pos += 10) {
+        CacheEntry* entry = &archive->entries[i];
+        entry->name_hash = read_u32_be(archive->content + pos);
+        entry->uncompressed_size = read_u24_be(archive->content + pos + 4);
+        entry->compressed_size = read_u24_be(archive->content + pos + 7);
+        entry->offset = offset;
+
+        if (entry->compressed_size > archive->content_size - offset) return false;
+        offset += entry->compressed_size;
+    }
+    return true;
+}
+
+/*
+ * cache_build_index - Open-addressing table: name hash → entry
+ *
+ *   slots = next power of two ≥ 2 x entry_count  (load factor ≤ 0.5)
+ *   index[slot] = entry number + 1, 0 = empty
+ *   collisions: linear probing
+ *
+ * A duplicate hash keeps the first entry, matching the client's linear
+ * search.
+ */
+static bool cache_build_index(Archive* archive) {
+    u32 slots = 16;
+    while (slots < archive->entry_count * 2) slots <<= 1;
+
+    archive->index = mem_calloc(MEM_CACHE, slots, sizeof(u32));
+    if (!archive->index) return false;
+    archive->index_mask = slots - 1;
+
+    for (u32 i = 0; i < archive->entry_count; i++) {
+        u32 hash = archive->entries[i].name_hash;
+        u32 slot = cache_index_slot(hash, archive->index_mask);
+        bool duplicate = false;
+        while (archive->index[slot] != 0) {
+            if (archive->entries[archive->index[slot] - 1].name_hash == hash) {
+                duplicate = true;
+                break;
+            }
+            slot = (slot + 1) & archive->index_mask;
+        }
+        if (!duplicate) archive->index[slot] = i + 1;
+    }
+    return true;
+}
+
+/*
+ * cache_release_archive - Free everything cache_load_archive() created
+ */
+static void cache_release_archive(Archive* archive) {
+    for (u32 i = 0; i < archive->entry_count; i++) {
+        mem_free(archive->entries[i].memo);
+    }
+    mem_free(archive->entries);
+    mem_free(archive->index);
+    mem_free(archive->unpacked);
+    if (archive->data) {
+        mapped_file_close(&archive->view);
     }
     
-    /* Get file size */
-    fseek(file, 0, SEEK_END);
-    long file_size = ftell(file);
-    fseek(file, 0, SEEK_SET);
+    /* Keep the path so a released archive can still be named */
+    char path[sizeof(archive->path)];
+    memcpy(path, archive->path, sizeof(path));
+    memset(archive, 0, sizeof(*archive));
+    memcpy(archive->path, path, sizeof(path));
+}
+
+bool cache_load_archive(Archive* archive, const char* path) {
+    if (!archive || !path) return false;
     
-    if (file_size <= 0) {
-        fclose(file);
-        return false;
+    /* Lazy opens pass archive->path itself */
+    if (path != archive->path) {
+        strncpy(archive->path, path, sizeof(archive->path) - 1);
     }
     
-    /* Allocate and read data */
-    archive->data = malloc(file_size);
-    if (!archive->data) {
-        fclose(file);
+    /* Map read-only; no private copy of the archive is made */
+    if (!mapped_file_open(&archive->view, archive->path)) {
+        archive->state = ARCHIVE_FAILED;
         return false;
     }
     
-    size_t bytes_read = fread(archive->data, 1, file_size, file);
-    fclose(file);
+    archive->data = archive->view.data;
+    archive->data_size = archive->view.size;
     
-    if (bytes_read != file_size) {
-        free(archive->data);
-        archive->data = NULL;
+    if (!cache_parse_entries(archive) || !cache_build_index(archive)) {
+        fprintf(stderr, "WARNING: Malformed archive %s\n", path);
+        cache_release_archive(archive);
+        archive->state = ARCHIVE_FAILED;
         return false;
     }
     
-    archive->data_size = (u32)file_size;
-    strncpy(archive->path, path, sizeof(archive->path) - 1);
-    
-    /* TODO: parse archive entries */
-    archive->entry_count = 1;
-    archive->entries = calloc(1, sizeof(CacheEntry));
-    if (archive->entries) {
-        strcpy(archive->entries[0].name, "data");
-        archive->entries[0].offset = 0;
-        archive->entries[0].compressed_size = archive->data_size;
-        archive->entries[0].uncompressed_size = archive->data_size;
-    }
-    
+    archive->state = ARCHIVE_LOADED;
     return true;
 }
 
+/*
+ * cache_open_archive - Open an archive on first use
+ *
+ *   ARCHIVE_UNLOADED ──cache_load_archive()──→ ARCHIVE_LOADED
+ *                                        └───→ ARCHIVE_FAILED (no retry)
+ *
+ * Only one thread may call this for a given archive at a time: the game
+ * thread after startup, or one warm worker per archive during it.
+ */
+static bool cache_open_archive(CacheSystem* cache, CacheArchive type) {
+    Archive* archive = &cache->archives[type];
+    if (archive->state == ARCHIVE_UNLOADED) {
+        if (cache_load_archive(archive, archive->path)) {
+            printf("Loaded archive: %s (%u files)\n", archive_names[type], archive->entry_count);
+        } else {
+            printf("Warning: Failed to load archive: %s\n", archive_names[type]);
+        }
+    }
+    return archive->state == ARCHIVE_LOADED;
+}
+
 /*
  *******************************************************************************
  * CACHE RETRIEVAL FUNCTIONS
  *******************************************************************************
  */
 
+/*
+ * cache_find_entry - O(1) lookup of a name in one archive
+ */
+static CacheEntry* cache_find_entry(Archive* archive, const char* name) {
+    if (!archive->index) return NULL;
+
+    u32 hash = cache_name_hash(name);
+    u32 slot = cache_index_slot(hash, archive->index_mask);
+    while (archive->index[slot] != 0) {
+        CacheEntry* entry = &archive->entries[archive->index[slot] - 1];
+        if (entry->name_hash == hash) return entry;
+        slot = (slot + 1) & archive->index_mask;
+    }
+    return NULL;
+}
+
+/*
+ * cache_evict_for - Drop least recently used memos until size fits
+ *
+ * Only called with a memo limit set. A linear scan is fine here: the
+ * cache holds a few hundred entries and eviction is rare (a limit is
+ * meant to be roughly the working set).
+ */
+static void cache_evict_for(CacheSystem* cache, u32 size) {
+    while (cache->memo_bytes + size > cache->memo_limit) {
+        CacheEntry* oldest = NULL;
+        for (i32 a = 0; a < CACHE_ARCHIVE_COUNT; a++) {
+            Archive* archive = &cache->archives[a];
+            for (u32 i = 0; i < archive->entry_count; i++) {
+                CacheEntry* entry = &archive->entries[i];
+                if (entry->memo && (!oldest || entry->last_used < oldest->last_used)) {
+                    oldest = entry;
+                }
+            }
+        }
+        if (!oldest) return;
+
+        mem_free(oldest->memo);
+        oldest->memo = NULL;
+        cache->memo_bytes -= oldest->uncompressed_size;
+    }
+}
+
 /*
  * FUNCTION: cache_get_file
  *
  * Retrieves a file from the cache by archive type and name.
  *
- * CURRENT IMPLEMENTATION:
- *
- *   This simplified version:
- *     1. Validates cache and archive type
- *     2. Returns pointer to entire archive data
- *     3. Ignores the name parameter (TODO)
- *
- * VALIDATION CHECKS:
- *
- *   Check 1: Cache exists and is initialized
- *     if (!cache || !cache->initialized)
- *     - Prevents use of uninitialized cache
- *     - Prevents NULL pointer dereference
- *
- *   Check 2: Archive type is valid
- *     if (type >= CACHE_ARCHIVE_COUNT)
- *     - Prevents array out-of-bounds access
- *     - Ensures valid enum value
- *
- *   Check 3: Archive has data
- *     if (archive->data && out_size)
- *     - Ensures data buffer exists
- *     - Ensures output parameter is valid
- *
- * CURRENT BEHAVIOR:
- *
- *   Returns entire archive data buffer regardless of name.
- *   This is a placeholder until full implementation.
- *
- *   Example:
- *     cache_get_file(cache, CACHE_ARCHIVE_CONFIG, "items", &size)
- *     -> Returns all config archive data, not just "items"
- *
- * FULL IMPLEMENTATION ALGORITHM:
- *
- *   Step 1: Validate parameters (same as current)
+ * ALGORITHM:
  *
- *   Step 2: Look up file name in entries array
- *     for (i = 0; i < archive->entry_count; i++):
- *       if (strcmp(archive->entries[i].name, name) == 0):
- *         found_entry = &archive->entries[i]
- *         break
+ *   1. Validate cache, archive type and arguments; open the archive
+ *      if this is its first use
+ *   2. entry = index lookup of cache_name_hash(name)     O(1)
+ *   3. Whole-compressed archive:
+ *        entry bytes are already raw inside archive->unpacked
+ *        → return a pointer into it, no copy
+ *   4. Per-entry compressed archive:
+ *        memo present → return it                       (hit)
+ *        otherwise    → bzip-decompress once into a new
+ *                       buffer, remember it in entry->memo (miss)
  *
- *   Step 3: If not found, return NULL
+ *   Repeated lookups of the same file never decompress twice:
  *
- *   Step 4: Extract compressed data
- *     compressed_data = archive->data + found_entry->offset
- *     compressed_size = found_entry->compressed_size
+ *     cache_get_file(CONFIG, "obj.dat")  → bunzip2, memo   (~ms)
+ *     cache_get_file(CONFIG, "obj.dat")  → memo            (~ns)
  *
- *   Step 5: Check if decompression needed
- *     if (compressed_size == uncompressed_size):
- *       // No compression, return direct pointer
- *       return compressed_data
- *     else:
- *       // Need decompression
- *       uncompressed = malloc(uncompressed_size)
- *       decompress(compressed_data, compressed_size,
- *                  uncompressed, uncompressed_size)
- *       // Cache decompressed data for reuse
- *       return uncompressed
+ * BOUNDED MEMOS (optional):
  *
- * OPTIMIZATION OPPORTUNITIES:
- *
- *   Current: O(n) linear search through entries
- *
- *   Option 1: Hash table lookup
- *     - O(1) average case
- *     - Requires hash table structure
- *     - Memory overhead: pointer array + chain storage
- *
- *   Option 2: Binary search
- *     - O(log n) guaranteed
- *     - Requires sorted entries array
- *     - No memory overhead
- *
- *   Option 3: Decompression cache
- *     - Keep frequently accessed files decompressed
- *     - LRU cache for memory management
- *     - Trades memory for CPU time
- *
- * DECOMPRESSION ALGORITHMS:
- *
- *   Possible compression formats:
- *     - GZIP: Common, good compression, moderate speed
- *     - BZIP2: Better compression, slower
- *     - LZMA: Best compression, slowest
- *     - Custom: Game-specific format
- *
- *   Decompression libraries:
- *     - zlib for GZIP
- *     - libbz2 for BZIP2
- *     - liblzma for LZMA
- *
- * MEMORY MANAGEMENT:
- *
- *   Current: Returns pointer into archive buffer
- *     - No allocation needed
- *     - No free needed
- *     - Pointer valid until cache destroyed
- *
- *   Future with decompression: Returns allocated buffer
- *     - Need allocation strategy
- *     - Need free strategy (who owns buffer?)
- *     - Options:
- *       a. Cache owns, free at cache_destroy
- *       b. Caller owns, must free
- *       c. Reference counted
+ *   With cache_set_memo_limit(cache, bytes) the decompressed memos of
+ *   all archives together stay under the limit; least recently used
+ *   memos are freed first. Without a limit (the default) memos live
+ *   until cache_destroy().
  *
  * PARAMETERS:
  *   cache    - Cache system to query
  *   type     - Archive type enum value
- *   name     - File name to retrieve (currently ignored)
+ *   name     - File name to retrieve, e.g. "obj.dat" (case-insensitive)
  *   out_size - Output parameter for data size
  *
  * RETURNS:
- *   Pointer to file data, or NULL if not found
+ *   Pointer to the uncompressed file, or NULL if not found
  *   Do NOT free the returned pointer (part of cache)
  */
-u8* cache_get_file(CacheSystem* cache, CacheArchive type, const char* name, u32* out_size) {
-    if (!cache || !cache->initialized || type >= CACHE_ARCHIVE_COUNT) {
+const u8* cache_get_file(CacheSystem* cache, CacheArchive type, const char* name, u32* out_size) {
+    if (!cache || !cache->initialized || type >= CACHE_ARCHIVE_COUNT || !name || !out_size) {
         return NULL;
     }
     
     Archive* archive = &cache->archives[type];
+    if (!cache_open_archive(cache, type)) return NULL;
+    
+    CacheEntry* entry = cache_find_entry(archive, name);
+    if (!entry) return NULL;
     
-    /* For now, just return the entire archive data */
-    /* TODO: Implement proper file lookup within archives */
-    if (archive->data && out_size) {
-        *out_size = archive->data_size;
-        return archive->data;
+    if (archive->whole_compressed) {
+        *out_size = entry->uncompressed_size;
+        return archive->content + entry->offset;
     }
     
+    entry->last_used = ++cache->clock;
+    if (!entry->memo) {
+        if (cache->memo_limit) cache_evict_for(cache, entry->uncompressed_size);
+        
+        u8* memo = mem_alloc(MEM_CACHE, entry->uncompressed_size ? entry->uncompressed_size : 1);
+        if (!memo) return NULL;
+        if (bzip_decompress_into(memo, (int)entry->uncompressed_size,
+                                 archive->content + entry->offset,
+                                 (int)entry->compressed_size) != (int)entry->uncompressed_size) {
+            fprintf(stderr, "ERROR: Corrupt file '%s' in %s\n", name, archive->path);
+            mem_free(memo);
+            return NULL;
+        }
+        entry->memo = memo;
+        cache->memo_bytes += entry->uncompressed_size;
+    }
+    
+    *out_size = entry->uncompressed_size;
+    return entry->memo;
+}
+
+void cache_set_memo_limit(CacheSystem* cache, u64 bytes) {
+    if (!cache) return;
+    cache->memo_limit = bytes;
+    if (bytes) cache_evict_for(cache, 0);
+}
+
+/*
+ *******************************************************************************
+ * PARALLEL WARM-UP
+ *******************************************************************************
+ *
+ * Archives are independent files and per-entry compressed files are
+ * independent bzip2 streams, so both can be decompressed concurrently:
+ *
+ *   Phase 1 - one job per archive:     map, parse, bunzip whole body
+ *   Phase 2 - one job per entry:       bunzip into entry->memo
+ *
+ *   ┌─────────┐  next = fetch_add(&warm->next, 1)  ┌──────────────────┐
+ *   │ worker 0│ ─────────────────────────────────→ │ job 0 1 2 3 4 ...│
+ *   │ worker 1│ ─────────────────────────────────→ │  (shared counter)│
+ *   │ caller  │ ─────────────────────────────────→ └──────────────────┘
+ *   └─────────┘
+ *
+ * Every job writes only its own archive (phase 1) or its own entry
+ * (phase 2), and the caller joins all workers before anything reads the
+ * results, so no locks are needed. A large archive and many small ones
+ * balance naturally because workers pull jobs until the counter runs out.
+ *
+ * Memo accounting (memo_bytes) is summed on the calling thread after
+ * phase 2, and phase 2 is skipped entirely when a memo limit is set.
+ */
+
+typedef struct CacheWarm {
+    CacheSystem* cache;
+    u32 next;                                   /* Next job (atomic) */
+    u32 job_count;
+    void (*run)(struct CacheWarm* warm, u32 job);
+} CacheWarm;
+
+static void cache_warm_archive(CacheWarm* warm, u32 job) {
+    Archive* archive = &warm->cache->archives[job];
+    if (archive->state == ARCHIVE_UNLOADED) {
+        cache_load_archive(archive, archive->path);
+    }
+}
+
+static void cache_warm_entry(CacheWarm* warm, u32 job) {
+    /* Map the flat job number onto (archive, entry) */
+    for (i32 a = 0; a < CACHE_ARCHIVE_COUNT; a++) {
+        Archive* archive = &warm->cache->archives[a];
+        u32 count = archive->state == ARCHIVE_LOADED ? archive->entry_count : 0;
+        if (job >= count) {
+            job -= count;
+            continue;
+        }
+        
+        CacheEntry* entry = &archive->entries[job];
+        if (archive->whole_compressed || entry->memo) return;
+        
+        u8* memo = mem_alloc(MEM_CACHE, entry->uncompressed_size ? entry->uncompressed_size : 1);
+        if (!memo) return;
+        if (bzip_decompress_into(memo, (int)entry->uncompressed_size,
+                                 archive->content + entry->offset,
+                                 (int)entry->compressed_size) != (int)entry->uncompressed_size) {
+            /* Left unmemoized; cache_get_file() reports the error on use */
+            mem_free(memo);
+            return;
+        }
+        entry->memo = memo;
+        return;
+    }
+}
+
+static void* cache_warm_worker(void* arg) {
+    CacheWarm* warm = arg;
+    for (;;) {
+        u32 job = __atomic_fetch_add(&warm->next, 1, __ATOMIC_RELAXED);
+        if (job >= warm->job_count) break;
+        warm->run(warm, job);
+    }
     return NULL;
 }
 
+/*
+ * cache_warm_run - Drain one phase with up to `workers` threads
+ *
+ * The calling thread is one of the workers, and the count is capped at
+ * the number of online CPUs. If a thread cannot be created, the
+ * remaining threads (at least the caller) finish the jobs.
+ */
+static void cache_warm_run(CacheWarm* warm, i32 workers) {
+    warm->next = 0;
+#ifndef _WIN32
+    /* More workers than cores only adds switching */
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus > 0 && workers > cpus) workers = (i32)cpus;
+    
+    pthread_t threads[CACHE_WARM_MAX_WORKERS];
+    i32 started = 0;
+    for (i32 i = 1; i < workers && i < CACHE_WARM_MAX_WORKERS; i++) {
+        if (pthread_create(&threads[started], NULL, cache_warm_worker, warm) != 0) break;
+        started++;
+    }
+    cache_warm_worker(warm);
+    for (i32 i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+#else
+    (void)workers;                  /* No pthreads: run on the caller */
+    cache_warm_worker(warm);
+#endif
+}
+
+u32 cache_warm(CacheSystem* cache, i32 workers) {
+    if (!cache || !cache->initialized) return 0;
+    if (workers < 1) workers = 1;
+    
+    /* Phase 1: open and index every archive */
+    CacheWarm warm = { cache, 0, CACHE_ARCHIVE_COUNT, cache_warm_archive };
+    cache_warm_run(&warm, workers);
+    
+    u32 entries = 0;
+    u32 loaded = 0;
+    for (i32 a = 0; a < CACHE_ARCHIVE_COUNT; a++) {
+        Archive* archive = &cache->archives[a];
+        if (archive->state == ARCHIVE_LOADED) {
+            printf("Loaded archive: %s (%u files)\n", archive_names[a], archive->entry_count);
+            entries += archive->entry_count;
+            loaded++;
+        } else {
+            printf("Warning: Failed to load archive: %s\n", archive_names[a]);
+        }
+    }
+    
+    /* Phase 2: decompress every file, unless memos are budgeted */
+    if (cache->memo_limit == 0) {
+        warm.job_count = entries;
+        warm.run = cache_warm_entry;
+        cache_warm_run(&warm, workers);
+        
+        cache->memo_bytes = 0;
+        for (i32 a = 0; a < CACHE_ARCHIVE_COUNT; a++) {
+            Archive* archive = &cache->archives[a];
+            u32 count = archive->state == ARCHIVE_LOADED ? archive->entry_count : 0;
+            for (u32 i = 0; i < count; i++) {
+                if (archive->entries[i].memo) {
+                    cache->memo_bytes += archive->entries[i].uncompressed_size;
+                }
+            }
+        }
+    }
+    
+    return loaded;
+}
+
 /*
  *******************************************************************************
  * EDUCATIONAL NOTES: CACHE DESIGN PATTERNS
@@ -685,27 +900,22 @@ u8* cache_get_file(CacheSystem* cache, CacheArchive type, const char* name, u32*
  *
  * FUTURE OPTIMIZATION IDEAS:
  *
- *   1. Memory-mapped files:
- *      - Use mmap() on Unix, MapViewOfFile() on Windows
- *      - Let OS handle paging
- *      - Reduce memory footprint
- *
- *   2. Compressed archive format:
+ *   1. Compressed archive format:
  *      - Store entire archive compressed
  *      - Decompress individual files on access
  *      - Cache decompressed files in LRU cache
  *
- *   3. Async loading:
+ *   2. Async loading:
  *      - Load archives in background thread
  *      - Allow server to start with partial cache
  *      - Load remaining archives during idle time
  *
- *   4. Hot-reload:
+ *   3. Hot-reload:
  *      - Watch archive files for changes
  *      - Reload modified archives at runtime
  *      - Useful for development/testing
  *
- *   5. Client-side caching:
+ *   4. Client-side caching:
  *      - Send cache files to client
  *      - Client caches locally
  *      - Use CRC to validate cache
@@ -12,7 +12,7 @@
  *
  *   1. ARCHIVE SYSTEM:
  *      - Multiple archives, each containing related data
- *      - Archives use .dat (data) and .idx (index) file pairs
+ *      - Each archive is one file: entry table + file data
  *      - Random access to individual files within archives
  *      - Compression support for reduced disk/network usage
  *
@@ -27,55 +27,52 @@
  *      - Wordenc: Text filtering/encoding data
  *
  *   3. FILE STRUCTURE:
- *      Each archive consists of two files:
- *        - .dat file: Actual compressed data
- *        - .idx file: Index mapping names to offsets
+ *      Each archive file holds:
+ *        - An entry table mapping name hashes to offsets and sizes
+ *        - The (bzip2-compressed) file data
  *
  *   4. DATA ACCESS PATTERN:
- *      1. Read index to find file offset
- *      2. Seek to offset in data file
- *      3. Read compressed size
- *      4. Read compressed data
- *      5. Decompress if necessary
- *      6. Return uncompressed data to caller
+ *      1. Hash the name, look it up in the archive's index
+ *      2. Go to the entry's offset in the mapped archive
+ *      3. Decompress on first access, remember the result
+ *      4. Return uncompressed data to caller
  *
- * ARCHIVE FILE FORMAT:
+ * ARCHIVE FILE FORMAT (jagfile):
  *
- *   INDEX FILE (.idx):
- *   +-------------+-------------+-------------+
- *   | Entry Count | Entry 1     | Entry 2     | ...
- *   | (4 bytes)   | (variable)  | (variable)  |
- *   +-------------+-------------+-------------+
+ *   Each archive is a single file:
+ *   +----------------+----------------+-----------------------------+
+ *   | unpacked (u24) | packed (u24)   | body (packed bytes)         |
+ *   +----------------+----------------+-----------------------------+
  *
- *   Each Index Entry:
- *   +-------------+-------------+-------------+-------------+
- *   | Name Length | Name String | Data Offset | Comp. Size  |
- *   | (2 bytes)   | (N bytes)   | (4 bytes)   | (4 bytes)   |
- *   +-------------+-------------+-------------+-------------+
+ *   packed != unpacked: the body is one bzip2 stream (whole-compressed)
+ *   packed == unpacked: the body is stored, each entry is bzip2'd alone
  *
- *   DATA FILE (.dat):
- *   +-------------+-------------+-------------+
- *   | File 1 Data | File 2 Data | File 3 Data | ...
- *   | (variable)  | (variable)  | (variable)  |
- *   +-------------+-------------+-------------+
+ *   Body:
+ *   +-------------+-------------+-------------+-----+-------------+
+ *   | File Count  | Entry 1     | Entry 2     | ... | File Data   |
+ *   | (2 bytes)   | (10 bytes)  | (10 bytes)  |     | (packed)    |
+ *   +-------------+-------------+-------------+-----+-------------+
  *
- *   Each Data Block (at offset from index):
+ *   Each Table Entry:
  *   +-------------+-------------+-------------+
- *   | Uncomp Size | Comp Data   | (padding)   |
- *   | (4 bytes)   | (N bytes)   | (0-3 bytes) |
+ *   | Name Hash   | Unpacked    | Packed      |
+ *   | (4 bytes)   | (3 bytes)   | (3 bytes)   |
  *   +-------------+-------------+-------------+
  *
+ *   File data is stored back to back in table order, so each file's
+ *   offset is the running sum of the packed sizes before it.
+ *
  * CACHE ENTRY STRUCTURE:
  *
  *   Each file within an archive has metadata:
- *     - Name: Identifier string (e.g., "item_definitions")
- *     - Offset: Position in .dat file
+ *     - Name hash: client hash of the name (e.g., of "obj.dat")
+ *     - Offset: Position in the archive body
  *     - Compressed size: Size of compressed data
  *     - Uncompressed size: Size after decompression
  *
  *   Example entry:
- *     Name: "config_item"
- *     Offset: 1024 (starts at byte 1024 in .dat file)
+ *     Name: "obj.dat" (stored as its hash)
+ *     Offset: 1024 (starts at byte 1024 in the body)
  *     Compressed: 500 bytes
  *     Uncompressed: 2000 bytes
  *     Compression ratio: 4:1 (75% reduction)
@@ -131,6 +128,7 @@
  *   +-----------------+
  *   | archives[8]     | --> Array of 8 Archive structures
  *   | initialized     | --> Boolean flag
+ *   | memo_*, clock   | --> Decompressed-file budget and LRU clock
  *   +-----------------+
  *
  *   Each Archive structure:
@@ -138,16 +136,18 @@
  *   | path[256]       | --> File path to archive
  *   | entries*        | --> Dynamic array of entry metadata
  *   | entry_count     | --> Number of entries
- *   | data*           | --> Entire .dat file in memory
- *   | data_size       | --> Size of data buffer
+ *   | index*          | --> Name-hash → entry table
+ *   | data*           | --> Entire archive file, mapped read-only
+ *   | data_size       | --> Size of data
  *   +-----------------+
  *
  *   Each CacheEntry structure:
  *   +-----------------+
- *   | name[64]        | --> File identifier
- *   | offset          | --> Position in data buffer
- *   | compressed_size | --> Size in data buffer
+ *   | name_hash       | --> File identifier (hash of the name)
+ *   | offset          | --> Position in archive body
+ *   | compressed_size | --> Size in archive body
  *   | uncompressed    | --> Size after decompression
+ *   | memo*           | --> Decompressed bytes, once requested
  *   +-----------------+
  *
  * TYPICAL ARCHIVE SIZES:
@@ -184,9 +184,9 @@
  * USAGE WORKFLOW:
  *
  *   1. Server Startup:
- *      - Create cache system
- *      - Load all archives into memory
- *      - Parse index structures
+ *      - Create cache system, record archive paths
+ *      - Warm: open, index and decompress archives on a worker pool
+ *      - Any archive not warmed is opened on first access
  *
  *   2. Client Request:
  *      - Client asks for specific file
@@ -204,28 +204,27 @@
  *
  *   Cache Initialization:
  *     Time: O(A * E) where A = archives, E = avg entries per archive
- *     Memory: O(total size of all .dat files)
- *     Typical: 50-200 MB loaded at startup
+ *     Memory: O(entries) private; archive bytes are mapped, not copied
  *
  *   File Lookup:
- *     Time: O(E) linear search through entries
- *     Could be optimized to O(log E) with hash table or binary search
- *     Typical: < 1 microsecond for small archives
+ *     Time: O(1) average - open-addressing table keyed by name hash
+ *     Typical: a few nanoseconds (hash the name, one or two probes)
  *
  *   File Retrieval:
- *     Time: O(1) direct offset access
- *     Memory: O(compressed size) already in memory
+ *     First request: O(uncompressed size) bzip2 decode, then memoized
+ *     Later requests: O(1), same pointer
  *
  * USAGE EXAMPLE:
  *
  *   // Server initialization
  *   g_cache = cache_create();
  *   cache_init(g_cache, "data");
+ *   cache_warm(g_cache, CACHE_WARM_WORKERS);   // optional
  *
  *   // Later, when client needs item definitions
  *   u32 size = 0;
- *   u8* data = cache_get_file(g_cache, CACHE_ARCHIVE_CONFIG, 
- *                              "item_definitions", &size);
+ *   const u8* data = cache_get_file(g_cache, CACHE_ARCHIVE_CONFIG,
+ *                                    "obj.dat", &size);
  *   if (data) {
  *       // Send 'data' to client (already decompressed)
  *       // 'size' contains the uncompressed size
@@ -238,22 +237,14 @@
  *
  *   data/
  *     archives/
- *       config.dat
- *       config.idx
- *       interface.dat
- *       interface.idx
- *       media.dat
- *       media.idx
- *       models.dat
- *       models.idx
- *       sounds.dat
- *       sounds.idx
- *       textures.dat
- *       textures.idx
- *       title.dat
- *       title.idx
- *       wordenc.dat
- *       wordenc.idx
+ *       config
+ *       interface
+ *       media
+ *       models
+ *       sounds
+ *       textures
+ *       title
+ *       wordenc
  *
  * EDUCATIONAL NOTES:
  *
@@ -263,16 +254,17 @@
  *     - Easier distribution (fewer files to manage)
  *     - Better compression (can compress across related files)
  *
- *   Why keep entire .dat files in memory?
+ *   Why keep entire archives in memory?
  *     - Fast random access (no disk seeks)
  *     - Reduced latency for client requests
  *     - Simplifies code (no file handle management)
- *     - Trade-off: Memory for speed
+ *     - Trade-off: Memory for speed (mitigated: the files are mapped,
+ *       so every server process on a host shares one page-cache copy)
  *
- *   Why separate .idx and .dat files?
- *     - Index can be parsed once at startup
+ *   Why an entry table in front of the data?
+ *     - Table can be parsed once at startup
  *     - Data can be memory-mapped efficiently
- *     - Index can be kept small for faster parsing
+ *     - Table is small (10 bytes per file) for fast parsing
  *     - Similar to databases (index + data separation)
  *
  *   Real-world analogs:
@@ -287,6 +279,8 @@
 #define CACHE_H
 
 #include "types.h"
+#include "mapped_file.h"
+#include <stdbool.h>
 
 /*
  * ENUMERATION: CacheArchive
@@ -320,6 +314,21 @@ typedef enum {
     CACHE_ARCHIVE_COUNT
 } CacheArchive;
 
+/*
+ * ENUMERATION: ArchiveState
+ *
+ * Archives are opened lazily, so each one is in one of three states:
+ *
+ *   ARCHIVE_UNLOADED - path recorded by cache_init(), nothing opened yet
+ *   ARCHIVE_LOADED   - mapped, parsed and indexed; ready for lookups
+ *   ARCHIVE_FAILED   - missing or malformed; never retried
+ */
+typedef enum {
+    ARCHIVE_UNLOADED,
+    ARCHIVE_LOADED,
+    ARCHIVE_FAILED
+} ArchiveState;
+
 /*
  * STRUCTURE: CacheEntry
  *
@@ -327,39 +336,45 @@ typedef enum {
  * Contains all information needed to locate and extract the file.
  *
  * FIELDS:
- *   name[64]          - File identifier (null-terminated string)
- *   offset            - Byte offset in archive data file
+ *   name_hash         - Client hash of the file name (names are not stored)
+ *   offset            - Byte offset in the archive body
  *   compressed_size   - Size of compressed data in bytes
  *   uncompressed_size - Size after decompression in bytes
+ *   memo              - Decompressed bytes once requested (or NULL)
+ *   last_used         - Cache clock at the last request (LRU eviction)
  *
  * MEMORY LAYOUT:
  *   +---+---+---+---+---+---+---+---+---+---+---+---+---+---+---+---+
- *   | name[0..63] (64 bytes)                                        |
+ *   | name_hash (4 bytes)       | offset (4 bytes)                  |
+ *   +---+---+---+---+---+---+---+---+---+---+---+---+---+---+---+---+
+ *   | compressed_size (4 bytes) | uncompressed_size (4 bytes)       |
  *   +---+---+---+---+---+---+---+---+---+---+---+---+---+---+---+---+
- *   | offset (4 bytes)          | compressed_size (4 bytes)         |
+ *   | memo* (8 bytes pointer)                                       |
  *   +---+---+---+---+---+---+---+---+---+---+---+---+---+---+---+---+
- *   | uncompressed_size (4 bytes)                                   |
+ *   | last_used (4 bytes)       | (padding)                         |
  *   +---+---+---+---+---+---+---+---+---+---+---+---+---+---+---+---+
- *   Total: 76 bytes per entry
+ *   Total: 32 bytes per entry
  *
  * EXAMPLE:
- *   CacheEntry entry;
- *   strcpy(entry.name, "item_definitions");
- *   entry.offset = 1024;
- *   entry.compressed_size = 500;
- *   entry.uncompressed_size = 2000;
+ *   Entry for "obj.dat" in the config archive:
+ *     name_hash = hash("obj.dat")
+ *     offset = 1024
+ *     compressed_size = 500
+ *     uncompressed_size = 2000
  *
  *   Interpretation:
- *     - File "item_definitions" starts at byte 1024 in data file
+ *     - File "obj.dat" starts at byte 1024 in the archive body
  *     - Compressed data is 500 bytes long
  *     - After decompression, data will be 2000 bytes
  *     - Compression ratio: 4:1 (75% space savings)
  */
 typedef struct {
-    char name[64];
+    u32 name_hash;
     u32 offset;
     u32 compressed_size;
     u32 uncompressed_size;
+    u8* memo;
+    u32 last_used;
 } CacheEntry;
 
 /*
@@ -369,51 +384,60 @@ typedef struct {
  * Archives group related files together for efficient access.
  *
  * FIELDS:
- *   path[256]   - File path to the archive (without .dat/.idx extension)
- *   entries     - Dynamic array of file metadata (heap-allocated)
- *   entry_count - Number of files in this archive
- *   data        - Entire .dat file contents (heap-allocated)
- *   data_size   - Total size of data buffer in bytes
- *
- * MEMORY LAYOUT:
- *   +---+---+---+---+---+---+---+---+
- *   | path[0..255] (256 bytes)      |
- *   +---+---+---+---+---+---+---+---+
- *   | entries* (8 bytes pointer)    |
- *   +---+---+---+---+---+---+---+---+
- *   | entry_count (4 bytes)         |
- *   +---+---+---+---+---+---+---+---+
- *   | data* (8 bytes pointer)       |
- *   +---+---+---+---+---+---+---+---+
- *   | data_size (4 bytes)           |
- *   +---+---+---+---+---+---+---+---+
- *   Total: 284 bytes per archive (plus heap allocations)
+ *   path[256]        - File path to the archive
+ *   state            - ARCHIVE_UNLOADED / LOADED / FAILED
+ *   entries          - Dynamic array of file metadata (heap-allocated)
+ *   entry_count      - Number of files in this archive
+ *   index            - Open-addressing table: slot → entry number + 1
+ *   index_mask       - Slot count - 1 (slot count is a power of two)
+ *   view             - Read-only mapping of the archive file
+ *   data             - Entire archive file (= view.data, read-only)
+ *   data_size        - Total size of data in bytes
+ *   unpacked         - Decompressed body of a whole-compressed archive
+ *   content          - Body the entry offsets refer to (data or unpacked)
+ *   content_size     - Bytes in content
+ *   whole_compressed - true: entries are raw inside unpacked
+ *                      false: each entry is its own bzip2 stream
+ *
+ * NAME LOOKUP:
+ *
+ *   hash("obj.dat") ─→ slot = mix(hash) & index_mask
+ *                        │
+ *                        ▼  linear probing until hash matches or 0
+ *   index: [0][3][0][1][0][0][2][0] ...
+ *              │
+ *              ▼
+ *   entries[2] = { hash, offset, sizes, memo }
  *
  * HEAP ALLOCATIONS:
  *   entries: entry_count * sizeof(CacheEntry) bytes
- *   data: data_size bytes
- *
- * EXAMPLE:
- *   Archive* config = &cache->archives[CACHE_ARCHIVE_CONFIG];
- *   strcpy(config->path, "data/archives/config");
- *   config->entry_count = 100;
- *   config->entries = malloc(100 * sizeof(CacheEntry));
- *   config->data_size = 500000;  // 500 KB
- *   config->data = malloc(500000);
+ *   index: 4 bytes per slot, 2-4 slots per entry
+ *   data: none - mapped from the page cache (see mapped_file.h), so
+ *         several server processes on one host share a single copy
+ *   unpacked: only for whole-compressed archives
  *
  * LIFECYCLE:
- *   1. Allocate Archive structure
- *   2. Load and parse .idx file -> populate entries
- *   3. Load .dat file -> populate data buffer
+ *   0. cache_init() records path (state = ARCHIVE_UNLOADED)
+ *   1. First use or cache_warm(): map archive file read-only -> data
+ *   2. Parse entry table -> entries (decompressing the body if needed)
+ *   3. Build name-hash index
  *   4. Ready for cache_get_file() calls
- *   5. On shutdown: free entries, free data
+ *   5. On shutdown: free memos, entries, index, unpacked; unmap data
  */
 typedef struct {
     char path[256];
+    ArchiveState state;
     CacheEntry* entries;
     u32 entry_count;
-    u8* data;
+    u32* index;
+    u32 index_mask;
+    MappedFile view;
+    const u8* data;
     u32 data_size;
+    u8* unpacked;
+    const u8* content;
+    u32 content_size;
+    bool whole_compressed;
 } Archive;
 
 /*
@@ -425,33 +449,15 @@ typedef struct {
  * FIELDS:
  *   archives[CACHE_ARCHIVE_COUNT] - Array of 8 archive structures
  *   initialized                    - True after cache_init() succeeds
- *
- * MEMORY LAYOUT:
- *   +---+---+---+---+---+---+---+---+
- *   | archives[0] (284 bytes)       |  Config archive
- *   +---+---+---+---+---+---+---+---+
- *   | archives[1] (284 bytes)       |  Interface archive
- *   +---+---+---+---+---+---+---+---+
- *   | archives[2] (284 bytes)       |  Media archive
- *   +---+---+---+---+---+---+---+---+
- *   | archives[3] (284 bytes)       |  Models archive
- *   +---+---+---+---+---+---+---+---+
- *   | archives[4] (284 bytes)       |  Sounds archive
- *   +---+---+---+---+---+---+---+---+
- *   | archives[5] (284 bytes)       |  Textures archive
- *   +---+---+---+---+---+---+---+---+
- *   | archives[6] (284 bytes)       |  Title archive
- *   +---+---+---+---+---+---+---+---+
- *   | archives[7] (284 bytes)       |  Wordenc archive
- *   +---+---+---+---+---+---+---+---+
- *   | initialized (1 byte)          |
- *   +---+---+---+---+---+---+---+---+
- *   Total: approximately 2273 bytes (plus heap allocations)
+ *   memo_bytes                     - Bytes held by decompressed memos
+ *   memo_limit                     - Memo budget in bytes, 0 = unbounded
+ *   clock                          - Request counter for LRU ordering
  *
  * TOTAL MEMORY USAGE:
- *   Base structure: ~2.3 KB
- *   Archive data: 50-200 MB (depends on game assets)
- *   Archive entries: ~100 KB (depends on file count)
+ *   Base structure: ~3 KB
+ *   Archive data: mapped, shared page cache (depends on game assets)
+ *   Archive entries + index: a few KB (depends on file count)
+ *   Memos: uncompressed size of files requested so far
  *
  * EXAMPLE:
  *   CacheSystem* cache = cache_create();
@@ -463,6 +469,9 @@ typedef struct {
 typedef struct {
     Archive archives[CACHE_ARCHIVE_COUNT];
     bool initialized;
+    u64 memo_bytes;
+    u64 memo_limit;
+    u32 clock;
 } CacheSystem;
 
 /*
@@ -473,7 +482,7 @@ typedef struct {
  *
  * USAGE:
  *   extern CacheSystem* g_cache;
- *   u8* data = cache_get_file(g_cache, CACHE_ARCHIVE_CONFIG, "items", &size);
+ *   const u8* data = cache_get_file(g_cache, CACHE_ARCHIVE_CONFIG, "obj.dat", &size);
  *
  * LIFECYCLE:
  *   1. main(): g_cache = cache_create()
@@ -519,11 +528,11 @@ CacheSystem* cache_create();
  * PROCESS:
  *   1. For each archive:
  *      a. Free entries array if allocated
- *      b. Free data buffer if allocated
+ *      b. Unmap data view if mapped
  *   2. Free CacheSystem structure itself
  *
  * MEMORY FREED:
- *   - All archive data buffers (50-200 MB typically)
+ *   - All archive data mappings (50-200 MB of address space typically)
  *   - All entry arrays (~100 KB typically)
  *   - CacheSystem structure (~2.3 KB)
  *   - Total: All cache-related memory returned to system
@@ -540,14 +549,16 @@ void cache_destroy(CacheSystem* cache);
 /*
  * FUNCTION: cache_init
  *
- * Loads all cache archives from disk into memory.
+ * Prepares the cache system without opening any archive.
  * This is called once at server startup.
  *
+ * Each archive is opened on its first cache_get_file(), or ahead of
+ * time by cache_warm().
+ *
  * PROCESS:
  *   1. For each archive type (config, interface, media, etc.):
  *      a. Construct path: "{data_path}/archives/{name}"
- *      b. Call cache_load_archive() to load .idx and .dat
- *      c. Log success or warning
+ *      b. Record it (state = ARCHIVE_UNLOADED)
  *   2. Set initialized flag to true
  *   3. Return success
  *
@@ -559,8 +570,7 @@ void cache_destroy(CacheSystem* cache);
  *   true if initialization succeeds, false otherwise
  *
  * TIME COMPLEXITY:
- *   O(total size of all archive files)
- *   Typical: 100-500 milliseconds for 100 MB of data
+ *   O(archives), no file is opened
  *
  * EXAMPLE:
  *   CacheSystem* cache = cache_create();
@@ -576,29 +586,18 @@ bool cache_init(CacheSystem* cache, const char* data_path);
 /*
  * FUNCTION: cache_load_archive
  *
- * Loads a single archive from disk into memory.
- * Reads both the .idx (index) and .dat (data) files.
+ * Maps a single archive and indexes its files.
  *
  * PROCESS:
- *   1. Open archive file (currently just loads .dat file)
- *   2. Determine file size using fseek/ftell
- *   3. Allocate buffer of exact size
- *   4. Read entire file into buffer
- *   5. Close file
- *   6. Store buffer and size in Archive structure
- *   7. TODO: Parse .idx file to populate entries array
- *
- * CURRENT IMPLEMENTATION:
- *   Currently creates a single dummy entry containing all data.
- *   Full implementation would:
- *     1. Read .idx file to get entry metadata
- *     2. Allocate entries array
- *     3. Populate each entry with name, offset, sizes
- *     4. Read .dat file for actual data
+ *   1. Map archive file read-only
+ *   2. Store view, data pointer and size in Archive structure
+ *   3. Parse the jagfile entry table (decompressing a whole-compressed
+ *      body once)
+ *   4. Build the name-hash index
  *
  * PARAMETERS:
- *   archive - Archive structure to populate
- *   path    - Base path to archive (without extension)
+ *   archive - Zeroed Archive structure to populate
+ *   path    - Path to archive file
  *
  * RETURNS:
  *   true if successful, false on any error
@@ -606,13 +605,13 @@ bool cache_init(CacheSystem* cache, const char* data_path);
  * ERROR HANDLING:
  *   - File doesn't exist: return false
  *   - File is empty: return false
- *   - Memory allocation fails: return false
- *   - Read fails: free allocated memory, return false
+ *   - Entry table truncated or out of bounds: release, return false
+ *   - Mapping unsupported: falls back to a heap copy, still succeeds
  *
  * EXAMPLE:
- *   Archive config_archive;
+ *   Archive config_archive = {0};
  *   if (cache_load_archive(&config_archive, "data/archives/config")) {
- *       printf("Loaded config archive: %u bytes\n", config_archive.data_size);
+ *       printf("Loaded config archive: %u files\n", config_archive.entry_count);
  *   }
  */
 bool cache_load_archive(Archive* archive, const char* path);
@@ -624,50 +623,105 @@ bool cache_load_archive(Archive* archive, const char* path);
  * Returns pointer to uncompressed data.
  *
  * PROCESS:
- *   1. Validate cache is initialized
- *   2. Validate archive type is in range
- *   3. Get reference to requested archive
- *   4. Search entries for matching name (TODO: currently returns all data)
- *   5. Decompress if necessary (TODO: not yet implemented)
- *   6. Return pointer to data and set output size
- *
- * CURRENT IMPLEMENTATION:
- *   Returns pointer to entire archive data buffer.
- *   Full implementation would:
- *     1. Look up file name in entries array
- *     2. Seek to offset in data buffer
- *     3. Extract compressed data
- *     4. Decompress if compressed_size != uncompressed_size
- *     5. Return decompressed data (possibly cached)
+ *   1. Validate cache is initialized and arguments are valid
+ *   2. Hash the name and probe the archive's index
+ *   3. Whole-compressed archive: point into the decompressed body
+ *   4. Otherwise: return the memoized copy, decompressing it on the
+ *      first request only
+ *   5. Return pointer to data and set output size
  *
  * PARAMETERS:
  *   cache    - Cache system to query
  *   type     - Archive type to search in
- *   name     - File name to look up
+ *   name     - File name to look up, e.g. "obj.dat" (case-insensitive)
  *   out_size - Output parameter for file size (set by function)
  *
  * RETURNS:
  *   Pointer to file data, or NULL if not found
- *   The returned pointer is valid until cache is destroyed
- *   Do NOT free the returned pointer (it's part of the archive buffer)
+ *   Without a memo limit the pointer is valid until cache is destroyed;
+ *   with one (cache_set_memo_limit) only until the next cache_get_file()
+ *   Do NOT free the returned pointer (it is owned by the cache)
+ *
+ * THREAD SAFETY:
+ *   Not thread-safe: a miss writes the memo. Call from the game thread.
  *
  * TIME COMPLEXITY:
- *   Current: O(1) - direct access
- *   Full implementation: O(n) - linear search through entries
- *   Could be O(log n) with binary search or O(1) with hash table
+ *   Lookup: O(1) average
+ *   First request of a per-entry compressed file: O(uncompressed size)
  *
  * EXAMPLE:
  *   u32 size = 0;
- *   u8* item_data = cache_get_file(g_cache, CACHE_ARCHIVE_CONFIG, 
- *                                   "item_definitions", &size);
- *   if (item_data) {
- *       printf("Item data: %u bytes\n", size);
- *       // Use item_data...
- *       // Do NOT free item_data - it's part of cache
+ *   const u8* obj_dat = cache_get_file(g_cache, CACHE_ARCHIVE_CONFIG,
+ *                                      "obj.dat", &size);
+ *   if (obj_dat) {
+ *       printf("obj.dat: %u bytes\n", size);
+ *       // Use obj_dat...
+ *       // Do NOT free obj_dat - it's part of cache
  *   } else {
- *       printf("Item definitions not found\n");
+ *       printf("obj.dat not found\n");
  *   }
  */
-u8* cache_get_file(CacheSystem* cache, CacheArchive type, const char* name, u32* out_size);
+const u8* cache_get_file(CacheSystem* cache, CacheArchive type, const char* name, u32* out_size);
+
+/*
+ * FUNCTION: cache_set_memo_limit
+ *
+ * Bounds the memory held by decompressed files.
+ *
+ * When a new file would push the memos past the limit, the least
+ * recently requested memos are freed first. A single file larger than
+ * the limit is still returned (the limit is then exceeded by that file
+ * alone until it is evicted).
+ *
+ * PARAMETERS:
+ *   cache - Cache system
+ *   bytes - Budget in bytes; 0 = unbounded (the default)
+ *
+ * EXAMPLE:
+ *   cache_set_memo_limit(g_cache, 16 * 1024 * 1024);  // 16 MB
+ */
+void cache_set_memo_limit(CacheSystem* cache, u64 bytes);
+
+/* Worker threads cache_warm() uses at server startup */
+#define CACHE_WARM_WORKERS 4
+
+/* Upper bound on cache_warm() workers */
+#define CACHE_WARM_MAX_WORKERS 16
+
+/*
+ * FUNCTION: cache_warm
+ *
+ * Opens every archive and decompresses every file ahead of time, in
+ * parallel, so the first requests after startup never stall on bzip2.
+ *
+ * PROCESS:
+ *   1. Phase 1: workers open, parse and index archives (one job per
+ *      archive; whole-compressed bodies are decompressed here)
+ *   2. Phase 2: workers decompress every per-entry compressed file
+ *      into its memo (one job per file)
+ *   Workers pull jobs from a shared atomic counter; the caller joins
+ *   them before returning, so the cache is single-threaded again
+ *   afterwards.
+ *
+ * Phase 2 is skipped when a memo limit is set (cache_set_memo_limit):
+ * the budget is meant to hold the working set, not everything.
+ *
+ * PARAMETERS:
+ *   cache   - Initialized cache system
+ *   workers - Threads including the caller (clamped to
+ *             1..CACHE_WARM_MAX_WORKERS and to the online CPU count;
+ *             Windows runs serially)
+ *
+ * RETURNS:
+ *   Number of archives loaded
+ *
+ * TIME COMPLEXITY:
+ *   O(total uncompressed bytes / workers)
+ *
+ * EXAMPLE:
+ *   cache_init(g_cache, "data");
+ *   cache_warm(g_cache, CACHE_WARM_WORKERS);
+ */
+u32 cache_warm(CacheSystem* cache, i32 workers);
 
 #endif /* CACHE_H */
@@ -0,0 +1,129 @@
+/*******************************************************************************
+ * CHAT.C - Public Chat Slots
+ *******************************************************************************
+ *
+ * See chat.h for why the packed text is forwarded as it came. The
+ * PLAYER_INFO segment is written by append_cached_segment() in update.c.
+ *
+ ******************************************************************************/
+
+#include "chat.h"
+#include "chat_filter.h"
+#include "constants.h"
+#include "log.h"
+#include <string.h>
+
+/* Client limits (menu entries in the 225 client) */
+#define CHAT_COLOR_MAX  11
+#define CHAT_EFFECT_MAX 5
+
+/* One slot per player index, allocated with the program */
+static ChatMessage chat_slots[MAX_PLAYERS];
+
+/*
+ * WORDPACK (the client's src/wordenc/wordpack.c, on plain buffers)
+ *
+ * Nibbles 0-12 are the 13 most common characters; 13-15 start a byte
+ * (high nibble, low nibble) holding index + 195 for the rest.
+ */
+static const char WORDPACK_TABLE[] = {
+    ' ', 'e', 't', 'a', 'o', 'i', 'h', 'n', 's', 'r', 'd', 'l', 'u',
+    'm', 'w', 'c', 'y', 'f', 'g', 'p', 'b', 'v', 'k', 'x', 'j', 'q', 'z',
+    '0', '1', '2', '3', '4', '5', '6', '7', '8', '9',
+    ' ', '!', '?', '.', ',', ':', ';', '(', ')', '-', '&', '*', '\\', '\'', '@', '#', '+', '=',
+    'A', '$', '%', '"', '[', ']'
+};
+#define WORDPACK_TABLE_LENGTH ((u32)sizeof(WORDPACK_TABLE))
+
+/* Packed bytes → text (at most 2 characters per byte) */
+static u32 chat_unpack(const u8* packed, u32 length, char* out) {
+    u32 pos = 0;
+    i32 carry = -1;
+    for (u32 i = 0; i < length; i++) {
+        for (u32 half = 0; half < 2; half++) {
+            u32 nibble = half == 0 ? packed[i] >> 4 : packed[i] & 0xF;
+            if (carry != -1) {
+                u32 index = ((u32)carry << 4) + nibble - 195;
+                out[pos++] = index < WORDPACK_TABLE_LENGTH ? WORDPACK_TABLE[index] : ' ';
+                carry = -1;
+            } else if (nibble < 13) {
+                out[pos++] = WORDPACK_TABLE[nibble];
+            } else {
+                carry = (i32)nibble;
+            }
+        }
+    }
+    /* The last byte's padding nibble reads as a space */
+    while (pos > 0 && out[pos - 1] == ' ') pos--;
+    out[pos] = '\0';
+    return pos;
+}
+
+/* Text → packed bytes, as the client packs (at most CHAT_PACKED_MAX characters) */
+static u32 chat_pack(const char* text, u8* out) {
+    u32 pos = 0;
+    i32 carry = -1;
+    for (u32 i = 0; text[i] && i < CHAT_PACKED_MAX; i++) {
+        u32 index = 0;
+        for (u32 j = 0; j < WORDPACK_TABLE_LENGTH; j++) {
+            if (text[i] == WORDPACK_TABLE[j]) {
+                index = j;
+                break;
+            }
+        }
+        if (index > 12) index += 195;
+
+        if (carry == -1) {
+            if (index < 13) carry = (i32)index;
+            else out[pos++] = (u8)index;
+        } else if (index < 13) {
+            out[pos++] = (u8)(((u32)carry << 4) + index);
+            carry = -1;
+        } else {
+            out[pos++] = (u8)(((u32)carry << 4) + (index >> 4));
+            carry = (i32)(index & 0xF);
+        }
+    }
+    if (carry != -1) out[pos++] = (u8)((u32)carry << 4);
+    return pos;
+}
+
+u32 chat_filter_packed(u8* packed, u32 length) {
+    if (!g_chat_filter || length > CHAT_PACKED_MAX) return length;
+    char text[CHAT_PACKED_MAX * 2 + 1];
+    chat_unpack(packed, length, text);
+    if (chat_filter_apply(g_chat_filter, text)) {
+        return chat_pack(text, packed);
+    }
+    return length;
+}
+
+bool chat_handle_public(Player* player, StreamBuffer* buf, u32 packet_length) {
+    if (player->index >= MAX_PLAYERS) return false;
+
+    /* [color:1][effect:1] then at least one packed byte */
+    if (packet_length < 3 || packet_length - 2 > CHAT_PACKED_MAX ||
+        !buffer_require(buf, packet_length)) {
+        LOG_DEBUG("Dropping MESSAGE_PUBLIC from %s: length %u\n", player->username, packet_length);
+        return false;
+    }
+
+    u8 color = buffer_get_u8(buf);
+    u8 effect = buffer_get_u8(buf);
+    if (color > CHAT_COLOR_MAX || effect > CHAT_EFFECT_MAX) return false;
+
+    ChatMessage* slot = &chat_slots[player->index];
+    slot->color = color;
+    slot->effect = effect;
+    slot->length = (u8)(packet_length - 2);
+    buffer_get_bytes(buf, slot->packed, slot->length);
+    slot->length = (u8)chat_filter_packed(slot->packed, slot->length);
+
+    player->update_flags |= UPDATE_CHAT;
+    player_mark_changed(player);
+    return true;
+}
+
+const ChatMessage* chat_get(const Player* player) {
+    return &chat_slots[player->index < MAX_PLAYERS ? player->index : 0];
+}
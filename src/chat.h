@@ -0,0 +1,111 @@
+/*******************************************************************************
+ * CHAT.H - Public Chat Without Re-Encoding
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Forwarding client-encoded bytes instead of decoding and re-encoding
+ *   - Preallocated per-entity slots (no allocation on the hot path)
+ *   - Encode once, copy per viewer (the update block cache)
+ *
+ * THE PROBLEM:
+ *
+ * The client sends public chat already compressed with wordpack (see
+ * src/wordenc/wordpack.c): 4-bit codes for common letters, 8 bits for
+ * the rest, at most 80 characters. A server that unpacks the text,
+ * checks it and packs it again does that work once per message - and a
+ * naive one does it again for every viewer:
+ *
+ *   50 players chatting in a crowd of 200:
+ *     50 unpack + 50 × 200 pack + 10000 allocations per tick
+ *
+ * THE SOLUTION - STAMP THE PACKED BYTES, SHARE THE SEGMENT:
+ *
+ *   MESSAGE_PUBLIC (client → server, VAR_BYTE):
+ *     [color:1][effect:1][packed text...]
+ *                         └── copied as-is ──┐
+ *                                            ▼
+ *   chat_slots[player->index]:  { color, effect, length, packed[] }
+ *                                            │
+ *                    update_flags |= UPDATE_CHAT
+ *                                            │
+ *   PLAYER_INFO chat segment (mask 0x40), encoded once per tick into the
+ *   player's update block cache (update.c), memcpy'd for every viewer:
+ *     [color << 8 | effect:2][rights:1][length:1][packed text]
+ *
+ *   50 players chatting in a crowd of 200:
+ *     50 copies in + 50 segment encodings + 10000 memcpy per tick
+ *
+ * SLOTS:
+ *   One ChatMessage per player index, allocated with the program. A
+ *   player has at most one public message per tick (the client sends
+ *   one line at a time); a second one in the same tick replaces the
+ *   first, as the client's overhead text would anyway. Slots are only
+ *   read while UPDATE_CHAT is set, so a reused index never shows a
+ *   previous player's text.
+ *
+ * FILTERING:
+ *   With the word lists loaded (g_chat_filter, chat_filter.h) each line
+ *   is unpacked and run through the filter's automata, linear in its
+ *   length, right in the handler. Only a line that had something masked
+ *   is packed again; a clean line keeps the sender's bytes.
+ *
+ * THREADS:
+ *   chat_handle_public() runs on the game thread while packets are
+ *   processed; update encoders (possibly on update pool workers) only
+ *   read the slots afterwards.
+ *
+ ******************************************************************************/
+
+#ifndef CHAT_H
+#define CHAT_H
+
+#include "types.h"
+#include "buffer.h"
+#include "player.h"
+
+/* Most packed bytes a line can take (80 characters, 8 bits at worst) */
+#define CHAT_PACKED_MAX 80
+
+/*
+ * ChatMessage - One player's public chat line for this tick
+ */
+typedef struct {
+    u8 color;                       /* 0-11, client's chat color menu */
+    u8 effect;                      /* 0-5: none, wave, wave2, shake, scroll, slide */
+    u8 length;                      /* Bytes of packed[] in use */
+    u8 packed[CHAT_PACKED_MAX];     /* wordpack bytes exactly as the client sent them */
+} ChatMessage;
+
+/*
+ * chat_handle_public - Stamp a MESSAGE_PUBLIC payload into the player's slot
+ *
+ * @param player         Sender
+ * @param buf            Payload view
+ * @param packet_length  Payload size
+ * @return               false if the payload was malformed (nothing stamped)
+ *
+ * Sets UPDATE_CHAT so viewers receive the line in this tick's PLAYER_INFO.
+ */
+bool chat_handle_public(Player* player, StreamBuffer* buf, u32 packet_length);
+
+/*
+ * chat_filter_packed - Run packed text through g_chat_filter in place
+ *
+ * @param packed  wordpack bytes (CHAT_PACKED_MAX room)
+ * @param length  Bytes in use
+ * @return        Bytes in use afterwards; unchanged for a clean line, or
+ *                without word lists loaded
+ *
+ * Private messages (social.h) go through the same filter.
+ */
+u32 chat_filter_packed(u8* packed, u32 length);
+
+/*
+ * chat_get - The player's current chat line
+ *
+ * Only meaningful while (player->update_flags & UPDATE_CHAT).
+ */
+const ChatMessage* chat_get(const Player* player);
+
+#endif /* CHAT_H */
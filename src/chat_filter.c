@@ -0,0 +1,1015 @@
+/*******************************************************************************
+ * CHAT_FILTER.C - Word Filter Automata
+ *******************************************************************************
+ *
+ * See chat_filter.h for the design. The confirmation rules after a match
+ * (boundaries, letter combinations, fragments, "@"/"."/"/" statuses and
+ * the address pass) follow src/wordenc/wordfilter.c so both sides mask
+ * the same messages.
+ *
+ ******************************************************************************/
+
+#include "chat_filter.h"
+#include "log.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Limits: words longer than this are ignored, larger automata refused */
+#define FILTER_MAX_WORD      32
+#define FILTER_MAX_STATES    65535
+#define FILTER_MAX_CLASSES   256
+#define FILTER_MAX_LETTERS   64
+
+ChatFilter* g_chat_filter = NULL;
+
+/*******************************************************************************
+ * LOOK-ALIKE RULES
+ ******************************************************************************/
+
+/* Symbol pairs that stand for one letter; letter/digit pairs are not folded */
+static const char DIGRAPHS[][2] = {
+    { '/', '\\' }, { '[', ')' },
+    { '(', ')' }, { '[', ']' }, { '{', '}' }, { '<', '>' },
+    { '\\', '/' }, { '\\', '|' }, { '|', '/' },
+    { ')', '(' }, { '}', '{' }, { ']', '[' }, { '>', '<' },
+};
+#define DIGRAPH_COUNT (sizeof(DIGRAPHS) / sizeof(DIGRAPHS[0]))
+
+/*
+ * emulated_size - Characters of text (b, then c) that word letter a
+ * accepts for bad words: 0 = no, 1 = b alone, 2 = the pair b c
+ */
+static int emulated_size(char c, char a, char b) {
+    if (a == b) return 1;
+    switch (a) {
+        case 'a':
+            if (b == '4' || b == '@' || b == '^') return 1;
+            return (b == '/' && c == '\\') ? 2 : 0;
+        case 'b':
+            if (b == '6' || b == '8') return 1;
+            return (b == '1' && c == '3') ? 2 : 0;
+        case 'c':
+            return (b == '(' || b == '<' || b == '{' || b == '[') ? 1 : 0;
+        case 'd':
+            return (b == '[' && c == ')') ? 2 : 0;
+        case 'e':
+            return b == '3' ? 1 : 0;
+        case 'f':
+            return (b == 'p' && c == 'h') ? 2 : 0;
+        case 'g':
+            return (b == '9' || b == '6') ? 1 : 0;
+        case 'h':
+            return b == '#' ? 1 : 0;
+        case 'i':
+            return (b == 'y' || b == 'l' || b == 'j' || b == '1' || b == '!' ||
+                    b == ':' || b == ';' || b == '|') ? 1 : 0;
+        case 'l':
+            return (b == '1' || b == '|' || b == 'i') ? 1 : 0;
+        case 'o':
+            if (b == '0' || b == '*') return 1;
+            return ((b == '(' && c == ')') || (b == '[' && c == ']') ||
+                    (b == '{' && c == '}') || (b == '<' && c == '>')) ? 2 : 0;
+        case 's':
+            return (b == '5' || b == 'z' || b == '$' || b == '2') ? 1 : 0;
+        case 't':
+            return (b == '7' || b == '+') ? 1 : 0;
+        case 'u':
+            if (b == 'v') return 1;
+            /* fall through - the same pairs as v */
+        case 'v':
+            return ((b == '\\' && c == '/') || (b == '\\' && c == '|') ||
+                    (b == '|' && c == '/')) ? 2 : 0;
+        case 'w':
+            return (b == 'v' && c == 'v') ? 2 : 0;
+        case 'x':
+            return ((b == ')' && c == '(') || (b == '}' && c == '{') ||
+                    (b == ']' && c == '[') || (b == '>' && c == '<')) ? 2 : 0;
+        case '0':
+            if (b == 'o') return 1;
+            return ((b == '(' && c == ')') || (b == '{' && c == '}') ||
+                    (b == '[' && c == ']')) ? 2 : 0;
+        case '1':
+            return b == 'l' ? 1 : 0;
+        case ',':
+            return b == '.' ? 1 : 0;
+        case '.':
+            return b == ',' ? 1 : 0;
+        case '!':
+            return b == 'i' ? 1 : 0;
+        default:
+            return 0;
+    }
+}
+
+/* The same for domains and TLDs (the client's getEmulatedDomainCharSize) */
+static int emulated_domain_size(char c, char a, char b) {
+    if (a == b) return 1;
+    if (a == 'o' && b == '0') return 1;
+    if (a == 'o' && b == '(' && c == ')') return 2;
+    if (a == 'c' && (b == '(' || b == '<' || b == '[')) return 1;
+    if (a == 's' && b == '$') return 1;
+    if (a == 'l' && b == 'i') return 1;
+    return 0;
+}
+
+/* Characters a bad word may skip over (the client's isLowerCaseAlpha) */
+static bool bad_filler(char c) {
+    if (c >= 'a' && c <= 'z') {
+        return c == 'v' || c == 'x' || c == 'j' || c == 'q' || c == 'z';
+    }
+    return true;
+}
+
+static bool domain_filler(char c) {
+    return !isalnum((unsigned char)c);
+}
+
+typedef struct {
+    int (*size)(char c, char a, char b);
+    bool (*filler)(char c);
+} FoldRules;
+
+static const FoldRules BAD_RULES = { emulated_size, bad_filler };
+static const FoldRules DOMAIN_RULES = { emulated_domain_size, domain_filler };
+
+/*******************************************************************************
+ * AUTOMATON
+ ******************************************************************************/
+
+/* Trie of the words, over letter indices */
+typedef struct {
+    u8 letter;          /* Index into letters[] (root: unused) */
+    i32 child;          /* First child, -1 if none */
+    i32 sibling;        /* Next sibling, -1 if none */
+    i32 word;           /* Word ending here, -1 if none */
+} TrieNode;
+
+/*
+ * FilterAutomaton - One word list compiled for one set of fold rules
+ *
+ * class_of[] and digraph_class[] are the folded alphabet, next[] the
+ * determinized trie, out[] the words that end in each state.
+ */
+typedef struct {
+    /* Word list */
+    char** words;
+    u32 word_count;
+
+    /* Alphabet */
+    char letters[FILTER_MAX_LETTERS];       /* Distinct characters used by words */
+    u32 letter_count;
+    u8 letter_index[256];
+    u8 class_of[256];                       /* Single character → class */
+    u8 digraph_class[DIGRAPH_COUNT];        /* 0 = not a token for these rules */
+    u64 class_letters[FILTER_MAX_CLASSES];  /* Letters each class stands for */
+    bool class_filler[FILTER_MAX_CLASSES];
+    u32 class_count;
+
+    /* Determinized trie */
+    u16* next;                              /* [state * class_count + class] */
+    u32* out_start;                         /* out[out_start[s] .. out_start[s + 1]) */
+    u16* out;
+    u32 state_count;
+} FilterAutomaton;
+
+struct ChatFilter {
+    FilterAutomaton bad;
+    FilterAutomaton domains;
+    FilterAutomaton tlds;
+    i8 (**combos)[2];                       /* Per bad word: letter pairs that excuse it */
+    u8* combo_counts;
+    u8* tld_types;                          /* Per TLD: 1-3, how strict */
+    u16* fragments;                         /* Sorted fragment ids */
+    u32 fragment_count;
+};
+
+/* Classify one token: which letters it stands for, whether it may be skipped */
+static void fold_token(const FilterAutomaton* a, const FoldRules* rules, char b, char c,
+                       bool pair, u64* letters, bool* filler) {
+    *letters = 0;
+    for (u32 i = 0; i < a->letter_count; i++) {
+        int size = pair ? rules->size(c, a->letters[i], b) : rules->size(0, a->letters[i], b);
+        if (size == (pair ? 2 : 1)) *letters |= (u64)1 << i;
+    }
+    *filler = pair ? true : rules->filler(b);
+}
+
+static u8 class_for(FilterAutomaton* a, u64 letters, bool filler) {
+    for (u32 k = 0; k < a->class_count; k++) {
+        if (a->class_letters[k] == letters && a->class_filler[k] == filler) return (u8)k;
+    }
+    if (a->class_count == FILTER_MAX_CLASSES) return 0;
+    u32 k = a->class_count++;
+    a->class_letters[k] = letters;
+    a->class_filler[k] = filler;
+    return (u8)k;
+}
+
+/* Build the folded alphabet: class 0 is "stands for nothing, not filler" */
+static bool build_alphabet(FilterAutomaton* a, const FoldRules* rules) {
+    memset(a->letter_index, 0xFF, sizeof(a->letter_index));
+    for (u32 w = 0; w < a->word_count; w++) {
+        for (const char* p = a->words[w]; *p; p++) {
+            u8 ch = (u8)*p;
+            if (a->letter_index[ch] != 0xFF) continue;
+            if (a->letter_count == FILTER_MAX_LETTERS) return false;
+            a->letter_index[ch] = (u8)a->letter_count;
+            a->letters[a->letter_count++] = (char)ch;
+        }
+    }
+
+    a->class_count = 0;
+    class_for(a, 0, false);
+    for (u32 ch = 1; ch < 256; ch++) {
+        u64 letters;
+        bool filler;
+        fold_token(a, rules, (char)ch, 0, false, &letters, &filler);
+        a->class_of[ch] = class_for(a, letters, filler);
+    }
+    a->class_of[0] = 0;
+    for (u32 d = 0; d < DIGRAPH_COUNT; d++) {
+        u64 letters;
+        bool filler;
+        fold_token(a, rules, DIGRAPHS[d][0], DIGRAPHS[d][1], true, &letters, &filler);
+        a->digraph_class[d] = letters ? class_for(a, letters, filler) : 0;
+    }
+    return true;
+}
+
+/* Trie over the words; words too long for the matcher are left out */
+static TrieNode* build_trie(const FilterAutomaton* a, u32* node_count) {
+    u32 capacity = 1;
+    for (u32 w = 0; w < a->word_count; w++) capacity += (u32)strlen(a->words[w]);
+    TrieNode* nodes = malloc(capacity * sizeof(TrieNode));
+    if (!nodes) return NULL;
+
+    nodes[0] = (TrieNode){ 0, -1, -1, -1 };
+    u32 count = 1;
+    for (u32 w = 0; w < a->word_count; w++) {
+        size_t len = strlen(a->words[w]);
+        if (len == 0 || len > FILTER_MAX_WORD) continue;
+        i32 node = 0;
+        for (size_t i = 0; i < len; i++) {
+            u8 letter = a->letter_index[(u8)a->words[w][i]];
+            i32 child = nodes[node].child;
+            while (child >= 0 && nodes[child].letter != letter) child = nodes[child].sibling;
+            if (child < 0) {
+                child = (i32)count++;
+                nodes[child] = (TrieNode){ letter, -1, nodes[node].child, -1 };
+                nodes[node].child = child;
+            }
+            node = child;
+        }
+        if (nodes[node].word < 0) nodes[node].word = (i32)w;
+    }
+    *node_count = count;
+    return nodes;
+}
+
+/*
+ * SUBSET CONSTRUCTION
+ *
+ * A state is a sorted set of trie nodes: every word prefix the text read
+ * so far can end with, under some reading of its look-alikes. The root
+ * is always in the set (a word may start anywhere), which is what makes
+ * the result an Aho-Corasick matcher without failure links.
+ *
+ * Filler has no transitions: tokens that stand for no letter are not fed
+ * to the automaton at all (filter_pass). A filler self-loop on every
+ * node would keep each prefix alive across spaces and grow the bad word
+ * automaton past 65535 states; without it, it has about 2500.
+ */
+typedef struct {
+    u32* items;             /* All sets, back to back */
+    u32 items_used, items_capacity;
+    u32* set_start;         /* Per state: offset into items (+1 entry) */
+    u32* table;             /* Hash → state + 1 (0 = empty) */
+    u32 table_mask;
+} SetStore;
+
+static u32 set_hash(const u32* set, u32 n) {
+    u32 h = 2166136261u;
+    for (u32 i = 0; i < n; i++) h = (h ^ set[i]) * 16777619u;
+    return h;
+}
+
+static int compare_u32(const void* x, const void* y) {
+    u32 a = *(const u32*)x, b = *(const u32*)y;
+    return a < b ? -1 : a > b;
+}
+
+/* Find or add a set; returns its state, or -1 when out of states/memory */
+static i32 set_intern(SetStore* s, u32* state_count, const u32* set, u32 n) {
+    u32 slot = set_hash(set, n) & s->table_mask;
+    while (s->table[slot]) {
+        u32 st = s->table[slot] - 1;
+        u32 len = s->set_start[st + 1] - s->set_start[st];
+        if (len == n && memcmp(s->items + s->set_start[st], set, n * sizeof(u32)) == 0) {
+            return (i32)st;
+        }
+        slot = (slot + 1) & s->table_mask;
+    }
+    if (*state_count >= FILTER_MAX_STATES) return -1;
+    if (s->items_used + n > s->items_capacity) {
+        u32 capacity = s->items_capacity * 2 + n;
+        u32* items = realloc(s->items, capacity * sizeof(u32));
+        if (!items) return -1;
+        s->items = items;
+        s->items_capacity = capacity;
+    }
+    memcpy(s->items + s->items_used, set, n * sizeof(u32));
+    s->items_used += n;
+    u32 st = (*state_count)++;
+    s->set_start[st + 1] = s->items_used;
+    s->table[slot] = st + 1;
+    return (i32)st;
+}
+
+static bool accepts(const FilterAutomaton* a, u8 letter, u8 cls) {
+    return (a->class_letters[cls] >> letter) & 1;
+}
+
+static bool build_automaton(FilterAutomaton* a, const FoldRules* rules) {
+    if (!build_alphabet(a, rules)) return false;
+    u32 node_count = 0;
+    TrieNode* nodes = build_trie(a, &node_count);
+    if (!nodes) return false;
+
+    SetStore s = { 0 };
+    s.items_capacity = 1024;
+    s.items = malloc(s.items_capacity * sizeof(u32));
+    s.set_start = calloc(FILTER_MAX_STATES + 1, sizeof(u32));
+    s.table_mask = (1u << 17) - 1;
+    s.table = calloc(s.table_mask + 1, sizeof(u32));
+    u32 next_capacity = 1024;
+    a->next = malloc((size_t)next_capacity * a->class_count * sizeof(u16));
+    u32* set = malloc(node_count * sizeof(u32));
+    u32* seen = calloc(node_count, sizeof(u32));
+    bool ok = s.items && s.set_start && s.table && a->next && set && seen;
+
+    u32 root = 0;
+    a->state_count = 0;
+    if (ok) set_intern(&s, &a->state_count, &root, 1);
+
+    /* Breadth-first: state st's transitions, interning new sets as found */
+    u32 stamp = 0;
+    for (u32 st = 0; ok && st < a->state_count; st++) {
+        if (st >= next_capacity) {
+            next_capacity *= 2;
+            u16* next = realloc(a->next, (size_t)next_capacity * a->class_count * sizeof(u16));
+            if (!next) { ok = false; break; }
+            a->next = next;
+        }
+        for (u32 k = 0; k < a->class_count && ok; k++) {
+            u32 n = 0;
+            stamp++;
+            set[n++] = 0;
+            seen[0] = stamp;
+#define ADD_NODE(node_) do { u32 it_ = (u32)(node_); \
+                if (seen[it_] != stamp) { seen[it_] = stamp; set[n++] = it_; } } while (0)
+            for (u32 i = s.set_start[st]; i < s.set_start[st + 1]; i++) {
+                u32 node = s.items[i];
+                /* Next letter, or the same letter again ("fuuu") */
+                for (i32 c = nodes[node].child; c >= 0; c = nodes[c].sibling) {
+                    if (accepts(a, nodes[c].letter, (u8)k)) ADD_NODE(c);
+                }
+                if (node != 0 && accepts(a, nodes[node].letter, (u8)k)) ADD_NODE(node);
+            }
+#undef ADD_NODE
+            qsort(set, n, sizeof(u32), compare_u32);
+            i32 target = set_intern(&s, &a->state_count, set, n);
+            if (target < 0) { ok = false; break; }
+            a->next[(size_t)st * a->class_count + k] = (u16)target;
+        }
+    }
+
+    /* Output function: words that end in each state */
+    if (ok) {
+        a->out_start = calloc(a->state_count + 1, sizeof(u32));
+        u32 total = 0;
+        for (u32 st = 0; st < a->state_count; st++) {
+            for (u32 i = s.set_start[st]; i < s.set_start[st + 1]; i++) {
+                if (nodes[s.items[i]].word >= 0) total++;
+            }
+        }
+        a->out = malloc((total ? total : 1) * sizeof(u16));
+        ok = a->out_start && a->out;
+        u32 pos = 0;
+        for (u32 st = 0; ok && st < a->state_count; st++) {
+            a->out_start[st] = pos;
+            for (u32 i = s.set_start[st]; i < s.set_start[st + 1]; i++) {
+                if (nodes[s.items[i]].word >= 0) a->out[pos++] = (u16)nodes[s.items[i]].word;
+            }
+        }
+        if (ok) a->out_start[a->state_count] = pos;
+    }
+
+    free(seen);
+    free(set);
+    free(s.table);
+    free(s.set_start);
+    free(s.items);
+    free(nodes);
+    return ok;
+}
+
+static void automaton_free(FilterAutomaton* a) {
+    for (u32 w = 0; w < a->word_count; w++) free(a->words[w]);
+    free(a->words);
+    free(a->next);
+    free(a->out_start);
+    free(a->out);
+}
+
+/*******************************************************************************
+ * LOADING
+ ******************************************************************************/
+
+typedef struct {
+    const u8* data;
+    u32 size;
+    u32 pos;
+    bool overflow;
+} ListReader;
+
+static u32 list_get(ListReader* r, u32 bytes) {
+    if (r->pos + bytes > r->size) {
+        r->overflow = true;
+        return 0;
+    }
+    u32 value = 0;
+    for (u32 i = 0; i < bytes; i++) value = value << 8 | r->data[r->pos++];
+    return value;
+}
+
+static char* list_get_string(ListReader* r) {
+    u32 len = list_get(r, 1);
+    char* s = malloc(len + 1);
+    if (!s) return NULL;
+    for (u32 i = 0; i < len; i++) s[i] = (char)tolower((int)list_get(r, 1));
+    s[len] = '\0';
+    return s;
+}
+
+static bool list_open(ListReader* r, CacheSystem* cache, const char* name) {
+    r->data = cache_get_file(cache, CACHE_ARCHIVE_WORDENC, name, &r->size);
+    r->pos = 0;
+    r->overflow = false;
+    if (!r->data) fprintf(stderr, "WARNING: wordenc has no %s\n", name);
+    return r->data != NULL;
+}
+
+static bool list_words(FilterAutomaton* a, u32 count) {
+    a->words = calloc(count ? count : 1, sizeof(char*));
+    a->word_count = count;
+    return a->words != NULL;
+}
+
+/* badenc.txt: [count:4] then per word [len:1][chars][pairs:1][(a:1, b:1) × pairs] */
+static bool load_bad(ChatFilter* f, CacheSystem* cache) {
+    ListReader r;
+    if (!list_open(&r, cache, "badenc.txt")) return false;
+    u32 count = list_get(&r, 4);
+    if (count > r.size || !list_words(&f->bad, count)) return false;
+    f->combos = calloc(count ? count : 1, sizeof(*f->combos));
+    f->combo_counts = calloc(count ? count : 1, 1);
+    if (!f->combos || !f->combo_counts) return false;
+    for (u32 i = 0; i < count && !r.overflow; i++) {
+        f->bad.words[i] = list_get_string(&r);
+        u32 pairs = list_get(&r, 1);
+        f->combo_counts[i] = (u8)pairs;
+        if (pairs == 0) continue;
+        f->combos[i] = malloc(pairs * sizeof(**f->combos));
+        if (!f->combos[i] || !f->bad.words[i]) return false;
+        for (u32 j = 0; j < pairs; j++) {
+            f->combos[i][j][0] = (i8)list_get(&r, 1);
+            f->combos[i][j][1] = (i8)list_get(&r, 1);
+        }
+    }
+    return !r.overflow;
+}
+
+/* domainenc.txt: [count:4] then [len:1][chars] per domain */
+static bool load_domains(ChatFilter* f, CacheSystem* cache) {
+    ListReader r;
+    if (!list_open(&r, cache, "domainenc.txt")) return false;
+    u32 count = list_get(&r, 4);
+    if (count > r.size || !list_words(&f->domains, count)) return false;
+    for (u32 i = 0; i < count && !r.overflow; i++) {
+        if (!(f->domains.words[i] = list_get_string(&r))) return false;
+    }
+    return !r.overflow;
+}
+
+/* tldlist.txt: [count:4] then [type:1][len:1][chars] per TLD */
+static bool load_tlds(ChatFilter* f, CacheSystem* cache) {
+    ListReader r;
+    if (!list_open(&r, cache, "tldlist.txt")) return false;
+    u32 count = list_get(&r, 4);
+    if (count > r.size || !list_words(&f->tlds, count)) return false;
+    f->tld_types = calloc(count ? count : 1, 1);
+    if (!f->tld_types) return false;
+    for (u32 i = 0; i < count && !r.overflow; i++) {
+        f->tld_types[i] = (u8)list_get(&r, 1);
+        if (!(f->tlds.words[i] = list_get_string(&r))) return false;
+    }
+    return !r.overflow;
+}
+
+/* fragmentsenc.txt: [count:4] then [id:2] per fragment, ascending */
+static bool load_fragments(ChatFilter* f, CacheSystem* cache) {
+    ListReader r;
+    if (!list_open(&r, cache, "fragmentsenc.txt")) return false;
+    u32 count = list_get(&r, 4);
+    if (count > r.size) return false;
+    f->fragments = malloc((count ? count : 1) * sizeof(u16));
+    if (!f->fragments) return false;
+    f->fragment_count = count;
+    for (u32 i = 0; i < count; i++) f->fragments[i] = (u16)list_get(&r, 2);
+    return !r.overflow;
+}
+
+ChatFilter* chat_filter_create(CacheSystem* cache) {
+    if (!cache) return NULL;
+    ChatFilter* f = calloc(1, sizeof(ChatFilter));
+    if (!f) return NULL;
+
+    /* Each list is parsed right away: cache pointers may not outlive the next get */
+    bool ok = load_bad(f, cache) && load_domains(f, cache) &&
+              load_tlds(f, cache) && load_fragments(f, cache) &&
+              build_automaton(&f->bad, &BAD_RULES) &&
+              build_automaton(&f->domains, &DOMAIN_RULES) &&
+              build_automaton(&f->tlds, &DOMAIN_RULES);
+    if (!ok) {
+        fprintf(stderr, "WARNING: Chat filter lists could not be compiled\n");
+        chat_filter_destroy(f);
+        return NULL;
+    }
+    return f;
+}
+
+void chat_filter_destroy(ChatFilter* filter) {
+    if (!filter) return;
+    for (u32 i = 0; i < filter->bad.word_count; i++) free(filter->combos ? filter->combos[i] : NULL);
+    free(filter->combos);
+    free(filter->combo_counts);
+    free(filter->tld_types);
+    free(filter->fragments);
+    automaton_free(&filter->bad);
+    automaton_free(&filter->domains);
+    automaton_free(&filter->tlds);
+    free(filter);
+}
+
+u32 chat_filter_states(const ChatFilter* filter) {
+    if (!filter) return 0;
+    return filter->bad.state_count + filter->domains.state_count + filter->tlds.state_count;
+}
+
+/*******************************************************************************
+ * MATCHING
+ ******************************************************************************/
+
+/* One input token: a character, or a symbol pair folded to one class */
+typedef struct {
+    u8 cls;
+    u8 start;           /* First character in the text */
+    u8 len;             /* 1 or 2 */
+} Token;
+
+static u32 tokenize(const FilterAutomaton* a, const char* text, u32 len, Token* tokens) {
+    u32 n = 0;
+    for (u32 i = 0; i < len; ) {
+        Token t = { a->class_of[(u8)text[i]], (u8)i, 1 };
+        if (i + 1 < len) {
+            for (u32 d = 0; d < DIGRAPH_COUNT; d++) {
+                if (a->digraph_class[d] && text[i] == DIGRAPHS[d][0] && text[i + 1] == DIGRAPHS[d][1]) {
+                    t.cls = a->digraph_class[d];
+                    t.len = 2;
+                    break;
+                }
+            }
+        }
+        tokens[n++] = t;
+        i += t.len;
+    }
+    return n;
+}
+
+/*
+ * A reported word, walked back to its start
+ *
+ * start/end are character offsets [start, end); the flags describe the
+ * tokens skipped as filler and the look-alikes read as letters, which
+ * the client's confirmation rules look at.
+ */
+typedef struct {
+    u32 start, end;
+    u32 filler_chars;
+    bool symbol;        /* Skipped a symbol ("f.u.c.k") */
+    bool numeral;       /* Skipped a digit */
+    bool emulated;      /* Read a digit as a letter ("4ss") */
+} Span;
+
+/*
+ * find_span - Leftmost start from which word can be read ending at token end
+ *
+ * Backward search over (letter j, token pos) pairs: token pos was read as
+ * word[j]; the token before it was word[j] again (repeat), word[j - 1],
+ * or filler in between. parent[] keeps the path to recover which tokens
+ * were letters. O(word length × span) per report.
+ */
+static bool find_span(const FilterAutomaton* a, const char* word, const Token* tokens,
+                      u32 end, const char* text, Span* span) {
+    u32 len = (u32)strlen(word);
+    if (len == 0 || len > FILTER_MAX_WORD) return false;
+    u8 letters[FILTER_MAX_WORD];
+    for (u32 j = 0; j < len; j++) letters[j] = a->letter_index[(u8)word[j]];
+    if (!accepts(a, letters[len - 1], tokens[end].cls)) return false;
+
+    u32 width = end + 1;
+    u16 parent[FILTER_MAX_WORD * (CHAT_FILTER_MAX_TEXT + 1)];
+    u8 visited[FILTER_MAX_WORD * (CHAT_FILTER_MAX_TEXT + 1)];
+    memset(visited, 0, len * width);
+    u16 stack[FILTER_MAX_WORD * (CHAT_FILTER_MAX_TEXT + 1)];
+    u32 top = 0;
+
+    u32 first = (len - 1) * width + end;
+    visited[first] = 1;
+    parent[first] = (u16)first;
+    stack[top++] = (u16)first;
+    i32 best = -1;
+
+    while (top > 0) {
+        u32 id = stack[--top];
+        u32 j = id / width, pos = id % width;
+        if (j == 0 && (best < 0 || (i32)pos < best % (i32)width)) best = (i32)id;
+        for (i32 q = (i32)pos - 1; q >= 0; q--) {
+            u8 cls = tokens[q].cls;
+            bool adjacent = q == (i32)pos - 1;
+            /* Repeats of the last letter must be adjacent: a word end takes no filler */
+            if (accepts(a, letters[j], cls) && (adjacent || j + 1 < len)) {
+                u32 to = j * width + (u32)q;
+                if (!visited[to]) { visited[to] = 1; parent[to] = (u16)id; stack[top++] = (u16)to; }
+            }
+            if (j > 0 && accepts(a, letters[j - 1], cls)) {
+                u32 to = (j - 1) * width + (u32)q;
+                if (!visited[to]) { visited[to] = 1; parent[to] = (u16)id; stack[top++] = (u16)to; }
+            }
+            if (!a->class_filler[cls]) break;
+        }
+    }
+    if (best < 0) return false;
+
+    /* Walk the path forward: tokens on it are letters, the rest filler */
+    memset(span, 0, sizeof(*span));
+    u32 s = (u32)best % width;
+    span->start = tokens[s].start;
+    span->end = (u32)tokens[end].start + tokens[end].len;
+    u32 id = (u32)best;
+    u32 next_letter = s;
+    for (u32 t = s; t <= end; t++) {
+        if (t == next_letter) {
+            char c0 = text[tokens[t].start];
+            char c1 = tokens[t].len == 2 ? text[tokens[t].start + 1] : 'a';
+            if (isdigit((unsigned char)c0) || isdigit((unsigned char)c1)) span->emulated = true;
+            id = parent[id];
+            next_letter = id % width;
+            if (next_letter == t) next_letter = end + 1;
+            continue;
+        }
+        for (u32 k = 0; k < tokens[t].len; k++) {
+            char c = text[tokens[t].start + k];
+            span->filler_chars++;
+            if (!isalnum((unsigned char)c) && c != '\'') span->symbol = true;
+            if (isdigit((unsigned char)c)) span->numeral = true;
+        }
+    }
+    return true;
+}
+
+/* Letter index of the client's combination table */
+static i8 combo_index(char c) {
+    if (c >= 'a' && c <= 'z') return (i8)(c + 1 - 'a');
+    if (c == '\'') return 28;
+    if (c >= '0' && c <= '9') return (i8)(c + 29 - '0');
+    return 27;
+}
+
+static bool combo_matches(const ChatFilter* f, u32 word, i8 a, i8 b) {
+    for (u32 i = 0; i < f->combo_counts[word]; i++) {
+        if (f->combos[word][i][0] == a && f->combos[word][i][1] == b) return true;
+    }
+    return false;
+}
+
+static int compare_u16(const void* x, const void* y) {
+    return (int)*(const u16*)x - (int)*(const u16*)y;
+}
+
+/* Is this piece (up to 3 characters) a known innocent fragment? */
+static bool is_fragment(const ChatFilter* f, const char* piece, u32 len) {
+    bool digits = true;
+    for (u32 i = 0; i < len; i++) {
+        if (!isdigit((unsigned char)piece[i])) digits = false;
+    }
+    if (digits) return true;
+
+    /* Base-38 id, last character most significant (the client's firstFragmentId) */
+    u32 id = 0;
+    for (u32 i = 0; i < len; i++) {
+        char c = piece[len - i - 1];
+        if (c >= 'a' && c <= 'z') id = id * 38 + (u32)(c + 1 - 'a');
+        else if (c == '\'') id = id * 38 + 27;
+        else if (c >= '0' && c <= '9') id = id * 38 + (u32)(c + 28 - '0');
+        else return false;
+    }
+    if (id > 0xFFFF) return false;
+    u16 key = (u16)id;
+    return bsearch(&key, f->fragments, f->fragment_count, sizeof(u16), compare_u16) != NULL;
+}
+
+static bool word_char(char c) {
+    return isalnum((unsigned char)c) || c == '\'';
+}
+
+/* The client's checks after a bad word matched (wordfilter.c filter()) */
+static bool bad_word_confirmed(const ChatFilter* f, u32 word, const char* text, u32 len,
+                               const Span* span) {
+    u32 start = span->start, end = span->end;
+    if (span->emulated && span->numeral) return false;
+    if (span->filler_chars * 100 / (end - start) > 90) return false;
+
+    if (span->symbol) {
+        /* Split by symbols: only counts as a word on its own, or if a piece is not innocent */
+        bool free_before = start == 0 || !word_char(text[start - 1]);
+        bool free_after = end >= len || !word_char(text[end]);
+        if (!free_before || !free_after) {
+            bool good = false;
+            for (i32 cur = free_before ? (i32)start : (i32)start - 2; !good && cur < (i32)end; cur++) {
+                if (cur < 0 || !word_char(text[cur])) continue;
+                u32 off = 0;
+                while (off < 3 && (u32)cur + off < len && word_char(text[cur + off])) off++;
+                bool valid = off != 0;
+                if (off < 3 && cur - 1 >= 0 && word_char(text[cur - 1])) valid = false;
+                if (valid && !is_fragment(f, text + cur, off)) good = true;
+            }
+            if (!good) return false;
+        }
+    } else {
+        /* Inside a longer word: some neighbouring letter pairs excuse it ("class") */
+        char before = start > 0 ? text[start - 1] : ' ';
+        char after = end < len ? text[end] : ' ';
+        if (combo_matches(f, word, combo_index(before), combo_index(after))) return false;
+    }
+
+    u32 numerals = 0, alphas = 0;
+    for (u32 i = start; i < end; i++) {
+        if (isdigit((unsigned char)text[i])) numerals++;
+        else if (isalpha((unsigned char)text[i])) alphas++;
+    }
+    return numerals <= alphas;
+}
+
+/* Copy of text with a marker word replaced by asterisks ("dot" → "***") */
+static void mark_literal(const char* text, char* out, const char* marker) {
+    strcpy(out, text);
+    size_t n = strlen(marker);
+    for (char* p = strstr(out, marker); p; p = strstr(p + n, marker)) memset(p, '*', n);
+}
+
+static bool alnum_at(const char* s, i32 i) {
+    return isalnum((unsigned char)s[i]);
+}
+
+/* '@' (3) or "(a)" (4) before a domain (the client's getDomainAtFilterStatus) */
+static int at_status(i32 start, const char* text, const char* marked) {
+    if (start == 0) return 2;
+    for (i32 i = start - 1; i >= 0 && !alnum_at(text, i); i--) {
+        if (text[i] == '@') return 3;
+    }
+    int stars = 0;
+    for (i32 i = start - 1; i >= 0 && !alnum_at(marked, i); i--) {
+        if (marked[i] == '*') stars++;
+    }
+    if (stars >= 3) return 4;
+    return alnum_at(text, start - 1) ? 0 : 1;
+}
+
+/* '.' or ',' (3) or "dot" (4) after a domain (getDomainDotFilterStatus) */
+static int dot_after_status(const char* text, const char* marked, i32 last, i32 len) {
+    if (last + 1 == len) return 2;
+    for (i32 i = last + 1; i < len && !alnum_at(text, i); i++) {
+        if (text[i] == '.' || text[i] == ',') return 3;
+    }
+    int stars = 0;
+    for (i32 i = last + 1; i < len && !alnum_at(marked, i); i++) {
+        if (marked[i] == '*') stars++;
+    }
+    if (stars >= 3) return 4;
+    return alnum_at(text, last + 1) ? 0 : 1;
+}
+
+/* '.' or ',' (3) or "dot" (4) before a TLD (getTldDotFilterStatus) */
+static int dot_before_status(const char* text, const char* marked, i32 start) {
+    if (start == 0) return 2;
+    for (i32 i = start - 1; i >= 0 && !alnum_at(text, i); i--) {
+        if (text[i] == ',' || text[i] == '.') return 3;
+    }
+    int stars = 0;
+    for (i32 i = start - 1; i >= 0 && !alnum_at(marked, i); i--) {
+        if (marked[i] == '*') stars++;
+    }
+    if (stars >= 3) return 4;
+    return alnum_at(text, start - 1) ? 0 : 1;
+}
+
+/* '/' or '\' (3) or "slash" (4) after a TLD (getTldSlashFilterStatus) */
+static int slash_status(const char* text, const char* marked, i32 last, i32 len) {
+    if (last + 1 == len) return 2;
+    for (i32 i = last + 1; i < len && !alnum_at(text, i); i++) {
+        if (text[i] == '\\' || text[i] == '/') return 3;
+    }
+    int stars = 0;
+    for (i32 i = last + 1; i < len && !alnum_at(marked, i); i++) {
+        if (marked[i] == '*') stars++;
+    }
+    if (stars >= 5) return 4;
+    return alnum_at(text, last + 1) ? 0 : 1;
+}
+
+typedef enum { PASS_BAD, PASS_DOMAINS, PASS_TLDS } PassKind;
+
+/* Mask the span of a confirmed TLD, widened over "dot"/"slash" and the words around it */
+static void mask_tld(char* text, i32 len, i32 first, i32 last, int dot, int slash,
+                     const char* dotted, const char* slashed) {
+    if (dot > 2) {
+        if (dot == 4) {
+            bool found = false;
+            for (i32 i = first - 1; i >= 0; i--) {
+                if (found) {
+                    if (dotted[i] != '*') break;
+                    first = i;
+                } else if (dotted[i] == '*') {
+                    first = i;
+                    found = true;
+                }
+            }
+        }
+        bool found = false;
+        for (i32 i = first - 1; i >= 0; i--) {
+            if (found) {
+                if (!alnum_at(text, i)) break;
+                first = i;
+            } else if (alnum_at(text, i)) {
+                found = true;
+                first = i;
+            }
+        }
+    }
+    if (slash > 2) {
+        if (slash == 4) {
+            bool found = false;
+            for (i32 i = last + 1; i < len; i++) {
+                if (found) {
+                    if (slashed[i] != '*') break;
+                    last = i;
+                } else if (slashed[i] == '*') {
+                    last = i;
+                    found = true;
+                }
+            }
+        }
+        bool found = false;
+        for (i32 i = last + 1; i < len; i++) {
+            if (found) {
+                if (!alnum_at(text, i)) break;
+                last = i;
+            } else if (alnum_at(text, i)) {
+                found = true;
+                last = i;
+            }
+        }
+    }
+    for (i32 i = first; i <= last; i++) text[i] = '*';
+}
+
+/* Run one automaton over text and mask what its confirmation rule accepts */
+static void filter_pass(const ChatFilter* f, const FilterAutomaton* a, PassKind kind,
+                        char* text, u32 len) {
+    Token tokens[CHAT_FILTER_MAX_TEXT];
+    char marked_a[CHAT_FILTER_MAX_TEXT + 1];
+    char marked_b[CHAT_FILTER_MAX_TEXT + 1];
+    char source[CHAT_FILTER_MAX_TEXT + 1];
+    u32 count = tokenize(a, text, len, tokens);
+
+    /* Reports are confirmed against the text as the pass found it, so a
+     * word masked first ("uck") cannot hide one ending at the same place */
+    memcpy(source, text, len + 1);
+
+    if (kind == PASS_DOMAINS) {
+        mark_literal(text, marked_a, "(a)");
+        mark_literal(text, marked_b, "dot");
+    } else if (kind == PASS_TLDS) {
+        mark_literal(text, marked_a, "dot");
+        mark_literal(text, marked_b, "slash");
+    }
+
+    u32 state = 0;
+    for (u32 t = 0; t < count; t++) {
+        /* Pure filler ("f.u.c.k") is skipped here and walked over by find_span */
+        u8 cls = tokens[t].cls;
+        if (a->class_letters[cls] == 0 && a->class_filler[cls]) continue;
+        state = a->next[(size_t)state * a->class_count + cls];
+        for (u32 o = a->out_start[state]; o < a->out_start[state + 1]; o++) {
+            u32 word = a->out[o];
+            Span span;
+            if (!find_span(a, a->words[word], tokens, t, source, &span)) continue;
+
+            if (kind == PASS_BAD) {
+                if (bad_word_confirmed(f, word, source, len, &span)) {
+                    memset(text + span.start, '*', span.end - span.start);
+                }
+            } else if (kind == PASS_DOMAINS) {
+                int at = at_status((i32)span.start, source, marked_a);
+                int dot = dot_after_status(source, marked_b, (i32)span.end - 1, (i32)len);
+                if (at > 2 || dot > 2) memset(text + span.start, '*', span.end - span.start);
+            } else {
+                int type = f->tld_types[word];
+                int dot = dot_before_status(text, marked_a, (i32)span.start);
+                int slash = slash_status(text, marked_b, (i32)span.end - 1, (i32)len);
+                bool match = (type == 1 && dot > 0 && slash > 0) ||
+                             (type == 2 && ((dot > 2 && slash > 0) || (dot > 0 && slash > 2))) ||
+                             (type == 3 && dot > 0 && slash > 2);
+                if (match) {
+                    mask_tld(text, (i32)len, (i32)span.start, (i32)span.end - 1, dot, slash,
+                             marked_a, marked_b);
+                }
+            }
+        }
+    }
+}
+
+/* Four numbers up to 255 in a row (an IP address): the client's filterFragments */
+static void filter_addresses(char* text, u32 len) {
+    u32 count = 0, start = 0;
+    for (u32 i = 0; i < len; ) {
+        if (!isdigit((unsigned char)text[i])) {
+            /* A letter other than the filler letters breaks the sequence */
+            if (isalnum((unsigned char)text[i]) && !bad_filler(text[i])) count = 0;
+            i++;
+            continue;
+        }
+        u32 j = i, value = 0;
+        while (j < len && isdigit((unsigned char)text[j])) {
+            if (value <= 255) value = value * 10 + (u32)(text[j] - '0');
+            j++;
+        }
+        if (count == 0) start = i;
+        if (value <= 255 && j - i <= 8) {
+            count++;
+        } else {
+            count = 0;
+        }
+        if (count == 4) {
+            memset(text + start, '*', j - start);
+            count = 0;
+        }
+        i = j;
+    }
+}
+
+/* Words the passes above mask by mistake, restored afterwards */
+static const char* const ALLOWLIST[] = { "cook", "cook's", "cooks", "seeks", "sheet" };
+
+bool chat_filter_apply(const ChatFilter* filter, char* text) {
+    if (!filter || !text) return false;
+    u32 len = (u32)strlen(text);
+    if (len > CHAT_FILTER_MAX_TEXT) len = CHAT_FILTER_MAX_TEXT;
+    if (len == 0) return false;
+
+    char original[CHAT_FILTER_MAX_TEXT + 1];
+    for (u32 i = 0; i < len; i++) text[i] = (char)tolower((unsigned char)text[i]);
+    memcpy(original, text, len);
+    original[len] = '\0';
+
+    /* Same order as the client: TLDs, bad words (twice), domains, addresses */
+    char saved = text[len];
+    text[len] = '\0';
+    filter_pass(filter, &filter->tlds, PASS_TLDS, text, len);
+    filter_pass(filter, &filter->bad, PASS_BAD, text, len);
+    filter_pass(filter, &filter->bad, PASS_BAD, text, len);
+    filter_pass(filter, &filter->domains, PASS_DOMAINS, text, len);
+    filter_addresses(text, len);
+
+    for (u32 i = 0; i < sizeof(ALLOWLIST) / sizeof(ALLOWLIST[0]); i++) {
+        size_t n = strlen(ALLOWLIST[i]);
+        for (const char* p = strstr(original, ALLOWLIST[i]); p; p = strstr(p + 1, ALLOWLIST[i])) {
+            memcpy(text + (p - original), ALLOWLIST[i], n);
+        }
+    }
+    text[len] = saved;
+    return memcmp(text, original, len) != 0;
+}
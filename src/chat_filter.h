@@ -0,0 +1,124 @@
+/*******************************************************************************
+ * CHAT_FILTER.H - Word Filter Compiled into Automata
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Multi-pattern matching (Aho-Corasick) instead of one scan per word
+ *   - Folding "looks like" rules into the input alphabet
+ *   - Subset construction: turning a nondeterministic matcher into a table
+ *
+ * THE PROBLEM:
+ *
+ * The client's word filter (src/wordenc/wordfilter.c) checks a message
+ * by trying every bad word at every position, and the same again for
+ * every domain and TLD:
+ *
+ *   for each word (hundreds):
+ *       for each start position (up to 80):
+ *           walk forward, asking getEmulatedSize(c, word[k], text[i])
+ *           whether "4" may stand for "a", "|" for "i", "()" for "o" ...
+ *
+ *   ≈ words × length × word length calls per message: fine for a client
+ *   filtering its own screen, not for a server filtering every line
+ *   of a crowd each tick.
+ *
+ * THE SOLUTION - ONE PASS OVER THE MESSAGE:
+ *
+ * 1. Alphabet folding. Every input character (and every two-symbol
+ *    look-alike such as "()" or "\/") is mapped to a class: the set of
+ *    word letters it can stand for, plus whether it may be skipped as
+ *    filler ("f.u.c.k"). Characters with the same answers share a class:
+ *
+ *      '4' '@' '^'  → {a}          '1'  → {i, l}         ' ' '.' → filler
+ *      '0' '*'      → {o} filler   'v'  → {u, v} filler
+ *
+ * 2. Automaton. The words form a trie. Reading a class can move to a
+ *    child (next letter) or stay (repeated letter, "fuuu"); pure filler
+ *    is skipped before the automaton sees it. Because one character can
+ *    mean several letters, the trie is nondeterministic; subset
+ *    construction turns every reachable set of trie nodes into one
+ *    state, so matching is a table lookup:
+ *
+ *      state = next[state][class[token]]      once per character
+ *
+ *    and each state lists the words that end there (Aho-Corasick's
+ *    output function: a match of any word at any start is found here,
+ *    there are no failure links to follow at run time).
+ *
+ * 3. Confirmation. A reported word is walked back from where it ended
+ *    to find its start, then checked with the client's rules (word
+ *    boundaries, the allowed letter combinations and fragments of
+ *    badenc.txt, "@"/"dot" next to a domain). Only reported words are
+ *    walked, and reports are rare.
+ *
+ *   Cost per message: O(length) lookups + O(span) per reported word,
+ *   independent of how many words are in the lists.
+ *
+ * LISTS (data/wordenc, loaded through the cache):
+ *   badenc.txt       Bad words and the letter pairs that excuse them
+ *   domainenc.txt    Domain names, masked next to "@" or "."
+ *   tldlist.txt      TLDs and their type (how strict the "." check is)
+ *   fragmentsenc.txt Innocent fragments for words split by symbols
+ *
+ * DIFFERENCES FROM THE CLIENT FILTER:
+ *   - Look-alikes made of letters or digits ("ph" for f, "vv" for w,
+ *     "13" for b) are not folded: a one-token look-ahead would turn
+ *     every "p" into a possible "f". Symbol pairs ("()", "/\") are.
+ *   - The matcher accepts a word wherever any reading of the characters
+ *     spells it; the client commits greedily to the first reading.
+ *   - "dot", "slash" and "(a)" next to domains are found literally.
+ *   - Domain letter 'e' matches only 'e' (the client accepts anything
+ *     there, a stand-in for the euro sign).
+ *
+ * THREADS:
+ *   The automata are read-only after chat_filter_create(); any number
+ *   of threads may call chat_filter_apply() at once.
+ *
+ ******************************************************************************/
+
+#ifndef CHAT_FILTER_H
+#define CHAT_FILTER_H
+
+#include "types.h"
+#include "cache.h"
+
+/* Longest message chat_filter_apply() looks at (characters) */
+#define CHAT_FILTER_MAX_TEXT 255
+
+typedef struct ChatFilter ChatFilter;
+
+/* Global filter (NULL when the lists could not be loaded) */
+extern ChatFilter* g_chat_filter;
+
+/*
+ * chat_filter_create - Load the word lists and compile their automata
+ *
+ * @param cache  Cache holding the wordenc archive
+ * @return       Filter, or NULL if a list is missing or malformed
+ *
+ * COMPLEXITY: O(states × classes) time and memory, once at startup
+ */
+ChatFilter* chat_filter_create(CacheSystem* cache);
+
+void chat_filter_destroy(ChatFilter* filter);
+
+/*
+ * chat_filter_apply - Mask bad words, domains and addresses with '*'
+ *
+ * @param filter  Compiled filter
+ * @param text    NUL-terminated message, filtered in place and lowercased
+ * @return        true if any character was masked
+ *
+ * Text beyond CHAT_FILTER_MAX_TEXT characters is left as it is.
+ *
+ * COMPLEXITY: O(length) plus O(span) per reported word
+ */
+bool chat_filter_apply(const ChatFilter* filter, char* text);
+
+/*
+ * chat_filter_states - Total automaton states (for startup logging)
+ */
+u32 chat_filter_states(const ChatFilter* filter);
+
+#endif /* CHAT_FILTER_H */
@@ -0,0 +1,403 @@
+/*******************************************************************************
+ * CHECKPOINT.C - Copy-on-Write World Checkpoints Implementation
+ *******************************************************************************
+ *
+ * See checkpoint.h for the fork and what is kept.
+ *
+ * FILE LAYOUT:
+ *
+ *   [CheckpointHeader][ground items...][objects...][NPCs...]
+ *                     └──────────── body_crc covers these ────────────┘
+ *
+ * Records are fixed-size structs written as they are in memory, like the
+ * sections of the world snapshot (snapshot.h); layout packs their sizes,
+ * so a build with a different record struct rejects the file instead of
+ * misreading it.
+ *
+ ******************************************************************************/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include "checkpoint.h"
+#include "ground_item.h"
+#include "object.h"
+#include "npc.h"
+#include "activation.h"
+#include "timer_wheel.h"
+#include "tick_stats.h"
+#include "crc32.h"
+#include "replay.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+u32 g_checkpoint_ticks = CHECKPOINT_TICKS;
+
+#define CHECKPOINT_LAYOUT ((u32)sizeof(CheckpointGroundItem) | \
+                           (u32)sizeof(CheckpointObject) << 8 | \
+                           (u32)sizeof(CheckpointNpc) << 16)
+
+/*
+ * checkpoint_serialize - Write the world's state into buffer
+ *
+ * @return  Bytes used (header included)
+ *
+ * Runs in the forked child: reads game state, writes only buffer.
+ */
+static u32 checkpoint_serialize(u8* buffer, u32 capacity, u64 tick, u64 unix_time, u32 world_id) {
+    CheckpointHeader* header = (CheckpointHeader*)buffer;
+    u32 pos = sizeof(CheckpointHeader);
+    memset(header, 0, sizeof(CheckpointHeader));
+
+    GroundItemSystem* ground = g_ground_items;
+    for (u32 i = 0; ground && i < ground->capacity; i++) {
+        const GroundItem* item = &ground->items[i];
+        if (item->item_id == 0 || pos + sizeof(CheckpointGroundItem) > capacity) continue;
+        CheckpointGroundItem* rec = (CheckpointGroundItem*)(buffer + pos);
+        rec->item_id = item->item_id;
+        rec->level = (u16)position_height(&item->position);
+        rec->x = (u16)position_x(&item->position);
+        rec->z = (u16)position_z(&item->position);
+        rec->count = item->count;
+        rec->despawn_ticks = (u32)timer_remaining(g_timers, item->despawn_timer);
+        pos += sizeof(CheckpointGroundItem);
+        header->ground_count++;
+    }
+
+    ObjectSystem* objects = g_objects;
+    for (u32 i = 0; objects && i < objects->object_capacity; i++) {
+        const GameObject* object = &objects->objects[i];
+        if (object->id == 0 || !object->temporary) continue;  /* Boot spawns come back by themselves */
+        if (pos + sizeof(CheckpointObject) > capacity) continue;
+        CheckpointObject* rec = (CheckpointObject*)(buffer + pos);
+        memset(rec, 0, sizeof(CheckpointObject));
+        rec->id = object->id;
+        rec->type = object->type;
+        rec->rotation = object->rotation;
+        rec->x = (u16)position_x(&object->position);
+        rec->z = (u16)position_z(&object->position);
+        rec->level = (u16)position_height(&object->position);
+        rec->removed = object->removed;
+        rec->despawn_ticks = (u32)timer_remaining(g_timers, object->despawn_timer);
+        pos += sizeof(CheckpointObject);
+        header->object_count++;
+    }
+
+    NpcSystem* npcs = g_npcs;
+    for (u32 i = 0; npcs && i < npcs->npc_capacity; i++) {
+        const Npc* npc = &npcs->npcs[i];
+        if (!npc->active || pos + sizeof(CheckpointNpc) > capacity) continue;
+        CheckpointNpc* rec = (CheckpointNpc*)(buffer + pos);
+        rec->index = npc->index;
+        rec->npc_id = npc->npc_id;
+        rec->spawn_x = (u16)position_x(&npc->spawn_position);
+        rec->spawn_z = (u16)position_z(&npc->spawn_position);
+        rec->x = (u16)position_x(&npc->position);
+        rec->z = (u16)position_z(&npc->position);
+        rec->level = (u16)position_height(&npc->position);
+        rec->hitpoints = npc->hitpoints;
+        rec->respawn_ticks = 0;
+        if (npc->timer_action == NPC_TIMER_RESPAWN) {
+            u64 left = timer_remaining(g_timers, npc->timer);
+            rec->respawn_ticks = left > 0 ? (u32)left : 1;
+        }
+        pos += sizeof(CheckpointNpc);
+        header->npc_count++;
+    }
+
+    header->magic = CHECKPOINT_MAGIC;
+    header->version = CHECKPOINT_VERSION;
+    header->layout = CHECKPOINT_LAYOUT;
+    header->world_id = world_id;
+    header->tick = tick;
+    header->unix_time = unix_time;
+    header->body_crc = crc32(buffer + sizeof(CheckpointHeader), pos - sizeof(CheckpointHeader));
+    return pos;
+}
+
+#ifndef _WIN32
+
+/*
+ * checkpoint_write - tmp file, fsync, rename (system calls only: the child)
+ */
+static bool checkpoint_write(const Checkpoint* cp, const u8* data, u32 size) {
+    int fd = open(cp->tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+
+    u32 done = 0;
+    while (done < size) {
+        ssize_t n = write(fd, data + done, size - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            close(fd);
+            unlink(cp->tmp_path);
+            return false;
+        }
+        done += (u32)n;
+    }
+    bool ok = fsync(fd) == 0;
+    ok = close(fd) == 0 && ok;
+    return ok && rename(cp->tmp_path, cp->path) == 0;
+}
+
+/*
+ * checkpoint_reap - Collect the child if it has exited
+ *
+ * @param block  Wait for it (shutdown) instead of polling
+ */
+static void checkpoint_reap(Checkpoint* cp, bool block) {
+    if (cp->child == 0) return;
+
+    int status = 0;
+    pid_t pid = waitpid((pid_t)cp->child, &status, block ? 0 : WNOHANG);
+    if (pid == 0) return;  /* Still writing */
+    if (pid < 0 && errno == EINTR) return;
+
+    double ms = (double)(tick_stats_now() - cp->child_started) / 1e6;
+    if (pid > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+        cp->taken++;
+        LOG_INFO("Checkpoint of tick %llu written to %s (%.1f ms, fork %.2f ms)\n",
+                 (unsigned long long)cp->child_tick, cp->path, ms, cp->last_fork_ns / 1e6);
+    } else {
+        cp->failed++;
+        LOG_WARN("WARNING: Checkpoint of tick %llu failed (%s)\n",
+                 (unsigned long long)cp->child_tick,
+                 pid > 0 && WIFSIGNALED(status) ? "writer killed" : "write error");
+    }
+    cp->child = 0;
+}
+
+/*
+ * checkpoint_take - Fork a child that writes the world as it is now
+ */
+static void checkpoint_take(Checkpoint* cp, u64 tick) {
+    u64 unix_time = (u64)time(NULL);
+    u64 start = tick_stats_now();
+
+    /* Output the child inherits unflushed would be written twice */
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    if (pid == 0) {
+        /* Child: Ctrl+C is for the server; this finishes and exits */
+        signal(SIGINT, SIG_IGN);
+        signal(SIGTERM, SIG_DFL);
+        u32 size = checkpoint_serialize(cp->buffer, cp->buffer_size, tick, unix_time, cp->world_id);
+        _exit(checkpoint_write(cp, cp->buffer, size) ? 0 : 1);
+    }
+
+    cp->last_fork_ns = tick_stats_now() - start;
+    if (pid < 0) {
+        cp->failed++;
+        LOG_WARN("WARNING: Checkpoint of tick %llu not taken (fork failed)\n",
+                 (unsigned long long)tick);
+        return;
+    }
+    cp->child = pid;
+    cp->child_tick = tick;
+    cp->child_started = start;
+}
+
+#else /* _WIN32 */
+
+/*
+ * Windows: no fork(). The checkpoint is serialized and written right
+ * here, on the game thread.
+ */
+static void checkpoint_reap(Checkpoint* cp, bool block) {
+    (void)cp; (void)block;
+}
+
+static void checkpoint_take(Checkpoint* cp, u64 tick) {
+    u64 start = tick_stats_now();
+    u32 size = checkpoint_serialize(cp->buffer, cp->buffer_size, tick, (u64)time(NULL),
+                                    cp->world_id);
+    FILE* file = fopen(cp->tmp_path, "wb");
+    bool ok = file && fwrite(cp->buffer, 1, size, file) == size;
+    if (file) ok = fclose(file) == 0 && ok;
+    remove(cp->path);
+    ok = ok && rename(cp->tmp_path, cp->path) == 0;
+    cp->last_fork_ns = tick_stats_now() - start;
+    if (ok) {
+        cp->taken++;
+    } else {
+        cp->failed++;
+        LOG_WARN("WARNING: Checkpoint of tick %llu failed (write error)\n", (unsigned long long)tick);
+    }
+}
+
+#endif /* _WIN32 */
+
+bool checkpoint_start(Checkpoint* cp, u32 world_id) {
+    if (!cp) return false;
+    memset(cp, 0, sizeof(Checkpoint));
+    cp->world_id = world_id;
+    if (world_id == 0) {
+        snprintf(cp->path, sizeof(cp->path), "data/world.ckpt");
+    } else {
+        snprintf(cp->path, sizeof(cp->path), "data/world-%u.ckpt", world_id);
+    }
+    snprintf(cp->tmp_path, sizeof(cp->tmp_path), "%s.tmp", cp->path);
+    if (g_checkpoint_ticks == 0) return false;
+
+    /* Room for every slot full: the child must never need more */
+    u64 size = sizeof(CheckpointHeader);
+    if (g_ground_items) size += (u64)g_ground_items->capacity * sizeof(CheckpointGroundItem);
+    if (g_objects) size += (u64)g_objects->object_capacity * sizeof(CheckpointObject);
+    if (g_npcs) size += (u64)g_npcs->npc_capacity * sizeof(CheckpointNpc);
+    cp->buffer = size <= UINT32_MAX ? (u8*)malloc((size_t)size) : NULL;
+    if (!cp->buffer) {
+        fprintf(stderr, "WARNING: No memory for world checkpoints, none will be taken\n");
+        return false;
+    }
+    cp->buffer_size = (u32)size;
+    printf("World checkpoint every %u ticks to %s (%u KB buffer)\n",
+           g_checkpoint_ticks, cp->path, cp->buffer_size / 1024);
+    return true;
+}
+
+void checkpoint_tick(Checkpoint* cp, u64 tick) {
+    if (!cp || !cp->buffer) return;
+    checkpoint_reap(cp, false);
+
+    if (g_checkpoint_ticks == 0 || tick % g_checkpoint_ticks != 0) return;
+    if (g_replay.recording || g_replay.replaying) return;
+    if (cp->child != 0) {
+        cp->skipped++;
+        LOG_WARN("WARNING: Checkpoint of tick %llu skipped (tick %llu still writing)\n",
+                 (unsigned long long)tick, (unsigned long long)cp->child_tick);
+        return;
+    }
+    checkpoint_take(cp, tick);
+}
+
+void checkpoint_stop(Checkpoint* cp) {
+    if (!cp) return;
+    checkpoint_reap(cp, true);
+    if (cp->buffer) {
+        printf("Checkpoints stopped (%llu written, %llu failed, %llu skipped)\n",
+               (unsigned long long)cp->taken, (unsigned long long)cp->failed,
+               (unsigned long long)cp->skipped);
+    }
+    free(cp->buffer);
+    cp->buffer = NULL;
+    cp->buffer_size = 0;
+}
+
+/*
+ * checkpoint_apply - Put the records of a validated checkpoint back
+ */
+static void checkpoint_apply(const CheckpointHeader* header, const u8* body) {
+    u32 ground = 0, objects = 0, npcs = 0;
+
+    const CheckpointGroundItem* item = (const CheckpointGroundItem*)body;
+    for (u32 i = 0; i < header->ground_count; i++, item++) {
+        Position position;
+        position_init(&position, item->x, item->z, item->level);
+        if (ground_item_drop(g_ground_items, item->item_id, item->count, &position,
+                             item->despawn_ticks)) {
+            ground++;
+        }
+    }
+
+    const CheckpointObject* object = (const CheckpointObject*)item;
+    for (u32 i = 0; i < header->object_count; i++, object++) {
+        GameObject* spawned = object_spawn(g_objects, object->id, object->x, object->z,
+                                           object->level, object->type, object->rotation);
+        if (!spawned) continue;
+        spawned->removed = object->removed != 0;
+        if (object->despawn_ticks > 0) {
+            object_despawn_after(g_objects, spawned, object->despawn_ticks);
+        } else {
+            spawned->temporary = true;
+        }
+        objects++;
+    }
+
+    const CheckpointNpc* rec = (const CheckpointNpc*)object;
+    for (u32 i = 0; i < header->npc_count; i++, rec++) {
+        /* Registered spawns only exist once their square is active
+         * (activation.h): this makes them, and finds the one */
+        Position spawn;
+        position_init(&spawn, rec->spawn_x, rec->spawn_z, rec->level);
+        Npc* spawned = activation_npc_for(g_activation, rec->npc_id, &spawn);
+        
+        Npc* npc = npc_get_by_index(g_npcs, rec->index);
+        if (!npc || !npc->active || npc->npc_id != rec->npc_id ||
+            position_x(&npc->spawn_position) != rec->spawn_x || position_z(&npc->spawn_position) != rec->spawn_z) {
+            npc = spawned;
+        }
+        if (!npc) continue;  /* Spawns changed since: leave the boot's NPC as it is */
+        Position position;
+        position_init(&position, rec->x, rec->z, rec->level);
+        npc_restore(g_npcs, npc, &position, rec->hitpoints, rec->respawn_ticks);
+        npcs++;
+    }
+
+    printf("Restored %u/%u ground items, %u/%u objects, %u/%u NPCs\n",
+           ground, header->ground_count, objects, header->object_count, npcs, header->npc_count);
+}
+
+bool checkpoint_restore(Checkpoint* cp) {
+    if (!cp || !cp->path[0]) return false;
+    if (g_replay.recording || g_replay.replaying) return false;
+
+    FILE* file = fopen(cp->path, "rb");
+    if (!file) return false;  /* First boot, or never checkpointed */
+
+    fseek(file, 0, SEEK_END);
+    long file_size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    u8* data = file_size >= (long)sizeof(CheckpointHeader) ? (u8*)malloc((size_t)file_size) : NULL;
+    bool read = data && fread(data, 1, (size_t)file_size, file) == (size_t)file_size;
+    fclose(file);
+    if (!read) {
+        free(data);
+        fprintf(stderr, "WARNING: Checkpoint %s unreadable, starting fresh\n", cp->path);
+        return false;
+    }
+
+    CheckpointHeader header;
+    memcpy(&header, data, sizeof(header));
+    u64 expected = sizeof(CheckpointHeader) +
+                   (u64)header.ground_count * sizeof(CheckpointGroundItem) +
+                   (u64)header.object_count * sizeof(CheckpointObject) +
+                   (u64)header.npc_count * sizeof(CheckpointNpc);
+    const char* problem = NULL;
+    if (header.magic != CHECKPOINT_MAGIC || header.version != CHECKPOINT_VERSION) {
+        problem = "not a checkpoint of this version";
+    } else if (header.layout != CHECKPOINT_LAYOUT) {
+        problem = "written by a build with other records";
+    } else if (expected != (u64)file_size) {
+        problem = "truncated";
+    } else if (crc32(data + sizeof(CheckpointHeader), (size_t)file_size - sizeof(CheckpointHeader)) !=
+               header.body_crc) {
+        problem = "checksum mismatch";
+    }
+    if (problem) {
+        fprintf(stderr, "WARNING: Checkpoint %s ignored (%s), starting fresh\n", cp->path, problem);
+        free(data);
+        return false;
+    }
+
+    time_t taken = (time_t)header.unix_time;
+    char when[32] = "?";
+    struct tm* tm = localtime(&taken);
+    if (tm) strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", tm);
+    printf("Restoring world checkpoint %s (tick %llu, %s)\n", cp->path,
+           (unsigned long long)header.tick, when);
+    checkpoint_apply(&header, data + sizeof(CheckpointHeader));
+    free(data);
+    return true;
+}
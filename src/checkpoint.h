@@ -0,0 +1,185 @@
+/*******************************************************************************
+ * CHECKPOINT.H - Copy-on-Write World Checkpoints for Crash Recovery
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - fork() as a snapshot: the child sees memory frozen at the fork
+ *   - Copy-on-write: pages are copied only when the parent changes them
+ *   - Consistent snapshots without locks or stopping the world for long
+ *   - Crash-safe files (write a temp file, fsync, rename)
+ *
+ * THE PROBLEM:
+ *
+ * Only player saves reach the disk. Everything else a world accumulates
+ * lives in memory and dies with the process:
+ *
+ *   ground items      drops, with their despawn timers
+ *   spawned objects   GameObject.temporary (stumps, fires, map locs removed)
+ *   NPCs              where each stands, its hitpoints, who is dead
+ *
+ * After a crash the world boots as if nothing had happened. Writing all
+ * of it from the tick would stall the tick for as long as the
+ * serialization and the disk take, and writing it from another thread
+ * while the tick changes it would not be a consistent picture.
+ *
+ * THE SOLUTION - FORK, LET THE CHILD WRITE:
+ *
+ *   GAME THREAD (end of tick N)          CHILD (memory as of tick N)
+ *   checkpoint_tick()                    serialize ground items, objects,
+ *     fork() ─────────────────────────→  NPCs into the preallocated buffer
+ *     back to ticking (cost: the fork)   write FILE.tmp, fsync, rename
+ *     ...                                _exit(0 or 1)
+ *   later ticks: waitpid(WNOHANG) ←────── exit status: logged
+ *
+ *   fork() copies the page tables, not the pages. Both processes share
+ *   every page until one writes to it; then the kernel copies that one
+ *   page for the writer. The child only reads game state (and writes its
+ *   own copy of the buffer), so the cost lands on the parent as one page
+ *   copy per page the following ticks touch, spread over those ticks.
+ *
+ *   The child touches nothing but memory and plain system calls: no
+ *   locks (another thread may have held one at the fork), no stdio, no
+ *   logging. The buffer is allocated up front by the parent.
+ *
+ * RESTORE:
+ *   At boot, before any player connects, checkpoint_restore() reads the
+ *   newest checkpoint (checked: magic, version, record layout, CRC) and
+ *   puts the items and objects back with their remaining despawn times.
+ *   NPCs are matched by id and spawn tile to a registered spawn, whose
+ *   mapsquare is activated for it (activation.h), or by index to one the
+ *   boot spawned, and moved, hurt or killed to match. Anything that no
+ *   longer matches (changed spawns, smaller limits) is skipped.
+ *
+ * NOT COVERED:
+ *   Loc changes sent to clients (zone_update.h) and NPC movement queues,
+ *   fights and scripts. A world restored from tick N also loses what
+ *   happened after N: at most one interval.
+ *
+ * FILES:
+ *   data/world.ckpt, or data/world-<id>.ckpt under --worlds. Every
+ *   --checkpoint-ticks N ticks (0 = never). Not taken or restored while
+ *   recording or replaying (replay.h): a replay starts from a fresh world.
+ *
+ * PLATFORM:
+ *   POSIX fork(). On Windows the checkpoint is written on the game thread,
+ *   which stalls that tick for the whole write.
+ *
+ ******************************************************************************/
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "types.h"
+#include <stdbool.h>
+
+/* Ticks between checkpoints (500 ticks = 5 minutes) */
+#define CHECKPOINT_TICKS 500
+
+#define CHECKPOINT_MAGIC   0x54504B43u  /* "CKPT" */
+#define CHECKPOINT_VERSION 1
+
+/* --checkpoint-ticks: ticks between checkpoints, 0 = off */
+extern u32 g_checkpoint_ticks;
+
+/*
+ * CheckpointHeader - Start of a checkpoint file, followed by the records
+ */
+typedef struct {
+    u32 magic;                  /* CHECKPOINT_MAGIC */
+    u32 version;                /* CHECKPOINT_VERSION */
+    u32 layout;                 /* Record sizes (checkpoint.c), a struct change mismatches */
+    u32 world_id;               /* g_world_id that wrote it */
+    u64 tick;                   /* Tick the checkpoint shows the end of */
+    u64 unix_time;              /* When it was taken */
+    u32 ground_count;           /* CheckpointGroundItem records */
+    u32 object_count;           /* CheckpointObject records */
+    u32 npc_count;              /* CheckpointNpc records */
+    u32 body_crc;               /* CRC32 of everything after the header */
+} CheckpointHeader;
+
+typedef struct {
+    u16 item_id;
+    u16 level;
+    u16 x, z;
+    u32 count;
+    u32 despawn_ticks;          /* 0 = never */
+} CheckpointGroundItem;
+
+typedef struct {
+    u16 id;
+    u8 type;
+    u8 rotation;
+    u16 x, z;
+    u16 level;
+    u8 removed;                 /* Marker hiding a map loc (object.h) */
+    u8 pad;
+    u32 despawn_ticks;          /* 0 = no despawn pending */
+} CheckpointObject;
+
+typedef struct {
+    u16 index;
+    u16 npc_id;
+    u16 spawn_x, spawn_z;       /* Identify the boot spawn it belongs to */
+    u16 x, z;
+    u16 level;
+    u16 hitpoints;
+    u32 respawn_ticks;          /* 0 = alive */
+} CheckpointNpc;
+
+/*
+ * Checkpoint - Writer state (game thread only)
+ */
+typedef struct {
+    u32 world_id;               /* g_world_id, recorded in the header */
+    char path[256];             /* data/world.ckpt */
+    char tmp_path[264];         /* path + ".tmp", written by the child */
+    u8* buffer;                 /* Serialization space, sized at start */
+    u32 buffer_size;
+
+    i64 child;                  /* Writing child's pid, 0 = none */
+    u64 child_tick;             /* Tick it is writing */
+    u64 child_started;          /* tick_stats_now() at its fork */
+
+    u64 taken;                  /* Checkpoints written */
+    u64 failed;                 /* Children that failed (or fork failures) */
+    u64 skipped;                /* Due while the previous one was still writing */
+    u64 last_fork_ns;           /* Game thread cost of the last one */
+} Checkpoint;
+
+/*
+ * checkpoint_start - Name the file and allocate the buffer
+ *
+ * @param cp        Zeroed Checkpoint
+ * @param world_id  g_world_id (names the file)
+ * @return          false if off (--checkpoint-ticks 0) or out of memory
+ *
+ * Call after the ground item, object and NPC systems exist: the buffer is
+ * sized for their capacities.
+ */
+bool checkpoint_start(Checkpoint* cp, u32 world_id);
+
+/*
+ * checkpoint_tick - Reap a finished child; take a checkpoint when due
+ *
+ * @param cp    Started Checkpoint (NULL buffer: does nothing)
+ * @param tick  Tick that has just finished
+ *
+ * Call at the end of a tick, when the world is consistent.
+ */
+void checkpoint_tick(Checkpoint* cp, u64 tick);
+
+/*
+ * checkpoint_stop - Wait for a writing child, free the buffer
+ */
+void checkpoint_stop(Checkpoint* cp);
+
+/*
+ * checkpoint_restore - Load the checkpoint file into a freshly booted world
+ *
+ * @param cp  Started Checkpoint (its path)
+ * @return    true if a checkpoint was found, valid and applied
+ */
+bool checkpoint_restore(Checkpoint* cp);
+
+#endif /* CHECKPOINT_H */
@@ -7,6 +7,7 @@
 #include "component.h"
 #include "defines.h"
 #include "jagfile.h"
+#include "locaddentity.h"
 #include "npcentity.h"
 #include "packet.h"
 #include "pix24.h"
@@ -54,6 +55,12 @@ struct Client {
     GameShell *shell;
     int archive_checksum[9];
     Jagfile *archive_title;
+    Jagfile *load_archives[9]; // custom: fetched, not yet unpacked (by archive_checksum index)
+    int load_step;
+    bool load_background;
+    bool load_login;
+    char load_message[MAX_STR];
+    int load_progress;
     PixFont *font_plain11;
     PixFont *font_plain12;
     PixFont *font_bold12;
@@ -185,6 +192,17 @@ struct Client {
     int orbit_camera_pitch; // 128
 
     int minimap_level; // -1
+    // what image_minimap holds, for createMinimap to shift instead of redrawing
+    int minimap_drawn_level; // -1 for nothing
+    int minimap_base_x;
+    int minimap_base_z;
+    int minimap_wall_rgb;
+    int minimap_door_rgb;
+    // tiles whose locs changed since the scene was rebuilt, before the minimap was (x0 > x1 for none)
+    int minimap_dirty_x0;
+    int minimap_dirty_z0;
+    int minimap_dirty_x1;
+    int minimap_dirty_z1;
     int flag_scene_tile_x;
     int flag_scene_tile_z;
 
@@ -248,6 +266,7 @@ struct Client {
     LinkList *spotanims;
     LinkList *merged_locations;
     LinkList *spawned_locations;
+    LocAddEntity *spawned_zones[4][13][13]; // custom: spawned_locations chained by plane and 8x8 scene zone
     LinkList ****level_obj_stacks;
     int8_t (*levelTileFlags)[104][104];
     int (*levelHeightmap)[104 + 1][104 + 1];
@@ -386,6 +405,8 @@ struct Client {
     int chatEffects;
     int bfsDirection[104][104];
     int bfsCost[104][104];
+    int bfsVisited[104][104]; // custom: bfsEpoch of the last search that reached the tile
+    int bfsEpoch;
     int bfsStepX[BFS_STEP_SIZE];
     int bfsStepZ[BFS_STEP_SIZE];
     int tryMoveNearest;
@@ -425,6 +446,7 @@ struct Client {
 void client_init_global(void);
 Client *client_new(void);
 void client_load(Client *c);
+void client_load_continue(Client *c);
 void client_update(Client *c);
 void client_draw(Client *c);
 void client_unload(Client *c);
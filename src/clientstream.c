@@ -447,24 +447,57 @@ void clientstream_close(ClientStream *stream) {
     // free(stream);
 }
 
-int clientstream_available(ClientStream *stream, int len) {
-    if (stream->bufLen >= len) {
-        return 1;
+// one recv into the free part of the ring up to its end (the next fill wraps around)
+static int clientstream_fill(ClientStream *stream) {
+    int start = (stream->bufPos + stream->bufLen) & (CLIENTSTREAM_BUFFER - 1);
+    int space = CLIENTSTREAM_BUFFER - stream->bufLen;
+    if (space > CLIENTSTREAM_BUFFER - start) {
+        space = CLIENTSTREAM_BUFFER - start;
+    }
+    if (space == 0) {
+        return -1;
     }
 
-    int bytes = recv(stream->socket, (char *)stream->buf + stream->bufPos + stream->bufLen, len - stream->bufLen, 0);
+    int bytes = recv(stream->socket, (char *)stream->buf + start, space, 0);
+    if (bytes > 0) {
+        stream->bufLen += bytes;
+    }
+    return bytes;
+}
 
-    if (bytes < 0) {
-        bytes = 0;
+// copy out of the ring, in two parts when the bytes wrap around its end
+static void clientstream_take(ClientStream *stream, int8_t *dst, int len) {
+    int first = CLIENTSTREAM_BUFFER - stream->bufPos;
+    if (first > len) {
+        first = len;
     }
+    memcpy(dst, stream->buf + stream->bufPos, first);
+    memcpy(dst + first, stream->buf, len - first);
+    stream->bufPos = (stream->bufPos + len) & (CLIENTSTREAM_BUFFER - 1);
+    stream->bufLen -= len;
+}
 
-    stream->bufLen += bytes;
+void clientstream_poll(ClientStream *stream) {
+    stream->polled = false;
+}
 
-    if (stream->bufLen < len) {
-        return 0;
+int clientstream_available(ClientStream *stream, int len) {
+    if (stream->bufLen >= len) {
+        return 1;
+    }
+
+    // custom: everything the socket has in one recv (previously one per call, for exactly
+    // the missing bytes), then nothing more until the next clientstream_poll
+    if (!stream->polled) {
+        stream->polled = true;
+        int bytes = clientstream_fill(stream);
+        // a recv that stopped at the end of the ring may have left more behind
+        if (bytes > 0 && stream->bufLen < len && ((stream->bufPos + stream->bufLen) & (CLIENTSTREAM_BUFFER - 1)) == 0) {
+            clientstream_fill(stream);
+        }
     }
 
-    return 1;
+    return stream->bufLen >= len;
 }
 
 int clientstream_read_byte(ClientStream *stream) {
@@ -486,38 +519,23 @@ int clientstream_read_bytes(ClientStream *stream, int8_t *dst, int off, int len)
         return -1;
     }
 
-    if (stream->bufLen > 0) {
-        int copy_length;
-
-        if (len > stream->bufLen) {
-            copy_length = stream->bufLen;
-        } else {
-            copy_length = len;
-        }
-
-        memcpy(dst, stream->buf + stream->bufPos, copy_length);
-
-        len -= copy_length;
-        stream->bufLen -= copy_length;
-
-        if (stream->bufLen == 0) {
-            stream->bufPos = 0;
-        } else {
-            stream->bufPos += copy_length;
-        }
-    }
-
     int read_duration = 0;
 
     while (len > 0) {
-        int bytes = recv(stream->socket, (char *)dst + off, len, 0);
-        if (bytes > 0) {
-            off += bytes;
-            len -= bytes;
-        } else if (bytes == 0) {
+        if (stream->bufLen > 0) {
+            int copy_length = len < stream->bufLen ? len : stream->bufLen;
+            clientstream_take(stream, dst + off, copy_length);
+            off += copy_length;
+            len -= copy_length;
+            continue;
+        }
+
+        // blocking read (login): wait for more, served through the ring like the rest
+        int bytes = clientstream_fill(stream);
+        if (bytes == 0) {
             stream->closed = true;
             return -1;
-        } else {
+        } else if (bytes < 0) {
             read_duration += 1;
 
             if (read_duration >= 5000) {
@@ -5,18 +5,24 @@
 
 typedef struct ClientStream ClientStream;
 
+// custom: received bytes wait in a ring, filled by one recv of everything pending (see clientstream_poll)
+#define CLIENTSTREAM_BUFFER 16384 // power of two, fits several ticks of packets (each < 5000)
+
 struct ClientStream {
     int socket;
     bool closed;
-    int8_t buf[5000];
-    int bufLen;
-    int bufPos;
+    int8_t buf[CLIENTSTREAM_BUFFER];
+    int bufLen; // bytes buffered
+    int bufPos; // ring index of the next byte
+    bool polled; // recv already done since clientstream_poll
 };
 
 bool clientstream_init(void);
 ClientStream *clientstream_new(void);
 ClientStream *clientstream_opensocket(int port);
 void clientstream_close(ClientStream *stream);
+// custom: allow one more recv, once per client update so a tick's reads cost one syscall at most
+void clientstream_poll(ClientStream *stream);
 int clientstream_available(ClientStream *stream, int length);
 int clientstream_read_byte(ClientStream *stream);
 int clientstream_read_bytes(ClientStream *stream, int8_t *dst, int off, int len);
@@ -0,0 +1,971 @@
+/*******************************************************************************
+ * CLUSTER.C - Region Ownership, Ghost Frames and Player Handoff
+ *******************************************************************************
+ *
+ * See cluster.h for the partition, the frames and what crosses a link.
+ *
+ * HANDOFF FRAME (after the 4-byte header, big-endian):
+ *
+ *   [u8 len][username]  [u8 len][password]  [u32 session_uid]
+ *   2 × ISAAC           [u32 count][u32 a][u32 b][u32 c][u32 initialized]
+ *                       [u32 rsl × 256][u32 mem × 256]      in, then out
+ *   [u32 origin_x][u32 origin_z][u32 area_digest]
+ *   [u8 allow_design][u8 run_path][u8 steps] steps × [u16 x][u16 z]
+ *   2 × container       [u8 capacity] capacity × [u16 id][u32 amount]
+ *   [u16 save length][player_save_serialize() bytes]
+ *
+ *   The save carries everything a logout would write; the rest is what
+ *   only lives in the session and the client already relies on: the
+ *   cipher positions, the loaded area, the walk in progress, and the
+ *   containers (not saved yet, see player.h).
+ *
+ ******************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "cluster.h"
+#include "account_registry.h"
+#include "buffer.h"
+#include "command.h"
+#include "instance.h"
+#include "item.h"
+#include "log.h"
+#include "login.h"
+#include "map_store.h"
+#include "movement.h"
+#include "player_list.h"
+#include "player_save.h"
+#include "presence.h"
+#include "server.h"
+#include "social.h"
+#include "update.h"
+#include "zone_grid.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+Cluster* g_cluster = NULL;
+
+/* Node of each mapsquare column (file x), cut before the fork */
+static u8 column_owner[256];
+static u32 cluster_nodes = 0;
+
+/* link_fds[i][j]: node i's end of the link to node j (-1 = none) */
+static i32 link_fds[CLUSTER_MAX_NODES][CLUSTER_MAX_NODES];
+static bool links_made = false;
+
+/* Set in the child by cluster_links_enter_node() */
+static bool node_entered = false;
+static u32 node_self = 0;
+
+/* Largest handoff body: fixed fields, two ISAACs, walk, containers, save */
+#define CLUSTER_ISAAC_BYTES ((5 + 2 * ISAAC_SIZE) * 4)
+#define CLUSTER_HANDOFF_MAX (4 + 2 + MAX_USERNAME_LENGTH + 64 + 4 + 2 * CLUSTER_ISAAC_BYTES + 12 + \
+                             3 + MAX_WAYPOINTS * 4 + 2 * (1 + 255 * 6) + 2 + PLAYER_SAVE_MAX_SIZE)
+
+/* The handoff is built in the frame buffer too: it must fit */
+typedef char cluster_handoff_fits[CLUSTER_HANDOFF_MAX <= CLUSTER_FRAME_MAX ? 1 : -1];
+
+/*******************************************************************************
+ * OWNERSHIP
+ ******************************************************************************/
+
+/*
+ * cut_columns - Split the columns into bands of about equal land
+ *
+ * A column goes to the band its middle land file falls in, so a band
+ * boundary never cuts a column and every node gets at least the columns
+ * its share lands in:
+ *
+ *   land per column   1 1 6 7 7 3 15 21 24 ... 23 22 19 20 5    (total 418)
+ *   middle × N / 418  0 0 0 0 0 0  0  0  0 ...  1  1  1  1 1
+ */
+static void cut_columns(u32 nodes) {
+    u32 land[256];
+    u32 total = 0;
+    for (u32 x = 0; x < 256; x++) {
+        land[x] = 0;
+        for (u32 z = 0; z < 256 && g_map_store; z++) {
+            if (map_store_get(g_map_store, MAP_FILE_LAND, (i32)x, (i32)z)) land[x]++;
+        }
+        total += land[x];
+    }
+
+    u32 before = 0;
+    for (u32 x = 0; x < 256; x++) {
+        u32 node = total ? (u32)(((u64)before + land[x] / 2) * nodes / total) : x * nodes / 256;
+        column_owner[x] = (u8)(node < nodes ? node : nodes - 1);
+        before += land[x];
+    }
+}
+
+u32 cluster_owner(const Cluster* cluster, const Position* pos) {
+    u32 x = position_x(pos);
+    u32 z = position_z(pos);
+    if (g_instances && instance_at(g_instances, x, z)) return cluster->node;
+    return column_owner[(x >> 6) & 0xFF];
+}
+
+/*******************************************************************************
+ * LINKS (supervisor)
+ ******************************************************************************/
+
+#ifndef _WIN32
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+static void links_close_all(void) {
+    for (u32 i = 0; i < CLUSTER_MAX_NODES; i++) {
+        for (u32 j = 0; j < CLUSTER_MAX_NODES; j++) {
+            if (links_made && link_fds[i][j] >= 0) close(link_fds[i][j]);
+            link_fds[i][j] = -1;
+        }
+    }
+}
+
+bool cluster_links_create(u32 nodes) {
+    if (nodes < 2 || nodes > CLUSTER_MAX_NODES) return false;
+    links_close_all();              /* Not made yet: only marks every end -1 */
+    links_made = true;
+    cluster_nodes = nodes;
+    cut_columns(nodes);
+
+    for (u32 i = 0; i < nodes; i++) {
+        for (u32 j = i + 1; j < nodes; j++) {
+            int pair[2];
+            if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, pair) != 0) {
+                perror("socketpair cluster");
+                links_close_all();
+                links_made = false;
+                return false;
+            }
+            fcntl(pair[0], F_SETFD, FD_CLOEXEC);
+            fcntl(pair[1], F_SETFD, FD_CLOEXEC);
+            link_fds[i][j] = pair[0];
+            link_fds[j][i] = pair[1];
+        }
+    }
+
+    for (u32 node = 0; node < nodes; node++) {
+        i32 first = -1, last = -1;
+        for (u32 x = 0; x < 256; x++) {
+            if (column_owner[x] != node) continue;
+            if (first < 0) first = (i32)x;
+            last = (i32)x;
+        }
+        printf("Cluster: node %u owns mapsquare columns %d-%d (x %d-%d)\n",
+               node, first, last, first * 64, last * 64 + 63);
+    }
+    return true;
+}
+
+void cluster_links_enter_node(u32 node) {
+    if (!links_made || node >= cluster_nodes) return;
+    for (u32 i = 0; i < CLUSTER_MAX_NODES; i++) {
+        for (u32 j = 0; j < CLUSTER_MAX_NODES; j++) {
+            if (i == node || link_fds[i][j] < 0) continue;
+            close(link_fds[i][j]);
+            link_fds[i][j] = -1;
+        }
+    }
+    node_entered = true;
+    node_self = node;
+}
+
+void cluster_links_forked(void) {
+    if (!links_made) return;
+    links_close_all();
+}
+
+/*******************************************************************************
+ * GHOST TABLE
+ ******************************************************************************/
+
+/* Base-37 names are dense in their low bits: mix before masking */
+static u32 ghost_home(const Cluster* cluster, u64 name) {
+    name ^= name >> 33;
+    name *= 0xff51afd7ed558ccdULL;
+    name ^= name >> 33;
+    return (u32)name & cluster->ghost_mask;
+}
+
+/* Index slot holding name, or the empty slot where it would go */
+static u32 ghost_slot(const Cluster* cluster, u64 name) {
+    u32 slot = ghost_home(cluster, name);
+    while (cluster->ghost_index[slot] && cluster->ghosts[cluster->ghost_index[slot] - 1].name != name) {
+        slot = (slot + 1) & cluster->ghost_mask;
+    }
+    return slot;
+}
+
+static ClusterGhost* ghost_find(const Cluster* cluster, u64 name) {
+    u16 index = cluster->ghost_index[ghost_slot(cluster, name)];
+    return index ? &cluster->ghosts[index - 1] : NULL;
+}
+
+/* Empty an index slot, shifting later entries of the probe run back */
+static void ghost_unindex(Cluster* cluster, u32 slot) {
+    u32 mask = cluster->ghost_mask;
+    u32 hole = slot;
+    for (u32 i = (slot + 1) & mask; cluster->ghost_index[i]; i = (i + 1) & mask) {
+        u32 home = ghost_home(cluster, cluster->ghosts[cluster->ghost_index[i] - 1].name);
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            cluster->ghost_index[hole] = cluster->ghost_index[i];
+            hole = i;
+        }
+    }
+    cluster->ghost_index[hole] = 0;
+}
+
+/* Base-37 back to letters and digits, for logs and ::cluster */
+static void ghost_name_decode(u64 name, char* out) {
+    char reversed[MAX_USERNAME_LENGTH + 1];
+    u32 length = 0;
+    while (name && length < MAX_USERNAME_LENGTH) {
+        u32 c = (u32)(name % 37);
+        name /= 37;
+        reversed[length++] = c == 0 ? '_' : c <= 26 ? (char)('a' + c - 1) : (char)('0' + c - 27);
+    }
+    for (u32 i = 0; i < length; i++) out[i] = reversed[length - 1 - i];
+    out[length] = '\0';
+}
+
+static void ghost_remove(Cluster* cluster, World* world, ClusterGhost* ghost) {
+    ghost_unindex(cluster, ghost_slot(cluster, ghost->name));
+    world_detach_ghost(world, &ghost->player);
+    player_free(&ghost->player);
+    ghost->name = 0;
+    cluster->ghost_count--;
+}
+
+/* A new ghost at a position with an appearance blob, attached; NULL if full */
+static ClusterGhost* ghost_add(Cluster* cluster, World* world, u64 name, u32 node, const Position* pos,
+                               const u8* blob, u8 blob_length, u8 version) {
+    if (cluster->ghost_count >= CLUSTER_GHOST_POOL) return NULL;
+    ClusterGhost* ghost = NULL;
+    for (u32 i = 0; i < CLUSTER_GHOST_POOL && !ghost; i++) {
+        if (cluster->ghosts[i].name == 0) ghost = &cluster->ghosts[i];
+    }
+    if (!ghost) return NULL;
+
+    Player* player = &ghost->player;
+    player_init(player, 0, NULL);
+    player->ghost = true;
+    ghost_name_decode(name, player->username);
+    player->position = *pos;
+    memcpy(player->appearance, blob, blob_length);
+    player->appearance_length = blob_length;
+    player->appearance_dirty = false;
+    player->appearance_version = version;
+    if (!world_attach_ghost(world, player)) {
+        player_free(player);
+        return NULL;
+    }
+
+    ghost->name = name;
+    ghost->node = (u8)node;
+    ghost->moved_tick = 0;
+    cluster->ghost_index[ghost_slot(cluster, name)] = (u16)(ghost - cluster->ghosts + 1);
+    cluster->ghost_count++;
+    return ghost;
+}
+
+static void ghosts_drop_node(Cluster* cluster, World* world, u32 node) {
+    for (u32 i = 0; i < CLUSTER_GHOST_POOL; i++) {
+        ClusterGhost* ghost = &cluster->ghosts[i];
+        if (ghost->name && ghost->node == node) ghost_remove(cluster, world, ghost);
+    }
+}
+
+/*******************************************************************************
+ * NODE
+ ******************************************************************************/
+
+Cluster* cluster_create(void) {
+    if (!node_entered) return NULL;
+
+    Cluster* cluster = (Cluster*)calloc(1, sizeof(Cluster));
+    if (!cluster) return NULL;
+    cluster->node = node_self;
+    cluster->nodes = cluster_nodes;
+    cluster->ghosts = (ClusterGhost*)calloc(CLUSTER_GHOST_POOL, sizeof(ClusterGhost));
+    cluster->ghost_mask = CLUSTER_GHOST_POOL * 2 - 1;
+    cluster->ghost_index = (u16*)calloc(CLUSTER_GHOST_POOL * 2, sizeof(u16));
+    cluster->frame = (u8*)malloc(CLUSTER_FRAME_MAX);
+    cluster->ghosted = (u16*)malloc(MAX_PLAYERS * sizeof(u16));
+    cluster->ghosted_peers = (u16*)malloc(MAX_PLAYERS * sizeof(u16));
+    bool ok = cluster->ghosts && cluster->ghost_index && cluster->frame &&
+              cluster->ghosted && cluster->ghosted_peers;
+
+    for (u32 node = 0; node < CLUSTER_MAX_NODES; node++) {
+        ClusterLink* link = &cluster->links[node];
+        link->fd = link_fds[node_self][node];
+        link_fds[node_self][node] = -1;
+        if (link->fd < 0) continue;
+        link->sent = (ClusterSent*)calloc(MAX_PLAYERS, sizeof(ClusterSent));
+        if (!link->sent) ok = false;
+    }
+    if (!ok) {
+        fprintf(stderr, "WARNING: Failed to create cluster state, node %u runs alone\n", node_self);
+        cluster_destroy(cluster, NULL);
+        return NULL;
+    }
+    printf("Cluster: node %u of %u\n", cluster->node, cluster->nodes);
+    return cluster;
+}
+
+void cluster_destroy(Cluster* cluster, World* world) {
+    if (!cluster) return;
+    if (cluster->ghosts) {
+        for (u32 i = 0; i < CLUSTER_GHOST_POOL; i++) {
+            ClusterGhost* ghost = &cluster->ghosts[i];
+            if (!ghost->name) continue;
+            if (world) world_detach_ghost(world, &ghost->player);
+            player_free(&ghost->player);
+        }
+    }
+    for (u32 node = 0; node < CLUSTER_MAX_NODES; node++) {
+        if (cluster->links[node].fd >= 0) close(cluster->links[node].fd);
+        free(cluster->links[node].sent);
+    }
+    if (cluster->ghost_frames_sent > 0 || cluster->handoffs_in > 0 || cluster->handoffs_out > 0) {
+        printf("Cluster: %llu ghost frames sent, %llu dropped, handoffs %llu out, %llu in, %llu failed\n",
+               (unsigned long long)cluster->ghost_frames_sent,
+               (unsigned long long)cluster->ghost_frames_dropped,
+               (unsigned long long)cluster->handoffs_out, (unsigned long long)cluster->handoffs_in,
+               (unsigned long long)cluster->handoffs_failed);
+    }
+    free(cluster->ghosts);
+    free(cluster->ghost_index);
+    free(cluster->frame);
+    free(cluster->ghosted);
+    free(cluster->ghosted_peers);
+    free(cluster);
+}
+
+static void link_down(Cluster* cluster, World* world, u32 node) {
+    ClusterLink* link = &cluster->links[node];
+    if (link->fd < 0) return;
+    close(link->fd);
+    link->fd = -1;
+    ghosts_drop_node(cluster, world, node);
+    LOG_WARN("Cluster: link to node %u closed\n", node);
+}
+
+/* One frame and, if passed, the socket with it (-1 = none); 0 = link closed */
+static ssize_t link_recv(i32 fd, u8* frame, u32 size, i32* passed) {
+    struct iovec iov = { frame, size };
+    union {
+        struct cmsghdr align;
+        u8 buf[CMSG_SPACE(sizeof(int))];
+    } control;
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    ssize_t length;
+    do {
+        length = recvmsg(fd, &msg, MSG_DONTWAIT);
+    } while (length < 0 && errno == EINTR);
+
+    *passed = -1;
+    if (length < 0) return length;
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            memcpy(passed, CMSG_DATA(cmsg), sizeof(int));
+            fcntl(*passed, F_SETFD, FD_CLOEXEC);
+        }
+    }
+    if (msg.msg_flags & MSG_TRUNC) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+    return length;
+}
+
+/* Send one frame, with a socket if fd >= 0; false with errno set */
+static bool link_send(i32 link_fd, const u8* frame, u32 length, i32 fd) {
+    struct iovec iov = { (void*)frame, length };
+    union {
+        struct cmsghdr align;
+        u8 buf[CMSG_SPACE(sizeof(int))];
+    } control;
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    if (fd >= 0) {
+        memset(&control, 0, sizeof(control));
+        msg.msg_control = control.buf;
+        msg.msg_controllen = sizeof(control.buf);
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    }
+    ssize_t sent;
+    do {
+        sent = sendmsg(link_fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+    } while (sent < 0 && errno == EINTR);
+    return sent == (ssize_t)length;
+}
+
+static void frame_header(StreamBuffer* out, ClusterOp op, u32 node, u32 count) {
+    buffer_put_u8(out, (u8)op);
+    buffer_put_u8(out, (u8)node);
+    buffer_put_u16(out, (u16)count);
+}
+
+/*******************************************************************************
+ * HANDOFF
+ ******************************************************************************/
+
+static void put_isaac(StreamBuffer* out, const ISAACCipher* cipher) {
+    buffer_put_u32(out, cipher->count);
+    buffer_put_u32(out, cipher->a);
+    buffer_put_u32(out, cipher->b);
+    buffer_put_u32(out, cipher->c);
+    buffer_put_u32(out, cipher->initialized);
+    for (u32 i = 0; i < ISAAC_SIZE; i++) buffer_put_u32(out, cipher->rsl[i]);
+    for (u32 i = 0; i < ISAAC_SIZE; i++) buffer_put_u32(out, cipher->mem[i]);
+}
+
+static void get_isaac(StreamBuffer* in, ISAACCipher* cipher) {
+    cipher->count = buffer_get_u32(in);
+    cipher->a = buffer_get_u32(in);
+    cipher->b = buffer_get_u32(in);
+    cipher->c = buffer_get_u32(in);
+    cipher->initialized = buffer_get_u32(in);
+    for (u32 i = 0; i < ISAAC_SIZE; i++) cipher->rsl[i] = buffer_get_u32(in);
+    for (u32 i = 0; i < ISAAC_SIZE; i++) cipher->mem[i] = buffer_get_u32(in);
+}
+
+static void put_string(StreamBuffer* out, const char* s, u32 max) {
+    u32 length = (u32)strnlen(s, max);
+    buffer_put_u8(out, (u8)length);
+    memcpy(out->data + out->position, s, length);
+    out->position += length;
+}
+
+static void put_container(StreamBuffer* out, const ItemContainer* container) {
+    u32 capacity = container ? container->capacity : 0;
+    if (capacity > 255) capacity = 255;
+    buffer_put_u8(out, (u8)capacity);
+    for (u32 slot = 0; slot < capacity; slot++) {
+        const Item* item = item_container_get(container, slot);
+        buffer_put_u16(out, item ? item->id : 0);
+        buffer_put_u32(out, item ? item->amount : 0);
+    }
+}
+
+/* Encode a player into the frame buffer; the frame's length */
+static u32 handoff_encode(Cluster* cluster, const Player* player) {
+    StreamBuffer out;
+    buffer_init_external(&out, cluster->frame, CLUSTER_FRAME_MAX);
+    frame_header(&out, CLUSTER_OP_HANDOFF, cluster->node, 1);
+    put_string(&out, player->username, MAX_USERNAME_LENGTH);
+    put_string(&out, player->password, sizeof(player->password) - 1);
+    buffer_put_u32(&out, player->session_uid);
+    put_isaac(&out, &player->conn->in_cipher);
+    put_isaac(&out, &player->conn->out_cipher);
+    buffer_put_u32(&out, player->origin_x);
+    buffer_put_u32(&out, player->origin_z);
+    buffer_put_u32(&out, player->area_digest);
+    buffer_put_u8(&out, player->allow_design ? 1 : 0);
+
+    /* The walk in progress, oldest step first */
+    const MovementHandler* movement = &player->movement;
+    buffer_put_u8(&out, movement->run_path ? 1 : 0);
+    buffer_put_u8(&out, (u8)movement->waypoint_count);
+    for (u32 i = 0; i < movement->waypoint_count; i++) {
+        u32 level, x, z;
+        coord_unpack((u32)movement->waypoints[(movement->waypoint_head + i) % MAX_WAYPOINTS], &level, &x, &z);
+        buffer_put_u16(&out, (u16)x);
+        buffer_put_u16(&out, (u16)z);
+    }
+
+    put_container(&out, player->inventory);
+    put_container(&out, player->equipment);
+
+    size_t save = player_save_serialize(player, out.data + out.position + 2);
+    buffer_put_u16(&out, (u16)save);
+    out.position += (u32)save;
+    return out.position;
+}
+
+/*
+ * handoff_ready - Target node of a player to hand off, or -1
+ *
+ * Only a plain TCP connection between packets: nothing half-read, no map
+ * download queued, nothing left in the output after a flush.
+ */
+static i32 handoff_ready(const Cluster* cluster, Player* player) {
+    if (player->socket_fd < 0 || player->linger_until || !player->conn_pooled) return -1;
+    u32 owner = cluster_owner(cluster, &player->position);
+    if (owner == cluster->node || cluster->links[owner].fd < 0) return -1;
+
+    const PlayerConnection* conn = player->conn;
+    if (g_netio || conn->ws.state != WS_STATE_NONE || conn->map_queue_count > 0) return -1;
+    if (conn->in_read != conn->in_buffer_size || conn->in_opcode != -1 || conn->in_paused) return -1;
+    return (i32)owner;
+}
+
+/* Send one player and its socket; true once it is the target's */
+static bool handoff_send(Cluster* cluster, Player* player, u32 target) {
+    if (!player_flush(player) || player->conn->out_stream.position != 0) return false;
+    if (!account_registry_transfer(g_account_registry, player->username, cluster->node, target)) return false;
+
+    u32 length = handoff_encode(cluster, player);
+    if (!link_send(cluster->links[target].fd, cluster->frame, length, player->socket_fd)) {
+        int error = errno;
+        account_registry_transfer(g_account_registry, player->username, target, cluster->node);
+        if (error == EPIPE || error == ECONNRESET) link_down(cluster, g_world, target);
+        return false;
+    }
+
+    /* The target has the socket: close this copy, leave without a trace */
+    LOG_INFO("Cluster: %s handed to node %u at (%u, %u)\n", player->username, target,
+             position_x(&player->position), position_z(&player->position));
+    network_unwatch(&g_server->network, player->socket_fd);
+    close(player->socket_fd);
+    player->socket_fd = -1;
+    social_player_logout(g_social, player);
+    player_drop(player);
+    cluster->handoffs_out++;
+    return true;
+}
+
+/* A player sent here could not be taken in: keep its save, free the name */
+static void handoff_refuse(Cluster* cluster, const char* username, const u8* save, u32 save_size) {
+    if (save_size > 0) player_save_write(username, save, save_size);
+    presence_disown(username);
+    account_registry_drop(g_account_registry, username, cluster->node);
+    cluster->handoffs_failed++;
+    LOG_WARN("Cluster: could not take in %s, saved and logged out\n", username);
+}
+
+static bool get_string(StreamBuffer* in, char* out, u32 max) {
+    if (!buffer_require(in, 1)) return false;
+    u32 length = buffer_get_u8(in);
+    if (length > max || !buffer_require(in, length)) return false;
+    buffer_get_bytes(in, (u8*)out, length);
+    out[length] = '\0';
+    return true;
+}
+
+static bool get_container(StreamBuffer* in, ItemContainer* container) {
+    if (!buffer_require(in, 1)) return false;
+    u32 capacity = buffer_get_u8(in);
+    if (!buffer_require(in, capacity * 6)) return false;
+    for (u32 slot = 0; slot < capacity; slot++) {
+        u16 id = buffer_get_u16(in);
+        u32 amount = buffer_get_u32(in);
+        if (id != 0 && amount != 0) item_container_set(container, slot, id, amount);
+    }
+    item_container_clear_dirty(container);
+    return true;
+}
+
+/*
+ * handoff_receive - Take in a player another node sent with its socket
+ */
+static void handoff_receive(Cluster* cluster, World* world, u32 node, u8* frame, u32 length, i32 fd) {
+    StreamBuffer in;
+    buffer_init_view(&in, frame, length);
+    buffer_skip(&in, 4);
+
+    char username[MAX_USERNAME_LENGTH + 1];
+    char password[64];
+    if (fd < 0 || !get_string(&in, username, MAX_USERNAME_LENGTH) ||
+        !get_string(&in, password, sizeof(password) - 1) ||
+        !buffer_require(&in, 4 + 2 * CLUSTER_ISAAC_BYTES + 12 + 3)) {
+        if (fd >= 0) close(fd);
+        cluster->handoffs_failed++;
+        LOG_WARN("Cluster: malformed handoff from node %u\n", node);
+        return;
+    }
+
+    /* The save goes last: find it first, it is all a refusal needs */
+    u32 session_uid = buffer_get_u32(&in);
+    u32 ciphers = in.position;
+    buffer_skip(&in, 2 * CLUSTER_ISAAC_BYTES);
+    u32 origin_x = buffer_get_u32(&in);
+    u32 origin_z = buffer_get_u32(&in);
+    u32 area_digest = buffer_get_u32(&in);
+    bool allow_design = buffer_get_u8(&in) != 0;
+    bool run_path = buffer_get_u8(&in) != 0;
+    u32 steps = buffer_get_u8(&in);
+    u32 step_x[MAX_WAYPOINTS], step_z[MAX_WAYPOINTS];
+    if (steps > MAX_WAYPOINTS || !buffer_require(&in, steps * 4)) steps = 0;
+    for (u32 i = 0; i < steps; i++) {
+        step_x[i] = buffer_get_u16(&in);
+        step_z[i] = buffer_get_u16(&in);
+    }
+    u32 containers = in.position;
+    for (u32 c = 0; c < 2 && buffer_require(&in, 1); c++) {
+        u32 capacity = buffer_get_u8(&in);
+        buffer_skip(&in, buffer_require(&in, capacity * 6) ? capacity * 6 : 0);
+    }
+    const u8* save = NULL;
+    u32 save_size = 0;
+    if (buffer_require(&in, 2)) {
+        save_size = buffer_get_u16(&in);
+        if (buffer_require(&in, save_size)) save = in.data + in.position;
+        else save_size = 0;
+    }
+
+    /* It was shown here as a ghost until now */
+    ClusterGhost* ghost = ghost_find(cluster, username_to_base37(username));
+    if (ghost) ghost_remove(cluster, world, ghost);
+
+    Player* player = server_attach_socket(g_server, fd);
+    if (!player) {
+        handoff_refuse(cluster, username, save, save_size);
+        return;
+    }
+    snprintf(player->username, sizeof(player->username), "%s", username);
+    snprintf(player->password, sizeof(player->password), "%s", password);
+    player->session_uid = session_uid;
+    in.position = ciphers;
+    get_isaac(&in, &player->conn->in_cipher);
+    get_isaac(&in, &player->conn->out_cipher);
+
+    player_load_buffer(player, save, save_size);
+    player->state = PLAYER_STATE_LOGGED_IN;
+    command_player_login(player);
+    in.position = containers;
+    if (!get_container(&in, player->inventory)) item_container_clear(player->inventory);
+    if (!get_container(&in, player->equipment)) item_container_clear(player->equipment);
+    player->allow_design = allow_design;
+
+    /* Registered and placed where it stands; the client keeps its scene */
+    login_send_initial_packets(player);
+    if (player_list_get(world->player_list, (u16)player->index) != player) {
+        player_drop(player);
+        handoff_refuse(cluster, username, save, save_size);
+        return;
+    }
+    player->origin_x = origin_x;
+    player->origin_z = origin_z;
+    player->area_digest = area_digest;
+    movement_set_run_path(&player->movement, run_path);
+    movement_add_path(&player->movement, step_x, step_z, steps);
+
+    presence_online(player);
+    social_player_login(g_social, player);
+    player->save_dirty = true;
+    cluster->handoffs_in++;
+    LOG_INFO("Cluster: %s handed over from node %u at (%u, %u)\n", player->username, node,
+             position_x(&player->position), position_z(&player->position));
+}
+
+/*******************************************************************************
+ * GHOST FRAMES
+ ******************************************************************************/
+
+/*
+ * ghost_apply - One entry of a ghost frame
+ *
+ * @return  false if the frame is malformed from here on
+ *
+ * A step the directions explain is shown as a walk or run; any other
+ * change of position (a teleport, or a frame missed) detaches the ghost
+ * and attaches it again, so viewers remove it and add it where it is.
+ */
+static bool ghost_apply(Cluster* cluster, World* world, u32 node, StreamBuffer* in, u64 stamp, u64 tick) {
+    if (!buffer_require(in, 16)) return false;
+    u64 name = buffer_get_u64(in);
+    u32 x = buffer_get_u16(in);
+    u32 z = buffer_get_u16(in);
+    u32 level = buffer_get_u8(in) & 3;
+    u8 dirs = buffer_get_u8(in);
+    u8 version = buffer_get_u8(in);
+    u8 blob_length = buffer_get_u8(in);
+    if (blob_length > APPEARANCE_BLOB_SIZE || !buffer_require(in, blob_length)) return false;
+    const u8* blob = in->data + in->position;
+    buffer_skip(in, blob_length);
+
+    /* Handed here already (its frame was sent before the handoff) */
+    if (name == 0 || world_get_player_by_name(world, name)) return true;
+
+    Position pos;
+    position_init(&pos, x, z, level);
+    ClusterGhost* ghost = ghost_find(cluster, name);
+    if (!ghost) {
+        /* Shown once its appearance is known; the owner sends it again */
+        if (blob_length == 0) return true;
+        ghost = ghost_add(cluster, world, name, node, &pos, blob, blob_length, version);
+        if (ghost) ghost->seen = stamp;
+        return true;
+    }
+    ghost->node = (u8)node;
+    ghost->seen = stamp;
+
+    Player* player = &ghost->player;
+    i32 primary = (i32)(dirs & 0xF) - 1;
+    i32 secondary = (i32)(dirs >> 4) - 1;
+    if (primary > 7 || secondary > 7) return false;
+    if (x != position_x(&player->position) || z != position_z(&player->position) ||
+        level != position_height(&player->position)) {
+        i32 step_x = (i32)position_x(&player->position);
+        i32 step_z = (i32)position_z(&player->position);
+        if (primary >= 0) {
+            step_x += DIRECTION_DELTA_X[primary];
+            step_z += DIRECTION_DELTA_Z[primary];
+        }
+        if (secondary >= 0) {
+            step_x += DIRECTION_DELTA_X[secondary];
+            step_z += DIRECTION_DELTA_Z[secondary];
+        }
+        bool walked = primary >= 0 && ghost->moved_tick != tick && level == position_height(&player->position) &&
+                      step_x == (i32)x && step_z == (i32)z;
+        player->position = pos;
+        if (walked) {
+            player->primary_direction = primary;
+            player->secondary_direction = secondary;
+            ghost->moved_tick = tick;
+            zone_grid_update(world->zone_grid, player->index, &player->position);
+            player_list_mark_changed(world->player_list, player);
+        } else {
+            world_detach_ghost(world, player);
+            player->primary_direction = -1;
+            player->secondary_direction = -1;
+            if (!world_attach_ghost(world, player)) {
+                ghost_unindex(cluster, ghost_slot(cluster, name));
+                player_free(player);
+                ghost->name = 0;
+                cluster->ghost_count--;
+                return true;
+            }
+        }
+    }
+
+    if (blob_length > 0 && (version != player->appearance_version || blob_length != player->appearance_length ||
+                            memcmp(blob, player->appearance, blob_length) != 0)) {
+        memcpy(player->appearance, blob, blob_length);
+        player->appearance_length = blob_length;
+        player->appearance_dirty = false;
+        /* The owner's counter wrapped (player_appearance_changed): stamps
+         * viewers cached before the wrap must not match the new count */
+        if (version < player->appearance_version) world_forget_appearance(world, (u16)player->index);
+        player->appearance_version = version;
+        player->update_flags |= UPDATE_APPEARANCE;
+        update_invalidate_block_cache(player);
+        player_list_mark_changed(world->player_list, player);
+    }
+    return true;
+}
+
+static void ghost_frame_apply(Cluster* cluster, World* world, u32 node, const u8* frame, u32 length, u64 tick) {
+    StreamBuffer in;
+    buffer_init_view(&in, frame, length);
+    buffer_skip(&in, 2);
+    u32 count = buffer_get_u16(&in);
+    u64 stamp = ++cluster->frames_applied;
+    for (u32 e = 0; e < count; e++) {
+        if (!ghost_apply(cluster, world, node, &in, stamp, tick)) {
+            LOG_WARN("Cluster: malformed ghost frame from node %u\n", node);
+            return;
+        }
+    }
+
+    /* Not listed any more: out of range of this node, or gone */
+    for (u32 i = 0; i < CLUSTER_GHOST_POOL; i++) {
+        ClusterGhost* ghost = &cluster->ghosts[i];
+        if (ghost->name && ghost->node == node && ghost->seen != stamp) ghost_remove(cluster, world, ghost);
+    }
+}
+
+/* Every frame waiting on one link, but one ghost frame per tick */
+static void link_receive(Cluster* cluster, World* world, u32 node, u64 tick) {
+    ClusterLink* link = &cluster->links[node];
+    bool waiting = false;
+    while (link->fd >= 0) {
+        u8 head[4];
+        ssize_t peeked = recv(link->fd, head, sizeof(head), MSG_PEEK | MSG_DONTWAIT);
+        if (peeked < 0 && errno == EINTR) continue;
+        if (peeked < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (peeked <= 0) {
+            link_down(cluster, world, node);
+            break;
+        }
+        if (head[0] == CLUSTER_OP_GHOSTS && link->applied_tick == tick && link->behind < CLUSTER_BACKLOG_MAX) {
+            waiting = true;
+            break;
+        }
+
+        i32 fd;
+        ssize_t length = link_recv(link->fd, cluster->frame, CLUSTER_FRAME_MAX, &fd);
+        if (length <= 0) {
+            if (fd >= 0) close(fd);
+            if (length < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            if (length < 0 && errno == EMSGSIZE) continue;
+            link_down(cluster, world, node);
+            break;
+        }
+        if (length >= 4 && cluster->frame[0] == CLUSTER_OP_HANDOFF) {
+            handoff_receive(cluster, world, node, cluster->frame, (u32)length, fd);
+            continue;
+        }
+        if (fd >= 0) close(fd);
+        if (length >= 4 && cluster->frame[0] == CLUSTER_OP_GHOSTS) {
+            ghost_frame_apply(cluster, world, node, cluster->frame, (u32)length, tick);
+            link->applied_tick = tick;
+        }
+    }
+    link->behind = waiting ? link->behind + 1 : 0;
+}
+
+void cluster_receive(Cluster* cluster, World* world, u64 tick) {
+    if (!cluster || !world) return;
+
+    /* A ghost no frame moves this tick stands */
+    for (u32 i = 0; i < CLUSTER_GHOST_POOL; i++) {
+        ClusterGhost* ghost = &cluster->ghosts[i];
+        if (!ghost->name) continue;
+        ghost->player.primary_direction = -1;
+        ghost->player.secondary_direction = -1;
+    }
+
+    for (u32 node = 0; node < cluster->nodes; node++) {
+        if (node != cluster->node) link_receive(cluster, world, node, tick);
+    }
+
+    /* Encoded here, so PLAYER_INFO workers only read them (update_pool.h) */
+    for (u32 i = 0; i < CLUSTER_GHOST_POOL; i++) {
+        if (cluster->ghosts[i].name) update_prepare_blocks(&cluster->ghosts[i].player);
+    }
+}
+
+/*
+ * ghost_frame_send - This tick's ghosts for one neighbour
+ *
+ * The appearance blob goes along when the neighbour may not have it: a
+ * new name for the PID, not listed last tick, a new version, or the
+ * PID's turn in the CLUSTER_BLOB_REFRESH_TICKS cycle.
+ */
+static void ghost_frame_send(Cluster* cluster, World* world, u32 node, u64 tick) {
+    ClusterLink* link = &cluster->links[node];
+    StreamBuffer out;
+    buffer_init_external(&out, cluster->frame, CLUSTER_FRAME_MAX);
+    frame_header(&out, CLUSTER_OP_GHOSTS, cluster->node, 0);
+
+    u32 count = 0;
+    for (u32 i = 0; i < cluster->ghosted_count && count < CLUSTER_GHOSTS_MAX; i++) {
+        if (!(cluster->ghosted_peers[i] & (1u << node))) continue;
+        Player* player = world->player_list->players[cluster->ghosted[i]];
+        u16 pid = (u16)player->index;
+        u64 name = username_to_base37(player->username);
+        const ClusterSent* sent = &link->sent[pid];
+        bool blob = player->appearance_length > 0 && !player->appearance_dirty &&
+                    (sent->name != name || sent->tick + 1 != tick || sent->version != player->appearance_version ||
+                     (tick + pid) % CLUSTER_BLOB_REFRESH_TICKS == 0);
+
+        buffer_put_u64(&out, name);
+        buffer_put_u16(&out, (u16)position_x(&player->position));
+        buffer_put_u16(&out, (u16)position_z(&player->position));
+        buffer_put_u8(&out, (u8)position_height(&player->position));
+        buffer_put_u8(&out, (u8)((player->primary_direction + 1) | ((player->secondary_direction + 1) << 4)));
+        buffer_put_u8(&out, player->appearance_version);
+        buffer_put_u8(&out, blob ? player->appearance_length : 0);
+        if (blob) {
+            memcpy(out.data + out.position, player->appearance, player->appearance_length);
+            out.position += player->appearance_length;
+        }
+        cluster->frame_pids[count] = pid;
+        cluster->frame_blobs[count] = blob;
+        count++;
+    }
+    cluster->frame[2] = (u8)(count >> 8);
+    cluster->frame[3] = (u8)count;
+
+    /* Nothing listed twice in a row: the neighbour holds no ghosts of ours */
+    if (count == 0 && link->listed == 0) return;
+
+    if (!link_send(link->fd, cluster->frame, out.position, -1)) {
+        cluster->ghost_frames_dropped++;
+        if (errno == EPIPE || errno == ECONNRESET) link_down(cluster, world, node);
+        return;
+    }
+    cluster->ghost_frames_sent++;
+    link->listed = count;
+    for (u32 e = 0; e < count; e++) {
+        const Player* player = world->player_list->players[cluster->frame_pids[e]];
+        ClusterSent* sent = &link->sent[cluster->frame_pids[e]];
+        sent->name = username_to_base37(player->username);
+        sent->tick = tick;
+        if (cluster->frame_blobs[e]) sent->version = player->appearance_version;
+    }
+}
+
+void cluster_send(Cluster* cluster, World* world, u64 tick) {
+    if (!cluster || !world || !g_server) return;
+    PlayerList* list = world->player_list;
+
+    /* Handoffs first: a player handed off is not ghosted back to its new node */
+    Player* leaving[CLUSTER_HANDOFFS_PER_TICK];
+    u32 targets[CLUSTER_HANDOFFS_PER_TICK];
+    u32 leaving_count = 0;
+    for (u32 i = 0; i < list->count && leaving_count < CLUSTER_HANDOFFS_PER_TICK; i++) {
+        i32 target = handoff_ready(cluster, list->active[i]);
+        if (target < 0) continue;
+        leaving[leaving_count] = list->active[i];
+        targets[leaving_count++] = (u32)target;
+    }
+    for (u32 i = 0; i < leaving_count; i++) handoff_send(cluster, leaving[i], targets[i]);
+
+    /*
+     * Who is near which neighbour. The bands are columns, so only X
+     * matters: the columns CLUSTER_GHOST_RANGE either side, and the
+     * player's own (one that could not be handed off yet).
+     */
+    cluster->ghosted_count = 0;
+    for (u32 i = 0; i < list->count; i++) {
+        const Player* player = list->active[i];
+        u32 x = position_x(&player->position);
+        if (g_instances && instance_at(g_instances, x, position_z(&player->position))) continue;
+        u32 west = x >= CLUSTER_GHOST_RANGE ? x - CLUSTER_GHOST_RANGE : 0;
+        u32 east = x + CLUSTER_GHOST_RANGE;
+        u16 peers = (u16)((1u << column_owner[(west >> 6) & 0xFF]) | (1u << column_owner[(x >> 6) & 0xFF]) |
+                          (1u << column_owner[(east >> 6) & 0xFF]));
+        peers &= (u16)~(1u << cluster->node);
+        if (!peers) continue;
+        cluster->ghosted[cluster->ghosted_count] = (u16)player->index;
+        cluster->ghosted_peers[cluster->ghosted_count++] = peers;
+    }
+
+    /* One frame per live link (an empty one once, to clear the ghosts there) */
+    for (u32 node = 0; node < cluster->nodes; node++) {
+        if (node != cluster->node && cluster->links[node].fd >= 0) ghost_frame_send(cluster, world, node, tick);
+    }
+}
+
+#else /* _WIN32 */
+
+bool cluster_links_create(u32 nodes) {
+    (void)nodes;
+    return false;
+}
+
+void cluster_links_enter_node(u32 node) { (void)node; }
+void cluster_links_forked(void) {}
+
+Cluster* cluster_create(void) { return NULL; }
+
+void cluster_destroy(Cluster* cluster, World* world) {
+    (void)world;
+    free(cluster);
+}
+
+void cluster_receive(Cluster* cluster, World* world, u64 tick) { (void)cluster; (void)world; (void)tick; }
+void cluster_send(Cluster* cluster, World* world, u64 tick) { (void)cluster; (void)world; (void)tick; }
+
+#endif /* _WIN32 */
@@ -0,0 +1,282 @@
+/*******************************************************************************
+ * CLUSTER.H - One World Across Several Nodes: Region Ownership and Ghosts
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Spatial partitioning of a simulation across processes
+ *   - Ghost (replica) entities at partition boundaries
+ *   - Moving a live connection between processes (SCM_RIGHTS)
+ *
+ * THE PROBLEM:
+ *
+ * --worlds N runs N separate worlds: a player on world 1 never sees one
+ * on world 2. One world is one process, and one game thread runs every
+ * player of it through world_process(). To grow one world past what a
+ * single tick can carry, its map has to be split between processes,
+ * without the players noticing where the split is:
+ *
+ *          node 0                 │                node 1
+ *                                 │
+ *              alice ●  ──────────┼────→   sees bob? walks across?
+ *                                 │   ● bob
+ *                                 │
+ *                              boundary
+ *
+ * THE SOLUTION - OWN REGIONS, GHOST THE EDGES, HAND OFF THE SOCKET:
+ *
+ *   bin/rs225 --cluster 2        (supervisor.h: one asset load, 2 nodes)
+ *
+ *   1. OWNERSHIP. Every mapsquare column (64 tiles of X) belongs to one
+ *      node. The columns are split into N contiguous bands holding about
+ *      the same number of land files, so each node gets a similar share
+ *      of the map, not of the empty sea:
+ *
+ *        file x  29 .. 43 │ 44 .. 53          (N = 2, 418 land files)
+ *                node 0   │ node 1           Lumbridge (50, 50): node 1
+ *
+ *      The table is built once before the fork and read by every node.
+ *      A tile inside an instance (instance.h) is always the local node's.
+ *
+ *   2. GHOSTS. Each tick every node sends each neighbour one datagram
+ *      listing its players within CLUSTER_GHOST_RANGE tiles of that
+ *      neighbour's squares. The receiver keeps them as ghost Players:
+ *      a PID and a zone grid entry (world_attach_ghost), nothing else.
+ *      Its PLAYER_INFO adds, moves and removes them like anyone else:
+ *
+ *        node 0                               node 1
+ *        alice (2812, 3200) ── GHOSTS ───→    ghost alice, PID 7
+ *                                             bob's PLAYER_INFO adds 7
+ *        alice walks east   ── dir 2 ────→    ghost steps, viewers see
+ *                                             a walk, not a teleport
+ *
+ *      A ghost is read-only: no tick phase moves it, it cannot fight or
+ *      trade, and it is never saved. Its appearance block is the owner's
+ *      encoded blob, sent again only when it changed (appearance_version)
+ *      and every CLUSTER_BLOB_REFRESH_TICKS for a receiver that missed it.
+ *
+ *   3. HANDOFF. A player standing on a square another node owns is moved
+ *      there at the end of the tick, socket and all:
+ *
+ *        source (end of tick)                 target (next tick)
+ *        ───────────────────────              ─────────────────────────
+ *        flush output                         take the fd, a free slot
+ *        account_registry_transfer()          restore ciphers, save,
+ *        HANDOFF frame + the socket ──────→   containers, walk queue
+ *        unwatch and close its copy           register, presence online
+ *        drop the slot (no save, no           (the client's scene and
+ *        logout packet, no offline)           loaded area are kept)
+ *
+ *      The client does not reconnect: its next packet is read by the
+ *      target with the same ISAAC state. The account claim moves
+ *      without being freed, so no second login can slip in between.
+ *
+ * THE LINKS:
+ *   One SOCK_SEQPACKET socket pair per pair of nodes, made before the
+ *   fork: a full mesh, one message per frame, no framing code. Frames
+ *   start like presence.h frames:
+ *
+ *     [u8 op][u8 node][u16 count] entries...         (big-endian)
+ *
+ *     GHOSTS   count × [u64 name][u16 x][u16 z][u8 level][u8 dirs]
+ *                      [u8 version][u8 blob length][blob]
+ *              dirs: primary + 1 (low nibble), secondary + 1 (high)
+ *     HANDOFF  count = 1, the player's state (cluster.c), one socket
+ *              passed alongside (SCM_RIGHTS)
+ *
+ *   Sends never block: a ghost frame that does not fit is dropped (the
+ *   next one carries the same positions), a handoff that does not fit
+ *   is retried next tick with the player still here.
+ *
+ * ORDER IN THE TICK:
+ *   cluster_receive()  after input, before world_process(): handoffs in,
+ *                      one ghost frame per neighbour applied
+ *   cluster_send()     after world_process(): handoffs out, ghost frames
+ *
+ *   A receiver that finds more than one ghost frame waiting applies one
+ *   per tick, so two nodes' tick clocks drifting apart do not make ghosts
+ *   stutter; only a backlog above CLUSTER_BACKLOG_MAX is drained at once.
+ *
+ * LIMITS:
+ *   - One host: the links are socket pairs between forked processes.
+ *     Nodes on other hosts would need a TCP link and a socket migration
+ *     the kernel cannot do, i.e. a reconnect.
+ *   - Only players cross. NPCs, ground items, locs, chat and hitsplats
+ *     stay on their node; across the boundary only player movement and
+ *     appearance are seen.
+ *   - WebSocket and --net-thread connections are not handed off (their
+ *     state is not only in the socket); they play on where they are.
+ *   - A handoff in flight to a node that exits is lost like a crash.
+ *
+ * THREAD SAFETY:
+ *   Game thread only.
+ *
+ ******************************************************************************/
+
+#ifndef CLUSTER_H
+#define CLUSTER_H
+
+#include "types.h"
+#include "player.h"
+#include "position.h"
+#include "supervisor.h"
+#include "world.h"
+#include <stdbool.h>
+
+/* Most nodes (one per supervisor world) */
+#define CLUSTER_MAX_NODES SUPERVISOR_MAX_WORLDS
+
+/* A player this close to a neighbour's squares is ghosted there */
+#define CLUSTER_GHOST_RANGE 16
+
+/* Entries in one ghost frame; players past it are not ghosted that tick */
+#define CLUSTER_GHOSTS_MAX 512
+
+/* Ghosts one node holds, from all its neighbours */
+#define CLUSTER_GHOST_POOL (CLUSTER_GHOSTS_MAX * 2)
+
+/* Ticks between unconditional appearance blobs per ghost */
+#define CLUSTER_BLOB_REFRESH_TICKS 16
+
+/* Handoffs a node starts per tick */
+#define CLUSTER_HANDOFFS_PER_TICK 32
+
+/* Ticks a link may stay one ghost frame behind before it is drained */
+#define CLUSTER_BACKLOG_MAX 5
+
+/* Largest frame: a full ghost frame (a handoff is smaller) */
+#define CLUSTER_GHOST_ENTRY_MAX (16 + APPEARANCE_BLOB_SIZE)
+#define CLUSTER_FRAME_MAX (4 + CLUSTER_GHOSTS_MAX * CLUSTER_GHOST_ENTRY_MAX)
+
+typedef enum {
+    CLUSTER_OP_GHOSTS = 1,      /* This tick's players near the receiver */
+    CLUSTER_OP_HANDOFF = 2,     /* One player and its socket */
+} ClusterOp;
+
+/*
+ * ClusterGhost - A player of another node, as this node shows it
+ */
+typedef struct {
+    Player player;              /* Attached to g_world while in use */
+    u64 name;                   /* Base-37, 0 = free */
+    u8 node;                    /* Owning node */
+    u64 seen;                   /* Stamp of the last ghost frame that listed it */
+    u64 moved_tick;             /* Tick its directions were set */
+} ClusterGhost;
+
+/*
+ * ClusterSent - What a neighbour was last sent for one local PID
+ */
+typedef struct {
+    u64 name;
+    u64 tick;                   /* Tick of the frame (0 = never) */
+    u8 version;                 /* appearance_version in its last blob */
+} ClusterSent;
+
+/*
+ * ClusterLink - This node's end of the link to one other node
+ */
+typedef struct {
+    i32 fd;                     /* -1 = no link (self, or the peer is gone) */
+    u64 applied_tick;           /* Tick a ghost frame was last applied */
+    u32 behind;                 /* Ticks in a row a ghost frame was left waiting */
+    u32 listed;                 /* Entries in the last ghost frame sent */
+    ClusterSent* sent;          /* [MAX_PLAYERS], by local PID */
+} ClusterLink;
+
+typedef struct {
+    u32 node;                   /* This node */
+    u32 nodes;
+    ClusterLink links[CLUSTER_MAX_NODES];
+
+    ClusterGhost* ghosts;       /* [CLUSTER_GHOST_POOL] */
+    u32 ghost_count;
+    u16* ghost_index;           /* Name table: ghost + 1, 0 = empty */
+    u32 ghost_mask;
+    u64 frames_applied;         /* Ghost frames applied (the seen stamps) */
+
+    u8* frame;                  /* [CLUSTER_FRAME_MAX], send and receive */
+
+    /* cluster_send() scratch: local PIDs near a neighbour, and which */
+    u16* ghosted;               /* [MAX_PLAYERS] */
+    u16* ghosted_peers;         /* Bit per node */
+    u32 ghosted_count;
+    u16 frame_pids[CLUSTER_GHOSTS_MAX];  /* Entries of the frame being sent */
+    bool frame_blobs[CLUSTER_GHOSTS_MAX];
+
+    u64 ghost_frames_sent;
+    u64 ghost_frames_dropped;
+    u64 handoffs_out;
+    u64 handoffs_in;
+    u64 handoffs_failed;        /* Refused here, or taken in and lost */
+} Cluster;
+
+/* This node's cluster state (server_init), NULL unless --cluster */
+extern Cluster* g_cluster;
+
+/*******************************************************************************
+ * SUPERVISOR (before and right after the fork)
+ ******************************************************************************/
+
+/*
+ * cluster_links_create - Ownership table and one link per pair of nodes
+ *
+ * @param nodes  2..CLUSTER_MAX_NODES
+ * @return       false on failure (nothing is left open)
+ *
+ * Called once the assets are loaded: the bands are cut by land file.
+ */
+bool cluster_links_create(u32 nodes);
+
+/*
+ * cluster_links_enter_node - In node's child: keep its ends, close the rest
+ */
+void cluster_links_enter_node(u32 node);
+
+/*
+ * cluster_links_forked - In the supervisor: close every end
+ */
+void cluster_links_forked(void);
+
+/*******************************************************************************
+ * NODE
+ ******************************************************************************/
+
+/*
+ * cluster_create - This node's state, from the links it entered with
+ *
+ * @return  NULL if the process is not a cluster node
+ */
+Cluster* cluster_create(void);
+
+/*
+ * cluster_destroy - Detach every ghost, close the links, print the counts
+ */
+void cluster_destroy(Cluster* cluster, World* world);
+
+/*
+ * cluster_owner - Node owning a tile (this node inside an instance)
+ */
+u32 cluster_owner(const Cluster* cluster, const Position* pos);
+
+/*
+ * cluster_receive - Take in handed-off players, apply ghost frames
+ *
+ * @param tick  Tick being processed
+ *
+ * Ghosts' directions are reset first, so a ghost no frame moved stands.
+ * Every ghost's update blocks are encoded at the end, on this thread
+ * (the PLAYER_INFO workers only read them).
+ */
+void cluster_receive(Cluster* cluster, World* world, u64 tick);
+
+/*
+ * cluster_send - Hand off players on other nodes' squares, send ghosts
+ *
+ * @param tick  Tick just processed
+ *
+ * COMPLEXITY: O(players online) plus O(ghosted) per neighbour
+ */
+void cluster_send(Cluster* cluster, World* world, u64 tick);
+
+#endif /* CLUSTER_H */
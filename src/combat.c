@@ -0,0 +1,485 @@
+/*******************************************************************************
+ * COMBAT.C - Melee Combat with Table-Driven Rolls and Scheduled Hits
+ *******************************************************************************
+ *
+ * See combat.h for the design.
+ *
+ * EVENTS (all on g_timers, ctx = the CombatSystem):
+ *
+ *   combat_swing_fired(attacker id)   reach check, roll, queue the hit,
+ *                                     schedule the next swing
+ *   combat_hit_fired(hit index)       damage, hitsplat, retaliation, death
+ *   combat_death_fired(NPC index)     remove the body (npc_kill)
+ *
+ * A dead NPC stays in view at 0 hitpoints for COMBAT_DEATH_DELAY ticks so
+ * viewers see the last hitsplat; nobody can target it meanwhile.
+ *
+ ******************************************************************************/
+
+#include "combat.h"
+#include "npc.h"
+#include "player.h"
+#include "player_list.h"
+#include "player_save.h"    /* SKILL_* */
+#include "world.h"
+#include "movement.h"
+#include "pathfinder.h"
+#include "map.h"
+#include "server_packets.h"
+#include "mem_stats.h"
+#include "log.h"
+#include <string.h>
+
+CombatSystem* g_combat = NULL;
+
+/* Ticks a killed NPC stays (at 0 hitpoints) before npc_kill() */
+#define COMBAT_DEATH_DELAY 2
+
+/* Where a player who dies comes back (player_init's spawn) */
+#define COMBAT_RESPAWN_X 3222
+#define COMBAT_RESPAWN_Z 3218
+
+/* NPC_INFO face entity: NPC index, or 32768 + player PID */
+#define COMBAT_FACE_PLAYER 32768
+#define COMBAT_FACE_NONE   65535
+
+/*
+ * Fighter - What the events need of one combatant, resolved from its id
+ */
+typedef struct {
+    Player* player;             /* Exactly one of player / npc is set */
+    Npc* npc;
+    const NpcDefinition* def;
+    Position* position;
+    MovementHandler* movement;
+    u32 size;                   /* Tiles per side */
+    u32 hitpoints;
+} Fighter;
+
+/*******************************************************************************
+ * RANDOM NUMBERS AND TABLES
+ ******************************************************************************/
+
+static inline u32 combat_rng(CombatSystem* sys) {
+    u32 x = sys->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    sys->rng = x;
+    return x;
+}
+
+/* Uniform in [0, n) without a division */
+static inline u32 combat_rng_range(CombatSystem* sys, u32 n) {
+    return (u32)(((u64)combat_rng(sys) * n) >> 32);
+}
+
+static inline u32 combat_level_index(u32 level) {
+    return level < COMBAT_LEVELS ? level : COMBAT_LEVELS - 1;
+}
+
+static inline u32 combat_bonus_bucket(i32 bonus) {
+    if (bonus < COMBAT_BONUS_MIN) bonus = COMBAT_BONUS_MIN;
+    u32 bucket = (u32)(bonus - COMBAT_BONUS_MIN) / COMBAT_BONUS_STEP;
+    return bucket < COMBAT_BONUS_BUCKETS ? bucket : COMBAT_BONUS_BUCKETS - 1;
+}
+
+/*
+ * combat_build_tables - Evaluate both formulas for every (level, bucket)
+ *
+ *   effective = level + 8,  multiplier = bonus + 64 (bucket's lowest bonus)
+ *   roll      = effective * multiplier
+ *   max_hit   = floor(0.5 + effective * multiplier / 640)
+ */
+static void combat_build_tables(CombatSystem* sys) {
+    for (u32 level = 0; level < COMBAT_LEVELS; level++) {
+        u32 effective = level + 8;
+        for (u32 bucket = 0; bucket < COMBAT_BONUS_BUCKETS; bucket++) {
+            u32 multiplier = bucket * COMBAT_BONUS_STEP;
+            u32 max_hit = (effective * multiplier + 320) / 640;
+            sys->roll[level][bucket] = effective * multiplier;
+            sys->max_hit[level][bucket] = (u8)(max_hit < 255 ? max_hit : 255);
+        }
+    }
+}
+
+u32 combat_roll_hit(CombatSystem* sys, u32 attack_level, i32 attack_bonus,
+                    u32 strength_level, i32 strength_bonus,
+                    u32 defence_level, i32 defence_bonus) {
+    u32 attack = sys->roll[combat_level_index(attack_level)][combat_bonus_bucket(attack_bonus)];
+    u32 defence = sys->roll[combat_level_index(defence_level)][combat_bonus_bucket(defence_bonus)];
+    if (combat_rng_range(sys, attack + 1) <= combat_rng_range(sys, defence + 1)) return 0;
+
+    u32 max_hit = sys->max_hit[combat_level_index(strength_level)]
+                              [combat_bonus_bucket(strength_bonus)];
+    return combat_rng_range(sys, max_hit + 1);
+}
+
+/*******************************************************************************
+ * LIFECYCLE
+ ******************************************************************************/
+
+CombatSystem* combat_system_create(void) {
+    CombatSystem* sys = mem_calloc(MEM_NPC, 1, sizeof(CombatSystem));
+    if (!sys) return NULL;
+
+    sys->target = mem_alloc(MEM_NPC, COMBAT_ENTITIES * sizeof(u16));
+    sys->target_session = mem_calloc(MEM_NPC, COMBAT_ENTITIES, sizeof(u32));
+    sys->session = mem_calloc(MEM_NPC, COMBAT_ENTITIES, sizeof(u32));
+    sys->swing = mem_calloc(MEM_NPC, COMBAT_ENTITIES, sizeof(TimerHandle));
+    sys->hit_tick = mem_alloc(MEM_NPC, COMBAT_ENTITIES * sizeof(u32));
+    sys->hits = mem_alloc(MEM_NPC, COMBAT_MAX_HITS * sizeof(CombatHit));
+    sys->free_hits = mem_alloc(MEM_NPC, COMBAT_MAX_HITS * sizeof(u16));
+    if (!sys->target || !sys->target_session || !sys->session || !sys->swing ||
+        !sys->hit_tick || !sys->hits || !sys->free_hits) {
+        combat_system_destroy(sys);
+        return NULL;
+    }
+    memset(sys->target, 0xFF, COMBAT_ENTITIES * sizeof(u16));       /* COMBAT_NONE */
+    memset(sys->hit_tick, 0xFF, COMBAT_ENTITIES * sizeof(u32));     /* Never hit */
+    for (u32 i = 0; i < COMBAT_MAX_HITS; i++) {
+        sys->free_hits[i] = (u16)(COMBAT_MAX_HITS - 1 - i);
+    }
+    sys->free_hit_count = COMBAT_MAX_HITS;
+    sys->rng = 0x2545F491u;
+
+    combat_build_tables(sys);
+    return sys;
+}
+
+/* Pending swings and hits stay on g_timers: destroy this after the wheel
+ * has stopped advancing (server_shutdown) */
+void combat_system_destroy(CombatSystem* sys) {
+    if (!sys) return;
+    mem_free(sys->target);
+    mem_free(sys->target_session);
+    mem_free(sys->session);
+    mem_free(sys->swing);
+    mem_free(sys->hit_tick);
+    mem_free(sys->hits);
+    mem_free(sys->free_hits);
+    mem_free(sys);
+}
+
+/*******************************************************************************
+ * COMBATANTS
+ ******************************************************************************/
+
+/*
+ * combat_fighter - Resolve an id to a live combatant
+ *
+ * @return  false if logged out, despawned, dead, a ghost of a player on
+ *          another node (cluster.h), or an NPC that cannot be fought
+ *          (max_hitpoints 0, like Hans)
+ */
+static bool combat_fighter(u16 id, Fighter* out) {
+    memset(out, 0, sizeof(*out));
+    if (COMBAT_IS_NPC(id)) {
+        Npc* npc = npc_get_by_index(g_npcs, (u16)(id - MAX_PLAYERS));
+        if (!npc || !npc->active || npc->hitpoints == 0) return false;
+        const NpcDefinition* def = npc_get_definition(g_npcs, npc->npc_id);
+        if (!def || def->max_hitpoints == 0) return false;
+        out->npc = npc;
+        out->def = def;
+        out->position = &npc->position;
+        out->movement = &npc->movement;
+        out->size = def->size ? def->size : 1;
+        out->hitpoints = npc->hitpoints;
+        return true;
+    }
+
+    Player* player = g_world ? player_list_get(g_world->player_list, id) : NULL;
+    if (!player || player->state != PLAYER_STATE_LOGGED_IN || player->ghost ||
+        player->levels[SKILL_HITPOINTS] == 0) {
+        return false;
+    }
+    out->player = player;
+    out->position = &player->position;
+    out->movement = &player->movement;
+    out->size = 1;
+    out->hitpoints = player->levels[SKILL_HITPOINTS];
+    return true;
+}
+
+/* NPC levels: every combat skill at the combat level (no stat tables in 225) */
+static u32 fighter_level(const Fighter* f, u32 skill) {
+    if (f->player) return f->player->levels[skill];
+    return f->def->combat_level ? f->def->combat_level : 1;
+}
+
+static u32 fighter_speed(const Fighter* f) {
+    if (f->player) return COMBAT_PLAYER_SPEED;
+    return f->def->attack_speed ? f->def->attack_speed : COMBAT_PLAYER_SPEED;
+}
+
+static void npc_face(Npc* npc, u16 face) {
+    if (npc->face_entity == face) return;
+    npc->face_entity = face;
+    npc_queue_update(g_npcs, npc, NPC_UPDATE_FACE_ENTITY);
+}
+
+/*
+ * combat_in_range - Same level and within COMBAT_CHASE_DISTANCE
+ */
+static bool combat_in_range(const Fighter* a, const Fighter* d) {
+    return position_same_height(a->position, d->position) &&
+           position_distance(a->position, d->position) <= COMBAT_CHASE_DISTANCE;
+}
+
+/*
+ * combat_in_reach - Melee reach: the two squares share an edge
+ *
+ *   . T .        A attacks T from any tile marked A,
+ *   A T A        never diagonally and never from
+ *   . A .        underneath
+ */
+static bool combat_in_reach(const Fighter* a, const Fighter* d) {
+    u32 ax0 = position_x(a->position), ax1 = ax0 + a->size - 1;
+    u32 az0 = position_z(a->position), az1 = az0 + a->size - 1;
+    u32 dx0 = position_x(d->position), dx1 = dx0 + d->size - 1;
+    u32 dz0 = position_z(d->position), dz1 = dz0 + d->size - 1;
+
+    bool x_overlap = ax0 <= dx1 && dx0 <= ax1;
+    bool z_overlap = az0 <= dz1 && dz0 <= az1;
+    bool x_touch = ax1 + 1 == dx0 || dx1 + 1 == ax0;
+    bool z_touch = az1 + 1 == dz0 || dz1 + 1 == az0;
+    return (x_overlap && z_touch) || (z_overlap && x_touch);
+}
+
+/*
+ * combat_chase - Walk the attacker to the nearest tile in reach
+ *
+ * The attacker's tile is clamped into the ring around the target; a
+ * corner of the ring is pulled onto the target's side, and a tile under
+ * the target is moved out to its west.
+ */
+static void combat_chase(const Fighter* a, const Fighter* d) {
+    i32 x = (i32)position_x(a->position), z = (i32)position_z(a->position);
+    i32 x0 = (i32)position_x(d->position), x1 = x0 + (i32)d->size - 1;
+    i32 z0 = (i32)position_z(d->position), z1 = z0 + (i32)d->size - 1;
+
+    bool x_inside = x >= x0 && x <= x1;
+    bool z_inside = z >= z0 && z <= z1;
+    if (x_inside && z_inside) {
+        x = x0 - 1;
+    } else if (!x_inside && !z_inside) {
+        z = z < z0 ? z0 : z1;
+        x = x < x0 ? x0 - 1 : x1 + 1;
+    } else if (x_inside) {
+        z = z < z0 ? z0 - 1 : z1 + 1;
+    } else {
+        x = x < x0 ? x0 - 1 : x1 + 1;
+    }
+    if (x < 0 || z < 0) return;
+
+    movement_reset(a->movement);
+    pathfinder_walk_to(a->movement, position_height(a->position), position_x(a->position), position_z(a->position),
+                       (u32)x, (u32)z);
+    movement_finish(a->movement);
+}
+
+/*******************************************************************************
+ * ENGAGING
+ ******************************************************************************/
+
+static void combat_swing_fired(void* ctx, u32 attacker);
+static void combat_hit_fired(void* ctx, u32 index);
+
+bool combat_attack(CombatSystem* sys, u16 attacker, u16 target) {
+    if (!sys || attacker >= COMBAT_ENTITIES || target >= COMBAT_ENTITIES || attacker == target) {
+        return false;
+    }
+    Fighter a, d;
+    if (!combat_fighter(attacker, &a) || !combat_fighter(target, &d)) return false;
+
+    if (!timer_pending(g_timers, sys->swing[attacker])) {
+        sys->swing[attacker] = timer_schedule(g_timers, 1, combat_swing_fired, sys, attacker);
+        if (sys->swing[attacker] == TIMER_NONE) return false;
+    }
+    if (sys->target[attacker] == COMBAT_NONE) sys->fighting++;
+    sys->target[attacker] = target;
+    sys->target_session[attacker] = sys->session[target];
+
+    if (a.npc) {
+        a.npc->in_combat = true;
+        npc_face(a.npc, COMBAT_IS_NPC(target) ? (u16)(target - MAX_PLAYERS)
+                                              : (u16)(COMBAT_FACE_PLAYER + target));
+    }
+    return true;
+}
+
+void combat_stop(CombatSystem* sys, u16 attacker) {
+    if (!sys || attacker >= COMBAT_ENTITIES || sys->target[attacker] == COMBAT_NONE) return;
+
+    sys->target[attacker] = COMBAT_NONE;
+    sys->fighting--;
+    timer_cancel(g_timers, sys->swing[attacker]);
+    sys->swing[attacker] = TIMER_NONE;
+
+    if (COMBAT_IS_NPC(attacker)) {
+        Npc* npc = npc_get_by_index(g_npcs, (u16)(attacker - MAX_PLAYERS));
+        if (npc && npc->active) {
+            npc->in_combat = false;
+            npc_face(npc, COMBAT_FACE_NONE);
+        }
+    }
+}
+
+void combat_remove(CombatSystem* sys, u16 id) {
+    if (!sys || id >= COMBAT_ENTITIES) return;
+    combat_stop(sys, id);
+    sys->session[id]++;
+}
+
+/*******************************************************************************
+ * SWINGS AND HITS
+ ******************************************************************************/
+
+static void combat_land(CombatSystem* sys, u16 attacker, u16 defender, u32 damage);
+
+/*
+ * combat_queue_hit - Schedule a swing's hit COMBAT_HIT_DELAY ticks out
+ */
+static void combat_queue_hit(CombatSystem* sys, u16 attacker, u16 defender, u32 damage) {
+    if (sys->free_hit_count > 0) {
+        u16 index = sys->free_hits[--sys->free_hit_count];
+        CombatHit* hit = &sys->hits[index];
+        hit->attacker = attacker;
+        hit->defender = defender;
+        hit->session = sys->session[defender];
+        hit->damage = (u8)damage;
+        hit->type = damage > 0 ? COMBAT_HIT_DAMAGE : COMBAT_HIT_BLOCK;
+        if (timer_schedule(g_timers, COMBAT_HIT_DELAY, combat_hit_fired, sys, index) != TIMER_NONE) {
+            return;
+        }
+        sys->free_hits[sys->free_hit_count++] = index;
+    }
+    /* No room in the pool or on the wheel: the hit lands with the swing */
+    combat_land(sys, attacker, defender, damage);
+}
+
+static void combat_swing_fired(void* ctx, u32 attacker) {
+    CombatSystem* sys = (CombatSystem*)ctx;
+    sys->swing[attacker] = TIMER_NONE;
+
+    u16 target = sys->target[attacker];
+    if (target == COMBAT_NONE) return;
+
+    Fighter a, d;
+    if (!combat_fighter((u16)attacker, &a) || !combat_fighter(target, &d) ||
+        sys->session[target] != sys->target_session[attacker] || !combat_in_range(&a, &d)) {
+        combat_stop(sys, (u16)attacker);
+        return;
+    }
+
+    /* Not in reach yet: walk closer, look again next tick. Two fighters
+     * after each other would both step and keep missing (a diagonal
+     * dance), so then only the higher id moves: an NPC comes to the
+     * player */
+    if (!combat_in_reach(&a, &d)) {
+        if (sys->target[target] != attacker || target < attacker) {
+            combat_chase(&a, &d);
+        }
+        sys->swing[attacker] = timer_schedule(g_timers, 1, combat_swing_fired, sys, attacker);
+        if (sys->swing[attacker] == TIMER_NONE) combat_stop(sys, (u16)attacker);
+        return;
+    }
+    if (movement_is_moving(a.movement)) movement_reset(a.movement);
+
+    /* No equipment bonuses in the 225 data: every bonus is 0 */
+    u32 damage = combat_roll_hit(sys, fighter_level(&a, SKILL_ATTACK), 0,
+                                 fighter_level(&a, SKILL_STRENGTH), 0,
+                                 fighter_level(&d, SKILL_DEFENCE), 0);
+    combat_queue_hit(sys, (u16)attacker, target, damage);
+
+    sys->swing[attacker] = timer_schedule(g_timers, fighter_speed(&a), combat_swing_fired,
+                                          sys, attacker);
+    if (sys->swing[attacker] == TIMER_NONE) combat_stop(sys, (u16)attacker);
+}
+
+static void combat_hit_fired(void* ctx, u32 index) {
+    CombatSystem* sys = (CombatSystem*)ctx;
+    CombatHit hit = sys->hits[index];
+
+    /* One hitsplat per entity per tick (combat.h): try again next tick */
+    if (hit.session == sys->session[hit.defender] &&
+        sys->hit_tick[hit.defender] == (u32)g_timers->now &&
+        timer_schedule(g_timers, 1, combat_hit_fired, sys, index) != TIMER_NONE) {
+        return;
+    }
+    sys->free_hits[sys->free_hit_count++] = (u16)index;
+
+    /* The defender died or left since the swing */
+    if (hit.session != sys->session[hit.defender]) return;
+    combat_land(sys, hit.attacker, hit.defender, hit.damage);
+}
+
+static void combat_death_fired(void* ctx, u32 index) {
+    (void)ctx;
+    Npc* npc = npc_get_by_index(g_npcs, (u16)index);
+    if (npc && npc->active && npc->hitpoints == 0) npc_kill(g_npcs, npc);
+}
+
+/*
+ * combat_die - Hitpoints reached 0
+ *
+ * Players are restored and sent home at once; NPCs stand still at 0
+ * hitpoints until combat_death_fired() removes them, so the killing blow
+ * is seen.
+ */
+static void combat_die(CombatSystem* sys, u16 id, const Fighter* f) {
+    combat_remove(sys, id);
+
+    if (f->npc) {
+        f->npc->in_combat = true;       /* No wandering off as a corpse */
+        movement_reset(&f->npc->movement);
+        if (timer_schedule(g_timers, COMBAT_DEATH_DELAY, combat_death_fired, sys,
+                           f->npc->index) == TIMER_NONE) {
+            npc_kill(g_npcs, f->npc);
+        }
+        return;
+    }
+
+    Player* player = f->player;
+    LOG_DEBUG("%s died in combat\n", player->username);
+    send_player_message(player, "Oh dear, you are dead!");
+    player->levels[SKILL_HITPOINTS] = player_base_level(player, SKILL_HITPOINTS);
+    queue_stat(player, SKILL_HITPOINTS);
+    movement_reset(&player->movement);
+    player_set_position(player, COMBAT_RESPAWN_X, COMBAT_RESPAWN_Z, 0);
+    map_send_load_area(player, position_get_mapsquare_x(&player->position),
+                       position_get_mapsquare_z(&player->position));
+}
+
+/*
+ * combat_land - Apply damage to the defender and show it
+ */
+static void combat_land(CombatSystem* sys, u16 attacker, u16 defender, u32 damage) {
+    Fighter d;
+    if (!combat_fighter(defender, &d)) return;
+
+    if (damage > d.hitpoints) damage = d.hitpoints;
+    u8 type = damage > 0 ? COMBAT_HIT_DAMAGE : COMBAT_HIT_BLOCK;
+    sys->hit_tick[defender] = (u32)g_timers->now;
+
+    if (d.player) {
+        d.player->levels[SKILL_HITPOINTS] = (u8)(d.hitpoints - damage);
+        queue_stat(d.player, SKILL_HITPOINTS);
+        player_queue_hit(d.player, (u8)damage, type);
+    } else {
+        d.npc->hitpoints = (u16)(d.hitpoints - damage);
+        d.npc->hit_damage = (u8)damage;
+        d.npc->hit_type = type;
+        npc_queue_update(g_npcs, d.npc, NPC_UPDATE_HIT);
+    }
+
+    if (damage == d.hitpoints) {
+        combat_die(sys, defender, &d);
+        return;
+    }
+
+    /* Retaliate, unless already fighting or (players) walking away */
+    if (sys->target[defender] == COMBAT_NONE && !(d.player && movement_is_moving(d.movement))) {
+        combat_attack(sys, defender, attacker);
+    }
+}
@@ -0,0 +1,205 @@
+/*******************************************************************************
+ * COMBAT.H - Melee Combat with Table-Driven Rolls and Scheduled Hits
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Lookup tables: formulas evaluated once per (level, bonus) bucket at
+ *     startup instead of once per swing
+ *   - Event-driven simulation: a fight is two timers, not a per-tick scan
+ *     of everyone who might be fighting
+ *   - Structure-of-arrays state indexed by one combatant id space shared
+ *     by players and NPCs
+ *   - Session counters to invalidate in-flight events cheaply
+ *
+ * THE PROBLEM:
+ *
+ * The NPC_INFO and PLAYER_INFO encoders can show a hitsplat (NPC mask
+ * 0x10, player mask 0x10) and the NPCs have hitpoints and an attack
+ * speed, but nothing ever attacks. The obvious engine checks every
+ * fighter every tick and evaluates the accuracy and max hit formulas on
+ * each swing:
+ *
+ *   for each fighter (thousands):  if tick >= next_attack: roll, hit
+ *
+ * Most fighters are between swings (a 4-tick weapon swings on 1 tick in
+ * 4), so most of that loop is wasted, and every swing redoes the same
+ * multiplications and divisions for the same few level and bonus pairs.
+ *
+ * THE SOLUTION - TABLES AND TIMERS:
+ *
+ *   startup:  roll[level][bucket]    = (level + 8) * (bonus + 64)
+ *             max_hit[level][bucket] = ((level + 8) * (bonus + 64) + 320) / 640
+ *
+ *   engage:   combat_attack(attacker, target)
+ *               → swing timer on g_timers, due next tick
+ *
+ *   swing:    out of reach? chase, try again next tick
+ *             A = roll[attack level][attack bonus]
+ *             D = roll[defence level][defence bonus]
+ *             hit if rand(0..A) > rand(0..D), damage rand(0..max_hit)
+ *               → hit timer, due COMBAT_HIT_DELAY ticks later
+ *               → swing timer again, attack speed ticks later
+ *
+ *   hit:      hitpoints down, hitsplat queued, defender retaliates,
+ *             death at 0
+ *
+ * A tick only touches the fighters whose swing or hit is due, and a swing
+ * is two table loads and three random numbers. The hitsplat rides the
+ * update blocks that are already shared per tick: npc_queue_update() for
+ * NPCs (encoded once in npc_update_prepare()) and player_queue_hit() for
+ * players (one cached PLAYER_MASK_HIT segment in update.c, copied to
+ * every viewer).
+ *
+ * COMBATANT IDS:
+ *
+ *   0 .. MAX_PLAYERS-1                 player PID       COMBAT_PLAYER(pid)
+ *   MAX_PLAYERS .. +MAX_NPCS-1         NPC index        COMBAT_NPC(index)
+ *
+ * Every per-fighter array is indexed by this id, so a player fighting
+ * an NPC, an NPC retaliating and two NPCs fighting each other all run
+ * through the same code.
+ *
+ * SESSIONS:
+ *
+ * Each id has a session counter, bumped when it dies or logs out. A
+ * scheduled hit and an attacker's target both remember the session they
+ * were aimed at; a mismatch means the defender is gone (or its slot now
+ * belongs to someone else), and the event is dropped without anything
+ * having to search for and cancel it.
+ *
+ * ONE HITSPLAT PER TICK:
+ *
+ * The 225 client shows one hitsplat per entity per update (mask 0x10;
+ * there is no second hit mask). A hit that lands on an entity already
+ * hit this tick is put back on the wheel for the next tick.
+ *
+ * FORMULAS (levels clamped to 255, bonuses to -64..191):
+ *   effective level  level + 8 (no attack styles or prayers yet)
+ *   bonus bucket     (bonus + 64) / COMBAT_BONUS_STEP, using the bucket's
+ *                    lowest bonus
+ *   NPC levels       attack = strength = defence = combat level
+ *   Bonuses          0: the 225 item data carries no equipment bonuses
+ *
+ * COMPLEXITY:
+ *   - per swing / per hit:   O(1) (two table loads, one timer)
+ *   - per tick:              O(swings and hits due), nothing for idle or
+ *                            waiting fighters
+ *   - memory:                tables 80 KB, state ~20 bytes per id,
+ *                            12 bytes per hit in flight
+ *
+ * THREADS:
+ *   Game thread only (timer callbacks and packet handlers).
+ *
+ ******************************************************************************/
+
+#ifndef COMBAT_H
+#define COMBAT_H
+
+#include "types.h"
+#include "timer_wheel.h"
+#include <stdbool.h>
+
+#define COMBAT_PLAYER(pid)    ((u16)(pid))
+#define COMBAT_NPC(index)     ((u16)(MAX_PLAYERS + (index)))
+#define COMBAT_IS_NPC(id)     ((id) >= MAX_PLAYERS)
+#define COMBAT_ENTITIES       (MAX_PLAYERS + MAX_NPCS)
+#define COMBAT_NONE           0xFFFF
+
+/* Table dimensions */
+#define COMBAT_LEVELS         256
+#define COMBAT_BONUS_MIN      (-64)
+#define COMBAT_BONUS_STEP     4
+#define COMBAT_BONUS_BUCKETS  64       /* Bonus -64 .. 191 */
+
+/* Ticks from a swing to its hitsplat (melee) */
+#define COMBAT_HIT_DELAY      1
+
+/* Attack speed of an unarmed player, in ticks */
+#define COMBAT_PLAYER_SPEED   4
+
+/* A target further than this (either axis) is given up on */
+#define COMBAT_CHASE_DISTANCE 16
+
+/* Hits in flight at once; past that a hit lands on the swing's tick */
+#define COMBAT_MAX_HITS       16384
+
+/* Hit types (client hitsplat colours) */
+#define COMBAT_HIT_BLOCK      0
+#define COMBAT_HIT_DAMAGE     1
+
+/*
+ * CombatHit - One scheduled hit, by index into CombatSystem.hits
+ */
+typedef struct {
+    u16 attacker;
+    u16 defender;
+    u32 session;                /* Defender's session when swung */
+    u8 damage;
+    u8 type;                    /* COMBAT_HIT_* */
+} CombatHit;
+
+/*
+ * CombatSystem - Tables plus per-combatant state (structure of arrays)
+ */
+typedef struct {
+    /* Formula tables, [level][bonus bucket] */
+    u32 roll[COMBAT_LEVELS][COMBAT_BONUS_BUCKETS];
+    u8 max_hit[COMBAT_LEVELS][COMBAT_BONUS_BUCKETS];
+
+    /* Per combatant id */
+    u16* target;                /* COMBAT_NONE: not attacking */
+    u32* target_session;        /* Target's session when engaged */
+    u32* session;               /* Bumped on death and logout */
+    TimerHandle* swing;         /* Next swing (or reach check) */
+    u32* hit_tick;              /* Tick of the last hitsplat shown */
+
+    CombatHit* hits;
+    u16* free_hits;             /* Stack of unused hit indices */
+    u32 free_hit_count;
+
+    u32 rng;                    /* xorshift32 state */
+    u32 fighting;               /* Ids with a target */
+} CombatSystem;
+
+extern CombatSystem* g_combat;
+
+CombatSystem* combat_system_create(void);
+void combat_system_destroy(CombatSystem* sys);
+
+/*
+ * combat_attack - Start (or switch) an attack on a target
+ *
+ * @param attacker  Combatant id (COMBAT_PLAYER / COMBAT_NPC)
+ * @param target    Combatant id
+ * @return          false if either cannot fight (dead, logged out, an NPC
+ *                  with no hitpoints) or they are the same
+ *
+ * The first swing is checked on the next tick, walking into reach first
+ * if needed. An attacker already swinging keeps its timer, so clicking
+ * again does not attack faster.
+ */
+bool combat_attack(CombatSystem* sys, u16 attacker, u16 target);
+
+/*
+ * combat_stop - The attacker stops attacking (walked away, logged out)
+ *
+ * Hits already swung still land.
+ */
+void combat_stop(CombatSystem* sys, u16 attacker);
+
+/*
+ * combat_remove - A combatant leaves: stop it and void every hit on it
+ */
+void combat_remove(CombatSystem* sys, u16 id);
+
+/*
+ * combat_roll_hit - One swing's damage from the tables
+ *
+ * @return  Damage (0 = blocked or missed)
+ */
+u32 combat_roll_hit(CombatSystem* sys, u32 attack_level, i32 attack_bonus,
+                    u32 strength_level, i32 strength_bonus,
+                    u32 defence_level, i32 defence_bonus);
+
+#endif /* COMBAT_H */
@@ -0,0 +1,170 @@
+/*******************************************************************************
+ * COMMAND.C - ::command Registry
+ *******************************************************************************
+ *
+ * See command.h for the dispatch path. The commands themselves are
+ * registered by server.c (server_register_commands).
+ *
+ ******************************************************************************/
+
+#include "command.h"
+#include "server_packets.h"
+#include "log.h"
+#include <ctype.h>
+#include <string.h>
+
+/* Open-addressing table: a power of two, at most half full */
+#define COMMAND_TABLE_SIZE 64
+#define COMMAND_TABLE_MASK (COMMAND_TABLE_SIZE - 1)
+
+/* Longest argument text split into argv (a CLIENT_CHEAT payload is at most 255) */
+#define COMMAND_LINE_MAX 255
+
+/* Names that get PLAYER_RIGHTS_ADMIN at login (--admin) */
+#define COMMAND_MAX_ADMINS 8
+
+typedef struct {
+    CommandDef def;
+    u32 hash;
+} Command;
+
+static Command commands[COMMAND_MAX];
+static u32 command_count = 0;
+
+/* command index + 1 per slot, 0 = empty */
+static u8 command_table[COMMAND_TABLE_SIZE];
+
+/* Tick each player may use each command again (indexed by player->index) */
+static u32 command_ready[MAX_PLAYERS][COMMAND_MAX];
+
+static char admins[COMMAND_MAX_ADMINS][MAX_USERNAME_LENGTH + 1];
+static u32 admin_count = 0;
+
+/* FNV-1a, one step per character */
+#define FNV_OFFSET 2166136261u
+#define FNV_PRIME  16777619u
+
+static u32 command_hash(const char* name) {
+    u32 hash = FNV_OFFSET;
+    for (const char* p = name; *p; p++) hash = (hash ^ (u8)*p) * FNV_PRIME;
+    return hash;
+}
+
+/* Slot holding name, or -1 */
+static i32 command_find(const char* name, u32 hash) {
+    for (u32 probe = 0; probe < COMMAND_TABLE_SIZE; probe++) {
+        u32 slot = (hash + probe) & COMMAND_TABLE_MASK;
+        if (command_table[slot] == 0) return -1;
+        const Command* c = &commands[command_table[slot] - 1];
+        if (c->hash == hash && strcmp(c->def.name, name) == 0) return (i32)(command_table[slot] - 1);
+    }
+    return -1;
+}
+
+bool command_register(const CommandDef* def) {
+    if (!def || !def->name || !def->handler || command_count >= COMMAND_MAX) return false;
+    u32 hash = command_hash(def->name);
+    if (command_find(def->name, hash) >= 0) {
+        printf("WARNING: Command '%s' registered twice\n", def->name);
+        return false;
+    }
+
+    commands[command_count] = (Command){ *def, hash };
+    u32 slot = hash & COMMAND_TABLE_MASK;
+    while (command_table[slot] != 0) slot = (slot + 1) & COMMAND_TABLE_MASK;
+    command_table[slot] = (u8)(++command_count);
+    return true;
+}
+
+bool command_dispatch(Player* player, char* line, u64 tick) {
+    if (!player || !line || player->index >= MAX_PLAYERS) return false;
+    if (line[0] == ':' && line[1] == ':') line += 2;
+
+    /* Name: lowercase and hash in the same pass */
+    u32 hash = FNV_OFFSET;
+    char* p = line;
+    for (; *p && *p != ' '; p++) {
+        *p = (char)tolower((unsigned char)*p);
+        hash = (hash ^ (u8)*p) * FNV_PRIME;
+    }
+    if (*p) *p++ = '\0';
+
+    i32 index = command_find(line, hash);
+    if (index < 0) return false;
+    const CommandDef* def = &commands[index].def;
+    if (player->rights < def->rights) return false;
+
+    u32* ready = &command_ready[player->index][index];
+    if (def->cooldown_ticks > 0) {
+        if ((u32)tick < *ready) {
+            LOG_DEBUG("Command '%s' from %s: cooling down\n", def->name, player->username);
+            return false;
+        }
+        *ready = (u32)tick + def->cooldown_ticks;
+    }
+
+    /* Arguments: split a stack copy on spaces, so rest stays whole; the
+     * last argument keeps whatever is left */
+    while (*p == ' ') p++;
+    char split[COMMAND_LINE_MAX + 1];
+    size_t length = strlen(p);
+    if (length > COMMAND_LINE_MAX) length = COMMAND_LINE_MAX;
+    memcpy(split, p, length);
+    split[length] = '\0';
+    CommandArgs args = { line, p, 0, { NULL } };
+    char* cursor = split;
+    while (*cursor && args.argc < COMMAND_MAX_ARGS) {
+        args.argv[args.argc++] = cursor;
+        if (args.argc == COMMAND_MAX_ARGS) break;
+        while (*cursor && *cursor != ' ') cursor++;
+        if (!*cursor) break;
+        *cursor++ = '\0';
+        while (*cursor == ' ') cursor++;
+    }
+
+    LOG_INFO("Command from %s: '%s' (%u args)\n", player->username, def->name, args.argc);
+    if (!def->handler(player, &args) && def->usage) {
+        send_player_message(player, def->usage);
+    }
+    return true;
+}
+
+bool command_arg_u32(const CommandArgs* args, u32 index, u32* out) {
+    if (!args || index >= args->argc) return false;
+    const char* s = args->argv[index];
+    if (!*s) return false;
+    u32 value = 0;
+    for (; *s; s++) {
+        if (!isdigit((unsigned char)*s)) return false;
+        u32 digit = (u32)(*s - '0');
+        if (value > (0xFFFFFFFFu - digit) / 10) return false;
+        value = value * 10 + digit;
+    }
+    *out = value;
+    return true;
+}
+
+/* Usernames compare without case (the client sends what was typed) */
+static bool username_equals(const char* a, const char* b) {
+    for (; *a && *b; a++, b++) {
+        if (tolower((unsigned char)*a) != tolower((unsigned char)*b)) return false;
+    }
+    return *a == *b;
+}
+
+bool command_add_admin(const char* username) {
+    if (!username || admin_count >= COMMAND_MAX_ADMINS) return false;
+    strncpy(admins[admin_count], username, MAX_USERNAME_LENGTH);
+    admins[admin_count][MAX_USERNAME_LENGTH] = '\0';
+    admin_count++;
+    return true;
+}
+
+void command_player_login(Player* player) {
+    if (!player || player->index >= MAX_PLAYERS) return;
+    player->rights = PLAYER_RIGHTS_NONE;
+    for (u32 i = 0; i < admin_count; i++) {
+        if (username_equals(admins[i], player->username)) player->rights = PLAYER_RIGHTS_ADMIN;
+    }
+    memset(command_ready[player->index], 0, sizeof(command_ready[player->index]));
+}
@@ -0,0 +1,152 @@
+/*******************************************************************************
+ * COMMAND.H - ::command Registry with Hashed Dispatch
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Table-driven dispatch instead of an if/strcmp chain
+ *   - Open-addressing hash lookup computed while scanning the name
+ *   - Tokenizing in place (pointers into one stack buffer, no malloc)
+ *   - Rejecting cheaply: privilege and rate checks before any parsing
+ *
+ * THE PROBLEM:
+ *
+ * Any player can send CLIENT_CHEAT ("::tele 3200 3200 0"). A handler
+ * written as a chain of comparisons costs more the more commands exist,
+ * and every command repeats its own argument parsing:
+ *
+ *   if (strncmp(msg, "tele ", 5) == 0)         ...sscanf
+ *   else if (strncmp(msg, "profile ", 8) == 0) ...strcmp
+ *   else if (strncmp(msg, "item ", 5) == 0)    ...sscanf
+ *   else if ...                                 one more per command
+ *
+ *   A spammer typing "::zzzz" walks the whole chain every packet, and
+ *   nothing stops an allowed command from being repeated each tick.
+ *
+ * THE SOLUTION - REGISTER ONCE, LOOK UP ONCE:
+ *
+ *   startup:  command_register(&(CommandDef){ "tele", handler, rights, cooldown, usage })
+ *             name → FNV-1a hash → slot in a 64-entry open-addressing table
+ *
+ *   packet:   "tele 3200 3200 0"
+ *              └──┘ hashed while scanning to the first space
+ *                   │
+ *             table[hash & 63] → probe until the hash and name match
+ *                   │             (a miss ends at an empty slot)
+ *             rights ≥ command's?  cooldown over?   else drop, nothing sent
+ *                   │
+ *             split the rest in place: argv = { "3200", "3200", "0" }
+ *                   │
+ *             handler(player, &args)  → false = send the usage line
+ *
+ *   Unknown, forbidden and rate-limited commands cost one copy of the
+ *   line, one hash and a probe or two: about what framing the packet did.
+ *
+ * RIGHTS:
+ *   The same levels the client draws as chat crowns: 0 player, 1
+ *   moderator, 2 administrator. They are session-only: player->rights is
+ *   set at login from the names given with --admin (command_add_admin).
+ *
+ * COOLDOWNS:
+ *   A command with cooldown_ticks > 0 can be used once per that many
+ *   ticks by each player. The ready tick lives in a per-player-index
+ *   table, cleared by command_player_login() so a reused index starts
+ *   fresh.
+ *
+ * THREADS:
+ *   Game thread only. Commands are registered during server_init().
+ *
+ ******************************************************************************/
+
+#ifndef COMMAND_H
+#define COMMAND_H
+
+#include "types.h"
+#include "player.h"
+
+/* Most commands that can be registered */
+#define COMMAND_MAX 32
+
+/* Most arguments split out of one line (the rest stay in the last one) */
+#define COMMAND_MAX_ARGS 8
+
+/* Player rights (the client's chat crown levels) */
+#define PLAYER_RIGHTS_NONE  0
+#define PLAYER_RIGHTS_MOD   1
+#define PLAYER_RIGHTS_ADMIN 2
+
+/*
+ * CommandArgs - One command line, tokenized in place
+ *
+ * argv[] points into the dispatcher's copy of the line and is valid
+ * only during the handler call. rest is everything after the name
+ * (for free text such as ::yell).
+ */
+typedef struct {
+    const char* name;                   /* Command name, lowercased */
+    const char* rest;                   /* Text after the name, "" if none */
+    u32 argc;
+    const char* argv[COMMAND_MAX_ARGS];
+} CommandArgs;
+
+/*
+ * CommandHandler - Run a command
+ *
+ * @return  false if the arguments were wrong (the usage line is sent)
+ */
+typedef bool (*CommandHandler)(Player* player, const CommandArgs* args);
+
+/*
+ * CommandDef - A command as registered
+ */
+typedef struct {
+    const char* name;                   /* Lowercase, no "::" */
+    CommandHandler handler;
+    u8 rights;                          /* Least PLAYER_RIGHTS_* allowed to use it */
+    u16 cooldown_ticks;                 /* 0 = no limit */
+    const char* usage;                  /* Sent when the handler returns false */
+} CommandDef;
+
+/*
+ * command_register - Add a command to the registry
+ *
+ * @param def  Definition (copied; the strings must outlive the registry)
+ * @return     false if the name is taken or the registry is full
+ */
+bool command_register(const CommandDef* def);
+
+/*
+ * command_dispatch - Look up and run one command line
+ *
+ * @param player  Sender
+ * @param line    NUL-terminated line without the newline; tokenized in place
+ * @param tick    Current tick (cooldowns)
+ * @return        true if a command ran (whatever its result)
+ *
+ * A leading "::" is skipped. Unknown, forbidden and cooling-down
+ * commands are dropped without a reply.
+ *
+ * COMPLEXITY: O(line length), independent of the number of commands
+ */
+bool command_dispatch(Player* player, char* line, u64 tick);
+
+/*
+ * command_arg_u32 - Parse argv[index] as a decimal number
+ *
+ * @return  false if the argument is missing or not entirely digits
+ */
+bool command_arg_u32(const CommandArgs* args, u32 index, u32* out);
+
+/*
+ * command_add_admin - Grant PLAYER_RIGHTS_ADMIN to a username at login
+ *
+ * @return  false if the list is full
+ */
+bool command_add_admin(const char* username);
+
+/*
+ * command_player_login - Set a new session's rights and clear its cooldowns
+ */
+void command_player_login(Player* player);
+
+#endif /* COMMAND_H */
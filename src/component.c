@@ -65,6 +65,104 @@ void component_free_global(void) {
         free(_Component.instances[i]);
     }
     free(_Component.instances);
+    free(_Component.varpReaderStart);
+    free(_Component.varpReaders);
+    free(_Component.rootReads);
+}
+
+static int compare_reader(const void *a, const void *b) {
+    const int *x = a;
+    const int *y = b;
+    return x[0] != y[0] ? x[0] - y[0] : x[1] - y[1];
+}
+
+// custom: walk every script once (same operand counts as client_execute_clientscript1) and index which root
+// interfaces read each varp, stat, inventory, energy and weight
+static void component_index_readers(void) {
+    int capacity = 256;
+    int pairs = 0;
+    int *reads = malloc(capacity * 2 * sizeof(int)); // (varp, root) pairs
+    _Component.rootReads = calloc(_Component.count, sizeof(int8_t));
+
+    for (int id = 0; id < _Component.count; id++) {
+        Component *com = _Component.instances[id];
+        if (!com || !com->scripts || com->layer < 0 || com->layer >= _Component.count) {
+            continue;
+        }
+
+        for (int i = 0; i < com->scriptCount; i++) {
+            int *script = com->scripts[i];
+            int pc = 0;
+            int opcode;
+
+            while ((opcode = script[pc++]) != 0) {
+                int varp = -1;
+                if (opcode == 1 || opcode == 2 || opcode == 3 || opcode == 6) {
+                    _Component.rootReads[com->layer] |= COMPONENT_READS_STATS;
+                    pc++;
+                } else if (opcode == 8 || opcode == 9) {
+                    _Component.rootReads[com->layer] |= COMPONENT_READS_STATS;
+                } else if (opcode == 4 || opcode == 10) {
+                    _Component.rootReads[com->layer] |= COMPONENT_READS_INVS;
+                    pc += 2;
+                } else if (opcode == 5 || opcode == 7) {
+                    varp = script[pc++];
+                } else if (opcode == 13) {
+                    varp = script[pc];
+                    pc += 2;
+                } else if (opcode == 11) {
+                    _Component.rootReads[com->layer] |= COMPONENT_READS_ENERGY;
+                } else if (opcode == 12) {
+                    _Component.rootReads[com->layer] |= COMPONENT_READS_WEIGHT;
+                }
+
+                if (varp < 0 || varp >= VARPS_COUNT) {
+                    continue;
+                }
+                if (pairs == capacity) {
+                    capacity *= 2;
+                    reads = realloc(reads, capacity * 2 * sizeof(int));
+                }
+                reads[pairs * 2] = varp;
+                reads[pairs * 2 + 1] = com->layer;
+                pairs++;
+            }
+        }
+    }
+
+    qsort(reads, pairs, 2 * sizeof(int), compare_reader);
+    _Component.varpReaderStart = calloc(VARPS_COUNT + 1, sizeof(int));
+    _Component.varpReaders = malloc((pairs > 0 ? pairs : 1) * sizeof(int));
+    int count = 0;
+    for (int i = 0; i < pairs; i++) {
+        if (i > 0 && reads[i * 2] == reads[i * 2 - 2] && reads[i * 2 + 1] == reads[i * 2 - 1]) {
+            continue;
+        }
+        _Component.varpReaders[count++] = reads[i * 2 + 1];
+        _Component.varpReaderStart[reads[i * 2] + 1] = count;
+    }
+    for (int v = 1; v <= VARPS_COUNT; v++) {
+        if (_Component.varpReaderStart[v] < _Component.varpReaderStart[v - 1]) {
+            _Component.varpReaderStart[v] = _Component.varpReaderStart[v - 1];
+        }
+    }
+    free(reads);
+}
+
+const int *component_varp_readers(int varp, int *count) {
+    if (!_Component.varpReaderStart || varp < 0 || varp >= VARPS_COUNT) {
+        *count = 0;
+        return NULL;
+    }
+    *count = _Component.varpReaderStart[varp + 1] - _Component.varpReaderStart[varp];
+    return _Component.varpReaders + _Component.varpReaderStart[varp];
+}
+
+int component_root_reads(int root) {
+    if (!_Component.rootReads || root < 0 || root >= _Component.count) {
+        return 0;
+    }
+    return _Component.rootReads[root];
 }
 
 void component_unpack(Jagfile *jag, Jagfile *media, PixFont **fonts) {
@@ -325,6 +423,7 @@ void component_unpack(Jagfile *jag, Jagfile *media, PixFont **fonts) {
     packet_free(dat);
     lrucache_free(_Component.imageCache);
     lrucache_free(_Component.modelCache);
+    component_index_readers();
 }
 
 Pix24 *component_get_image(Jagfile *media, char *sprite, int spriteId) {
@@ -336,7 +435,10 @@ Pix24 *component_get_image(Jagfile *media, char *sprite, int spriteId) {
 
     // try {
     image = pix24_from_archive(media, sprite, spriteId);
-    lrucache_put(_Component.imageCache, uid, &image->link);
+    if (image) {
+        pix24_pack_spans(image, false);
+        lrucache_put(_Component.imageCache, uid, &image->link);
+    }
     // } catch (Exception ignored) {
     // 	return null;
     // }
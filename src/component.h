@@ -22,6 +22,11 @@
 #define BUTTON_TOGGLE 4
 #define BUTTON_SELECT 5
 #define BUTTON_CONTINUE 6
+// custom: what the scripts under a root interface read besides varps (component_root_reads)
+#define COMPONENT_READS_STATS 0x1
+#define COMPONENT_READS_INVS 0x2
+#define COMPONENT_READS_ENERGY 0x4
+#define COMPONENT_READS_WEIGHT 0x8
 
 typedef struct {
     int *invSlotObjId;
@@ -154,6 +159,10 @@ typedef struct {
     Component **instances;
     LruCache *imageCache;
     LruCache *modelCache;
+    // custom: reverse index built by component_unpack, roots are the layer ids components belong to
+    int *varpReaderStart; // varp v is read by the roots varpReaders[varpReaderStart[v]..varpReaderStart[v + 1])
+    int *varpReaders;
+    int8_t *rootReads; // COMPONENT_READS_* by root id
 } ComponentData;
 
 void component_free_global(void);
@@ -161,3 +170,6 @@ void component_unpack(Jagfile *jag, Jagfile *media, PixFont **fonts);
 Pix24 *component_get_image(Jagfile *media, char *sprite, int spriteId);
 Model *component_get_model(int id);
 Model *component_get_model2(Component *com, int primaryFrame, int secondaryFrame, bool active, bool *_free);
+// the root interfaces whose scripts read varp, so a change redraws only where one of them is shown
+const int *component_varp_readers(int varp, int *count);
+int component_root_reads(int root);
@@ -0,0 +1,94 @@
+/*******************************************************************************
+ * CONFIG_FILE.C - Config File Reader Implementation
+ *******************************************************************************
+ *
+ * See config_file.h for the format.
+ *
+ * The file is read into the front of one buffer and tokenized there; each
+ * line's option is copied behind it with "--" in front, so the arguments
+ * need two allocations (text and argv) however long the file is.
+ *
+ ******************************************************************************/
+
+#include "config_file.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static bool is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+bool config_file_load(const char* path, ConfigArgs* out) {
+    memset(out, 0, sizeof(ConfigArgs));
+
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (size < 0) {
+        fclose(f);
+        return false;
+    }
+
+    /* File bytes, then every option again with "--" (at most 3 bytes per byte) */
+    size_t length = (size_t)size;
+    char* text = (char*)malloc(length * 4 + 4);
+    /* A word needs at least two bytes (itself and a separator) */
+    char** argv = (char**)malloc((length / 2 + 2) * sizeof(char*));
+    if (!text || !argv || fread(text, 1, length, f) != length) {
+        free(text);
+        free(argv);
+        fclose(f);
+        return false;
+    }
+    fclose(f);
+    text[length] = '\0';
+
+    char* names = text + length + 1;
+    int argc = 0;
+    char* line = text;
+    while (line < text + length) {
+        char* end = strchr(line, '\n');
+        if (!end) end = text + length;
+        *end = '\0';
+        char* comment = strchr(line, '#');
+        if (comment) *comment = '\0';
+
+        bool first = true;
+        char* p = line;
+        while (*p) {
+            while (is_blank(*p)) p++;
+            if (!*p) break;
+            char* word = p;
+            while (*p && !is_blank(*p)) p++;
+            if (*p) *p++ = '\0';
+
+            if (first) {
+                /* The option: spelled as on the command line */
+                size_t n = strlen(word);
+                names[0] = '-';
+                names[1] = '-';
+                memcpy(names + 2, word, n + 1);
+                argv[argc++] = names;
+                names += n + 3;
+                first = false;
+            } else if (strcmp(word, "=") != 0) {
+                argv[argc++] = word;
+            }
+        }
+        line = end + 1;
+    }
+
+    out->argc = argc;
+    out->argv = argv;
+    out->text = text;
+    return true;
+}
+
+void config_file_free(ConfigArgs* args) {
+    free(args->argv);
+    free(args->text);
+    memset(args, 0, sizeof(ConfigArgs));
+}
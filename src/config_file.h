@@ -0,0 +1,79 @@
+/*******************************************************************************
+ * CONFIG_FILE.H - Server Settings from a File, Read as Command Line Options
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - One parser for two sources (a file and argv)
+ *   - Tokenizing a text file in place (one allocation for every string)
+ *   - Layered settings: defaults, then the file, then the command line
+ *
+ * THE PROBLEM:
+ *
+ * Every setting the server has is a command line flag, and a deployment
+ * that sizes its pools (--max-players, --max-npcs, --tick-ms, ...) ends up
+ * with a launch line longer than the settings it changes. Adding a second,
+ * different config syntax would mean two parsers to keep in step, and a
+ * flag added to one but not the other.
+ *
+ * THE SOLUTION - A FILE OF FLAGS:
+ *
+ * Each line of the file is one command line option without its dashes:
+ *
+ *   # data/world1.cfg                    becomes
+ *   max-players = 500                    --max-players 500
+ *   max-npcs 2000                        --max-npcs 2000
+ *   tick-ms 600                          --tick-ms 600
+ *   net-thread                           --net-thread
+ *   admin alice                          --admin alice
+ *   log-level=debug                      --log-level=debug
+ *
+ * config_file_load() turns the file into an argv array and main() runs it
+ * through the same loop as the real argv, before it:
+ *
+ *   compiled defaults  →  --config FILE  →  command line   (last one wins)
+ *
+ * so every flag works in the file, and a flag on the command line
+ * overrides the file for one run.
+ *
+ * FORMAT:
+ *   - '#' starts a comment (to the end of the line)
+ *   - The first word is the option; the words after it are its values
+ *   - A lone '=' between option and value is skipped
+ *   - Words are separated by spaces or tabs; there is no quoting
+ *
+ ******************************************************************************/
+
+#ifndef CONFIG_FILE_H
+#define CONFIG_FILE_H
+
+#include "types.h"
+#include <stdbool.h>
+
+/*
+ * ConfigArgs - A config file as command line arguments
+ *
+ * argv[i] point into text, which holds the whole file (tokens terminated
+ * in place) followed by the "--option" spellings.
+ */
+typedef struct {
+    int argc;
+    char** argv;
+    char* text;
+} ConfigArgs;
+
+/*
+ * config_file_load - Read a config file into arguments
+ *
+ * @param path  File to read
+ * @param out   Filled on success; release with config_file_free()
+ * @return      false if the file cannot be read (out left empty)
+ */
+bool config_file_load(const char* path, ConfigArgs* out);
+
+/*
+ * config_file_free - Release what config_file_load() allocated
+ */
+void config_file_free(ConfigArgs* args);
+
+#endif /* CONFIG_FILE_H */
@@ -146,23 +146,25 @@
  *     - Exhaust memory (buffering data)
  *     - Degrade service for legitimate players
  * 
- * RATE LIMITING ALGORITHM:
- *   Server tracks packets per connection:
+ * RATE LIMITING ALGORITHM - TOKEN BUCKET PER CONNECTION:
+ *   Each PlayerConnection holds in_tokens. Handling a packet spends one;
+ *   every tick adds PACKETS_PER_TICK, up to PACKET_BURST:
  *   
- *   struct Connection {
- *       u32 packet_count;      // Packets received this second
- *       u64 last_reset_time;   // Timestamp of last reset
- *   };
+ *     tokens: 30 ──burst of 30──► 0 ──tick──► 9 ──tick──► 18 ...
  *   
- *   On each packet:
- *     if (now - last_reset_time >= 1000ms) {
- *         packet_count = 0;
- *         last_reset_time = now;
- *     }
- *     packet_count++;
- *     if (packet_count > MAX_PACKETS_PER_SECOND) {
- *         disconnect_player("Packet spam");
- *     }
+ *   A packet that finds the bucket empty is not dropped and does not
+ *   disconnect anyone: it stays buffered (in_buffer, or the network
+ *   thread's inbound ring) and the connection stays listed in
+ *   GameServer.input_pending for the next tick's PACKETS phase. Order
+ *   is preserved; a flood only delays the flooder's own packets, never
+ *   anyone else's tick.
+ *   
+ *   The refill is computed lazily from in_refill_tick when a packet
+ *   arrives, so idle connections cost nothing per tick.
+ *   
+ *   A flooder that fills its buffer stops being read (inline mode:
+ *   unwatched until the tick drains it, so TCP pushes back on the client); with
+ *   --net-thread an overflowing inbound ring disconnects it, as before.
  * 
  * WHY 15?:
  *   - Normal gameplay: ~5 packets/sec (movement, clicks)
@@ -175,11 +177,17 @@
  * 
  * ALTERNATIVES (not used here):
  *   - Token bucket: Allow bursts, smooth rate over time
- *   - Leaky bucket: Fixed rate, drop excess
+ *   - Leaky bucket: Fixed rate, drop excess (we defer instead)
  *   - Sliding window: More accurate, higher complexity
  */
 #define MAX_PACKETS_PER_SECOND 15
 
+/* Tokens added per tick: 15/s at 600ms ticks = 9 */
+#define PACKETS_PER_TICK (MAX_PACKETS_PER_SECOND * TICK_RATE_MS / 1000)
+
+/* Bucket size: a new connection or an idle player may burst two seconds' worth */
+#define PACKET_BURST (MAX_PACKETS_PER_SECOND * 2)
+
 /*
  * TICK_RATE - Game loop tick duration in milliseconds
  * 
@@ -365,40 +373,37 @@
 #define LOGIN_RESPONSE_WORLD_FULL 7
 
 /*
- * LOGIN_RESPONSE_TRY_AGAIN - Temporary server error
+ * LOGIN_RESPONSE_TRY_AGAIN - Server busy, retry shortly
  * 
- * VALUE: 11
+ * VALUE: 1
  * 
- * MEANING: Login failed due to temporary issue, retry may succeed
+ * MEANING: The login was not looked at; sending it again later may succeed
  * 
  * USE CASES:
- *   - Database connection lost
- *   - Authentication service timeout
- *   - Server under heavy load
- *   - Transient network error
+ *   - Login backlog full (reconnect storm after a restart)
+ *   - Login worker queue full with no budget left this tick
  * 
- * SERVER LOGIC:
- *   if (!database_available()) {
- *       log_error("DB unavailable during login");
+ * SERVER LOGIC (login.c, login admission):
+ *   if (logins_waiting >= LOGIN_BACKLOG_MAX) {
  *       return TRY_AGAIN;
  *   }
  * 
  * RETRY STRATEGY:
- *   Client should:
- *     - Wait 2-5 seconds before retry
- *     - Max 3 retry attempts
- *     - Show error if still failing
+ *   The 225 client handles this code itself: it sleeps 2 seconds and
+ *   reconnects with the same credentials, without showing a message.
+ *   The server therefore sheds load without any player clicking
+ *   "Login" again, and a storm spreads out by 2 s per refusal.
  * 
- * MONITORING:
- *   High rate of TRY_AGAIN responses indicates:
- *     - Infrastructure problems
- *     - DDoS attack
- *     - Need to scale resources
+ * NOTE:
+ *   Code 11 ("Login server rejected session. Please try again.") also
+ *   mentions trying again, but the client stops and waits for the
+ *   player there. 1 is the code that retries.
  * 
- * CLIENT DISPLAY:
- *   "Login server unavailable. Please try again in a few moments."
+ * MONITORING:
+ *   A steady stream of TRY_AGAIN (g_login_admission.turned_away) means
+ *   the budget is too small for the login rate, not just a burst.
  */
-#define LOGIN_RESPONSE_TRY_AGAIN 11
+#define LOGIN_RESPONSE_TRY_AGAIN 1
 
 /*
  * LOGIN_RESPONSE_ACCOUNT_LOCKED - Account banned or locked
@@ -526,19 +531,20 @@
  * VALUE: 0x2 (bit 1)
  * 
  * TRIGGERED WHEN:
- *   - Player types message and presses enter
+ *   - Player types message and presses enter (MESSAGE_PUBLIC, chat.c)
  * 
- * DATA SENT (if flag set):
- *   ┌───────────┬────────────┬─────────────────────────┐
- *   │   Color   │   Effect   │   Compressed Text       │
- *   │ (1 byte)  │ (1 byte)   │ (variable, max ~80)     │
- *   └───────────┴────────────┴─────────────────────────┘
+ * DATA SENT (if flag set, client mask bit 0x40 in the 225 client):
+ *   ┌───────────────────┬───────────┬───────────┬─────────────────────┐
+ *   │ Color<<8 | Effect │  Rights   │  Length   │   Packed Text       │
+ *   │    (2 bytes)      │ (1 byte)  │ (1 byte)  │ (length, max 80)    │
+ *   └───────────────────┴───────────┴───────────┴─────────────────────┘
  * 
  * TEXT COMPRESSION:
- *   RuneScape uses Huffman-like encoding to compress text:
- *     - Common words: "the" → 3 bits
- *     - Uncommon letters: "q" → 7 bits
- *     - Reduces "hello world" from 11 bytes to ~6 bytes
+ *   The client packs text with wordpack (src/wordenc/wordpack.c):
+ *     - 13 common characters → 4 bits
+ *     - Everything else → 8 bits
+ *     - Reduces "hello world" from 11 bytes to ~7 bytes
+ *   The server forwards the packed bytes without unpacking them.
  * 
  * FREQUENCY:
  *   - Medium (players chat occasionally)
@@ -4,6 +4,11 @@
  * 
  * Standard CRC32 checksum algorithm for data integrity verification.
  * Uses polynomial 0xEDB88320 (reversed IEEE 802.3 polynomial).
+ *
+ * The one CRC32 in the tree: save files, the save log, snapshots, map
+ * files (map_calculate_crc32) and the client's rs_crc32 all call it.
+ * Slicing-by-8 everywhere, PCLMULQDQ or ARMv8 CRC32 instructions where
+ * the CPU has them (picked at runtime, see crc32.c).
  * 
  ******************************************************************************/
 
@@ -23,4 +28,11 @@
  */
 u32 crc32(const u8* data, size_t length);
 
+/*
+ * crc32_backend - Name of the implementation crc32() uses on this CPU
+ *
+ * @return  "slicing-by-8", "pclmulqdq" or "armv8-crc32"
+ */
+const char* crc32_backend(void);
+
 #endif /* CRC32_H */
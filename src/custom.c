@@ -7,6 +7,7 @@
 #include "client.h"
 #include "custom.h"
 #include "datastruct/jstring.h"
+#include "datastruct/lrucache.h"
 #include "gameshell.h"
 #include "inputtracking.h"
 #include "thirdparty/ini.h"
@@ -109,6 +110,10 @@ void load_ini_config(Client *c) {
     _Custom.resizable = true;
 #endif
     INI_INT_LOG(&(&_Custom), item_outlines, );
+    INI_INT_LOG(&(&_Custom), render_threads, );
+    INI_INT_LOG(&(&_Custom), cache_budget, );
+    INI_INT_LOG(&(&_Custom), anim_cache, );
+    INI_INT_LOG(&(&_Custom), gpu_render, );
 
     rs2_log("\n");
     ini_free(config);
@@ -231,7 +236,16 @@ void draw_info_overlay(Client *c) {
         // skip 2 possible spots of "Close Window"
         y += 13;
         y += 13;
-        sprintf(buf, "LRU: %dK / %dK", bump_allocator_used() >> 10, bump_allocator_capacity() >> 10);
+        sprintf(buf, "LRU: %dK / %dK (peak %dK)", bump_allocator_used() >> 10, bump_allocator_capacity() >> 10, arena_peak(ARENA_SCENE) >> 10);
+        drawStringRight(c->font_plain11, x, y, buf, YELLOW, true);
+        y += 13;
+        sprintf(buf, "Frame: peak %dK / %dK", arena_peak(ARENA_FRAME) >> 10, arena_capacity(ARENA_FRAME) >> 10);
+        drawStringRight(c->font_plain11, x, y, buf, YELLOW, true);
+        y += 13;
+        int64_t cached;
+        uint32_t hits, misses, evictions;
+        lrucache_totals(&cached, &hits, &misses, &evictions);
+        sprintf(buf, "Cache: %dK, %d%% hits, %u evicted", (int)(cached >> 10), hits + misses ? (int)((uint64_t)hits * 100 / (hits + misses)) : 100, evictions);
         drawStringRight(c->font_plain11, x, y, buf, YELLOW, true);
         y += 13;
         sprintf(buf, "FPS: %d", c->shell->fps);
@@ -18,6 +18,10 @@ typedef struct {
     int chat_era; // 0 - early beta, 1 - late beta, 2 - launch
     bool resizable;
     bool item_outlines;
+    int render_threads; // 2+: binned scene rendering on that many threads (pix3d_bin.h)
+    int cache_budget;   // KiB shared by the model and icon caches, 0 for entry counts only (lrucache.h)
+    int anim_cache;     // animated NPC and player frames kept for reuse, 0 for none (model_apply_transform_cached)
+    bool gpu_render;    // draw the scene with GL ES 2 (pix3d_gpu.h), SDL2/SDL3 built with -DPIX3D_GPU
 } Custom;
 
 bool load_ini_args(void);
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <stdint.h>
+
 #include "linkable.h"
 
 typedef struct DoublyLinkable DoublyLinkable;
@@ -7,6 +9,8 @@ struct DoublyLinkable {
     Linkable link;
     DoublyLinkable *next2;
     DoublyLinkable *prev2;
+    int cache_bytes;       // lrucache cost while cached
+    uint32_t cache_stamp;  // lrucache use counter at the last get or put
 };
 
 void doublylinkable_uncache(DoublyLinkable *link);
@@ -3,54 +3,144 @@
 #include <stdlib.h>
 
 #include "doublylinklist.h"
-#include "hashtable.h"
 #include "lrucache.h"
+#include "probetable.h"
+
+static struct {
+    int64_t budget;
+    int64_t bytes;      // over every cache
+    uint32_t stamp;     // use counter, wraps
+    LruCache *caches[LRUCACHE_MAX_CACHES];
+    int cache_count;
+} _Lru;
 
 LruCache *lrucache_new(int size) {
     LruCache *cache = calloc(1, sizeof(LruCache));
     cache->capacity = size;
     cache->available = size;
-    cache->hashtable = hashtable_new(1024);
+    cache->table = probetable_new(size < 1024 ? size : 1024);
     cache->history = doublylinklist_new();
+    if (_Lru.cache_count < LRUCACHE_MAX_CACHES) {
+        _Lru.caches[_Lru.cache_count++] = cache;
+    }
     return cache;
 }
 
 void lrucache_free(LruCache *cache) {
-    hashtable_free(cache->hashtable);
+    for (int i = 0; i < _Lru.cache_count; i++) {
+        if (_Lru.caches[i] == cache) {
+            _Lru.caches[i] = _Lru.caches[--_Lru.cache_count];
+            break;
+        }
+    }
+    _Lru.bytes -= cache->bytes;
+    probetable_free(cache->table);
     doublylinklist_free(cache->history);
     free(cache);
 }
 
+// drops the least recently used entry, false if the cache is empty
+static bool lrucache_evict(LruCache *cache) {
+    DoublyLinkable *node = doublylinklist_pop(cache->history);
+    if (!node) {
+        return false;
+    }
+    probetable_remove(cache->table, node->link.key, node);
+    cache->bytes -= node->cache_bytes;
+    _Lru.bytes -= node->cache_bytes;
+    node->cache_bytes = 0;
+    if (cache->evicted) {
+        cache->evicted(node);
+    }
+    return true;
+}
+
 DoublyLinkable *lrucache_get(LruCache *cache, int64_t key) {
-    DoublyLinkable *node = (DoublyLinkable *)hashtable_get(cache->hashtable, key);
+    DoublyLinkable *node = probetable_get(cache->table, key);
     if (node) {
+        node->cache_stamp = ++_Lru.stamp;
         doublylinklist_push(cache->history, node);
+        cache->hits++;
+    } else {
+        cache->misses++;
     }
 
     return node;
 }
 
-void lrucache_put(LruCache *cache, int64_t key, DoublyLinkable *value) {
+// evicts across caches, oldest use first, until the costs fit the budget
+static void lrucache_fit_budget(DoublyLinkable *keep) {
+    while (_Lru.budget > 0 && _Lru.bytes > _Lru.budget) {
+        LruCache *oldest = NULL;
+        uint32_t age = 0;
+        for (int i = 0; i < _Lru.cache_count; i++) {
+            LruCache *cache = _Lru.caches[i];
+            DoublyLinkable *node = cache->history->head->next2;
+            if (cache->bytes <= 0 || node == cache->history->head || node == keep) {
+                continue;
+            }
+            if (!oldest || _Lru.stamp - node->cache_stamp > age) {
+                oldest = cache;
+                age = _Lru.stamp - node->cache_stamp;
+            }
+        }
+        if (!oldest || !lrucache_evict(oldest)) {
+            return;
+        }
+        oldest->available++;
+        oldest->evictions++;
+    }
+}
+
+void lrucache_put_sized(LruCache *cache, int64_t key, DoublyLinkable *value, int bytes) {
+    if (!probetable_put(cache->table, key, value)) {
+        return;
+    }
+    value->link.key = key;
     if (cache->available == 0) {
-        DoublyLinkable *node = doublylinklist_pop(cache->history);
-        linkable_unlink(&node->link);
-        doublylinkable_uncache(node);
+        if (lrucache_evict(cache)) {
+            cache->evictions++;
+        }
     } else {
         cache->available--;
     }
-    hashtable_put(cache->hashtable, key, &value->link);
+    value->cache_bytes = bytes;
+    value->cache_stamp = ++_Lru.stamp;
+    cache->bytes += bytes;
+    _Lru.bytes += bytes;
     doublylinklist_push(cache->history, value);
+    lrucache_fit_budget(value);
+}
+
+void lrucache_put(LruCache *cache, int64_t key, DoublyLinkable *value) {
+    lrucache_put_sized(cache, key, value, 0);
 }
 
 void lrucache_clear(LruCache *cache) {
-    while (true) {
-        DoublyLinkable *node = doublylinklist_pop(cache->history);
-        if (!node) {
-            cache->available = cache->capacity;
-            return;
-        }
+    while (lrucache_evict(cache)) {
+    }
+    cache->available = cache->capacity;
+}
+
+void lrucache_set_evicted(LruCache *cache, void (*evicted)(DoublyLinkable *value)) {
+    cache->evicted = evicted;
+}
+
+void lrucache_set_budget(int64_t bytes) {
+    _Lru.budget = bytes;
+    lrucache_fit_budget(NULL);
+}
+
+int64_t lrucache_budget(void) {
+    return _Lru.budget;
+}
 
-        linkable_unlink(&node->link);
-        doublylinkable_uncache(node);
+void lrucache_totals(int64_t *bytes, uint32_t *hits, uint32_t *misses, uint32_t *evictions) {
+    *bytes = _Lru.bytes;
+    *hits = *misses = *evictions = 0;
+    for (int i = 0; i < _Lru.cache_count; i++) {
+        *hits += _Lru.caches[i]->hits;
+        *misses += _Lru.caches[i]->misses;
+        *evictions += _Lru.caches[i]->evictions;
     }
 }
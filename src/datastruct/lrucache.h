@@ -3,17 +3,45 @@
 #include <stdint.h>
 
 #include "doublylinklist.h"
-#include "hashtable.h"
+#include "probetable.h"
+
+// Least recently used cache. Every cache holds at most capacity entries,
+// and entries put with a byte cost (lrucache_put_sized) also count against
+// a budget shared by all caches: while the costs add up to more than the
+// budget, the entry used longest ago - in whichever cache - is evicted.
+//
+// Evicting only drops an entry from its cache, as it always did: cached
+// models and icons live in the bump allocator (allocator.h) and are
+// reclaimed together when the caches are cleared. A cache of heap entries
+// sets an evicted callback (lrucache_set_evicted) to free each one as it
+// leaves, whether for capacity, budget or lrucache_clear.
+
+#define LRUCACHE_MAX_CACHES 32
 
 typedef struct {
     int capacity;
     int available;
-    HashTable *hashtable;
+    ProbeTable *table;  // key -> DoublyLinkable
     DoublyLinkList *history;
+    int64_t bytes;      // costs of the entries held
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t evictions; // for capacity or budget, not by lrucache_clear
+    void (*evicted)(DoublyLinkable *value);
 } LruCache;
 
 LruCache *lrucache_new(int size);
 DoublyLinkable *lrucache_get(LruCache *cache, int64_t key);
 void lrucache_put(LruCache *cache, int64_t key, DoublyLinkable *value);
+// bytes: what holding value costs, counted against the shared budget
+void lrucache_put_sized(LruCache *cache, int64_t key, DoublyLinkable *value, int bytes);
 void lrucache_clear(LruCache *cache);
+// called with every entry dropped from cache from now on, NULL for none
+void lrucache_set_evicted(LruCache *cache, void (*evicted)(DoublyLinkable *value));
 void lrucache_free(LruCache *cache);
+
+// budget shared by every cache, 0 (the default) for capacities only
+void lrucache_set_budget(int64_t bytes);
+int64_t lrucache_budget(void);
+// totals over every live cache
+void lrucache_totals(int64_t *bytes, uint32_t *hits, uint32_t *misses, uint32_t *evictions);
@@ -0,0 +1,120 @@
+#include <stdlib.h>
+
+#include "probetable.h"
+
+// keys are ids and packed bitsets whose low bits repeat, so mix every bit
+// into the slot index (the splitmix64 finalizer)
+static uint32_t probetable_hash(int64_t key) {
+    uint64_t h = (uint64_t)key;
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    return (uint32_t)(h ^ (h >> 31));
+}
+
+ProbeTable *probetable_new(uint32_t capacity) {
+    uint32_t size = 16;
+    while (size < capacity + capacity / 3 && size < (1u << 30)) {
+        size <<= 1;
+    }
+    ProbeTable *table = calloc(1, sizeof(ProbeTable));
+    if (!table) {
+        return NULL;
+    }
+    table->slots = calloc(size, sizeof(ProbeSlot));
+    if (!table->slots) {
+        free(table);
+        return NULL;
+    }
+    table->mask = size - 1;
+    return table;
+}
+
+void probetable_free(ProbeTable *table) {
+    if (table) {
+        free(table->slots);
+        free(table);
+    }
+}
+
+void *probetable_get(const ProbeTable *table, int64_t key) {
+    for (uint32_t i = probetable_hash(key) & table->mask;; i = (i + 1) & table->mask) {
+        const ProbeSlot *slot = &table->slots[i];
+        if (!slot->value) {
+            return NULL;
+        }
+        if (slot->key == key) {
+            return slot->value;
+        }
+    }
+}
+
+static bool probetable_grow(ProbeTable *table) {
+    uint32_t size = (table->mask + 1) * 2;
+    ProbeSlot *slots = calloc(size, sizeof(ProbeSlot));
+    if (!slots) {
+        return false;
+    }
+    for (uint32_t i = 0; i <= table->mask; i++) {
+        ProbeSlot *slot = &table->slots[i];
+        if (slot->value) {
+            uint32_t j = probetable_hash(slot->key) & (size - 1);
+            while (slots[j].value) {
+                j = (j + 1) & (size - 1);
+            }
+            slots[j] = *slot;
+        }
+    }
+    free(table->slots);
+    table->slots = slots;
+    table->mask = size - 1;
+    return true;
+}
+
+bool probetable_put(ProbeTable *table, int64_t key, void *value) {
+    if ((table->count + 1) * 4 > (table->mask + 1) * 3 && !probetable_grow(table)) {
+        return false;
+    }
+    for (uint32_t i = probetable_hash(key) & table->mask;; i = (i + 1) & table->mask) {
+        ProbeSlot *slot = &table->slots[i];
+        if (!slot->value) {
+            slot->key = key;
+            slot->value = value;
+            table->count++;
+            return true;
+        }
+        if (slot->key == key) {
+            slot->value = value;
+            return true;
+        }
+    }
+}
+
+bool probetable_remove(ProbeTable *table, int64_t key, const void *value) {
+    uint32_t i = probetable_hash(key) & table->mask;
+    for (;; i = (i + 1) & table->mask) {
+        ProbeSlot *slot = &table->slots[i];
+        if (!slot->value) {
+            return false;
+        }
+        if (slot->key == key) {
+            if (slot->value != value) {
+                return false;
+            }
+            break;
+        }
+    }
+
+    // backward shift: pull later entries of the run into the gap unless
+    // that would move one before its home slot
+    uint32_t gap = i;
+    for (uint32_t j = (i + 1) & table->mask; table->slots[j].value; j = (j + 1) & table->mask) {
+        uint32_t home = probetable_hash(table->slots[j].key) & table->mask;
+        if (((j - home) & table->mask) >= ((j - gap) & table->mask)) {
+            table->slots[gap] = table->slots[j];
+            gap = j;
+        }
+    }
+    table->slots[gap].value = NULL;
+    table->count--;
+    return true;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Open-addressing map from 64-bit keys to pointers, for LruCache lookups.
+// Keys and values sit inline in one array and collisions probe the next
+// slots (linear probing), so a lookup reads one or two cache lines where
+// HashTable walks a bucket's linked nodes across the heap.
+//
+//   slots  [k:v][   ][k:v][k:v][k:v][   ] ...
+//                      ^hash   ^probe  ^probe
+//
+// Removal shifts the following entries of the run back into the gap
+// (no tombstones), and the table doubles at 3/4 full.
+
+typedef struct {
+    int64_t key;
+    void *value; // NULL marks an empty slot
+} ProbeSlot;
+
+typedef struct {
+    ProbeSlot *slots;
+    uint32_t mask; // slot count - 1 (a power of 2)
+    uint32_t count;
+} ProbeTable;
+
+// capacity: entries expected, the table grows past it as needed
+ProbeTable *probetable_new(uint32_t capacity);
+void probetable_free(ProbeTable *table);
+void *probetable_get(const ProbeTable *table, int64_t key);
+// replaces the value of a key already present; false if out of memory
+bool probetable_put(ProbeTable *table, int64_t key, void *value);
+// removes key only while it maps to value; false if it did not
+bool probetable_remove(ProbeTable *table, int64_t key, const void *value);
@@ -0,0 +1,109 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "slotmap.h"
+
+#define SLOTMAP_USED (UINT32_MAX - 1)
+
+static void slotmap_push_free(SlotMap *map, uint32_t index) {
+    map->next[index] = SLOTMAP_NONE;
+    if (map->free_tail == SLOTMAP_NONE) {
+        map->free_head = index;
+    } else {
+        map->next[map->free_tail] = index;
+    }
+    map->free_tail = index;
+}
+
+SlotMap *slotmap_new(uint32_t capacity, uint32_t first) {
+    if (capacity > SLOTMAP_MAX_CAPACITY) {
+        return NULL;
+    }
+
+    SlotMap *map = calloc(1, sizeof(SlotMap));
+    if (!map) {
+        return NULL;
+    }
+    map->next = calloc(capacity ? capacity : 1, sizeof(uint32_t));
+    map->generation = calloc(capacity ? capacity : 1, sizeof(uint16_t));
+    if (!map->next || !map->generation) {
+        slotmap_free(map);
+        return NULL;
+    }
+
+    map->capacity = capacity;
+    map->first = first;
+    map->free_head = SLOTMAP_NONE;
+    map->free_tail = SLOTMAP_NONE;
+    for (uint32_t i = 0; i < capacity; i++) {
+        map->generation[i] = 1;
+        if (i < first) {
+            map->next[i] = SLOTMAP_USED; // reserved, never handed out or released
+        } else {
+            slotmap_push_free(map, i);
+        }
+    }
+    return map;
+}
+
+void slotmap_free(SlotMap *map) {
+    if (!map) {
+        return;
+    }
+    free(map->next);
+    free(map->generation);
+    free(map);
+}
+
+uint32_t slotmap_alloc(SlotMap *map) {
+    if (!map || map->free_head == SLOTMAP_NONE) {
+        return SLOTMAP_NONE;
+    }
+
+    uint32_t index = map->free_head;
+    map->free_head = map->next[index];
+    if (map->free_head == SLOTMAP_NONE) {
+        map->free_tail = SLOTMAP_NONE;
+    }
+    map->next[index] = SLOTMAP_USED;
+    map->count++;
+    return index;
+}
+
+uint32_t slotmap_peek(const SlotMap *map) {
+    return map ? map->free_head : SLOTMAP_NONE;
+}
+
+void slotmap_release(SlotMap *map, uint32_t index) {
+    if (!slotmap_used(map, index) || index < map->first) {
+        return;
+    }
+
+    // skip 0 on wrap so no handle is ever 0
+    map->generation[index] = (uint16_t)(map->generation[index] + 1);
+    if (map->generation[index] == 0) {
+        map->generation[index] = 1;
+    }
+    map->count--;
+    slotmap_push_free(map, index);
+}
+
+bool slotmap_used(const SlotMap *map, uint32_t index) {
+    return map && index < map->capacity && map->next[index] == SLOTMAP_USED;
+}
+
+SlotHandle slotmap_handle(const SlotMap *map, uint32_t index) {
+    if (!map || index >= map->capacity) {
+        return 0;
+    }
+    return ((SlotHandle)map->generation[index] << 16) | index;
+}
+
+uint32_t slotmap_resolve(const SlotMap *map, SlotHandle handle) {
+    uint32_t index = handle & 0xFFFF;
+    if (!slotmap_used(map, index) || map->generation[index] != (handle >> 16)) {
+        return SLOTMAP_NONE;
+    }
+    return index;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Index allocator for fixed arrays of entities (player slots, PIDs, NPCs,
+// objects). Free indices form an intrusive FIFO list threaded through
+// next[], so alloc and release are O(1) instead of scanning the array for
+// an unused entry. FIFO order hands out the index that has been free the
+// longest (ascending on a fresh map), so a just-released index is not
+// reused straight away.
+//
+// Each index has a generation, bumped on release. A SlotHandle packs
+// [generation:16][index:16] and stops resolving once its index has been
+// released, which catches references that outlive what they pointed at.
+
+#define SLOTMAP_NONE UINT32_MAX
+#define SLOTMAP_MAX_CAPACITY 65536
+
+// 0 is never a valid handle (generations start at 1)
+typedef uint32_t SlotHandle;
+
+typedef struct {
+    uint32_t capacity;
+    uint32_t first;        // lowest index handed out
+    uint32_t count;        // indices in use
+    uint32_t free_head;    // next index to hand out, SLOTMAP_NONE if full
+    uint32_t free_tail;
+    uint32_t *next;        // free-list link, SLOTMAP_USED while allocated
+    uint16_t *generation;
+} SlotMap;
+
+// indices below first are never handed out (e.g. PID 0)
+SlotMap *slotmap_new(uint32_t capacity, uint32_t first);
+void slotmap_free(SlotMap *map);
+
+// returns SLOTMAP_NONE when every index is in use
+uint32_t slotmap_alloc(SlotMap *map);
+// index the next alloc will return, without taking it
+uint32_t slotmap_peek(const SlotMap *map);
+// no-op for an index that is not allocated
+void slotmap_release(SlotMap *map, uint32_t index);
+bool slotmap_used(const SlotMap *map, uint32_t index);
+
+SlotHandle slotmap_handle(const SlotMap *map, uint32_t index);
+// index of a live handle, or SLOTMAP_NONE if it is stale or invalid
+uint32_t slotmap_resolve(const SlotMap *map, SlotHandle handle);
@@ -0,0 +1,293 @@
+/*******************************************************************************
+ * DEF_STORE.C - Definition Tables: Hot Arrays, Interned Strings, Snapshot Tables
+ *******************************************************************************
+ *
+ * See def_store.h for the design.
+ *
+ * SNAPSHOT TABLES:
+ *
+ *   snapshot_open() has already checked the fingerprint and checksums.
+ *   The store additionally requires every definition section and a
+ *   NUL-terminated pool, or it ignores the snapshot and decodes. String
+ *   offsets in the text tables are checked on every lookup
+ *   (def_store_string), so a bad offset reads as "" instead of running
+ *   off the pool.
+ *
+ ******************************************************************************/
+
+#include "def_store.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+DefStore* g_defs = NULL;
+
+/*******************************************************************************
+ * STRING POOL
+ ******************************************************************************/
+
+static inline u32 string_hash(const char* str, u32 len) {
+    u32 h = 2166136261u;  /* FNV-1a */
+    for (u32 i = 0; i < len; i++) {
+        h = (h ^ (u8)str[i]) * 16777619u;
+    }
+    return h;
+}
+
+static bool string_pool_init(StringPool* pool) {
+    pool->capacity = 64 * 1024;
+    pool->data = malloc(pool->capacity);
+    pool->table_mask = 4095;
+    pool->table = calloc(pool->table_mask + 1, sizeof(u32));
+    if (!pool->data || !pool->table) return false;
+    pool->data[0] = '\0';
+    pool->size = 1;
+    return true;
+}
+
+static void string_pool_free(StringPool* pool) {
+    free(pool->data);
+    free(pool->table);
+    memset(pool, 0, sizeof(StringPool));
+}
+
+/*
+ * string_pool_grow_table - Double the table (kept at most half full)
+ */
+static bool string_pool_grow_table(StringPool* pool) {
+    u32 mask = pool->table_mask * 2 + 1;
+    u32* table = calloc(mask + 1, sizeof(u32));
+    if (!table) return false;
+
+    for (u32 i = 0; i <= pool->table_mask; i++) {
+        u32 offset = pool->table[i];
+        if (offset == 0) continue;
+        const char* str = pool->data + offset;
+        u32 j = string_hash(str, (u32)strlen(str)) & mask;
+        while (table[j] != 0) j = (j + 1) & mask;
+        table[j] = offset;
+    }
+    free(pool->table);
+    pool->table = table;
+    pool->table_mask = mask;
+    return true;
+}
+
+u32 def_store_intern(DefStore* store, const char* str, u32 len) {
+    if (!store || !str || len == 0) return 0;
+    StringPool* pool = &store->strings;
+    if (!pool->data) return 0;  /* Loaded from a snapshot: the pool is frozen */
+
+    u32 i = string_hash(str, len) & pool->table_mask;
+    while (pool->table[i] != 0) {
+        const char* existing = pool->data + pool->table[i];
+        if (memcmp(existing, str, len) == 0 && existing[len] == '\0') {
+            return pool->table[i];
+        }
+        i = (i + 1) & pool->table_mask;
+    }
+
+    if (pool->size + len + 1 > pool->capacity) {
+        u32 capacity = pool->capacity;
+        while (pool->size + len + 1 > capacity) capacity *= 2;
+        char* data = realloc(pool->data, capacity);
+        if (!data) return 0;
+        pool->data = data;
+        pool->capacity = capacity;
+    }
+
+    u32 offset = pool->size;
+    memcpy(pool->data + offset, str, len);
+    pool->data[offset + len] = '\0';
+    pool->size += len + 1;
+    pool->table[i] = offset;
+    pool->count++;
+
+    if (pool->count * 2 > pool->table_mask + 1) {
+        string_pool_grow_table(pool);  /* On failure probes just get longer */
+    }
+    return offset;
+}
+
+const char* def_store_string(const DefStore* store, u32 offset) {
+    if (!store) return "";
+    if (store->snapshot) {
+        if (offset >= store->mapped_strings_size) return "";
+        return store->mapped_strings + offset;
+    }
+    if (offset >= store->strings.size) return "";
+    return store->strings.data + offset;
+}
+
+/*******************************************************************************
+ * STORE
+ ******************************************************************************/
+
+/*
+ * def_store_use_snapshot - Take the tables from a snapshot if all are there
+ */
+static bool def_store_use_snapshot(DefStore* store, const Snapshot* snapshot) {
+    for (u32 i = 0; i < DEF_SECTION_COUNT; i++) {
+        u32 elem_size = snapshot->header->sections[i].elem_size;
+        u32 count = 0;
+        if (!snapshot_section(snapshot, (SnapshotSection)i, elem_size, &count) || count == 0) {
+            return false;
+        }
+    }
+
+    u32 size = 0;
+    const char* strings = snapshot_section(snapshot, SNAPSHOT_STRINGS, 1, &size);
+    if (!strings || size == 0 || strings[size - 1] != '\0') return false;
+
+    store->snapshot = snapshot;
+    store->mapped_strings = strings;
+    store->mapped_strings_size = size;
+    return true;
+}
+
+DefStore* def_store_create(const Snapshot* snapshot) {
+    DefStore* store = calloc(1, sizeof(DefStore));
+    if (!store) return NULL;
+
+    if (snapshot && def_store_use_snapshot(store, snapshot)) {
+        return store;
+    }
+
+    if (!string_pool_init(&store->strings)) {
+        def_store_destroy(store);
+        return NULL;
+    }
+    return store;
+}
+
+void def_store_destroy(DefStore* store) {
+    if (!store) return;
+    for (u32 i = 0; i < DEF_SECTION_COUNT; i++) {
+        free(store->tables[i]);
+    }
+    string_pool_free(&store->strings);
+    free(store);
+}
+
+const void* def_store_section(const DefStore* store, DefSection section, u32 elem_size, u32* count) {
+    if (!store || !store->snapshot || section >= DEF_SECTION_COUNT) return NULL;
+    return snapshot_section(store->snapshot, (SnapshotSection)section, elem_size, count);
+}
+
+void* def_store_table(DefStore* store, DefSection section, u32 elem_size, u32 count) {
+    if (!store || section >= DEF_SECTION_COUNT || elem_size == 0 || count == 0) return NULL;
+
+    void* table = calloc(count, elem_size);
+    if (!table) return NULL;
+    free(store->tables[section]);
+    store->tables[section] = table;
+    store->counts[section] = count;
+    store->elem_sizes[section] = elem_size;
+    return table;
+}
+
+bool def_store_snapshot(const DefStore* store, SnapshotWriter* writer) {
+    if (!store || !writer) return false;
+
+    if (store->snapshot) {
+        for (u32 i = 0; i < DEF_SECTION_COUNT; i++) {
+            u32 elem_size = store->snapshot->header->sections[i].elem_size;
+            u32 count = 0;
+            const void* table = snapshot_section(store->snapshot, (SnapshotSection)i, elem_size, &count);
+            snapshot_writer_set(writer, (SnapshotSection)i, table, elem_size, count);
+        }
+        snapshot_writer_set(writer, SNAPSHOT_STRINGS, store->mapped_strings, 1,
+                            store->mapped_strings_size);
+        return true;
+    }
+
+    for (u32 i = 0; i < DEF_SECTION_COUNT; i++) {
+        if (!store->tables[i]) return false;
+        snapshot_writer_set(writer, (SnapshotSection)i, store->tables[i],
+                            store->elem_sizes[i], store->counts[i]);
+    }
+    snapshot_writer_set(writer, SNAPSHOT_STRINGS, store->strings.data, 1, store->strings.size);
+    return true;
+}
+
+/*******************************************************************************
+ * CONFIG FILE DECODING
+ ******************************************************************************/
+
+u32 config_g1(ConfigReader* r) {
+    if (r->pos >= r->size) {
+        r->overrun = true;
+        return 0;
+    }
+    return r->data[r->pos++];
+}
+
+i32 config_g1b(ConfigReader* r) {
+    return (i32)(i8)config_g1(r);
+}
+
+u32 config_g2(ConfigReader* r) {
+    u32 hi = config_g1(r);
+    return (hi << 8) | config_g1(r);
+}
+
+u32 config_g4(ConfigReader* r) {
+    u32 hi = config_g2(r);
+    return (hi << 16) | config_g2(r);
+}
+
+void config_skip(ConfigReader* r, u32 bytes) {
+    if (bytes > r->size - r->pos) {
+        r->pos = r->size;
+        r->overrun = true;
+    } else {
+        r->pos += bytes;
+    }
+}
+
+/* Strings in config files end with '\n' (see gjstr) */
+u32 config_string(ConfigReader* r, DefStore* store) {
+    u32 start = r->pos;
+    while (r->pos < r->size && r->data[r->pos] != 10) {
+        r->pos++;
+    }
+    if (r->pos >= r->size) {
+        r->overrun = true;
+        return 0;
+    }
+    u32 len = r->pos - start;
+    r->pos++;  /* '\n' */
+    return def_store_intern(store, (const char*)r->data + start, len);
+}
+
+bool config_table_open(ConfigTable* table, CacheSystem* cache, const char* name) {
+    char idx_name[32];
+    char dat_name[32];
+    u32 idx_size = 0;
+    u32 dat_size = 0;
+
+    memset(table, 0, sizeof(ConfigTable));
+    if (!cache) return false;
+    snprintf(idx_name, sizeof(idx_name), "%s.idx", name);
+    snprintf(dat_name, sizeof(dat_name), "%s.dat", name);
+
+    const u8* idx = cache_get_file(cache, CACHE_ARCHIVE_CONFIG, idx_name, &idx_size);
+    const u8* dat = cache_get_file(cache, CACHE_ARCHIVE_CONFIG, dat_name, &dat_size);
+    if (!idx || !dat) return false;
+
+    table->index = (ConfigReader){ idx, idx_size, 0, false };
+    table->count = config_g2(&table->index);
+    table->dat = dat;
+    table->dat_size = dat_size;
+    table->offset = 2;
+    return !table->index.overrun && table->count > 0;
+}
+
+bool config_table_next(ConfigTable* table, ConfigReader* def) {
+    u32 length = config_g2(&table->index);
+    if (table->index.overrun) return false;
+
+    *def = (ConfigReader){ table->dat, table->dat_size, table->offset, false };
+    table->offset += length;
+    return true;
+}
@@ -0,0 +1,235 @@
+/*******************************************************************************
+ * DEF_STORE.H - Definition Tables: Hot Arrays, Interned Strings, Snapshot Tables
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Hot/cold data splitting (keep what the tick reads together)
+ *   - String interning (one copy of each distinct string)
+ *   - Decoding length-prefixed config files without copying them
+ *   - Zero-copy loading of a prebuilt image with mmap
+ *
+ * THE PROBLEM:
+ *
+ * ItemDefinition, NpcDefinition and ObjectDefinition used to inline their
+ * text: name[64], examine[128] and, for objects, actions[5][32]. An
+ * object definition was ~400 bytes of which the collision code reads 6:
+ *
+ *   ┌──┬──────── name ────────┬───────── examine ─────────┬─┬─┬─┬──────┐
+ *   │id│ "Door\0.........."   │ "A wooden door.\0........"│w│l│s│ ...  │
+ *   └──┴──────────────────────┴───────────────────────────┴─┴─┴─┴──────┘
+ *      cold: 192 bytes between the id and width/length/solid
+ *
+ * Every lookup pulled several cache lines of text nobody reads, and
+ * thousands of definitions stored "Open", "Close" and "Examine" over and
+ * over in fixed-size buffers.
+ *
+ * THE SOLUTION - SPLIT TABLES:
+ *
+ *   definitions[]  hot fields only (stackable, solid, width, ...)
+ *   text[]         per definition, u32 offsets into the string pool
+ *   string pool    every distinct string once, NUL-terminated
+ *
+ *   text[1519] = { name: 812, examine: 4410, actions: { 96, 0, ... } }
+ *   pool:  ... 96:"Open\0" ... 812:"Door\0" ... 4410:"A wooden door.\0"
+ *
+ * Offset 0 is always the empty string, so a zeroed text entry reads as
+ * "no name, no actions".
+ *
+ * DECODING:
+ *
+ * The *_system_init() loaders walk obj / npc / loc .idx + .dat in the
+ * config archive with a ConfigReader straight into those tables; strings
+ * are interned from the decoded file without an intermediate copy.
+ *
+ * SNAPSHOT (snapshot.h):
+ *
+ * The tables and the pool are sections of the world snapshot. When the
+ * snapshot is current the systems point their arrays straight into the
+ * mapping: no decoding, no copying, and pages the server never touches
+ * are never read from disk. Otherwise they decode as above and the
+ * server writes a new snapshot from def_store_snapshot().
+ *
+ ******************************************************************************/
+
+#ifndef DEF_STORE_H
+#define DEF_STORE_H
+
+#include "types.h"
+#include "cache.h"
+#include "snapshot.h"
+#include <stdbool.h>
+
+/*
+ * DefSection - Tables stored in the store (same numbers as the snapshot's)
+ */
+typedef enum {
+    DEF_SECTION_ITEMS = SNAPSHOT_ITEMS,
+    DEF_SECTION_ITEM_TEXT = SNAPSHOT_ITEM_TEXT,
+    DEF_SECTION_NPCS = SNAPSHOT_NPCS,
+    DEF_SECTION_NPC_TEXT = SNAPSHOT_NPC_TEXT,
+    DEF_SECTION_OBJECTS = SNAPSHOT_OBJECTS,
+    DEF_SECTION_OBJECT_TEXT = SNAPSHOT_OBJECT_TEXT,
+    DEF_SECTION_COUNT
+} DefSection;
+
+/*
+ * DefText - Name and examine text of an item or NPC (pool offsets)
+ */
+typedef struct {
+    u32 name;
+    u32 examine;
+} DefText;
+
+/*
+ * StringPool - Interned NUL-terminated strings, addressed by offset
+ */
+typedef struct {
+    char* data;
+    u32 size;                   /* Bytes used (data[0] is the empty string) */
+    u32 capacity;
+    u32* table;                 /* Open addressing: offset, 0 = empty */
+    u32 table_mask;
+    u32 count;                  /* Distinct strings interned */
+} StringPool;
+
+/*
+ * DefStore - Owner of every definition table and the string pool
+ *
+ * Tables come either from def_store_table() (decoded this boot, owned
+ * here) or from the snapshot (def_store_section()). Systems never free
+ * their definition arrays.
+ */
+typedef struct {
+    StringPool strings;
+
+    const Snapshot* snapshot;   /* Non-NULL when the tables are mapped */
+    const char* mapped_strings; /* Snapshot's string pool */
+    u32 mapped_strings_size;
+
+    void* tables[DEF_SECTION_COUNT];    /* Decoded tables (heap) */
+    u32 counts[DEF_SECTION_COUNT];
+    u32 elem_sizes[DEF_SECTION_COUNT];
+} DefStore;
+
+extern DefStore* g_defs;
+
+/*
+ * def_store_create - Create the store, on top of a snapshot if given
+ *
+ * @param snapshot  Validated snapshot (snapshot_open), or NULL to decode
+ * @return          New store, or NULL on allocation failure
+ *
+ * With a snapshot the pool is frozen: def_store_intern() returns 0.
+ */
+DefStore* def_store_create(const Snapshot* snapshot);
+
+/*
+ * def_store_destroy - Free every decoded table and the pool
+ *
+ * The snapshot, if any, stays open: it belongs to the caller.
+ */
+void def_store_destroy(DefStore* store);
+
+/*
+ * def_store_section - A table from the snapshot
+ *
+ * @param store      Store
+ * @param section    Table wanted
+ * @param elem_size  sizeof() the caller's struct
+ * @param count      Receives the number of entries
+ * @return           Read-only table, or NULL without a snapshot
+ */
+const void* def_store_section(const DefStore* store, DefSection section, u32 elem_size, u32* count);
+
+/*
+ * def_store_table - Allocate a zeroed table to decode into
+ *
+ * Owned by the store, and added to the next snapshot by def_store_snapshot().
+ */
+void* def_store_table(DefStore* store, DefSection section, u32 elem_size, u32 count);
+
+/*
+ * def_store_intern - Add a string (len bytes, no NUL needed) to the pool
+ *
+ * @return  Offset of the string; 0 for "" or on allocation failure
+ *
+ * COMPLEXITY: O(len) average
+ */
+u32 def_store_intern(DefStore* store, const char* str, u32 len);
+
+/*
+ * def_store_string - String at a pool offset ("" if out of range)
+ */
+const char* def_store_string(const DefStore* store, u32 offset);
+
+/*
+ * def_store_snapshot - Add the tables and pool to a snapshot writer
+ *
+ * Works for mapped and decoded tables alike (the pointers must stay
+ * valid until the writer has saved).
+ *
+ * @return  false if a table is missing
+ */
+bool def_store_snapshot(const DefStore* store, SnapshotWriter* writer);
+
+/*******************************************************************************
+ * CONFIG FILE DECODING
+ ******************************************************************************/
+
+/*
+ * ConfigReader - Bounds-checked cursor over one config definition
+ *
+ * Reads past the end return 0 and set overrun, so one check after the
+ * opcode loop replaces a check per field.
+ */
+typedef struct {
+    const u8* data;
+    u32 size;
+    u32 pos;
+    bool overrun;
+} ConfigReader;
+
+u32 config_g1(ConfigReader* r);
+i32 config_g1b(ConfigReader* r);
+u32 config_g2(ConfigReader* r);
+u32 config_g4(ConfigReader* r);
+void config_skip(ConfigReader* r, u32 bytes);
+
+/*
+ * config_string - Intern a '\n'-terminated config string
+ *
+ * @return  Pool offset (0 for an empty string)
+ */
+u32 config_string(ConfigReader* r, DefStore* store);
+
+/*
+ * ConfigTable - Walks the definitions of a .idx / .dat pair
+ *
+ *   .idx: g2 count, then g2 length per definition
+ *   .dat: g2 count, then the definitions back to back
+ */
+typedef struct {
+    ConfigReader index;
+    const u8* dat;
+    u32 dat_size;
+    u32 count;
+    u32 offset;                 /* Start of the next definition in .dat */
+} ConfigTable;
+
+/*
+ * config_table_open - Find a config file pair in the config archive
+ *
+ * @param name  Base name, e.g. "obj" for obj.idx / obj.dat
+ * @return      false if the cache or either file is missing
+ */
+bool config_table_open(ConfigTable* table, CacheSystem* cache, const char* name);
+
+/*
+ * config_table_next - Reader over the next definition
+ *
+ * @return  false once the index runs out
+ */
+bool config_table_next(ConfigTable* table, ConfigReader* def);
+
+#endif /* DEF_STORE_H */
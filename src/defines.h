@@ -50,17 +50,26 @@
 // NOTE: more extreme lowmem mode, making the game fully explorable on 32 MB
 // -2 MB RAM, may cause some models to be invisible
 #define MODEL_MAX_DEPTH 600
-// -1 MB RAM, may cause buffer overflows
-#define MODEL_DEPTH_FACE_COUNT 80
 // -1 MB RAM, may cause more lag
 #define PIX3D_POOL_COUNT 5
 // -1 MB RAM, disables login screen flames
 #define DISABLE_FLAMES
+// -2 MB RAM, re-projects scenery every frame
+#define MODEL_PROJECTION_CACHE 0
 #else
 #define MODEL_MAX_DEPTH 1500
-#define MODEL_DEPTH_FACE_COUNT 512
 #define PIX3D_POOL_COUNT 20
+#define MODEL_PROJECTION_CACHE 4096
 #endif
+
+// interface areas blit only what changed since their last draw: needs a window that keeps its
+// contents between frames and a cursor not drawn into it (the consoles redraw theirs every blit)
+#if defined(SDL) && SDL > 1 && !defined(__EMSCRIPTEN__)
+#define PIXMAP_DIRTY_TRACKING 1
+#else
+#define PIXMAP_DIRTY_TRACKING 0
+#endif
+
 #define LOCBUFFER_COUNT 100
 #define MAX_NPC_COUNT 8192
 #define MAX_PLAYER_COUNT 2048
@@ -10,6 +10,7 @@
 #include "../allocator.h"
 #include "../animbase.h"
 #include "../animframe.h"
+#include "../archive_cache.h"
 #include "../client.h"
 #include "../clientstream.h"
 #include "../collisionmap.h"
@@ -35,12 +36,15 @@
 #include "../packet.h"
 #include "../pix24.h"
 #include "../pix3d.h"
+#include "../pix3d_bin.h"
+#include "../pix3d_gpu.h"
 #include "../pix8.h"
 #include "../pixmap.h"
 #include "../platform.h"
 #include "../playerentity.h"
 #include "../projectileentity.h"
 #include "../protocol.h"
+#include "../scene_decode.h"
 #include "../seqtype.h"
 #include "../sound/wave.h"
 #include "../spotanimentity.h"
@@ -105,6 +109,10 @@ static void client_scenemap_free(Client *c);
 static void client_build_scene(Client *c);
 static void client_clear_caches(void);
 static void client_update_orbit_camera(Client *c);
+static void client_redraw_root(Client *c, int root);
+static void client_redraw_varp_readers(Client *c, int varp);
+static void client_redraw_readers(Client *c, int reads);
+static void client_spawned_reindex(Client *c);
 
 void client_init_global(void) {
     int acc = 0;
@@ -211,19 +219,6 @@ void client_load(Client *c) {
     client_load_title_background(c);
     client_load_title_images(c);
 
-    Jagfile *config = load_archive(c, "config", c->archive_checksum[2], "config", 15);
-    Jagfile *inter = load_archive(c, "interface", c->archive_checksum[3], "interface", 20);
-    Jagfile *media = load_archive(c, "media", c->archive_checksum[4], "2d graphics", 30);
-    Jagfile *models = load_archive(c, "models", c->archive_checksum[5], "3d graphics", 40);
-    Jagfile *textures = load_archive(c, "textures", c->archive_checksum[6], "textures", 60);
-    Jagfile *wordenc = load_archive(c, "wordenc", c->archive_checksum[7], "chat system", 65);
-    Jagfile *sounds = load_archive(c, "sounds", c->archive_checksum[8], "sound effects", 70);
-
-    if (!config || !inter || !media || !models || !textures || !wordenc || !sounds) {
-        c->error_loading = true;
-        return;
-    }
-
     c->levelTileFlags = calloc(4, sizeof(*c->levelTileFlags));
     c->levelHeightmap = calloc(4, sizeof(*c->levelHeightmap));
     c->scene = world3d_new(c->levelHeightmap, 104, 4, 104);
@@ -231,7 +226,38 @@ void client_load(Client *c) {
         c->levelCollisionMap[level] = collisionmap_new(104, 104);
     }
     c->image_minimap = pix24_new(512, 512, false);
-    client_draw_progress(c, "Unpacking media", 75);
+
+    // custom: the other archives load behind the title screen, see LOAD_STEPS
+    c->load_background = true;
+
+// NOTE: arenas cannot grow, past capacity they fall back to the heap until reset, left value shifted to MiB/KiB (arbitrary value)
+#if defined(_arch_dreamcast) || defined(__NDS__)
+    malloc_stats();
+    if (!bump_allocator_init(8 << 20) || !arena_init(ARENA_FRAME, 32 << 10)) {
+#else
+    if (!(_Client.lowmem ? bump_allocator_init(16 << 20) : bump_allocator_init(32 << 20)) || !arena_init(ARENA_FRAME, 256 << 10)) {
+#endif
+        c->error_loading = true;
+    }
+
+    // network init happens here after game loads instead of in platform_init because being connected disables fast-forward in emulators
+    if (!clientstream_init()) {
+        c->error_loading = true;
+    }
+
+// TODO temp: wait for wiiu and switch touch input fixes, melonds 32mb emulation
+#if defined(__WIIU__) || defined(__SWITCH__) || defined(__NDS__)
+    client_login(c, c->username, c->password, false);
+#endif
+
+#if defined(_arch_dreamcast) || defined(__NDS__)
+    // it's fine for the consoles memory to be full here, it frees the login screen after this
+    malloc_stats();
+#endif
+}
+
+static void client_load_media(Client *c) {
+    Jagfile *media = c->load_archives[4];
     c->image_invback = pix8_from_archive(media, "invback", 0);
     c->image_chatback = pix8_from_archive(media, "chatback", 0);
     c->image_mapback = pix8_from_archive(media, "mapback", 0);
@@ -348,17 +374,33 @@ void client_load(Client *c) {
         }
     }
 
-    client_draw_progress(c, "Unpacking textures", 80);
-    pix3d_unpack_textures(textures);
+    pix24_free(backleft1);
+    pix24_free(backleft2);
+    pix24_free(backright1);
+    pix24_free(backright2);
+    pix24_free(backtop1);
+    pix24_free(backtop2);
+    pix24_free(backvmid1);
+    pix24_free(backvmid2);
+    pix24_free(backvmid3);
+    pix24_free(backhmid2);
+}
+
+static void client_load_textures(Client *c) {
+    pix3d_unpack_textures(c->load_archives[6]);
     pix3d_set_brightness(0.8);
     pix3d_init_pool(PIX3D_POOL_COUNT);
+}
 
-    client_draw_progress(c, "Unpacking models", 83);
+static void client_load_models(Client *c) {
+    Jagfile *models = c->load_archives[5];
     model_unpack(models);
     animbase_unpack(models);
     animframe_unpack(models);
+}
 
-    client_draw_progress(c, "Unpacking config", 86);
+static void client_load_config(Client *c) {
+    Jagfile *config = c->load_archives[2];
     seqtype_unpack(config);
     loctype_unpack(config);
     flotype_unpack(config);
@@ -367,20 +409,15 @@ void client_load(Client *c) {
     idktype_unpack(config);
     spotanimtype_unpack(config);
     varptype_unpack(config);
-
     _ObjType.membersWorld = _Client.members;
-    if (!_Client.lowmem) {
-        client_draw_progress(c, "Unpacking sounds", 90);
-        Packet *sound_dat = jagfile_to_packet(sounds, "sounds.dat");
-        wave_unpack(sound_dat);
-        packet_free(sound_dat);
-    }
+}
 
-    client_draw_progress(c, "Unpacking interfaces", 92);
+static void client_load_interfaces(Client *c) {
     PixFont *fonts[] = {c->font_plain11, c->font_plain12, c->font_bold12, c->font_quill8};
-    component_unpack(inter, media, fonts);
+    component_unpack(c->load_archives[3], c->load_archives[4], fonts);
+}
 
-    client_draw_progress(c, "Preparing game engine", 97);
+static void client_load_engine(Client *c) {
     for (int y = 0; y < 33; y++) {
         int left = 999;
         int right = 0;
@@ -432,55 +469,93 @@ void client_load(Client *c) {
 
     world3d_init(512, 334, 500, 800, distance);
     free(distance);
-    wordfilter_unpack(wordenc);
+    wordfilter_unpack(c->load_archives[7]);
+}
+
+static void client_load_sounds(Client *c) {
+    Packet *sound_dat = jagfile_to_packet(c->load_archives[8], "sounds.dat");
+    wave_unpack(sound_dat);
+    packet_free(sound_dat);
+}
+
+// custom: client_load() used to fetch and unpack every archive before anything was shown.
+// It now loads title only and the rest follows in these steps, one per frame behind the
+// title screen (client_load_continue). A step comes after every archive and step it reads.
+// Logging in waits for the first LOAD_LOGIN_STEPS (client_load_wait); sounds load on in
+// game, wave_generate() has nothing to play until then
+typedef struct {
+    const char *message; // display name of a fetch, or progress message
+    int progress;
+    int archive; // archive_checksum index fetched by this step, or -1
+    const char *name;
+    void (*unpack)(Client *c);
+    int release[2]; // archives no later step reads, or -1
+    bool highmem;
+} ClientLoadStep;
+
+static const ClientLoadStep LOAD_STEPS[] = {
+    {"config", 15, 2, "config", NULL, {-1, -1}, false},
+    {"Unpacking config", 20, -1, NULL, client_load_config, {2, -1}, false},
+    {"textures", 30, 6, "textures", NULL, {-1, -1}, false},
+    {"Unpacking textures", 35, -1, NULL, client_load_textures, {6, -1}, false},
+    {"3d graphics", 45, 5, "models", NULL, {-1, -1}, false},
+    {"Unpacking models", 50, -1, NULL, client_load_models, {5, -1}, false},
+    {"2d graphics", 60, 4, "media", NULL, {-1, -1}, false},
+    {"Unpacking media", 65, -1, NULL, client_load_media, {-1, -1}, false},
+    {"interface", 70, 3, "interface", NULL, {-1, -1}, false},
+    {"Unpacking interfaces", 75, -1, NULL, client_load_interfaces, {3, 4}, false},
+    {"chat system", 85, 7, "wordenc", NULL, {-1, -1}, false},
+    {"Preparing game engine", 95, -1, NULL, client_load_engine, {7, -1}, false},
+    {"sound effects", 98, 8, "sounds", NULL, {-1, -1}, true},
+    {"Unpacking sounds", 100, -1, NULL, client_load_sounds, {8, -1}, true},
+};
 
-    pix24_free(backleft1);
-    pix24_free(backleft2);
-    pix24_free(backright1);
-    pix24_free(backright2);
-    pix24_free(backtop1);
-    pix24_free(backtop2);
-    pix24_free(backvmid1);
-    pix24_free(backvmid2);
-    pix24_free(backvmid3);
-    pix24_free(backhmid2);
+#define LOAD_STEP_COUNT (int)(sizeof(LOAD_STEPS) / sizeof(LOAD_STEPS[0]))
+#define LOAD_LOGIN_STEPS 12
 
-    jagfile_free(config);
-    jagfile_free(inter);
-    jagfile_free(media);
-    jagfile_free(models);
-    jagfile_free(textures);
-    jagfile_free(wordenc);
-    jagfile_free(sounds);
-    // } catch (Exception ex) {
-    // 	ex.printStackTrace();
-    // 	this.errorLoading = true;
-    // }
+static void client_load_step(Client *c) {
+    const ClientLoadStep *step = &LOAD_STEPS[c->load_step++];
+    if (c->load_step == LOAD_STEP_COUNT) {
+        c->load_background = false;
+    }
+    if (step->highmem && _Client.lowmem) {
+        return;
+    }
 
-// NOTE: cannot grow allocator, must fit max usage, left value shifted to MiB (arbitrary value)
-#if defined(_arch_dreamcast) || defined(__NDS__)
-    malloc_stats();
-    if (!bump_allocator_init(8 << 20)) {
-#else
-    if (!(_Client.lowmem ? bump_allocator_init(16 << 20) : bump_allocator_init(32 << 20))) {
-#endif
-        c->error_loading = true;
+    if (step->archive != -1) {
+        Jagfile *jagfile = load_archive(c, step->name, c->archive_checksum[step->archive], step->message, step->progress);
+        if (!jagfile) {
+            c->error_loading = true;
+            return;
+        }
+        c->load_archives[step->archive] = jagfile;
+        return;
     }
 
-    // network init happens here after game loads instead of in platform_init because being connected disables fast-forward in emulators
-    if (!clientstream_init()) {
-        c->error_loading = true;
+    client_draw_progress(c, step->message, step->progress);
+    step->unpack(c);
+    for (int i = 0; i < 2; i++) {
+        if (step->release[i] != -1) {
+            jagfile_free(c->load_archives[step->release[i]]);
+            c->load_archives[step->release[i]] = NULL;
+        }
     }
+}
 
-// TODO temp: wait for wiiu and switch touch input fixes, melonds 32mb emulation
-#if defined(__WIIU__) || defined(__SWITCH__) || defined(__NDS__)
-    client_login(c, c->username, c->password, false);
-#endif
+void client_load_continue(Client *c) {
+    if (c->load_background && !c->error_loading) {
+        client_load_step(c);
+    }
+}
 
-#if defined(_arch_dreamcast) || defined(__NDS__)
-    // it's fine for the consoles memory to be full here, it frees the login screen after this
-    malloc_stats();
-#endif
+// custom: finish what the game screen needs now, progress shown in the login box
+static bool client_load_wait(Client *c) {
+    c->load_login = true;
+    while (!c->error_loading && c->load_step < LOAD_LOGIN_STEPS) {
+        client_load_step(c);
+    }
+    c->load_login = false;
+    return !c->error_loading;
 }
 
 void client_load_title_background(Client *c) {
@@ -2523,6 +2598,54 @@ static void client_update_orbit_camera(Client *c) {
     }
 }
 
+// custom: neighbour offsets and the direction stored for each, in the order client_try_move queues them
+static const int BFS_DIRECTIONS[8][3] = {
+    {-1, 0, 2}, {1, 0, 8}, {0, -1, 1}, {0, 1, 4}, {-1, -1, 3}, {1, -1, 9}, {-1, 1, 6}, {1, 1, 12}};
+
+// custom: bit i set if the step BFS_DIRECTIONS[i] out of (x, z) is open; each cardinal neighbour's flags are read
+// once and the diagonals reuse those results
+static int client_walk_directions(int **flags, int x, int z) {
+    bool west = x > 0 && (flags[x - 1][z] & 0x280108) == 0;
+    bool east = x < 103 && (flags[x + 1][z] & 0x280180) == 0;
+    bool south = z > 0 && (flags[x][z - 1] & 0x280102) == 0;
+    bool north = z < 103 && (flags[x][z + 1] & 0x280120) == 0;
+
+    int open = west | east << 1 | south << 2 | north << 3;
+    if (west && south && (flags[x - 1][z - 1] & 0x28010E) == 0) {
+        open |= 1 << 4;
+    }
+    if (east && south && (flags[x + 1][z - 1] & 0x280183) == 0) {
+        open |= 1 << 5;
+    }
+    if (west && north && (flags[x - 1][z + 1] & 0x280138) == 0) {
+        open |= 1 << 6;
+    }
+    if (east && north && (flags[x + 1][z + 1] & 0x2801E0) == 0) {
+        open |= 1 << 7;
+    }
+    return open;
+}
+
+static bool client_try_move_reached(Client *c, int x, int z, int dx, int dz, int locWidth, int locLength, int locRotation, int locShape, int forceapproach) {
+    if (x == dx && z == dz) {
+        return true;
+    }
+
+    if (locShape != 0) {
+        int shape = locShape - 1;
+
+        if ((shape <= WALL_SQUARECORNER || shape == WALL_DIAGONAL) && collisionmap_test_wall(c->levelCollisionMap[c->currentLevel], x, z, dx, dz, shape, locRotation)) {
+            return true;
+        }
+
+        if (shape <= WALLDECOR_DIAGONAL_BOTH && collisionmap_test_wdecor(c->levelCollisionMap[c->currentLevel], x, z, dx, dz, shape, locRotation)) {
+            return true;
+        }
+    }
+
+    return locWidth != 0 && locLength != 0 && collisionmap_test_loc(c->levelCollisionMap[c->currentLevel], x, z, dx, dz, locWidth, locLength, forceapproach);
+}
+
 static bool client_try_move(Client *c, int srcX, int srcZ, int dx, int dz, int type, int locWidth, int locLength, int locRotation, int locShape, int forceapproach, bool tryNearest) {
     printf("DEBUG client_try_move: srcX=%d srcZ=%d dx=%d dz=%d sceneBaseTileX=%d sceneBaseTileZ=%d\n", 
            srcX, srcZ, dx, dz, c->sceneBaseTileX, c->sceneBaseTileZ);
@@ -2540,16 +2663,17 @@ static bool client_try_move(Client *c, int srcX, int srcZ, int dx, int dz, int t
         return false;
     }
     
-    for (int x = 0; x < sceneWidth; x++) {
-        for (int z = 0; z < sceneLength; z++) {
-            c->bfsDirection[x][z] = 0;
-            c->bfsCost[x][z] = 99999999;
-        }
+    // custom: tiles count as visited only if stamped with this search's epoch, so nothing is reset per click
+    if (++c->bfsEpoch <= 0) {
+        memset(c->bfsVisited, 0, sizeof(c->bfsVisited));
+        c->bfsEpoch = 1;
     }
+    int epoch = c->bfsEpoch;
 
     int x = srcX;
     int z = srcZ;
 
+    c->bfsVisited[srcX][srcZ] = epoch;
     c->bfsDirection[srcX][srcZ] = 99;
     c->bfsCost[srcX][srcZ] = 0;
 
@@ -2559,102 +2683,45 @@ static bool client_try_move(Client *c, int srcX, int srcZ, int dx, int dz, int t
     c->bfsStepX[steps] = srcX;
     c->bfsStepZ[steps++] = srcZ;
 
-    bool arrived = false;
     int bufferSize = BFS_STEP_SIZE;
     int **flags = c->levelCollisionMap[c->currentLevel]->flags;
 
-    while (length != steps) {
+    // custom: the goal is tested when a tile is queued rather than when it is taken out; the queue is FIFO so the
+    // same tile wins, but a target next to the player ends the search without expanding the rest of that ring
+    bool arrived = client_try_move_reached(c, x, z, dx, dz, locWidth, locLength, locRotation, locShape, forceapproach);
+
+    while (!arrived && length != steps) {
         x = c->bfsStepX[length];
         z = c->bfsStepZ[length];
         length = (length + 1) % bufferSize;
 
-        if (x == dx && z == dz) {
-            arrived = true;
-            break;
-        }
-
-        if (locShape != 0) {
-            int shape = locShape - 1;
+        int open = client_walk_directions(flags, x, z);
+        int nextCost = c->bfsCost[x][z] + 1;
 
-            if ((shape <= WALL_SQUARECORNER || shape == WALL_DIAGONAL) && collisionmap_test_wall(c->levelCollisionMap[c->currentLevel], x, z, dx, dz, shape, locRotation)) {
-                arrived = true;
-                break;
+        for (int i = 0; i < 8; i++) {
+            if ((open & (1 << i)) == 0) {
+                continue;
             }
 
-            if (shape <= WALLDECOR_DIAGONAL_BOTH && collisionmap_test_wdecor(c->levelCollisionMap[c->currentLevel], x, z, dx, dz, shape, locRotation)) {
-                arrived = true;
-                break;
+            int nextX = x + BFS_DIRECTIONS[i][0];
+            int nextZ = z + BFS_DIRECTIONS[i][1];
+            if (c->bfsVisited[nextX][nextZ] == epoch) {
+                continue;
             }
-        }
-
-        if (locWidth != 0 && locLength != 0 && collisionmap_test_loc(c->levelCollisionMap[c->currentLevel], x, z, dx, dz, locWidth, locLength, forceapproach)) {
-            arrived = true;
-            break;
-        }
-
-        int nextCost = c->bfsCost[x][z] + 1;
-        if (x > 0 && c->bfsDirection[x - 1][z] == 0 && (flags[x - 1][z] & 0x280108) == 0) {
-            c->bfsStepX[steps] = x - 1;
-            c->bfsStepZ[steps] = z;
-            steps = (steps + 1) % bufferSize;
-            c->bfsDirection[x - 1][z] = 2;
-            c->bfsCost[x - 1][z] = nextCost;
-        }
-
-        if (x < sceneWidth - 1 && c->bfsDirection[x + 1][z] == 0 && (flags[x + 1][z] & 0x280180) == 0) {
-            c->bfsStepX[steps] = x + 1;
-            c->bfsStepZ[steps] = z;
-            steps = (steps + 1) % bufferSize;
-            c->bfsDirection[x + 1][z] = 8;
-            c->bfsCost[x + 1][z] = nextCost;
-        }
-
-        if (z > 0 && c->bfsDirection[x][z - 1] == 0 && (flags[x][z - 1] & 0x280102) == 0) {
-            c->bfsStepX[steps] = x;
-            c->bfsStepZ[steps] = z - 1;
-            steps = (steps + 1) % bufferSize;
-            c->bfsDirection[x][z - 1] = 1;
-            c->bfsCost[x][z - 1] = nextCost;
-        }
 
-        if (z < sceneLength - 1 && c->bfsDirection[x][z + 1] == 0 && (flags[x][z + 1] & 0x280120) == 0) {
-            c->bfsStepX[steps] = x;
-            c->bfsStepZ[steps] = z + 1;
+            c->bfsStepX[steps] = nextX;
+            c->bfsStepZ[steps] = nextZ;
             steps = (steps + 1) % bufferSize;
-            c->bfsDirection[x][z + 1] = 4;
-            c->bfsCost[x][z + 1] = nextCost;
-        }
+            c->bfsVisited[nextX][nextZ] = epoch;
+            c->bfsDirection[nextX][nextZ] = BFS_DIRECTIONS[i][2];
+            c->bfsCost[nextX][nextZ] = nextCost;
 
-        if (x > 0 && z > 0 && c->bfsDirection[x - 1][z - 1] == 0 && (flags[x - 1][z - 1] & 0x28010E) == 0 && (flags[x - 1][z] & 0x280108) == 0 && (flags[x][z - 1] & 0x280102) == 0) {
-            c->bfsStepX[steps] = x - 1;
-            c->bfsStepZ[steps] = z - 1;
-            steps = (steps + 1) % bufferSize;
-            c->bfsDirection[x - 1][z - 1] = 3;
-            c->bfsCost[x - 1][z - 1] = nextCost;
-        }
-
-        if (x < sceneWidth - 1 && z > 0 && c->bfsDirection[x + 1][z - 1] == 0 && (flags[x + 1][z - 1] & 0x280183) == 0 && (flags[x + 1][z] & 0x280180) == 0 && (flags[x][z - 1] & 0x280102) == 0) {
-            c->bfsStepX[steps] = x + 1;
-            c->bfsStepZ[steps] = z - 1;
-            steps = (steps + 1) % bufferSize;
-            c->bfsDirection[x + 1][z - 1] = 9;
-            c->bfsCost[x + 1][z - 1] = nextCost;
-        }
-
-        if (x > 0 && z < sceneLength - 1 && c->bfsDirection[x - 1][z + 1] == 0 && (flags[x - 1][z + 1] & 0x280138) == 0 && (flags[x - 1][z] & 0x280108) == 0 && (flags[x][z + 1] & 0x280120) == 0) {
-            c->bfsStepX[steps] = x - 1;
-            c->bfsStepZ[steps] = z + 1;
-            steps = (steps + 1) % bufferSize;
-            c->bfsDirection[x - 1][z + 1] = 6;
-            c->bfsCost[x - 1][z + 1] = nextCost;
-        }
-
-        if (x < sceneWidth - 1 && z < sceneLength - 1 && c->bfsDirection[x + 1][z + 1] == 0 && (flags[x + 1][z + 1] & 0x2801E0) == 0 && (flags[x + 1][z] & 0x280180) == 0 && (flags[x][z + 1] & 0x280120) == 0) {
-            c->bfsStepX[steps] = x + 1;
-            c->bfsStepZ[steps] = z + 1;
-            steps = (steps + 1) % bufferSize;
-            c->bfsDirection[x + 1][z + 1] = 12;
-            c->bfsCost[x + 1][z + 1] = nextCost;
+            if (client_try_move_reached(c, nextX, nextZ, dx, dz, locWidth, locLength, locRotation, locShape, forceapproach)) {
+                x = nextX;
+                z = nextZ;
+                arrived = true;
+                break;
+            }
         }
     }
 
@@ -2666,7 +2733,7 @@ static bool client_try_move(Client *c, int srcX, int srcZ, int dx, int dz, int t
             for (int padding = 1; padding < 2; padding++) {
                 for (int px = dx - padding; px <= dx + padding; px++) {
                     for (int pz = dz - padding; pz <= dz + padding; pz++) {
-                        if (px >= 0 && pz >= 0 && px < 104 && pz < 104 && c->bfsCost[px][pz] < min) {
+                        if (px >= 0 && pz >= 0 && px < 104 && pz < 104 && c->bfsVisited[px][pz] == epoch && c->bfsCost[px][pz] < min) {
                             min = c->bfsCost[px][pz];
                             x = px;
                             z = pz;
@@ -4341,6 +4408,9 @@ void client_update_game(Client *c) {
         c->idle_timeout--;
     }
 
+    if (c->stream) {
+        clientstream_poll(c->stream);
+    }
     for (int i = 0; i < 5 && client_read(c); i++) {
     }
 
@@ -4353,7 +4423,7 @@ void client_update_game(Client *c) {
                 // if (c->wave_ids[wave] != c->last_wave_id || c->wave_loops[wave] != c->last_wave_loops) {
                 Packet *buf = wave_generate(c->wave_ids[wave], c->wave_loops[wave]);
 
-                if (rs2_now() + (uint64_t)(buf->pos / 22) > c->last_wave_start_time + (uint64_t)(c->last_wave_length / 22)) {
+                if (buf && rs2_now() + (uint64_t)(buf->pos / 22) > c->last_wave_start_time + (uint64_t)(c->last_wave_length / 22)) {
                     c->last_wave_length = buf->pos;
                     c->last_wave_start_time = rs2_now();
                     // if (c->saveWave(buf->data, buf->pos)) {
@@ -4402,7 +4472,6 @@ void client_update_game(Client *c) {
             p1isaac(c->out, 81);
             p2(c->out, tracking->pos);
             pdata(c->out, tracking->data, tracking->pos, 0);
-            packet_release(tracking);
         }
 
         c->idle_net_cycles++;
@@ -4702,10 +4771,7 @@ bool client_read(Client *c) {
         if (c->varps[varp] != value) {
             c->varps[varp] = value;
             updateVarp(c, varp);
-            c->redraw_sidebar = true;
-            if (c->sticky_chat_interface_id != -1) {
-                c->redraw_chatback = true;
-            }
+            client_redraw_varp_readers(c, varp);
         }
         c->packet_type = -1;
         return true;
@@ -4791,6 +4857,7 @@ bool client_read(Client *c) {
             fclose(file);
 #endif
             // signlink.cachesave("m" + x + "_" + z, this.sceneMapLandData[index]);
+            scene_decode_submit(index, SCENE_DECODE_LAND, c->sceneMapLandData[index], c->sceneMapLandDataIndexLength[index]);
             c->scene_state = 1;
         }
         c->packet_type = -1;
@@ -4822,6 +4889,7 @@ bool client_read(Client *c) {
         // signlink.looprate(5);
         int regions = (c->packet_size - 2) / 10;
 
+        scene_decode_reset(regions);
         client_scenemap_free(c);
         c->sceneMapLandData = calloc(regions, sizeof(int8_t *));
         c->sceneMapLocData = calloc(regions, sizeof(int8_t *));
@@ -4903,6 +4971,7 @@ bool client_read(Client *c) {
                 } else {
                     c->sceneMapLandDataIndexLength[i] = (int)size;
                     c->sceneMapLandData[i] = data;
+                    scene_decode_submit(i, SCENE_DECODE_LAND, data, (int)size);
                 }
             }
             if (locCrc != 0) {
@@ -4967,6 +5036,7 @@ bool client_read(Client *c) {
                 } else {
                     c->sceneMapLocDataIndexLength[i] = (int)size;
                     c->sceneMapLocData[i] = data;
+                    scene_decode_submit(i, SCENE_DECODE_LOCS, data, (int)size);
                 }
             }
         }
@@ -5041,6 +5111,7 @@ bool client_read(Client *c) {
                 free(loc);
             }
         }
+        client_spawned_reindex(c);
         if (c->flagSceneTileX != 0) {
             c->flagSceneTileX -= dx;
             c->flagSceneTileZ -= dz;
@@ -5096,14 +5167,13 @@ bool client_read(Client *c) {
     }
     if (c->packet_type == 54) {
         // MIDI_SONG
-        char *name = gjstr(c->in);
+        char *name = gjstr_view(c->in);
         int crc = g4(c->in);
         int length = g4(c->in);
         if (strcmp(name, c->currentMidi) != 0 && c->midiActive && !_Client.lowmem) {
             platform_set_midi(name, crc, length);
         }
-        strcpy(c->currentMidi, name);
-        free(name);
+        snprintf(c->currentMidi, sizeof(c->currentMidi), "%s", name);
         c->midiCrc = crc;
         c->midiSize = length;
         c->nextMusicDelay = 0;
@@ -5136,6 +5206,7 @@ bool client_read(Client *c) {
             fclose(file);
 #endif
             // signlink.cachesave("l" + x + "_" + z, c->sceneMapLocData[index]);
+            scene_decode_submit(index, SCENE_DECODE_LOCS, c->sceneMapLocData[index], c->sceneMapLocDataIndexLength[index]);
             c->scene_state = 1;
         }
         c->packet_type = -1;
@@ -5187,10 +5258,7 @@ bool client_read(Client *c) {
         if (c->varps[varp] != value) {
             c->varps[varp] = value;
             updateVarp(c, varp);
-            c->redraw_sidebar = true;
-            if (c->sticky_chat_interface_id != -1) {
-                c->redraw_chatback = true;
-            }
+            client_redraw_varp_readers(c, varp);
         }
         c->packet_type = -1;
         return true;
@@ -5246,16 +5314,16 @@ bool client_read(Client *c) {
             p1isaac(c->out, 81);
             p2(c->out, tracking->pos);
             pdata(c->out, tracking->data, tracking->pos, 0);
-            packet_release(tracking);
         }
         c->packet_type = -1;
         return true;
     }
     if (c->packet_type == 98) {
         // UPDATE_INV_FULL
-        c->redraw_sidebar = true;
         int com = g2(c->in);
         Component *inv = _Component.instances[com];
+        client_redraw_root(c, inv->layer);
+        client_redraw_readers(c, COMPONENT_READS_INVS);
         int size = g1(c->in);
         for (int i = 0; i < size; i++) {
             inv->invSlotObjId[i] = g2(c->in);
@@ -5371,6 +5439,7 @@ bool client_read(Client *c) {
             c->wave_loops[c->wave_count] = loop;
             c->wave_delay[c->wave_count] = delay + _Wave.delays[id];
             c->wave_count++;
+            wave_prefetch(id, loop);
         }
         c->packet_type = -1;
         return true;
@@ -5490,11 +5559,20 @@ bool client_read(Client *c) {
                 sortObjStacks(c, x, z);
             }
         }
-        for (LocAddEntity *loc = (LocAddEntity *)linklist_head(c->spawned_locations); loc; loc = (LocAddEntity *)linklist_next(c->spawned_locations)) {
-            if (loc->x >= c->baseX && loc->x < c->baseX + 8 && loc->z >= c->baseZ && loc->z < c->baseZ + 8 && loc->plane == c->currentLevel) {
-                addLoc(c, loc->plane, loc->x, loc->z, loc->lastLocIndex, loc->lastAngle, loc->lastShape, loc->layer);
-                linkable_unlink(&loc->link);
-                free(loc);
+        for (int zoneX = c->baseX >> 3; zoneX <= (c->baseX + 7) >> 3 && zoneX < 13; zoneX++) {
+            for (int zoneZ = c->baseZ >> 3; zoneZ <= (c->baseZ + 7) >> 3 && zoneZ < 13; zoneZ++) {
+                LocAddEntity **next = &c->spawned_zones[c->currentLevel][zoneX][zoneZ];
+                while (*next) {
+                    LocAddEntity *loc = *next;
+                    if (loc->x >= c->baseX && loc->x < c->baseX + 8 && loc->z >= c->baseZ && loc->z < c->baseZ + 8) {
+                        addLoc(c, loc->plane, loc->x, loc->z, loc->lastLocIndex, loc->lastAngle, loc->lastShape, loc->layer);
+                        *next = loc->zone_next;
+                        linkable_unlink(&loc->link);
+                        free(loc);
+                    } else {
+                        next = &loc->zone_next;
+                    }
+                }
             }
         }
         c->packet_type = -1;
@@ -5566,7 +5644,7 @@ bool client_read(Client *c) {
             if (c->varps[i] != c->varCache[i]) {
                 c->varps[i] = c->varCache[i];
                 updateVarp(c, i);
-                c->redraw_sidebar = true;
+                client_redraw_varp_readers(c, i);
             }
         }
         c->packet_type = -1;
@@ -5590,9 +5668,7 @@ bool client_read(Client *c) {
     }
     if (c->packet_type == 68) {
         // UPDATE_RUNENERGY
-        if (c->selected_tab == 12) {
-            c->redraw_sidebar = true;
-        }
+        client_redraw_readers(c, COMPONENT_READS_ENERGY);
         c->energy = g1(c->in);
         c->packet_type = -1;
         return true;
@@ -5635,7 +5711,7 @@ bool client_read(Client *c) {
     }
     if (c->packet_type == 4) {
         // MESSAGE_GAME
-        char *message = gjstr(c->in);
+        char *message = gjstr_view(c->in);
         int64_t username;
         if (strendswith(message, ":tradereq:")) {
             char *player = substring(message, 0, indexof(message, ":"));
@@ -5650,6 +5726,7 @@ bool client_read(Client *c) {
             if (!ignored && c->overrideChat == 0) {
                 client_add_message(c, 4, "wishes to trade with you.", player);
             }
+            free(player);
         } else if (strendswith(message, ":duelreq:")) {
             char *player = substring(message, 0, indexof(message, ":"));
             username = jstring_to_base37(player);
@@ -5663,10 +5740,10 @@ bool client_read(Client *c) {
             if (!ignored && c->overrideChat == 0) {
                 client_add_message(c, 8, "wishes to duel with you.", player);
             }
+            free(player);
         } else {
             client_add_message(c, 0, message, "");
         }
-        free(message);
         c->packet_type = -1;
         return true;
     }
@@ -5780,9 +5857,7 @@ bool client_read(Client *c) {
     if (c->packet_type == 201) {
         // IF_SETTEXT
         int com = g2(c->in);
-        char *text = gjstr(c->in);
-        strcpy(_Component.instances[com]->text, text);
-        free(text);
+        gjstr_into(c->in, _Component.instances[com]->text, sizeof(_Component.instances[com]->text));
         if (_Component.instances[com]->layer == c->tab_interface_id[c->selected_tab]) {
             c->redraw_sidebar = true;
         }
@@ -5791,7 +5866,7 @@ bool client_read(Client *c) {
     }
     if (c->packet_type == 44) {
         // UPDATE_STAT
-        c->redraw_sidebar = true;
+        client_redraw_readers(c, COMPONENT_READS_STATS);
         int stat = g1(c->in);
         int xp = g4(c->in);
         int level = g1(c->in);
@@ -5819,9 +5894,7 @@ bool client_read(Client *c) {
     }
     if (c->packet_type == 22) {
         // UPDATE_RUNWEIGHT
-        if (c->selected_tab == 12) {
-            c->redraw_sidebar = true;
-        }
+        client_redraw_readers(c, COMPONENT_READS_WEIGHT);
         c->weightCarried = g2b(c->in);
         c->packet_type = -1;
         return true;
@@ -5842,9 +5915,10 @@ bool client_read(Client *c) {
     }
     if (c->packet_type == 213) {
         // UPDATE_INV_PARTIAL
-        c->redraw_sidebar = true;
         int com = g2(c->in);
         Component *inv = _Component.instances[com];
+        client_redraw_root(c, inv->layer);
+        client_redraw_readers(c, COMPONENT_READS_INVS);
         while (c->in->pos < c->packet_size) {
             int slot = g1(c->in);
             int id = g2(c->in);
@@ -6098,15 +6172,18 @@ void getPlayerExtended2(Client *c, PlayerEntity *player, int index, int mask, Pa
     player->pathing_entity.lastMaskCycle = _Client.loop_cycle;
 
     if ((mask & 0x1) == 1) {
+        // custom: kept past this packet for players coming back into view, so copied, but into
+        // the buffer this player already has when it is big enough
         int length = g1(buf);
-        int8_t *data = calloc(length, sizeof(int8_t));
-        Packet *appearance = packet_new(data, length);
-        gdata(buf, length, 0, data);
-
-        if (c->player_appearance_buffer[index]) {
-            packet_free(c->player_appearance_buffer[index]);
+        Packet *appearance = c->player_appearance_buffer[index];
+        if (!appearance || appearance->length < length) {
+            if (appearance) {
+                packet_free(appearance);
+            }
+            appearance = c->player_appearance_buffer[index] = packet_new(calloc(length, sizeof(int8_t)), length);
         }
-        c->player_appearance_buffer[index] = appearance;
+        appearance->pos = 0;
+        gdata(buf, length, 0, appearance->data);
         playerentity_read(player, appearance);
     }
     if ((mask & 0x2) == 2) {
@@ -6133,7 +6210,7 @@ void getPlayerExtended2(Client *c, PlayerEntity *player, int index, int mask, Pa
         }
     }
     if ((mask & 0x8) == 8) {
-        strcpy(player->pathing_entity.chat, gjstr(buf));
+        gjstr_into(buf, player->pathing_entity.chat, sizeof(player->pathing_entity.chat));
         player->pathing_entity.chatColor = 0;
         player->pathing_entity.chatStyle = 0;
         player->pathing_entity.chatTimer = 150;
@@ -6270,6 +6347,7 @@ static void client_clear_caches(void) {
     lrucache_clear(_ObjType.iconCache);
     lrucache_clear(_PlayerEntity.modelCache);
     lrucache_clear(_SpotAnimType.modelCache);
+    model_frame_cache_clear();
     bump_allocator_reset();
 }
 
@@ -6319,11 +6397,16 @@ static void client_build_scene(Client *c) {
         int8_t *src = c->sceneMapLandData[i];
 
         if (src) {
-            Packet *buf = packet_new(src, c->sceneMapLandDataIndexLength[i]);
-            int length = g4(buf);
-            bzip_decompress(data, src, c->sceneMapLandDataIndexLength[i] - 4, 4);
-            free(buf);
-            world_load_ground(world, (c->sceneCenterZoneX - 6) * 8, (c->sceneCenterZoneZ - 6) * 8, x, z, data, length);
+            Packet buf;
+            packet_view(&buf, src, c->sceneMapLandDataIndexLength[i]);
+            int length = g4(&buf);
+            // decoded by the scene decode thread when the file was complete
+            int8_t *decoded = (int8_t *)scene_decode_take(i, SCENE_DECODE_LAND);
+            if (!decoded) {
+                bzip_decompress(data, src, c->sceneMapLandDataIndexLength[i] - 4, 4);
+                decoded = data;
+            }
+            world_load_ground(world, (c->sceneCenterZoneX - 6) * 8, (c->sceneCenterZoneZ - 6) * 8, x, z, decoded, length);
         } else if (c->sceneCenterZoneZ < 800) {
             clearLandscape(world, z, x, 64, 64);
         }
@@ -6334,13 +6417,17 @@ static void client_build_scene(Client *c) {
     for (int i = 0; i < maps; i++) {
         int8_t *src = c->sceneMapLocData[i];
         if (src) {
-            Packet *buf = packet_new(src, c->sceneMapLocDataIndexLength[i]);
-            int length = g4(buf);
-            bzip_decompress(data, src, c->sceneMapLocDataIndexLength[i] - 4, 4);
-            free(buf);
+            Packet buf;
+            packet_view(&buf, src, c->sceneMapLocDataIndexLength[i]);
+            int length = g4(&buf);
+            int8_t *decoded = (int8_t *)scene_decode_take(i, SCENE_DECODE_LOCS);
+            if (!decoded) {
+                bzip_decompress(data, src, c->sceneMapLocDataIndexLength[i] - 4, 4);
+                decoded = data;
+            }
             int x = (c->sceneMapIndex[i] >> 8) * 64 - c->sceneBaseTileX;
             int z = (c->sceneMapIndex[i] & 0xff) * 64 - c->sceneBaseTileZ;
-            world_load_locations(world, c->scene, c->locList, c->levelCollisionMap, data, length, x, z);
+            world_load_locations(world, c->scene, c->locList, c->levelCollisionMap, decoded, length, x, z);
         }
     }
 
@@ -6381,6 +6468,12 @@ static void client_build_scene(Client *c) {
 }
 
 void drawMinimapLoc(Client *c, int tileX, int tileZ, int level, int wallRgb, int doorRgb) {
+    // walls write their own tile's pixels unclipped: skip them for a tile outside the
+    // bounds, which minimap_redraw_tiles sets to the tiles it redraws
+    int tilePx = tileX * 4 + 48;
+    int tilePy = (104 - 1 - tileZ) * 4 + 48;
+    bool inside = tilePx >= _Pix2D.left && tilePx + 4 <= _Pix2D.right && tilePy >= _Pix2D.top && tilePy + 4 <= _Pix2D.bottom;
+
     int bitset = world3d_get_wallbitset(c->scene, level, tileX, tileZ);
     if (bitset != 0) {
         int info = world3d_get_info(c->scene, level, tileX, tileZ, bitset);
@@ -6396,7 +6489,9 @@ void drawMinimapLoc(Client *c, int tileX, int tileZ, int level, int wallRgb, int
         int locId = bitset >> 14 & 0x7fff;
 
         LocType *loc = loctype_get(locId);
-        if (loc->mapscene == -1) {
+        if (loc->mapscene == -1 && !inside) {
+            // wall pixels of a tile outside the bounds
+        } else if (loc->mapscene == -1) {
             if (shape == WALL_STRAIGHT || shape == WALL_L) {
                 if (angle == 0) {
                     dst[offset] = rgb;
@@ -6481,7 +6576,7 @@ void drawMinimapLoc(Client *c, int tileX, int tileZ, int level, int wallRgb, int
                 int offsetY = (loc->length * 4 - scene->height) / 2;
                 pix8_draw(scene, tileX * 4 + 48 + offsetX, (104 - tileZ - loc->length) * 4 + offsetY + 48);
             }
-        } else if (shape == WALL_DIAGONAL) {
+        } else if (shape == WALL_DIAGONAL && inside) {
             int rgb = 0xeeeeee;
             if (bitset > 0) {
                 rgb = 0xee0000;
@@ -6519,17 +6614,41 @@ void drawMinimapLoc(Client *c, int tileX, int tileZ, int level, int wallRgb, int
     }
 }
 
-void createMinimap(Client *c, int level) {
+// Tiles a loc's minimap drawing can reach from its own: mapscene icons are at most
+// 8x8 pixels, centred on a footprint of up to 14 tiles
+#define MINIMAP_LOC_REACH 8
+
+// Tiles from a scene's edge whose minimap differs from the same tiles further in:
+// ground colours blend over 5 tiles, and icons of locs past the edge are missing
+#define MINIMAP_EDGE 8
+
+// Redraw tiles x0..x1, z0..z1 (inclusive) of the minimap exactly as createMinimap
+// draws them: their ground, then every loc that can reach them, in the same order
+// and clipped to them. Pixels outside those tiles are left alone; the edge tiles
+// 0 and 103 take the image's border past them.
+static void minimap_redraw_tiles(Client *c, int level, int x0, int z0, int x1, int z1) {
+    x0 = x0 < 0 ? 0 : x0;
+    z0 = z0 < 0 ? 0 : z0;
+    x1 = x1 > 104 - 1 ? 104 - 1 : x1;
+    z1 = z1 > 104 - 1 ? 104 - 1 : z1;
+    if (x0 > x1 || z0 > z1) {
+        return;
+    }
+
     int *pixels = c->image_minimap->pixels;
-    int length = c->image_minimap->width * c->image_minimap->height;
-    for (int i = 0; i < length; i++) {
-        pixels[i] = 0;
+    int left = x0 == 0 ? 0 : x0 * 4 + 48;
+    int right = x1 == 104 - 1 ? 512 : (x1 + 1) * 4 + 48;
+    int top = z1 == 104 - 1 ? 0 : (104 - 1 - z1) * 4 + 48;
+    int bottom = z0 == 0 ? 512 : (104 - z0) * 4 + 48;
+    for (int y = top; y < bottom; y++) {
+        memset(pixels + y * 512 + left, 0, (right - left) * sizeof(int));
     }
 
-    for (int z = 1; z < 104 - 1; z++) {
-        int offset = (104 - 1 - z) * 512 * 4 + 24628;
+    for (int z = z0 > 1 ? z0 : 1; z <= z1 && z < 104 - 1; z++) {
+        int x = x0 > 1 ? x0 : 1;
+        int offset = (104 - 1 - z) * 512 * 4 + 24628 + (x - 1) * 4;
 
-        for (int x = 1; x < 104 - 1; x++) {
+        for (; x <= x1 && x < 104 - 1; x++) {
             if ((c->levelTileFlags[level][x][z] & 0x18) == 0) {
                 world3d_draw_minimaptile(c->scene, level, x, z, pixels, offset, 512);
             }
@@ -6542,24 +6661,115 @@ void createMinimap(Client *c, int level) {
         }
     }
 
-    int wallRgb = (((int)(jrand() * 20.0) + 238 - 10) << 16) + (((int)(jrand() * 20.0) + 238 - 10) << 8) + (int)(jrand() * 20.0) + 238 - 10;
-    int doorRgb = ((int)(jrand() * 20.0) + 238 - 10) << 16;
-
     pix24_bind(c->image_minimap);
+    pix2d_set_clipping(bottom, right, top, left);
 
-    for (int z = 1; z < 104 - 1; z++) {
-        for (int x = 1; x < 104 - 1; x++) {
+    int minX = x0 - MINIMAP_LOC_REACH > 1 ? x0 - MINIMAP_LOC_REACH : 1;
+    int maxX = x1 + MINIMAP_LOC_REACH < 104 - 2 ? x1 + MINIMAP_LOC_REACH : 104 - 2;
+    int minZ = z0 - MINIMAP_LOC_REACH > 1 ? z0 - MINIMAP_LOC_REACH : 1;
+    int maxZ = z1 + MINIMAP_LOC_REACH < 104 - 2 ? z1 + MINIMAP_LOC_REACH : 104 - 2;
+    for (int z = minZ; z <= maxZ; z++) {
+        for (int x = minX; x <= maxX; x++) {
             if ((c->levelTileFlags[level][x][z] & 0x18) == 0) {
-                drawMinimapLoc(c, x, z, level, wallRgb, doorRgb);
+                drawMinimapLoc(c, x, z, level, c->minimap_wall_rgb, c->minimap_door_rgb);
             }
 
             if (level < 3 && (c->levelTileFlags[level + 1][x][z] & 0x8) != 0) {
-                drawMinimapLoc(c, x, z, level + 1, wallRgb, doorRgb);
+                drawMinimapLoc(c, x, z, level + 1, c->minimap_wall_rgb, c->minimap_door_rgb);
             }
         }
     }
 
     pixmap_bind(c->area_viewport);
+}
+
+// Move the minimap by the scene's shift of dx, dz tiles and redraw what the old scene
+// could not give: tiles near either scene's edge and tiles whose locs changed since
+static bool minimap_shift(Client *c, int level, int dx, int dz) {
+    int lo = 1 + MINIMAP_EDGE;
+    int hi = 104 - 2 - MINIMAP_EDGE;
+    // tiles kept: inside both scenes' margins
+    int keepX0 = lo > lo - dx ? lo : lo - dx;
+    int keepX1 = hi < hi - dx ? hi : hi - dx;
+    int keepZ0 = lo > lo - dz ? lo : lo - dz;
+    int keepZ1 = hi < hi - dz ? hi : hi - dz;
+    if (keepX0 > keepX1 || keepZ0 > keepZ1) {
+        return false;
+    }
+
+    // tile x, z is now drawn where tile x + dx, z + dz was
+    int *pixels = c->image_minimap->pixels;
+    int shiftX = dx * 4;
+    int shiftY = -dz * 4;
+    int left = keepX0 * 4 + 48;
+    int width = (keepX1 - keepX0 + 1) * 4;
+    int top = (104 - 1 - keepZ1) * 4 + 48;
+    int bottom = (104 - keepZ0) * 4 + 48;
+    if (shiftY > 0) {
+        for (int y = top; y < bottom; y++) {
+            memmove(pixels + y * 512 + left, pixels + (y + shiftY) * 512 + left + shiftX, width * sizeof(int));
+        }
+    } else {
+        for (int y = bottom - 1; y >= top; y--) {
+            memmove(pixels + y * 512 + left, pixels + (y + shiftY) * 512 + left + shiftX, width * sizeof(int));
+        }
+    }
+
+
+    minimap_redraw_tiles(c, level, 0, 0, 104 - 1, keepZ0 - 1);
+    minimap_redraw_tiles(c, level, 0, keepZ1 + 1, 104 - 1, 104 - 1);
+    minimap_redraw_tiles(c, level, 0, keepZ0, keepX0 - 1, keepZ1);
+    minimap_redraw_tiles(c, level, keepX1 + 1, keepZ0, 104 - 1, keepZ1);
+    if (c->minimap_dirty_x0 <= c->minimap_dirty_x1) {
+        minimap_redraw_tiles(c, level, c->minimap_dirty_x0, c->minimap_dirty_z0, c->minimap_dirty_x1, c->minimap_dirty_z1);
+    }
+    return true;
+}
+
+// A loc at x, z was added or removed: redraw the tiles its icon or walls can cover, or
+// remember them for minimap_shift if the scene was rebuilt and the minimap is not yet
+static void minimap_loc_changed(Client *c, int level, int x, int z) {
+    int x0 = x - 1;
+    int z0 = z - 1;
+    int x1 = x + MINIMAP_LOC_REACH;
+    int z1 = z + MINIMAP_LOC_REACH;
+    if (c->minimap_level == -1) {
+        if (c->minimap_dirty_x0 > c->minimap_dirty_x1) {
+            c->minimap_dirty_x0 = x0;
+            c->minimap_dirty_z0 = z0;
+            c->minimap_dirty_x1 = x1;
+            c->minimap_dirty_z1 = z1;
+        } else {
+            c->minimap_dirty_x0 = x0 < c->minimap_dirty_x0 ? x0 : c->minimap_dirty_x0;
+            c->minimap_dirty_z0 = z0 < c->minimap_dirty_z0 ? z0 : c->minimap_dirty_z0;
+            c->minimap_dirty_x1 = x1 > c->minimap_dirty_x1 ? x1 : c->minimap_dirty_x1;
+            c->minimap_dirty_z1 = z1 > c->minimap_dirty_z1 ? z1 : c->minimap_dirty_z1;
+        }
+        return;
+    }
+
+    // the level drawn, or the one above where its bridges are
+    int drawn = c->minimap_drawn_level;
+    if (drawn != -1 && drawn == c->minimap_level && (level == drawn || level == drawn + 1)) {
+        minimap_redraw_tiles(c, drawn, x0, z0, x1, z1);
+    }
+}
+
+void createMinimap(Client *c, int level) {
+    int dx = c->sceneBaseTileX - c->minimap_base_x;
+    int dz = c->sceneBaseTileZ - c->minimap_base_z;
+    bool shifted = c->minimap_drawn_level == level && minimap_shift(c, level, dx, dz);
+    c->minimap_drawn_level = level;
+    c->minimap_base_x = c->sceneBaseTileX;
+    c->minimap_base_z = c->sceneBaseTileZ;
+    c->minimap_dirty_x0 = 0;
+    c->minimap_dirty_x1 = -1;
+
+    if (!shifted) {
+        c->minimap_wall_rgb = (((int)(jrand() * 20.0) + 238 - 10) << 16) + (((int)(jrand() * 20.0) + 238 - 10) << 8) + (int)(jrand() * 20.0) + 238 - 10;
+        c->minimap_door_rgb = ((int)(jrand() * 20.0) + 238 - 10) << 16;
+        minimap_redraw_tiles(c, level, 0, 0, 104 - 1, 104 - 1);
+    }
     c->activeMapFunctionCount = 0;
 
     for (int x = 0; x < 104; x++) {
@@ -6683,6 +6893,7 @@ void addLoc(Client *c, int level, int x, int z, int id, int angle, int shape, in
             LocType *type = loctype_get(otherId);
 
             if (x + type->width > 104 - 1 || z + type->width > 104 - 1 || x + type->length > 104 - 1 || z + type->length > 104 - 1) {
+                minimap_loc_changed(c, level, x, z);
                 return;
             }
 
@@ -6710,6 +6921,7 @@ void addLoc(Client *c, int level, int x, int z, int id, int angle, int shape, in
 
         world_add_loc(level, x, z, c->scene, c->levelHeightmap, c->locList, c->levelCollisionMap[level], id, shape, angle, tileLevel);
     }
+    minimap_loc_changed(c, level, x, z);
 }
 
 void sortObjStacks(Client *c, int x, int z) {
@@ -6769,6 +6981,28 @@ void sortObjStacks(Client *c, int x, int z) {
     world3d_add_objstack(c->scene, x, z, getHeightmapY(c, c->currentLevel, x * 128 + 64, z * 128 + 64), c->currentLevel, bitset, objtype_get_interfacemodel(type, topObj->count, true), middleObj, bottomObj);
 }
 
+
+// custom: a zone packet looks at the spawned locs chained under its own zone instead of walking them all
+static LocAddEntity **client_spawned_zone(Client *c, int plane, int x, int z) {
+    return &c->spawned_zones[plane][x >> 3][z >> 3];
+}
+
+static void client_spawned_add(Client *c, LocAddEntity *loc) {
+    LocAddEntity **next = client_spawned_zone(c, loc->plane, loc->x, loc->z);
+    while (*next) {
+        next = &(*next)->zone_next;
+    }
+    loc->zone_next = NULL;
+    *next = loc;
+}
+
+static void client_spawned_reindex(Client *c) {
+    memset(c->spawned_zones, 0, sizeof(c->spawned_zones));
+    for (LocAddEntity *loc = (LocAddEntity *)linklist_head(c->spawned_locations); loc; loc = (LocAddEntity *)linklist_next(c->spawned_locations)) {
+        client_spawned_add(c, loc);
+    }
+}
+
 void readZonePacket(Client *c, Packet *buf, int opcode) {
     int pos = g1(buf);
     int x = c->baseX + (pos >> 4 & 0x7);
@@ -6787,12 +7021,9 @@ void readZonePacket(Client *c, Packet *buf, int opcode) {
             id = g2(buf);
         }
         if (x >= 0 && z >= 0 && x < 104 && z < 104) {
-            LocAddEntity *loc = NULL;
-            for (LocAddEntity *next = (LocAddEntity *)linklist_head(c->spawned_locations); next != NULL; next = (LocAddEntity *)linklist_next(c->spawned_locations)) {
-                if (next->plane == c->currentLevel && next->x == x && next->z == z && next->layer == layer) {
-                    loc = next;
-                    break;
-                }
+            LocAddEntity *loc = *client_spawned_zone(c, c->currentLevel, x, z);
+            while (loc && (loc->x != x || loc->z != z || loc->layer != layer)) {
+                loc = loc->zone_next;
             }
             if (!loc) {
                 int bitset = 0;
@@ -6826,6 +7057,7 @@ void readZonePacket(Client *c, Packet *buf, int opcode) {
                 loc->lastShape = otherShape;
                 loc->lastAngle = otherAngle;
                 linklist_add_tail(c->spawned_locations, &loc->link);
+                client_spawned_add(c, loc);
             }
             loc->locIndex = id;
             loc->shape = shape;
@@ -7092,7 +7324,7 @@ void getNpcPosExtended(Client *c, Packet *buf, int size) {
             }
         }
         if ((mask & 0x8) == 8) {
-            strcpy(npc->pathing_entity.chat, gjstr(buf));
+            gjstr_into(buf, npc->pathing_entity.chat, sizeof(npc->pathing_entity.chat));
             npc->pathing_entity.chatTimer = 100;
         }
         if ((mask & 0x10) == 16) {
@@ -7259,6 +7491,41 @@ void client_add_message(Client *c, int type, const char *text, const char *sende
     strcpy(c->message_text[0], text);
 }
 
+// custom: interfaces shown in the sidebar and chat are redrawn when something their scripts read changes
+// (component_varp_readers, component_root_reads), not on every varp, stat or inventory update
+static int client_sidebar_root(Client *c) {
+    return c->sidebar_interface_id != -1 ? c->sidebar_interface_id : c->tab_interface_id[c->selected_tab];
+}
+
+static void client_redraw_root(Client *c, int root) {
+    if (root == -1) {
+        return;
+    }
+    if (root == client_sidebar_root(c)) {
+        c->redraw_sidebar = true;
+    }
+    if (root == c->chat_interface_id || root == c->sticky_chat_interface_id) {
+        c->redraw_chatback = true;
+    }
+}
+
+static void client_redraw_varp_readers(Client *c, int varp) {
+    int count;
+    const int *roots = component_varp_readers(varp, &count);
+    for (int i = 0; i < count; i++) {
+        client_redraw_root(c, roots[i]);
+    }
+}
+
+static void client_redraw_readers(Client *c, int reads) {
+    if (component_root_reads(client_sidebar_root(c)) & reads) {
+        c->redraw_sidebar = true;
+    }
+    if ((component_root_reads(c->chat_interface_id) | component_root_reads(c->sticky_chat_interface_id)) & reads) {
+        c->redraw_chatback = true;
+    }
+}
+
 void updateVarp(Client *c, int id) {
     int clientcode = _VarpType.instances[id]->clientcode;
     if (clientcode == 0) {
@@ -7519,6 +7786,10 @@ void client_update_title(Client *c) {
 void client_login(Client *c, const char *username, const char *password, bool reconnect) {
     // signlink.errorname = username;
     // try {
+    if (c->load_step < LOAD_LOGIN_STEPS && !client_load_wait(c)) {
+        return;
+    }
+
     if (!reconnect) {
         c->login_message0 = "";
         c->login_message1 = "Connecting to server...";
@@ -7638,6 +7909,7 @@ void client_login(Client *c, const char *username, const char *password, bool re
         c->orbit_camera_yaw = (int)(jrand() * 20.0) - 10 & 0x7ff;
 
         c->minimap_level = -1;
+        c->minimap_drawn_level = -1;
         c->flag_scene_tile_x = 0;
         c->flag_scene_tile_z = 0;
 
@@ -7678,6 +7950,7 @@ void client_login(Client *c, const char *username, const char *password, bool re
         // TODO: why not linklist_clear originally?
         linklist_free(c->spawned_locations);
         c->spawned_locations = linklist_new();
+        memset(c->spawned_zones, 0, sizeof(c->spawned_zones));
         c->friend_count = 0;
         c->sticky_chat_interface_id = -1;
         c->chat_interface_id = -1;
@@ -7810,6 +8083,14 @@ void client_prepare_game_screen(Client *c) {
     c->area_backbase1 = pixmap_new(501, 61);
     c->area_backbase2 = pixmap_new(288, 40);
     c->area_backhmid1 = pixmap_new(269, 66);
+    // redrawn whole every frame or on every change but mostly the same: blit what changed
+    // (not the viewport, the scene moves every frame)
+    pixmap_track_dirty(c->area_chatback, true);
+    pixmap_track_dirty(c->area_mapback, true);
+    pixmap_track_dirty(c->area_sidebar, true);
+    pixmap_track_dirty(c->area_backbase1, true);
+    pixmap_track_dirty(c->area_backbase2, true);
+    pixmap_track_dirty(c->area_backhmid1, true);
     c->redraw_background = true;
 }
 
@@ -7879,11 +8160,15 @@ void client_draw(Client *c) {
 
         c->drag_cycles = 0;
     }
+
+    // custom: one loading step per frame, after the frame it would have held up
+    client_load_continue(c);
 }
 
 void client_draw_game(Client *c) {
     if (c->redraw_background) {
         c->redraw_background = false;
+        pixmap_invalidate_all(); // the window was cleared or resized: blit every area whole
         pixmap_draw(c->area_backleft1, 0, 11);
         pixmap_draw(c->area_backleft2, 0, 375);
         pixmap_draw(c->area_backright1, 729, 5);
@@ -7908,10 +8193,6 @@ void client_draw_game(Client *c) {
         client_draw_scene(c);
     }
 
-    if (c->menu_visible && c->menu_area == 1) {
-        c->redraw_sidebar = true;
-    }
-
     if (c->sidebar_interface_id != -1) {
         bool redraw = client_update_interface_animation(c, c->sidebar_interface_id, c->scene_delta);
         if (redraw) {
@@ -7927,7 +8208,7 @@ void client_draw_game(Client *c) {
         c->redraw_sidebar = true;
     }
 
-    if (c->redraw_sidebar) {
+    if (c->redraw_sidebar || (c->menu_visible && c->menu_area == 1)) {
         client_draw_sidebar(c);
         c->redraw_sidebar = false;
     }
@@ -7972,11 +8253,7 @@ void client_draw_game(Client *c) {
         c->redraw_chatback = true;
     }
 
-    if (c->menu_visible && c->menu_area == 2) {
-        c->redraw_chatback = true;
-    }
-
-    if (c->redraw_chatback) {
+    if (c->redraw_chatback || (c->menu_visible && c->menu_area == 2)) {
         client_draw_chatback(c);
         c->redraw_chatback = false;
     }
@@ -8338,13 +8615,29 @@ void projectFromGround2(Client *c, int x, int height, int z) {
     project(c, x, y, z);
 }
 
+// custom: the pitch half of project(), from a point already rotated by yaw
+static void project_pitch(Client *c, int dx, int dy, int dz) {
+    int sinPitch = _Pix3D.sin_table[c->cameraPitch];
+    int cosPitch = _Pix3D.cos_table[c->cameraPitch];
+
+    int tmp = (dy * cosPitch - dz * sinPitch) >> 16;
+    dz = (dy * sinPitch + dz * cosPitch) >> 16;
+    dy = tmp;
+
+    if (dz >= 50) {
+        c->projectX = _Pix3D.center_x + (dx << 9) / dz;
+        c->projectY = _Pix3D.center_y + (dy << 9) / dz;
+    } else {
+        c->projectX = -1;
+        c->projectY = -1;
+    }
+}
+
 void project(Client *c, int x, int y, int z) {
     int dx = x - c->cameraX;
     int dy = y - c->cameraY;
     int dz = z - c->cameraZ;
 
-    int sinPitch = _Pix3D.sin_table[c->cameraPitch];
-    int cosPitch = _Pix3D.cos_table[c->cameraPitch];
     int sinYaw = _Pix3D.sin_table[c->cameraYaw];
     int cosYaw = _Pix3D.cos_table[c->cameraYaw];
 
@@ -8352,17 +8645,46 @@ void project(Client *c, int x, int y, int z) {
     dz = (dz * cosYaw - dx * sinYaw) >> 16;
     dx = tmp;
 
-    tmp = (dy * cosPitch - dz * sinPitch) >> 16;
-    dz = (dy * sinPitch + dz * cosPitch) >> 16;
-    dy = tmp;
-
-    if (dz >= 50) {
-        c->projectX = _Pix3D.center_x + (dx << 9) / dz;
-        c->projectY = _Pix3D.center_y + (dy << 9) / dz;
-    } else {
+    project_pitch(c, dx, dy, dz);
+}
+
+// custom: every overlay of one entity (head icons, hint arrow, chat, health
+// bar, hitsplat) is projected from the same ground point, only at another
+// height, and the yaw rotation does not involve height. The heightmap lookup
+// and the yaw are done once per entity, on its first overlay, and each
+// overlay pays only for the pitch and the divide: the same projectX/Y as
+// projectFromGround().
+typedef struct {
+    bool ready;
+    bool on_map;
+    int dx; // yaw rotated, from the camera
+    int dy; // ground, from the camera
+    int dz;
+} GroundAnchor;
+
+static void projectFromAnchor(Client *c, GroundAnchor *anchor, PathingEntity *entity, int height) {
+    if (!anchor->ready) {
+        int x = entity->x;
+        int z = entity->z;
+        anchor->ready = true;
+        anchor->on_map = x >= 128 && z >= 128 && x <= 13056 && z <= 13056;
+        if (anchor->on_map) {
+            int dx = x - c->cameraX;
+            int dz = z - c->cameraZ;
+            int sinYaw = _Pix3D.sin_table[c->cameraYaw];
+            int cosYaw = _Pix3D.cos_table[c->cameraYaw];
+            anchor->dx = (dz * sinYaw + dx * cosYaw) >> 16;
+            anchor->dz = (dz * cosYaw - dx * sinYaw) >> 16;
+            anchor->dy = getHeightmapY(c, c->currentLevel, x, z) - c->cameraY;
+        }
+    }
+
+    if (!anchor->on_map) {
         c->projectX = -1;
         c->projectY = -1;
+        return;
     }
+    project_pitch(c, anchor->dx, anchor->dy - height, anchor->dz);
 }
 
 static void draw2DEntityElements(Client *c) {
@@ -8381,6 +8703,7 @@ static void draw2DEntityElements(Client *c) {
         if (!entity || !pathingentity_is_visible(entity)) {
             continue;
         }
+        GroundAnchor anchor = {0};
 
         // TODO
         // if (c->showDebug) {
@@ -8508,7 +8831,7 @@ static void draw2DEntityElements(Client *c) {
 
             PlayerEntity *player = (PlayerEntity *)entity;
             if (player->headicons != 0) {
-                projectFromGround(c, entity, entity->height + 15);
+                projectFromAnchor(c, &anchor, entity, entity->height + 15);
 
                 if (c->projectX > -1) {
                     for (int icon = 0; icon < 8; icon++) {
@@ -8521,20 +8844,20 @@ static void draw2DEntityElements(Client *c) {
             }
 
             if (index >= 0 && c->hint_type == 10 && c->hint_player == c->player_ids[index]) {
-                projectFromGround(c, entity, entity->height + 15);
+                projectFromAnchor(c, &anchor, entity, entity->height + 15);
                 if (c->projectX > -1) {
                     pix24_draw(c->image_headicons[7], c->projectX - 12, c->projectY - y);
                 }
             }
         } else if (c->hint_type == 1 && c->hint_npc == c->npc_ids[index - c->player_count] && _Client.loop_cycle % 20 < 10) {
-            projectFromGround(c, entity, entity->height + 15);
+            projectFromAnchor(c, &anchor, entity, entity->height + 15);
             if (c->projectX > -1) {
                 pix24_draw(c->image_headicons[2], c->projectX - 12, c->projectY - 28);
             }
         }
 
         if (entity->chat[0] && (index >= c->player_count || c->public_chat_setting == 0 || c->public_chat_setting == 3 || (c->public_chat_setting == 1 && client_is_friend(c, ((PlayerEntity *)entity)->name)))) {
-            projectFromGround(c, entity, entity->height);
+            projectFromAnchor(c, &anchor, entity, entity->height);
 
             if (c->projectX > -1 && c->chatCount < MAX_CHATS) {
                 c->chatWidth[c->chatCount] = stringWidth(c->font_bold12, entity->chat) / 2;
@@ -8559,7 +8882,7 @@ static void draw2DEntityElements(Client *c) {
         }
 
         if (entity->combatCycle > _Client.loop_cycle + 100) {
-            projectFromGround(c, entity, entity->height + 15);
+            projectFromAnchor(c, &anchor, entity, entity->height + 15);
 
             if (c->projectX > -1) {
                 int w = entity->health * 30 / entity->totalHealth;
@@ -8572,7 +8895,7 @@ static void draw2DEntityElements(Client *c) {
         }
 
         if (entity->combatCycle > _Client.loop_cycle + 330) {
-            projectFromGround(c, entity, entity->height / 2);
+            projectFromAnchor(c, &anchor, entity, entity->height / 2);
 
             if (c->projectX > -1) {
                 pix24_draw(c->image_hitmarks[entity->damageType], c->projectX - 12, c->projectY - 12);
@@ -8707,7 +9030,7 @@ static void updateTextures(Client *c, int cycle) {
 
             texture->pixels = dst;
             c->textureBuffer = src;
-            pix3d_push_texture(17);
+            pix3d_scroll_texture(17, c->scene_delta * 2);
         }
 
         if (_Pix3D.textureCycle[24] >= cycle) {
@@ -8723,7 +9046,7 @@ static void updateTextures(Client *c, int cycle) {
 
             texture->pixels = dst;
             c->textureBuffer = src;
-            pix3d_push_texture(24);
+            pix3d_scroll_texture(24, c->scene_delta * 2);
         }
     }
 }
@@ -9479,9 +9802,7 @@ void client_draw_on_minimap(Client *c, int dy, Pix24 *image, int dx) {
     }
 }
 
-void client_draw_chatback(Client *c) {
-    pixmap_bind(c->area_chatback);
-    _Pix3D.line_offset = c->area_chatback_offsets;
+static void client_draw_chatback_layer(Client *c) {
     pix8_draw(c->image_chatback, 0, 0);
     if (c->show_social_input) {
         char buf[CHAT_LENGTH + 2];
@@ -9610,7 +9931,18 @@ void client_draw_chatback(Client *c) {
     } else {
         client_draw_interface(c, _Component.instances[c->sticky_chat_interface_id], 0, 0, 0);
     }
-    if (c->menu_visible && c->menu_area == 2) {
+}
+
+void client_draw_chatback(Client *c) {
+    pixmap_bind(c->area_chatback);
+    _Pix3D.line_offset = c->area_chatback_offsets;
+    bool menu = c->menu_visible && c->menu_area == 2;
+    // custom: as in client_draw_sidebar, an open menu puts back the chat drawn under it unless redraw_chatback is set
+    if (c->redraw_chatback || !menu || !pixmap_restore_layer(c->area_chatback)) {
+        client_draw_chatback_layer(c);
+        pixmap_keep_layer(c->area_chatback, menu);
+    }
+    if (menu) {
         client_draw_menu(c);
     }
     pixmap_draw(c->area_chatback, 22, 375);
@@ -9661,13 +9993,19 @@ void client_draw_scrollbar(Client *c, int x, int y, int scrollY, int scrollHeigh
 void client_draw_sidebar(Client *c) {
     pixmap_bind(c->area_sidebar);
     _Pix3D.line_offset = c->area_sidebar_offsets;
-    pix8_draw(c->image_invback, 0, 0);
-    if (c->sidebar_interface_id != -1) {
-        client_draw_interface(c, _Component.instances[c->sidebar_interface_id], 0, 0, 0);
-    } else if (c->tab_interface_id[c->selected_tab] != -1) {
-        client_draw_interface(c, _Component.instances[c->tab_interface_id[c->selected_tab]], 0, 0, 0);
+    bool menu = c->menu_visible && c->menu_area == 1;
+    // custom: an open menu redraws the sidebar every frame, but unless redraw_sidebar says otherwise the
+    // interface under it is the one drawn last time: put that back instead of walking the component tree again
+    if (c->redraw_sidebar || !menu || !pixmap_restore_layer(c->area_sidebar)) {
+        pix8_draw(c->image_invback, 0, 0);
+        if (c->sidebar_interface_id != -1) {
+            client_draw_interface(c, _Component.instances[c->sidebar_interface_id], 0, 0, 0);
+        } else if (c->tab_interface_id[c->selected_tab] != -1) {
+            client_draw_interface(c, _Component.instances[c->tab_interface_id[c->selected_tab]], 0, 0, 0);
+        }
+        pixmap_keep_layer(c->area_sidebar, menu);
     }
-    if (c->menu_visible && c->menu_area == 1) {
+    if (menu) {
         client_draw_menu(c);
     }
     pixmap_draw(c->area_sidebar, 562, 231);
@@ -10404,6 +10742,13 @@ void client_draw_title_screen(Client *c) {
         drawStringTaggableCenter(c->font_bold12, "Cancel", x, y + 5, WHITE, true);
     }
 
+    // custom: what is still loading before a login can start
+    if (c->load_background && !c->load_login && c->load_step < LOAD_LOGIN_STEPS) {
+        char status[MAX_STR + 16];
+        snprintf(status, sizeof(status), "%s - %d%%", c->load_message, c->load_progress);
+        drawStringTaggableCenter(c->font_plain11, status, w / 2, h - 6, WHITE, true);
+    }
+
     pixmap_draw(c->image_title4, 214, 186);
     if (c->redraw_background) {
         c->redraw_background = false;
@@ -10417,12 +10762,27 @@ void client_draw_title_screen(Client *c) {
 }
 
 void client_unload(Client *c) {
+    // custom: the frees below expect everything unpacked, as before progressive loading
+    while (c->load_background && !c->error_loading) {
+        client_load_step(c);
+    }
+    for (int i = 0; i < 9; i++) {
+        if (c->load_archives[i]) {
+            jagfile_free(c->load_archives[i]);
+        }
+    }
+
     bump_allocator_free();
+    arena_free(ARENA_FRAME);
 
     model_free_global();
     animbase_free_global();
     animframe_free_global();
     component_free_global();
+    pix3d_bin_stop();
+    pix3d_gpu_stop();
+    scene_decode_stop();
+    wave_stop();
     pix3d_free_global();
     tone_free_global();
     wave_free_global();
@@ -10446,7 +10806,7 @@ void client_unload(Client *c) {
 #include "emscripten.h"
 
 EM_JS(bool, get_host_js, (char *socketip, size_t len, int *http_port), {
-    const url = new URL(window.location.href);
+    const url = new URL(location.href); // the page's, or on a worker its script's (same origin)
     stringToUTF8(url.hostname, socketip, len);
     if (url.port && url.hostname != 'localhost' && url.hostname != '127.0.0.1') {
         HEAP32[http_port >> 2] = parseInt(url.port, 10);
@@ -10577,6 +10937,25 @@ init:
 
     Client *c = client_new();
     load_ini_config(c);
+    if (_Custom.render_threads > 1) {
+        pix3d_bin_start(_Custom.render_threads);
+    }
+    if (_Custom.gpu_render) {
+#if defined(PIX3D_GPU) && defined(SDL) && SDL > 1
+        Pix3DGpuContext gpu = {platform_gl_proc, platform_gl_make_current};
+        if (!platform_gl_init() || !pix3d_gpu_start(&gpu)) {
+            rs2_error("gpu_render: no GL ES 2 context, the scene stays in software\n");
+        }
+#else
+        rs2_error("gpu_render: needs SDL2/SDL3 built with -DPIX3D_GPU, the scene stays in software\n");
+#endif
+    }
+    scene_decode_start();
+    wave_start();
+    if (_Custom.cache_budget > 0) {
+        lrucache_set_budget((int64_t)_Custom.cache_budget << 10);
+    }
+    model_frame_cache_init(_Custom.anim_cache);
     
     // Apply command-line username/password if provided
     if (cmdline_username[0] != '\0') {
@@ -10592,6 +10971,7 @@ init:
 
 void client_free(Client *c) {
     free(c->stream);
+    scene_decode_reset(0);
     client_scenemap_free(c);
     gameshell_free(c->shell);
     pixfont_free(c->font_plain11);
@@ -10782,6 +11162,8 @@ Client *client_new(void) {
     c->orbit_camera_pitch = 128;
 
     c->minimap_level = -1;
+    c->minimap_drawn_level = -1;
+    c->minimap_dirty_x1 = -1;
     c->sticky_chat_interface_id = -1;
     c->chat_interface_id = -1;
     c->viewport_interface_id = -1;
@@ -10877,6 +11259,12 @@ Jagfile *load_archive(Client *c, const char *name, int crc, const char *display_
         return jagfile_new(data, size);
     }
 
+    // custom: unpacked copy from an earlier launch (IndexedDB), see archive_cache.h
+    Jagfile *cached = archive_cache_load(name, crc);
+    if (cached) {
+        return cached;
+    }
+
     while (!data) {
         char message[PATH_MAX];
         snprintf(message, sizeof(message), "Requesting %s", display_name);
@@ -10899,7 +11287,12 @@ Jagfile *load_archive(Client *c, const char *name, int crc, const char *display_
     }
 
     // signlink.cachesave(name, data);
-    return jagfile_new(data, size);
+    bool matches = rs_crc32(data, size) == crc;
+    Jagfile *jagfile = jagfile_new(data, size);
+    if (matches) {
+        jagfile = archive_cache_store(name, crc, jagfile);
+    }
+    return jagfile;
 }
 #else
 void *client_openurl(const char *name, int *size) {
@@ -10923,6 +11316,13 @@ Jagfile *load_archive(Client *c, const char *name, int crc, const char *display_
     // TODO: add load messages?
     (void)c;
 
+    // custom: skip the read and the bzip2 work if an unpacked copy matches, see archive_cache.h
+    Jagfile *cached = archive_cache_load(name, crc);
+    if (cached) {
+        free(header);
+        return cached;
+    }
+
 #ifdef ANDROID
     SDL_RWops *file = SDL_RWFromFile(filename, "rb");
 #else
@@ -10969,7 +11369,11 @@ Jagfile *load_archive(Client *c, const char *name, int crc, const char *display_
         // data = NULL;
     }
 
-    return jagfile_new(data, file_size);
+    Jagfile *jagfile = jagfile_new(data, file_size);
+    if (crc_value == crc) {
+        jagfile = archive_cache_store(name, crc, jagfile);
+    }
+    return jagfile;
 }
 #endif
 
@@ -11036,6 +11440,19 @@ void client_load_title(Client *c) {
 }
 
 void client_draw_progress(Client *c, const char *message, int progress) {
+    if (c->load_background) {
+        // custom: loading behind the title screen, which shows this itself
+        snprintf(c->load_message, sizeof(c->load_message), "%s", message);
+        c->load_progress = progress;
+        if (c->load_login) {
+            c->login_message0 = "Loading - please wait...";
+            c->login_message1 = c->load_message;
+            client_draw_title_screen(c);
+            platform_update_surface();
+        }
+        return;
+    }
+
     client_load_title(c);
     if (!c->archive_title) {
         gameshell_draw_progress(c->shell, message, progress);
@@ -66,14 +66,18 @@ void gameshell_run(Client *c) {
     gameshell_draw_progress(c->shell, "Loading...", 0);
     client_load(c);
 
+    // Logic runs on a fixed grid of deltime ms deadlines and the loop sleeps
+    // until the next one, instead of the applet's measured otim[] ratio: the
+    // deadlines are absolute, so a sleep that overshoots shortens the next
+    // wait rather than stretching every later frame, and nothing wakes early
+    // to spin. A frame that falls behind runs the missed ticks back to back
+    // (at most GAMESHELL_MAX_CATCHUP, as the applet's ratio floor of 25 did)
+    // and then draws once; further behind than that, the grid restarts.
+    uint64_t next = rs2_now();
     int opos = 0;
-    int ratio = 256;
-    int delta = 1;
-    int count = 0;
     for (int i = 0; i < 10; i++) {
-        c->shell->otim[i] = rs2_now();
+        c->shell->otim[i] = next;
     }
-    int64_t ntime;
     while (c->shell->state >= 0) {
 #ifdef __3DS__
         if (!aptMainLoop()) {
@@ -87,48 +91,35 @@ void gameshell_run(Client *c) {
                 return;
             }
         }
-        int lastRatio = ratio;
-        int lastDelta = delta;
-        ratio = 300;
-        delta = 1;
-        ntime = rs2_now();
-        if (c->shell->otim[opos] == 0L) {
-            ratio = lastRatio;
-            delta = lastDelta;
-        } else if (ntime > c->shell->otim[opos]) {
-            ratio = (int)((c->shell->deltime * 2560L) / (ntime - c->shell->otim[opos]));
-        }
-        if (ratio < 25) {
-            ratio = 25;
-        }
-        if (ratio > 256) {
-            ratio = 256;
-            delta = (int)((int64_t)c->shell->deltime - (ntime - c->shell->otim[opos]) / 10L);
-        }
-        c->shell->otim[opos] = ntime;
-        opos = (opos + 1) % 10;
-        if (delta > 1) {
-            for (int i = 0; i < 10; i++) {
-                if (c->shell->otim[i] != 0L) {
-                    c->shell->otim[i] += delta;
-                }
-            }
-        }
-        if (delta < c->shell->mindel) {
-            delta = c->shell->mindel;
-        }
+        uint64_t now = rs2_now();
+        int wait = now < next ? (int)(next - now) : 0;
+        // always give up at least mindel, as before, for the other threads
+        rs2_sleep(wait < c->shell->mindel ? c->shell->mindel : wait);
+        now = rs2_now();
 
-        rs2_sleep(delta);
-        while (count < 256) {
+        int ticks = 0;
+        while (now >= next && ticks < GAMESHELL_MAX_CATCHUP) {
             platform_poll_events(c);
             client_update(c);
             c->shell->mouse_click_button = 0;
             c->shell->key_queue_read_pos = c->shell->key_queue_write_pos;
-            count += ratio;
+            next += c->shell->deltime;
+            ticks++;
+        }
+        if (ticks == 0) {
+            // woke before the deadline: the frame would be the same one
+            continue;
+        }
+        if (now >= next) {
+            next = now + c->shell->deltime;
         }
-        count &= 0xff;
-        if (c->shell->deltime > 0) {
-            c->shell->fps = ratio * 1000 / (c->shell->deltime * 256);
+
+        // frames per second over the last 10 drawn
+        int64_t oldest = c->shell->otim[opos];
+        c->shell->otim[opos] = (int64_t)now;
+        opos = (opos + 1) % 10;
+        if ((int64_t)now > oldest) {
+            c->shell->fps = (int)(10000 / ((int64_t)now - oldest));
         }
         client_draw(c);
         client_run_flames(c);      // NOTE: random placement of run_flames
@@ -4,6 +4,10 @@
 
 #include "platform.h"
 
+// client_update ticks run back to back by a frame that fell behind, before it
+// draws and the rest are dropped
+#define GAMESHELL_MAX_CATCHUP 10
+
 struct GameShell {
     int state;
     int fps;
@@ -0,0 +1,505 @@
+/*******************************************************************************
+ * GROUND_ITEM.C - Zone-Bucketed Ground Items with Per-Viewer Deltas
+ *******************************************************************************
+ *
+ * See ground_item.h for the design.
+ *
+ * DATA LAYOUT:
+ *
+ *   items[]       fixed pool, slots from a SlotMap; each item is on two
+ *                 index-linked lists: its zone's items and the age list
+ *   zones[]       dense array of GroundZone, never shrinks
+ *   zone_table[]  open-addressed (linear probing) map from
+ *                 coord_pack(level, zone_x, zone_z) to a zones[] index;
+ *                 zones are never removed, so no deletion is needed
+ *
+ * Zone indices are stored instead of pointers because zones[] moves when
+ * it grows.
+ *
+ ******************************************************************************/
+
+#include "ground_item.h"
+#include "movement.h"  /* coord_pack */
+#include "packets.h"
+#include "packet_codec.h"
+#include "item.h"
+#include "mem_stats.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Payload kept per UPDATE_ZONE_PARTIAL_ENCLOSED, well inside the client's
+ * 5000-byte packet buffer; a larger zone is split over several packets */
+#define GROUND_ENCLOSED_LIMIT 4000
+
+/* Largest stack the client can display (signed 32-bit) */
+#define GROUND_MAX_COUNT 2147483647u
+
+GroundItemSystem* g_ground_items = NULL;
+
+/*******************************************************************************
+ * ZONE INDEX
+ ******************************************************************************/
+
+static inline u32 zone_hash(u32 key) {
+    u32 h = key * 0x9E3779B1u;  /* Fibonacci hashing */
+    return h ^ (h >> 16);
+}
+
+static inline u32 zone_key(const Position* position) {
+    return coord_pack(position_height(position), position_get_zone_x(position), position_get_zone_z(position));
+}
+
+static u32 zone_find(const GroundItemSystem* sys, u32 key) {
+    u32 i = zone_hash(key) & sys->zone_table_mask;
+    while (sys->zone_table[i] != GROUND_NONE) {
+        if (sys->zones[sys->zone_table[i]].key == key) return sys->zone_table[i];
+        i = (i + 1) & sys->zone_table_mask;
+    }
+    return GROUND_NONE;
+}
+
+static void zone_table_insert(u32* table, u32 mask, const GroundZone* zones, u32 index) {
+    u32 i = zone_hash(zones[index].key) & mask;
+    while (table[i] != GROUND_NONE) {
+        i = (i + 1) & mask;
+    }
+    table[i] = index;
+}
+
+/*
+ * zone_get - Index of a zone's record, created on first use
+ *
+ * Keeps the table at most half full, doubling (and rehashing) before
+ * that, so probe runs stay short.
+ */
+static u32 zone_get(GroundItemSystem* sys, u32 key) {
+    u32 index = zone_find(sys, key);
+    if (index != GROUND_NONE) return index;
+
+    if (sys->zone_count == sys->zone_capacity) {
+        u32 capacity = sys->zone_capacity * 2;
+        GroundZone* zones = mem_realloc(MEM_OBJECT, sys->zones, capacity * sizeof(GroundZone));
+        if (!zones) return GROUND_NONE;
+        sys->zones = zones;
+        sys->zone_capacity = capacity;
+    }
+
+    u32 size = sys->zone_table_mask + 1;
+    if ((sys->zone_count + 1) * 2 > size) {
+        u32* table = mem_alloc(MEM_OBJECT, size * 2 * sizeof(u32));
+        if (!table) return GROUND_NONE;
+        memset(table, 0xFF, size * 2 * sizeof(u32));
+        for (u32 i = 0; i < sys->zone_count; i++) {
+            zone_table_insert(table, size * 2 - 1, sys->zones, i);
+        }
+        mem_free(sys->zone_table);
+        sys->zone_table = table;
+        sys->zone_table_mask = size * 2 - 1;
+    }
+
+    index = sys->zone_count++;
+    GroundZone* zone = &sys->zones[index];
+    memset(zone, 0, sizeof(GroundZone));
+    zone->key = key;
+    zone->head = GROUND_NONE;
+    zone_table_insert(sys->zone_table, sys->zone_table_mask, sys->zones, index);
+    return index;
+}
+
+/*******************************************************************************
+ * CHANGE LOG
+ ******************************************************************************/
+
+static inline u16 wire_count(u32 count) {
+    return (u16)(count > GROUND_MAX_WIRE_COUNT ? GROUND_MAX_WIRE_COUNT : count);
+}
+
+static inline u8 wire_tile(const Position* position) {
+    return (u8)(((position_x(position) & 7) << 4) | (position_z(position) & 7));
+}
+
+static void zone_log(GroundItemSystem* sys, GroundZone* zone, GroundEventType type,
+                     const GroundItem* item, u16 count, u16 old_count) {
+    zone->revision++;
+    GroundEvent* event = &zone->log[(zone->revision - 1) & (GROUND_ZONE_LOG - 1)];
+    event->type = (u8)type;
+    event->tile = wire_tile(&item->position);
+    event->item_id = item->item_id;
+    event->count = count;
+    event->old_count = old_count;
+    sys->changes++;
+}
+
+/*******************************************************************************
+ * LIFECYCLE
+ ******************************************************************************/
+
+GroundItemSystem* ground_item_system_create(u32 capacity) {
+    if (capacity == 0 || capacity > SLOTMAP_MAX_CAPACITY) return NULL;
+
+    GroundItemSystem* sys = mem_calloc(MEM_OBJECT, 1, sizeof(GroundItemSystem));
+    if (!sys) return NULL;
+
+    sys->items = mem_calloc(MEM_OBJECT, capacity, sizeof(GroundItem));
+    sys->slots = slotmap_new(capacity, 0);
+    sys->zone_capacity = 256;
+    sys->zones = mem_alloc(MEM_OBJECT, sys->zone_capacity * sizeof(GroundZone));
+    sys->zone_table = mem_alloc(MEM_OBJECT, 512 * sizeof(u32));
+    if (!sys->items || !sys->slots || !sys->zones || !sys->zone_table) {
+        ground_item_system_destroy(sys);
+        return NULL;
+    }
+    memset(sys->zone_table, 0xFF, 512 * sizeof(u32));
+    sys->zone_table_mask = 511;
+    sys->capacity = capacity;
+    sys->oldest = GROUND_NONE;
+    sys->newest = GROUND_NONE;
+    return sys;
+}
+
+void ground_item_system_destroy(GroundItemSystem* sys) {
+    if (!sys) return;
+    if (sys->items) {
+        for (u32 i = 0; i < sys->capacity; i++) {
+            timer_cancel(g_timers, sys->items[i].despawn_timer);
+        }
+    }
+    mem_free(sys->items);
+    slotmap_free(sys->slots);
+    mem_free(sys->zones);
+    mem_free(sys->zone_table);
+    mem_free(sys);
+}
+
+/*******************************************************************************
+ * ITEMS
+ ******************************************************************************/
+
+static void ground_item_despawn_fired(void* ctx, u32 index) {
+    GroundItemSystem* sys = (GroundItemSystem*)ctx;
+    GroundItem* item = &sys->items[index];
+    item->despawn_timer = TIMER_NONE;  /* Already fired */
+    ground_item_remove(sys, item);
+}
+
+static void ground_item_schedule(GroundItemSystem* sys, GroundItem* item, u32 ticks) {
+    timer_cancel(g_timers, item->despawn_timer);
+    item->despawn_timer = TIMER_NONE;
+    if (ticks > 0) {
+        item->despawn_timer = timer_schedule(g_timers, ticks, ground_item_despawn_fired, sys,
+                                             (u32)(item - sys->items));
+    }
+}
+
+GroundItem* ground_item_drop(GroundItemSystem* sys, u16 item_id, u32 count,
+                             const Position* position, u32 despawn_ticks) {
+    if (!sys || item_id == 0 || count == 0 || !position) return NULL;
+
+    /* Stackables merge into a stack of the same item on the tile */
+    const ItemDefinition* def = item_get_definition(g_items, item_id);
+    if (def && def->stackable) {
+        GroundItem* stack = ground_item_get_at(sys, item_id, position);
+        if (stack) {
+            u32 room = GROUND_MAX_COUNT - stack->count;
+            ground_item_set_count(sys, stack, stack->count + (count < room ? count : room));
+            ground_item_schedule(sys, stack, despawn_ticks);
+            return stack;
+        }
+    }
+
+    Position tile = *position;
+    u32 zone_index = zone_get(sys, zone_key(&tile));
+    if (zone_index == GROUND_NONE) return NULL;
+
+    u32 slot = slotmap_alloc(sys->slots);
+    if (slot == SLOTMAP_NONE) {
+        /* Full: the oldest item on the ground makes room */
+        ground_item_remove(sys, &sys->items[sys->oldest]);
+        slot = slotmap_alloc(sys->slots);
+    }
+
+    GroundItem* item = &sys->items[slot];
+    item->item_id = item_id;
+    item->count = count < GROUND_MAX_COUNT ? count : GROUND_MAX_COUNT;
+    item->position = tile;
+    item->zone = zone_index;
+    item->despawn_timer = TIMER_NONE;
+
+    GroundZone* zone = &sys->zones[zone_index];
+    item->zone_prev = GROUND_NONE;
+    item->zone_next = zone->head;
+    if (zone->head != GROUND_NONE) sys->items[zone->head].zone_prev = slot;
+    zone->head = slot;
+    zone->count++;
+
+    item->age_prev = sys->newest;
+    item->age_next = GROUND_NONE;
+    if (sys->newest != GROUND_NONE) {
+        sys->items[sys->newest].age_next = slot;
+    } else {
+        sys->oldest = slot;
+    }
+    sys->newest = slot;
+
+    zone_log(sys, zone, GROUND_EVENT_ADD, item, wire_count(item->count), 0);
+    ground_item_schedule(sys, item, despawn_ticks);
+    return item;
+}
+
+void ground_item_set_count(GroundItemSystem* sys, GroundItem* item, u32 count) {
+    if (!sys || !item || item->item_id == 0) return;
+    if (count == 0) {
+        ground_item_remove(sys, item);
+        return;
+    }
+
+    u16 old_wire = wire_count(item->count);
+    item->count = count;
+    /* Beyond 65535 the client already shows the capped value */
+    if (wire_count(count) != old_wire) {
+        zone_log(sys, &sys->zones[item->zone], GROUND_EVENT_COUNT, item,
+                 wire_count(count), old_wire);
+    }
+}
+
+void ground_item_remove(GroundItemSystem* sys, GroundItem* item) {
+    if (!sys || !item || item->item_id == 0) return;
+
+    u32 slot = (u32)(item - sys->items);
+    timer_cancel(g_timers, item->despawn_timer);
+    item->despawn_timer = TIMER_NONE;
+
+    GroundZone* zone = &sys->zones[item->zone];
+    if (item->zone_prev != GROUND_NONE) {
+        sys->items[item->zone_prev].zone_next = item->zone_next;
+    } else {
+        zone->head = item->zone_next;
+    }
+    if (item->zone_next != GROUND_NONE) sys->items[item->zone_next].zone_prev = item->zone_prev;
+    zone->count--;
+
+    if (item->age_prev != GROUND_NONE) {
+        sys->items[item->age_prev].age_next = item->age_next;
+    } else {
+        sys->oldest = item->age_next;
+    }
+    if (item->age_next != GROUND_NONE) {
+        sys->items[item->age_next].age_prev = item->age_prev;
+    } else {
+        sys->newest = item->age_prev;
+    }
+
+    zone_log(sys, zone, GROUND_EVENT_DEL, item, 0, 0);
+    item->item_id = 0;
+    slotmap_release(sys->slots, slot);
+}
+
+GroundItem* ground_item_get_at(GroundItemSystem* sys, u16 item_id, const Position* position) {
+    if (!sys || !position) return NULL;
+
+    u32 zone_index = zone_find(sys, zone_key(position));
+    if (zone_index == GROUND_NONE) return NULL;
+
+    for (u32 i = sys->zones[zone_index].head; i != GROUND_NONE; i = sys->items[i].zone_next) {
+        GroundItem* item = &sys->items[i];
+        if (item->item_id == item_id && position_equals(&item->position, position)) {
+            return item;
+        }
+    }
+    return NULL;
+}
+
+/*******************************************************************************
+ * VIEWER UPDATES
+ ******************************************************************************/
+
+/*
+ * ZoneWriter - Appends zone sub-packets to UPDATE_ZONE_PARTIAL_ENCLOSED
+ *
+ * The packet is opened on the first sub-packet (nothing is sent for a
+ * zone with no changes) and closed and reopened when it would pass
+ * GROUND_ENCLOSED_LIMIT.
+ */
+typedef struct {
+    Player* player;
+    StreamBuffer* out;
+    u8 base_x, base_z;          /* Scene-local corner of the zone */
+    u32 start;                  /* Payload start of the open packet */
+    bool open;
+} ZoneWriter;
+
+static inline ISAACCipher* zone_cipher(Player* player) {
+    return player->conn->out_cipher.initialized ? &player->conn->out_cipher : NULL;
+}
+
+static void zone_writer_close(ZoneWriter* w) {
+    if (w->open) {
+        buffer_finish_var_header(w->out, VAR_SHORT);
+        w->open = false;
+    }
+}
+
+static void zone_writer_reserve(ZoneWriter* w, u32 bytes) {
+    if (w->open && w->out->position - w->start + bytes > GROUND_ENCLOSED_LIMIT) {
+        zone_writer_close(w);
+    }
+    if (!w->open) {
+        buffer_write_header_var(w->out, SERVER_UPDATE_ZONE_PARTIAL_ENCLOSED,
+                                zone_cipher(w->player), VAR_SHORT);
+        w->start = w->out->position;
+        buffer_write_byte(w->out, w->base_x);
+        buffer_write_byte(w->out, w->base_z);
+        w->open = true;
+    }
+}
+
+/*
+ * packets.h swaps OBJ_ADD and OBJ_REVEAL: the client reads 223 as OBJ_ADD
+ * (id, count) and 50 as OBJ_REVEAL (id, count, receiver). The raw values
+ * below follow the client.
+ */
+#define ZONE_OBJ_ADD 223
+
+static void zone_write_add(ZoneWriter* w, u8 tile, u16 item_id, u16 count) {
+    zone_writer_reserve(w, 6);
+    buffer_write_byte(w->out, ZONE_OBJ_ADD);
+    buffer_write_byte(w->out, tile);
+    buffer_write_short(w->out, item_id, BYTE_ORDER_BIG);
+    buffer_write_short(w->out, count, BYTE_ORDER_BIG);
+}
+
+static void zone_write_event(ZoneWriter* w, const GroundEvent* event) {
+    switch (event->type) {
+        case GROUND_EVENT_ADD:
+            zone_write_add(w, event->tile, event->item_id, event->count);
+            break;
+        case GROUND_EVENT_DEL:
+            zone_writer_reserve(w, 4);
+            buffer_write_byte(w->out, SERVER_OBJ_DEL);
+            buffer_write_byte(w->out, event->tile);
+            buffer_write_short(w->out, event->item_id, BYTE_ORDER_BIG);
+            break;
+        case GROUND_EVENT_COUNT:
+            zone_writer_reserve(w, 8);
+            buffer_write_byte(w->out, SERVER_OBJ_COUNT);
+            buffer_write_byte(w->out, event->tile);
+            buffer_write_short(w->out, event->item_id, BYTE_ORDER_BIG);
+            buffer_write_short(w->out, event->old_count, BYTE_ORDER_BIG);
+            buffer_write_short(w->out, event->count, BYTE_ORDER_BIG);
+            break;
+    }
+}
+
+/*
+ * zone_send_full - Clear the zone on the client, then add every item
+ */
+static void zone_send_full(GroundItemSystem* sys, ZoneWriter* w, const GroundZone* zone) {
+    encode_update_zone_full_follows(w->out, zone_cipher(w->player), (u8)w->base_x, (u8)w->base_z);
+
+    for (u32 i = zone->head; i != GROUND_NONE; i = sys->items[i].zone_next) {
+        const GroundItem* item = &sys->items[i];
+        zone_write_add(w, wire_tile(&item->position), item->item_id, wire_count(item->count));
+    }
+    zone_writer_close(w);
+}
+
+/*
+ * zone_send_delta - Replay the logged changes after revision known
+ */
+static void zone_send_delta(ZoneWriter* w, const GroundZone* zone, u32 known) {
+    for (u32 r = known + 1; r <= zone->revision; r++) {
+        zone_write_event(w, &zone->log[(r - 1) & (GROUND_ZONE_LOG - 1)]);
+    }
+    zone_writer_close(w);
+}
+
+/*
+ * ground_tracking_shift - Follow the client's rebuild to a new origin
+ *
+ * The client moves its item stacks by the difference between the old
+ * and new scene base and drops those that fall outside; revisions move
+ * with them.
+ */
+static void ground_tracking_shift(GroundTracking* t, u32 origin_zone_x, u32 origin_zone_z) {
+    i32 dx = (i32)origin_zone_x - (i32)t->origin_zone_x;
+    i32 dz = (i32)origin_zone_z - (i32)t->origin_zone_z;
+    u32 shifted[GROUND_SCENE_ZONES][GROUND_SCENE_ZONES];
+
+    for (i32 x = 0; x < GROUND_SCENE_ZONES; x++) {
+        for (i32 z = 0; z < GROUND_SCENE_ZONES; z++) {
+            i32 old_x = x + dx;
+            i32 old_z = z + dz;
+            bool inside = old_x >= 0 && old_z >= 0 &&
+                          old_x < GROUND_SCENE_ZONES && old_z < GROUND_SCENE_ZONES;
+            shifted[x][z] = inside ? t->revision[old_x][old_z] : GROUND_REVISION_UNKNOWN;
+        }
+    }
+    memcpy(t->revision, shifted, sizeof(shifted));
+    t->origin_zone_x = origin_zone_x;
+    t->origin_zone_z = origin_zone_z;
+}
+
+void ground_item_update_player(GroundItemSystem* sys, Player* player, GroundTracking* tracking) {
+    if (!sys || !player || !tracking) return;
+    memset(tracking->cleared, 0, sizeof(tracking->cleared));
+
+    u32 level = position_height(&player->position);
+    u32 origin_zone_x = player->origin_x >> 3;
+    u32 origin_zone_z = player->origin_z >> 3;
+    bool rescan = false;
+
+    if (!tracking->valid || tracking->level != level) {
+        /*
+         * New session or another level: the client may hold stale stacks
+         * of this level, so every zone with a record gets a full send.
+         */
+        for (u32 x = 0; x < GROUND_SCENE_ZONES; x++) {
+            for (u32 z = 0; z < GROUND_SCENE_ZONES; z++) {
+                tracking->revision[x][z] = GROUND_REVISION_UNKNOWN;
+            }
+        }
+        tracking->valid = true;
+        tracking->level = level;
+        tracking->origin_zone_x = origin_zone_x;
+        tracking->origin_zone_z = origin_zone_z;
+        rescan = true;
+    } else if (tracking->origin_zone_x != origin_zone_x || tracking->origin_zone_z != origin_zone_z) {
+        ground_tracking_shift(tracking, origin_zone_x, origin_zone_z);
+        rescan = true;
+    }
+
+    /* Nothing dropped, taken or changed anywhere since the last sync */
+    if (!rescan && tracking->changes_seen == sys->changes) return;
+    tracking->changes_seen = sys->changes;
+
+    ZoneWriter w = { .player = player, .out = player_out(player) };
+    i32 base_zone_x = (i32)origin_zone_x - 6;
+    i32 base_zone_z = (i32)origin_zone_z - 6;
+
+    for (i32 x = 0; x < GROUND_SCENE_ZONES; x++) {
+        for (i32 z = 0; z < GROUND_SCENE_ZONES; z++) {
+            if (base_zone_x + x < 0 || base_zone_z + z < 0) continue;
+
+            u32 known = tracking->revision[x][z];
+            u32 index = zone_find(sys, coord_pack(level, (u32)(base_zone_x + x), (u32)(base_zone_z + z)));
+            if (index == GROUND_NONE) {
+                /* Never held an item, so the client cannot hold one either */
+                tracking->revision[x][z] = 0;
+                continue;
+            }
+
+            const GroundZone* zone = &sys->zones[index];
+            if (known == zone->revision) continue;
+
+            w.base_x = (u8)(x << 3);
+            w.base_z = (u8)(z << 3);
+            if (known == GROUND_REVISION_UNKNOWN || zone->revision - known > GROUND_ZONE_LOG) {
+                zone_send_full(sys, &w, zone);
+                tracking->cleared[x] |= (u16)(1u << z);
+            } else {
+                zone_send_delta(&w, zone, known);
+            }
+            tracking->revision[x][z] = zone->revision;
+        }
+    }
+}
@@ -0,0 +1,254 @@
+/*******************************************************************************
+ * GROUND_ITEM.H - Zone-Bucketed Ground Items with Per-Viewer Deltas
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Spatial bucketing by the protocol's own unit (the 8x8 zone)
+ *   - Revision counters and bounded change logs (ring buffers)
+ *   - Delta synchronization: send what changed since the client's version
+ *   - Falling back to a full resync when the log no longer reaches back
+ *
+ * THE PROBLEM:
+ *
+ * Every client shows the items lying in its 104x104 scene. The naive way
+ * to keep it right is to resend whatever is on the ground near a player
+ * whenever anything changes:
+ *
+ *   player drops 1 bone in a zone holding 40 items
+ *     → every viewer: UPDATE_ZONE_FULL_FOLLOWS + 41 OBJ_ADDs
+ *
+ * That is 40 redundant adds per viewer per drop, and at a busy bank or
+ * a boss kill it repeats several times a tick.
+ *
+ * THE SOLUTION - ZONES WITH REVISIONS:
+ *
+ * Items are filed by zone (8x8 tiles, the unit zone packets address).
+ * Each zone counts its changes in a revision and keeps the last
+ * GROUND_ZONE_LOG changes in a ring:
+ *
+ *   zone (402, 403, level 0)
+ *   ┌──────────────────────────────────────────────┐
+ *   │ items:    bones ─ coins x25 ─ logs           │
+ *   │ revision: 7                                  │
+ *   │ log:      r5 ADD logs  r6 DEL bones          │
+ *   │           r7 COUNT coins 20 → 25             │
+ *   └──────────────────────────────────────────────┘
+ *
+ * Each viewer remembers, per zone of its scene, the revision its client
+ * has seen. Once a tick, every zone whose revision moved on is brought
+ * up to date with exactly the logged changes in between:
+ *
+ *   viewer knows r5, zone is at r7
+ *     → UPDATE_ZONE_PARTIAL_ENCLOSED(zone) { OBJ_DEL bones, OBJ_COUNT coins }
+ *
+ * The whole contents are only sent (UPDATE_ZONE_FULL_FOLLOWS, which clears
+ * the zone on the client, then one OBJ_ADD per item) when the client
+ * cannot be holding the zone: it just entered the scene, the viewer
+ * changed level, or more than GROUND_ZONE_LOG changes happened since the
+ * client's revision. A drop never triggers one.
+ *
+ * ZONE PACKETS (client readZonePacket, positions relative to the zone):
+ *
+ *   UPDATE_ZONE_FULL_FOLLOWS      g1 base_x, g1 base_z    clear zone's items
+ *   UPDATE_ZONE_PARTIAL_ENCLOSED  g1 base_x, g1 base_z, then repeated
+ *                                 [opcode][body], opcodes not ISAAC-encoded
+ *     OBJ_ADD    (223)  g1 tile, g2 id, g2 count
+ *     OBJ_DEL    (49)   g1 tile, g2 id
+ *     OBJ_COUNT  (151)  g1 tile, g2 id, g2 old count, g2 new count
+ *
+ *   tile = ((x & 7) << 4) | (z & 7); base_x/base_z are scene-local tiles
+ *   (0-103), the zone's corner relative to the last LOAD_AREA.
+ *
+ * SCENE TRACKING:
+ *
+ *   The scene is 13x13 zones around the LOAD_AREA origin. When the
+ *   client rebuilds it for a new origin it shifts its item stacks along
+ *   and drops those that left, so GroundTracking shifts its revisions the
+ *   same way. Only zones that newly entered the scene need a full send.
+ *
+ * COMPLEXITY:
+ *   - drop / pick up / count change:  O(1) average (zone hash + tile scan)
+ *   - viewer update, nothing changed:  O(1) (global change counter)
+ *   - viewer update, otherwise:        O(169 zone lookups + changes sent)
+ *
+ ******************************************************************************/
+
+#ifndef GROUND_ITEM_H
+#define GROUND_ITEM_H
+
+#include "types.h"
+#include "position.h"
+#include "player.h"
+#include "timer_wheel.h"
+#include "datastruct/slotmap.h"
+#include <stdbool.h>
+
+/* Changes remembered per zone (power of two) */
+#define GROUND_ZONE_LOG 64
+
+/* The client scene is 104x104 tiles = 13x13 zones */
+#define GROUND_SCENE_ZONES 13
+
+/* Revision a viewer has for a zone its client does not hold */
+#define GROUND_REVISION_UNKNOWN UINT32_MAX
+
+/* Largest count the zone packets carry (g2) */
+#define GROUND_MAX_WIRE_COUNT 65535
+
+/* Default lifetime of a dropped item (200 ticks = 2 minutes) */
+#define GROUND_ITEM_DESPAWN_TICKS 200
+
+#define GROUND_NONE UINT32_MAX
+
+typedef enum {
+    GROUND_EVENT_ADD,
+    GROUND_EVENT_DEL,
+    GROUND_EVENT_COUNT
+} GroundEventType;
+
+/*
+ * GroundEvent - One logged zone change, already in wire form
+ *
+ * Counts are stored clamped to GROUND_MAX_WIRE_COUNT, exactly as the
+ * client was told, so OBJ_COUNT's old count matches the client's stack.
+ */
+typedef struct {
+    u8 type;                    /* GroundEventType */
+    u8 tile;                    /* ((x & 7) << 4) | (z & 7) */
+    u16 item_id;
+    u16 count;                  /* ADD: count, COUNT: new count */
+    u16 old_count;              /* COUNT only */
+} GroundEvent;
+
+/*
+ * GroundItem - One item stack lying on a tile
+ */
+typedef struct {
+    u16 item_id;                /* 0 while the slot is free */
+    u32 count;
+    Position position;
+    u32 zone;                   /* Index into GroundItemSystem.zones */
+    u32 zone_prev, zone_next;   /* Items of the same zone */
+    u32 age_prev, age_next;     /* Oldest-first list, for eviction */
+    TimerHandle despawn_timer;
+} GroundItem;
+
+/*
+ * GroundZone - Items and change log of one 8x8 zone
+ *
+ * Created on the first drop and kept for the server's lifetime even when
+ * empty: a revision must never go back to 0, or a viewer holding r5 of a
+ * recreated zone could miss its first five changes.
+ */
+typedef struct {
+    u32 key;                    /* coord_pack(level, zone_x, zone_z) */
+    u32 revision;               /* Changes so far */
+    u32 head;                   /* First item, GROUND_NONE if empty */
+    u32 count;                  /* Items in the zone */
+    GroundEvent log[GROUND_ZONE_LOG];   /* Change r at log[(r - 1) % LOG] */
+} GroundZone;
+
+/*
+ * GroundTracking - What one client holds of the ground items, per PID
+ *
+ * revision[x][z] is the revision of scene zone (x, z) the client has, or
+ * GROUND_REVISION_UNKNOWN. All zeroes (login) means "nothing sent yet".
+ */
+typedef struct {
+    bool valid;                 /* false until the first update */
+    u32 origin_zone_x;          /* Scene the revisions belong to */
+    u32 origin_zone_z;
+    u32 level;
+    u32 changes_seen;           /* GroundItemSystem.changes last synced */
+    u32 revision[GROUND_SCENE_ZONES][GROUND_SCENE_ZONES];
+    u16 cleared[GROUND_SCENE_ZONES];    /* Bit z of [x]: zone sent UPDATE_ZONE_FULL_FOLLOWS
+                                           by the last update (the client also reverted
+                                           its changed locs there, see zone_update.h) */
+} GroundTracking;
+
+/*
+ * GroundItemSystem - All ground items plus the zone index
+ */
+typedef struct {
+    GroundItem* items;
+    u32 capacity;
+    SlotMap* slots;             /* Free item slots */
+    u32 oldest, newest;         /* Ends of the age list */
+
+    GroundZone* zones;          /* Dense, grows by doubling */
+    u32 zone_count;
+    u32 zone_capacity;
+    u32* zone_table;            /* Open addressing: zone index or GROUND_NONE */
+    u32 zone_table_mask;
+
+    u32 changes;                /* Bumped on every logged change anywhere */
+} GroundItemSystem;
+
+extern GroundItemSystem* g_ground_items;
+
+/*
+ * ground_item_system_create - Allocate an empty store
+ *
+ * @param capacity  Maximum items on the ground (MAX_GROUND_ITEMS)
+ * @return          New system, or NULL on allocation failure
+ */
+GroundItemSystem* ground_item_system_create(u32 capacity);
+
+/*
+ * ground_item_system_destroy - Free the store and cancel its timers
+ */
+void ground_item_system_destroy(GroundItemSystem* sys);
+
+/*
+ * ground_item_drop - Put an item on the ground
+ *
+ * @param sys            Ground item store
+ * @param item_id        Item ID (non-zero)
+ * @param count          Amount (non-zero)
+ * @param position       Tile to drop on
+ * @param despawn_ticks  Ticks until it disappears (0 = never)
+ * @return               The stack holding the item, or NULL
+ *
+ * A stackable item dropped on a tile already holding the same item is
+ * merged into that stack (one OBJ_COUNT instead of a second OBJ_ADD) and
+ * its despawn timer restarted. When the store is full the oldest item
+ * is removed to make room.
+ */
+GroundItem* ground_item_drop(GroundItemSystem* sys, u16 item_id, u32 count,
+                             const Position* position, u32 despawn_ticks);
+
+/*
+ * ground_item_set_count - Change the amount in a stack (0 removes it)
+ *
+ * Meant for stackable items. The client's OBJ_DEL removes the first
+ * stack of an ID on the tile, so stacks sharing an ID and tile (dropped
+ * non-stackables) must all keep count 1 to stay interchangeable.
+ */
+void ground_item_set_count(GroundItemSystem* sys, GroundItem* item, u32 count);
+
+/*
+ * ground_item_remove - Take a stack off the ground (picked up, despawned)
+ */
+void ground_item_remove(GroundItemSystem* sys, GroundItem* item);
+
+/*
+ * ground_item_get_at - First stack of item_id on a tile, or NULL
+ *
+ * COMPLEXITY: O(items in the tile's zone)
+ */
+GroundItem* ground_item_get_at(GroundItemSystem* sys, u16 item_id, const Position* position);
+
+/*
+ * ground_item_update_player - Bring a client's ground items up to date
+ *
+ * @param sys       Ground item store
+ * @param player    Viewer (origin_x/origin_z from its last LOAD_AREA)
+ * @param tracking  Viewer's GroundTracking (World.ground_tracking[pid])
+ *
+ * Appends zone packets to the player's output arena; the caller commits.
+ * Call after LOAD_AREA for this tick has been written.
+ */
+void ground_item_update_player(GroundItemSystem* sys, Player* player, GroundTracking* tracking);
+
+#endif /* GROUND_ITEM_H */
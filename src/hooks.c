@@ -0,0 +1,48 @@
+/*******************************************************************************
+ * HOOKS.C - Event Hook Registration
+ *******************************************************************************
+ *
+ * See hooks.h. Dispatch is inline in the header; this file only fills the
+ * tables before the game starts.
+ *
+ ******************************************************************************/
+
+#include "hooks.h"
+#include <stdio.h>
+#include <string.h>
+
+HookTables g_hooks;
+
+#define HOOK_ADD_IMPL(Name, name, params, args) \
+    bool hook_add_##name(Hook##Name##Fn fn, void* ctx) { \
+        if (!fn || g_hooks.frozen || g_hooks.name.count == HOOK_MAX_HANDLERS) { \
+            fprintf(stderr, "WARNING: Hook %s not added (%s)\n", #name, \
+                    !fn ? "no handler" : g_hooks.frozen ? "tables frozen" : "table full"); \
+            return false; \
+        } \
+        g_hooks.name.fn[g_hooks.name.count] = fn; \
+        g_hooks.name.ctx[g_hooks.name.count] = ctx; \
+        g_hooks.name.count++; \
+        return true; \
+    }
+HOOK_EVENTS(HOOK_ADD_IMPL)
+#undef HOOK_ADD_IMPL
+
+void hooks_freeze(void) {
+    g_hooks.frozen = true;
+
+    char line[160];
+    int len = snprintf(line, sizeof(line), "Hooks frozen:");
+#define HOOK_REPORT(Name, name, params, args) \
+    if (len > 0 && (size_t)len < sizeof(line)) { \
+        len += snprintf(line + len, sizeof(line) - (size_t)len, " %s %u", #name, \
+                        g_hooks.name.count); \
+    }
+    HOOK_EVENTS(HOOK_REPORT)
+#undef HOOK_REPORT
+    printf("%s\n", line);
+}
+
+void hooks_reset(void) {
+    memset(&g_hooks, 0, sizeof(g_hooks));
+}
@@ -0,0 +1,154 @@
+/*******************************************************************************
+ * HOOKS.H - Typed Event Hooks for Gameplay Extensions
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Observer dispatch generated from one X-macro table (typed handlers,
+ *     no void* casts at the call sites)
+ *   - Structure-of-arrays handler tables: one contiguous array per event
+ *   - Freeze-after-init: tables that never change once the game runs
+ *     need no locks and no atomics to be read
+ *   - Paying for extensibility only when it is used
+ *
+ * THE PROBLEM:
+ *
+ * Everything that reacts to "a player logged in" is a line in
+ * server_send_initial_game_packets(); everything that reacts to a packet
+ * is a case in server_dispatch_packet(); everything per tick is a call
+ * in server_tick(). A feature that watches those moments (an anti-cheat
+ * packet counter, a zone-based music or PvP flag, a plugin for one
+ * server) means editing the hottest functions in the tree, and every
+ * server pays for it whether it uses the feature or not.
+ *
+ * THE SOLUTION - FIRE AN EVENT, LET SUBSCRIBERS DECIDE:
+ *
+ *   startup:   hook_add_login(on_login, ctx)       ─┐  server_init():
+ *              hook_add_packet(count_packet, ctx)   │  subscribe, then
+ *              hooks_freeze()                      ─┘  freeze
+ *
+ *   game:      hook_login(player)      (inline: count, branch, calls)
+ *
+ *   g_hooks.login:   fn[]  = { on_login, ... }     contiguous: one cache
+ *                    ctx[] = { ctx, ... }          line for several
+ *                    count = 1                     subscribers
+ *
+ * An event with no subscribers is one load of its count and a branch
+ * that is always not-taken, so the predictor gets it right every time;
+ * the handler loop is never entered. With subscribers, each call is an
+ * indirect call through a table that does not change, so it predicts
+ * just as well.
+ *
+ * Subscribing is only allowed until hooks_freeze() (the end of
+ * server_init()). After that the tables are read-only for the rest of
+ * the process, so the game thread reads them without locks, and a
+ * handler cannot subscribe another handler in the middle of a dispatch.
+ *
+ * EVENTS (HOOK_EVENTS):
+ *   login        (player)                    after the login packets
+ *   logout       (player)                    a logged-in player's slot is dropped
+ *   zone_enter   (player, zone_x, zone_z)    crossed into another 8x8 zone
+ *   packet       (player, opcode, payload, length)
+ *                                            before the packet's handler
+ *   tick_end     (tick)                      end of server_tick()
+ *
+ *   Handlers run on the game thread, inside the code that fires them:
+ *   a packet handler sees the payload before the server acts on it and
+ *   must not keep the pointer.
+ *
+ * ADDING AN EVENT:
+ *   One X() line below gives the handler type, the table, hook_add_<x>()
+ *   and hook_<x>(); then fire it where it happens.
+ *
+ ******************************************************************************/
+
+#ifndef HOOKS_H
+#define HOOKS_H
+
+#include "types.h"
+#include "player.h"
+#include <stdbool.h>
+
+/* Subscribers per event */
+#define HOOK_MAX_HANDLERS 8
+
+/*
+ * HOOK_EVENTS - X(Name, name, (parameters), (arguments))
+ *
+ * Handlers receive the subscriber's ctx first, then the parameters.
+ */
+#define HOOK_EVENTS(X) \
+    X(Login,     login,      (Player* player),                    (player)) \
+    X(Logout,    logout,     (Player* player),                    (player)) \
+    X(ZoneEnter, zone_enter, (Player* player, u32 zone_x, u32 zone_z), \
+                             (player, zone_x, zone_z)) \
+    X(Packet,    packet,     (Player* player, u8 opcode, const u8* payload, u32 length), \
+                             (player, opcode, payload, length)) \
+    X(TickEnd,   tick_end,   (u64 tick),                          (tick))
+
+#define HOOK_UNPAREN(...) __VA_ARGS__
+
+/* HookLoginFn etc.: void fn(void* ctx, Player* player) */
+#define HOOK_TYPEDEF(Name, name, params, args) \
+    typedef void (*Hook##Name##Fn)(void* ctx, HOOK_UNPAREN params);
+HOOK_EVENTS(HOOK_TYPEDEF)
+#undef HOOK_TYPEDEF
+
+/*
+ * HookTables - Every event's subscribers, one contiguous array each
+ */
+#define HOOK_TABLE(Name, name, params, args) \
+    struct { \
+        u32 count; \
+        Hook##Name##Fn fn[HOOK_MAX_HANDLERS]; \
+        void* ctx[HOOK_MAX_HANDLERS]; \
+    } name;
+typedef struct {
+    HOOK_EVENTS(HOOK_TABLE)
+    bool frozen;                        /* Set by hooks_freeze() */
+} HookTables;
+#undef HOOK_TABLE
+
+extern HookTables g_hooks;
+
+/*
+ * hook_add_<event> - Subscribe a handler (before hooks_freeze())
+ *
+ * @param fn   Handler
+ * @param ctx  Passed back to it as its first argument
+ * @return     false if frozen, full or fn is NULL
+ */
+#define HOOK_ADD_DECL(Name, name, params, args) \
+    bool hook_add_##name(Hook##Name##Fn fn, void* ctx);
+HOOK_EVENTS(HOOK_ADD_DECL)
+#undef HOOK_ADD_DECL
+
+/*
+ * hook_<event> - Fire an event: every subscriber, in subscription order
+ *
+ * COMPLEXITY: O(1) with no subscribers (one branch), O(subscribers)
+ */
+#define HOOK_FIRE(Name, name, params, args) \
+    static inline void hook_##name params { \
+        u32 count = g_hooks.name.count; \
+        if (count == 0) return; \
+        for (u32 i = 0; i < count; i++) { \
+            g_hooks.name.fn[i](g_hooks.name.ctx[i], HOOK_UNPAREN args); \
+        } \
+    }
+HOOK_EVENTS(HOOK_FIRE)
+#undef HOOK_FIRE
+
+/*
+ * hooks_freeze - End of subscribing (server_init())
+ *
+ * Logs how many handlers each event has.
+ */
+void hooks_freeze(void);
+
+/*
+ * hooks_reset - Empty and unfreeze every table (server_shutdown())
+ */
+void hooks_reset(void);
+
+#endif /* HOOKS_H */
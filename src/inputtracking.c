@@ -3,10 +3,18 @@
 
 InputTracking _InputTracking;
 
+// custom: both buffers live as long as the client; a full one is handed to
+// inputtracking_flush() while events go on into the other
 void inputtracking_set_enabled(InputTracking *it) {
-    it->outBuffer = packet_alloc(1);
+    if (!it->buffers[0]) {
+        it->buffers[0] = packet_alloc(1);
+        it->buffers[1] = packet_alloc(1);
+    }
+    it->outBuffer = it->buffers[0];
+    it->outBuffer->pos = 0;
     it->oldBuffer = NULL;
     it->lastTime = rs2_now();
+    it->movePending = false;
     it->enabled = true;
 }
 
@@ -15,7 +23,51 @@ void inputtracking_set_disabled(InputTracking *it) {
     it->outBuffer = NULL;
 }
 
+static void inputtracking_write_move(InputTracking *it, int x, int y, uint64_t now) {
+    it->trackedCount++;
+
+    uint64_t delta = (now - it->lastTime) / 10L;
+    if (delta > 250L) {
+        delta = 250L;
+    }
+
+    it->lastTime = now;
+    if (x - it->lastX < 8 && x - it->lastX >= -8 && y - it->lastY < 8 && y - it->lastY >= -8) {
+        inputtracking_ensure_capacity(it, 3);
+        p1(it->outBuffer, 5);
+        p1(it->outBuffer, (int)delta);
+        p1(it->outBuffer, x + ((y - it->lastY + 8) << 4) + 8 - it->lastX);
+    } else if (x - it->lastX < 128 && x - it->lastX >= -128 && y - it->lastY < 128 && y - it->lastY >= -128) {
+        inputtracking_ensure_capacity(it, 4);
+        p1(it->outBuffer, 6);
+        p1(it->outBuffer, (int)delta);
+        p1(it->outBuffer, x + 128 - it->lastX);
+        p1(it->outBuffer, y + 128 - it->lastY);
+    } else {
+        inputtracking_ensure_capacity(it, 5);
+        p1(it->outBuffer, 7);
+        p1(it->outBuffer, (int)delta);
+        p3(it->outBuffer, x + (y << 10));
+    }
+
+    it->lastX = x;
+    it->lastY = y;
+}
+
+// custom: the latest move held back by the 50ms limit goes out before the
+// next event (or at the next flush), so the journal ends where the mouse stopped
+static void inputtracking_write_pending(InputTracking *it) {
+    if (it->movePending) {
+        it->movePending = false;
+        it->lastMoveTime = it->pendingTime;
+        inputtracking_write_move(it, it->pendingX, it->pendingY, it->pendingTime);
+    }
+}
+
 Packet *inputtracking_flush(InputTracking *it) {
+    if (it->enabled && it->movePending && rs2_now() - it->lastMoveTime >= 50L) {
+        inputtracking_write_pending(it);
+    }
     Packet *buffer = NULL;
     if (it->oldBuffer && it->enabled) {
         buffer = it->oldBuffer;
@@ -25,6 +77,9 @@ Packet *inputtracking_flush(InputTracking *it) {
 }
 
 Packet *inputtracking_stop(InputTracking *it) {
+    if (it->enabled) {
+        inputtracking_write_pending(it);
+    }
     Packet *buffer = NULL;
     if (it->outBuffer && it->outBuffer->pos > 0 && it->enabled) {
         buffer = it->outBuffer;
@@ -36,13 +91,15 @@ Packet *inputtracking_stop(InputTracking *it) {
 void inputtracking_ensure_capacity(InputTracking *it, int n) {
     if (it->outBuffer->pos + n >= 500) {
         Packet *buffer = it->outBuffer;
-        it->outBuffer = packet_alloc(1);
+        it->outBuffer = buffer == it->buffers[0] ? it->buffers[1] : it->buffers[0];
+        it->outBuffer->pos = 0;
         it->oldBuffer = buffer;
     }
 }
 
 void inputtracking_mouse_pressed(InputTracking *it, int x, int y, int button) {
     if (it->enabled && (x >= 0 && x < 789 && y >= 0 && y < 532)) {
+        inputtracking_write_pending(it);
         it->trackedCount++;
 
         uint64_t now = rs2_now();
@@ -67,6 +124,7 @@ void inputtracking_mouse_pressed(InputTracking *it, int x, int y, int button) {
 
 void inputtracking_mouse_released(InputTracking *it, int button) {
     if (it->enabled) {
+        inputtracking_write_pending(it);
         it->trackedCount++;
 
         uint64_t now = rs2_now();
@@ -93,41 +151,22 @@ void inputtracking_mouse_moved(InputTracking *it, int x, int y) {
         uint64_t now = rs2_now();
 
         if (now - it->lastMoveTime >= 50L) {
+            // custom: this move supersedes one still held back
+            it->movePending = false;
             it->lastMoveTime = now;
-            it->trackedCount++;
-
-            uint64_t delta = (now - it->lastTime) / 10L;
-            if (delta > 250L) {
-                delta = 250L;
-            }
-
-            it->lastTime = now;
-            if (x - it->lastX < 8 && x - it->lastX >= -8 && y - it->lastY < 8 && y - it->lastY >= -8) {
-                inputtracking_ensure_capacity(it, 3);
-                p1(it->outBuffer, 5);
-                p1(it->outBuffer, (int)delta);
-                p1(it->outBuffer, x + ((y - it->lastY + 8) << 4) + 8 - it->lastX);
-            } else if (x - it->lastX < 128 && x - it->lastX >= -128 && y - it->lastY < 128 && y - it->lastY >= -128) {
-                inputtracking_ensure_capacity(it, 4);
-                p1(it->outBuffer, 6);
-                p1(it->outBuffer, (int)delta);
-                p1(it->outBuffer, x + 128 - it->lastX);
-                p1(it->outBuffer, y + 128 - it->lastY);
-            } else {
-                inputtracking_ensure_capacity(it, 5);
-                p1(it->outBuffer, 7);
-                p1(it->outBuffer, (int)delta);
-                p3(it->outBuffer, x + (y << 10));
-            }
-
-            it->lastX = x;
-            it->lastY = y;
+            inputtracking_write_move(it, x, y, now);
+        } else {
+            it->movePending = true;
+            it->pendingX = x;
+            it->pendingY = y;
+            it->pendingTime = now;
         }
     }
 }
 
 void inputtracking_key_pressed(InputTracking *it, int key) {
     if (it->enabled) {
+        inputtracking_write_pending(it);
         it->trackedCount++;
 
         uint64_t now = rs2_now();
@@ -158,6 +197,7 @@ void inputtracking_key_pressed(InputTracking *it, int key) {
 
 void inputtracking_key_released(InputTracking *it, int key) {
     if (it->enabled) {
+        inputtracking_write_pending(it);
         it->trackedCount++;
 
         uint64_t now = rs2_now();
@@ -188,6 +228,7 @@ void inputtracking_key_released(InputTracking *it, int key) {
 
 void inputtracking_focus_gained(InputTracking *it) {
     if (it->enabled) {
+        inputtracking_write_pending(it);
         it->trackedCount++;
 
         uint64_t now = rs2_now();
@@ -205,6 +246,7 @@ void inputtracking_focus_gained(InputTracking *it) {
 
 void inputtracking_focus_lost(InputTracking *it) {
     if (it->enabled) {
+        inputtracking_write_pending(it);
         it->trackedCount++;
 
         uint64_t now = rs2_now();
@@ -222,6 +264,7 @@ void inputtracking_focus_lost(InputTracking *it) {
 
 void inputtracking_mouse_entered(InputTracking *it) {
     if (it->enabled) {
+        inputtracking_write_pending(it);
         it->trackedCount++;
 
         uint64_t now = rs2_now();
@@ -239,6 +282,7 @@ void inputtracking_mouse_entered(InputTracking *it) {
 
 void inputtracking_mouse_exited(InputTracking *it) {
     if (it->enabled) {
+        inputtracking_write_pending(it);
         it->trackedCount++;
 
         uint64_t now = rs2_now();
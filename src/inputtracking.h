@@ -13,9 +13,17 @@ typedef struct {
     uint64_t lastMoveTime;
     int lastX;
     int lastY;
+    // custom: outBuffer and oldBuffer are these two, reused while tracking
+    Packet *buffers[2];
+    // custom: latest move inside the 50ms limit, written by the next event or flush
+    bool movePending;
+    int pendingX;
+    int pendingY;
+    uint64_t pendingTime;
 } InputTracking;
 
 // all these are static synchronized in java
+// custom: flush and stop return a buffer the tracker keeps, don't release it
 void inputtracking_set_enabled(InputTracking *it);
 void inputtracking_set_disabled(InputTracking *it);
 Packet *inputtracking_flush(InputTracking *it);
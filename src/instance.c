@@ -0,0 +1,188 @@
+/*******************************************************************************
+ * INSTANCE.C - Copy-on-Write Private Copies of a Mapsquare
+ *******************************************************************************
+ *
+ * See instance.h for the design.
+ *
+ * SLOT NUMBERS:
+ *   slot = column * INSTANCE_ROWS + row, and the slot's mapsquare is
+ *   (INSTANCE_REGION_X + column * 2, INSTANCE_REGION_Z + row * 2), so a
+ *   coordinate names its slot with two subtractions and a shift.
+ *
+ ******************************************************************************/
+
+#include "instance.h"
+#include "npc.h"
+#include "combat.h"
+#include "zone_update.h"
+#include "mem_stats.h"
+#include "log.h"
+#include <string.h>
+
+InstanceSystem* g_instances = NULL;
+
+InstanceSystem* instance_system_create(void) {
+    InstanceSystem* sys = mem_calloc(MEM_MAP, 1, sizeof(InstanceSystem));
+    if (!sys) return NULL;
+
+    for (u32 slot = 0; slot < INSTANCE_SLOTS; slot++) {
+        Instance* instance = &sys->slots[slot];
+        instance->region_x = (u8)(INSTANCE_REGION_X + (slot / INSTANCE_ROWS) * INSTANCE_STRIDE);
+        instance->region_z = (u8)(INSTANCE_REGION_Z + (slot % INSTANCE_ROWS) * INSTANCE_STRIDE);
+
+        /* Popped lowest first */
+        sys->free[slot] = (u16)(INSTANCE_SLOTS - 1 - slot);
+    }
+    sys->free_count = INSTANCE_SLOTS;
+    return sys;
+}
+
+void instance_system_destroy(InstanceSystem* sys) {
+    if (!sys) return;
+    for (u32 slot = 0; slot < INSTANCE_SLOTS; slot++) {
+        if (sys->slots[slot].active) instance_destroy(sys, &sys->slots[slot]);
+    }
+    mem_free(sys);
+}
+
+/*
+ * instance_slot - Slot of the mapsquare a region coordinate names
+ *
+ * @return  Slot, or INSTANCE_SLOTS if the region is not a slot's
+ */
+static u32 instance_slot(i32 region_x, i32 region_z) {
+    i32 column = region_x - INSTANCE_REGION_X;
+    i32 row = region_z - INSTANCE_REGION_Z;
+    if (column < 0 || row < 0 || (column | row) & (INSTANCE_STRIDE - 1)) return INSTANCE_SLOTS;
+    column /= INSTANCE_STRIDE;
+    row /= INSTANCE_STRIDE;
+    if (column >= INSTANCE_COLUMNS || row >= INSTANCE_ROWS) return INSTANCE_SLOTS;
+    return (u32)(column * INSTANCE_ROWS + row);
+}
+
+/*
+ * instance_copy_npcs - Spawn the base mapsquare's NPCs in the instance
+ *
+ * The NPC zone grid lists the 64 zones' NPCs; those spawned in the base
+ * mapsquare are spawned again at the same spot in the instance.
+ */
+static void instance_copy_npcs(Instance* instance) {
+    if (!g_npcs) return;
+
+    u16 filed[MAX_NPCS];
+    u32 count = zone_grid_query(g_npcs->zones, instance->base_x * 64u + 32, instance->base_z * 64u + 32,
+                                31, filed, MAX_NPCS);
+    u16 spawned[MAX_NPCS];
+    u32 spawned_count = 0;
+    for (u32 i = 0; i < count; i++) {
+        const Npc* npc = &g_npcs->npcs[filed[i]];
+        if (position_get_mapsquare_x(&npc->spawn_position) != instance->base_x ||
+            position_get_mapsquare_z(&npc->spawn_position) != instance->base_z) {
+            continue;
+        }
+        Position at;
+        instance_position(instance, &npc->spawn_position, &at);
+        Npc* copy = npc_spawn(g_npcs, npc->npc_id, position_x(&at), position_z(&at), position_height(&at));
+        if (copy) spawned[spawned_count++] = copy->index;
+    }
+
+    if (spawned_count == 0) return;
+    instance->npcs = mem_alloc(MEM_NPC, spawned_count * sizeof(u16));
+    if (!instance->npcs) {
+        /* Not tracked means never despawned: take them away now */
+        for (u32 i = 0; i < spawned_count; i++) npc_despawn(g_npcs, &g_npcs->npcs[spawned[i]]);
+        return;
+    }
+    memcpy(instance->npcs, spawned, spawned_count * sizeof(u16));
+    instance->npc_count = (u16)spawned_count;
+}
+
+Instance* instance_create(InstanceSystem* sys, u32 base_x, u32 base_z) {
+    if (!sys || !g_world_collision || sys->free_count == 0) return NULL;
+    if (base_x >= WORLD_REGIONS_PER_AXIS || base_z >= WORLD_REGIONS_PER_AXIS) return NULL;
+    if (!world_collision_mapped(g_world_collision, 0, (i32)(base_x * 64), (i32)(base_z * 64))) {
+        return NULL;
+    }
+    if (instance_slot((i32)base_x, (i32)base_z) != INSTANCE_SLOTS) return NULL;
+
+    Instance* instance = &sys->slots[sys->free[sys->free_count - 1]];
+    if (!world_collision_share_region(g_world_collision, instance->region_x, instance->region_z,
+                                      base_x, base_z)) {
+        return NULL;
+    }
+    sys->free_count--;
+    sys->active_count++;
+
+    instance->active = true;
+    instance->base_x = (u8)base_x;
+    instance->base_z = (u8)base_z;
+    instance->generation++;
+    instance_copy_npcs(instance);
+
+    LOG_DEBUG("Instance of mapsquare (%u, %u) at (%u, %u), %u NPCs\n",
+              base_x, base_z, instance->region_x, instance->region_z, instance->npc_count);
+    return instance;
+}
+
+void instance_destroy(InstanceSystem* sys, Instance* instance) {
+    if (!sys || !instance || !instance->active) return;
+
+    for (u32 i = 0; i < instance->npc_count && g_npcs; i++) {
+        Npc* npc = &g_npcs->npcs[instance->npcs[i]];
+        combat_remove(g_combat, COMBAT_NPC(npc->index));
+        npc_despawn(g_npcs, npc);
+    }
+    mem_free(instance->npcs);
+    instance->npcs = NULL;
+    instance->npc_count = 0;
+
+    world_collision_release_region(g_world_collision, instance->region_x, instance->region_z);
+    zone_update_loc_forget(g_zone_updates, instance->region_x, instance->region_z);
+
+    instance->active = false;
+    sys->free[sys->free_count++] = (u16)(instance - sys->slots);
+    sys->active_count--;
+}
+
+Instance* instance_at(InstanceSystem* sys, u32 x, u32 z) {
+    if (!sys) return NULL;
+    u32 slot = instance_slot((i32)(x >> 6), (i32)(z >> 6));
+    if (slot == INSTANCE_SLOTS || !sys->slots[slot].active) return NULL;
+    return &sys->slots[slot];
+}
+
+void instance_position(const Instance* instance, const Position* base, Position* out) {
+    position_init(out, position_x(base) - instance->base_x * 64u + instance->region_x * 64u,
+                  position_z(base) - instance->base_z * 64u + instance->region_z * 64u,
+                  position_height(base));
+}
+
+void instance_base_position(const Instance* instance, const Position* position, Position* out) {
+    position_init(out, position_x(position) - instance->region_x * 64u + instance->base_x * 64u,
+                  position_z(position) - instance->region_z * 64u + instance->base_z * 64u,
+                  position_height(position));
+}
+
+bool instance_map_source(const InstanceSystem* sys, i32* file_x, i32* file_z) {
+    if (!sys || sys->active_count == 0) return false;
+    u32 slot = instance_slot(*file_x, *file_z);
+    if (slot == INSTANCE_SLOTS || !sys->slots[slot].active) return false;
+    *file_x = sys->slots[slot].base_x;
+    *file_z = sys->slots[slot].base_z;
+    return true;
+}
+
+void instance_system_rebind(InstanceSystem* sys, WorldCollision* collision,
+                            const WorldCollision* before) {
+    if (!sys || !collision) return;
+    for (u32 slot = 0; slot < INSTANCE_SLOTS && sys->active_count > 0; slot++) {
+        const Instance* instance = &sys->slots[slot];
+        if (!instance->active) continue;
+        if (!world_collision_share_region(collision, instance->region_x, instance->region_z,
+                                          instance->base_x, instance->base_z) ||
+            !world_collision_keep_private(collision, before, instance->region_x, instance->region_z)) {
+            LOG_WARN("Instance at (%u, %u) lost its collision changes in the reload\n",
+                     instance->region_x, instance->region_z);
+        }
+    }
+}
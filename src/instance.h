@@ -0,0 +1,179 @@
+/*******************************************************************************
+ * INSTANCE.H - Copy-on-Write Private Copies of a Mapsquare
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Copy-on-write: share everything, copy only what gets changed
+ *   - Address translation: one more level of indirection in front of
+ *     tables that already exist (page index, map file lookup)
+ *   - Relocation: the same data shown at a different address
+ *   - Slot allocation from a free stack, no search
+ *
+ * THE PROBLEM:
+ *
+ * A minigame or boss room wants its own copy of a mapsquare: players in
+ * one copy must not see, block or fight those in another, and what one
+ * group opens or knocks down stays in its copy. Deep-copying the area
+ * means its collision (4 levels x 8KB), its map files, its NPC spawns;
+ * hundreds of groups would hold hundreds of identical copies, and every
+ * start would copy them again.
+ *
+ * THE SOLUTION - A SLOT OF EMPTY MAP, POINTED AT THE ORIGINAL:
+ *
+ * Coordinates past the real map (regions x >= INSTANCE_REGION_X, where
+ * no map file exists) are cut into instance slots, one mapsquare each
+ * with an empty mapsquare between neighbours so no client's 104x104
+ * scene reaches a second instance:
+ *
+ *       base Lumbridge (50, 50)           instance slot (96, 2)
+ *   ┌─────────────────────────┐      ┌─────────────────────────┐
+ *   │ collision pages         │ ←─── │ page_index: same pages  │  8 bytes
+ *   │ m50_50 / l50_50         │ ←─── │ file lookups redirected │  0 bytes
+ *   │ NPC spawns              │ ───→ │ copies, relocated       │  per NPC
+ *   └─────────────────────────┘      └─────────────────────────┘
+ *
+ *   collision   world_collision_share_region() copies the four page
+ *               index entries; the first world_collision_modify() inside
+ *               the instance gives that level a private 8KB page
+ *               (world_collision.h, PRIVATE PAGES)
+ *   map files   map.c asks instance_map_source() before every map store
+ *               lookup, so LOAD_AREA lists the base files' CRCs under the
+ *               instance's file coordinates and the file requests are
+ *               answered with the base files, renamed on the wire
+ *   locs        changes are zone_update_loc_add/del() at the instance's
+ *               coordinates: stored per zone as changes only, like any
+ *               other changed loc
+ *   NPCs        the base region's spawns are spawned again, moved by the
+ *               slot's offset
+ *
+ * The client sees nothing special: a teleport to the instance's
+ * coordinates and the usual map_send_load_area(). Creating an instance
+ * writes four page index entries and spawns its NPCs; an unchanged one
+ * holds no tiles and no map data of its own.
+ *
+ * COORDINATES:
+ *
+ *   instance tile = base tile - base region * 64 + slot region * 64
+ *
+ * instance_position() and instance_base_position() convert; everything
+ * else (movement, pathfinding, the zone grids, updates) just sees
+ * ordinary coordinates that happen to lie far east of the map.
+ *
+ * LIFETIME:
+ *   instance_destroy() despawns the NPCs, releases the private pages and
+ *   drops the loc changes, then frees the slot for reuse. Players still
+ *   inside must be moved out first (their client would keep the old
+ *   scene; the server would see blocked tiles). Ground items dropped
+ *   inside are the caller's to clear, as are objects spawned with
+ *   object_spawn(): neither is copied from the base world either.
+ *
+ * COMPLEXITY:
+ *   - create:   O(levels + NPC spawns in the base region)
+ *   - destroy:  O(levels + its NPCs + 256 zone lookups)
+ *   - lookups:  O(1) (slot from coordinates)
+ *   - memory:   ~26 bytes per slot, 8KB per modified level, 2 bytes per
+ *               copied NPC
+ *
+ * THREADS:
+ *   Game thread only, outside the parallel phases (see world_collision.h).
+ *
+ ******************************************************************************/
+
+#ifndef INSTANCE_H
+#define INSTANCE_H
+
+#include "types.h"
+#include "position.h"
+#include "world_collision.h"
+#include <stdbool.h>
+
+/* First region column of the instance slots: the 225 map ends near 60 */
+#define INSTANCE_REGION_X 96
+#define INSTANCE_REGION_Z 2
+
+/* Slots are every other region in both directions */
+#define INSTANCE_STRIDE  2
+#define INSTANCE_COLUMNS 64     /* Regions 96, 98 .. 222 */
+#define INSTANCE_ROWS    126    /* Regions 2, 4 .. 252 */
+#define INSTANCE_SLOTS   (INSTANCE_COLUMNS * INSTANCE_ROWS)
+
+/*
+ * Instance - One slot (active or free)
+ */
+typedef struct {
+    bool active;
+    u8 base_x, base_z;          /* Mapsquare it is a copy of */
+    u8 region_x, region_z;      /* Mapsquare it occupies (fixed per slot) */
+    u16 npc_count;
+    u16* npcs;                  /* NPC indices spawned for it */
+    u32 generation;             /* Bumped each time the slot is reused */
+} Instance;
+
+/*
+ * InstanceSystem - Every slot, and a stack of the free ones
+ */
+typedef struct {
+    Instance slots[INSTANCE_SLOTS];
+    u16 free[INSTANCE_SLOTS];
+    u32 free_count;
+    u32 active_count;
+} InstanceSystem;
+
+extern InstanceSystem* g_instances;
+
+InstanceSystem* instance_system_create(void);
+
+/* Destroys every active instance first (g_world_collision, g_npcs and
+ * g_zone_updates must still exist) */
+void instance_system_destroy(InstanceSystem* sys);
+
+/*
+ * instance_create - A new private copy of a mapsquare
+ *
+ * @param base_x, base_z  Mapsquare (x >> 6, z >> 6) to copy
+ * @return                Instance, or NULL if the mapsquare has no map,
+ *                        is itself an instance, or every slot is taken
+ */
+Instance* instance_create(InstanceSystem* sys, u32 base_x, u32 base_z);
+
+/*
+ * instance_destroy - Despawn, release and free the slot
+ */
+void instance_destroy(InstanceSystem* sys, Instance* instance);
+
+/*
+ * instance_at - The active instance containing a tile, or NULL
+ */
+Instance* instance_at(InstanceSystem* sys, u32 x, u32 z);
+
+/*
+ * instance_position / instance_base_position - Translate a tile
+ *
+ * Base tile (inside the copied mapsquare) to the instance's tile, and
+ * back. The height is kept.
+ */
+void instance_position(const Instance* instance, const Position* base, Position* out);
+void instance_base_position(const Instance* instance, const Position* position, Position* out);
+
+/*
+ * instance_map_source - Redirect a map file lookup
+ *
+ * @param file_x, file_z  Map file coordinates; replaced by the base
+ *                        mapsquare's if they name an active instance
+ * @return                true if they were replaced
+ *
+ * NULL-safe (no instances: nothing is replaced).
+ */
+bool instance_map_source(const InstanceSystem* sys, i32* file_x, i32* file_z);
+
+/*
+ * instance_system_rebind - Re-share every instance in a rebuilt collision
+ *
+ * @param collision  New collision (after a map reload)
+ * @param before     Collision being replaced; its private pages are kept
+ */
+void instance_system_rebind(InstanceSystem* sys, WorldCollision* collision,
+                            const WorldCollision* before);
+
+#endif /* INSTANCE_H */
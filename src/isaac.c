@@ -843,12 +843,13 @@ void isaac_next(ISAACCipher* cipher) {
 }
 
 /*
- * isaac_get_next - Get next random 32-bit value
+ * isaac_keys - Take the next n keys at once
  * 
- * @param cipher  Pointer to initialized ISAAC cipher
- * @return        Pseudorandom 32-bit value (uniformly distributed)
+ * isaac_get_next() itself is inline in isaac.h; this is its batch form
+ * and consumes rsl[] in exactly the same order, so either may be used
+ * on one cipher and the client never sees a difference.
  * 
- * ALGORITHM:
+ * ALGORITHM (isaac_get_next, once per key):
  *   1. Check if count == 0 (no values left in current batch)
  *   2. If so, call isaac_next() to generate new batch
  *   3. Decrement count (moves to next value)
@@ -936,15 +937,35 @@ void isaac_next(ISAACCipher* cipher) {
  *     AES-CTR:      200 million values/sec (slower but more secure)
  *     RC4:          400 million values/sec (broken, don't use)
  * 
- * COMPLEXITY: O(1) amortized time
+ * BATCH:
+ *   isaac_keys() copies min(n, count) keys out of rsl[] in one loop
+ *   (backwards, matching the consumption order), then refills and
+ *   repeats until n keys are taken.
+ * 
+ * WHY THE SHUFFLE IS NOT VECTORIZED:
+ *   Each rngstep reads mem[] at an index taken from a value written one
+ *   or two steps earlier (ind(mm, x), ind(mm, y >> 8)), and a and b carry
+ *   from step to step. Lanes cannot run ahead of each other without
+ *   changing the keystream the client expects, so the 256 steps stay a
+ *   serial, unrolled chain; the savings are in how keys are handed out.
+ * 
+ * COMPLEXITY: O(1) amortized per key
  */
-u32 isaac_get_next(ISAACCipher* cipher) {
-    /* Check if we need to generate new batch */
-    if (cipher->count == 0) {
-        isaac_next(cipher);          /* Generate 256 new values */
-        cipher->count = ISAAC_SIZE;   /* Reset counter to 256 */
+void isaac_keys(ISAACCipher* cipher, u32* keys, u32 n) {
+    while (n > 0) {
+        if (cipher->count == 0) {
+            isaac_next(cipher);
+            cipher->count = ISAAC_SIZE;
+        }
+        
+        /* Take what is left of this batch, newest index first */
+        u32 run = n < cipher->count ? n : cipher->count;
+        const u32* src = cipher->rsl + cipher->count;
+        for (u32 i = 0; i < run; i++) {
+            keys[i] = *--src;
+        }
+        cipher->count -= run;
+        keys += run;
+        n -= run;
     }
-    
-    /* Return next value (consuming from high to low indices) */
-    return cipher->rsl[--cipher->count];
 }
@@ -330,9 +330,42 @@ void isaac_next(ISAACCipher* cipher);
  *   - Worst case O(1) time (when triggering shuffle)
  *   - Approximately 4 CPU cycles per value on modern x86-64
  * 
+ * INLINE:
+ *   Every packet header in and out takes one key, so the common case (a
+ *   key left in rsl[]) is defined here: a compare, a decrement and a load
+ *   in the caller, no call. Only the refill every 256th key goes out of
+ *   line to isaac_next().
+ * 
  * COMPLEXITY: O(1) amortized (shuffle every 256th call)
  */
-u32 isaac_get_next(ISAACCipher* cipher);
+static inline u32 isaac_get_next(ISAACCipher* cipher) {
+    if (cipher->count == 0) {
+        isaac_next(cipher);             /* Generate 256 new values */
+        cipher->count = ISAAC_SIZE;
+    }
+    return cipher->rsl[--cipher->count];
+}
+
+/*
+ * isaac_keys - Take the next n keys at once
+ * 
+ * @param cipher  Pointer to initialized ISAAC cipher
+ * @param keys    Receives n keys, in the order isaac_get_next() would
+ *                have returned them
+ * @param n       Keys wanted (any number; refills as needed)
+ * 
+ * For a run of packets whose headers are all known up front (a map file
+ * sent as chunks, a batch of queued packets): one call and one
+ * straight copy out of rsl[] per 256 keys, instead of a count check
+ * per key.
+ * 
+ *   rsl[]:  [ ...  R3  R4  R5  R6 ]      count = 7
+ *                          ◄───────
+ *   isaac_keys(c, k, 3) → k = { R6, R5, R4 }, count = 4
+ * 
+ * COMPLEXITY: O(n)
+ */
+void isaac_keys(ISAACCipher* cipher, u32* keys, u32 n);
 
 /*******************************************************************************
  * SECURITY CONSIDERATIONS
@@ -42,8 +42,8 @@
  * ┌──────────────────────────────────────────────────────────────┐
  * │                    GLOBAL ITEM SYSTEM                        │
  * │  g_items -> ItemSystem                                       │
- * │    ├─> definitions: ItemDefinition[10000] (2.5 MB)           │
- * │    ├─> definition_count: 10000                               │
+ * │    ├─> definitions: ItemDefinition[n] (in g_defs, read-only) │
+ * │    ├─> text: DefText[n] (offsets into the string pool)       │
  * │    └─> initialized: true                                     │
  * └──────────────────────────────────────────────────────────────┘
  *                           │
@@ -61,6 +61,7 @@
  ******************************************************************************/
 
 #include "item.h"
+#include "mem_stats.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -157,42 +158,11 @@ ItemSystem* item_system_create() {
  *   2. Free definitions array (if allocated)
  *   3. Free ItemSystem struct itself
  * 
- * MEMORY DEALLOCATION ORDER:
+ * OWNERSHIP:
  * 
- * Important: Always free inner allocations before outer structure!
- * 
- * Correct order:
- *   1. free(items->definitions)  // Free array first
- *   2. free(items)               // Then free struct
- * 
- * Wrong order would cause memory leak:
- *   1. free(items)               // Struct gone, can't access ->definitions
- *   2. free(items->definitions)  // ERROR: items is already freed!
- * 
- * VISUAL REPRESENTATION:
- * 
- * Before destruction:
- * ┌────────────┐
- * │  items  ───┼──> ┌──────────────────┐
- * └────────────┘    │  ItemSystem      │
- *                   │  definitions  ───┼──> [array of 10000 ItemDefinitions]
- *                   │  count: 10000    │
- *                   │  initialized: T  │
- *                   └──────────────────┘
- * 
- * After free(items->definitions):
- * ┌────────────┐
- * │  items  ───┼──> ┌──────────────────┐
- * └────────────┘    │  ItemSystem      │
- *                   │  definitions  ───┼──> [FREED]
- *                   │  count: 10000    │
- *                   │  initialized: T  │
- *                   └──────────────────┘
- * 
- * After free(items):
- * ┌────────────┐
- * │  items  ───┼──> [FREED]
- * └────────────┘
+ * definitions and text point into g_defs: either tables decoded this
+ * boot or the world snapshot. They are read-only here and released
+ * by def_store_destroy(), so only the ItemSystem struct is freed.
  * 
  * NULL SAFETY:
  * 
@@ -218,12 +188,10 @@ ItemSystem* item_system_create() {
 void item_system_destroy(ItemSystem* items) {
     if (!items) return;  /* NULL-safe early exit */
     
-    /* Free definitions array if it was allocated */
-    if (items->definitions) {
-        free(items->definitions);
-    }
-    
-    /* Free the ItemSystem struct itself */
+    /*
+     * The definition and text tables belong to g_defs (decoded tables or
+     * the mapped snapshot) and are released by def_store_destroy().
+     */
     free(items);
 }
 
@@ -234,183 +202,168 @@ void item_system_destroy(ItemSystem* items) {
  * @return       true on success, false on failure
  * 
  * ALGORITHM:
- *   1. Validate input (items != NULL, not already initialized)
- *   2. Allocate definitions array
- *   3. Load item definitions from cache files (TODO)
- *   4. Mark system as initialized
- *   5. Return success status
- * 
- * CURRENT IMPLEMENTATION:
- * 
- * This is a placeholder implementation. It allocates memory and sets up
- * one example item (coins, ID 995) to demonstrate the system works.
- * 
- * TODO: Replace with actual cache loader that reads from RS2 cache files.
- * 
- * CACHE FILE FORMAT (RS2):
- * 
- * RS2 stores item definitions in cache files:
- *   - cache/item_definitions.dat2 (binary data)
- *   - cache/item_definitions.idx (index/offset table)
- * 
- * Binary format (TLV - Type-Length-Value encoding):
- *   Each definition is a series of TLV entries:
- *   
- *   [opcode:u8][payload]
- *   
- *   Common opcodes:
- *     1  = model ID
- *     2  = name (string)
- *     3  = examine text (string)
- *     4  = zoom
- *     5  = rotation X
- *     6  = rotation Y
- *     7  = offset X
- *     11 = stackable (boolean)
- *     12 = value (i32)
- *     16 = members (boolean)
- *     23 = equipment slot
- *     ...
- *     0  = end of definition
- * 
- * FUTURE IMPLEMENTATION SKETCH:
- * 
- *   FILE* dat = fopen("cache/item_definitions.dat2", "rb");
- *   FILE* idx = fopen("cache/item_definitions.idx", "rb");
- *   
- *   for (int id = 0; id < MAX_ITEMS; id++) {
- *       // Read offset from index file
- *       u32 offset = read_u32(idx);
- *       if (offset == 0) continue;  // Item doesn't exist
- *       
- *       // Seek to definition in data file
- *       fseek(dat, offset, SEEK_SET);
- *       
- *       // Parse TLV entries
- *       while (true) {
- *           u8 opcode = read_u8(dat);
- *           if (opcode == 0) break;  // End of definition
- *           
- *           switch (opcode) {
- *               case 2:  // Name
- *                   read_string(dat, definitions[id].name);
- *                   break;
- *               case 3:  // Examine
- *                   read_string(dat, definitions[id].examine);
- *                   break;
- *               case 11:  // Stackable
- *                   definitions[id].stackable = true;
- *                   break;
- *               // ... handle other opcodes ...
- *           }
- *       }
- *   }
- * 
- * ALLOCATION SIZE CALCULATION:
- * 
- * definition_count = 10,000
- * sizeof(ItemDefinition) = 256 bytes (approximately, with padding)
- * Total allocation = 10,000 * 256 = 2,560,000 bytes (2.5 MB)
- * 
- * Is this too much?
- *   - Modern servers: No, 2.5 MB is trivial
- *   - Embedded systems: Maybe, could use on-demand loading
- *   - Trade-off: Memory for speed (O(1) lookup)
+ *   1. Validate input (items != NULL, not already initialized, g_defs)
+ *   2. Snapshot current: point at its item tables and stop
+ *   3. Decode obj.idx / obj.dat from the config archive
+ *   4. Resolve notes against the items they note
+ *   5. Mark system as initialized
  * 
- * IDEMPOTENCE:
+ * CONFIG FORMAT (obj.dat):
  * 
- * This function is idempotent - calling it multiple times is safe.
- * If already initialized, it returns false without modifying anything.
+ * obj.idx holds a u16 count then a u16 length per item; obj.dat holds
+ * the definitions back to back. Each is a list of opcodes ending in 0:
  * 
- * Example:
- *   item_system_init(sys);  // Returns true
- *   item_system_init(sys);  // Returns false (already initialized)
- * 
- * ERROR HANDLING:
+ *   [opcode:u8][payload] ... [0]
  * 
- * Failure modes:
- *   1. items is NULL -> return false
- *   2. Already initialized -> return false
- *   3. Allocation fails -> return false
+ *     1  = model (g2)               2  = name (string)
+ *     3  = examine (string)         11 = stackable (no payload)
+ *     12 = cost (g4)                16 = members (no payload)
+ *     23 = male wield model (g2, g1)
+ *     30-39 = ground / inventory options (string)
+ *     97 = note link (g2)           98 = note template (g2)
  * 
- * On failure, the system remains in a consistent state:
- *   - initialized flag stays false
- *   - definitions pointer stays NULL
- *   - Safe to retry initialization
+ * Fields the server does not use (zoom, rotation, recolours, count
+ * variants) are skipped. Strings go straight into the pool; repeated ones
+ * ("Drop", "Wield", most note examines' prefixes) cost nothing extra.
  * 
- * EXAMPLE ITEM SETUP (COINS):
+ * NOTES:
  * 
- * We initialize item ID 995 (coins) as a demonstration:
+ * A note definition only says "I am item 98's template, noting item N".
+ * Like the client, we copy the name, members and value from item N, make
+ * it stackable, and link N back to it through note_id.
  * 
- *   ID: 995
- *   Name: "Coins"
- *   Examine: "Lovely money!"
- *   Stackable: true (multiple coins share one slot)
- *   Tradeable: true (can be traded)
- *   Value: 1 (1 coin = 1 gp)
+ * NO CACHE:
  * 
- * This is the most commonly used item in RS2, so it's a good test case.
+ * Without a config archive the system holds one item (coins, 995), so
+ * containers and ground items still work in a bare checkout.
  * 
- * COMPLEXITY: O(n) where n = definition_count (due to calloc zeroing)
+ * COMPLEXITY: O(size of obj.dat); O(1) when mapped from the snapshot
  */
 bool item_system_init(ItemSystem* items) {
-    if (!items || items->initialized) return false;
+    if (!items || items->initialized || !g_defs) return false;
     
-    /* 
-     * Allocate space for 10,000 item definitions.
-     * This covers all RS2 2007 items plus room for future additions.
-     * 
-     * calloc() zero-initializes all memory, so:
-     *   - All item IDs start at 0
-     *   - All names are empty strings
-     *   - All boolean flags are false
-     *   - All numeric fields are 0
-     */
-    items->definition_count = 10000;
-    items->definitions = calloc(items->definition_count, sizeof(ItemDefinition));
+    /* Fast path: tables straight out of the snapshot */
+    u32 count = 0, text_count = 0;
+    const ItemDefinition* mapped = def_store_section(g_defs, DEF_SECTION_ITEMS,
+                                                     sizeof(ItemDefinition), &count);
+    const DefText* mapped_text = def_store_section(g_defs, DEF_SECTION_ITEM_TEXT,
+                                                   sizeof(DefText), &text_count);
+    if (mapped && mapped_text && text_count == count) {
+        items->definitions = mapped;
+        items->text = mapped_text;
+        items->definition_count = count;
+        items->initialized = true;
+        printf("Initialized item system with %u definitions (mapped)\n", count);
+        return true;
+    }
     
-    if (!items->definitions) {
-        /* Allocation failed (out of memory) */
-        return false;
+    ConfigTable table;
+    if (!config_table_open(&table, g_cache, "obj")) {
+        /*
+         * No config archive: a single hand-written item (coins) so the
+         * containers and ground items still have something to work with.
+         */
+        ItemDefinition* defs = def_store_table(g_defs, DEF_SECTION_ITEMS,
+                                               sizeof(ItemDefinition), 996);
+        DefText* text = def_store_table(g_defs, DEF_SECTION_ITEM_TEXT,
+                                        sizeof(DefText), 996);
+        if (!defs || !text) return false;
+        
+        ItemDefinition* coins = &defs[995];
+        coins->id = 995;
+        coins->stackable = true;   /* Multiple coins stack in one slot */
+        coins->tradeable = true;   /* Can be traded between players */
+        coins->value = 1;          /* 1 coin = 1 gold piece */
+        text[995].name = def_store_intern(g_defs, "Coins", 5);
+        text[995].examine = def_store_intern(g_defs, "Lovely money!", 13);
+        
+        items->definitions = defs;
+        items->text = text;
+        items->definition_count = 996;
+        items->initialized = true;
+        printf("Initialized item system with %u definitions (no cache)\n", 996u);
+        return true;
     }
     
-    /*
-     * TODO: Load actual item definitions from cache files
-     * 
-     * For now, manually initialize one item (coins) as proof-of-concept.
-     * This demonstrates the system works without requiring cache files.
-     */
+    ItemDefinition* defs = def_store_table(g_defs, DEF_SECTION_ITEMS,
+                                           sizeof(ItemDefinition), table.count);
+    DefText* text = def_store_table(g_defs, DEF_SECTION_ITEM_TEXT,
+                                    sizeof(DefText), table.count);
+    u16* cert_link = calloc(table.count, sizeof(u16));
+    u16* cert_template = calloc(table.count, sizeof(u16));
+    if (!defs || !text || !cert_link || !cert_template) {
+        free(cert_link);
+        free(cert_template);
+        return false;
+    }
     
-    /* 
-     * Initialize item ID 995: Coins
-     * 
-     * Direct array access is safe because we just allocated 10,000 slots.
-     * 995 < 10000, so this is in bounds.
-     */
-    ItemDefinition* coins = &items->definitions[995];
-    coins->id = 995;
+    ConfigReader r;
+    for (u32 id = 0; config_table_next(&table, &r); id++) {
+        ItemDefinition* def = &defs[id];
+        def->id = (u16)id;
+        def->tradeable = true;
+        
+        for (;;) {
+            u32 op = config_g1(&r);
+            if (op == 0 || r.overrun) break;
+            
+            if (op == 1) def->sprite_id = (u16)config_g2(&r);
+            else if (op == 2) text[id].name = config_string(&r, g_defs);
+            else if (op == 3) text[id].examine = config_string(&r, g_defs);
+            else if (op == 9) { /* no payload */ }
+            else if (op == 11) def->stackable = true;
+            else if (op == 12) def->value = (i32)config_g4(&r);
+            else if (op == 16) def->members = true;
+            else if (op == 23 || op == 25) {
+                u32 model = config_g2(&r);
+                config_skip(&r, 1);
+                if (op == 23) def->equip_model = (u16)model;
+            }
+            else if (op >= 30 && op <= 39) config_string(&r, g_defs);
+            else if (op == 40) config_skip(&r, config_g1(&r) * 4);
+            else if (op == 97) cert_link[id] = (u16)config_g2(&r);
+            else if (op == 98) cert_template[id] = (u16)config_g2(&r);
+            else if (op >= 100 && op <= 109) config_skip(&r, 4);
+            else if ((op >= 4 && op <= 8) || op == 10 || op == 24 || op == 26 ||
+                     op == 78 || op == 79 || (op >= 90 && op <= 93) || op == 95) {
+                config_skip(&r, 2);
+            }
+            else break;     /* Unknown opcode: the rest is unreadable */
+        }
+    }
     
-    /* 
-     * String copy with strcpy
-     * 
-     * Safe because:
-     *   - Source strings are literals (always null-terminated)
-     *   - Destination buffers are large enough:
-     *     - name[64] can hold "Coins" (5 + 1 null byte)
-     *     - examine[128] can hold "Lovely money!" (13 + 1 null byte)
+    /*
+     * Notes ("certs") carry only their template and the item they note;
+     * the client fills in the rest from the linked item, so do we.
      */
-    strcpy(coins->name, "Coins");
-    strcpy(coins->examine, "Lovely money!");
-    
-    /* Set item properties */
-    coins->stackable = true;   /* Multiple coins stack in one slot */
-    coins->tradeable = true;   /* Can be traded between players */
-    coins->value = 1;          /* 1 coin = 1 gold piece */
-    
-    printf("Initialized item system with %u definitions\n", items->definition_count);
+    for (u32 id = 0; id < table.count; id++) {
+        u16 link = cert_link[id];
+        if (!cert_template[id] || link >= table.count) continue;
+        
+        const char* name = def_store_string(g_defs, text[link].name);
+        char examine[160];
+        int len = snprintf(examine, sizeof(examine),
+                           "Swap this note at any bank for %s %s.",
+                           strchr("AEIOU", name[0]) && name[0] ? "an" : "a", name);
+        if (len < 0) len = 0;
+        if ((size_t)len >= sizeof(examine)) len = sizeof(examine) - 1;
+        
+        text[id].name = text[link].name;
+        text[id].examine = def_store_intern(g_defs, examine, (u32)len);
+        defs[id].members = defs[link].members;
+        defs[id].value = defs[link].value;
+        defs[id].stackable = true;
+        defs[link].noteable = true;
+        defs[link].note_id = (u16)id;
+    }
+    free(cert_link);
+    free(cert_template);
     
-    /* Mark system as initialized (enables other functions) */
+    items->definitions = defs;
+    items->text = text;
+    items->definition_count = table.count;
     items->initialized = true;
+    printf("Initialized item system with %u definitions\n", table.count);
     return true;
 }
 
@@ -505,9 +458,9 @@ bool item_system_init(ItemSystem* items) {
  *   - Lifetime: Pointer valid until item_system_destroy() called
  * 
  * Example usage:
- *   ItemDefinition* def = item_get_definition(g_items, 995);
+ *   const ItemDefinition* def = item_get_definition(g_items, 995);
  *   if (def) {
- *       printf("Item: %s\n", def->name);
+ *       printf("Item: %s\n", item_get_name(g_items, 995));
  *       if (def->stackable) {
  *           printf("This item can stack!\n");
  *       }
@@ -518,9 +471,9 @@ bool item_system_init(ItemSystem* items) {
  * NULL CHECKS:
  * 
  * Always check return value before dereferencing:
- *   ItemDefinition* def = item_get_definition(g_items, id);
+ *   const ItemDefinition* def = item_get_definition(g_items, id);
  *   if (!def) return;  // Item doesn't exist
- *   printf("%s\n", def->name);  // Safe to use
+ *   if (def->stackable) ...  // Safe to use
  * 
  * THREAD SAFETY:
  * 
@@ -535,7 +488,7 @@ bool item_system_init(ItemSystem* items) {
  * 
  * COMPLEXITY: O(1) time, O(1) space
  */
-ItemDefinition* item_get_definition(ItemSystem* items, u16 id) {
+const ItemDefinition* item_get_definition(ItemSystem* items, u16 id) {
     /* 
      * Input validation
      * 
@@ -559,6 +512,164 @@ ItemDefinition* item_get_definition(ItemSystem* items, u16 id) {
     return &items->definitions[id];
 }
 
+const char* item_get_name(ItemSystem* items, u16 id) {
+    if (!items || !items->initialized || id >= items->definition_count) return "";
+    return def_store_string(g_defs, items->text[id].name);
+}
+
+const char* item_get_examine(ItemSystem* items, u16 id) {
+    if (!items || !items->initialized || id >= items->definition_count) return "";
+    return def_store_string(g_defs, items->text[id].examine);
+}
+
+/*******************************************************************************
+ * ITEM CONTAINER SLOT INDEX
+ *******************************************************************************
+ * 
+ * Every change to a slot goes through container_set_slot(), which keeps
+ * used, the index, the free-slot bitmap and the dirty set in step.
+ * 
+ * The index is an open-addressed table of slots, keyed by the id in the
+ * slot it names (at most half full: 2x capacity entries, rounded up to a
+ * power of two). Removal is by slot, with the backward-shift deletion the
+ * object position table uses (see object.c), so no tombstones build up
+ * in a bank that is deposited into and withdrawn from all day.
+ ******************************************************************************/
+
+static inline u32 container_hash(u16 id) {
+    u32 h = (u32)id * 0x9E3779B1u;  /* Fibonacci hashing */
+    return h ^ (h >> 16);
+}
+
+/* Does id stack in this container (one slot for any amount)? */
+static bool container_stacks(const ItemContainer* container, u16 id) {
+    if (container->flags & ITEM_CONTAINER_ALWAYS_STACK) return true;
+    const ItemDefinition* def = item_get_definition(g_items, id);
+    return def && def->stackable;
+}
+
+static u32 container_index_lookup(const ItemContainer* container, u16 id) {
+    u32 i = container_hash(id) & container->index_mask;
+    while (container->index[i] != ITEM_SLOT_NONE) {
+        u32 slot = container->index[i];
+        if (container->items[slot].id == id) return slot;
+        i = (i + 1) & container->index_mask;
+    }
+    return ITEM_SLOT_NONE;
+}
+
+static void container_index_insert(ItemContainer* container, u32 slot) {
+    u32 i = container_hash(container->items[slot].id) & container->index_mask;
+    while (container->index[i] != ITEM_SLOT_NONE) {
+        i = (i + 1) & container->index_mask;
+    }
+    container->index[i] = slot;
+}
+
+/* Remove slot's entry; call while items[slot] still holds the indexed id */
+static void container_index_remove(ItemContainer* container, u32 slot) {
+    u32 mask = container->index_mask;
+    u32 i = container_hash(container->items[slot].id) & mask;
+    while (container->index[i] != ITEM_SLOT_NONE && container->index[i] != slot) {
+        i = (i + 1) & mask;
+    }
+    if (container->index[i] == ITEM_SLOT_NONE) return;  /* Not a stack */
+    
+    /* Backward shift: pull later entries of the run into the hole */
+    u32 j = i;
+    for (;;) {
+        j = (j + 1) & mask;
+        u32 entry = container->index[j];
+        if (entry == ITEM_SLOT_NONE) break;
+        
+        u32 home = container_hash(container->items[entry].id) & mask;
+        bool stays = (i <= j) ? (home > i && home <= j) : (home > i || home <= j);
+        if (stays) continue;
+        
+        container->index[i] = entry;
+        i = j;
+    }
+    container->index[i] = ITEM_SLOT_NONE;
+}
+
+static void container_index_rebuild(ItemContainer* container) {
+    memset(container->index, 0xFF, (container->index_mask + 1) * sizeof(u32));
+    for (u32 slot = 0; slot < container->capacity; slot++) {
+        u16 id = container->items[slot].id;
+        if (id != 0 && container_stacks(container, id)) {
+            container_index_insert(container, slot);
+        }
+    }
+}
+
+static inline void container_mark_dirty(ItemContainer* container, u32 slot) {
+    u64 bit = 1ull << (slot & 63);
+    if (container->dirty_bits[slot >> 6] & bit) return;
+    container->dirty_bits[slot >> 6] |= bit;
+    container->dirty[container->dirty_count++] = slot;
+}
+
+static inline void container_set_free(ItemContainer* container, u32 slot, bool free_slot) {
+    if (!container->free_bits) return;
+    u64 bit = 1ull << (slot & 63);
+    if (free_slot) container->free_bits[slot >> 6] |= bit;
+    else container->free_bits[slot >> 6] &= ~bit;
+}
+
+/*
+ * container_set_slot - The one place slot contents change
+ */
+static void container_set_slot(ItemContainer* container, u32 slot, u16 id, u32 amount) {
+    Item* item = &container->items[slot];
+    if (item->id == id && item->amount == amount) return;
+    if (id == 0) amount = 0;
+    
+    if (item->id != id) {
+        if (item->id != 0) {
+            if (container->index) container_index_remove(container, slot);
+            container->used--;
+        }
+        item->id = id;
+        if (id != 0) {
+            container->used++;
+            if (container->index && container_stacks(container, id)) {
+                container_index_insert(container, slot);
+            }
+        }
+        container_set_free(container, slot, id == 0);
+    }
+    item->amount = amount;
+    container_mark_dirty(container, slot);
+}
+
+static inline u32 lowest_bit(u64 word) {
+#if defined(__GNUC__)
+    return (u32)__builtin_ctzll(word);
+#else
+    u32 bit = 0;
+    while (!(word & 1)) {
+        word >>= 1;
+        bit++;
+    }
+    return bit;
+#endif
+}
+
+/* First empty slot, ITEM_SLOT_NONE if full */
+static u32 container_first_free(const ItemContainer* container) {
+    if (container->free_bits) {
+        u32 words = (container->capacity + 63) / 64;
+        for (u32 w = 0; w < words; w++) {
+            if (container->free_bits[w]) return w * 64 + lowest_bit(container->free_bits[w]);
+        }
+        return ITEM_SLOT_NONE;
+    }
+    for (u32 i = 0; i < container->capacity; i++) {
+        if (container->items[i].id == 0) return i;
+    }
+    return ITEM_SLOT_NONE;
+}
+
 /*******************************************************************************
  * ITEM CONTAINER MANAGEMENT
  ******************************************************************************/
@@ -689,22 +800,46 @@ ItemDefinition* item_get_definition(ItemSystem* items, u16 id) {
  * COMPLEXITY: O(capacity) time (due to calloc zeroing), O(capacity) space
  */
 ItemContainer* item_container_create(u32 capacity) {
+    return item_container_create_ex(capacity, 0);
+}
+
+ItemContainer* item_container_create_ex(u32 capacity, u32 flags) {
     /* Allocate container struct */
-    ItemContainer* container = calloc(1, sizeof(ItemContainer));
+    ItemContainer* container = mem_calloc(MEM_PLAYER, 1, sizeof(ItemContainer));
     if (!container) return NULL;  /* Out of memory */
     
     /* Store capacity (used for bounds checking) */
     container->capacity = capacity;
+    container->flags = flags;
     
-    /* Allocate items array */
-    container->items = calloc(capacity, sizeof(Item));
+    /* Allocate items array, plus one dirty bit and list entry per slot */
+    u32 words = (capacity + 63) / 64;
+    container->items = mem_calloc(MEM_PLAYER, capacity, sizeof(Item));
+    container->dirty_bits = mem_calloc(MEM_PLAYER, words ? words : 1, sizeof(u64));
+    container->dirty = mem_calloc(MEM_PLAYER, capacity ? capacity : 1, sizeof(u32));
     
-    if (!container->items) {
-        /* Array allocation failed - clean up struct before returning */
-        free(container);
+    if (!container->items || !container->dirty_bits || !container->dirty) {
+        /* Allocation failed - clean up before returning */
+        item_container_destroy(container);
         return NULL;
     }
     
+    if (flags & ITEM_CONTAINER_INDEXED) {
+        u32 size = 16;
+        while (size < capacity * 2) size *= 2;
+        container->index = mem_alloc(MEM_PLAYER, size * sizeof(u32));
+        container->index_mask = size - 1;
+        container->free_bits = mem_calloc(MEM_PLAYER, words ? words : 1, sizeof(u64));
+        if (!container->index || !container->free_bits) {
+            item_container_destroy(container);
+            return NULL;
+        }
+        memset(container->index, 0xFF, size * sizeof(u32));
+        for (u32 slot = 0; slot < capacity; slot++) {
+            container_set_free(container, slot, true);
+        }
+    }
+    
     /* Success - return pointer to initialized container */
     return container;
 }
@@ -764,13 +899,15 @@ ItemContainer* item_container_create(u32 capacity) {
 void item_container_destroy(ItemContainer* container) {
     if (!container) return;  /* NULL-safe early exit */
     
-    /* Free items array (inner allocation) */
-    if (container->items) {
-        free(container->items);
-    }
+    /* Free items array and slot bookkeeping (inner allocations) */
+    mem_free(container->items);
+    mem_free(container->index);
+    mem_free(container->free_bits);
+    mem_free(container->dirty_bits);
+    mem_free(container->dirty);
     
     /* Free container struct (outer allocation) */
-    free(container);
+    mem_free(container);
 }
 
 /*
@@ -874,6 +1011,9 @@ void item_container_destroy(ItemContainer* container) {
  *   - Large containers (bank with 816 slots)
  *   - Frequent additions/removals
  *   - Trade-off: complexity for speed
+ *   That is what ITEM_CONTAINER_INDEXED containers keep (see
+ *   ITEM CONTAINER SLOT INDEX above): the stack comes from the index and
+ *   the empty slot from the free-slot bitmap.
  * 
  * OVERFLOW PROTECTION:
  * 
@@ -885,27 +1025,17 @@ void item_container_destroy(ItemContainer* container) {
  *   amount = 1
  *   Result: 4,294,967,296 (overflows to 0)
  * 
- * Current implementation: NO OVERFLOW PROTECTION
- *   - Assumes reasonable amounts
- *   - RS2 client enforces max stack size
- *   - Server trusts client (bad for security!)
- * 
- * Better implementation (future):
- *   u32 new_amount = items[i].amount + amount;
- *   if (new_amount < items[i].amount) {
- *       // Overflow detected
- *       items[i].amount = UINT32_MAX;  // Cap at maximum
- *   } else {
- *       items[i].amount = new_amount;
- *   }
+ * The add is refused (false) when the stack would pass UINT32_MAX, so
+ * an amount never wraps around to a small number.
  * 
  * FAILURE MODES:
  * 
  * Returns false when:
  *   1. container is NULL (invalid input)
  *   2. container->items is NULL (corrupted container)
- *   3. amount is 0 (no-op, could be true instead)
+ *   3. id or amount is 0
  *   4. No empty slot found (container full)
+ *   5. The stack would overflow
  * 
  * CLIENT NOTIFICATION:
  * 
@@ -918,36 +1048,27 @@ void item_container_destroy(ItemContainer* container) {
  *   Best case: O(1) - stackable item in first slot
  *   Average case: O(n/2) - scan half the slots
  *   Worst case: O(n) - scan all slots (full container)
+ *   Indexed: O(1) for a stack, O(n / 64) for an empty slot
  */
 bool item_container_add(ItemContainer* container, u16 id, u32 amount) {
     /* Validate inputs */
-    if (!container || !container->items || amount == 0) return false;
+    if (!container || !container->items || id == 0 || amount == 0) return false;
     
-    /* 
-     * Get item definition to check stackability.
-     * 
-     * item_get_definition() may return NULL if:
-     *   - g_items is not initialized
-     *   - id is out of range
+    /*
+     * Stacking item: add to its existing stack if there is one.
      * 
-     * We check def != NULL and def->stackable to handle this safely.
+     * Indexed containers look the stack up in the index; others scan.
+     * Whether the item stacks comes from its definition (item_get_definition
+     * may return NULL before the item system is loaded: then it does not),
+     * or from ITEM_CONTAINER_ALWAYS_STACK.
      */
-    ItemDefinition* def = item_get_definition(g_items, id);
-    if (def && def->stackable) {
-        /*
-         * Item is stackable - search for existing slot with same ID
-         * 
-         * Linear search through all slots:
-         *   - Check if items[i].id == id
-         *   - If match found: increase amount and return
-         *   - If no match: fall through to "find empty slot" logic
-         */
-        for (u32 i = 0; i < container->capacity; i++) {
-            if (container->items[i].id == id) {
-                /* Found existing stack - increase amount */
-                container->items[i].amount += amount;
-                return true;
-            }
+    if (container_stacks(container, id)) {
+        u32 slot = item_container_find(container, id);
+        if (slot != ITEM_SLOT_NONE) {
+            Item* item = &container->items[slot];
+            if (amount > UINT32_MAX - item->amount) return false;  /* Would overflow */
+            container_set_slot(container, slot, id, item->amount + amount);
+            return true;
         }
     }
     
@@ -956,19 +1077,14 @@ bool item_container_add(ItemContainer* container, u16 id, u32 amount) {
      *   - Item is not stackable, OR
      *   - Item is stackable but doesn't exist yet
      * 
-     * Find first empty slot (id == 0) and add item there.
+     * Put it in the first empty slot (lowest set bit of free_bits, or a
+     * scan for id == 0).
      */
-    for (u32 i = 0; i < container->capacity; i++) {
-        if (container->items[i].id == 0) {
-            /* Found empty slot - add item */
-            container->items[i].id = id;
-            container->items[i].amount = amount;
-            return true;
-        }
-    }
+    u32 slot = container_first_free(container);
+    if (slot == ITEM_SLOT_NONE) return false;  /* Container is full */
     
-    /* No empty slot found - container is full */
-    return false;
+    container_set_slot(container, slot, id, amount);
+    return true;
 }
 
 /*
@@ -1114,44 +1230,21 @@ bool item_container_remove(ItemContainer* container, u32 slot, u32 amount) {
     /* Validate inputs */
     if (!container || !container->items || slot >= container->capacity) return false;
     
-    /* 
-     * Get pointer to item at specified slot
-     * 
-     * This is safe because:
-     *   - slot < capacity (bounds checked above)
-     *   - items array is allocated with capacity elements
-     */
-    Item* item = &container->items[slot];
-    
     /* 
      * Validate item exists and has sufficient amount
      * 
      * id == 0: Slot is empty
-     * amount < amount: Not enough items to remove
+     * item->amount < amount: Not enough items to remove
      */
+    const Item* item = &container->items[slot];
     if (item->id == 0 || item->amount < amount) return false;
     
     /* 
-     * Decrease amount
-     * 
-     * This is safe because we validated item->amount >= amount above.
-     * No risk of underflow (unsigned integer wrapping to large value).
-     */
-    item->amount -= amount;
-    
-    /* 
-     * Check if slot is now empty
-     * 
-     * If amount reached 0:
-     *   - Clear id (marks slot as empty)
-     *   - Allows slot to be reused by item_container_add()
-     * 
-     * Note: amount is already 0 from subtraction above,
-     *       so we only need to clear id
+     * Decrease amount; at 0 the slot becomes empty (id = 0) and can be
+     * reused by item_container_add().
      */
-    if (item->amount == 0) {
-        item->id = 0;
-    }
+    u32 remaining = item->amount - amount;
+    container_set_slot(container, slot, remaining ? item->id : 0, remaining);
     
     return true;
 }
@@ -1184,15 +1277,14 @@ bool item_container_remove(ItemContainer* container, u32 slot, u32 amount) {
  * 
  * Implications:
  *   - No copying (fast, O(1))
- *   - Caller can modify item (if they want to)
+ *   - Read-only (changes go through item_container_*())
  *   - Pointer valid until container destroyed
  * 
  * Example usage:
- *   Item* item = item_container_get(inv, 5);
+ *   const Item* item = item_container_get(inv, 5);
  *   if (item && item->id != 0) {
  *       // Slot 5 is occupied
- *       ItemDefinition* def = item_get_definition(g_items, item->id);
- *       printf("Slot 5: %u x %s\n", item->amount, def->name);
+ *       printf("Slot 5: %u x %s\n", item->amount, item_get_name(g_items, item->id));
  *   } else {
  *       // Slot 5 is empty or invalid
  *       printf("Slot 5: empty\n");
@@ -1204,7 +1296,7 @@ bool item_container_remove(ItemContainer* container, u32 slot, u32 amount) {
  * Caller must check item->id to determine if slot is occupied.
  * 
  * Example:
- *   Item* item = item_container_get(inv, 10);
+ *   const Item* item = item_container_get(inv, 10);
  *   if (!item) {
  *       // Invalid slot index
  *       return;
@@ -1227,27 +1319,22 @@ bool item_container_remove(ItemContainer* container, u32 slot, u32 amount) {
  *   - Reading arbitrary memory
  *   - Potential crashes or security issues
  * 
- * MODIFICATION THROUGH POINTER:
- * 
- * Caller receives direct pointer to item in array.
- * They could modify the item:
- * 
- *   Item* item = item_container_get(inv, 5);
- *   item->amount = 999999;  // Cheating!
+ * READ-ONLY POINTER:
  * 
- * This is intentional - allows flexibility.
- * Caller is trusted to use responsibly.
+ * Caller receives a const pointer to the item in the array:
  * 
- * If read-only access is needed:
  *   const Item* item = item_container_get(inv, 5);
- *   item->amount = 100;  // Compiler error: const
+ *   item->amount = 999999;  // Compiler error: const
+ * 
+ * A write through it would bypass the slot index and the dirty set, so
+ * the client would never hear of it. Use item_container_add/remove.
  * 
  * ITERATION PATTERN:
  * 
  * Common pattern: Iterate through all slots
  * 
  *   for (u32 i = 0; i < container->capacity; i++) {
- *       Item* item = item_container_get(container, i);
+ *       const Item* item = item_container_get(container, i);
  *       if (item && item->id != 0) {
  *           // Process occupied slot
  *           printf("[%u] Item %u x%u\n", i, item->id, item->amount);
@@ -1268,7 +1355,7 @@ bool item_container_remove(ItemContainer* container, u32 slot, u32 amount) {
  * 
  * COMPLEXITY: O(1) time
  */
-Item* item_container_get(ItemContainer* container, u32 slot) {
+const Item* item_container_get(const ItemContainer* container, u32 slot) {
     /* Validate inputs */
     if (!container || !container->items || slot >= container->capacity) return NULL;
     
@@ -1282,6 +1369,12 @@ Item* item_container_get(ItemContainer* container, u32 slot) {
     return &container->items[slot];
 }
 
+bool item_container_set(ItemContainer* container, u32 slot, u16 id, u32 amount) {
+    if (!container || !container->items || slot >= container->capacity) return false;
+    container_set_slot(container, slot, id, amount);
+    return true;
+}
+
 /*
  * item_container_clear - Remove all items from container
  * 
@@ -1420,13 +1513,100 @@ void item_container_clear(ItemContainer* container) {
     if (!container || !container->items) return;
     
     /* 
-     * Zero entire items array
-     * 
-     * This sets all bytes to 0:
-     *   - All id fields become 0 (empty slot marker)
-     *   - All amount fields become 0
+     * Empty every occupied slot
      * 
-     * memset is fast and safe for this use case.
+     * Slot by slot rather than one memset, so the emptied slots are
+     * recorded as dirty and leave the index.
      */
-    memset(container->items, 0, container->capacity * sizeof(Item));
+    for (u32 slot = 0; slot < container->capacity && container->used > 0; slot++) {
+        if (container->items[slot].id != 0) {
+            container_set_slot(container, slot, 0, 0);
+        }
+    }
+}
+
+u32 item_container_find(const ItemContainer* container, u16 id) {
+    if (!container || !container->items || id == 0) return ITEM_SLOT_NONE;
+    
+    if (container->index && container_stacks(container, id)) {
+        return container_index_lookup(container, id);
+    }
+    for (u32 i = 0; i < container->capacity; i++) {
+        if (container->items[i].id == id) return i;
+    }
+    return ITEM_SLOT_NONE;
+}
+
+u32 item_container_add_many(ItemContainer* container, const Item* items, u32 count) {
+    if (!container || !items) return 0;
+    
+    u32 added = 0;
+    for (u32 i = 0; i < count; i++) {
+        if (items[i].id == 0 || items[i].amount == 0) continue;
+        if (!item_container_add(container, items[i].id, items[i].amount)) break;
+        added++;
+    }
+    return added;
+}
+
+u32 item_container_move_all(ItemContainer* from, ItemContainer* to) {
+    if (!from || !to || from == to || !from->items) return 0;
+    
+    u32 moved = 0;
+    for (u32 slot = 0; slot < from->capacity && from->used > 0; slot++) {
+        const Item* item = &from->items[slot];
+        if (item->id == 0) continue;
+        if (item_container_add(to, item->id, item->amount)) {
+            container_set_slot(from, slot, 0, 0);
+            moved++;
+        }
+    }
+    return moved;
+}
+
+void item_container_sort(ItemContainer* container, ItemCompare compare) {
+    if (!container || !container->items || container->used == 0) return;
+    
+    /* Pack the occupied slots, in slot order */
+    u32 count = 0;
+    Item* packed = mem_alloc(MEM_PLAYER, container->used * sizeof(Item));
+    if (!packed) return;
+    for (u32 slot = 0; slot < container->capacity && count < container->used; slot++) {
+        if (container->items[slot].id != 0) packed[count++] = container->items[slot];
+    }
+    if (compare) qsort(packed, count, sizeof(Item), compare);
+    
+    /*
+     * Write them back. Items move between slots wholesale, so the index
+     * is rebuilt once at the end instead of being updated per slot.
+     */
+    for (u32 slot = 0; slot < container->capacity; slot++) {
+        Item want = slot < count ? packed[slot] : (Item){ 0, 0 };
+        Item* item = &container->items[slot];
+        if (item->id == want.id && item->amount == want.amount) continue;
+        *item = want;
+        container_set_free(container, slot, want.id == 0);
+        container_mark_dirty(container, slot);
+    }
+    mem_free(packed);
+    
+    if (container->index) container_index_rebuild(container);
+}
+
+const u32* item_container_dirty(const ItemContainer* container, u32* count) {
+    if (!container) {
+        if (count) *count = 0;
+        return NULL;
+    }
+    if (count) *count = container->dirty_count;
+    return container->dirty;
+}
+
+void item_container_clear_dirty(ItemContainer* container) {
+    if (!container) return;
+    for (u32 i = 0; i < container->dirty_count; i++) {
+        u32 slot = container->dirty[i];
+        container->dirty_bits[slot >> 6] &= ~(1ull << (slot & 63));
+    }
+    container->dirty_count = 0;
 }
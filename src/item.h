@@ -34,6 +34,7 @@
 #define ITEM_H
 
 #include "types.h"
+#include "def_store.h"
 
 /*******************************************************************************
  * ITEM DEFINITION STRUCTURE
@@ -42,28 +43,29 @@
  * This is the "blueprint" for an item - it defines what an item IS,
  * not how many you have or where it's located.
  * 
- * MEMORY LAYOUT: 256 bytes per definition
+ * MEMORY LAYOUT: 72 bytes per definition (hot fields only)
  * 
  * ┌─────────────────────────────────────────────────────────────┐
  * │  FIELD           │ TYPE  │ SIZE │ OFFSET │ PURPOSE          │
  * ├─────────────────────────────────────────────────────────────┤
  * │  id              │ u16   │  2B  │   0    │ Unique identifier│
- * │  name            │ char[]│ 64B  │   2    │ Display name     │
- * │  examine         │ char[]│ 128B │  66    │ Examine text     │
- * │  sprite_id       │ u16   │  2B  │ 194    │ Inventory icon   │
- * │  value           │ i32   │  4B  │ 196    │ Store price      │
- * │  stackable       │ bool  │  1B  │ 200    │ Can stack?       │
- * │  members         │ bool  │  1B  │ 201    │ Members only?    │
- * │  tradeable       │ bool  │  1B  │ 202    │ Can trade?       │
- * │  noteable        │ bool  │  1B  │ 203    │ Has note form?   │
- * │  note_id         │ u16   │  2B  │ 204    │ Noted item ID    │
- * │  weight          │ i32   │  4B  │ 206    │ Weight (kg*10)   │
- * │  equip_slot      │ u8    │  1B  │ 210    │ Equipment slot   │
- * │  equip_model     │ u16   │  2B  │ 211    │ Worn model ID    │
- * │  bonuses[12]     │ i32[] │ 48B  │ 213    │ Combat bonuses   │
- * │  (padding)       │       │  ?   │ 261    │ (alignment)      │
+ * │  note_id         │ u16   │  2B  │   2    │ Noted item ID    │
+ * │  sprite_id       │ u16   │  2B  │   4    │ Inventory model  │
+ * │  equip_model     │ u16   │  2B  │   6    │ Worn model ID    │
+ * │  value           │ i32   │  4B  │   8    │ Store price      │
+ * │  weight          │ i32   │  4B  │  12    │ Weight (kg*10)   │
+ * │  stackable       │ bool  │  1B  │  16    │ Can stack?       │
+ * │  members         │ bool  │  1B  │  17    │ Members only?    │
+ * │  tradeable       │ bool  │  1B  │  18    │ Can trade?       │
+ * │  noteable        │ bool  │  1B  │  19    │ Has note form?   │
+ * │  equip_slot      │ u8    │  1B  │  20    │ Equipment slot   │
+ * │  (padding)       │       │  3B  │  21    │ (alignment)      │
+ * │  bonuses[12]     │ i32[] │ 48B  │  24    │ Combat bonuses   │
  * └─────────────────────────────────────────────────────────────┘
  * 
+ * Name and examine text live in ItemSystem.text[] as offsets into the
+ * shared string pool (see def_store.h): item_get_name(), item_get_examine().
+ * 
  * EXAMPLE DEFINITIONS:
  * 
  * Coins (ID 995):
@@ -86,10 +88,11 @@
  ******************************************************************************/
 typedef struct {
     u16  id;              /* Unique item identifier (0-65535) */
-    char name[64];        /* Display name (null-terminated) */
-    char examine[128];    /* Examine text shown when right-clicking */
-    u16  sprite_id;       /* Inventory icon sprite ID */
+    u16  note_id;         /* Item ID when noted (0 if not noteable) */
+    u16  sprite_id;       /* Inventory model ID */
+    u16  equip_model;     /* 3D model ID when equipped */
     i32  value;           /* Store buy/sell price (gold pieces) */
+    i32  weight;          /* Weight in kg * 10 (e.g., 125 = 12.5kg) */
     
     /* Item properties (boolean flags) */
     bool stackable;       /* Can multiple items share one slot? */
@@ -97,12 +100,8 @@ typedef struct {
     bool tradeable;       /* Can be traded/sold on GE? */
     bool noteable;        /* Can be converted to noted form? */
     
-    u16  note_id;         /* Item ID when noted (0 if not noteable) */
-    i32  weight;          /* Weight in kg * 10 (e.g., 125 = 12.5kg) */
-    
     /* Equipment properties */
     u8   equip_slot;      /* 0=head, 1=cape, 2=amulet, 3=weapon, etc. */
-    u16  equip_model;     /* 3D model ID when equipped */
     
     /* Combat bonuses array:
      * [0] = Stab attack       [6]  = Stab defense
@@ -198,7 +197,7 @@ typedef struct {
  * MEMORY LAYOUT (for 28-slot inventory):
  * 
  * ┌────────────────────────────────────────────────────────────┐
- * │  ItemContainer struct (16 bytes on 64-bit)                 │
+ * │  ItemContainer struct (slot array fields)                  │
  * ├────────────────────────────────────────────────────────────┤
  * │  items    : Item*  (8B pointer to array)                   │
  * │  capacity : u32    (4B max slots)                          │
@@ -260,13 +259,58 @@ typedef struct {
  *   item_container_remove(inv, 0, 5000);  // Remove 5k coins from slot 0
  * 
  * Accessing items:
- *   Item* coins = item_container_get(inv, 0);
+ *   const Item* coins = item_container_get(inv, 0);
  *   printf("Coins: %u\n", coins->amount);
  * 
+ * SLOT INDEX (ITEM_CONTAINER_INDEXED):
+ * 
+ * Both operations above scan the slots. For a 28-slot inventory that is
+ * nothing, but a bank or shop holds hundreds of slots and a deposit-all
+ * adds one item per inventory slot. An indexed container additionally
+ * keeps:
+ * 
+ *   index      open-addressed id -> slot of the item's stack (stacking
+ *              items only: a non-stackable item may fill many slots)
+ *   free_bits  one bit per slot, set while the slot is empty
+ * 
+ *   add(995, 500):  index[995] -> slot 3, amount += 500         O(1)
+ *   add(4151, 1):   lowest set bit of free_bits -> slot 7        O(capacity / 64)
+ * 
+ * ITEM_CONTAINER_ALWAYS_STACK makes every item stack (banks), so every
+ * item is in the index.
+ * 
+ * DIRTY SLOTS:
+ * 
+ * Every mutation records the slots it changed, once each, in dirty[]
+ * (dirty_bits dedupes). The packet code sends just those slots
+ * (UPDATE_INV_PARTIAL) and clears the set; see send_container_update().
+ * 
+ * Containers must therefore only be changed through item_container_*():
+ * item_container_get() hands out a const pointer.
+ * 
  ******************************************************************************/
+
+/* item_container_create_ex() flags */
+#define ITEM_CONTAINER_INDEXED      0x1     /* id -> slot index + free-slot bitmap */
+#define ITEM_CONTAINER_ALWAYS_STACK 0x2     /* Every item stacks (banks) */
+
+#define ITEM_SLOT_NONE UINT32_MAX
+
 typedef struct {
     Item* items;      /* Heap-allocated array of item slots */
     u32   capacity;   /* Maximum number of slots */
+    u32   flags;      /* ITEM_CONTAINER_* */
+    u32   used;       /* Occupied slots */
+    
+    /* ITEM_CONTAINER_INDEXED only */
+    u32*  index;      /* Open addressing: slot of a stack, ITEM_SLOT_NONE = empty */
+    u32   index_mask;
+    u64*  free_bits;  /* Bit set = slot empty */
+    
+    /* Slots changed since item_container_clear_dirty() */
+    u64*  dirty_bits;
+    u32*  dirty;      /* In order of first change */
+    u32   dirty_count;
 } ItemContainer;
 
 /*******************************************************************************
@@ -278,23 +322,22 @@ typedef struct {
  * MEMORY LAYOUT:
  * 
  * ┌───────────────────────────────────────────────────────────┐
- * │  ItemSystem struct (24 bytes on 64-bit)                   │
+ * │  ItemSystem struct                                         │
  * ├───────────────────────────────────────────────────────────┤
- * │  definitions      : ItemDefinition* (8B pointer)          │
- * │  definition_count : u32 (4B)                              │
- * │  initialized      : bool (1B)                             │
- * │  (padding)        : 3B                                    │
+ * │  definitions      : const ItemDefinition* (hot fields)    │
+ * │  text             : const DefText* (name/examine offsets) │
+ * │  definition_count : u32                                   │
+ * │  initialized      : bool                                  │
  * └───────────────────────────────────────────────────────────┘
  *                       │
  *                       v
  * ┌───────────────────────────────────────────────────────────┐
- * │  ItemDefinition array (10,000 * 256B = 2.5 MB)            │
+ * │  ItemDefinition array (one per obj.dat entry, 72B each)   │
  * ├──────────┬──────────┬──────────┬─────┬──────────┬────────┤
- * │  ID 0    │  ID 1    │  ID 2    │ ... │  ID 998  │ ID 999 │
- * │ (empty)  │ (empty)  │ (empty)  │     │ (empty)  │ (empty)│
- * ├──────────┼──────────┼──────────┼─────┼──────────┼────────┤
- * │  ID 995 = Coins                                           │
- * │  name = "Coins", stackable = true, value = 1              │
+ * │  ID 0    │  ID 1    │  ID 2    │ ... │  ID 995  │  ...   │
+ * ├──────────┴──────────┴──────────┴─────┴──────────┴────────┤
+ * │  ID 995 = Coins: stackable = true, value = 1              │
+ * │  text[995] = { name → "Coins", examine → "Lovely money!" }│
  * └───────────────────────────────────────────────────────────┘
  * 
  * LOOKUP ALGORITHM:
@@ -320,37 +363,17 @@ typedef struct {
  *   Cons: Wastes memory on unused IDs
  *   When to use: Dense, contiguous ID ranges (like OSRS)
  * 
- * MEMORY OVERHEAD ANALYSIS:
- * 
- * OSRS 2007 has approximately 7,000 items.
- * We allocate 10,000 slots for future-proofing.
- * 
- * Total memory: 10,000 * 256 bytes = 2,560,000 bytes (2.5 MB)
- * Used memory:  7,000 * 256 bytes = 1,792,000 bytes (1.75 MB)
- * Wasted:       3,000 * 256 bytes = 768,000 bytes (0.75 MB)
- * 
- * Is 0.75 MB waste acceptable?
- *   - Modern servers have GBs of RAM
- *   - Simplicity and speed outweigh memory cost
- *   - Trade-off: waste memory to gain performance
- * 
  * INITIALIZATION:
  * 
- * Currently, definitions are initialized to zero.
- * TODO: Load from OSRS cache files (.dat2, .idx)
- * 
- * Cache loading steps (future implementation):
- *   1. Open cache archive (item_definitions.dat2)
- *   2. Read index file to locate definition offsets
- *   3. For each definition:
- *      a. Read binary data (TLV-encoded)
- *      b. Parse fields (name, examine, stats, etc.)
- *      c. Store in definitions[id]
- *   4. Mark system as initialized
+ * item_system_init() takes the tables from g_defs: mapped straight from
+ * the world snapshot when it is current, otherwise decoded from obj.idx /
+ * obj.dat in the config archive (and saved to the snapshot by server_init).
+ * Both arrays are owned by g_defs and read-only.
  * 
  ******************************************************************************/
 typedef struct {
-    ItemDefinition* definitions;      /* Array of all item definitions */
+    const ItemDefinition* definitions; /* Hot fields, indexed by item ID */
+    const DefText*  text;             /* Name/examine pool offsets, by ID */
     u32             definition_count; /* Number of definitions (array size) */
     bool            initialized;      /* Has system been initialized? */
 } ItemSystem;
@@ -377,7 +400,7 @@ typedef struct {
  *   }
  * 
  * Usage throughout codebase:
- *   ItemDefinition* def = item_get_definition(g_items, 995);
+ *   const ItemDefinition* def = item_get_definition(g_items, 995);
  *   if (def->stackable) { ... }
  * 
  * THREAD SAFETY:
@@ -443,26 +466,23 @@ void item_system_destroy(ItemSystem* items);
  * 
  * ALGORITHM:
  *   1. Check if already initialized (idempotent)
- *   2. Allocate definitions array (currently 10,000 slots)
- *   3. Load definitions from cache (TODO: implement cache loader)
- *   4. Set initialized = true
+ *   2. Snapshot current: point definitions/text into g_defs' mapping
+ *   3. Otherwise decode obj.idx / obj.dat from the config archive into
+ *      tables from def_store_table(), interning name and examine
+ *   4. No config archive: a single hand-written definition (coins, 995)
+ *   5. Set initialized = true
  * 
- * CURRENT IMPLEMENTATION:
- *   - Allocates 10,000 zero-initialized definitions
- *   - Manually initializes item ID 995 (coins) as example
- *   - TODO: Replace with actual cache parser
- * 
- * FUTURE CACHE LOADING:
- *   - Read item_definitions.dat2 from cache/
- *   - Parse binary format (TLV encoding)
- *   - Populate all definitions
+ * DECODED FIELDS (obj.dat opcodes):
+ *   1 model → sprite_id, 2 name, 3 examine, 11 stackable, 12 value,
+ *   16 members, 97/98 note link/template. Notes take name, value and
+ *   members from the item they note, as the client does, and stack.
  * 
  * ERROR HANDLING:
- *   - Returns false if already initialized
+ *   - Returns false if already initialized or g_defs is NULL
  *   - Returns false if allocation fails
  *   - On failure, system remains uninitialized (safe to retry)
  * 
- * COMPLEXITY: O(n) where n = definition_count
+ * COMPLEXITY: O(size of obj.dat), O(1) from the snapshot
  */
 bool item_system_init(ItemSystem* items);
 
@@ -481,9 +501,9 @@ bool item_system_init(ItemSystem* items);
  * LOOKUP COMPLEXITY: O(1) time
  * 
  * EXAMPLE:
- *   ItemDefinition* coins = item_get_definition(g_items, 995);
+ *   const ItemDefinition* coins = item_get_definition(g_items, 995);
  *   if (coins && coins->stackable) {
- *       printf("%s can stack!\n", coins->name);
+ *       printf("%s can stack!\n", item_get_name(g_items, 995));
  *   }
  * 
  * NULL RETURN:
@@ -493,7 +513,13 @@ bool item_system_init(ItemSystem* items);
  * 
  * THREAD SAFETY: Read-only, safe to call from any thread
  */
-ItemDefinition* item_get_definition(ItemSystem* items, u16 id);
+const ItemDefinition* item_get_definition(ItemSystem* items, u16 id);
+
+/*
+ * item_get_name / item_get_examine - Text of an item ("" if unknown)
+ */
+const char* item_get_name(ItemSystem* items, u16 id);
+const char* item_get_examine(ItemSystem* items, u16 id);
 
 /*******************************************************************************
  * ITEM CONTAINER MANAGEMENT FUNCTIONS
@@ -526,6 +552,18 @@ ItemDefinition* item_get_definition(ItemSystem* items, u16 id);
  */
 ItemContainer* item_container_create(u32 capacity);
 
+/*
+ * item_container_create_ex - Allocate a container with ITEM_CONTAINER_* flags
+ * 
+ * @param capacity  Number of item slots
+ * @param flags     ITEM_CONTAINER_INDEXED for banks and shops (hundreds of
+ *                  slots), ITEM_CONTAINER_ALWAYS_STACK for banks
+ * @return          New container, or NULL on failure
+ * 
+ * item_container_create(capacity) is item_container_create_ex(capacity, 0).
+ */
+ItemContainer* item_container_create_ex(u32 capacity, u32 flags);
+
 /*
  * item_container_destroy - Free all memory used by container
  * 
@@ -645,20 +683,37 @@ bool item_container_remove(ItemContainer* container, u32 slot, u32 amount);
  *   2. Return &items[slot]
  * 
  * USAGE:
- *   Item* item = item_container_get(inv, 5);
+ *   const Item* item = item_container_get(inv, 5);
  *   if (item && item->id != 0) {
- *       ItemDefinition* def = item_get_definition(g_items, item->id);
- *       printf("Slot 5: %u x %s\n", item->amount, def->name);
+ *       printf("Slot 5: %u x %s\n", item->amount, item_get_name(g_items, item->id));
  *   }
  * 
  * SAFETY:
  *   - Returns pointer to internal array (caller must not free)
+ *   - Read-only: changes go through item_container_*() so the index
+ *     and dirty slots stay right
  *   - Pointer is valid until container is destroyed or cleared
  *   - Caller should check if item->id != 0 (slot not empty)
  * 
  * COMPLEXITY: O(1) time
  */
-Item* item_container_get(ItemContainer* container, u32 slot);
+const Item* item_container_get(const ItemContainer* container, u32 slot);
+
+/*
+ * item_container_set - Put exactly this stack in one slot
+ * 
+ * @param slot    Slot index (0 to capacity-1)
+ * @param id      Item ID, 0 to empty the slot
+ * @param amount  Quantity (ignored for id 0)
+ * @return        false if the slot is out of range
+ * 
+ * For restoring a container slot for slot (cluster.h hands a player's
+ * inventory and equipment to another node this way); no stacking or
+ * free-slot search. Keeps the index and dirty slots right.
+ * 
+ * COMPLEXITY: O(1) time
+ */
+bool item_container_set(ItemContainer* container, u32 slot, u16 id, u32 amount);
 
 /*
  * item_container_clear - Remove all items from container
@@ -681,4 +736,69 @@ Item* item_container_get(ItemContainer* container, u32 slot);
  */
 void item_container_clear(ItemContainer* container);
 
+/*
+ * item_container_find - Slot holding an item
+ * 
+ * @return  The item's stack (or first slot, for non-stacking items), or
+ *          ITEM_SLOT_NONE
+ * 
+ * COMPLEXITY: O(1) for stacking items of an indexed container,
+ *             O(capacity) otherwise
+ */
+u32 item_container_find(const ItemContainer* container, u16 id);
+
+/*
+ * item_container_add_many - Add several items in one pass
+ * 
+ * @param items  Items to add (id 0 / amount 0 entries are skipped)
+ * @param count  Number of entries
+ * @return       Entries added; stops at the first that does not fit,
+ *               leaving it and the rest out
+ * 
+ * COMPLEXITY: O(count) with an index, O(count * capacity) without
+ */
+u32 item_container_add_many(ItemContainer* container, const Item* items, u32 count);
+
+/*
+ * item_container_move_all - Move every item of one container into another
+ * 
+ * @return  Slots emptied in from. Items that do not fit stay where they
+ *          are (a deposit-all into a full bank keeps them in the inventory)
+ * 
+ * Both containers record their changed slots as dirty.
+ */
+u32 item_container_move_all(ItemContainer* from, ItemContainer* to);
+
+/*
+ * ItemCompare - Sort order for item_container_sort() (qsort comparator)
+ */
+typedef int (*ItemCompare)(const void* a, const void* b);
+
+/*
+ * item_container_sort - Pack items into the leading slots, optionally sorted
+ * 
+ * @param compare  Order of the packed items, or NULL to keep their order
+ *                 (closing the gaps a withdrawal left)
+ * 
+ * Only slots whose contents changed become dirty.
+ * 
+ * COMPLEXITY: O(capacity) packing, plus O(n log n) with a compare
+ */
+void item_container_sort(ItemContainer* container, ItemCompare compare);
+
+/*
+ * item_container_dirty - Slots changed since the last clear_dirty
+ * 
+ * @param count  Receives the number of slots
+ * @return       Slot numbers, each once, in order of first change
+ */
+const u32* item_container_dirty(const ItemContainer* container, u32* count);
+
+/*
+ * item_container_clear_dirty - Forget the changed slots (after sending them)
+ * 
+ * COMPLEXITY: O(dirty slots)
+ */
+void item_container_clear_dirty(ItemContainer* container);
+
 #endif /* ITEM_H */
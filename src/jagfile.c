@@ -6,17 +6,36 @@
 #include "thirdparty/bzip.h"
 
 static Jagfile *jagfile_parse(int8_t *src, int length);
+static void jagfile_parse_index(Jagfile *jagfile, Packet *packet);
 
 Jagfile *jagfile_new(int8_t *src, int length) {
     return jagfile_parse(src, length);
 }
 
+Jagfile *jagfile_new_unpacked(int8_t *data, int length) {
+    Jagfile *jagfile = calloc(1, sizeof(Jagfile));
+    jagfile->data = data;
+    jagfile->is_compressed_whole = true;
+    Packet *packet = packet_new(data, length);
+    jagfile_parse_index(jagfile, packet);
+    free(packet);
+    return jagfile;
+}
+
 void jagfile_free(Jagfile *jagfile) {
     free(jagfile->data);
     free(jagfile->file_hash);
     free(jagfile->file_unpacked_size);
     free(jagfile->file_packed_size);
     free(jagfile->file_offset);
+    free(jagfile->sorted_hash);
+    free(jagfile->sorted_id);
+    if (jagfile->file_unpacked) {
+        for (int i = 0; i < jagfile->file_count; i++) {
+            free(jagfile->file_unpacked[i]);
+        }
+        free(jagfile->file_unpacked);
+    }
     free(jagfile);
 }
 
@@ -38,6 +57,12 @@ static Jagfile *jagfile_parse(int8_t *src, int length) {
         packet = packet_new(jagfile->data, unpacked_size);
         jagfile->is_compressed_whole = true;
     }
+    jagfile_parse_index(jagfile, packet);
+    free(packet);
+    return jagfile;
+}
+
+static void jagfile_parse_index(Jagfile *jagfile, Packet *packet) {
     jagfile->file_count = g2(packet);
     jagfile->file_hash = calloc(jagfile->file_count, sizeof(int));
     jagfile->file_unpacked_size = calloc(jagfile->file_count, sizeof(int));
@@ -51,27 +76,80 @@ static Jagfile *jagfile_parse(int8_t *src, int length) {
         jagfile->file_offset[i] = offset;
         offset += jagfile->file_packed_size[i];
     }
-    free(packet);
-    return jagfile;
+
+    // custom: sorted once here so every lookup is a binary search (insertion sort, archives hold tens of files)
+    jagfile->sorted_hash = calloc(jagfile->file_count, sizeof(int));
+    jagfile->sorted_id = calloc(jagfile->file_count, sizeof(int));
+    for (int i = 0; i < jagfile->file_count; i++) {
+        int hash = jagfile->file_hash[i];
+        int j = i;
+        for (; j > 0 && jagfile->sorted_hash[j - 1] > hash; j--) {
+            jagfile->sorted_hash[j] = jagfile->sorted_hash[j - 1];
+            jagfile->sorted_id[j] = jagfile->sorted_id[j - 1];
+        }
+        jagfile->sorted_hash[j] = hash;
+        jagfile->sorted_id[j] = i;
+    }
 }
 
 int jagfile_read(Jagfile *jagfile, const char *name) {
-    int hash = 0;
-    for (size_t i = 0; i < strlen(name); i++) {
-        hash = hash * 61 + toupper(name[i]) - 32;
+    uint32_t hash = 0;
+    for (const char *c = name; *c; c++) {
+        hash = hash * 61 + (uint32_t)toupper((unsigned char)*c) - 32;
     }
-    for (int id = 0; id < jagfile->file_count; id++) {
-        if (jagfile->file_hash[id] == hash) {
-            return id;
+
+    // first of equal hashes, the id the linear scan used to find
+    int low = 0;
+    int high = jagfile->file_count;
+    while (low < high) {
+        int mid = (low + high) >> 1;
+        if (jagfile->sorted_hash[mid] < (int)hash) {
+            low = mid + 1;
+        } else {
+            high = mid;
         }
     }
+    if (low < jagfile->file_count && jagfile->sorted_hash[low] == (int)hash) {
+        return jagfile->sorted_id[low];
+    }
     // NOTE custom, need index again when creating packet/jpeg to get the length
     return -1;
 }
 
+const int8_t *jagfile_borrow(Jagfile *jagfile, const char *name, int *length) {
+    int id = jagfile_read(jagfile, name);
+    if (id == -1) {
+        return NULL;
+    }
+
+    *length = jagfile->file_unpacked_size[id];
+    if (jagfile->is_compressed_whole) {
+        return jagfile->data + jagfile->file_offset[id];
+    }
+    if (!jagfile->file_unpacked) {
+        jagfile->file_unpacked = calloc(jagfile->file_count, sizeof(int8_t *));
+    }
+    if (!jagfile->file_unpacked[id]) {
+        jagfile->file_unpacked[id] = jagfile_read_index(jagfile, id);
+    }
+    return jagfile->file_unpacked[id];
+}
+
+bool jagfile_view_packet(Jagfile *jagfile, const char *name, Packet *view) {
+    int length = 0;
+    const int8_t *data = jagfile_borrow(jagfile, name, &length);
+    if (!data) {
+        return false;
+    }
+    packet_view(view, data, length);
+    return true;
+}
+
 int8_t *jagfile_read_index(Jagfile *jagfile, int id) {
     int8_t *dest = malloc(jagfile->file_unpacked_size[id]);
-    if (jagfile->is_compressed_whole) {
+    if (jagfile->file_unpacked && jagfile->file_unpacked[id]) {
+        memcpy(dest, jagfile->file_unpacked[id], jagfile->file_unpacked_size[id]);
+    } else if (jagfile->is_compressed_whole) {
         memcpy(dest, jagfile->data + jagfile->file_offset[id], jagfile->file_unpacked_size[id]);
     } else {
         bzip_decompress(dest, jagfile->data, jagfile->file_packed_size[id], jagfile->file_offset[id]);
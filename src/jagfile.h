@@ -12,11 +12,22 @@ typedef struct {
     int *file_packed_size;
     int *file_offset;
     bool is_compressed_whole;
+    // custom: file ids ordered by hash for jagfile_read, and files decompressed by jagfile_borrow
+    int *sorted_hash;
+    int *sorted_id;
+    int8_t **file_unpacked;
 } Jagfile;
 
 Jagfile *jagfile_new(int8_t *src, int length);
+// custom: an archive whose files are all stored uncompressed (no size header, see archive_cache.h)
+Jagfile *jagfile_new_unpacked(int8_t *data, int length);
 void jagfile_free(Jagfile *jagfile);
 Packet *jagfile_to_packet(Jagfile *jagfile, const char *name);
 // NOTE can't make those static as pix24 uses them directly with stb
 int8_t *jagfile_read_index(Jagfile *jagfile, int id);
 int jagfile_read(Jagfile *jagfile, const char *name);
+// custom: read-only view of a file owned by the archive, NULL if missing: no copy when the
+// archive was compressed whole, otherwise decompressed on the first borrow and kept until jagfile_free
+const int8_t *jagfile_borrow(Jagfile *jagfile, const char *name, int *length);
+// custom: jagfile_borrow as a Packet to read with g1() etc, never packet_free() it
+bool jagfile_view_packet(Jagfile *jagfile, const char *name, Packet *view);
@@ -0,0 +1,306 @@
+/*******************************************************************************
+ * LOAD_QUEUE.C - Login Worker Implementation
+ *******************************************************************************
+ *
+ * See load_queue.h for the design.
+ *
+ * WORKER LOOP:
+ *
+ *   lock
+ *   while running:
+ *       wait until a job is unclaimed (or stop was requested)
+ *       job = jobs[head + claimed++]
+ *       unlock → login_decode_block() → player_load_read() into the job → lock
+ *       job->status = result
+ *       done += finished jobs now contiguous with the done prefix
+ *   unlock
+ *
+ * The game thread never touches jobs past head + done, and no other
+ * worker touches a claimed job, so the worker fills it without holding
+ * the mutex. Status is the one field other threads look at (advancing
+ * done), so it is only written under the mutex.
+ *
+ ******************************************************************************/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include "load_queue.h"
+#include "player_save.h"
+#include "login.h"
+#include "account_registry.h"
+#include "supervisor.h"
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+LoadQueue* g_load_queue = NULL;
+u32 g_load_queue_threads = LOAD_QUEUE_THREADS;
+
+#ifndef _WIN32
+
+#include <pthread.h>
+#include <signal.h>
+
+#define QUEUE_MUTEX(q)  ((pthread_mutex_t*)(q)->mutex)
+#define QUEUE_WAKE(q)   ((pthread_cond_t*)(q)->wake)
+
+/*
+ * job_reserve - Make job->data hold at least size bytes
+ */
+static bool job_reserve(LoadJob* job, u32 size) {
+    if (job->data_capacity >= size) return true;
+    u8* grown = (u8*)realloc(job->data, size);
+    if (!grown) return false;
+    job->data = grown;
+    job->data_capacity = size;
+    return true;
+}
+
+/*
+ * load_job_run - Decode the block and read the save (worker, unlocked)
+ */
+static LoadStatus load_job_run(LoadJob* job, u8* buffer, u32 buffer_size) {
+    u64 trace_start = trace_begin();
+    bool decoded = login_decode_block(job->block, job->block_size, &job->login);
+    trace_end(trace_start, "login_decode", job->slot);
+    if (!decoded) return LOAD_REJECTED;
+    memset(job->block, 0, job->block_size);  /* Plaintext logins: the password */
+
+    /* Claim before reading, so the file read is the other world's last save */
+    if (!account_registry_claim(g_account_registry, job->login.username, g_world_id)) {
+        return LOAD_ONLINE;
+    }
+
+    u32 size = 0;
+    trace_start = trace_begin();
+    bool found = player_load_read(job->login.username, buffer, buffer_size, &size);
+    trace_end(trace_start, "login_read", size);
+    if (!found) return LOAD_MISSING;
+    if (!job_reserve(job, size)) return LOAD_FAILED;
+    memcpy(job->data, buffer, size);
+    job->size = size;
+    return LOAD_FOUND;
+}
+
+static void* load_queue_thread_main(void* arg) {
+    LoadQueue* queue = (LoadQueue*)arg;
+    u8 buffer[PLAYER_SAVE_MAX_SIZE];
+    trace_thread_name("login");
+    pthread_mutex_lock(QUEUE_MUTEX(queue));
+
+    for (;;) {
+        while (queue->claimed == queue->count && queue->running) {
+            pthread_cond_wait(QUEUE_WAKE(queue), QUEUE_MUTEX(queue));
+        }
+        if (!queue->running) break;  /* Pending requests are dropped */
+
+        LoadJob* job = &queue->jobs[(queue->head + queue->claimed) % queue->capacity];
+        queue->claimed++;
+        pthread_mutex_unlock(QUEUE_MUTEX(queue));
+
+        LoadStatus status = load_job_run(job, buffer, sizeof(buffer));
+
+        pthread_mutex_lock(QUEUE_MUTEX(queue));
+        job->status = status;
+        if (status == LOAD_FOUND) queue->found++;
+        if (status == LOAD_REJECTED) queue->rejected++;
+        while (queue->done < queue->claimed &&
+               queue->jobs[(queue->head + queue->done) % queue->capacity].status != LOAD_PENDING) {
+            queue->done++;
+        }
+    }
+
+    pthread_mutex_unlock(QUEUE_MUTEX(queue));
+    return NULL;
+}
+
+/*
+ * load_queue_free - Release everything load_queue_start() allocated
+ */
+static void load_queue_free(LoadQueue* queue) {
+    if (queue->jobs) {
+        for (u32 i = 0; i < queue->capacity; i++) free(queue->jobs[i].data);
+        memset(queue->jobs, 0, queue->capacity * sizeof(LoadJob));  /* Credentials */
+        free(queue->jobs);
+    }
+    if (queue->mutex) pthread_mutex_destroy(QUEUE_MUTEX(queue));
+    if (queue->wake) pthread_cond_destroy(QUEUE_WAKE(queue));
+    free(queue->mutex);
+    free(queue->wake);
+    free(queue->threads);
+    memset(queue, 0, sizeof(LoadQueue));
+}
+
+bool load_queue_start(LoadQueue* queue, u32 threads) {
+    if (!queue) return false;
+    memset(queue, 0, sizeof(LoadQueue));
+    if (threads < 1) threads = 1;
+    if (threads > LOAD_QUEUE_MAX_THREADS) threads = LOAD_QUEUE_MAX_THREADS;
+
+    queue->capacity = LOAD_QUEUE_CAPACITY;
+    queue->jobs = (LoadJob*)calloc(queue->capacity, sizeof(LoadJob));
+    pthread_mutex_t* mutex = (pthread_mutex_t*)malloc(sizeof(pthread_mutex_t));
+    pthread_cond_t* wake = (pthread_cond_t*)malloc(sizeof(pthread_cond_t));
+    pthread_t* handles = (pthread_t*)calloc(threads, sizeof(pthread_t));
+
+    bool ok = queue->jobs && mutex && wake && handles;
+    if (ok && pthread_mutex_init(mutex, NULL) == 0) {
+        queue->mutex = mutex;
+    } else {
+        free(mutex);
+        ok = false;
+    }
+    if (ok && pthread_cond_init(wake, NULL) == 0) {
+        queue->wake = wake;
+    } else {
+        free(wake);
+        ok = false;
+    }
+
+    if (ok) {
+        queue->threads = handles;
+        queue->running = true;
+
+        /* Signals stay on the game thread, as for the network thread */
+        sigset_t all, previous;
+        sigfillset(&all);
+        pthread_sigmask(SIG_BLOCK, &all, &previous);
+        while (queue->thread_count < threads &&
+               pthread_create(&handles[queue->thread_count], NULL, load_queue_thread_main, queue) == 0) {
+            queue->thread_count++;
+        }
+        pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+        if (queue->thread_count == 0) {
+            queue->running = false;
+            ok = false;
+        }
+    } else {
+        free(handles);
+    }
+
+    if (!ok) {
+        load_queue_free(queue);
+        fprintf(stderr, "WARNING: Login workers not started, logins are handled synchronously\n");
+        return false;
+    }
+
+    g_load_queue = queue;
+    printf("Login workers started (%u thread%s, %u job queue)\n", queue->thread_count,
+           queue->thread_count == 1 ? "" : "s", queue->capacity);
+    return true;
+}
+
+void load_queue_stop(LoadQueue* queue) {
+    if (!queue || !queue->running) return;  /* Never started, or already stopped */
+    if (g_load_queue == queue) g_load_queue = NULL;
+
+    pthread_mutex_lock(QUEUE_MUTEX(queue));
+    queue->running = false;
+    pthread_cond_broadcast(QUEUE_WAKE(queue));
+    pthread_mutex_unlock(QUEUE_MUTEX(queue));
+
+    /* Each finishes at most the job in progress */
+    for (u32 i = 0; i < queue->thread_count; i++) {
+        pthread_join(((pthread_t*)queue->threads)[i], NULL);
+    }
+
+    printf("Login workers stopped (%llu logins, %llu found a save, %llu rejected)\n",
+           (unsigned long long)queue->submitted, (unsigned long long)queue->found,
+           (unsigned long long)queue->rejected);
+    load_queue_free(queue);
+}
+
+bool load_queue_submit(LoadQueue* queue, u32 slot, const u8* block, u32 size, u32* ticket) {
+    if (!queue || !block || !ticket || size > LOGIN_BLOCK_MAX) return false;
+
+    pthread_mutex_lock(QUEUE_MUTEX(queue));
+    bool queued = false;
+
+    if (queue->running && queue->count < queue->capacity) {
+        LoadJob* job = &queue->jobs[(queue->head + queue->count) % queue->capacity];
+        if (++queue->next_ticket == 0) queue->next_ticket = 1;  /* 0 = no ticket */
+        job->slot = slot;
+        job->ticket = queue->next_ticket;
+        memcpy(job->block, block, size);
+        job->block_size = size;
+        job->status = LOAD_PENDING;
+        job->size = 0;
+
+        queue->count++;
+        queue->submitted++;
+        pthread_cond_signal(QUEUE_WAKE(queue));
+        *ticket = job->ticket;
+        queued = true;
+    }
+
+    pthread_mutex_unlock(QUEUE_MUTEX(queue));
+    return queued;
+}
+
+const LoadJob* load_queue_peek(LoadQueue* queue) {
+    if (!queue || !queue->running) return NULL;
+
+    pthread_mutex_lock(QUEUE_MUTEX(queue));
+    const LoadJob* job = queue->done > 0 ? &queue->jobs[queue->head] : NULL;
+    pthread_mutex_unlock(QUEUE_MUTEX(queue));
+    return job;
+}
+
+void load_queue_pop(LoadQueue* queue) {
+    if (!queue || !queue->running) return;
+
+    pthread_mutex_lock(QUEUE_MUTEX(queue));
+    if (queue->done > 0) {
+        LoadJob* job = &queue->jobs[queue->head];
+        memset(&job->login, 0, sizeof(job->login));  /* Credentials */
+        queue->head = (queue->head + 1) % queue->capacity;
+        queue->count--;
+        queue->claimed--;
+        queue->done--;
+    }
+    pthread_mutex_unlock(QUEUE_MUTEX(queue));
+}
+
+bool load_queue_busy(LoadQueue* queue) {
+    if (!queue || !queue->running) return false;
+
+    pthread_mutex_lock(QUEUE_MUTEX(queue));
+    bool busy = queue->count > 0;
+    pthread_mutex_unlock(QUEUE_MUTEX(queue));
+    return busy;
+}
+
+u32 load_queue_pending(LoadQueue* queue) {
+    if (!queue || !queue->running) return 0;
+
+    pthread_mutex_lock(QUEUE_MUTEX(queue));
+    u32 count = queue->count;
+    pthread_mutex_unlock(QUEUE_MUTEX(queue));
+    return count;
+}
+
+#else /* _WIN32 */
+
+/*
+ * Windows: no worker threads (pthreads unavailable with MSVC).
+ * g_load_queue stays NULL and login_process_header() decodes and loads
+ * synchronously.
+ */
+bool load_queue_start(LoadQueue* queue, u32 threads) {
+    (void)queue; (void)threads;
+    fprintf(stderr, "WARNING: Login workers not supported on this platform, logins are handled synchronously\n");
+    return false;
+}
+void load_queue_stop(LoadQueue* queue) { (void)queue; }
+bool load_queue_submit(LoadQueue* queue, u32 slot, const u8* block, u32 size, u32* ticket) {
+    (void)queue; (void)slot; (void)block; (void)size; (void)ticket;
+    return false;
+}
+const LoadJob* load_queue_peek(LoadQueue* queue) { (void)queue; return NULL; }
+void load_queue_pop(LoadQueue* queue) { (void)queue; }
+bool load_queue_busy(LoadQueue* queue) { (void)queue; return false; }
+u32 load_queue_pending(LoadQueue* queue) { (void)queue; return 0; }
+
+#endif /* _WIN32 */
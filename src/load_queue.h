@@ -0,0 +1,224 @@
+/*******************************************************************************
+ * LOAD_QUEUE.H - Login Workers: RSA Block Decoding and Player Loading
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Turning a blocking call into request → worker → completion
+ *   - Pipelining: the tick keeps running while a login waits on disk
+ *   - A small worker pool that still completes in request order
+ *   - Stale completions (the requester may be gone when the answer arrives)
+ *
+ * THE PROBLEM:
+ *
+ * A login costs two slow things before the client can be answered: the
+ * RSA private-key operation on its login block (rsa_key.h, tens of
+ * microseconds) and the read of its save file. Done inline on the game
+ * thread, a reconnect storm after a restart is served one login at a time:
+ *
+ *   server_process_packets():  |login 1: rsa, read|login 2: rsa, read|...
+ *                              └──── 300 serial logins, nobody moves ────┘
+ *
+ * THE SOLUTION - DECODE AND LOAD ON WORKERS, FINISH ON THE TICK THREAD:
+ *
+ *   GAME THREAD                              WORKER THREADS (1..N)
+ *   login_process_header()                   loop:
+ *     parse header (version, CRCs)             claim the oldest pending job
+ *     state = LOGGING_IN                       login_decode_block(block)
+ *     load_queue_submit(slot, block) ──→         (RSA decrypt, parse)
+ *     return                                   player_load_read(username)
+ *   ...                                        mark job done
+ *   server_finish_logins():          ←─────────────┘
+ *     load_queue_peek() → job
+ *     login_accept(): credentials, ISAAC seeds
+ *     login_complete(): LOGIN_RESPONSE_OK, parse save, LOGGED_IN
+ *     send initial game packets
+ *
+ * The workers only turn bytes into bytes - a block into credentials, a
+ * username into a save; everything that touches the Player or game state
+ * stays on the game thread.
+ *
+ * ONE RING, FOUR REGIONS:
+ *
+ * Jobs are claimed in order but finish in any order (one worker may be
+ * reading a large save while another decrypts). The ring keeps them in
+ * request order and hands the game thread only the finished prefix:
+ *
+ *   jobs: [ done | done | in flight / done | pending ][ free ... ]
+ *           ↑ head       ↑ head + done       ↑ head + claimed  ↑ head + count
+ *           game thread  each owned by the   game thread appends here
+ *           reads these  worker that claimed it
+ *
+ * Each job has exactly one owner at a time, so blocks and saves are
+ * written straight into the job and the mutex only protects the counters
+ * and job status. A job finishing out of order waits (already done)
+ * until the ones before it are; logins cost about the same, so this
+ * head-of-line wait is short and the game thread sees them in order.
+ *
+ * STALE RESULTS:
+ *   A client can drop while its login is in flight and the slot can be
+ *   taken by a new connection before the result arrives. Every request
+ *   gets a ticket number, kept in Player.login_ticket; a result is applied
+ *   only if the slot is still LOGGING_IN with the same ticket.
+ *
+ * BACK-PRESSURE:
+ *   Login admission (login.h) answers TRY_AGAIN once LOGIN_BACKLOG_MAX
+ *   jobs are in the ring, well before it fills. Should it fill anyway
+ *   (or no worker is running) the login is decoded and loaded
+ *   synchronously, as before.
+ *
+ * PLATFORM:
+ *   POSIX threads. On Windows load_queue_start() fails, g_load_queue stays
+ *   NULL and every login is handled synchronously.
+ *
+ ******************************************************************************/
+
+#ifndef LOAD_QUEUE_H
+#define LOAD_QUEUE_H
+
+#include "types.h"
+#include "login.h"
+#include <stdbool.h>
+
+/* Logins that can wait for the workers at once */
+#define LOAD_QUEUE_CAPACITY 512
+
+/* Default worker count (--login-threads N) and upper bound */
+#define LOAD_QUEUE_THREADS 2
+#define LOAD_QUEUE_MAX_THREADS 16
+
+/*
+ * LOAD_QUEUE_POLL_MS - Longest the event loop sleeps while loads are out
+ *
+ * The workers do not wake the event loop; server_run() shortens its
+ * wait to this while jobs are outstanding, so a finished login waits at
+ * most this long (instead of until the next packet or tick).
+ */
+#define LOAD_QUEUE_POLL_MS 2
+
+/*
+ * LoadStatus - Outcome of one load request
+ */
+typedef enum {
+    LOAD_PENDING = 0,       /* Not processed yet */
+    LOAD_FOUND,             /* login decoded; data/size hold the save */
+    LOAD_MISSING,           /* login decoded; no usable save: the player is new */
+    LOAD_FAILED,            /* login decoded; save not buffered: load synchronously */
+    LOAD_REJECTED,          /* Block did not decode (bad RSA, malformed) */
+    LOAD_ONLINE             /* login decoded; another world holds the account */
+} LoadStatus;
+
+/*
+ * LoadJob - One login waiting for its block to be decoded and its save
+ */
+typedef struct {
+    u32 slot;               /* Player slot that asked */
+    u32 ticket;             /* Must match Player.login_ticket */
+    u8 block[LOGIN_BLOCK_MAX];  /* RSA block as received */
+    u32 block_size;
+    LoginBlock login;       /* Decoded block (status != LOAD_REJECTED) */
+    LoadStatus status;      /* Written under the mutex */
+    u8* data;               /* Save bytes (heap, reused between jobs) */
+    u32 size;               /* Bytes in data */
+    u32 data_capacity;      /* Allocated bytes in data */
+} LoadJob;
+
+/*
+ * LoadQueue - Ring of jobs (see above) plus the worker threads
+ *
+ * head, count, claimed, done and the statistics are protected by the mutex.
+ */
+typedef struct {
+    LoadJob* jobs;
+    u32 capacity;
+    u32 head;               /* Oldest job */
+    u32 count;              /* Jobs in the ring */
+    u32 claimed;            /* ...of which taken by a worker (the first claimed) */
+    u32 done;               /* ...of which finished in order (the first done) */
+    u32 next_ticket;        /* Game thread only */
+
+    u64 submitted;          /* Requests accepted */
+    u64 found;              /* ...that found a save */
+    u64 rejected;           /* ...whose block did not decode */
+
+    bool running;
+    void* mutex;            /* pthread_mutex_t (opaque, as in netio.h) */
+    void* wake;             /* pthread_cond_t: request queued / stop requested */
+    void* threads;          /* pthread_t[thread_count] */
+    u32 thread_count;
+} LoadQueue;
+
+/*
+ * g_load_queue - Running workers, or NULL (logins are handled synchronously)
+ */
+extern LoadQueue* g_load_queue;
+
+/*
+ * g_load_queue_threads - Workers server_init() starts (--login-threads N)
+ */
+extern u32 g_load_queue_threads;
+
+/*
+ * load_queue_start - Allocate the ring and start the worker threads
+ *
+ * @param queue    Zeroed LoadQueue to initialize
+ * @param threads  Workers (clamped to 1..LOAD_QUEUE_MAX_THREADS)
+ * @return         true if at least one worker started; sets g_load_queue
+ */
+bool load_queue_start(LoadQueue* queue, u32 threads);
+
+/*
+ * load_queue_stop - Stop the workers and free the ring
+ *
+ * Pending requests are dropped: their players are still LOGGING_IN and
+ * are disconnected (unsaved, as they never logged in) by the caller.
+ * Safe to call more than once. Clears g_load_queue.
+ */
+void load_queue_stop(LoadQueue* queue);
+
+/*
+ * load_queue_submit - Ask the workers to decode a login block and load its save
+ *
+ * @param queue   Running queue (NULL-safe: returns false)
+ * @param slot    Player slot to deliver to
+ * @param block   RSA block as received (copied)
+ * @param size    Bytes in block (at most LOGIN_BLOCK_MAX)
+ * @param ticket  Receives the request's ticket (never 0)
+ * @return        true if queued; false if full or not running (the
+ *                caller decodes and loads synchronously)
+ *
+ * COMPLEXITY: O(size)
+ */
+bool load_queue_submit(LoadQueue* queue, u32 slot, const u8* block, u32 size, u32* ticket);
+
+/*
+ * load_queue_peek - Oldest finished job, or NULL
+ *
+ * @param queue  Queue (NULL-safe)
+ * @return       Job owned by the caller until load_queue_pop()
+ */
+const LoadJob* load_queue_peek(LoadQueue* queue);
+
+/*
+ * load_queue_pop - Release the job returned by load_queue_peek()
+ */
+void load_queue_pop(LoadQueue* queue);
+
+/*
+ * load_queue_busy - Whether any job is still in the ring
+ *
+ * @param queue  Queue (NULL-safe: returns false)
+ */
+bool load_queue_busy(LoadQueue* queue);
+
+/*
+ * load_queue_pending - Jobs in the ring: waiting, in work or finished
+ *
+ * Every one is a login admitted but not yet completed (login admission
+ * counts them against LOGIN_BACKLOG_MAX).
+ *
+ * @param queue  Queue (NULL-safe: returns 0)
+ */
+u32 load_queue_pending(LoadQueue* queue);
+
+#endif /* LOAD_QUEUE_H */
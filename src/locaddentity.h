@@ -2,7 +2,7 @@
 
 #include "datastruct/linkable.h"
 
-typedef struct {
+typedef struct LocAddEntity {
     Linkable link;
     int plane;
     int layer;
@@ -14,4 +14,5 @@ typedef struct {
     int lastLocIndex;
     int lastAngle;
     int lastShape;
+    struct LocAddEntity *zone_next; // custom: next in the same Client.spawned_zones chain
 } LocAddEntity;
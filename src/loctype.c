@@ -31,10 +31,7 @@ void loctype_unpack(Jagfile *config) {
         offset += g2(idx);
     }
 
-    _LocType.cache = calloc(10, sizeof(LocType *));
-    for (int id = 0; id < 10; id++) {
-        _LocType.cache[id] = loctype_new();
-    }
+    _LocType.decoded = calloc(_LocType.count, sizeof(LocType *));
 
     packet_free(idx);
 }
@@ -43,22 +40,23 @@ void loctype_free_global(void) {
     lrucache_free(_LocType.modelCacheStatic);
     lrucache_free(_LocType.modelCacheDynamic);
     free(_LocType.offsets);
-    for (int i = 0; i < 10; i++) {
-        free(_LocType.cache[i]);
+    for (int i = 0; i < _LocType.count; i++) {
+        free(_LocType.decoded[i]);
     }
-    free(_LocType.cache);
+    free(_LocType.decoded);
     packet_free(_LocType.dat);
 }
 
 LocType *loctype_get(int id) {
-    for (int i = 0; i < 10; i++) {
-        if (_LocType.cache[i]->index == id) {
-            return _LocType.cache[i];
-        }
+    // custom: a scene build asks for the same few hundred ids thousands of times, the
+    // 10 slot ring decoded them again on nearly every call once more than 10 were in use.
+    // Decoding every loc, obj and npc id up front would cost ~3.4ms, so ids decode lazily
+    LocType *loc = _LocType.decoded[id];
+    if (loc) {
+        return loc;
     }
 
-    _LocType.cachePos = (_LocType.cachePos + 1) % 10;
-    LocType *loc = _LocType.cache[_LocType.cachePos];
+    loc = _LocType.decoded[id] = loctype_new();
     _LocType.dat->pos = _LocType.offsets[id];
     loc->index = id;
     loctype_reset(loc);
@@ -299,7 +297,7 @@ Model *loctype_get_model(LocType *loc, int shape, int rotation, int heightmapSW,
         if (flipped) {
             model_rotate_y180(model);
         }
-        lrucache_put(_LocType.modelCacheStatic, modelId, &model->link);
+        lrucache_put_sized(_LocType.modelCacheStatic, modelId, &model->link, model_size(model));
     }
 
     bool scaled = loc->resizex != 128 || loc->resizey != 128 || loc->resizez != 128;
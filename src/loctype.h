@@ -80,8 +80,7 @@ typedef struct {
     int count;
     int *offsets;
     Packet *dat;
-    LocType **cache;
-    int cachePos;
+    LocType **decoded; // custom: by id, decoded on first get and kept (was a ring of 10 re-decoded slots)
 } LocTypeData;
 
 void loctype_unpack(Jagfile *config);
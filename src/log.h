@@ -0,0 +1,159 @@
+/*******************************************************************************
+ * LOG.H - Leveled, Compile-Time Removable Logging
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Zero-cost abstractions with the C preprocessor
+ *   - Separating build-time and run-time configuration
+ *   - Why logging on hot paths is a throughput problem
+ *
+ * THE PROBLEM:
+ *
+ * stdout is a single shared stream. Every printf() takes its lock, formats
+ * and (when stdout is a pipe or terminal) eventually does a write(). With
+ * hex dumps on every send()/recv() and per-candidate logs in the player
+ * update, a busy server spends more time logging than simulating:
+ *
+ *   per tick, 500 players:  500 x PLAYER_INFO "Third pass" logs
+ *                           500 x TX hex dumps (~3 printf per byte!)
+ *                           N   x RX hex dumps + ISAAC decode logs
+ *
+ * THE SOLUTION - TWO GATES:
+ *
+ *   LOG_DEBUG("x=%u", x)
+ *        │
+ *        ▼
+ *   ┌───────────────────────────┐  no   ┌────────────────────────────┐
+ *   │ level <= LOG_COMPILE_LEVEL│ ────→ │ if (0 && ...) - the whole  │
+ *   │ (constant, build time)    │       │ statement is compiled out  │
+ *   └───────────────────────────┘       └────────────────────────────┘
+ *        │ yes
+ *        ▼
+ *   ┌───────────────────────────┐  no
+ *   │ level <= g_log_level      │ ────→ skipped: one predictable branch,
+ *   │ (variable, run time)      │       arguments are never evaluated
+ *   └───────────────────────────┘
+ *        │ yes
+ *        ▼
+ *     log_write() ── formatted, queued for the log writer thread
+ *                    (log_sink.h): the caller never waits on stdout
+ *
+ * TRACE AND HEX LOGGING (per subsystem, opt-in):
+ *   Protocol-level logging (packet traces, hex dumps, per-tick update
+ *   internals) is far too noisy to enable globally. LOG_TRACE() and
+ *   LOG_HEX() take a subsystem bit and only fire if that subsystem was
+ *   enabled at run time (--log=net,packet,...). They are compiled out when
+ *   LOG_COMPILE_LEVEL < LOG_LEVEL_TRACE.
+ *
+ * CONFIGURATION:
+ *   Build time:  make LOG_LEVEL=3        (compile out DEBUG and TRACE)
+ *   Run time:    --log-level=warn        (error, warn, info, debug, trace)
+ *                --log=net,packet        (subsystems, or "all")
+ *                --log-file=server.log   (instead of stdout/stderr)
+ *                --log-rotate=64         (MB before the file rotates, 0 = never)
+ *                --log-sync              (write on the logging thread, no writer)
+ *
+ ******************************************************************************/
+
+#ifndef LOG_H
+#define LOG_H
+
+#include "types.h"
+#include <stdbool.h>
+
+/* Severity levels (lower = more important) */
+#define LOG_LEVEL_NONE   0
+#define LOG_LEVEL_ERROR  1
+#define LOG_LEVEL_WARN   2
+#define LOG_LEVEL_INFO   3
+#define LOG_LEVEL_DEBUG  4
+#define LOG_LEVEL_TRACE  5
+
+/*
+ * LOG_COMPILE_LEVEL - Most verbose level compiled into the binary
+ *
+ * Defaults to TRACE so every message can be enabled at run time;
+ * production builds pass -DLOG_COMPILE_LEVEL=LOG_LEVEL_INFO (or
+ * make LOG_LEVEL=3) to remove debug code from the hot paths entirely.
+ */
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL LOG_LEVEL_TRACE
+#endif
+
+/* Subsystems for LOG_TRACE / LOG_HEX (bit mask) */
+#define LOG_NET       (1u << 0)   /* Raw socket bytes (RX/TX hex dumps) */
+#define LOG_PACKET    (1u << 1)   /* Decoded packets: opcodes, lengths, ISAAC */
+#define LOG_LOGIN     (1u << 2)   /* Login handshake internals */
+#define LOG_UPDATE    (1u << 3)   /* Player update (PLAYER_INFO) internals */
+#define LOG_WORLD     (1u << 4)   /* Per-tick world processing */
+#define LOG_MOVEMENT  (1u << 5)   /* Movement packets and pathing */
+#define LOG_ALL       0xFFFFFFFFu
+
+/* Run-time configuration (see log_configure) */
+extern i32 g_log_level;
+extern u32 g_log_subsystems;
+extern bool g_log_sync;             /* --log-sync: no writer thread */
+extern const char* g_log_file;      /* --log-file, or NULL for stdout/stderr */
+extern u32 g_log_rotate_mb;         /* --log-rotate */
+
+#define LOG_ENABLED(level) \
+    ((level) <= LOG_COMPILE_LEVEL && (level) <= g_log_level)
+
+#define LOG_SUBSYSTEM_ENABLED(sub) \
+    (LOG_LEVEL_TRACE <= LOG_COMPILE_LEVEL && (g_log_subsystems & (sub)) != 0)
+
+#define LOG_AT(level, ...) \
+    do { if (LOG_ENABLED(level)) log_write((level), __VA_ARGS__); } while (0)
+
+#define LOG_ERROR(...)  LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+#define LOG_WARN(...)   LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_INFO(...)   LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_DEBUG(...)  LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+
+/*
+ * LOG_TRACE - Protocol-level message for one subsystem
+ *
+ * USAGE:
+ *   LOG_TRACE(LOG_PACKET, "[RX] op=%u len=%u\n", opcode, length);
+ */
+#define LOG_TRACE(sub, ...) \
+    do { if (LOG_SUBSYSTEM_ENABLED(sub)) log_write(LOG_LEVEL_TRACE, __VA_ARGS__); } while (0)
+
+/*
+ * LOG_HEX - Hex dump of a byte range for one subsystem
+ *
+ * OUTPUT FORMAT:
+ *   [HEX] TX len=3: 01 02 03
+ */
+#define LOG_HEX(sub, tag, data, len) \
+    do { if (LOG_SUBSYSTEM_ENABLED(sub)) log_hex((tag), (data), (len)); } while (0)
+
+/*
+ * log_write - Emit one formatted message (use the macros instead)
+ *
+ * ERROR and WARN go to stderr, everything else to stdout (or all to
+ * --log-file). While the log writer runs (log_sink.h) the line is queued
+ * for it; otherwise it is written here with a single stdio call, so lines
+ * from the network thread and the game thread never interleave mid-line.
+ */
+void log_write(i32 level, const char* fmt, ...);
+
+/*
+ * log_hex - Emit a hex dump as one line (use LOG_HEX instead)
+ */
+void log_hex(const char* tag, const u8* data, u32 len);
+
+/*
+ * log_configure - Apply one command-line option
+ *
+ * @param arg  "--log-level=<name>", "--log=<subsystem,...>",
+ *             "--log-file=<path>", "--log-rotate=<MB>" or "--log-sync"
+ * @return     true if arg was a logging option (valid or not)
+ *
+ * Level names:     none, error, warn, info, debug, trace
+ * Subsystem names: net, packet, login, update, world, movement, all
+ */
+bool log_configure(const char* arg);
+
+#endif /* LOG_H */
@@ -0,0 +1,263 @@
+/*******************************************************************************
+ * LOG_SINK.C - Log Output on a Writer Thread Implementation
+ *******************************************************************************
+ *
+ * See log_sink.h for the queue and why a full queue drops lines.
+ *
+ * WRITER THREAD LOOP:
+ *
+ *   while running or lines queued:
+ *       write every published slot (in position order), free each slot
+ *       lines were dropped since last time? → write "N log lines dropped"
+ *       wrote something → fflush; nothing → sleep LOG_SINK_IDLE_NS
+ *
+ * The writer polls instead of waiting on a condition variable: a producer
+ * would need the mutex to signal one without losing the wake-up, and the
+ * whole point is that producers never take a lock. Two milliseconds of
+ * latency on a log line is invisible.
+ *
+ ******************************************************************************/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include "log_sink.h"
+#include "log.h"
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+LogSink* g_log_sink = NULL;
+
+#ifndef _WIN32
+
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+
+#define load_acquire(p)     __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define load_relaxed(p)     __atomic_load_n((p), __ATOMIC_RELAXED)
+#define store_release(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+/* Writer's sleep when nothing is queued */
+#define LOG_SINK_IDLE_NS 2000000L
+
+bool log_sink_push(LogSink* sink, i32 level, const char* text, u32 length) {
+    if (!sink || !load_relaxed(&sink->running)) return false;
+
+    u32 pos = load_relaxed(&sink->enqueue);
+    LogSlot* slot;
+    for (;;) {
+        slot = &sink->slots[pos & (LOG_SINK_SLOTS - 1)];
+        i32 diff = (i32)(load_acquire(&slot->seq) - pos);
+        if (diff == 0) {
+            /* Free for pos: claim it (on failure pos is reloaded) */
+            if (__atomic_compare_exchange_n(&sink->enqueue, &pos, pos + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            /* Not read since the last lap: full, drop the line */
+            __atomic_fetch_add(&sink->dropped, 1, __ATOMIC_RELAXED);
+            return true;
+        } else {
+            /* Another producer claimed pos first */
+            pos = load_relaxed(&sink->enqueue);
+        }
+    }
+
+    if (length > LOG_SINK_LINE) length = LOG_SINK_LINE;
+    memcpy(slot->text, text, length);
+    slot->length = length;
+    slot->level = level;
+    store_release(&slot->seq, pos + 1);
+    return true;
+}
+
+/*
+ * sink_output - Where a line goes: the file, or stdout/stderr by level
+ */
+static FILE* sink_output(LogSink* sink, i32 level) {
+    if (sink->file) return (FILE*)sink->file;
+    return level <= LOG_LEVEL_WARN ? stderr : stdout;
+}
+
+/*
+ * sink_rotate - FILE → FILE.1 → FILE.2 ... and start a new FILE
+ *
+ * If the new file cannot be opened, lines go to stdout/stderr from here on.
+ */
+static void sink_rotate(LogSink* sink) {
+    char from[sizeof(sink->path) + 16];
+    char to[sizeof(sink->path) + 16];
+
+    fclose((FILE*)sink->file);
+    for (int k = LOG_SINK_KEEP - 1; k >= 1; k--) {
+        snprintf(from, sizeof(from), "%s.%d", sink->path, k);
+        snprintf(to, sizeof(to), "%s.%d", sink->path, k + 1);
+        rename(from, to);
+    }
+    snprintf(to, sizeof(to), "%s.1", sink->path);
+    rename(sink->path, to);
+
+    sink->file = fopen(sink->path, "w");
+    sink->file_bytes = 0;
+    if (!sink->file) {
+        fprintf(stderr, "WARNING: Cannot reopen log file %s, logging to stdout\n", sink->path);
+    }
+}
+
+/*
+ * sink_write - Write one line and rotate if the file is now full
+ */
+static void sink_write(LogSink* sink, i32 level, const char* text, u32 length) {
+    fwrite(text, 1, length, sink_output(sink, level));
+    sink->written++;
+    if (sink->file) {
+        sink->file_bytes += length;
+        if (sink->rotate_bytes && sink->file_bytes >= sink->rotate_bytes) sink_rotate(sink);
+    }
+}
+
+/*
+ * sink_drain - Write every published line
+ *
+ * @return  Lines written (0 if the queue was empty)
+ */
+static u32 sink_drain(LogSink* sink) {
+    u32 lines = 0;
+    for (;;) {
+        u32 pos = sink->dequeue;
+        LogSlot* slot = &sink->slots[pos & (LOG_SINK_SLOTS - 1)];
+        if (load_acquire(&slot->seq) != pos + 1) break;  /* Empty, or not published yet */
+
+        sink_write(sink, slot->level, slot->text, slot->length);
+        store_release(&slot->seq, pos + LOG_SINK_SLOTS);
+        sink->dequeue = pos + 1;
+        lines++;
+    }
+
+    u64 dropped = load_relaxed(&sink->dropped);
+    if (dropped != sink->reported) {
+        char line[64];
+        int n = snprintf(line, sizeof(line), "WARNING: %llu log lines dropped (queue full)\n",
+                         (unsigned long long)(dropped - sink->reported));
+        sink_write(sink, LOG_LEVEL_WARN, line, (u32)n);
+        sink->reported = dropped;
+        lines++;
+    }
+    return lines;
+}
+
+static void* log_sink_thread_main(void* arg) {
+    LogSink* sink = (LogSink*)arg;
+    trace_thread_name("log");
+
+    for (;;) {
+        /* Read before draining: lines pushed before the stop are all written */
+        bool running = load_acquire(&sink->running);
+        if (sink_drain(sink) > 0) {
+            if (sink->file) fflush((FILE*)sink->file);
+            fflush(stdout);
+            fflush(stderr);
+        } else if (!running) {
+            break;
+        } else {
+            struct timespec idle = { 0, LOG_SINK_IDLE_NS };
+            nanosleep(&idle, NULL);
+        }
+    }
+    return NULL;
+}
+
+bool log_sink_start(LogSink* sink, const char* path, u64 rotate_bytes) {
+    if (!sink) return false;
+    memset(sink, 0, sizeof(LogSink));
+
+    sink->slots = (LogSlot*)malloc(LOG_SINK_SLOTS * sizeof(LogSlot));
+    pthread_t* thread = (pthread_t*)malloc(sizeof(pthread_t));
+    if (!sink->slots || !thread) {
+        free(sink->slots);
+        free(thread);
+        memset(sink, 0, sizeof(LogSink));
+        fprintf(stderr, "WARNING: Log writer not started, logging synchronously\n");
+        return false;
+    }
+    for (u32 i = 0; i < LOG_SINK_SLOTS; i++) sink->slots[i].seq = i;
+
+    if (path && path[0]) {
+        snprintf(sink->path, sizeof(sink->path), "%s", path);
+        sink->file = fopen(sink->path, "a");
+        if (sink->file) {
+            fseek((FILE*)sink->file, 0, SEEK_END);
+            long size = ftell((FILE*)sink->file);
+            sink->file_bytes = size > 0 ? (u64)size : 0;
+            sink->rotate_bytes = rotate_bytes;
+        } else {
+            fprintf(stderr, "WARNING: Cannot open log file %s, logging to stdout\n", sink->path);
+        }
+    }
+
+    sink->thread = thread;
+    sink->running = true;
+
+    /* Signals stay on the game thread, as for the network thread */
+    sigset_t all, previous;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &previous);
+    int rc = pthread_create(thread, NULL, log_sink_thread_main, sink);
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+    if (rc != 0) {
+        if (sink->file) fclose((FILE*)sink->file);
+        free(sink->slots);
+        free(thread);
+        memset(sink, 0, sizeof(LogSink));
+        fprintf(stderr, "WARNING: Log writer not started, logging synchronously\n");
+        return false;
+    }
+
+    /* Anything printf()ed so far comes out before the first queued line */
+    fflush(stdout);
+    g_log_sink = sink;
+    printf("Log writer started (%u line queue, %s)\n", LOG_SINK_SLOTS,
+           sink->file ? sink->path : "stdout");
+    return true;
+}
+
+void log_sink_stop(LogSink* sink) {
+    if (!sink || !sink->running) return;  /* Never started, or already stopped */
+    if (g_log_sink == sink) g_log_sink = NULL;
+
+    store_release(&sink->running, false);
+    pthread_join(*(pthread_t*)sink->thread, NULL);
+
+    u64 written = sink->written;
+    u64 dropped = sink->dropped;
+    if (sink->file) fclose((FILE*)sink->file);
+    free(sink->slots);
+    free(sink->thread);
+    memset(sink, 0, sizeof(LogSink));
+
+    printf("Log writer stopped (%llu lines written, %llu dropped)\n",
+           (unsigned long long)written, (unsigned long long)dropped);
+}
+
+#else /* _WIN32 */
+
+/*
+ * Windows: no writer thread (pthreads unavailable with MSVC). g_log_sink
+ * stays NULL and log_write() writes directly.
+ */
+bool log_sink_start(LogSink* sink, const char* path, u64 rotate_bytes) {
+    (void)sink; (void)path; (void)rotate_bytes;
+    fprintf(stderr, "WARNING: Log writer not supported on this platform, logging synchronously\n");
+    return false;
+}
+void log_sink_stop(LogSink* sink) { (void)sink; }
+bool log_sink_push(LogSink* sink, i32 level, const char* text, u32 length) {
+    (void)sink; (void)level; (void)text; (void)length;
+    return false;
+}
+
+#endif /* _WIN32 */
@@ -0,0 +1,150 @@
+/*******************************************************************************
+ * LOG_SINK.H - Log Output on a Writer Thread
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Multi-producer/single-consumer queues without locks
+ *   - Per-slot sequence numbers (a bounded queue after Dmitry Vyukov)
+ *   - Dropping instead of blocking: the latency-critical side never waits
+ *   - Size-based log rotation
+ *
+ * THE PROBLEM:
+ *
+ * log.h keeps the noisy logs off the hot paths, but connection, login,
+ * save and error messages are still written by the thread that logs them,
+ * usually the game thread. stdout under Docker is a pipe to the log
+ * collector; when the collector falls behind the pipe fills and write()
+ * blocks, and so does every later printf() on the stdout lock:
+ *
+ *   tick: |process|LOG_INFO("Player connected") ── write() blocks ──...
+ *                                   └──── the tick waits for the pipe ────┘
+ *
+ * THE SOLUTION - QUEUE THE LINE, WRITE IT ELSEWHERE:
+ *
+ *   ANY THREAD (game, network, save)      LOG WRITER THREAD
+ *   log_write()                           loop:
+ *     vsnprintf → line (its own stack)      take published slots in order
+ *     log_sink_push(line) ──────────────→   fwrite to stdout/stderr or file
+ *       claim a slot (one CAS)              rotate the file when it is full
+ *       copy the line, publish it           fflush once per batch
+ *     return (no stdio, no syscalls)        nothing queued: sleep 2 ms
+ *
+ * THE QUEUE:
+ *   A ring of LOG_SINK_SLOTS fixed slots, each with a sequence number:
+ *
+ *     slot.seq == pos        free for the producer that claims pos
+ *     slot.seq == pos + 1    published, the writer may read it
+ *     slot.seq == pos + N    read, free again for position pos + N
+ *
+ *   Producers race for positions with a compare-and-swap on enqueue; a
+ *   claimed slot belongs to one producer until it stores seq = pos + 1
+ *   (RELEASE). The single writer needs no atomic read-modify-write at all:
+ *   it checks seq (ACQUIRE), copies the line out and hands the slot back.
+ *
+ * NEVER BLOCK:
+ *   If the slot a producer would claim has not been read yet, the queue is
+ *   full: the line is dropped and counted, and the writer reports the count
+ *   ("N log lines dropped") once it catches up. A stalled pipe or disk costs
+ *   log lines, never a tick.
+ *
+ * ROTATION (--log-file):
+ *   Lines go to the file instead of stdout/stderr. When it grows past the
+ *   limit (--log-rotate=MB, default 64) it is renamed to FILE.1 (FILE.1 to
+ *   FILE.2, ... up to LOG_SINK_KEEP) and a new FILE is started.
+ *
+ * ORDER:
+ *   Lines keep the order they were claimed in. Startup and shutdown
+ *   banners are still printf()ed directly and can overtake queued lines by
+ *   a few milliseconds.
+ *
+ * PLATFORM:
+ *   POSIX threads. On Windows log_sink_start() fails and log_write()
+ *   writes directly, as with --log-sync.
+ *
+ ******************************************************************************/
+
+#ifndef LOG_SINK_H
+#define LOG_SINK_H
+
+#include "types.h"
+#include <stdbool.h>
+
+/* Queued lines before producers start dropping (power of two) */
+#define LOG_SINK_SLOTS 1024
+
+/* Longest line, as log_write() formats it */
+#define LOG_SINK_LINE 1024
+
+/* Rotated files kept next to --log-file (FILE.1 .. FILE.N) */
+#define LOG_SINK_KEEP 5
+
+/*
+ * LogSlot - One queued line
+ */
+typedef struct {
+    u32 seq;                    /* See THE QUEUE above (atomic) */
+    i32 level;                  /* LOG_LEVEL_*: stdout or stderr */
+    u32 length;                 /* Bytes in text */
+    char text[LOG_SINK_LINE];
+} LogSlot;
+
+/*
+ * LogSink - The queue plus the writer thread and its output
+ */
+typedef struct {
+    LogSlot* slots;
+    u32 enqueue;                /* Next position to claim (producers, CAS) */
+    u32 dequeue;                /* Next position to read (writer only) */
+
+    u64 dropped;                /* Lines lost to a full queue (atomic) */
+    u64 reported;               /* ...of which the writer has reported */
+    u64 written;                /* Lines written */
+
+    char path[512];             /* --log-file, or "" for stdout/stderr */
+    void* file;                 /* FILE* open on path */
+    u64 file_bytes;             /* Bytes in the current file */
+    u64 rotate_bytes;           /* Rotate past this many, 0 = never */
+
+    bool running;               /* Cleared by log_sink_stop (atomic) */
+    void* thread;               /* pthread_t */
+} LogSink;
+
+/*
+ * g_log_sink - Running writer, or NULL (log_write writes directly)
+ */
+extern LogSink* g_log_sink;
+
+/*
+ * log_sink_start - Allocate the queue and start the writer thread
+ *
+ * @param sink          Zeroed LogSink to initialize
+ * @param path          File to write, or NULL/"" for stdout and stderr
+ * @param rotate_bytes  Rotate the file past this size, 0 = never
+ * @return              true on success; sets g_log_sink
+ */
+bool log_sink_start(LogSink* sink, const char* path, u64 rotate_bytes);
+
+/*
+ * log_sink_stop - Write every queued line, then stop the thread
+ *
+ * Clears g_log_sink, so later lines are written directly. Call once every
+ * other thread that logs has stopped. Safe to call more than once.
+ */
+void log_sink_stop(LogSink* sink);
+
+/*
+ * log_sink_push - Queue one formatted line
+ *
+ * @param sink    Running sink
+ * @param level   LOG_LEVEL_* (ERROR and WARN go to stderr without a file)
+ * @param text    Line, newline included
+ * @param length  Bytes in text (longer lines are cut at LOG_SINK_LINE)
+ * @return        false if the sink is not running (write it yourself);
+ *                true if queued or dropped because the queue was full
+ *
+ * Lock-free: safe from any thread, never waits for the writer.
+ */
+bool log_sink_push(LogSink* sink, i32 level, const char* text, u32 length);
+
+#endif /* LOG_SINK_H */
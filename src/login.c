@@ -215,19 +215,17 @@
  *   }
  *   
  *   // Stage 2: Wait for login header (in select/epoll loop)
- *   StreamBuffer* in = buffer_create(512);
- *   ssize_t received = network_receive(client_socket, in->data, 512);
- *   in->position = received;
- *   in->bit_position = 0;
+ *   u8 bytes[512];
+ *   ssize_t received = network_receive(client_socket, bytes, sizeof(bytes));
+ *   StreamBuffer in;
+ *   buffer_init_view(&in, bytes, (u32)received);
  *   
- *   if (!login_process_header(player, in)) {
+ *   if (!login_process_header(player, &in)) {
  *       fprintf(stderr, "Login failed for %s\n", player->username);
- *       buffer_destroy(in);
  *       player_destroy(player);
  *       close(client_socket);
  *       return;
  *   }
- *   buffer_destroy(in);
  *   
  *   // Stage 3: Finalize login
  *   login_send_initial_packets(player);
@@ -239,9 +237,18 @@
  */
 
 #include "login.h"
+#include "log.h"
 #include "network.h"
 #include "world.h"
 #include "player_save.h"
+#include "load_queue.h"
+#include "rsa_key.h"
+#include "replay.h"
+#include "command.h"
+#include "account_registry.h"
+#include "presence.h"
+#include "supervisor.h"
+#include "session.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -265,10 +272,11 @@
  *      - 4 bytes for seed1 (u32)
  *      - 4 bytes for seed2 (u32)
  *
- *   2. Seed random number generator with current time
- *      - srand(time(NULL))
- *      - WARNING: time(NULL) provides only second-level granularity
- *      - Multiple connections in same second get same seed!
+ *   2. Seed random number generator with current time, once
+ *      - srand(time(NULL)) on the first connection only
+ *      - Reseeding per connection gave every connection in the same
+ *        second the same seeds - a reconnect storm after a restart
+ *        handed hundreds of clients identical server seeds
  *
  *   3. Generate two random 32-bit values
  *      - seed1 = rand()
@@ -281,12 +289,11 @@
  *      - Big-endian ensures cross-platform compatibility
  *
  *   5. Transmit buffer to client socket
- *      - network_send(socket, data, length)
- *      - Blocking send (waits until all 8 bytes sent or error)
+ *      - player_out_commit(player) → network_send(socket, data, length)
+ *      - Arena is reset afterwards (nothing to free)
  *
- *   6. Cleanup and return status
- *      - buffer_destroy(out) frees memory
- *      - Return true if sent > 0, false otherwise
+ *   6. Return status
+ *      - Return true if all 8 bytes were sent, false otherwise
  *
  * PACKET STRUCTURE
  * ----------------
@@ -310,8 +317,8 @@
  *
  *   2. Low Entropy:
  *      - srand(time(NULL)) has at most 32 bits of entropy
- *      - Multiple connections in same second share seed
- *      - Attacker can guess seed by knowing connection time
+ *      - Seeded once, so connections no longer share seeds, but the
+ *        whole sequence follows from the server's start time
  *
  *   3. Recommended Fix:
  *      - Use /dev/urandom on Unix:
@@ -364,21 +371,22 @@
  *
  * SPACE COMPLEXITY
  * ----------------
- *   O(1) - Fixed 8-byte buffer allocation
+ *   O(1) - 8 bytes written into the player's output arena (no allocation)
  */
 bool login_process_connection(Player* player) {
-    /* Allocate output buffer for 8 bytes (2x u32) */
-    StreamBuffer* out = buffer_create(8);
+    /* Seed packet (2x u32) goes through the player's output arena */
+    StreamBuffer* out = player_out(player);
     
     /* 
-     * Seed the random number generator with current Unix timestamp.
-     * WARNING: This is called for EVERY connection, reseeding with same
-     * value if multiple connections occur in the same second. This reduces
-     * randomness and makes seeds predictable.
-     * 
-     * BETTER APPROACH: Seed once at server startup, or use better RNG.
+     * Seed the random number generator with current Unix timestamp, once.
+     * Reseeding here on every connection restarted the sequence, so all
+     * connections accepted in the same second were sent the same seeds.
      */
-    srand(time(NULL));
+    static bool seeded = false;
+    if (!seeded) {
+        srand((unsigned)time(NULL));
+        seeded = true;
+    }
     
     /* Generate two pseudo-random 32-bit seeds */
     u32 seed1 = rand();
@@ -397,16 +405,14 @@ bool login_process_connection(Player* player) {
     
     /* 
      * Send 8-byte seed packet to client.
-     * network_send() returns number of bytes sent, or -1/0 on error.
+     * player_out_commit() returns false if the socket rejected the write;
+     * either way the arena is reset for the next packet.
      */
-    i32 sent = network_send(player->socket_fd, out->data, out->position);
-    
-    /* Free buffer memory (no longer needed) */
-    buffer_destroy(out);
+    bool sent = player_out_commit(player);
     
     /* Log success for debugging */
-    if (sent > 0) {
-        printf("Sent server seed to player %u\n", player->index);
+    if (sent) {
+        LOG_INFO("Sent server seed to player %u\n", player->index);
         return true;
     }
     
@@ -414,6 +420,60 @@ bool login_process_connection(Player* player) {
     return false;
 }
 
+LoginAdmission g_login_admission = {
+    .budget = LOGIN_BUDGET_PER_TICK,
+    .backlog_max = LOGIN_BACKLOG_MAX,
+};
+
+void login_admission_tick(void) {
+    g_login_admission.completed = 0;
+}
+
+bool login_admission_open(void) {
+    return g_login_admission.budget == 0 ||
+           g_login_admission.completed < g_login_admission.budget;
+}
+
+/*
+ * login_admit - Admission check for one login header (see login.h)
+ *
+ * @return  LOGIN_RESPONSE_OK, or the code to refuse the login with
+ */
+static u8 login_admit(void) {
+    LoginAdmission* admission = &g_login_admission;
+    u32 waiting = load_queue_pending(g_load_queue);
+    
+    /* Every PID (0 is reserved) is in use or promised to a queued login */
+    if (g_world && g_world->player_list) {
+        const PlayerList* list = g_world->player_list;
+        if (list->count + waiting + 1 >= list->capacity) {
+            admission->world_full++;
+            return LOGIN_RESPONSE_WORLD_FULL;
+        }
+    }
+    
+    if (g_load_queue ? waiting >= admission->backlog_max : !login_admission_open()) {
+        /* Inline logins complete right away, so they need budget now */
+        admission->turned_away++;
+        return LOGIN_RESPONSE_TRY_AGAIN;
+    }
+    return LOGIN_RESPONSE_OK;
+}
+
+/*
+ * login_refuse - Send a one-byte refusal and disconnect
+ *
+ * The reply is queued in the output arena; player_disconnect() flushes
+ * it before the socket is closed.
+ */
+void login_refuse(Player* player, u8 response) {
+    LOG_TRACE(LOG_LOGIN, "Refusing login on slot %u (response %u)\n", player->slot, response);
+    StreamBuffer* out = player_out(player);
+    buffer_write_byte(out, response);
+    player_out_commit(player);
+    player_disconnect(player);
+}
+
 /*
  * ==============================================================================
  * login_process_header - Validate Credentials and Initialize Ciphers (Stage 2)
@@ -452,41 +512,30 @@ bool login_process_connection(Player* player) {
  *      - Current implementation doesn't validate (trusts client)
  *      - Production should verify to detect modified caches
  *
- *   7. Skip RSA block header (2 bytes)
- *      - rsa_length: Length of encrypted block
- *      - rsa_opcode: Always 10 for login
- *      - Current implementation doesn't decrypt (assumes plaintext)
- *
- *   8. Read client ISAAC seeds (4x u32 = 16 bytes)
- *      - Client generates random seeds
- *      - Server uses these to initialize both ciphers
- *      - Logged for debugging
+ *   7. Take the RSA block (rsa_length bytes), pass admission (login.h:
+ *      TRY_AGAIN / WORLD_FULL and disconnect if refused) and mark the
+ *      player LOGGING_IN
  *
- *   9. Skip UID (1x u32 = 4 bytes)
- *      - Unique identifier for client machine
- *      - Could be used for ban enforcement (not implemented)
+ *   8. Hand the block to the login workers (load_queue.h), which
+ *      decrypt it (rsa_key.h: CRT + Montgomery, when data/rsa.key is
+ *      loaded), parse it with login_decode_block() and read the save.
+ *      If the workers are unavailable or full, do the same right here.
  *
- *  10. Extract username (variable length, newline-terminated)
- *      - Read characters until byte 10 (newline) or max length
- *      - Null-terminate string
- *      - Max length: MAX_USERNAME_LENGTH (20 characters)
+ *   9. Block contents (LoginBlock)
+ *      - Opcode 10
+ *      - Client ISAAC seeds (4x u32)
+ *      - UID (u32, unused: could drive ban enforcement)
+ *      - Username and password, each terminated by byte 10
  *
- *  11. Extract password (variable length, newline-terminated)
- *      - Read characters until byte 10 (newline) or max length
- *      - Null-terminate string
- *      - Max length: 63 characters
- *
- *  12. Initialize ISAAC ciphers
+ *  10. login_accept() (game thread, once the block is decoded)
+ *      - Copy username and password into the player
  *      - in_cipher: Uses client seeds [S0, S1, S2, S3]
  *      - out_cipher: Uses seeds [S0+50, S1+50, S2+50, S3+50]
  *      - Different seeds prevent keystream collision
  *
- *  13. Send login response code
- *      - LOGIN_RESPONSE_OK (2) for success
- *      - Other codes for errors (not implemented)
- *
- *  14. Update player state
- *      - Set state to PLAYER_STATE_LOGGED_IN
+ *  11. login_complete() (game thread, once the save is in)
+ *      - Send LOGIN_RESPONSE_OK (2); other codes not implemented
+ *      - Apply the save, set state to PLAYER_STATE_LOGGED_IN
  *      - Player now ready for game protocol
  *
  * LOGIN TYPE CODES
@@ -600,7 +649,8 @@ bool login_process_connection(Player* player) {
  *            - Must have valid socket_fd
  *            - username and password fields will be populated
  *            - in_cipher and out_cipher will be initialized
- *            - state will be set to PLAYER_STATE_LOGGED_IN
+ *            - state will be set to PLAYER_STATE_LOGGING_IN, or
+ *              PLAYER_STATE_LOGGED_IN if the save was loaded inline
  *
  *   in     : Input StreamBuffer containing login header
  *            - Must have at least 2 bytes initially
@@ -608,18 +658,18 @@ bool login_process_connection(Player* player) {
  *
  * RETURN VALUE
  * ------------
- *   true  : Login successful, player authenticated
+ *   true  : Header consumed (logged in, waiting for the loader, or
+ *           refused by admission - the player is then disconnected)
  *   false : Login failed (validation error or network error)
  *
  * SIDE EFFECTS
  * ------------
  *   - Reads multiple bytes from input buffer (position advances)
- *   - Writes username to player->username
- *   - Writes password to player->password (PLAINTEXT - security risk)
- *   - Initializes player->in_cipher with client seeds
- *   - Initializes player->out_cipher with client seeds + 50
- *   - Sets player->state to PLAYER_STATE_LOGGED_IN
- *   - Sends 1 byte (LOGIN_RESPONSE_OK) to client socket
+ *   - Sets player->state to PLAYER_STATE_LOGGING_IN and
+ *     player->login_ticket (worker request)
+ *   - Inline only: decodes the block, login_accept() (username,
+ *     password, ISAAC ciphers), sends 1 byte (LOGIN_RESPONSE_OK), sets
+ *     PLAYER_STATE_LOGGED_IN
  *   - Prints multiple debug messages (seeds, username, success)
  *
  * ERROR HANDLING
@@ -628,30 +678,28 @@ bool login_process_connection(Player* player) {
  *     - Buffer has insufficient data (incomplete packet)
  *     - Login type not 16 or 18 (invalid protocol)
  *     - Client version not 225 (version mismatch)
+ *     - Inline only: the RSA block does not decode
  *     - network_send fails (connection error)
  *
  * EXAMPLE
  * -------
- *   StreamBuffer* in = buffer_create(512);
- *   ssize_t received = recv(player->socket_fd, in->data, 512, 0);
- *   in->limit = received;
+ *   u8 bytes[512];
+ *   ssize_t received = recv(player->socket_fd, bytes, sizeof(bytes), 0);
+ *   StreamBuffer in;
+ *   buffer_init_view(&in, bytes, (u32)received);
  *   
- *   if (login_process_header(player, in)) {
+ *   if (login_process_header(player, &in)) {
  *       printf("Login successful: %s\n", player->username);
  *       login_send_initial_packets(player);
  *   } else {
  *       printf("Login failed\n");
  *       close(player->socket_fd);
  *   }
- *   buffer_destroy(in);
  *
  * TIME COMPLEXITY
  * ---------------
- *   O(U + P) where U = username length, P = password length
- *     - Fixed reads: O(1)
- *     - Username extraction: O(U)
- *     - Password extraction: O(P)
- *     - ISAAC init: O(1) (fixed internal operations)
+ *   O(1) on the game thread when the workers take the block; inline,
+ *   one RSA decryption (rsa_key.h) plus O(U + P) for the credentials
  *
  * SPACE COMPLEXITY
  * ----------------
@@ -671,9 +719,10 @@ bool login_process_header(Player* player, StreamBuffer* in) {
      */
     u8 login_type = buffer_read_byte(in, false);
     if (login_type != 16 && login_type != 18) {
-        printf("Invalid login type: %u\n", login_type);
+        LOG_WARN("Invalid login type: %u\n", login_type);
         return false;  /* Unknown login type, reject */
     }
+    player->login_reconnect = login_type == 18;
     
     /* 
      * Read block length (1 byte).
@@ -692,7 +741,7 @@ bool login_process_header(Player* player, StreamBuffer* in) {
      */
     u8 client_version = buffer_read_byte(in, false);
     if (client_version != 225) {
-        printf("Invalid client version: %u (expected 225)\n", client_version);
+        LOG_WARN("Invalid client version: %u (expected 225)\n", client_version);
         return false;  /* Version mismatch, reject */
     }
     
@@ -717,75 +766,137 @@ bool login_process_header(Player* player, StreamBuffer* in) {
     }
     
     /* 
-     * Read RSA block header (2 bytes).
-     * In production, this block would be RSA-encrypted with server's
-     * public key. Current implementation assumes plaintext for simplicity.
+     * Take the RSA block: [rsa_length:1][block]. Decrypting and parsing
+     * it (login_decode_block) is left to the login workers, so a flood
+     * of logins costs the game thread a copy each, not an RSA operation.
      */
-    u8 rsa_length = buffer_read_byte(in, false);  /* Length of encrypted block */
-    u8 rsa_opcode = buffer_read_byte(in, false);  /* Always 10 for login */
+    u8 rsa_length = buffer_read_byte(in, false);
+    if (buffer_get_remaining(in) < rsa_length) {
+        return false;
+    }
+    const u8* rsa_block = in->data + in->position;
+    buffer_skip(in, rsa_length);
+    
+    /* Backlog full or world full: answer and hang up (header consumed) */
+    u8 refusal = login_admit();
+    if (refusal != LOGIN_RESPONSE_OK) {
+        login_refuse(player, refusal);
+        return true;
+    }
     
     /* 
-     * Read 4 client ISAAC seeds (16 bytes total).
-     * Client generates these random values.
-     * Server uses them to initialize ISAAC ciphers for opcode encryption.
-     * 
-     * These seeds establish the shared secret for the session.
+     * Decode the block and load the save on the login workers
+     * (load_queue.h). The response code is only sent once both are done,
+     * by login_complete() from server_finish_logins(); until then the
+     * player is LOGGING_IN and the client waits for its response byte.
      */
-    u32 client_seeds[4];
-    for (int i = 0; i < 4; i++) {
-        client_seeds[i] = buffer_read_int(in, BYTE_ORDER_BIG);
+    player->state = PLAYER_STATE_LOGGING_IN;
+    if (load_queue_submit(g_load_queue, player->slot, rsa_block, rsa_length, &player->login_ticket)) {
+        LOG_TRACE(LOG_LOGIN, "Queued login block for slot %u (ticket %u)\n",
+                  player->slot, player->login_ticket);
+        return true;
     }
     
-    /* Log seeds for debugging (useful for protocol analysis) */
-    printf("DEBUG: Client ISAAC seeds: [0x%08X, 0x%08X, 0x%08X, 0x%08X]\n", 
-           client_seeds[0], client_seeds[1], client_seeds[2], client_seeds[3]);
+    /* No workers, or their queue is full: do it all here, as before */
+    LoginBlock block;
+    if (!login_decode_block(rsa_block, rsa_length, &block)) {
+        LOG_WARN("Rejected login block (%s)\n", g_rsa_key ? "RSA decryption failed" : "malformed");
+        return false;
+    }
+    login_accept(player, &block);
     
-    /* 
-     * Read and discard UID (4 bytes).
-     * Unique identifier for client machine.
-     * Could be used for:
-     *   - Device fingerprinting
-     *   - Multi-account detection
-     *   - Ban enforcement
-     * Current implementation ignores it.
-     */
-    buffer_read_int(in, BYTE_ORDER_BIG);
+    /* Already logged in here (username index, world.h), unless it is their lingering session */
+    Player* online = world_get_player(g_world, player->username);
+    if (online && session_matches(online, &block)) {
+        session_resume(online, player);
+        return true;
+    }
+    if (online) {
+        login_refuse(player, LOGIN_RESPONSE_ACCOUNT_ONLINE);
+        return true;
+    }
     
-    /* 
-     * Extract username (variable length, newline-terminated).
-     * 
-     * Format: ASCII characters followed by byte 10 (newline)
-     * Max length: MAX_USERNAME_LENGTH (20 characters)
-     * 
-     * Example: "zezima" encoded as [122, 101, 122, 105, 109, 97, 10]
-     */
-    char ch;
-    u32 username_len = 0;
-    while ((ch = buffer_read_byte(in, false)) != 10 && username_len < MAX_USERNAME_LENGTH) {
-        player->username[username_len++] = ch;
+    /* Another world holds the account (or has not saved it yet): account_registry.h */
+    if (!account_registry_claim(g_account_registry, player->username, g_world_id)) {
+        login_refuse(player, LOGIN_RESPONSE_ACCOUNT_ONLINE);
+        return true;
     }
-    player->username[username_len] = '\0';  /* Null-terminate string */
     
-    /* 
-     * Extract password (variable length, newline-terminated).
-     * 
-     * Format: ASCII characters followed by byte 10 (newline)
-     * Max length: 63 characters
-     * 
-     * SECURITY WARNING: Stored in plaintext in player structure.
-     * Production code should:
-     *   1. Hash password immediately (bcrypt, argon2)
-     *   2. Compare hash with database
-     *   3. Clear plaintext from memory
-     */
-    u32 password_len = 0;
-    while ((ch = buffer_read_byte(in, false)) != 10 && password_len < 63) {
-        player->password[password_len++] = ch;
+    u8 save[PLAYER_SAVE_MAX_SIZE];
+    u32 save_size = 0;
+    bool found = player_load_read(player->username, save, sizeof(save), &save_size);
+    return login_complete(player, found ? save : NULL, save_size);
+}
+
+/*
+ * login_read_string - Copy a byte-10-terminated string out of a block
+ *
+ * @return  Position after the terminator, or 0 if there is none within
+ *          size or the string is longer than max characters
+ */
+static u32 login_read_string(const u8* data, u32 size, u32 pos, char* out, u32 max) {
+    u32 len = 0;
+    while (pos < size && data[pos] != 10) {
+        if (len == max) return 0;
+        out[len++] = (char)data[pos++];
+    }
+    if (pos >= size) return 0;
+    out[len] = '\0';
+    return pos + 1;
+}
+
+/*
+ * login_decode_block - Decrypt (if keyed) and parse the RSA block
+ *
+ * Runs on the login workers: touches only its arguments and the
+ * read-only g_rsa_key.
+ */
+bool login_decode_block(const u8* data, u32 size, LoginBlock* out) {
+    u8 plain[RSA_MAX_BYTES];
+    const u8* block = data;
+    
+    if (g_rsa_key) {
+        /* The client always encrypts when it has the public key */
+        i32 len = rsa_key_decrypt(g_rsa_key, data, size, plain, sizeof(plain));
+        if (len < 0) return false;
+        block = plain;
+        size = (u32)len;
     }
-    player->password[password_len] = '\0';  /* Null-terminate string */
+    
+    /* [10][seeds:16][uid:4] then two strings */
+    bool ok = size >= 21 && block[0] == 10;
+    if (ok) {
+        for (int i = 0; i < 4; i++) {
+            const u8* p = block + 1 + i * 4;
+            out->seeds[i] = ((u32)p[0] << 24) | ((u32)p[1] << 16) | ((u32)p[2] << 8) | p[3];
+        }
+        const u8* p = block + 17;
+        out->uid = ((u32)p[0] << 24) | ((u32)p[1] << 16) | ((u32)p[2] << 8) | p[3];
+        
+        u32 pos = login_read_string(block, size, 21, out->username, MAX_USERNAME_LENGTH);
+        pos = pos ? login_read_string(block, size, pos, out->password,
+                                      sizeof(out->password) - 1) : 0;
+        ok = pos != 0 && out->username[0] != '\0';
+    }
+    
+    memset(plain, 0, sizeof(plain));  /* Held the password */
+    return ok;
+}
+
+/*
+ * login_accept - Credentials into the player, ISAAC seeded (game thread)
+ */
+void login_accept(Player* player, const LoginBlock* block) {
+    memcpy(player->username, block->username, sizeof(player->username));
+    memcpy(player->password, block->password, sizeof(player->password));
+    player->session_uid = block->uid;
+    
+    /* Log seeds for debugging (useful for protocol analysis) */
+    LOG_TRACE(LOG_LOGIN, "Client ISAAC seeds: [0x%08X, 0x%08X, 0x%08X, 0x%08X]\n", 
+              block->seeds[0], block->seeds[1], block->seeds[2], block->seeds[3]);
     
     /* Log username for debugging (password not logged for security) */
-    printf("Login: username='%s'\n", player->username);
+    LOG_INFO("Login: username='%s'\n", player->username);
     
     /* 
      * Initialize ISAAC ciphers for bidirectional communication.
@@ -799,17 +910,39 @@ bool login_process_header(Player* player, StreamBuffer* in) {
     u32 in_seed[4];
     u32 out_seed[4];
     for (int i = 0; i < 4; i++) {
-        in_seed[i] = client_seeds[i];
-        out_seed[i] = client_seeds[i] + 50;  /* Offset for different keystream */
+        in_seed[i] = block->seeds[i];
+        out_seed[i] = block->seeds[i] + 50;  /* Offset for different keystream */
     }
     
     /* Initialize ciphers with derived seeds */
-    isaac_init(&player->in_cipher, in_seed, 4);
-    isaac_init(&player->out_cipher, out_seed, 4);
+    isaac_init(&player->conn->in_cipher, in_seed, 4);
+    isaac_init(&player->conn->out_cipher, out_seed, 4);
+    
+    /* Seeds and name only: the password never reaches a recording */
+    if (g_replay.recording) {
+        replay_record_accept(player->slot, block->seeds, player->username);
+    }
     
     /* Log cipher initialization status */
-    printf("DEBUG: ISAAC initialized - in_cipher.initialized=%u, out_cipher.initialized=%u\n",
-           player->in_cipher.initialized, player->out_cipher.initialized);
+    LOG_TRACE(LOG_LOGIN, "ISAAC initialized - in_cipher.initialized=%u, out_cipher.initialized=%u\n",
+              player->conn->in_cipher.initialized, player->conn->out_cipher.initialized);
+}
+
+/*
+ * login_complete - Answer the client and enter the game (Stage 2, part 2)
+ *
+ * @param player     Player in LOGGING_IN state (ciphers seeded)
+ * @param save       Save bytes from player_load_read(), or NULL for a new
+ *                   player
+ * @param save_size  Bytes in save
+ * @return           true if logged in; false if the response could not be
+ *                   sent (connection lost)
+ */
+bool login_complete(Player* player, const u8* save, u32 save_size) {
+    /* The save as loaded: a replay must not depend on the files on disk */
+    if (g_replay.recording) {
+        replay_record_complete(player->slot, save, save_size);
+    }
     
     /* 
      * Send login response code to client.
@@ -824,33 +957,39 @@ bool login_process_header(Player* player, StreamBuffer* in) {
      * 
      * Current implementation always sends OK (no validation).
      */
-    StreamBuffer* out = buffer_create(16);
+    StreamBuffer* out = player_out(player);
     buffer_write_byte(out, LOGIN_RESPONSE_OK);
     
     /* Send response to client socket */
-    i32 sent = network_send(player->socket_fd, out->data, out->position);
-    buffer_destroy(out);
+    bool sent = player_out_commit(player);
     
-    if (sent > 0) {
-        /* Load player data from disk (or initialize new player) */
-        bool existing_player = player_load(player);
+    if (sent) {
+        /* Apply the save (or initialize a new player) */
+        bool existing_player = player_load_buffer(player, save, save_size);
         
         /* Update player state to logged in */
         player->state = PLAYER_STATE_LOGGED_IN;
+        command_player_login(player);
+        presence_online(player);
+        
+        /* Spend this tick's login budget (login.h, LOGIN ADMISSION) */
+        g_login_admission.completed++;
+        g_login_admission.logins++;
         
         /* Set login timestamp */
         player->last_login = (u64)time(NULL) * 1000;  /* Convert to milliseconds */
         
         if (existing_player) {
-            printf("Player '%s' logged in successfully (existing player loaded)\n", player->username);
+            LOG_INFO("Player '%s' logged in successfully (existing player loaded)\n", player->username);
         } else {
-            printf("Player '%s' logged in successfully (new player created)\n", player->username);
+            LOG_INFO("Player '%s' logged in successfully (new player created)\n", player->username);
         }
         
         return true;
     }
     
-    /* Network error (connection closed or send failed) */
+    /* Network error (connection closed or send failed): never entered, free the account */
+    account_registry_drop(g_account_registry, player->username, g_world_id);
     return false;
 }
 
@@ -1139,6 +1278,9 @@ void login_send_initial_packets(Player* player) {
      */
     player->update_flags = 0x1;  /* UPDATE_APPEARANCE flag */
     
+    /* Loaded body/colors are new to everyone: stamp a fresh version */
+    player_appearance_changed(player);
+    
     /* 
      * Register player with world.
      * This adds the player to global tracking structures:
@@ -1162,5 +1304,5 @@ void login_send_initial_packets(Player* player) {
     player->login_time = (u64)time(NULL);
     
     /* Log successful setup for debugging */
-    printf("Player setup complete for %s\n", player->username);
+    LOG_INFO("Player setup complete for %s\n", player->username);
 }
@@ -55,9 +55,11 @@
  *
  *   Code | Constant                         | Meaning
  *   -----+----------------------------------+--------------------------------
+ *     1  | LOGIN_RESPONSE_TRY_AGAIN         | Busy - client resends in 2 s
  *     2  | LOGIN_RESPONSE_OK                | Success - player logged in
  *     3  | LOGIN_RESPONSE_INVALID_CREDENTIALS| Username/password incorrect
  *     5  | LOGIN_RESPONSE_ACCOUNT_ONLINE    | Account already logged in
+ *     7  | LOGIN_RESPONSE_WORLD_FULL        | No player index left
  *    15  | LOGIN_RESPONSE_RECONNECT         | Reconnection request
  *    18  | LOGIN_RESPONSE_SUCCESS_STAFF     | Staff member login success
  *
@@ -182,6 +184,9 @@
  * messages to the user.
  */
 
+/* Login queue is full - the client waits 2 seconds and resends the login */
+#define LOGIN_RESPONSE_TRY_AGAIN 1
+
 /* Login successful - player authenticated and ready for game */
 #define LOGIN_RESPONSE_OK 2
 
@@ -191,12 +196,109 @@
 /* Account is already logged in (prevents duplicate sessions) */
 #define LOGIN_RESPONSE_ACCOUNT_ONLINE 5
 
+/* Every player index is taken or promised to a login in progress */
+#define LOGIN_RESPONSE_WORLD_FULL 7
+
 /* Reconnection acknowledged (for session recovery) */
 #define LOGIN_RESPONSE_RECONNECT 15
 
 /* Successful login for staff member (may trigger special client behavior) */
 #define LOGIN_RESPONSE_SUCCESS_STAFF 18
 
+/*
+ * LOGIN_BLOCK_MAX - Largest RSA block (its length is one byte on the wire)
+ */
+#define LOGIN_BLOCK_MAX 255
+
+/*
+ * LoginBlock - Decoded contents of the login packet's RSA block
+ * --------------------------------------------------------------
+ *   [10][seed0:4][seed1:4][seed2:4][seed3:4][uid:4][username\n][password\n]
+ *
+ * Encrypted with the server's public key when the client has one
+ * configured (rsa_key.h), plaintext otherwise.
+ */
+typedef struct {
+    u32 seeds[4];                           /* Client ISAAC seeds */
+    u32 uid;                                /* Client machine identifier */
+    char username[MAX_USERNAME_LENGTH + 1];
+    char password[64];
+} LoginBlock;
+
+/*
+ * ==============================================================================
+ * LOGIN ADMISSION
+ * ==============================================================================
+ *
+ * THE PROBLEM
+ * -----------
+ * After a world restart every client reconnects within the same second or
+ * two. Each login costs an RSA decryption, a save load, world registration
+ * and the initial game packets (map region, inventory, skills, ...). With
+ * no limit all of that landed in one or two ticks: the tick ran long for
+ * everyone already online, and the load queue could overflow into
+ * synchronous logins on the game thread.
+ *
+ * THE SOLUTION - ADMIT, QUEUE, SPEND A BUDGET PER TICK
+ * ----------------------------------------------------
+ *
+ *   header ──► admission ──► load queue ──► workers ──► finished ──► complete
+ *                 │          (RSA, save)                  │        (budget/tick)
+ *                 │                                       │
+ *                 ├─ backlog full ─► TRY_AGAIN (1)        └─ over budget: stays
+ *                 └─ no PID left  ─► WORLD_FULL (7)          queued for next tick
+ *
+ *   1. Admission: a header is admitted while fewer than LOGIN_BACKLOG_MAX
+ *      logins are queued (load_queue_pending). Past that the client gets
+ *      LOGIN_RESPONSE_TRY_AGAIN, which the 225 client answers by waiting
+ *      2 seconds and logging in again by itself.
+ *
+ *   2. Budget: server_finish_logins() completes at most `budget` logins
+ *      per tick (login_complete: reply, save, register, initial
+ *      packets). Finished jobs past the budget keep their place in the
+ *      queue; login_admission_tick() refills the budget every tick.
+ *
+ *   A storm of 2000 reconnects with the defaults:
+ *
+ *     tick 0:   256 admitted, 1744 told TRY_AGAIN
+ *     tick 0-2: 100 completed per tick, backlog drains
+ *     +2 s:     the 1744 come back; the next 256 are admitted, ...
+ *     ~16 s:    everyone is in (8 rounds), no tick did more than 100
+ *
+ * Without workers (Windows, or none started) logins complete inline, so
+ * the budget is checked at admission instead.
+ */
+
+/* Logins completed per tick (--login-budget N, 0 = unlimited) */
+#define LOGIN_BUDGET_PER_TICK 100
+
+/* Logins admitted but not yet completed before TRY_AGAIN */
+#define LOGIN_BACKLOG_MAX 256
+
+/*
+ * LoginAdmission - Budget and counters (game thread only)
+ */
+typedef struct {
+    u32 budget;                 /* Completions per tick, 0 = unlimited */
+    u32 backlog_max;            /* Queued logins before TRY_AGAIN */
+    u32 completed;              /* Completions this tick */
+    u64 logins;                 /* Completions since start */
+    u64 turned_away;            /* TRY_AGAIN replies */
+    u64 world_full;             /* WORLD_FULL replies */
+} LoginAdmission;
+
+extern LoginAdmission g_login_admission;
+
+/*
+ * login_admission_tick - Refill the per-tick budget (start of every tick)
+ */
+void login_admission_tick(void);
+
+/*
+ * login_admission_open - Whether this tick's budget has room for a login
+ */
+bool login_admission_open(void);
+
 /*
  * Login Stage Enumeration
  * ------------------------
@@ -273,7 +375,7 @@ bool login_process_connection(Player* player);
  *
  * Side Effects:
  *   - Reads login type, version, CRC checksums, ISAAC seeds, credentials
- *   - Initializes player->in_cipher and player->out_cipher
+ *   - Initializes player->conn->in_cipher and player->conn->out_cipher
  *   - Stores username and password in player structure
  *   - Sets player->state to PLAYER_STATE_LOGGED_IN on success
  *   - Sends LOGIN_RESPONSE_OK (or error code) to client
@@ -289,11 +391,13 @@ bool login_process_connection(Player* player);
  *     3       | u8   | High/low memory flag
  *     4-39    | u32  | 9x CRC32 checksums for cache files
  *     40      | u8   | RSA block length
- *     41      | u8   | RSA opcode (always 10)
- *     42-57   | u32  | 4x ISAAC seeds (client-generated)
- *     58-61   | u32  | UID (unique identifier)
- *     62-...  | str  | Username (terminated by byte 10)
- *     ...-... | str  | Password (terminated by byte 10)
+ *     41-...  | -    | RSA block (LoginBlock), decoded by
+ *             |      | login_decode_block():
+ *             | u8   |   RSA opcode (always 10)
+ *             | u32  |   4x ISAAC seeds (client-generated)
+ *             | u32  |   UID (unique identifier)
+ *             | str  |   Username (terminated by byte 10)
+ *             | str  |   Password (terminated by byte 10)
  *
  *   ISAAC Cipher Initialization:
  *     in_cipher  : Initialized with client seeds [S0, S1, S2, S3]
@@ -311,6 +415,57 @@ bool login_process_connection(Player* player);
  */
 bool login_process_header(Player* player, StreamBuffer* in);
 
+/*
+ * login_decode_block - Decrypt and parse a login packet's RSA block
+ * ------------------------------------------------------------------
+ * With g_rsa_key loaded the block is RSA-decrypted first (CRT, see
+ * rsa_key.h); without one it must be plaintext. Thread-safe: the login
+ * workers (load_queue.h) call it off the game thread.
+ *
+ * Parameters:
+ *   data : Block bytes as received (after the block length byte)
+ *   size : Bytes in data (at most LOGIN_BLOCK_MAX)
+ *   out  : Receives the seeds and credentials
+ *
+ * Returns:
+ *   true  : Block decoded
+ *   false : Not decryptable with the key, wrong opcode, or a malformed
+ *           or over-long username / password
+ */
+bool login_decode_block(const u8* data, u32 size, LoginBlock* out);
+
+/*
+ * login_accept - Take a decoded block's credentials and seed ISAAC
+ * -----------------------------------------------------------------
+ * Copies username and password into the player and initializes both
+ * ciphers from the client seeds. Game thread only.
+ */
+void login_accept(Player* player, const LoginBlock* block);
+
+/*
+ * login_complete - Stage 2b: Finish a login once the save is available
+ * ---------------------------------------------------------------------
+ * Sends LOGIN_RESPONSE_OK, applies the save bytes (or new player
+ * defaults) and moves the player to LOGGED_IN. Called by
+ * login_process_header() when the save was read inline, otherwise by
+ * server_finish_logins() when the login loader delivers it.
+ *
+ * Parameters:
+ *   player    : Player in LOGGING_IN state (ciphers already seeded)
+ *   save      : Bytes from player_load_read(), or NULL for a new player
+ *   save_size : Bytes in save
+ *
+ * Returns:
+ *   true  : Player is logged in
+ *   false : Response could not be sent (connection lost)
+ */
+bool login_complete(Player* player, const u8* save, u32 save_size);
+
+/*
+ * login_refuse - Send a one-byte refusal (LOGIN_RESPONSE_*) and disconnect
+ */
+void login_refuse(Player* player, u8 response);
+
 /*
  * login_process_payload - Stage 3: Process additional login data
  * ---------------------------------------------------------------
@@ -354,7 +509,7 @@ bool login_process_payload(Player* player, StreamBuffer* in);
  *
  * Notes:
  *   - Does NOT send game packets (handled by server_send_initial_game_packets)
- *   - Must be called after successful login_process_header()
+ *   - Must be called once login_complete() has succeeded
  *   - Player will appear in game world after next update cycle
  *
  * Example:
@@ -126,7 +126,7 @@
  *   #ifdef _WIN32
  *   BOOL WINAPI CtrlHandler(DWORD type) {
  *       if (type == CTRL_C_EVENT) {
- *           server_shutdown(g_server);
+ *           g_server->running = false;
  *           return TRUE;
  *       }
  *       return FALSE;
@@ -140,9 +140,30 @@
  ******************************************************************************/
 
 #include "server.h"
+#include "log.h"
+#include "log_sink.h"
+#include "snapshot.h"
+#include "script_asm.h"
+#include "tick_stats.h"
+#include "tick_governor.h"
+#include "session.h"
+#include "checkpoint.h"
+#include "metrics.h"
+#include "asset_http.h"
+#include "packet_profile.h"
+#include "trace.h"
+#include "replay.h"
+#include "command.h"
+#include "account_registry.h"
+#include "cluster.h"
+#include "update.h"
+#include "supervisor.h"
+#include "map.h"
+#include "config_file.h"
 #include <stdio.h>
 #include <signal.h>
 #include <stdlib.h>
+#include <string.h>
 
 /*******************************************************************************
  * GLOBAL STATE
@@ -172,10 +193,17 @@ GameServer* g_server = NULL;
  * 
  * ALGORITHM:
  *   1. Check if server is initialized
- *   2. Print shutdown message
- *   3. Call server_shutdown() to cleanup
+ *   2. First signal: print shutdown message, set server->running = false
+ *   3. Later signals: nothing (the shutdown is already under way)
  *   4. Return to interrupted context
- *   5. Main loop will exit normally
+ *   5. Main loop exits within a tick; run_world() calls server_shutdown()
+ * 
+ * WHY NOT SHUT DOWN HERE:
+ *   The handler interrupts the game thread anywhere, possibly halfway
+ *   through a tick. Freeing players and systems from here raced the tick
+ *   it interrupted, and the whole serial teardown ran in signal context.
+ *   The shutdown itself (bulk save, one logout flush) now runs on the
+ *   game thread after the loop, between ticks.
  * 
  * SIGNAL SAFETY:
  *   This function runs in signal context (async-signal-safe)
@@ -193,12 +221,12 @@ GameServer* g_server = NULL;
  * REENTRANCY:
  *   If SIGINT arrives during signal_handler execution:
  *   - Handler will be invoked again (recursion)
- *   - Protected by g_server NULL check
- *   - Second call has no effect (server already shutting down)
+ *   - Both calls only store flags, so the order does not matter
  * 
  * SIGNAL DISPOSITION:
- *   After handler returns, default behavior is restored
- *   If user presses Ctrl+C again during shutdown, process terminates immediately
+ *   Only the first signal counts. Under --worlds a world gets Ctrl+C
+ *   twice (from the terminal and forwarded by the supervisor), so a
+ *   repeat cannot mean "force quit"; use SIGKILL for a stuck shutdown
  * 
  * EXAMPLE EXECUTION FLOW:
  * 
@@ -206,10 +234,10 @@ GameServer* g_server = NULL;
  *     main() → server_run() → [infinite loop] → ...
  *   
  *   User presses Ctrl+C:
- *     [loop interrupted] → signal_handler(SIGINT) → server_shutdown()
- *     → [handler returns] → [loop continues one iteration]
+ *     [loop interrupted] → signal_handler(SIGINT) → running = false
+ *     → [handler returns] → [loop finishes its iteration]
  *     → while(server->running) is false → exit loop
- *     → cleanup in main() → exit(0)
+ *     → server_shutdown() in run_world() → exit(0)
  * 
  * PORTABILITY:
  *   POSIX signal handling:
@@ -222,21 +250,391 @@ GameServer* g_server = NULL;
  * COMPLEXITY: O(1) time
  */
 void signal_handler(int sig) {
-    if (g_server) {
-        printf("\nShutting down server (signal %d)...\n", sig);
-        server_shutdown(g_server);
-    }
+    static volatile sig_atomic_t requested = 0;
+    if (!g_server || requested) return;
+    requested = 1;
+    printf("\nShutting down server (signal %d)...\n", sig);
+    g_server->running = false;
+}
+
+/*
+ * trace_signal_handler - SIGUSR2: dump the trace rings after the next tick
+ *
+ * Only sets a flag (trace_request_dump); the game thread writes the file.
+ */
+void trace_signal_handler(int sig) {
+    (void)sig;
+    trace_request_dump();
 }
 
 /*******************************************************************************
  * ENTRY POINT
  ******************************************************************************/
 
+/*
+ * ServerOptions - Command line settings one world runs with
+ */
+typedef struct {
+    bool net_thread;            /* --net-thread: move socket I/O onto a dedicated thread (see netio.h) */
+    bool save_log;              /* --save-log: keep saves in one append-only log (see save_log.h) */
+    u32 update_threads;         /* --update-threads N: encode PLAYER_INFO on N threads (see update_pool.h) */
+    u32 tick_shards;            /* --tick-shards N: move players on N threads by mapsquare (see region_shard.h) */
+    const char* record_path;    /* --record FILE: capture client traffic (see replay.h) */
+    const char* replay_path;    /* --replay FILE: rerun a capture (see replay.h) */
+    u32 worlds;                 /* --worlds N: N worlds sharing one asset load (see supervisor.h) */
+    u32 cluster;                /* --cluster N: one world on N nodes (see cluster.h) */
+    u16 ws_port;                /* --ws-port N: also accept WebSocket clients on N (see websocket.h) */
+    u32 map_rate;               /* --map-rate KB/s: map download pace, 0 = unpaced (see map.h) */
+    bool tick_budget_set;       /* --tick-budget given (else half of --tick-ms) */
+} ServerOptions;
+
+/*
+ * run_world - Steps 1-9 below for one world listening on port
+ *
+ * @return  Exit code
+ *
+ * Called by main() for a single world, or in each child forked by the
+ * --worlds supervisor (with the assets already loaded).
+ */
+/* Log writer thread (log_sink.h), one per world process */
+static LogSink log_sink;
+
+static int run_world(const ServerOptions* options, u16 port) {
+    /*
+     * STEP 1: Allocate GameServer on heap
+     * 
+     * calloc() ensures all bytes are zeroed:
+     *   - player[].state = PLAYER_STATE_DISCONNECTED (0)
+     *   - server->running = false
+     *   - All pointers = NULL
+     */
+    /* Allocate server on heap to avoid stack overflow */
+    GameServer* server = calloc(1, sizeof(GameServer));
+    if (!server) {
+        fprintf(stderr, "ERROR: Failed to allocate server memory\n");
+        fprintf(stderr, "       Required: %zu bytes\n", sizeof(GameServer));
+        return 1;
+    }
+    
+    /*
+     * STEP 2: Set global pointer for signal handler
+     * 
+     * Must be set before server_init() in case signal arrives during init
+     */
+    g_server = server;
+    
+    /*
+     * STEP 3: Register signal handlers
+     * 
+     * SIGINT:  Ctrl+C (interrupt)
+     * SIGTERM: kill <pid> (termination request)
+     * 
+     * Both signals now invoke signal_handler() for graceful shutdown
+     */
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+#ifdef SIGUSR2
+    signal(SIGUSR2, trace_signal_handler);  /* kill -USR2 <pid>: trace dump (trace.h) */
+#endif
+    
+    /*
+     * STEP 4: Print startup banner
+     */
+    printf("========================================\n");
+    printf("  RuneScape Private Server (C)\n");
+    printf("  Revision: 225 (May 2004 Protocol)\n");
+    printf("  Port: %u\n", port);
+    printf("========================================\n");
+    printf("Starting server...\n");
+    
+    /*
+     * STEP 5: Initialize server subsystems
+     * 
+     * Initializes in order:
+     *   - World state
+     *   - Cache system (item/NPC/object definitions)
+     *   - Item system
+     *   - NPC system
+     *   - Object system
+     *   - Player slots
+     *   - Network socket
+     * 
+     * Returns false on critical failure (port in use, out of memory, etc.)
+     */
+    /* A replay binds no port, and NPCs wander the same way every run */
+    if (options->replay_path) srand(REPLAY_RAND_SEED);
+    if (!server_init(server, options->replay_path ? 0 : port)) {
+        fprintf(stderr, "ERROR: Server initialization failed\n");
+        fprintf(stderr, "       Common causes:\n");
+        fprintf(stderr, "         - Port %u already in use\n", port);
+        fprintf(stderr, "         - Insufficient memory\n");
+        fprintf(stderr, "         - Missing data files\n");
+        free(server);
+        g_server = NULL;
+        return 1;
+    }
+    if (!g_log_sync) log_sink_start(&log_sink, g_log_file, (u64)g_log_rotate_mb << 20);
+    
+    /*
+     * STEP 6: Enter main event loop
+     * 
+     * server_run() blocks until server->running becomes false
+     * This happens when:
+     *   - Signal handler sets server->running = false
+     *   - Critical error occurs
+     */
+    if (options->replay_path) {
+        bool replayed = server_replay(server, options->replay_path);
+        server_shutdown(server);
+        free(server);
+        g_server = NULL;
+        log_sink_stop(&log_sink);
+        return replayed ? 0 : 1;
+    }
+    /* A recording starts from a fresh world too: only then is it replayable */
+    if (!options->record_path) checkpoint_restore(&server->checkpoint);
+    if (options->record_path && !replay_record_open(options->record_path)) {
+        fprintf(stderr, "WARNING: Recording to %s unavailable\n", options->record_path);
+    }
+    /* Before the network thread, which takes over the listeners; world N uses port + N */
+    u16 ws_port = options->ws_port ? (u16)(options->ws_port + (port - SERVER_PORT)) : 0;
+    if (ws_port && !server_listen_websocket(server, ws_port)) {
+        fprintf(stderr, "WARNING: WebSocket port %u unavailable\n", ws_port);
+    }
+    if (options->net_thread && !server_start_net_thread(server)) {
+        fprintf(stderr, "WARNING: Network thread unavailable, using single-threaded loop\n");
+    }
+    if (options->update_threads > 1 && !server_start_update_pool(server, options->update_threads)) {
+        fprintf(stderr, "WARNING: Update pool unavailable, encoding player updates serially\n");
+    }
+    if (options->tick_shards > 1 && !server_start_region_shards(server, options->tick_shards)) {
+        fprintf(stderr, "WARNING: Region shards unavailable, moving players serially\n");
+    }
+    if (options->save_log && !server_open_save_log(server, SAVE_LOG_PATH)) {
+        fprintf(stderr, "WARNING: Save log unavailable, using one save file per player\n");
+    }
+    
+    printf("========================================\n");
+    printf("  Server is now online!\n");
+    printf("  Press Ctrl+C to stop gracefully\n");
+    printf("========================================\n");
+    server_run(server);
+    
+    /*
+     * STEP 7: Graceful shutdown
+     * 
+     * Only reached after server_run() returns (server->running = false)
+     * Performs final cleanup:
+     *   - Log out remaining players (one flush)
+     *   - Save them in one parallel batch
+     *   - Close network sockets
+     *   - Free subsystem resources
+     */
+    printf("Performing final cleanup...\n");
+    server_shutdown(server);
+    
+    /*
+     * STEP 8: Free heap memory
+     * 
+     * Deallocates GameServer structure
+     * All player slots, buffers, and subsystem data are freed
+     */
+    free(server);
+    g_server = NULL;
+    log_sink_stop(&log_sink);  /* Last: writes whatever the shutdown logged */
+    
+    /*
+     * STEP 9: Exit successfully
+     */
+    printf("========================================\n");
+    printf("  Server stopped cleanly\n");
+    printf("  Exit code: 0 (success)\n");
+    printf("========================================\n");
+    return 0;
+}
+
+/* WorldMain for the supervisor: world N listens on SERVER_PORT + N */
+static int run_supervised_world(u32 world, void* ctx) {
+    if (g_metrics_port != 0) g_metrics_port = (u16)(g_metrics_port + world);
+    if (g_asset_http_port != 0) g_asset_http_port = (u16)(g_asset_http_port + world);
+    /* Each world writes and rotates its own file: FILE.world<N> */
+    static char log_path[512];
+    if (g_log_file) {
+        snprintf(log_path, sizeof(log_path), "%s.world%u", g_log_file, world);
+        g_log_file = log_path;
+    }
+    return run_world((const ServerOptions*)ctx, (u16)(SERVER_PORT + world));
+}
+
+/*
+ * parse_options - Apply command line style options
+ *
+ * @param options  Options being built
+ * @param argc     Arguments in argv
+ * @param argv     Options (argv of main(), or a config file's)
+ * @param first    Index of the first option (1 for main()'s argv)
+ * @return         -1 to go on, or an exit code (--build-snapshot or
+ *                 --build-scripts ran)
+ *
+ * Run over the --config file first, then over the command line, so the
+ * command line wins (config_file.h).
+ */
+static int parse_options(ServerOptions* options, int argc, char** argv, int first) {
+    for (int i = first; i < argc; i++) {
+        if (strcmp(argv[i], "--net-thread") == 0) {
+            options->net_thread = true;
+        } else if (strcmp(argv[i], "--save-log") == 0) {
+            options->save_log = true;
+        } else if (strcmp(argv[i], "--build-snapshot") == 0) {
+            /* Prebuild the world snapshot for deploys (see snapshot.h) */
+            return server_build_snapshot(SNAPSHOT_PATH) ? 0 : 1;
+        } else if (strcmp(argv[i], "--build-scripts") == 0) {
+            /* Compile data/scripts/NAME.rs2 into data/scripts.dat (see script_asm.h) */
+            return script_build(SCRIPT_SOURCE_DIR, SCRIPT_PROGRAM_PATH) ? 0 : 1;
+        } else if (strcmp(argv[i], "--config") == 0 && i + 1 < argc) {
+            /* Read by main() before everything else */
+            i++;
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            options->record_path = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            options->replay_path = argv[++i];
+        } else if (strcmp(argv[i], "--update-threads") == 0 && i + 1 < argc) {
+            options->update_threads = (u32)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--tick-shards") == 0 && i + 1 < argc) {
+            options->tick_shards = (u32)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--login-threads") == 0 && i + 1 < argc) {
+            /* Decrypt login blocks and load saves on N workers (see load_queue.h) */
+            u32 threads = (u32)strtoul(argv[++i], NULL, 10);
+            if (threads > 0) g_load_queue_threads = threads;
+        } else if (strcmp(argv[i], "--tick-budget") == 0 && i + 1 < argc) {
+            /* Warn when a tick's work takes over N ms, 0 = never (see tick_stats.h) */
+            g_tick_stats.budget_ms = (u32)strtoul(argv[++i], NULL, 10);
+            options->tick_budget_set = true;
+        } else if (strcmp(argv[i], "--no-tick-governor") == 0) {
+            /* Never shed work when ticks run long (see tick_governor.h) */
+            g_tick_governor.enabled = false;
+        } else if (strcmp(argv[i], "--tick-catchup") == 0 && i + 1 < argc) {
+            /* Missed ticks: skip to the next deadline or burst them (see server.h) */
+            const char* policy = argv[++i];
+            if (strcmp(policy, "burst") == 0) g_tick_catchup = TICK_CATCHUP_BURST;
+            else if (strcmp(policy, "skip") == 0) g_tick_catchup = TICK_CATCHUP_SKIP;
+            else fprintf(stderr, "WARNING: Unknown --tick-catchup '%s'\n", policy);
+        } else if (strcmp(argv[i], "--packet-profile") == 0) {
+            /* Per-opcode counts, bytes and handler time (see packet_profile.h) */
+            packet_profile_set(true, 0);
+        } else if (strcmp(argv[i], "--trace") == 0) {
+            /* Span tracing from startup; dump with SIGUSR2 or ::trace dump (see trace.h) */
+            trace_set(true);
+        } else if (strcmp(argv[i], "--metrics-port") == 0 && i + 1 < argc) {
+            /* Serve Prometheus metrics on port N (see metrics.h) */
+            g_metrics_port = (u16)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--http-port") == 0 && i + 1 < argc) {
+            /* Serve the client archives over HTTP on port N (see asset_http.h) */
+            g_asset_http_port = (u16)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--login-budget") == 0 && i + 1 < argc) {
+            /* Complete at most N logins per tick, 0 = no limit (see login.h) */
+            g_login_admission.budget = (u32)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--session-grace") == 0 && i + 1 < argc) {
+            /* Ticks a dropped player stays in the world, 0 = log out at once (see session.h) */
+            g_session_grace_ticks = (u32)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--checkpoint-ticks") == 0 && i + 1 < argc) {
+            /* Ticks between world checkpoints, 0 = none (see checkpoint.h) */
+            g_checkpoint_ticks = (u32)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--local-player-budget") == 0 && i + 1 < argc) {
+            /* Shrink view radius past N visible players (see player_list.h) */
+            u32 budget = (u32)strtoul(argv[++i], NULL, 10);
+            if (budget > 0) g_local_player_budget = budget;
+        } else if (strcmp(argv[i], "--player-info-budget") == 0 && i + 1 < argc) {
+            /* PLAYER_INFO payload bytes per viewer, at most the client's buffer (see update.h) */
+            u32 bytes = (u32)strtoul(argv[++i], NULL, 10);
+            if (bytes > 0) g_player_info_budget = bytes < MAX_PACKET_SIZE ? bytes : MAX_PACKET_SIZE;
+        } else if (strcmp(argv[i], "--map-rate") == 0 && i + 1 < argc) {
+            /* Map download KB/s per connection, 0 = unpaced (see map.h) */
+            options->map_rate = (u32)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--no-nodelay") == 0) {
+            /* Leave Nagle's algorithm on for game sockets (see network.h) */
+            g_socket_profile.nodelay = false;
+        } else if (strcmp(argv[i], "--sndbuf") == 0 && i + 1 < argc) {
+            /* SO_SNDBUF in KB per game socket, 0 = kernel autotuning */
+            g_socket_profile.send_buffer = (u32)strtoul(argv[++i], NULL, 10) * 1024;
+        } else if (strcmp(argv[i], "--rcvbuf") == 0 && i + 1 < argc) {
+            /* SO_RCVBUF in KB per game socket, 0 = kernel autotuning */
+            g_socket_profile.recv_buffer = (u32)strtoul(argv[++i], NULL, 10) * 1024;
+        } else if (strcmp(argv[i], "--listen-backlog") == 0 && i + 1 < argc) {
+            /* Pending connections the listeners queue */
+            i32 backlog = (i32)strtol(argv[++i], NULL, 10);
+            if (backlog > 0) g_socket_profile.backlog = backlog;
+        } else if (strcmp(argv[i], "--out-arena") == 0 && i + 1 < argc) {
+            /* Output arena bytes per connection (bigger bursts spill to the heap) */
+            g_connection_out_bytes = (u32)strtoul(argv[++i], NULL, 10);
+            if (g_connection_out_bytes < CONNECTION_OUT_BYTES_MIN) {
+                g_connection_out_bytes = CONNECTION_OUT_BYTES_MIN;
+            }
+        } else if (strcmp(argv[i], "--conn-slab") == 0 && i + 1 < argc) {
+            /* Connections allocated together when the pool runs dry */
+            g_connection_slab = (u32)strtoul(argv[++i], NULL, 10);
+            if (g_connection_slab == 0) g_connection_slab = 1;
+        } else if (strcmp(argv[i], "--max-players") == 0 && i + 1 < argc) {
+            /* Runtime limits, clamped to the compiled ceilings (see server.h) */
+            g_server_limits.players = (u32)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--max-npcs") == 0 && i + 1 < argc) {
+            g_server_limits.npcs = (u32)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--max-ground-items") == 0 && i + 1 < argc) {
+            g_server_limits.ground_items = (u32)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--max-waypoints") == 0 && i + 1 < argc) {
+            g_server_limits.waypoints = (u32)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--tick-ms") == 0 && i + 1 < argc) {
+            g_server_limits.tick_ms = (u32)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--ws-port") == 0 && i + 1 < argc) {
+            options->ws_port = (u16)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--worlds") == 0 && i + 1 < argc) {
+            options->worlds = (u32)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--cluster") == 0 && i + 1 < argc) {
+            options->cluster = (u32)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--admin") == 0 && i + 1 < argc) {
+            /* Administrator rights for ::commands (see command.h) */
+            if (!command_add_admin(argv[++i])) {
+                fprintf(stderr, "WARNING: Too many --admin names, ignoring '%s'\n", argv[i]);
+            }
+        } else if (!log_configure(argv[i])) {
+            fprintf(stderr, "WARNING: Ignoring unknown option '%s'\n", argv[i]);
+        }
+    }
+    
+    return -1;
+}
+
 /*
  * main - Application entry point
  * 
- * @param argc  Argument count (unused)
- * @param argv  Argument vector (unused)
+ * @param argc  Argument count
+ * @param argv  Argument vector:
+ *                --net-thread         enable the network thread
+ *                --save-log           store saves in data/players/saves.log
+ *                --build-snapshot     write data/world.snap and exit
+ *                --build-scripts      write data/scripts.dat and exit
+ *                --record FILE        record client traffic (see replay.h)
+ *                --replay FILE        replay a recording, report, exit
+ *                --admin NAME         ::command rights for NAME (repeatable)
+ *                --worlds N           N worlds on ports 43594.., one asset load
+ *                --cluster N          one world split over N nodes on ports
+ *                                     43594.., by region (cluster.h)
+ *                --tick-shards N      move players on N threads by mapsquare
+ *                --config FILE        read options from FILE (config_file.h)
+ *                --max-players N      size tables for N players (also
+ *                                     --max-npcs, --max-ground-items,
+ *                                     --max-waypoints, --tick-ms; server.h)
+ *                --no-tick-governor   keep all work when ticks run long
+ *                --player-info-budget N  bytes of PLAYER_INFO per viewer
+ *                                     per tick, nearest first (update.h)
+ *                --session-grace N    keep a dropped player N ticks for a
+ *                                     reconnect, 0 = never (session.h)
+ *                --checkpoint-ticks N checkpoint the world every N ticks,
+ *                                     0 = never (checkpoint.h)
+ *                --log-level=<level>  error, warn, info, debug, trace
+ *                --log=<sub,...>      trace subsystems (see log.h)
+ *                --log-file=<path>    log to a rotated file (log_sink.h;
+ *                                     also --log-rotate=<MB>, --log-sync)
  * @return      Exit code (0 = success, 1 = failure)
  * 
  * ALGORITHM:
@@ -342,121 +740,67 @@ void signal_handler(int sig) {
  *   - Space: O(N) where N = MAX_PLAYERS
  */
 int main(int argc, char** argv) {
-    /* Suppress unused parameter warnings */
-    (void)argc;
-    (void)argv;
+    ServerOptions options = { 0 };
+    options.map_rate = MAP_TRANSFER_RATE_DEFAULT;
     
-    /*
-     * STEP 1: Allocate GameServer on heap
-     * 
-     * calloc() ensures all bytes are zeroed:
-     *   - player[].state = PLAYER_STATE_DISCONNECTED (0)
-     *   - server->running = false
-     *   - All pointers = NULL
-     */
-    /* Allocate server on heap to avoid stack overflow */
-    GameServer* server = calloc(1, sizeof(GameServer));
-    if (!server) {
-        fprintf(stderr, "ERROR: Failed to allocate server memory\n");
-        fprintf(stderr, "       Required: %zu bytes\n", sizeof(GameServer));
-        return 1;
+    /* --config FILE: its lines are options, overridden by the command line */
+    ConfigArgs config = { 0 };
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--config") != 0) continue;
+        if (!config_file_load(argv[i + 1], &config)) {
+            fprintf(stderr, "ERROR: Cannot read config file %s\n", argv[i + 1]);
+            return 1;
+        }
+        break;
     }
+    int exit_code = parse_options(&options, config.argc, config.argv, 0);
+    if (exit_code < 0) exit_code = parse_options(&options, argc, argv, 1);
+    config_file_free(&config);
+    if (exit_code >= 0) return exit_code;
     
-    /*
-     * STEP 2: Set global pointer for signal handler
-     * 
-     * Must be set before server_init() in case signal arrives during init
-     */
-    g_server = server;
+    /* Settings that depend on the tick period */
+    server_limits_clamp(&g_server_limits);
+    if (!options.tick_budget_set) g_tick_stats.budget_ms = g_server_limits.tick_ms / 2;
+    g_map_transfer_tick_bytes = MAP_TRANSFER_TICK_BYTES(options.map_rate, g_server_limits.tick_ms);
     
-    /*
-     * STEP 3: Register signal handlers
-     * 
-     * SIGINT:  Ctrl+C (interrupt)
-     * SIGTERM: kill <pid> (termination request)
-     * 
-     * Both signals now invoke signal_handler() for graceful shutdown
-     */
-    signal(SIGINT, signal_handler);
-    signal(SIGTERM, signal_handler);
+    /* --cluster N: the supervisor's N processes are nodes of one world */
+    if (options.cluster > 0) {
+        if (options.cluster < 2 || options.worlds > 1 || options.net_thread) {
+            fprintf(stderr, "ERROR: --cluster needs 2 or more nodes, without --worlds or --net-thread\n");
+            return 1;
+        }
+        options.worlds = options.cluster;
+    }
     
-    /*
-     * STEP 4: Print startup banner
-     */
-    printf("========================================\n");
-    printf("  RuneScape Private Server (C)\n");
-    printf("  Revision: 225 (May 2004 Protocol)\n");
-    printf("  Port: %d\n", SERVER_PORT);
-    printf("========================================\n");
-    printf("Starting server...\n");
+    /* One world, as always */
+    if (options.worlds <= 1) {
+        return run_world(&options, SERVER_PORT);
+    }
     
     /*
-     * STEP 5: Initialize server subsystems
-     * 
-     * Initializes in order:
-     *   - World state
-     *   - Cache system (item/NPC/object definitions)
-     *   - Item system
-     *   - NPC system
-     *   - Object system
-     *   - Player slots
-     *   - Network socket
-     * 
-     * Returns false on critical failure (port in use, out of memory, etc.)
+     * --worlds N: load the read-only assets once, map the shared account
+     * registry, then fork one process per world (supervisor.h)
      */
-    if (!server_init(server, SERVER_PORT)) {
-        fprintf(stderr, "ERROR: Server initialization failed\n");
-        fprintf(stderr, "       Common causes:\n");
-        fprintf(stderr, "         - Port %d already in use\n", SERVER_PORT);
-        fprintf(stderr, "         - Insufficient memory\n");
-        fprintf(stderr, "         - Missing data files\n");
-        free(server);
-        g_server = NULL;
+    if (options.replay_path || options.record_path || options.save_log) {
+        fprintf(stderr, "ERROR: --worlds cannot be combined with --replay, --record or --save-log\n");
         return 1;
     }
-    
-    /*
-     * STEP 6: Enter main event loop
-     * 
-     * server_run() blocks until server->running becomes false
-     * This happens when:
-     *   - Signal handler calls server_shutdown()
-     *   - Critical error occurs
-     */
-    printf("========================================\n");
-    printf("  Server is now online!\n");
-    printf("  Press Ctrl+C to stop gracefully\n");
-    printf("========================================\n");
-    server_run(server);
-    
-    /*
-     * STEP 7: Graceful shutdown
-     * 
-     * Only reached after server_run() returns (server->running = false)
-     * Performs final cleanup:
-     *   - Disconnect remaining players
-     *   - Save data
-     *   - Close network sockets
-     *   - Free subsystem resources
-     */
-    printf("Performing final cleanup...\n");
-    server_shutdown(server);
-    
-    /*
-     * STEP 8: Free heap memory
-     * 
-     * Deallocates GameServer structure
-     * All player slots, buffers, and subsystem data are freed
-     */
-    free(server);
-    g_server = NULL;
-    
-    /*
-     * STEP 9: Exit successfully
-     */
-    printf("========================================\n");
-    printf("  Server stopped cleanly\n");
-    printf("  Exit code: 0 (success)\n");
-    printf("========================================\n");
-    return 0;
+    if (options.worlds > SUPERVISOR_MAX_WORLDS) {
+        fprintf(stderr, "ERROR: At most %d worlds\n", SUPERVISOR_MAX_WORLDS);
+        return 1;
+    }
+    printf("Supervisor: loading shared assets for %u worlds...\n", options.worlds);
+    g_account_registry = account_registry_create(options.worlds);
+    if (!g_account_registry || !server_load_assets()) {
+        fprintf(stderr, "ERROR: Failed to prepare the shared assets\n");
+        return 1;
+    }
+    if (options.cluster > 0 && !cluster_links_create(options.cluster)) {
+        fprintf(stderr, "ERROR: Failed to link the cluster nodes\n");
+        return 1;
+    }
+    int result = supervisor_run(options.worlds, run_supervised_world, &options);
+    account_registry_destroy(g_account_registry);
+    g_account_registry = NULL;
+    return result;
 }
@@ -16,8 +16,8 @@
  * IMPLEMENTATION DETAILS:
  *
  *   CRC32 Implementation:
- *     - Table-driven for O(1) per-byte lookup
- *     - Lazy initialization (builds table on first use)
+ *     - The shared crc32() (crc32.c): slicing-by-8, or PCLMULQDQ /
+ *       ARMv8 CRC32 instructions when the CPU has them
  *     - Standard polynomial: 0xEDB88320
  *     - Used by: ZIP, PNG, Ethernet, MPEG-2
  *
@@ -34,39 +34,34 @@
  * MEMORY MANAGEMENT:
  *
  *   Static allocations:
- *     - CRC32 table: 256 entries x 4 bytes = 1024 bytes
  *     - File coordinate list: 9 entries x 8 bytes = 72 bytes (stack)
  *
  *   Dynamic allocations:
- *     - Map file buffers: allocated per-file, freed after transmission
- *     - Packet buffers: allocated per-packet, freed after send
- *
- * CROSS-PLATFORM COMPATIBILITY:
- *
- *   Path separators:
- *     - Windows: backslash (\)
- *     - Unix/Linux: forward slash (/)
- *     - Handled via PATH_SEPARATOR macro
+ *     - Map file buffers: none per request; every file is loaded once
+ *       into the map store at startup (map_store.c), which also owns
+ *       the platform-specific directory and path handling
+ *     - Packets: written into the player's output arena
  *
  *******************************************************************************
  */
 
 #include "map.h"
 #include "buffer.h"
+#include "crc32.h"
 #include "packets.h"
+#include "packet_codec.h"
 #include "network.h"
+#include "map_store.h"
+#include "metrics.h"
+#include "trace.h"
+#include "instance.h"
+#include "traffic.h"
+#include "log.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-#ifdef _WIN32
-#include <windows.h>
-#include <direct.h>
-#define PATH_SEPARATOR "\\"
-#else
-#include <sys/stat.h>
-#define PATH_SEPARATOR "/"
-#endif
+u32 g_map_transfer_tick_bytes = MAP_TRANSFER_TICK_BYTES(MAP_TRANSFER_RATE_DEFAULT, TICK_RATE_MS);
 
 /*
  *******************************************************************************
@@ -153,56 +148,14 @@
  *     - All burst errors up to 32 bits
  *     - Most larger errors (99.9999% detection rate)
  *
- */
-
-/* CRC32 lookup table (1024 bytes) */
-static u32 crc32_table[256];
-static bool crc32_initialized = false;
-
-/*
- * FUNCTION: init_crc32_table (internal)
+ * IMPLEMENTATION:
  *
- * Builds the CRC32 lookup table using the IEEE 802.3 polynomial.
- * This is called once on first CRC calculation.
+ *   The table walk above is the reference; crc32.c runs 8 tables at
+ *   once (slicing-by-8) or the CPU's carry-less multiply / CRC32
+ *   instructions, with identical results. Maps, saves and snapshots
+ *   share that one implementation.
  *
- * ALGORITHM:
- *   For i from 0 to 255:
- *     crc = i
- *     For j from 0 to 7:
- *       if (crc & 1):  // lowest bit is 1
- *         crc = (crc >> 1) XOR 0xEDB88320
- *       else:          // lowest bit is 0
- *         crc = crc >> 1
- *     table[i] = crc
- *
- * EXAMPLE TRACE (i=1):
- *   Start: crc = 0x00000001
- *   j=0: bit 0 is 1, crc = 0x00000000 ^ 0xEDB88320 = 0xF6798990
- *   j=1: bit 0 is 0, crc = 0x7B3CC4C8
- *   j=2: bit 0 is 0, crc = 0x3D9E6264
- *   j=3: bit 0 is 0, crc = 0x1ECF3132
- *   j=4: bit 0 is 0, crc = 0x0F679899
- *   j=5: bit 0 is 1, crc = 0x07B3CC4C ^ 0xEDB88320 = 0xEA65586C
- *   j=6: bit 0 is 0, crc = 0x7532AC36
- *   j=7: bit 0 is 0, crc = 0x3A99561B
- *   (Note: actual calculation may differ due to bit manipulation)
  */
-static void init_crc32_table() {
-    if (crc32_initialized) return;
-    
-    for (u32 i = 0; i < 256; i++) {
-        u32 crc = i;
-        for (int j = 0; j < 8; j++) {
-            if (crc & 1) {
-                crc = (crc >> 1) ^ 0xedb88320u;
-            } else {
-                crc >>= 1;
-            }
-        }
-        crc32_table[i] = crc;
-    }
-    crc32_initialized = true;
-}
 
 /*
  * FUNCTION: map_calculate_crc32
@@ -247,17 +200,11 @@ static void init_crc32_table() {
  *   32-bit CRC32 checksum
  *
  * PERFORMANCE:
- *   ~3-4 CPU cycles per byte on modern processors
- *   Example: 5KB file = approximately 20,000 cycles = 5 microseconds at 4GHz
+ *   Delegates to crc32(): ~2 GB/s slicing-by-8, ~20 GB/s with PCLMULQDQ.
+ *   A 64 KB map file is checksummed in ~3 microseconds.
  */
 u32 map_calculate_crc32(const u8* data, u32 length) {
-    init_crc32_table();
-    
-    u32 crc = 0xffffffffu;
-    for (u32 i = 0; i < length; i++) {
-        crc = (crc >> 8) ^ crc32_table[(crc ^ data[i]) & 0xff];
-    }
-    return ~crc;
+    return crc32(data, length);
 }
 
 /*
@@ -369,74 +316,42 @@ static void add_unique(FileCoord* files, i32* file_count, i32 fx, i32 fz) {
 }
 
 /*
- * FUNCTION: read_file_to_buffer (internal)
- *
- * Reads an entire file into a dynamically allocated buffer.
- *
- * PROCESS:
- *   1. Open file in binary read mode
- *   2. Seek to end to determine file size
- *   3. Seek back to start
- *   4. Allocate buffer of exact size
- *   5. Read entire file in one operation
- *   6. Close file
- *
- * ERROR HANDLING:
- *   - File doesn't exist: return false
- *   - File is empty (size <= 0): return false
- *   - Memory allocation fails: return false
- *   - Read fails or incomplete: free buffer and return false
- *
- * MEMORY RESPONSIBILITY:
- *   Caller must free the allocated buffer when done.
+ * map_area_files - The unique files of the 3x3 area around a position
  *
- * PARAMETERS:
- *   path - File path to read
- *   data - Output pointer to allocated buffer (set by function)
- *   size - Output file size (set by function)
- *
- * RETURNS:
- *   true if successful, false on any error
- *
- * EXAMPLE USAGE:
- *   u8* buffer = NULL;
- *   u32 size = 0;
- *   if (read_file_to_buffer("data/maps/m_50_50", &buffer, &size)) {
- *       // Use buffer...
- *       free(buffer);
- *   }
+ * Steps 1-3 of map_send_load_area() below. Returns the file count (1-9).
  */
-static bool read_file_to_buffer(const char* path, u8** data, u32* size) {
-    FILE* file = fopen(path, "rb");
-    if (!file) {
-        return false;
-    }
-    
-    fseek(file, 0, SEEK_END);
-    long file_size = ftell(file);
-    fseek(file, 0, SEEK_SET);
-    
-    if (file_size <= 0) {
-        fclose(file);
-        return false;
-    }
+static i32 map_area_files(i32 abs_x, i32 abs_z, FileCoord files[9]) {
+    i32 centre_file_x = map_get_file_coord(abs_x);
+    i32 centre_file_z = map_get_file_coord(abs_z);
+    i32 file_count = 0;
     
-    *data = malloc(file_size);
-    if (!*data) {
-        fclose(file);
-        return false;
-    }
+    /* Center */
+    add_unique(files, &file_count, centre_file_x, centre_file_z);
     
-    size_t read_size = fread(*data, 1, file_size, file);
-    fclose(file);
+    /* Cardinal directions */
+    add_unique(files, &file_count, centre_file_x, map_get_file_coord(abs_z + 52));
+    add_unique(files, &file_count, centre_file_x, map_get_file_coord(abs_z - 52));
+    add_unique(files, &file_count, map_get_file_coord(abs_x + 52), centre_file_z);
+    add_unique(files, &file_count, map_get_file_coord(abs_x - 52), centre_file_z);
     
-    if (read_size != file_size) {
-        free(*data);
-        return false;
-    }
+    /* Diagonals */
+    add_unique(files, &file_count, map_get_file_coord(abs_x + 52), map_get_file_coord(abs_z + 52));
+    add_unique(files, &file_count, map_get_file_coord(abs_x - 52), map_get_file_coord(abs_z + 52));
+    add_unique(files, &file_count, map_get_file_coord(abs_x + 52), map_get_file_coord(abs_z - 52));
+    add_unique(files, &file_count, map_get_file_coord(abs_x - 52), map_get_file_coord(abs_z - 52));
     
-    *size = (u32)file_size;
-    return true;
+    return file_count;
+}
+
+/*
+ * map_file_get - map_store_get() behind the instance redirect
+ *
+ * An instance's file coordinates (instance.h) name its base mapsquare's
+ * files; every other coordinate is looked up as it is.
+ */
+static const MapFile* map_file_get(const MapStore* store, MapFileType type, i32 file_x, i32 file_z) {
+    instance_map_source(g_instances, &file_x, &file_z);
+    return map_store_get(store, type, file_x, file_z);
 }
 
 /*
@@ -477,13 +392,12 @@ static bool read_file_to_buffer(const char* path, u8** data, u32* size) {
  *   Step 3: Eliminate duplicates
  *     Use add_unique() to prevent sending same file twice
  *
- *   Step 4: Calculate CRCs for each unique file
+ *   Step 4: Look up CRCs for each unique file
  *     For each file coordinate (x, z):
- *       - Read m_X_Z (land file)
- *       - Calculate CRC32
- *       - Read l_X_Z (loc file)  
- *       - Calculate CRC32
- *       - Store both CRCs
+ *       - Land CRC from the map store (m_X_Z, computed at startup)
+ *       - Loc CRC from the map store (l_X_Z, computed at startup)
+ *       - Missing files send CRC 0
+ *     No disk I/O happens here (see map_store.h).
  *
  *   Step 5: Build and send packet
  *     Write region_x, region_y
@@ -524,39 +438,44 @@ static bool read_file_to_buffer(const char* path, u8** data, u32* size) {
  */
 void map_send_load_area(Player* player, i32 region_x, i32 region_y) {
     if (!player || player->socket_fd < 0) return;
+    u64 trace_start = trace_begin();
     
-    i32 abs_x = (i32)player->position.x;
-    i32 abs_z = (i32)player->position.z;
-    
-    i32 centre_file_x = map_get_file_coord(abs_x);
-    i32 centre_file_z = map_get_file_coord(abs_z);
+    i32 abs_x = (i32)position_x(&player->position);
+    i32 abs_z = (i32)position_z(&player->position);
     
     /* Collect unique map files to send (center + 8 surrounding) */
     FileCoord files[9];
-    i32 file_count = 0;
+    i32 file_count = map_area_files(abs_x, abs_z, files);
     
-    /* Center */
-    add_unique(files, &file_count, centre_file_x, centre_file_z);
-    
-    /* Cardinal directions */
-    add_unique(files, &file_count, centre_file_x, map_get_file_coord(abs_z + 52));
-    add_unique(files, &file_count, centre_file_x, map_get_file_coord(abs_z - 52));
-    add_unique(files, &file_count, map_get_file_coord(abs_x + 52), centre_file_z);
-    add_unique(files, &file_count, map_get_file_coord(abs_x - 52), centre_file_z);
+    /* CRCs first (precomputed: pure table lookups), to compare with the last area */
+    i32 zone_x = abs_x >> 3;
+    i32 zone_z = abs_z >> 3;
+    u32 area[2 + 9 * 3];
+    u32 words = 0;
+    area[words++] = (u32)zone_x;
+    area[words++] = (u32)zone_z;
+    for (i32 i = 0; i < file_count; i++) {
+        const MapFile* land = map_file_get(g_map_store, MAP_FILE_LAND, files[i].x, files[i].z);
+        const MapFile* loc = map_file_get(g_map_store, MAP_FILE_LOC, files[i].x, files[i].z);
+        area[words++] = ((u32)files[i].x << 8) | (u32)files[i].z;
+        area[words++] = land ? land->crc : 0;
+        area[words++] = loc ? loc->crc : 0;
+    }
     
-    /* Diagonals */
-    add_unique(files, &file_count, map_get_file_coord(abs_x + 52), map_get_file_coord(abs_z + 52));
-    add_unique(files, &file_count, map_get_file_coord(abs_x - 52), map_get_file_coord(abs_z + 52));
-    add_unique(files, &file_count, map_get_file_coord(abs_x + 52), map_get_file_coord(abs_z - 52));
-    add_unique(files, &file_count, map_get_file_coord(abs_x - 52), map_get_file_coord(abs_z - 52));
+    /* Same zone, files and CRCs as the client's current scene: nothing to rebuild */
+    u32 digest = crc32((const u8*)area, words * sizeof(u32));
+    if (digest == player->area_digest) {
+        metrics_add(&g_metrics.load_areas_skipped, 1);
+        trace_end(trace_start, "map_send_load_area", player->index);
+        return;
+    }
+    player->area_digest = digest;
     
     /* Create packet */
-    StreamBuffer* out = buffer_create(6 + file_count * 10);
-    buffer_write_header_var(out, SERVER_LOAD_AREA, player->out_cipher.initialized ? &player->out_cipher : NULL, VAR_SHORT);
+    StreamBuffer* out = player_out(player);
+    buffer_write_header_var(out, SERVER_LOAD_AREA, player->conn->out_cipher.initialized ? &player->conn->out_cipher : NULL, VAR_SHORT);
     u32 payload_start = out->position;
 
-    i32 zone_x = abs_x >> 3;
-    i32 zone_z = abs_z >> 3;
     buffer_write_short(out, zone_x, BYTE_ORDER_BIG);
     buffer_write_short(out, zone_z, BYTE_ORDER_BIG);
     
@@ -564,48 +483,217 @@ void map_send_load_area(Player* player, i32 region_x, i32 region_y) {
     player->origin_x = abs_x;
     player->origin_z = abs_z;
     
-    /* Write file entries with CRCs */
+    /* File entries: [x][z][land crc][loc crc] */
     for (i32 i = 0; i < file_count; i++) {
-        char land_path[256];
-        char loc_path[256];
-        u32 land_crc = 0;
-        u32 loc_crc = 0;
-        
-        snprintf(land_path, sizeof(land_path), "data%smaps%sm%d_%d", 
-                 PATH_SEPARATOR, PATH_SEPARATOR, files[i].x, files[i].z);
-        snprintf(loc_path, sizeof(loc_path), "data%smaps%sl%d_%d", 
-                 PATH_SEPARATOR, PATH_SEPARATOR, files[i].x, files[i].z);
-        
-        /* Calculate CRCs */
-        u8* data = NULL;
-        u32 size = 0;
-        if (read_file_to_buffer(land_path, &data, &size)) {
-            land_crc = map_calculate_crc32(data, size);
-            free(data);
-        }
-        
-        data = NULL;
-        size = 0;
-        if (read_file_to_buffer(loc_path, &data, &size)) {
-            loc_crc = map_calculate_crc32(data, size);
-            free(data);
-        }
-        
         buffer_write_byte(out, files[i].x);
         buffer_write_byte(out, files[i].z);
-        buffer_write_int(out, (i32)land_crc, BYTE_ORDER_BIG);
-        buffer_write_int(out, (i32)loc_crc, BYTE_ORDER_BIG);
+        buffer_write_int(out, (i32)area[2 + i * 3 + 1], BYTE_ORDER_BIG);
+        buffer_write_int(out, (i32)area[2 + i * 3 + 2], BYTE_ORDER_BIG);
     }
     
     buffer_finish_var_header(out, VAR_SHORT);
     dbg_log_send("LOAD_AREA", SERVER_LOAD_AREA, "varshort",
         (int)(out->position - payload_start),
-          player->out_cipher.initialized ? 1 : 0);
+          player->conn->out_cipher.initialized ? 1 : 0);
 
-    network_send(player->socket_fd, out->data, out->position);
-    buffer_destroy(out);
+    player_out_commit(player);
     
-    printf("Sent LOAD_AREA: region (%d, %d) with %d map files\n", region_x, region_y, file_count);
+    LOG_DEBUG("Sent LOAD_AREA: region (%d, %d) with %d map files\n", region_x, region_y, file_count);
+    trace_end(trace_start, "map_send_load_area", player->index);
+}
+
+/*
+ * FUNCTION: map_prefetch_ahead
+ *
+ * Called when a player enters a new zone. If their current step heads
+ * out of the reload bounds within MAP_PREFETCH_TILES, the area they will
+ * be sent on the way out is predicted from the step direction, and its
+ * files that the current area lacks are prefetched (map_store_prefetch).
+ *
+ *   reload bounds (origin zone -4 .. +5)
+ *   ┌──────────────────────────┐
+ *   │              player →  ··│·· exit in ≤ 16 tiles
+ *   │                          │   → area around the exit point:
+ *   └──────────────────────────┘     prefetch its new files once
+ *
+ * Each predicted area is prefetched once (player->prefetch_zone); a
+ * player who turns around costs nothing but a few page-cache hints.
+ */
+void map_prefetch_ahead(Player* player) {
+    i32 dir = player->secondary_direction >= 0 ? player->secondary_direction
+                                               : player->primary_direction;
+    if (dir < 0 || dir > 7) return;
+    i32 dx = DIRECTION_DELTA_X[dir];
+    i32 dz = DIRECTION_DELTA_Z[dir];
+    
+    /* The bounds player_step_movement() checks */
+    i32 origin_zone_x = (i32)(player->origin_x >> 3);
+    i32 origin_zone_z = (i32)(player->origin_z >> 3);
+    i32 x = (i32)position_x(&player->position);
+    i32 z = (i32)position_z(&player->position);
+    
+    i32 steps = MAP_PREFETCH_TILES + 1;
+    if (dx > 0 && ((origin_zone_x + 5) << 3) - x < steps) steps = ((origin_zone_x + 5) << 3) - x;
+    if (dx < 0 && x - ((origin_zone_x - 4) << 3) + 1 < steps) steps = x - ((origin_zone_x - 4) << 3) + 1;
+    if (dz > 0 && ((origin_zone_z + 5) << 3) - z < steps) steps = ((origin_zone_z + 5) << 3) - z;
+    if (dz < 0 && z - ((origin_zone_z - 4) << 3) + 1 < steps) steps = z - ((origin_zone_z - 4) << 3) + 1;
+    if (steps > MAP_PREFETCH_TILES) return;
+    
+    i32 next_x = x + dx * steps;
+    i32 next_z = z + dz * steps;
+    if (next_x < 0 || next_z < 0) return;
+    u32 key = ((u32)(next_x >> 3) << 16) | (u32)(next_z >> 3);
+    if (key == player->prefetch_zone) return;
+    player->prefetch_zone = key;
+    
+    FileCoord next[9], now[9];
+    i32 next_count = map_area_files(next_x, next_z, next);
+    i32 now_count = map_area_files((i32)player->origin_x, (i32)player->origin_z, now);
+    for (i32 i = 0; i < next_count; i++) {
+        bool have = false;
+        for (i32 k = 0; k < now_count && !have; k++) {
+            have = now[k].x == next[i].x && now[k].z == next[i].z;
+        }
+        if (!have) {
+            i32 file_x = next[i].x, file_z = next[i].z;
+            instance_map_source(g_instances, &file_x, &file_z);
+            map_store_prefetch(g_map_store, file_x, file_z);
+            metrics_add(&g_metrics.map_prefetches, 1);
+        }
+    }
+}
+
+/*
+ * FUNCTION: map_area_changed
+ *
+ * Whether the files of a player's last LOAD_AREA differ between two map
+ * stores, as the client would see it: any land or loc CRC changed, or a
+ * file appeared or disappeared (CRC 0 in LOAD_AREA).
+ *
+ * The area is recomputed from the origin the LOAD_AREA was sent for
+ * (player->origin_x / origin_z), not from where the player stands now.
+ */
+bool map_area_changed(const Player* player, const MapStore* before, const MapStore* after) {
+    FileCoord files[9];
+    i32 file_count = map_area_files((i32)player->origin_x, (i32)player->origin_z, files);
+    
+    for (i32 i = 0; i < file_count; i++) {
+        for (u32 type = 0; type < MAP_FILE_TYPE_COUNT; type++) {
+            const MapFile* a = map_file_get(before, (MapFileType)type, files[i].x, files[i].z);
+            const MapFile* b = map_file_get(after, (MapFileType)type, files[i].x, files[i].z);
+            if ((a ? a->crc : 0) != (b ? b->crc : 0)) return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * map_send_chunks - Queue chunks [first, first + count) of a stored file
+ *
+ * Writes, per chunk, the player's ISAAC-encrypted opcode followed by the
+ * shared [len][x][z][offset][total][data] bytes from the map store. The
+ * chunk opcodes' keys come from isaac_keys() in one go rather than one
+ * isaac_get_next() per packet, which is why count is fixed up front.
+ *
+ * file_x / file_z are the coordinates the client asked for. They differ
+ * from the stored chunk's only for an instance (instance.h), whose chunks
+ * are its base file's with the two coordinate bytes rewritten.
+ */
+static void map_send_chunks(Player* player, const MapFile* file, u8 data_opcode,
+                            u8 file_x, u8 file_z, u32 first, u32 count) {
+    ISAACCipher* cipher = player->conn->out_cipher.initialized ? &player->conn->out_cipher : NULL;
+    
+    /* The chunk headers are a known run: take their keys in batches */
+    u32 keys[64];
+    for (u32 i = 0; i < count; i++) {
+        u32 k = i % 64;
+        if (k == 0 && cipher) {
+            isaac_keys(cipher, keys, count - i < 64 ? count - i : 64);
+        }
+        u32 size;
+        const u8* chunk = map_file_chunk(file, first + i, &size);
+        
+        StreamBuffer* out = player_out(player);
+        buffer_write_byte(out, (u8)(data_opcode + (cipher ? keys[k] : 0)));
+        if (chunk[2] == file_x && chunk[3] == file_z) {
+            buffer_write_bytes(out, chunk, size);
+        } else {
+            u8 coords[2] = { file_x, file_z };
+            buffer_write_bytes(out, chunk, 2);
+            buffer_write_bytes(out, coords, 2);
+            buffer_write_bytes(out, chunk + 4, size - 4);
+        }
+        player_out_commit(player);
+        metrics_add(&g_metrics.map_bytes, size);
+        traffic_add(player->conn, TRAFFIC_MAP_BYTES, size);
+    }
+    metrics_add(&g_metrics.packets_out[data_opcode], count);
+}
+
+/*
+ * map_send_done - Queue the DATA_LAND_DONE / DATA_LOC_DONE of a file
+ */
+static void map_send_done(Player* player, MapFileType type, i32 file_x, i32 file_z) {
+    ISAACCipher* cipher = player->conn->out_cipher.initialized ? &player->conn->out_cipher : NULL;
+    StreamBuffer* done = player_out(player);
+    if (type == MAP_FILE_LAND) {
+        encode_data_land_done(done, cipher, (u8)file_x, (u8)file_z);
+    } else {
+        encode_data_loc_done(done, cipher, (u8)file_x, (u8)file_z);
+    }
+    player_out_commit(player);
+}
+
+static u8 map_data_opcode(MapFileType type) {
+    return type == MAP_FILE_LAND ? SERVER_DATA_LAND : SERVER_DATA_LOC;
+}
+
+/*
+ * map_send_file - Stream one stored map file at once
+ *
+ * Every chunk, then the DONE packet. A file that does not exist only gets
+ * the DONE packet, exactly as before.
+ */
+static void map_send_file(Player* player, MapFileType type, i32 file_x, i32 file_z) {
+    const MapFile* file = map_file_get(g_map_store, type, file_x, file_z);
+    if (file) {
+        map_send_chunks(player, file, map_data_opcode(type), (u8)file_x, (u8)file_z,
+                        0, file->chunk_count);
+    }
+    map_send_done(player, type, file_x, file_z);
+}
+
+/*
+ * map_queue_file - Add one requested file to the player's transfer queue
+ *
+ * A file asked for again starts over: the client has dropped whatever it
+ * had received of it. With the queue full, the file is sent at once, as
+ * every file was before pacing.
+ */
+static void map_queue_file(Player* player, MapFileType type, u8 file_x, u8 file_z) {
+    PlayerConnection* conn = player->conn;
+    const MapFile* file = map_file_get(g_map_store, type, file_x, file_z);
+    u32 crc = file ? file->crc : 0;
+    
+    for (u32 i = 0; i < conn->map_queue_count; i++) {
+        MapTransfer* transfer = &conn->map_queue[i];
+        if (transfer->type == type && transfer->file_x == file_x && transfer->file_z == file_z) {
+            transfer->next_chunk = 0;
+            transfer->crc = crc;
+            return;
+        }
+    }
+    
+    if (conn->map_queue_count == PLAYER_MAP_QUEUE) {
+        map_send_file(player, type, file_x, file_z);
+        return;
+    }
+    MapTransfer* transfer = &conn->map_queue[conn->map_queue_count++];
+    transfer->type = (u8)type;
+    transfer->file_x = file_x;
+    transfer->file_z = file_z;
+    transfer->next_chunk = 0;
+    transfer->crc = crc;
 }
 
 /*
@@ -647,16 +735,84 @@ void map_handle_request(Player* player, StreamBuffer* in, i32 packet_length) {
     if (!player || !in) return;
     
     i32 entries = packet_length / 3;
+    if (entries <= 0 || !buffer_require(in, (u32)entries * 3)) return;
+    
+    /* Layout checked once above: unchecked reads (see buffer.h) */
     for (i32 i = 0; i < entries; i++) {
-        u8 type = buffer_read_byte(in, false);
-        u8 x = buffer_read_byte(in, false);
-        u8 z = buffer_read_byte(in, false);
+        u8 type = buffer_get_u8(in);
+        u8 x = buffer_get_u8(in);
+        u8 z = buffer_get_u8(in);
         
-        if (type == 0) {
-            map_send_land_data(player, x, z);
-        } else {
-            map_send_loc_data(player, x, z);
+        map_queue_file(player, type == 0 ? MAP_FILE_LAND : MAP_FILE_LOC, x, z);
+    }
+}
+
+/*
+ * map_pump_player - Queue this tick's share of a player's map transfers
+ *
+ * Oldest request first. A transfer whose file changed under it (a map
+ * reload, asset_reload.h) is dropped: that player was sent a fresh
+ * LOAD_AREA and asks again.
+ */
+static void map_pump_player(Player* player) {
+    PlayerConnection* conn = player->conn;
+    
+    /* Room left this tick: the rate, then what the client has not yet read */
+    u32 budget = UINT32_MAX;
+    if (g_map_transfer_tick_bytes > 0) {
+        u32 backlog = player_out_backlog(player);
+        u32 room = backlog < MAP_TRANSFER_WINDOW ? MAP_TRANSFER_WINDOW - backlog : 0;
+        budget = g_map_transfer_tick_bytes < room ? g_map_transfer_tick_bytes : room;
+    }
+    
+    /* A congested connection (player.h) gets nothing until it drains */
+    if (player_out_congested(player)) budget = 0;
+    
+    u32 finished = 0;
+    u32 spent = 0;
+    while (finished < conn->map_queue_count && spent < budget) {
+        MapTransfer* transfer = &conn->map_queue[finished];
+        MapFileType type = (MapFileType)transfer->type;
+        const MapFile* file = map_file_get(g_map_store, type, transfer->file_x, transfer->file_z);
+        if ((file ? file->crc : 0) != transfer->crc) {
+            finished++;
+            continue;
+        }
+        
+        /* As many whole chunks as the budget covers (at least one) */
+        u32 chunks = file ? file->chunk_count : 0;
+        u32 count = 0;
+        while (transfer->next_chunk + count < chunks && spent < budget) {
+            u32 size;
+            map_file_chunk(file, transfer->next_chunk + count, &size);
+            spent += size;
+            count++;
         }
+        if (count > 0) {
+            map_send_chunks(player, file, map_data_opcode(type), transfer->file_x, transfer->file_z,
+                            transfer->next_chunk, count);
+        }
+        transfer->next_chunk = (u16)(transfer->next_chunk + count);
+        
+        if (transfer->next_chunk < chunks) break;
+        map_send_done(player, type, transfer->file_x, transfer->file_z);
+        finished++;
+    }
+    
+    conn->map_queue_count -= finished;
+    if (finished > 0 && conn->map_queue_count > 0) {
+        memmove(conn->map_queue, conn->map_queue + finished,
+                conn->map_queue_count * sizeof(MapTransfer));
+    }
+    if (conn->map_queue_count > 0) metrics_add(&g_metrics.map_transfers_deferred, 1);
+}
+
+void map_pump_transfers(Player* players, u32 count) {
+    if (!g_map_store) return;
+    for (u32 i = 0; i < count; i++) {
+        Player* player = &players[i];
+        if (player->conn->map_queue_count == 0 || player->socket_fd < 0) continue;
+        map_pump_player(player);
     }
 }
 
@@ -679,7 +835,7 @@ void map_handle_request(Player* player, StreamBuffer* in, i32 packet_length) {
  *     - Compatible: matches original client implementation
  *
  *   Algorithm steps:
- *     1. Read entire file into memory
+ *     1. Look up the file in the map store (already in memory)
  *     2. offset = 0
  *     3. While offset < total_size:
  *        a. remaining = min(1000, total_size - offset)
@@ -691,6 +847,10 @@ void map_handle_request(Player* player, StreamBuffer* in, i32 packet_length) {
  *        c. offset += remaining
  *     4. Send DATA_LAND_DONE packet
  *
+ *   Steps 2-3 are done once per file at startup: the map store keeps
+ *   every chunk serialized except its opcode, so per player each chunk
+ *   costs one encrypted opcode byte plus one memcpy (map_send_file).
+ *
  * PACKET SEQUENCE EXAMPLE (5000-byte file):
  *
  *   Packet 1: DATA_LAND [x=50, z=50, offset=0, total=5000, data[0..999]]
@@ -724,48 +884,9 @@ void map_handle_request(Player* player, StreamBuffer* in, i32 packet_length) {
  */
 void map_send_land_data(Player* player, i32 file_x, i32 file_z) {
     if (!player || player->socket_fd < 0) return;
-    
-    char path[256];
-    snprintf(path, sizeof(path), "data%smaps%sm%d_%d", 
-             PATH_SEPARATOR, PATH_SEPARATOR, file_x, file_z);
-    
-    u8* data = NULL;
-    u32 total_size = 0;
-    read_file_to_buffer(path, &data, &total_size);
-    
-    const i32 CHUNK_SIZE = 1000;
-    i32 offset = 0;
-    
-    while (offset < total_size && data != NULL) {
-        i32 remaining = (total_size - offset) < CHUNK_SIZE ? (total_size - offset) : CHUNK_SIZE;
-        
-        StreamBuffer* out = buffer_create(remaining + 8);
-        buffer_write_header_var(out, SERVER_DATA_LAND, player->out_cipher.initialized ? &player->out_cipher : NULL, VAR_SHORT);
-        buffer_write_byte(out, file_x);
-        buffer_write_byte(out, file_z);
-        buffer_write_short(out, offset, BYTE_ORDER_BIG);
-        buffer_write_short(out, total_size, BYTE_ORDER_BIG);
-        
-        for (i32 i = 0; i < remaining; i++) {
-            buffer_write_byte(out, data[offset + i]);
-        }
-        
-        buffer_finish_var_header(out, VAR_SHORT);
-        network_send(player->socket_fd, out->data, out->position);
-        buffer_destroy(out);
-        
-        offset += remaining;
-    }
-    
-    if (data) free(data);
-    
-    /* Send completion packet */
-    StreamBuffer* done = buffer_create(3);
-    buffer_write_header(done, SERVER_DATA_LAND_DONE, player->out_cipher.initialized ? &player->out_cipher : NULL);
-    buffer_write_byte(done, file_x);
-    buffer_write_byte(done, file_z);
-    network_send(player->socket_fd, done->data, done->position);
-    buffer_destroy(done);
+    u64 trace_start = trace_begin();
+    map_send_file(player, MAP_FILE_LAND, file_x, file_z);
+    trace_end(trace_start, "map_send_land_data", (u32)(file_x << 8 | file_z));
 }
 
 /*
@@ -802,46 +923,7 @@ void map_send_land_data(Player* player, i32 file_x, i32 file_z) {
  */
 void map_send_loc_data(Player* player, i32 file_x, i32 file_z) {
     if (!player || player->socket_fd < 0) return;
-    
-    char path[256];
-    snprintf(path, sizeof(path), "data%smaps%sl%d_%d", 
-             PATH_SEPARATOR, PATH_SEPARATOR, file_x, file_z);
-    
-    u8* data = NULL;
-    u32 total_size = 0;
-    read_file_to_buffer(path, &data, &total_size);
-    
-    const i32 CHUNK_SIZE = 1000;
-    i32 offset = 0;
-    
-    while (offset < total_size && data != NULL) {
-        i32 remaining = (total_size - offset) < CHUNK_SIZE ? (total_size - offset) : CHUNK_SIZE;
-        
-        StreamBuffer* out = buffer_create(remaining + 8);
-        buffer_write_header_var(out, SERVER_DATA_LOC, player->out_cipher.initialized ? &player->out_cipher : NULL, VAR_SHORT);
-        buffer_write_byte(out, file_x);
-        buffer_write_byte(out, file_z);
-        buffer_write_short(out, offset, BYTE_ORDER_BIG);
-        buffer_write_short(out, total_size, BYTE_ORDER_BIG);
-        
-        for (i32 i = 0; i < remaining; i++) {
-            buffer_write_byte(out, data[offset + i]);
-        }
-        
-        buffer_finish_var_header(out, VAR_SHORT);
-        network_send(player->socket_fd, out->data, out->position);
-        buffer_destroy(out);
-        
-        offset += remaining;
-    }
-    
-    if (data) free(data);
-    
-    /* Send completion packet */
-    StreamBuffer* done = buffer_create(3);
-    buffer_write_header(done, SERVER_DATA_LOC_DONE, player->out_cipher.initialized ? &player->out_cipher : NULL);
-    buffer_write_byte(done, file_x);
-    buffer_write_byte(done, file_z);
-    network_send(player->socket_fd, done->data, done->position);
-    buffer_destroy(done);
+    u64 trace_start = trace_begin();
+    map_send_file(player, MAP_FILE_LOC, file_x, file_z);
+    trace_end(trace_start, "map_send_loc_data", (u32)(file_x << 8 | file_z));
 }
@@ -126,7 +126,7 @@
  *
  *   CRC32 Calculation:
  *     Time: O(n) where n = file size in bytes
- *     Space: O(1) - uses 256-entry lookup table (1KB)
+ *     Space: O(1) - uses crc32.c's 8 KB of lookup tables
  *     Typical file size: 2-10 KB per region
  *
  *   Region Loading:
@@ -206,6 +206,7 @@
 #include "types.h"
 #include "player.h"
 #include "buffer.h"
+#include "map_store.h"
 
 /*
  * FUNCTION: map_calculate_crc32
@@ -214,8 +215,10 @@
  * polynomial (0xEDB88320). This checksum is used to validate map file
  * integrity and detect corruption.
  *
+ * Same value as crc32() (crc32.c), which does the work.
+ *
  * ALGORITHM:
- *   1. Initialize lookup table (one-time, 256 entries)
+ *   1. Initialize lookup tables (one-time, see crc32.c)
  *   2. Start with CRC = 0xFFFFFFFF
  *   3. For each byte in data:
  *      a. XOR byte with low 8 bits of CRC
@@ -232,7 +235,7 @@
  *
  * COMPLEXITY:
  *   Time: O(n) where n = length
- *   Space: O(1) - uses static 256-entry table
+ *   Space: O(1) - uses crc32.c's static tables
  *
  * EXAMPLE:
  *   u8 file_data[5000];
@@ -285,14 +288,99 @@ u32 map_calculate_crc32(const u8* data, u32 length);
  *   - Sends 9 region entries with CRCs
  *   - Client compares CRCs with cached files
  *   - Client requests files with mismatched/missing CRCs
+ *
+ * UNCHANGED AREAS:
+ *   The zone, file list and CRCs are hashed into player->area_digest.
+ *   If they match the last LOAD_AREA sent to this client (a teleport
+ *   within the same zone, say), nothing is sent: the client's scene is
+ *   already exactly that, and a rebuild would only blank it for a
+ *   moment and re-run its file checks. The client cannot be sent part
+ *   of an area: its scene is built from the full list every time.
  */
 void map_send_load_area(Player* player, i32 region_x, i32 region_y);
 
+/* How close to the reload bounds map_prefetch_ahead() starts, in tiles */
+#define MAP_PREFETCH_TILES 16
+
+/*
+ * FUNCTION: map_prefetch_ahead
+ *
+ * Warms the map files of the area a moving player is about to be sent.
+ *
+ * PARAMETERS:
+ *   player - Player who just entered a new zone (game thread)
+ *
+ * From the direction of the player's last step, predicts where they will
+ * leave the reload bounds (if within MAP_PREFETCH_TILES) and prefetches
+ * the files that area adds (map_store_prefetch()), so the MAP_REQUEST
+ * that follows the LOAD_AREA finds them in memory. Once per predicted
+ * area (player->prefetch_zone).
+ */
+void map_prefetch_ahead(Player* player);
+
+/*
+ * FUNCTION: map_area_changed
+ *
+ * Checks whether a reload changed anything the player was told about.
+ *
+ * PARAMETERS:
+ *   player - Player whose last LOAD_AREA is checked (origin_x/origin_z)
+ *   before - Store that LOAD_AREA was built from
+ *   after  - Replacement store
+ *
+ * RETURNS:
+ *   true if a land or loc CRC in the player's 3x3 area differs, or a
+ *   file was added or removed there
+ *
+ * USED BY:
+ *   asset_reload.c, to send a fresh LOAD_AREA only where maps changed
+ */
+bool map_area_changed(const Player* player, const MapStore* before, const MapStore* after);
+
+/*
+ * MAP TRANSFER PACING:
+ *
+ *   A MAP_REQUEST used to be answered on the spot: every chunk of every
+ *   file asked for, ~45 KB for a fresh 3x3 area, queued in one go. That
+ *   burst filled the socket's send buffer, and the next PLAYER_INFO sat
+ *   behind it, so a player crossing into a new area saw everyone around
+ *   them freeze until the download was through.
+ *
+ *   Requests now go into a per-connection queue (PlayerConnection's
+ *   map_queue) and are streamed at the end of each tick, after that
+ *   tick's game packets:
+ *
+ *     tick:  packets ─► world (PLAYER_INFO, NPC_INFO, zones, state)
+ *                    ─► map_pump_transfers()  chunks, in the room left
+ *     flush: [ game packets ][ map chunks ]  ─► socket
+ *
+ *   Each connection gets, per tick, the smaller of
+ *     - g_map_transfer_tick_bytes (--map-rate KB/s, default
+ *       MAP_TRANSFER_RATE_DEFAULT; 0 = no pacing, send everything)
+ *     - MAP_TRANSFER_WINDOW minus the output still unsent from earlier
+ *       (player_out_backlog), so a slow reader gets no new chunks until
+ *       it catches up, and game packets never queue behind more than
+ *       one window of map data.
+ *   and nothing at all while the connection is congested (the send
+ *   queue watermarks in player.h), paced or not.
+ *
+ *   Game packets are always written as they are produced; only map data
+ *   waits. A fresh area at the default rate takes two ticks.
+ */
+#define MAP_TRANSFER_RATE_DEFAULT 64            /* KB per second per connection */
+#define MAP_TRANSFER_WINDOW (32 * 1024)         /* Unsent bytes past which no chunks are added */
+#define MAP_TRANSFER_TICK_BYTES(kb_per_second, tick_ms) \
+    ((u32)((u64)(kb_per_second) * 1024 * (tick_ms) / 1000))
+
+/* Map bytes per connection per tick, 0 = unpaced (set by --map-rate) */
+extern u32 g_map_transfer_tick_bytes;
+
 /*
  * FUNCTION: map_handle_request
  *
  * Processes a MAP_REQUEST packet from the client. The client sends this
  * packet when it needs map files (either missing or CRC mismatch).
+ * The files are queued for map_pump_transfers(), not sent here.
  *
  * PACKET STRUCTURE:
  *   Each entry is 3 bytes:
@@ -304,7 +392,7 @@ void map_send_load_area(Player* player, i32 region_x, i32 region_y);
  *   1. Calculate number of entries (packet_length / 3)
  *   2. For each entry:
  *      a. Read type, x, z
- *      b. Call appropriate send function
+ *      b. Queue the file (a repeated request restarts it from chunk 0)
  *
  * PARAMETERS:
  *   player        - Pointer to player requesting map data
@@ -319,6 +407,22 @@ void map_send_load_area(Player* player, i32 region_x, i32 region_y);
  */
 void map_handle_request(Player* player, StreamBuffer* in, i32 packet_length);
 
+/*
+ * FUNCTION: map_pump_transfers
+ *
+ * Streams each connection's share of its queued map files (see MAP
+ * TRANSFER PACING above). Called by server_tick() after world_process(),
+ * so the chunks follow the tick's game packets in the same flush.
+ *
+ * PARAMETERS:
+ *   players - Player slots (the server's players[])
+ *   count   - Number of slots
+ *
+ * COMPLEXITY:
+ *   O(count) plus the chunks sent
+ */
+void map_pump_transfers(Player* players, u32 count);
+
 /*
  * FUNCTION: map_send_land_data
  *
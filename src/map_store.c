@@ -0,0 +1,375 @@
+/*******************************************************************************
+ * MAP_STORE.C - In-Memory Map File Store Implementation
+ *******************************************************************************
+ *
+ * STARTUP SCAN:
+ *
+ *   for each entry in data/maps/:
+ *       "m<x>_<z>" → LAND,  "l<x>_<z>" → LOC,  anything else → skip
+ *       map file read-only, crc = map_calculate_crc32(data)
+ *       index[type][(x << 8) | z] = slot
+ *
+ * Directory listing is the only platform-specific part:
+ *   POSIX:   opendir() / readdir()
+ *   Windows: FindFirstFileA() / FindNextFileA()
+ *
+ ******************************************************************************/
+
+#include "map_store.h"
+#include "map.h"
+#include "mem_stats.h"
+#include "thirdparty/bzip.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#define PATH_SEPARATOR "\\"
+#else
+#include <dirent.h>
+#define PATH_SEPARATOR "/"
+#endif
+
+MapStore* g_map_store = NULL;
+
+/*
+ * parse_map_name - Decode "m<x>_<z>" / "l<x>_<z>"
+ *
+ * @return  true if name is a map file with coordinates in [0, 255]
+ */
+static bool parse_map_name(const char* name, MapFileType* type, i32* x, i32* z) {
+    if (name[0] == 'm') {
+        *type = MAP_FILE_LAND;
+    } else if (name[0] == 'l') {
+        *type = MAP_FILE_LOC;
+    } else {
+        return false;
+    }
+
+    /* %n rejects trailing junk such as "m50_50.bak" */
+    int consumed = 0;
+    if (sscanf(name + 1, "%d_%d%n", x, z, &consumed) != 2) return false;
+    if (name[1 + consumed] != '\0') return false;
+    return *x >= 0 && *x <= 255 && *z >= 0 && *z <= 255;
+}
+
+/*
+ * encode_chunks - Serialize every chunk packet of a file (minus opcode)
+ *
+ * Same bytes map_send_land_data() used to write per player:
+ *   [len:2 BE][x][z][offset:2 BE][total:2 BE][data]
+ */
+static bool encode_chunks(MapFile* file, u8 file_x, u8 file_z) {
+    file->chunk_count = (file->size + MAP_CHUNK_DATA - 1) / MAP_CHUNK_DATA;
+    file->encoded_size = file->chunk_count * (2 + MAP_CHUNK_HEADER) + file->size;
+    u8* encoded = mem_alloc(MEM_MAP, file->encoded_size);
+    if (!encoded) return false;
+    file->encoded = encoded;
+
+    u8* p = encoded;
+    for (u32 offset = 0; offset < file->size; offset += MAP_CHUNK_DATA) {
+        u32 n = file->size - offset < MAP_CHUNK_DATA ? file->size - offset : MAP_CHUNK_DATA;
+        u32 length = MAP_CHUNK_HEADER + n;
+
+        *p++ = (u8)(length >> 8);
+        *p++ = (u8)length;
+        *p++ = file_x;
+        *p++ = file_z;
+        *p++ = (u8)(offset >> 8);
+        *p++ = (u8)offset;
+        *p++ = (u8)(file->size >> 8);
+        *p++ = (u8)file->size;
+        memcpy(p, file->data + offset, n);
+        p += n;
+    }
+    return true;
+}
+
+/*
+ * map_store_add - Load one directory entry into the store
+ */
+static void map_store_add(MapStore* store, const char* dir, const char* name) {
+    MapFileType type;
+    i32 x, z;
+    if (!parse_map_name(name, &type, &x, &z)) return;
+
+    u32 key = ((u32)x << 8) | (u32)z;
+    if (store->index[type][key] != MAP_STORE_NONE) return;  /* e.g. "m050_50" */
+    if (store->count >= MAP_STORE_NONE) return;
+
+    char path[512];
+    snprintf(path, sizeof(path), "%s%s%s", dir, PATH_SEPARATOR, name);
+
+    /* Read-only view of the page cache, shared with other server processes */
+    MappedFile view;
+    if (!mapped_file_open(&view, path)) return;
+
+    if (store->count == store->capacity) {
+        u32 new_capacity = store->capacity ? store->capacity * 2 : 256;
+        MapFile* grown = mem_realloc(MEM_MAP, store->files, new_capacity * sizeof(MapFile));
+        if (!grown) {
+            mapped_file_close(&view);
+            return;
+        }
+        store->files = grown;
+        store->capacity = new_capacity;
+    }
+
+    MapFile* file = &store->files[store->count];
+    file->view = view;
+    file->data = view.data;
+    file->size = view.size;
+    file->crc = map_calculate_crc32(file->data, file->size);
+    if (!encode_chunks(file, (u8)x, (u8)z)) {
+        mapped_file_close(&file->view);
+        return;
+    }
+
+    store->index[type][key] = (u16)store->count;
+    store->count++;
+    store->total_bytes += file->size + file->encoded_size;
+}
+
+MapStore* map_store_create(const char* dir) {
+    if (!dir) return NULL;
+
+    MapStore* store = mem_calloc(MEM_MAP, 1, sizeof(MapStore));
+    if (!store) return NULL;
+
+    /* 0xFF bytes → every u16 becomes MAP_STORE_NONE */
+    memset(store->index, 0xFF, sizeof(store->index));
+
+#ifdef _WIN32
+    char pattern[512];
+    snprintf(pattern, sizeof(pattern), "%s\\*", dir);
+    WIN32_FIND_DATAA entry;
+    HANDLE handle = FindFirstFileA(pattern, &entry);
+    if (handle != INVALID_HANDLE_VALUE) {
+        do {
+            if (!(entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+                map_store_add(store, dir, entry.cFileName);
+            }
+        } while (FindNextFileA(handle, &entry));
+        FindClose(handle);
+    } else {
+        fprintf(stderr, "WARNING: Map directory '%s' not found\n", dir);
+    }
+#else
+    DIR* handle = opendir(dir);
+    if (handle) {
+        struct dirent* entry;
+        while ((entry = readdir(handle)) != NULL) {
+            map_store_add(store, dir, entry->d_name);
+        }
+        closedir(handle);
+    } else {
+        fprintf(stderr, "WARNING: Map directory '%s' not found\n", dir);
+    }
+#endif
+
+    printf("Loaded %u map files (%llu bytes) from %s\n",
+           store->count, (unsigned long long)store->total_bytes, dir);
+    return store;
+}
+
+MapStore* map_store_create_from_snapshot(const Snapshot* snapshot) {
+    u32 count = 0, bytes_size = 0;
+    const MapFileRecord* records = snapshot_section(snapshot, SNAPSHOT_MAP_FILES,
+                                                    sizeof(MapFileRecord), &count);
+    const u8* bytes = snapshot_section(snapshot, SNAPSHOT_MAP_BYTES, 1, &bytes_size);
+    if (!records || !bytes || count >= MAP_STORE_NONE) return NULL;
+
+    MapStore* store = mem_calloc(MEM_MAP, 1, sizeof(MapStore));
+    if (!store) return NULL;
+    memset(store->index, 0xFF, sizeof(store->index));
+    store->from_snapshot = true;
+
+    store->files = mem_calloc(MEM_MAP, count ? count : 1, sizeof(MapFile));
+    if (!store->files) {
+        mem_free(store);
+        return NULL;
+    }
+    store->capacity = count;
+
+    for (u32 i = 0; i < count; i++) {
+        const MapFileRecord* r = &records[i];
+        u32 chunks = (r->size + MAP_CHUNK_DATA - 1) / MAP_CHUNK_DATA;
+        u32 key = ((u32)r->file_x << 8) | r->file_z;
+
+        /* The checksum says the bytes are what was written; still never trust an offset */
+        if (r->type >= MAP_FILE_TYPE_COUNT || store->index[r->type][key] != MAP_STORE_NONE ||
+            (u64)r->data_offset + r->size > bytes_size ||
+            (u64)r->encoded_offset + r->encoded_size > bytes_size ||
+            r->encoded_size != chunks * (2 + MAP_CHUNK_HEADER) + r->size) {
+            map_store_destroy(store);
+            return NULL;
+        }
+
+        MapFile* file = &store->files[store->count];
+        file->data = bytes + r->data_offset;
+        file->size = r->size;
+        file->crc = r->crc;
+        file->encoded = bytes + r->encoded_offset;
+        file->encoded_size = r->encoded_size;
+        file->chunk_count = chunks;
+
+        store->index[r->type][key] = (u16)store->count;
+        store->count++;
+        store->total_bytes += file->size + file->encoded_size;
+    }
+
+    printf("Mapped %u map files (%llu bytes) from the snapshot\n",
+           store->count, (unsigned long long)store->total_bytes);
+    return store;
+}
+
+bool map_store_snapshot(const MapStore* store, SnapshotWriter* writer) {
+    if (!store || !writer) return false;
+
+    u64 total = 0;
+    for (u32 i = 0; i < store->count; i++) {
+        total += store->files[i].size + store->files[i].encoded_size;
+    }
+    if (total > UINT32_MAX) return false;
+
+    MapFileRecord* records = snapshot_writer_alloc(writer, SNAPSHOT_MAP_FILES,
+                                                   sizeof(MapFileRecord), store->count);
+    u8* bytes = snapshot_writer_alloc(writer, SNAPSHOT_MAP_BYTES, 1, (u32)total);
+    if (!records || !bytes) return false;
+
+    /* Coordinates come from the index; files[] does not record them */
+    u32 offset = 0;
+    for (u32 type = 0; type < MAP_FILE_TYPE_COUNT; type++) {
+        for (u32 key = 0; key < 256 * 256; key++) {
+            u16 slot = store->index[type][key];
+            if (slot == MAP_STORE_NONE) continue;
+
+            const MapFile* file = &store->files[slot];
+            MapFileRecord* r = &records[slot];
+            r->type = (u8)type;
+            r->file_x = (u8)(key >> 8);
+            r->file_z = (u8)key;
+            r->crc = file->crc;
+            r->data_offset = offset;
+            r->size = file->size;
+            memcpy(bytes + offset, file->data, file->size);
+            offset += file->size;
+            r->encoded_offset = offset;
+            r->encoded_size = file->encoded_size;
+            memcpy(bytes + offset, file->encoded, file->encoded_size);
+            offset += file->encoded_size;
+        }
+    }
+    return true;
+}
+
+void map_store_destroy(MapStore* store) {
+    if (!store) return;
+    if (!store->from_snapshot) {
+        for (u32 i = 0; i < store->count; i++) {
+            mapped_file_close(&store->files[i].view);
+            mem_free((void*)store->files[i].encoded);
+        }
+    }
+    mem_free(store->files);
+    mem_free(store);
+}
+
+const MapFile* map_store_get(const MapStore* store, MapFileType type, i32 file_x, i32 file_z) {
+    if (!store || (u32)type >= MAP_FILE_TYPE_COUNT) return NULL;
+    if (file_x < 0 || file_x > 255 || file_z < 0 || file_z > 255) return NULL;
+
+    u16 slot = store->index[type][((u32)file_x << 8) | (u32)file_z];
+    return slot == MAP_STORE_NONE ? NULL : &store->files[slot];
+}
+
+const u8* map_file_chunk(const MapFile* file, u32 index, u32* size) {
+    /* Every chunk but the last is full, so positions are a fixed stride */
+    u32 start = index * MAP_CHUNK_STRIDE;
+    u32 end = start + MAP_CHUNK_STRIDE;
+    if (end > file->encoded_size) end = file->encoded_size;
+    *size = end - start;
+    return file->encoded + start;
+}
+
+void map_store_prefetch(const MapStore* store, i32 file_x, i32 file_z) {
+    /* Heap chunks (built this boot) are resident already */
+    if (!store || !store->from_snapshot) return;
+    for (u32 type = 0; type < MAP_FILE_TYPE_COUNT; type++) {
+        const MapFile* file = map_store_get(store, (MapFileType)type, file_x, file_z);
+        if (file) mapped_file_prefetch(file->encoded, file->encoded_size);
+    }
+}
+
+u32 map_file_unpack(const MapFile* file, u8** buffer, u32* capacity) {
+    if (!file || file->size < 4) return 0;
+
+    u32 unpacked = ((u32)file->data[0] << 24) | ((u32)file->data[1] << 16) |
+                   ((u32)file->data[2] << 8) | file->data[3];
+    if (unpacked == 0 || unpacked > MAP_FILE_MAX_UNPACKED) return 0;
+
+    if (*capacity < unpacked) {
+        u8* grown = (u8*)realloc(*buffer, unpacked);
+        if (!grown) return 0;
+        *buffer = grown;
+        *capacity = unpacked;
+    }
+
+    int written = bzip_decompress_into(*buffer, (int)unpacked, file->data + 4, (int)file->size - 4);
+    return written == (int)unpacked ? unpacked : 0;
+}
+
+void map_loc_reader_init(MapLocReader* reader, const u8* data, u32 size) {
+    memset(reader, 0, sizeof(MapLocReader));
+    reader->data = data;
+    reader->size = size;
+    reader->id = -1;
+}
+
+/*
+ * loc_smart - Read a smart; false if the file ends inside it
+ */
+static bool loc_smart(MapLocReader* reader, u32* value) {
+    if (reader->offset >= reader->size) return false;
+    u32 first = reader->data[reader->offset];
+    if (first < 128) {
+        reader->offset++;
+        *value = first;
+        return true;
+    }
+    if (reader->offset + 2 > reader->size) return false;
+    *value = ((first << 8) | reader->data[reader->offset + 1]) - 32768;
+    reader->offset += 2;
+    return true;
+}
+
+i32 map_loc_next(MapLocReader* reader, MapLoc* loc) {
+    for (;;) {
+        u32 delta;
+        if (!reader->in_group) {
+            if (!loc_smart(reader, &delta)) return -1;
+            if (delta == 0) return 0;
+            reader->id += (i32)delta;
+            reader->pos = 0;
+            reader->in_group = true;
+        }
+
+        if (!loc_smart(reader, &delta)) return -1;
+        if (delta == 0) {
+            reader->in_group = false;
+            continue;
+        }
+        reader->pos += delta - 1;
+        if (reader->offset >= reader->size) return -1;
+        u32 info = reader->data[reader->offset++];
+
+        loc->id = reader->id;
+        loc->level = (reader->pos >> 12) & 0x3;
+        loc->x = (reader->pos >> 6) & 0x3f;
+        loc->z = reader->pos & 0x3f;
+        loc->shape = info >> 2;
+        loc->rotation = info & 0x3;
+        return 1;
+    }
+}
@@ -0,0 +1,302 @@
+/*******************************************************************************
+ * MAP_STORE.H - In-Memory Map File Store with Precomputed CRCs
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Moving I/O off the latency-critical path (load once at startup)
+ *   - Precomputing derived data (CRC32) instead of recomputing per request
+ *   - Direct-indexed lookup tables over a small, dense key space
+ *
+ * THE PROBLEM:
+ *
+ * Every region change used to open, read and CRC up to 18 files from
+ * data/maps/ (nine land + nine loc), and every MAP_REQUEST re-read the
+ * requested file from disk - all on the tick thread:
+ *
+ *   player crosses region boundary
+ *       └─→ map_send_load_area()
+ *             ├─ fopen/fread/CRC m50_50   ─┐
+ *             ├─ fopen/fread/CRC l50_50    │  up to 18 disk reads
+ *             └─ ...                      ─┘  → every player's tick waits
+ *
+ * THE SOLUTION - LOAD ONCE, LOOK UP FOREVER:
+ *
+ * The whole data/maps/ directory is ~3MB. At startup every m<x>_<z> and
+ * l<x>_<z> file is mapped into memory and its CRC32 computed once. File
+ * coordinates are single bytes on the wire, so the key space is only
+ * 256 x 256 per type and a direct index table gives O(1) lookups:
+ *
+ *   index[type][(x << 8) | z] ─→ files[k] = { data, size, crc }
+ *                                  (or MAP_STORE_NONE if no such file)
+ *
+ *   map_send_load_area():  9 lookups, 0 syscalls
+ *   map_send_land_data():  1 lookup,  0 syscalls
+ *
+ * PRE-ENCODED CHUNKS:
+ *
+ * Map files reach the client as SERVER_DATA_LAND / SERVER_DATA_LOC
+ * packets of at most 1000 data bytes. Everything in those packets except
+ * the ISAAC-encrypted opcode is identical for every player, so each file
+ * also keeps its chunk packets serialized once, minus the opcode:
+ *
+ *   encoded: [len:2][x][z][offset:2][total:2][data ≤1000] [len:2][x]...
+ *            └──────────────── chunk 0 ─────────────────┘ └─ chunk 1 ─
+ *
+ *   Per player and chunk:  1 encrypted opcode byte + 1 memcpy
+ *   (previously:           ~1006 buffer_write_byte() calls)
+ *
+ * SNAPSHOT:
+ *
+ * Scanning, mapping, CRCing and chunking ~1450 files is repeated work on
+ * every boot. map_store_snapshot() writes the files, their CRCs and their
+ * encoded chunks into the world snapshot (snapshot.h) as one records
+ * table plus one byte area; map_store_create_from_snapshot() then only
+ * fills in the index and points every MapFile into the mapping.
+ *
+ * COMPRESSION:
+ *
+ * The stored bytes already are the compressed form: each file is a 4-byte
+ * length and a bzip2 body, which the client unpacks when it builds the
+ * scene. There is nothing left to squeeze out for the wire:
+ *
+ *   200 files as stored        412,211 bytes
+ *   each gzip -9'd again       418,048 bytes  (+1.4%)
+ *
+ * So the store keeps no second, transport-compressed copy, and the
+ * server offers no compressed stream: it would not shrink map traffic,
+ * and the 225 client has no way to ask for one. Map bandwidth is
+ * managed by pacing instead (map.h, MAP TRANSFER PACING).
+ *
+ * The store is immutable after creation, so it can be read from any
+ * thread without locking.
+ *
+ * MEMORY:
+ *   2 x 65536 x 2 bytes index  = 256KB
+ *   file bytes                 ≈ on-disk size of the map files (~1.2MB),
+ *                                mapped read-only (see mapped_file.h) so
+ *                                they live in the shared page cache
+ *   pre-encoded chunks         ≈ same again (+8 bytes per 1000)
+ *
+ ******************************************************************************/
+
+#ifndef MAP_STORE_H
+#define MAP_STORE_H
+
+#include "types.h"
+#include "mapped_file.h"
+#include "snapshot.h"
+#include <stdbool.h>
+
+/* Index sentinel for "no file at these coordinates" */
+#define MAP_STORE_NONE 0xFFFF
+
+/* Data bytes per SERVER_DATA_LAND / SERVER_DATA_LOC packet */
+#define MAP_CHUNK_DATA 1000
+
+/* Bytes before the data: x(1) z(1) offset(2) total(2) */
+#define MAP_CHUNK_HEADER 6
+
+/* Stride of one pre-encoded chunk: var-short length(2) + header + data */
+#define MAP_CHUNK_STRIDE (2 + MAP_CHUNK_HEADER + MAP_CHUNK_DATA)
+
+/*
+ * MapFileType - Which of the two per-region files
+ */
+typedef enum {
+    MAP_FILE_LAND = 0,      /* m<x>_<z>: terrain */
+    MAP_FILE_LOC  = 1,      /* l<x>_<z>: locations (objects) */
+    MAP_FILE_TYPE_COUNT
+} MapFileType;
+
+/*
+ * MapFile - One map file held in memory
+ */
+typedef struct {
+    MappedFile view;        /* Read-only mapping of the file */
+    const u8* data;         /* File contents (= view.data) */
+    u32 size;               /* Bytes in data */
+    u32 crc;                /* CRC32 as sent in LOAD_AREA */
+    const u8* encoded;      /* Chunk packets without opcode (see above) */
+    u32 encoded_size;       /* Bytes in encoded */
+    u32 chunk_count;        /* Packets in encoded */
+} MapFile;
+
+/*
+ * MapFileRecord - One map file in the snapshot
+ *
+ * Offsets are into the SNAPSHOT_MAP_BYTES section.
+ */
+typedef struct {
+    u8 type;                /* MapFileType */
+    u8 file_x;
+    u8 file_z;
+    u8 pad;
+    u32 crc;
+    u32 data_offset;
+    u32 size;
+    u32 encoded_offset;
+    u32 encoded_size;
+} MapFileRecord;
+
+/*
+ * MapStore - Every map file, keyed by (type, file_x, file_z)
+ */
+typedef struct {
+    u16 index[MAP_FILE_TYPE_COUNT][256 * 256];  /* Key → files[] slot */
+    MapFile* files;                             /* Loaded files */
+    u32 count;
+    u32 capacity;
+    u64 total_bytes;
+    bool from_snapshot;     /* Bytes live in the snapshot, not owned */
+} MapStore;
+
+/*
+ * map_store_create - Load every map file in a directory
+ *
+ * @param dir  Directory holding m<x>_<z> / l<x>_<z> files (e.g. "data/maps")
+ * @return     Store (possibly empty if dir is missing), or NULL on
+ *             allocation failure
+ *
+ * Files whose names do not match, or whose coordinates are outside
+ * 0-255, are ignored.
+ *
+ * COMPLEXITY: O(total file bytes) time (map + CRC once)
+ */
+MapStore* map_store_create(const char* dir);
+
+/*
+ * map_store_create_from_snapshot - Point a store at a snapshot's map files
+ *
+ * @param snapshot  Validated snapshot (must outlive the store)
+ * @return          Store, or NULL if the snapshot's map sections are
+ *                  missing or inconsistent (build with map_store_create)
+ *
+ * COMPLEXITY: O(file count) time, no file I/O
+ */
+MapStore* map_store_create_from_snapshot(const Snapshot* snapshot);
+
+/*
+ * map_store_snapshot - Add every file to a snapshot writer
+ *
+ * @return  false on allocation failure
+ */
+bool map_store_snapshot(const MapStore* store, SnapshotWriter* writer);
+
+/*
+ * map_store_destroy - Free all file data and the store
+ *
+ * @param store  Store to free (NULL-safe)
+ */
+void map_store_destroy(MapStore* store);
+
+/*
+ * map_store_get - Look up a map file
+ *
+ * @param store   Store (NULL-safe)
+ * @param type    MAP_FILE_LAND or MAP_FILE_LOC
+ * @param file_x  File X coordinate (abs_x >> 6)
+ * @param file_z  File Z coordinate (abs_z >> 6)
+ * @return        File, or NULL if there is no such file
+ *
+ * COMPLEXITY: O(1) time
+ */
+const MapFile* map_store_get(const MapStore* store, MapFileType type, i32 file_x, i32 file_z);
+
+/*
+ * map_file_chunk - Locate one pre-encoded chunk packet
+ *
+ * @param file   File from map_store_get()
+ * @param index  Chunk number [0, chunk_count)
+ * @param size   Receives the chunk's byte count (length field included)
+ * @return       Pointer to [len:2][x][z][offset:2][total:2][data]
+ *
+ * The caller writes the encrypted opcode, then copies these bytes as is.
+ */
+const u8* map_file_chunk(const MapFile* file, u32 index, u32* size);
+
+/*
+ * map_store_prefetch - Start reading a region's chunks from disk
+ *
+ * @param store   Store (NULL-safe)
+ * @param file_x  File X coordinate
+ * @param file_z  File Z coordinate
+ *
+ * With a snapshot the chunks are mapped and fault in on first use, on
+ * the tick of the MAP_REQUEST. This hints both files of the region to
+ * the kernel (mapped_file_prefetch) so they are in memory by then.
+ * No-op for stores built this boot (their chunks are on the heap).
+ *
+ * COMPLEXITY: O(1), one madvise per file, never blocks
+ */
+void map_store_prefetch(const MapStore* store, i32 file_x, i32 file_z);
+
+/*******************************************************************************
+ * LOC FILE DECODING
+ *******************************************************************************
+ *
+ * Shared by the collision builder (world_collision.h) and the static loc
+ * table (static_locs.h). After the 4-byte length + headerless bzip2
+ * wrapper a loc file is:
+ *
+ *   smart(delta id) { smart(delta pos + 1) info ... 0 } ... 0
+ *     pos  = level << 12 | x << 6 | z      (x, z local to the region)
+ *     info = shape << 2 | rotation
+ *
+ *   smart: one byte 0-127, or two bytes (big-endian) minus 32768
+ *
+ ******************************************************************************/
+
+/* Decompressed map files are far smaller; anything larger is corrupt */
+#define MAP_FILE_MAX_UNPACKED (1024 * 1024)
+
+/*
+ * MapLoc - One loc as stored in its file (level before bridge shifts)
+ */
+typedef struct {
+    i32 id;
+    u32 level;
+    u32 x;                  /* 0-63 within the region */
+    u32 z;
+    u32 shape;
+    u32 rotation;
+} MapLoc;
+
+/*
+ * MapLocReader - Cursor over an unpacked loc file
+ */
+typedef struct {
+    const u8* data;
+    u32 size;
+    u32 offset;
+    i32 id;                 /* Current id group */
+    u32 pos;                /* Last position in the group */
+    bool in_group;
+} MapLocReader;
+
+/*
+ * map_file_unpack - Decompress a map file into buffer (grown as needed)
+ *
+ * @return  Unpacked size, or 0 if the file is missing or corrupt
+ */
+u32 map_file_unpack(const MapFile* file, u8** buffer, u32* capacity);
+
+/*
+ * map_loc_reader_init - Start reading an unpacked loc file
+ */
+void map_loc_reader_init(MapLocReader* reader, const u8* data, u32 size);
+
+/*
+ * map_loc_next - Read the next loc
+ *
+ * @return  1 with *loc filled, 0 at the end of the file, -1 if the file
+ *          is truncated (locs read before it are valid)
+ */
+i32 map_loc_next(MapLocReader* reader, MapLoc* loc);
+
+/*
+ * g_map_store - Global map store, created in server_init()
+ */
+extern MapStore* g_map_store;
+
+#endif /* MAP_STORE_H */
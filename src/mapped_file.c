@@ -0,0 +1,155 @@
+/*******************************************************************************
+ * MAPPED_FILE.C - Read-Only Memory-Mapped File Views Implementation
+ *******************************************************************************
+ *
+ * The file descriptor / file handle is closed as soon as the mapping
+ * exists: the mapping keeps its own reference to the file, so a view
+ * costs no open descriptor for the life of the server.
+ *
+ ******************************************************************************/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include "mapped_file.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*
+ * read_into_heap - Fallback when the file cannot be mapped
+ */
+static bool read_into_heap(MappedFile* file, const char* path) {
+    FILE* fp = fopen(path, "rb");
+    if (!fp) return false;
+
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    if (size <= 0) {
+        fclose(fp);
+        return false;
+    }
+
+    u8* data = malloc((size_t)size);
+    if (!data) {
+        fclose(fp);
+        return false;
+    }
+
+    size_t read_size = fread(data, 1, (size_t)size, fp);
+    fclose(fp);
+
+    if (read_size != (size_t)size) {
+        free(data);
+        return false;
+    }
+
+    file->data = data;
+    file->size = (u32)size;
+    file->mapped = false;
+    return true;
+}
+
+#ifdef _WIN32
+
+bool mapped_file_open(MappedFile* file, const char* path) {
+    if (!file || !path) return false;
+    memset(file, 0, sizeof(*file));
+
+    HANDLE handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+                                OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (handle == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(handle, &size) || size.QuadPart <= 0 || size.QuadPart > 0xFFFFFFFFLL) {
+        CloseHandle(handle);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(handle);
+    if (!mapping) return read_into_heap(file, path);
+
+    const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        CloseHandle(mapping);
+        return read_into_heap(file, path);
+    }
+
+    file->data = view;
+    file->size = (u32)size.QuadPart;
+    file->mapped = true;
+    file->mapping = mapping;
+    return true;
+}
+
+void mapped_file_close(MappedFile* file) {
+    if (!file || !file->data) return;
+    if (file->mapped) {
+        UnmapViewOfFile(file->data);
+        CloseHandle(file->mapping);
+    } else {
+        free((void*)file->data);
+    }
+    memset(file, 0, sizeof(*file));
+}
+
+void mapped_file_prefetch(const u8* data, u32 size) {
+    (void)data; (void)size;     /* PrefetchVirtualMemory needs Windows 8 */
+}
+
+#else
+
+bool mapped_file_open(MappedFile* file, const char* path) {
+    if (!file || !path) return false;
+    memset(file, 0, sizeof(*file));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) ||
+        st.st_size <= 0 || (unsigned long long)st.st_size > 0xFFFFFFFFULL) {
+        close(fd);
+        return false;
+    }
+
+    void* view = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (view == MAP_FAILED) return read_into_heap(file, path);
+
+    file->data = view;
+    file->size = (u32)st.st_size;
+    file->mapped = true;
+    return true;
+}
+
+void mapped_file_close(MappedFile* file) {
+    if (!file || !file->data) return;
+    if (file->mapped) {
+        munmap((void*)file->data, file->size);
+    } else {
+        free((void*)file->data);
+    }
+    memset(file, 0, sizeof(*file));
+}
+
+void mapped_file_prefetch(const u8* data, u32 size) {
+    if (!data || size == 0) return;
+    uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+    uintptr_t start = (uintptr_t)data & ~(page - 1);
+    uintptr_t end = (uintptr_t)data + size;
+    posix_madvise((void*)start, end - start, POSIX_MADV_WILLNEED);
+}
+
+#endif
@@ -0,0 +1,97 @@
+/*******************************************************************************
+ * MAPPED_FILE.H - Read-Only Memory-Mapped File Views
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Memory-mapped I/O (mmap / MapViewOfFile)
+ *   - The OS page cache as a cross-process shared resource
+ *   - Private vs shared memory accounting
+ *
+ * THE PROBLEM:
+ *
+ * fopen() + fread() into a malloc'd buffer copies every byte twice: once
+ * from disk into the kernel's page cache, then again into the process's
+ * private heap. With several worlds on one host, each process holds its
+ * own private copy of the very same asset files:
+ *
+ *   world 1 heap: [config][models][maps...]  ─┐
+ *   world 2 heap: [config][models][maps...]   ├─ N private copies
+ *   world 3 heap: [config][models][maps...]  ─┘
+ *   page cache:   [config][models][maps...]  ← plus the kernel's copy
+ *
+ * THE SOLUTION - MAP THE PAGE CACHE DIRECTLY:
+ *
+ * A read-only mapping makes the page cache pages themselves appear in the
+ * process's address space. Nothing is copied at open time; pages are
+ * faulted in on first touch, and every process mapping the same file
+ * shares the same physical pages:
+ *
+ *   world 1 ─┐
+ *   world 2 ─┼─→ page cache: [config][models][maps...]  (one copy)
+ *   world 3 ─┘
+ *
+ *   POSIX:   open() → fstat() → mmap(PROT_READ, MAP_SHARED) → close()
+ *   Windows: CreateFileA() → CreateFileMappingA(PAGE_READONLY)
+ *            → MapViewOfFile(FILE_MAP_READ)
+ *
+ * The view is read-only: writing through it faults. Code that needs to
+ * modify the bytes must copy them first.
+ *
+ * FALLBACK:
+ *   If the platform cannot map the file (e.g. a filesystem without mmap
+ *   support), the file is read into a heap buffer instead. Callers see
+ *   the same { data, size } either way.
+ *
+ ******************************************************************************/
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include "types.h"
+#include <stdbool.h>
+
+/*
+ * MappedFile - One read-only view of a whole file
+ */
+typedef struct {
+    const u8* data;         /* First byte of the file (read-only) */
+    u32 size;               /* Bytes in data */
+    bool mapped;            /* true: OS mapping, false: heap fallback */
+#ifdef _WIN32
+    void* mapping;          /* HANDLE from CreateFileMappingA */
+#endif
+} MappedFile;
+
+/*
+ * mapped_file_open - Map a whole file read-only
+ *
+ * @param file  Receives the view
+ * @param path  File to map
+ * @return      true on success; false if the file is missing, empty or
+ *              cannot be read (file is zeroed)
+ *
+ * COMPLEXITY: O(1) when mapped (pages load lazily), O(size) on fallback
+ */
+bool mapped_file_open(MappedFile* file, const char* path);
+
+/*
+ * mapped_file_close - Release a view from mapped_file_open()
+ *
+ * @param file  View to release (NULL-safe, safe on a zeroed view)
+ */
+void mapped_file_close(MappedFile* file);
+
+/*
+ * mapped_file_prefetch - Ask the OS to start reading part of a view now
+ *
+ * @param data  First byte wanted (anywhere inside a view)
+ * @param size  Bytes wanted
+ *
+ * Returns at once; the kernel reads the pages in the background, so a
+ * later first touch finds them in memory instead of waiting on the disk.
+ * A hint only: harmless on heap memory, a no-op on Windows.
+ */
+void mapped_file_prefetch(const u8* data, u32 size);
+
+#endif /* MAPPED_FILE_H */
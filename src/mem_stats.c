@@ -0,0 +1,114 @@
+/*******************************************************************************
+ * MEM_STATS.C - Tagged Allocation Implementation
+ *******************************************************************************
+ *
+ * See mem_stats.h for the design.
+ *
+ ******************************************************************************/
+
+#include "mem_stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+MemStats g_mem_stats;
+
+static const char* const TAG_NAMES[MEM_TAG_COUNT] = {
+    "cache", "map", "player", "tracking", "npc", "object", "buffer",
+};
+
+/*
+ * MemHeader - In front of every block (16 bytes keeps malloc's alignment)
+ */
+typedef struct {
+    u64 size;
+    u32 tag;
+    u32 reserved;
+} MemHeader;
+
+static void charge(MemTag tag, u64 size) {
+    u64 live = __atomic_add_fetch(&g_mem_stats.live[tag], size, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&g_mem_stats.allocs[tag], 1, __ATOMIC_RELAXED);
+    u64 peak = __atomic_load_n(&g_mem_stats.peak[tag], __ATOMIC_RELAXED);
+    while (live > peak &&
+           !__atomic_compare_exchange_n(&g_mem_stats.peak[tag], &peak, live, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+static void release(MemTag tag, u64 size) {
+    __atomic_sub_fetch(&g_mem_stats.live[tag], size, __ATOMIC_RELAXED);
+    __atomic_sub_fetch(&g_mem_stats.allocs[tag], 1, __ATOMIC_RELAXED);
+}
+
+void* mem_alloc(MemTag tag, size_t size) {
+    MemHeader* header = (MemHeader*)malloc(sizeof(MemHeader) + size);
+    if (!header) return NULL;
+    header->size = size;
+    header->tag = (u32)tag;
+    charge(tag, size);
+    return header + 1;
+}
+
+void* mem_calloc(MemTag tag, size_t count, size_t size) {
+    if (size != 0 && count > ((size_t)-1 - sizeof(MemHeader)) / size) return NULL;
+    MemHeader* header = (MemHeader*)calloc(1, sizeof(MemHeader) + count * size);
+    if (!header) return NULL;
+    header->size = count * size;
+    header->tag = (u32)tag;
+    charge(tag, header->size);
+    return header + 1;
+}
+
+void* mem_realloc(MemTag tag, void* ptr, size_t size) {
+    if (!ptr) return mem_alloc(tag, size);
+    MemHeader* old = (MemHeader*)ptr - 1;
+    MemTag old_tag = (MemTag)old->tag;
+    u64 old_size = old->size;
+
+    MemHeader* header = (MemHeader*)realloc(old, sizeof(MemHeader) + size);
+    if (!header) return NULL;
+    release(old_tag, old_size);
+    header->size = size;
+    header->tag = (u32)tag;
+    charge(tag, size);
+    return header + 1;
+}
+
+void mem_free(void* ptr) {
+    if (!ptr) return;
+    MemHeader* header = (MemHeader*)ptr - 1;
+    release((MemTag)header->tag, header->size);
+    free(header);
+}
+
+const char* mem_tag_name(MemTag tag) {
+    return tag < MEM_TAG_COUNT ? TAG_NAMES[tag] : "?";
+}
+
+u64 mem_stats_live(MemTag tag) {
+    return __atomic_load_n(&g_mem_stats.live[tag], __ATOMIC_RELAXED);
+}
+
+u64 mem_stats_peak(MemTag tag) {
+    return __atomic_load_n(&g_mem_stats.peak[tag], __ATOMIC_RELAXED);
+}
+
+u64 mem_stats_rss(void) {
+#ifdef _WIN32
+    return 0;
+#else
+    /* statm: size resident shared ... (in pages) */
+    FILE* f = fopen("/proc/self/statm", "r");
+    if (!f) return 0;
+    unsigned long long size = 0, resident = 0;
+    int n = fscanf(f, "%llu %llu", &size, &resident);
+    fclose(f);
+    if (n != 2) return 0;
+    return (u64)resident * (u64)sysconf(_SC_PAGESIZE);
+#endif
+}
@@ -0,0 +1,128 @@
+/*******************************************************************************
+ * MEM_STATS.H - Heap Allocations Tagged by Subsystem
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Allocation accounting with a size header in front of each block
+ *   - Live and peak (high-water) counters, updated lock-free
+ *   - Attributing a process's memory to the code that asked for it
+ *
+ * THE PROBLEM:
+ *
+ * The server's RSS says 180 MB. Is that the cache archives, the map store,
+ * 2000 players' containers, the per-viewer tracking tables, or a leak
+ * that grows by a few KB per login? ps cannot say, and a heap profiler
+ * is not something to attach to a live world. Sizing --max-players or
+ * --max-npcs without knowing what each costs is guesswork.
+ *
+ * THE SOLUTION - TAG THE ALLOCATION, COUNT THE TAG:
+ *
+ * Subsystems that own most of the heap allocate through mem_alloc() and
+ * friends with a tag instead of malloc():
+ *
+ *   container->items = mem_calloc(MEM_PLAYER, capacity, sizeof(Item));
+ *   ...
+ *   mem_free(container->items);         tag and size come from the header
+ *
+ * Each block carries a 16-byte header with its size and tag, so freeing
+ * needs neither, and the counters stay exact through realloc():
+ *
+ *   ┌──────────────┬──────────────────────────────┐
+ *   │ size │ tag   │ caller's bytes ...           │
+ *   └──────────────┴──────────────────────────────┘
+ *   ^ malloc()      ^ returned pointer (16-aligned like malloc's)
+ *
+ *   live[tag]  += size on alloc, -= size on free     (relaxed atomic add)
+ *   peak[tag]   = max(peak[tag], live[tag])          (CAS loop, rarely loops)
+ *
+ * A block from mem_alloc() must go back through mem_free(), never free()
+ * (and the reverse): the pointer free() needs is 16 bytes earlier.
+ *
+ * TAGS:
+ *   cache     cache archives, their unpacked data and memoised files
+ *   map       map store: region files and the table of them
+ *   player    item containers (inventory, equipment, bank)
+ *   tracking  per-viewer player, NPC and ground item tracking
+ *   npc       NPC system: NPC records and update lists
+ *   object    world objects and ground items, with their hash tables
+ *   buffer    stream buffers and connections (in/out buffers)
+ *
+ * Slab pools count a whole slab when it is allocated (slab_pool.h), which
+ * is the address space they hold, not the objects in use.
+ *
+ * REPORTS:
+ *   ::mem                      live and peak per tag, and process RSS
+ *   rs225_heap_bytes{subsystem="..."}, rs225_heap_peak_bytes{...}  (metrics.h)
+ *
+ * The client's bump arenas report their own use and peak in the debug
+ * overlay (allocator.h: bump_allocator_used(), arena_peak()).
+ *
+ ******************************************************************************/
+
+#ifndef MEM_STATS_H
+#define MEM_STATS_H
+
+#include "types.h"
+#include <stddef.h>
+
+/*
+ * MemTag - Subsystem an allocation is charged to
+ */
+typedef enum {
+    MEM_CACHE = 0,
+    MEM_MAP,
+    MEM_PLAYER,
+    MEM_TRACKING,
+    MEM_NPC,
+    MEM_OBJECT,
+    MEM_BUFFER,
+    MEM_TAG_COUNT
+} MemTag;
+
+/*
+ * MemStats - Byte counters per tag (atomic: any thread allocates)
+ */
+typedef struct {
+    u64 live[MEM_TAG_COUNT];        /* Bytes allocated and not freed */
+    u64 peak[MEM_TAG_COUNT];        /* Most live bytes ever */
+    u64 allocs[MEM_TAG_COUNT];      /* Blocks allocated and not freed */
+} MemStats;
+
+extern MemStats g_mem_stats;
+
+/*
+ * mem_alloc / mem_calloc - malloc() / calloc() charged to a tag
+ */
+void* mem_alloc(MemTag tag, size_t size);
+void* mem_calloc(MemTag tag, size_t count, size_t size);
+
+/*
+ * mem_realloc - realloc() a mem_alloc() block (NULL: a new one for tag)
+ *
+ * On failure the old block is untouched and NULL is returned, as realloc().
+ */
+void* mem_realloc(MemTag tag, void* ptr, size_t size);
+
+/*
+ * mem_free - Free a mem_alloc() block (NULL-safe)
+ */
+void mem_free(void* ptr);
+
+/*
+ * mem_tag_name - "cache", "map", ... (metrics labels and ::mem)
+ */
+const char* mem_tag_name(MemTag tag);
+
+/*
+ * mem_stats_live / mem_stats_peak - Current and peak bytes for a tag
+ */
+u64 mem_stats_live(MemTag tag);
+u64 mem_stats_peak(MemTag tag);
+
+/*
+ * mem_stats_rss - Resident set size in bytes (0 where unknown)
+ */
+u64 mem_stats_rss(void);
+
+#endif /* MEM_STATS_H */
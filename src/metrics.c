@@ -0,0 +1,407 @@
+/*******************************************************************************
+ * METRICS.C - Server Counters and a Prometheus Text Endpoint
+ *******************************************************************************
+ *
+ * See metrics.h for what is counted and who writes it.
+ *
+ * SCRAPE CONNECTION:
+ *
+ *   accept ──► read until "\r\n\r\n" ──► render into out ──► send ──► close
+ *                                                │
+ *                                    partial send: watch for writability
+ *
+ *   Only the request line is looked at: GET /metrics (or /) gets the
+ *   counters, anything else a 404. The response is rendered from atomic
+ *   loads of g_metrics in one go, so every value in it was read within
+ *   microseconds of the others.
+ *
+ ******************************************************************************/
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "metrics.h"
+#include "tick_stats.h"
+#include "mem_stats.h"
+#include "traffic.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+Metrics g_metrics;
+u16 g_metrics_port = 0;
+
+/* Histogram bucket upper bounds in ms (metrics.h: METRICS_TICK_BUCKETS) */
+static const u32 TICK_BUCKET_MS[METRICS_TICK_BUCKETS] = {
+    1, 2, 5, 10, 25, 50, 100, 300, 600, 1200,
+};
+
+/*
+ * MetricsClient - One scrape connection
+ */
+typedef struct {
+    i32 fd;                         /* -1 = slot free */
+    u64 opened;                     /* tick_stats_now() at accept */
+    char request[512];              /* Request head read so far */
+    u32 request_len;
+    char* out;                      /* Rendered response */
+    u32 out_len;
+    u32 out_cap;
+    u32 out_sent;
+} MetricsClient;
+
+static struct {
+    NetworkServer* network;
+    i32 listen_fd;
+    MetricsClient clients[METRICS_MAX_CLIENTS];
+} g_endpoint = { NULL, -1, { { 0 } } };
+
+/*******************************************************************************
+ * RECORDING
+ ******************************************************************************/
+
+void metrics_observe_tick(u64 work_ns) {
+    u64 us = work_ns / 1000;
+    u32 bucket = 0;
+    while (bucket < METRICS_TICK_BUCKETS && us > (u64)TICK_BUCKET_MS[bucket] * 1000) bucket++;
+    metrics_add(&g_metrics.tick_buckets[bucket], 1);
+    metrics_add(&g_metrics.tick_sum_us, us);
+    metrics_add(&g_metrics.ticks, 1);
+}
+
+void metrics_publish_tick(u32 players, u32 login_depth, u32 save_depth) {
+    metrics_set(&g_metrics.players_online, players);
+    metrics_set(&g_metrics.login_queue_depth, login_depth);
+    metrics_set(&g_metrics.save_queue_depth, save_depth);
+}
+
+void metrics_publish_output(u64 queued, u32 deepest, u32 congested) {
+    metrics_set(&g_metrics.out_queued_bytes, queued);
+    metrics_set(&g_metrics.out_queue_max_bytes, deepest);
+    metrics_set(&g_metrics.out_congested, congested);
+}
+
+/*******************************************************************************
+ * RENDERING
+ ******************************************************************************/
+
+static u64 load(const u64* value) {
+    return __atomic_load_n(value, __ATOMIC_RELAXED);
+}
+
+/*
+ * out_printf - Append formatted text to a client's response, growing it
+ */
+static void out_printf(MetricsClient* client, const char* fmt, ...) {
+    for (;;) {
+        va_list args;
+        va_start(args, fmt);
+        u32 room = client->out_cap - client->out_len;
+        i32 n = vsnprintf(client->out ? client->out + client->out_len : NULL, room, fmt, args);
+        va_end(args);
+        if (n < 0) return;
+        if ((u32)n < room) {
+            client->out_len += (u32)n;
+            return;
+        }
+        u32 cap = client->out_cap ? client->out_cap * 2 : 16384;
+        while (cap - client->out_len <= (u32)n) cap *= 2;
+        char* grown = (char*)realloc(client->out, cap);
+        if (!grown) return;
+        client->out = grown;
+        client->out_cap = cap;
+    }
+}
+
+static void out_header(MetricsClient* client, const char* name, const char* type, const char* help) {
+    out_printf(client, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+static void out_value(MetricsClient* client, const char* name, const char* type,
+                      const char* help, u64 value) {
+    out_header(client, name, type, help);
+    out_printf(client, "%s %llu\n", name, (unsigned long long)value);
+}
+
+/*
+ * out_by_opcode - One labelled series per opcode with a non-zero count
+ */
+static void out_by_opcode(MetricsClient* client, const char* name, const char* help,
+                          const u64* values) {
+    out_header(client, name, "counter", help);
+    for (u32 op = 0; op < 256; op++) {
+        u64 value = load(&values[op]);
+        if (value == 0) continue;
+        out_printf(client, "%s{opcode=\"%u\"} %llu\n", name, op, (unsigned long long)value);
+    }
+}
+
+static void render_metrics(MetricsClient* client) {
+    const Metrics* m = &g_metrics;
+
+    out_value(client, "rs225_players_online", "gauge",
+              "Players logged in at the end of the last tick.", load(&m->players_online));
+    out_value(client, "rs225_login_queue_depth", "gauge",
+              "Logins waiting on the login workers.", load(&m->login_queue_depth));
+    out_value(client, "rs225_save_queue_depth", "gauge",
+              "Player saves queued or being written.", load(&m->save_queue_depth));
+    out_value(client, "rs225_send_queue_bytes", "gauge",
+              "Output queued for game connections but not yet sent.", load(&m->out_queued_bytes));
+    out_value(client, "rs225_send_queue_max_bytes", "gauge",
+              "Unsent output of the most backed-up game connection.",
+              load(&m->out_queue_max_bytes));
+    out_value(client, "rs225_send_queue_congested", "gauge",
+              "Game connections over the send queue high watermark.", load(&m->out_congested));
+
+    out_value(client, "rs225_received_bytes_total", "counter",
+              "Bytes read from game sockets.", load(&m->bytes_received));
+    out_value(client, "rs225_sent_bytes_total", "counter",
+              "Bytes written to game sockets.", load(&m->bytes_sent));
+    out_value(client, "rs225_map_bytes_sent_total", "counter",
+              "Map file bytes streamed to clients.", load(&m->map_bytes));
+    out_value(client, "rs225_load_areas_skipped_total", "counter",
+              "LOAD_AREA packets not sent because the client's scene already matched.",
+              load(&m->load_areas_skipped));
+    out_value(client, "rs225_map_prefetches_total", "counter",
+              "Map regions prefetched ahead of a player leaving their area.",
+              load(&m->map_prefetches));
+    out_value(client, "rs225_map_transfers_deferred_total", "counter",
+              "Ticks a connection still had map files queued after its transfer budget.",
+              load(&m->map_transfers_deferred));
+    out_value(client, "rs225_packets_deferred_total", "counter",
+              "Times a connection's packets were held for a later tick by the rate limit.",
+              load(&m->packets_deferred));
+    out_value(client, "rs225_slow_consumers_total", "counter",
+              "Connections dropped for staying over the send queue high watermark.",
+              load(&m->slow_consumers));
+    out_value(client, "rs225_connections_reaped_total", "counter",
+              "Connections dropped for not logging in in time or sending nothing while logged in.",
+              load(&m->connections_reaped));
+
+    /* Tagged heap (mem_stats.h): live and peak bytes per subsystem */
+    out_header(client, "rs225_heap_bytes", "gauge",
+               "Heap bytes allocated and not yet freed, by subsystem.");
+    for (u32 t = 0; t < MEM_TAG_COUNT; t++) {
+        out_printf(client, "rs225_heap_bytes{subsystem=\"%s\"} %llu\n", mem_tag_name((MemTag)t),
+                   (unsigned long long)mem_stats_live((MemTag)t));
+    }
+    out_header(client, "rs225_heap_peak_bytes", "gauge",
+               "Most heap bytes a subsystem has held at once since startup.");
+    for (u32 t = 0; t < MEM_TAG_COUNT; t++) {
+        out_printf(client, "rs225_heap_peak_bytes{subsystem=\"%s\"} %llu\n",
+                   mem_tag_name((MemTag)t), (unsigned long long)mem_stats_peak((MemTag)t));
+    }
+    out_value(client, "rs225_resident_bytes", "gauge",
+              "Resident set size of the server process.", mem_stats_rss());
+
+    out_by_opcode(client, "rs225_packets_received_total",
+                  "Client packets handled, by opcode.", m->packets_in);
+    out_by_opcode(client, "rs225_packet_bytes_received_total",
+                  "Payload bytes of handled client packets, by opcode.", m->packet_bytes_in);
+    out_by_opcode(client, "rs225_packets_sent_total",
+                  "Server packets written, by opcode.", m->packets_out);
+
+    /* Top talkers of the last traffic window (traffic.h), one series per rank */
+    out_header(client, "rs225_traffic_window_total", "gauge",
+               "Traffic of every connection over the last traffic window, by counter.");
+    for (u32 c = 0; c < TRAFFIC_COUNTERS; c++) {
+        out_printf(client, "rs225_traffic_window_total{counter=\"%s\"} %llu\n",
+                   traffic_counter_name((TrafficCounter)c),
+                   (unsigned long long)g_traffic.report_total[c]);
+    }
+    out_header(client, "rs225_top_talker", "gauge",
+               "Busiest connections of the last traffic window, by counter.");
+    for (u32 c = 0; c < TRAFFIC_COUNTERS; c++) {
+        for (u32 r = 0; r < g_traffic.top_count[c]; r++) {
+            const TrafficTalker* talker = &g_traffic.top[c][r];
+            out_printf(client, "rs225_top_talker{counter=\"%s\",rank=\"%u\",player=\"%s\"} %llu\n",
+                       traffic_counter_name((TrafficCounter)c), r + 1, talker->name,
+                       (unsigned long long)talker->value);
+        }
+    }
+
+    /* Histogram buckets are cumulative in the exposition format */
+    const char* name = "rs225_tick_duration_seconds";
+    out_header(client, name, "histogram", "Time spent in server_tick().");
+    u64 cumulative = 0;
+    for (u32 b = 0; b < METRICS_TICK_BUCKETS; b++) {
+        cumulative += load(&m->tick_buckets[b]);
+        out_printf(client, "%s_bucket{le=\"%g\"} %llu\n", name, TICK_BUCKET_MS[b] / 1000.0,
+                   (unsigned long long)cumulative);
+    }
+    cumulative += load(&m->tick_buckets[METRICS_TICK_BUCKETS]);
+    out_printf(client, "%s_bucket{le=\"+Inf\"} %llu\n", name, (unsigned long long)cumulative);
+    out_printf(client, "%s_sum %.6f\n", name, load(&m->tick_sum_us) / 1e6);
+    out_printf(client, "%s_count %llu\n", name, (unsigned long long)cumulative);
+}
+
+/*
+ * build_response - Status line, headers and body for one request
+ */
+static void build_response(MetricsClient* client) {
+    bool found = strncmp(client->request, "GET /metrics", 12) == 0 ||
+                 strncmp(client->request, "GET / ", 6) == 0;
+
+    /* Render the body after room for the headers, then write those in front */
+    const u32 head_room = 160;
+    out_printf(client, "%*s", (int)head_room, "");
+    u32 body_start = client->out_len;
+    if (found) {
+        render_metrics(client);
+    } else {
+        out_printf(client, "Not found\n");
+    }
+    if (client->out_len < body_start) return;  /* Out of memory */
+
+    char head[160];
+    i32 head_len = snprintf(head, sizeof(head),
+                            "HTTP/1.0 %s\r\n"
+                            "Content-Type: text/plain; version=0.0.4\r\n"
+                            "Content-Length: %u\r\n"
+                            "Connection: close\r\n\r\n",
+                            found ? "200 OK" : "404 Not Found", client->out_len - body_start);
+    u32 start = body_start - (u32)head_len;
+    memcpy(client->out + start, head, (u32)head_len);
+    client->out_sent = start;
+}
+
+/*******************************************************************************
+ * CONNECTIONS
+ ******************************************************************************/
+
+static void client_close(MetricsClient* client) {
+    if (client->fd < 0) return;
+    network_unwatch(g_endpoint.network, client->fd);
+    network_close_socket(client->fd);
+    client->fd = -1;
+    free(client->out);
+    client->out = NULL;
+    client->out_len = client->out_cap = client->out_sent = 0;
+    client->request_len = 0;
+}
+
+/*
+ * client_write - Send what the socket takes; close once all of it went
+ */
+static void client_write(MetricsClient* client, u32 token) {
+    while (client->out_sent < client->out_len) {
+        i32 n = network_send(client->fd, (const u8*)client->out + client->out_sent,
+                             client->out_len - client->out_sent);
+        if (n > 0) {
+            client->out_sent += (u32)n;
+            continue;
+        }
+        if (n < 0 && network_would_block()) {
+            network_watch(g_endpoint.network, client->fd, token, true);
+            return;
+        }
+        break;
+    }
+    client_close(client);
+}
+
+static void client_read(MetricsClient* client, u32 token) {
+    for (;;) {
+        u32 room = sizeof(client->request) - 1 - client->request_len;
+        if (room == 0) {
+            client_close(client);  /* Request head too large */
+            return;
+        }
+        i32 n = network_receive(client->fd, (u8*)client->request + client->request_len, room);
+        if (n > 0) {
+            client->request_len += (u32)n;
+            client->request[client->request_len] = '\0';
+            if (strstr(client->request, "\r\n\r\n") || strstr(client->request, "\n\n")) break;
+            continue;
+        }
+        if (n < 0 && network_would_block()) return;
+        client_close(client);  /* Peer closed or failed before a full request */
+        return;
+    }
+
+    build_response(client);
+    if (client->out_len == 0) {
+        client_close(client);
+        return;
+    }
+    client_write(client, token);
+}
+
+static void accept_clients(void) {
+    u64 now = tick_stats_now();
+    for (;;) {
+        i32 fd = network_accept(g_endpoint.listen_fd);
+        if (fd < 0) return;
+
+        /* Drop scrapes that stalled; refuse if every slot is still busy */
+        MetricsClient* slot = NULL;
+        for (u32 i = 0; i < METRICS_MAX_CLIENTS; i++) {
+            MetricsClient* client = &g_endpoint.clients[i];
+            if (client->fd >= 0 &&
+                now - client->opened > (u64)METRICS_CLIENT_TIMEOUT_MS * 1000000) {
+                client_close(client);
+            }
+            if (client->fd < 0 && !slot) slot = client;
+        }
+        u32 token = slot ? METRICS_TOKEN_BASE + 1 + (u32)(slot - g_endpoint.clients) : 0;
+        if (!slot || !network_watch(g_endpoint.network, fd, token, false)) {
+            network_close_socket(fd);
+            continue;
+        }
+        slot->fd = fd;
+        slot->opened = now;
+        slot->request_len = 0;
+    }
+}
+
+/*******************************************************************************
+ * LIFECYCLE
+ ******************************************************************************/
+
+bool metrics_listen(NetworkServer* network, u16 port) {
+    for (u32 i = 0; i < METRICS_MAX_CLIENTS; i++) g_endpoint.clients[i].fd = -1;
+
+    i32 fd = network_listen(port);
+    if (fd < 0) {
+        fprintf(stderr, "WARNING: Failed to open metrics port %u\n", port);
+        return false;
+    }
+    if (!network_watch(network, fd, METRICS_TOKEN_LISTENER, false)) {
+        fprintf(stderr, "WARNING: Failed to watch metrics port %u\n", port);
+        network_close_socket(fd);
+        return false;
+    }
+    g_endpoint.network = network;
+    g_endpoint.listen_fd = fd;
+    printf("Metrics on port %u (GET /metrics)\n", port);
+    return true;
+}
+
+void metrics_handle_event(const NetworkEvent* event) {
+    if (g_endpoint.listen_fd < 0) return;
+    if (event->token == METRICS_TOKEN_LISTENER) {
+        accept_clients();
+        return;
+    }
+
+    u32 index = event->token - METRICS_TOKEN_BASE - 1;
+    if (index >= METRICS_MAX_CLIENTS) return;
+    MetricsClient* client = &g_endpoint.clients[index];
+    if (client->fd < 0) return;
+
+    if (client->out_len > 0) {
+        if (event->writable || event->readable) client_write(client, event->token);
+    } else if (event->readable) {
+        client_read(client, event->token);
+    }
+}
+
+void metrics_close(void) {
+    if (g_endpoint.listen_fd < 0) return;
+    for (u32 i = 0; i < METRICS_MAX_CLIENTS; i++) {
+        client_close(&g_endpoint.clients[i]);
+    }
+    network_unwatch(g_endpoint.network, g_endpoint.listen_fd);
+    network_close_socket(g_endpoint.listen_fd);
+    g_endpoint.listen_fd = -1;
+}
@@ -0,0 +1,206 @@
+/*******************************************************************************
+ * METRICS.H - Server Counters and a Prometheus Text Endpoint
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Lock-free counters: relaxed atomic adds, no mutex on the hot path
+ *   - Separating the data a monitor reads from the data the tick uses
+ *   - The Prometheus text exposition format (counters, gauges, histograms)
+ *   - Serving a second protocol (HTTP) from the same event loop
+ *
+ * THE PROBLEM:
+ *
+ * The only window into a running server was stdout ("Player connected...",
+ * the tick report). How many players are on, which packets dominate the
+ * inbound traffic, how deep the save queue gets during an autosave wave -
+ * answering any of it meant reading logs by hand. A monitoring system
+ * wants numbers it can poll, graph and alert on.
+ *
+ * THE SOLUTION - COUNTERS THE TICK WRITES, A SCRAPER THAT ONLY READS THEM:
+ *
+ *   tick thread / network thread          metrics port (--metrics-port N)
+ *   ─────────────────────────────         ───────────────────────────────
+ *   packet handled → metrics_add()        GET /metrics
+ *   bytes sent     → metrics_add()   ──►  atomic loads of g_metrics only
+ *   end of tick    → metrics_publish_tick()   → text response, close
+ *
+ * Every value lives in g_metrics, nowhere else:
+ *
+ *   - Counters are bumped with a relaxed atomic add (one `lock xadd`, a
+ *     few ns) at the place the event happens. Relaxed is enough: each
+ *     counter is independent and a scrape only needs a recent value.
+ *   - Gauges (players online, queue depths) are values the tick thread
+ *     already has or can take cheaply once per tick; it copies them into
+ *     g_metrics at the end of the tick with metrics_publish_tick().
+ *
+ * A scrape never walks player slots, takes a queue mutex or reads tick
+ * state: the tick thread's data is never touched by it, and the cost of a
+ * scrape does not grow with the number of players.
+ *
+ * SERVED BY THE NETWORK LOOP:
+ *
+ *   The metrics listener and its (at most METRICS_MAX_CLIENTS) HTTP
+ *   connections are watched in the game's own event set with tokens from
+ *   METRICS_TOKEN_BASE up. Whichever loop owns the sockets - server_run()
+ *   or the network thread (--net-thread) - hands those events to
+ *   metrics_handle_event(). Each request gets one HTTP/1.0 response and
+ *   the connection is closed; a response that does not fit the socket
+ *   buffer is finished on writability, like player output.
+ *
+ * EXPOSITION (text format 0.0.4):
+ *
+ *   # HELP rs225_players_online Players logged in at the end of the last tick.
+ *   # TYPE rs225_players_online gauge
+ *   rs225_players_online 42
+ *   rs225_packets_received_total{opcode="165"} 9120
+ *   rs225_tick_duration_seconds_bucket{le="0.005"} 3170
+ *   rs225_heap_bytes{subsystem="map"} 41943040
+ *
+ *   Per-opcode series are only written for opcodes seen at least once.
+ *   Heap series come from mem_stats.h's counters, one per subsystem tag.
+ *
+ * CONFIGURATION:
+ *   --metrics-port N   serve on port N (off by default)
+ *
+ ******************************************************************************/
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "types.h"
+#include "network.h"
+#include <stdbool.h>
+
+/* Concurrent scrapes served at once (further connections are refused) */
+#define METRICS_MAX_CLIENTS 8
+
+/* A scrape that has not finished in this long is dropped */
+#define METRICS_CLIENT_TIMEOUT_MS 5000
+
+/* Event tokens: listener, then one per client (below the listener/netio tokens) */
+#define METRICS_TOKEN_BASE 0xFFFFFF00u
+#define METRICS_TOKEN_LISTENER METRICS_TOKEN_BASE
+
+/* Tick duration histogram upper bounds, milliseconds (+Inf is implicit) */
+#define METRICS_TICK_BUCKETS 10
+
+/*
+ * Metrics - Every exported value
+ *
+ * Written with metrics_add() / metrics_set() only, read with atomic loads
+ * by the scraper. Counters touched by the network thread sit on their own
+ * cache line so they do not bounce the tick thread's counters.
+ */
+typedef struct {
+    /* Socket traffic (whichever thread does the recv/send) */
+    u64 bytes_received;
+    u64 bytes_sent;
+    u8  pad_net[48];
+
+    /* Packets (tick thread) */
+    u64 packets_in[256];            /* Handled client packets by opcode */
+    u64 packet_bytes_in[256];       /* Their payload bytes */
+    u64 packets_out[256];           /* Server packets written by opcode */
+    u64 map_bytes;                  /* Map file bytes streamed to clients */
+    u64 load_areas_skipped;         /* LOAD_AREAs not sent: same as the client's scene */
+    u64 map_prefetches;             /* Map regions prefetched ahead of a player */
+    u64 map_transfers_deferred;     /* Ticks a connection's map files were left unfinished */
+    u64 packets_deferred;           /* Rate limit hits (packet held for a later tick) */
+    u64 slow_consumers;             /* Connections dropped for staying congested */
+    u64 connections_reaped;         /* Dropped for a missed login or idle deadline */
+
+    /* Tick durations (server_tick work) */
+    u64 tick_buckets[METRICS_TICK_BUCKETS + 1];  /* Per bucket, not cumulative */
+    u64 tick_sum_us;
+    u64 ticks;
+
+    /* Gauges published once per tick */
+    u64 players_online;
+    u64 login_queue_depth;
+    u64 save_queue_depth;
+    u64 out_queued_bytes;           /* Unsent output over all connections */
+    u64 out_queue_max_bytes;        /* ... of the deepest one */
+    u64 out_congested;              /* Connections over the high watermark (player.h) */
+} Metrics;
+
+extern Metrics g_metrics;
+
+/*
+ * g_metrics_port - Port for the endpoint (0 = disabled, --metrics-port)
+ */
+extern u16 g_metrics_port;
+
+/*
+ * metrics_add - Add to a counter (any thread, lock-free)
+ */
+static inline void metrics_add(u64* counter, u64 n) {
+    __atomic_fetch_add(counter, n, __ATOMIC_RELAXED);
+}
+
+/*
+ * metrics_set - Store a gauge (any thread, lock-free)
+ */
+static inline void metrics_set(u64* gauge, u64 value) {
+    __atomic_store_n(gauge, value, __ATOMIC_RELAXED);
+}
+
+/*
+ * metrics_observe_tick - Record one tick's work time in the histogram
+ *
+ * @param work_ns  server_tick() duration (tick_stats_end)
+ */
+void metrics_observe_tick(u64 work_ns);
+
+/*
+ * metrics_publish_tick - Copy the end-of-tick gauges into g_metrics
+ *
+ * @param players      Players logged in
+ * @param login_depth  Logins waiting on the workers (load_queue_pending)
+ * @param save_depth   Saves not yet written (save_queue_pending)
+ */
+void metrics_publish_tick(u32 players, u32 login_depth, u32 save_depth);
+
+/*
+ * metrics_publish_output - Copy the per-connection send queue gauges
+ *
+ * @param queued     Unsent bytes summed over all connections
+ * @param deepest    Unsent bytes of the deepest connection
+ * @param congested  Connections currently congested (player_out_congested)
+ */
+void metrics_publish_output(u64 queued, u32 deepest, u32 congested);
+
+/*
+ * metrics_listen - Open the endpoint and watch it in the game's event set
+ *
+ * @param network  Game NetworkServer (already initialized)
+ * @param port     TCP port
+ * @return         false (with a warning) if the port could not be bound
+ *
+ * Call before the network thread starts: the poll() backend's event set
+ * may only be changed by the thread that waits on it.
+ */
+bool metrics_listen(NetworkServer* network, u16 port);
+
+/*
+ * metrics_owns_token - true for the listener's and clients' tokens
+ */
+static inline bool metrics_owns_token(u32 token) {
+    return token >= METRICS_TOKEN_BASE && token <= METRICS_TOKEN_BASE + METRICS_MAX_CLIENTS;
+}
+
+/*
+ * metrics_handle_event - Accept, read a request, or continue a response
+ *
+ * @param event  Event whose token metrics_owns_token()
+ *
+ * Called by the thread that waits on the event set.
+ */
+void metrics_handle_event(const NetworkEvent* event);
+
+/*
+ * metrics_close - Close the listener and any open scrape connections
+ */
+void metrics_close(void);
+
+#endif /* METRICS_H */
@@ -1,4 +1,5 @@
 #include <math.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -6,9 +7,11 @@
 #include "allocator.h"
 #include "animbase.h"
 #include "animframe.h"
+#include "datastruct/lrucache.h"
 #include "defines.h"
 #include "jagfile.h"
 #include "model.h"
+#include "model_transform.h"
 #include "pix2d.h"
 #include "pix3d.h"
 #include "platform.h"
@@ -18,6 +21,8 @@ extern Pix3D _Pix3D;
 extern Pix2D _Pix2D;
 extern AnimFrameData _AnimFrame;
 
+static void projection_free(void);
+
 void model_init_global(void) {
     _Model.face_clipped_x = calloc(4096, sizeof(bool));
     _Model.face_near_clipped = calloc(4096, sizeof(bool));
@@ -28,10 +33,10 @@ void model_init_global(void) {
     _Model.vertex_view_space_y = calloc(4096, sizeof(int));
     _Model.vertex_view_space_z = calloc(4096, sizeof(int));
     _Model.tmp_depth_face_count = calloc(MODEL_MAX_DEPTH, sizeof(int));
-    _Model.tmp_depth_faces = calloc(MODEL_MAX_DEPTH, sizeof(int *));
-    for (int i = 0; i < MODEL_MAX_DEPTH; i++) {
-        _Model.tmp_depth_faces[i] = calloc(MODEL_DEPTH_FACE_COUNT, sizeof(int));
-    }
+    _Model.tmp_depth_face_start = calloc(MODEL_MAX_DEPTH, sizeof(int));
+    _Model.tmp_depth_faces = calloc(4096, sizeof(int));
+    _Model.tmp_face_depth = calloc(4096, sizeof(int));
+    _Model.tmp_visible_faces = calloc(4096, sizeof(int));
     _Model.tmp_priority_face_count = calloc(12, sizeof(int));
     _Model.tmp_priority_faces = calloc(12, sizeof(int *));
     for (int i = 0; i < 12; i++) {
@@ -44,6 +49,7 @@ void model_init_global(void) {
     _Model.clipped_y = calloc(10, sizeof(int));
     _Model.clipped_color = calloc(10, sizeof(int));
     _Model.picked_bitsets = calloc(1000, sizeof(int));
+    model_transform_init();
 
     _Model.base_x = 0;
     _Model.base_y = 0;
@@ -59,6 +65,8 @@ void model_free_global(void) {
         free(_Model.metadata[i]);
     }
     free(_Model.metadata);
+    projection_free();
+    model_frame_cache_free();
     free(_Model.face_clipped_x);
     free(_Model.face_near_clipped);
     free(_Model.vertex_screen_x);
@@ -68,10 +76,10 @@ void model_free_global(void) {
     free(_Model.vertex_view_space_y);
     free(_Model.vertex_view_space_z);
     free(_Model.tmp_depth_face_count);
-    for (int i = 0; i < MODEL_MAX_DEPTH; i++) {
-        free(_Model.tmp_depth_faces[i]);
-    }
+    free(_Model.tmp_depth_face_start);
     free(_Model.tmp_depth_faces);
+    free(_Model.tmp_face_depth);
+    free(_Model.tmp_visible_faces);
     free(_Model.tmp_priority_face_count);
     for (int i = 0; i < 12; i++) {
         free(_Model.tmp_priority_faces[i]);
@@ -83,6 +91,7 @@ void model_free_global(void) {
     free(_Model.clipped_x);
     free(_Model.clipped_y);
     free(_Model.clipped_color);
+    free(_Model.vertex_lightness);
     free(_Model.picked_bitsets);
 
     packet_free(_Model.head);
@@ -206,6 +215,24 @@ void model_free(Model *model) {
     free(model);
 }
 
+int model_size(const Model *m) {
+    int ints = m->vertex_count * 3 + m->textured_face_count * 3;
+    int *faceArrays[] = {m->face_indices_a, m->face_indices_b, m->face_indices_c, m->face_color_a, m->face_color_b, m->face_color_c, m->face_infos, m->face_priorities, m->face_alphas, m->face_colors, m->face_labels};
+    for (int i = 0; i < 11; i++) {
+        if (faceArrays[i]) {
+            ints += m->face_count;
+        }
+    }
+    if (m->vertex_labels) {
+        ints += m->vertex_count;
+    }
+    int bytes = (int)sizeof(Model) + ints * (int)sizeof(int);
+    if (m->vertex_normal) {
+        bytes += m->vertex_count * (int)(sizeof(VertexNormal *) + sizeof(VertexNormal));
+    }
+    return bytes;
+}
+
 void model_unpack(Jagfile *models) {
     // try {
     _Model.head = jagfile_to_packet(models, "ob_head.dat");
@@ -965,7 +992,244 @@ void model_draw_simple(Model *m, int pitch, int yaw, int roll, int eyePitch, int
     // }
 }
 
+/*
+ * PROJECTION CACHE (model_draw_static)
+ *
+ * Scenery does not move. While the camera holds still, a wall, loc or
+ * ground decoration projects to the same screen coordinates and sorts its
+ * faces the same way every frame, so model_draw_static() keeps the result
+ * per (model, yaw, scene position):
+ *
+ *   first frame   transform V vertices, depth-sort F faces, draw them
+ *                 and record which faces were drawn, in order
+ *   next frames   same camera: draw the recorded faces from the stored
+ *                 screen and view-space coordinates
+ *
+ * Any change of camera pitch, yaw or viewport starts a new epoch and every
+ * entry goes stale (moving the camera changes each scene position anyway).
+ * A model is numbered on its first cached draw; the functions that move
+ * its vertices clear the number, so a changed model - or a new one
+ * allocated where a freed one lived - never matches an old entry.
+ * Slots are direct-mapped: a collision projects again and takes the slot.
+ * Hovering the mouse over a model always takes the full path (picking).
+ */
+typedef struct {
+    Model *model;
+    int id;                     /* model->projection_id when recorded */
+    int epoch;
+    int yaw;
+    int x;
+    int y;
+    int z;
+    bool view_space;            /* screen z and view space stored too */
+    int vertex_capacity;
+    int face_capacity;
+    int *screen_x;
+    int *screen_y;
+    int *screen_z;
+    int *view_x;
+    int *view_y;
+    int *view_z;
+    int face_count;
+    int *faces;                 /* Drawn faces, in draw order */
+    unsigned char *face_flags;  /* Bit 0 near clipped, bit 1 clipped x */
+} ProjectionEntry;
+
+static struct {
+    ProjectionEntry *slots;     /* MODEL_PROJECTION_CACHE, allocated on first use */
+    int epoch;
+    int next_id;
+    int camera[7];
+    ProjectionEntry *recording;
+} _Projection;
+
+/*
+ * projection_free - Release every cached projection
+ */
+static void projection_free(void) {
+    if (!_Projection.slots) {
+        return;
+    }
+    for (int i = 0; i < MODEL_PROJECTION_CACHE; i++) {
+        ProjectionEntry *entry = &_Projection.slots[i];
+        free(entry->screen_x);
+        free(entry->screen_y);
+        free(entry->screen_z);
+        free(entry->view_x);
+        free(entry->view_y);
+        free(entry->view_z);
+        free(entry->faces);
+        free(entry->face_flags);
+    }
+    free(_Projection.slots);
+    memset(&_Projection, 0, sizeof(_Projection));
+}
+
+/*
+ * projection_slot - Entry for a static draw, and whether it can be replayed
+ */
+static ProjectionEntry *projection_slot(Model *m, int yaw, int sinCameraPitch, int cosCameraPitch, int sinCameraYaw, int cosCameraYaw, int sceneX, int sceneY, int sceneZ, bool *hit) {
+    *hit = false;
+    if (MODEL_PROJECTION_CACHE == 0) {
+        return NULL;
+    }
+    if (!_Projection.slots) {
+        _Projection.slots = calloc(MODEL_PROJECTION_CACHE, sizeof(ProjectionEntry));
+        if (!_Projection.slots) {
+            return NULL;
+        }
+    }
+
+    int camera[7] = {sinCameraPitch, cosCameraPitch, sinCameraYaw, cosCameraYaw, _Pix3D.center_x, _Pix3D.center_y, _Pix2D.bound_x};
+    if (memcmp(camera, _Projection.camera, sizeof(camera)) != 0) {
+        memcpy(_Projection.camera, camera, sizeof(camera));
+        _Projection.epoch++;
+    }
+    if (m->projection_id == 0) {
+        if (++_Projection.next_id <= 0) {
+            _Projection.next_id = 1;
+        }
+        m->projection_id = _Projection.next_id;
+    }
+
+    uint32_t hash = (uint32_t)((uintptr_t)m >> 4) ^ (uint32_t)yaw * 31u ^ (uint32_t)sceneX * 73856093u ^ (uint32_t)sceneY * 19349663u ^ (uint32_t)sceneZ * 83492791u;
+    ProjectionEntry *entry = &_Projection.slots[(hash ^ hash >> 16) % MODEL_PROJECTION_CACHE];
+    *hit = entry->model == m && entry->id == m->projection_id && entry->epoch == _Projection.epoch && entry->yaw == yaw && entry->x == sceneX && entry->y == sceneY && entry->z == sceneZ;
+    return entry;
+}
+
+/*
+ * projection_store - Keep the projection in _Model and start recording faces
+ *
+ * @return  false if the entry could not grow (the model is drawn uncached)
+ */
+static bool projection_store(ProjectionEntry *entry, Model *m, int yaw, int sceneX, int sceneY, int sceneZ, bool viewSpace) {
+    entry->model = NULL;
+    if (m->vertex_count > entry->vertex_capacity) {
+        int capacity = m->vertex_count;
+        int **arrays[] = {&entry->screen_x, &entry->screen_y, &entry->screen_z, &entry->view_x, &entry->view_y, &entry->view_z};
+        for (int i = 0; i < 6; i++) {
+            int *grown = realloc(*arrays[i], capacity * sizeof(int));
+            if (!grown) {
+                return false;
+            }
+            *arrays[i] = grown;
+        }
+        entry->vertex_capacity = capacity;
+    }
+    if (m->face_count > entry->face_capacity) {
+        int *faces = realloc(entry->faces, m->face_count * sizeof(int));
+        if (!faces) {
+            return false;
+        }
+        entry->faces = faces;
+        unsigned char *flags = realloc(entry->face_flags, m->face_count);
+        if (!flags) {
+            return false;
+        }
+        entry->face_flags = flags;
+        entry->face_capacity = m->face_count;
+    }
+
+    int bytes = m->vertex_count * sizeof(int);
+    memcpy(entry->screen_x, _Model.vertex_screen_x, bytes);
+    memcpy(entry->screen_y, _Model.vertex_screen_y, bytes);
+    if (viewSpace) {
+        memcpy(entry->screen_z, _Model.vertex_screen_z, bytes);
+        memcpy(entry->view_x, _Model.vertex_view_space_x, bytes);
+        memcpy(entry->view_y, _Model.vertex_view_space_y, bytes);
+        memcpy(entry->view_z, _Model.vertex_view_space_z, bytes);
+    }
+    entry->model = m;
+    entry->id = m->projection_id;
+    entry->epoch = _Projection.epoch;
+    entry->yaw = yaw;
+    entry->x = sceneX;
+    entry->y = sceneY;
+    entry->z = sceneZ;
+    entry->view_space = viewSpace;
+    entry->face_count = 0;
+    _Projection.recording = entry;
+    return true;
+}
+
+/*
+ * projection_replay - Draw the recorded faces from the stored coordinates
+ */
+static void projection_replay(Model *m, const ProjectionEntry *entry) {
+    int *screenX = _Model.vertex_screen_x;
+    int *screenY = _Model.vertex_screen_y;
+    int *screenZ = _Model.vertex_screen_z;
+    int *viewX = _Model.vertex_view_space_x;
+    int *viewY = _Model.vertex_view_space_y;
+    int *viewZ = _Model.vertex_view_space_z;
+    _Model.vertex_screen_x = entry->screen_x;
+    _Model.vertex_screen_y = entry->screen_y;
+    if (entry->view_space) {
+        _Model.vertex_screen_z = entry->screen_z;
+        _Model.vertex_view_space_x = entry->view_x;
+        _Model.vertex_view_space_y = entry->view_y;
+        _Model.vertex_view_space_z = entry->view_z;
+    }
+
+    for (int i = 0; i < entry->face_count; i++) {
+        int f = entry->faces[i];
+        _Model.face_near_clipped[f] = entry->face_flags[i] & 1;
+        _Model.face_clipped_x[f] = entry->face_flags[i] >> 1 & 1;
+        model_draw_face(m, f);
+    }
+
+    _Model.vertex_screen_x = screenX;
+    _Model.vertex_screen_y = screenY;
+    _Model.vertex_screen_z = screenZ;
+    _Model.vertex_view_space_x = viewX;
+    _Model.vertex_view_space_y = viewY;
+    _Model.vertex_view_space_z = viewZ;
+}
+
+#ifdef MODEL_STAGE_TIMING
+uint64_t g_model_stage_ns[MODEL_STAGE_COUNT];
+static uint64_t (*stage_now)(void);
+static ModelStage stage_current;
+static uint64_t stage_since;
+
+void model_stage_clock(uint64_t (*now_ns)(void)) {
+    stage_now = now_ns;
+    stage_current = MODEL_STAGE_NONE;
+}
+
+// charge the time since the last switch to the stage that was running
+static void model_stage_enter(ModelStage stage) {
+    if (!stage_now) {
+        return;
+    }
+    uint64_t now = stage_now();
+    if (stage_current != MODEL_STAGE_NONE) {
+        g_model_stage_ns[stage_current] += now - stage_since;
+    }
+    stage_current = stage;
+    stage_since = now;
+}
+#define MODEL_STAGE_ENTER(stage) model_stage_enter(stage)
+#else
+#define MODEL_STAGE_ENTER(stage)
+#endif
+
+static void model_draw_at(Model *m, int yaw, int sinCameraPitch, int cosCameraPitch, int sinCameraYaw, int cosCameraYaw, int sceneX, int sceneY, int sceneZ, int key, bool keep);
+
 void model_draw(Model *m, int yaw, int sinCameraPitch, int cosCameraPitch, int sinCameraYaw, int cosCameraYaw, int sceneX, int sceneY, int sceneZ, int key) {
+    MODEL_STAGE_ENTER(MODEL_STAGE_CULL);
+    model_draw_at(m, yaw, sinCameraPitch, cosCameraPitch, sinCameraYaw, cosCameraYaw, sceneX, sceneY, sceneZ, key, false);
+    MODEL_STAGE_ENTER(MODEL_STAGE_NONE);
+}
+
+void model_draw_static(Model *m, int yaw, int sinCameraPitch, int cosCameraPitch, int sinCameraYaw, int cosCameraYaw, int sceneX, int sceneY, int sceneZ, int key) {
+    MODEL_STAGE_ENTER(MODEL_STAGE_CULL);
+    model_draw_at(m, yaw, sinCameraPitch, cosCameraPitch, sinCameraYaw, cosCameraYaw, sceneX, sceneY, sceneZ, key, true);
+    MODEL_STAGE_ENTER(MODEL_STAGE_NONE);
+}
+
+static void model_draw_at(Model *m, int yaw, int sinCameraPitch, int cosCameraPitch, int sinCameraYaw, int cosCameraYaw, int sceneX, int sceneY, int sceneZ, int key, bool keep) {
     int a = (sceneZ * cosCameraYaw - sceneX * sinCameraYaw) >> 16;
     int b = (sceneY * sinCameraPitch + a * cosCameraPitch) >> 16;
     int c = m->radius * cosCameraPitch >> 16;
@@ -1031,98 +1295,121 @@ void model_draw(Model *m, int yaw, int sinCameraPitch, int cosCameraPitch, int s
             }
         }
     }
-    cx = _Pix3D.center_x;
-    cy = _Pix3D.center_y;
-    yawsin = 0;
-    int yawcos = 0;
-    if (yaw != 0) {
-        yawsin = _Pix3D.sin_table[yaw];
-        yawcos = _Pix3D.cos_table[yaw];
+    ProjectionEntry *entry = NULL;
+    if (keep) {
+        bool hit;
+        entry = projection_slot(m, yaw, sinCameraPitch, cosCameraPitch, sinCameraYaw, cosCameraYaw, sceneX, sceneY, sceneZ, &hit);
+        if (hit && !hasInput) {
+            MODEL_STAGE_ENTER(MODEL_STAGE_RASTER);
+            projection_replay(m, entry);
+            return;
+        }
+    }
+    MODEL_STAGE_ENTER(MODEL_STAGE_TRANSFORM);
+    // 4 or 8 vertices at a time where the CPU allows (model_transform.h)
+    ModelTransform transform = {
+        .yaw = yaw != 0,
+        .yaw_sin = _Pix3D.sin_table[yaw],
+        .yaw_cos = _Pix3D.cos_table[yaw],
+        .scene_x = sceneX,
+        .scene_y = sceneY,
+        .scene_z = sceneZ,
+        .camera_sin_yaw = sinCameraYaw,
+        .camera_cos_yaw = cosCameraYaw,
+        .camera_sin_pitch = sinCameraPitch,
+        .camera_cos_pitch = cosCameraPitch,
+        .center_x = _Pix3D.center_x,
+        .center_y = _Pix3D.center_y,
+        .depth_offset = b,
+    };
+    ModelVertices vertices = {
+        _Model.vertex_screen_x, _Model.vertex_screen_y, _Model.vertex_screen_z,
+        _Model.vertex_view_space_x, _Model.vertex_view_space_y, _Model.vertex_view_space_z,
+    };
+    if (model_transform_vertices(&transform, m->vertices_x, m->vertices_y, m->vertices_z, m->vertex_count, project || m->textured_face_count > 0, &vertices)) {
+        project = true;
     }
-    for (int v = 0; v < m->vertex_count; v++) {
-        int x = m->vertices_x[v];
-        int y = m->vertices_y[v];
-        int z = m->vertices_z[v];
-        int temp;
-        if (yaw != 0) {
-            temp = (z * yawsin + x * yawcos) >> 16;
-            z = (z * yawcos - x * yawsin) >> 16;
-            x = temp;
-        }
-        x += sceneX;
-        y += sceneY;
-        z += sceneZ;
-        temp = (z * sinCameraYaw + x * cosCameraYaw) >> 16;
-        z = (z * cosCameraYaw - x * sinCameraYaw) >> 16;
-        x = temp;
-        temp = (y * cosCameraPitch - z * sinCameraPitch) >> 16;
-        z = (y * sinCameraPitch + z * cosCameraPitch) >> 16;
-
-        _Model.vertex_screen_z[v] = z - b;
-        if (z >= 50) {
-            _Model.vertex_screen_x[v] = cx + (x << 9) / z;
-            _Model.vertex_screen_y[v] = cy + (temp << 9) / z;
-        } else {
-            _Model.vertex_screen_x[v] = -5000;
-            project = true;
-        }
-        if (project || m->textured_face_count > 0) {
-            _Model.vertex_view_space_x[v] = x;
-            _Model.vertex_view_space_y[v] = temp;
-            _Model.vertex_view_space_z[v] = z;
-        }
+    if (entry && !projection_store(entry, m, yaw, sceneX, sceneY, sceneZ, project || m->textured_face_count > 0)) {
+        entry = NULL;
     }
+    MODEL_STAGE_ENTER(MODEL_STAGE_CULL);
     // try {
     model_draw2(m, project, hasInput, key);
     // } catch ( Exception ignored) {
+    _Projection.recording = NULL;
 }
 
 void model_draw2(Model *m, bool projected, bool hasInput, int bitset) {
     // added < MODEL_MAX_DEPTH checks for model 714 and for optional smaller depth buffer
-    for (int i = 0; i < m->max_depth && i < MODEL_MAX_DEPTH; i++) {
-        _Model.tmp_depth_face_count[i] = 0;
-    }
+    // (a model deeper than the buffer draws nothing, as before)
+    int depths = m->max_depth <= MODEL_MAX_DEPTH ? m->max_depth : 0;
+    // counting sort, back to front: count each visible face's depth here,
+    // then place the faces so tmp_depth_faces holds them in drawing order.
+    // The counts are all zero between draws (the placing pass hands them back
+    // that way), so only the buckets between nearest and farthest are touched
+    int *depthCount = _Model.tmp_depth_face_count;
+    int *faceDepth = _Model.tmp_face_depth;
+    int *visibleFaces = _Model.tmp_visible_faces;
+    int visible = 0;
+    int nearest = depths;
+    int farthest = -1;
     for (int f = 0; f < m->face_count; f++) {
-        if (!m->face_infos || m->face_infos[f] != -1) {
-            int a = m->face_indices_a[f];
-            int b = m->face_indices_b[f];
-            int c = m->face_indices_c[f];
-
-            int xa = _Model.vertex_screen_x[a];
-            int xb = _Model.vertex_screen_x[b];
-            int xc = _Model.vertex_screen_x[c];
-            if (projected && (xa == -5000 || xb == -5000 || xc == -5000)) {
-                _Model.face_near_clipped[f] = true;
-                int depth_average = (_Model.vertex_screen_z[a] + _Model.vertex_screen_z[b] + _Model.vertex_screen_z[c]) / 3 + m->min_depth;
-                if (depth_average < MODEL_MAX_DEPTH) {
-                    _Model.tmp_depth_faces[depth_average][_Model.tmp_depth_face_count[depth_average]++] = f;
-                }
-            } else {
-                if (hasInput && model_point_within_triangle(_Model.mouse_x, _Model.mouse_y, _Model.vertex_screen_y[a], _Model.vertex_screen_y[b], _Model.vertex_screen_y[c], xa, xb, xc)) {
-                    _Model.picked_bitsets[_Model.picked_count++] = bitset;
-                    hasInput = false;
-                }
+        if (m->face_infos && m->face_infos[f] == -1) {
+            continue;
+        }
+        int a = m->face_indices_a[f];
+        int b = m->face_indices_b[f];
+        int c = m->face_indices_c[f];
 
-                if ((xa - xb) * (_Model.vertex_screen_y[c] - _Model.vertex_screen_y[b]) - (_Model.vertex_screen_y[a] - _Model.vertex_screen_y[b]) * (xc - xb) > 0) {
-                    _Model.face_near_clipped[f] = false;
-                    _Model.face_clipped_x[f] = xa >= 0 || xb >= 0 || xc >= 0 || xa <= _Pix2D.bound_x || xb <= _Pix2D.bound_x || xc <= _Pix2D.bound_x;
-                    int depth_average = (_Model.vertex_screen_z[a] + _Model.vertex_screen_z[b] + _Model.vertex_screen_z[c]) / 3 + m->min_depth;
-                    if (depth_average < MODEL_MAX_DEPTH) {
-                        _Model.tmp_depth_faces[depth_average][_Model.tmp_depth_face_count[depth_average]++] = f;
-                    }
-                }
+        int xa = _Model.vertex_screen_x[a];
+        int xb = _Model.vertex_screen_x[b];
+        int xc = _Model.vertex_screen_x[c];
+        // only a model with a vertex behind the near plane (projected) has faces to clip there
+        if (projected && (xa == -5000 || xb == -5000 || xc == -5000)) {
+            _Model.face_near_clipped[f] = true;
+        } else {
+            if (hasInput && model_point_within_triangle(_Model.mouse_x, _Model.mouse_y, _Model.vertex_screen_y[a], _Model.vertex_screen_y[b], _Model.vertex_screen_y[c], xa, xb, xc)) {
+                _Model.picked_bitsets[_Model.picked_count++] = bitset;
+                hasInput = false;
+            }
+
+            if ((xa - xb) * (_Model.vertex_screen_y[c] - _Model.vertex_screen_y[b]) - (_Model.vertex_screen_y[a] - _Model.vertex_screen_y[b]) * (xc - xb) <= 0) {
+                continue;
+            }
+            _Model.face_near_clipped[f] = false;
+            // every face takes the clipping rasterizer: the test this was
+            // (xa >= 0 || ... || xc <= bound_x) held for any x
+            _Model.face_clipped_x[f] = true;
+        }
+        int depth_average = (_Model.vertex_screen_z[a] + _Model.vertex_screen_z[b] + _Model.vertex_screen_z[c]) / 3 + m->min_depth;
+        if (depth_average >= 0 && depth_average < depths) {
+            faceDepth[f] = depth_average;
+            depthCount[depth_average]++;
+            visibleFaces[visible++] = f;
+            if (depth_average < nearest) {
+                nearest = depth_average;
+            }
+            if (depth_average > farthest) {
+                farthest = depth_average;
             }
         }
     }
+    int *depthStart = _Model.tmp_depth_face_start;
+    int placed = 0;
+    for (int depth = farthest; depth >= nearest; depth--) {
+        depthStart[depth] = placed;
+        placed += depthCount[depth];
+        depthCount[depth] = 0;
+    }
+    int *sorted = _Model.tmp_depth_faces;
+    for (int i = 0; i < visible; i++) {
+        int f = visibleFaces[i];
+        sorted[depthStart[faceDepth[f]]++] = f;
+    }
+    MODEL_STAGE_ENTER(MODEL_STAGE_RASTER);
     if (!m->face_priorities) {
-        for (int depth = m->max_depth - 1; depth >= 0 && depth < MODEL_MAX_DEPTH; depth--) {
-            int count = _Model.tmp_depth_face_count[depth];
-            if (count > 0) {
-                int *faces = _Model.tmp_depth_faces[depth];
-                for (int f = 0; f < count; f++) {
-                    model_draw_face(m, faces[f]);
-                }
-            }
+        for (int i = 0; i < visible; i++) {
+            model_draw_face(m, sorted[i]);
         }
         return;
     }
@@ -1130,23 +1417,18 @@ void model_draw2(Model *m, bool projected, bool hasInput, int bitset) {
         _Model.tmp_priority_face_count[priority] = 0;
         _Model.tmp_priority_depth_sum[priority] = 0;
     }
-    for (int depth = m->max_depth - 1; depth >= 0 && depth < MODEL_MAX_DEPTH; depth--) {
-        const int face_count = _Model.tmp_depth_face_count[depth];
-        if (face_count > 0) {
-            int *faces = _Model.tmp_depth_faces[depth];
-            for (int i = 0; i < face_count; i++) {
-                int priority_depth = faces[i];
-                int depth_average = m->face_priorities[priority_depth];
-                int priority_face_count = _Model.tmp_priority_face_count[depth_average]++;
-                _Model.tmp_priority_faces[depth_average][priority_face_count] = priority_depth;
-                if (depth_average < 10) {
-                    _Model.tmp_priority_depth_sum[depth_average] += depth;
-                } else if (depth_average == 10) {
-                    _Model.tmp_priority10_face_depth[priority_face_count] = depth;
-                } else {
-                    _Model.tmp_priority11_face_depth[priority_face_count] = depth;
-                }
-            }
+    for (int i = 0; i < visible; i++) {
+        int priority_depth = sorted[i];
+        int depth = faceDepth[priority_depth];
+        int depth_average = m->face_priorities[priority_depth];
+        int priority_face_count = _Model.tmp_priority_face_count[depth_average]++;
+        _Model.tmp_priority_faces[depth_average][priority_face_count] = priority_depth;
+        if (depth_average < 10) {
+            _Model.tmp_priority_depth_sum[depth_average] += depth;
+        } else if (depth_average == 10) {
+            _Model.tmp_priority10_face_depth[priority_face_count] = depth;
+        } else {
+            _Model.tmp_priority11_face_depth[priority_face_count] = depth;
         }
     }
     int averagePriorityDepthSum1_2 = 0;
@@ -1243,6 +1525,11 @@ void model_draw2(Model *m, bool projected, bool hasInput, int bitset) {
 }
 
 void model_draw_face(Model *m, int index) {
+    if (_Projection.recording) {
+        ProjectionEntry *entry = _Projection.recording;
+        entry->faces[entry->face_count] = index;
+        entry->face_flags[entry->face_count++] = _Model.face_near_clipped[index] | _Model.face_clipped_x[index] << 1;
+    }
     if (_Model.face_near_clipped[index]) {
         model_draw_near_clipped_face(m, index);
         return;
@@ -1695,7 +1982,108 @@ void model_apply_transforms(Model *m, int id, int id2, int *walkmerge) {
     }
 }
 
+/*
+ * ANIMATED FRAME CACHE (model_apply_transform_cached)
+ *
+ * An animating NPC or player is a fresh model_share_alpha() copy of its
+ * cached base model every frame, transformed by the current seq frame.
+ * A crowd of one NPC type standing idle or walking does that same work
+ * for the same (base model, frame) over and over. With the cache on, the
+ * first transform of a pair keeps the resulting vertices (and face
+ * alphas, for models that animate them); later ones copy them back.
+ *
+ * Entries are heap blocks counted against the lrucache budget at their
+ * size, and freed as they are evicted. The owner identifies the base
+ * model the way its model cache does (NPC type index, player appearance
+ * hash), so a rebuilt base model matches its old entries. Only single
+ * frames are cached: walkmerge blends pair two seqs and are rare.
+ */
+typedef struct {
+    DoublyLinkable link;
+    ModelFrameOwner kind;
+    int64_t owner;
+    int frame;
+    int vertex_count;
+    int alpha_count;            /* face alphas kept after the vertices */
+    int data[];                 /* x, y, z of every vertex, then alphas */
+} ModelFrame;
+
+static LruCache *frame_cache;
+
+static void model_frame_evicted(DoublyLinkable *value) {
+    free(value);
+}
+
+void model_frame_cache_init(int size) {
+    model_frame_cache_free();
+    if (size > 0) {
+        frame_cache = lrucache_new(size);
+        lrucache_set_evicted(frame_cache, model_frame_evicted);
+    }
+}
+
+void model_frame_cache_clear(void) {
+    if (frame_cache) {
+        lrucache_clear(frame_cache);
+    }
+}
+
+void model_frame_cache_free(void) {
+    if (frame_cache) {
+        lrucache_clear(frame_cache);
+        lrucache_free(frame_cache);
+        frame_cache = NULL;
+    }
+}
+
+void model_apply_transform_cached(Model *m, ModelFrameOwner kind, int64_t owner, int id, bool alphas) {
+    if (!frame_cache || !m->label_vertices || id == -1) {
+        model_apply_transform(m, id);
+        return;
+    }
+
+    int vertices = m->vertex_count;
+    int alpha_count = alphas && m->face_alphas ? m->face_count : 0;
+    uint64_t key = ((uint64_t)owner * 0x9e3779b97f4a7c15ull) ^ ((uint64_t)kind << 32 | (uint32_t)id);
+    ModelFrame *cached = (ModelFrame *)lrucache_get(frame_cache, (int64_t)key);
+    if (cached && cached->kind == kind && cached->owner == owner && cached->frame == id && cached->vertex_count == vertices && cached->alpha_count == alpha_count) {
+        memcpy(m->vertices_x, cached->data, vertices * sizeof(int));
+        memcpy(m->vertices_y, cached->data + vertices, vertices * sizeof(int));
+        memcpy(m->vertices_z, cached->data + vertices * 2, vertices * sizeof(int));
+        if (alpha_count > 0) {
+            memcpy(m->face_alphas, cached->data + vertices * 3, alpha_count * sizeof(int));
+        }
+        m->projection_id = 0;
+        return;
+    }
+
+    model_apply_transform(m, id);
+    if (cached) {
+        // another pair hashed to this key: leave its entry be
+        return;
+    }
+
+    int bytes = (int)sizeof(ModelFrame) + (vertices * 3 + alpha_count) * (int)sizeof(int);
+    ModelFrame *frame = calloc(1, bytes);
+    if (!frame) {
+        return;
+    }
+    frame->kind = kind;
+    frame->owner = owner;
+    frame->frame = id;
+    frame->vertex_count = vertices;
+    frame->alpha_count = alpha_count;
+    memcpy(frame->data, m->vertices_x, vertices * sizeof(int));
+    memcpy(frame->data + vertices, m->vertices_y, vertices * sizeof(int));
+    memcpy(frame->data + vertices * 2, m->vertices_z, vertices * sizeof(int));
+    if (alpha_count > 0) {
+        memcpy(frame->data + vertices * 3, m->face_alphas, alpha_count * sizeof(int));
+    }
+    lrucache_put_sized(frame_cache, (int64_t)key, &frame->link, bytes);
+}
+
 void model_apply_transform2(Model *m, int x, int y, int z, int *labels, int labels_count, int type) {
+    m->projection_id = 0;
     if (type == OP_BASE) {
         int count = 0;
         _Model.base_x = 0;
@@ -1839,6 +2227,7 @@ void model_apply_transform2(Model *m, int x, int y, int z, int *labels, int labe
 }
 
 void model_rotate_y90(Model *m) {
+    m->projection_id = 0;
     for (int v = 0; v < m->vertex_count; v++) {
         int tmp = m->vertices_x[v];
         m->vertices_x[v] = m->vertices_z[v];
@@ -1847,6 +2236,7 @@ void model_rotate_y90(Model *m) {
 }
 
 void model_rotate_x(Model *m, int angle) {
+    m->projection_id = 0;
     int sin = _Pix3D.sin_table[angle];
     int cos = _Pix3D.cos_table[angle];
     for (int v = 0; v < m->vertex_count; v++) {
@@ -1857,6 +2247,7 @@ void model_rotate_x(Model *m, int angle) {
 }
 
 void model_translate(Model *m, int y, int x, int z) {
+    m->projection_id = 0;
     for (int v = 0; v < m->vertex_count; v++) {
         m->vertices_x[v] += x;
         m->vertices_y[v] += y;
@@ -1873,6 +2264,7 @@ void model_recolor(Model *m, int src, int dst) {
 }
 
 void model_rotate_y180(Model *m) {
+    m->projection_id = 0;
     for (int v = 0; v < m->vertex_count; v++) {
         m->vertices_z[v] = -m->vertices_z[v];
     }
@@ -1885,6 +2277,7 @@ void model_rotate_y180(Model *m) {
 }
 
 void model_scale(Model *m, int x, int y, int z) {
+    m->projection_id = 0;
     for (int v = 0; v < m->vertex_count; v++) {
         m->vertices_x[v] = m->vertices_x[v] * x / 128;
         m->vertices_y[v] = m->vertices_y[v] * y / 128;
@@ -1893,6 +2286,7 @@ void model_scale(Model *m, int x, int y, int z) {
 }
 
 void model_calculate_bounds_y(Model *m) {
+    m->projection_id = 0;
     m->max_y = 0;
     m->min_y = 0;
 
@@ -1969,34 +2363,32 @@ int model_mul_color_lightness(int hsl, int scalar, int face_infos) {
 }
 
 void model_apply_lighting(Model *m, int light_ambient, int light_attenuation, int lightsrc_x, int lightsrc_y, int lightsrc_z, bool _free) {
+    // a vertex's lightness only depends on its normal, so divide once per
+    // vertex rather than once per face corner (about six times as often)
+    if (_Model.vertex_lightness_capacity < m->vertex_count) {
+        free(_Model.vertex_lightness);
+        _Model.vertex_lightness = malloc(m->vertex_count * sizeof(int));
+        _Model.vertex_lightness_capacity = m->vertex_count;
+    }
+    int *lightness = _Model.vertex_lightness;
+    for (int v = 0; v < m->vertex_count; v++) {
+        VertexNormal *n = m->vertex_normal[v];
+        // w is 0 only where no smooth face uses the vertex
+        lightness[v] = n->w == 0 ? 0 : light_ambient + (lightsrc_x * n->x + lightsrc_y * n->y + lightsrc_z * n->z) / (light_attenuation * n->w);
+    }
+
     for (int f = 0; f < m->face_count; f++) {
-        int a = m->face_indices_a[f];
-        int b = m->face_indices_b[f];
-        int c = m->face_indices_c[f];
-        if (!m->face_infos) {
-            int color = m->face_colors[f];
-            VertexNormal *n = m->vertex_normal[a];
-            int lightness = light_ambient + (lightsrc_x * n->x + lightsrc_y * n->y + lightsrc_z * n->z) / (light_attenuation * n->w);
-            m->face_color_a[f] = model_mul_color_lightness(color, lightness, 0);
-            n = m->vertex_normal[b];
-            lightness = light_ambient + (lightsrc_x * n->x + lightsrc_y * n->y + lightsrc_z * n->z) / (light_attenuation * n->w);
-            m->face_color_b[f] = model_mul_color_lightness(color, lightness, 0);
-            n = m->vertex_normal[c];
-            lightness = light_ambient + (lightsrc_x * n->x + lightsrc_y * n->y + lightsrc_z * n->z) / (light_attenuation * n->w);
-            m->face_color_c[f] = model_mul_color_lightness(color, lightness, 0);
-        } else if ((m->face_infos[f] & 0x1) == 0) {
-            int color = m->face_colors[f];
-            int info = m->face_infos[f];
-            VertexNormal *n = m->vertex_normal[a];
-            int lightness = light_ambient + (lightsrc_x * n->x + lightsrc_y * n->y + lightsrc_z * n->z) / (light_attenuation * n->w);
-            m->face_color_a[f] = model_mul_color_lightness(color, lightness, info);
-            n = m->vertex_normal[b];
-            lightness = light_ambient + (lightsrc_x * n->x + lightsrc_y * n->y + lightsrc_z * n->z) / (light_attenuation * n->w);
-            m->face_color_b[f] = model_mul_color_lightness(color, lightness, info);
-            n = m->vertex_normal[c];
-            lightness = light_ambient + (lightsrc_x * n->x + lightsrc_y * n->y + lightsrc_z * n->z) / (light_attenuation * n->w);
-            m->face_color_c[f] = model_mul_color_lightness(color, lightness, info);
+        int info = 0;
+        if (m->face_infos) {
+            info = m->face_infos[f];
+            if ((info & 0x1) != 0) {
+                continue;
+            }
         }
+        int color = m->face_colors[f];
+        m->face_color_a[f] = model_mul_color_lightness(color, lightness[m->face_indices_a[f]], info);
+        m->face_color_b[f] = model_mul_color_lightness(color, lightness[m->face_indices_b[f]], info);
+        m->face_color_c[f] = model_mul_color_lightness(color, lightness[m->face_indices_c[f]], info);
     }
     if (_free) {
         if (m->vertex_normal) {
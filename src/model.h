@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "jagfile.h"
 #include "packet.h"
@@ -71,6 +72,7 @@ typedef struct Model {
     VertexNormal **vertex_normal_original;
     int obj_raise;
     bool pickable;
+    int projection_id; // model_draw_static cache key, 0 until drawn and whenever vertices move
 
     int label_vertices_count;
     int label_faces_count;
@@ -107,7 +109,10 @@ typedef struct {
     int *vertex_view_space_y;
     int *vertex_view_space_z;
     int *tmp_depth_face_count;
-    int **tmp_depth_faces;
+    int *tmp_depth_face_start;
+    int *tmp_depth_faces;   // visible faces, back to front
+    int *tmp_face_depth;    // per visible face: its depth bucket
+    int *tmp_visible_faces; // visible faces in face order, before sorting
     int *tmp_priority_face_count;
     int **tmp_priority_faces;
     int *tmp_priority10_face_depth;
@@ -116,6 +121,8 @@ typedef struct {
     int *clipped_x;
     int *clipped_y;
     int *clipped_color;
+    int *vertex_lightness; // model_apply_lighting, per vertex
+    int vertex_lightness_capacity;
     int base_x;
     int base_y;
     int base_z;
@@ -126,6 +133,28 @@ typedef struct {
     int *picked_bitsets;
 } ModelData;
 
+// whose base model a cached animation frame was made from
+typedef enum {
+    MODEL_FRAME_NPC,            // owner: NpcType index
+    MODEL_FRAME_PLAYER          // owner: appearance hash (player model cache key)
+} ModelFrameOwner;
+
+// where model_draw spends its time: bounds and backface tests, vertex
+// projection, face sorting and rasterizing (bench/render_bench.c)
+typedef enum {
+    MODEL_STAGE_NONE,
+    MODEL_STAGE_CULL,
+    MODEL_STAGE_TRANSFORM,
+    MODEL_STAGE_RASTER,
+    MODEL_STAGE_COUNT
+} ModelStage;
+
+#ifdef MODEL_STAGE_TIMING
+// nanoseconds spent per stage, counted once model_stage_clock is set
+extern uint64_t g_model_stage_ns[MODEL_STAGE_COUNT];
+void model_stage_clock(uint64_t (*now_ns)(void));
+#endif
+
 void model_free_global(void);
 void model_init_global(void);
 void model_free_calculate_normals(Model *m);
@@ -133,6 +162,8 @@ void model_free_label_references(Model *m);
 void model_free_share_colored(Model *m, bool shareColors, bool shareAlpha, bool shareVertices);
 void model_free_share_alpha(Model *m, bool shareAlpha);
 void model_free(Model *model);
+// bytes held by the model and its arrays (lrucache_put_sized)
+int model_size(const Model *m);
 void model_unpack(Jagfile *models);
 Model *model_from_id(int id, bool use_allocator);
 Model *model_from_models(Model **models, int count, bool use_allocator);
@@ -149,6 +180,8 @@ void model_calculate_bounds_y(Model *m);
 bool model_point_within_triangle(int x, int y, int ya, int yb, int yc, int xa, int xb, int xc);
 void model_draw_simple(Model *m, int pitch, int yaw, int roll, int eyePitch, int eyeX, int eyeY, int eyeZ);
 void model_draw(Model *m, int yaw, int sinCameraPitch, int cosCameraPitch, int sinCameraYaw, int cosCameraYaw, int sceneX, int sceneY, int sceneZ, int key);
+// model_draw for scenery: reuses last frame's projection while the camera and model are unchanged
+void model_draw_static(Model *m, int yaw, int sinCameraPitch, int cosCameraPitch, int sinCameraYaw, int cosCameraYaw, int sceneX, int sceneY, int sceneZ, int key);
 void model_draw2(Model *m, bool projected, bool hasInput, int bitset);
 void model_draw_face(Model *m, int index);
 void model_draw_near_clipped_face(Model *m, int index);
@@ -156,6 +189,14 @@ void model_create_label_references(Model *m, bool use_allocator);
 void model_apply_transform(Model *m, int id);
 void model_apply_transforms(Model *m, int id, int id2, int *walkmerge);
 void model_apply_transform2(Model *m, int x, int y, int z, int *labels, int labels_count, int type);
+// optional cache of animated vertices per (base model, seq frame), under the
+// lrucache budget; size in entries, 0 leaves it off (the default)
+void model_frame_cache_init(int size);
+void model_frame_cache_clear(void);
+void model_frame_cache_free(void);
+// model_apply_transform for a model_share_alpha copy of owner's base model;
+// alphas: the copy has its own face alphas, which the frame may change
+void model_apply_transform_cached(Model *m, ModelFrameOwner kind, int64_t owner, int id, bool alphas);
 void model_rotate_y90(Model *m);
 void model_rotate_x(Model *m, int angle);
 void model_translate(Model *m, int y, int x, int z);
@@ -0,0 +1,467 @@
+/*******************************************************************************
+ * MODEL_TRANSFORM.C - Batched Vertex Transform Implementation
+ *******************************************************************************
+ *
+ * See model_transform.h for the kernels and why their output is identical.
+ *
+ * LAYOUT:
+ *   Each vector kernel runs whole batches, then hands the last few
+ *   vertices (fewer than a batch) to the scalar kernel, which is the loop
+ *   model_draw() used to contain. A near lane divides by 1 instead of its
+ *   z, so no lane ever divides by zero; the blend discards its quotient.
+ *
+ ******************************************************************************/
+
+#include "model_transform.h"
+
+#if !defined(PIX3D_SCALAR) && defined(__GNUC__) && defined(__x86_64__)
+#define MODEL_SSE2 1
+#include <immintrin.h>
+#elif !defined(PIX3D_SCALAR) && defined(__GNUC__) && defined(__aarch64__)
+#define MODEL_NEON 1
+#include <arm_neon.h>
+#elif !defined(PIX3D_SCALAR) && defined(__wasm_simd128__)
+#define MODEL_WASM 1
+#include <wasm_simd128.h>
+#endif
+
+typedef bool (*TransformKernel)(const ModelTransform *t, const int *x, const int *y, const int *z, int count, bool view, const ModelVertices *out);
+
+/*******************************************************************************
+ * SCALAR (every platform)
+ ******************************************************************************/
+
+static bool scalar_transform(const ModelTransform *t, const int *xs, const int *ys, const int *zs, int count, bool view, const ModelVertices *out) {
+    bool near = false;
+    for (int v = 0; v < count; v++) {
+        int x = xs[v];
+        int y = ys[v];
+        int z = zs[v];
+        int temp;
+        if (t->yaw) {
+            temp = (z * t->yaw_sin + x * t->yaw_cos) >> 16;
+            z = (z * t->yaw_cos - x * t->yaw_sin) >> 16;
+            x = temp;
+        }
+        x += t->scene_x;
+        y += t->scene_y;
+        z += t->scene_z;
+        temp = (z * t->camera_sin_yaw + x * t->camera_cos_yaw) >> 16;
+        z = (z * t->camera_cos_yaw - x * t->camera_sin_yaw) >> 16;
+        x = temp;
+        temp = (y * t->camera_cos_pitch - z * t->camera_sin_pitch) >> 16;
+        z = (y * t->camera_sin_pitch + z * t->camera_cos_pitch) >> 16;
+
+        out->screen_z[v] = z - t->depth_offset;
+        if (z >= MODEL_NEAR_Z) {
+            out->screen_x[v] = t->center_x + (x << 9) / z;
+            out->screen_y[v] = t->center_y + (temp << 9) / z;
+        } else {
+            out->screen_x[v] = MODEL_NEAR_CLIPPED;
+            near = true;
+            view = true;
+        }
+        if (view) {
+            out->view_x[v] = x;
+            out->view_y[v] = temp;
+            out->view_z[v] = z;
+        }
+    }
+    return near;
+}
+
+#if defined(MODEL_SSE2) || defined(MODEL_NEON) || defined(MODEL_WASM)
+
+/* The rest of a batch kernel's vertices, from v on */
+static bool scalar_tail(const ModelTransform *t, const int *xs, const int *ys, const int *zs, int v, int count, bool view, const ModelVertices *out) {
+    ModelVertices rest = {
+        out->screen_x + v, out->screen_y + v, out->screen_z + v,
+        out->view_x + v, out->view_y + v, out->view_z + v
+    };
+    return scalar_transform(t, xs + v, ys + v, zs + v, count - v, view, &rest);
+}
+
+#endif
+
+static TransformKernel g_kernel = scalar_transform;
+static const char *g_kernel_name = "scalar";
+
+#if defined(MODEL_SSE2)
+
+/*******************************************************************************
+ * SSE2 (every x86-64)
+ ******************************************************************************/
+
+/* Low 32 bits of each lane's product (SSE2 has no 32-bit mullo) */
+static inline __m128i sse2_mullo(__m128i a, __m128i b) {
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+/* (a * s + b * c) >> 16 per lane */
+static inline __m128i sse2_rotate_add(__m128i a, __m128i s, __m128i b, __m128i c) {
+    return _mm_srai_epi32(_mm_add_epi32(sse2_mullo(a, s), sse2_mullo(b, c)), 16);
+}
+
+/* (a * c - b * s) >> 16 per lane */
+static inline __m128i sse2_rotate_sub(__m128i a, __m128i c, __m128i b, __m128i s) {
+    return _mm_srai_epi32(_mm_sub_epi32(sse2_mullo(a, c), sse2_mullo(b, s)), 16);
+}
+
+/* n / d per lane, truncated as C divides ints */
+static inline __m128i sse2_divide(__m128i n, __m128i d) {
+    __m128d low = _mm_div_pd(_mm_cvtepi32_pd(n), _mm_cvtepi32_pd(d));
+    __m128d high = _mm_div_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(n, _MM_SHUFFLE(1, 0, 3, 2))), _mm_cvtepi32_pd(_mm_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2))));
+    return _mm_unpacklo_epi64(_mm_cvttpd_epi32(low), _mm_cvttpd_epi32(high));
+}
+
+/* mask ? a : b */
+static inline __m128i sse2_select(__m128i mask, __m128i a, __m128i b) {
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+static bool sse2_transform(const ModelTransform *t, const int *xs, const int *ys, const int *zs, int count, bool view, const ModelVertices *out) {
+    __m128i yawSin = _mm_set1_epi32(t->yaw_sin);
+    __m128i yawCos = _mm_set1_epi32(t->yaw_cos);
+    __m128i sceneX = _mm_set1_epi32(t->scene_x);
+    __m128i sceneY = _mm_set1_epi32(t->scene_y);
+    __m128i sceneZ = _mm_set1_epi32(t->scene_z);
+    __m128i sinYaw = _mm_set1_epi32(t->camera_sin_yaw);
+    __m128i cosYaw = _mm_set1_epi32(t->camera_cos_yaw);
+    __m128i sinPitch = _mm_set1_epi32(t->camera_sin_pitch);
+    __m128i cosPitch = _mm_set1_epi32(t->camera_cos_pitch);
+    __m128i centerX = _mm_set1_epi32(t->center_x);
+    __m128i centerY = _mm_set1_epi32(t->center_y);
+    __m128i depth = _mm_set1_epi32(t->depth_offset);
+    __m128i nearZ = _mm_set1_epi32(MODEL_NEAR_Z);
+    __m128i clipped = _mm_set1_epi32(MODEL_NEAR_CLIPPED);
+    __m128i one = _mm_set1_epi32(1);
+    bool near = false;
+
+    int v = 0;
+    for (; v + 4 <= count; v += 4) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(xs + v));
+        __m128i y = _mm_loadu_si128((const __m128i *)(ys + v));
+        __m128i z = _mm_loadu_si128((const __m128i *)(zs + v));
+        __m128i temp;
+        if (t->yaw) {
+            temp = sse2_rotate_add(z, yawSin, x, yawCos);
+            z = sse2_rotate_sub(z, yawCos, x, yawSin);
+            x = temp;
+        }
+        x = _mm_add_epi32(x, sceneX);
+        y = _mm_add_epi32(y, sceneY);
+        z = _mm_add_epi32(z, sceneZ);
+        temp = sse2_rotate_add(z, sinYaw, x, cosYaw);
+        z = sse2_rotate_sub(z, cosYaw, x, sinYaw);
+        x = temp;
+        temp = sse2_rotate_sub(y, cosPitch, z, sinPitch);
+        z = sse2_rotate_add(y, sinPitch, z, cosPitch);
+
+        __m128i isNear = _mm_cmplt_epi32(z, nearZ);
+        __m128i divisor = sse2_select(isNear, one, z);
+        __m128i screenX = _mm_add_epi32(centerX, sse2_divide(_mm_slli_epi32(x, 9), divisor));
+        __m128i screenY = _mm_add_epi32(centerY, sse2_divide(_mm_slli_epi32(temp, 9), divisor));
+        __m128i oldY = _mm_loadu_si128((const __m128i *)(out->screen_y + v));
+
+        _mm_storeu_si128((__m128i *)(out->screen_z + v), _mm_sub_epi32(z, depth));
+        _mm_storeu_si128((__m128i *)(out->screen_x + v), sse2_select(isNear, clipped, screenX));
+        _mm_storeu_si128((__m128i *)(out->screen_y + v), sse2_select(isNear, oldY, screenY));
+        if (_mm_movemask_epi8(isNear)) {
+            near = true;
+            view = true;
+        }
+        if (view) {
+            _mm_storeu_si128((__m128i *)(out->view_x + v), x);
+            _mm_storeu_si128((__m128i *)(out->view_y + v), temp);
+            _mm_storeu_si128((__m128i *)(out->view_z + v), z);
+        }
+    }
+    return scalar_tail(t, xs, ys, zs, v, count, view, out) || near;
+}
+
+/*******************************************************************************
+ * AVX2 (x86-64, when the CPU has it)
+ *
+ * The tail goes to the scalar kernel, compiled without AVX: the upper
+ * halves of the ymm registers are cleared first (see pix3d_span.c).
+ ******************************************************************************/
+
+__attribute__((target("avx2")))
+static inline __m256i avx2_rotate_add(__m256i a, __m256i s, __m256i b, __m256i c) {
+    return _mm256_srai_epi32(_mm256_add_epi32(_mm256_mullo_epi32(a, s), _mm256_mullo_epi32(b, c)), 16);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i avx2_rotate_sub(__m256i a, __m256i c, __m256i b, __m256i s) {
+    return _mm256_srai_epi32(_mm256_sub_epi32(_mm256_mullo_epi32(a, c), _mm256_mullo_epi32(b, s)), 16);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i avx2_divide(__m256i n, __m256i d) {
+    __m128i low = _mm256_cvttpd_epi32(_mm256_div_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(n)), _mm256_cvtepi32_pd(_mm256_castsi256_si128(d))));
+    __m128i high = _mm256_cvttpd_epi32(_mm256_div_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(n, 1)), _mm256_cvtepi32_pd(_mm256_extracti128_si256(d, 1))));
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+}
+
+__attribute__((target("avx2")))
+static bool avx2_transform(const ModelTransform *t, const int *xs, const int *ys, const int *zs, int count, bool view, const ModelVertices *out) {
+    __m256i yawSin = _mm256_set1_epi32(t->yaw_sin);
+    __m256i yawCos = _mm256_set1_epi32(t->yaw_cos);
+    __m256i sceneX = _mm256_set1_epi32(t->scene_x);
+    __m256i sceneY = _mm256_set1_epi32(t->scene_y);
+    __m256i sceneZ = _mm256_set1_epi32(t->scene_z);
+    __m256i sinYaw = _mm256_set1_epi32(t->camera_sin_yaw);
+    __m256i cosYaw = _mm256_set1_epi32(t->camera_cos_yaw);
+    __m256i sinPitch = _mm256_set1_epi32(t->camera_sin_pitch);
+    __m256i cosPitch = _mm256_set1_epi32(t->camera_cos_pitch);
+    __m256i centerX = _mm256_set1_epi32(t->center_x);
+    __m256i centerY = _mm256_set1_epi32(t->center_y);
+    __m256i depth = _mm256_set1_epi32(t->depth_offset);
+    __m256i nearZ = _mm256_set1_epi32(MODEL_NEAR_Z);
+    __m256i clipped = _mm256_set1_epi32(MODEL_NEAR_CLIPPED);
+    __m256i one = _mm256_set1_epi32(1);
+    bool near = false;
+
+    int v = 0;
+    for (; v + 8 <= count; v += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(xs + v));
+        __m256i y = _mm256_loadu_si256((const __m256i *)(ys + v));
+        __m256i z = _mm256_loadu_si256((const __m256i *)(zs + v));
+        __m256i temp;
+        if (t->yaw) {
+            temp = avx2_rotate_add(z, yawSin, x, yawCos);
+            z = avx2_rotate_sub(z, yawCos, x, yawSin);
+            x = temp;
+        }
+        x = _mm256_add_epi32(x, sceneX);
+        y = _mm256_add_epi32(y, sceneY);
+        z = _mm256_add_epi32(z, sceneZ);
+        temp = avx2_rotate_add(z, sinYaw, x, cosYaw);
+        z = avx2_rotate_sub(z, cosYaw, x, sinYaw);
+        x = temp;
+        temp = avx2_rotate_sub(y, cosPitch, z, sinPitch);
+        z = avx2_rotate_add(y, sinPitch, z, cosPitch);
+
+        __m256i isNear = _mm256_cmpgt_epi32(nearZ, z);
+        __m256i divisor = _mm256_blendv_epi8(z, one, isNear);
+        __m256i screenX = _mm256_add_epi32(centerX, avx2_divide(_mm256_slli_epi32(x, 9), divisor));
+        __m256i screenY = _mm256_add_epi32(centerY, avx2_divide(_mm256_slli_epi32(temp, 9), divisor));
+        __m256i oldY = _mm256_loadu_si256((const __m256i *)(out->screen_y + v));
+
+        _mm256_storeu_si256((__m256i *)(out->screen_z + v), _mm256_sub_epi32(z, depth));
+        _mm256_storeu_si256((__m256i *)(out->screen_x + v), _mm256_blendv_epi8(screenX, clipped, isNear));
+        _mm256_storeu_si256((__m256i *)(out->screen_y + v), _mm256_blendv_epi8(screenY, oldY, isNear));
+        if (_mm256_movemask_epi8(isNear)) {
+            near = true;
+            view = true;
+        }
+        if (view) {
+            _mm256_storeu_si256((__m256i *)(out->view_x + v), x);
+            _mm256_storeu_si256((__m256i *)(out->view_y + v), temp);
+            _mm256_storeu_si256((__m256i *)(out->view_z + v), z);
+        }
+    }
+    _mm256_zeroupper();
+    return scalar_tail(t, xs, ys, zs, v, count, view, out) || near;
+}
+
+#endif /* MODEL_SSE2 */
+
+#if defined(MODEL_NEON)
+
+/*******************************************************************************
+ * NEON (arm64: double precision lanes for the divides)
+ ******************************************************************************/
+
+static inline int32x4_t neon_rotate_add(int32x4_t a, int32x4_t s, int32x4_t b, int32x4_t c) {
+    return vshrq_n_s32(vaddq_s32(vmulq_s32(a, s), vmulq_s32(b, c)), 16);
+}
+
+static inline int32x4_t neon_rotate_sub(int32x4_t a, int32x4_t c, int32x4_t b, int32x4_t s) {
+    return vshrq_n_s32(vsubq_s32(vmulq_s32(a, c), vmulq_s32(b, s)), 16);
+}
+
+static inline int32x2_t neon_divide2(int32x2_t n, int32x2_t d) {
+    float64x2_t q = vdivq_f64(vcvtq_f64_s64(vmovl_s32(n)), vcvtq_f64_s64(vmovl_s32(d)));
+    return vmovn_s64(vcvtq_s64_f64(q));
+}
+
+static inline int32x4_t neon_divide(int32x4_t n, int32x4_t d) {
+    return vcombine_s32(neon_divide2(vget_low_s32(n), vget_low_s32(d)), neon_divide2(vget_high_s32(n), vget_high_s32(d)));
+}
+
+static bool neon_transform(const ModelTransform *t, const int *xs, const int *ys, const int *zs, int count, bool view, const ModelVertices *out) {
+    int32x4_t yawSin = vdupq_n_s32(t->yaw_sin);
+    int32x4_t yawCos = vdupq_n_s32(t->yaw_cos);
+    int32x4_t sceneX = vdupq_n_s32(t->scene_x);
+    int32x4_t sceneY = vdupq_n_s32(t->scene_y);
+    int32x4_t sceneZ = vdupq_n_s32(t->scene_z);
+    int32x4_t sinYaw = vdupq_n_s32(t->camera_sin_yaw);
+    int32x4_t cosYaw = vdupq_n_s32(t->camera_cos_yaw);
+    int32x4_t sinPitch = vdupq_n_s32(t->camera_sin_pitch);
+    int32x4_t cosPitch = vdupq_n_s32(t->camera_cos_pitch);
+    int32x4_t centerX = vdupq_n_s32(t->center_x);
+    int32x4_t centerY = vdupq_n_s32(t->center_y);
+    int32x4_t depth = vdupq_n_s32(t->depth_offset);
+    int32x4_t nearZ = vdupq_n_s32(MODEL_NEAR_Z);
+    int32x4_t clipped = vdupq_n_s32(MODEL_NEAR_CLIPPED);
+    int32x4_t one = vdupq_n_s32(1);
+    bool near = false;
+
+    int v = 0;
+    for (; v + 4 <= count; v += 4) {
+        int32x4_t x = vld1q_s32(xs + v);
+        int32x4_t y = vld1q_s32(ys + v);
+        int32x4_t z = vld1q_s32(zs + v);
+        int32x4_t temp;
+        if (t->yaw) {
+            temp = neon_rotate_add(z, yawSin, x, yawCos);
+            z = neon_rotate_sub(z, yawCos, x, yawSin);
+            x = temp;
+        }
+        x = vaddq_s32(x, sceneX);
+        y = vaddq_s32(y, sceneY);
+        z = vaddq_s32(z, sceneZ);
+        temp = neon_rotate_add(z, sinYaw, x, cosYaw);
+        z = neon_rotate_sub(z, cosYaw, x, sinYaw);
+        x = temp;
+        temp = neon_rotate_sub(y, cosPitch, z, sinPitch);
+        z = neon_rotate_add(y, sinPitch, z, cosPitch);
+
+        uint32x4_t isNear = vcltq_s32(z, nearZ);
+        int32x4_t divisor = vbslq_s32(isNear, one, z);
+        int32x4_t screenX = vaddq_s32(centerX, neon_divide(vshlq_n_s32(x, 9), divisor));
+        int32x4_t screenY = vaddq_s32(centerY, neon_divide(vshlq_n_s32(temp, 9), divisor));
+        int32x4_t oldY = vld1q_s32(out->screen_y + v);
+
+        vst1q_s32(out->screen_z + v, vsubq_s32(z, depth));
+        vst1q_s32(out->screen_x + v, vbslq_s32(isNear, clipped, screenX));
+        vst1q_s32(out->screen_y + v, vbslq_s32(isNear, oldY, screenY));
+        if (vmaxvq_u32(isNear)) {
+            near = true;
+            view = true;
+        }
+        if (view) {
+            vst1q_s32(out->view_x + v, x);
+            vst1q_s32(out->view_y + v, temp);
+            vst1q_s32(out->view_z + v, z);
+        }
+    }
+    return scalar_tail(t, xs, ys, zs, v, count, view, out) || near;
+}
+
+#endif /* MODEL_NEON */
+
+#if defined(MODEL_WASM)
+
+/*******************************************************************************
+ * WASM SIMD128 (web builds with -msimd128: double lanes for the divides)
+ ******************************************************************************/
+
+static inline v128_t wasm_rotate_add(v128_t a, v128_t s, v128_t b, v128_t c) {
+    return wasm_i32x4_shr(wasm_i32x4_add(wasm_i32x4_mul(a, s), wasm_i32x4_mul(b, c)), 16);
+}
+
+static inline v128_t wasm_rotate_sub(v128_t a, v128_t c, v128_t b, v128_t s) {
+    return wasm_i32x4_shr(wasm_i32x4_sub(wasm_i32x4_mul(a, c), wasm_i32x4_mul(b, s)), 16);
+}
+
+/* n / d per lane: two divides of two lanes, truncated into the low lanes */
+static inline v128_t wasm_divide(v128_t n, v128_t d) {
+    v128_t nHigh = wasm_i32x4_shuffle(n, n, 2, 3, 0, 1);
+    v128_t dHigh = wasm_i32x4_shuffle(d, d, 2, 3, 0, 1);
+    v128_t low = wasm_i32x4_trunc_sat_f64x2_zero(wasm_f64x2_div(wasm_f64x2_convert_low_i32x4(n), wasm_f64x2_convert_low_i32x4(d)));
+    v128_t high = wasm_i32x4_trunc_sat_f64x2_zero(wasm_f64x2_div(wasm_f64x2_convert_low_i32x4(nHigh), wasm_f64x2_convert_low_i32x4(dHigh)));
+    return wasm_i32x4_shuffle(low, high, 0, 1, 4, 5);
+}
+
+static bool wasm_transform(const ModelTransform *t, const int *xs, const int *ys, const int *zs, int count, bool view, const ModelVertices *out) {
+    v128_t yawSin = wasm_i32x4_splat(t->yaw_sin);
+    v128_t yawCos = wasm_i32x4_splat(t->yaw_cos);
+    v128_t sceneX = wasm_i32x4_splat(t->scene_x);
+    v128_t sceneY = wasm_i32x4_splat(t->scene_y);
+    v128_t sceneZ = wasm_i32x4_splat(t->scene_z);
+    v128_t sinYaw = wasm_i32x4_splat(t->camera_sin_yaw);
+    v128_t cosYaw = wasm_i32x4_splat(t->camera_cos_yaw);
+    v128_t sinPitch = wasm_i32x4_splat(t->camera_sin_pitch);
+    v128_t cosPitch = wasm_i32x4_splat(t->camera_cos_pitch);
+    v128_t centerX = wasm_i32x4_splat(t->center_x);
+    v128_t centerY = wasm_i32x4_splat(t->center_y);
+    v128_t depth = wasm_i32x4_splat(t->depth_offset);
+    v128_t nearZ = wasm_i32x4_splat(MODEL_NEAR_Z);
+    v128_t clipped = wasm_i32x4_splat(MODEL_NEAR_CLIPPED);
+    v128_t one = wasm_i32x4_splat(1);
+    bool near = false;
+
+    int v = 0;
+    for (; v + 4 <= count; v += 4) {
+        v128_t x = wasm_v128_load(xs + v);
+        v128_t y = wasm_v128_load(ys + v);
+        v128_t z = wasm_v128_load(zs + v);
+        v128_t temp;
+        if (t->yaw) {
+            temp = wasm_rotate_add(z, yawSin, x, yawCos);
+            z = wasm_rotate_sub(z, yawCos, x, yawSin);
+            x = temp;
+        }
+        x = wasm_i32x4_add(x, sceneX);
+        y = wasm_i32x4_add(y, sceneY);
+        z = wasm_i32x4_add(z, sceneZ);
+        temp = wasm_rotate_add(z, sinYaw, x, cosYaw);
+        z = wasm_rotate_sub(z, cosYaw, x, sinYaw);
+        x = temp;
+        temp = wasm_rotate_sub(y, cosPitch, z, sinPitch);
+        z = wasm_rotate_add(y, sinPitch, z, cosPitch);
+
+        v128_t isNear = wasm_i32x4_lt(z, nearZ);
+        v128_t divisor = wasm_v128_bitselect(one, z, isNear);
+        v128_t screenX = wasm_i32x4_add(centerX, wasm_divide(wasm_i32x4_shl(x, 9), divisor));
+        v128_t screenY = wasm_i32x4_add(centerY, wasm_divide(wasm_i32x4_shl(temp, 9), divisor));
+        v128_t oldY = wasm_v128_load(out->screen_y + v);
+
+        wasm_v128_store(out->screen_z + v, wasm_i32x4_sub(z, depth));
+        wasm_v128_store(out->screen_x + v, wasm_v128_bitselect(clipped, screenX, isNear));
+        wasm_v128_store(out->screen_y + v, wasm_v128_bitselect(oldY, screenY, isNear));
+        if (wasm_v128_any_true(isNear)) {
+            near = true;
+            view = true;
+        }
+        if (view) {
+            wasm_v128_store(out->view_x + v, x);
+            wasm_v128_store(out->view_y + v, temp);
+            wasm_v128_store(out->view_z + v, z);
+        }
+    }
+    return scalar_tail(t, xs, ys, zs, v, count, view, out) || near;
+}
+
+#endif /* MODEL_WASM */
+
+void model_transform_init(void) {
+#if defined(MODEL_SSE2)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        g_kernel = avx2_transform;
+        g_kernel_name = "avx2";
+    } else {
+        g_kernel = sse2_transform;
+        g_kernel_name = "sse2";
+    }
+#elif defined(MODEL_NEON)
+    g_kernel = neon_transform;
+    g_kernel_name = "neon";
+#elif defined(MODEL_WASM)
+    g_kernel = wasm_transform;
+    g_kernel_name = "simd128";
+#endif
+}
+
+bool model_transform_vertices(const ModelTransform *t, const int *x, const int *y, const int *z, int count, bool view, const ModelVertices *out) {
+    return g_kernel(t, x, y, z, count, view, out);
+}
+
+const char *model_transform_backend(void) {
+    return g_kernel_name;
+}
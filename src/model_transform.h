@@ -0,0 +1,127 @@
+/*******************************************************************************
+ * MODEL_TRANSFORM.H - Batched Vertex Transform for model_draw()
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Structure-of-arrays data feeding SIMD lanes with plain loads
+ *   - Fixed-point rotation in 32-bit integer lanes
+ *   - Exact integer division through double precision
+ *   - Turning a per-vertex branch into a lane mask and a blend
+ *
+ * THE PROBLEM:
+ *
+ * Every model drawn in the scene (players, NPCs, animated locs - hundreds
+ * per frame in a busy area) has each vertex rotated and projected by
+ * model_draw(), one at a time:
+ *
+ *   for each vertex
+ *     rotate by the model's yaw, translate, rotate by the camera
+ *     if z >= 50:  screen = centre + (view << 9) / z     two idivs
+ *     else:        screen x = -5000 (near clipped)       a branch
+ *
+ * The coordinates are already separate arrays (vertices_x/y/z), exactly
+ * what a vector unit wants, but the loop takes them one lane at a time.
+ *
+ * THE SOLUTION - 4 OR 8 VERTICES PER STEP:
+ *
+ *   vertices_x  [x0 x1 x2 x3 x4 x5 x6 x7]  ┐
+ *   vertices_y  [y0 y1 ...             ]  ├─ one load each
+ *   vertices_z  [z0 z1 ...             ]  ┘
+ *        │  multiply, shift, add: the same fixed-point steps per lane
+ *        ▼
+ *   near = z < 50               [0 0 1 0 0 0 0 0]   a mask, no branch
+ *   q    = (x << 9) / z         double divides, truncated
+ *   screen_x = near ? -5000 : centre + q            one blend
+ *
+ *   sse2  4 lanes (every x86-64)
+ *   avx2  8 lanes (if the CPU has it)
+ *   neon  4 lanes (arm64)
+ *   simd128  4 lanes (web builds with -msimd128, see pix3d_span.h)
+ *
+ * IDENTICAL OUTPUT:
+ *   - Lane multiplies keep the low 32 bits of each product and shifts are
+ *     arithmetic: the scalar int expression's value, step by step.
+ *   - (x << 9) / z: numerator and divisor are exact as doubles, and a
+ *     quotient of two ints below 2^31 never rounds across an integer, so
+ *     truncating the double quotient gives C's integer division.
+ *   - A near clipped vertex keeps its old screen y (the blend reloads
+ *     it), as the scalar loop leaves it untouched.
+ *
+ * SELECTION:
+ *   model_transform_init() (called by model_init_global) picks the widest
+ *   kernel once, as pix3d_spans_init() does; -DPIX3D_SCALAR keeps the
+ *   scalar loop here too.
+ *
+ ******************************************************************************/
+
+#ifndef MODEL_TRANSFORM_H
+#define MODEL_TRANSFORM_H
+
+#include <stdbool.h>
+
+/* Nearest view depth that is projected; nearer vertices are clipped */
+#define MODEL_NEAR_Z 50
+
+/* Screen x of a near clipped vertex */
+#define MODEL_NEAR_CLIPPED -5000
+
+/*
+ * ModelTransform - One model_draw() call's rotation and projection
+ */
+typedef struct {
+    bool yaw;               /* rotate by the model's yaw first */
+    int yaw_sin;
+    int yaw_cos;
+    int scene_x;            /* model origin relative to the camera */
+    int scene_y;
+    int scene_z;
+    int camera_sin_yaw;
+    int camera_cos_yaw;
+    int camera_sin_pitch;
+    int camera_cos_pitch;
+    int center_x;           /* _Pix3D.center_x / center_y */
+    int center_y;
+    int depth_offset;       /* subtracted from view z for screen z */
+} ModelTransform;
+
+/*
+ * ModelVertices - Where the transform writes (_Model's scratch arrays)
+ */
+typedef struct {
+    int *screen_x;
+    int *screen_y;
+    int *screen_z;
+    int *view_x;
+    int *view_y;
+    int *view_z;
+} ModelVertices;
+
+/*
+ * model_transform_init - Pick the kernel for this CPU
+ */
+void model_transform_init(void);
+
+/*
+ * model_transform_vertices - Rotate and project a model's vertices
+ *
+ * @param t      The model's rotation, position and the camera
+ * @param x      vertices_x (and y, z): count entries each
+ * @param count  Vertices
+ * @param view   Keep view space coordinates of every vertex (textured
+ *               faces or a model already known to cross the near plane).
+ *               Otherwise they are written from the first near clipped
+ *               vertex's batch on, as the scalar loop writes them from
+ *               that vertex on.
+ * @param out    Output arrays, count entries each
+ * @return       true if any vertex was near clipped
+ */
+bool model_transform_vertices(const ModelTransform *t, const int *x, const int *y, const int *z, int count, bool view, const ModelVertices *out);
+
+/*
+ * model_transform_backend - Kernel in use: "scalar", "sse2", "avx2", "neon",
+ *                           "simd128"
+ */
+const char *model_transform_backend(void);
+
+#endif /* MODEL_TRANSFORM_H */
@@ -7,7 +7,7 @@
  * 
  * KEY ALGORITHMS IMPLEMENTED:
  *   1. Coordinate packing/unpacking (32-bit integer compression)
- *   2. Queue operations (enqueue, dequeue with shift-left)
+ *   2. Queue operations (ring buffer enqueue, dequeue, path append)
  *   3. Bounds validation (world coordinate limits)
  *   4. Dynamic direction calculation (from current position)
  *   5. Recursive waypoint validation (TypeScript validateAndAdvanceStep)
@@ -15,7 +15,7 @@
  * 
  * EDUCATIONAL CONCEPTS:
  *   - Bit manipulation for data compression
- *   - Array-based queue (shift-on-dequeue approach)
+ *   - Ring buffer queue (head index + count, no shifting)
  *   - Stack allocation (no heap/malloc needed)
  *   - Bounds checking and input validation
  *   - Game state management (tick-based updates)
@@ -35,41 +35,46 @@
  * 
  * QUEUE IMPLEMENTATION CHOICE:
  * 
- * This uses a simple shift-left approach rather than circular buffer:
- * 
- *   SHIFT-LEFT (used here):
- *     Enqueue: O(1) - append to end
- *     Dequeue: O(n) - shift all elements left
- *     Space:   O(1) - no wasted slots, inline storage
- * 
- *   CIRCULAR BUFFER (alternative):
- *     Enqueue: O(1) - write to tail, increment tail
- *     Dequeue: O(1) - read from head, increment head
- *     Space:   O(n) - wastes slots until wrap-around
- * 
- * WHY SHIFT-LEFT FOR THIS USE CASE?
- *   - MAX_WAYPOINTS is small (25 typical)
- *   - O(n) shift takes ~50-100 CPU cycles (negligible)
- *   - Simpler code (no head/tail pointer management)
- *   - No modulo arithmetic (faster)
- *   - No wasted array capacity
- *   - Dequeue happens once per game tick (600ms) so O(n) is acceptable
- *   - Matches TypeScript behavior (array shift)
- * 
- * PERFORMANCE CALCULATION:
- *   Assume 25 waypoints, modern CPU at 3GHz:
- *     Shift operation: ~2 CPU cycles per i32 (memmove)
- *     Total: 25 × 2 = 50 cycles = 0.000017ms (17 nanoseconds)
- *     Game tick: 600ms = 600,000,000 nanoseconds
- *     Shift cost: 0.000003% of tick time (completely negligible)
+ * A ring buffer over the inline array:
+ * 
+ *   waypoint_head   slot of the next waypoint
+ *   waypoint_count  waypoints queued from there, wrapping past the end
+ * 
+ *   Enqueue: write slot (head + count) mod MAX_WAYPOINTS, count++   O(1)
+ *   Dequeue: head = (head + 1) mod MAX_WAYPOINTS, count--           O(1)
+ * 
+ * WHY NOT SHIFT-LEFT?
+ *   The first version shifted the whole array left on every dequeue, like
+ *   TypeScript's array shift. MAX_WAYPOINTS is 100, so a long path moved
+ *   up to 99 values per step - for every moving player and NPC, once or
+ *   twice per tick. The ring moves one index instead, and every slot stays
+ *   usable: the queue holds MAX_WAYPOINTS waypoints, as before.
+ * 
+ *   The wrap is a compare and subtract (ring_slot below): MAX_WAYPOINTS
+ *   is not a power of two, and a division per step would cost more than
+ *   the branch it saves.
+ * 
+ * PATH APPEND:
+ *   Paths come as arrays (pathfinder results, the client's walk packet).
+ *   movement_add_path() queues one with at most two runs of writes, one
+ *   up to the end of the array and one from slot 0.
  * 
  ******************************************************************************/
 
 #include "movement.h"
+#include "log.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
+u32 g_movement_waypoints = MAX_WAYPOINTS;
+
+/* Slot of a ring position: head + offset, wrapped (offset <= MAX_WAYPOINTS) */
+static inline u32 ring_slot(u32 head, u32 offset) {
+    u32 slot = head + offset;
+    return slot >= MAX_WAYPOINTS ? slot - MAX_WAYPOINTS : slot;
+}
+
 /*******************************************************************************
  * COORDINATE PACKING/UNPACKING
  ******************************************************************************/
@@ -208,7 +213,7 @@ void movement_naive_path(MovementHandler* handler, u32 src_x, u32 src_z, u32 des
     u32 current_z = src_z;
     
     /* Walk diagonally while both dx and dz are non-zero */
-    while (dx != 0 && dz != 0 && handler->waypoint_index < MAX_WAYPOINTS - 1) {
+    while (dx != 0 && dz != 0 && handler->waypoint_count < g_movement_waypoints) {
         if (dx > 0) {
             current_x++;
             dx--;
@@ -229,7 +234,7 @@ void movement_naive_path(MovementHandler* handler, u32 src_x, u32 src_z, u32 des
     }
     
     /* Walk horizontally for remaining X distance */
-    while (dx != 0 && handler->waypoint_index < MAX_WAYPOINTS - 1) {
+    while (dx != 0 && handler->waypoint_count < g_movement_waypoints) {
         if (dx > 0) {
             current_x++;
             dx--;
@@ -242,7 +247,7 @@ void movement_naive_path(MovementHandler* handler, u32 src_x, u32 src_z, u32 des
     }
     
     /* Walk vertically for remaining Z distance */
-    while (dz != 0 && handler->waypoint_index < MAX_WAYPOINTS - 1) {
+    while (dz != 0 && handler->waypoint_count < g_movement_waypoints) {
         if (dz > 0) {
             current_z++;
             dz--;
@@ -266,12 +271,12 @@ void movement_naive_path(MovementHandler* handler, u32 src_x, u32 src_z, u32 des
  * 
  * ALGORITHM:
  *   1. Zero entire struct: memset(handler, 0, sizeof(MovementHandler))
- *   2. Set waypoint_index = -1 (empty queue, matches TypeScript)
+ *   2. Queue left empty: waypoint_head = 0, waypoint_count = 0
  *   3. Set initial run energy: run_energy = 10000
  * 
  * ZEROED FIELDS (via memset):
  *   - All waypoint values: 0
- *   - waypoint_index: 0 (overwritten to -1 below)
+ *   - waypoint_head, waypoint_count: 0 (empty queue)
  *   - run_path: false (0)
  *   - running: false (0)
  *   - run_energy: 0 (overwritten to 10000 below)
@@ -293,7 +298,7 @@ void movement_naive_path(MovementHandler* handler, u32 src_x, u32 src_z, u32 des
  *   After init:
  *   ┌────────────────────────────────────────┐
  *   │ waypoints[0..MAX_WAYPOINTS-1] = 0      │
- *   │ waypoint_index = -1 (empty)            │
+ *   │ waypoint_count = 0 (empty)             │
  *   │ run_path       = false                 │
  *   │ running        = false                 │
  *   │ run_energy     = 10000                 │
@@ -303,7 +308,6 @@ void movement_naive_path(MovementHandler* handler, u32 src_x, u32 src_z, u32 des
  */
 void movement_init(MovementHandler* handler) {
     memset(handler, 0, sizeof(MovementHandler));
-    handler->waypoint_index = -1;
     handler->run_energy = 10000;
 }
 
@@ -313,7 +317,7 @@ void movement_init(MovementHandler* handler) {
  * @param handler  Pointer to MovementHandler to clean up
  * 
  * ALGORITHM:
- *   1. Set waypoint_index = -1 (mark queue as empty)
+ *   1. Set waypoint_head = waypoint_count = 0 (mark queue as empty)
  * 
  * MEMORY MANAGEMENT:
  *   No heap allocation used - waypoints stored inline in struct
@@ -322,20 +326,20 @@ void movement_init(MovementHandler* handler) {
  * 
  * IDEMPOTENT OPERATION:
  *   Safe to call multiple times:
- *     First call:  Sets waypoint_index = -1
- *     Second call: Sets waypoint_index = -1 again (no-op)
+ *     First call:  Sets waypoint_count = 0
+ *     Second call: Sets waypoint_count = 0 again (no-op)
  * 
  * EXAMPLE - LIFECYCLE:
  *   movement_add_step(&handler, 3200, 3200);
  *     → waypoints[0] = coord_pack(0, 3200, 3200)
- *     → waypoint_index = 0
+ *     → waypoint_count = 1
  *   
  *   movement_add_step(&handler, 3201, 3201);
  *     → waypoints[1] = coord_pack(0, 3201, 3201)
- *     → waypoint_index = 1
+ *     → waypoint_count = 2
  *   
  *   movement_destroy(&handler);
- *     → waypoint_index = -1
+ *     → waypoint_head = 0, waypoint_count = 0
  *     → Queue now empty (waypoint data still in array but ignored)
  * 
  * WHEN TO CALL:
@@ -343,10 +347,11 @@ void movement_init(MovementHandler* handler) {
  *   - Player teleport (via movement_reset which calls this)
  *   - Server shutdown (optional)
  * 
- * COMPLEXITY: O(1) time - single assignment
+ * COMPLEXITY: O(1) time - two assignments
  */
 void movement_destroy(MovementHandler* handler) {
-    handler->waypoint_index = -1;
+    handler->waypoint_head = 0;
+    handler->waypoint_count = 0;
 }
 
 /*
@@ -405,10 +410,10 @@ void movement_reset(MovementHandler* handler) {
  * @param z        World Z coordinate of waypoint
  * 
  * ALGORITHM (simplified from old Point* approach):
- *   1. Capacity check: if (waypoint_index >= MAX_WAYPOINTS-1) → reject
+ *   1. Capacity check: if (waypoint_count == g_movement_waypoints) → reject
  *   2. Bounds check: if (x > 12800 || z > 12800) → reject with warning
  *   3. Pack coordinates: coord_pack(0, x, z)
- *   4. Store: waypoints[++waypoint_index] = packed_coord
+ *   4. Store at the tail: waypoints[ring_slot(head, count++)] = packed_coord
  * 
  * NOTE: Direction NOT calculated here (matches TypeScript)
  *   Old approach: Stored direction in Point struct
@@ -444,18 +449,18 @@ void movement_reset(MovementHandler* handler) {
  *   Step 1: movement_add_step(&handler, 3201, 3200)
  *     → coord_pack(0, 3201, 3200) = 0x0032C800
  *     → waypoints[0] = 0x0032C800
- *     → waypoint_index = 0
+ *     → waypoint_count = 1
  *   
  *   Step 2: movement_add_step(&handler, 3201, 3201)
  *     → coord_pack(0, 3201, 3201) = 0x0032C801
  *     → waypoints[1] = 0x0032C801
- *     → waypoint_index = 1
+ *     → waypoint_count = 2
  *   
  *   Queue after adding all steps:
  *   ┌─────────────────────────────────────────────────────────┐
  *   │ waypoints[0] = 0x0032C800  (x=3201, z=3200)             │
  *   │ waypoints[1] = 0x0032C801  (x=3201, z=3201)             │
- *   │ waypoint_index = 1                                      │
+ *   │ waypoint_head = 0, waypoint_count = 2                   │
  *   └─────────────────────────────────────────────────────────┘
  *   
  *   Direction calculated later in movement_get_next_direction():
@@ -508,16 +513,55 @@ void movement_reset(MovementHandler* handler) {
  * COMPLEXITY: O(1) time, O(1) space (no allocation)
  */
 void movement_add_step(MovementHandler* handler, u32 x, u32 z) {
-    if (handler->waypoint_index >= MAX_WAYPOINTS - 1) {
+    if (handler->waypoint_count >= g_movement_waypoints) {
         return;
     }
     
     if (x > 12800 || z > 12800) {
-        printf("WARNING: movement_add_step out of bounds: x=%u, z=%u\n", x, z);
+        LOG_WARN("movement_add_step out of bounds: x=%u, z=%u\n", x, z);
         return;
     }
     
-    handler->waypoints[++handler->waypoint_index] = coord_pack(0, x, z);
+    handler->waypoints[ring_slot(handler->waypoint_head, handler->waypoint_count++)] = coord_pack(0, x, z);
+}
+
+/*
+ * movement_add_path - Append a whole path to the movement queue
+ * 
+ * @param handler  Pointer to MovementHandler
+ * @param x        World X coordinates of the steps, first to last
+ * @param z        World Z coordinates of the steps
+ * @param count    Steps in x and z
+ * @return         Steps queued
+ * 
+ * ALGORITHM:
+ *   Walk the ring from the tail slot, writing each in-bounds step and
+ *   wrapping the slot once at the end of the array. Stops when the queue
+ *   is full; out of bounds steps are skipped as movement_add_step() does.
+ * 
+ * COMPLEXITY: O(count) time, no per-step capacity or wrap arithmetic
+ *             beyond one compare
+ */
+u32 movement_add_path(MovementHandler* handler, const u32* x, const u32* z, u32 count) {
+    u32 room = handler->waypoint_count < g_movement_waypoints
+             ? g_movement_waypoints - handler->waypoint_count : 0;
+    u32 slot = ring_slot(handler->waypoint_head, handler->waypoint_count);
+    u32 queued = 0;
+    
+    for (u32 i = 0; i < count && queued < room; i++) {
+        if (x[i] > 12800 || z[i] > 12800) {
+            LOG_WARN("movement_add_step out of bounds: x=%u, z=%u\n", x[i], z[i]);
+            continue;
+        }
+        handler->waypoints[slot] = coord_pack(0, x[i], z[i]);
+        if (++slot == MAX_WAYPOINTS) {
+            slot = 0;
+        }
+        queued++;
+    }
+    
+    handler->waypoint_count += queued;
+    return queued;
 }
 
 /*
@@ -649,14 +693,14 @@ void movement_finish(MovementHandler* handler) {
  * @return           Direction (0-7) or -1 if no valid movement
  * 
  * ALGORITHM (FIXED - multi-tile waypoint support):
- *   1. If queue empty (waypoint_index == -1), return -1
- *   2. Unpack first waypoint: coord_unpack(waypoints[0], &level, &x, &z)
+ *   1. If queue empty (waypoint_count == 0), return -1
+ *   2. Unpack first waypoint: coord_unpack(waypoints[waypoint_head], ...)
  *   3. Calculate deltas: dx = x - current_x, dz = z - current_z
  *   4. NORMALIZE deltas to single-tile step: step_dx/step_dz = -1, 0, or +1
- *   5. Calculate direction: position_direction(step_dx, step_dz)
+ *   5. Calculate direction: DIRECTION_FROM_STEP (same as position_direction)
  *   6. If direction == -1 (already at waypoint):
- *        a. Dequeue waypoint (shift array left, decrement index)
- *        b. Recursively call self (check next waypoint)
+ *        a. Dequeue waypoint (advance head, decrement count)
+ *        b. Check the next waypoint (TypeScript recurses; a loop here)
  *   7. Else (valid direction found):
  *        a. Calculate next position after move
  *        b. If next position == waypoint, THEN dequeue waypoint
@@ -686,7 +730,7 @@ void movement_finish(MovementHandler* handler) {
  *     }
  * 
  *   C Implementation:
- *     Same recursive logic - when player already at waypoint, dequeue and
+ *     Same logic as a loop - when player already at waypoint, dequeue and
  *     check next waypoint without moving. Continues until valid move found.
  * 
  * EXAMPLE - MULTI-TILE WAYPOINT:
@@ -694,7 +738,7 @@ void movement_finish(MovementHandler* handler) {
  *   Initial state:
  *   ┌──────────────────────────────────────────────────────────┐
  *   │ waypoints[0] = 0x0032C900  (x=3225, z=3200)  ← 5 tiles E │
- *   │ waypoint_index = 0                                       │
+ *   │ waypoint_head = 0, waypoint_count = 1                    │
  *   │ Current player position: (3220, 3200)                    │
  *   └──────────────────────────────────────────────────────────┘
  * 
@@ -744,17 +788,14 @@ void movement_finish(MovementHandler* handler) {
  *     player->primary_direction = dir;
  *   }
  * 
- * SHIFT OPERATION:
- *   For array of N packed i32 values:
- *     for (i = 0; i <= waypoint_index; i++)
- *       waypoints[i] = waypoints[i+1];  // Copy 4-byte i32
- *   
- *   Example timing (25 waypoints, 3GHz CPU):
- *     25 i32s × 2 cycles = 50 cycles = 0.000017ms
+ * DEQUEUE OPERATION:
+ *   The consumed waypoint stays in its slot; only the head moves:
+ *     waypoint_head = ring_slot(waypoint_head, 1);
+ *     waypoint_count--;
  *   
- *   Faster than old Point* approach:
- *     Old: 25 pointers × 2 cycles + 25 free() calls
- *     New: 25 i32s × 2 cycles (no free needed)
+ *   The shift-left version copied every queued waypoint one slot down
+ *   here (up to 99 i32s on a long path, and one past the array when it
+ *   was full).
  * 
  * ENERGY DEPLETION:
  *   Only decreases energy when running:
@@ -770,7 +811,7 @@ void movement_finish(MovementHandler* handler) {
  *     Allows energy to regenerate (if regeneration logic added)
  * 
  * EMPTY QUEUE HANDLING:
- *   if (handler->waypoint_index == -1)
+ *   if (handler->waypoint_count == 0)
  *     return -1;
  *   
  *   Caller should check for -1:
@@ -794,35 +835,34 @@ void movement_finish(MovementHandler* handler) {
  *         }
  *       }
  * 
- * COMPLEXITY: O(n) time worst case (recursive), O(n) for shift (n = waypoint_index)
+ * COMPLEXITY: O(1) per dequeue; O(n) only when n queued waypoints are
+ *             already reached
  */
 i32 movement_get_next_direction(MovementHandler* handler, u32 current_x, u32 current_z) {
-    if (handler->waypoint_index == -1) {
-        return -1;
-    }
-    
     u32 level, x, z;
-    coord_unpack(handler->waypoints[0], &level, &x, &z);
-    
-    i32 dx = x - current_x;
-    i32 dz = z - current_z;
-    
-    /* Normalize deltas to -1, 0, or +1 for single-tile movement */
-    i32 step_dx = (dx < 0) ? -1 : (dx > 0) ? 1 : 0;
-    i32 step_dz = (dz < 0) ? -1 : (dz > 0) ? 1 : 0;
+    i32 step_dx, step_dz, direction;
     
-    i32 direction = position_direction(step_dx, step_dz);
-    
-    if (direction == -1) {
-        /* Already at waypoint, dequeue and check next */
-        handler->waypoint_index--;
-        if (handler->waypoint_index != -1) {
-            for (i32 i = 0; i <= handler->waypoint_index; i++) {
-                handler->waypoints[i] = handler->waypoints[i + 1];
-            }
-            return movement_get_next_direction(handler, current_x, current_z);
+    for (;;) {
+        if (handler->waypoint_count == 0) {
+            return -1;
         }
-        return -1;
+        
+        coord_unpack(handler->waypoints[handler->waypoint_head], &level, &x, &z);
+        
+        i32 dx = x - current_x;
+        i32 dz = z - current_z;
+        
+        /* Normalize deltas to -1, 0, or +1 for single-tile movement */
+        step_dx = (dx < 0) ? -1 : (dx > 0) ? 1 : 0;
+        step_dz = (dz < 0) ? -1 : (dz > 0) ? 1 : 0;
+        
+        direction = DIRECTION_FROM_STEP[(step_dz + 1) * 3 + (step_dx + 1)];
+        if (direction != -1) {
+            break;
+        }
+        
+        /* Already at waypoint, dequeue and check next */
+        movement_remove_first_waypoint(handler);
     }
     
     /* Calculate the position after this move */
@@ -832,12 +872,7 @@ i32 movement_get_next_direction(MovementHandler* handler, u32 current_x, u32 cur
     /* Check if this move will reach the waypoint */
     if (next_x == x && next_z == z) {
         /* We'll reach the waypoint after this move, dequeue it */
-        handler->waypoint_index--;
-        if (handler->waypoint_index != -1) {
-            for (i32 i = 0; i <= handler->waypoint_index; i++) {
-                handler->waypoints[i] = handler->waypoints[i + 1];
-            }
-        }
+        movement_remove_first_waypoint(handler);
     }
     
     /* Decrease energy if running */
@@ -880,7 +915,7 @@ i32 movement_get_next_direction(MovementHandler* handler, u32 current_x, u32 cur
  * COMPLEXITY: O(1) time
  */
 bool movement_is_moving(const MovementHandler* handler) {
-    return handler->waypoint_index != -1;
+    return handler->waypoint_count != 0;
 }
 
 /*
@@ -912,7 +947,7 @@ bool movement_is_moving(const MovementHandler* handler) {
  * COMPLEXITY: O(1) time
  */
 u32 movement_get_waypoint_count(const MovementHandler* handler) {
-    return handler->waypoint_index + 1;
+    return handler->waypoint_count;
 }
 
 /*
@@ -922,11 +957,8 @@ u32 movement_get_waypoint_count(const MovementHandler* handler) {
  * 
  * ALGORITHM:
  *   1. If queue empty (waypoint_count == 0), return (no-op)
- *   2. Free first waypoint: free(waypoints[0])
- *   3. Shift remaining waypoints left:
- *        for i in [1, waypoint_count):
- *          waypoints[i-1] = waypoints[i]
- *   4. Decrement count: waypoint_count--
+ *   2. Advance the head one slot (wrapping): waypoint_head = ring_slot(head, 1)
+ *   3. Decrement count: waypoint_count--
  * 
  * DIFFERENCE FROM movement_get_next:
  *   ┌──────────────────────┬─────────────────────────────────┐
@@ -991,15 +1023,13 @@ u32 movement_get_waypoint_count(const MovementHandler* handler) {
  *   if (handler->waypoint_count == 0)
  *     return;  // No-op, safe to call on empty queue
  * 
- * COMPLEXITY: O(n) time where n = waypoint_count (due to shift)
+ * COMPLEXITY: O(1) time
  */
 void movement_remove_first_waypoint(MovementHandler* handler) {
-    if (handler->waypoint_index == -1) {
+    if (handler->waypoint_count == 0) {
         return;
     }
     
-    for (i32 i = 0; i <= handler->waypoint_index; i++) {
-        handler->waypoints[i] = handler->waypoints[i + 1];
-    }
-    handler->waypoint_index--;
+    handler->waypoint_head = ring_slot(handler->waypoint_head, 1);
+    handler->waypoint_count--;
 }
@@ -63,7 +63,7 @@
  *   │ waypoints[2] → (3203,3203) dir=NORTHEAST                      │
  *   │ waypoints[3] → (3204,3204) dir=NORTHEAST                      │
  *   │ waypoints[4] → (3205,3205) dir=NORTHEAST                      │
- *   │ waypoint_count = 5                                            │
+ *   │ waypoint_head = 0, waypoint_count = 5                         │
  *   └───────────────────────────────────────────────────────────────┘
  * 
  * TICK PROCESSING (Walking):
@@ -78,37 +78,33 @@
  *   Tick 2: Pop waypoints[0,1] → Move to (3204,3204), count=1
  *   Tick 3: Pop waypoints[0]   → Move to (3205,3205), count=0 (arrived!)
  * 
- * ARRAY-BASED QUEUE IMPLEMENTATION:
+ * RING BUFFER QUEUE IMPLEMENTATION:
  * 
- * This uses a simple array with shift-on-dequeue (vs circular buffer):
+ * The waypoints live in a fixed ring with a head slot and a count:
  * 
  *   Enqueue (add_step):
- *     waypoints[waypoint_count++] = new_point;  // O(1)
+ *     waypoints[(head + count) % MAX_WAYPOINTS] = point;  count++;  // O(1)
  * 
- *   Dequeue (get_next):
- *     result = waypoints[0];                     // O(1) read
- *     Shift all elements left:                   // O(n) shift
- *       waypoints[i-1] = waypoints[i];
- *     waypoint_count--;
+ *   Dequeue (get_next_direction reaching a waypoint):
+ *     head = (head + 1) % MAX_WAYPOINTS;  count--;              // O(1)
+ * 
+ *   ┌────┬────┬────┬────┬────┬────┬─ ─ ─┬────┐
+ *   │ w5 │ w6 │    │    │ w2 │ w3 │     │ w4 │   head = 4, count = 5
+ *   └────┴────┴────┴────┴────┴────┴─ ─ ─┴────┘
+ *     tail wraps ──┘      └── head: the next waypoint
  * 
  * COMPLEXITY ANALYSIS:
  *   - Enqueue: O(1) time
- *   - Dequeue: O(n) time where n = waypoint_count
- *   - Space:   O(1) - fixed array size
- * 
- * ALTERNATIVE IMPLEMENTATION (Circular Buffer):
- *   Could use head/tail pointers for O(1) dequeue:
- *     int head = 0, tail = 0;
- *     Enqueue: waypoints[tail++ % MAX_WAYPOINTS] = point;
- *     Dequeue: return waypoints[head++ % MAX_WAYPOINTS];
- *   
- *   Trade-off: O(1) dequeue but wastes array slots until wrap-around
+ *   - Dequeue: O(1) time (no elements move)
+ *   - Append path (movement_add_path): O(n) for n new steps, one call
+ *   - Space:   O(1) - fixed array size, every slot usable
  * 
- * WHY SIMPLE SHIFT APPROACH?
- *   - MAX_WAYPOINTS is small (typically 25-50)
- *   - O(n) shift is ~100 CPU cycles (negligible)
- *   - Simpler code (no modulo arithmetic)
- *   - No wasted array slots
+ * WHY A RING?
+ *   MAX_WAYPOINTS is 100. Shifting the array on every dequeue moved up to
+ *   99 values per step, for every moving player and NPC, once or twice a
+ *   tick. With thousands of entities walking that is real work for nothing:
+ *   the head index moves instead. The wrap is a compare and subtract, not a
+ *   modulo (MAX_WAYPOINTS is not a power of two).
  * 
  * WORLD COORDINATE BOUNDS:
  * 
@@ -140,10 +136,12 @@
  *                    Direction calculated dynamically on dequeue
  *                    Processed in FIFO order (queue semantics)
  * 
- *   waypoint_index:  Current last waypoint index
- *                    Range: [-1, MAX_WAYPOINTS-1]
- *                    -1 = empty queue (matches TypeScript)
- *                    0+ = index of last waypoint
+ *   waypoint_head:   Slot of the next waypoint (the queue's front)
+ *                    Range: [0, MAX_WAYPOINTS-1]
+ * 
+ *   waypoint_count:  Waypoints queued, from waypoint_head on (wrapping)
+ *                    Range: [0, MAX_WAYPOINTS]
+ *                    0 = empty queue (TypeScript's waypointIndex == -1)
  * 
  *   run_path:        Client's run toggle state
  *                    true  = player wants to run this path
@@ -168,7 +166,8 @@
  * │ ...                                                                  │
  * │ waypoints[MAX_WAYPOINTS-1] = (unused)                                │
  * ├──────────────────────────────────────────────────────────────────────┤
- * │ waypoint_index = 2  (0-based, so 3 waypoints total)                  │
+ * │ waypoint_head  = 0                                                   │
+ * │ waypoint_count = 3                                                   │
  * │ run_path       = true                                                │
  * │ running        = true                                                │
  * │ run_energy     = 9500                                                │
@@ -198,27 +197,39 @@
  *   - Simpler memory management (no leaks possible)
  * 
  * INVARIANTS:
- *   - -1 ≤ waypoint_index < MAX_WAYPOINTS
- *   - waypoint_index == -1 means queue is empty
- *   - waypoints[0..waypoint_index] contain valid packed coordinates
+ *   - 0 ≤ waypoint_head < MAX_WAYPOINTS
+ *   - 0 ≤ waypoint_count ≤ MAX_WAYPOINTS
+ *   - waypoint_count == 0 means queue is empty
+ *   - the waypoint_count slots from waypoint_head (wrapping past the
+ *     end to 0) contain valid packed coordinates, first to last
  *   - running == (run_path && run_energy > 0)
  *   - 0 ≤ run_energy ≤ 10000
  * 
  * LIFECYCLE:
- *   1. movement_init()                    → Set waypoint_index=-1, run_energy=10000
+ *   1. movement_init()                    → Empty queue, run_energy=10000
  *   2. movement_add_step() x N            → Pack and store coordinates
+ *      (or movement_add_path() once)
  *   3. movement_get_next_direction()      → Unpack, calculate direction, dequeue
- *   4. movement_destroy()                 → Set waypoint_index=-1 (no free needed)
+ *   4. movement_destroy()                 → Set waypoint_count=0 (no free needed)
  * 
  ******************************************************************************/
 typedef struct {
-    i32 waypoints[MAX_WAYPOINTS];      /* Queue of packed coordinates (FIFO) */
-    i32 waypoint_index;                /* Current waypoint index (-1 = empty) */
+    i32 waypoints[MAX_WAYPOINTS];      /* Ring of packed coordinates (FIFO) */
+    u32 waypoint_head;                 /* Slot of the next waypoint */
+    u32 waypoint_count;                /* Waypoints queued (0 = empty) */
     bool run_path;                     /* Client run toggle state */
     bool running;                      /* Actual running state (considers energy) */
     u32 run_energy;                    /* Energy resource [0, 10000] */
 } MovementHandler;
 
+/*
+ * g_movement_waypoints - Waypoints a handler may queue (--max-waypoints)
+ *
+ * At most MAX_WAYPOINTS, the size of the ring; the ring keeps its size
+ * and only this many of its slots are ever filled.
+ */
+extern u32 g_movement_waypoints;
+
 /*******************************************************************************
  * PUBLIC API
  ******************************************************************************/
@@ -230,11 +241,11 @@ typedef struct {
  * 
  * ALGORITHM:
  *   1. Zero-initialize entire struct (memset)
- *   2. Set waypoint_index to -1 (empty queue)
+ *   2. Empty queue (waypoint_head = waypoint_count = 0)
  *   3. Set run_energy to 10000 (100% energy)
  * 
  * INITIAL STATE:
- *   - waypoint_index = -1 (empty queue, matches TypeScript)
+ *   - waypoint_count = 0 (empty queue)
  *   - run_path       = false
  *   - running        = false
  *   - run_energy     = 10000
@@ -255,7 +266,7 @@ void movement_init(MovementHandler* handler);
  * @param handler  Pointer to MovementHandler to clean up
  * 
  * ALGORITHM:
- *   1. Set waypoint_index = -1 (mark queue as empty)
+ *   1. Set waypoint_head = waypoint_count = 0 (mark queue as empty)
  * 
  * MEMORY SAFETY:
  *   - No heap allocation used, so no memory to free
@@ -272,9 +283,9 @@ void movement_init(MovementHandler* handler);
  *   movement_init(&handler);
  *   movement_add_step(&handler, 3200, 3200);
  *   movement_add_step(&handler, 3201, 3201);
- *   // handler.waypoint_index = 1 (two waypoints)
+ *   // handler.waypoint_count = 2
  *   movement_destroy(&handler);
- *   // handler.waypoint_index = -1 (empty queue)
+ *   // handler.waypoint_count = 0 (empty queue)
  * 
  * COMPLEXITY: O(1) time
  */
@@ -315,10 +326,10 @@ void movement_reset(MovementHandler* handler);
  * @param z        World Z coordinate of waypoint
  * 
  * ALGORITHM:
- *   1. Check queue capacity: if full (index >= MAX_WAYPOINTS-1), reject
+ *   1. Check queue capacity: if full (count == MAX_WAYPOINTS), reject
  *   2. Validate coordinates: if out of bounds (x>12800 or z>12800), reject
  *   3. Pack coordinates: coord_pack(0, x, z)
- *   4. Store in queue: waypoints[++waypoint_index] = packed
+ *   4. Store at the tail: waypoints[(head + count++) % MAX_WAYPOINTS]
  * 
  * NOTE: Direction is NOT stored (unlike old implementation)
  *   Direction calculated dynamically on dequeue (matches TypeScript)
@@ -354,15 +365,37 @@ void movement_reset(MovementHandler* handler);
  * MEMORY EFFICIENCY:
  *   No heap allocation (stored inline in array)
  *   Each waypoint: 4 bytes (packed i32)
- *   Max memory: MAX_WAYPOINTS × 4 = 100 bytes (25 waypoints)
+ *   Max memory: MAX_WAYPOINTS × 4 = 400 bytes (100 waypoints)
  *   
- *   Old Point* approach: MAX_WAYPOINTS × 16 bytes = 400 bytes
+ *   Old Point* approach: MAX_WAYPOINTS × 16 bytes = 1600 bytes
  *   Improvement: 4x less memory, better cache locality
  * 
  * COMPLEXITY: O(1) time, O(1) space (no allocation)
  */
 void movement_add_step(MovementHandler* handler, u32 x, u32 z);
 
+/*
+ * movement_add_path - Append a whole path to the movement queue
+ * 
+ * @param handler  Pointer to MovementHandler
+ * @param x        World X coordinates of the steps, first to last
+ * @param z        World Z coordinates of the steps
+ * @param count    Steps in x and z
+ * @return         Steps queued
+ * 
+ * The pathfinder's and the client's paths arrive as arrays: this queues
+ * them in one call, with movement_add_step()'s rules per step - an out of
+ * bounds step is skipped with the same warning, and the path is cut where
+ * the queue is full. At most two copies, one per side of the wrap.
+ * 
+ * EXAMPLE:
+ *   PathResult path;   // from pathfinder_find_tile()
+ *   movement_add_path(&player->movement, path.x, path.z, path.count);
+ * 
+ * COMPLEXITY: O(count) time, O(1) space
+ */
+u32 movement_add_path(MovementHandler* handler, const u32* x, const u32* z, u32 count);
+
 /*
  * coord_pack - Pack coordinates into 32-bit integer
  * 
@@ -504,18 +537,16 @@ void movement_finish(MovementHandler* handler);
  * @return           Direction constant (0-7), or -1 if no movement
  * 
  * ALGORITHM (matches TypeScript PathingEntity.validateAndAdvanceStep):
- *   1. If queue empty (waypoint_index == -1), return -1
- *   2. Unpack first waypoint: coord_unpack(waypoints[0], &level, &x, &z)
+ *   1. If queue empty (waypoint_count == 0), return -1
+ *   2. Unpack first waypoint: coord_unpack(waypoints[waypoint_head], ...)
  *   3. Calculate direction: position_direction(x - current_x, z - current_z)
  *   4. If direction == -1 (waypoint reached):
- *        a. Dequeue waypoint (shift array left)
- *        b. Decrement waypoint_index
- *        c. Recursively call self (like TypeScript recursive validation)
+ *        a. Dequeue waypoint (advance waypoint_head, decrement count)
+ *        b. Check the next one (like TypeScript recursive validation)
  *   5. Else (valid direction):
- *        a. Dequeue waypoint (shift array left)
- *        b. Decrement waypoint_index
- *        c. Decrease run energy if running
- *        d. Return direction
+ *        a. Dequeue waypoint if this step reaches it
+ *        b. Decrease run energy if running
+ *        c. Return direction
  * 
  * RECURSIVE VALIDATION (matches TypeScript):
  *   When player is already at waypoint destination (direction == -1):
@@ -526,21 +557,22 @@ void movement_finish(MovementHandler* handler);
  * DEQUEUE VISUALIZATION:
  *   Before:
  *   ┌──────────────────────────────────────────────────────────┐
- *   │ waypoints[0] = 0x0032C833  (x=3222, z=3219)              │
+ *   │ waypoints[0] = 0x0032C833  (x=3222, z=3219)  ← head      │
  *   │ waypoints[1] = 0x0032CC33  (x=3223, z=3219)              │
  *   │ waypoints[2] = 0x0032CC34  (x=3223, z=3220)              │
- *   │ waypoint_index = 2                                       │
+ *   │ waypoint_head = 0, waypoint_count = 3                    │
  *   │ Current pos: (3222, 3218)                                │
  *   └──────────────────────────────────────────────────────────┘
  * 
  *   Calculate: dx = 3222-3222 = 0, dz = 3219-3218 = 1
- *   Direction: NORTH (1)
+ *   Direction: NORTH (1), and the step reaches waypoints[0]
  * 
  *   After movement_get_next_direction():
  *   ┌──────────────────────────────────────────────────────────┐
- *   │ waypoints[0] = 0x0032CC33  (x=3223, z=3219)  ← shifted   │
- *   │ waypoints[1] = 0x0032CC34  (x=3223, z=3220)  ← shifted   │
- *   │ waypoint_index = 1                                       │
+ *   │ waypoints[0] = 0x0032C833  (consumed, left in place)     │
+ *   │ waypoints[1] = 0x0032CC33  (x=3223, z=3219)  ← head      │
+ *   │ waypoints[2] = 0x0032CC34  (x=3223, z=3220)              │
+ *   │ waypoint_head = 1, waypoint_count = 2                    │
  *   └──────────────────────────────────────────────────────────┘
  * 
  *   Returned: 1 (NORTH)
@@ -575,7 +607,8 @@ void movement_finish(MovementHandler* handler);
  *       }
  *     }
  * 
- * COMPLEXITY: O(n) time worst case (recursive dequeue), usually O(n) for shift
+ * COMPLEXITY: O(1) per dequeue; O(n) only when n queued waypoints are
+ *             already reached
  */
 i32 movement_get_next_direction(MovementHandler* handler, u32 current_x, u32 current_z);
 
@@ -620,9 +653,7 @@ u32 movement_get_waypoint_count(const MovementHandler* handler);
  * 
  * ALGORITHM:
  *   1. If queue empty (waypoint_count == 0), return (no-op)
- *   2. Free first waypoint: free(waypoints[0])
- *   3. Shift remaining waypoints left (same as movement_get_next)
- *   4. Decrement count: waypoint_count--
+ *   2. Advance waypoint_head (wrapping), decrement waypoint_count
  * 
  * DIFFERENCE FROM movement_get_next:
  *   - Does NOT allocate copy (no malloc)
@@ -652,7 +683,7 @@ u32 movement_get_waypoint_count(const MovementHandler* handler);
  *     // Player stops (or continue to next waypoint)
  *   }
  * 
- * COMPLEXITY: O(n) time where n = waypoint_count
+ * COMPLEXITY: O(1) time
  */
 void movement_remove_first_waypoint(MovementHandler* handler);
 
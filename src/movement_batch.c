@@ -0,0 +1,121 @@
+/*******************************************************************************
+ * MOVEMENT_BATCH.C - Batched Zone Change Detection Implementation
+ *******************************************************************************
+ *
+ * See movement_batch.h for the design.
+ *
+ * The three passes of movement_batch_collect() are kept as separate
+ * loops on purpose: the gather has an indirect load, the flag pass has
+ * none and vectorizes, the compaction carries n from one entry to the
+ * next. Fused, the loop would vectorize none of them.
+ *
+ ******************************************************************************/
+
+#include "movement_batch.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * MOVEMENT_BATCH_LANES - Entries the flag pass rounds its count up to
+ *
+ * At -O2 gcc only vectorizes a loop that needs no scalar remainder, so
+ * the pass always runs whole groups of 16 (16 flags fill one SSE2
+ * register). The arrays are allocated to the rounded capacity; entries
+ * past count are stale or zero and never compacted.
+ */
+#define MOVEMENT_BATCH_LANES 16
+
+bool movement_batch_init(MovementBatch* batch, u32 capacity) {
+    if (!batch) return false;
+    memset(batch, 0, sizeof(MovementBatch));
+    if (capacity == 0 || capacity > 0xFFFF) return false;
+
+    u32 lanes = (capacity + MOVEMENT_BATCH_LANES - 1) & ~(u32)(MOVEMENT_BATCH_LANES - 1);
+    batch->index = (u16*)malloc(capacity * sizeof(u16));
+    batch->order = (u16*)malloc(capacity * sizeof(u16));
+    batch->coord = (u32*)calloc(lanes, sizeof(u32));
+    batch->filed = (u32*)calloc(lanes, sizeof(u32));
+    batch->flags = (u8*)calloc(lanes, 1);
+    batch->changes = (MovementChange*)malloc(capacity * sizeof(MovementChange));
+    if (!batch->index || !batch->order || !batch->coord || !batch->filed ||
+        !batch->flags || !batch->changes) {
+        movement_batch_free(batch);
+        return false;
+    }
+    batch->capacity = capacity;
+    return true;
+}
+
+void movement_batch_free(MovementBatch* batch) {
+    if (!batch) return;
+    free(batch->index);
+    free(batch->order);
+    free(batch->coord);
+    free(batch->filed);
+    free(batch->flags);
+    free(batch->changes);
+    memset(batch, 0, sizeof(MovementBatch));
+}
+
+/*
+ * flag_zone_changes - The flag pass
+ *
+ * restrict spares the vectorized loop a runtime overlap check, and the
+ * rounded count its scalar remainder.
+ */
+static void flag_zone_changes(const u32* restrict coord, const u32* restrict filed,
+                              u8* restrict flags, u32 count) {
+    count = (count + MOVEMENT_BATCH_LANES - 1) & ~(u32)(MOVEMENT_BATCH_LANES - 1);
+    for (u32 i = 0; i < count; i++) {
+        /* Another zone (or not filed at all) when a masked bit differs */
+        u32 moved = ((coord[i] ^ filed[i]) & ZONE_GRID_PACKED_MASK) != 0;
+        flags[i] |= (u8)(moved << 1);   /* MOVEMENT_BATCH_ZONE */
+    }
+}
+
+void movement_batch_collect(MovementBatch* batch, const ZoneGrid* grid) {
+    u32 count = batch->count;
+    const u16* index = batch->index;
+    u8* flags = batch->flags;
+
+    /* Gather: the zone each entity is filed under */
+    for (u32 i = 0; i < count; i++) {
+        batch->filed[i] = grid->filed[index[i]];
+    }
+
+    flag_zone_changes(batch->coord, batch->filed, flags, count);
+
+    /* Compact: slot n is overwritten until an entry with a flag keeps it */
+    MovementChange* changes = batch->changes;
+    u32 n = 0;
+    for (u32 i = 0; i < count; i++) {
+        changes[n].index = index[i];
+        changes[n].order = batch->order[i];
+        changes[n].flags = flags[i];
+        n += flags[i] != 0;
+    }
+    batch->change_count = n;
+}
+
+void movement_batch_merge(MovementBatch* out, MovementBatch* const* batches, u32 count) {
+    u32 next[MOVEMENT_BATCH_MERGE_MAX] = { 0 };  /* Cursor per batch */
+    if (count > MOVEMENT_BATCH_MERGE_MAX) count = MOVEMENT_BATCH_MERGE_MAX;
+
+    u32 n = 0;
+    for (;;) {
+        /* The lowest order at any cursor comes next */
+        u32 best = count;
+        u32 best_order = 0;
+        for (u32 b = 0; b < count; b++) {
+            if (next[b] == batches[b]->change_count) continue;
+            u32 order = batches[b]->changes[next[b]].order;
+            if (best == count || order < best_order) {
+                best = b;
+                best_order = order;
+            }
+        }
+        if (best == count || n == out->capacity) break;
+        out->changes[n++] = batches[best]->changes[next[best]++];
+    }
+    out->change_count = n;
+}
@@ -0,0 +1,184 @@
+/*******************************************************************************
+ * MOVEMENT_BATCH.H - Batched Zone Change Detection After Movement
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Splitting per-entity work into passes over flat arrays
+ *   - Comparing packed coordinates with XOR and a mask
+ *   - Branch-free stream compaction (keep only the entities that changed)
+ *   - Merging per-thread results back into one deterministic order
+ *
+ * THE PROBLEM:
+ *
+ * After every step, phase 1 of world_process() asked the zone grid
+ * whether the player had left their 8x8 zone:
+ *
+ *   for each player:
+ *       step                                   (moves the player)
+ *       zone_grid_update(grid, pid, position)  two compares, two branches
+ *
+ * and npc_system_process() did the same for every walking NPC. Almost
+ * every answer is "no" - a player crosses a zone boundary at most every
+ * few steps - but each question is a call, two loads from the grid and a
+ * branch that is taken at random, interleaved with the waypoint pops.
+ * With region sharding (region_shard.h) the question also had to wait for
+ * the serial merge, because the grid is shared.
+ *
+ * THE SOLUTION - STEP, THEN ASK EVERYONE AT ONCE:
+ *
+ *   step pass      each entity is stepped; its position is pushed packed
+ *                  (coord_pack layout) with the step's own flags
+ *
+ *   index  [ 12   7   301  44 ... ]
+ *   coord  [ c0   c1  c2   c3 ... ]     packed position after the step
+ *
+ *   gather         filed[i] = grid->filed[index[i]]   (read-only)
+ *
+ *   flag pass      zone = ((coord[i] ^ filed[i]) & ZONE_GRID_PACKED_MASK) != 0
+ *                  straight-line integer code over three arrays: the
+ *                  compiler vectorizes it
+ *
+ *   compaction     changes[n] = i;  n += flags[i] != 0
+ *                  always write, advance only for a change: no branch
+ *
+ *   changes        [ {pid 7, MOVED|ZONE} {pid 44, MOVED|RELOAD|ZONE} ]
+ *
+ * Only the changes reach the serial part: relinking the grid, waking
+ * NPCs, prefetching map squares, sending a new area, marking the movers
+ * changed (player_list.h). Players standing still are never touched.
+ *
+ * PER SHARD:
+ *   Each region shard has its own batch and runs all three passes on its
+ *   own thread: the grid is only read until the merge. Every change
+ *   carries the entity's position in the player list (order), so
+ *   movement_batch_merge() puts the shards' changes back into list order
+ *   and the merge sends exactly what the serial loop would.
+ *
+ * WHAT STAYS PER ENTITY:
+ *   The step itself. Waypoints live in each entity's MovementHandler ring
+ *   and the run step starts where the walk step ended, so the waypoint
+ *   pop stays a loop per entity; it picks its direction from
+ *   DIRECTION_FROM_STEP (position.h) rather than position_direction()'s
+ *   branches. A player's reload bounds are relative to their area origin,
+ *   not a fixed grid, so the step reports them (MOVEMENT_BATCH_RELOAD).
+ *
+ ******************************************************************************/
+
+#ifndef MOVEMENT_BATCH_H
+#define MOVEMENT_BATCH_H
+
+#include "types.h"
+#include "position.h"
+#include "movement.h"
+#include "zone_grid.h"
+#include <stdbool.h>
+
+/* Flags per entity: the step left its area's reload bounds */
+#define MOVEMENT_BATCH_RELOAD 0x01
+
+/* ... set by movement_batch_collect(): it is in another zone than filed */
+#define MOVEMENT_BATCH_ZONE   0x02
+
+/* ... the step moved it (players: goes on the list's changed set) */
+#define MOVEMENT_BATCH_MOVED  0x04
+
+/* Batches movement_batch_merge() takes at once (one per region shard) */
+#define MOVEMENT_BATCH_MERGE_MAX 16
+
+/*
+ * MovementChange - One entity that needs the serial merge
+ */
+typedef struct {
+    u16 index;                  /* Player PID or NPC index */
+    u16 order;                  /* Position in the caller's processing order */
+    u8 flags;                   /* MOVEMENT_BATCH_* */
+} MovementChange;
+
+/*
+ * MovementBatch - Entities stepped this tick, as parallel arrays
+ *
+ * Entries are pushed in ascending order; changes[] keeps that order.
+ */
+typedef struct {
+    u16* index;                 /* Player PID or NPC index */
+    u16* order;                 /* Position in the caller's order */
+    u32* coord;                 /* coord_pack() of the position after the step */
+    u32* filed;                 /* Grid's packed zone (collect scratch) */
+    u8* flags;                  /* MOVEMENT_BATCH_* */
+    MovementChange* changes;    /* Entries with any flag, in order */
+    u32 count;
+    u32 change_count;
+    u32 capacity;
+} MovementBatch;
+
+/*
+ * movement_batch_init - Allocate room for capacity entities
+ *
+ * @param batch     Zeroed batch
+ * @param capacity  Entities per tick (at most 65535: indices are u16)
+ * @return          false on allocation failure (batch left empty)
+ */
+bool movement_batch_init(MovementBatch* batch, u32 capacity);
+
+/*
+ * movement_batch_free - Release the arrays (safe on a zeroed batch)
+ */
+void movement_batch_free(MovementBatch* batch);
+
+/*
+ * movement_batch_clear - Forget the last tick's entries and changes
+ */
+static inline void movement_batch_clear(MovementBatch* batch) {
+    batch->count = 0;
+    batch->change_count = 0;
+}
+
+/*
+ * movement_batch_push - Record one stepped entity
+ *
+ * @param batch  Batch with room left
+ * @param index  Player PID or NPC index
+ * @param order  Position in the caller's processing order (ascending)
+ * @param pos    Position after the step
+ * @param flags  MOVEMENT_BATCH_RELOAD / _MOVED as the step reported, else 0
+ *
+ * COMPLEXITY: O(1) time
+ */
+static inline void movement_batch_push(MovementBatch* batch, u32 index, u32 order,
+                                       const Position* pos, u8 flags) {
+    u32 i = batch->count++;
+    batch->index[i] = (u16)index;
+    batch->order[i] = (u16)order;
+    batch->coord[i] = pos->packed;
+    batch->flags[i] = flags;
+}
+
+/*
+ * movement_batch_collect - Flag zone changes and compact the changes
+ *
+ * @param batch  Pushed entries
+ * @param grid   Zone grid the entities are filed in (only read)
+ *
+ * Sets MOVEMENT_BATCH_ZONE exactly where zone_grid_update() would return
+ * true for the pushed position (any tile below 16384, as coord_pack
+ * keeps 14 bits), then fills changes[] with every entry
+ * that has a flag. Safe on several threads at once for disjoint entities.
+ *
+ * COMPLEXITY: O(count) time, no branches on the data
+ */
+void movement_batch_collect(MovementBatch* batch, const ZoneGrid* grid);
+
+/*
+ * movement_batch_merge - Merge several batches' changes by order
+ *
+ * @param out      Batch whose changes[] receives the merge (its capacity
+ *                 must cover every change)
+ * @param batches  Collected batches, each in ascending order
+ * @param count    Number of batches (at most MOVEMENT_BATCH_MERGE_MAX)
+ *
+ * COMPLEXITY: O(changes * count) time
+ */
+void movement_batch_merge(MovementBatch* out, MovementBatch* const* batches, u32 count);
+
+#endif /* MOVEMENT_BATCH_H */
@@ -0,0 +1,653 @@
+/*******************************************************************************
+ * NETIO.C - Network I/O Thread Implementation
+ *******************************************************************************
+ *
+ * See netio.h for the pipeline, record format and ownership rules.
+ *
+ * NETWORK THREAD LOOP:
+ *
+ *   while running:
+ *       network_wait(events)                  ← sockets + wake pipe
+ *       listener ready  → accept all, send CONNECT events
+ *       client readable → recv, split frames, push inbound records
+ *       client writable → send from outbound ring
+ *       wake pipe       → handle flush / close requests from game thread
+ *       if anything was pushed inbound → wake the game thread
+ *
+ * CONTROL RECORDS:
+ *   events   (net → game):  [CONNECT|CONNECT_WS:1][slot:2][fd:4]
+ *   requests (game → net):  [FLUSH|CLOSE:1][slot:2]
+ *
+ *   Requests are hints: conn->state and the outbound ring are the truth.
+ *   If the request ring is ever full the game thread sets io->rescan and
+ *   the network thread checks every connection instead.
+ *
+ ******************************************************************************/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include "netio.h"
+#include "packets.h"
+#include "metrics.h"
+#include "asset_http.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+NetIo* g_netio = NULL;
+
+#ifndef _WIN32
+
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+
+#define NETIO_EVENT_CONNECT     1
+#define NETIO_EVENT_CONNECT_WS  2
+#define NETIO_REQUEST_FLUSH  1
+#define NETIO_REQUEST_CLOSE  2
+
+/* Event token for the game → net wake pipe (listener uses 0xFFFFFFFF) */
+#define NETIO_TOKEN_WAKE 0xFFFFFFFEu
+
+#define load_acquire(p)      __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define store_release(p, v)  __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define exchange(p, v)       __atomic_exchange_n((p), (v), __ATOMIC_ACQ_REL)
+
+/*******************************************************************************
+ * WAKEUP SIGNALLING
+ ******************************************************************************/
+
+/*
+ * signal_pipe - Write one wake byte unless one is already pending
+ *
+ * The flag turns a burst of N notifications into a single write() and a
+ * single wakeup; the receiver clears it before looking for work, so a
+ * notification racing with that check always causes another wakeup.
+ */
+static void signal_pipe(i32 fd, u32* signaled) {
+    if (exchange(signaled, 1) == 0) {
+        u8 b = 1;
+        ssize_t n = write(fd, &b, 1);
+        (void)n;  /* Pipe full means a wakeup is already pending */
+    }
+}
+
+static void drain_pipe(i32 fd, u32* signaled) {
+    u8 buf[64];
+    while (read(fd, buf, sizeof(buf)) > 0) { }
+    __atomic_store_n(signaled, 0, __ATOMIC_SEQ_CST);
+}
+
+static bool make_pipe(i32 fds[2]) {
+    if (pipe(fds) != 0) return false;
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    fcntl(fds[1], F_SETFL, O_NONBLOCK);
+    return true;
+}
+
+/*******************************************************************************
+ * NETWORK THREAD - INBOUND
+ ******************************************************************************/
+
+/*
+ * push_record - Append one inbound record for the game thread
+ *
+ * @return  false if the inbound ring is full (client is flooding us)
+ */
+static bool push_record(NetConnection* c, u8 kind, u8 opcode, const u8* payload, u32 length) {
+    /* Always leave room for the final CLOSED record */
+    if (kind != NETIO_RECORD_CLOSED &&
+        spsc_ring_free_space(&c->inbound) < 2 * NETIO_RECORD_HEADER + length) {
+        return false;
+    }
+    u8 header[NETIO_RECORD_HEADER] = { kind, opcode, (u8)(length >> 8), (u8)length };
+    return spsc_ring_pushv(&c->inbound, header, NETIO_RECORD_HEADER, payload, length);
+}
+
+/*
+ * mark_dead - Stop servicing a connection and tell the game thread
+ *
+ * The socket stays open (and the slot OPEN) until the game thread calls
+ * netio_close(), so its descriptor number cannot be reused under it.
+ */
+static void mark_dead(NetIo* io, NetConnection* c) {
+    if (c->dead) return;
+    c->dead = true;
+    network_unwatch(io->network, c->fd);
+
+    /* Cannot fail: push_record() keeps room reserved for it */
+    push_record(c, NETIO_RECORD_CLOSED, 0, NULL, 0);
+}
+
+/*
+ * split_frames - Turn received bytes into inbound records
+ *
+ * @return  false on protocol violation or inbound overflow
+ *
+ * Before framing is enabled everything is forwarded as RAW. Afterwards
+ * this is the same PacketLengths[] logic as server_process_player_input,
+ * except that a decoded opcode is remembered across partial packets so
+ * the ISAAC stream is advanced exactly once per packet.
+ */
+static bool split_frames(NetConnection* c) {
+    if (!load_acquire(&c->framing)) {
+        if (c->rx_size == 0) return true;
+        if (!push_record(c, NETIO_RECORD_RAW, 0, c->rx, c->rx_size)) return false;
+        c->rx_size = 0;
+        return true;
+    }
+
+    u32 offset = 0;
+    while (offset < c->rx_size) {
+        const u8* p = c->rx + offset;
+        u32 avail = c->rx_size - offset;
+
+        if (c->pending_opcode < 0) {
+            c->pending_opcode = (i32)((p[0] - isaac_get_next(&c->in_cipher)) & 0xFF);
+        }
+        u8 opcode = (u8)c->pending_opcode;
+
+        i32 length = PacketLengths[opcode];
+        u32 header = 1;
+        if (length == -1) {
+            if (avail < 2) break;
+            length = p[1];
+            header = 2;
+        } else if (length == -2) {
+            if (avail < 3) break;
+            length = (p[1] << 8) | p[2];
+            header = 3;
+        }
+        if (length < 0) length = 0;
+
+        /* A packet that can never fit in rx[] would wedge the stream */
+        if (header + (u32)length > MAX_PACKET_SIZE) return false;
+        if (avail < header + (u32)length) break;
+
+        if (!push_record(c, NETIO_RECORD_PACKET, opcode, p + header, (u32)length)) return false;
+        c->pending_opcode = -1;
+        offset += header + (u32)length;
+    }
+
+    /* Keep the partial tail (at most one packet) for the next recv() */
+    if (offset > 0) {
+        memmove(c->rx, c->rx + offset, c->rx_size - offset);
+        c->rx_size -= offset;
+    }
+    return true;
+}
+
+static void service_write(NetIo* io, NetConnection* c, u32 slot);
+
+static void service_read(NetIo* io, NetConnection* c, u32 slot) {
+    if (c->dead) return;
+
+    for (;;) {
+        u32 space = MAX_PACKET_SIZE - c->rx_size;
+        i32 n = network_receive(c->fd, c->rx + c->rx_size, space);
+        if (n > 0) {
+            metrics_add(&g_metrics.bytes_received, (u64)n);
+            if (c->ws.state != WS_STATE_NONE) {
+                /* Unframe in place: only stream bytes reach split_frames */
+                bool handshaking = c->ws.state == WS_STATE_HANDSHAKE;
+                i32 kept = ws_input(&c->ws, c->fd, c->rx, c->rx_size, c->rx_size + (u32)n);
+                if (kept < 0) {
+                    mark_dead(io, c);
+                    return;
+                }
+                c->rx_size = (u32)kept;
+                if (!ws_ready(&c->ws)) continue;
+                if (handshaking) service_write(io, c, slot);
+            } else {
+                c->rx_size += (u32)n;
+            }
+            if (!split_frames(c)) {
+                LOG_WARN("netio: dropping fd=%d (input overflow or oversized packet)\n", c->fd);
+                mark_dead(io, c);
+                return;
+            }
+            continue;
+        }
+        if (n < 0 && network_would_block()) return;
+
+        /* 0 = orderly shutdown by peer, -1 = socket error */
+        mark_dead(io, c);
+        return;
+    }
+}
+
+/*******************************************************************************
+ * NETWORK THREAD - OUTBOUND
+ ******************************************************************************/
+
+/*
+ * service_write - Send as much queued output as the socket accepts
+ *
+ * Sends straight out of the ring (zero-copy); a wrapped ring takes two
+ * send() calls. Leftovers wait for a writability event.
+ */
+static void service_write(NetIo* io, NetConnection* c, u32 slot) {
+    if (c->dead) return;
+
+    /* Nothing may go out ahead of the WebSocket handshake reply */
+    if (c->ws.state == WS_STATE_HANDSHAKE) return;
+
+    const u8* data;
+    u32 span;
+    while ((span = spsc_ring_peek_span(&c->outbound, &data)) > 0) {
+        i32 n = network_send(c->fd, data, span);
+        if (n > 0) {
+            metrics_add(&g_metrics.bytes_sent, (u64)n);
+            spsc_ring_consume(&c->outbound, (u32)n);
+            continue;
+        }
+        if (n < 0 && network_would_block()) break;
+        mark_dead(io, c);
+        return;
+    }
+
+    bool backed_up = spsc_ring_used(&c->outbound) > 0;
+    if (backed_up != c->want_write) {
+        network_watch(io->network, c->fd, slot, backed_up);
+        c->want_write = backed_up;
+    }
+}
+
+/*
+ * finish_close - Execute a close requested by the game thread
+ */
+static void finish_close(NetIo* io, NetConnection* c, u32 slot) {
+    /* Best effort: logout packets and the like are usually still queued */
+    service_write(io, c, slot);
+
+    network_unwatch(io->network, c->fd);
+    network_close_socket(c->fd);
+
+    c->fd = -1;
+    c->rx_size = 0;
+    c->pending_opcode = -1;
+    c->want_write = false;
+    c->dead = false;
+    memset(&c->ws, 0, sizeof(c->ws));
+    spsc_ring_reset(&c->inbound);
+    spsc_ring_reset(&c->outbound);
+    store_release(&c->framing, 0);
+    store_release(&c->flush_queued, 0);
+
+    /* Publish the emptied rings before the slot can be handed out again */
+    store_release(&c->state, NETCONN_FREE);
+}
+
+/*******************************************************************************
+ * NETWORK THREAD - CONTROL
+ ******************************************************************************/
+
+static void accept_all(NetIo* io, bool websocket) {
+    i32 fd;
+    while ((fd = websocket ? network_accept_websocket(io->network)
+                           : network_accept_connection(io->network)) >= 0) {
+        /* Find a FREE slot, starting after the last one handed out */
+        u32 slot = io->capacity;
+        for (u32 k = 0; k < io->capacity; k++) {
+            u32 s = (io->accept_cursor + k) % io->capacity;
+            if (load_acquire(&io->conns[s].state) == NETCONN_FREE) {
+                slot = s;
+                break;
+            }
+        }
+
+        u8 event[7] = { websocket ? NETIO_EVENT_CONNECT_WS : NETIO_EVENT_CONNECT,
+                        (u8)(slot >> 8), (u8)slot,
+                        (u8)(fd >> 24), (u8)(fd >> 16), (u8)(fd >> 8), (u8)fd };
+
+        if (slot == io->capacity || spsc_ring_free_space(&io->events) < sizeof(event)) {
+            network_close_socket(fd);
+            LOG_WARN("Server full, rejected connection\n");
+            continue;
+        }
+        if (!network_watch(io->network, fd, slot, false)) {
+            network_close_socket(fd);
+            LOG_WARN("Failed to watch socket fd=%d, rejected connection\n", fd);
+            continue;
+        }
+
+        /* Rings are allocated on first use and kept for the slot's lifetime */
+        NetConnection* c = &io->conns[slot];
+        if (!c->inbound.data &&
+            !(spsc_ring_init(&c->inbound, NETIO_INBOUND_RING) &&
+              spsc_ring_init(&c->outbound, NETIO_OUTBOUND_RING))) {
+            spsc_ring_free(&c->inbound);
+            network_unwatch(io->network, fd);
+            network_close_socket(fd);
+            LOG_ERROR("Out of memory for connection buffers, rejected connection\n");
+            continue;
+        }
+        c->fd = fd;
+        c->ws.state = websocket ? WS_STATE_HANDSHAKE : WS_STATE_NONE;
+        store_release(&c->state, NETCONN_OPEN);
+        spsc_ring_push(&io->events, event, sizeof(event));
+        io->accept_cursor = (slot + 1) % io->capacity;
+    }
+}
+
+static void handle_requests(NetIo* io) {
+    u8 req[3];
+    while (spsc_ring_pop(&io->requests, req, sizeof(req)) == sizeof(req)) {
+        u32 slot = ((u32)req[1] << 8) | req[2];
+        if (slot >= io->capacity) continue;
+        NetConnection* c = &io->conns[slot];
+
+        u32 state = load_acquire(&c->state);
+        if (state == NETCONN_CLOSING) {
+            finish_close(io, c, slot);
+        } else if (state == NETCONN_OPEN && req[0] == NETIO_REQUEST_FLUSH) {
+            store_release(&c->flush_queued, 0);
+            service_write(io, c, slot);
+        }
+    }
+
+    /* Fallback after a request-ring overflow: the state is authoritative */
+    if (exchange(&io->rescan, 0)) {
+        for (u32 slot = 0; slot < io->capacity; slot++) {
+            NetConnection* c = &io->conns[slot];
+            u32 state = load_acquire(&c->state);
+            if (state == NETCONN_CLOSING) {
+                finish_close(io, c, slot);
+            } else if (state == NETCONN_OPEN && spsc_ring_used(&c->outbound) > 0) {
+                store_release(&c->flush_queued, 0);
+                service_write(io, c, slot);
+            }
+        }
+    }
+}
+
+static void* netio_thread_main(void* arg) {
+    NetIo* io = (NetIo*)arg;
+    NetworkEvent events[NETWORK_MAX_EVENTS];
+
+    while (load_acquire(&io->running)) {
+        i32 count = network_wait(io->network, 1000, events, NETWORK_MAX_EVENTS);
+        bool pushed = false;
+
+        for (i32 e = 0; e < count; e++) {
+            u32 token = events[e].token;
+            if (token == NETWORK_TOKEN_LISTENER || token == NETWORK_TOKEN_WS_LISTENER) {
+                accept_all(io, token == NETWORK_TOKEN_WS_LISTENER);
+                pushed = true;
+            } else if (token == NETIO_TOKEN_WAKE) {
+                drain_pipe(io->net_wake[0], &io->net_signaled);
+            } else if (metrics_owns_token(token)) {
+                metrics_handle_event(&events[e]);
+            } else if (asset_http_owns_token(token)) {
+                asset_http_handle_event(&events[e]);
+            } else if (token < io->capacity) {
+                NetConnection* c = &io->conns[token];
+                if (load_acquire(&c->state) != NETCONN_OPEN) continue;
+                if (events[e].writable) service_write(io, c, token);
+                if (events[e].readable) {
+                    service_read(io, c, token);
+                    pushed = true;
+                }
+            }
+        }
+
+        /* Requests may arrive without a wake event winning the race */
+        handle_requests(io);
+
+        if (pushed) signal_pipe(io->game_wake[1], &io->game_signaled);
+    }
+    return NULL;
+}
+
+/*******************************************************************************
+ * LIFECYCLE
+ ******************************************************************************/
+
+bool netio_start(NetIo* io, NetworkServer* network, u32 capacity) {
+    if (!io || !network || capacity == 0 || capacity > 0xFFFF) return false;
+
+    memset(io, 0, sizeof(NetIo));
+    io->network = network;
+    io->capacity = capacity;
+    io->net_wake[0] = io->net_wake[1] = -1;
+    io->game_wake[0] = io->game_wake[1] = -1;
+
+    io->conns = (NetConnection*)calloc(capacity, sizeof(NetConnection));
+    if (!io->conns) return false;
+
+    bool ok = spsc_ring_init(&io->events, NETIO_CONTROL_RING) &&
+              spsc_ring_init(&io->requests, NETIO_CONTROL_RING) &&
+              make_pipe(io->net_wake) && make_pipe(io->game_wake);
+    for (u32 i = 0; ok && i < capacity; i++) {
+        NetConnection* c = &io->conns[i];
+        c->fd = -1;
+        c->pending_opcode = -1;
+    }
+    if (ok) ok = network_watch(network, io->net_wake[0], NETIO_TOKEN_WAKE, false);
+
+    pthread_t* thread = ok ? (pthread_t*)malloc(sizeof(pthread_t)) : NULL;
+    if (ok && thread) {
+        io->thread = thread;
+        store_release(&io->running, 1);
+
+        /*
+         * Block signals in the new thread so SIGINT/SIGTERM always land
+         * on the game thread (whose handler ends up joining this one).
+         */
+        sigset_t all, previous;
+        sigfillset(&all);
+        pthread_sigmask(SIG_BLOCK, &all, &previous);
+        int rc = pthread_create(thread, NULL, netio_thread_main, io);
+        pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+        if (rc != 0) {
+            store_release(&io->running, 0);
+            free(thread);
+            io->thread = NULL;
+            ok = false;
+        }
+    } else {
+        ok = false;
+    }
+
+    if (!ok) {
+        netio_stop(io);
+        return false;
+    }
+
+    g_netio = io;
+    printf("Network thread started (%u connection slots, %s)\n",
+           capacity, network_backend_name());
+    return true;
+}
+
+void netio_stop(NetIo* io) {
+    if (!io || io->capacity == 0) return;  /* Never started, or already stopped */
+    if (g_netio == io) g_netio = NULL;
+
+    if (io->thread) {
+        store_release(&io->running, 0);
+        signal_pipe(io->net_wake[1], &io->net_signaled);
+        pthread_join(*(pthread_t*)io->thread, NULL);
+        free(io->thread);
+        io->thread = NULL;
+    }
+
+    /* Thread is gone: this thread now owns every connection */
+    if (io->conns) {
+        for (u32 i = 0; i < io->capacity; i++) {
+            NetConnection* c = &io->conns[i];
+            if (c->fd >= 0) {
+                service_write(io, c, i);
+                network_unwatch(io->network, c->fd);
+                network_close_socket(c->fd);
+            }
+            spsc_ring_free(&c->inbound);
+            spsc_ring_free(&c->outbound);
+        }
+        free(io->conns);
+        io->conns = NULL;
+    }
+    spsc_ring_free(&io->events);
+    spsc_ring_free(&io->requests);
+
+    for (int k = 0; k < 2; k++) {
+        if (io->net_wake[k] >= 0) close(io->net_wake[k]);
+        if (io->game_wake[k] >= 0) close(io->game_wake[k]);
+        io->net_wake[k] = io->game_wake[k] = -1;
+    }
+    io->capacity = 0;
+}
+
+/*******************************************************************************
+ * GAME THREAD API
+ ******************************************************************************/
+
+void netio_wait(NetIo* io, i32 timeout_ms) {
+    if (timeout_ms < 0) timeout_ms = 0;
+
+    struct pollfd pfd;
+    pfd.fd = io->game_wake[0];
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    if (poll(&pfd, 1, timeout_ms) > 0) {
+        drain_pipe(io->game_wake[0], &io->game_signaled);
+    }
+}
+
+bool netio_next_connection(NetIo* io, u32* slot, i32* fd, bool* websocket) {
+    u8 event[7];
+    if (spsc_ring_used(&io->events) < sizeof(event)) return false;
+    spsc_ring_pop(&io->events, event, sizeof(event));
+
+    *websocket = event[0] == NETIO_EVENT_CONNECT_WS;
+    *slot = ((u32)event[1] << 8) | event[2];
+    *fd = (i32)(((u32)event[3] << 24) | ((u32)event[4] << 16) |
+                ((u32)event[5] << 8) | event[6]);
+    return true;
+}
+
+bool netio_next_record(NetIo* io, u32 slot, NetIoRecord* record, u8* scratch) {
+    SpscRing* ring = &io->conns[slot].inbound;
+
+    u8 header[NETIO_RECORD_HEADER];
+    if (spsc_ring_peek(ring, header, NETIO_RECORD_HEADER) < NETIO_RECORD_HEADER) return false;
+
+    record->kind = header[0];
+    record->opcode = header[1];
+    record->length = (u16)((header[2] << 8) | header[3]);
+
+    /* Records are pushed whole, so the payload is already there */
+    u32 total = NETIO_RECORD_HEADER + record->length;
+    const u8* span;
+    if (spsc_ring_peek_span(ring, &span) >= total) {
+        record->payload = span + NETIO_RECORD_HEADER;   /* Zero-copy */
+    } else {
+        /* Wraps around the end of the ring: linearize into scratch */
+        u8 tmp[NETIO_RECORD_HEADER + MAX_PACKET_SIZE];
+        u32 take = total <= sizeof(tmp) ? total : (u32)sizeof(tmp);
+        spsc_ring_peek(ring, tmp, take);
+        memcpy(scratch, tmp + NETIO_RECORD_HEADER, take - NETIO_RECORD_HEADER);
+        record->payload = scratch;
+    }
+    return true;
+}
+
+void netio_release_record(NetIo* io, u32 slot, const NetIoRecord* record) {
+    spsc_ring_consume(&io->conns[slot].inbound, NETIO_RECORD_HEADER + record->length);
+}
+
+void netio_begin_framing(NetIo* io, u32 slot, const ISAACCipher* cipher) {
+    NetConnection* c = &io->conns[slot];
+    c->in_cipher = *cipher;
+    c->pending_opcode = -1;
+    /* Cipher copy becomes visible before the flag that hands it over */
+    store_release(&c->framing, 1);
+}
+
+/*
+ * push_request - Queue a control request, falling back to a rescan
+ */
+static void push_request(NetIo* io, u8 op, u32 slot) {
+    u8 req[3] = { op, (u8)(slot >> 8), (u8)slot };
+    if (!spsc_ring_push(&io->requests, req, sizeof(req))) {
+        store_release(&io->rescan, 1);
+    }
+    io->game_pending = true;
+}
+
+i32 netio_send(NetIo* io, u32 slot, const u8* data, u32 len) {
+    NetConnection* c = &io->conns[slot];
+    if (load_acquire(&c->state) != NETCONN_OPEN) return -1;
+
+    u32 space = spsc_ring_free_space(&c->outbound);
+    u32 n = len < space ? len : space;
+    if (n > 0) {
+        spsc_ring_push(&c->outbound, data, n);
+        if (exchange(&c->flush_queued, 1) == 0) {
+            push_request(io, NETIO_REQUEST_FLUSH, slot);
+        }
+    }
+    return (i32)n;
+}
+
+u32 netio_backlog(NetIo* io, u32 slot) {
+    NetConnection* c = &io->conns[slot];
+    if (load_acquire(&c->state) != NETCONN_OPEN) return 0;
+    return spsc_ring_used(&c->outbound);
+}
+
+void netio_close(NetIo* io, u32 slot) {
+    NetConnection* c = &io->conns[slot];
+    if (load_acquire(&c->state) != NETCONN_OPEN) return;
+
+    store_release(&c->state, NETCONN_CLOSING);
+    push_request(io, NETIO_REQUEST_CLOSE, slot);
+}
+
+void netio_commit(NetIo* io) {
+    if (!io->game_pending) return;
+    io->game_pending = false;
+    signal_pipe(io->net_wake[1], &io->net_signaled);
+}
+
+#else /* _WIN32 */
+
+/*
+ * Windows: no network thread (pthreads unavailable with MSVC). The server
+ * stays on the single-threaded event loop; --net-thread reports failure.
+ */
+bool netio_start(NetIo* io, NetworkServer* network, u32 capacity) {
+    (void)io; (void)network; (void)capacity;
+    fprintf(stderr, "Network thread is not supported on this platform\n");
+    return false;
+}
+void netio_stop(NetIo* io) { (void)io; }
+void netio_wait(NetIo* io, i32 timeout_ms) { (void)io; (void)timeout_ms; }
+bool netio_next_connection(NetIo* io, u32* slot, i32* fd, bool* websocket) {
+    (void)io; (void)slot; (void)fd; (void)websocket;
+    return false;
+}
+bool netio_next_record(NetIo* io, u32 slot, NetIoRecord* record, u8* scratch) {
+    (void)io; (void)slot; (void)record; (void)scratch;
+    return false;
+}
+void netio_release_record(NetIo* io, u32 slot, const NetIoRecord* record) {
+    (void)io; (void)slot; (void)record;
+}
+void netio_begin_framing(NetIo* io, u32 slot, const ISAACCipher* cipher) {
+    (void)io; (void)slot; (void)cipher;
+}
+i32 netio_send(NetIo* io, u32 slot, const u8* data, u32 len) {
+    (void)io; (void)slot; (void)data; (void)len;
+    return -1;
+}
+u32 netio_backlog(NetIo* io, u32 slot) { (void)io; (void)slot; return 0; }
+void netio_close(NetIo* io, u32 slot) { (void)io; (void)slot; }
+void netio_commit(NetIo* io) { (void)io; }
+
+#endif /* _WIN32 */
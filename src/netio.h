@@ -0,0 +1,264 @@
+/*******************************************************************************
+ * NETIO.H - Network I/O Thread with Lock-Free Hand-off to the Game Thread
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Pipeline parallelism (I/O stage and game-logic stage on own threads)
+ *   - Lock-free message passing (one SPSC ring per direction per connection)
+ *   - Ownership hand-off (which thread may touch which field, and when)
+ *   - Wakeup signalling without busy-waiting (self-pipe trick)
+ *
+ * THE PIPELINE:
+ *
+ *   ┌─────────────────────────┐               ┌─────────────────────────┐
+ *   │     NETWORK THREAD      │               │       GAME THREAD       │
+ *   │                         │   inbound     │                         │
+ *   │ epoll/kqueue wait       │ ─────────────→│ dispatch packets        │
+ *   │ accept()                │  [records]    │ login handshake         │
+ *   │ recv() + frame split    │               │ world_process() (tick)  │
+ *   │ ISAAC opcode decode     │   outbound    │ encode packets          │
+ *   │ send() queued output    │ ←─────────────│ player_flush()          │
+ *   │                         │  [raw bytes]  │                         │
+ *   └─────────────────────────┘               └─────────────────────────┘
+ *           ↑  wake pipe (game → net)    wake pipe (net → game)  ↓
+ *
+ * Every arrow is a single-producer/single-consumer ring (spsc_ring.h), so
+ * neither thread ever takes a lock or waits for the other. A slow client
+ * can never stall a tick, and a long tick never stops sockets being read.
+ *
+ * INBOUND RECORDS (network → game, per connection):
+ *
+ *   [kind:1][opcode:1][length:2 BE][payload:length]
+ *
+ *   NETIO_RECORD_RAW     Bytes before login completes (game runs login.c)
+ *   NETIO_RECORD_PACKET  One complete game packet, opcode already decoded
+ *   NETIO_RECORD_CLOSED  Peer closed or socket failed (always last)
+ *
+ * FRAMING HAND-OFF:
+ *   Packet boundaries depend on the ISAAC-decoded opcode, and the cipher
+ *   is only seeded by the login handshake on the game thread. After a
+ *   successful login the game thread copies the seeded inbound cipher into
+ *   the connection and publishes it (netio_begin_framing); from then on the
+ *   network thread owns that cipher and splits frames itself. Until then it
+ *   forwards RAW bytes. The client sends nothing between its login block
+ *   and our login response, and the response is queued after publishing,
+ *   so no byte is ever framed with the wrong state.
+ *
+ * CONNECTION LIFECYCLE (conn->state, slot index == player slot):
+ *
+ *   FREE ──accept (net)──→ OPEN ──netio_close (game)──→ CLOSING ──(net)──┐
+ *    ↑                                                                   │
+ *    └────────────── socket closed, rings emptied (net) ─────────────────┘
+ *
+ *   The game thread learns about new connections through a CONNECT event
+ *   and only touches a connection's rings between that event and its own
+ *   netio_close(). The network thread only closes the descriptor after the
+ *   game thread asked for it, so a descriptor number is never reused while
+ *   the game thread still refers to it.
+ *
+ * SELECTING THE MODE:
+ *   The network thread is started with the --net-thread command-line flag
+ *   (POSIX only). Without it the server keeps the single-threaded event
+ *   loop in server_run(). Packet handlers are identical in both modes.
+ *
+ ******************************************************************************/
+
+#ifndef NETIO_H
+#define NETIO_H
+
+#include "types.h"
+#include "network.h"
+#include "spsc_ring.h"
+#include "isaac.h"
+#include "websocket.h"
+#include <stdbool.h>
+
+/*
+ * Per-connection ring sizes (powers of two). Allocated when a slot first
+ * accepts a connection and reused afterwards, so memory grows with peak
+ * concurrent connections rather than MAX_PLAYERS.
+ */
+#define NETIO_INBOUND_RING   (64 * 1024)    /* Decoded packets awaiting dispatch */
+#define NETIO_OUTBOUND_RING  (128 * 1024)   /* Encoded bytes awaiting send() */
+#define NETIO_CONTROL_RING   (16 * 1024)    /* Connect events / close requests */
+
+/* Bytes in an inbound record header */
+#define NETIO_RECORD_HEADER 4
+
+typedef enum {
+    NETIO_RECORD_RAW    = 0,
+    NETIO_RECORD_PACKET = 1,
+    NETIO_RECORD_CLOSED = 2
+} NetIoRecordKind;
+
+typedef enum {
+    NETCONN_FREE    = 0,
+    NETCONN_OPEN    = 1,
+    NETCONN_CLOSING = 2
+} NetConnState;
+
+/*
+ * NetConnection - One client socket as seen by both threads
+ *
+ * OWNERSHIP:
+ *   shared (atomic):   state, framing, flush_queued
+ *   ring endpoints:    inbound  (net produces, game consumes)
+ *                      outbound (game produces, net consumes)
+ *   network thread:    everything else
+ */
+typedef struct {
+    u32 state;              /* NetConnState */
+    u32 framing;            /* 1 once in_cipher has been published */
+    u32 flush_queued;       /* Outbound flush request pending */
+    SpscRing inbound;
+    SpscRing outbound;
+
+    i32 fd;                 /* Client socket */
+    ISAACCipher in_cipher;  /* Opcode cipher (valid once framing) */
+    i32 pending_opcode;     /* Decoded opcode of a partial packet, or -1 */
+    u8 rx[MAX_PACKET_SIZE]; /* Received bytes not yet framed */
+    u32 rx_size;
+    bool want_write;        /* Socket watched for writability */
+    bool dead;              /* CLOSED record sent; stop reading/writing */
+    WsConn ws;              /* WebSocket layer, if accepted on the ws port */
+} NetConnection;
+
+/*
+ * NetIoRecord - One inbound record, as returned by netio_next_record()
+ */
+typedef struct {
+    u8 kind;                /* NetIoRecordKind */
+    u8 opcode;              /* PACKET only */
+    u16 length;             /* Payload bytes */
+    const u8* payload;      /* Points into the ring or the caller's scratch */
+} NetIoRecord;
+
+/*
+ * NetIo - Network thread state (one per server)
+ */
+typedef struct {
+    NetworkServer* network;      /* Listener + event backend (net thread only) */
+    NetConnection* conns;        /* [capacity], indexed by player slot */
+    u32 capacity;
+    u32 accept_cursor;           /* Next slot to try when accepting */
+
+    SpscRing events;             /* net → game: CONNECT notifications */
+    SpscRing requests;           /* game → net: flush / close requests */
+    u32 rescan;                  /* Request ring overflowed: scan all conns */
+
+    i32 net_wake[2];             /* Pipe: game wakes the network thread */
+    i32 game_wake[2];            /* Pipe: network thread wakes the game */
+    u32 net_signaled;            /* A byte is already in net_wake */
+    u32 game_signaled;           /* A byte is already in game_wake */
+    bool game_pending;           /* Game queued work since last netio_commit */
+
+    u32 running;
+    void* thread;                /* pthread_t (opaque to keep this header portable) */
+} NetIo;
+
+/*
+ * g_netio - Active network thread, or NULL in single-threaded mode
+ *
+ * player.c uses this to route output and socket closes through the
+ * network thread instead of calling send()/close() directly.
+ */
+extern NetIo* g_netio;
+
+/*
+ * netio_start - Create rings and start the network thread
+ *
+ * @param io        Zeroed NetIo to initialize
+ * @param network   Initialized listener (ownership of its event backend
+ *                  passes to the network thread)
+ * @param capacity  Number of connection slots (MAX_PLAYERS)
+ * @return          true on success; sets g_netio
+ */
+bool netio_start(NetIo* io, NetworkServer* network, u32 capacity);
+
+/*
+ * netio_stop - Stop the thread, close every socket and free all rings
+ *
+ * Safe to call more than once. Clears g_netio.
+ */
+void netio_stop(NetIo* io);
+
+/* ---- Game thread API ---- */
+
+/*
+ * netio_wait - Sleep until the network thread has news or timeout
+ *
+ * @param timeout_ms  Maximum wait (time left until the next tick)
+ */
+void netio_wait(NetIo* io, i32 timeout_ms);
+
+/*
+ * netio_next_connection - Pop one newly accepted connection
+ *
+ * @param slot       Receives the connection/player slot
+ * @param fd         Receives the socket descriptor (for logging / identity)
+ * @param websocket  Receives whether it came in on the WebSocket port
+ *                   (its output must be framed, websocket.h; the network
+ *                   thread already unframes its input)
+ * @return           false when there are no more
+ */
+bool netio_next_connection(NetIo* io, u32* slot, i32* fd, bool* websocket);
+
+/*
+ * netio_next_record - Look at the next inbound record of a connection
+ *
+ * @param scratch  MAX_PACKET_SIZE buffer, used only if the record wraps
+ *                 around the end of the ring (otherwise zero-copy)
+ * @return         false if nothing is queued
+ *
+ * The record stays queued until netio_release_record(). Do not release
+ * it if the player was disconnected while handling it.
+ */
+bool netio_next_record(NetIo* io, u32 slot, NetIoRecord* record, u8* scratch);
+
+/*
+ * netio_release_record - Consume the record returned by netio_next_record
+ */
+void netio_release_record(NetIo* io, u32 slot, const NetIoRecord* record);
+
+/*
+ * netio_begin_framing - Hand the seeded inbound cipher to the network thread
+ *
+ * Called once, right after a successful login. The game thread must not
+ * use its own copy of the cipher afterwards.
+ */
+void netio_begin_framing(NetIo* io, u32 slot, const ISAACCipher* cipher);
+
+/*
+ * netio_send - Queue encoded bytes for the network thread to write
+ *
+ * @return  Bytes accepted (may be less than len if the ring is full),
+ *          or -1 if the connection is no longer open
+ */
+i32 netio_send(NetIo* io, u32 slot, const u8* data, u32 len);
+
+/*
+ * netio_backlog - Bytes in a connection's outbound ring, not yet written
+ *
+ * Game thread only (it is the ring's producer, so the count can only
+ * shrink while it looks).
+ */
+u32 netio_backlog(NetIo* io, u32 slot);
+
+/*
+ * netio_close - Ask the network thread to flush and close a connection
+ *
+ * The game thread must not touch the connection again until a new
+ * CONNECT event hands the slot back.
+ */
+void netio_close(NetIo* io, u32 slot);
+
+/*
+ * netio_commit - Wake the network thread if anything was queued
+ *
+ * Called once per game loop iteration after flushing, so a burst of
+ * sends costs a single wakeup.
+ */
+void netio_commit(NetIo* io);
+
+#endif /* NETIO_H */
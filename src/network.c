@@ -33,7 +33,10 @@
 
 #include "network.h"
 #include <string.h>
-#include <stdio.h>   /* for printf in dump_hex */
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>  /* realloc/free for the poll() interest list */
+#include <stdint.h>  /* uintptr_t for kqueue udata tokens */
 
 /* Platform-specific headers */
 #ifdef _WIN32
@@ -45,42 +48,66 @@
     /* POSIX Sockets (Linux, macOS, BSD) */
     #include <sys/socket.h> /* socket, bind, listen, accept, recv, send */
     #include <netinet/in.h> /* sockaddr_in, INADDR_ANY, htons */
+    #include <netinet/tcp.h> /* TCP_NODELAY */
     #include <fcntl.h>      /* fcntl for non-blocking mode */
     #include <unistd.h>     /* close */
+    #include <errno.h>      /* errno, EAGAIN, EWOULDBLOCK */
 #endif
 
-/*******************************************************************************
- * DEBUG UTILITIES
- ******************************************************************************/
+/*
+ * Event backend selection (see EVENT NOTIFICATION in network.h)
+ */
+#if defined(__linux__) && !defined(NETWORK_USE_POLL)
+    #define NETWORK_BACKEND_EPOLL
+    #include <sys/epoll.h>
+#elif (defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || \
+       defined(__NetBSD__) || defined(__DragonFly__)) && !defined(NETWORK_USE_POLL)
+    #define NETWORK_BACKEND_KQUEUE
+    #include <sys/types.h>
+    #include <sys/event.h>
+    #include <sys/time.h>
+#else
+    #define NETWORK_BACKEND_POLL
+    #ifdef _WIN32
+        typedef WSAPOLLFD NetPollFd;
+        #define net_poll(set, count, timeout) WSAPoll((set), (ULONG)(count), (timeout))
+    #else
+        #include <poll.h>
+        typedef struct pollfd NetPollFd;
+        #define net_poll(set, count, timeout) poll((set), (nfds_t)(count), (timeout))
+    #endif
+#endif
+
+SocketProfile g_socket_profile = { true, 0, 0, NETWORK_LISTEN_BACKLOG };
 
 /*
- * dump_hex - Print byte array as hexadecimal (for protocol debugging)
- * 
- * @param tag   Descriptive label (e.g., "TX", "RX")
- * @param data  Byte array to dump
- * @param len   Number of bytes to print
- * 
- * OUTPUT FORMAT:
- *   [HEX] TX len=10: 01 02 03 04 05 06 07 08 09 0A
- * 
- * USE CASES:
- *   - Verify packet structure during development
- *   - Debug protocol mismatches (compare with expected bytes)
- *   - Analyze captured network traffic (e.g., Wireshark dumps)
- * 
- * EXAMPLE:
- *   u8 packet[] = {0x01, 0x02, 0x03};
- *   dump_hex("SEND", packet, 3);
- *   // Output: [HEX] SEND len=3: 01 02 03
- * 
- * COMPLEXITY: O(len) time
+ * set_buffer_sizes - The profile's SO_SNDBUF / SO_RCVBUF on a game listener
+ *
+ * Best effort: the kernel clamps (and on Linux doubles) the value, and a
+ * refusal only leaves the default in place.
+ */
+static void set_buffer_sizes(i32 fd) {
+    int size;
+    if (g_socket_profile.send_buffer > 0) {
+        size = (int)g_socket_profile.send_buffer;
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, (char*)&size, sizeof(size));
+    }
+    if (g_socket_profile.recv_buffer > 0) {
+        size = (int)g_socket_profile.recv_buffer;
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, (char*)&size, sizeof(size));
+    }
+}
+
+/*
+ * accept_game_socket - network_accept() plus the profile's TCP_NODELAY
  */
-static void dump_hex(const char* tag, const u8* data, u32 len) {
-    printf("[HEX] %s len=%u: ", tag, len);
-    for (u32 i = 0; i < len; ++i) {
-        printf("%02X ", data[i]);  /* %02X = 2-digit hex with leading zero */
+static i32 accept_game_socket(i32 listen_fd) {
+    i32 fd = network_accept(listen_fd);
+    if (fd >= 0 && g_socket_profile.nodelay) {
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (char*)&on, sizeof(on));
     }
-    printf("\n");
+    return fd;
 }
 
 /*******************************************************************************
@@ -100,7 +127,7 @@ static void dump_hex(const char* tag, const u8* data, u32 len) {
  *   3. Set SO_REUSEADDR option (allows immediate port reuse)
  *   4. Set non-blocking mode (fcntl/ioctlsocket)
  *   5. Bind socket to 0.0.0.0:port (all network interfaces)
- *   6. Start listening with backlog=10 (queue 10 pending connections)
+ *   6. Start listening (backlog from g_socket_profile, default 1024)
  *   7. Mark server as running
  * 
  * DETAILED STEPS:
@@ -285,11 +312,11 @@ static void dump_hex(const char* tag, const u8* data, u32 len) {
  * 
  * STEP 6: START LISTENING
  * ──────────────────────────────────────────────────────────────────
- * listen(server_fd, 10)
+ * listen(server_fd, g_socket_profile.backlog)
  * 
  * Purpose: Mark socket as passive (accepting connections)
  * 
- * Backlog parameter (10):
+ * Backlog parameter (NETWORK_LISTEN_BACKLOG = 1024 unless configured):
  *   Maximum length of pending connection queue
  *   
  *   When client calls connect():
@@ -297,19 +324,21 @@ static void dump_hex(const char* tag, const u8* data, u32 len) {
  *     2. Connection enters queue
  *     3. Waits for server to accept()
  *   
- *   If queue full (10 pending connections):
+ *   If queue full:
  *     - New SYN packets are ignored/dropped
  *     - Client connect() times out
  *   
  *   Typical values:
  *     Small servers: 5-10
  *     Web servers:   128-1024
+ *     Here:          1024 - a restarted world gets every client back at
+ *                    once (see SOCKET PROFILE in network.h)
  * 
  * LISTEN QUEUE DIAGRAM:
  * ┌────────────────────────────────────────────────────────────┐
  * │ Server Socket (LISTEN state):                              │
  * │                                                            │
- * │  Pending Connection Queue (max 10):                        │
+ * │  Pending Connection Queue (max backlog):                   │
  * │  ┌─────────┬─────────┬─────────┬─────────┬─────┐           │
  * │  │Client 1 │Client 2 │Client 3 │  ...    │Empty│           │
  * │  └─────────┴─────────┴─────────┴─────────┴─────┘           │
@@ -343,6 +372,13 @@ bool network_init(NetworkServer* server, u16 port) {
     /* Store port and initialize state */
     server->port = port;
     server->running = false;
+    server->server_fd = -1;
+    server->ws_fd = -1;
+    server->poll_fd = -1;
+    server->poll_set = NULL;
+    server->poll_tokens = NULL;
+    server->poll_count = 0;
+    server->poll_capacity = 0;
 
 #ifdef _WIN32
     /*
@@ -397,6 +433,9 @@ bool network_init(NetworkServer* server, u16 port) {
 #endif
         return false;
     }
+    
+    /* Buffer sizes from the socket profile, inherited by accepted sockets */
+    set_buffer_sizes(server->server_fd);
 
     /*
      * STEP 3: Set non-blocking mode
@@ -456,9 +495,9 @@ bool network_init(NetworkServer* server, u16 port) {
      * STEP 6: Start listening for connections
      * 
      * Marks socket as passive (accepting connections).
-     * Creates queue for pending connections (backlog=10).
+     * Creates queue for pending connections (g_socket_profile.backlog).
      */
-    if (listen(server->server_fd, 10) < 0) {
+    if (listen(server->server_fd, g_socket_profile.backlog) < 0) {
         /* listen() failed (socket not bound, etc.) */
 #ifdef _WIN32
         closesocket(server->server_fd);
@@ -472,10 +511,57 @@ bool network_init(NetworkServer* server, u16 port) {
     /*
      * Success: Server is ready to accept connections
      */
+    /*
+     * Create the readiness-notification handle and watch the listener
+     * so network_wait() wakes up for incoming connections.
+     */
+#if defined(NETWORK_BACKEND_EPOLL)
+    server->poll_fd = epoll_create1(0);
+#elif defined(NETWORK_BACKEND_KQUEUE)
+    server->poll_fd = kqueue();
+#endif
+#ifndef NETWORK_BACKEND_POLL
+    if (server->poll_fd < 0) {
+        close(server->server_fd);
+        server->server_fd = -1;
+        return false;
+    }
+#endif
+    if (!network_watch(server, server->server_fd, NETWORK_TOKEN_LISTENER, false)) {
+        network_shutdown(server);
+        return false;
+    }
+
     server->running = true;
     return true;
 }
 
+i32 network_listen(u16 port) {
+    i32 fd = (i32)socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    
+    int opt = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, (char*)&opt, sizeof(opt));
+#ifdef _WIN32
+    u_long mode = 1;
+    ioctlsocket(fd, FIONBIO, &mode);
+#else
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+#endif
+    
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons(port);
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+        listen(fd, g_socket_profile.backlog) < 0) {
+        network_close_socket(fd);
+        return -1;
+    }
+    return fd;
+}
+
 /*******************************************************************************
  * SERVER SHUTDOWN
  ******************************************************************************/
@@ -517,6 +603,11 @@ bool network_init(NetworkServer* server, u16 port) {
  * COMPLEXITY: O(1) time
  */
 void network_shutdown(NetworkServer* server) {
+    if (server->ws_fd >= 0) {
+        network_close_socket(server->ws_fd);
+        server->ws_fd = -1;
+    }
+    
     /* Close listening socket if valid */
     if (server->server_fd >= 0) {
 #ifdef _WIN32
@@ -527,6 +618,20 @@ void network_shutdown(NetworkServer* server) {
         server->server_fd = -1;  /* Mark as invalid */
     }
     
+    /* Release the event backend */
+#ifndef NETWORK_BACKEND_POLL
+    if (server->poll_fd >= 0) {
+        close(server->poll_fd);
+        server->poll_fd = -1;
+    }
+#endif
+    free(server->poll_set);
+    free(server->poll_tokens);
+    server->poll_set = NULL;
+    server->poll_tokens = NULL;
+    server->poll_count = 0;
+    server->poll_capacity = 0;
+    
     /* Mark server as stopped */
     server->running = false;
     
@@ -539,6 +644,33 @@ void network_shutdown(NetworkServer* server) {
 #endif
 }
 
+/*
+ * network_stop_listening - Close the game listener, keep everything else
+ * 
+ * @param server  Pointer to initialized NetworkServer
+ * 
+ * First step of a shutdown: connections arriving while the players are
+ * saved are refused at once (RST) instead of sitting in the accept
+ * backlog until the process exits. Client sockets, the event backend and
+ * Winsock stay up for the logout packets; network_shutdown() releases
+ * them later and skips the listener.
+ * 
+ * Only call while no other thread waits on the event set (netio.h).
+ * 
+ * COMPLEXITY: O(1) time
+ */
+void network_stop_listening(NetworkServer* server) {
+    if (server->ws_fd >= 0) {
+        network_unwatch(server, server->ws_fd);
+        network_close_socket(server->ws_fd);
+        server->ws_fd = -1;
+    }
+    if (server->server_fd < 0) return;
+    network_unwatch(server, server->server_fd);
+    network_close_socket(server->server_fd);
+    server->server_fd = -1;
+}
+
 /*******************************************************************************
  * CONNECTION MANAGEMENT
  ******************************************************************************/
@@ -660,7 +792,7 @@ void network_shutdown(NetworkServer* server) {
  * 
  * COMPLEXITY: O(1) time
  */
-i32 network_accept_connection(NetworkServer* server) {
+i32 network_accept(i32 listen_fd) {
     /*
      * Prepare client address structure (filled by accept)
      */
@@ -677,7 +809,7 @@ i32 network_accept_connection(NetworkServer* server) {
      * 
      * Non-blocking: Returns immediately even if no connections pending
      */
-    i32 client_fd = accept(server->server_fd, (struct sockaddr*)&client_addr, &client_len);
+    i32 client_fd = accept(listen_fd, (struct sockaddr*)&client_addr, &client_len);
     
     if (client_fd >= 0) {
         /*
@@ -696,6 +828,26 @@ i32 network_accept_connection(NetworkServer* server) {
     return client_fd;
 }
 
+i32 network_accept_connection(NetworkServer* server) {
+    return accept_game_socket(server->server_fd);
+}
+
+bool network_listen_websocket(NetworkServer* server, u16 port) {
+    i32 fd = network_listen(port);
+    if (fd < 0) return false;
+    set_buffer_sizes(fd);
+    if (!network_watch(server, fd, NETWORK_TOKEN_WS_LISTENER, false)) {
+        network_close_socket(fd);
+        return false;
+    }
+    server->ws_fd = fd;
+    return true;
+}
+
+i32 network_accept_websocket(NetworkServer* server) {
+    return server->ws_fd >= 0 ? accept_game_socket(server->ws_fd) : -1;
+}
+
 /*******************************************************************************
  * DATA TRANSFER
  ******************************************************************************/
@@ -947,8 +1099,9 @@ i32 network_receive(i32 socket_fd, u8* buffer, u32 length) {
  *     - send() may return EAGAIN
  *     - Waits for window update from receiver
  * 
- * HEX DUMP (Debug Feature):
- *   Before sending, this function dumps bytes as hex:
+ * HEX DUMP (Debug Feature, --log=net):
+ *   Before sending, this function dumps bytes as hex (LOG_HEX, off
+ *   unless the net subsystem is enabled at run time):
  *   
  *   [HEX] TX len=10: 01 02 03 04 05 06 07 08 09 0A
  *   
@@ -975,10 +1128,10 @@ i32 network_receive(i32 socket_fd, u8* buffer, u32 length) {
  */
 i32 network_send(i32 socket_fd, const u8* buffer, u32 length) {
     /*
-     * Debug: Dump transmitted bytes as hex
+     * Debug: Dump transmitted bytes as hex (--log=net)
      * Helps verify packet structure during development
      */
-    dump_hex("TX", buffer, length);
+    LOG_HEX(LOG_NET, "TX", buffer, length);
 
     /*
      * send() copies data to kernel TCP send buffer
@@ -994,6 +1147,196 @@ i32 network_send(i32 socket_fd, const u8* buffer, u32 length) {
     return send(socket_fd, (const char*)buffer, length, 0);
 }
 
+bool network_would_block(void) {
+#ifdef _WIN32
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+}
+
+/*******************************************************************************
+ * EVENT NOTIFICATION
+ ******************************************************************************/
+
+const char* network_backend_name(void) {
+#if defined(NETWORK_BACKEND_EPOLL)
+    return "epoll";
+#elif defined(NETWORK_BACKEND_KQUEUE)
+    return "kqueue";
+#elif defined(_WIN32)
+    return "WSAPoll";
+#else
+    return "poll";
+#endif
+}
+
+#ifdef NETWORK_BACKEND_POLL
+/*
+ * poll_remove_at - Drop entry i from the poll() interest list
+ * 
+ * Swaps the last entry into the hole: O(1), order does not matter.
+ */
+static void poll_remove_at(NetworkServer* server, u32 i) {
+    NetPollFd* set = (NetPollFd*)server->poll_set;
+    u32 last = --server->poll_count;
+    if (i != last) {
+        set[i] = set[last];
+        server->poll_tokens[i] = server->poll_tokens[last];
+    }
+}
+#endif
+
+bool network_watch(NetworkServer* server, i32 socket_fd, u32 token, bool want_write) {
+    if (!server || socket_fd < 0) return false;
+
+#if defined(NETWORK_BACKEND_EPOLL)
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | (want_write ? EPOLLOUT : 0);
+    ev.data.u32 = token;
+
+    /* MOD first: updating interest is the common call after registration */
+    if (epoll_ctl(server->poll_fd, EPOLL_CTL_MOD, socket_fd, &ev) == 0) return true;
+    if (errno != ENOENT) return false;
+    return epoll_ctl(server->poll_fd, EPOLL_CTL_ADD, socket_fd, &ev) == 0;
+
+#elif defined(NETWORK_BACKEND_KQUEUE)
+    struct kevent change;
+    void* udata = (void*)(uintptr_t)token;
+
+    EV_SET(&change, socket_fd, EVFILT_READ, EV_ADD, 0, 0, udata);
+    if (kevent(server->poll_fd, &change, 1, NULL, 0, NULL) < 0) return false;
+
+    /* Write filter: add or delete (ENOENT on a delete is harmless) */
+    EV_SET(&change, socket_fd, EVFILT_WRITE, want_write ? EV_ADD : EV_DELETE, 0, 0, udata);
+    if (kevent(server->poll_fd, &change, 1, NULL, 0, NULL) < 0 && want_write) return false;
+    return true;
+
+#else
+    NetPollFd* set = (NetPollFd*)server->poll_set;
+    short wanted = (short)(POLLIN | (want_write ? POLLOUT : 0));
+
+    /* Existing entry (or a stale one for a reused descriptor number) */
+    for (u32 i = 0; i < server->poll_count; i++) {
+        if ((i32)set[i].fd == socket_fd) {
+            set[i].events = wanted;
+            server->poll_tokens[i] = token;
+            return true;
+        }
+    }
+
+    if (server->poll_count == server->poll_capacity) {
+        u32 cap = server->poll_capacity ? server->poll_capacity * 2 : 64;
+        NetPollFd* nset = (NetPollFd*)realloc(server->poll_set, cap * sizeof(NetPollFd));
+        if (!nset) return false;
+        server->poll_set = nset;
+        u32* ntok = (u32*)realloc(server->poll_tokens, cap * sizeof(u32));
+        if (!ntok) return false;
+        server->poll_tokens = ntok;
+        server->poll_capacity = cap;
+        set = nset;
+    }
+
+    set[server->poll_count].fd = socket_fd;
+    set[server->poll_count].events = wanted;
+    set[server->poll_count].revents = 0;
+    server->poll_tokens[server->poll_count] = token;
+    server->poll_count++;
+    return true;
+#endif
+}
+
+void network_unwatch(NetworkServer* server, i32 socket_fd) {
+    if (!server || socket_fd < 0) return;
+
+#if defined(NETWORK_BACKEND_EPOLL)
+    struct epoll_event ev;  /* Ignored, but required by pre-2.6.9 kernels */
+    memset(&ev, 0, sizeof(ev));
+    epoll_ctl(server->poll_fd, EPOLL_CTL_DEL, socket_fd, &ev);
+
+#elif defined(NETWORK_BACKEND_KQUEUE)
+    struct kevent change;
+    EV_SET(&change, socket_fd, EVFILT_READ, EV_DELETE, 0, 0, NULL);
+    kevent(server->poll_fd, &change, 1, NULL, 0, NULL);
+    EV_SET(&change, socket_fd, EVFILT_WRITE, EV_DELETE, 0, 0, NULL);
+    kevent(server->poll_fd, &change, 1, NULL, 0, NULL);
+
+#else
+    NetPollFd* set = (NetPollFd*)server->poll_set;
+    for (u32 i = 0; i < server->poll_count; i++) {
+        if ((i32)set[i].fd == socket_fd) {
+            poll_remove_at(server, i);
+            return;
+        }
+    }
+#endif
+}
+
+i32 network_wait(NetworkServer* server, i32 timeout_ms, NetworkEvent* events, u32 max_events) {
+    if (!server || !events || max_events == 0) return 0;
+    if (max_events > NETWORK_MAX_EVENTS) max_events = NETWORK_MAX_EVENTS;
+    if (timeout_ms < 0) timeout_ms = 0;
+
+#if defined(NETWORK_BACKEND_EPOLL)
+    struct epoll_event ready[NETWORK_MAX_EVENTS];
+    i32 n = epoll_wait(server->poll_fd, ready, (int)max_events, timeout_ms);
+    if (n < 0) return 0;  /* EINTR (signal) - caller re-checks running flag */
+
+    for (i32 i = 0; i < n; i++) {
+        events[i].token = ready[i].data.u32;
+        /* Hangup/error are reported as readable: recv() then sees 0 / -1 */
+        events[i].readable = (ready[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) != 0;
+        events[i].writable = (ready[i].events & EPOLLOUT) != 0;
+    }
+    return n;
+
+#elif defined(NETWORK_BACKEND_KQUEUE)
+    struct kevent ready[NETWORK_MAX_EVENTS];
+    struct timespec ts;
+    ts.tv_sec = timeout_ms / 1000;
+    ts.tv_nsec = (long)(timeout_ms % 1000) * 1000000L;
+
+    i32 n = kevent(server->poll_fd, NULL, 0, ready, (int)max_events, &ts);
+    if (n < 0) return 0;
+
+    for (i32 i = 0; i < n; i++) {
+        events[i].token = (u32)(uintptr_t)ready[i].udata;
+        events[i].readable = ready[i].filter == EVFILT_READ || (ready[i].flags & EV_EOF);
+        events[i].writable = ready[i].filter == EVFILT_WRITE;
+    }
+    return n;
+
+#else
+    NetPollFd* set = (NetPollFd*)server->poll_set;
+    if (server->poll_count == 0) return 0;
+
+    i32 n = net_poll(set, server->poll_count, timeout_ms);
+    if (n <= 0) return 0;
+
+    u32 count = 0;
+    u32 i = 0;
+    while (i < server->poll_count && count < max_events) {
+        short re = set[i].revents;
+        set[i].revents = 0;
+
+        if (re & POLLNVAL) {
+            /* Descriptor was closed without unregistering - prune it */
+            poll_remove_at(server, i);
+            continue;  /* Re-examine the entry swapped into slot i */
+        }
+        if (re & (POLLIN | POLLHUP | POLLERR | POLLOUT)) {
+            events[count].token = server->poll_tokens[i];
+            events[count].readable = (re & (POLLIN | POLLHUP | POLLERR)) != 0;
+            events[count].writable = (re & POLLOUT) != 0;
+            count++;
+        }
+        i++;
+    }
+    return (i32)count;
+#endif
+}
+
 /*******************************************************************************
  * SOCKET CLEANUP
  ******************************************************************************/
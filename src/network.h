@@ -252,12 +252,20 @@
  *               true: Accepting connections
  *               false: Shutting down or not initialized
  * 
- * MEMORY LAYOUT:
+ *   poll_fd:    Readiness-notification handle (see EVENT NOTIFICATION)
+ *               Linux: epoll instance    BSD/macOS: kqueue instance
+ *               -1 when the portable poll()/WSAPoll() backend is used
+ * 
+ *   poll_set, poll_tokens, poll_count, poll_capacity:
+ *               Interest list of the poll()/WSAPoll() backend only
+ *               (pollfd array + parallel token array, grown on demand)
+ * 
+ * MEMORY LAYOUT (first 8 bytes):
  * ┌────────────────────┬────────────────────┬────────────────────┐
  * │ i32 server_fd      │ u16 port           │ bool running       │
  * │ (4 bytes)          │ (2 bytes)          │ (1 byte + 1 pad)   │
  * └────────────────────┴────────────────────┴────────────────────┘
- * Total: 8 bytes (with padding for alignment)
+ * followed by the event backend fields
  * 
  * INVARIANTS:
  *   - If running == true, then server_fd >= 0
@@ -271,8 +279,84 @@ typedef struct {
     i32  server_fd;  /* Listening socket file descriptor */
     u16  port;       /* TCP port number (e.g., 43594) */
     bool running;    /* true if server is active */
+    i32  ws_fd;      /* WebSocket listener (websocket.h), -1 if none */
+    
+    i32   poll_fd;        /* epoll/kqueue handle, -1 for poll() backend */
+    void* poll_set;       /* poll() backend: struct pollfd[poll_capacity] */
+    u32*  poll_tokens;    /* poll() backend: token per poll_set entry */
+    u32   poll_count;     /* poll() backend: entries in use */
+    u32   poll_capacity;  /* poll() backend: entries allocated */
 } NetworkServer;
 
+/*
+ * NetworkEvent - One socket readiness notification from network_wait()
+ * 
+ * token:    Value given to network_watch() (player slot index), or
+ *           NETWORK_TOKEN_LISTENER for the listening socket
+ * readable: Data, a pending connection, or a hangup/error to collect
+ *           (recv/accept will not block)
+ * writable: Kernel send buffer has room again (only reported while
+ *           network_watch(..., want_write=true) is in effect)
+ */
+typedef struct {
+    u32  token;
+    bool readable;
+    bool writable;
+} NetworkEvent;
+
+/* Token reported for the listening socket */
+#define NETWORK_TOKEN_LISTENER 0xFFFFFFFFu
+
+/* Token reported for the WebSocket listener (0xFFFFFFFE is netio's wake pipe) */
+#define NETWORK_TOKEN_WS_LISTENER 0xFFFFFFFDu
+
+/* Upper bound on events returned by one network_wait() call */
+#define NETWORK_MAX_EVENTS 256
+
+/*******************************************************************************
+ * SOCKET PROFILE - Options for the game's listeners and client sockets
+ *******************************************************************************
+ * 
+ * TCP_NODELAY:
+ *   Nagle's algorithm holds a small segment back until the previous one
+ *   is acknowledged, so it can coalesce it with more data. The server
+ *   already coalesces: a connection's whole tick of packets leaves in one
+ *   send() (player_flush). Nagle could then only hold that write back by
+ *   a round trip (up to the peer's delayed-ACK timer, ~40 ms on Linux).
+ *   It is switched off on every game socket.
+ * 
+ * SO_SNDBUF / SO_RCVBUF:
+ *   0 leaves the kernel's autotuning alone. A fixed size caps how much a
+ *   stalled client can hold in the kernel before our own backlog
+ *   (PLAYER_OUT_HIGH_WATER, player.h) sees it. They are set on the
+ *   listener, which the accepted sockets inherit them from: the receive
+ *   window scale is fixed in the SYN-ACK, before accept() returns.
+ * 
+ * LISTEN BACKLOG:
+ *   Completed handshakes waiting for accept(). When a world restarts,
+ *   every client reconnects within a second or two. With 10 slots most
+ *   of their SYNs were dropped and retried after 1, 3 and 7 seconds. The
+ *   kernel caps the value (net.core.somaxconn).
+ * 
+ * Side services (the metrics port) use the kernel defaults and only
+ * share the backlog.
+ ******************************************************************************/
+
+/* listen() backlog unless --listen-backlog says otherwise */
+#define NETWORK_LISTEN_BACKLOG 1024
+
+/*
+ * SocketProfile - Set from the command line before network_init()
+ */
+typedef struct {
+    bool nodelay;       /* TCP_NODELAY on accepted game sockets */
+    u32 send_buffer;    /* SO_SNDBUF bytes, 0 = kernel default (--sndbuf KB) */
+    u32 recv_buffer;    /* SO_RCVBUF bytes, 0 = kernel default (--rcvbuf KB) */
+    i32 backlog;        /* listen() backlog (--listen-backlog N) */
+} SocketProfile;
+
+extern SocketProfile g_socket_profile;
+
 /*******************************************************************************
  * LIFECYCLE MANAGEMENT
  ******************************************************************************/
@@ -414,6 +498,66 @@ bool network_init(NetworkServer* server, u16 port);
  */
 void network_shutdown(NetworkServer* server);
 
+/*
+ * network_stop_listening - Close the game listener only
+ * 
+ * @param server  Pointer to initialized NetworkServer
+ * 
+ * Closes the WebSocket listener too.
+ * New connections are refused from here on; client sockets and the event
+ * backend stay open until network_shutdown(). Not while the network
+ * thread (netio.h) is running: it waits on the same event set.
+ */
+void network_stop_listening(NetworkServer* server);
+
+/*
+ * network_listen_websocket - Also accept browser clients on another port
+ * 
+ * @param server  Pointer to initialized NetworkServer
+ * @param port    TCP port for WebSocket connections
+ * @return        false if the port could not be bound or watched
+ * 
+ * The listener joins the event set with NETWORK_TOKEN_WS_LISTENER;
+ * connections from it are taken with network_accept_websocket() and
+ * speak WebSocket (websocket.h) before the game protocol. Call before
+ * the network thread starts, which takes over the event set.
+ */
+bool network_listen_websocket(NetworkServer* server, u16 port);
+
+/*
+ * network_accept_websocket - Accept one pending WebSocket connection
+ * 
+ * @return  Non-blocking client socket, or -1 if none is pending
+ */
+i32 network_accept_websocket(NetworkServer* server);
+
+/*
+ * network_listen - Open an extra non-blocking listener on another port
+ * 
+ * @param port  TCP port to bind on all interfaces
+ * @return      Listening socket, or -1 if it could not be bound
+ * 
+ * For side services (the metrics port) that share the game's event set:
+ * the caller network_watch()es the socket with its own token and accepts
+ * with network_accept(). SO_REUSEADDR, non-blocking and the profile's
+ * backlog, but none of its buffer sizes; call after network_init() so
+ * Winsock is started.
+ * Close it with network_close_socket().
+ */
+i32 network_listen(u16 port);
+
+/*
+ * network_accept - Accept one pending connection from any listener
+ * 
+ * @param listen_fd  Socket from network_init() or network_listen()
+ * @return           Non-blocking client socket, or -1 if none is pending
+ * 
+ * No socket profile: game connections come through
+ * network_accept_connection() / network_accept_websocket(), which add
+ * TCP_NODELAY.
+ */
+i32 network_accept(i32 listen_fd);
+
 /*******************************************************************************
  * CONNECTION MANAGEMENT
  ******************************************************************************/
@@ -815,6 +959,115 @@ i32 network_receive(i32 socket_fd, u8* buffer, u32 length);
  */
 i32 network_send(i32 socket_fd, const u8* buffer, u32 length);
 
+/*
+ * network_would_block - Check whether the last socket call failed softly
+ * 
+ * @return  true if the last send()/recv() returned -1 only because the
+ *          non-blocking socket was not ready (EAGAIN / EWOULDBLOCK /
+ *          WSAEWOULDBLOCK), false for real errors
+ * 
+ * USAGE:
+ *   i32 n = network_send(fd, data, len);
+ *   if (n < 0 && network_would_block()) {
+ *       // Kernel send buffer full - keep data queued, retry next flush
+ *   } else if (n < 0) {
+ *       // Connection broken - drop client
+ *   }
+ * 
+ * Must be called immediately after the failing call (errno is global
+ * and overwritten by later library calls).
+ * 
+ * COMPLEXITY: O(1) time
+ */
+bool network_would_block(void);
+
+/*******************************************************************************
+ * EVENT NOTIFICATION
+ *******************************************************************************
+ * 
+ * Instead of sleeping and then calling recv() on every player slot to see
+ * whether anything arrived, the server asks the kernel to wake it only
+ * when a socket is ready:
+ * 
+ *   Polling (old):                     Readiness (new):
+ *     loop:                              loop:
+ *       sleep(1ms)                         wait(until tick deadline)
+ *       for 2048 slots: recv()   →         for each READY socket: recv()
+ * 
+ * BACKENDS (chosen at compile time):
+ *   Linux:          epoll      O(ready) per wait
+ *   BSD / macOS:    kqueue     O(ready) per wait
+ *   Windows/other:  WSAPoll() / poll()   O(watched) per wait
+ * 
+ *   Build with -DNETWORK_USE_POLL to force the portable poll() backend.
+ * 
+ * LEVEL-TRIGGERED:
+ *   A socket keeps being reported while unread data remains, so a reader
+ *   that stops early (full input buffer) is simply woken again.
+ * 
+ * CLOSED SOCKETS:
+ *   epoll and kqueue drop a descriptor from the interest set when it is
+ *   closed. The poll() backend prunes entries reported as POLLNVAL, and
+ *   network_watch() on a reused descriptor number replaces the old entry,
+ *   so callers never need to unregister before close().
+ ******************************************************************************/
+
+/*
+ * network_backend_name - Name of the compiled-in event backend
+ * 
+ * @return  "epoll", "kqueue", "WSAPoll" or "poll"
+ */
+const char* network_backend_name(void);
+
+/*
+ * network_watch - Register (or update) interest in a client socket
+ * 
+ * @param server      Server whose event set to modify
+ * @param socket_fd   Connected client socket
+ * @param token       Value reported back in NetworkEvent.token
+ * @param want_write  Also report writability (set while output is backed up)
+ * @return            true on success
+ * 
+ * Calling again for the same socket replaces its token and interest.
+ * 
+ * COMPLEXITY: O(1) (epoll/kqueue), O(watched) (poll)
+ */
+bool network_watch(NetworkServer* server, i32 socket_fd, u32 token, bool want_write);
+
+/*
+ * network_unwatch - Stop reporting events for a socket that stays open
+ * 
+ * @param server     Server whose event set to modify
+ * @param socket_fd  Socket to remove (ignored if not watched)
+ * 
+ * Only needed when a socket must stay open but silent (e.g. a peer that
+ * hung up while its slot is still in use); close() alone is enough
+ * otherwise.
+ * 
+ * COMPLEXITY: O(1) (epoll/kqueue), O(watched) (poll)
+ */
+void network_unwatch(NetworkServer* server, i32 socket_fd);
+
+/*
+ * network_wait - Block until sockets are ready or the timeout expires
+ * 
+ * @param server      Server to wait on (listener is always watched)
+ * @param timeout_ms  Maximum wait in milliseconds (0 = just check)
+ * @param events      Output array
+ * @param max_events  Capacity of events (clamped to NETWORK_MAX_EVENTS)
+ * @return            Number of events written (0 on timeout or signal)
+ * 
+ * USAGE (main loop):
+ *   i32 n = network_wait(&net, ms_until_next_tick, events, NETWORK_MAX_EVENTS);
+ *   for (i32 i = 0; i < n; i++) {
+ *       if (events[i].token == NETWORK_TOKEN_LISTENER) accept_all();
+ *       else if (events[i].readable) read_player(events[i].token);
+ *   }
+ * 
+ * COMPLEXITY: O(ready) (epoll/kqueue), O(watched) (poll)
+ */
+i32 network_wait(NetworkServer* server, i32 timeout_ms, NetworkEvent* events, u32 max_events);
+
 /*******************************************************************************
  * SOCKET CLEANUP
  ******************************************************************************/
@@ -79,8 +79,13 @@
  ******************************************************************************/
 
 #include "npc.h"
+#include "constants.h"  /* MAX_NPCS */
+#include "pathfinder.h" /* pathfinder_walk_to (random walks off the wander set) */
+#include "mem_stats.h"
+#include "occupancy.h"
+#include "log.h"
 #include <stdlib.h>   /* malloc, calloc, free */
-#include <string.h>   /* strcpy */
+#include <string.h>   /* memset */
 #include <stdio.h>    /* printf */
 
 /*******************************************************************************
@@ -106,6 +111,11 @@
  */
 NpcSystem* g_npcs = NULL;
 
+/* Scheduling helpers (defined with npc_system_process below) */
+static void npc_wake(NpcSystem* npcs, Npc* npc);
+static void npc_sleep(NpcSystem* npcs, Npc* npc);
+static void npc_timer_cancel(Npc* npc);
+
 /*******************************************************************************
  * NPC SYSTEM LIFECYCLE
  ******************************************************************************/
@@ -182,7 +192,7 @@ NpcSystem* g_npcs = NULL;
  */
 NpcSystem* npc_system_create(u32 capacity) {
     /* PHASE 1: Allocate NpcSystem structure */
-    NpcSystem* npcs = calloc(1, sizeof(NpcSystem));
+    NpcSystem* npcs = mem_calloc(MEM_NPC, 1, sizeof(NpcSystem));
     if (!npcs) {
         /* Out of memory - system struct allocation failed */
         return NULL;
@@ -190,11 +200,30 @@ NpcSystem* npc_system_create(u32 capacity) {
     
     /* PHASE 2: Allocate NPC instance array */
     npcs->npc_capacity = capacity;
-    npcs->npcs = calloc(capacity, sizeof(Npc));
+    npcs->npcs = mem_calloc(MEM_NPC, capacity, sizeof(Npc));
     if (!npcs->npcs) {
         /* Out of memory - array allocation failed
          * CRITICAL: Must free npcs to prevent memory leak */
-        free(npcs);
+        mem_free(npcs);
+        return NULL;
+    }
+    
+    /* PHASE 3: Per-tick structures (zone grid and changed list) */
+    npcs->zones = zone_grid_create(capacity);
+    npcs->changed = mem_calloc(MEM_NPC, capacity, sizeof(u16));
+    npcs->awake = mem_calloc(MEM_NPC, capacity, sizeof(u16));
+    npcs->slots = slotmap_new(capacity, 0);
+    npcs->wander = wander_table_create();
+    bool walked = movement_batch_init(&npcs->walked, capacity);
+    if (!npcs->zones || !npcs->changed || !npcs->awake || !npcs->slots || !npcs->wander || !walked) {
+        zone_grid_destroy(npcs->zones);
+        wander_table_destroy(npcs->wander);
+        movement_batch_free(&npcs->walked);
+        mem_free(npcs->changed);
+        mem_free(npcs->awake);
+        slotmap_free(npcs->slots);
+        mem_free(npcs->npcs);
+        mem_free(npcs);
         return NULL;
     }
     
@@ -215,42 +244,11 @@ NpcSystem* npc_system_create(u32 capacity) {
  * npc_system_destroy - Free all heap-allocated NPC system memory
  * 
  * DEALLOCATION ORDER:
- *   Must free in reverse order of allocation (child before parent):
- *     1. definitions array (child of NpcSystem)
- *     2. npcs array (child of NpcSystem)
- *     3. NpcSystem struct (parent)
- * 
- * DEALLOCATION DIAGRAM:
- * 
- *   Before destroy:
- *   ┌───────────────┐
- *   │  NpcSystem    │
- *   │  ┌─────────┐  │
- *   │  │defs ────┼──┼──> [definition array]
- *   │  │npcs ────┼──┼──> [npc instance array]
- *   │  └─────────┘  │
- *   └───────────────┘
- * 
- *   After free(definitions):
- *   ┌───────────────┐
- *   │  NpcSystem    │
- *   │  ┌─────────┐  │
- *   │  │defs ────┼──┼──> (freed)
- *   │  │npcs ────┼──┼──> [npc instance array]
- *   │  └─────────┘  │
- *   └───────────────┘
- * 
- *   After free(npcs):
- *   ┌───────────────┐
- *   │  NpcSystem    │
- *   │  ┌─────────┐  │
- *   │  │defs ────┼──┼──> (freed)
- *   │  │npcs ────┼──┼──> (freed)
- *   │  └─────────┘  │
- *   └───────────────┘
- * 
- *   After free(npcs):
- *   (all freed)
+ *   Children before parent: the npcs array, zone grid, changed/awake
+ *   lists and slot map, then the NpcSystem struct.
+ * 
+ *   definitions and text are NOT freed here: they point into g_defs
+ *   (decoded tables or the mapped snapshot), released by def_store_destroy().
  * 
  * DANGLING POINTER PREVENTION:
  *   After calling this function, caller should:
@@ -277,20 +275,20 @@ void npc_system_destroy(NpcSystem* npcs) {
     /* NULL-safe: allow calling with NULL pointer */
     if (!npcs) return;
     
-    /* Free definitions array if allocated */
-    if (npcs->definitions) {
-        free(npcs->definitions);
-        /* Good practice: NULL out dangling pointer
-         * (not strictly necessary since freeing npcs next) */
-    }
-    
     /* Free NPC instances array if allocated */
     if (npcs->npcs) {
-        free(npcs->npcs);
+        mem_free(npcs->npcs);
     }
     
+    zone_grid_destroy(npcs->zones);
+    movement_batch_free(&npcs->walked);
+    mem_free(npcs->changed);
+    mem_free(npcs->awake);
+    slotmap_free(npcs->slots);
+    wander_table_destroy(npcs->wander);
+    
     /* Finally, free the NpcSystem struct itself */
-    free(npcs);
+    mem_free(npcs);
     
     /* Note: Caller must set g_npcs = NULL to prevent use-after-free */
 }
@@ -300,37 +298,26 @@ void npc_system_destroy(NpcSystem* npcs) {
  * 
  * INITIALIZATION PROCESS:
  *   1. Validate system not already initialized (prevent double-init)
- *   2. Allocate definitions array
- *   3. Load NPC data from cache files (TODO: implement)
- *   4. Set initialized=true
- * 
- * CACHE FILE FORMAT (RuneScape):
- *   NPC definitions stored in binary cache files:
- *     - npc.dat: Definition data (name, stats, models)
- *     - npc.idx: Index for quick lookup
- * 
- *   Each definition contains:
- *     - ID (u16)
- *     - Name (variable-length string)
- *     - Examine text (variable-length string)
- *     - Combat stats (u8/u16 fields)
- *     - Model IDs (u16 array)
- *     - Animation IDs (u16 fields)
- *     - Colors (u16 array)
- *     - Flags (bool fields)
- * 
- * CURRENT IMPLEMENTATION:
- *   Hardcoded sample definitions for testing:
- *     ID 0: Hans - Lumbridge Castle servant (non-combat NPC)
- *     ID 1: Man - Generic low-level human (combat level 2)
- * 
- * FUTURE IMPLEMENTATION:
- *   Replace hardcoded data with cache loading:
- *     FILE* dat = fopen("data/npc.dat", "rb");
- *     FILE* idx = fopen("data/npc.idx", "rb");
- *     for (u16 id = 0; id < definition_count; id++) {
- *       load_npc_definition(&definitions[id], dat, idx);
- *     }
+ *   2. Snapshot current: point at its NPC tables and stop
+ *   3. Decode npc.idx / npc.dat from the config archive
+ *   4. Overlay the server-only fields (npc_apply_server_stats)
+ *   5. Set initialized=true
+ * 
+ * CONFIG FORMAT (npc.dat):
+ *   Like obj.dat, a list of [opcode][payload] per NPC ending in 0:
+ *     1  = models (g1 count, g2 each)     2  = name (string)
+ *     3  = examine (string)               12 = size (g1)
+ *     13 = stand animation (g2)           14 = walk animation (g2)
+ *     17 = walk + turn animations (4 x g2)
+ *     30-39 = options (string)            40 = recolours (g1 n, n x 4)
+ *     95 = combat level (g2)
+ *   Head models, scaling, minimap and ambient/contrast opcodes are
+ *   skipped; the client needs them, the server does not.
+ * 
+ * SERVER-ONLY FIELDS:
+ *   Hitpoints, attack speed, respawn time and wander radius are not in
+ *   the cache. They are overlaid from the breakdowns below onto whatever
+ *   the cache decoded (or onto blank definitions when there is no cache).
  * 
  * HANS DEFINITION BREAKDOWN:
  * 
@@ -363,169 +350,168 @@ void npc_system_destroy(NpcSystem* npcs) {
  *   │  size: 1 (occupies 1x1 tile)                        │
  *   └─────────────────────────────────────────────────────┘
  * 
- * MEMORY ALLOCATION:
- *   10000 definitions * 128 bytes each = 1.28 MB
- *   Allocated once, used for lifetime of server
- * 
  * ERROR HANDLING:
  *   Returns false if:
- *     - npcs is NULL (invalid parameter)
+ *     - npcs is NULL or g_defs is NULL (invalid parameter)
  *     - Already initialized (prevent double-init)
- *     - calloc fails (out of memory)
+ *     - A table allocation fails (out of memory)
  * 
- * COMPLEXITY: O(definition_count) time and space
+ * COMPLEXITY: O(size of npc.dat); O(1) when mapped from the snapshot
  */
+
+/*
+ * npc_apply_server_stats - Overlay the fields npc.dat does not carry
+ * 
+ * Only touches IDs present in the table. Runs before the tables are
+ * saved, so the snapshot already holds the merged definitions.
+ */
+static void npc_apply_server_stats(NpcDefinition* defs, DefText* text, u32 count) {
+    /*--------------------------------------------------------------------------
+     * NPC ID 1 = "Man"
+     *--------------------------------------------------------------------------*/
+    if (count > 1) {
+        NpcDefinition* man = &defs[1];
+        if (!text[1].name) {
+            /* No cache: the name, level and size come from here too */
+            text[1].name = def_store_intern(g_defs, "Man", 3);
+            text[1].examine = def_store_intern(g_defs, "One of Lumbridge's residents.", 29);
+            man->combat_level = 2;
+            man->size = 1;
+        }
+        
+        /* Hitpoints: 7 HP (dies in 2-3 hits for low-level players) */
+        man->max_hitpoints = 7;
+        
+        /* Attack speed: 4 ticks per attack (2.4 seconds)
+         * 
+         * For comparison:
+         *   Fast weapons (dagger): 2 ticks (1.2 seconds)
+         *   Normal weapons (sword): 4 ticks (2.4 seconds)
+         *   Slow weapons (2h sword): 6 ticks (3.6 seconds)
+         */
+        man->attack_speed = 4;
+        
+        /* Respawn time: 25 ticks after death (15 seconds) */
+        man->respawn_time = 25;
+        
+        /* Walk radius: 5 tiles from spawn point */
+        man->walk_radius = 5;
+        
+        /* Behavioral flags */
+        man->aggressive = false;  /* Won't auto-attack players */
+        man->retreats = true;     /* Runs away when low HP (<=20%) */
+    }
+    
+    /*--------------------------------------------------------------------------
+     * NPC ID 0 = "Hans"
+     *--------------------------------------------------------------------------*/
+    if (count > 0) {
+        NpcDefinition* hans = &defs[0];
+        if (!text[0].name) {
+            text[0].name = def_store_intern(g_defs, "Hans", 4);
+            text[0].examine = def_store_intern(g_defs, "Servant of the Duke of Lumbridge.", 33);
+            hans->size = 1;
+        }
+        
+        /* Non-combat: max hitpoints 0 prevents targeting */
+        hans->max_hitpoints = 0;
+        
+        /* Wanders around the Lumbridge Castle courtyard */
+        hans->walk_radius = 20;
+        hans->aggressive = false;
+    }
+}
+
 bool npc_system_init(NpcSystem* npcs) {
     /* Validate parameters */
-    if (!npcs) return false;
+    if (!npcs || !g_defs) return false;
     
     /* Prevent double-initialization */
     if (npcs->initialized) return false;
     
-    /* TODO: Load actual count from cache files
-     * For now, allocate space for 10000 possible NPC types */
-    npcs->definition_count = 10000;
-    npcs->definitions = calloc(npcs->definition_count, sizeof(NpcDefinition));
+    /* Fast path: tables straight out of the snapshot */
+    u32 count = 0, text_count = 0;
+    const NpcDefinition* mapped = def_store_section(g_defs, DEF_SECTION_NPCS,
+                                                    sizeof(NpcDefinition), &count);
+    const DefText* mapped_text = def_store_section(g_defs, DEF_SECTION_NPC_TEXT,
+                                                   sizeof(DefText), &text_count);
+    if (mapped && mapped_text && text_count == count) {
+        npcs->definitions = mapped;
+        npcs->text = mapped_text;
+        npcs->definition_count = count;
+        printf("Initialized NPC system with %u definitions (mapped)\n", count);
+        npcs->initialized = true;
+        return true;
+    }
+    
+    ConfigTable table;
+    bool have_cache = config_table_open(&table, g_cache, "npc");
+    count = have_cache ? table.count : 2;
     
-    /* Check allocation success */
-    if (!npcs->definitions) {
+    NpcDefinition* defs = def_store_table(g_defs, DEF_SECTION_NPCS,
+                                          sizeof(NpcDefinition), count);
+    DefText* text = def_store_table(g_defs, DEF_SECTION_NPC_TEXT,
+                                    sizeof(DefText), count);
+    if (!defs || !text) {
         /* Out of memory */
         return false;
     }
     
-    /*--------------------------------------------------------------------------
-     * HARDCODED DEFINITION: NPC ID 1 = "Man"
-     *--------------------------------------------------------------------------*/
-    
-    /* Get pointer to definition slot 1 */
-    NpcDefinition* man = &npcs->definitions[1];
-    
-    /* Identity */
-    man->id = 1;
-    strcpy(man->name, "Man");
-    strcpy(man->examine, "One of Lumbridge's residents.");
-    
-    /* Combat stats
-     * 
-     * Combat level calculation (simplified):
-     *   Base: attack + strength + defence + hitpoints + prayer / 2
-     *   Man: Low-level NPC, minimal combat ability
-     * 
-     * Hitpoints: 7 HP (dies in 2-3 hits for low-level players)
-     */
-    man->combat_level = 2;
-    man->max_hitpoints = 7;
-    
-    /* Attack speed: 4 ticks per attack
-     * 
-     * Tick rate: 600ms (0.6 seconds)
-     * Attack interval: 4 * 0.6 = 2.4 seconds between attacks
-     * 
-     * For comparison:
-     *   Fast weapons (dagger): 2 ticks (1.2 seconds)
-     *   Normal weapons (sword): 4 ticks (2.4 seconds)
-     *   Slow weapons (2h sword): 6 ticks (3.6 seconds)
-     */
-    man->attack_speed = 4;
-    
-    /* Respawn time: 25 ticks after death
-     * 
-     * Calculation: 25 * 0.6 = 15 seconds
-     * 
-     * RuneScape respawn times vary by NPC:
-     *   Common NPCs (chickens, cows): 10-30 seconds
-     *   Uncommon NPCs (guards): 30-60 seconds
-     *   Bosses: 60-120 seconds or longer
-     */
-    man->respawn_time = 25;
-    
-    /* Walk radius: 5 tiles from spawn point
-     * 
-     * Random walk behavior:
-     *   Every few ticks, NPC picks random tile within radius
-     *   Uses pathfinding to navigate there
-     *   When reached, picks new destination
-     * 
-     * Visual representation (spawn at center):
-     * 
-     *   ┌─────────────────────────────────┐
-     *   │  . . . . . . . . . . .          │
-     *   │  . . . . X X X . . . .          │
-     *   │  . . . X X X X X . . .          │
-     *   │  . . X X X X X X X . .          │
-     *   │  . . X X X S X X X . .  S = spawn point
-     *   │  . . X X X X X X X . .  X = walkable area (radius 5)
-     *   │  . . . X X X X X . . .  . = outside walk radius
-     *   │  . . . . X X X . . . .          │
-     *   │  . . . . . . . . . . .          │
-     *   └─────────────────────────────────┘
-     */
-    man->walk_radius = 5;
-    
-    /* Behavioral flags */
-    man->aggressive = false;  /* Won't auto-attack players */
-    man->retreats = true;     /* Runs away when low HP (<=20%) */
-    
-    /* Size: 1x1 tiles
-     * 
-     * Size affects:
-     *   - Collision detection (1x1 NPCs block 1 tile)
-     *   - Pathfinding (larger NPCs need more clearance)
-     *   - Combat distance (larger NPCs attackable from farther)
-     * 
-     * Size examples:
-     *   1x1: Humans, goblins, chickens
-     *   2x2: Giants, hill giants
-     *   3x3: Dragons, demons
-     *   5x5: King Black Dragon
-     */
-    man->size = 1;
-    
-    /* Note: models, colors, and animations left at 0 (not yet implemented) */
-    
-    /*--------------------------------------------------------------------------
-     * HARDCODED DEFINITION: NPC ID 0 = "Hans"
-     *--------------------------------------------------------------------------*/
-    
-    /* Get pointer to definition slot 0 */
-    NpcDefinition* hans = &npcs->definitions[0];
-    
-    /* Identity */
-    hans->id = 0;
-    strcpy(hans->name, "Hans");
-    strcpy(hans->examine, "Servant of the Duke of Lumbridge.");
-    
-    /* Non-combat NPC
-     * 
-     * Combat level 0 indicates NPC cannot be attacked
-     * Max hitpoints 0 prevents targeting
-     * 
-     * Hans is a quest/dialogue NPC, not meant for combat
-     */
-    hans->combat_level = 0;
-    hans->max_hitpoints = 0;
+    for (u32 id = 0; id < count; id++) {
+        defs[id].id = (u16)id;
+        defs[id].size = 1;
+    }
     
-    /* Walk radius: 20 tiles
-     * 
-     * Hans wanders around Lumbridge Castle courtyard
-     * Larger radius than combat NPCs (more dynamic)
-     * 
-     * Path may include:
-     *   - Castle entrance
-     *   - Courtyard
-     *   - Kitchen area
-     *   - Duke's throne room
-     */
-    hans->walk_radius = 20;
+    ConfigReader r;
+    for (u32 id = 0; have_cache && config_table_next(&table, &r); id++) {
+        NpcDefinition* def = &defs[id];
+        
+        for (;;) {
+            u32 op = config_g1(&r);
+            if (op == 0 || r.overrun) break;
+            
+            if (op == 1) {
+                u32 n = config_g1(&r);
+                for (u32 i = 0; i < n; i++) {
+                    u32 model = config_g2(&r);
+                    if (i < 12) def->models[i] = (u16)model;
+                }
+            }
+            else if (op == 2) text[id].name = config_string(&r, g_defs);
+            else if (op == 3) text[id].examine = config_string(&r, g_defs);
+            else if (op == 12) def->size = (u8)config_g1b(&r);
+            else if (op == 13) def->stand_anim = (u16)config_g2(&r);
+            else if (op == 14) def->walk_anim = (u16)config_g2(&r);
+            else if (op == 16 || op == 93) { /* no payload */ }
+            else if (op == 17) {
+                def->walk_anim = (u16)config_g2(&r);
+                config_skip(&r, 6);     /* turn around, turn left, turn right */
+            }
+            else if (op >= 30 && op <= 39) config_string(&r, g_defs);
+            else if (op == 40) {
+                u32 n = config_g1(&r);
+                for (u32 i = 0; i < n; i++) {
+                    config_skip(&r, 2);     /* source colour */
+                    u32 dest = config_g2(&r);
+                    if (i < 5) def->colors[i] = (u16)dest;
+                }
+            }
+            else if (op == 60) config_skip(&r, config_g1(&r) * 2);
+            else if (op == 95) def->combat_level = (u16)config_g2(&r);
+            else if ((op >= 90 && op <= 92) || op == 97 || op == 98) config_skip(&r, 2);
+            else break;     /* Unknown opcode: the rest is unreadable */
+        }
+    }
     
-    /* Behavioral flags */
-    hans->aggressive = false;  /* Never attacks (non-combat) */
+    npc_apply_server_stats(defs, text, count);
     
-    /* Size */
-    hans->size = 1;  /* Standard human size */
+    npcs->definitions = defs;
+    npcs->text = text;
+    npcs->definition_count = count;
     
     /* Debug output */
-    printf("Initialized NPC system with %u definitions\n", npcs->definition_count);
+    printf("Initialized NPC system with %u definitions%s\n", count,
+           have_cache ? "" : " (no cache)");
     
     /* Mark system as initialized (now safe to spawn NPCs) */
     npcs->initialized = true;
@@ -557,9 +543,9 @@ bool npc_system_init(NpcSystem* npcs) {
  *   id=10000: OUT OF BOUNDS, return NULL
  * 
  * USAGE PATTERN:
- *   NpcDefinition* def = npc_get_definition(g_npcs, npc->npc_id);
+ *   const NpcDefinition* def = npc_get_definition(g_npcs, npc->npc_id);
  *   if (def) {
- *     Draw name tag: def->name
+ *     Draw name tag: npc_get_name(g_npcs, npc->npc_id)
  *     Show combat level: def->combat_level
  *     Render model: def->models[...]
  *   }
@@ -574,7 +560,7 @@ bool npc_system_init(NpcSystem* npcs) {
  * 
  * COMPLEXITY: O(1) time, O(1) space
  */
-NpcDefinition* npc_get_definition(NpcSystem* npcs, u16 id) {
+const NpcDefinition* npc_get_definition(NpcSystem* npcs, u16 id) {
     /* Validate system pointer */
     if (!npcs) return NULL;
     
@@ -590,6 +576,16 @@ NpcDefinition* npc_get_definition(NpcSystem* npcs, u16 id) {
     return &npcs->definitions[id];
 }
 
+const char* npc_get_name(NpcSystem* npcs, u16 id) {
+    if (!npcs || !npcs->initialized || id >= npcs->definition_count) return "";
+    return def_store_string(g_defs, npcs->text[id].name);
+}
+
+const char* npc_get_examine(NpcSystem* npcs, u16 id) {
+    if (!npcs || !npcs->initialized || id >= npcs->definition_count) return "";
+    return def_store_string(g_defs, npcs->text[id].examine);
+}
+
 /*******************************************************************************
  * NPC INSTANCE MANAGEMENT
  ******************************************************************************/
@@ -736,7 +732,7 @@ NpcDefinition* npc_get_definition(NpcSystem* npcs, u16 id) {
  *       npc_spawn(g_npcs, GOBLIN_ID, x, z, 0);
  *     }
  * 
- * COMPLEXITY: O(N) time worst case, O(1) space
+ * COMPLEXITY: O(1) time (free list pop), O(1) space
  */
 Npc* npc_spawn(NpcSystem* npcs, u16 npc_id, u32 x, u32 z, u32 height) {
     /* Validate parameters */
@@ -744,28 +740,19 @@ Npc* npc_spawn(NpcSystem* npcs, u16 npc_id, u32 x, u32 z, u32 height) {
     if (!npcs->initialized) return NULL;
     
     /*--------------------------------------------------------------------------
-     * SLOT ALLOCATION: Find first free NPC slot
+     * SLOT ALLOCATION: Pop the longest-free NPC slot
      *--------------------------------------------------------------------------*/
     
-    Npc* npc = NULL;  /* Will point to allocated slot */
-    
-    /* Linear search through NPC array */
-    for (u32 i = 0; i < npcs->npc_capacity; i++) {
-        /* Check if slot is available */
-        if (!npcs->npcs[i].active) {
-            /* Found free slot! */
-            npc = &npcs->npcs[i];
-            npc->index = (u16)i;  /* Store index for network protocol */
-            break;  /* Stop searching */
-        }
-    }
-    
-    /* Check if allocation failed (all slots in use) */
-    if (!npc) {
-        printf("No free NPC slots available\n");
+    u32 slot = slotmap_alloc(npcs->slots);
+    if (slot == SLOTMAP_NONE) {
+        /* All slots in use */
+        LOG_WARN("No free NPC slots available\n");
         return NULL;
     }
     
+    Npc* npc = &npcs->npcs[slot];
+    npc->index = (u16)slot;  /* Store index for network protocol */
+    
     /*--------------------------------------------------------------------------
      * NPC STATE INITIALIZATION
      *--------------------------------------------------------------------------*/
@@ -802,7 +789,7 @@ Npc* npc_spawn(NpcSystem* npcs, u16 npc_id, u32 x, u32 z, u32 height) {
     movement_init(&npc->movement);
     
     /* Initialize combat stats from definition */
-    NpcDefinition* def = npc_get_definition(npcs, npc_id);
+    const NpcDefinition* def = npc_get_definition(npcs, npc_id);
     if (def) {
         /* Set hitpoints to maximum (full health) */
         npc->hitpoints = def->max_hitpoints;
@@ -810,9 +797,13 @@ Npc* npc_spawn(NpcSystem* npcs, u16 npc_id, u32 x, u32 z, u32 height) {
         /* Definition not found (shouldn't happen if npc_id valid) */
         npc->hitpoints = 0;
     }
+    npc->size = def && def->size > 0 ? def->size : 1;
+    npc->in_combat = false;
     
     /* Clear update flags (no pending updates) */
     npc->update_flags = 0;
+    npc->walk_direction = -1;
+    npc->mask_block_length = 0;
     
     /* Mark slot as active (in use) */
     npc->active = true;
@@ -820,9 +811,19 @@ Npc* npc_spawn(NpcSystem* npcs, u16 npc_id, u32 x, u32 z, u32 height) {
     /* Clear respawn timer (NPC is alive) */
     npc->respawn_timer = 0;
     
+    /* File in the zone grid so nearby viewers find it */
+    zone_grid_insert(npcs->zones, npc->index, &npc->position);
+    occupancy_add(g_occupancy, &npc->position, npc->size);
+    
+    /* Start awake; the first sleep check puts it down if nobody is near */
+    npc->awake = false;
+    npc->timer_action = NPC_TIMER_NONE;
+    npc->timer = TIMER_NONE;
+    npc_wake(npcs, npc);
+    
     /* Debug output */
-    printf("Spawned NPC %u (id: %u) at (%u, %u, %u)\n", 
-           npc->index, npc_id, x, z, height);
+    LOG_DEBUG("Spawned NPC %u (id: %u) at (%u, %u, %u)\n", 
+              npc->index, npc_id, x, z, height);
     
     return npc;
 }
@@ -873,11 +874,14 @@ Npc* npc_spawn(NpcSystem* npcs, u16 npc_id, u32 x, u32 z, u32 height) {
  *   After despawn, slot available for next npc_spawn():
  * 
  *   Time T:   npc_spawn(npcs, 1, x, z, 0)  -> uses slot 42
- *   Time T+1: npc_despawn(npcs, npc)       -> frees slot 42
- *   Time T+2: npc_spawn(npcs, 2, x, z, 0)  -> reuses slot 42
+ *   Time T+1: npc_despawn(npcs, npc)       -> slot 42 to the back of
+ *                                             the free list
+ *   Later:    npc_spawn(npcs, 2, x, z, 0)  -> reuses slot 42 once every
+ *                                             longer-free slot is taken
  * 
  *   Same index, different NPC!
- *   Clients must handle index reuse correctly
+ *   Clients must handle index reuse correctly; FIFO reuse makes it rare
+ *   for a viewer to still track the old NPC when it happens
  * 
  * NETWORK PROTOCOL:
  * 
@@ -934,6 +938,13 @@ void npc_despawn(NpcSystem* npcs, Npc* npc) {
     /* Check if NPC is actually active */
     if (!npc->active) return;  /* Already despawned, no-op */
     
+    /* A dead NPC (respawn pending) already left its tiles */
+    bool standing = npc->timer_action != NPC_TIMER_RESPAWN;
+    
+    /* Off the awake list and the timer wheel before the slot is reused */
+    npc_sleep(npcs, npc);
+    npc_timer_cancel(npc);
+    
     /* Mark slot as inactive (available for reuse) */
     npc->active = false;
     
@@ -953,8 +964,15 @@ void npc_despawn(NpcSystem* npcs, Npc* npc) {
      */
     movement_destroy(&npc->movement);
     
+    /* Viewers drop it on their next NPC_INFO (no longer found in zones) */
+    zone_grid_remove(npcs->zones, npc->index);
+    if (standing) occupancy_remove(g_occupancy, &npc->position, npc->size);
+    
+    /* Back on the free list, behind every slot already waiting there */
+    slotmap_release(npcs->slots, npc->index);
+    
     /* Debug output */
-    printf("Despawned NPC %u\n", npc->index);
+    LOG_DEBUG("Despawned NPC %u\n", npc->index);
     
     /* Note: NPC struct remains in array (not freed)
      * Data will be overwritten on next spawn to this slot */
@@ -1145,20 +1163,26 @@ void npc_process(Npc* npc) {
     if (movement_is_moving(&npc->movement)) {
         /* Get next movement direction based on current position */
         i32 dir = movement_get_next_direction(&npc->movement, 
-                                              npc->position.x, 
-                                              npc->position.z);
+                                              position_x(&npc->position), 
+                                              position_z(&npc->position));
         
-        if (dir != -1) {
+        if (dir != -1 && occupancy_step_blocked(g_occupancy, &npc->position, npc->size,
+                                                DIRECTION_DELTA_X[dir], DIRECTION_DELTA_Z[dir])) {
+            /* Someone stands there: stop and let the next wander or
+             * chase find another way (occupancy.h) */
+            movement_reset(&npc->movement);
+        } else if (dir != -1) {
             /* Move NPC in calculated direction */
+            Position from = npc->position;
             position_move(&npc->position, 
                          DIRECTION_DELTA_X[dir], 
                          DIRECTION_DELTA_Z[dir]);
             /* Note: height remains same (no vertical movement) */
+            occupancy_move(g_occupancy, &from, &npc->position, npc->size);
             
-            /* TODO: Set movement update flag for network protocol
-             * npc->update_flags |= NPC_UPDATE_MOVEMENT;
-             * npc->primary_direction = dir;
-             */
+            /* Sent as a walk step in NPC_INFO (npc_system_process
+             * puts the NPC on the changed list) */
+            npc->walk_direction = (i8)dir;
         }
     }
     
@@ -1166,30 +1190,16 @@ void npc_process(Npc* npc) {
      * FUTURE IMPLEMENTATIONS (TODO)
      *--------------------------------------------------------------------------*/
     
-    /* TODO: Combat AI
-     * 
-     * if (npc->in_combat) {
-     *   process_combat(npc);
-     * }
-     */
+    /* Combat AI: not polled here. Swings and hits are g_timers events
+     * (combat.h) that set in_combat and queue the chase path walked
+     * above */
     
-    /* TODO: Random walking
-     * 
-     * NpcDefinition* def = npc_get_definition(g_npcs, npc->npc_id);
-     * if (def && def->walk_radius > 0) {
-     *   if (!movement_is_moving(&npc->movement) && rand() % 100 < 5) {
-     *     random_walk(npc, def);
-     *   }
-     * }
-     */
+    /* Random walking: not polled either. NPC_TIMER_WANDER queues a
+     * walk to a tile of the spawn's wander set (wander.h), walked above */
     
-    /* TODO: Aggression detection
-     * 
-     * NpcDefinition* def = npc_get_definition(g_npcs, npc->npc_id);
-     * if (def && def->aggressive) {
-     *   check_aggression(npc);
-     * }
-     */
+    /* Aggression: not polled per NPC either. aggression_process() starts
+     * from the zones players are in and hunts only the aggressive NPCs
+     * filed there (aggression.h) */
     
     /* TODO: Respawn logic
      * 
@@ -1202,6 +1212,277 @@ void npc_process(Npc* npc) {
      */
 }
 
+/*
+ * npc_mark_changed - Put an NPC on the changed list once per tick
+ */
+static void npc_mark_changed(NpcSystem* npcs, Npc* npc) {
+    if (npc->changed) return;
+    npc->changed = true;
+    npcs->changed[npcs->changed_count++] = npc->index;
+}
+
+/*******************************************************************************
+ * SCHEDULING: AWAKE LIST AND TIMERS
+ *******************************************************************************
+ * 
+ * AWAKE LIST:
+ *   npcs->awake[0, awake_count) holds the NPCs processed each tick, in no
+ *   particular order. Npc.awake_slot is each NPC's position in it, so
+ *   sleeping is a swap-remove:
+ * 
+ *     awake: [ 7, 12, 40, 95 ]   npc_sleep(12)
+ *     awake: [ 7, 95, 40 ]       95 moved into slot 1
+ * 
+ * TIMERS:
+ *   Each NPC has at most one timed action (respawn or next random walk)
+ *   on g_timers, with the NPC index as the callback argument. The handle
+ *   is kept in Npc.timer so despawning can cancel it.
+ * 
+ ******************************************************************************/
+
+static void npc_timer_fired(void* ctx, u32 index);
+
+/*
+ * npc_timer_cancel - Remove an NPC's pending timer, if any
+ */
+static void npc_timer_cancel(Npc* npc) {
+    if (npc->timer_action == NPC_TIMER_NONE) return;
+    timer_cancel(g_timers, npc->timer);
+    npc->timer = TIMER_NONE;
+    npc->timer_action = NPC_TIMER_NONE;
+}
+
+/*
+ * npc_timer_schedule - Fire action on an NPC in delay ticks (at least 1)
+ * 
+ * Replaces the NPC's pending timer, if any. Without g_timers (no server
+ * running) nothing is scheduled.
+ */
+static void npc_timer_schedule(NpcSystem* npcs, Npc* npc, u32 delay, NpcTimerAction action) {
+    npc_timer_cancel(npc);
+    npc->timer = timer_schedule(g_timers, delay, npc_timer_fired, npcs, npc->index);
+    if (npc->timer != TIMER_NONE) npc->timer_action = (u8)action;
+}
+
+/*
+ * npc_schedule_wander - Queue the next random walk, if the NPC wanders
+ */
+static void npc_schedule_wander(NpcSystem* npcs, Npc* npc) {
+    const NpcDefinition* def = npc_get_definition(npcs, npc->npc_id);
+    if (!def || def->walk_radius == 0) return;
+    npc_timer_schedule(npcs, npc, 1 + (u32)rand() % NPC_WANDER_DELAY_MAX, NPC_TIMER_WANDER);
+}
+
+static void npc_wake(NpcSystem* npcs, Npc* npc) {
+    if (npc->awake || !npc->active) return;
+    if (npc->timer_action == NPC_TIMER_RESPAWN) return;  /* Dead */
+    
+    npc->awake = true;
+    npc->awake_slot = (u16)npcs->awake_count;
+    npcs->awake[npcs->awake_count++] = npc->index;
+    
+    /* Wander timers are dropped while asleep; restart on waking */
+    if (npc->timer_action == NPC_TIMER_NONE) npc_schedule_wander(npcs, npc);
+}
+
+static void npc_sleep(NpcSystem* npcs, Npc* npc) {
+    if (!npc->awake) return;
+    
+    u16 last = npcs->awake[--npcs->awake_count];
+    npcs->awake[npc->awake_slot] = last;
+    npcs->npcs[last].awake_slot = npc->awake_slot;
+    npc->awake = false;
+}
+
+/*
+ * npc_player_near - Any player filed in the zones around an NPC?
+ * 
+ * Checks a zone further than NPC_WAKE_DISTANCE so an NPC at the edge
+ * does not flip between asleep and awake as a player walks back and
+ * forth across one zone boundary.
+ */
+static bool npc_player_near(const ZoneGrid* players, const Npc* npc) {
+    u16 found;
+    return zone_grid_query(players, position_x(&npc->position), position_z(&npc->position),
+                           NPC_WAKE_DISTANCE + 8, &found, 1) > 0;
+}
+
+/*
+ * npc_respawn - NPC_TIMER_RESPAWN fired: back at spawn, full health
+ */
+static void npc_respawn(NpcSystem* npcs, Npc* npc) {
+    const NpcDefinition* def = npc_get_definition(npcs, npc->npc_id);
+    npc->hitpoints = def ? def->max_hitpoints : 0;
+    npc->respawn_timer = 0;
+    npc->position = npc->spawn_position;
+    movement_reset(&npc->movement);
+    
+    /* Viewers add it again on their next NPC_INFO. Wakes like a fresh
+     * spawn; the next sleep check puts it down if nobody is near */
+    zone_grid_insert(npcs->zones, npc->index, &npc->position);
+    occupancy_add(g_occupancy, &npc->position, npc->size);
+    npc_wake(npcs, npc);
+}
+
+/*
+ * npc_wander - NPC_TIMER_WANDER fired: walk to a random nearby tile
+ * 
+ * The tile comes from the spawn's wander set, with the path through the
+ * set's BFS tree (wander.h). Off the set (no collision, chased outside
+ * it, radius too large) a random tile of the square is pathed to.
+ */
+static void npc_wander(NpcSystem* npcs, Npc* npc) {
+    if (!npc->awake) return;  /* Rescheduled by npc_wake() */
+    
+    const NpcDefinition* def = npc_get_definition(npcs, npc->npc_id);
+    if (!def || def->walk_radius == 0) return;
+    
+    if (!movement_is_moving(&npc->movement) && !npc->in_combat) {
+        movement_reset(&npc->movement);
+        if (!wander_walk(npcs->wander, g_world_collision, &npc->spawn_position, def->walk_radius,
+                         &npc->position, &npc->movement)) {
+            i32 span = (i32)def->walk_radius * 2 + 1;
+            i32 dest_x = (i32)position_x(&npc->spawn_position) + rand() % span - (i32)def->walk_radius;
+            i32 dest_z = (i32)position_z(&npc->spawn_position) + rand() % span - (i32)def->walk_radius;
+            if (dest_x >= 0 && dest_z >= 0) {
+                pathfinder_walk_to(&npc->movement, position_height(&npc->position),
+                                   position_x(&npc->position), position_z(&npc->position),
+                                   (u32)dest_x, (u32)dest_z);
+            }
+        }
+        movement_finish(&npc->movement);
+    }
+    npc_schedule_wander(npcs, npc);
+}
+
+/*
+ * npc_timer_fired - g_timers callback: run the NPC's timed action
+ */
+static void npc_timer_fired(void* ctx, u32 index) {
+    NpcSystem* npcs = (NpcSystem*)ctx;
+    Npc* npc = &npcs->npcs[index];
+    
+    NpcTimerAction action = (NpcTimerAction)npc->timer_action;
+    npc->timer = TIMER_NONE;
+    npc->timer_action = NPC_TIMER_NONE;
+    switch (action) {
+        case NPC_TIMER_RESPAWN: npc_respawn(npcs, npc); break;
+        case NPC_TIMER_WANDER:  npc_wander(npcs, npc); break;
+        default: break;
+    }
+}
+
+/*
+ * npc_system_process - Run one tick for every awake NPC
+ * 
+ * A walking NPC is marked changed so npc_system_end_tick() resets its
+ * walk_direction, and pushed into npcs->walked. After the loop the batch
+ * flags the walkers that crossed an 8x8 zone boundary and only those are
+ * refiled, in the order they walked (nothing in the loop reads the NPC
+ * zone grid, so the buckets end up linked as if refiled on the spot).
+ * 
+ * The awake list is walked backwards: npc_sleep() moves the last entry
+ * into the freed slot, which has then already been processed.
+ */
+void npc_system_process(NpcSystem* npcs, const ZoneGrid* players) {
+    if (!npcs || !npcs->initialized) return;
+    
+    npcs->tick++;
+    
+    MovementBatch* walked = &npcs->walked;
+    movement_batch_clear(walked);
+    for (u32 i = npcs->awake_count; i-- > 0;) {
+        Npc* npc = &npcs->npcs[npcs->awake[i]];
+        
+        npc_process(npc);
+        if (npc->walk_direction != -1) {
+            movement_batch_push(walked, npc->index, walked->count, &npc->position, 0);
+            npc_mark_changed(npcs, npc);
+        } else if (players && (npcs->tick + npc->index) % NPC_SLEEP_CHECK_TICKS == 0 &&
+                   !movement_is_moving(&npc->movement) && !npc_player_near(players, npc)) {
+            npc_sleep(npcs, npc);
+        }
+    }
+    
+    movement_batch_collect(walked, npcs->zones);
+    for (u32 c = 0; c < walked->change_count; c++) {
+        u32 index = walked->changes[c].index;
+        zone_grid_update(npcs->zones, index, &npcs->npcs[index].position);
+    }
+}
+
+void npc_wake_near(NpcSystem* npcs, const Position* pos) {
+    if (!npcs || !pos || npcs->awake_count == npcs->npc_capacity) return;
+    
+    u16 nearby[MAX_NPCS];
+    u32 count = zone_grid_query(npcs->zones, position_x(pos), position_z(pos), NPC_WAKE_DISTANCE,
+                                nearby, sizeof(nearby) / sizeof(nearby[0]));
+    for (u32 i = 0; i < count; i++) {
+        npc_wake(npcs, &npcs->npcs[nearby[i]]);
+    }
+}
+
+void npc_kill(NpcSystem* npcs, Npc* npc) {
+    if (!npcs || !npc || !npc->active) return;
+    if (npc->timer_action == NPC_TIMER_RESPAWN) return;  /* Already dead */
+    
+    const NpcDefinition* def = npc_get_definition(npcs, npc->npc_id);
+    npc->hitpoints = 0;
+    npc->in_combat = false;
+    npc->respawn_timer = def ? def->respawn_time : 1;
+    movement_reset(&npc->movement);
+    
+    npc_sleep(npcs, npc);
+    zone_grid_remove(npcs->zones, npc->index);
+    occupancy_remove(g_occupancy, &npc->position, npc->size);
+    npc_timer_schedule(npcs, npc, (u32)npc->respawn_timer, NPC_TIMER_RESPAWN);
+}
+
+void npc_restore(NpcSystem* npcs, Npc* npc, const Position* position, u16 hitpoints,
+                 u32 respawn_ticks) {
+    if (!npcs || !npc || !npc->active || !position) return;
+    
+    if (respawn_ticks > 0) {
+        /* Dead at the checkpoint: dead now, back when it was due */
+        npc_kill(npcs, npc);
+        npc->respawn_timer = respawn_ticks;
+        npc_timer_schedule(npcs, npc, respawn_ticks, NPC_TIMER_RESPAWN);
+        return;
+    }
+    
+    const NpcDefinition* def = npc_get_definition(npcs, npc->npc_id);
+    npc->hitpoints = def && hitpoints > def->max_hitpoints ? def->max_hitpoints : hitpoints;
+    occupancy_move(g_occupancy, &npc->position, position, npc->size);
+    npc->position = *position;
+    movement_reset(&npc->movement);
+    zone_grid_update(npcs->zones, npc->index, &npc->position);
+}
+
+void npc_queue_update(NpcSystem* npcs, Npc* npc, u32 flags) {
+    if (!npcs || !npc || !npc->active) return;
+    npc->update_flags |= flags;
+    npc_mark_changed(npcs, npc);
+}
+
+/*
+ * npc_system_end_tick - Clear this tick's flags and movement
+ * 
+ * Only NPCs on the changed list can have anything to clear, so idle
+ * NPCs are never touched.
+ */
+void npc_system_end_tick(NpcSystem* npcs) {
+    if (!npcs) return;
+    
+    for (u32 i = 0; i < npcs->changed_count; i++) {
+        Npc* npc = &npcs->npcs[npcs->changed[i]];
+        npc->update_flags = 0;
+        npc->walk_direction = -1;
+        npc->mask_block_length = 0;
+        npc->changed = false;
+    }
+    npcs->changed_count = 0;
+}
+
 /*
  * npc_get_by_index - Retrieve NPC instance by network index
  * 
@@ -48,7 +48,7 @@
  * 
  * For a system with 5000 NPC capacity:
  *   NpcSystem struct:     ~40 bytes
- *   NpcDefinition array:  10000 * 128 bytes = 1.28 MB
+ *   NpcDefinition array:  ~8000 * 58 bytes = 464 KB (in g_defs)
  *   Npc instance array:   5000 * 80 bytes = 400 KB
  *   Total:                ~1.7 MB
  * 
@@ -60,6 +60,12 @@
 #include "types.h"      /* u8, u16, u32, u64, bool */
 #include "position.h"   /* Position struct (x, z, height) */
 #include "movement.h"   /* MovementHandler (waypoint queue) */
+#include "zone_grid.h"  /* ZoneGrid (NPCs filed by 8x8 zone) */
+#include "movement_batch.h" /* MovementBatch (zone changes of walkers) */
+#include "timer_wheel.h" /* TimerHandle (respawn and wander timers) */
+#include "datastruct/slotmap.h" /* SlotMap (free NPC indices) */
+#include "def_store.h" /* DefText (name/examine pool offsets) */
+#include "wander.h" /* WanderTable (reachable tiles per spawn) */
 
 /*******************************************************************************
  * NPC DEFINITION - IMMUTABLE TEMPLATE
@@ -85,7 +91,12 @@
  *   Example: 1000 "Man" NPCs share 1 definition (128 bytes)
  *            vs. storing name/stats in each instance (128 KB vs. 128 bytes)
  * 
- * STRUCTURE SIZE: 128 bytes (approximate)
+ * TEXT:
+ *   name and examine live in the shared string pool (def_store.h) as
+ *   NpcSystem.text[id]; read them with npc_get_name() / npc_get_examine().
+ *   Everything here is what the tick actually reads.
+ * 
+ * STRUCTURE SIZE: 58 bytes
  * ALIGNMENT: Natural alignment (largest field is u16 array)
  * 
  ******************************************************************************/
@@ -97,18 +108,12 @@ typedef struct {
     /* Unique identifier for this NPC type (e.g., 0=Hans, 1=Man, 2=Goblin) */
     u16 id;
     
-    /* Display name shown to players (max 63 chars + null terminator) */
-    char name[64];
-    
-    /* Right-click examine text (max 127 chars + null terminator) */
-    char examine[128];
-    
     /*--------------------------------------------------------------------------
      * COMBAT STATS
      *--------------------------------------------------------------------------*/
     
-    /* Combat level displayed above NPC (0-255, typically 0-999 in RS) */
-    u8 combat_level;
+    /* Combat level displayed above NPC (vislevel, 0 = not shown) */
+    u16 combat_level;
     
     /* Maximum hitpoints (health) for this NPC type */
     u16 max_hitpoints;
@@ -204,10 +209,35 @@ typedef struct {
  *   │ reset HP, pos   │ ───────────────┘
  *   └─────────────────┘  OR npc_despawn()
  * 
- * STRUCTURE SIZE: ~80 bytes (approximate)
+ * STRUCTURE SIZE: ~120 bytes (approximate)
  * ALIGNMENT: Natural (u64 field requires 8-byte alignment)
  * 
  ******************************************************************************/
+/*
+ * SCHEDULING CONSTANTS (see npc_system_process)
+ *
+ * NPC_WAKE_DISTANCE: NPCs filed in the zones within this many tiles of a
+ *   player are awake. One zone beyond the 15-tile view distance, so an
+ *   NPC is already running when it comes into view.
+ * NPC_SLEEP_CHECK_TICKS: an awake NPC looks for players every this many
+ *   ticks (staggered by index, so 1/16th of them check per tick).
+ * NPC_WANDER_DELAY_MAX: longest pause between random walks, in ticks.
+ */
+#define NPC_WAKE_DISTANCE 23
+#define NPC_SLEEP_CHECK_TICKS 16
+#define NPC_WANDER_DELAY_MAX 20
+
+/* Timed action pending on an NPC (one per NPC) */
+typedef enum {
+    NPC_TIMER_NONE = 0,
+    NPC_TIMER_WANDER,       /* Random walk within walk_radius of spawn */
+    NPC_TIMER_RESPAWN       /* Return to life at spawn_position */
+} NpcTimerAction;
+
+/* Largest encoded NPC mask block: mask + animation 3 + face entity 2 +
+ * hit 4 + transform 2 + face tile 4 = 16 bytes */
+#define NPC_MASK_BLOCK_SIZE 16
+
 typedef struct {
     /*--------------------------------------------------------------------------
      * IDENTIFICATION
@@ -235,6 +265,10 @@ typedef struct {
      * NPC returns here after death or when wander timer expires */
     Position spawn_position;
     
+    /* Tiles per side (the definition's size, at least 1): the footprint
+     * marked in g_occupancy (occupancy.h) */
+    u8 size;
+    
     /* Movement waypoint queue and pathfinding state
      * See movement.h for details */
     MovementHandler movement;
@@ -247,6 +281,9 @@ typedef struct {
      * Decreases when damaged, capped at NpcDefinition.max_hitpoints */
     u16 hitpoints;
     
+    /* Attacking someone (combat.h): the fight moves it, not random walks */
+    bool in_combat;
+    
     /*--------------------------------------------------------------------------
      * NETWORK SYNCHRONIZATION
      *--------------------------------------------------------------------------*/
@@ -277,6 +314,28 @@ typedef struct {
      */
     u32 update_flags;
     
+    /* Data for the flags above, read by the NPC_INFO encoder (npc_update.c)
+     * Only meaningful while the matching flag is set this tick */
+    u16 animation_id;           /* NPC_UPDATE_ANIMATION (65535 = stop) */
+    u8 animation_delay;
+    u8 hit_damage;              /* NPC_UPDATE_HIT */
+    u8 hit_type;
+    u16 face_entity;            /* NPC_UPDATE_FACE_ENTITY (65535 = none) */
+    u16 face_x;                 /* NPC_UPDATE_FACE_DIR: tile to face */
+    u16 face_z;
+    u16 transform_id;           /* NPC_UPDATE_APPEARANCE: new NPC id */
+    
+    /* Direction walked this tick (0-7), -1 if the NPC stood still */
+    i8 walk_direction;
+    
+    /* On NpcSystem.changed this tick (update_flags or walk_direction set) */
+    bool changed;
+    
+    /* Mask block shared by every viewer this tick, encoded once by
+     * npc_update_prepare(); 0 length = no block */
+    u8 mask_block_length;
+    u8 mask_block[NPC_MASK_BLOCK_SIZE];
+    
     /*--------------------------------------------------------------------------
      * LIFECYCLE STATE
      *--------------------------------------------------------------------------*/
@@ -285,10 +344,23 @@ typedef struct {
     bool active;
     
     /* Game ticks until respawn (0 = alive or inactive)
-     * Set to NpcDefinition.respawn_time when NPC dies
-     * Decremented each tick until 0, then NPC respawns */
+     * Set to NpcDefinition.respawn_time by npc_kill(), which schedules
+     * NPC_TIMER_RESPAWN on g_timers; nothing counts it down */
     u64 respawn_timer;
     
+    /*--------------------------------------------------------------------------
+     * SCHEDULING (see npc_system_process)
+     *--------------------------------------------------------------------------*/
+    
+    /* On NpcSystem.awake: processed every tick. Asleep NPCs are skipped
+     * until a player comes near (npc_wake_near) */
+    bool awake;
+    u16 awake_slot;             /* Index in NpcSystem.awake while awake */
+    
+    /* Pending timed action (NPC_TIMER_NONE = none) on g_timers */
+    u8 timer_action;
+    TimerHandle timer;
+    
 } Npc;
 
 /*******************************************************************************
@@ -335,6 +407,13 @@ typedef struct {
 /* NPC face entity changed (lock facing to player/NPC) */
 #define NPC_UPDATE_FACE_ENTITY  0x0020
 
+/*
+ * These are server-side flags; npc_update.c maps them onto the client's
+ * NPC_INFO mask bits (0x02 animation, 0x04 face entity, 0x10 hit, 0x20
+ * transform, 0x80 face tile). NPC_UPDATE_FORCE_CHAT has no text field to
+ * send yet and is not encoded.
+ */
+
 /*******************************************************************************
  * NPC SYSTEM - GLOBAL MANAGER
  *******************************************************************************
@@ -378,9 +457,13 @@ typedef struct {
      * │  def[0]  │  def[1]  │  def[2]  │ ... │def[N-1]  │
      * │   Hans   │   Man    │  Goblin  │     │  Dragon  │
      * └──────────┴──────────┴──────────┴─────┴──────────┘
-     *  128 bytes  128 bytes  128 bytes        128 bytes
+     *
+     * Read-only: owned by g_defs (decoded tables or the mapped snapshot).
      */
-    NpcDefinition* definitions;
+    const NpcDefinition* definitions;
+    
+    /* Name/examine pool offsets, indexed like definitions */
+    const DefText* text;
     
     /* Number of definitions loaded (max NPC ID + 1) */
     u32 definition_count;
@@ -394,7 +477,7 @@ typedef struct {
      * 
      * SLOT ALLOCATION:
      *   Active NPCs: npc[i].active = true
-     *   Free slots:  npc[i].active = false
+     *   Free slots:  npc[i].active = false, and listed in slots
      * 
      * MEMORY LAYOUT:
      * ┌──────────┬──────────┬──────────┬─────┬──────────┐
@@ -405,20 +488,55 @@ typedef struct {
      *  80 bytes   80 bytes   80 bytes         80 bytes
      * 
      * SPAWNING ALGORITHM:
-     *   Linear search for first inactive slot:
-     *     for (i = 0; i < capacity; i++)
-     *       if (!npcs[i].active) return &npcs[i];
-     *   Time complexity: O(N) worst case
-     * 
-     * OPTIMIZATION OPPORTUNITY:
-     *   Maintain free list for O(1) allocation
-     *   Trade-off: 4 bytes per NPC for next pointer
+     *   Pop the free list in slots (see below): O(1), where the old
+     *   search for the first inactive slot was O(N) on a busy world
      */
     Npc* npcs;
     
     /* Maximum number of concurrent NPCs (array size) */
     u32 npc_capacity;
     
+    /* Free NPC indices, longest-free first (datastruct/slotmap.h)
+     * npc_spawn() pops, npc_despawn() pushes. FIFO order means a despawned
+     * index is reused last, giving clients that still track the old NPC
+     * the longest time to drop it before a different one appears there */
+    SlotMap* slots;
+    
+    /*--------------------------------------------------------------------------
+     * PER-TICK STATE
+     *--------------------------------------------------------------------------*/
+    
+    /* Spatial index of active NPCs by 8x8 zone (capacity npc_capacity)
+     * Viewers query the zones around them instead of scanning all NPCs */
+    ZoneGrid* zones;
+    
+    /* NPCs that walked this tick, refiled in zones after the loop by the
+     * zone changes it flags (capacity npc_capacity, see movement_batch.h) */
+    MovementBatch walked;
+    
+    /* Indices of NPCs that walked or got update flags this tick
+     * Each NPC appears at most once (Npc.changed), so npc_capacity entries
+     * always suffice. Mask blocks are encoded and flags cleared by walking
+     * this list, not the whole array - most NPCs are idle most ticks */
+    u16* changed;
+    u32 changed_count;
+    
+    /* Indices of awake NPCs, unordered (swap-remove on sleep)
+     * Only these are processed each tick; an NPC with no player within
+     * NPC_WAKE_DISTANCE falls asleep and costs nothing until woken */
+    u16* awake;
+    u32 awake_count;
+    
+    /* Tiles reachable around each (spawn, walk radius), flood filled on
+     * first use and shared by every NPC spawned with both: random walks
+     * pick from it instead of searching (wander.h) */
+    WanderTable* wander;
+    
+    /* Ticks run by npc_system_process() (staggers the sleep checks).
+     * Respawns and random walks wait on g_timers instead of being
+     * polled every tick */
+    u32 tick;
+    
     /*--------------------------------------------------------------------------
      * SYSTEM STATE
      *--------------------------------------------------------------------------*/
@@ -495,15 +613,10 @@ NpcSystem* npc_system_create(u32 capacity);
  * 
  * ALGORITHM:
  *   1. Check for NULL (safe to call on NULL pointer)
- *   2. Free definitions array if allocated
- *   3. Free NPC instances array if allocated
- *   4. Free NpcSystem struct
+ *   2. Free NPC instances array if allocated
+ *   3. Free NpcSystem struct
  * 
- * CLEANUP ORDER:
- *   Must free child allocations before parent:
- *     1. npcs->definitions (child)
- *     2. npcs->npcs (child)
- *     3. npcs (parent)
+ * The definition tables belong to g_defs and are not freed here.
  * 
  * USAGE:
  *   npc_system_destroy(g_npcs);
@@ -526,25 +639,24 @@ void npc_system_destroy(NpcSystem* npcs);
  * 
  * ALGORITHM:
  *   1. Check if already initialized (prevent double-init)
- *   2. Allocate definitions array
- *   3. Load NPC data from cache files (TODO: implement cache reading)
- *   4. Currently: hardcoded sample definitions (Hans, Man)
+ *   2. Snapshot current: point at its NPC tables and stop
+ *   3. Decode npc.idx / npc.dat from the config archive: name, examine,
+ *      models, size, stand/walk animations, combat level (opcode 95)
+ *   4. Overlay the server-only fields the cache does not carry
+ *      (hitpoints, attack speed, respawn, wander radius)
  *   5. Set initialized=true
  * 
- * DEFINITION LOADING (FUTURE):
- *   Read from cache files (typically .dat and .idx files):
- *     for each NPC ID in cache:
- *       Parse binary definition data
- *       Decode model IDs, colors, animations
- *       Store in definitions array
- * 
- * HARDCODED DEFINITIONS (CURRENT):
- *   ID 0: Hans (Lumbridge Castle servant, non-combat)
- *   ID 1: Man (Lumbridge resident, level 2)
+ * SERVER-ONLY FIELDS:
+ *   npc.dat is client data: it has no hitpoints or respawn times. Those
+ *   come from a small table in npc.c, applied after decoding and saved in
+ *   the snapshot with everything else (bump SNAPSHOT_VERSION when it changes).
+ *     ID 0: Hans (Lumbridge Castle servant, wanders the castle)
+ *     ID 1: Man (Lumbridge resident, 7 hitpoints)
+ *   Without a config archive these two are the only definitions.
  * 
  * ERROR HANDLING:
  *   Returns false if:
- *     - npcs is NULL
+ *     - npcs is NULL or g_defs is NULL
  *     - Already initialized
  *     - Memory allocation fails
  * 
@@ -555,7 +667,7 @@ void npc_system_destroy(NpcSystem* npcs);
  *     exit(1);
  *   }
  * 
- * COMPLEXITY: O(definition_count) time and space
+ * COMPLEXITY: O(size of npc.dat); O(1) when mapped from the snapshot
  */
 bool npc_system_init(NpcSystem* npcs);
 
@@ -573,9 +685,9 @@ bool npc_system_init(NpcSystem* npcs);
  *     - id >= definition_count (out of range)
  * 
  * USAGE:
- *   NpcDefinition* def = npc_get_definition(g_npcs, npc->npc_id);
+ *   const NpcDefinition* def = npc_get_definition(g_npcs, npc->npc_id);
  *   if (def) {
- *     printf("NPC name: %s\n", def->name);
+ *     printf("NPC name: %s\n", npc_get_name(g_npcs, npc->npc_id));
  *     printf("Combat level: %u\n", def->combat_level);
  *   }
  * 
@@ -585,7 +697,13 @@ bool npc_system_init(NpcSystem* npcs);
  * 
  * COMPLEXITY: O(1) time
  */
-NpcDefinition* npc_get_definition(NpcSystem* npcs, u16 id);
+const NpcDefinition* npc_get_definition(NpcSystem* npcs, u16 id);
+
+/*
+ * npc_get_name / npc_get_examine - Text of an NPC type ("" if unknown)
+ */
+const char* npc_get_name(NpcSystem* npcs, u16 id);
+const char* npc_get_examine(NpcSystem* npcs, u16 id);
 
 /*******************************************************************************
  * NPC INSTANCE MANAGEMENT FUNCTIONS
@@ -694,10 +812,8 @@ void npc_despawn(NpcSystem* npcs, Npc* npc);
  * ALGORITHM:
  *   1. Validate NPC is active
  *   2. Process movement (move to next waypoint if walking)
- *   3. TODO: Process combat AI
- *   4. TODO: Process random walking (if idle)
- *   5. TODO: Process aggression (auto-attack nearby players)
- *   6. TODO: Decrement respawn timer (if dead)
+ *   (Random walking, respawning and combat run from g_timers;
+ *   aggression from aggression_process(), per player-occupied zone)
  * 
  * MOVEMENT PROCESSING:
  *   If NPC has waypoints queued:
@@ -707,12 +823,9 @@ void npc_despawn(NpcSystem* npcs, Npc* npc);
  *     4. Set movement update flag for clients
  * 
  * GAME LOOP INTEGRATION:
- *   Called once per tick for each active NPC:
- *     for (i = 0; i < npcs->npc_capacity; i++) {
- *       if (npcs->npcs[i].active) {
- *         npc_process(&npcs->npcs[i]);
- *       }
- *     }
+ *   Called once per tick for each awake NPC by npc_system_process().
+ *   Random walking and respawning are timed actions on g_timers, not
+ *   per-tick checks here.
  * 
  * TICK RATE:
  *   RuneScape tick = 600ms (0.6 seconds)
@@ -729,6 +842,103 @@ void npc_despawn(NpcSystem* npcs, Npc* npc);
  */
 void npc_process(Npc* npc);
 
+/*
+ * npc_system_process - Run one tick for every awake NPC
+ * 
+ * @param npcs     NPC system
+ * @param players  World player zone grid (for falling asleep)
+ * 
+ * ALGORITHM:
+ *   1. npc_process() each awake NPC; refile NPCs that walked in the
+ *      zone grid and put them on the changed list
+ *   2. Staggered: an awake NPC standing still with no player in the
+ *      zones within NPC_WAKE_DISTANCE falls asleep
+ *   Respawns and random walks fire from g_timers (server_tick) before
+ *   this runs.
+ * 
+ * SLEEPING NPCs:
+ *   Most of the map has nobody in it, so most NPCs sleep. A sleeping
+ *   NPC is not visited at all: players wake the NPCs around them when
+ *   they enter a new zone (npc_wake_near), and timed actions come off
+ *   g_timers when due rather than being counted down per NPC.
+ * 
+ * COMPLEXITY: O(awake NPCs)
+ */
+void npc_system_process(NpcSystem* npcs, const ZoneGrid* players);
+
+/*
+ * npc_wake_near - Wake every NPC filed near a position
+ * 
+ * @param npcs  NPC system
+ * @param pos   Player position (after entering a new zone, or logging in)
+ * 
+ * Wakes the NPCs in the zones within NPC_WAKE_DISTANCE. Walking within
+ * a zone cannot bring new NPCs into range, so callers only need this on
+ * zone changes (zone_grid_update() returning true).
+ * 
+ * COMPLEXITY: O(NPCs in the nearby zones)
+ */
+void npc_wake_near(NpcSystem* npcs, const Position* pos);
+
+/*
+ * npc_kill - Take an NPC out of the world until it respawns
+ * 
+ * @param npcs  NPC system
+ * @param npc   Living NPC
+ * 
+ * Removes the NPC from the zone grid (viewers drop it), puts it to sleep
+ * and schedules NPC_TIMER_RESPAWN after NpcDefinition.respawn_time
+ * ticks. On respawn it reappears at spawn_position with full hitpoints.
+ * 
+ * COMPLEXITY: O(1) time
+ */
+void npc_kill(NpcSystem* npcs, Npc* npc);
+
+/*
+ * npc_restore - Put a spawned NPC back as a checkpoint found it (checkpoint.h)
+ * 
+ * @param npcs           NPC system
+ * @param npc            Active NPC, as spawned at boot
+ * @param position       Where it stood
+ * @param hitpoints      Its hitpoints (capped at the definition's maximum)
+ * @param respawn_ticks  0 if alive; else it was dead and respawns after
+ *                       this many ticks
+ * 
+ * COMPLEXITY: O(1) time
+ */
+void npc_restore(NpcSystem* npcs, Npc* npc, const Position* position, u16 hitpoints,
+                 u32 respawn_ticks);
+
+/*
+ * npc_queue_update - Set update flags on an NPC for this tick
+ * 
+ * @param npcs   NPC system
+ * @param npc    NPC whose state changed (fill the matching data fields)
+ * @param flags  NPC_UPDATE_* bits
+ * 
+ * Use this instead of writing update_flags directly, so the NPC is on
+ * the changed list and its flags are cleared after the tick.
+ * 
+ * USAGE:
+ *   npc->animation_id = 422;
+ *   npc->animation_delay = 0;
+ *   npc_queue_update(g_npcs, npc, NPC_UPDATE_ANIMATION);
+ * 
+ * COMPLEXITY: O(1) time
+ */
+void npc_queue_update(NpcSystem* npcs, Npc* npc, u32 flags);
+
+/*
+ * npc_system_end_tick - Clear this tick's flags and movement
+ * 
+ * @param npcs  NPC system
+ * 
+ * Called after every viewer's NPC_INFO was built.
+ * 
+ * COMPLEXITY: O(changed NPCs)
+ */
+void npc_system_end_tick(NpcSystem* npcs);
+
 /*
  * npc_get_by_index - Retrieve NPC instance by network index
  * 
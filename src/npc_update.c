@@ -0,0 +1,234 @@
+/*******************************************************************************
+ * NPC_UPDATE.C - NPC Update Protocol Implementation
+ *******************************************************************************
+ *
+ * See npc_update.h for the packet layout and the design. The client side
+ * is getNpcPos() in entry/client.c (getNpcPosOldVis → NewVis → Extended),
+ * which reads the three sections in exactly the order written here.
+ *
+ * MASK BITS (client NPC_INFO masks, not the server NPC_UPDATE_* flags):
+ *
+ *   wire  server flag              payload
+ *   0x02  NPC_UPDATE_ANIMATION     [seq:2][delay:1]
+ *   0x04  NPC_UPDATE_FACE_ENTITY   [target:2]
+ *   0x10  NPC_UPDATE_HIT           [damage:1][type:1][hp:1][max hp:1]
+ *   0x20  NPC_UPDATE_APPEARANCE    [npc id:2]
+ *   0x80  NPC_UPDATE_FACE_DIR      [tile x:2][tile z:2]
+ *
+ *   Payloads follow the mask byte in ascending wire bit order, which is
+ *   the order the client reads them.
+ *
+ ******************************************************************************/
+
+#include "npc_update.h"
+#include "player_list.h"
+#include "packets.h"
+#include "log.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Client mask bits */
+#define NPC_MASK_ANIMATION    0x02
+#define NPC_MASK_FACE_ENTITY  0x04
+#define NPC_MASK_HIT          0x10
+#define NPC_MASK_TRANSFORM    0x20
+#define NPC_MASK_FACE_TILE    0x80
+
+/*
+ * Mask block scratch for npc_update_player() (game thread only), reused
+ * every call like update.c's block_scratch
+ */
+static u8 npc_block_storage[1024];
+static StreamBuffer npc_block_scratch;
+static bool npc_block_scratch_ready = false;
+
+/*
+ * npc_encode_mask_block - Encode npc's pending flags into npc->mask_block
+ *
+ * Leaves mask_block_length at 0 when no flag maps onto a client mask bit
+ * (e.g. the NPC only walked), so the walk is sent without a block.
+ */
+static void npc_encode_mask_block(const NpcSystem* npcs, Npc* npc) {
+    u32 flags = npc->update_flags;
+    u8 mask = 0;
+    if (flags & NPC_UPDATE_ANIMATION)   mask |= NPC_MASK_ANIMATION;
+    if (flags & NPC_UPDATE_FACE_ENTITY) mask |= NPC_MASK_FACE_ENTITY;
+    if (flags & NPC_UPDATE_HIT)         mask |= NPC_MASK_HIT;
+    if (flags & NPC_UPDATE_APPEARANCE)  mask |= NPC_MASK_TRANSFORM;
+    if (flags & NPC_UPDATE_FACE_DIR)    mask |= NPC_MASK_FACE_TILE;
+
+    npc->mask_block_length = 0;
+    if (mask == 0) return;
+
+    StreamBuffer out;
+    buffer_init_external(&out, npc->mask_block, sizeof(npc->mask_block));
+    buffer_write_byte(&out, mask);
+    if (mask & NPC_MASK_ANIMATION) {
+        buffer_write_short(&out, npc->animation_id, BYTE_ORDER_BIG);
+        buffer_write_byte(&out, npc->animation_delay);
+    }
+    if (mask & NPC_MASK_FACE_ENTITY) {
+        buffer_write_short(&out, npc->face_entity, BYTE_ORDER_BIG);
+    }
+    if (mask & NPC_MASK_HIT) {
+        /* Health bar values are single bytes on the wire */
+        const NpcDefinition* def = npc_get_definition((NpcSystem*)npcs, npc->npc_id);
+        u16 max_hp = def ? def->max_hitpoints : npc->hitpoints;
+        buffer_write_byte(&out, npc->hit_damage);
+        buffer_write_byte(&out, npc->hit_type);
+        buffer_write_byte(&out, (u8)(npc->hitpoints < 255 ? npc->hitpoints : 255));
+        buffer_write_byte(&out, (u8)(max_hp < 255 ? max_hp : 255));
+    }
+    if (mask & NPC_MASK_TRANSFORM) {
+        buffer_write_short(&out, npc->transform_id, BYTE_ORDER_BIG);
+    }
+    if (mask & NPC_MASK_FACE_TILE) {
+        buffer_write_short(&out, npc->face_x, BYTE_ORDER_BIG);
+        buffer_write_short(&out, npc->face_z, BYTE_ORDER_BIG);
+    }
+    npc->mask_block_length = (u8)out.position;
+}
+
+void npc_update_prepare(NpcSystem* npcs) {
+    if (!npcs) return;
+    for (u32 i = 0; i < npcs->changed_count; i++) {
+        npc_encode_mask_block(npcs, &npcs->npcs[npcs->changed[i]]);
+    }
+}
+
+/*
+ * npc_find_visible - NPCs within view of a viewer
+ *
+ * Same rules as player_is_within_distance(): same height and at most
+ * MAX_VIEW_DISTANCE tiles on each axis, tested for all candidates at once
+ * by position_view_mask(). Returns the number found.
+ */
+static u32 npc_find_visible(const Player* viewer, const NpcSystem* npcs, NpcSet* visible) {
+    memset(visible, 0, sizeof(*visible));
+
+    u16 candidates[MAX_NPCS];
+    u32 coords[POSITION_VIEW_ROUND(MAX_NPCS)];
+    u64 mask[POSITION_VIEW_ROUND(MAX_NPCS) / POSITION_VIEW_LANES];
+    u32 candidate_count = zone_grid_query(npcs->zones, position_x(&viewer->position), position_z(&viewer->position),
+                                          MAX_VIEW_DISTANCE, candidates, MAX_NPCS);
+    for (u32 i = 0; i < candidate_count; i++) {
+        const Npc* npc = &npcs->npcs[candidates[i]];
+        coords[i] = npc->active ? position_view_coord(&npc->position) : POSITION_VIEW_HIDDEN;
+    }
+    u32 found = position_view_mask(&viewer->position, coords, candidate_count,
+                                   MAX_VIEW_DISTANCE, mask);
+
+    for (u32 w = 0; w * POSITION_VIEW_LANES < candidate_count; w++) {
+        for (u64 bits = mask[w]; bits; bits &= bits - 1) {
+            u32 i = w * POSITION_VIEW_LANES + (u32)__builtin_ctzll(bits);
+            npc_set_add(visible, candidates[i]);
+        }
+    }
+    return found;
+}
+
+bool npc_update_encode(Player* viewer, NpcTracking* tracking, const NpcSystem* npcs,
+                       StreamBuffer* block) {
+    if (!viewer || !tracking || !npcs || !block) return false;
+
+    NpcSet visible;
+    u32 visible_count = npc_find_visible(viewer, npcs, &visible);
+
+    /* Client already shows nothing and nothing is near: skip the packet */
+    if (tracking->local_count == 0 && visible_count == 0) return false;
+
+    StreamBuffer* out = player_out(viewer);
+    buffer_reset(block);
+
+    ISAACCipher* enc = viewer->conn->out_cipher.initialized ? &viewer->conn->out_cipher : NULL;
+    buffer_write_header_var(out, SERVER_NPC_INFO, enc, VAR_SHORT);
+    u32 payload_start = buffer_get_position(out);
+
+    buffer_start_bit_access(out);
+    buffer_write_bits(out, 8, tracking->local_count);
+
+    /*
+     * TRACKED NPCs: keep, move or remove, compacting local_npcs[] in
+     * place (same two-pointer pass as update_other_players)
+     */
+    u32 write_idx = 0;
+    for (u32 read_idx = 0; read_idx < tracking->local_count; read_idx++) {
+        u16 index = tracking->local_npcs[read_idx];
+
+        if (!npc_set_has(&visible, index)) {
+            buffer_write_bits(out, 3, bits_pack(1, 2, 3));  /* Update required, type 3 = removal */
+            npc_set_remove(&tracking->tracked, index);
+            continue;
+        }
+
+        tracking->local_npcs[write_idx++] = index;
+        const Npc* npc = &npcs->npcs[index];
+        bool has_update = npc->mask_block_length > 0;
+
+        if (npc->walk_direction != -1) {
+            /* Walk: update required, type 1, direction, extended info flag */
+            u32 walk = bits_pack(1, 2, 1);
+            walk = bits_pack(walk, 3, (u32)npc->walk_direction);
+            walk = bits_pack(walk, 1, has_update ? 1 : 0);
+            buffer_write_bits(out, 7, walk);
+        } else if (has_update) {
+            buffer_write_bits(out, 3, bits_pack(1, 2, 0));  /* Update required, type 0 = stand */
+        } else {
+            buffer_write_bits(out, 1, 0);
+            continue;
+        }
+        if (has_update) {
+            buffer_write_bytes(block, npc->mask_block, npc->mask_block_length);
+        }
+    }
+    tracking->local_count = write_idx;
+
+    /*
+     * NEW NPCs: visible \ tracked in index order, 35 bits each
+     */
+    NpcSet adds;
+    for (u32 w = 0; w < NPC_SET_WORDS; w++) {
+        adds.bits[w] = visible.bits[w] & ~tracking->tracked.bits[w];
+    }
+    for (u32 index = npc_set_next(&adds, 0);
+         index < NPC_INFO_END_MARKER && tracking->local_count < MAX_LOCAL_NPCS;
+         index = npc_set_next(&adds, index + 1)) {
+        const Npc* npc = &npcs->npcs[index];
+        bool has_update = npc->mask_block_length > 0;
+        i32 delta_x = (i32)position_x(&npc->position) - (i32)position_x(&viewer->position);
+        i32 delta_z = (i32)position_z(&npc->position) - (i32)position_z(&viewer->position);
+
+        /* [index:13][type:11] then [dx:5][dz:5][update:1] */
+        buffer_write_bits(out, 24, bits_pack(index, 11, npc->npc_id));
+        u32 rest = bits_pack((u32)delta_x & 0x1F, 5, (u32)delta_z & 0x1F);
+        buffer_write_bits(out, 11, bits_pack(rest, 1, has_update ? 1 : 0));
+
+        npc_set_add(&tracking->tracked, index);
+        tracking->local_npcs[tracking->local_count++] = (u16)index;
+        if (has_update) {
+            buffer_write_bytes(block, npc->mask_block, npc->mask_block_length);
+        }
+    }
+
+    buffer_write_bits(out, 13, NPC_INFO_END_MARKER);
+    buffer_finish_bit_access(out);
+
+    if (block->position > 0) {
+        buffer_write_bytes(out, block->data, block->position);
+    }
+    buffer_finish_var_header(out, VAR_SHORT);
+
+    dbg_log_send("NPC_INFO", SERVER_NPC_INFO, "varshort",
+                 (int)(buffer_get_position(out) - payload_start), enc != NULL);
+    return true;
+}
+
+void npc_update_player(Player* viewer, NpcTracking* tracking, const NpcSystem* npcs) {
+    if (!npc_block_scratch_ready) {
+        buffer_init_external(&npc_block_scratch, npc_block_storage, sizeof(npc_block_storage));
+        npc_block_scratch_ready = true;
+    }
+    if (npc_update_encode(viewer, tracking, npcs, &npc_block_scratch)) {
+        player_out_commit(viewer);
+    }
+}
@@ -0,0 +1,153 @@
+/*******************************************************************************
+ * NPC_UPDATE.H - NPC Update Protocol (Packet 1 / NPC_INFO)
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Interest management: each client only hears about nearby entities
+ *   - Delta encoding against what the client already shows
+ *   - Encode-once, copy-many for data shared by many recipients
+ *   - Keeping per-tick cost proportional to change, not population
+ *
+ * THE PROBLEM:
+ *
+ * The world holds up to MAX_NPCS (8191) NPCs. Each client only renders
+ * the ones within 15 tiles, and most NPCs stand still most of the time.
+ * Sending every NPC's state to every player would be 8191 x players
+ * records per tick; scanning all NPCs per viewer would be 8191 x players
+ * checks even when nobody is near any NPC.
+ *
+ * THE SOLUTION - MIRROR PLAYER_INFO:
+ *
+ *   NPC_INFO has the same shape as PLAYER_INFO (see update.c), minus the
+ *   local player section:
+ *
+ *   [count:8]                                   tracked NPCs, client order
+ *   per tracked NPC:
+ *     [0]                                       unchanged
+ *     [1][0]                                    stand, mask block follows
+ *     [1][1][dir:3][upd:1]                      walked one tile
+ *     [1][3]                                    removed
+ *   per new NPC:
+ *     [index:13][type:11][dx:5][dz:5][upd:1]    add, relative to viewer
+ *   [8191:13]                                   end of adds
+ *   mask blocks (byte aligned), in the order the bits announced them
+ *
+ *   Interest: NPCs are filed in their own zone grid (NpcSystem.zones),
+ *   so a viewer queries the zones within 15 tiles, exactly like the
+ *   player zone grid. A viewer with no NPCs tracked and none nearby gets
+ *   no packet at all.
+ *
+ *   Tracking: NpcTracking mirrors PlayerTracking: the client's list in
+ *   order plus the same NPCs as an NpcSet (one bit per NPC index), so
+ *   removals are one bit test and adds are visible \ tracked.
+ *
+ *   Shared blocks: an NPC's mask block is identical for every viewer.
+ *   npc_update_prepare() encodes it once per tick into Npc.mask_block
+ *   for NPCs on the changed list only; viewers memcpy it.
+ *
+ * PER-TICK COST:
+ *   npc_update_prepare:   O(changed NPCs)
+ *   npc_update_encode:    O(NPCs filed in the viewer's nearby zones)
+ *   NPCs far from players are asleep and not visited at all (see
+ *   npc_system_process()).
+ *
+ ******************************************************************************/
+
+#ifndef NPC_UPDATE_H
+#define NPC_UPDATE_H
+
+#include "types.h"
+#include "constants.h"
+#include "buffer.h"
+#include "npc.h"
+#include "player.h"
+
+/* Most NPCs in one viewer's local list (NPC_INFO sends an 8-bit count) */
+#define MAX_LOCAL_NPCS 255
+
+/* NPC index that ends the add section (13 bits all set) */
+#define NPC_INFO_END_MARKER 8191
+
+/* 64-bit words in an NpcSet (8192 bits covers every 13-bit index) */
+#define NPC_SET_WORDS ((MAX_NPCS + 64) / 64)
+
+/*
+ * NpcSet - One bit per NPC index (1KB), the NPC twin of PlayerSet
+ */
+typedef struct {
+    u64 bits[NPC_SET_WORDS];
+} NpcSet;
+
+static inline bool npc_set_has(const NpcSet* set, u32 index) {
+    return (set->bits[index >> 6] >> (index & 63)) & 1;
+}
+
+static inline void npc_set_add(NpcSet* set, u32 index) {
+    set->bits[index >> 6] |= (u64)1 << (index & 63);
+}
+
+static inline void npc_set_remove(NpcSet* set, u32 index) {
+    set->bits[index >> 6] &= ~((u64)1 << (index & 63));
+}
+
+/* First member >= index, or NPC_SET_WORDS * 64 if none */
+static inline u32 npc_set_next(const NpcSet* set, u32 index) {
+    if (index >= NPC_SET_WORDS * 64) return NPC_SET_WORDS * 64;
+    u32 word = index >> 6;
+    u64 bits = set->bits[word] & (~(u64)0 << (index & 63));
+    while (!bits) {
+        if (++word == NPC_SET_WORDS) return NPC_SET_WORDS * 64;
+        bits = set->bits[word];
+    }
+    return (word << 6) | (u32)__builtin_ctzll(bits);
+}
+
+/*
+ * NpcTracking - Which NPCs one viewer's client currently shows
+ *
+ * SIZE: 510 + 4 + 1024 = ~1.5KB, 3.1MB for MAX_PLAYERS viewers.
+ * Zeroed on login and logout, like PlayerTracking.
+ */
+typedef struct {
+    u16 local_npcs[MAX_LOCAL_NPCS];     /* NPC indices in client order */
+    u32 local_count;                    /* Number of local NPCs */
+    NpcSet tracked;                     /* Same NPCs, as a set */
+} NpcTracking;
+
+/*
+ * npc_update_prepare - Encode the shared mask block of every changed NPC
+ *
+ * @param npcs  NPC system
+ *
+ * Run on the game thread after NPC processing and before any viewer's
+ * NPC_INFO; afterwards the encoder only reads NPCs, so viewers may be
+ * encoded in parallel (see update_pool.h).
+ *
+ * COMPLEXITY: O(changed NPCs)
+ */
+void npc_update_prepare(NpcSystem* npcs);
+
+/*
+ * npc_update_encode - Write one viewer's NPC_INFO into its out arena
+ *
+ * @param viewer    Player receiving the packet
+ * @param tracking  Viewer's NPC tracking
+ * @param npcs      NPC system (read-only)
+ * @param block     Caller-owned mask block scratch (reset here)
+ * @return          true if a packet was written; false when the viewer
+ *                  tracks no NPCs and none are nearby (nothing to say)
+ *
+ * Does not commit; see npc_update_player().
+ */
+bool npc_update_encode(Player* viewer, NpcTracking* tracking, const NpcSystem* npcs,
+                       StreamBuffer* block);
+
+/*
+ * npc_update_player - npc_update_encode() plus player_out_commit()
+ *
+ * Uses a file-scope block scratch; game thread only.
+ */
+void npc_update_player(Player* viewer, NpcTracking* tracking, const NpcSystem* npcs);
+
+#endif /* NPC_UPDATE_H */
@@ -46,10 +46,7 @@ void npctype_unpack(Jagfile *config) {
         offset += g2(idx);
     }
 
-    _NpcType.cache = calloc(20, sizeof(NpcType *));
-    for (int id = 0; id < 20; id++) {
-        _NpcType.cache[id] = npctype_new();
-    }
+    _NpcType.decoded = calloc(_NpcType.count, sizeof(NpcType *));
     _NpcType.modelCache = lrucache_new(30);
 
     packet_free(idx);
@@ -58,22 +55,22 @@ void npctype_unpack(Jagfile *config) {
 void npctype_free_global(void) {
     lrucache_free(_NpcType.modelCache);
     free(_NpcType.offsets);
-    for (int i = 0; i < 20; i++) {
-        free(_NpcType.cache[i]);
+    for (int i = 0; i < _NpcType.count; i++) {
+        free(_NpcType.decoded[i]);
     }
-    free(_NpcType.cache);
+    free(_NpcType.decoded);
     packet_free(_NpcType.dat);
 }
 
 NpcType *npctype_get(int id) {
-    for (int i = 0; i < 20; i++) {
-        if (_NpcType.cache[i]->index == (int64_t)id) {
-            return _NpcType.cache[i];
-        }
+    // custom: kept once decoded, see loctype_get (the ring allocated a new slot per miss and
+    // leaked the one it replaced, as NpcEntity.type could still point at it)
+    NpcType *npc = _NpcType.decoded[id];
+    if (npc) {
+        return npc;
     }
 
-    _NpcType.cachePos = (_NpcType.cachePos + 1) % 20;
-    NpcType *npc = _NpcType.cache[_NpcType.cachePos] = npctype_new();
+    npc = _NpcType.decoded[id] = npctype_new();
     _NpcType.dat->pos = _NpcType.offsets[id];
     npc->index = id;
     npctype_decode(npc, _NpcType.dat);
@@ -191,7 +188,7 @@ Model *npctype_get_sequencedmodel(NpcType *npc, int primaryTransformId, int seco
 
         model_create_label_references(model, true);
         model_calculate_normals(model, 64, 850, -30, -50, -30, true, true);
-        lrucache_put(_NpcType.modelCache, npc->index, &model->link);
+        lrucache_put_sized(_NpcType.modelCache, npc->index, &model->link, model_size(model));
     }
 
     tmp = model_share_alpha(model, !npc->animHasAlpha);
@@ -199,7 +196,7 @@ Model *npctype_get_sequencedmodel(NpcType *npc, int primaryTransformId, int seco
     if (primaryTransformId != -1 && secondaryTransformId != -1) {
         model_apply_transforms(tmp, primaryTransformId, secondaryTransformId, seqMask);
     } else if (primaryTransformId != -1) {
-        model_apply_transform(tmp, primaryTransformId);
+        model_apply_transform_cached(tmp, MODEL_FRAME_NPC, npc->index, primaryTransformId, npc->animHasAlpha);
     }
 
     if (npc->resizeh != 128 || npc->resizev != 128) {
@@ -40,8 +40,7 @@ typedef struct {
     int count;
     int *offsets;
     Packet *dat;
-    NpcType **cache;
-    int cachePos;
+    NpcType **decoded; // custom: by id, decoded on first get and kept (was a ring of 20 slots)
     LruCache *modelCache; // = new LruCache(30);
 } NpcTypeData;
 
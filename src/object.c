@@ -8,9 +8,9 @@
  * (dynamic world state).
  * 
  * KEY ALGORITHMS IMPLEMENTED:
- *   1. Free slot allocation (linear search, O(n) worst case)
+ *   1. Free slot allocation (free list, O(1))
  *   2. Definition lookup by ID (direct indexing, O(1))
- *   3. Instance lookup by position (linear search, O(n) worst case)
+ *   3. Instance lookup by position (open-addressed hash, O(1) average)
  *   4. Memory pool management with slot reuse
  * 
  * EDUCATIONAL CONCEPTS:
@@ -42,8 +42,8 @@
  *   └────────────┴────────────┴────────────┴────────────┴────────┘
  *   
  *   Free slot detection: id==0 means slot is available
- *   Allocation: Linear search for first id==0 slot
- *   Deallocation: Set id=0 to mark slot as free
+ *   Allocation: Pop the longest-free slot from the slots free list
+ *   Deallocation: Set id=0 and push the slot back on the free list
  * 
  * OBJECT LIFECYCLE FLOWCHART:
  * 
@@ -100,30 +100,23 @@
  * 
  * ALLOCATION ALGORITHM ANALYSIS:
  * 
- *   CURRENT IMPLEMENTATION (linear free slot search):
+ *   FORMER IMPLEMENTATION (linear free slot search):
  *     Time complexity: O(capacity) worst case
- *     Space complexity: O(1) extra (no auxiliary structures)
  *     
  *     Worst case scenario:
- *       - 99,999 objects spawned (capacity = 100,000)
- *       - All in first 99,999 slots
- *       - Last slot (99,999) is free
- *       - Next spawn requires checking all 99,999 slots
- *     
- *     Best case scenario:
- *       - First slot is free
- *       - O(1) allocation
- * 
- *   OPTIMIZED ALTERNATIVE (free list):
- *     Maintain linked list of free slots:
- *       - At creation: free_list = [0, 1, 2, ..., capacity-1]
- *       - At spawn: pop from free_list
- *       - At despawn: push to free_list
+ *       - 9,999 objects spawned (capacity = 10,000)
+ *       - All in the first 9,999 slots
+ *       - Next spawn checks all 9,999 slots before finding the last
+ * 
+ *   CURRENT IMPLEMENTATION (free list, datastruct/slotmap.h):
+ *     Free slots are linked in a FIFO list:
+ *       - At creation: free = [0, 1, 2, ..., capacity-1]
+ *       - At spawn: pop the head (the slot free the longest)
+ *       - At despawn: push onto the tail
  *     
  *     Time complexity: O(1) for both spawn and despawn
- *     Space complexity: O(capacity) for free list
- *     
- *     Trade-off: Faster allocation, but uses more memory
+ *     Space complexity: 6 bytes per slot (link + generation), 60KB
+ *     for 10,000 slots
  * 
  * LOOKUP ALGORITHM ANALYSIS:
  * 
@@ -133,19 +126,14 @@
  *     Space: O(definition_count)
  *     
  *     Example:
- *       ObjectDefinition* def = &definitions[1519];
+ *       const ObjectDefinition* def = &definitions[1519];
  *       No loop required, just pointer arithmetic!
  * 
  *   INSTANCE LOOKUP (by position):
- *     Algorithm: Linear search
- *     Time: O(capacity) worst case
- *     Space: O(1) extra
- *     
- *     Optimization: Spatial indexing
- *       - Divide world into regions (64x64 tiles each)
- *       - Hash map: region_id -> list of objects
- *       - Lookup: O(1) to find region, O(objects_in_region) to search
- *       - Typical speedup: 100-1000x faster
+ *     Algorithm: Open-addressed hash of (coord_pack tile, type) -> slot,
+ *                maintained by object_spawn/object_despawn
+ *     Time: O(1) average (table at most half full)
+ *     Space: 8 bytes per table entry, 2-4 entries per object slot
  * 
  * CACHE FILE FORMAT (simplified):
  * 
@@ -218,18 +206,19 @@
  *   object_system_init      │ O(defs)         │ O(defs)
  *   object_system_destroy   │ O(1)            │ O(1)
  *   object_get_definition   │ O(1)            │ O(1)
- *   object_spawn            │ O(capacity)*    │ O(1)
+ *   object_spawn            │ O(1)            │ O(1)
  *   object_despawn          │ O(1)            │ O(1)
- *   object_get_at           │ O(capacity)*    │ O(1)
- * 
- *   * Could be optimized to O(1) with free list (spawn) or
- *     O(objects_in_region) with spatial indexing (get_at)
+ *   object_get_at           │ O(1) average    │ O(1)
  * 
  ******************************************************************************/
 
 #include "object.h"
+#include "movement.h"  /* coord_pack */
+#include "loctype.h"   /* loc shapes */
+#include "mem_stats.h"
+#include "log.h"
 #include <stdlib.h>  /* malloc, calloc, free */
-#include <string.h>  /* strcpy, memset */
+#include <string.h>  /* memset */
 #include <stdio.h>   /* printf (for debug output) */
 
 /*******************************************************************************
@@ -261,6 +250,74 @@
  ******************************************************************************/
 ObjectSystem* g_objects = NULL;
 
+/*******************************************************************************
+ * POSITION TABLE
+ *******************************************************************************
+ * 
+ * Open-addressed hash of (coord_pack(height, x, z), type) -> object slot,
+ * kept in step with the objects array by object_spawn()/object_despawn().
+ * 
+ *   index = hash(key, type) & mask, then index+1, index+2, ... (wrapping)
+ *   until the matching entry or an empty one.
+ * 
+ * Removal uses backward-shift deletion: entries after the hole that
+ * could live in it (their home index is not between the hole and
+ * themselves) move back, so every run stays unbroken without tombstones:
+ * 
+ *   before remove B:  [A h=4][B h=4][C h=5][D h=7]   (indices 4..7)
+ *   remove B (at 5):  C (home 5) moves into 5, D (home 7) stays
+ *   after:            [A h=4][C h=5][  empty ][D h=7]
+ ******************************************************************************/
+
+static inline u32 object_hash(u32 key, u8 type) {
+    u32 h = (key ^ ((u32)type << 30)) * 0x9E3779B1u;  /* Fibonacci hashing */
+    return h ^ (h >> 16);
+}
+
+static void object_table_insert(ObjectSystem* objects, u32 slot) {
+    const GameObject* obj = &objects->objects[slot];
+    u32 key = obj->position.packed;
+    u32 i = object_hash(key, obj->type) & objects->by_tile_mask;
+    
+    /* The table is at most half full, so this always finds an empty entry */
+    while (objects->by_tile[i].used) {
+        i = (i + 1) & objects->by_tile_mask;
+    }
+    objects->by_tile[i].key = key;
+    objects->by_tile[i].slot = (u16)slot;
+    objects->by_tile[i].type = obj->type;
+    objects->by_tile[i].used = 1;
+}
+
+static void object_table_remove(ObjectSystem* objects, u32 slot) {
+    const GameObject* obj = &objects->objects[slot];
+    u32 mask = objects->by_tile_mask;
+    u32 key = obj->position.packed;
+    u32 i = object_hash(key, obj->type) & mask;
+    
+    while (objects->by_tile[i].used && objects->by_tile[i].slot != slot) {
+        i = (i + 1) & mask;
+    }
+    if (!objects->by_tile[i].used) return;  /* Not in the table */
+    
+    /* Backward shift: pull later entries of the run into the hole */
+    u32 j = i;
+    for (;;) {
+        j = (j + 1) & mask;
+        ObjectHashEntry* entry = &objects->by_tile[j];
+        if (!entry->used) break;
+        
+        u32 home = object_hash(entry->key, entry->type) & mask;
+        /* Can entry move to i? Only if home is not in (i, j] cyclically */
+        bool stays = (i <= j) ? (home > i && home <= j) : (home > i || home <= j);
+        if (stays) continue;
+        
+        objects->by_tile[i] = *entry;
+        i = j;
+    }
+    objects->by_tile[i].used = 0;
+}
+
 /*******************************************************************************
  * LIFECYCLE MANAGEMENT
  ******************************************************************************/
@@ -323,7 +380,7 @@ ObjectSystem* object_system_create(u32 capacity) {
      *   - object_count = 0
      *   - definitions = NULL (0)
      */
-    ObjectSystem* objects = calloc(1, sizeof(ObjectSystem));
+    ObjectSystem* objects = mem_calloc(MEM_OBJECT, 1, sizeof(ObjectSystem));
     if (!objects) return NULL;  /* Out of memory - allocation failed */
     
     /* Store capacity for later reference
@@ -337,12 +394,29 @@ ObjectSystem* object_system_create(u32 capacity) {
      *   - All positions are (0, 0, 0)
      *   - All flags are false
      */
-    objects->objects = calloc(capacity, sizeof(GameObject));
+    objects->objects = mem_calloc(MEM_OBJECT, capacity, sizeof(GameObject));
     if (!objects->objects) { 
         /* Objects array allocation failed
          * Must free ObjectSystem struct to prevent memory leak
          */
-        free(objects);  /* Clean up partial allocation */
+        mem_free(objects);  /* Clean up partial allocation */
+        return NULL;
+    }
+    
+    /* Every slot starts on the free list (fails above SLOTMAP_MAX_CAPACITY) */
+    objects->slots = slotmap_new(capacity, 0);
+    
+    /* Position table: power of two, at least twice capacity (<= half full) */
+    u32 table_size = 16;
+    while (table_size < capacity * 2) table_size <<= 1;
+    objects->by_tile = mem_calloc(MEM_OBJECT, table_size, sizeof(ObjectHashEntry));
+    objects->by_tile_mask = table_size - 1;
+    
+    if (!objects->slots || !objects->by_tile) {
+        slotmap_free(objects->slots);
+        mem_free(objects->by_tile);
+        mem_free(objects->objects);
+        mem_free(objects);
         return NULL;
     }
     
@@ -376,25 +450,16 @@ ObjectSystem* object_system_create(u32 capacity) {
  *   │                    Free Memory                          │
  *   └─────────────────────────────────────────────────────────┘
  * 
- * DEALLOCATION ORDER:
- *   1. definitions array (dynamically allocated in init)
- *   2. objects array (dynamically allocated in create)
- *   3. ObjectSystem struct (outermost allocation)
- * 
- *   Order doesn't technically matter (free() doesn't care), but
- *   following reverse allocation order is good practice
+ * DEFINITIONS ARE NOT FREED HERE:
+ *   definitions and text point into g_defs (decoded tables or the mapped
+ *   snapshot) and are released by def_store_destroy().
  * 
  * NULL POINTER SAFETY:
  *   Safe to call with NULL argument (does nothing)
- *   Safe to call if definitions is NULL (wasn't initialized)
  *   
  *   Example safe usage:
  *     ObjectSystem* sys = NULL;
  *     object_system_destroy(sys);  // Safe, does nothing
- *     
- *     sys = object_system_create(1000);
- *     // Skip init, so definitions is NULL
- *     object_system_destroy(sys);  // Safe, only frees objects and struct
  * 
  * CALLER RESPONSIBILITIES:
  *   This function ONLY frees memory. Before calling, caller should:
@@ -414,22 +479,113 @@ void object_system_destroy(ObjectSystem* objects) {
     /* NULL check - safe to call on NULL pointer */
     if (!objects) return;
     
-    /* Free definitions array (allocated in object_system_init)
-     * Check if NULL first - may not be allocated if init was never called
-     */
-    if (objects->definitions) {
-        free(objects->definitions);
-    }
-    
     /* Free objects array (allocated in object_system_create)
      * Always allocated if objects != NULL (created successfully)
      */
     if (objects->objects) {
-        free(objects->objects);
+        mem_free(objects->objects);
     }
     
+    slotmap_free(objects->slots);
+    mem_free(objects->by_tile);
+    
     /* Free ObjectSystem struct itself (outermost allocation) */
-    free(objects);
+    mem_free(objects);
+}
+
+/*
+ * object_type_for_shape - ObjectType of a loc shape (loctype.h)
+ * 
+ *   0-3, 9   walls              → OBJECT_TYPE_WALL
+ *   4-8      wall decorations   → OBJECT_TYPE_WALL_DECORATION
+ *   10-21    centrepieces/roofs → OBJECT_TYPE_INTERACTABLE
+ *   22       ground decoration  → OBJECT_TYPE_GROUND_DECORATION
+ */
+u8 object_type_for_shape(i32 shape) {
+    if (shape < 0) return OBJECT_TYPE_INTERACTABLE;
+    if (shape <= WALL_SQUARECORNER || shape == WALL_DIAGONAL) return OBJECT_TYPE_WALL;
+    if (shape <= WALLDECOR_DIAGONAL_BOTH) return OBJECT_TYPE_WALL_DECORATION;
+    if (shape == GROUNDDECOR) return OBJECT_TYPE_GROUND_DECORATION;
+    return OBJECT_TYPE_INTERACTABLE;
+}
+
+/* The client hides an option spelled "hidden" (any case) */
+static bool object_option_hidden(const char* option) {
+    const char* hidden = "hidden";
+    for (u32 i = 0; i < 6; i++) {
+        char c = option[i];
+        if (c >= 'A' && c <= 'Z') c = (char)(c - 'A' + 'a');
+        if (c != hidden[i]) return false;
+    }
+    return option[6] == '\0';
+}
+
+/*
+ * object_decode - Decode one loc.dat definition into def / text
+ * 
+ * Same opcode table as decode_loc() in world_collision.c (and the
+ * client's loctype_decode), keeping the fields ObjectDefinition has.
+ */
+static void object_decode(ConfigReader* r, ObjectDefinition* def, ObjectText* text) {
+    def->width = 1;
+    def->length = 1;
+    def->solid = true;
+    def->impenetrable = true;
+    
+    i32 active = -1;
+    bool has_ops = false;
+    i32 first_shape = -1;
+    
+    for (;;) {
+        u32 op = config_g1(r);
+        if (op == 0 || r->overrun) break;
+        
+        if (op == 1) {
+            u32 n = config_g1(r);
+            for (u32 i = 0; i < n; i++) {
+                u32 model = config_g2(r);
+                u32 shape = config_g1(r);
+                if (i == 0) first_shape = (i32)shape;
+                if (i < 10) {
+                    def->model_ids[i] = (u16)model;
+                    def->model_types[i] = (u16)shape;
+                    def->model_count = (u8)(i + 1);
+                }
+            }
+        }
+        else if (op == 2) text->name = config_string(r, g_defs);
+        else if (op == 3) text->examine = config_string(r, g_defs);
+        else if (op == 14) def->width = (u8)config_g1(r);
+        else if (op == 15) def->length = (u8)config_g1(r);
+        else if (op == 17) def->solid = false;
+        else if (op == 18) def->impenetrable = false;
+        else if (op == 19) active = (i32)config_g1(r);
+        else if (op == 23) def->clipped = true;
+        else if (op == 21 || op == 22 || op == 25 || op == 62 || op == 64 || op == 73) {
+            /* Flags without a payload */
+        }
+        else if (op == 28 || op == 29 || op == 39) config_skip(r, 1);
+        else if (op >= 30 && op < 39) {
+            u32 option = config_string(r, g_defs);
+            has_ops = true;
+            if (op < 35 && !object_option_hidden(def_store_string(g_defs, option))) {
+                text->actions[op - 30] = option;
+            }
+        }
+        else if (op == 40) config_skip(r, config_g1(r) * 4);
+        else if (op == 24 || op == 60 || (op >= 65 && op <= 68) || (op >= 70 && op <= 72)) {
+            config_skip(r, 2);
+        }
+        else if (op == 69) config_skip(r, 1);
+        else break;     /* Unknown opcode: the rest is unreadable */
+    }
+    
+    def->type = object_type_for_shape(first_shape);
+    if (active == -1) {
+        def->interactive = first_shape == CENTREPIECE_STRAIGHT || has_ops;
+    } else {
+        def->interactive = active == 1;
+    }
 }
 
 /*
@@ -437,210 +593,116 @@ void object_system_destroy(ObjectSystem* objects) {
  * 
  * ALGORITHM STEPS:
  *   1. Validate parameters (objects not NULL, not already initialized)
- *   2. Set definition_count (currently hardcoded to 30,000)
- *   3. Allocate definitions array (definition_count entries)
- *   4. Load definitions from cache file (TODO: not yet implemented)
- *   5. Populate example definitions (Door, Tree) for testing
- *   6. Set initialized=true
- *   7. Reset object_count=0 (ensure clean state)
- * 
- * DEFINITION LOADING PROCESS (when cache is implemented):
- * 
- *   1. Open cache file:
- *      FILE* f = fopen("./cache/objects/definitions.dat", "rb");
- *   
- *   2. Read definition count:
- *      fread(&definition_count, sizeof(u32), 1, f);
- *   
- *   3. For each definition:
- *      a. Read ID:
- *         u16 id;
- *         fread(&id, sizeof(u16), 1, f);
- *      
- *      b. Read name (length-prefixed string):
- *         u8 name_len;
- *         fread(&name_len, 1, 1, f);
- *         fread(definitions[id].name, 1, name_len, f);
- *         definitions[id].name[name_len] = '\0';  // Null-terminate
- *      
- *      c. Read examine text (same pattern as name)
- *      
- *      d. Read properties:
- *         fread(&definitions[id].type, 1, 1, f);
- *         fread(&definitions[id].width, 1, 1, f);
- *         fread(&definitions[id].length, 1, 1, f);
- *      
- *      e. Read flags (packed bits):
- *         u8 flags;
- *         fread(&flags, 1, 1, f);
- *         definitions[id].solid = (flags & 0x01) != 0;
- *         definitions[id].impenetrable = (flags & 0x02) != 0;
- *         definitions[id].interactive = (flags & 0x04) != 0;
- *         definitions[id].clipped = (flags & 0x08) != 0;
- *      
- *      f. Read models (count, then array of IDs and types)
- *      
- *      g. Read actions (count, then array of length-prefixed strings)
- *   
- *   4. Close file:
- *      fclose(f);
- * 
- * EXAMPLE DEFINITION INITIALIZATION (Door):
- * 
- *   ObjectDefinition* door = &objects->definitions[1519];
- *   
- *   Memory layout before:
- *     All bytes are zero (from calloc)
- *   
- *   After initialization:
- *   ┌─────────────────────────────────────────────────────────┐
- *   │ id = 1519                                               │
- *   │ name = "Door\0" (remaining 59 bytes are zero)           │
- *   │ examine = "A wooden door.\0" (remaining 113 bytes zero) │
- *   │ type = 0 (OBJECT_TYPE_WALL)                             │
- *   │ width = 1                                               │
- *   │ length = 1                                              │
- *   │ solid = true (1)                                        │
- *   │ impenetrable = false (0)                                │
- *   │ interactive = true (1)                                  │
- *   │ clipped = true (1)                                      │
- *   │ model_ids = {0, 0, ...} (all zero, no models set)       │
- *   │ model_types = {0, 0, ...} (all zero)                    │
- *   │ model_count = 0                                         │
- *   │ actions[0] = "Open\0" (28 bytes zero)                   │
- *   │ actions[1-4] = "" (all zeros, no action)                │
- *   └─────────────────────────────────────────────────────────┘
+ *   2. Snapshot current: point definitions/text at its loc tables
+ *   3. Otherwise decode loc.idx / loc.dat into def_store_table() tables
+ *   4. No config archive: hand-written Door (1519) and Tree (1276)
+ *   5. Set initialized=true, reset object_count=0
+ * 
+ * DECODED DEFINITION (Door, loc 1519 in this revision):
+ * 
+ *   definitions[1519]               text[1519]
+ *   ┌──────────────────────┐       ┌───────────────────────────┐
+ *   │ type = WALL          │       │ name    → "Door"          │
+ *   │ width = 1, length = 1│       │ examine → "A wooden door."│
+ *   │ solid = true         │       │ actions → {"Open", ...}   │
+ *   │ interactive = true   │       └───────────────────────────┘
+ *   │ model_ids = {...}    │        offsets into the string pool
+ *   └──────────────────────┘
  * 
  * IDEMPOTENCY:
  *   NOT idempotent - calling twice returns false
  *   initialized flag prevents double initialization
- *   
- *   Scenario:
- *     object_system_init(sys);  // Returns true, succeeds
- *     object_system_init(sys);  // Returns false, already initialized
  * 
  * ERROR CASES:
  *   Returns false if:
- *     - objects is NULL (invalid parameter)
+ *     - objects is NULL or g_defs is NULL (invalid parameter)
  *     - objects->initialized is true (already initialized)
- *     - definitions allocation fails (out of memory)
- *     - Cache file cannot be opened (TODO: when implemented)
- *     - Cache file has invalid format (TODO: when implemented)
+ *     - a table allocation fails (out of memory)
  * 
- * COMPLEXITY: O(definition_count) time, O(definition_count) space
+ * COMPLEXITY: O(size of loc.dat); O(1) when mapped from the snapshot
  */
 bool object_system_init(ObjectSystem* objects) {
     /* Validate parameters
      * Return false if system is NULL or already initialized
      */
-    if (!objects || objects->initialized) return false;
+    if (!objects || objects->initialized || !g_defs) return false;
     
-    /* TODO: Load definition_count from cache file
-     * For now, hardcode to 30,000 (typical RuneScape object count)
-     * This covers all objects from original game plus custom additions
-     */
-    objects->definition_count = 30000;
+    /* Fast path: tables straight out of the snapshot */
+    u32 count = 0, text_count = 0;
+    const ObjectDefinition* mapped = def_store_section(g_defs, DEF_SECTION_OBJECTS,
+                                                       sizeof(ObjectDefinition), &count);
+    const ObjectText* mapped_text = def_store_section(g_defs, DEF_SECTION_OBJECT_TEXT,
+                                                      sizeof(ObjectText), &text_count);
+    if (mapped && mapped_text && text_count == count) {
+        objects->definitions = mapped;
+        objects->text = mapped_text;
+        objects->definition_count = count;
+        printf("Initialized object system with %u definitions (mapped)\n", count);
+        objects->initialized = true;
+        objects->object_count = 0;
+        return true;
+    }
     
-    /* Allocate definitions array
-     * Size: 30,000 * 350 bytes = 10.5 MB
-     * calloc() zeros all memory, so:
-     *   - All IDs are 0 (invalid/unused)
-     *   - All strings are empty ("\0")
-     *   - All flags are false
-     *   - All counts are 0
-     */
-    objects->definitions = calloc(objects->definition_count, sizeof(ObjectDefinition));
+    ConfigTable table;
+    bool have_cache = config_table_open(&table, g_cache, "loc");
+    count = have_cache ? table.count : 1520;
     
-    /* Check allocation success */
-    if (!objects->definitions) {
+    ObjectDefinition* defs = def_store_table(g_defs, DEF_SECTION_OBJECTS,
+                                             sizeof(ObjectDefinition), count);
+    ObjectText* text = def_store_table(g_defs, DEF_SECTION_OBJECT_TEXT,
+                                       sizeof(ObjectText), count);
+    if (!defs || !text) {
         return false;  /* Out of memory */
     }
     
-    /* TODO: Load definitions from cache file
-     * Pseudocode:
-     *   FILE* f = fopen("./cache/objects/definitions.dat", "rb");
-     *   if (!f) return false;
-     *   
-     *   for (int i = 0; i < definition_count; i++) {
-     *     parse_definition_entry(f, &objects->definitions[i]);
-     *   }
-     *   
-     *   fclose(f);
-     * 
-     * For now, hardcode a few example definitions for testing
-     */
-    
-    /* EXAMPLE DEFINITION 1: Door (ID 1519)
-     * 
-     * PROPERTIES:
-     *   - Type: WALL (occupies edge between tiles)
-     *   - Size: 1x1 (single tile edge)
-     *   - Solid: Blocks movement (closed door)
-     *   - Interactive: Can be opened
-     *   - Action: "Open" (primary left-click action)
-     * 
-     * USE CASE:
-     *   Common in buildings, houses, castles
-     *   Player clicks to toggle open/closed state
-     *   When open: solid=false (can walk through)
-     *   When closed: solid=true (blocks movement)
-     */
-    ObjectDefinition* door = &objects->definitions[1519];
-    door->id = 1519;                        /* Unique identifier */
-    strcpy(door->name, "Door");             /* Display name */
-    strcpy(door->examine, "A wooden door."); /* Examine text */
-    door->type = OBJECT_TYPE_WALL;          /* Edge object */
-    door->width = 1;                        /* 1 tile wide */
-    door->length = 1;                       /* 1 tile long */
-    door->solid = true;                     /* Blocks movement */
-    door->interactive = true;               /* Can be clicked */
-    door->clipped = true;                   /* Blocks camera */
-    strcpy(door->actions[0], "Open");       /* Primary action */
-    /* Other fields remain zero (from calloc):
-     *   impenetrable = false (projectiles pass through)
-     *   model_ids = {0, ...} (no models set yet)
-     *   model_count = 0
-     *   actions[1-4] = "" (no other actions)
-     */
+    if (have_cache) {
+        ConfigReader r;
+        for (u32 id = 0; config_table_next(&table, &r); id++) {
+            defs[id].id = (u16)id;
+            object_decode(&r, &defs[id], &text[id]);
+        }
+    } else {
+        /* EXAMPLE DEFINITION 1: Door (ID 1519)
+         * 
+         * Edge object, blocks movement while closed, "Open" on left-click.
+         */
+        ObjectDefinition* door = &defs[1519];
+        door->id = 1519;                        /* Unique identifier */
+        door->type = OBJECT_TYPE_WALL;          /* Edge object */
+        door->width = 1;                        /* 1 tile wide */
+        door->length = 1;                       /* 1 tile long */
+        door->solid = true;                     /* Blocks movement */
+        door->interactive = true;               /* Can be clicked */
+        door->clipped = true;                   /* Blocks camera */
+        text[1519].name = def_store_intern(g_defs, "Door", 4);
+        text[1519].examine = def_store_intern(g_defs, "A wooden door.", 14);
+        text[1519].actions[0] = def_store_intern(g_defs, "Open", 4);
+        
+        /* EXAMPLE DEFINITION 2: Tree (ID 1276)
+         * 
+         * Tile object for woodcutting:
+         *   Tree (permanent) -> Stump (temporary) -> Tree (respawned)
+         */
+        ObjectDefinition* tree = &defs[1276];
+        tree->id = 1276;                        /* Unique identifier */
+        tree->type = OBJECT_TYPE_INTERACTABLE;  /* Tile object */
+        tree->width = 1;                        /* 1 tile wide */
+        tree->length = 1;                       /* 1 tile long */
+        tree->solid = true;                     /* Blocks movement */
+        tree->interactive = true;               /* Can be clicked */
+        tree->clipped = true;                   /* Blocks camera */
+        text[1276].name = def_store_intern(g_defs, "Tree", 4);
+        text[1276].examine = def_store_intern(g_defs, "A healthy tree.", 15);
+        text[1276].actions[0] = def_store_intern(g_defs, "Chop down", 9);
+    }
     
-    /* EXAMPLE DEFINITION 2: Tree (ID 1276)
-     * 
-     * PROPERTIES:
-     *   - Type: INTERACTABLE (occupies full tile)
-     *   - Size: 1x1 (single tile)
-     *   - Solid: Blocks movement (cannot walk through tree)
-     *   - Interactive: Can be chopped with axe
-     *   - Action: "Chop down" (woodcutting skill)
-     * 
-     * USE CASE:
-     *   Woodcutting skill training
-     *   Player clicks with axe equipped
-     *   After chopping: despawn tree, spawn logs item, spawn stump
-     *   After timeout: despawn stump, respawn tree
-     * 
-     * LIFECYCLE:
-     *   Tree (permanent) -> Stump (temporary) -> Tree (respawned)
-     */
-    ObjectDefinition* tree = &objects->definitions[1276];
-    tree->id = 1276;                        /* Unique identifier */
-    strcpy(tree->name, "Tree");             /* Display name */
-    strcpy(tree->examine, "A healthy tree."); /* Examine text */
-    tree->type = OBJECT_TYPE_INTERACTABLE;  /* Tile object */
-    tree->width = 1;                        /* 1 tile wide */
-    tree->length = 1;                       /* 1 tile long */
-    tree->solid = true;                     /* Blocks movement */
-    tree->interactive = true;               /* Can be clicked */
-    tree->clipped = true;                   /* Blocks camera */
-    strcpy(tree->actions[0], "Chop down");  /* Primary action */
-    /* Other fields remain zero:
-     *   impenetrable = false (arrows pass over/around)
-     *   model_ids = {0, ...}
-     *   model_count = 0
-     *   actions[1-4] = ""
-     */
+    objects->definitions = defs;
+    objects->text = text;
+    objects->definition_count = count;
     
     /* Log initialization success */
-    printf("Initialized object system with %u definitions\n", objects->definition_count);
+    printf("Initialized object system with %u definitions%s\n", count,
+           have_cache ? "" : " (no cache)");
     
     /* Mark system as initialized and ready for use */
     objects->initialized = true;
@@ -727,7 +789,7 @@ bool object_system_init(ObjectSystem* objects) {
  * 
  * COMPLEXITY: O(1) time, O(1) space
  */
-ObjectDefinition* object_get_definition(ObjectSystem* objects, u16 id) {
+const ObjectDefinition* object_get_definition(ObjectSystem* objects, u16 id) {
     /* Validate parameters
      * Check if system exists and is initialized
      */
@@ -756,6 +818,23 @@ ObjectDefinition* object_get_definition(ObjectSystem* objects, u16 id) {
     return &objects->definitions[id];
 }
 
+const char* object_get_name(ObjectSystem* objects, u16 id) {
+    if (!objects || !objects->initialized || id >= objects->definition_count) return "";
+    return def_store_string(g_defs, objects->text[id].name);
+}
+
+const char* object_get_examine(ObjectSystem* objects, u16 id) {
+    if (!objects || !objects->initialized || id >= objects->definition_count) return "";
+    return def_store_string(g_defs, objects->text[id].examine);
+}
+
+const char* object_get_action(ObjectSystem* objects, u16 id, u32 index) {
+    if (!objects || !objects->initialized || id >= objects->definition_count || index >= 5) {
+        return "";
+    }
+    return def_store_string(g_defs, objects->text[id].actions[index]);
+}
+
 /*******************************************************************************
  * OBJECT INSTANCE FUNCTIONS
  ******************************************************************************/
@@ -765,68 +844,28 @@ ObjectDefinition* object_get_definition(ObjectSystem* objects, u16 id) {
  * 
  * ALGORITHM STEPS:
  *   1. Validate parameters (system initialized, capacity not exceeded)
- *   2. Find free slot in objects array (linear search for id==0)
+ *   2. Pop a free slot from the slots free list
  *   3. Initialize GameObject fields with provided parameters
  *   4. Increment object_count
  *   5. Log spawn message (debug output)
  *   6. Return pointer to new GameObject
  * 
- * FREE SLOT SEARCH ALGORITHM:
+ * FREE SLOT ALLOCATION:
  * 
- *   Linear search for first id==0 slot:
+ *   Free slots are linked in a FIFO list (objects->slots):
  *   
- *   for (i = 0; i < object_capacity; i++) {
- *     if (objects[i].id == 0) {
- *       // Found free slot at index i
- *       return &objects[i];
- *     }
- *   }
- *   // No free slots found
- *   return NULL;
+ *   u32 slot = slotmap_alloc(objects->slots);  // pop head, O(1)
+ *   ...
+ *   slotmap_release(objects->slots, slot);     // push tail, O(1)
  *   
- *   BEST CASE: First slot is free
- *     - Check objects[0], find id==0
- *     - Return immediately
- *     - Time: O(1)
+ *   The previous linear search for the first id==0 slot cost
+ *   O(capacity) once the array filled up - at 9,999 of 10,000 objects
+ *   every spawn read nearly the whole array. The free list costs the
+ *   same at any fill level.
  *   
- *   AVERAGE CASE: Object count = capacity / 2
- *     - Check objects[0..capacity/2]
- *     - Find free slot around middle
- *     - Time: O(capacity/2) = O(capacity)
- *   
- *   WORST CASE: All slots full
- *     - Check all capacity slots
- *     - Return NULL (no free slots)
- *     - Time: O(capacity)
- * 
- * OPTIMIZATION - FREE LIST:
- * 
- *   Instead of linear search, maintain stack of free indices:
- *   
- *   struct ObjectSystem {
- *     ...
- *     u32* free_list;      // Array of free indices
- *     u32 free_list_top;   // Stack pointer (next free index)
- *   };
- *   
- *   Initialization:
- *     for (i = 0; i < capacity; i++) {
- *       free_list[i] = i;  // All slots initially free
- *     }
- *     free_list_top = capacity - 1;
- *   
- *   Allocation:
- *     if (free_list_top < 0) return NULL;  // No free slots
- *     u32 index = free_list[free_list_top--];  // Pop from stack
- *     return &objects[index];  // O(1) allocation!
- *   
- *   Deallocation:
- *     free_list[++free_list_top] = index;  // Push to stack, O(1)
- *   
- *   Trade-off:
- *     - Faster: O(1) allocation vs O(n) linear search
- *     - More memory: capacity * 4 bytes for free_list
- *     - Example: 100,000 capacity = 400KB extra memory
+ *   FIFO rather than a stack: the slot reused is the one free the
+ *   longest, not the one just vacated, so a stale GameObject* kept past
+ *   object_despawn() is less likely to point at a new object.
  * 
  * POSITION INITIALIZATION:
  * 
@@ -857,7 +896,7 @@ ObjectDefinition* object_get_definition(ObjectSystem* objects, u16 id) {
  *     - Temporary spawns are rare (runtime actions)
  *     - Keeps function signature simpler
  * 
- * COMPLEXITY: O(capacity) worst case for free slot search, O(1) space
+ * COMPLEXITY: O(1) time (free list pop), O(1) space
  */
 GameObject* object_spawn(ObjectSystem* objects, u16 object_id, u32 x, u32 z, u32 height, u8 type, u8 rotation) {
     /* Validate parameters
@@ -867,35 +906,19 @@ GameObject* object_spawn(ObjectSystem* objects, u16 object_id, u32 x, u32 z, u32
         return NULL;  /* Invalid parameters or capacity exceeded */
     }
     
-    /* Find free slot in objects array
-     * Linear search for first slot with id==0
-     * 
-     * OPTIMIZATION OPPORTUNITY:
-     *   This is O(capacity) worst case
-     *   Could be O(1) with free list data structure
-     *   
-     * Trade-off:
-     *   - Current: Simple, no extra memory
-     *   - Free list: Faster, uses capacity * 4 bytes extra
-     */
-    GameObject* obj = NULL;
-    for (u32 i = 0; i < objects->object_capacity; i++) {
-        if (objects->objects[i].id == 0) {
-            /* Found free slot at index i
-             * id==0 means slot is not occupied
-             */
-            obj = &objects->objects[i];
-            break;  /* Stop searching, found what we need */
-        }
-    }
+    /* id 0 marks a free slot: such an object could never be despawned
+     * and its slot would never return to the free list */
+    if (object_id == 0) return NULL;
     
-    /* Check if free slot was found
-     * obj==NULL means all slots are occupied
+    /* Take the slot that has been free the longest
+     * O(1): popped from the free list, no scan for id==0
      */
-    if (!obj) {
-        printf("No free object slots available\n");
+    u32 slot = slotmap_alloc(objects->slots);
+    if (slot == SLOTMAP_NONE) {
+        LOG_WARN("No free object slots available\n");
         return NULL;
     }
+    GameObject* obj = &objects->objects[slot];
     
     /* Initialize GameObject fields
      * 
@@ -940,12 +963,17 @@ GameObject* object_spawn(ObjectSystem* objects, u16 object_id, u32 x, u32 z, u32
      * Caller can change to temporary=true if needed
      */
     obj->temporary = false;
+    obj->removed = false;
     
     /* Initialize spawn time to 0
      * Only used for temporary objects
      * Caller should set to current_tick for temporary spawns
      */
     obj->spawn_time = 0;
+    obj->despawn_timer = TIMER_NONE;
+    
+    /* Findable by object_get_at() from now on */
+    object_table_insert(objects, slot);
     
     /* Increment object count
      * Tracks number of active (id!=0) objects
@@ -958,7 +986,7 @@ GameObject* object_spawn(ObjectSystem* objects, u16 object_id, u32 x, u32 z, u32
     /* Log spawn message for debugging
      * Helps track object lifecycle in server logs
      */
-    printf("Spawned object %u at (%u, %u, %u)\n", object_id, x, z, height);
+    LOG_DEBUG("Spawned object %u at (%u, %u, %u)\n", object_id, x, z, height);
     
     /* Return pointer to newly spawned object
      * Caller can use this to:
@@ -975,7 +1003,8 @@ GameObject* object_spawn(ObjectSystem* objects, u16 object_id, u32 x, u32 z, u32
  * ALGORITHM STEPS:
  *   1. Validate parameters (objects not NULL, object not NULL, object active)
  *   2. Set object->id = 0 (mark slot as FREE)
- *   3. Decrement object_count
+ *   3. Push the slot onto the tail of the free list
+ *   4. Decrement object_count
  *   4. Log despawn message (debug output)
  * 
  * FREE SLOT MARKING:
@@ -1036,7 +1065,7 @@ GameObject* object_spawn(ObjectSystem* objects, u16 object_id, u32 x, u32 z, u32
  *      region_remove_object(region, object);
  *   
  *   2. Update collision map:
- *      ObjectDefinition* def = object_get_definition(sys, object->id);
+ *      const ObjectDefinition* def = object_get_definition(sys, object->id);
  *      if (def->solid) {
  *        collision_remove_object(collision_map, object);
  *      }
@@ -1077,11 +1106,18 @@ void object_despawn(ObjectSystem* objects, GameObject* object) {
      */
     if (!objects || !object || object->id == 0) return;
     
+    /* An early despawn must not leave the timer to hit the next occupant */
+    timer_cancel(g_timers, object->despawn_timer);
+    object->despawn_timer = TIMER_NONE;
+    
     /* Mark slot as FREE
      * Setting id=0 makes this slot available for reuse
      * This is the ONLY field we need to change
      */
+    u32 slot = (u32)(object - objects->objects);
+    object_table_remove(objects, slot);
     object->id = 0;
+    slotmap_release(objects->slots, slot);
     
     /* Decrement active object count
      * Maintains invariant: object_count == number of id!=0 objects
@@ -1092,7 +1128,28 @@ void object_despawn(ObjectSystem* objects, GameObject* object) {
      * Note: We can still read position because it hasn't been cleared
      * (We only set id=0, other fields retain old values)
      */
-    printf("Despawned object at (%u, %u)\n", object->position.x, object->position.z);
+    LOG_DEBUG("Despawned object at (%u, %u)\n", position_x(&object->position), position_z(&object->position));
+}
+
+/*
+ * object_despawn_timer_fired - g_timers callback for object_despawn_after()
+ */
+static void object_despawn_timer_fired(void* ctx, u32 index) {
+    ObjectSystem* objects = (ObjectSystem*)ctx;
+    GameObject* object = &objects->objects[index];
+    object->despawn_timer = TIMER_NONE;  /* Already fired */
+    object_despawn(objects, object);
+}
+
+bool object_despawn_after(ObjectSystem* objects, GameObject* object, u32 ticks) {
+    if (!objects || !object || object->id == 0 || !g_timers) return false;
+    
+    timer_cancel(g_timers, object->despawn_timer);
+    object->temporary = true;
+    object->spawn_time = g_timers->now;
+    object->despawn_timer = timer_schedule(g_timers, ticks, object_despawn_timer_fired, objects,
+                                           (u32)(object - objects->objects));
+    return object->despawn_timer != TIMER_NONE;
 }
 
 /*
@@ -1100,35 +1157,22 @@ void object_despawn(ObjectSystem* objects, GameObject* object) {
  * 
  * ALGORITHM STEPS:
  *   1. Validate parameters (system initialized)
- *   2. Linear search through objects array
- *   3. For each object:
- *        a. Check if slot is occupied (id != 0)
- *        b. Check if position matches (x, z, height)
- *        c. Check if type matches
- *   4. Return first match, or NULL if none found
- * 
- * LINEAR SEARCH PATTERN:
- * 
- *   for (i = 0; i < capacity; i++) {
- *     GameObject* obj = &objects[i];
- *     
- *     // Skip free slots
- *     if (obj->id == 0) continue;
- *     
- *     // Check position match (all 3 coordinates)
- *     if (obj->position.x != x) continue;
- *     if (obj->position.z != z) continue;
- *     if (obj->position.height != height) continue;
- *     
- *     // Check type match
- *     if (obj->type != type) continue;
- *     
- *     // All conditions met - found it!
- *     return obj;
- *   }
+ *   2. key = coord_pack(height, x, z); index = hash(key, type) & mask
+ *   3. Walk the probe run from index:
+ *        a. Skip entries whose key or type differ
+ *        b. Confirm the object's exact position (coord_pack keeps 14
+ *           bits of x and z and 2 of height, so far-out coordinates
+ *           could share a key)
+ *   4. Return first match, or NULL at the first empty entry
+ * 
+ * PROBE PATTERN:
+ * 
+ *   key  = coord_pack(0, 3232, 3232)
+ *   i    = hash(key, WALL) & mask          e.g. 1041
+ *   by_tile[1041]: other tile              -> skip
+ *   by_tile[1042]: key, WALL, slot 17      -> objects[17]
  *   
- *   // Searched all slots, no match found
- *   return NULL;
+ *   (an empty entry ends the run: nothing at that tile)
  * 
  * POSITION MATCHING:
  * 
@@ -1183,55 +1227,15 @@ void object_despawn(ObjectSystem* objects, GameObject* object) {
  *     - But returning first match is safe behavior
  *     - Alternative: Return NULL on duplicate (too strict)
  * 
- * OPTIMIZATION - SPATIAL INDEXING:
+ * WHY A HASH TABLE:
  * 
- *   CURRENT IMPLEMENTATION (linear search):
- *     Time: O(capacity)
- *     Space: O(1) extra
- *     
- *     Problem: Must check ALL capacity slots
- *     Example: capacity=100,000, object at index 99,999
- *              Must check 99,999 slots before finding it
- *   
- *   OPTIMIZED (region-based spatial indexing):
- *     
- *     Divide world into regions (e.g., 64x64 tiles each):
- *     
- *     struct Region {
- *       GameObject* objects[1000];  // Max 1000 objects per region
- *       u32 object_count;
- *     };
- *     
- *     Region regions[256][256];  // 256x256 region grid
- *     
- *     Lookup:
- *       1. Calculate region: region_x = x / 64, region_z = z / 64
- *       2. Get region: Region* r = &regions[region_x][region_z]
- *       3. Search region: Linear search r->objects (only ~100-1000 objects)
- *     
- *     Time: O(objects_in_region) typically 100-1000
- *     Space: O(capacity) for region arrays
- *     
- *     Speedup: 100-1000x faster!
- *   
- *   OPTIMIZED (hash map):
- *     
- *     Hash function:
- *       hash = (x << 16) | (z << 8) | (height << 4) | type
- *     
- *     Hash map: hash -> list of objects
- *     
- *     Lookup:
- *       1. Calculate hash
- *       2. Get hash bucket: list = hashmap[hash % bucket_count]
- *       3. Search list: Linear search (only ~1-10 objects)
- *     
- *     Time: O(1) average, O(n) worst case (hash collision)
- *     Space: O(capacity) for hash map
- *     
- *     Speedup: 1000-10000x faster!
+ *   The previous linear scan checked every slot: O(capacity) per call,
+ *   on every object click and door toggle, and collision updates will
+ *   call it for every loc loaded from the map files. The table is at
+ *   most half full, so a lookup visits one or two entries regardless of
+ *   how many objects are loaded.
  * 
- * COMPLEXITY: O(capacity) worst case, O(1) space
+ * COMPLEXITY: O(1) average, O(1) space
  */
 GameObject* object_get_at(ObjectSystem* objects, u32 x, u32 z, u32 height, u8 type) {
     /* Validate parameters
@@ -1239,51 +1243,69 @@ GameObject* object_get_at(ObjectSystem* objects, u32 x, u32 z, u32 height, u8 ty
      */
     if (!objects || !objects->initialized) return NULL;
     
-    /* Linear search through all object slots
-     * Check each slot for matching position and type
-     * 
-     * PERFORMANCE:
-     *   Best case: First slot matches (O(1))
-     *   Average case: Match at middle (O(capacity/2))
-     *   Worst case: No match, check all (O(capacity))
-     */
-    for (u32 i = 0; i < objects->object_capacity; i++) {
-        GameObject* obj = &objects->objects[i];
-        
-        /* Check if slot is occupied
-         * id==0 means FREE slot, skip it
-         * 
-         * OPTIMIZATION: Early exit on free slots
-         * Avoids checking position/type for empty slots
-         */
-        if (obj->id == 0) continue;
-        
-        /* Check position match (all 3 coordinates must match)
-         * Uses short-circuit evaluation for efficiency:
-         *   - If X doesn't match, don't check Z or height
-         *   - If Z doesn't match, don't check height
-         *   - Only if all 3 match do we check type
-         */
-        if (obj->position.x != x) continue;      /* X mismatch */
-        if (obj->position.z != z) continue;      /* Z mismatch */
-        if (obj->position.height != height) continue;  /* Height mismatch */
-        
-        /* Check type match
-         * Type filtering allows multiple objects at same position
-         */
-        if (obj->type != type) continue;         /* Type mismatch */
-        
-        /* All conditions met - found matching object!
-         * Return pointer to object (not a copy)
-         */
-        return obj;
+    u32 mask = objects->by_tile_mask;
+    u32 key = coord_pack(height, x, z);
+    u32 i = object_hash(key, type) & mask;
+    
+    /* Probe the run; an empty entry means no such object */
+    while (objects->by_tile[i].used) {
+        const ObjectHashEntry* entry = &objects->by_tile[i];
+        if (entry->key == key && entry->type == type) {
+            /* Exact position check (the key drops high coordinate bits) */
+            GameObject* obj = &objects->objects[entry->slot];
+            if (position_x(&obj->position) == x && position_z(&obj->position) == z && position_height(&obj->position) == height) {
+                return obj;
+            }
+        }
+        i = (i + 1) & mask;
     }
     
-    /* Searched all slots, no match found
-     * Either:
-     *   - No object at that position
-     *   - Object exists but type doesn't match
-     *   - Position is out of bounds (invalid coordinates)
-     */
     return NULL;
 }
+
+bool object_loc_at(ObjectSystem* objects, const StaticLocs* locs, u32 x, u32 z, u32 height,
+                   u8 type, ObjectLoc* out) {
+    /* An override decides, whatever the map says */
+    const GameObject* object = object_get_at(objects, x, z, height, type);
+    if (object) {
+        if (object->removed) return false;
+        out->id = object->id;
+        out->type = object->type;
+        out->rotation = object->rotation;
+        out->from_map = false;
+        return true;
+    }
+
+    const StaticLoc* loc = static_locs_at(locs, x, z, height, type);
+    if (!loc) return false;
+    out->id = loc->id;
+    out->type = type;
+    out->rotation = (u8)static_loc_rotation(loc);
+    out->from_map = true;
+    return true;
+}
+
+bool object_remove_loc(ObjectSystem* objects, const StaticLocs* locs, u32 x, u32 z, u32 height,
+                       u8 type) {
+    GameObject* object = object_get_at(objects, x, z, height, type);
+    if (object && object->removed) return false;
+
+    const StaticLoc* loc = static_locs_at(locs, x, z, height, type);
+    if (!loc) {
+        if (!object) return false;
+        object_despawn(objects, object);
+        return true;
+    }
+
+    /* Hide the map loc: turn the override into a marker, or add one */
+    if (!object) {
+        object = object_spawn(objects, loc->id, x, z, height, type, (u8)static_loc_rotation(loc));
+        if (!object) return false;
+    } else {
+        timer_cancel(g_timers, object->despawn_timer);
+        object->despawn_timer = TIMER_NONE;
+    }
+    object->removed = true;
+    object->temporary = true;
+    return true;
+}
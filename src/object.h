@@ -256,40 +256,35 @@
  * 
  * SPATIAL INDEXING:
  * 
- * Objects are indexed by region for efficient lookup:
+ * Objects are indexed by tile for efficient lookup:
  * 
  *   NAIVE APPROACH (linear search):
  *     To find object at (3232, 3232):
  *       - Search ALL objects in world
  *       - O(n) time where n = total objects (millions!)
  * 
- *   OPTIMIZED APPROACH (region-based):
+ *   HASHED APPROACH (used here):
  *     To find object at (3232, 3232):
- *       1. Calculate region: (3232 >> 3) = region 404
- *       2. Search only objects in region 404
- *       3. O(m) time where m = objects in region (hundreds)
- *       4. Speedup: ~10,000x faster!
+ *       1. Pack the tile: coord_pack(height, 3232, 3232)
+ *       2. Hash (tile, type) into the position table
+ *       3. O(1) average: one or two entries probed
  * 
  * OBJECT LOOKUP ALGORITHM:
  * 
  *   function object_get_at(x, z, height, type):
- *     1. Calculate region coordinates from (x, z)
- *     2. Get object list for that region
- *     3. For each object in region:
- *          - Check if position matches (x, z, height)
- *          - Check if type matches (walls vs interactables)
- *          - Return first match
+ *     1. Pack the tile: key = coord_pack(height, x, z)
+ *     2. Hash (key, type) into the object position table
+ *     3. Probe forward from that entry until an empty one:
+ *          - Return the first entry whose key and type match
  *     4. Return NULL if no match found
  * 
  * MEMORY LAYOUT:
  * 
- *   ObjectDefinition Structure (approximately 350 bytes):
+ *   ObjectDefinition Structure (50 bytes):
  *   ┌──────────────┬────────┬──────────────────────────────┐
  *   │ Field        │ Size   │ Purpose                      │
  *   ├──────────────┼────────┼──────────────────────────────┤
  *   │ id           │ 2 B    │ Unique identifier (0-65535)  │
- *   │ name         │ 64 B   │ Display name "Door"          │
- *   │ examine      │ 128 B  │ Examine text "A wooden door" │
  *   │ type         │ 1 B    │ Object type (0-3)            │
  *   │ width        │ 1 B    │ Width in tiles (1-10)        │
  *   │ length       │ 1 B    │ Length in tiles (1-10)       │
@@ -300,9 +295,11 @@
  *   │ model_ids    │ 20 B   │ 3D model IDs (10 * u16)      │
  *   │ model_types  │ 20 B   │ Model types (10 * u16)       │
  *   │ model_count  │ 1 B    │ Number of models (0-10)      │
- *   │ actions      │ 160 B  │ Action strings (5 * 32 B)    │
  *   └──────────────┴────────┴──────────────────────────────┘
- *   TOTAL: ~350 bytes (with padding)
+ *   TOTAL: 50 bytes (with padding)
+ * 
+ *   ObjectText (28 bytes): name, examine and 5 actions as u32 offsets
+ *   into the shared string pool ("Open" is stored once for every door).
  * 
  *   GameObject Structure (25 bytes):
  *   ┌──────────────┬────────┬──────────────────────────────┐
@@ -316,8 +313,9 @@
  *   │ rotation     │ 1 B    │ Rotation (0-3)               │
  *   │ temporary    │ 1 B    │ Temporary flag (bool)        │
  *   │ spawn_time   │ 8 B    │ Spawn timestamp (u64)        │
+ *   │ despawn_timer│ 4 B    │ Pending despawn (g_timers)   │
  *   └──────────────┴────────┴──────────────────────────────┘
- *   TOTAL: 25 bytes
+ *   TOTAL: 29 bytes
  * 
  *   ObjectSystem Structure (variable size):
  *   ┌──────────────────┬────────┬──────────────────────────┐
@@ -333,9 +331,9 @@
  *   TOTAL: 29 bytes (+ dynamic arrays)
  * 
  *   Total memory for 30,000 definitions + 100,000 instances:
- *     Definitions: 30,000 * 350 B = 10.5 MB
+ *     Definitions: 30,000 * (50 B + 28 B text) = 2.3 MB + string pool
  *     Instances:  100,000 * 25 B  = 2.5 MB
- *     TOTAL: 13 MB (reasonable for modern servers)
+ *     TOTAL: ~5 MB (reasonable for modern servers)
  * 
  * CACHE FILE FORMAT:
  * 
@@ -392,8 +390,7 @@
  *                                      OBJECT_TYPE_WALL);
  * 
  *   4. Get object definition:
- *      ObjectDefinition* def = object_get_definition(objects, obj->id);
- *      printf("Object name: %s\n", def->name);
+ *      printf("Object name: %s\n", object_get_name(objects, obj->id));
  * 
  *   5. Despawn object:
  *      object_despawn(objects, obj);
@@ -408,6 +405,10 @@
 
 #include "types.h"
 #include "position.h"
+#include "timer_wheel.h"
+#include "static_locs.h"
+#include "datastruct/slotmap.h"
+#include "def_store.h"
 
 /*******************************************************************************
  * OBJECT TYPE ENUMERATION
@@ -544,12 +545,12 @@ typedef enum {
  *   model_ids:    3D model IDs for rendering (up to 10 models)
  *   model_types:  Model type flags for each model
  *   model_count:  Number of valid models in model_ids array
- *   actions:      Right-click menu actions (up to 5, empty string = unused)
  * 
- * ACTION ARRAY:
- *   actions[0] = Primary action (left-click, e.g., "Open")
- *   actions[1] = Secondary action (right-click, e.g., "Knock")
- *   actions[2-4] = Additional actions (conditional, e.g., "Pick-lock")
+ * HOT FIELDS ONLY:
+ *   The collision and interaction checks read type, width, length and the
+ *   flags, so those come first and nothing else sits between them. Name,
+ *   examine and the right-click actions are in ObjectText (below), read
+ *   through object_get_name() / object_get_action().
  * 
  * SIZE CALCULATION:
  *   Large objects occupy width * length tiles
@@ -572,8 +573,6 @@ typedef enum {
  * EXAMPLE DEFINITION (Door ID 1519):
  *   {
  *     id = 1519,
- *     name = "Door",
- *     examine = "A wooden door.",
  *     type = OBJECT_TYPE_WALL,
  *     width = 1,
  *     length = 1,
@@ -583,16 +582,15 @@ typedef enum {
  *     clipped = true,
  *     model_ids = {2345, 0, 0, ...},
  *     model_types = {0, 0, 0, ...},
- *     model_count = 1,
- *     actions = {"Open", "", "", "", "Examine"}
+ *     model_count = 1
  *   }
+ *   text[1519] = { name: "Door", examine: "A wooden door.",
+ *                  actions: {"Open", "", "", "", ""} }  (pool offsets)
  * 
  * COMPLEXITY: O(1) lookup by ID (array indexed by object ID)
  */
 typedef struct {
     u16 id;                 /* Unique object identifier (0-65535) */
-    char name[64];          /* Display name, e.g., "Door", "Tree" */
-    char examine[128];      /* Examine text, e.g., "A wooden door." */
     u8 type;                /* ObjectType: wall, decoration, interactable, etc. */
     u8 width;               /* Width in tiles (X axis, typically 1-5) */
     u8 length;              /* Length in tiles (Z axis, typically 1-5) */
@@ -603,9 +601,20 @@ typedef struct {
     u16 model_ids[10];      /* 3D model IDs for rendering (up to 10) */
     u16 model_types[10];    /* Model type/variant for each model */
     u8 model_count;         /* Number of models in model_ids (0-10) */
-    char actions[5][32];    /* Right-click actions (5 slots, 32 chars each) */
 } ObjectDefinition;
 
+/*
+ * ObjectText - Strings of one object definition (string pool offsets)
+ * 
+ * actions[0] is the primary (left-click) option, e.g. "Open";
+ * 0 is the empty string, i.e. no option in that slot.
+ */
+typedef struct {
+    u32 name;               /* e.g. "Door" */
+    u32 examine;            /* e.g. "A wooden door." */
+    u32 actions[5];         /* Right-click options, "" = unused */
+} ObjectText;
+
 /*******************************************************************************
  * GAME OBJECT - Dynamic Instance State
  *******************************************************************************
@@ -632,6 +641,7 @@ typedef struct {
  *   rotation:   Cardinal direction (0=WEST, 1=NORTH, 2=EAST, 3=SOUTH)
  *   temporary:  If true, object was spawned at runtime (not from map cache)
  *   spawn_time: Timestamp when object was spawned (for temporary objects)
+ *   despawn_timer: Pending despawn on g_timers (TIMER_NONE = none)
  * 
  * ID FIELD:
  *   When id=0, this slot is FREE (not occupied by any object)
@@ -659,19 +669,19 @@ typedef struct {
  *   Temporary object lifecycle:
  *     1. Player chops tree (permanent object)
  *     2. Server despawns tree
- *     3. Server spawns stump (temporary=true, spawn_time=current_tick)
- *     4. After timeout (60 seconds), server despawns stump
+ *     3. Server spawns stump, object_despawn_after(stump, 100)
+ *     4. After timeout (60 seconds), g_timers despawns the stump
  *     5. Server respawns tree (permanent object)
  * 
- * SPAWN_TIME USAGE:
- *   For temporary objects, spawn_time stores tick count when spawned
- *   Cleanup system checks: if (current_tick - spawn_time > timeout) despawn
+ * SPAWN_TIME AND DESPAWN_TIMER:
+ *   object_despawn_after() records the spawn tick and schedules the
+ *   despawn on g_timers. Nothing scans the object array for expired
+ *   objects: the timer fires on exactly the tick it is due.
  *   
  *   Example:
  *     spawn_time = 10000 (tick when stump spawned)
- *     current_tick = 10100 (current game tick)
- *     timeout = 100 ticks (60 seconds at 600ms per tick)
- *     if (10100 - 10000 > 100) -> despawn stump
+ *     object_despawn_after(objects, stump, 100)
+ *     tick 10100 -> timer fires -> object_despawn(stump)
  * 
  * FREE SLOT DETECTION:
  *   To find free slot in object array:
@@ -696,9 +706,28 @@ typedef struct {
     u8 type;            /* ObjectType (wall, decoration, interactable, etc.) */
     u8 rotation;        /* Cardinal direction: 0=W, 1=N, 2=E, 3=S */
     bool temporary;     /* True if spawned at runtime (not from map cache) */
+    bool removed;       /* Override hiding the map loc here (static_locs.h) */
     u64 spawn_time;     /* Tick count when spawned (for temporary objects) */
+    TimerHandle despawn_timer;  /* Pending object_despawn_after() timer */
 } GameObject;
 
+/*
+ * ObjectHashEntry - One entry of the object position table
+ * 
+ * The table is open-addressed with linear probing: an entry lives at the
+ * first free index at or after the hash of (key, type). Keeping the key
+ * and type in the entry lets a probe skip non-matching entries without
+ * touching the GameObject itself.
+ * 
+ * SIZE: 8 bytes (the table is 8 bytes x 2-4 entries per object slot)
+ */
+typedef struct {
+    u32 key;            /* coord_pack(height, x, z) */
+    u16 slot;           /* Index in ObjectSystem.objects */
+    u8 type;            /* ObjectType */
+    u8 used;            /* 0 = empty entry (ends a probe) */
+} ObjectHashEntry;
+
 /*******************************************************************************
  * OBJECT SYSTEM - Global Object Manager
  *******************************************************************************
@@ -751,8 +780,18 @@ typedef struct {
  *     - Free slots have id == 0
  *   
  *   Free slot allocation:
- *     Linear search for first id==0 slot: O(capacity) worst case
- *     Could be optimized with free list: O(1) allocation
+ *     Pop the free list in slots (datastruct/slotmap.h): O(1)
+ *     Capacity is limited to SLOTMAP_MAX_CAPACITY (65,536)
+ * 
+ * POSITION TABLE:
+ *   by_tile maps (tile, type) to the object's slot, so object_get_at()
+ *   is O(1) instead of a scan of the objects array:
+ *     - object_spawn() inserts, object_despawn() removes
+ *     - size is a power of two at least twice object_capacity, so the
+ *       table is never more than half full and probes stay short
+ *     - removal shifts later entries of the same run back into the hole
+ *       (backward-shift deletion): no tombstones, lookups never slow
+ *       down after many spawn/despawn cycles
  *   
  *   Example capacity:
  *     object_capacity = 100000 (100K max instances)
@@ -792,15 +831,19 @@ typedef struct {
  * COMPLEXITY:
  *   Storage: O(definition_count + object_capacity) space
  *   Definition lookup: O(1) time (direct array indexing)
- *   Instance spawn: O(capacity) worst case (linear free slot search)
- *   Instance lookup: O(capacity) worst case (linear search by position)
+ *   Instance spawn: O(1) time (free list pop)
+ *   Instance lookup: O(1) average (position table)
  */
 typedef struct {
-    ObjectDefinition* definitions;  /* Array of object templates (from cache) */
+    const ObjectDefinition* definitions;  /* Object templates (owned by g_defs) */
+    const ObjectText* text;         /* Name/examine/actions, indexed like definitions */
     u32 definition_count;           /* Number of definitions loaded */
     GameObject* objects;            /* Array of object instances (in world) */
     u32 object_capacity;            /* Maximum object instances */
     u32 object_count;               /* Current number of spawned objects */
+    SlotMap* slots;                 /* Free object slots, longest-free first */
+    ObjectHashEntry* by_tile;       /* Position table: (tile, type) -> slot */
+    u32 by_tile_mask;               /* Table size - 1 (size is a power of two) */
     bool initialized;               /* True if system is ready */
 } ObjectSystem;
 
@@ -893,15 +936,12 @@ ObjectSystem* object_system_create(u32 capacity);
  * 
  * ALGORITHM:
  *   1. Check if objects is NULL (safe to call on NULL pointer)
- *   2. Free definitions array (if allocated)
- *   3. Free objects array
- *   4. Free ObjectSystem struct
+ *   2. Free objects array and position table
+ *   3. Free ObjectSystem struct
  * 
  * MEMORY DEALLOCATION:
- *   Frees heap allocations in reverse order of creation:
- *     1. definitions array (from object_system_init)
- *     2. objects array (from object_system_create)
- *     3. ObjectSystem struct (from object_system_create)
+ *   Frees what object_system_create allocated. The definition tables
+ *   belong to g_defs and are released by def_store_destroy().
  * 
  * NULL SAFETY:
  *   Safe to call with NULL pointer (no-op)
@@ -941,57 +981,31 @@ void object_system_destroy(ObjectSystem* objects);
  * 
  * ALGORITHM:
  *   1. Check if already initialized (return false if so)
- *   2. Allocate definitions array (30,000 entries)
- *   3. Load definitions from cache file
- *   4. Parse each definition entry
- *   5. Set initialized=true
- * 
- * CURRENT IMPLEMENTATION:
- *   TODO: Full cache loading not yet implemented
- *   Currently hardcodes a few example definitions:
+ *   2. Snapshot current: point at its loc tables and stop
+ *   3. Decode loc.idx / loc.dat from the config archive
+ *   4. Set initialized=true
+ * 
+ * CONFIG FORMAT (loc.dat), same opcodes the collision loader reads:
+ *     1  = models (g1 n, then n x [g2 model, g1 shape])
+ *     2  = name           3  = examine
+ *     14 = width (g1)     15 = length (g1)
+ *     17 = not solid      18 = not impenetrable
+ *     19 = interactive (g1)   23 = occludes (clipped)
+ *     30-34 = options (string, "hidden" = none)
+ *   type comes from the first model's shape (wall, wall decoration,
+ *   centrepiece/roof, ground decoration); without opcode 19 a loc is
+ *   interactive if it has options or is a centrepiece, like the client.
+ * 
+ * NO CACHE:
+ *   Two hand-written definitions keep the system usable:
  *     - Door (ID 1519)
  *     - Tree (ID 1276)
  * 
- * CACHE FILE FORMAT (simplified):
- *   Binary file: ./cache/objects/object_definitions.dat
- *   
- *   Structure:
- *     [definition_count:u32]
- *     For each definition:
- *       [id:u16]
- *       [name_length:u8][name:chars]
- *       [examine_length:u8][examine:chars]
- *       [type:u8][width:u8][length:u8]
- *       [flags:u8]  (packed: solid|impenetrable|interactive|clipped)
- *       [model_count:u8]
- *       For each model:
- *         [model_id:u16][model_type:u16]
- *       [action_count:u8]
- *       For each action:
- *         [action_length:u8][action:chars]
- * 
- * MEMORY ALLOCATION:
- *   Allocates definitions array:
- *     30,000 definitions * 350 bytes = 10.5 MB
- * 
  * ERROR HANDLING:
  *   Returns false if:
- *     - objects is NULL
+ *     - objects is NULL or g_defs is NULL
  *     - Already initialized (initialized=true)
- *     - Definitions allocation fails
- *     - Cache file cannot be opened/parsed
- * 
- * EXAMPLE HARDCODED DEFINITION (Door):
- *   definitions[1519].id = 1519;
- *   strcpy(definitions[1519].name, "Door");
- *   strcpy(definitions[1519].examine, "A wooden door.");
- *   definitions[1519].type = OBJECT_TYPE_WALL;
- *   definitions[1519].width = 1;
- *   definitions[1519].length = 1;
- *   definitions[1519].solid = true;
- *   definitions[1519].interactive = true;
- *   definitions[1519].clipped = true;
- *   strcpy(definitions[1519].actions[0], "Open");
+ *     - A table allocation fails
  * 
  * INITIALIZATION SEQUENCE:
  *   1. Call object_system_create() first
@@ -1011,7 +1025,7 @@ void object_system_destroy(ObjectSystem* objects);
  *   }
  *   printf("Loaded %u object definitions\n", objects->definition_count);
  * 
- * COMPLEXITY: O(definition_count) time for cache loading
+ * COMPLEXITY: O(size of loc.dat); O(1) when mapped from the snapshot
  */
 bool object_system_init(ObjectSystem* objects);
 
@@ -1041,25 +1055,40 @@ bool object_system_init(ObjectSystem* objects);
  *   Definition remains valid until object_system_destroy()
  * 
  * EXAMPLE USAGE:
- *   ObjectDefinition* door_def = object_get_definition(g_objects, 1519);
+ *   const ObjectDefinition* door_def = object_get_definition(g_objects, 1519);
  *   if (!door_def) {
  *     fprintf(stderr, "Unknown object ID: 1519\n");
  *     return;
  *   }
- *   printf("Object name: %s\n", door_def->name);
- *   printf("Examine: %s\n", door_def->examine);
- *   printf("Primary action: %s\n", door_def->actions[0]);
+ *   printf("Object name: %s\n", object_get_name(g_objects, 1519));
+ *   printf("Primary action: %s\n", object_get_action(g_objects, 1519, 0));
  * 
  * USE CASE - PLAYER INTERACTION:
  *   Player clicks object at (3232, 3232):
  *     1. Find GameObject at that position
  *     2. Get definition: def = object_get_definition(sys, obj->id)
  *     3. Check if interactive: if (!def->interactive) return;
- *     4. Execute action: handle_object_action(def->actions[0])
+ *     4. Execute action: handle_object_action(object_get_action(sys, obj->id, 0))
  * 
  * COMPLEXITY: O(1) time (direct array indexing)
  */
-ObjectDefinition* object_get_definition(ObjectSystem* objects, u16 id);
+const ObjectDefinition* object_get_definition(ObjectSystem* objects, u16 id);
+
+/*
+ * object_get_name / object_get_examine - Text of an object ("" if unknown)
+ */
+const char* object_get_name(ObjectSystem* objects, u16 id);
+const char* object_get_examine(ObjectSystem* objects, u16 id);
+
+/*
+ * object_get_action - Right-click option 0-4 of an object ("" if none)
+ */
+const char* object_get_action(ObjectSystem* objects, u16 id, u32 index);
+
+/*
+ * object_type_for_shape - ObjectType of a loc shape (loctype.h)
+ */
+u8 object_type_for_shape(i32 shape);
 
 /*******************************************************************************
  * OBJECT INSTANCE FUNCTIONS
@@ -1079,18 +1108,15 @@ ObjectDefinition* object_get_definition(ObjectSystem* objects, u16 id);
  * 
  * ALGORITHM:
  *   1. Validate parameters (objects initialized, capacity not exceeded)
- *   2. Find free slot in objects array (id == 0)
+ *   2. Pop a free slot from the slots free list
  *   3. Initialize GameObject with provided parameters
- *   4. Increment object_count
- *   5. Return pointer to new object
+ *   4. Insert it in the position table (for object_get_at)
+ *   5. Increment object_count
+ *   6. Return pointer to new object
  * 
  * FREE SLOT ALLOCATION:
- *   Linear search for first id==0 slot:
- *     for (i = 0; i < capacity; i++)
- *       if (objects[i].id == 0) return &objects[i];
- *   
- *   O(capacity) worst case (all slots full except last one)
- *   Could be optimized with free list for O(1) allocation
+ *   O(1): the slot free the longest is popped from objects->slots
+ *   object_id 0 is rejected (id 0 marks a free slot)
  * 
  * CAPACITY CHECK:
  *   Returns NULL if object_count >= object_capacity
@@ -1121,8 +1147,7 @@ ObjectDefinition* object_get_definition(ObjectSystem* objects, u16 id);
  *   GameObject* stump = object_spawn(g_objects, 1342, 3232, 3232, 0,
  *                                    OBJECT_TYPE_INTERACTABLE, 0);
  *   if (stump) {
- *     stump->temporary = true;
- *     stump->spawn_time = get_current_tick();
+ *     object_despawn_after(g_objects, stump, 100);  // Gone in 60 seconds
  *   }
  * 
  * NETWORK SYNCHRONIZATION:
@@ -1141,7 +1166,7 @@ ObjectDefinition* object_get_definition(ObjectSystem* objects, u16 id);
  *       collision_add_object(collision_map, obj);
  *     }
  * 
- * COMPLEXITY: O(capacity) worst case for free slot search
+ * COMPLEXITY: O(1) average
  */
 GameObject* object_spawn(ObjectSystem* objects, u16 object_id, u32 x, u32 z, 
                          u32 height, u8 type, u8 rotation);
@@ -1183,15 +1208,9 @@ GameObject* object_spawn(ObjectSystem* objects, u16 object_id, u32 x, u32 z,
  *   }
  * 
  * TEMPORARY OBJECT CLEANUP:
- *   Periodic tick checks for expired temporary objects:
- *     for (i = 0; i < capacity; i++) {
- *       GameObject* obj = &objects[i];
- *       if (obj->id != 0 && obj->temporary) {
- *         if (current_tick - obj->spawn_time > timeout) {
- *           object_despawn(objects, obj);
- *         }
- *       }
- *     }
+ *   Temporary objects are despawned by their g_timers timer (see
+ *   object_despawn_after). Despawning one early cancels that timer, so
+ *   it cannot later remove whatever reuses the slot.
  * 
  * NETWORK SYNCHRONIZATION:
  *   After despawning, caller should:
@@ -1205,7 +1224,7 @@ GameObject* object_spawn(ObjectSystem* objects, u16 object_id, u32 x, u32 z,
  * 
  * COLLISION UPDATES:
  *   After despawning, caller should update collision map:
- *     ObjectDefinition* def = object_get_definition(g_objects, obj->id);
+ *     const ObjectDefinition* def = object_get_definition(g_objects, obj->id);
  *     if (def->solid) {
  *       collision_remove_object(collision_map, obj);
  *     }
@@ -1227,6 +1246,21 @@ GameObject* object_spawn(ObjectSystem* objects, u16 object_id, u32 x, u32 z,
  */
 void object_despawn(ObjectSystem* objects, GameObject* object);
 
+/*
+ * object_despawn_after - Make an object temporary, despawned in N ticks
+ * 
+ * @param objects  Object system
+ * @param object   Spawned object
+ * @param ticks    Ticks until object_despawn() (at least 1)
+ * @return         false if no timer could be scheduled (no g_timers)
+ * 
+ * Sets temporary=true and spawn_time to the current tick, and schedules
+ * the despawn on g_timers (replacing any earlier one for this object).
+ * 
+ * COMPLEXITY: O(1) time
+ */
+bool object_despawn_after(ObjectSystem* objects, GameObject* object, u32 ticks);
+
 /*
  * object_get_at - Find object at specific position and type
  * 
@@ -1239,18 +1273,15 @@ void object_despawn(ObjectSystem* objects, GameObject* object);
  * 
  * ALGORITHM:
  *   1. Validate parameters (objects initialized)
- *   2. Linear search through objects array
- *   3. For each object:
- *        - Check if id != 0 (slot is occupied)
- *        - Check if position matches (x, z, height)
- *        - Check if type matches
+ *   2. Hash (coord_pack(height, x, z), type) into objects->by_tile
+ *   3. Probe forward until an empty entry:
+ *        - Skip entries whose key or type differ
+ *        - Confirm the exact position on the object itself
  *   4. Return first match, or NULL if none found
  * 
- * LINEAR SEARCH:
- *   O(capacity) worst case (must check all slots)
- *   Could be optimized with spatial indexing:
- *     - Hash map by position: O(1) lookup
- *     - Region grid: O(objects_in_region) lookup
+ * POSITION TABLE:
+ *   O(1) average: the table is at most half full, so a probe visits
+ *   one or two entries whatever the number of objects loaded
  * 
  * TYPE FILTERING:
  *   Multiple objects can exist at same position with different types
@@ -1270,14 +1301,14 @@ void object_despawn(ObjectSystem* objects, GameObject* object);
  * 
  * FIRST MATCH:
  *   Returns first matching object found
- *   If multiple objects match (should not happen), only returns first
+ *   If multiple objects match (should not happen), returns the one
+ *   spawned first
  * 
  * EXAMPLE USAGE (find door):
  *   GameObject* door = object_get_at(g_objects, 3232, 3232, 0,
  *                                    OBJECT_TYPE_WALL);
  *   if (door) {
- *     ObjectDefinition* def = object_get_definition(g_objects, door->id);
- *     printf("Found %s at (%u, %u)\n", def->name,
+ *     printf("Found %s at (%u, %u)\n", object_get_name(g_objects, door->id),
  *            door->position.x, door->position.z);
  *   } else {
  *     printf("No wall object at (3232, 3232)\n");
@@ -1302,19 +1333,49 @@ void object_despawn(ObjectSystem* objects, GameObject* object);
  *          obj = object_get_at(sys, 3232, 3232, 0, OBJECT_TYPE_INTERACTABLE);
  *     4. If found, handle interactable (chop tree, etc.)
  * 
- * OPTIMIZATION OPPORTUNITY:
- *   For production servers with many objects, consider:
- *     - Hash map: position -> list of objects
- *     - Region grid: divide map into chunks, index objects by chunk
- *     - Quadtree: hierarchical spatial partitioning
- *   
- *   With region grid (64x64 tiles per region):
- *     - Index by region ID: O(1) to get region
- *     - Search within region: O(objects_in_region)
- *     - Typical speedup: 100-1000x faster
- * 
- * COMPLEXITY: O(capacity) worst case (linear search all objects)
+ * COMPLEXITY: O(1) average (hash probe)
  */
 GameObject* object_get_at(ObjectSystem* objects, u32 x, u32 z, u32 height, u8 type);
 
+/*******************************************************************************
+ * MAP LOCS - Static Table Beneath, GameObjects as Overrides
+ ******************************************************************************/
+
+/*
+ * ObjectLoc - The loc a tile shows for one type
+ */
+typedef struct {
+    u16 id;
+    u8 type;
+    u8 rotation;
+    bool from_map;      /* Straight from the static table, no override */
+} ObjectLoc;
+
+/*
+ * object_loc_at - The loc at a tile, map or override (static_locs.h)
+ * 
+ * @param locs  Map locs (g_static_locs, NULL: GameObjects only)
+ * @param out   Receives the loc if there is one
+ * @return      true if the tile has a loc of this type
+ * 
+ * A GameObject at the tile and type wins over the map: a removed one
+ * means nothing is there.
+ * 
+ * COMPLEXITY: O(1) average hash probe, then O(log(locs in the square))
+ */
+bool object_loc_at(ObjectSystem* objects, const StaticLocs* locs, u32 x, u32 z, u32 height,
+                   u8 type, ObjectLoc* out);
+
+/*
+ * object_remove_loc - Take the loc of a type off a tile
+ * 
+ * @return  true if there was one
+ * 
+ * A GameObject without a map loc beneath is despawned; a map loc is
+ * hidden by a removed GameObject (the map table is never written).
+ * The marker is temporary, so checkpoints keep the removal.
+ */
+bool object_remove_loc(ObjectSystem* objects, const StaticLocs* locs, u32 x, u32 z, u32 height,
+                       u8 type);
+
 #endif /* OBJECT_H */
@@ -46,10 +46,7 @@ void objtype_unpack(Jagfile *config) {
         offset += g2(idx);
     }
 
-    _ObjType.cache = calloc(10, sizeof(ObjType *));
-    for (int id = 0; id < 10; id++) {
-        _ObjType.cache[id] = objtype_new();
-    }
+    _ObjType.decoded = calloc(_ObjType.count, sizeof(ObjType *));
 
     packet_free(idx);
 }
@@ -58,22 +55,22 @@ void objtype_free_global(void) {
     lrucache_free(_ObjType.modelCache);
     lrucache_free(_ObjType.iconCache);
     free(_ObjType.offsets);
-    for (int i = 0; i < 10; i++) {
-        free(_ObjType.cache[i]);
+    for (int i = 0; i < _ObjType.count; i++) {
+        free(_ObjType.decoded[i]);
     }
-    free(_ObjType.cache);
+    free(_ObjType.decoded);
     packet_free(_ObjType.dat);
 }
 
 ObjType *objtype_get(int id) {
-    for (int i = 0; i < 10; i++) {
-        if (_ObjType.cache[i]->index == id) {
-            return _ObjType.cache[i];
-        }
+    // custom: kept once decoded, see loctype_get (a note also shares its template's recolours,
+    // which a reused slot used to free under the template)
+    ObjType *obj = _ObjType.decoded[id];
+    if (obj) {
+        return obj;
     }
 
-    _ObjType.cachePos = (_ObjType.cachePos + 1) % 10;
-    ObjType *obj = _ObjType.cache[_ObjType.cachePos];
+    obj = _ObjType.decoded[id] = objtype_new();
     _ObjType.dat->pos = _ObjType.offsets[id];
     obj->index = id;
     objtype_reset(obj);
@@ -226,7 +223,7 @@ Pix24 *objtype_get_icon_outline(int id, int count, int outline_color) {
     }
 
     if (outline_color == 0) {
-        lrucache_put(_ObjType.iconCache, id, &icon->link);
+        lrucache_put_sized(_ObjType.iconCache, id, &icon->link, (int)sizeof(Pix24) + icon->width * icon->height * (int)sizeof(int));
     }
     pix2d_bind(_w, _h, _data);
     pix2d_set_clipping(_b, _r, _t, _l);
@@ -333,7 +330,8 @@ Pix24 *objtype_get_icon(int id, int count) {
         linkedIcon->crop_h = h;
     }
 
-    lrucache_put(_ObjType.iconCache, id, &icon->link);
+    int spans = pix24_pack_spans(icon, true);
+    lrucache_put_sized(_ObjType.iconCache, id, &icon->link, (int)sizeof(Pix24) + icon->width * icon->height * (int)sizeof(int) + spans);
     pix2d_bind(_w, _h, _data);
     pix2d_set_clipping(_b, _r, _t, _l);
     _Pix3D.center_x = _cx;
@@ -573,7 +571,7 @@ Model *objtype_get_interfacemodel(ObjType *obj, int count, bool use_allocator) {
 
     model_calculate_normals(model, 64, 768, -50, -10, -50, true, use_allocator);
     model->pickable = true;
-    lrucache_put(_ObjType.modelCache, obj->index, &model->link);
+    lrucache_put_sized(_ObjType.modelCache, obj->index, &model->link, model_size(model));
     return model;
 }
 
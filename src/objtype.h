@@ -52,8 +52,7 @@ typedef struct {
     int count;
     int *offsets;
     Packet *dat;
-    ObjType **cache;
-    int cachePos;
+    ObjType **decoded; // custom: by id, decoded on first get and kept (was a ring of 10 re-decoded slots)
     bool membersWorld;    // = true;
     LruCache *modelCache; // = new LruCache(50);
     LruCache *iconCache;  // = new LruCache(200);
@@ -0,0 +1,137 @@
+/*******************************************************************************
+ * OCCUPANCY.C - Tile Occupancy Bitmap Implementation
+ *******************************************************************************
+ *
+ * See occupancy.h for the layout and who is in the map.
+ *
+ * Pages are allocated on first use and kept: a region someone stood in
+ * is likely to be stood in again, and a page is 4.5KB. The page table
+ * alone is 512KB, one u16 per region and level.
+ *
+ ******************************************************************************/
+
+#include "occupancy.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+OccupancyMap* g_occupancy = NULL;
+
+/* Pages the pool starts with (shared empty page included) */
+#define OCCUPANCY_INITIAL_PAGES 64
+
+OccupancyMap* occupancy_create(void) {
+    OccupancyMap* map = (OccupancyMap*)calloc(1, sizeof(OccupancyMap));
+    if (!map) return NULL;
+
+    map->pages = (OccupancyPage*)calloc(OCCUPANCY_INITIAL_PAGES, sizeof(OccupancyPage));
+    if (!map->pages) {
+        free(map);
+        return NULL;
+    }
+    map->page_capacity = OCCUPANCY_INITIAL_PAGES;
+    map->page_count = 1;  /* OCCUPANCY_PAGE_EMPTY */
+    return map;
+}
+
+void occupancy_destroy(OccupancyMap* map) {
+    if (!map) return;
+    free(map->pages);
+    free(map);
+}
+
+/*
+ * occupancy_page - The page holding a tile, allocated if create is set
+ *
+ * @return  Page, or NULL (not allocated and create unset, or out of memory)
+ */
+static OccupancyPage* occupancy_page(OccupancyMap* map, u32 level, u32 x, u32 z, bool create) {
+    u16* entry = &map->page_index[level & 3][((x >> 6) & 0xff) << 8 | ((z >> 6) & 0xff)];
+    if (*entry != OCCUPANCY_PAGE_EMPTY) return &map->pages[*entry];
+    if (!create || map->page_count > 0xFFFF) return NULL;
+
+    if (map->page_count == map->page_capacity) {
+        u32 capacity = map->page_capacity * 2;
+        OccupancyPage* grown = (OccupancyPage*)realloc(map->pages, capacity * sizeof(OccupancyPage));
+        if (!grown) return NULL;
+        map->pages = grown;
+        map->page_capacity = capacity;
+    }
+    OccupancyPage* page = &map->pages[map->page_count];
+    memset(page, 0, sizeof(OccupancyPage));
+    *entry = (u16)map->page_count++;
+    return page;
+}
+
+/*
+ * occupancy_adjust - Add delta (+1 / -1) to every tile of a footprint
+ */
+static void occupancy_adjust(OccupancyMap* map, const Position* position, u32 size, i32 delta) {
+    u32 level = position_height(position);
+    u32 x0 = position_x(position);
+    u32 z0 = position_z(position);
+    if (size == 0) size = 1;
+
+    for (u32 x = x0; x < x0 + size; x++) {
+        for (u32 z = z0; z < z0 + size; z++) {
+            OccupancyPage* page = occupancy_page(map, level, x, z, delta > 0);
+            if (!page) continue;
+
+            u8* count = &page->count[(x & 63) << 6 | (z & 63)];
+            if (delta > 0) {
+                if (*count < 255) (*count)++;
+            } else if (*count > 0) {
+                (*count)--;
+            }
+            u64 bit = 1ull << (z & 63);
+            page->bits[x & 63] = *count ? page->bits[x & 63] | bit : page->bits[x & 63] & ~bit;
+        }
+    }
+}
+
+void occupancy_add(OccupancyMap* map, const Position* position, u32 size) {
+    if (!map || !position) return;
+    occupancy_adjust(map, position, size, 1);
+}
+
+void occupancy_remove(OccupancyMap* map, const Position* position, u32 size) {
+    if (!map || !position) return;
+    occupancy_adjust(map, position, size, -1);
+}
+
+void occupancy_move(OccupancyMap* map, const Position* from, const Position* to, u32 size) {
+    if (!map || !from || !to || position_equals(from, to)) return;
+    occupancy_adjust(map, from, size, -1);
+    occupancy_adjust(map, to, size, 1);
+}
+
+bool occupancy_step_blocked(const OccupancyMap* map, const Position* position, u32 size,
+                            i32 dx, i32 dz) {
+    if (!map || !position) return false;
+    if (size == 0) size = 1;
+
+    u32 level = position_height(position);
+    i32 x0 = (i32)position_x(position) + dx;
+    i32 z0 = (i32)position_z(position) + dz;
+    i32 s = (i32)size;
+
+    /* The column the step adds (east or west edge of the new footprint) */
+    if (dx != 0) {
+        i32 x = dx > 0 ? x0 + s - 1 : x0;
+        for (i32 z = z0; z < z0 + s; z++) {
+            if (occupancy_test(map, level, (u32)x, (u32)z)) return true;
+        }
+    }
+
+    /* The row it adds, less the corner the column already covered */
+    if (dz != 0) {
+        i32 z = dz > 0 ? z0 + s - 1 : z0;
+        i32 from = x0, to = x0 + s;
+        if (dx > 0) to--;
+        if (dx < 0) from++;
+        for (i32 x = from; x < to; x++) {
+            if (occupancy_test(map, level, (u32)x, (u32)z)) return true;
+        }
+    }
+    return false;
+}
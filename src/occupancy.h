@@ -0,0 +1,173 @@
+/*******************************************************************************
+ * OCCUPANCY.H - Which Tiles an Entity Stands On, One Bit per Tile
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Bitmaps as a set of tiles (one bit test per membership query)
+ *   - Incremental maintenance: update on change instead of recomputing
+ *   - Reference counts behind a bitmap (entities may share a tile)
+ *   - Paging a sparse 2D grid (the layout of world_collision.h)
+ *
+ * THE PROBLEM:
+ *
+ * An NPC that walks (wander, chase) should not step onto a tile another
+ * NPC or a player is standing on, or a crowd of spawns piles up on one
+ * tile. Asking "is anyone there?" from the entities means a zone grid
+ * query and a compare per nearby entity, on every step:
+ *
+ *   step ──→ zone_grid_query(x, z) ──→ 40 goblins ──→ 40 compares
+ *
+ * and an NPC of size 2 or 3 covers 4 or 9 tiles, each to be checked.
+ *
+ * THE SOLUTION - A BITMAP KEPT UP TO DATE BY THE MOVES:
+ *
+ *   page_index[level][region]        pages (one per 64x64 region in use)
+ *   ┌───────────────────────┐        ┌─────────────────────────────────┐
+ *   │ (50,50) ──────────────┼──────→ │ bits[x & 63] bit (z & 63)       │
+ *   │ (12,80) → 0 ──────────┼──┐     │ count[(x & 63) << 6 | (z & 63)] │
+ *   └───────────────────────┘  │     ├─────────────────────────────────┤
+ *     region = x >> 6, z >> 6  └───→ │ 0: EMPTY (shared, never written)│
+ *                                    └─────────────────────────────────┘
+ *
+ *   occupancy_test()  = two loads and a shift, no branch
+ *   occupancy_move()  = size² count updates where the entity was and
+ *                       size² where it is now (1 + 1 for most NPCs)
+ *
+ *   Every spawn, despawn, death, respawn, step and teleport updates the
+ *   map, so it is always the set of tiles somebody stands on. The count
+ *   behind each bit lets two entities share a tile (spawned together, a
+ *   teleport onto someone): the bit clears when the last one leaves.
+ *
+ * MULTI-TILE ENTITIES:
+ *   An entity of size s at (x, z) covers x .. x+s-1 and z .. z+s-1, its
+ *   south-west tile being its position. A step is blocked if a tile it
+ *   enters is occupied; only the tiles the step adds to the footprint
+ *   are tested, never the entity's own:
+ *
+ *        size 2 stepping east            tested: the column at x + 2
+ *        ┌───┬───┬───┐
+ *        │ A │ A │ ? │
+ *        ├───┼───┼───┤
+ *        │ A │ A │ ? │
+ *        └───┴───┴───┘
+ *
+ * WHO IS IN IT:
+ *   NPCs (their definition's size) and logged-in players (size 1). Only
+ *   NPC steps are tested: players walk through NPCs and each other, as in
+ *   the original game. The pathfinder ignores entities (they move); the
+ *   step test is where a blocked NPC stops and drops its path, and its
+ *   next wander or chase finds another way.
+ *
+ * THREAD SAFETY:
+ *   Game thread only. Sharded player steps (region_shard.h) are applied
+ *   here when their changes are merged, not on the shards.
+ *
+ ******************************************************************************/
+
+#ifndef OCCUPANCY_H
+#define OCCUPANCY_H
+
+#include "types.h"
+#include "position.h"
+#include <stdbool.h>
+
+/* Levels and regions, as in world_collision.h */
+#define OCCUPANCY_LEVELS 4
+#define OCCUPANCY_REGIONS (256 * 256)
+
+/* Page every untouched region shares: nobody there */
+#define OCCUPANCY_PAGE_EMPTY 0
+
+/*
+ * OccupancyPage - One 64x64 region on one level
+ */
+typedef struct {
+    u64 bits[64];               /* bits[x & 63] >> (z & 63): occupied */
+    u8 count[64 * 64];          /* Entities on the tile (saturates at 255) */
+} OccupancyPage;
+
+/*
+ * OccupancyMap - Page table and pages
+ */
+typedef struct {
+    u16 page_index[OCCUPANCY_LEVELS][OCCUPANCY_REGIONS];
+    OccupancyPage* pages;       /* pages[0] is the shared empty page */
+    u32 page_count;
+    u32 page_capacity;
+} OccupancyMap;
+
+/*
+ * g_occupancy - The world's occupancy, or NULL (nothing blocks NPC steps)
+ */
+extern OccupancyMap* g_occupancy;
+
+/*
+ * occupancy_create - Empty map (every region on the shared empty page)
+ *
+ * @return  Map, or NULL on allocation failure
+ */
+OccupancyMap* occupancy_create(void);
+
+/*
+ * occupancy_destroy - Free the map (NULL-safe)
+ */
+void occupancy_destroy(OccupancyMap* map);
+
+/*
+ * occupancy_test - Is anyone standing on the tile?
+ *
+ * @param map    Map (not NULL)
+ * @param level  Height level (taken & 3)
+ * @param x, z   World tile (taken modulo 16384)
+ *
+ * COMPLEXITY: O(1), two dependent loads, no branch
+ */
+static inline bool occupancy_test(const OccupancyMap* map, u32 level, u32 x, u32 z) {
+    const OccupancyPage* page =
+        &map->pages[map->page_index[level & 3][((x >> 6) & 0xff) << 8 | ((z >> 6) & 0xff)]];
+    return (page->bits[x & 63] >> (z & 63)) & 1;
+}
+
+/*
+ * occupancy_add - An entity of size tiles per side now stands at position
+ *
+ * A region's page is allocated on the first entity to enter it; a failed
+ * allocation leaves those tiles unmarked (steps onto them are allowed).
+ *
+ * COMPLEXITY: O(size²)
+ */
+void occupancy_add(OccupancyMap* map, const Position* position, u32 size);
+
+/*
+ * occupancy_remove - The entity added at position has left it
+ *
+ * COMPLEXITY: O(size²)
+ */
+void occupancy_remove(OccupancyMap* map, const Position* position, u32 size);
+
+/*
+ * occupancy_move - occupancy_remove(from) then occupancy_add(to)
+ *
+ * COMPLEXITY: O(size²)
+ */
+void occupancy_move(OccupancyMap* map, const Position* from, const Position* to, u32 size);
+
+/*
+ * occupancy_step_blocked - Would the step (dx, dz) enter an occupied tile?
+ *
+ * @param map       Map (NULL: never blocked)
+ * @param position  Entity's south-west tile before the step
+ * @param size      Tiles per side
+ * @param dx, dz    Step, each -1, 0 or +1
+ * @return          true if a tile entering the footprint is occupied
+ *
+ * Tests only the tiles the step adds to the footprint (size, or
+ * 2 x size - 1 for a diagonal), so the entity never blocks itself.
+ *
+ * COMPLEXITY: O(size)
+ */
+bool occupancy_step_blocked(const OccupancyMap* map, const Position* position, u32 size,
+                            i32 dx, i32 dz);
+
+#endif /* OCCUPANCY_H */
@@ -5,12 +5,12 @@
 
 #include "datastruct/doublylinkable.h"
 #include "defines.h"
+#include "crc32.h"
 #include "packet.h"
 #include "platform.h"
 #include "thirdparty/isaac.h"
 #include "thirdparty/rsa.h"
 
-static int crctable[256];
 static const int BITMASK[] = {
     0, 1, 3, 7, 0xf, 0x1f, 0x3f, 0x7f, 0xff,
     0x1ff, 0x3ff, 0x7ff, 0xfff, 0x1fff, 0x3fff, 0x7fff, 0xffff,
@@ -29,24 +29,11 @@ void packet_init_global(void) {
     _Packet.cacheMin = linklist_new();
     _Packet.cacheMid = linklist_new();
     _Packet.cacheMax = linklist_new();
-
-    const int CRC32_POLYNOMIAL = 0xedb88320;
-    for (int i = 0; i < 256; i++) {
-        uint32_t crc = i;
-        for (int j = 0; j < 8; j++) {
-            if ((crc & 1) == 1) {
-                crc = crc >> 1 ^ CRC32_POLYNOMIAL;
-            } else {
-                crc >>= 1;
-            }
-        }
-        crctable[i] = crc;
-    }
 }
 
 Packet *packet_new(int8_t *src, int length) {
     Packet *packet = calloc(1, sizeof(Packet));
-    packet->link = (DoublyLinkable){(Linkable){0}, NULL, NULL};
+    packet->link = (DoublyLinkable){(Linkable){0}, NULL, NULL, 0, 0};
     packet->data = src;
     packet->length = length;
     packet->pos = 0;
@@ -59,12 +46,9 @@ void packet_free(Packet *packet) {
     free(packet);
 }
 
+// shared with the server's saves and maps, see crc32.c
 int rs_crc32(const int8_t *data, size_t length) {
-    int crc = -1;
-    for (size_t i = 0; i < length; i++) {
-        crc = ((uint32_t)crc >> 8) ^ crctable[(crc ^ data[i]) & 0xff];
-    }
-    return ~crc;
+    return (int)crc32((const uint8_t *)data, length);
 }
 
 Packet *packet_alloc(int type) {
@@ -140,6 +124,18 @@ int8_t *slice_bytes(Packet *packet, int offset, int length) {
     return copy_of_range(packet->data, offset, offset + length);
 }
 
+void packet_view(Packet *view, const int8_t *data, int length) {
+    memset(view, 0, sizeof(*view));
+    view->data = (int8_t *)data; // readers only, see packet.h
+    view->length = length;
+}
+
+const int8_t *gdata_view(Packet *packet, int length) {
+    const int8_t *data = packet->data + packet->pos;
+    packet->pos += length;
+    return data;
+}
+
 void p1isaac(Packet *packet, int opcode) {
     packet->data[packet->pos++] = (int8_t)(opcode + isaac_next(&packet->random));
 }
@@ -279,6 +275,28 @@ char *gjstr(Packet *packet) {
     return str;
 }
 
+char *gjstr_view(Packet *packet) {
+    char *str = (char *)packet->data + packet->pos;
+    while (packet->data[packet->pos] != 10) {
+        packet->pos++;
+    }
+    packet->data[packet->pos++] = '\0';
+    return str;
+}
+
+int gjstr_into(Packet *packet, char *dest, int size) {
+    int start = packet->pos;
+    while (packet->data[packet->pos++] != 10)
+        ;
+    int len = packet->pos - start - 1;
+    if (len > size - 1) {
+        len = size - 1;
+    }
+    memcpy(dest, packet->data + start, len);
+    dest[len] = '\0';
+    return len;
+}
+
 int8_t *gjstrbyte(Packet *packet) {
     int start = packet->pos;
     while (packet->data[packet->pos++] != 10)
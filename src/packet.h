@@ -31,9 +31,13 @@ Packet *packet_new(int8_t *src, int length);
 void packet_free(Packet *packet);
 Packet *packet_alloc(int type);
 void packet_release(Packet *packet);
+// NOTE: take, slice and slice_bytes copy, for data that outlives the packet
 int8_t *take(Packet *packet);
 Packet *slice(Packet *packet, int offset, int length);
 int8_t *slice_bytes(Packet *packet, int offset, int length);
+// custom: borrowed views, no allocation and nothing to free, valid as long as the bytes they point into
+void packet_view(Packet *view, const int8_t *data, int length); // read only, never packet_free() a view
+const int8_t *gdata_view(Packet *packet, int length);
 void p1isaac(Packet *packet, int opcode);
 void p1(Packet *packet, int value);
 void p2(Packet *packet, int value);
@@ -57,6 +61,10 @@ int g4(Packet *packet);
 int64_t g8(Packet *packet);
 char *fastgjstr(Packet *packet);
 char *gjstr(Packet *packet);
+// custom: gjstr without the malloc: _view ends the string in place ('\n' becomes '\0') so only for a
+// buffer read once (the network input), _into copies into storage that outlives the packet, truncated to fit
+char *gjstr_view(Packet *packet);
+int gjstr_into(Packet *packet, char *dest, int size);
 int8_t *gjstrbyte(Packet *packet);
 void gdata(Packet *packet, int length, int offset, int8_t *dest);
 void access_bits(Packet *packet);
@@ -0,0 +1,199 @@
+/*******************************************************************************
+ * PACKET_CODEC.H - Decoders and Writers Generated from the Packet Schema
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Code generation with the C preprocessor (X-macros)
+ *   - Compile-time checks that two tables agree (static assertions in C99)
+ *   - Validating a packet once, then decoding with unchecked loads
+ *
+ * THE PROBLEM:
+ *
+ * A handler used to decode by hand, one checked call per field, with the
+ * layout living only in the order of those calls:
+ *
+ *   u8 gender = buffer_read_byte(buf, false);         call + check
+ *   for (i = 0; i < 7; i++)                           7 calls + 7 checks
+ *       idk[i] = buffer_read_byte(buf, false);
+ *   for (i = 0; i < 5; i++) ...                       5 more
+ *
+ * and a writer the same way. Nothing tied the calls to the packet's
+ * length in PacketLengths[] or SERVERPROT_SIZES: IF_SETHIDE wrote 6 bytes
+ * into a 3-byte packet, and the client framed every packet after it wrong.
+ *
+ * THE SOLUTION - ONE LAYOUT, EVERYTHING ELSE GENERATED:
+ *
+ *   packets.h:  #define CLIENT_IF_BUTTON_FIELDS(F, A)  F(u16, component)
+ *
+ *   here:       CLIENT_DECODER(IfButtonPacket, decode_if_button,
+ *                              CLIENT_IF_BUTTON_FIELDS, CLIENT_IF_BUTTON_LENGTH)
+ *
+ *   expands to: typedef struct { u16 component; } IfButtonPacket;
+ *
+ *               static inline bool decode_if_button(StreamBuffer* buf,
+ *                                                   IfButtonPacket* out) {
+ *                   if (!buffer_require(buf, 2)) return false;   one check
+ *                   out->component = buffer_get_u16(buf);        inline load
+ *                   return true;
+ *               }
+ *
+ *               + a compile error if the fields do not add up to
+ *                 CLIENT_IF_BUTTON_LENGTH
+ *
+ * Server writers are generated the same way from SERVER_*_FIELDS:
+ *
+ *   SERVER_WRITER(IF_SETTAB, encode_if_settab)
+ *
+ *     static inline void encode_if_settab(StreamBuffer* out,
+ *                                         ISAACCipher* cipher,
+ *                                         u16 component, u8 tab) {
+ *         buffer_reserve(out, 1 + 3);                 one capacity check
+ *         buffer_write_header(out, SERVER_IF_SETTAB, cipher);
+ *         buffer_put_u16(out, component);
+ *         buffer_put_u8(out, tab);
+ *     }
+ *
+ *   A layout that does not add up to SERVER_IF_SETTAB_SIZE does not compile.
+ *
+ * STATIC ASSERTIONS IN C99:
+ *
+ *   C99 has no _Static_assert, but an array of negative size is an error:
+ *
+ *     typedef char check[(1 + 2 == 3) ? 1 : -1];   compiles
+ *     typedef char check[(1 + 4 == 3) ? 1 : -1];   "size of array is negative"
+ *
+ * FIELD TYPES:
+ *   u8, i8, u16, u32, u64, all big-endian. Each type's wire width is its
+ *   sizeof, so a layout's size is the sum of the sizeof its fields.
+ *
+ ******************************************************************************/
+
+#ifndef PACKET_CODEC_H
+#define PACKET_CODEC_H
+
+#include "types.h"
+#include "buffer.h"
+#include "packets.h"
+
+/*******************************************************************************
+ * EXPANSIONS OF ONE FIELD
+ ******************************************************************************/
+
+#define CODEC_STRUCT_FIELD(type, name)          type name;
+#define CODEC_STRUCT_ARRAY(type, name, count)   type name[count];
+
+#define CODEC_WIDTH_FIELD(type, name)           + (u32)sizeof(type)
+#define CODEC_WIDTH_ARRAY(type, name, count)    + (u32)sizeof(type) * (count)
+
+#define CODEC_GET_FIELD(type, name)             out->name = buffer_get_##type(buf);
+#define CODEC_GET_ARRAY(type, name, count) \
+    for (u32 i_ = 0; i_ < (count); i_++) out->name[i_] = buffer_get_##type(buf);
+
+#define CODEC_PARAM(type, name)                 , type name
+#define CODEC_PUT(type, name)                   buffer_put_##type(out, name);
+
+/* Wire size of a field list */
+#define CODEC_CLIENT_SIZE(fields)   (0 fields(CODEC_WIDTH_FIELD, CODEC_WIDTH_ARRAY))
+#define CODEC_SERVER_SIZE(fields)   (0 fields(CODEC_WIDTH_FIELD))
+
+/*******************************************************************************
+ * GENERATORS
+ ******************************************************************************/
+
+/*
+ * CLIENT_LAYOUT - Struct and decoder for a client payload layout
+ *
+ * @param type    Struct name to define
+ * @param decode  Decoder name: bool decode(StreamBuffer* buf, type* out)
+ * @param fields  CLIENT_*_FIELDS list
+ *
+ * The decoder returns false (and reads nothing) if fewer bytes than the
+ * layout remain; on true the buffer is positioned after it.
+ */
+#define CLIENT_LAYOUT(type, decode, fields) \
+    typedef struct { fields(CODEC_STRUCT_FIELD, CODEC_STRUCT_ARRAY) } type; \
+    static inline bool decode(StreamBuffer* buf, type* out) { \
+        if (!buffer_require(buf, CODEC_CLIENT_SIZE(fields))) return false; \
+        fields(CODEC_GET_FIELD, CODEC_GET_ARRAY) \
+        return true; \
+    }
+
+/*
+ * CLIENT_DECODER - CLIENT_LAYOUT for a fixed-length packet, checked
+ *                  against its length in CLIENT_PACKET_LIST
+ */
+#define CLIENT_DECODER(type, decode, fields, length) \
+    CLIENT_LAYOUT(type, decode, fields) \
+    typedef char type##_matches_schema[(CODEC_CLIENT_SIZE(fields) == (length)) ? 1 : -1];
+
+/*
+ * SERVER_WRITER - Writer for a fixed-size server packet
+ *
+ * @param NAME    Packet name in SERVER_PACKET_LIST (with SERVER_NAME_FIELDS)
+ * @param encode  Writer name: void encode(StreamBuffer*, ISAACCipher*, fields...)
+ *
+ * Writes opcode and payload; the caller logs and commits as usual.
+ */
+#define SERVER_WRITER(NAME, encode) \
+    static inline void encode(StreamBuffer* out, ISAACCipher* cipher \
+                              SERVER_##NAME##_FIELDS(CODEC_PARAM)) { \
+        buffer_reserve(out, 1 + SERVER_##NAME##_SIZE); \
+        buffer_write_header(out, SERVER_##NAME, cipher); \
+        SERVER_##NAME##_FIELDS(CODEC_PUT) \
+    } \
+    typedef char encode##_matches_schema[ \
+        (CODEC_SERVER_SIZE(SERVER_##NAME##_FIELDS) == SERVER_##NAME##_SIZE) ? 1 : -1];
+
+/*******************************************************************************
+ * CLIENT → SERVER
+ ******************************************************************************/
+
+CLIENT_DECODER(IfButtonPacket, decode_if_button,
+               CLIENT_IF_BUTTON_FIELDS, CLIENT_IF_BUTTON_LENGTH)
+
+CLIENT_DECODER(PlayerDesignPacket, decode_player_design,
+               CLIENT_IF_PLAYERDESIGN_FIELDS, CLIENT_IF_PLAYERDESIGN_LENGTH)
+
+CLIENT_DECODER(ResumePauseButtonPacket, decode_resume_pausebutton,
+               CLIENT_RESUME_PAUSEBUTTON_FIELDS, CLIENT_RESUME_PAUSEBUTTON_LENGTH)
+
+/* OPNPC1-5 share one layout; OPNPC2 is "Attack" */
+CLIENT_DECODER(OpNpcPacket, decode_opnpc, CLIENT_OPNPC_FIELDS, CLIENT_OPNPC2_LENGTH)
+
+/* INV_BUTTON1-5 share one layout (shop.h: Value, Buy/Sell 1, 5, 10) */
+CLIENT_DECODER(InvButtonPacket, decode_inv_button,
+               CLIENT_INV_BUTTON_FIELDS, CLIENT_INV_BUTTON1_LENGTH)
+
+/* MOVE_GAMECLICK / MOVE_MINIMAPCLICK / MOVE_OPCLICK: header, then steps */
+CLIENT_LAYOUT(MovePacket, decode_move, CLIENT_MOVE_FIELDS)
+
+/* Friend and ignore list edits share one layout: a base-37 name */
+CLIENT_DECODER(SocialNamePacket, decode_social_name,
+               CLIENT_SOCIAL_NAME_FIELDS, CLIENT_FRIENDLIST_ADD_LENGTH)
+
+/* MESSAGE_PRIVATE: recipient, then the text */
+CLIENT_LAYOUT(MessagePrivatePacket, decode_message_private, CLIENT_MESSAGE_PRIVATE_FIELDS)
+
+/*******************************************************************************
+ * SERVER → CLIENT
+ ******************************************************************************/
+
+SERVER_WRITER(IF_SETTAB, encode_if_settab)
+SERVER_WRITER(IF_OPENTOP, encode_if_opentop)
+SERVER_WRITER(IF_OPENBOTTOM, encode_if_openbottom)
+SERVER_WRITER(IF_OPENSUB, encode_if_opensub)
+SERVER_WRITER(IF_SETHIDE, encode_if_sethide)
+SERVER_WRITER(IF_CLOSE, encode_if_close)
+SERVER_WRITER(UPDATE_STAT, encode_update_stat)
+SERVER_WRITER(UPDATE_RUNENERGY, encode_update_runenergy)
+SERVER_WRITER(VARP_SMALL, encode_varp_small)
+SERVER_WRITER(VARP_LARGE, encode_varp_large)
+SERVER_WRITER(CAM_RESET, encode_cam_reset)
+SERVER_WRITER(LOGOUT, encode_logout)
+SERVER_WRITER(UPDATE_ZONE_FULL_FOLLOWS, encode_update_zone_full_follows)
+SERVER_WRITER(DATA_LAND_DONE, encode_data_land_done)
+SERVER_WRITER(DATA_LOC_DONE, encode_data_loc_done)
+SERVER_WRITER(UPDATE_FRIENDLIST, encode_update_friendlist)
+
+#endif /* PACKET_CODEC_H */
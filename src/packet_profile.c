@@ -0,0 +1,133 @@
+/*******************************************************************************
+ * PACKET_PROFILE.C - Per-Opcode Traffic and Handler Time Profiler
+ *******************************************************************************
+ *
+ * See packet_profile.h for what is measured and where.
+ *
+ * OPEN PACKET BOOKKEEPING:
+ *
+ *   StreamBuffer.profile_opcode holds opcode + 1 of the packet being
+ *   written (0 = none, so zeroed and reset buffers have no open packet)
+ *   and profile_start the offset of its header:
+ *
+ *   out: [184 ........ PLAYER_INFO ........][44 .. ][167 ...]
+ *         ↑ begin(184)                      ↑ begin(44): 184 += 38 bytes
+ *                                                    ↑ begin(167): 44 += 7
+ *                                        commit → settle: 167 += rest
+ *
+ ******************************************************************************/
+
+#include "packet_profile.h"
+#include "constants.h"
+#include "log.h"
+#include "tick_stats.h"
+#include <stdlib.h>
+#include <string.h>
+
+PacketProfile g_packet_profile;
+
+void packet_profile_set(bool enabled, u64 tick) {
+    if (enabled && !g_packet_profile.enabled) {
+        memset(&g_packet_profile, 0, sizeof(g_packet_profile));
+        g_packet_profile.window_start = tick + 1;
+    }
+    g_packet_profile.enabled = enabled;
+}
+
+void packet_profile_out_settle(StreamBuffer* buf) {
+    if (buf->profile_opcode == 0) return;
+    u32 op = buf->profile_opcode - 1;
+    buf->profile_opcode = 0;
+    if (buf->position < buf->profile_start) return;  /* Flushed in between */
+
+    __atomic_fetch_add(&g_packet_profile.out[op].count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&g_packet_profile.out[op].bytes, buf->position - buf->profile_start,
+                       __ATOMIC_RELAXED);
+}
+
+void packet_profile_out_begin(StreamBuffer* buf, u8 opcode) {
+    packet_profile_out_settle(buf);
+    buf->profile_opcode = (u16)(opcode + 1);
+    buf->profile_start = buf->position;
+}
+
+/* Sort keys for the report: busiest first */
+static int compare_in(const void* a, const void* b) {
+    const PacketProfileIn* x = &g_packet_profile.in[*(const u8*)a];
+    const PacketProfileIn* y = &g_packet_profile.in[*(const u8*)b];
+    return (x->ns < y->ns) - (x->ns > y->ns);
+}
+
+static int compare_out(const void* a, const void* b) {
+    const PacketProfileOut* x = &g_packet_profile.out[*(const u8*)a];
+    const PacketProfileOut* y = &g_packet_profile.out[*(const u8*)b];
+    return (x->bytes < y->bytes) - (x->bytes > y->bytes);
+}
+
+void packet_profile_dump(u64 tick) {
+    PacketProfile* p = &g_packet_profile;
+    u64 ticks = tick >= p->window_start ? tick - p->window_start + 1 : 0;
+    double seconds = ticks * (g_tick_stats.period_ms / 1000.0);
+    if (seconds <= 0) seconds = 1;
+
+    u8 in_ops[256], out_ops[256];
+    u32 in_n = 0, out_n = 0;
+    u64 in_packets = 0, in_ns = 0, out_packets = 0, out_bytes = 0;
+    for (u32 op = 0; op < 256; op++) {
+        if (p->in[op].count) {
+            in_ops[in_n++] = (u8)op;
+            in_packets += p->in[op].count;
+            in_ns += p->in[op].ns;
+        }
+        if (p->out[op].count) {
+            out_ops[out_n++] = (u8)op;
+            out_packets += p->out[op].count;
+            out_bytes += p->out[op].bytes;
+        }
+    }
+    qsort(in_ops, in_n, 1, compare_in);
+    qsort(out_ops, out_n, 1, compare_out);
+
+    LOG_INFO("Packet profile, ticks %llu-%llu (%.0f s): in %llu packets %.1f ms cpu, "
+             "out %llu packets %llu bytes\n",
+             (unsigned long long)p->window_start, (unsigned long long)tick, seconds,
+             (unsigned long long)in_packets, in_ns / 1e6,
+             (unsigned long long)out_packets, (unsigned long long)out_bytes);
+
+    if (in_n) LOG_INFO("   in  op      count    pkt/s      bytes   cpu ms   avg us   max us\n");
+    for (u32 i = 0; i < in_n && i < PACKET_PROFILE_ROWS; i++) {
+        const PacketProfileIn* row = &p->in[in_ops[i]];
+        LOG_INFO("      %3u %10llu %8.1f %10llu %8.2f %8.1f %8.1f\n", in_ops[i],
+                 (unsigned long long)row->count, row->count / seconds,
+                 (unsigned long long)row->bytes, row->ns / 1e6,
+                 row->ns / 1e3 / row->count, row->max_ns / 1e3);
+    }
+
+    if (out_n) LOG_INFO("  out  op      count    pkt/s      bytes   bytes/s  avg size\n");
+    for (u32 i = 0; i < out_n && i < PACKET_PROFILE_ROWS; i++) {
+        const PacketProfileOut* row = &p->out[out_ops[i]];
+        LOG_INFO("      %3u %10llu %8.1f %10llu %9.0f %9.1f\n", out_ops[i],
+                 (unsigned long long)row->count, row->count / seconds,
+                 (unsigned long long)row->bytes, row->bytes / seconds,
+                 (double)row->bytes / row->count);
+    }
+
+    LOG_INFO("  over MAX_PACKETS_PER_SECOND (%u/tick): %llu packets in %llu connection-ticks "
+             "(%.1f%% of inbound)\n",
+             PACKETS_PER_TICK,
+             (unsigned long long)p->spam_packets, (unsigned long long)p->spam_ticks,
+             in_packets ? 100.0 * p->spam_packets / in_packets : 0.0);
+
+    /* Restart the window (the enabled flag stays as it is) */
+    bool enabled = p->enabled;
+    memset(p, 0, sizeof(*p));
+    p->enabled = enabled;
+    p->window_start = tick + 1;
+}
+
+void packet_profile_tick(u64 tick) {
+    if (!g_packet_profile.enabled) return;
+    if (tick + 1 - g_packet_profile.window_start >= PACKET_PROFILE_INTERVAL) {
+        packet_profile_dump(tick);
+    }
+}
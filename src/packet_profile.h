@@ -0,0 +1,170 @@
+/*******************************************************************************
+ * PACKET_PROFILE.H - Per-Opcode Traffic and Handler Time Profiler
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Sampling-free profiling: measure every call, but only while asked to
+ *   - Attributing bytes to the packet that wrote them
+ *   - Windowed reports that reset, so each one describes "now"
+ *
+ * THE PROBLEM:
+ *
+ * Which handlers are worth optimizing? server_handle_packet() could say
+ * how often it saw movement packets (a static counter, in trace output)
+ * and dbg_log_send() prints every send one line at a time. Neither says
+ * where handler CPU time goes, which server packets make up the outbound
+ * bytes, or whether clients sending more than MAX_PACKETS_PER_SECOND are
+ * a measurable share of the load.
+ *
+ * THE SOLUTION - ONE TABLE ROW PER OPCODE, ON DEMAND:
+ *
+ *   inbound  (server_handle_packet)       outbound (buffer_write_header)
+ *   ┌────┬───────┬───────┬───────┬──────┐  ┌────┬───────┬─────────┐
+ *   │ op │ count │ bytes │ cpu   │ max  │  │ op │ count │ bytes   │
+ *   ├────┼───────┼───────┼───────┼──────┤  ├────┼───────┼─────────┤
+ *   │165 │  9120 │ 91042 │ 41 ms │ 80us │  │184 │  2000 │ 1.9 MB  │
+ *   │... │       │       │       │      │  │... │       │         │
+ *
+ *   Inbound:  the handler is timed with two clock reads around the
+ *             opcode switch (tick_stats_now).
+ *   Outbound: a packet's bytes are not known when its header is written.
+ *             The buffer remembers the open packet's opcode and start;
+ *             the next header in the same buffer, or player_out_commit(),
+ *             closes it and charges position - start to that opcode.
+ *
+ *   Spam:     packets per connection per tick are counted; those beyond
+ *             MAX_PACKETS_PER_SECOND's share of a tick are totalled, so
+ *             the report says how much of the inbound load runs on burst
+ *             tokens (the limit itself is enforced by the token bucket).
+ *
+ * TOGGLE AND REPORT:
+ *
+ *   --packet-profile          start with profiling on
+ *   ::profile on|off|dump     in game, at runtime
+ *
+ *   While on, the table is logged (LOG_INFO) every PACKET_PROFILE_INTERVAL
+ *   ticks, busiest rows first, and the window restarts. While off the
+ *   hot paths cost one predictable branch on g_packet_profile.enabled.
+ *
+ * THREADS:
+ *   Inbound rows are written by the game thread only. Outbound headers are
+ *   also written by the PLAYER_INFO workers (update_pool.h), so outbound
+ *   rows are updated with relaxed atomic adds. Reports run on the game
+ *   thread between ticks, when the workers are idle.
+ *
+ ******************************************************************************/
+
+#ifndef PACKET_PROFILE_H
+#define PACKET_PROFILE_H
+
+#include "types.h"
+#include "buffer.h"
+#include <stdbool.h>
+
+/* Ticks per report while profiling (100 ticks = 1 minute) */
+#define PACKET_PROFILE_INTERVAL 100
+
+/* Rows printed per direction (busiest first) */
+#define PACKET_PROFILE_ROWS 16
+
+typedef struct {
+    u64 count;
+    u64 bytes;                  /* Payload bytes */
+    u64 ns;                     /* Handler time */
+    u64 max_ns;                 /* Slowest single call */
+} PacketProfileIn;
+
+typedef struct {
+    u64 count;
+    u64 bytes;                  /* Whole packet: opcode, length and payload */
+} PacketProfileOut;
+
+/*
+ * PacketProfile - The current window
+ */
+typedef struct {
+    bool enabled;
+    u64 window_start;           /* Tick the window started at */
+    PacketProfileIn in[256];
+    PacketProfileOut out[256];
+    u64 spam_packets;           /* Packets over the per-tick limit */
+    u64 spam_ticks;             /* Connection-ticks that went over it */
+} PacketProfile;
+
+extern PacketProfile g_packet_profile;
+
+/*
+ * packet_profile_set - Turn profiling on (fresh window) or off
+ *
+ * @param enabled  New state
+ * @param tick     Current tick (window start)
+ */
+void packet_profile_set(bool enabled, u64 tick);
+
+/*
+ * packet_profile_in - Record one handled client packet
+ *
+ * @param opcode  Decrypted opcode
+ * @param length  Payload bytes
+ * @param ns      Handler time
+ */
+static inline void packet_profile_in(u8 opcode, u32 length, u64 ns) {
+    PacketProfileIn* row = &g_packet_profile.in[opcode];
+    row->count++;
+    row->bytes += length;
+    row->ns += ns;
+    if (ns > row->max_ns) row->max_ns = ns;
+}
+
+/*
+ * packet_profile_spam - Record a packet past the per-tick limit
+ *
+ * @param first  true for the first excess packet of this connection-tick
+ */
+static inline void packet_profile_spam(bool first) {
+    g_packet_profile.spam_packets++;
+    if (first) g_packet_profile.spam_ticks++;
+}
+
+/*
+ * packet_profile_out_begin - A server packet header is being written
+ *
+ * @param buf     Buffer the header goes into (its open packet is closed)
+ * @param opcode  Plain opcode
+ */
+void packet_profile_out_begin(StreamBuffer* buf, u8 opcode);
+
+/*
+ * packet_profile_out - Record one whole server packet of known length
+ *
+ * For packets copied in rather than written header first
+ * (packet_template.h).
+ */
+static inline void packet_profile_out(u8 opcode, u32 bytes) {
+    __atomic_fetch_add(&g_packet_profile.out[opcode].count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&g_packet_profile.out[opcode].bytes, bytes, __ATOMIC_RELAXED);
+}
+
+/*
+ * packet_profile_out_settle - Close the buffer's open packet, if any
+ *
+ * @param buf  Output buffer about to be committed or flushed
+ */
+void packet_profile_out_settle(StreamBuffer* buf);
+
+/*
+ * packet_profile_tick - Report and restart the window when it is due
+ *
+ * @param tick  Tick that just ran
+ */
+void packet_profile_tick(u64 tick);
+
+/*
+ * packet_profile_dump - Log the current window and restart it
+ *
+ * @param tick  Last tick in the window
+ */
+void packet_profile_dump(u64 tick);
+
+#endif /* PACKET_PROFILE_H */
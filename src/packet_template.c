@@ -0,0 +1,59 @@
+/*******************************************************************************
+ * PACKET_TEMPLATE.C - Prebuilt Packet Sequences Implementation
+ *******************************************************************************
+ *
+ * See packet_template.h for the design.
+ *
+ * The keys for the whole template are taken with one isaac_keys() call,
+ * so the opcode pass is a plain loop over two arrays.
+ *
+ ******************************************************************************/
+
+#include "packet_template.h"
+#include "isaac.h"
+#include "metrics.h"
+#include "packet_profile.h"
+#include <string.h>
+
+void packet_template_init(PacketTemplate* t) {
+    buffer_init_external(&t->buf, t->storage, PACKET_TEMPLATE_BYTES);
+    t->packets = 0;
+}
+
+StreamBuffer* packet_template_open(PacketTemplate* t, u8 opcode) {
+    if (t->packets == PACKET_TEMPLATE_PACKETS) return NULL;
+    if (t->buf.position >= PACKET_TEMPLATE_BYTES) return NULL;
+    if (!buffer_reserve(&t->buf, 1)) return NULL;
+
+    t->opcode_at[t->packets++] = (u16)t->buf.position;
+    buffer_put_u8(&t->buf, opcode);
+    return &t->buf;
+}
+
+u8* packet_template_emit(const PacketTemplate* t, StreamBuffer* out, ISAACCipher* cipher) {
+    u32 length = t->buf.position;
+    u32 packets = t->packets;
+    if (!buffer_reserve(out, length)) return NULL;
+
+    u8* base = out->data + out->position;
+    memcpy(base, t->buf.data, length);
+
+    u32 keys[PACKET_TEMPLATE_PACKETS];
+    bool encrypt = cipher && cipher->initialized;
+    if (encrypt) isaac_keys(cipher, keys, packets);
+
+    if (g_packet_profile.enabled) packet_profile_out_settle(out);
+    for (u32 i = 0; i < packets; i++) {
+        u32 at = t->opcode_at[i];
+        u8 opcode = t->buf.data[at];
+        metrics_add(&g_metrics.packets_out[opcode], 1);
+        if (g_packet_profile.enabled) {
+            u32 end = i + 1 < packets ? t->opcode_at[i + 1] : length;
+            packet_profile_out(opcode, end - at);
+        }
+        if (encrypt) base[at] = (u8)(opcode + keys[i]);
+    }
+
+    out->position += length;
+    return base;
+}
@@ -0,0 +1,109 @@
+/*******************************************************************************
+ * PACKET_TEMPLATE.H - Prebuilt Packet Sequences, Copied and Patched per Player
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Building constant output once and copying it, instead of re-encoding
+ *   - Patching per-recipient fields at known offsets
+ *   - Stream-cipher opcodes applied to a whole sequence in one pass
+ *
+ * THE PROBLEM:
+ *
+ * Right after login every player is sent the same burst:
+ *
+ *   21 x UPDATE_STAT     [44][skill][xp:4][level]      layout fixed, values not
+ *   13 x IF_SETTAB       [167][interface:2][tab]       identical for everyone
+ *    2 x MESSAGE_GAME    [4][len]"Welcome to ..."      identical for everyone
+ *
+ * and each packet was built by its own sender: a call, a capacity check, a
+ * header with its own ISAAC step and metrics update, then the payload one
+ * field at a time - 36 times for bytes that are almost all the same for
+ * every login.
+ *
+ * THE SOLUTION - RECORD ONCE, COPY, PATCH, ENCRYPT:
+ *
+ *   at first use      packet_template_open() records each packet with its
+ *                     plain opcode and remembers where the opcode sits:
+ *
+ *     bytes      [44 00 .. .. .. .. ..][44 01 .. ..] ... [167 16 DF 00] ...
+ *     opcode_at   0                     7                 147
+ *
+ *   per player        packet_template_emit(): one memcpy into the output
+ *                     arena, then one pass over opcode_at that adds each
+ *                     packet's ISAAC key to its opcode byte; the caller
+ *                     writes its own values (stats) at fixed offsets
+ *
+ * The copy lands in the player's output arena (player.h) like any other
+ * packet, so the burst still leaves in the one write per flush that the
+ * arena already gives every packet.
+ *
+ * The client sees exactly the bytes the per-packet senders wrote: same
+ * packets, same order, one ISAAC key per packet in that order.
+ *
+ ******************************************************************************/
+
+#ifndef PACKET_TEMPLATE_H
+#define PACKET_TEMPLATE_H
+
+#include "types.h"
+#include "buffer.h"
+#include <stdbool.h>
+
+/* Bytes and packets one template holds */
+#define PACKET_TEMPLATE_BYTES   512
+#define PACKET_TEMPLATE_PACKETS 48
+
+/*
+ * PacketTemplate - Plain (unencrypted) packets, back to back
+ */
+typedef struct {
+    u8 storage[PACKET_TEMPLATE_BYTES];
+    StreamBuffer buf;                           /* Over storage; position = length */
+    u16 opcode_at[PACKET_TEMPLATE_PACKETS];     /* Offset of each packet's opcode */
+    u32 packets;
+} PacketTemplate;
+
+/*
+ * packet_template_init - Empty template
+ */
+void packet_template_init(PacketTemplate* t);
+
+/*
+ * packet_template_open - Start the next packet
+ *
+ * @param t       Template
+ * @param opcode  Plain opcode (written as is; encrypted per emit)
+ * @return        Buffer to put the payload into (buffer_put_* after
+ *                buffer_reserve, or buffer_write_*), NULL when the
+ *                template is full
+ *
+ * Variable-length packets write their own length after the opcode.
+ */
+StreamBuffer* packet_template_open(PacketTemplate* t, u8 opcode);
+
+/*
+ * packet_template_length - Bytes recorded so far
+ */
+static inline u32 packet_template_length(const PacketTemplate* t) {
+    return t->buf.position;
+}
+
+/*
+ * packet_template_emit - Append the template to an output buffer
+ *
+ * @param t       Recorded template
+ * @param out     Output buffer (usually player_out())
+ * @param cipher  Opcode cipher, or NULL / uninitialized for plain opcodes
+ * @return        Start of the copy in out, for patching per-player
+ *                fields (valid until out is written again); NULL if out
+ *                cannot grow
+ *
+ * Counts every packet in the metrics and the packet profiler as
+ * buffer_write_header() would.
+ *
+ * COMPLEXITY: O(bytes) copy + O(packets) cipher steps
+ */
+u8* packet_template_emit(const PacketTemplate* t, StreamBuffer* out, ISAACCipher* cipher);
+
+#endif /* PACKET_TEMPLATE_H */
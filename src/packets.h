@@ -18,6 +18,34 @@
  *     -1:   Variable byte (next byte is length)
  *     -2:   Variable short (next 2 bytes are length, big-endian)
  * 
+ * ONE SCHEMA, EVERYTHING GENERATED (X-macros):
+ *   Each direction is one list of X(NAME, opcode, length) rows. Every
+ *   table that used to be typed by hand is expanded from that list, so
+ *   an opcode, its name and its length can no longer disagree:
+ * 
+ *     CLIENT_PACKET_LIST(X) ──┬─> ClientPacket enum  CLIENT_IF_BUTTON = 155
+ *                             ├─> ClientPacketLength CLIENT_IF_BUTTON_LENGTH = 2
+ *                             ├─> PacketLengths[256] (the framer's table)
+ *                             └─> ClientPacketNames[256] (logging)
+ *     SERVER_PACKET_LIST(X) ──┬─> ServerPacket enum  SERVER_IF_SETTAB = 167
+ *                             ├─> ServerPacketSize   SERVER_IF_SETTAB_SIZE = 3
+ *                             └─> ServerPacketSizes[256]
+ * 
+ *   How an X-macro works: the list is a macro taking another macro,
+ *   and each use passes a different one:
+ * 
+ *     #define X_ENUM(name, op, len) CLIENT_##name = op,
+ *     enum { CLIENT_PACKET_LIST(X_ENUM) };
+ *       → enum { CLIENT_ANTICHEAT_OPLOGIC8 = 2, CLIENT_CLIENT_CHEAT = 4, ... };
+ * 
+ *   Field layouts of the packets the server decodes or encodes live
+ *   next to the lists (CLIENT_*_FIELDS, SERVER_*_FIELDS); packet_codec.h
+ *   turns them into decoders and writers, with compile-time checks that
+ *   each layout adds up to the length in the list.
+ * 
+ *   Names and lengths are those of the 225 client (src/entry/client.c
+ *   names every packet it sends; src/protocol.h has its server sizes).
+ * 
  ******************************************************************************/
 
 #ifndef PACKETS_H
@@ -26,95 +54,113 @@
 #include "types.h"
 
 /*******************************************************************************
- * SERVER PACKET OPCODES (Server → Client)
+ * SERVER PACKET SCHEMA (Server → Client)
  *******************************************************************************
  * 
  * These opcodes are sent by the server to update client state.
- * Values match Jagex's protocol specification.
+ * Values match Jagex's protocol specification; sizes match the client's
+ * SERVERPROT_SIZES (the client frames by them, so a wrong size desyncs
+ * every packet after it).
+ * 
+ *   X(name, opcode, payload size: >= 0 fixed, -1 VAR_BYTE, -2 VAR_SHORT)
  * 
  ******************************************************************************/
-/* Server packet opcodes (unchanged; matches C++ enum) */
+#define SERVER_PACKET_LIST(X) \
+    X(NPC_INFO,                       1, -2) \
+    X(IF_SETCOLOUR,                   2,  4) \
+    X(CAM_FORCEANGLE,                 3,  6) \
+    X(MESSAGE_GAME,                   4, -1) \
+    X(UPDATE_ZONE_PARTIAL_FOLLOWS,    7,  2) \
+    X(SYNTH_SOUND,                   12,  5) \
+    X(CAM_SHAKE,                     13,  4) \
+    X(IF_OPENBOTTOM,                 14,  2) \
+    X(UPDATE_INV_CLEAR,              15,  2) \
+    X(CLEAR_WALKING_QUEUE,           19,  0) \
+    X(DATA_LOC_DONE,                 20,  2) \
+    X(UPDATE_IGNORELIST,             21, -2) \
+    X(UPDATE_RUNWEIGHT,              22,  2) \
+    X(LOC_ADD_CHANGE,                23, 14) \
+    X(HINT_ARROW,                    25,  6) \
+    X(IF_SETHIDE,                    26,  3) \
+    X(IF_OPENSUB,                    28,  4) \
+    X(CHAT_FILTER_SETTINGS,          32,  3) \
+    X(MESSAGE_PRIVATE,               41, -1) \
+    X(LOC_ANIM,                      42,  4) \
+    X(UPDATE_REBOOT_TIMER,           43,  2) \
+    X(UPDATE_STAT,                   44,  6) \
+    X(IF_SETOBJECT,                  46,  6) \
+    X(OBJ_DEL,                       49,  3) \
+    X(OBJ_ADD,                       50,  7) \
+    X(MIDI_SONG,                     54, -1) \
+    X(LOC_ADD,                       59,  4) \
+    X(UPDATE_RUNENERGY,              68,  1) \
+    X(MAP_PROJANIM,                  69, 15) \
+    X(CAM_MOVETO,                    74,  6) \
+    X(LOC_DEL,                       76,  2) \
+    X(DATA_LAND_DONE,                80,  2) \
+    X(IF_SETTAB_ACTIVE,              84,  1) \
+    X(IF_SETMODEL,                   87,  4) \
+    X(UPDATE_INV_FULL,               98, -2) \
+    X(IF_SETMODEL_COLOUR,           103,  6) \
+    X(IF_SETTAB_FLASH,              126,  1) \
+    X(IF_CLOSE,                     129,  0) \
+    X(DATA_LAND,                    132, -2) \
+    X(FINISH_TRACKING,              133,  0) \
+    X(UPDATE_ZONE_FULL_FOLLOWS,     135,  2) \
+    X(RESET_ANIMS,                  136,  0) \
+    X(UPDATE_UID192,                139,  2) \
+    X(LAST_LOGIN_INFO,              140,  9) \
+    X(LOGOUT,                       142,  0) \
+    X(IF_SETANIM,                   146,  4) \
+    X(VARP_SMALL,                   150,  3) \
+    X(OBJ_COUNT,                    151,  7) \
+    X(UPDATE_FRIENDLIST,            152,  9) \
+    X(UPDATE_ZONE_PARTIAL_ENCLOSED, 162, -2) \
+    X(IF_SETTAB,                    167,  3) \
+    X(IF_OPENTOP,                   168,  2) \
+    X(VARP_LARGE,                   175,  6) \
+    X(PLAYER_INFO,                  184, -2) \
+    X(IF_OPENSTICKY,                185,  2) \
+    X(SPOTANIM_SPECIFIC,            191,  6) \
+    X(RESET_CLIENT_VARCACHE,        193,  0) \
+    X(IF_OPENSIDEBAR,               195,  2) \
+    X(IF_SETPLAYERHEAD,             197,  2) \
+    X(IF_SETTEXT,                   201, -2) \
+    X(IF_SETNPCHEAD,                204,  4) \
+    X(IF_SETPOSITION,               209,  6) \
+    X(MIDI_JINGLE,                  212, -2) \
+    X(UPDATE_INV_PARTIAL,           213, -2) \
+    X(DATA_LOC,                     220, -2) \
+    X(OBJ_REVEAL,                   223,  5) \
+    X(ENABLE_TRACKING,              226,  0) \
+    X(LOAD_AREA,                    237, -2) \
+    X(CAM_RESET,                    239,  0) \
+    X(IF_IAMOUNT,                   243,  0) \
+    X(IF_MULTIZONE,                 254,  1)
+
+#define SERVER_PACKET_ENUM(name, op, size) SERVER_##name = op,
+#define SERVER_PACKET_SIZE(name, op, size) SERVER_##name##_SIZE = size,
+
 typedef enum {
-    SERVER_NPC_INFO = 1,
-    SERVER_IF_SETCOLOUR = 2,
-    SERVER_CAM_FORCEANGLE = 3,
-    SERVER_MESSAGE_GAME = 4,
-    SERVER_UPDATE_ZONE_PARTIAL_FOLLOWS = 7,
-    SERVER_SYNTH_SOUND = 12,
-    SERVER_CAM_SHAKE = 13,
-    SERVER_IF_OPENBOTTOM = 14,
-    SERVER_UPDATE_INV_CLEAR = 15,
-    SERVER_CLEAR_WALKING_QUEUE = 19,
-    SERVER_DATA_LOC_DONE = 20,
-    SERVER_UPDATE_IGNORELIST = 21,
-    SERVER_UPDATE_RUNWEIGHT = 22,
-    SERVER_LOC_ADD_CHANGE = 23,
-    SERVER_HINT_ARROW = 25,
-    SERVER_IF_SETHIDE = 26,
-    SERVER_IF_OPENSUB = 28,
-    SERVER_CHAT_FILTER_SETTINGS = 32,
-    SERVER_MESSAGE_PRIVATE = 41,
-    SERVER_LOC_ANIM = 42,
-    SERVER_UPDATE_REBOOT_TIMER = 43,
-    SERVER_UPDATE_STAT = 44,
-    SERVER_IF_SETOBJECT = 46,
-    SERVER_OBJ_DEL = 49,
-    SERVER_OBJ_ADD = 50,
-    SERVER_MIDI_SONG = 54,
-    SERVER_LOC_ADD = 59,
-    SERVER_UPDATE_RUNENERGY = 68,
-    SERVER_MAP_PROJANIM = 69,
-    SERVER_SENDMAPREGION = 73,   /* present in some trees; fine to keep */
-    SERVER_CAM_MOVETO = 74,
-    SERVER_LOC_DEL = 76,
-    SERVER_DATA_LAND_DONE = 80,
-    SERVER_IF_SETTAB_ACTIVE = 84,
-    SERVER_IF_SETMODEL = 87,
-    SERVER_UPDATE_INV_FULL = 98,
-    SERVER_IF_SETMODEL_COLOUR = 103,
-    SERVER_IF_SETTAB_FLASH = 126,
-    SERVER_IF_CLOSE = 129,
-    SERVER_DATA_LAND = 132,
-    SERVER_FINISH_TRACKING = 133,
-    SERVER_UPDATE_ZONE_FULL_FOLLOWS = 135,
-    SERVER_RESET_ANIMS = 136,
-    SERVER_UPDATE_UID192 = 139,
-    SERVER_LAST_LOGIN_INFO = 140,
-    SERVER_LOGOUT = 142,
-    SERVER_IF_SETANIM = 146,
-    SERVER_VARP_SMALL = 150,
-    SERVER_OBJ_COUNT = 151,
-    SERVER_UPDATE_FRIENDLIST = 152,
-    SERVER_UPDATE_ZONE_PARTIAL_ENCLOSED = 162,
-    SERVER_IF_SETTAB = 167,
-    SERVER_IF_OPENTOP = 168,
-    SERVER_VARP_LARGE = 175,
-    SERVER_PLAYER_INFO = 184,
-    SERVER_IF_OPENSTICKY = 185,
-    SERVER_SPOTANIM_SPECIFIC = 191,
-    SERVER_RESET_CLIENT_VARCACHE = 193,
-    SERVER_IF_OPENSIDEBAR = 195,
-    SERVER_IF_SETPLAYERHEAD = 197,
-    SERVER_IF_SETTEXT = 201,
-    SERVER_IF_SETNPCHEAD = 204,
-    SERVER_IF_SETPOSITION = 209,
-    SERVER_MIDI_JINGLE = 212,
-    SERVER_UPDATE_INV_PARTIAL = 213,
-    SERVER_DATA_LOC = 220,
-    SERVER_OBJ_REVEAL = 223,
-    SERVER_ENABLE_TRACKING = 226,
-    SERVER_LOAD_AREA = 237,
-    SERVER_CAM_RESET = 239,
-    SERVER_IF_IAMOUNT = 243,
-    SERVER_IF_MULTIZONE = 254
+    SERVER_PACKET_LIST(SERVER_PACKET_ENUM)
 } ServerPacket;
 
+typedef enum {
+    SERVER_PACKET_LIST(SERVER_PACKET_SIZE)
+} ServerPacketSize;
+
+/* Opcode → payload size, for code that has only the opcode (broadcast.c) */
+#define SERVER_PACKET_SIZE_ENTRY(name, op, size) [op] = size,
+
+static const i8 ServerPacketSizes[256] = {
+    SERVER_PACKET_LIST(SERVER_PACKET_SIZE_ENTRY)
+};
+
 /*******************************************************************************
- * CLIENT PACKET LENGTH TABLE (Client → Server)
+ * CLIENT PACKET SCHEMA (Client → Server)
  *******************************************************************************
  * 
- * Maps client packet opcode to expected payload size.
- * Used during packet parsing to determine how many bytes to read.
+ * Every packet the 225 client sends, with its payload length.
  * 
  * ENCODING:
  *   -2: Variable short (read 2-byte big-endian length, then payload)
@@ -122,6 +168,105 @@ typedef enum {
  *    0: Header only (no payload)
  *   >0: Fixed size payload in bytes
  * 
+ ******************************************************************************/
+#define CLIENT_PACKET_LIST(X) \
+    X(ANTICHEAT_OPLOGIC8,      2,  2) \
+    X(CLIENT_CHEAT,            4, -1) \
+    X(INV_BUTTON5,             6,  6) \
+    X(ANTICHEAT_OPLOGIC1,      7,  4) \
+    X(OPNPC2,                  8,  2) \
+    X(OPLOCT,                  9,  8) \
+    X(FRIENDLIST_DEL,         11,  8) \
+    X(ANTICHEAT_OPLOGIC7,     17,  4) \
+    X(OPNPC3,                 27,  2) \
+    X(ANTICHEAT_OPLOGIC3,     30,  3) \
+    X(INV_BUTTON1,            31,  6) \
+    X(INV_BUTTON4,            38,  6) \
+    X(OPOBJ2,                 40,  6) \
+    X(OPHELDT,                48,  8) \
+    X(IF_PLAYERDESIGN,        52, 13) \
+    X(OPPLAYER2,              53,  2) \
+    X(INV_BUTTON2,            59,  6) \
+    X(ANTICHEAT_OPLOGIC6,     66,  4) \
+    X(IDLE_TIMER,             70,  0) \
+    X(OPHELD2,                71,  6) \
+    X(OPLOCU,                 75, 12) \
+    X(IGNORELIST_ADD,         79,  8) \
+    X(EVENT_TRACKING,         81, -2) \
+    X(ANTICHEAT_CYCLELOGIC5,  85,  0) \
+    X(ANTICHEAT_OPLOGIC2,     88,  4) \
+    X(MOVE_OPCLICK,           93, -1) \
+    X(OPLOC3,                 96,  6) \
+    X(OPLOC4,                 97,  6) \
+    X(OPNPC5,                100,  2) \
+    X(NO_TIMEOUT,            108,  0) \
+    X(OPNPC4,                113,  2) \
+    X(OPLOC5,                116,  6) \
+    X(FRIENDLIST_ADD,        118,  8) \
+    X(OPHELDU,               130, 12) \
+    X(OPHELD3,               133,  6) \
+    X(OPNPCT,                134,  4) \
+    X(OPOBJT,                138,  8) \
+    X(OPOBJ1,                140,  6) \
+    X(ANTICHEAT_CYCLELOGIC2, 146, -1) \
+    X(MESSAGE_PRIVATE,       148, -1) \
+    X(REBUILD_GETMAPS,       150, -1) \
+    X(IF_BUTTON,             155,  2) \
+    X(OPHELD4,               157,  6) \
+    X(MESSAGE_PUBLIC,        158, -1) \
+    X(INV_BUTTOND,           159,  6) \
+    X(OPPLAYER1,             164,  2) \
+    X(MOVE_MINIMAPCLICK,     165, -1) \
+    X(IGNORELIST_DEL,        171,  8) \
+    X(OPLOC2,                172,  6) \
+    X(TUTORIAL_CLICKSIDE,    175,  1) \
+    X(ANTICHEAT_OPLOGIC4,    176,  2) \
+    X(OPPLAYERT,             177,  4) \
+    X(OPOBJ4,                178,  6) \
+    X(MOVE_GAMECLICK,        181, -1) \
+    X(OPPLAYER3,             185,  2) \
+    X(EVENT_CAMERA_POSITION, 189,  6) \
+    X(BUG_REPORT,            190, 10) \
+    X(OPNPC1,                194,  2) \
+    X(OPHELD1,               195,  6) \
+    X(OPOBJ3,                200,  6) \
+    X(OPNPCU,                202,  8) \
+    X(OPPLAYER4,             206,  2) \
+    X(OPHELD5,               211,  6) \
+    X(INV_BUTTON3,           212,  6) \
+    X(ANTICHEAT_CYCLELOGIC3, 215,  3) \
+    X(ANTICHEAT_CYCLELOGIC6, 219, -1) \
+    X(ANTICHEAT_OPLOGIC5,    220,  0) \
+    X(CLOSE_MODAL,           231,  0) \
+    X(ANTICHEAT_CYCLELOGIC1, 233,  1) \
+    X(RESUME_PAUSEBUTTON,    235,  2) \
+    X(ANTICHEAT_CYCLELOGIC4, 236,  4) \
+    X(RESUME_P_COUNTDIALOG,  237,  4) \
+    X(ANTICHEAT_OPLOGIC9,    238,  1) \
+    X(OPOBJU,                239, 12) \
+    X(CHAT_SETMODE,          244,  3) \
+    X(OPLOC1,                245,  6) \
+    X(OPOBJ5,                247,  6) \
+    X(OPPLAYERU,             248,  8)
+
+#define CLIENT_PACKET_ENUM(name, op, len) CLIENT_##name = op,
+#define CLIENT_PACKET_LENGTH(name, op, len) CLIENT_##name##_LENGTH = len,
+
+typedef enum {
+    CLIENT_PACKET_LIST(CLIENT_PACKET_ENUM)
+} ClientPacket;
+
+typedef enum {
+    CLIENT_PACKET_LIST(CLIENT_PACKET_LENGTH)
+} ClientPacketLength;
+
+/*******************************************************************************
+ * CLIENT PACKET LENGTH TABLE
+ *******************************************************************************
+ * 
+ * Maps client packet opcode to expected payload size.
+ * Used during packet parsing to determine how many bytes to read.
+ * 
  * PARSING ALGORITHM:
  *   1. Read encrypted opcode byte
  *   2. Decrypt: opcode = (encrypted - isaac_next()) & 0xFF
@@ -130,42 +275,127 @@ typedef enum {
  *   5. If len == -2: read 2 bytes (big-endian) for length
  *   6. Read 'len' bytes of payload
  * 
- * VALUES:
- *   Protocol revision 225 client packet sizes
+ * GENERATED:
+ *   Designated initializers from CLIENT_PACKET_LIST; opcodes the client
+ *   never sends stay 0 (header only).
  * 
  ******************************************************************************/
-/*
- * Protocol 225 client packet lengths (client -> server).
- * -1 = variable byte, -2 = variable short, 0+ = fixed size
- * COPIED to match the working C++ server's Packet.h table.
- */
+#define CLIENT_PACKET_LENGTH_ENTRY(name, op, len) [op] = len,
+#define CLIENT_PACKET_NAME_ENTRY(name, op, len) [op] = #name,
+
 static const i8 PacketLengths[256] = {
-    0, 0, 2, 0, -1, 0, 6, 4, 2, 8, // 0-9
-    0, 8, 0, 0, 0, 0, 0, 4, 0, 0,  // 10-19
-    0, 0, 0, 0, 0, 0, 0, 2, 0, 0,  // 20-29
-    3, 6, 0, 0, 0, 0, 0, 0, 6, 0,  // 30-39
-    6, 0, 0, 0, 0, 0, 0, 0, 8, 0,  // 40-49
-    0, 0, 13, 2, 0, 0, 0, 0, 0, 6, // 50-59
-    0, 0, 0, 0, 0, 0, 4, 0, 0, 0,  // 60-69
-    0, 6, 0, 0, 0, 12, 0, 0, 0, 8, // 70-79
-    0, -2, 0, 0, 0, 0, 0, 0, 4, 0, // 80-89
-    0, 0, 0, -1, 0, 0, 6, 6, -1, 0,// 90-99
-    2, 0, 0, 0, 0, 0, 0, 0, 0, 0,  // 100-109
-    0, 0, 0, 2, 0, 0, 6, 0, 8, 0,  // 110-119
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  // 120-129
-    12, 0, 0, 6, 4, 0, 0, 0, 8, 0, // 130-139
-    6, 0, 0, 0, 0, 0, -1, 0, -1, 0,// 140-149
-    -1, 0, 0, 0, 0, 2, 0, 6, -1, 6,// 150-159
-    0, 0, 0, 0, 2, -1, 0, 0, 0, 0, // 160-169
-    0, 8, 6, 0, 0, 1, 2, 4, 6, 0,  // 170-179
-    0, -1, 0, 0, 0, 2, 0, 0, 0, 6, // 180-189
-    10, 0, 0, 0, 2, 0, 6, 0, 0, 0, // 190-199 (190=10, 194=2, 195=6)
-    6, 0, 8, 0, 0, 0, 2, 0, 0, 0,  // 200-209 (200=6, 202=8, 206=2)
-    0, 6, 6, 0, 0, 3, 0, 0, 0, -1, // 210-219 (211=6, 212=6, 215=3, 219=-1)
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  // 220-229 (no changes)
-    0, 0, 0, 1, 0, 2, 4, 4, 1, 12, // 230-239 (233=1, 235=2, 236=4, 237=4, 238=1, 239=12)
-    0, 0, 0, 0, 3, 6, 0, 6, 8, 0,  // 240-249 (244=3, 245=6, 247=6, 248=8)
-    0, 0, 0, 0, 0, 0               // 250-255
+    CLIENT_PACKET_LIST(CLIENT_PACKET_LENGTH_ENTRY)
+};
+
+/* Opcode → "IF_BUTTON" etc., NULL for opcodes not in the schema */
+static const char* const ClientPacketNames[256] = {
+    CLIENT_PACKET_LIST(CLIENT_PACKET_NAME_ENTRY)
 };
 
+/*******************************************************************************
+ * FIELD LAYOUTS
+ *******************************************************************************
+ * 
+ * Fixed layouts of the packets with a generated codec (packet_codec.h),
+ * all big-endian:
+ * 
+ *   F(type, name)          one u8 / i8 / u16 / u32 / u64
+ *   A(type, name, count)   an array of them
+ * 
+ * The client's VAR_BYTE walk packets share a fixed 5-byte header
+ * (MOVE), followed by the steps.
+ * 
+ ******************************************************************************/
+
+/* Client → server */
+#define CLIENT_IF_BUTTON_FIELDS(F, A) \
+    F(u16, component)
+
+#define CLIENT_IF_PLAYERDESIGN_FIELDS(F, A) \
+    F(i8, gender) \
+    A(i8, identikits, 7) \
+    A(u8, colors, 5)
+
+#define CLIENT_RESUME_PAUSEBUTTON_FIELDS(F, A) \
+    F(u16, component)
+
+#define CLIENT_OPNPC_FIELDS(F, A) \
+    F(u16, npc_index)
+
+/* INV_BUTTON1-5: the item, its slot and the inventory component */
+#define CLIENT_INV_BUTTON_FIELDS(F, A) \
+    F(u16, item) \
+    F(u16, slot) \
+    F(u16, component)
+
+#define CLIENT_MOVE_FIELDS(F, A) \
+    F(u8, ctrl_down) \
+    F(u16, start_x) \
+    F(u16, start_z)
+
+/* FRIENDLIST_ADD / FRIENDLIST_DEL / IGNORELIST_ADD / IGNORELIST_DEL */
+#define CLIENT_SOCIAL_NAME_FIELDS(F, A) \
+    F(u64, name)
+
+/* MESSAGE_PRIVATE: recipient, then the wordpacked text */
+#define CLIENT_MESSAGE_PRIVATE_FIELDS(F, A) \
+    F(u64, name)
+
+/* Server → client */
+#define SERVER_IF_SETTAB_FIELDS(F) \
+    F(u16, component) \
+    F(u8, tab)
+
+#define SERVER_IF_OPENTOP_FIELDS(F) \
+    F(u16, component)
+
+#define SERVER_IF_OPENBOTTOM_FIELDS(F) \
+    F(u16, component)
+
+#define SERVER_IF_OPENSUB_FIELDS(F) \
+    F(u16, main) \
+    F(u16, side)
+
+#define SERVER_IF_SETHIDE_FIELDS(F) \
+    F(u16, component) \
+    F(u8, hidden)
+
+#define SERVER_IF_CLOSE_FIELDS(F)
+
+#define SERVER_UPDATE_STAT_FIELDS(F) \
+    F(u8, skill) \
+    F(u32, experience) \
+    F(u8, level)
+
+#define SERVER_UPDATE_RUNENERGY_FIELDS(F) \
+    F(u8, energy)
+
+#define SERVER_VARP_SMALL_FIELDS(F) \
+    F(u16, id) \
+    F(u8, value)
+
+#define SERVER_VARP_LARGE_FIELDS(F) \
+    F(u16, id) \
+    F(u32, value)
+
+#define SERVER_CAM_RESET_FIELDS(F)
+
+#define SERVER_LOGOUT_FIELDS(F)
+
+#define SERVER_UPDATE_ZONE_FULL_FOLLOWS_FIELDS(F) \
+    F(u8, zone_x) \
+    F(u8, zone_z)
+
+#define SERVER_DATA_LAND_DONE_FIELDS(F) \
+    F(u8, file_x) \
+    F(u8, file_z)
+
+#define SERVER_DATA_LOC_DONE_FIELDS(F) \
+    F(u8, file_x) \
+    F(u8, file_z)
+
+#define SERVER_UPDATE_FRIENDLIST_FIELDS(F) \
+    F(u64, name) \
+    F(u8, world)
+
 #endif /* PACKETS_H */
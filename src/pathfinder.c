@@ -0,0 +1,375 @@
+/*******************************************************************************
+ * PATHFINDER.C - Bounded BFS Implementation
+ *******************************************************************************
+ *
+ * See pathfinder.h for the design.
+ *
+ * SEARCH LOOP (window coordinates, source at the centre):
+ *
+ *   generation++; visit(source)
+ *   while frontier not empty:
+ *       t = pop
+ *       if t reaches the target: done
+ *       for each of the 8 neighbours n (client order):
+ *           if not visited and the step t → n is open: visit(n), push
+ *
+ * A step is open when the neighbour has none of the step's mask bits
+ * (a wall on the side being entered, a loc, a blocked floor); diagonal
+ * steps also need both cardinal steps they cut between to be open.
+ *
+ * DIRECTION CODES (client_try_move):
+ *   The code stored for a tile says where its parent lies, as bits:
+ *     0x1 parent is north, 0x2 east, 0x4 south, 0x8 west
+ *   (reached by stepping west → 2, parent is east).
+ *
+ ******************************************************************************/
+
+#include "pathfinder.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+PathFinder* g_pathfinder = NULL;
+
+/* Client's bfsCost limit when looking for the nearest reachable tile */
+#define NEAREST_MAX_COST 100
+
+/*
+ * Step - One of the 8 moves, with the masks that must be clear
+ *
+ * mask:    bits of the destination tile that block the move (STEP_BLOCK_*)
+ * side_x:  mask for (x + dx, z) on diagonals, 0 for cardinal moves
+ * side_z:  mask for (x, z + dz) on diagonals
+ */
+typedef struct {
+    i8 dx;
+    i8 dz;
+    u8 code;
+    u16 mask;
+    u16 side_x;
+    u16 side_z;
+} Step;
+
+static const Step STEPS[8] = {
+    { -1,  0,  2, STEP_BLOCK_WEST,       0,               0                },
+    {  1,  0,  8, STEP_BLOCK_EAST,       0,               0                },
+    {  0, -1,  1, STEP_BLOCK_SOUTH,      0,               0                },
+    {  0,  1,  4, STEP_BLOCK_NORTH,      0,               0                },
+    { -1, -1,  3, STEP_BLOCK_SOUTH_WEST, STEP_BLOCK_WEST, STEP_BLOCK_SOUTH },
+    {  1, -1,  9, STEP_BLOCK_SOUTH_EAST, STEP_BLOCK_EAST, STEP_BLOCK_SOUTH },
+    { -1,  1,  6, STEP_BLOCK_NORTH_WEST, STEP_BLOCK_WEST, STEP_BLOCK_NORTH },
+    {  1,  1, 12, STEP_BLOCK_NORTH_EAST, STEP_BLOCK_EAST, STEP_BLOCK_NORTH },
+};
+
+/*
+ * Target - What ends the search
+ */
+typedef struct {
+    i32 x;                  /* World tile (south-west corner) */
+    i32 z;
+    u32 width;              /* 0 = exactly (x, z) */
+    u32 length;
+    u8 forceapproach;
+} Target;
+
+/*
+ * Search - Per-call constants
+ */
+typedef struct {
+    const WorldCollision* collision;
+    u32 level;
+    i32 origin_x;           /* World tile of window (0, 0) */
+    i32 origin_z;
+} Search;
+
+static inline u32 tile_index(i32 x, i32 z) {
+    return (u32)x * PATHFINDER_SIZE + (u32)z;
+}
+
+/*
+ * window_flags - Packed flags of a window tile
+ */
+static inline u16 window_flags(const Search* s, i32 x, i32 z) {
+    return world_collision_flags(s->collision, s->level, s->origin_x + x, s->origin_z + z);
+}
+
+/*
+ * reached - Whether window tile (x, z) ends the search
+ *
+ * Rectangle targets: inside it, or on a tile touching one of its sides
+ * with no wall on the side facing it and that side not excluded by
+ * forceapproach (collisionmap_test_loc(), on packed flags).
+ */
+static bool reached(const Search* s, const Target* target, i32 x, i32 z) {
+    i32 wx = s->origin_x + x;
+    i32 wz = s->origin_z + z;
+    if (target->width == 0) return wx == target->x && wz == target->z;
+
+    i32 max_x = target->x + (i32)target->width - 1;
+    i32 max_z = target->z + (i32)target->length - 1;
+    bool along_z = wz >= target->z && wz <= max_z;
+    bool along_x = wx >= target->x && wx <= max_x;
+    if (along_x && along_z) return true;
+
+    u16 flags = window_flags(s, x, z);
+    if (wx == target->x - 1 && along_z) {
+        return !(flags & TILE_WALL_EAST) && !(target->forceapproach & 0x8);
+    }
+    if (wx == max_x + 1 && along_z) {
+        return !(flags & TILE_WALL_WEST) && !(target->forceapproach & 0x2);
+    }
+    if (wz == target->z - 1 && along_x) {
+        return !(flags & TILE_WALL_NORTH) && !(target->forceapproach & 0x4);
+    }
+    if (wz == max_z + 1 && along_x) {
+        return !(flags & TILE_WALL_SOUTH) && !(target->forceapproach & 0x1);
+    }
+    return false;
+}
+
+/*
+ * trace_path - Turn points from the source to (x, z), into result
+ *
+ * Walks parent directions back to the source, collecting the tiles where
+ * the direction changes into finder->queue (free once the search is
+ * over), then copies them out source-first.
+ */
+static void trace_path(PathFinder* finder, const Search* s, i32 x, i32 z, PathResult* result) {
+    const i32 centre = PATHFINDER_SIZE / 2;
+    u32 count = 0;
+
+    /* The source itself is never a waypoint */
+    if (x != centre || z != centre) {
+        finder->queue[count++] = (u16)tile_index(x, z);
+    }
+    u8 dir = finder->direction[tile_index(x, z)];
+    u8 next = dir;
+
+    while (x != centre || z != centre) {
+        if (next != dir) {
+            dir = next;
+            finder->queue[count++] = (u16)tile_index(x, z);
+        }
+
+        if (next & 0x2) {
+            x++;
+        } else if (next & 0x8) {
+            x--;
+        }
+        if (next & 0x1) {
+            z++;
+        } else if (next & 0x4) {
+            z--;
+        }
+        next = finder->direction[tile_index(x, z)];
+    }
+
+    result->count = 0;
+    for (u32 i = count; i > 0 && result->count < MAX_WAYPOINTS; i--) {
+        u32 tile = finder->queue[i - 1];
+        result->x[result->count] = (u32)(s->origin_x + (i32)(tile / PATHFINDER_SIZE));
+        result->z[result->count] = (u32)(s->origin_z + (i32)(tile % PATHFINDER_SIZE));
+        result->count++;
+    }
+}
+
+/*
+ * search - BFS from the window centre until target is reached
+ */
+static PathStatus search(PathFinder* finder, const WorldCollision* collision, u32 level,
+                         u32 src_x, u32 src_z, const Target* target, bool try_nearest,
+                         PathResult* result) {
+    result->count = 0;
+    result->nearest = false;
+
+    if (!finder || !collision) return PATH_OUT_OF_RANGE;
+
+    const i32 centre = PATHFINDER_SIZE / 2;
+    Search s;
+    s.collision = collision;
+    s.level = level;
+    s.origin_x = (i32)src_x - centre;
+    s.origin_z = (i32)src_z - centre;
+
+    i32 dest_x = target->x - s.origin_x;
+    i32 dest_z = target->z - s.origin_z;
+    if (dest_x < 0 || dest_z < 0 || dest_x >= PATHFINDER_SIZE || dest_z >= PATHFINDER_SIZE) {
+        return PATH_OUT_OF_RANGE;
+    }
+    if (!world_collision_mapped(collision, level, (i32)src_x, (i32)src_z)) {
+        return PATH_OUT_OF_RANGE;
+    }
+
+    if (++finder->generation == 0) {
+        memset(finder->stamp, 0, sizeof(finder->stamp));
+        finder->generation = 1;
+    }
+    const u32 generation = finder->generation;
+    u32* stamp = finder->stamp;
+
+    u32 head = 0;
+    u32 tail = 0;
+    u32 start = tile_index(centre, centre);
+    stamp[start] = generation;
+    finder->direction[start] = 0xFF;  /* Source: ends the back-trace */
+    finder->cost[start] = 0;
+    finder->queue[tail++] = (u16)start;
+
+    bool arrived = false;
+    i32 x = centre;
+    i32 z = centre;
+
+    while (head != tail) {
+        u32 tile = finder->queue[head++];
+        x = (i32)(tile / PATHFINDER_SIZE);
+        z = (i32)(tile % PATHFINDER_SIZE);
+
+        if (reached(&s, target, x, z)) {
+            arrived = true;
+            break;
+        }
+
+        u16 next_cost = (u16)(finder->cost[tile] + 1);
+        for (u32 i = 0; i < 8; i++) {
+            const Step* step = &STEPS[i];
+            i32 nx = x + step->dx;
+            i32 nz = z + step->dz;
+            if (nx < 0 || nz < 0 || nx >= PATHFINDER_SIZE || nz >= PATHFINDER_SIZE) continue;
+
+            u32 n = tile_index(nx, nz);
+            if (stamp[n] == generation) continue;
+            if (window_flags(&s, nx, nz) & step->mask) continue;
+            if (step->side_x && ((window_flags(&s, nx, z) & step->side_x) ||
+                                 (window_flags(&s, x, nz) & step->side_z))) continue;
+
+            stamp[n] = generation;
+            finder->direction[n] = step->code;
+            finder->cost[n] = next_cost;
+            finder->queue[tail++] = (u16)n;
+        }
+    }
+
+    finder->searches++;
+    finder->tiles_visited += head;
+
+    if (!arrived) {
+        if (!try_nearest) return PATH_UNREACHABLE;
+
+        /* Reached tile next to the destination with the lowest cost */
+        u32 best = NEAREST_MAX_COST;
+        for (i32 px = dest_x - 1; px <= dest_x + 1; px++) {
+            for (i32 pz = dest_z - 1; pz <= dest_z + 1; pz++) {
+                if (px < 0 || pz < 0 || px >= PATHFINDER_SIZE || pz >= PATHFINDER_SIZE) continue;
+                u32 n = tile_index(px, pz);
+                if (stamp[n] == generation && finder->cost[n] < best) {
+                    best = finder->cost[n];
+                    x = px;
+                    z = pz;
+                    arrived = true;
+                }
+            }
+        }
+        if (!arrived) return PATH_UNREACHABLE;
+        result->nearest = true;
+    }
+
+    trace_path(finder, &s, x, z, result);
+    return PATH_FOUND;
+}
+
+PathFinder* pathfinder_create(void) {
+    PathFinder* finder = (PathFinder*)calloc(1, sizeof(PathFinder));
+    if (!finder) {
+        fprintf(stderr, "ERROR: Failed to allocate pathfinder\n");
+    }
+    return finder;
+}
+
+void pathfinder_destroy(PathFinder* finder) {
+    if (!finder) return;
+    if (finder->searches > 0) {
+        printf("Pathfinder: %llu searches, %llu tiles visited on average\n",
+               (unsigned long long)finder->searches,
+               (unsigned long long)(finder->tiles_visited / finder->searches));
+    }
+    free(finder);
+}
+
+PathStatus pathfinder_find_tile(PathFinder* finder, const WorldCollision* collision, u32 level,
+                                u32 src_x, u32 src_z, u32 dest_x, u32 dest_z,
+                                bool try_nearest, PathResult* result) {
+    Target target = { (i32)dest_x, (i32)dest_z, 0, 0, 0 };
+    return search(finder, collision, level, src_x, src_z, &target, try_nearest, result);
+}
+
+PathStatus pathfinder_find_adjacent(PathFinder* finder, const WorldCollision* collision, u32 level,
+                                    u32 src_x, u32 src_z, u32 dest_x, u32 dest_z,
+                                    u32 width, u32 length, u8 forceapproach, PathResult* result) {
+    Target target = { (i32)dest_x, (i32)dest_z, width ? width : 1, length ? length : 1, forceapproach };
+    return search(finder, collision, level, src_x, src_z, &target, false, result);
+}
+
+/*
+ * STEP_BY_DELTA - STEPS entry for a one-tile move, by (dx + 1) * 3 + (dz + 1)
+ *
+ * Index 4 (no move) is never looked up.
+ */
+static const u8 STEP_BY_DELTA[9] = {
+    4, 0, 6,    /* dx = -1: SW, W, NW */
+    2, 0, 3,    /* dx =  0: S, -, N */
+    5, 1, 7,    /* dx = +1: SE, E, NE */
+};
+
+u32 pathfinder_validate_steps(const WorldCollision* collision, u32 level, u32 src_x, u32 src_z,
+                              u32* x, u32* z, u32 count) {
+    if (!collision || !world_collision_mapped(collision, level, (i32)src_x, (i32)src_z)) {
+        return count;
+    }
+
+    i32 cx = (i32)src_x;
+    i32 cz = (i32)src_z;
+    for (u32 i = 0; i < count; i++) {
+        i32 tx = (i32)x[i];
+        i32 tz = (i32)z[i];
+        while (cx != tx || cz != tz) {
+            i32 sx = (tx > cx) - (tx < cx);
+            i32 sz = (tz > cz) - (tz < cz);
+            const Step* step = &STEPS[STEP_BY_DELTA[(sx + 1) * 3 + (sz + 1)]];
+            i32 nx = cx + sx;
+            i32 nz = cz + sz;
+
+            u16 blocked = world_collision_flags(collision, level, nx, nz) & step->mask;
+            if (step->side_x) {
+                blocked |= world_collision_flags(collision, level, nx, cz) & step->side_x;
+                blocked |= world_collision_flags(collision, level, cx, nz) & step->side_z;
+            }
+            if (blocked) {
+                /* Stop where the walk stops: keep a partial last leg */
+                bool at_start = i == 0 ? cx == (i32)src_x && cz == (i32)src_z
+                                       : cx == (i32)x[i - 1] && cz == (i32)z[i - 1];
+                if (at_start) return i;
+                x[i] = (u32)cx;
+                z[i] = (u32)cz;
+                return i + 1;
+            }
+            cx = nx;
+            cz = nz;
+        }
+    }
+    return count;
+}
+
+void pathfinder_walk_to(MovementHandler* handler, u32 level, u32 src_x, u32 src_z, u32 dest_x, u32 dest_z) {
+    PathResult path;
+    PathStatus status = pathfinder_find_tile(g_pathfinder, g_world_collision, level,
+                                             src_x, src_z, dest_x, dest_z, true, &path);
+
+    if (status == PATH_OUT_OF_RANGE) {
+        movement_naive_path(handler, src_x, src_z, dest_x, dest_z);
+        return;
+    }
+
+    if (status == PATH_FOUND) {
+        movement_add_path(handler, path.x, path.z, path.count);
+    }
+}
@@ -0,0 +1,219 @@
+/*******************************************************************************
+ * PATHFINDER.H - Bounded Breadth-First Search over the Collision Grids
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Breadth-first search on a uniform-cost grid (8-way movement)
+ *   - Bounding a search (fixed window) so its worst case is known
+ *   - Reusing one preallocated buffer with generation stamps (no clears)
+ *   - Compressing a tile path into turn points
+ *
+ * THE PROBLEM:
+ *
+ * movement_naive_path() walks diagonally, then straight, and ignores
+ * every wall. Anything the server moves on its own (destination-only walk
+ * packets, NPCs closing in on a target) walked through scenery.
+ *
+ * THE SOLUTION - THE CLIENT'S BFS, ON THE SERVER'S GRID:
+ *
+ * The same search the client runs in client_try_move(), over the world
+ * collision pages (world_collision.h), limited to a window centred on
+ * the source:
+ *
+ *        PATHFINDER_SIZE (128)
+ *   ┌──────────────────────────┐
+ *   │            · · ·         │   every tile within 64 of the source
+ *   │          · · S · ·       │   is reachable by the search; a
+ *   │            · · ·    D    │   destination outside the window
+ *   │                          │   gets no path (caller falls back)
+ *   └──────────────────────────┘
+ *
+ *   Expansion order W, E, S, N, SW, SE, NW, NE and the per-direction
+ *   masks (STEP_BLOCK_*) are the client's, so both sides pick the same
+ *   shortest path. Tile lookups go through world_collision_flags(), which
+ *   does not branch when the search crosses into another region's page.
+ *
+ * GENERATION STAMPS:
+ *
+ * A search must start with every tile unvisited. Clearing 16K entries
+ * per search would cost more than most searches; instead each tile
+ * records the search that last visited it:
+ *
+ *   visited(t)  ⇔  stamp[t] == generation
+ *   new search  →  generation++            (O(1) "clear")
+ *
+ * Only when the 32-bit counter wraps is the stamp array zeroed.
+ *
+ * TURN POINTS:
+ *   The tile path is walked back from the destination through the
+ *   recorded directions; only the tiles where the direction changes are
+ *   kept (as the client does), which is what MovementHandler expects: it
+ *   steps towards each waypoint one tile at a time.
+ *
+ * COMPLEXITY:
+ *   O(tiles visited) per search, at most PATHFINDER_SIZE² (16384) tiles
+ *   and 8 neighbour tests each; a path across a room visits a few hundred.
+ *
+ * THREAD SAFETY:
+ *   A PathFinder is scratch space for one search at a time. The server's
+ *   g_pathfinder is used from the game thread only.
+ *
+ ******************************************************************************/
+
+#ifndef PATHFINDER_H
+#define PATHFINDER_H
+
+#include "types.h"
+#include "movement.h"
+#include "world_collision.h"
+#include <stdbool.h>
+
+/* Edge of the search window in tiles (source at its centre) */
+#define PATHFINDER_SIZE 128
+
+/* Tiles in the window */
+#define PATHFINDER_TILES (PATHFINDER_SIZE * PATHFINDER_SIZE)
+
+/*
+ * PathStatus - Outcome of a search
+ */
+typedef enum {
+    PATH_FOUND = 0,         /* result holds the path (maybe to a nearby tile) */
+    PATH_UNREACHABLE,       /* Searched the window, no way there */
+    PATH_OUT_OF_RANGE       /* Destination outside the window, or the
+                               source's region has no map: never searched */
+} PathStatus;
+
+/*
+ * PathFinder - Reusable search state
+ *
+ * All arrays are indexed by window tile: x * PATHFINDER_SIZE + z.
+ */
+typedef struct {
+    u32 generation;                 /* Current search */
+    u32 stamp[PATHFINDER_TILES];    /* Search that last reached the tile */
+    u8 direction[PATHFINDER_TILES]; /* Step that reached it (client codes) */
+    u16 cost[PATHFINDER_TILES];     /* Steps from the source */
+    u16 queue[PATHFINDER_TILES];    /* BFS frontier (each tile queued once) */
+
+    u64 searches;                   /* Statistics */
+    u64 tiles_visited;
+} PathFinder;
+
+/*
+ * PathResult - Turn points from the source (exclusive) to the end
+ */
+typedef struct {
+    u32 count;
+    u32 x[MAX_WAYPOINTS];
+    u32 z[MAX_WAYPOINTS];
+    bool nearest;           /* Destination unreachable: ends next to it */
+} PathResult;
+
+/*
+ * g_pathfinder - The game thread's search buffer (NULL until created)
+ */
+extern PathFinder* g_pathfinder;
+
+/*
+ * pathfinder_create - Allocate a search buffer
+ *
+ * @return  PathFinder, or NULL on allocation failure
+ */
+PathFinder* pathfinder_create(void);
+
+/*
+ * pathfinder_destroy - Free a search buffer
+ *
+ * @param finder  Buffer (NULL-safe)
+ */
+void pathfinder_destroy(PathFinder* finder);
+
+/*
+ * pathfinder_find_tile - Shortest path to a tile (click-to-walk)
+ *
+ * @param finder        Search buffer
+ * @param collision     World collision
+ * @param level         Height level of source and destination
+ * @param src_x, src_z  Start tile
+ * @param dest_x, dest_z Destination tile
+ * @param try_nearest   If unreachable, end at the reached tile nearest
+ *                      the destination (within one tile, as the client)
+ * @param result        Receives the turn points (count 0 = already there)
+ * @return              PATH_FOUND, PATH_UNREACHABLE or PATH_OUT_OF_RANGE
+ *
+ * A path longer than MAX_WAYPOINTS turn points keeps the first
+ * MAX_WAYPOINTS from the source (the walk stops short).
+ *
+ * COMPLEXITY: O(tiles visited), bounded by PATHFINDER_TILES
+ */
+PathStatus pathfinder_find_tile(PathFinder* finder, const WorldCollision* collision, u32 level,
+                                u32 src_x, u32 src_z, u32 dest_x, u32 dest_z,
+                                bool try_nearest, PathResult* result);
+
+/*
+ * pathfinder_find_adjacent - Shortest path to stand next to a rectangle
+ *
+ * @param finder         Search buffer
+ * @param collision      World collision
+ * @param level          Height level
+ * @param src_x, src_z   Start tile
+ * @param dest_x, dest_z South-west tile of the target
+ * @param width, length  Target size in tiles (an NPC, a loc footprint)
+ * @param forceapproach  Sides that don't count (LocCollision.forceapproach)
+ * @param result         Receives the turn points
+ * @return               PATH_FOUND once a tile touching the target (not
+ *                       through a wall, see collisionmap_test_loc) is
+ *                       reached; otherwise as pathfinder_find_tile()
+ *
+ * Used for chasing and for walking up to things: the target's own tiles
+ * are usually blocked, so the search ends beside it instead.
+ *
+ * COMPLEXITY: O(tiles visited), bounded by PATHFINDER_TILES
+ */
+PathStatus pathfinder_find_adjacent(PathFinder* finder, const WorldCollision* collision, u32 level,
+                                    u32 src_x, u32 src_z, u32 dest_x, u32 dest_z,
+                                    u32 width, u32 length, u8 forceapproach, PathResult* result);
+
+/*
+ * pathfinder_validate_steps - Cut a client-sent path at its first blocked step
+ *
+ * @param collision      World collision (NULL: path kept as sent)
+ * @param level          Height level
+ * @param src_x, src_z   Current tile
+ * @param x, z           Waypoints in walking order; the last one kept is
+ *                       rewritten to the last open tile if a step towards
+ *                       it is blocked
+ * @param count          Waypoints in x/z
+ * @return               Waypoints to keep (0 = the first step is blocked)
+ *
+ * Walks the path the way MovementHandler will (diagonally, then straight,
+ * towards each waypoint) and tests every tile against the step masks,
+ * without searching. One table lookup and one or three flag loads per
+ * tile, so it is cheap enough for every movement packet; the BFS is only
+ * for paths the server makes itself.
+ *
+ * A path starting in a region without a map is kept as sent.
+ *
+ * COMPLEXITY: O(tiles walked), at most MAX_WAYPOINTS x 255 for a packet
+ */
+u32 pathfinder_validate_steps(const WorldCollision* collision, u32 level, u32 src_x, u32 src_z,
+                              u32* x, u32* z, u32 count);
+
+/*
+ * pathfinder_walk_to - Queue a collision-aware walk to a tile
+ *
+ * @param handler        Movement queue (appended to)
+ * @param level          Height level
+ * @param src_x, src_z   Current tile
+ * @param dest_x, dest_z Destination
+ *
+ * Uses g_pathfinder over g_world_collision. Without collision data, or
+ * on PATH_OUT_OF_RANGE, falls back to movement_naive_path(). An
+ * unreachable destination walks to a reachable tile next to it if there
+ * is one, otherwise nothing is queued.
+ */
+void pathfinder_walk_to(MovementHandler* handler, u32 level, u32 src_x, u32 src_z, u32 dest_x, u32 dest_z);
+
+#endif /* PATHFINDER_H */
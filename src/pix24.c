@@ -22,8 +22,143 @@
 #endif
 #include "thirdparty/stb_image.h"
 
+#if !defined(PIX3D_SCALAR) && defined(__GNUC__) && defined(__x86_64__)
+#define PIX24_SSE2 1
+#include <emmintrin.h>
+#elif !defined(PIX3D_SCALAR) && defined(__GNUC__) && defined(__ARM_NEON)
+#define PIX24_NEON 1
+#include <arm_neon.h>
+#elif !defined(PIX3D_SCALAR) && defined(__wasm_simd128__)
+#define PIX24_WASM 1
+#include <wasm_simd128.h>
+#endif
+
 extern Pix2D _Pix2D;
 
+// row kernels for the transparent (0) skipping copies and the alpha blend, 4
+// pixels at a time where the CPU has 128-bit vectors (as pix3d_span.c picks
+// them). A skipped pixel is written back unchanged. The blend keeps r and b in
+// alternate 16-bit lanes and g in a third, so src * alpha + dst * (256 - alpha)
+// (at most 255 * 256) never carries into the next channel: exactly the scalar sum
+
+static inline int pix24_blend(int rgb, int dstRgb, int alpha, int invAlpha) {
+    return (((rgb & 0xff00ff) * alpha + (dstRgb & 0xff00ff) * invAlpha & 0xff00ff00) + ((rgb & 0xff00) * alpha + (dstRgb & 0xff00) * invAlpha & 0xff0000)) >> 8;
+}
+
+static void pix24_copy_row(int *dst, const int *src, int w) {
+    int x = 0;
+#if defined(PIX24_SSE2)
+    for (; x + 4 <= w; x += 4) {
+        __m128i rgb = _mm_loadu_si128((const __m128i *)(src + x));
+        __m128i old = _mm_loadu_si128((const __m128i *)(dst + x));
+        __m128i skip = _mm_cmpeq_epi32(rgb, _mm_setzero_si128());
+        _mm_storeu_si128((__m128i *)(dst + x), _mm_or_si128(_mm_and_si128(skip, old), _mm_andnot_si128(skip, rgb)));
+    }
+#elif defined(PIX24_NEON)
+    for (; x + 4 <= w; x += 4) {
+        int32x4_t rgb = vld1q_s32(src + x);
+        uint32x4_t skip = vceqq_s32(rgb, vdupq_n_s32(0));
+        vst1q_s32(dst + x, vbslq_s32(skip, vld1q_s32(dst + x), rgb));
+    }
+#elif defined(PIX24_WASM)
+    for (; x + 4 <= w; x += 4) {
+        v128_t rgb = wasm_v128_load(src + x);
+        v128_t skip = wasm_i32x4_eq(rgb, wasm_i32x4_splat(0));
+        wasm_v128_store(dst + x, wasm_v128_bitselect(wasm_v128_load(dst + x), rgb, skip));
+    }
+#endif
+    for (; x < w; x++) {
+        if (src[x] != 0) {
+            dst[x] = src[x];
+        }
+    }
+}
+
+static void pix24_copy_row_masked(int *dst, const int *src, const int8_t *mask, int w) {
+    int x = 0;
+#if defined(PIX24_SSE2)
+    for (; x + 4 <= w; x += 4) {
+        __m128i rgb = _mm_loadu_si128((const __m128i *)(src + x));
+        __m128i old = _mm_loadu_si128((const __m128i *)(dst + x));
+        __m128i masked = _mm_set_epi32(mask[x + 3], mask[x + 2], mask[x + 1], mask[x]);
+        __m128i skip = _mm_or_si128(_mm_cmpeq_epi32(rgb, _mm_setzero_si128()), _mm_xor_si128(_mm_cmpeq_epi32(masked, _mm_setzero_si128()), _mm_set1_epi32(-1)));
+        _mm_storeu_si128((__m128i *)(dst + x), _mm_or_si128(_mm_and_si128(skip, old), _mm_andnot_si128(skip, rgb)));
+    }
+#elif defined(PIX24_NEON)
+    for (; x + 4 <= w; x += 4) {
+        int32x4_t rgb = vld1q_s32(src + x);
+        int32_t lanes[4] = {mask[x], mask[x + 1], mask[x + 2], mask[x + 3]};
+        uint32x4_t skip = vorrq_u32(vceqq_s32(rgb, vdupq_n_s32(0)), vmvnq_u32(vceqq_s32(vld1q_s32(lanes), vdupq_n_s32(0))));
+        vst1q_s32(dst + x, vbslq_s32(skip, vld1q_s32(dst + x), rgb));
+    }
+#elif defined(PIX24_WASM)
+    for (; x + 4 <= w; x += 4) {
+        v128_t rgb = wasm_v128_load(src + x);
+        v128_t masked = wasm_i32x4_make(mask[x], mask[x + 1], mask[x + 2], mask[x + 3]);
+        v128_t skip = wasm_v128_or(wasm_i32x4_eq(rgb, wasm_i32x4_splat(0)), wasm_i32x4_ne(masked, wasm_i32x4_splat(0)));
+        wasm_v128_store(dst + x, wasm_v128_bitselect(wasm_v128_load(dst + x), rgb, skip));
+    }
+#endif
+    for (; x < w; x++) {
+        if (src[x] != 0 && mask[x] == 0) {
+            dst[x] = src[x];
+        }
+    }
+}
+
+static void pix24_blend_row(int *dst, const int *src, int w, int alpha) {
+    int invAlpha = 256 - alpha;
+    int x = 0;
+#if defined(PIX24_SSE2)
+    __m128i a16 = _mm_set1_epi16((short)alpha);
+    __m128i ia16 = _mm_set1_epi16((short)invAlpha);
+    __m128i rbMask = _mm_set1_epi32(0xff00ff);
+    __m128i gMask = _mm_set1_epi32(0xff);
+    for (; x + 4 <= w; x += 4) {
+        __m128i rgb = _mm_loadu_si128((const __m128i *)(src + x));
+        __m128i old = _mm_loadu_si128((const __m128i *)(dst + x));
+        __m128i rb = _mm_add_epi16(_mm_mullo_epi16(_mm_and_si128(rgb, rbMask), a16), _mm_mullo_epi16(_mm_and_si128(old, rbMask), ia16));
+        __m128i g = _mm_add_epi16(_mm_mullo_epi16(_mm_and_si128(_mm_srli_epi32(rgb, 8), gMask), a16), _mm_mullo_epi16(_mm_and_si128(_mm_srli_epi32(old, 8), gMask), ia16));
+        __m128i blended = _mm_or_si128(_mm_srli_epi16(rb, 8), _mm_slli_epi32(_mm_srli_epi16(g, 8), 8));
+        __m128i skip = _mm_cmpeq_epi32(rgb, _mm_setzero_si128());
+        _mm_storeu_si128((__m128i *)(dst + x), _mm_or_si128(_mm_and_si128(skip, old), _mm_andnot_si128(skip, blended)));
+    }
+#elif defined(PIX24_NEON)
+    uint16x8_t a16 = vdupq_n_u16((uint16_t)alpha);
+    uint16x8_t ia16 = vdupq_n_u16((uint16_t)invAlpha);
+    uint32x4_t rbMask = vdupq_n_u32(0xff00ff);
+    uint32x4_t gMask = vdupq_n_u32(0xff);
+    for (; x + 4 <= w; x += 4) {
+        uint32x4_t rgb = vld1q_u32((const uint32_t *)src + x);
+        uint32x4_t old = vld1q_u32((const uint32_t *)dst + x);
+        uint16x8_t rb = vmlaq_u16(vmulq_u16(vreinterpretq_u16_u32(vandq_u32(rgb, rbMask)), a16), vreinterpretq_u16_u32(vandq_u32(old, rbMask)), ia16);
+        uint16x8_t g = vmlaq_u16(vmulq_u16(vreinterpretq_u16_u32(vandq_u32(vshrq_n_u32(rgb, 8), gMask)), a16), vreinterpretq_u16_u32(vandq_u32(vshrq_n_u32(old, 8), gMask)), ia16);
+        uint32x4_t blended = vorrq_u32(vreinterpretq_u32_u16(vshrq_n_u16(rb, 8)), vshlq_n_u32(vreinterpretq_u32_u16(vshrq_n_u16(g, 8)), 8));
+        uint32x4_t skip = vceqq_u32(rgb, vdupq_n_u32(0));
+        vst1q_u32((uint32_t *)dst + x, vbslq_u32(skip, old, blended));
+    }
+#elif defined(PIX24_WASM)
+    v128_t a16 = wasm_i16x8_splat((int16_t)alpha);
+    v128_t ia16 = wasm_i16x8_splat((int16_t)invAlpha);
+    v128_t rbMask = wasm_i32x4_splat(0xff00ff);
+    v128_t gMask = wasm_i32x4_splat(0xff);
+    for (; x + 4 <= w; x += 4) {
+        v128_t rgb = wasm_v128_load(src + x);
+        v128_t old = wasm_v128_load(dst + x);
+        v128_t rb = wasm_i16x8_add(wasm_i16x8_mul(wasm_v128_and(rgb, rbMask), a16), wasm_i16x8_mul(wasm_v128_and(old, rbMask), ia16));
+        v128_t g = wasm_i16x8_add(wasm_i16x8_mul(wasm_v128_and(wasm_u32x4_shr(rgb, 8), gMask), a16), wasm_i16x8_mul(wasm_v128_and(wasm_u32x4_shr(old, 8), gMask), ia16));
+        v128_t blended = wasm_v128_or(wasm_u16x8_shr(rb, 8), wasm_i32x4_shl(wasm_u16x8_shr(g, 8), 8));
+        v128_t skip = wasm_i32x4_eq(rgb, wasm_i32x4_splat(0));
+        wasm_v128_store(dst + x, wasm_v128_bitselect(old, blended, skip));
+    }
+#endif
+    for (; x < w; x++) {
+        if (src[x] != 0) {
+            dst[x] = pix24_blend(src[x], dst[x], alpha, invAlpha);
+        }
+    }
+}
+
 Pix24 *pix24_new(int width, int height, bool use_allocator) {
     Pix24 *pix24 = rs2_calloc(use_allocator, 1, sizeof(Pix24));
     pix24->pixels = rs2_calloc(use_allocator, width * height, sizeof(int));
@@ -34,17 +169,21 @@ Pix24 *pix24_new(int width, int height, bool use_allocator) {
 }
 
 void pix24_free(Pix24 *pix24) {
+    free(pix24->spans);
     free(pix24->pixels);
     free(pix24);
 }
 
 Pix24 *pix24_from_jpeg(Jagfile *jag, const char *name) {
-    const int id = jagfile_read(jag, name);
-    int8_t *data = jagfile_read_index(jag, id);
+    int length = 0;
+    const int8_t *data = jagfile_borrow(jag, name, &length);
+    if (!data) {
+        rs2_error("Error converting jpg");
+        return NULL;
+    }
 
     int x, y, n;
-    unsigned char *jpeg_data = stbi_load_from_memory((unsigned char *)data, jag->file_unpacked_size[id], &x, &y, &n, 0);
-    free(data);
+    unsigned char *jpeg_data = stbi_load_from_memory((const unsigned char *)data, length, &x, &y, &n, 0);
     if (!jpeg_data) {
         rs2_error("Error converting jpg");
         return NULL;
@@ -73,8 +212,15 @@ Pix24 *pix24_from_archive(Jagfile *jag, const char *name, int index) {
     char *filename = calloc(name_length, sizeof(char));
     snprintf(filename, name_length, "%s.dat", name);
 
-    Packet *dat = jagfile_to_packet(jag, filename);
-    Packet *idx = jagfile_to_packet(jag, "index.dat");
+    // custom: views into the archive, index.dat is read again for every sprite in it
+    Packet dat_view;
+    Packet idx_view;
+    if (!jagfile_view_packet(jag, filename, &dat_view) || !jagfile_view_packet(jag, "index.dat", &idx_view)) {
+        free(filename);
+        return NULL;
+    }
+    Packet *dat = &dat_view;
+    Packet *idx = &idx_view;
 
     idx->pos = g2(dat);
     Pix24 *pix24 = calloc(1, sizeof(Pix24));
@@ -102,8 +248,6 @@ Pix24 *pix24_from_archive(Jagfile *jag, const char *name, int index) {
         // rs2_error("pix24 info %i %i %i %i\n", dat->pos, dat->length, idx->pos, idx->length);
         free(palette);
         free(filename);
-        packet_free(dat);
-        packet_free(idx);
         free(pix24);
         return NULL;
     }
@@ -129,8 +273,6 @@ Pix24 *pix24_from_archive(Jagfile *jag, const char *name, int index) {
     }
     free(palette);
     free(filename);
-    packet_free(dat);
-    packet_free(idx);
     return pix24;
 }
 
@@ -238,10 +380,90 @@ void pix24_copy_pixels(int w, int h, int *src, int srcOff, int srcStep, int *dst
     }
 }
 
+int pix24_pack_spans(Pix24 *pix24, bool use_allocator) {
+    int w = pix24->width;
+    int h = pix24->height;
+    int count = h;
+    for (int i = 0; i < w * h; i++) {
+        if (pix24->pixels[i] != 0 && (i % w == 0 || pix24->pixels[i - 1] == 0)) {
+            count += 2;
+        }
+    }
+
+    int16_t *spans = rs2_malloc(use_allocator, count * (int)sizeof(int16_t));
+    if (!spans) {
+        return 0;
+    }
+    int16_t *out = spans;
+    for (int y = 0; y < h; y++) {
+        const int *row = pix24->pixels + y * w;
+        int16_t *runs = out++;
+        *runs = 0;
+        for (int x = 0; x < w;) {
+            if (row[x] == 0) {
+                x++;
+                continue;
+            }
+            int start = x;
+            while (x < w && row[x] != 0) {
+                x++;
+            }
+            *out++ = (int16_t)start;
+            *out++ = (int16_t)(x - start);
+            (*runs)++;
+        }
+    }
+    pix24->spans = spans;
+    return count * (int)sizeof(int16_t);
+}
+
+// pix24_draw (alpha 256) or pix24_draw_alpha of a packed sprite: each opaque run
+// clipped to the bounds and copied or blended whole, the transparent ones never read
+static void pix24_draw_spans(Pix24 *pix24, int x, int y, int alpha) {
+    const int16_t *spans = pix24->spans;
+    int w = pix24->width;
+    int h = pix24->height;
+    int left = _Pix2D.left - x;
+    int right = _Pix2D.right - x;
+    int first = _Pix2D.top - y > 0 ? _Pix2D.top - y : 0;
+    int last = _Pix2D.bottom - y < h ? _Pix2D.bottom - y : h;
+    if (left >= w || right <= 0 || first >= last) {
+        return;
+    }
+
+    for (int row = 0; row < first; row++) {
+        spans += 1 + *spans * 2;
+    }
+    for (int row = first; row < last; row++) {
+        const int *src = pix24->pixels + row * w;
+        int *dst = _Pix2D.pixels + x + (y + row) * _Pix2D.width;
+        for (int runs = *spans++; runs > 0; runs--, spans += 2) {
+            int start = spans[0];
+            int end = start + spans[1];
+            if (start < left) {
+                start = left;
+            }
+            if (end > right) {
+                end = right;
+            }
+            if (start < end && alpha == 256) {
+                memcpy(dst + start, src + start, (end - start) * sizeof(int));
+            } else if (start < end) {
+                pix24_blend_row(dst + start, src + start, end - start, alpha);
+            }
+        }
+    }
+}
+
 void pix24_draw(Pix24 *pix24, int x, int y) {
     x += pix24->crop_x;
     y += pix24->crop_y;
 
+    if (pix24->spans) {
+        pix24_draw_spans(pix24, x, y, 256);
+        return;
+    }
+
     int dstOff = x + y * _Pix2D.width;
     int srcOff = 0;
     int h = pix24->height;
@@ -284,51 +506,10 @@ void pix24_draw(Pix24 *pix24, int x, int y) {
 }
 
 void pix24_copy_pixels2(int *dst, int *src, int srcOff, int dstOff, int w, int h, int dstStep, int srcStep) {
-    int qw = -(w >> 2);
-    w = -(w & 0x3);
-
     for (int y = -h; y < 0; y++) {
-        for (int x = qw; x < 0; x++) {
-            int rgb = src[srcOff++];
-            if (rgb == 0) {
-                dstOff++;
-            } else {
-                dst[dstOff++] = rgb;
-            }
-
-            rgb = src[srcOff++];
-            if (rgb == 0) {
-                dstOff++;
-            } else {
-                dst[dstOff++] = rgb;
-            }
-
-            rgb = src[srcOff++];
-            if (rgb == 0) {
-                dstOff++;
-            } else {
-                dst[dstOff++] = rgb;
-            }
-
-            rgb = src[srcOff++];
-            if (rgb == 0) {
-                dstOff++;
-            } else {
-                dst[dstOff++] = rgb;
-            }
-        }
-
-        for (int x = w; x < 0; x++) {
-            int rgb = src[srcOff++];
-            if (rgb == 0) {
-                dstOff++;
-            } else {
-                dst[dstOff++] = rgb;
-            }
-        }
-
-        dstOff += dstStep;
-        srcOff += srcStep;
+        pix24_copy_row(dst + dstOff, src + srcOff, w);
+        dstOff += w + dstStep;
+        srcOff += w + srcStep;
     }
 }
 
@@ -430,6 +611,11 @@ void pix24_draw_alpha(Pix24 *pix24, int alpha, int x, int y) {
     x += pix24->crop_x;
     y += pix24->crop_y;
 
+    if (pix24->spans) {
+        pix24_draw_spans(pix24, x, y, alpha);
+        return;
+    }
+
     int dstStep = x + y * _Pix2D.width;
     int srcStep = 0;
     int h = pix24->height;
@@ -472,21 +658,10 @@ void pix24_draw_alpha(Pix24 *pix24, int alpha, int x, int y) {
 }
 
 void pix24_copy_pixels_alpha(int w, int h, int *src, int srcOff, int srcStep, int *dst, int dstOff, int dstStep, int alpha) {
-    int invAlpha = 256 - alpha;
-
     for (int y = -h; y < 0; y++) {
-        for (int x = -w; x < 0; x++) {
-            int rgb = src[srcOff++];
-            if (rgb == 0) {
-                dstOff++;
-            } else {
-                int dstRgb = dst[dstOff];
-                dst[dstOff++] = (((rgb & 0xff00ff) * alpha + (dstRgb & 0xff00ff) * invAlpha & 0xff00ff00) + ((rgb & 0xff00) * alpha + (dstRgb & 0xff00) * invAlpha & 0xff0000)) >> 8;
-            }
-        }
-
-        dstOff += dstStep;
-        srcOff += srcStep;
+        pix24_blend_row(dst + dstOff, src + srcOff, w, alpha);
+        dstOff += w + dstStep;
+        srcOff += w + srcStep;
     }
 }
 
@@ -570,50 +745,9 @@ void pix24_draw_masked(Pix24 *pix24, int x, int y, Pix8 *mask) {
 }
 
 void pix24_copy_pixels_masked(int w, int h, int *src, int srcStep, int srcOff, int *dst, int dstOff, int dstStep, int8_t *mask) {
-    int qw = -(w >> 2);
-    w = -(w & 0x3);
-
     for (int y = -h; y < 0; y++) {
-        for (int x = qw; x < 0; x++) {
-            int rgb = src[srcOff++];
-            if (rgb != 0 && mask[dstOff] == 0) {
-                dst[dstOff++] = rgb;
-            } else {
-                dstOff++;
-            }
-
-            rgb = src[srcOff++];
-            if (rgb != 0 && mask[dstOff] == 0) {
-                dst[dstOff++] = rgb;
-            } else {
-                dstOff++;
-            }
-
-            rgb = src[srcOff++];
-            if (rgb != 0 && mask[dstOff] == 0) {
-                dst[dstOff++] = rgb;
-            } else {
-                dstOff++;
-            }
-
-            rgb = src[srcOff++];
-            if (rgb != 0 && mask[dstOff] == 0) {
-                dst[dstOff++] = rgb;
-            } else {
-                dstOff++;
-            }
-        }
-
-        for (int x = w; x < 0; x++) {
-            int rgb = src[srcOff++];
-            if (rgb != 0 && mask[dstOff] == 0) {
-                dst[dstOff++] = rgb;
-            } else {
-                dstOff++;
-            }
-        }
-
-        dstOff += dstStep;
-        srcOff += srcStep;
+        pix24_copy_row_masked(dst + dstOff, src + srcOff, mask + dstOff, w);
+        dstOff += w + dstStep;
+        srcOff += w + srcStep;
     }
 }
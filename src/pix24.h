@@ -12,6 +12,8 @@ typedef struct {
     int crop_y;
     int crop_w;
     int crop_h;
+    // opaque runs row by row (pix24_pack_spans): run count, then start and length of each
+    int16_t *spans;
 } Pix24;
 
 Pix24 *pix24_new(int width, int height, bool use_allocator);
@@ -23,6 +25,9 @@ void pix24_translate(Pix24 *pix24, int r, int g, int b);
 void pix24_blit_opaque(Pix24 *pix24, int x, int y);
 void pix24_copy_pixels(int w, int h, int *src, int srcOff, int srcStep, int *dst, int dstOff, int dstStep);
 void pix24_draw(Pix24 *pix24, int x, int y);
+// pack the opaque runs of a sprite whose pixels are final, so pix24_draw copies
+// run by run instead of testing every pixel; returns the bytes they take
+int pix24_pack_spans(Pix24 *pix24, bool use_allocator);
 void pix24_copy_pixels2(int *dst, int *src, int srcOff, int dstOff, int w, int h, int dstStep, int srcStep);
 void pix24_crop(Pix24 *pix24, int x, int y, int w, int h);
 void pix24_scale(int w, int h, int *src, int offW, int offH, int *dst, int dstStep, int dstOff, int currentW, int scaleCropWidth, int scaleCropHeight);
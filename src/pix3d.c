@@ -1,18 +1,23 @@
+#include <limits.h>
 #include <math.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "pix3d.h"
+#include "pix3d_bin.h"
+#include "pix3d_gpu.h"
+#include "pix3d_span.h"
 #include "pix8.h"
 #include "platform.h"
 
 Pix3D _Pix3D = {.lowMemory = true, .jagged = true};
 extern Pix2D _Pix2D;
 
-static void gouraudRaster(int x0, int x1, int color0, int color1, int *dst, int offset, int length);
-static void flatRaster(int x0, int x1, int *dst, int offset, int rgb);
-static void textureRaster(int xA, int xB, int *dst, int offset, int *texels, int curU, int curV, int u, int v, int w, int uStride, int vStride, int wStride, int shadeA, int shadeB);
+static void gouraudRaster(const Pix3DRaster *r, int x0, int x1, int color0, int color1, int *dst, int offset, int length);
+static void flatRaster(const Pix3DRaster *r, int x0, int x1, int *dst, int offset, int rgb);
+static void textureRaster(const Pix3DRaster *r, int xA, int xB, int *dst, int offset, int *texels, int curU, int curV, int u, int v, int w, int uStride, int vStride, int wStride, int shadeA, int shadeB);
 
 void pix3d_init_global(void) {
     _Pix3D.reciprical15 = malloc(512 * sizeof(int));
@@ -36,9 +41,15 @@ void pix3d_init_global(void) {
     _Pix3D.textureHasTransparency = calloc(50, sizeof(bool));
     _Pix3D.textureColors = calloc(50, sizeof(int));
     _Pix3D.activeTexels = calloc(50, sizeof(int *));
+    _Pix3D.texelScroll = calloc(50, sizeof(int));
     _Pix3D.textureCycle = calloc(50, sizeof(int));
+    _Pix3D.textureLruPrev = calloc(50, sizeof(int));
+    _Pix3D.textureLruNext = calloc(50, sizeof(int));
+    _Pix3D.textureLruHead = -1;
+    _Pix3D.textureLruTail = -1;
     _Pix3D.palette = calloc(65536, sizeof(int));
     _Pix3D.texturePalettes = calloc(50, sizeof(int *));
+    pix3d_spans_init();
 }
 
 void pix3d_free_global(void) {
@@ -55,6 +66,7 @@ void pix3d_free_global(void) {
     free(_Pix3D.textures);
     free(_Pix3D.texturePalettes);
     free(_Pix3D.activeTexels);
+    free(_Pix3D.texelScroll);
     free(_Pix3D.reciprical15);
     free(_Pix3D.reciprical16);
     free(_Pix3D.sin_table);
@@ -62,6 +74,8 @@ void pix3d_free_global(void) {
     free(_Pix3D.textureHasTransparency);
     free(_Pix3D.textureColors);
     free(_Pix3D.textureCycle);
+    free(_Pix3D.textureLruPrev);
+    free(_Pix3D.textureLruNext);
     free(_Pix3D.palette);
 }
 
@@ -83,7 +97,40 @@ void pix3d_init3d(int width, int height) {
     _Pix3D.center_y = height / 2;
 }
 
+// the LRU list holds exactly the textures with activeTexels set
+static void pix3d_texel_unlink(int id) {
+    int prev = _Pix3D.textureLruPrev[id];
+    int next = _Pix3D.textureLruNext[id];
+    if (prev == -1) {
+        _Pix3D.textureLruHead = next;
+    } else {
+        _Pix3D.textureLruNext[prev] = next;
+    }
+    if (next == -1) {
+        _Pix3D.textureLruTail = prev;
+    } else {
+        _Pix3D.textureLruPrev[next] = prev;
+    }
+}
+
+static void pix3d_texel_link_head(int id) {
+    _Pix3D.textureLruPrev[id] = -1;
+    _Pix3D.textureLruNext[id] = _Pix3D.textureLruHead;
+    if (_Pix3D.textureLruHead == -1) {
+        _Pix3D.textureLruTail = id;
+    } else {
+        _Pix3D.textureLruPrev[_Pix3D.textureLruHead] = id;
+    }
+    _Pix3D.textureLruHead = id;
+}
+
 void pix3d_clear_texels(void) {
+    // texels only depend on the texture and its palette, so with memory to
+    // spare they are kept for the next scene instead of freed and rebuilt
+    if (!_Pix3D.lowMemory && _Pix3D.texelPool) {
+        return;
+    }
+
     for (int i = 0; i < _Pix3D.poolSize; i++) {
         free(_Pix3D.texelPool[i]);
         _Pix3D.texelPool[i] = NULL;
@@ -95,6 +142,8 @@ void pix3d_clear_texels(void) {
         free(_Pix3D.activeTexels[i]);
         _Pix3D.activeTexels[i] = NULL;
     }
+    _Pix3D.textureLruHead = -1;
+    _Pix3D.textureLruTail = -1;
 }
 
 void pix3d_init_pool(int size) {
@@ -116,6 +165,8 @@ void pix3d_init_pool(int size) {
     for (int i = 0; i < 50; i++) {
         _Pix3D.activeTexels[i] = NULL;
     }
+    _Pix3D.textureLruHead = -1;
+    _Pix3D.textureLruTail = -1;
 }
 
 void pix3d_unpack_textures(Jagfile *jag) {
@@ -158,15 +209,94 @@ int pix3d_get_average_texture_rgb(int id) {
 }
 
 void pix3d_push_texture(int id) {
+    pix3d_gpu_texture_changed(id);
     if (_Pix3D.activeTexels[id]) {
+        pix3d_texel_unlink(id);
         _Pix3D.texelPool[_Pix3D.poolSize++] = _Pix3D.activeTexels[id];
         _Pix3D.activeTexels[id] = NULL;
     }
 }
 
+void pix3d_scroll_texture(int id, int rows) {
+    int *texels = _Pix3D.activeTexels[id];
+    if (!texels) {
+        return;
+    }
+
+    // the texels are a per-pixel function of the texture, so scrolling its
+    // pixels by whole texel rows is the same as reading the texels that many
+    // rows back: the spans add texelScroll to v and the texels stay put.
+    // Only rebuild when rows don't map onto whole texel rows
+    Pix8 *texture = _Pix3D.textures[id];
+    int size = _Pix3D.lowMemory ? 64 : 128;
+    int scale = size / texture->width;
+    if (scale < 1 || texture->width * scale != size || texture->height * scale != size) {
+        pix3d_push_texture(id);
+        return;
+    }
+
+    _Pix3D.texelScroll[id] = (_Pix3D.texelScroll[id] - rows * scale * size) & (size * size - 1);
+}
+
+// a palette colour and its three darker copies, as the 4 texel planes hold them
+static void pix3d_shade_texel(int rgb, int *shade) {
+    rgb &= 0xf8f8ff;
+    shade[0] = rgb;
+    shade[1] = rgb - ((uint32_t)rgb >> 3) & 0xf8f8ff;
+    shade[2] = rgb - ((uint32_t)rgb >> 2) & 0xf8f8ff;
+    shade[3] = rgb - ((uint32_t)rgb >> 2) - ((uint32_t)rgb >> 3) & 0xf8f8ff;
+}
+
+static void pix3d_expand_texels(int id, int *texels) {
+    Pix8 *texture = _Pix3D.textures[id];
+    int *palette = _Pix3D.texturePalettes[id];
+
+    // shade each palette entry once rather than each texel
+    int shades[256][4];
+    int count = texture->palette_count < 256 ? texture->palette_count : 256;
+    for (int i = 0; i < count; i++) {
+        pix3d_shade_texel(palette[i], shades[i]);
+    }
+
+    int plane = _Pix3D.lowMemory ? 4096 : 16384;
+    int spare[4];
+    bool transparent = false;
+    for (int i = 0; i < plane; i++) {
+        int pixel;
+        if (_Pix3D.lowMemory || texture->width != 64) {
+            pixel = texture->pixels[i];
+        } else {
+            pixel = texture->pixels[((i & 0x7f) >> 1) + (i >> 8 << 6)];
+        }
+
+        const int *shade;
+        if (pixel >= 0 && pixel < count) {
+            shade = shades[pixel];
+        } else {
+            pix3d_shade_texel(palette[pixel], spare);
+            shade = spare;
+        }
+        if (shade[0] == 0) {
+            transparent = true;
+        }
+        texels[i] = shade[0];
+        texels[i + plane] = shade[1];
+        texels[i + plane * 2] = shade[2];
+        texels[i + plane * 3] = shade[3];
+    }
+    _Pix3D.textureHasTransparency[id] = transparent;
+    // built from the pixels as scrolled so far
+    _Pix3D.texelScroll[id] = 0;
+    pix3d_gpu_texture_changed(id);
+}
+
 static int *pix3d_get_texels(int id) {
     _Pix3D.textureCycle[id] = _Pix3D.cycle++;
     if (_Pix3D.activeTexels[id]) {
+        if (_Pix3D.textureLruHead != id) {
+            pix3d_texel_unlink(id);
+            pix3d_texel_link_head(id);
+        }
         return _Pix3D.activeTexels[id];
     }
     int *texels;
@@ -174,55 +304,15 @@ static int *pix3d_get_texels(int id) {
         texels = _Pix3D.texelPool[--_Pix3D.poolSize];
         _Pix3D.texelPool[_Pix3D.poolSize] = NULL;
     } else {
-        int cycle = 0;
-        int selected = -1;
-        for (int t = 0; t < _Pix3D.textureCount; t++) {
-            if (_Pix3D.activeTexels[t] && (_Pix3D.textureCycle[t] < cycle || selected == -1)) {
-                cycle = _Pix3D.textureCycle[t];
-                selected = t;
-            }
-        }
+        // the list tail is the least recently used (lowest textureCycle)
+        int selected = _Pix3D.textureLruTail;
+        pix3d_texel_unlink(selected);
         texels = _Pix3D.activeTexels[selected];
         _Pix3D.activeTexels[selected] = NULL;
     }
     _Pix3D.activeTexels[id] = texels;
-    Pix8 *texture = _Pix3D.textures[id];
-    int *palette = _Pix3D.texturePalettes[id];
-    if (_Pix3D.lowMemory) {
-        _Pix3D.textureHasTransparency[id] = false;
-        for (int i = 0; i < 4096; i++) {
-            int rgb = texels[i] = palette[texture->pixels[i]] & 0xf8f8ff;
-            if (rgb == 0) {
-                _Pix3D.textureHasTransparency[id] = true;
-            }
-            texels[i + 4096] = rgb - ((uint32_t)rgb >> 3) & 0xf8f8ff;
-            texels[i + 8192] = rgb - ((uint32_t)rgb >> 2) & 0xf8f8ff;
-            texels[i + 12288] = rgb - ((uint32_t)rgb >> 2) - ((uint32_t)rgb >> 3) & 0xf8f8ff;
-        }
-    } else {
-        if (texture->width == 64) {
-            for (int y = 0; y < 128; y++) {
-                for (int x = 0; x < 128; x++) {
-                    texels[x + (y << 7)] = palette[texture->pixels[(x >> 1) + (y >> 1 << 6)]];
-                }
-            }
-        } else {
-            for (int i = 0; i < 16384; i++) {
-                texels[i] = palette[texture->pixels[i]];
-            }
-        }
-        _Pix3D.textureHasTransparency[id] = false;
-        for (int i = 0; i < 16384; i++) {
-            texels[i] &= 0xf8f8ff;
-            int rgb = texels[i];
-            if (rgb == 0) {
-                _Pix3D.textureHasTransparency[id] = true;
-            }
-            texels[i + 16384] = rgb - ((uint32_t)rgb >> 3) & 0xf8f8ff;
-            texels[i + 32768] = rgb - ((uint32_t)rgb >> 2) & 0xf8f8ff;
-            texels[i + 49152] = rgb - ((uint32_t)rgb >> 2) - ((uint32_t)rgb >> 3) & 0xf8f8ff;
-        }
-    }
+    pix3d_texel_link_head(id);
+    pix3d_expand_texels(id, texels);
     return texels;
 }
 
@@ -289,6 +379,7 @@ void pix3d_set_brightness(double brightness) {
             _Pix3D.palette[offset++] = rgbAdjusted;
         }
     }
+    pix3d_gpu_palette_changed();
     for (int id = 0; id < 50; id++) {
         if (_Pix3D.textures[id]) {
             int palette_count = _Pix3D.textures[id]->palette_count;
@@ -333,7 +424,62 @@ int pix3d_set_gamma(int rgb, double gamma) {
 }
 #endif
 
+/*
+ * raster_now - State of a triangle drawn right away, on every row
+ */
+static Pix3DRaster raster_now(void) {
+    Pix3DRaster r = {_Pix3D.alpha, _Pix3D.clipX, _Pix3D.opaque, _Pix3D.scroll, INT_MIN, INT_MAX};
+    return r;
+}
+
 void gouraudTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int colorA, int colorB, int colorC) {
+    if (g_pix3d_gpu) {
+        pix3d_gpu_gouraud(xA, xB, xC, yA, yB, yC, colorA, colorB, colorC);
+        return;
+    }
+    if (g_pix3d_binning) {
+        pix3d_bin_gouraud(xA, xB, xC, yA, yB, yC, colorA, colorB, colorC);
+        return;
+    }
+    Pix3DRaster r = raster_now();
+    pix3d_draw_gouraud(&r, xA, xB, xC, yA, yB, yC, colorA, colorB, colorC);
+}
+
+void flatTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int color) {
+    if (g_pix3d_gpu) {
+        pix3d_gpu_flat(xA, xB, xC, yA, yB, yC, color);
+        return;
+    }
+    if (g_pix3d_binning) {
+        pix3d_bin_flat(xA, xB, xC, yA, yB, yC, color);
+        return;
+    }
+    Pix3DRaster r = raster_now();
+    pix3d_draw_flat(&r, xA, xB, xC, yA, yB, yC, color);
+}
+
+void textureTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int shadeA, int shadeB, int shadeC, int originX, int originY, int originZ, int txB, int txC, int tyB, int tyC, int tzB, int tzC, int texture) {
+    /* Loading texels now would evict a buffer recorded faces still use */
+    if (g_pix3d_binning && !_Pix3D.activeTexels[texture] && _Pix3D.poolSize == 0) {
+        pix3d_bin_flush();
+    }
+    int *texels = pix3d_get_texels(texture);
+    _Pix3D.opaque = !_Pix3D.textureHasTransparency[texture];
+    _Pix3D.scroll = _Pix3D.texelScroll[texture];
+
+    if (g_pix3d_gpu) {
+        pix3d_gpu_texture(xA, xB, xC, yA, yB, yC, shadeA, shadeB, shadeC, originX, originY, originZ, txB, txC, tyB, tyC, tzB, tzC, texture, texels);
+        return;
+    }
+    if (g_pix3d_binning) {
+        pix3d_bin_texture(xA, xB, xC, yA, yB, yC, shadeA, shadeB, shadeC, originX, originY, originZ, txB, txC, tyB, tyC, tzB, tzC, texels);
+        return;
+    }
+    Pix3DRaster r = raster_now();
+    pix3d_draw_texture(&r, xA, xB, xC, yA, yB, yC, shadeA, shadeB, shadeC, originX, originY, originZ, txB, txC, tyB, tyC, tzB, tzC, texels);
+}
+
+void pix3d_draw_gouraud(const Pix3DRaster *r, int xA, int xB, int xC, int yA, int yB, int yC, int colorA, int colorB, int colorC) {
     int dxAB = xB - xA;
     int dyAB = yB - yA;
     int dxAC = xC - xA;
@@ -400,16 +546,16 @@ void gouraudTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int colorA,
                     yB -= yA;
                     yA = _Pix3D.line_offset[yA];
 
-                    while (--yB >= 0) {
-                        gouraudRaster(xC >> 16, xA >> 16, colorC >> 7, colorA >> 7, _Pix2D.pixels, yA, 0);
+                    while (--yB >= 0 && yA < r->bottom) {
+                        gouraudRaster(r, xC >> 16, xA >> 16, colorC >> 7, colorA >> 7, _Pix2D.pixels, yA, 0);
                         xC += xStepAC;
                         xA += xStepAB;
                         colorC += colorStepAC;
                         colorA += colorStepAB;
                         yA += _Pix2D.width;
                     }
-                    while (--yC >= 0) {
-                        gouraudRaster(xC >> 16, xB >> 16, colorC >> 7, colorB >> 7, _Pix2D.pixels, yA, 0);
+                    while (--yC >= 0 && yA < r->bottom) {
+                        gouraudRaster(r, xC >> 16, xB >> 16, colorC >> 7, colorB >> 7, _Pix2D.pixels, yA, 0);
                         xC += xStepAC;
                         xB += xStepBC;
                         colorC += colorStepAC;
@@ -421,16 +567,16 @@ void gouraudTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int colorA,
                     yB -= yA;
                     yA = _Pix3D.line_offset[yA];
 
-                    while (--yB >= 0) {
-                        gouraudRaster(xA >> 16, xC >> 16, colorA >> 7, colorC >> 7, _Pix2D.pixels, yA, 0);
+                    while (--yB >= 0 && yA < r->bottom) {
+                        gouraudRaster(r, xA >> 16, xC >> 16, colorA >> 7, colorC >> 7, _Pix2D.pixels, yA, 0);
                         xC += xStepAC;
                         xA += xStepAB;
                         colorC += colorStepAC;
                         colorA += colorStepAB;
                         yA += _Pix2D.width;
                     }
-                    while (--yC >= 0) {
-                        gouraudRaster(xB >> 16, xC >> 16, colorB >> 7, colorC >> 7, _Pix2D.pixels, yA, 0);
+                    while (--yC >= 0 && yA < r->bottom) {
+                        gouraudRaster(r, xB >> 16, xC >> 16, colorB >> 7, colorC >> 7, _Pix2D.pixels, yA, 0);
                         xC += xStepAC;
                         xB += xStepBC;
                         colorC += colorStepAC;
@@ -462,16 +608,16 @@ void gouraudTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int colorA,
                     yC -= yA;
                     yA = _Pix3D.line_offset[yA];
 
-                    while (--yC >= 0) {
-                        gouraudRaster(xB >> 16, xA >> 16, colorB >> 7, colorA >> 7, _Pix2D.pixels, yA, 0);
+                    while (--yC >= 0 && yA < r->bottom) {
+                        gouraudRaster(r, xB >> 16, xA >> 16, colorB >> 7, colorA >> 7, _Pix2D.pixels, yA, 0);
                         xB += xStepAC;
                         xA += xStepAB;
                         colorB += colorStepAC;
                         colorA += colorStepAB;
                         yA += _Pix2D.width;
                     }
-                    while (--yB >= 0) {
-                        gouraudRaster(xC >> 16, xA >> 16, colorC >> 7, colorA >> 7, _Pix2D.pixels, yA, 0);
+                    while (--yB >= 0 && yA < r->bottom) {
+                        gouraudRaster(r, xC >> 16, xA >> 16, colorC >> 7, colorA >> 7, _Pix2D.pixels, yA, 0);
                         xC += xStepBC;
                         xA += xStepAB;
                         colorC += colorStepBC;
@@ -483,16 +629,16 @@ void gouraudTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int colorA,
                     yC -= yA;
                     yA = _Pix3D.line_offset[yA];
 
-                    while (--yC >= 0) {
-                        gouraudRaster(xA >> 16, xB >> 16, colorA >> 7, colorB >> 7, _Pix2D.pixels, yA, 0);
+                    while (--yC >= 0 && yA < r->bottom) {
+                        gouraudRaster(r, xA >> 16, xB >> 16, colorA >> 7, colorB >> 7, _Pix2D.pixels, yA, 0);
                         xB += xStepAC;
                         xA += xStepAB;
                         colorB += colorStepAC;
                         colorA += colorStepAB;
                         yA += _Pix2D.width;
                     }
-                    while (--yB >= 0) {
-                        gouraudRaster(xA >> 16, xC >> 16, colorA >> 7, colorC >> 7, _Pix2D.pixels, yA, 0);
+                    while (--yB >= 0 && yA < r->bottom) {
+                        gouraudRaster(r, xA >> 16, xC >> 16, colorA >> 7, colorC >> 7, _Pix2D.pixels, yA, 0);
                         xC += xStepBC;
                         xA += xStepAB;
                         colorC += colorStepBC;
@@ -536,16 +682,16 @@ void gouraudTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int colorA,
                     yC -= yB;
                     yB = _Pix3D.line_offset[yB];
 
-                    while (--yC >= 0) {
-                        gouraudRaster(xA >> 16, xB >> 16, colorA >> 7, colorB >> 7, _Pix2D.pixels, yB, 0);
+                    while (--yC >= 0 && yB < r->bottom) {
+                        gouraudRaster(r, xA >> 16, xB >> 16, colorA >> 7, colorB >> 7, _Pix2D.pixels, yB, 0);
                         xA += xStepAB;
                         xB += xStepBC;
                         colorA += colorStepAB;
                         colorB += colorStepBC;
                         yB += _Pix2D.width;
                     }
-                    while (--yA >= 0) {
-                        gouraudRaster(xA >> 16, xC >> 16, colorA >> 7, colorC >> 7, _Pix2D.pixels, yB, 0);
+                    while (--yA >= 0 && yB < r->bottom) {
+                        gouraudRaster(r, xA >> 16, xC >> 16, colorA >> 7, colorC >> 7, _Pix2D.pixels, yB, 0);
                         xA += xStepAB;
                         xC += xStepAC;
                         colorA += colorStepAB;
@@ -557,16 +703,16 @@ void gouraudTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int colorA,
                     yC -= yB;
                     yB = _Pix3D.line_offset[yB];
 
-                    while (--yC >= 0) {
-                        gouraudRaster(xB >> 16, xA >> 16, colorB >> 7, colorA >> 7, _Pix2D.pixels, yB, 0);
+                    while (--yC >= 0 && yB < r->bottom) {
+                        gouraudRaster(r, xB >> 16, xA >> 16, colorB >> 7, colorA >> 7, _Pix2D.pixels, yB, 0);
                         xA += xStepAB;
                         xB += xStepBC;
                         colorA += colorStepAB;
                         colorB += colorStepBC;
                         yB += _Pix2D.width;
                     }
-                    while (--yA >= 0) {
-                        gouraudRaster(xC >> 16, xA >> 16, colorC >> 7, colorA >> 7, _Pix2D.pixels, yB, 0);
+                    while (--yA >= 0 && yB < r->bottom) {
+                        gouraudRaster(r, xC >> 16, xA >> 16, colorC >> 7, colorA >> 7, _Pix2D.pixels, yB, 0);
                         xA += xStepAB;
                         xC += xStepAC;
                         colorA += colorStepAB;
@@ -598,16 +744,16 @@ void gouraudTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int colorA,
                     yA -= yB;
                     yB = _Pix3D.line_offset[yB];
 
-                    while (--yA >= 0) {
-                        gouraudRaster(xC >> 16, xB >> 16, colorC >> 7, colorB >> 7, _Pix2D.pixels, yB, 0);
+                    while (--yA >= 0 && yB < r->bottom) {
+                        gouraudRaster(r, xC >> 16, xB >> 16, colorC >> 7, colorB >> 7, _Pix2D.pixels, yB, 0);
                         xC += xStepAB;
                         xB += xStepBC;
                         colorC += colorStepAB;
                         colorB += colorStepBC;
                         yB += _Pix2D.width;
                     }
-                    while (--yC >= 0) {
-                        gouraudRaster(xA >> 16, xB >> 16, colorA >> 7, colorB >> 7, _Pix2D.pixels, yB, 0);
+                    while (--yC >= 0 && yB < r->bottom) {
+                        gouraudRaster(r, xA >> 16, xB >> 16, colorA >> 7, colorB >> 7, _Pix2D.pixels, yB, 0);
                         xA += xStepAC;
                         xB += xStepBC;
                         colorA += colorStepAC;
@@ -619,16 +765,16 @@ void gouraudTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int colorA,
                     yA -= yB;
                     yB = _Pix3D.line_offset[yB];
 
-                    while (--yA >= 0) {
-                        gouraudRaster(xB >> 16, xC >> 16, colorB >> 7, colorC >> 7, _Pix2D.pixels, yB, 0);
+                    while (--yA >= 0 && yB < r->bottom) {
+                        gouraudRaster(r, xB >> 16, xC >> 16, colorB >> 7, colorC >> 7, _Pix2D.pixels, yB, 0);
                         xC += xStepAB;
                         xB += xStepBC;
                         colorC += colorStepAB;
                         colorB += colorStepBC;
                         yB += _Pix2D.width;
                     }
-                    while (--yC >= 0) {
-                        gouraudRaster(xB >> 16, xA >> 16, colorB >> 7, colorA >> 7, _Pix2D.pixels, yB, 0);
+                    while (--yC >= 0 && yB < r->bottom) {
+                        gouraudRaster(r, xB >> 16, xA >> 16, colorB >> 7, colorA >> 7, _Pix2D.pixels, yB, 0);
                         xA += xStepAC;
                         xB += xStepBC;
                         colorA += colorStepAC;
@@ -671,16 +817,16 @@ void gouraudTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int colorA,
                 yA -= yC;
                 yC = _Pix3D.line_offset[yC];
 
-                while (--yA >= 0) {
-                    gouraudRaster(xB >> 16, xC >> 16, colorB >> 7, colorC >> 7, _Pix2D.pixels, yC, 0);
+                while (--yA >= 0 && yC < r->bottom) {
+                    gouraudRaster(r, xB >> 16, xC >> 16, colorB >> 7, colorC >> 7, _Pix2D.pixels, yC, 0);
                     xB += xStepBC;
                     xC += xStepAC;
                     colorB += colorStepBC;
                     colorC += colorStepAC;
                     yC += _Pix2D.width;
                 }
-                while (--yB >= 0) {
-                    gouraudRaster(xB >> 16, xA >> 16, colorB >> 7, colorA >> 7, _Pix2D.pixels, yC, 0);
+                while (--yB >= 0 && yC < r->bottom) {
+                    gouraudRaster(r, xB >> 16, xA >> 16, colorB >> 7, colorA >> 7, _Pix2D.pixels, yC, 0);
                     xB += xStepBC;
                     xA += xStepAB;
                     colorB += colorStepBC;
@@ -692,16 +838,16 @@ void gouraudTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int colorA,
                 yA -= yC;
                 yC = _Pix3D.line_offset[yC];
 
-                while (--yA >= 0) {
-                    gouraudRaster(xC >> 16, xB >> 16, colorC >> 7, colorB >> 7, _Pix2D.pixels, yC, 0);
+                while (--yA >= 0 && yC < r->bottom) {
+                    gouraudRaster(r, xC >> 16, xB >> 16, colorC >> 7, colorB >> 7, _Pix2D.pixels, yC, 0);
                     xB += xStepBC;
                     xC += xStepAC;
                     colorB += colorStepBC;
                     colorC += colorStepAC;
                     yC += _Pix2D.width;
                 }
-                while (--yB >= 0) {
-                    gouraudRaster(xA >> 16, xB >> 16, colorA >> 7, colorB >> 7, _Pix2D.pixels, yC, 0);
+                while (--yB >= 0 && yC < r->bottom) {
+                    gouraudRaster(r, xA >> 16, xB >> 16, colorA >> 7, colorB >> 7, _Pix2D.pixels, yC, 0);
                     xB += xStepBC;
                     xA += xStepAB;
                     colorB += colorStepBC;
@@ -733,16 +879,16 @@ void gouraudTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int colorA,
                 yB -= yC;
                 yC = _Pix3D.line_offset[yC];
 
-                while (--yB >= 0) {
-                    gouraudRaster(xA >> 16, xC >> 16, colorA >> 7, colorC >> 7, _Pix2D.pixels, yC, 0);
+                while (--yB >= 0 && yC < r->bottom) {
+                    gouraudRaster(r, xA >> 16, xC >> 16, colorA >> 7, colorC >> 7, _Pix2D.pixels, yC, 0);
                     xA += xStepBC;
                     xC += xStepAC;
                     colorA += colorStepBC;
                     colorC += colorStepAC;
                     yC += _Pix2D.width;
                 }
-                while (--yA >= 0) {
-                    gouraudRaster(xB >> 16, xC >> 16, colorB >> 7, colorC >> 7, _Pix2D.pixels, yC, 0);
+                while (--yA >= 0 && yC < r->bottom) {
+                    gouraudRaster(r, xB >> 16, xC >> 16, colorB >> 7, colorC >> 7, _Pix2D.pixels, yC, 0);
                     xB += xStepAB;
                     xC += xStepAC;
                     colorB += colorStepAB;
@@ -754,16 +900,16 @@ void gouraudTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int colorA,
                 yB -= yC;
                 yC = _Pix3D.line_offset[yC];
 
-                while (--yB >= 0) {
-                    gouraudRaster(xC >> 16, xA >> 16, colorC >> 7, colorA >> 7, _Pix2D.pixels, yC, 0);
+                while (--yB >= 0 && yC < r->bottom) {
+                    gouraudRaster(r, xC >> 16, xA >> 16, colorC >> 7, colorA >> 7, _Pix2D.pixels, yC, 0);
                     xA += xStepBC;
                     xC += xStepAC;
                     colorA += colorStepBC;
                     colorC += colorStepAC;
                     yC += _Pix2D.width;
                 }
-                while (--yA >= 0) {
-                    gouraudRaster(xC >> 16, xB >> 16, colorC >> 7, colorB >> 7, _Pix2D.pixels, yC, 0);
+                while (--yA >= 0 && yC < r->bottom) {
+                    gouraudRaster(r, xC >> 16, xB >> 16, colorC >> 7, colorB >> 7, _Pix2D.pixels, yC, 0);
                     xB += xStepAB;
                     xC += xStepAC;
                     colorB += colorStepAB;
@@ -775,13 +921,16 @@ void gouraudTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int colorA,
     }
 }
 
-static void gouraudRaster(int x0, int x1, int color0, int color1, int *dst, int offset, int length) {
-    int rgb;
+static void gouraudRaster(const Pix3DRaster *r, int x0, int x1, int color0, int color1, int *dst, int offset, int length) {
+    /* Rows outside the band being drawn (pix3d_bin.h) */
+    if (offset < r->top || offset >= r->bottom) {
+        return;
+    }
 
     if (_Pix3D.jagged) {
         int colorStep;
 
-        if (_Pix3D.clipX) {
+        if (r->clipX) {
             if (x1 - x0 > 3) {
                 colorStep = (color1 - color0) / (x1 - x0);
             } else {
@@ -801,11 +950,8 @@ static void gouraudRaster(int x0, int x1, int color0, int color1, int *dst, int
                 return;
             }
 
-            offset += x0;
-            length = (x1 - x0) >> 2;
             colorStep <<= 2;
         } else if (x0 < x1) {
-            offset += x0;
             length = (x1 - x0) >> 2;
 
             if (length > 0) {
@@ -817,59 +963,16 @@ static void gouraudRaster(int x0, int x1, int color0, int color1, int *dst, int
             return;
         }
 
-        if (_Pix3D.alpha == 0) {
-            while (--length >= 0) {
-                rgb = _Pix3D.palette[color0 >> 8];
-                color0 += colorStep;
-
-                dst[offset++] = rgb;
-                dst[offset++] = rgb;
-                dst[offset++] = rgb;
-                dst[offset++] = rgb;
-            }
-
-            length = (x1 - x0) & 0x3;
-            if (length > 0) {
-                rgb = _Pix3D.palette[color0 >> 8];
-
-                while (--length >= 0) {
-                    dst[offset++] = rgb;
-                }
-            }
+        /* One palette entry per 4 pixels (pix3d_span.h) */
+        if (r->alpha == 0) {
+            g_pix3d_spans->jagged(dst + offset + x0, x1 - x0, color0, colorStep, _Pix3D.palette);
         } else {
-            int alpha = _Pix3D.alpha;
-            int invAlpha = 256 - _Pix3D.alpha;
-
-            while (--length >= 0) {
-                rgb = _Pix3D.palette[color0 >> 8];
-                color0 += colorStep;
-
-                rgb = ((((rgb & 0xff00ff) * invAlpha) >> 8) & 0xff00ff) + ((((rgb & 0xff00) * invAlpha) >> 8) & 0xff00);
-                dst[offset] = rgb + ((((dst[offset] & 0xff00ff) * alpha) >> 8) & 0xff00ff) + ((((dst[offset] & 0xff00) * alpha) >> 8) & 0xff00);
-                offset++;
-                dst[offset] = rgb + ((((dst[offset] & 0xff00ff) * alpha) >> 8) & 0xff00ff) + ((((dst[offset] & 0xff00) * alpha) >> 8) & 0xff00);
-                offset++;
-                dst[offset] = rgb + ((((dst[offset] & 0xff00ff) * alpha) >> 8) & 0xff00ff) + ((((dst[offset] & 0xff00) * alpha) >> 8) & 0xff00);
-                offset++;
-                dst[offset] = rgb + ((((dst[offset] & 0xff00ff) * alpha) >> 8) & 0xff00ff) + ((((dst[offset] & 0xff00) * alpha) >> 8) & 0xff00);
-                offset++;
-            }
-
-            length = (x1 - x0) & 0x3;
-            if (length > 0) {
-                rgb = _Pix3D.palette[color0 >> 8];
-                rgb = ((((rgb & 0xff00ff) * invAlpha) >> 8) & 0xff00ff) + ((((rgb & 0xff00) * invAlpha) >> 8) & 0xff00);
-
-                while (--length >= 0) {
-                    dst[offset] = rgb + ((((dst[offset] & 0xff00ff) * alpha) >> 8) & 0xff00ff) + ((((dst[offset] & 0xff00) * alpha) >> 8) & 0xff00);
-                    offset++;
-                }
-            }
+            g_pix3d_spans->jagged_blend(dst + offset + x0, x1 - x0, color0, colorStep, _Pix3D.palette, r->alpha);
         }
     } else if (x0 < x1) {
         int colorStep = (color1 - color0) / (x1 - x0);
 
-        if (_Pix3D.clipX) {
+        if (r->clipX) {
             if (x1 > _Pix2D.bound_x) {
                 x1 = _Pix2D.bound_x;
             }
@@ -884,31 +987,15 @@ static void gouraudRaster(int x0, int x1, int color0, int color1, int *dst, int
             }
         }
 
-        offset += x0;
-        length = x1 - x0;
-
-        if (_Pix3D.alpha == 0) {
-            while (--length >= 0) {
-                dst[offset++] = _Pix3D.palette[color0 >> 8];
-                color0 += colorStep;
-            }
+        if (r->alpha == 0) {
+            g_pix3d_spans->smooth(dst + offset + x0, x1 - x0, color0, colorStep, _Pix3D.palette);
         } else {
-            int alpha = _Pix3D.alpha;
-            int invAlpha = 256 - _Pix3D.alpha;
-
-            while (--length >= 0) {
-                rgb = _Pix3D.palette[color0 >> 8];
-                color0 += colorStep;
-
-                rgb = ((((rgb & 0xff00ff) * invAlpha) >> 8) & 0xff00ff) + ((((rgb & 0xff00) * invAlpha) >> 8) & 0xff00);
-                dst[offset] = rgb + ((((dst[offset] & 0xff00ff) * alpha) >> 8) & 0xff00ff) + ((((dst[offset] & 0xff00) * alpha) >> 8) & 0xff00);
-                offset++;
-            }
+            g_pix3d_spans->smooth_blend(dst + offset + x0, x1 - x0, color0, colorStep, _Pix3D.palette, r->alpha);
         }
     }
 }
 
-void flatTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int color) {
+void pix3d_draw_flat(const Pix3DRaster *r, int xA, int xB, int xC, int yA, int yB, int yC, int color) {
     int dxAB = xB - xA;
     int dyAB = yB - yA;
     int dxAC = xC - xA;
@@ -964,14 +1051,14 @@ void flatTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int color) {
                     yB -= yA;
                     yA = _Pix3D.line_offset[yA];
 
-                    while (--yB >= 0) {
-                        flatRaster(xC >> 16, xA >> 16, _Pix2D.pixels, yA, color);
+                    while (--yB >= 0 && yA < r->bottom) {
+                        flatRaster(r, xC >> 16, xA >> 16, _Pix2D.pixels, yA, color);
                         xC += xStepAC;
                         xA += xStepAB;
                         yA += _Pix2D.width;
                     }
-                    while (--yC >= 0.0F) {
-                        flatRaster(xC >> 16, xB >> 16, _Pix2D.pixels, yA, color);
+                    while (--yC >= 0.0F && yA < r->bottom) {
+                        flatRaster(r, xC >> 16, xB >> 16, _Pix2D.pixels, yA, color);
                         xC += xStepAC;
                         xB += xStepBC;
                         yA += _Pix2D.width;
@@ -981,14 +1068,14 @@ void flatTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int color) {
                     yB -= yA;
                     yA = _Pix3D.line_offset[yA];
 
-                    while (--yB >= 0) {
-                        flatRaster(xA >> 16, xC >> 16, _Pix2D.pixels, yA, color);
+                    while (--yB >= 0 && yA < r->bottom) {
+                        flatRaster(r, xA >> 16, xC >> 16, _Pix2D.pixels, yA, color);
                         xC += xStepAC;
                         xA += xStepAB;
                         yA += _Pix2D.width;
                     }
-                    while (--yC >= 0) {
-                        flatRaster(xB >> 16, xC >> 16, _Pix2D.pixels, yA, color);
+                    while (--yC >= 0 && yA < r->bottom) {
+                        flatRaster(r, xB >> 16, xC >> 16, _Pix2D.pixels, yA, color);
                         xC += xStepAC;
                         xB += xStepBC;
                         yA += _Pix2D.width;
@@ -1013,14 +1100,14 @@ void flatTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int color) {
                     yC -= yA;
                     yA = _Pix3D.line_offset[yA];
 
-                    while (--yC >= 0) {
-                        flatRaster(xB >> 16, xA >> 16, _Pix2D.pixels, yA, color);
+                    while (--yC >= 0 && yA < r->bottom) {
+                        flatRaster(r, xB >> 16, xA >> 16, _Pix2D.pixels, yA, color);
                         xB += xStepAC;
                         xA += xStepAB;
                         yA += _Pix2D.width;
                     }
-                    while (--yB >= 0) {
-                        flatRaster(xC >> 16, xA >> 16, _Pix2D.pixels, yA, color);
+                    while (--yB >= 0 && yA < r->bottom) {
+                        flatRaster(r, xC >> 16, xA >> 16, _Pix2D.pixels, yA, color);
                         xC += xStepBC;
                         xA += xStepAB;
                         yA += _Pix2D.width;
@@ -1030,14 +1117,14 @@ void flatTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int color) {
                     yC -= yA;
                     yA = _Pix3D.line_offset[yA];
 
-                    while (--yC >= 0) {
-                        flatRaster(xA >> 16, xB >> 16, _Pix2D.pixels, yA, color);
+                    while (--yC >= 0 && yA < r->bottom) {
+                        flatRaster(r, xA >> 16, xB >> 16, _Pix2D.pixels, yA, color);
                         xB += xStepAC;
                         xA += xStepAB;
                         yA += _Pix2D.width;
                     }
-                    while (--yB >= 0) {
-                        flatRaster(xA >> 16, xC >> 16, _Pix2D.pixels, yA, color);
+                    while (--yB >= 0 && yA < r->bottom) {
+                        flatRaster(r, xA >> 16, xC >> 16, _Pix2D.pixels, yA, color);
                         xC += xStepBC;
                         xA += xStepAB;
                         yA += _Pix2D.width;
@@ -1074,14 +1161,14 @@ void flatTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int color) {
                     yC -= yB;
                     yB = _Pix3D.line_offset[yB];
 
-                    while (--yC >= 0) {
-                        flatRaster(xA >> 16, xB >> 16, _Pix2D.pixels, yB, color);
+                    while (--yC >= 0 && yB < r->bottom) {
+                        flatRaster(r, xA >> 16, xB >> 16, _Pix2D.pixels, yB, color);
                         xA += xStepAB;
                         xB += xStepBC;
                         yB += _Pix2D.width;
                     }
-                    while (--yA >= 0) {
-                        flatRaster(xA >> 16, xC >> 16, _Pix2D.pixels, yB, color);
+                    while (--yA >= 0 && yB < r->bottom) {
+                        flatRaster(r, xA >> 16, xC >> 16, _Pix2D.pixels, yB, color);
                         xA += xStepAB;
                         xC += xStepAC;
                         yB += _Pix2D.width;
@@ -1091,14 +1178,14 @@ void flatTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int color) {
                     yC -= yB;
                     yB = _Pix3D.line_offset[yB];
 
-                    while (--yC >= 0) {
-                        flatRaster(xB >> 16, xA >> 16, _Pix2D.pixels, yB, color);
+                    while (--yC >= 0 && yB < r->bottom) {
+                        flatRaster(r, xB >> 16, xA >> 16, _Pix2D.pixels, yB, color);
                         xA += xStepAB;
                         xB += xStepBC;
                         yB += _Pix2D.width;
                     }
-                    while (--yA >= 0) {
-                        flatRaster(xC >> 16, xA >> 16, _Pix2D.pixels, yB, color);
+                    while (--yA >= 0 && yB < r->bottom) {
+                        flatRaster(r, xC >> 16, xA >> 16, _Pix2D.pixels, yB, color);
                         xA += xStepAB;
                         xC += xStepAC;
                         yB += _Pix2D.width;
@@ -1123,14 +1210,14 @@ void flatTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int color) {
                     yA -= yB;
                     yB = _Pix3D.line_offset[yB];
 
-                    while (--yA >= 0) {
-                        flatRaster(xC >> 16, xB >> 16, _Pix2D.pixels, yB, color);
+                    while (--yA >= 0 && yB < r->bottom) {
+                        flatRaster(r, xC >> 16, xB >> 16, _Pix2D.pixels, yB, color);
                         xC += xStepAB;
                         xB += xStepBC;
                         yB += _Pix2D.width;
                     }
-                    while (--yC >= 0) {
-                        flatRaster(xA >> 16, xB >> 16, _Pix2D.pixels, yB, color);
+                    while (--yC >= 0 && yB < r->bottom) {
+                        flatRaster(r, xA >> 16, xB >> 16, _Pix2D.pixels, yB, color);
                         xA += xStepAC;
                         xB += xStepBC;
                         yB += _Pix2D.width;
@@ -1140,14 +1227,14 @@ void flatTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int color) {
                     yA -= yB;
                     yB = _Pix3D.line_offset[yB];
 
-                    while (--yA >= 0) {
-                        flatRaster(xB >> 16, xC >> 16, _Pix2D.pixels, yB, color);
+                    while (--yA >= 0 && yB < r->bottom) {
+                        flatRaster(r, xB >> 16, xC >> 16, _Pix2D.pixels, yB, color);
                         xC += xStepAB;
                         xB += xStepBC;
                         yB += _Pix2D.width;
                     }
-                    while (--yC >= 0) {
-                        flatRaster(xB >> 16, xA >> 16, _Pix2D.pixels, yB, color);
+                    while (--yC >= 0 && yB < r->bottom) {
+                        flatRaster(r, xB >> 16, xA >> 16, _Pix2D.pixels, yB, color);
                         xA += xStepAC;
                         xB += xStepBC;
                         yB += _Pix2D.width;
@@ -1183,14 +1270,14 @@ void flatTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int color) {
                 yA -= yC;
                 yC = _Pix3D.line_offset[yC];
 
-                while (--yA >= 0) {
-                    flatRaster(xB >> 16, xC >> 16, _Pix2D.pixels, yC, color);
+                while (--yA >= 0 && yC < r->bottom) {
+                    flatRaster(r, xB >> 16, xC >> 16, _Pix2D.pixels, yC, color);
                     xB += xStepBC;
                     xC += xStepAC;
                     yC += _Pix2D.width;
                 }
-                while (--yB >= 0) {
-                    flatRaster(xB >> 16, xA >> 16, _Pix2D.pixels, yC, color);
+                while (--yB >= 0 && yC < r->bottom) {
+                    flatRaster(r, xB >> 16, xA >> 16, _Pix2D.pixels, yC, color);
                     xB += xStepBC;
                     xA += xStepAB;
                     yC += _Pix2D.width;
@@ -1200,14 +1287,14 @@ void flatTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int color) {
                 yA -= yC;
                 yC = _Pix3D.line_offset[yC];
 
-                while (--yA >= 0) {
-                    flatRaster(xC >> 16, xB >> 16, _Pix2D.pixels, yC, color);
+                while (--yA >= 0 && yC < r->bottom) {
+                    flatRaster(r, xC >> 16, xB >> 16, _Pix2D.pixels, yC, color);
                     xB += xStepBC;
                     xC += xStepAC;
                     yC += _Pix2D.width;
                 }
-                while (--yB >= 0) {
-                    flatRaster(xA >> 16, xB >> 16, _Pix2D.pixels, yC, color);
+                while (--yB >= 0 && yC < r->bottom) {
+                    flatRaster(r, xA >> 16, xB >> 16, _Pix2D.pixels, yC, color);
                     xB += xStepBC;
                     xA += xStepAB;
                     yC += _Pix2D.width;
@@ -1232,14 +1319,14 @@ void flatTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int color) {
                 yB -= yC;
                 yC = _Pix3D.line_offset[yC];
 
-                while (--yB >= 0) {
-                    flatRaster(xA >> 16, xC >> 16, _Pix2D.pixels, yC, color);
+                while (--yB >= 0 && yC < r->bottom) {
+                    flatRaster(r, xA >> 16, xC >> 16, _Pix2D.pixels, yC, color);
                     xA += xStepBC;
                     xC += xStepAC;
                     yC += _Pix2D.width;
                 }
-                while (--yA >= 0) {
-                    flatRaster(xB >> 16, xC >> 16, _Pix2D.pixels, yC, color);
+                while (--yA >= 0 && yC < r->bottom) {
+                    flatRaster(r, xB >> 16, xC >> 16, _Pix2D.pixels, yC, color);
                     xB += xStepAB;
                     xC += xStepAC;
                     yC += _Pix2D.width;
@@ -1249,14 +1336,14 @@ void flatTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int color) {
                 yB -= yC;
                 yC = _Pix3D.line_offset[yC];
 
-                while (--yB >= 0) {
-                    flatRaster(xC >> 16, xA >> 16, _Pix2D.pixels, yC, color);
+                while (--yB >= 0 && yC < r->bottom) {
+                    flatRaster(r, xC >> 16, xA >> 16, _Pix2D.pixels, yC, color);
                     xA += xStepBC;
                     xC += xStepAC;
                     yC += _Pix2D.width;
                 }
-                while (--yA >= 0) {
-                    flatRaster(xC >> 16, xB >> 16, _Pix2D.pixels, yC, color);
+                while (--yA >= 0 && yC < r->bottom) {
+                    flatRaster(r, xC >> 16, xB >> 16, _Pix2D.pixels, yC, color);
                     xB += xStepAB;
                     xC += xStepAC;
                     yC += _Pix2D.width;
@@ -1266,8 +1353,13 @@ void flatTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int color) {
     }
 }
 
-static void flatRaster(int x0, int x1, int *dst, int offset, int rgb) {
-    if (_Pix3D.clipX) {
+static void flatRaster(const Pix3DRaster *r, int x0, int x1, int *dst, int offset, int rgb) {
+    /* Rows outside the band being drawn (pix3d_bin.h) */
+    if (offset < r->top || offset >= r->bottom) {
+        return;
+    }
+
+    if (r->clipX) {
         if (x1 > _Pix2D.bound_x) {
             x1 = _Pix2D.bound_x;
         }
@@ -1281,49 +1373,17 @@ static void flatRaster(int x0, int x1, int *dst, int offset, int rgb) {
         return;
     }
 
-    offset += x0;
-    int length = (x1 - x0) >> 2;
-
-    if (_Pix3D.alpha == 0) {
-        while (--length >= 0) {
-            dst[offset++] = rgb;
-            dst[offset++] = rgb;
-            dst[offset++] = rgb;
-            dst[offset++] = rgb;
-        }
-
-        length = (x1 - x0) & 0x3;
-        while (--length >= 0) {
-            dst[offset++] = rgb;
-        }
+    if (r->alpha == 0) {
+        g_pix3d_spans->fill(dst + offset + x0, x1 - x0, rgb);
     } else {
-        int alpha = _Pix3D.alpha;
-        int invAlpha = 256 - _Pix3D.alpha;
+        int alpha = r->alpha;
+        int invAlpha = 256 - r->alpha;
         rgb = ((rgb & 0xff00ff) * invAlpha >> 8 & 0xff00ff) + ((rgb & 0xff00) * invAlpha >> 8 & 0xff00);
-
-        while (--length >= 0) {
-            dst[offset] = rgb + ((((dst[offset] & 0xff00ff) * alpha) >> 8) & 0xff00ff) + ((((dst[offset] & 0xff00) * alpha) >> 8) & 0xff00);
-            offset++;
-            dst[offset] = rgb + ((((dst[offset] & 0xff00ff) * alpha) >> 8) & 0xff00ff) + ((((dst[offset] & 0xff00) * alpha) >> 8) & 0xff00);
-            offset++;
-            dst[offset] = rgb + ((((dst[offset] & 0xff00ff) * alpha) >> 8) & 0xff00ff) + ((((dst[offset] & 0xff00) * alpha) >> 8) & 0xff00);
-            offset++;
-            dst[offset] = rgb + ((((dst[offset] & 0xff00ff) * alpha) >> 8) & 0xff00ff) + ((((dst[offset] & 0xff00) * alpha) >> 8) & 0xff00);
-            offset++;
-        }
-
-        length = (x1 - x0) & 0x3;
-        while (--length >= 0) {
-            dst[offset] = rgb + ((((dst[offset] & 0xff00ff) * alpha) >> 8) & 0xff00ff) + ((((dst[offset] & 0xff00) * alpha) >> 8) & 0xff00);
-            offset++;
-        }
+        g_pix3d_spans->blend(dst + offset + x0, x1 - x0, rgb, alpha);
     }
 }
 
-void textureTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int shadeA, int shadeB, int shadeC, int originX, int originY, int originZ, int txB, int txC, int tyB, int tyC, int tzB, int tzC, int texture) {
-    int *texels = pix3d_get_texels(texture);
-    _Pix3D.opaque = !_Pix3D.textureHasTransparency[texture];
-
+void pix3d_draw_texture(const Pix3DRaster *r, int xA, int xB, int xC, int yA, int yB, int yC, int shadeA, int shadeB, int shadeC, int originX, int originY, int originZ, int txB, int txC, int tyB, int tyC, int tzB, int tzC, int *texels) {
     int verticalX = originX - txB;
     int verticalY = originY - tyB;
     int verticalZ = originZ - tzB;
@@ -1415,8 +1475,8 @@ void textureTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int shadeA,
                     yB -= yA;
                     yA = _Pix3D.line_offset[yA];
 
-                    while (--yB >= 0) {
-                        textureRaster(xC >> 16, xA >> 16, _Pix2D.pixels, yA, texels, 0, 0, u, v, w, uStride, vStride, wStride, shadeC >> 8, shadeA >> 8);
+                    while (--yB >= 0 && yA < r->bottom) {
+                        textureRaster(r, xC >> 16, xA >> 16, _Pix2D.pixels, yA, texels, 0, 0, u, v, w, uStride, vStride, wStride, shadeC >> 8, shadeA >> 8);
                         xC += xStepAC;
                         xA += xStepAB;
                         shadeC += shadeStepAC;
@@ -1426,8 +1486,8 @@ void textureTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int shadeA,
                         v += vStepVertical;
                         w += wStepVertical;
                     }
-                    while (--yC >= 0) {
-                        textureRaster(xC >> 16, xB >> 16, _Pix2D.pixels, yA, texels, 0, 0, u, v, w, uStride, vStride, wStride, shadeC >> 8, shadeB >> 8);
+                    while (--yC >= 0 && yA < r->bottom) {
+                        textureRaster(r, xC >> 16, xB >> 16, _Pix2D.pixels, yA, texels, 0, 0, u, v, w, uStride, vStride, wStride, shadeC >> 8, shadeB >> 8);
                         xC += xStepAC;
                         xB += xStepBC;
                         shadeC += shadeStepAC;
@@ -1442,8 +1502,8 @@ void textureTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int shadeA,
                     yB -= yA;
                     yA = _Pix3D.line_offset[yA];
 
-                    while (--yB >= 0) {
-                        textureRaster(xA >> 16, xC >> 16, _Pix2D.pixels, yA, texels, 0, 0, u, v, w, uStride, vStride, wStride, shadeA >> 8, shadeC >> 8);
+                    while (--yB >= 0 && yA < r->bottom) {
+                        textureRaster(r, xA >> 16, xC >> 16, _Pix2D.pixels, yA, texels, 0, 0, u, v, w, uStride, vStride, wStride, shadeA >> 8, shadeC >> 8);
                         xC += xStepAC;
                         xA += xStepAB;
                         shadeC += shadeStepAC;
@@ -1453,8 +1513,8 @@ void textureTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int shadeA,
                         v += vStepVertical;
                         w += wStepVertical;
                     }
-                    while (--yC >= 0) {
-                        textureRaster(xB >> 16, xC >> 16, _Pix2D.pixels, yA, texels, 0, 0, u, v, w, uStride, vStride, wStride, shadeB >> 8, shadeC >> 8);
+                    while (--yC >= 0 && yA < r->bottom) {
+                        textureRaster(r, xB >> 16, xC >> 16, _Pix2D.pixels, yA, texels, 0, 0, u, v, w, uStride, vStride, wStride, shadeB >> 8, shadeC >> 8);
                         xC += xStepAC;
                         xB += xStepBC;
                         shadeC += shadeStepAC;
@@ -1494,8 +1554,8 @@ void textureTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int shadeA,
                     yC -= yA;
                     yA = _Pix3D.line_offset[yA];
 
-                    while (--yC >= 0) {
-                        textureRaster(xA >> 16, xB >> 16, _Pix2D.pixels, yA, texels, 0, 0, u, v, w, uStride, vStride, wStride, shadeA >> 8, shadeB >> 8);
+                    while (--yC >= 0 && yA < r->bottom) {
+                        textureRaster(r, xA >> 16, xB >> 16, _Pix2D.pixels, yA, texels, 0, 0, u, v, w, uStride, vStride, wStride, shadeA >> 8, shadeB >> 8);
                         xB += xStepAC;
                         xA += xStepAB;
                         shadeB += shadeStepAC;
@@ -1505,8 +1565,8 @@ void textureTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int shadeA,
                         v += vStepVertical;
                         w += wStepVertical;
                     }
-                    while (--yB >= 0) {
-                        textureRaster(xA >> 16, xC >> 16, _Pix2D.pixels, yA, texels, 0, 0, u, v, w, uStride, vStride, wStride, shadeA >> 8, shadeC >> 8);
+                    while (--yB >= 0 && yA < r->bottom) {
+                        textureRaster(r, xA >> 16, xC >> 16, _Pix2D.pixels, yA, texels, 0, 0, u, v, w, uStride, vStride, wStride, shadeA >> 8, shadeC >> 8);
                         xC += xStepBC;
                         xA += xStepAB;
                         shadeC += shadeStepBC;
@@ -1521,8 +1581,8 @@ void textureTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int shadeA,
                     yC -= yA;
                     yA = _Pix3D.line_offset[yA];
 
-                    while (--yC >= 0) {
-                        textureRaster(xB >> 16, xA >> 16, _Pix2D.pixels, yA, texels, 0, 0, u, v, w, uStride, vStride, wStride, shadeB >> 8, shadeA >> 8);
+                    while (--yC >= 0 && yA < r->bottom) {
+                        textureRaster(r, xB >> 16, xA >> 16, _Pix2D.pixels, yA, texels, 0, 0, u, v, w, uStride, vStride, wStride, shadeB >> 8, shadeA >> 8);
                         xB += xStepAC;
                         xA += xStepAB;
                         shadeB += shadeStepAC;
@@ -1532,8 +1592,8 @@ void textureTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int shadeA,
                         v += vStepVertical;
                         w += wStepVertical;
                     }
-                    while (--yB >= 0) {
-                        textureRaster(xC >> 16, xA >> 16, _Pix2D.pixels, yA, texels, 0, 0, u, v, w, uStride, vStride, wStride, shadeC >> 8, shadeA >> 8);
+                    while (--yB >= 0 && yA < r->bottom) {
+                        textureRaster(r, xC >> 16, xA >> 16, _Pix2D.pixels, yA, texels, 0, 0, u, v, w, uStride, vStride, wStride, shadeC >> 8, shadeA >> 8);
                         xC += xStepBC;
                         xA += xStepAB;
                         shadeC += shadeStepBC;
@@ -1585,8 +1645,8 @@ void textureTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int shadeA,
                     yC -= yB;
                     yB = _Pix3D.line_offset[yB];
 
-                    while (--yC >= 0) {
-                        textureRaster(xA >> 16, xB >> 16, _Pix2D.pixels, yB, texels, 0, 0, u, v, w, uStride, vStride, wStride, shadeA >> 8, shadeB >> 8);
+                    while (--yC >= 0 && yB < r->bottom) {
+                        textureRaster(r, xA >> 16, xB >> 16, _Pix2D.pixels, yB, texels, 0, 0, u, v, w, uStride, vStride, wStride, shadeA >> 8, shadeB >> 8);
                         xA += xStepAB;
                         xB += xStepBC;
                         shadeA += shadeStepAB;
@@ -1596,8 +1656,8 @@ void textureTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int shadeA,
                         v += vStepVertical;
                         w += wStepVertical;
                     }
-                    while (--yA >= 0) {
-                        textureRaster(xA >> 16, xC >> 16, _Pix2D.pixels, yB, texels, 0, 0, u, v, w, uStride, vStride, wStride, shadeA >> 8, shadeC >> 8);
+                    while (--yA >= 0 && yB < r->bottom) {
+                        textureRaster(r, xA >> 16, xC >> 16, _Pix2D.pixels, yB, texels, 0, 0, u, v, w, uStride, vStride, wStride, shadeA >> 8, shadeC >> 8);
                         xA += xStepAB;
                         xC += xStepAC;
                         shadeA += shadeStepAB;
@@ -1612,8 +1672,8 @@ void textureTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int shadeA,
                     yC -= yB;
                     yB = _Pix3D.line_offset[yB];
 
-                    while (--yC >= 0) {
-                        textureRaster(xB >> 16, xA >> 16, _Pix2D.pixels, yB, texels, 0, 0, u, v, w, uStride, vStride, wStride, shadeB >> 8, shadeA >> 8);
+                    while (--yC >= 0 && yB < r->bottom) {
+                        textureRaster(r, xB >> 16, xA >> 16, _Pix2D.pixels, yB, texels, 0, 0, u, v, w, uStride, vStride, wStride, shadeB >> 8, shadeA >> 8);
                         xA += xStepAB;
                         xB += xStepBC;
                         shadeA += shadeStepAB;
@@ -1623,8 +1683,8 @@ void textureTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int shadeA,
                         v += vStepVertical;
                         w += wStepVertical;
                     }
-                    while (--yA >= 0) {
-                        textureRaster(xC >> 16, xA >> 16, _Pix2D.pixels, yB, texels, 0, 0, u, v, w, uStride, vStride, wStride, shadeC >> 8, shadeA >> 8);
+                    while (--yA >= 0 && yB < r->bottom) {
+                        textureRaster(r, xC >> 16, xA >> 16, _Pix2D.pixels, yB, texels, 0, 0, u, v, w, uStride, vStride, wStride, shadeC >> 8, shadeA >> 8);
                         xA += xStepAB;
                         xC += xStepAC;
                         shadeA += shadeStepAB;
@@ -1664,8 +1724,8 @@ void textureTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int shadeA,
                     yA -= yB;
                     yB = _Pix3D.line_offset[yB];
 
-                    while (--yA >= 0) {
-                        textureRaster(xC >> 16, xB >> 16, _Pix2D.pixels, yB, texels, 0, 0, u, v, w, uStride, vStride, wStride, shadeC >> 8, shadeB >> 8);
+                    while (--yA >= 0 && yB < r->bottom) {
+                        textureRaster(r, xC >> 16, xB >> 16, _Pix2D.pixels, yB, texels, 0, 0, u, v, w, uStride, vStride, wStride, shadeC >> 8, shadeB >> 8);
                         xC += xStepAB;
                         xB += xStepBC;
                         shadeC += shadeStepAB;
@@ -1675,8 +1735,8 @@ void textureTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int shadeA,
                         v += vStepVertical;
                         w += wStepVertical;
                     }
-                    while (--yC >= 0) {
-                        textureRaster(xA >> 16, xB >> 16, _Pix2D.pixels, yB, texels, 0, 0, u, v, w, uStride, vStride, wStride, shadeA >> 8, shadeB >> 8);
+                    while (--yC >= 0 && yB < r->bottom) {
+                        textureRaster(r, xA >> 16, xB >> 16, _Pix2D.pixels, yB, texels, 0, 0, u, v, w, uStride, vStride, wStride, shadeA >> 8, shadeB >> 8);
                         xA += xStepAC;
                         xB += xStepBC;
                         shadeA += shadeStepAC;
@@ -1691,8 +1751,8 @@ void textureTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int shadeA,
                     yA -= yB;
                     yB = _Pix3D.line_offset[yB];
 
-                    while (--yA >= 0) {
-                        textureRaster(xB >> 16, xC >> 16, _Pix2D.pixels, yB, texels, 0, 0, u, v, w, uStride, vStride, wStride, shadeB >> 8, shadeC >> 8);
+                    while (--yA >= 0 && yB < r->bottom) {
+                        textureRaster(r, xB >> 16, xC >> 16, _Pix2D.pixels, yB, texels, 0, 0, u, v, w, uStride, vStride, wStride, shadeB >> 8, shadeC >> 8);
                         xC += xStepAB;
                         xB += xStepBC;
                         shadeC += shadeStepAB;
@@ -1702,8 +1762,8 @@ void textureTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int shadeA,
                         v += vStepVertical;
                         w += wStepVertical;
                     }
-                    while (--yC >= 0) {
-                        textureRaster(xB >> 16, xA >> 16, _Pix2D.pixels, yB, texels, 0, 0, u, v, w, uStride, vStride, wStride, shadeB >> 8, shadeA >> 8);
+                    while (--yC >= 0 && yB < r->bottom) {
+                        textureRaster(r, xB >> 16, xA >> 16, _Pix2D.pixels, yB, texels, 0, 0, u, v, w, uStride, vStride, wStride, shadeB >> 8, shadeA >> 8);
                         xA += xStepAC;
                         xB += xStepBC;
                         shadeA += shadeStepAC;
@@ -1754,8 +1814,8 @@ void textureTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int shadeA,
                 yA -= yC;
                 yC = _Pix3D.line_offset[yC];
 
-                while (--yA >= 0) {
-                    textureRaster(xB >> 16, xC >> 16, _Pix2D.pixels, yC, texels, 0, 0, u, v, w, uStride, vStride, wStride, shadeB >> 8, shadeC >> 8);
+                while (--yA >= 0 && yC < r->bottom) {
+                    textureRaster(r, xB >> 16, xC >> 16, _Pix2D.pixels, yC, texels, 0, 0, u, v, w, uStride, vStride, wStride, shadeB >> 8, shadeC >> 8);
                     xB += xStepBC;
                     xC += xStepAC;
                     shadeB += shadeStepBC;
@@ -1765,8 +1825,8 @@ void textureTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int shadeA,
                     v += vStepVertical;
                     w += wStepVertical;
                 }
-                while (--yB >= 0) {
-                    textureRaster(xB >> 16, xA >> 16, _Pix2D.pixels, yC, texels, 0, 0, u, v, w, uStride, vStride, wStride, shadeB >> 8, shadeA >> 8);
+                while (--yB >= 0 && yC < r->bottom) {
+                    textureRaster(r, xB >> 16, xA >> 16, _Pix2D.pixels, yC, texels, 0, 0, u, v, w, uStride, vStride, wStride, shadeB >> 8, shadeA >> 8);
                     xB += xStepBC;
                     xA += xStepAB;
                     shadeB += shadeStepBC;
@@ -1781,8 +1841,8 @@ void textureTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int shadeA,
                 yA -= yC;
                 yC = _Pix3D.line_offset[yC];
 
-                while (--yA >= 0) {
-                    textureRaster(xC >> 16, xB >> 16, _Pix2D.pixels, yC, texels, 0, 0, u, v, w, uStride, vStride, wStride, shadeC >> 8, shadeB >> 8);
+                while (--yA >= 0 && yC < r->bottom) {
+                    textureRaster(r, xC >> 16, xB >> 16, _Pix2D.pixels, yC, texels, 0, 0, u, v, w, uStride, vStride, wStride, shadeC >> 8, shadeB >> 8);
                     xB += xStepBC;
                     xC += xStepAC;
                     shadeB += shadeStepBC;
@@ -1792,8 +1852,8 @@ void textureTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int shadeA,
                     v += vStepVertical;
                     w += wStepVertical;
                 }
-                while (--yB >= 0) {
-                    textureRaster(xA >> 16, xB >> 16, _Pix2D.pixels, yC, texels, 0, 0, u, v, w, uStride, vStride, wStride, shadeA >> 8, shadeB >> 8);
+                while (--yB >= 0 && yC < r->bottom) {
+                    textureRaster(r, xA >> 16, xB >> 16, _Pix2D.pixels, yC, texels, 0, 0, u, v, w, uStride, vStride, wStride, shadeA >> 8, shadeB >> 8);
                     xB += xStepBC;
                     xA += xStepAB;
                     shadeB += shadeStepBC;
@@ -1833,8 +1893,8 @@ void textureTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int shadeA,
                 yB -= yC;
                 yC = _Pix3D.line_offset[yC];
 
-                while (--yB >= 0) {
-                    textureRaster(xA >> 16, xC >> 16, _Pix2D.pixels, yC, texels, 0, 0, u, v, w, uStride, vStride, wStride, shadeA >> 8, shadeC >> 8);
+                while (--yB >= 0 && yC < r->bottom) {
+                    textureRaster(r, xA >> 16, xC >> 16, _Pix2D.pixels, yC, texels, 0, 0, u, v, w, uStride, vStride, wStride, shadeA >> 8, shadeC >> 8);
                     xA += xStepBC;
                     xC += xStepAC;
                     shadeA += shadeStepBC;
@@ -1844,8 +1904,8 @@ void textureTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int shadeA,
                     v += vStepVertical;
                     w += wStepVertical;
                 }
-                while (--yA >= 0) {
-                    textureRaster(xB >> 16, xC >> 16, _Pix2D.pixels, yC, texels, 0, 0, u, v, w, uStride, vStride, wStride, shadeB >> 8, shadeC >> 8);
+                while (--yA >= 0 && yC < r->bottom) {
+                    textureRaster(r, xB >> 16, xC >> 16, _Pix2D.pixels, yC, texels, 0, 0, u, v, w, uStride, vStride, wStride, shadeB >> 8, shadeC >> 8);
                     xB += xStepAB;
                     xC += xStepAC;
                     shadeB += shadeStepAB;
@@ -1860,8 +1920,8 @@ void textureTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int shadeA,
                 yB -= yC;
                 yC = _Pix3D.line_offset[yC];
 
-                while (--yB >= 0) {
-                    textureRaster(xC >> 16, xA >> 16, _Pix2D.pixels, yC, texels, 0, 0, u, v, w, uStride, vStride, wStride, shadeC >> 8, shadeA >> 8);
+                while (--yB >= 0 && yC < r->bottom) {
+                    textureRaster(r, xC >> 16, xA >> 16, _Pix2D.pixels, yC, texels, 0, 0, u, v, w, uStride, vStride, wStride, shadeC >> 8, shadeA >> 8);
                     xA += xStepBC;
                     xC += xStepAC;
                     shadeA += shadeStepBC;
@@ -1871,8 +1931,8 @@ void textureTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int shadeA,
                     v += vStepVertical;
                     w += wStepVertical;
                 }
-                while (--yA >= 0) {
-                    textureRaster(xC >> 16, xB >> 16, _Pix2D.pixels, yC, texels, 0, 0, u, v, w, uStride, vStride, wStride, shadeC >> 8, shadeB >> 8);
+                while (--yA >= 0 && yC < r->bottom) {
+                    textureRaster(r, xC >> 16, xB >> 16, _Pix2D.pixels, yC, texels, 0, 0, u, v, w, uStride, vStride, wStride, shadeC >> 8, shadeB >> 8);
                     xB += xStepAB;
                     xC += xStepAC;
                     shadeB += shadeStepAB;
@@ -1887,14 +1947,18 @@ void textureTriangle(int xA, int xB, int xC, int yA, int yB, int yC, int shadeA,
     }
 }
 
-static void textureRaster(int xA, int xB, int *dst, int offset, int *texels, int curU, int curV, int u, int v, int w, int uStride, int vStride, int wStride, int shadeA, int shadeB) {
+static void textureRaster(const Pix3DRaster *r, int xA, int xB, int *dst, int offset, int *texels, int curU, int curV, int u, int v, int w, int uStride, int vStride, int wStride, int shadeA, int shadeB) {
+    /* Rows outside the band being drawn (pix3d_bin.h) */
+    if (offset < r->top || offset >= r->bottom) {
+        return;
+    }
+
     if (xA >= xB) {
         return;
     }
 
     int shadeStrides;
-    int strides;
-    if (_Pix3D.clipX) {
+    if (r->clipX) {
         shadeStrides = (shadeB - shadeA) / (xB - xA);
 
         if (xB > _Pix2D.bound_x) {
@@ -1910,412 +1974,37 @@ static void textureRaster(int xA, int xB, int *dst, int offset, int *texels, int
             return;
         }
 
-        strides = (xB - xA) >> 3;
         shadeStrides <<= 12;
         shadeA <<= 9;
     } else {
         if (xB - xA > 7) {
-            strides = (xB - xA) >> 3;
-            shadeStrides = (shadeB - shadeA) * _Pix3D.reciprical15[strides] >> 6;
+            shadeStrides = (shadeB - shadeA) * _Pix3D.reciprical15[(xB - xA) >> 3] >> 6;
         } else {
-            strides = 0;
             shadeStrides = 0;
         }
 
         shadeA <<= 9;
     }
 
-    offset += xA;
-
-    if (_Pix3D.lowMemory) {
-        int nextU = 0;
-        int nextV = 0;
-        int dx = xA - _Pix3D.center_x;
-
-        u = u + (uStride >> 3) * dx;
-        v = v + (vStride >> 3) * dx;
-        w = w + (wStride >> 3) * dx;
-
-        int curW = w >> 12;
-        if (curW != 0) {
-            curU = u / curW;
-            curV = v / curW;
-            if (curU < 0) {
-                curU = 0;
-            } else if (curU > 0xfc0) {
-                curU = 0xfc0;
-            }
-        }
-
-        u = u + uStride;
-        v = v + vStride;
-        w = w + wStride;
-
-        curW = w >> 12;
-        if (curW != 0) {
-            nextU = u / curW;
-            nextV = v / curW;
-            if (nextU < 0x7) {
-                nextU = 0x7;
-            } else if (nextU > 0xfc0) {
-                nextU = 0xfc0;
-            }
-        }
-
-        int stepU = (nextU - curU) >> 3;
-        int stepV = (nextV - curV) >> 3;
-        curU += (shadeA >> 3) & 0xc0000;
-        int shadeShift = shadeA >> 23;
-
-        if (_Pix3D.opaque) {
-            while (strides-- > 0) {
-                dst[offset++] = (uint32_t)texels[(curV & 0xfc0) + (curU >> 6)] >> shadeShift;
-                curU += stepU;
-                curV += stepV;
-
-                dst[offset++] = (uint32_t)texels[(curV & 0xfc0) + (curU >> 6)] >> shadeShift;
-                curU += stepU;
-                curV += stepV;
-
-                dst[offset++] = (uint32_t)texels[(curV & 0xfc0) + (curU >> 6)] >> shadeShift;
-                curU += stepU;
-                curV += stepV;
-
-                dst[offset++] = (uint32_t)texels[(curV & 0xfc0) + (curU >> 6)] >> shadeShift;
-                curU += stepU;
-                curV += stepV;
-
-                dst[offset++] = (uint32_t)texels[(curV & 0xfc0) + (curU >> 6)] >> shadeShift;
-                curU += stepU;
-                curV += stepV;
-
-                dst[offset++] = (uint32_t)texels[(curV & 0xfc0) + (curU >> 6)] >> shadeShift;
-                curU += stepU;
-                curV += stepV;
-
-                dst[offset++] = (uint32_t)texels[(curV & 0xfc0) + (curU >> 6)] >> shadeShift;
-                curU += stepU;
-                curV += stepV;
-
-                dst[offset++] = (uint32_t)texels[(curV & 0xfc0) + (curU >> 6)] >> shadeShift;
-                curU = nextU;
-                curV = nextV;
-
-                u += uStride;
-                v += vStride;
-                w += wStride;
-
-                curW = w >> 12;
-                if (curW != 0) {
-                    nextU = u / curW;
-                    nextV = v / curW;
-                    if (nextU < 0x7) {
-                        nextU = 0x7;
-                    } else if (nextU > 0xfc0) {
-                        nextU = 0xfc0;
-                    }
-                }
-
-                stepU = (nextU - curU) >> 3;
-                stepV = (nextV - curV) >> 3;
-                shadeA += shadeStrides;
-                curU += (shadeA >> 3) & 0xc0000;
-                shadeShift = shadeA >> 23;
-            }
-
-            strides = xB - xA & 0x7;
-            while (strides-- > 0) {
-                dst[offset++] = (uint32_t)texels[(curV & 0xfc0) + (curU >> 6)] >> shadeShift;
-                curU += stepU;
-                curV += stepV;
-            }
-        } else {
-            while (strides-- > 0) {
-                int rgb;
-                if ((rgb = (uint32_t)texels[(curV & 0xfc0) + (curU >> 6)] >> shadeShift) != 0) {
-                    dst[offset] = rgb;
-                }
-                offset++;
-                curU += stepU;
-                curV += stepV;
-
-                if ((rgb = (uint32_t)texels[(curV & 0xfc0) + (curU >> 6)] >> shadeShift) != 0) {
-                    dst[offset] = rgb;
-                }
-                offset++;
-                curU += stepU;
-                curV += stepV;
-
-                if ((rgb = (uint32_t)texels[(curV & 0xfc0) + (curU >> 6)] >> shadeShift) != 0) {
-                    dst[offset] = rgb;
-                }
-                offset++;
-                curU += stepU;
-                curV += stepV;
-
-                if ((rgb = (uint32_t)texels[(curV & 0xfc0) + (curU >> 6)] >> shadeShift) != 0) {
-                    dst[offset] = rgb;
-                }
-                offset++;
-                curU += stepU;
-                curV += stepV;
-
-                if ((rgb = (uint32_t)texels[(curV & 0xfc0) + (curU >> 6)] >> shadeShift) != 0) {
-                    dst[offset] = rgb;
-                }
-                offset++;
-                curU += stepU;
-                curV += stepV;
-
-                if ((rgb = (uint32_t)texels[(curV & 0xfc0) + (curU >> 6)] >> shadeShift) != 0) {
-                    dst[offset] = rgb;
-                }
-                offset++;
-                curU += stepU;
-                curV += stepV;
-
-                if ((rgb = (uint32_t)texels[(curV & 0xfc0) + (curU >> 6)] >> shadeShift) != 0) {
-                    dst[offset] = rgb;
-                }
-                offset++;
-                curU += stepU;
-                curV += stepV;
-
-                if ((rgb = (uint32_t)texels[(curV & 0xfc0) + (curU >> 6)] >> shadeShift) != 0) {
-                    dst[offset] = rgb;
-                }
-                offset++;
-                curU = nextU;
-                curV = nextV;
-
-                u += uStride;
-                v += vStride;
-                w += wStride;
-
-                curW = w >> 12;
-                if (curW != 0) {
-                    nextU = u / curW;
-                    nextV = v / curW;
-                    if (nextU < 7) {
-                        nextU = 7;
-                    } else if (nextU > 0xfc0) {
-                        nextU = 0xfc0;
-                    }
-                }
-
-                stepU = (nextU - curU) >> 3;
-                stepV = (nextV - curV) >> 3;
-                shadeA += shadeStrides;
-                curU += (shadeA >> 3) & 0xc0000;
-                shadeShift = shadeA >> 23;
-            }
-
-            strides = (xB - xA) & 0x7;
-            while (strides-- > 0) {
-                int rgb;
-                if ((rgb = (uint32_t)texels[(curV & 0xfc0) + (curU >> 6)] >> shadeShift) != 0) {
-                    dst[offset] = rgb;
-                }
-
-                offset++;
-                curU += stepU;
-                curV += stepV;
-            }
-        }
+    /* 64x64 texels in low memory, else 128x128 (pix3d_span.h) */
+    Pix3DTexture texture;
+    int dx = xA - _Pix3D.center_x;
+    texture.u = u + (uStride >> 3) * dx;
+    texture.v = v + (vStride >> 3) * dx;
+    texture.w = w + (wStride >> 3) * dx;
+    texture.uStride = uStride;
+    texture.vStride = vStride;
+    texture.wStride = wStride;
+    texture.curU = curU;
+    texture.curV = curV;
+    texture.shade = shadeA;
+    texture.shadeStride = shadeStrides;
+    texture.size = _Pix3D.lowMemory ? 6 : 7;
+    texture.scroll = r->scroll;
+
+    if (r->opaque) {
+        g_pix3d_spans->texture(dst + offset + xA, xB - xA, texels, &texture);
     } else {
-        int nextU = 0;
-        int nextV = 0;
-        int dx = xA - _Pix3D.center_x;
-
-        u = u + (uStride >> 3) * dx;
-        v = v + (vStride >> 3) * dx;
-        w = w + (wStride >> 3) * dx;
-
-        int curW = w >> 14;
-        if (curW != 0) {
-            curU = u / curW;
-            curV = v / curW;
-            if (curU < 0) {
-                curU = 0;
-            } else if (curU > 0x3f80) {
-                curU = 0x3f80;
-            }
-        }
-
-        u = u + uStride;
-        v = v + vStride;
-        w = w + wStride;
-
-        curW = w >> 14;
-        if (curW != 0) {
-            nextU = u / curW;
-            nextV = v / curW;
-            if (nextU < 0x7) {
-                nextU = 0x7;
-            } else if (nextU > 0x3f80) {
-                nextU = 0x3f80;
-            }
-        }
-
-        int stepU = (nextU - curU) >> 3;
-        int stepV = (nextV - curV) >> 3;
-        curU += shadeA & 0x600000;
-        int shadeShift = shadeA >> 23;
-
-        if (_Pix3D.opaque) {
-            while (strides-- > 0) {
-                dst[offset++] = (uint32_t)texels[(curV & 0x3f80) + (curU >> 7)] >> shadeShift;
-                curU += stepU;
-                curV += stepV;
-
-                dst[offset++] = (uint32_t)texels[(curV & 0x3f80) + (curU >> 7)] >> shadeShift;
-                curU += stepU;
-                curV += stepV;
-
-                dst[offset++] = (uint32_t)texels[(curV & 0x3f80) + (curU >> 7)] >> shadeShift;
-                curU += stepU;
-                curV += stepV;
-
-                dst[offset++] = (uint32_t)texels[(curV & 0x3f80) + (curU >> 7)] >> shadeShift;
-                curU += stepU;
-                curV += stepV;
-
-                dst[offset++] = (uint32_t)texels[(curV & 0x3f80) + (curU >> 7)] >> shadeShift;
-                curU += stepU;
-                curV += stepV;
-
-                dst[offset++] = (uint32_t)texels[(curV & 0x3f80) + (curU >> 7)] >> shadeShift;
-                curU += stepU;
-                curV += stepV;
-
-                dst[offset++] = (uint32_t)texels[(curV & 0x3f80) + (curU >> 7)] >> shadeShift;
-                curU += stepU;
-                curV += stepV;
-
-                dst[offset++] = (uint32_t)texels[(curV & 0x3f80) + (curU >> 7)] >> shadeShift;
-                curU = nextU;
-                curV = nextV;
-
-                u += uStride;
-                v += vStride;
-                w += wStride;
-
-                curW = w >> 14;
-                if (curW != 0) {
-                    nextU = u / curW;
-                    nextV = v / curW;
-                    if (nextU < 0x7) {
-                        nextU = 0x7;
-                    } else if (nextU > 0x3f80) {
-                        nextU = 0x3f80;
-                    }
-                }
-
-                stepU = (nextU - curU) >> 3;
-                stepV = (nextV - curV) >> 3;
-                shadeA += shadeStrides;
-                curU += shadeA & 0x600000;
-                shadeShift = shadeA >> 23;
-            }
-
-            strides = xB - xA & 0x7;
-            while (strides-- > 0) {
-                dst[offset++] = (uint32_t)texels[(curV & 0x3f80) + (curU >> 7)] >> shadeShift;
-                curU += stepU;
-                curV += stepV;
-            }
-        } else {
-            while (strides-- > 0) {
-                int rgb;
-                if ((rgb = (uint32_t)texels[(curV & 0x3f80) + (curU >> 7)] >> shadeShift) != 0) {
-                    dst[offset] = rgb;
-                }
-                offset++;
-                curU += stepU;
-                curV += stepV;
-
-                if ((rgb = (uint32_t)texels[(curV & 0x3f80) + (curU >> 7)] >> shadeShift) != 0) {
-                    dst[offset] = rgb;
-                }
-                offset++;
-                curU += stepU;
-                curV += stepV;
-
-                if ((rgb = (uint32_t)texels[(curV & 0x3f80) + (curU >> 7)] >> shadeShift) != 0) {
-                    dst[offset] = rgb;
-                }
-                offset++;
-                curU += stepU;
-                curV += stepV;
-
-                if ((rgb = (uint32_t)texels[(curV & 0x3f80) + (curU >> 7)] >> shadeShift) != 0) {
-                    dst[offset] = rgb;
-                }
-                offset++;
-                curU += stepU;
-                curV += stepV;
-
-                if ((rgb = (uint32_t)texels[(curV & 0x3f80) + (curU >> 7)] >> shadeShift) != 0) {
-                    dst[offset] = rgb;
-                }
-                offset++;
-                curU += stepU;
-                curV += stepV;
-
-                if ((rgb = (uint32_t)texels[(curV & 0x3f80) + (curU >> 7)] >> shadeShift) != 0) {
-                    dst[offset] = rgb;
-                }
-                offset++;
-                curU += stepU;
-                curV += stepV;
-
-                if ((rgb = (uint32_t)texels[(curV & 0x3f80) + (curU >> 7)] >> shadeShift) != 0) {
-                    dst[offset] = rgb;
-                }
-                offset++;
-                curU += stepU;
-                curV += stepV;
-
-                if ((rgb = (uint32_t)texels[(curV & 0x3f80) + (curU >> 7)] >> shadeShift) != 0) {
-                    dst[offset] = rgb;
-                }
-                offset++;
-                curU = nextU;
-                curV = nextV;
-
-                u += uStride;
-                v += vStride;
-                w += wStride;
-
-                curW = w >> 14;
-                if (curW != 0) {
-                    nextU = u / curW;
-                    nextV = v / curW;
-                    if (nextU < 0x7) {
-                        nextU = 0x7;
-                    } else if (nextU > 0x3f80) {
-                        nextU = 0x3f80;
-                    }
-                }
-
-                stepU = (nextU - curU) >> 3;
-                stepV = (nextV - curV) >> 3;
-                shadeA += shadeStrides;
-                curU += shadeA & 0x600000;
-                shadeShift = shadeA >> 23;
-            }
-
-            strides = xB - xA & 0x7;
-            while (strides-- > 0) {
-                int rgb;
-                if ((rgb = (uint32_t)texels[(curV & 0x3f80) + (curU >> 7)] >> shadeShift) != 0) {
-                    dst[offset] = rgb;
-                }
-
-                offset++;
-                curU += stepU;
-                curV += stepV;
-            }
-        }
+        g_pix3d_spans->texture_transparent(dst + offset + xA, xB - xA, texels, &texture);
     }
 }
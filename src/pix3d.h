@@ -11,6 +11,8 @@ typedef struct {
     bool clipX;
     bool opaque;
     int alpha;
+    // texel offset of the texture being drawn (texelScroll of it)
+    int scroll;
     int center_x;
     int center_y;
     int *line_offset;
@@ -28,7 +30,14 @@ typedef struct {
     bool *textureHasTransparency;
     int *textureColors;
     int **activeTexels;
+    // texel offset added to v where a texture scrolled since its texels were built
+    int *texelScroll;
     int *textureCycle;
+    // textures holding texels, most recently used first (-1 ends the list)
+    int *textureLruPrev;
+    int *textureLruNext;
+    int textureLruHead;
+    int textureLruTail;
     int *palette;
     int **texturePalettes;
 
@@ -45,6 +54,7 @@ void pix3d_init_pool(int size);
 void pix3d_unpack_textures(Jagfile *jag);
 int pix3d_get_average_texture_rgb(int id);
 void pix3d_push_texture(int id);
+void pix3d_scroll_texture(int id, int rows);
 void pix3d_set_brightness(double brightness);
 int pix3d_set_gamma(int rgb, double gamma);
 
@@ -0,0 +1,438 @@
+/*******************************************************************************
+ * PIX3D_BIN.C - Binned, Multithreaded Scene Rasterization Implementation
+ *******************************************************************************
+ *
+ * See pix3d_bin.h for the design.
+ *
+ * ONE FLUSH:
+ *
+ *   game thread                         worker k
+ *   ───────────                         ────────
+ *   next = 0                            lock
+ *   lock                                wait until generation != seen
+ *   generation++, pending = N-1         unlock
+ *   broadcast wake ──────────────────→  claim bands, draw them
+ *   unlock                              lock
+ *   claim bands, draw them              pending-- → 0? signal done
+ *   lock                                (back to waiting)
+ *   wait until pending == 0  ←────────
+ *   unlock, empty the bands
+ *
+ ******************************************************************************/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pix2d.h"
+#include "pix3d.h"
+#include "pix3d_bin.h"
+
+extern Pix2D _Pix2D;
+extern Pix3D _Pix3D;
+
+bool g_pix3d_binning = false;
+
+#if (defined(__linux__) || defined(__APPLE__) || defined(__FreeBSD__)) && !defined(__EMSCRIPTEN__)
+
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+
+enum {
+    BIN_GOURAUD,
+    BIN_FLAT,
+    BIN_TEXTURE
+};
+
+/*
+ * BinCommand - One recorded triangle
+ *
+ * color holds colorA-C (Gouraud), the rgb (flat) or shadeA-C (textured);
+ * origin holds originX ... tzC of a textured face.
+ */
+typedef struct {
+    int type;
+    int alpha;
+    bool clipX;
+    bool opaque;
+    int scroll;
+    int x[3];
+    int y[3];
+    int color[3];
+    int origin[9];
+    int *texels;
+} BinCommand;
+
+/*
+ * BinBand - Commands touching one band of rows, in the order recorded
+ */
+typedef struct {
+    int *commands;
+    int count;
+    int capacity;
+} BinBand;
+
+static struct {
+    BinCommand *commands;       /* PIX3D_BIN_MAX_COMMANDS */
+    int count;
+    BinBand *bands;
+    int band_count;             /* Bands of the current target */
+    int band_capacity;
+    int width;                  /* Target's row stride */
+    int bottom;                 /* Target's rows drawn: [0, bottom) */
+
+    int next;                   /* Next unclaimed band (atomic) */
+    int generation;             /* Bumped once per flush */
+    int pending;                /* Workers still on this generation */
+    bool running;
+    int thread_count;           /* Threads including the caller */
+    pthread_t threads[PIX3D_BIN_MAX_THREADS];
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;        /* New generation / stop */
+    pthread_cond_t done;        /* pending reached 0 */
+
+    unsigned long long flushes;
+    unsigned long long recorded;
+} _Bins;
+
+/*
+ * bin_draw_band - Replay one band's commands on its rows only
+ */
+static void bin_draw_band(int index) {
+    const BinBand *band = &_Bins.bands[index];
+    Pix3DRaster r;
+    r.top = index == 0 ? 0 : index * PIX3D_BIN_ROWS * _Bins.width;
+    r.bottom = index == _Bins.band_count - 1 ? _Bins.bottom * _Bins.width : (index + 1) * PIX3D_BIN_ROWS * _Bins.width;
+
+    for (int i = 0; i < band->count; i++) {
+        const BinCommand *c = &_Bins.commands[band->commands[i]];
+        r.alpha = c->alpha;
+        r.clipX = c->clipX;
+        r.opaque = c->opaque;
+        r.scroll = c->scroll;
+
+        switch (c->type) {
+        case BIN_GOURAUD:
+            pix3d_draw_gouraud(&r, c->x[0], c->x[1], c->x[2], c->y[0], c->y[1], c->y[2], c->color[0], c->color[1], c->color[2]);
+            break;
+        case BIN_FLAT:
+            pix3d_draw_flat(&r, c->x[0], c->x[1], c->x[2], c->y[0], c->y[1], c->y[2], c->color[0]);
+            break;
+        default:
+            pix3d_draw_texture(&r, c->x[0], c->x[1], c->x[2], c->y[0], c->y[1], c->y[2], c->color[0], c->color[1], c->color[2],
+                               c->origin[0], c->origin[1], c->origin[2], c->origin[3], c->origin[4], c->origin[5], c->origin[6], c->origin[7], c->origin[8], c->texels);
+            break;
+        }
+    }
+}
+
+/*
+ * bin_drain - Claim bands until none are left
+ */
+static void bin_drain(void) {
+    for (;;) {
+        int band = __atomic_fetch_add(&_Bins.next, 1, __ATOMIC_RELAXED);
+        if (band >= _Bins.band_count) {
+            break;
+        }
+        bin_draw_band(band);
+    }
+}
+
+static void *bin_thread_main(void *arg) {
+    (void)arg;
+    int seen = 0;
+
+    pthread_mutex_lock(&_Bins.mutex);
+    for (;;) {
+        while (_Bins.generation == seen && _Bins.running) {
+            pthread_cond_wait(&_Bins.wake, &_Bins.mutex);
+        }
+        if (!_Bins.running) {
+            break;
+        }
+        seen = _Bins.generation;
+        pthread_mutex_unlock(&_Bins.mutex);
+
+        bin_drain();
+
+        pthread_mutex_lock(&_Bins.mutex);
+        if (--_Bins.pending == 0) {
+            pthread_cond_signal(&_Bins.done);
+        }
+    }
+    pthread_mutex_unlock(&_Bins.mutex);
+    return NULL;
+}
+
+bool pix3d_bin_start(int threads) {
+    if (_Bins.running) {
+        return true;
+    }
+
+    /* More threads than cores only adds switching */
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus > 0 && threads > cpus) {
+        threads = (int)cpus;
+    }
+    if (threads > PIX3D_BIN_MAX_THREADS) {
+        threads = PIX3D_BIN_MAX_THREADS;
+    }
+    if (threads < 2) {
+        fprintf(stderr, "WARNING: Binned rendering needs 2+ threads, triangles stay serial\n");
+        return false;
+    }
+
+    _Bins.commands = malloc(PIX3D_BIN_MAX_COMMANDS * sizeof(BinCommand));
+    if (!_Bins.commands || pthread_mutex_init(&_Bins.mutex, NULL) != 0) {
+        free(_Bins.commands);
+        _Bins.commands = NULL;
+        fprintf(stderr, "WARNING: Binned rendering not started, triangles stay serial\n");
+        return false;
+    }
+    pthread_cond_init(&_Bins.wake, NULL);
+    pthread_cond_init(&_Bins.done, NULL);
+    _Bins.running = true;
+    _Bins.thread_count = 1;     /* The caller draws bands too */
+
+    /* Signals stay on the main thread */
+    sigset_t all, previous;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &previous);
+    for (int i = 1; i < threads; i++) {
+        if (pthread_create(&_Bins.threads[_Bins.thread_count], NULL, bin_thread_main, NULL) != 0) {
+            break;
+        }
+        _Bins.thread_count++;
+    }
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+    if (_Bins.thread_count < 2) {
+        _Bins.running = false;
+        pthread_mutex_destroy(&_Bins.mutex);
+        pthread_cond_destroy(&_Bins.wake);
+        pthread_cond_destroy(&_Bins.done);
+        free(_Bins.commands);
+        _Bins.commands = NULL;
+        fprintf(stderr, "WARNING: Raster threads not started, triangles stay serial\n");
+        return false;
+    }
+
+    printf("Binned rendering started (%d threads, %d rows per band)\n", _Bins.thread_count, PIX3D_BIN_ROWS);
+    return true;
+}
+
+void pix3d_bin_stop(void) {
+    if (!_Bins.running) {
+        return;
+    }
+    pix3d_bin_end();
+
+    pthread_mutex_lock(&_Bins.mutex);
+    _Bins.running = false;
+    pthread_cond_broadcast(&_Bins.wake);
+    pthread_mutex_unlock(&_Bins.mutex);
+    for (int i = 1; i < _Bins.thread_count; i++) {
+        pthread_join(_Bins.threads[i], NULL);
+    }
+
+    printf("Binned rendering stopped (%llu triangles, %llu flushes)\n", _Bins.recorded, _Bins.flushes);
+    pthread_mutex_destroy(&_Bins.mutex);
+    pthread_cond_destroy(&_Bins.wake);
+    pthread_cond_destroy(&_Bins.done);
+    for (int i = 0; i < _Bins.band_capacity; i++) {
+        free(_Bins.bands[i].commands);
+    }
+    free(_Bins.bands);
+    free(_Bins.commands);
+    memset(&_Bins, 0, sizeof(_Bins));
+}
+
+void pix3d_bin_begin(void) {
+    if (!_Bins.running || g_pix3d_binning || _Pix2D.bottom <= 0) {
+        return;
+    }
+
+    int bands = (_Pix2D.bottom + PIX3D_BIN_ROWS - 1) / PIX3D_BIN_ROWS;
+    if (bands > _Bins.band_capacity) {
+        BinBand *grown = realloc(_Bins.bands, bands * sizeof(BinBand));
+        if (!grown) {
+            return;     /* Draw this frame serially */
+        }
+        memset(grown + _Bins.band_capacity, 0, (bands - _Bins.band_capacity) * sizeof(BinBand));
+        _Bins.bands = grown;
+        _Bins.band_capacity = bands;
+    }
+    _Bins.band_count = bands;
+    _Bins.width = _Pix2D.width;
+    _Bins.bottom = _Pix2D.bottom;
+    g_pix3d_binning = true;
+}
+
+void pix3d_bin_end(void) {
+    if (!g_pix3d_binning) {
+        return;
+    }
+    pix3d_bin_flush();
+    g_pix3d_binning = false;
+}
+
+void pix3d_bin_flush(void) {
+    if (_Bins.count == 0) {
+        return;
+    }
+
+    _Bins.next = 0;
+    pthread_mutex_lock(&_Bins.mutex);
+    _Bins.generation++;
+    _Bins.pending = _Bins.thread_count - 1;
+    pthread_cond_broadcast(&_Bins.wake);
+    pthread_mutex_unlock(&_Bins.mutex);
+
+    bin_drain();
+
+    pthread_mutex_lock(&_Bins.mutex);
+    while (_Bins.pending > 0) {
+        pthread_cond_wait(&_Bins.done, &_Bins.mutex);
+    }
+    pthread_mutex_unlock(&_Bins.mutex);
+
+    for (int i = 0; i < _Bins.band_count; i++) {
+        _Bins.bands[i].count = 0;
+    }
+    _Bins.count = 0;
+    _Bins.flushes++;
+}
+
+/*
+ * bin_record - Claim a command for a triangle and file it in its bands
+ *
+ * @return  The command to fill in, or NULL if it draws no row
+ */
+static BinCommand *bin_record(int type, int yA, int yB, int yC) {
+    int top = yA < yB ? (yA < yC ? yA : yC) : (yB < yC ? yB : yC);
+    int bottom = yA > yB ? (yA > yC ? yA : yC) : (yB > yC ? yB : yC);
+    if (top >= _Bins.bottom || bottom < 0) {
+        return NULL;
+    }
+    if (top < 0) {
+        top = 0;
+    }
+    if (bottom >= _Bins.bottom) {
+        bottom = _Bins.bottom - 1;
+    }
+
+    if (_Bins.count == PIX3D_BIN_MAX_COMMANDS) {
+        pix3d_bin_flush();
+    }
+    int index = _Bins.count;
+    int first = top / PIX3D_BIN_ROWS;
+    int last = bottom / PIX3D_BIN_ROWS;
+
+    for (int b = first; b <= last; b++) {
+        BinBand *band = &_Bins.bands[b];
+        if (band->count == band->capacity) {
+            int capacity = band->capacity ? band->capacity * 2 : 256;
+            int *grown = realloc(band->commands, capacity * sizeof(int));
+            if (!grown) {
+                return NULL;    /* Out of memory: the face is lost, not misdrawn */
+            }
+            band->commands = grown;
+            band->capacity = capacity;
+        }
+    }
+    for (int b = first; b <= last; b++) {
+        BinBand *band = &_Bins.bands[b];
+        band->commands[band->count++] = index;
+    }
+
+    BinCommand *c = &_Bins.commands[_Bins.count++];
+    c->type = type;
+    c->alpha = _Pix3D.alpha;
+    c->clipX = _Pix3D.clipX;
+    c->opaque = _Pix3D.opaque;
+    c->scroll = _Pix3D.scroll;
+    c->y[0] = yA;
+    c->y[1] = yB;
+    c->y[2] = yC;
+    _Bins.recorded++;
+    return c;
+}
+
+void pix3d_bin_gouraud(int xA, int xB, int xC, int yA, int yB, int yC, int colorA, int colorB, int colorC) {
+    BinCommand *c = bin_record(BIN_GOURAUD, yA, yB, yC);
+    if (!c) {
+        return;
+    }
+    c->x[0] = xA;
+    c->x[1] = xB;
+    c->x[2] = xC;
+    c->color[0] = colorA;
+    c->color[1] = colorB;
+    c->color[2] = colorC;
+}
+
+void pix3d_bin_flat(int xA, int xB, int xC, int yA, int yB, int yC, int color) {
+    BinCommand *c = bin_record(BIN_FLAT, yA, yB, yC);
+    if (!c) {
+        return;
+    }
+    c->x[0] = xA;
+    c->x[1] = xB;
+    c->x[2] = xC;
+    c->color[0] = color;
+}
+
+void pix3d_bin_texture(int xA, int xB, int xC, int yA, int yB, int yC, int shadeA, int shadeB, int shadeC, int originX, int originY, int originZ, int txB, int txC, int tyB, int tyC, int tzB, int tzC, int *texels) {
+    BinCommand *c = bin_record(BIN_TEXTURE, yA, yB, yC);
+    if (!c) {
+        return;
+    }
+    c->x[0] = xA;
+    c->x[1] = xB;
+    c->x[2] = xC;
+    c->color[0] = shadeA;
+    c->color[1] = shadeB;
+    c->color[2] = shadeC;
+    c->origin[0] = originX;
+    c->origin[1] = originY;
+    c->origin[2] = originZ;
+    c->origin[3] = txB;
+    c->origin[4] = txC;
+    c->origin[5] = tyB;
+    c->origin[6] = tyC;
+    c->origin[7] = tzB;
+    c->origin[8] = tzC;
+    c->texels = texels;
+}
+
+#else
+
+/*
+ * No POSIX threads (Windows, Emscripten, consoles): nothing is recorded,
+ * g_pix3d_binning stays false and every triangle is drawn at once.
+ */
+bool pix3d_bin_start(int threads) {
+    (void)threads;
+    fprintf(stderr, "WARNING: Binned rendering not supported on this platform, triangles stay serial\n");
+    return false;
+}
+void pix3d_bin_stop(void) {}
+void pix3d_bin_begin(void) {}
+void pix3d_bin_end(void) {}
+void pix3d_bin_flush(void) {}
+void pix3d_bin_gouraud(int xA, int xB, int xC, int yA, int yB, int yC, int colorA, int colorB, int colorC) {
+    (void)xA; (void)xB; (void)xC; (void)yA; (void)yB; (void)yC; (void)colorA; (void)colorB; (void)colorC;
+}
+void pix3d_bin_flat(int xA, int xB, int xC, int yA, int yB, int yC, int color) {
+    (void)xA; (void)xB; (void)xC; (void)yA; (void)yB; (void)yC; (void)color;
+}
+void pix3d_bin_texture(int xA, int xB, int xC, int yA, int yB, int yC, int shadeA, int shadeB, int shadeC, int originX, int originY, int originZ, int txB, int txC, int tyB, int tyC, int tzB, int tzC, int *texels) {
+    (void)xA; (void)xB; (void)xC; (void)yA; (void)yB; (void)yC; (void)shadeA; (void)shadeB; (void)shadeC;
+    (void)originX; (void)originY; (void)originZ; (void)txB; (void)txC; (void)tyB; (void)tyC; (void)tzB; (void)tzC; (void)texels;
+}
+
+#endif
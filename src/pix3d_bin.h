@@ -0,0 +1,157 @@
+/*******************************************************************************
+ * PIX3D_BIN.H - Binned, Multithreaded Scene Rasterization
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Deferred rendering: record draw commands now, rasterize them later
+ *   - Screen-space binning that keeps painter's order inside every bin
+ *   - Parallel rasterization with no locks on the frame buffer
+ *   - Flushing early when a recorded command's inputs are about to change
+ *
+ * THE PROBLEM:
+ *
+ * world3d_draw() walks the scene back to front and rasterizes each face
+ * the moment it reaches it, on the one thread that runs the client:
+ *
+ *   world3d_draw ── tile ── model ── face ── gouraudTriangle ── spans
+ *                                            (one core, every pixel)
+ *
+ * At 512x334 that is fine. In a resizable SDL2/SDL3 window at 1080p or
+ * more, the spans are most of the frame, and seven of eight cores idle.
+ * Faces cannot simply be handed out to threads: they overlap, and the
+ * renderer has no depth buffer - the last face drawn over a pixel wins.
+ *
+ * THE SOLUTION - RECORD INTO BANDS, RASTERIZE BANDS IN PARALLEL:
+ *
+ *   RECORD (game thread, during world3d_draw)
+ *     gouraudTriangle / flatTriangle / textureTriangle store their
+ *     arguments and the state they read (alpha, clipX, opaque, texels)
+ *     as a command, and append its index to every band it touches:
+ *
+ *       rows   0-15   band 0   [ 3 ]
+ *       rows  16-31   band 1   [ 0  3  7 ]        indices ascend, so each
+ *       rows  32-47   band 2   [ 0  1  2  7 ]     band replays its faces
+ *       ...                                       in painter's order
+ *
+ *   RASTERIZE (pix3d_bin_end, all threads)
+ *     Threads claim whole bands from a shared counter (as cache_warm and
+ *     update_pool claim work) and replay the band's commands, drawing only
+ *     the band's rows. Two bands never share a pixel, so no thread waits
+ *     on another until the frame is done.
+ *
+ * WHY BANDS, NOT SQUARE TILES:
+ *   The rasterizer draws whole scanlines, and a scanline cut at a tile
+ *   edge would not come out the same: the jagged Gouraud mode takes one
+ *   palette entry per 4 pixels counted from the span's start, and
+ *   textures divide out perspective every 8. A band replays a face's edge
+ *   walk unchanged and skips the rows outside it, so every pixel gets the
+ *   value the serial renderer gives it - binning is invisible on screen.
+ *   The cost is walking a tall face's edges down to each band it spans
+ *   (the walk stops at the band's last row): a few adds per row against
+ *   a whole span of pixels.
+ *
+ * FLUSHING EARLY:
+ *   A textured command keeps a pointer to its texture's texels. When the
+ *   texel pool is empty, loading another texture evicts the least recently
+ *   used one and reuses its buffer - which recorded commands may still
+ *   point at. textureTriangle() therefore rasterizes everything recorded
+ *   so far before such a load. A full command buffer flushes the same way.
+ *   Either way the frame stays in order: a flush draws all earlier faces
+ *   before any later one is recorded.
+ *
+ * WHAT IS SHARED, AND WHY IT IS SAFE:
+ *   While bands are drawn, the game thread is inside pix3d_bin_flush()
+ *   and nothing changes the palette, texels, reciprocal tables or the
+ *   _Pix2D target; workers only read them. Each worker writes the pixels
+ *   of the bands it claimed.
+ *
+ * ENABLING:
+ *   Off by default. render_threads=N in config.ini starts N threads
+ *   (capped at the core count); world3d_draw() brackets the scene with
+ *   pix3d_bin_begin() / pix3d_bin_end(). Models drawn outside the scene
+ *   (interfaces, item icons) are rasterized at once, as before.
+ *
+ * PLATFORM:
+ *   POSIX threads on Linux, macOS and the BSDs. Elsewhere (Windows,
+ *   Emscripten, the consoles) pix3d_bin_start() fails and every triangle
+ *   is drawn serially.
+ *
+ ******************************************************************************/
+
+#ifndef PIX3D_BIN_H
+#define PIX3D_BIN_H
+
+#include <stdbool.h>
+
+/* Rows per band */
+#define PIX3D_BIN_ROWS 16
+
+/* Commands recorded before a flush is forced */
+#define PIX3D_BIN_MAX_COMMANDS 16384
+
+/* Upper bound on threads, including the game thread */
+#define PIX3D_BIN_MAX_THREADS 16
+
+/*
+ * Pix3DRaster - What a triangle's rasterizer reads besides its arguments
+ *
+ * top and bottom are pixel offsets (y * width): rows whose offset falls
+ * outside [top, bottom) are walked but not drawn.
+ */
+typedef struct {
+    int alpha;
+    bool clipX;
+    bool opaque;
+    int scroll;     /* texture: texel offset added to v (pix3d_scroll_texture) */
+    int top;
+    int bottom;
+} Pix3DRaster;
+
+/* Rasterizers behind gouraudTriangle() etc. (pix3d.c) */
+void pix3d_draw_gouraud(const Pix3DRaster *r, int xA, int xB, int xC, int yA, int yB, int yC, int colorA, int colorB, int colorC);
+void pix3d_draw_flat(const Pix3DRaster *r, int xA, int xB, int xC, int yA, int yB, int yC, int color);
+void pix3d_draw_texture(const Pix3DRaster *r, int xA, int xB, int xC, int yA, int yB, int yC, int shadeA, int shadeB, int shadeC, int originX, int originY, int originZ, int txB, int txC, int tyB, int tyC, int tzB, int tzC, int *texels);
+
+/* Set between pix3d_bin_begin() and pix3d_bin_end() */
+extern bool g_pix3d_binning;
+
+/*
+ * pix3d_bin_start - Start the raster threads
+ *
+ * @param threads  Threads including the caller (capped at the core count)
+ * @return         false if fewer than 2 could run; triangles stay serial
+ */
+bool pix3d_bin_start(int threads);
+
+/*
+ * pix3d_bin_stop - Stop the raster threads (flushes anything recorded)
+ */
+void pix3d_bin_stop(void);
+
+/*
+ * pix3d_bin_begin - Record triangles from here on (no-op unless started)
+ *
+ * Bands are cut for the current _Pix2D target, which must not change
+ * until pix3d_bin_end().
+ */
+void pix3d_bin_begin(void);
+
+/*
+ * pix3d_bin_end - Rasterize everything recorded and stop recording
+ */
+void pix3d_bin_end(void);
+
+/*
+ * pix3d_bin_flush - Rasterize everything recorded so far, keep recording
+ *
+ * COMPLEXITY: O(commands x bands each spans) spread over the threads
+ */
+void pix3d_bin_flush(void);
+
+/* Record one triangle with the current _Pix3D alpha, clipX and opaque */
+void pix3d_bin_gouraud(int xA, int xB, int xC, int yA, int yB, int yC, int colorA, int colorB, int colorC);
+void pix3d_bin_flat(int xA, int xB, int xC, int yA, int yB, int yC, int color);
+void pix3d_bin_texture(int xA, int xB, int xC, int yA, int yB, int yC, int shadeA, int shadeB, int shadeC, int originX, int originY, int originZ, int txB, int txC, int tyB, int tyC, int tzB, int tzC, int *texels);
+
+#endif /* PIX3D_BIN_H */
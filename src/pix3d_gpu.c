@@ -0,0 +1,780 @@
+/*******************************************************************************
+ * PIX3D_GPU.C - OpenGL ES 2 Scene Rasterization Implementation
+ *******************************************************************************
+ *
+ * See pix3d_gpu.h for the design.
+ *
+ * ONE FLUSH:
+ *
+ *   bind the offscreen target, scissor to _Pix2D's clip
+ *   first flush of the frame? clear colour and depth : clear depth
+ *   copy a changed palette / textures
+ *   colour batch ──→ texture batches ──→ alpha batch (blend, no depth writes)
+ *   empty the batches, number triangles from 0 again
+ *
+ * pix3d_gpu_end() flushes and reads the clip rectangle back into _Pix2D.
+ *
+ ******************************************************************************/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pix2d.h"
+#include "pix3d.h"
+#include "pix3d_gpu.h"
+
+extern Pix2D _Pix2D;
+extern Pix3D _Pix3D;
+
+bool g_pix3d_gpu = false;
+
+#ifdef PIX3D_GPU
+
+#if defined(SDL) && SDL == 3
+#include <SDL3/SDL_opengles2.h>
+#elif defined(SDL) && SDL == 2
+#include "SDL_opengles2.h"
+#else
+#include <GLES2/gl2.h>
+#endif
+
+/* As many textures as pix3d has */
+#define GPU_TEXTURES 50
+
+/*
+ * Every GL ES 2 function used, loaded through the platform's proc
+ * (SDL_GL_GetProcAddress, eglGetProcAddress): no link-time GL library
+ */
+#define GPU_GL_FUNCTIONS(X)                                       \
+    X(PFNGLACTIVETEXTUREPROC, ActiveTexture)                      \
+    X(PFNGLATTACHSHADERPROC, AttachShader)                        \
+    X(PFNGLBINDATTRIBLOCATIONPROC, BindAttribLocation)            \
+    X(PFNGLBINDBUFFERPROC, BindBuffer)                            \
+    X(PFNGLBINDFRAMEBUFFERPROC, BindFramebuffer)                  \
+    X(PFNGLBINDRENDERBUFFERPROC, BindRenderbuffer)                \
+    X(PFNGLBINDTEXTUREPROC, BindTexture)                          \
+    X(PFNGLBLENDFUNCPROC, BlendFunc)                              \
+    X(PFNGLBUFFERDATAPROC, BufferData)                            \
+    X(PFNGLCHECKFRAMEBUFFERSTATUSPROC, CheckFramebufferStatus)    \
+    X(PFNGLCLEARPROC, Clear)                                      \
+    X(PFNGLCLEARCOLORPROC, ClearColor)                            \
+    X(PFNGLCLEARDEPTHFPROC, ClearDepthf)                          \
+    X(PFNGLCOMPILESHADERPROC, CompileShader)                      \
+    X(PFNGLCREATEPROGRAMPROC, CreateProgram)                      \
+    X(PFNGLCREATESHADERPROC, CreateShader)                        \
+    X(PFNGLDELETEBUFFERSPROC, DeleteBuffers)                      \
+    X(PFNGLDELETEFRAMEBUFFERSPROC, DeleteFramebuffers)            \
+    X(PFNGLDELETEPROGRAMPROC, DeleteProgram)                      \
+    X(PFNGLDELETERENDERBUFFERSPROC, DeleteRenderbuffers)          \
+    X(PFNGLDELETESHADERPROC, DeleteShader)                        \
+    X(PFNGLDELETETEXTURESPROC, DeleteTextures)                    \
+    X(PFNGLDEPTHFUNCPROC, DepthFunc)                              \
+    X(PFNGLDEPTHMASKPROC, DepthMask)                              \
+    X(PFNGLDISABLEPROC, Disable)                                  \
+    X(PFNGLDISABLEVERTEXATTRIBARRAYPROC, DisableVertexAttribArray) \
+    X(PFNGLDRAWARRAYSPROC, DrawArrays)                            \
+    X(PFNGLENABLEPROC, Enable)                                    \
+    X(PFNGLENABLEVERTEXATTRIBARRAYPROC, EnableVertexAttribArray)  \
+    X(PFNGLFRAMEBUFFERRENDERBUFFERPROC, FramebufferRenderbuffer)  \
+    X(PFNGLFRAMEBUFFERTEXTURE2DPROC, FramebufferTexture2D)        \
+    X(PFNGLGENBUFFERSPROC, GenBuffers)                            \
+    X(PFNGLGENFRAMEBUFFERSPROC, GenFramebuffers)                  \
+    X(PFNGLGENRENDERBUFFERSPROC, GenRenderbuffers)                \
+    X(PFNGLGENTEXTURESPROC, GenTextures)                          \
+    X(PFNGLGETPROGRAMINFOLOGPROC, GetProgramInfoLog)              \
+    X(PFNGLGETPROGRAMIVPROC, GetProgramiv)                        \
+    X(PFNGLGETSHADERINFOLOGPROC, GetShaderInfoLog)                \
+    X(PFNGLGETSHADERIVPROC, GetShaderiv)                          \
+    X(PFNGLGETSTRINGPROC, GetString)                              \
+    X(PFNGLGETUNIFORMLOCATIONPROC, GetUniformLocation)            \
+    X(PFNGLLINKPROGRAMPROC, LinkProgram)                          \
+    X(PFNGLPIXELSTOREIPROC, PixelStorei)                          \
+    X(PFNGLREADPIXELSPROC, ReadPixels)                            \
+    X(PFNGLRENDERBUFFERSTORAGEPROC, RenderbufferStorage)          \
+    X(PFNGLSCISSORPROC, Scissor)                                  \
+    X(PFNGLSHADERSOURCEPROC, ShaderSource)                        \
+    X(PFNGLTEXIMAGE2DPROC, TexImage2D)                            \
+    X(PFNGLTEXPARAMETERIPROC, TexParameteri)                      \
+    X(PFNGLUNIFORM1IPROC, Uniform1i)                              \
+    X(PFNGLUNIFORM2FPROC, Uniform2f)                              \
+    X(PFNGLUSEPROGRAMPROC, UseProgram)                            \
+    X(PFNGLVERTEXATTRIBPOINTERPROC, VertexAttribPointer)          \
+    X(PFNGLVIEWPORTPROC, Viewport)
+
+#define GPU_GL_FIELD(type, name) type name;
+static struct {
+    GPU_GL_FUNCTIONS(GPU_GL_FIELD)
+} gl;
+#undef GPU_GL_FIELD
+
+/* Vertex attributes, the same slots in both programs */
+enum {
+    ATTRIB_POSITION = 0,
+    ATTRIB_INDEX,           /* colour: palette index, -1 for rgba */
+    ATTRIB_RGBA,            /* colour: flat rgb, and alpha of both */
+    ATTRIB_UVW = 1,         /* texture: u, v, w plane values */
+    ATTRIB_SHADE = 2        /* texture: shade */
+};
+
+/*
+ * ColourVertex - Flat and Gouraud faces
+ */
+typedef struct {
+    float x, y, z;
+    float index;
+    uint8_t rgba[4];
+} ColourVertex;
+
+/*
+ * TextureVertex - Textured faces
+ */
+typedef struct {
+    float x, y, z;
+    float u, v, w;
+    float shade;
+} TextureVertex;
+
+typedef struct {
+    void *data;
+    int count;      /* Vertices */
+    int capacity;
+} VertexList;
+
+typedef struct {
+    GLuint program;
+    GLint size;     /* u_size: target width, height */
+    GLint sampler;
+} GpuProgram;
+
+static struct {
+    bool running;
+    Pix3DGpuContext context;
+    const char *renderer;
+
+    GpuProgram colour;
+    GpuProgram texture;
+    GLuint buffer;
+    GLuint framebuffer;
+    GLuint target;          /* Colour texture of the framebuffer */
+    GLuint depth;
+    int width, height;      /* Of the target */
+    GLuint palette;
+    bool palette_stale;
+
+    /* Per pix3d texture: a copy of its plane 0 texels, and the GL texture */
+    GLuint textures[GPU_TEXTURES];
+    int *texels[GPU_TEXTURES];
+    int texel_size[GPU_TEXTURES];
+    bool texel_stale[GPU_TEXTURES];     /* Copy texels on next use */
+    bool texel_upload[GPU_TEXTURES];    /* Copied, not yet on the GPU */
+
+    VertexList colour_batch;
+    VertexList alpha_batch;
+    VertexList texture_batch[GPU_TEXTURES];
+    int sequence;           /* Triangles since the depth buffer was cleared */
+    bool drawn;             /* Something flushed this frame: read it back */
+    uint32_t *readback;
+    int readback_capacity;
+
+    unsigned long long recorded;
+    unsigned long long flushes;
+    unsigned long long draws;
+} _Gpu;
+
+static const char *COLOUR_VERTEX =
+    "attribute vec3 a_position;\n"
+    "attribute float a_index;\n"
+    "attribute vec4 a_rgba;\n"
+    "uniform vec2 u_size;\n"
+    "varying float v_index;\n"
+    "varying vec4 v_rgba;\n"
+    "void main() {\n"
+    "    v_index = a_index;\n"
+    "    v_rgba = a_rgba;\n"
+    "    gl_Position = vec4((a_position.xy + 0.5) * 2.0 / u_size - 1.0, a_position.z * 2.0 - 1.0, 1.0);\n"
+    "}\n";
+
+static const char *COLOUR_FRAGMENT =
+    "#ifdef GL_FRAGMENT_PRECISION_HIGH\n"
+    "precision highp float;\n"
+    "#else\n"
+    "precision mediump float;\n"
+    "#endif\n"
+    "uniform sampler2D u_palette;\n"
+    "varying float v_index;\n"
+    "varying vec4 v_rgba;\n"
+    "void main() {\n"
+    "    if (v_index < 0.0) {\n"
+    "        gl_FragColor = v_rgba;\n"
+    "        return;\n"
+    "    }\n"
+    "    float i = floor(v_index);\n"
+    "    vec2 at = (vec2(mod(i, 256.0), floor(i / 256.0)) + 0.5) / 256.0;\n"
+    "    gl_FragColor = vec4(texture2D(u_palette, at).rgb, v_rgba.a);\n"
+    "}\n";
+
+static const char *TEXTURE_VERTEX =
+    "attribute vec3 a_position;\n"
+    "attribute vec3 a_uvw;\n"
+    "attribute float a_shade;\n"
+    "uniform vec2 u_size;\n"
+    "varying vec3 v_uvw;\n"
+    "varying float v_shade;\n"
+    "void main() {\n"
+    "    v_uvw = a_uvw;\n"
+    "    v_shade = a_shade;\n"
+    "    gl_Position = vec4((a_position.xy + 0.5) * 2.0 / u_size - 1.0, a_position.z * 2.0 - 1.0, 1.0);\n"
+    "}\n";
+
+/* The shade picks a darker copy (bits 4-5) and halves (bits 6+), as textureRaster */
+static const char *TEXTURE_FRAGMENT =
+    "#ifdef GL_FRAGMENT_PRECISION_HIGH\n"
+    "precision highp float;\n"
+    "#else\n"
+    "precision mediump float;\n"
+    "#endif\n"
+    "uniform sampler2D u_texture;\n"
+    "varying vec3 v_uvw;\n"
+    "varying float v_shade;\n"
+    "void main() {\n"
+    "    vec4 texel = texture2D(u_texture, v_uvw.xy / v_uvw.z);\n"
+    "    if (texel.a < 0.5) {\n"
+    "        discard;\n"
+    "    }\n"
+    "    float copy = mod(floor(v_shade / 16.0), 4.0);\n"
+    "    float halve = floor(v_shade / 64.0);\n"
+    "    gl_FragColor = vec4(texel.rgb * (1.0 - copy * 0.125) / exp2(halve), 1.0);\n"
+    "}\n";
+
+static GLuint gpu_shader(GLenum type, const char *source) {
+    GLuint shader = gl.CreateShader(type);
+    gl.ShaderSource(shader, 1, &source, NULL);
+    gl.CompileShader(shader);
+    GLint ok = 0;
+    gl.GetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+    if (!ok) {
+        char log[512] = {0};
+        gl.GetShaderInfoLog(shader, sizeof(log) - 1, NULL, log);
+        fprintf(stderr, "WARNING: GPU shader did not compile: %s\n", log);
+        gl.DeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+static bool gpu_program(GpuProgram *p, const char *vertex, const char *fragment, const char *attrib1, const char *attrib2, const char *sampler) {
+    GLuint vs = gpu_shader(GL_VERTEX_SHADER, vertex);
+    GLuint fs = gpu_shader(GL_FRAGMENT_SHADER, fragment);
+    if (!vs || !fs) {
+        return false;
+    }
+    p->program = gl.CreateProgram();
+    gl.AttachShader(p->program, vs);
+    gl.AttachShader(p->program, fs);
+    gl.BindAttribLocation(p->program, ATTRIB_POSITION, "a_position");
+    gl.BindAttribLocation(p->program, 1, attrib1);
+    gl.BindAttribLocation(p->program, 2, attrib2);
+    gl.LinkProgram(p->program);
+    gl.DeleteShader(vs);
+    gl.DeleteShader(fs);
+
+    GLint ok = 0;
+    gl.GetProgramiv(p->program, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        char log[512] = {0};
+        gl.GetProgramInfoLog(p->program, sizeof(log) - 1, NULL, log);
+        fprintf(stderr, "WARNING: GPU program did not link: %s\n", log);
+        return false;
+    }
+    p->size = gl.GetUniformLocation(p->program, "u_size");
+    p->sampler = gl.GetUniformLocation(p->program, sampler);
+    return true;
+}
+
+static void gpu_texture_parameters(GLenum wrap_s, GLenum wrap_t) {
+    gl.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    gl.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    gl.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap_s);
+    gl.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap_t);
+}
+
+bool pix3d_gpu_start(const Pix3DGpuContext *context) {
+    if (_Gpu.running) {
+        return true;
+    }
+    if (!context || !context->proc) {
+        fprintf(stderr, "WARNING: No GL ES 2 context, the scene stays in software\n");
+        return false;
+    }
+    _Gpu.context = *context;
+    if (_Gpu.context.make_current) {
+        _Gpu.context.make_current();
+    }
+
+#define GPU_GL_LOAD(type, name)                                                  \
+    gl.name = (type)_Gpu.context.proc("gl" #name);                               \
+    if (!gl.name) {                                                              \
+        fprintf(stderr, "WARNING: GL ES 2 has no gl%s, the scene stays in software\n", #name); \
+        return false;                                                            \
+    }
+    GPU_GL_FUNCTIONS(GPU_GL_LOAD)
+#undef GPU_GL_LOAD
+
+    if (!gpu_program(&_Gpu.colour, COLOUR_VERTEX, COLOUR_FRAGMENT, "a_index", "a_rgba", "u_palette") ||
+        !gpu_program(&_Gpu.texture, TEXTURE_VERTEX, TEXTURE_FRAGMENT, "a_uvw", "a_shade", "u_texture")) {
+        pix3d_gpu_stop();
+        return false;
+    }
+
+    gl.GenBuffers(1, &_Gpu.buffer);
+    gl.GenFramebuffers(1, &_Gpu.framebuffer);
+    gl.GenTextures(1, &_Gpu.palette);
+    gl.GenTextures(GPU_TEXTURES, _Gpu.textures);
+    gl.BindTexture(GL_TEXTURE_2D, _Gpu.palette);
+    gpu_texture_parameters(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+    for (int id = 0; id < GPU_TEXTURES; id++) {
+        _Gpu.texel_stale[id] = true;
+    }
+    _Gpu.palette_stale = true;
+    _Gpu.running = true;
+
+    _Gpu.renderer = (const char *)gl.GetString(GL_RENDERER);
+    printf("GPU scene rendering started (%s)\n", _Gpu.renderer ? _Gpu.renderer : "unknown renderer");
+    return true;
+}
+
+void pix3d_gpu_stop(void) {
+    if (_Gpu.running) {
+        pix3d_gpu_end();
+        printf("GPU scene rendering stopped (%llu triangles, %llu flushes, %llu draw calls)\n", _Gpu.recorded, _Gpu.flushes, _Gpu.draws);
+    }
+    if (gl.DeleteProgram) {
+        if (_Gpu.context.make_current) {
+            _Gpu.context.make_current();
+        }
+        gl.DeleteProgram(_Gpu.colour.program);
+        gl.DeleteProgram(_Gpu.texture.program);
+        gl.DeleteBuffers(1, &_Gpu.buffer);
+        gl.DeleteFramebuffers(1, &_Gpu.framebuffer);
+        gl.DeleteTextures(1, &_Gpu.target);
+        gl.DeleteRenderbuffers(1, &_Gpu.depth);
+        gl.DeleteTextures(1, &_Gpu.palette);
+        gl.DeleteTextures(GPU_TEXTURES, _Gpu.textures);
+    }
+    for (int id = 0; id < GPU_TEXTURES; id++) {
+        free(_Gpu.texels[id]);
+        free(_Gpu.texture_batch[id].data);
+    }
+    free(_Gpu.colour_batch.data);
+    free(_Gpu.alpha_batch.data);
+    free(_Gpu.readback);
+    memset(&_Gpu, 0, sizeof(_Gpu));
+    memset(&gl, 0, sizeof(gl));
+}
+
+const char *pix3d_gpu_renderer(void) {
+    return _Gpu.running ? _Gpu.renderer : NULL;
+}
+
+/*
+ * gpu_target - Size the offscreen target to the bound pixmap
+ */
+static bool gpu_target(int width, int height) {
+    gl.BindFramebuffer(GL_FRAMEBUFFER, _Gpu.framebuffer);
+    if (width == _Gpu.width && height == _Gpu.height) {
+        return true;
+    }
+    gl.DeleteTextures(1, &_Gpu.target);
+    gl.DeleteRenderbuffers(1, &_Gpu.depth);
+
+    gl.GenTextures(1, &_Gpu.target);
+    gl.BindTexture(GL_TEXTURE_2D, _Gpu.target);
+    gpu_texture_parameters(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+    gl.TexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    gl.FramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _Gpu.target, 0);
+
+    /* 16 bits is all GL ES 2 promises, and enough for PIX3D_GPU_DEPTH_LEVELS */
+    gl.GenRenderbuffers(1, &_Gpu.depth);
+    gl.BindRenderbuffer(GL_RENDERBUFFER, _Gpu.depth);
+    gl.RenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT16, width, height);
+    gl.FramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, _Gpu.depth);
+
+    if (gl.CheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        fprintf(stderr, "WARNING: GPU target %dx%d incomplete, the scene stays in software\n", width, height);
+        _Gpu.width = 0;
+        _Gpu.height = 0;
+        return false;
+    }
+    _Gpu.width = width;
+    _Gpu.height = height;
+    return true;
+}
+
+/*
+ * gpu_upload_rgba - Copy 0xRRGGBB ints to a bound texture, alpha 0 where 0
+ */
+static void gpu_upload_rgba(const int *src, int width, int height) {
+    uint8_t *rgba = malloc((size_t)width * height * 4);
+    if (!rgba) {
+        return;
+    }
+    for (int i = 0; i < width * height; i++) {
+        int rgb = src[i];
+        rgba[i * 4 + 0] = rgb >> 16 & 0xff;
+        rgba[i * 4 + 1] = rgb >> 8 & 0xff;
+        rgba[i * 4 + 2] = rgb & 0xff;
+        rgba[i * 4 + 3] = rgb != 0 ? 0xff : 0;
+    }
+    gl.PixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    gl.TexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+    free(rgba);
+}
+
+static void gpu_use(const GpuProgram *p) {
+    gl.UseProgram(p->program);
+    gl.Uniform2f(p->size, (float)_Gpu.width, (float)_Gpu.height);
+    gl.Uniform1i(p->sampler, 0);
+}
+
+static void gpu_draw_colour(const VertexList *list) {
+    if (list->count == 0) {
+        return;
+    }
+    gl.BufferData(GL_ARRAY_BUFFER, list->count * sizeof(ColourVertex), list->data, GL_STREAM_DRAW);
+    gl.VertexAttribPointer(ATTRIB_POSITION, 3, GL_FLOAT, GL_FALSE, sizeof(ColourVertex), (void *)offsetof(ColourVertex, x));
+    gl.VertexAttribPointer(ATTRIB_INDEX, 1, GL_FLOAT, GL_FALSE, sizeof(ColourVertex), (void *)offsetof(ColourVertex, index));
+    gl.VertexAttribPointer(ATTRIB_RGBA, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(ColourVertex), (void *)offsetof(ColourVertex, rgba));
+    gl.DrawArrays(GL_TRIANGLES, 0, list->count);
+    _Gpu.draws++;
+}
+
+/*
+ * gpu_flush - Draw the batches into the target and empty them
+ */
+static void gpu_flush(void) {
+    bool any = _Gpu.colour_batch.count > 0 || _Gpu.alpha_batch.count > 0;
+    for (int id = 0; id < GPU_TEXTURES && !any; id++) {
+        any = _Gpu.texture_batch[id].count > 0;
+    }
+    if (!any) {
+        return;
+    }
+
+    if (_Gpu.context.make_current) {
+        _Gpu.context.make_current();
+    }
+    if (!gpu_target(_Pix2D.width, _Pix2D.height)) {
+        _Gpu.colour_batch.count = 0;
+        _Gpu.alpha_batch.count = 0;
+        for (int id = 0; id < GPU_TEXTURES; id++) {
+            _Gpu.texture_batch[id].count = 0;
+        }
+        g_pix3d_gpu = false;
+        _Gpu.running = false;   /* Later frames in software */
+        return;
+    }
+
+    /* The software renderer leaves the last clip column alone (bound_x) */
+    gl.Viewport(0, 0, _Gpu.width, _Gpu.height);
+    gl.Enable(GL_SCISSOR_TEST);
+    gl.Scissor(0, 0, _Pix2D.bound_x, _Pix2D.bottom);
+    gl.Enable(GL_DEPTH_TEST);
+    gl.DepthFunc(GL_LESS);
+    gl.DepthMask(GL_TRUE);
+    gl.Disable(GL_BLEND);
+    gl.ClearDepthf(1.0f);
+    if (!_Gpu.drawn) {
+        gl.ClearColor(0.0f, 0.0f, 0.0f, 1.0f);   /* pix2d_clear() */
+        gl.Clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    } else {
+        gl.Clear(GL_DEPTH_BUFFER_BIT);
+    }
+
+    gl.ActiveTexture(GL_TEXTURE0);
+    if (_Gpu.palette_stale) {
+        gl.BindTexture(GL_TEXTURE_2D, _Gpu.palette);
+        gpu_upload_rgba(_Pix3D.palette, 256, 256);
+        _Gpu.palette_stale = false;
+    }
+    for (int id = 0; id < GPU_TEXTURES; id++) {
+        if (_Gpu.texel_upload[id]) {
+            gl.BindTexture(GL_TEXTURE_2D, _Gpu.textures[id]);
+            gpu_texture_parameters(GL_CLAMP_TO_EDGE, GL_REPEAT);    /* u clamps, v wraps */
+            gpu_upload_rgba(_Gpu.texels[id], _Gpu.texel_size[id], _Gpu.texel_size[id]);
+            _Gpu.texel_upload[id] = false;
+        }
+    }
+
+    gl.BindBuffer(GL_ARRAY_BUFFER, _Gpu.buffer);
+    gl.EnableVertexAttribArray(0);
+    gl.EnableVertexAttribArray(1);
+    gl.EnableVertexAttribArray(2);
+
+    gpu_use(&_Gpu.colour);
+    gl.BindTexture(GL_TEXTURE_2D, _Gpu.palette);
+    gpu_draw_colour(&_Gpu.colour_batch);
+
+    gpu_use(&_Gpu.texture);
+    for (int id = 0; id < GPU_TEXTURES; id++) {
+        VertexList *list = &_Gpu.texture_batch[id];
+        if (list->count == 0) {
+            continue;
+        }
+        gl.BindTexture(GL_TEXTURE_2D, _Gpu.textures[id]);
+        gl.BufferData(GL_ARRAY_BUFFER, list->count * sizeof(TextureVertex), list->data, GL_STREAM_DRAW);
+        gl.VertexAttribPointer(ATTRIB_POSITION, 3, GL_FLOAT, GL_FALSE, sizeof(TextureVertex), (void *)offsetof(TextureVertex, x));
+        gl.VertexAttribPointer(ATTRIB_UVW, 3, GL_FLOAT, GL_FALSE, sizeof(TextureVertex), (void *)offsetof(TextureVertex, u));
+        gl.VertexAttribPointer(ATTRIB_SHADE, 1, GL_FLOAT, GL_FALSE, sizeof(TextureVertex), (void *)offsetof(TextureVertex, shade));
+        gl.DrawArrays(GL_TRIANGLES, 0, list->count);
+        _Gpu.draws++;
+        list->count = 0;
+    }
+
+    /* Keeps alpha / 256 of what is behind: source weight (256 - alpha) / 256 */
+    gpu_use(&_Gpu.colour);
+    gl.BindTexture(GL_TEXTURE_2D, _Gpu.palette);
+    gl.Enable(GL_BLEND);
+    gl.BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    gl.DepthMask(GL_FALSE);
+    gpu_draw_colour(&_Gpu.alpha_batch);
+    gl.DepthMask(GL_TRUE);
+    gl.Disable(GL_BLEND);
+
+    gl.DisableVertexAttribArray(0);
+    gl.DisableVertexAttribArray(1);
+    gl.DisableVertexAttribArray(2);
+    gl.Disable(GL_SCISSOR_TEST);
+
+    _Gpu.colour_batch.count = 0;
+    _Gpu.alpha_batch.count = 0;
+    _Gpu.sequence = 0;
+    _Gpu.drawn = true;
+    _Gpu.flushes++;
+}
+
+void pix3d_gpu_begin(void) {
+    if (!_Gpu.running || g_pix3d_gpu || _Pix2D.bottom <= 0 || _Pix2D.bound_x <= 0) {
+        return;
+    }
+    _Gpu.drawn = false;
+    _Gpu.sequence = 0;
+    g_pix3d_gpu = true;
+}
+
+void pix3d_gpu_end(void) {
+    if (!g_pix3d_gpu) {
+        return;
+    }
+    gpu_flush();
+    g_pix3d_gpu = false;
+    if (!_Gpu.drawn) {
+        return;     /* Nothing drawn: the cleared pixmap is the frame */
+    }
+
+    int width = _Pix2D.bound_x;
+    int height = _Pix2D.bottom;
+    if (width * height > _Gpu.readback_capacity) {
+        uint32_t *grown = realloc(_Gpu.readback, (size_t)width * height * 4);
+        if (!grown) {
+            return;
+        }
+        _Gpu.readback = grown;
+        _Gpu.readback_capacity = width * height;
+    }
+
+    /* Rows come back top first: the shaders put screen row 0 at GL row 0 */
+    gl.PixelStorei(GL_PACK_ALIGNMENT, 4);
+    gl.ReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, _Gpu.readback);
+    gl.BindFramebuffer(GL_FRAMEBUFFER, 0);
+    const uint8_t *src = (const uint8_t *)_Gpu.readback;
+    for (int y = 0; y < height; y++) {
+        int *dst = _Pix2D.pixels + y * _Pix2D.width;
+        for (int x = 0; x < width; x++, src += 4) {
+            dst[x] = src[0] << 16 | src[1] << 8 | src[2];
+        }
+    }
+}
+
+/*
+ * gpu_vertices - Room for one more triangle (3 vertices) in a list
+ *
+ * @return  Its first vertex, or NULL if out of memory (the face is lost)
+ */
+static void *gpu_vertices(VertexList *list, size_t size) {
+    if (list->count + 3 > list->capacity) {
+        int capacity = list->capacity ? list->capacity * 2 : 3 * 1024;
+        void *grown = realloc(list->data, capacity * size);
+        if (!grown) {
+            return NULL;
+        }
+        list->data = grown;
+        list->capacity = capacity;
+    }
+    void *at = (uint8_t *)list->data + list->count * size;
+    list->count += 3;
+    return at;
+}
+
+/*
+ * gpu_depth - Painter's depth of the next triangle (flushes if none left)
+ */
+static float gpu_depth(void) {
+    if (_Gpu.sequence >= PIX3D_GPU_DEPTH_LEVELS - 1) {
+        gpu_flush();
+    }
+    _Gpu.recorded++;
+    return 1.0f - (float)(++_Gpu.sequence) / (float)PIX3D_GPU_DEPTH_LEVELS;
+}
+
+static void gpu_colour(int xA, int xB, int xC, int yA, int yB, int yC, float iA, float iB, float iC, int rgb) {
+    float z = gpu_depth();
+    VertexList *list = _Pix3D.alpha == 0 ? &_Gpu.colour_batch : &_Gpu.alpha_batch;
+    ColourVertex *v = gpu_vertices(list, sizeof(ColourVertex));
+    if (!v) {
+        return;
+    }
+    int x[3] = {xA, xB, xC};
+    int y[3] = {yA, yB, yC};
+    float index[3] = {iA, iB, iC};
+    int weight = 256 - _Pix3D.alpha;
+    uint8_t a = weight > 255 ? 255 : (uint8_t)weight;
+    for (int i = 0; i < 3; i++) {
+        v[i].x = (float)x[i];
+        v[i].y = (float)y[i];
+        v[i].z = z;
+        v[i].index = index[i];
+        v[i].rgba[0] = rgb >> 16 & 0xff;
+        v[i].rgba[1] = rgb >> 8 & 0xff;
+        v[i].rgba[2] = rgb & 0xff;
+        v[i].rgba[3] = a;
+    }
+}
+
+void pix3d_gpu_gouraud(int xA, int xB, int xC, int yA, int yB, int yC, int colorA, int colorB, int colorC) {
+    gpu_colour(xA, xB, xC, yA, yB, yC, (float)colorA, (float)colorB, (float)colorC, 0);
+}
+
+void pix3d_gpu_flat(int xA, int xB, int xC, int yA, int yB, int yC, int color) {
+    gpu_colour(xA, xB, xC, yA, yB, yC, -1.0f, -1.0f, -1.0f, color);
+}
+
+void pix3d_gpu_texture(int xA, int xB, int xC, int yA, int yB, int yC, int shadeA, int shadeB, int shadeC, int originX, int originY, int originZ, int txB, int txC, int tyB, int tyC, int tzB, int tzC, int texture, const int *texels) {
+    if (texture < 0 || texture >= GPU_TEXTURES) {
+        return;
+    }
+
+    /* Copy now: the texel buffer may be reused by another texture before the flush */
+    if (_Gpu.texel_stale[texture]) {
+        int size = _Pix3D.lowMemory ? 64 : 128;
+        if (_Gpu.texel_size[texture] != size) {
+            free(_Gpu.texels[texture]);
+            _Gpu.texels[texture] = malloc(size * size * sizeof(int));
+            _Gpu.texel_size[texture] = _Gpu.texels[texture] ? size : 0;
+        }
+        if (!_Gpu.texels[texture]) {
+            return;
+        }
+        memcpy(_Gpu.texels[texture], texels, size * size * sizeof(int));
+        _Gpu.texel_stale[texture] = false;
+        _Gpu.texel_upload[texture] = true;
+    }
+
+    /*
+     * textureTriangle's plane equations, without their fixed-point shifts
+     * (common to u, v and w, so they cancel in u / w and v / w):
+     * at pixel (x, y), u = uOrigin * 512 + uX * (x - cx) + uY * (y - cy)
+     */
+    double vX = originX - txB, vY = originY - tyB, vZ = originZ - tzB;
+    double hX = txC - originX, hY = tyC - originY, hZ = tzC - originZ;
+    double uO = hX * originY - hY * originX, uX = hY * originZ - hZ * originY, uY = hZ * originX - hX * originZ;
+    double tO = vX * originY - vY * originX, tX = vY * originZ - vZ * originY, tY = vZ * originX - vX * originZ;
+    double wO = vY * hX - vX * hY, wX = vZ * hY - vY * hZ, wY = vX * hZ - vZ * hX;
+
+    /* The copy holds the texels as built; a scrolled texture reads them rows back */
+    int size = _Gpu.texel_size[texture];
+    double scroll = (double)_Pix3D.texelScroll[texture] / (size * size);
+
+    int x[3] = {xA, xB, xC};
+    int y[3] = {yA, yB, yC};
+    int shade[3] = {shadeA, shadeB, shadeC};
+    double u[3], v[3], w[3];
+    double largest = 0.0;
+    for (int i = 0; i < 3; i++) {
+        double dx = x[i] - _Pix3D.center_x;
+        double dy = y[i] - _Pix3D.center_y;
+        u[i] = uO * 512.0 + uX * dx + uY * dy;
+        v[i] = tO * 512.0 + tX * dx + tY * dy;
+        w[i] = wO * 512.0 + wX * dx + wY * dy;
+        v[i] += w[i] * scroll;
+        double magnitude = w[i] < 0 ? -w[i] : w[i];
+        if (magnitude > largest) {
+            largest = magnitude;
+        }
+    }
+    if (largest == 0.0) {
+        return;     /* Seen edge on: no texel to look up */
+    }
+
+    float z = gpu_depth();
+    TextureVertex *out = gpu_vertices(&_Gpu.texture_batch[texture], sizeof(TextureVertex));
+    if (!out) {
+        return;
+    }
+    for (int i = 0; i < 3; i++) {
+        out[i].x = (float)x[i];
+        out[i].y = (float)y[i];
+        out[i].z = z;
+        out[i].u = (float)(u[i] / largest);
+        out[i].v = (float)(v[i] / largest);
+        out[i].w = (float)(w[i] / largest);
+        out[i].shade = (float)shade[i];
+    }
+}
+
+void pix3d_gpu_texture_changed(int id) {
+    if (id >= 0 && id < GPU_TEXTURES) {
+        _Gpu.texel_stale[id] = true;
+    }
+}
+
+void pix3d_gpu_palette_changed(void) {
+    _Gpu.palette_stale = true;
+}
+
+#else
+
+/*
+ * Built without PIX3D_GPU: g_pix3d_gpu stays false and every triangle is
+ * drawn in software.
+ */
+bool pix3d_gpu_start(const Pix3DGpuContext *context) {
+    (void)context;
+    fprintf(stderr, "WARNING: Built without PIX3D_GPU, the scene stays in software\n");
+    return false;
+}
+void pix3d_gpu_stop(void) {}
+void pix3d_gpu_begin(void) {}
+void pix3d_gpu_end(void) {}
+void pix3d_gpu_gouraud(int xA, int xB, int xC, int yA, int yB, int yC, int colorA, int colorB, int colorC) {
+    (void)xA; (void)xB; (void)xC; (void)yA; (void)yB; (void)yC; (void)colorA; (void)colorB; (void)colorC;
+}
+void pix3d_gpu_flat(int xA, int xB, int xC, int yA, int yB, int yC, int color) {
+    (void)xA; (void)xB; (void)xC; (void)yA; (void)yB; (void)yC; (void)color;
+}
+void pix3d_gpu_texture(int xA, int xB, int xC, int yA, int yB, int yC, int shadeA, int shadeB, int shadeC, int originX, int originY, int originZ, int txB, int txC, int tyB, int tyC, int tzB, int tzC, int texture, const int *texels) {
+    (void)xA; (void)xB; (void)xC; (void)yA; (void)yB; (void)yC; (void)shadeA; (void)shadeB; (void)shadeC;
+    (void)originX; (void)originY; (void)originZ; (void)txB; (void)txC; (void)tyB; (void)tyC; (void)tzB; (void)tzC;
+    (void)texture; (void)texels;
+}
+void pix3d_gpu_texture_changed(int id) {
+    (void)id;
+}
+void pix3d_gpu_palette_changed(void) {}
+const char *pix3d_gpu_renderer(void) {
+    return NULL;
+}
+
+#endif
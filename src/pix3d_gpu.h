@@ -0,0 +1,134 @@
+/*******************************************************************************
+ * PIX3D_GPU.H - OpenGL ES 2 Scene Rasterization Behind the pix3d Calls
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Replacing a rasterizer behind an unchanged draw-call boundary
+ *   - Keeping painter's order with a depth buffer instead of draw order
+ *   - Batching triangles by state (texture) without reordering the picture
+ *   - Perspective-correct texturing from screen-space plane equations
+ *
+ * THE PROBLEM:
+ *
+ * Every pixel of the scene is filled by the CPU: gouraudTriangle(),
+ * flatTriangle() and textureTriangle() walk edges and run span kernels
+ * (pix3d_span.h), on one core or on the binning threads (pix3d_bin.h).
+ * In a large resizable window that is most of the frame, while the GPU
+ * that presents it does nothing else.
+ *
+ * A GPU wants few, large draw calls: all faces with one texture in one
+ * call. But the renderer has no depth buffer - the last face drawn over a
+ * pixel wins, and world3d_draw() relies on drawing back to front. Sorting
+ * faces by texture would draw them out of that order.
+ *
+ * THE SOLUTION - THE DRAW ORDER BECOMES THE DEPTH:
+ *
+ *   triangle n of the frame gets depth  z = 1 - (n + 1) / 65535
+ *
+ *   a later face is nearer than every earlier one, so with the depth test
+ *   on it still covers them - in whatever order the GPU draws them:
+ *
+ *     colour batch     opaque flat and Gouraud faces         1 draw call
+ *     texture batches  textured faces, one per texture       1 per texture
+ *     alpha batch      translucent faces, in their order     1 draw call
+ *
+ * Translucent faces are drawn last and in their own order: a blend needs
+ * what is behind it already drawn, and the depth test still hides them
+ * under any later opaque face.
+ *
+ * MATCHING THE SOFTWARE PICTURE:
+ *   - Gouraud faces interpolate the palette index, as the span kernels
+ *     do, and look it up in a 256x256 copy of _Pix3D.palette.
+ *   - Textured faces: textureTriangle's u, v and w are plane equations in
+ *     screen space; each vertex gets their values, the GPU interpolates
+ *     them linearly and the fragment divides u / w, v / w - the same
+ *     perspective texture lookup, without the 8-pixel steps. The shade
+ *     picks the same darker copy (7/8, 3/4, 5/8) and halving.
+ *   - Texel 0 of a transparent texture is discarded; translucent faces
+ *     keep alpha / 256 of what is behind them.
+ *   Edges land on the GPU's pixel centres, so the picture is close to the
+ *   software one, not bit-identical; the software renderer stays the
+ *   reference (render_bench's checksums).
+ *
+ * THE FRAME:
+ *   world3d_draw() brackets the scene with pix3d_gpu_begin() / _end().
+ *   Triangles are recorded into the batches; at the end they are drawn
+ *   into an offscreen target the size of the bound pixmap and read back
+ *   into _Pix2D, so everything the client draws over the scene afterwards
+ *   (names, hitsplats, menus, the interface) stays software as before.
+ *   More than 65534 triangles flush early: the batches are drawn, the
+ *   depth buffer cleared and numbering starts over, in order.
+ *
+ * TEXTURES:
+ *   Each texture's texels are copied to the GPU once, on first use.
+ *   pix3d_scroll_texture() and pix3d_set_brightness() mark them changed
+ *   and the next use copies them again; the palette likewise.
+ *
+ * ENABLING:
+ *   Built with -DPIX3D_GPU for SDL2/SDL3, and gpu_render=1 in config.ini:
+ *   the platform makes a hidden GL ES 2 context and passes its function
+ *   loader to pix3d_gpu_start() (no GL library is linked). Without
+ *   either, or if the context fails, every triangle is drawn in software.
+ *
+ ******************************************************************************/
+
+#ifndef PIX3D_GPU_H
+#define PIX3D_GPU_H
+
+#include <stdbool.h>
+
+/* Triangles drawn per depth buffer before an early flush */
+#define PIX3D_GPU_DEPTH_LEVELS 65535
+
+/*
+ * Pix3DGpuContext - The GL ES 2 context the platform made
+ */
+typedef struct {
+    void *(*proc)(const char *name);  /* GL entry point by name */
+    void (*make_current)(void);       /* Before drawing; NULL if it stays current */
+} Pix3DGpuContext;
+
+/* Set while triangles are recorded for the GPU */
+extern bool g_pix3d_gpu;
+
+/*
+ * pix3d_gpu_start - Load GL, compile the shaders
+ *
+ * @return  false if not built with PIX3D_GPU or the context is unusable;
+ *          the scene stays in software
+ */
+bool pix3d_gpu_start(const Pix3DGpuContext *context);
+
+/*
+ * pix3d_gpu_stop - Free every GL object (with the context still current)
+ */
+void pix3d_gpu_stop(void);
+
+/*
+ * pix3d_gpu_begin / pix3d_gpu_end - Record the scene, then draw it and
+ * read it back into the bound pixmap
+ */
+void pix3d_gpu_begin(void);
+void pix3d_gpu_end(void);
+
+/*
+ * pix3d_gpu_gouraud / flat / texture - Record one triangle
+ * (called by gouraudTriangle, flatTriangle and textureTriangle)
+ */
+void pix3d_gpu_gouraud(int xA, int xB, int xC, int yA, int yB, int yC, int colorA, int colorB, int colorC);
+void pix3d_gpu_flat(int xA, int xB, int xC, int yA, int yB, int yC, int color);
+void pix3d_gpu_texture(int xA, int xB, int xC, int yA, int yB, int yC, int shadeA, int shadeB, int shadeC, int originX, int originY, int originZ, int txB, int txC, int tyB, int tyC, int tzB, int tzC, int texture, const int *texels);
+
+/*
+ * pix3d_gpu_texture_changed / palette_changed - Copy again on next use
+ */
+void pix3d_gpu_texture_changed(int id);
+void pix3d_gpu_palette_changed(void);
+
+/*
+ * pix3d_gpu_renderer - GL_RENDERER of the running context, or NULL
+ */
+const char *pix3d_gpu_renderer(void);
+
+#endif /* PIX3D_GPU_H */
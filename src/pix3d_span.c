@@ -0,0 +1,762 @@
+/*******************************************************************************
+ * PIX3D_SPAN.C - SIMD Span Fills Implementation
+ *******************************************************************************
+ *
+ * See pix3d_span.h for the kernels and why their output is identical.
+ *
+ * LAYOUT:
+ *   Each vector kernel runs its full vectors, then hands the rest of the
+ *   span (fewer pixels than a vector, or than a group pair) to the scalar
+ *   kernel with the colour it has reached. The scalar kernels are the
+ *   loops gouraudRaster() and flatRaster() used to contain.
+ *
+ *   The per-pixel Gouraud and texture kernels need a table lookup per
+ *   pixel. Only AVX2 can gather; SSE2 and NEON would load the entries
+ *   one by one, so they keep the scalar kernels and vectorize only the
+ *   Gouraud blend around the loads.
+ *
+ *   Texture kernels keep textureRaster()'s two divides per 8 pixels as
+ *   they were (texture_begin/advance) and gather one stride at a time.
+ *   Transparent textures store with a mask: a zero texel leaves the
+ *   pixel behind it untouched.
+ *
+ ******************************************************************************/
+
+#include "pix3d_span.h"
+#include <stdint.h>
+
+#if !defined(PIX3D_SCALAR) && defined(__GNUC__) && defined(__x86_64__)
+#define PIX3D_SSE2 1
+#include <immintrin.h>
+#elif !defined(PIX3D_SCALAR) && defined(__GNUC__) && defined(__ARM_NEON)
+#define PIX3D_NEON 1
+#include <arm_neon.h>
+#elif !defined(PIX3D_SCALAR) && defined(__wasm_simd128__)
+#define PIX3D_WASM 1
+#include <wasm_simd128.h>
+#endif
+
+/*
+ * The texture helpers below are written once with opaque and size as
+ * parameters; every kernel passes constants. They must be inlined for
+ * those to fold, and GCC will not inline them into several callers on
+ * its own: out of line, the variable shifts cost ~15%.
+ */
+#if defined(__GNUC__)
+#define SPAN_INLINE static inline __attribute__((always_inline))
+#else
+#define SPAN_INLINE static inline
+#endif
+
+/*******************************************************************************
+ * SCALAR (every platform)
+ ******************************************************************************/
+
+static inline int scale_rgb(int rgb, int a) {
+    return ((((rgb & 0xff00ff) * a) >> 8) & 0xff00ff) + ((((rgb & 0xff00) * a) >> 8) & 0xff00);
+}
+
+static void scalar_fill(int *dst, int length, int rgb) {
+    while (length >= 4) {
+        dst[0] = rgb;
+        dst[1] = rgb;
+        dst[2] = rgb;
+        dst[3] = rgb;
+        dst += 4;
+        length -= 4;
+    }
+    while (--length >= 0) {
+        *dst++ = rgb;
+    }
+}
+
+static void scalar_blend(int *dst, int length, int rgb, int alpha) {
+    while (--length >= 0) {
+        *dst = rgb + scale_rgb(*dst, alpha);
+        dst++;
+    }
+}
+
+static void scalar_jagged(int *dst, int length, int color, int step, const int *palette) {
+    for (int groups = length >> 2; groups > 0; groups--) {
+        int rgb = palette[color >> 8];
+        color += step;
+        dst[0] = rgb;
+        dst[1] = rgb;
+        dst[2] = rgb;
+        dst[3] = rgb;
+        dst += 4;
+    }
+    if (length & 0x3) {
+        scalar_fill(dst, length & 0x3, palette[color >> 8]);
+    }
+}
+
+static void scalar_jagged_blend(int *dst, int length, int color, int step, const int *palette, int alpha) {
+    int invAlpha = 256 - alpha;
+
+    for (int groups = length >> 2; groups > 0; groups--) {
+        int rgb = scale_rgb(palette[color >> 8], invAlpha);
+        color += step;
+        scalar_blend(dst, 4, rgb, alpha);
+        dst += 4;
+    }
+    if (length & 0x3) {
+        scalar_blend(dst, length & 0x3, scale_rgb(palette[color >> 8], invAlpha), alpha);
+    }
+}
+
+static void scalar_smooth(int *dst, int length, int color, int step, const int *palette) {
+    while (--length >= 0) {
+        *dst++ = palette[color >> 8];
+        color += step;
+    }
+}
+
+static void scalar_smooth_blend(int *dst, int length, int color, int step, const int *palette, int alpha) {
+    int invAlpha = 256 - alpha;
+
+    while (--length >= 0) {
+        int rgb = scale_rgb(palette[color >> 8], invAlpha);
+        color += step;
+        *dst = rgb + scale_rgb(*dst, alpha);
+        dst++;
+    }
+}
+
+/*
+ * texture_begin - First divide of a textured span
+ *
+ * Exactly textureRaster()'s old setup; the masks and shifts that
+ * differ between 64x64 and 128x128 textures all follow from size.
+ */
+SPAN_INLINE void texture_begin(Pix3DTexture *t, int size) {
+    int maxU = ((1 << size) - 1) << size;
+    int curW = t->w >> (2 * size);
+
+    if (curW != 0) {
+        t->curU = t->u / curW;
+        t->curV = t->v / curW;
+        if (t->curU < 0) {
+            t->curU = 0;
+        } else if (t->curU > maxU) {
+            t->curU = maxU;
+        }
+    }
+
+    t->u += t->uStride;
+    t->v += t->vStride;
+    t->w += t->wStride;
+
+    t->nextU = 0;
+    t->nextV = 0;
+    curW = t->w >> (2 * size);
+    if (curW != 0) {
+        t->nextU = t->u / curW;
+        t->nextV = t->v / curW;
+        if (t->nextU < 0x7) {
+            t->nextU = 0x7;
+        } else if (t->nextU > maxU) {
+            t->nextU = maxU;
+        }
+    }
+
+    /* Every v the span reads moves by the same whole rows */
+    t->curV += t->scroll;
+    t->nextV += t->scroll;
+
+    t->stepU = (t->nextU - t->curU) >> 3;
+    t->stepV = (t->nextV - t->curV) >> 3;
+    t->curU += ((t->shade >> 21) & 0x3) << (3 * size);
+}
+
+/*
+ * texture_advance - Move to the next 8 pixels: one more divide
+ */
+SPAN_INLINE void texture_advance(Pix3DTexture *t, int size) {
+    int maxU = ((1 << size) - 1) << size;
+
+    t->curU = t->nextU;
+    t->curV = t->nextV;
+
+    t->u += t->uStride;
+    t->v += t->vStride;
+    t->w += t->wStride;
+
+    int curW = t->w >> (2 * size);
+    if (curW != 0) {
+        t->nextU = t->u / curW;
+        t->nextV = t->v / curW + t->scroll;
+        if (t->nextU < 0x7) {
+            t->nextU = 0x7;
+        } else if (t->nextU > maxU) {
+            t->nextU = maxU;
+        }
+    }
+
+    t->stepU = (t->nextU - t->curU) >> 3;
+    t->stepV = (t->nextV - t->curV) >> 3;
+    t->shade += t->shadeStride;
+    t->curU += ((t->shade >> 21) & 0x3) << (3 * size);
+}
+
+SPAN_INLINE void scalar_texel(int *dst, const int *texels, int u, int v, int shadeShift, int opaque, int size) {
+    int rgb = (uint32_t)texels[(v & (((1 << size) - 1) << size)) + (u >> size)] >> shadeShift;
+    if (opaque || rgb != 0) {
+        *dst = rgb;
+    }
+}
+
+/*
+ * scalar_texels - Draw length (< 8) pixels of the current stride
+ */
+SPAN_INLINE void scalar_texels(int *dst, int length, const int *texels, const Pix3DTexture *t, int opaque, int size) {
+    int shadeShift = t->shade >> 23;
+    int u = t->curU;
+    int v = t->curV;
+    int stepU = t->stepU;
+    int stepV = t->stepV;
+
+    for (int i = 0; i < length; i++) {
+        scalar_texel(dst + i, texels, u, v, shadeShift, opaque, size);
+        u += stepU;
+        v += stepV;
+    }
+}
+
+/*
+ * scalar_stride - Draw all 8 pixels of the current stride
+ *
+ * Unrolled, as the loops in textureRaster() were.
+ */
+SPAN_INLINE void scalar_stride(int *dst, const int *texels, const Pix3DTexture *t, int opaque, int size) {
+    int shadeShift = t->shade >> 23;
+    int u = t->curU;
+    int v = t->curV;
+    int stepU = t->stepU;
+    int stepV = t->stepV;
+
+    scalar_texel(dst + 0, texels, u, v, shadeShift, opaque, size);
+    u += stepU;
+    v += stepV;
+    scalar_texel(dst + 1, texels, u, v, shadeShift, opaque, size);
+    u += stepU;
+    v += stepV;
+    scalar_texel(dst + 2, texels, u, v, shadeShift, opaque, size);
+    u += stepU;
+    v += stepV;
+    scalar_texel(dst + 3, texels, u, v, shadeShift, opaque, size);
+    u += stepU;
+    v += stepV;
+    scalar_texel(dst + 4, texels, u, v, shadeShift, opaque, size);
+    u += stepU;
+    v += stepV;
+    scalar_texel(dst + 5, texels, u, v, shadeShift, opaque, size);
+    u += stepU;
+    v += stepV;
+    scalar_texel(dst + 6, texels, u, v, shadeShift, opaque, size);
+    u += stepU;
+    v += stepV;
+    scalar_texel(dst + 7, texels, u, v, shadeShift, opaque, size);
+}
+
+SPAN_INLINE void scalar_texture_span(int *dst, int length, const int *texels, const Pix3DTexture *texture, int opaque, int size) {
+    /* A local copy stays in registers: dst cannot alias it */
+    Pix3DTexture state = *texture;
+    Pix3DTexture *t = &state;
+
+    texture_begin(t, size);
+    for (int strides = length >> 3; strides > 0; strides--) {
+        scalar_stride(dst, texels, t, opaque, size);
+        dst += 8;
+        texture_advance(t, size);
+    }
+    scalar_texels(dst, length & 0x7, texels, t, opaque, size);
+}
+
+static void scalar_texture(int *dst, int length, const int *texels, const Pix3DTexture *texture) {
+    if (texture->size == 6) {
+        scalar_texture_span(dst, length, texels, texture, 1, 6);
+    } else {
+        scalar_texture_span(dst, length, texels, texture, 1, 7);
+    }
+}
+
+static void scalar_texture_transparent(int *dst, int length, const int *texels, const Pix3DTexture *texture) {
+    if (texture->size == 6) {
+        scalar_texture_span(dst, length, texels, texture, 0, 6);
+    } else {
+        scalar_texture_span(dst, length, texels, texture, 0, 7);
+    }
+}
+
+static const Pix3DSpans SCALAR_SPANS = {
+    scalar_fill, scalar_blend, scalar_jagged, scalar_jagged_blend,
+    scalar_smooth, scalar_smooth_blend,
+    scalar_texture, scalar_texture_transparent, "scalar"
+};
+
+const Pix3DSpans *g_pix3d_spans = &SCALAR_SPANS;
+
+/*
+ * Value (colour or texture coordinate) i pixels into a run: value + i *
+ * step, computed unsigned so the wrap is defined (the scalar loop's sum
+ * wraps the same way)
+ */
+#define LANE_VALUE(value, step, i) ((int)((unsigned)(value) + (unsigned)(i) * (unsigned)(step)))
+
+#ifdef PIX3D_SSE2
+
+/*******************************************************************************
+ * SSE2 (baseline on x86-64)
+ ******************************************************************************/
+
+/* scale_rgb() on 4 pixels; a16 holds a in every 16-bit lane */
+static inline __m128i sse2_scale(__m128i v, __m128i a16) {
+    __m128i rb = _mm_and_si128(v, _mm_set1_epi32(0xff00ff));
+    __m128i g = _mm_and_si128(_mm_srli_epi32(v, 8), _mm_set1_epi32(0xff));
+    rb = _mm_srli_epi16(_mm_mullo_epi16(rb, a16), 8);
+    g = _mm_and_si128(_mm_mullo_epi16(g, a16), _mm_set1_epi32(0xff00));
+    return _mm_add_epi32(rb, g);
+}
+
+static inline void sse2_blend4(int *dst, __m128i rgb, __m128i alpha16) {
+    __m128i old = _mm_loadu_si128((const __m128i *)dst);
+    _mm_storeu_si128((__m128i *)dst, _mm_add_epi32(rgb, sse2_scale(old, alpha16)));
+}
+
+static void sse2_fill(int *dst, int length, int rgb) {
+    __m128i v = _mm_set1_epi32(rgb);
+    int i = 0;
+    for (; i + 8 <= length; i += 8) {
+        _mm_storeu_si128((__m128i *)(dst + i), v);
+        _mm_storeu_si128((__m128i *)(dst + i + 4), v);
+    }
+    for (; i + 4 <= length; i += 4) {
+        _mm_storeu_si128((__m128i *)(dst + i), v);
+    }
+    scalar_fill(dst + i, length - i, rgb);
+}
+
+static void sse2_blend(int *dst, int length, int rgb, int alpha) {
+    __m128i v = _mm_set1_epi32(rgb);
+    __m128i alpha16 = _mm_set1_epi16((short)alpha);
+    int i = 0;
+    for (; i + 4 <= length; i += 4) {
+        sse2_blend4(dst + i, v, alpha16);
+    }
+    scalar_blend(dst + i, length - i, rgb, alpha);
+}
+
+static void sse2_jagged(int *dst, int length, int color, int step, const int *palette) {
+    int i = 0;
+    for (; i + 4 <= length; i += 4) {
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_set1_epi32(palette[color >> 8]));
+        color += step;
+    }
+    scalar_jagged(dst + i, length - i, color, step, palette);
+}
+
+static void sse2_jagged_blend(int *dst, int length, int color, int step, const int *palette, int alpha) {
+    __m128i alpha16 = _mm_set1_epi16((short)alpha);
+    __m128i inv16 = _mm_set1_epi16((short)(256 - alpha));
+    int i = 0;
+    for (; i + 4 <= length; i += 4) {
+        __m128i rgb = sse2_scale(_mm_set1_epi32(palette[color >> 8]), inv16);
+        color += step;
+        sse2_blend4(dst + i, rgb, alpha16);
+    }
+    scalar_jagged_blend(dst + i, length - i, color, step, palette, alpha);
+}
+
+static void sse2_smooth_blend(int *dst, int length, int color, int step, const int *palette, int alpha) {
+    __m128i alpha16 = _mm_set1_epi16((short)alpha);
+    __m128i inv16 = _mm_set1_epi16((short)(256 - alpha));
+    int i = 0;
+    for (; i + 4 <= length; i += 4) {
+        __m128i rgb = _mm_setr_epi32(palette[color >> 8],
+                                     palette[LANE_VALUE(color, step, 1) >> 8],
+                                     palette[LANE_VALUE(color, step, 2) >> 8],
+                                     palette[LANE_VALUE(color, step, 3) >> 8]);
+        color = LANE_VALUE(color, step, 4);
+        sse2_blend4(dst + i, sse2_scale(rgb, inv16), alpha16);
+    }
+    scalar_smooth_blend(dst + i, length - i, color, step, palette, alpha);
+}
+
+static const Pix3DSpans SSE2_SPANS = {
+    sse2_fill, sse2_blend, sse2_jagged, sse2_jagged_blend,
+    scalar_smooth, sse2_smooth_blend,
+    scalar_texture, scalar_texture_transparent, "sse2"
+};
+
+/*******************************************************************************
+ * AVX2 (x86-64, when the CPU has it)
+ *
+ * The tails go to the SSE2 or scalar kernels, which are compiled without
+ * AVX. Each kernel clears the upper halves of the ymm registers first:
+ * GCC turns those calls into jumps and leaves it out, and legacy SSE code
+ * running with dirty upper halves was measured 6x slower here.
+ ******************************************************************************/
+
+__attribute__((target("avx2")))
+static inline __m256i avx2_scale(__m256i v, __m256i a16) {
+    __m256i rb = _mm256_and_si256(v, _mm256_set1_epi32(0xff00ff));
+    __m256i g = _mm256_and_si256(_mm256_srli_epi32(v, 8), _mm256_set1_epi32(0xff));
+    rb = _mm256_srli_epi16(_mm256_mullo_epi16(rb, a16), 8);
+    g = _mm256_and_si256(_mm256_mullo_epi16(g, a16), _mm256_set1_epi32(0xff00));
+    return _mm256_add_epi32(rb, g);
+}
+
+__attribute__((target("avx2")))
+static inline void avx2_blend8(int *dst, __m256i rgb, __m256i alpha16) {
+    __m256i old = _mm256_loadu_si256((const __m256i *)dst);
+    _mm256_storeu_si256((__m256i *)dst, _mm256_add_epi32(rgb, avx2_scale(old, alpha16)));
+}
+
+/* value + i * step in lane i: colours or texture coordinates of 8 pixels */
+__attribute__((target("avx2")))
+static inline __m256i avx2_ramp(int value, int step) {
+    __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    return _mm256_add_epi32(_mm256_set1_epi32(value), _mm256_mullo_epi32(lane, _mm256_set1_epi32(step)));
+}
+
+__attribute__((target("avx2")))
+static void avx2_fill(int *dst, int length, int rgb) {
+    __m256i v = _mm256_set1_epi32(rgb);
+    int i = 0;
+    for (; i + 8 <= length; i += 8) {
+        _mm256_storeu_si256((__m256i *)(dst + i), v);
+    }
+    _mm256_zeroupper();
+    sse2_fill(dst + i, length - i, rgb);
+}
+
+__attribute__((target("avx2")))
+static void avx2_blend(int *dst, int length, int rgb, int alpha) {
+    __m256i v = _mm256_set1_epi32(rgb);
+    __m256i alpha16 = _mm256_set1_epi16((short)alpha);
+    int i = 0;
+    for (; i + 8 <= length; i += 8) {
+        avx2_blend8(dst + i, v, alpha16);
+    }
+    _mm256_zeroupper();
+    sse2_blend(dst + i, length - i, rgb, alpha);
+}
+
+/* Two 4-pixel groups per store */
+__attribute__((target("avx2")))
+static void avx2_jagged(int *dst, int length, int color, int step, const int *palette) {
+    int i = 0;
+    for (; i + 8 <= length; i += 8) {
+        int a = palette[color >> 8];
+        color += step;
+        int b = palette[color >> 8];
+        color += step;
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_setr_epi32(a, a, a, a, b, b, b, b));
+    }
+    _mm256_zeroupper();
+    sse2_jagged(dst + i, length - i, color, step, palette);
+}
+
+__attribute__((target("avx2")))
+static void avx2_jagged_blend(int *dst, int length, int color, int step, const int *palette, int alpha) {
+    __m256i alpha16 = _mm256_set1_epi16((short)alpha);
+    __m256i inv16 = _mm256_set1_epi16((short)(256 - alpha));
+    int i = 0;
+    for (; i + 8 <= length; i += 8) {
+        int a = palette[color >> 8];
+        color += step;
+        int b = palette[color >> 8];
+        color += step;
+        __m256i rgb = avx2_scale(_mm256_setr_epi32(a, a, a, a, b, b, b, b), inv16);
+        avx2_blend8(dst + i, rgb, alpha16);
+    }
+    _mm256_zeroupper();
+    sse2_jagged_blend(dst + i, length - i, color, step, palette, alpha);
+}
+
+__attribute__((target("avx2")))
+static void avx2_smooth(int *dst, int length, int color, int step, const int *palette) {
+    __m256i colors = avx2_ramp(color, step);
+    __m256i advance = _mm256_set1_epi32(LANE_VALUE(0, step, 8));
+    int i = 0;
+    for (; i + 8 <= length; i += 8) {
+        __m256i rgb = _mm256_i32gather_epi32(palette, _mm256_srai_epi32(colors, 8), 4);
+        _mm256_storeu_si256((__m256i *)(dst + i), rgb);
+        colors = _mm256_add_epi32(colors, advance);
+    }
+    _mm256_zeroupper();
+    scalar_smooth(dst + i, length - i, LANE_VALUE(color, step, i), step, palette);
+}
+
+__attribute__((target("avx2")))
+static void avx2_smooth_blend(int *dst, int length, int color, int step, const int *palette, int alpha) {
+    __m256i alpha16 = _mm256_set1_epi16((short)alpha);
+    __m256i inv16 = _mm256_set1_epi16((short)(256 - alpha));
+    __m256i colors = avx2_ramp(color, step);
+    __m256i advance = _mm256_set1_epi32(LANE_VALUE(0, step, 8));
+    int i = 0;
+    for (; i + 8 <= length; i += 8) {
+        __m256i rgb = _mm256_i32gather_epi32(palette, _mm256_srai_epi32(colors, 8), 4);
+        avx2_blend8(dst + i, avx2_scale(rgb, inv16), alpha16);
+        colors = _mm256_add_epi32(colors, advance);
+    }
+    _mm256_zeroupper();
+    sse2_smooth_blend(dst + i, length - i, LANE_VALUE(color, step, i), step, palette, alpha);
+}
+
+/*
+ * avx2_texels - One whole stride: 8 gathered texels
+ *
+ * Falls back to the scalar loop for a shade shift outside 0..31.
+ */
+__attribute__((target("avx2")))
+SPAN_INLINE void avx2_texels(int *dst, const int *texels, const Pix3DTexture *t, int opaque, int size) {
+    int shadeShift = t->shade >> 23;
+    if (shadeShift < 0 || shadeShift > 31) {
+        scalar_stride(dst, texels, t, opaque, size);
+        return;
+    }
+
+    __m256i u = avx2_ramp(t->curU, t->stepU);
+    __m256i v = avx2_ramp(t->curV, t->stepV);
+    __m256i vmask = _mm256_set1_epi32(((1 << size) - 1) << size);
+    __m256i index = _mm256_add_epi32(_mm256_and_si256(v, vmask), _mm256_srai_epi32(u, size));
+    __m256i rgb = _mm256_srl_epi32(_mm256_i32gather_epi32(texels, index, 4), _mm_cvtsi32_si128(shadeShift));
+
+    if (opaque) {
+        _mm256_storeu_si256((__m256i *)dst, rgb);
+    } else {
+        /* Zero texels are holes: store only the other lanes */
+        __m256i hole = _mm256_cmpeq_epi32(rgb, _mm256_setzero_si256());
+        _mm256_maskstore_epi32(dst, _mm256_xor_si256(hole, _mm256_set1_epi32(-1)), rgb);
+    }
+}
+
+__attribute__((target("avx2")))
+SPAN_INLINE void avx2_texture_span(int *dst, int length, const int *texels, const Pix3DTexture *texture, int opaque, int size) {
+    Pix3DTexture state = *texture;
+    Pix3DTexture *t = &state;
+
+    texture_begin(t, size);
+    for (int strides = length >> 3; strides > 0; strides--) {
+        avx2_texels(dst, texels, t, opaque, size);
+        dst += 8;
+        texture_advance(t, size);
+    }
+    scalar_texels(dst, length & 0x7, texels, t, opaque, size);
+}
+
+__attribute__((target("avx2")))
+static void avx2_texture(int *dst, int length, const int *texels, const Pix3DTexture *texture) {
+    if (texture->size == 6) {
+        avx2_texture_span(dst, length, texels, texture, 1, 6);
+    } else {
+        avx2_texture_span(dst, length, texels, texture, 1, 7);
+    }
+}
+
+__attribute__((target("avx2")))
+static void avx2_texture_transparent(int *dst, int length, const int *texels, const Pix3DTexture *texture) {
+    if (texture->size == 6) {
+        avx2_texture_span(dst, length, texels, texture, 0, 6);
+    } else {
+        avx2_texture_span(dst, length, texels, texture, 0, 7);
+    }
+}
+
+static const Pix3DSpans AVX2_SPANS = {
+    avx2_fill, avx2_blend, avx2_jagged, avx2_jagged_blend,
+    avx2_smooth, avx2_smooth_blend,
+    avx2_texture, avx2_texture_transparent, "avx2"
+};
+
+#endif /* PIX3D_SSE2 */
+
+#ifdef PIX3D_NEON
+
+/*******************************************************************************
+ * NEON (arm64, and armv7 builds with -mfpu=neon)
+ ******************************************************************************/
+
+/* scale_rgb() on 4 pixels */
+static inline uint32x4_t neon_scale(uint32x4_t v, uint16x8_t a16) {
+    uint32x4_t rb = vandq_u32(v, vdupq_n_u32(0xff00ff));
+    uint32x4_t g = vandq_u32(vshrq_n_u32(v, 8), vdupq_n_u32(0xff));
+    rb = vreinterpretq_u32_u16(vshrq_n_u16(vmulq_u16(vreinterpretq_u16_u32(rb), a16), 8));
+    g = vandq_u32(vreinterpretq_u32_u16(vmulq_u16(vreinterpretq_u16_u32(g), a16)), vdupq_n_u32(0xff00));
+    return vaddq_u32(rb, g);
+}
+
+static inline void neon_blend4(int *dst, uint32x4_t rgb, uint16x8_t alpha16) {
+    uint32x4_t old = vreinterpretq_u32_s32(vld1q_s32(dst));
+    vst1q_s32(dst, vreinterpretq_s32_u32(vaddq_u32(rgb, neon_scale(old, alpha16))));
+}
+
+static void neon_fill(int *dst, int length, int rgb) {
+    int32x4_t v = vdupq_n_s32(rgb);
+    int i = 0;
+    for (; i + 4 <= length; i += 4) {
+        vst1q_s32(dst + i, v);
+    }
+    scalar_fill(dst + i, length - i, rgb);
+}
+
+static void neon_blend(int *dst, int length, int rgb, int alpha) {
+    uint32x4_t v = vdupq_n_u32((uint32_t)rgb);
+    uint16x8_t alpha16 = vdupq_n_u16((uint16_t)alpha);
+    int i = 0;
+    for (; i + 4 <= length; i += 4) {
+        neon_blend4(dst + i, v, alpha16);
+    }
+    scalar_blend(dst + i, length - i, rgb, alpha);
+}
+
+static void neon_jagged(int *dst, int length, int color, int step, const int *palette) {
+    int i = 0;
+    for (; i + 4 <= length; i += 4) {
+        vst1q_s32(dst + i, vdupq_n_s32(palette[color >> 8]));
+        color += step;
+    }
+    scalar_jagged(dst + i, length - i, color, step, palette);
+}
+
+static void neon_jagged_blend(int *dst, int length, int color, int step, const int *palette, int alpha) {
+    uint16x8_t alpha16 = vdupq_n_u16((uint16_t)alpha);
+    uint16x8_t inv16 = vdupq_n_u16((uint16_t)(256 - alpha));
+    int i = 0;
+    for (; i + 4 <= length; i += 4) {
+        uint32x4_t rgb = neon_scale(vdupq_n_u32((uint32_t)palette[color >> 8]), inv16);
+        color += step;
+        neon_blend4(dst + i, rgb, alpha16);
+    }
+    scalar_jagged_blend(dst + i, length - i, color, step, palette, alpha);
+}
+
+static void neon_smooth_blend(int *dst, int length, int color, int step, const int *palette, int alpha) {
+    uint16x8_t alpha16 = vdupq_n_u16((uint16_t)alpha);
+    uint16x8_t inv16 = vdupq_n_u16((uint16_t)(256 - alpha));
+    int i = 0;
+    for (; i + 4 <= length; i += 4) {
+        uint32_t lanes[4] = {
+            (uint32_t)palette[color >> 8],
+            (uint32_t)palette[LANE_VALUE(color, step, 1) >> 8],
+            (uint32_t)palette[LANE_VALUE(color, step, 2) >> 8],
+            (uint32_t)palette[LANE_VALUE(color, step, 3) >> 8]
+        };
+        color = LANE_VALUE(color, step, 4);
+        neon_blend4(dst + i, neon_scale(vld1q_u32(lanes), inv16), alpha16);
+    }
+    scalar_smooth_blend(dst + i, length - i, color, step, palette, alpha);
+}
+
+static const Pix3DSpans NEON_SPANS = {
+    neon_fill, neon_blend, neon_jagged, neon_jagged_blend,
+    scalar_smooth, neon_smooth_blend,
+    scalar_texture, scalar_texture_transparent, "neon"
+};
+
+#endif /* PIX3D_NEON */
+
+#ifdef PIX3D_WASM
+
+/*******************************************************************************
+ * WASM SIMD128 (web builds with -msimd128)
+ *
+ * The same kernels as NEON: wasm has no gather either.
+ ******************************************************************************/
+
+/* scale_rgb() on 4 pixels */
+static inline v128_t wasm_scale(v128_t v, v128_t a16) {
+    v128_t rb = wasm_v128_and(v, wasm_i32x4_splat(0xff00ff));
+    v128_t g = wasm_v128_and(wasm_u32x4_shr(v, 8), wasm_i32x4_splat(0xff));
+    rb = wasm_u16x8_shr(wasm_i16x8_mul(rb, a16), 8);
+    g = wasm_v128_and(wasm_i16x8_mul(g, a16), wasm_i32x4_splat(0xff00));
+    return wasm_i32x4_add(rb, g);
+}
+
+static inline void wasm_blend4(int *dst, v128_t rgb, v128_t alpha16) {
+    v128_t old = wasm_v128_load(dst);
+    wasm_v128_store(dst, wasm_i32x4_add(rgb, wasm_scale(old, alpha16)));
+}
+
+static void wasm_fill(int *dst, int length, int rgb) {
+    v128_t v = wasm_i32x4_splat(rgb);
+    int i = 0;
+    for (; i + 4 <= length; i += 4) {
+        wasm_v128_store(dst + i, v);
+    }
+    scalar_fill(dst + i, length - i, rgb);
+}
+
+static void wasm_blend(int *dst, int length, int rgb, int alpha) {
+    v128_t v = wasm_i32x4_splat(rgb);
+    v128_t alpha16 = wasm_i16x8_splat((int16_t)alpha);
+    int i = 0;
+    for (; i + 4 <= length; i += 4) {
+        wasm_blend4(dst + i, v, alpha16);
+    }
+    scalar_blend(dst + i, length - i, rgb, alpha);
+}
+
+static void wasm_jagged(int *dst, int length, int color, int step, const int *palette) {
+    int i = 0;
+    for (; i + 4 <= length; i += 4) {
+        wasm_v128_store(dst + i, wasm_i32x4_splat(palette[color >> 8]));
+        color += step;
+    }
+    scalar_jagged(dst + i, length - i, color, step, palette);
+}
+
+static void wasm_jagged_blend(int *dst, int length, int color, int step, const int *palette, int alpha) {
+    v128_t alpha16 = wasm_i16x8_splat((int16_t)alpha);
+    v128_t inv16 = wasm_i16x8_splat((int16_t)(256 - alpha));
+    int i = 0;
+    for (; i + 4 <= length; i += 4) {
+        v128_t rgb = wasm_scale(wasm_i32x4_splat(palette[color >> 8]), inv16);
+        color += step;
+        wasm_blend4(dst + i, rgb, alpha16);
+    }
+    scalar_jagged_blend(dst + i, length - i, color, step, palette, alpha);
+}
+
+static void wasm_smooth_blend(int *dst, int length, int color, int step, const int *palette, int alpha) {
+    v128_t alpha16 = wasm_i16x8_splat((int16_t)alpha);
+    v128_t inv16 = wasm_i16x8_splat((int16_t)(256 - alpha));
+    int i = 0;
+    for (; i + 4 <= length; i += 4) {
+        v128_t rgb = wasm_i32x4_make(palette[color >> 8],
+                                     palette[LANE_VALUE(color, step, 1) >> 8],
+                                     palette[LANE_VALUE(color, step, 2) >> 8],
+                                     palette[LANE_VALUE(color, step, 3) >> 8]);
+        color = LANE_VALUE(color, step, 4);
+        wasm_blend4(dst + i, wasm_scale(rgb, inv16), alpha16);
+    }
+    scalar_smooth_blend(dst + i, length - i, color, step, palette, alpha);
+}
+
+static const Pix3DSpans WASM_SPANS = {
+    wasm_fill, wasm_blend, wasm_jagged, wasm_jagged_blend,
+    scalar_smooth, wasm_smooth_blend,
+    scalar_texture, scalar_texture_transparent, "simd128"
+};
+
+#endif /* PIX3D_WASM */
+
+void pix3d_spans_init(void) {
+#if defined(PIX3D_SSE2)
+    __builtin_cpu_init();
+    g_pix3d_spans = __builtin_cpu_supports("avx2") ? &AVX2_SPANS : &SSE2_SPANS;
+#elif defined(PIX3D_NEON)
+    g_pix3d_spans = &NEON_SPANS;
+#elif defined(PIX3D_WASM)
+    g_pix3d_spans = &WASM_SPANS;
+#else
+    g_pix3d_spans = &SCALAR_SPANS;
+#endif
+}
+
+const char *pix3d_span_backend(void) {
+    return g_pix3d_spans->name;
+}
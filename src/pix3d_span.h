@@ -0,0 +1,147 @@
+/*******************************************************************************
+ * PIX3D_SPAN.H - SIMD Span Fills for the Software Rasterizer
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Splitting a rasterizer into "walk the edges" and "fill a span"
+ *   - Packed 8-bit channel arithmetic in 16-bit SIMD lanes
+ *   - Gathering palette entries and texels (AVX2) versus loading them one by one
+ *   - Picking a kernel table once, by CPU feature, behind one pointer
+ *
+ * THE PROBLEM:
+ *
+ * flatTriangle(), gouraudTriangle() and textureTriangle() (pix3d.c) walk
+ * a triangle's edges one scanline at a time and hand each row to
+ * flatRaster(), gouraudRaster() or textureRaster(). Those fill the row
+ * ("span") one int pixel at a time:
+ *
+ *   y=10        ██████████████                  one span per scanline,
+ *   y=11      ██████████████████                each pixel a separate
+ *   y=12    ██████████████████████              store (plus, with alpha,
+ *                                               two multiplies per pixel)
+ *
+ * With the edges cheap and the spans long, the spans are the frame time.
+ *
+ * THE SOLUTION - SPAN KERNELS, ONE TABLE PER INSTRUCTION SET:
+ *
+ *   flatRaster / gouraudRaster      clip, step setup     (unchanged)
+ *   textureRaster                   clip, perspective divide per 8 pixels
+ *        │
+ *        └── g_pix3d_spans->fill / blend / jagged / smooth / texture ...
+ *              scalar   the original loops (every platform)
+ *              sse2     4 pixels per store        (every x86-64)
+ *              avx2     8 pixels, palette and texel gather
+ *                                                 (if the CPU has it)
+ *              neon     4 pixels per store        (arm64, armv7+neon)
+ *              simd128  4 pixels per store        (web, -msimd128)
+ *
+ *   The clipping, colour steps and perspective divides stay where they
+ *   were; a kernel only fills [dst, dst + length), so every kernel sees
+ *   the same inputs.
+ *
+ * IDENTICAL OUTPUT:
+ *   Every kernel writes exactly the pixels the scalar loop writes.
+ *
+ *   - Colours advance by repeated addition in the scalar loop; lane i
+ *     starts at color + i * step, which is the same value (mod 2^32).
+ *   - The jagged (low detail) mode keeps its 4-pixel groups: one palette
+ *     entry per group, the tail reusing the colour after the last group.
+ *   - Texels are shifted right as unsigned ints by the shade; a shade
+ *     outside 0..31 (never produced by textureTriangle) takes the scalar
+ *     kernel, whose shift does whatever the compiler's does.
+ *   - Alpha blending scales each channel as
+ *       ((c & 0xff00ff) * a >> 8 & 0xff00ff) + ((c & 0xff00) * a >> 8 & 0xff00)
+ *     Each 8-bit channel times a (<= 256) fits in 16 bits, so the same
+ *     products come out of 16-bit lane multiplies:
+ *
+ *       pixel  [xx RR GG BB]
+ *       rb     [00 RR|00 BB]  × a per 16-bit lane → >> 8 → [00 R'|00 B']
+ *       g      [00 00|00 GG]  × a                 → & ff00 → [00 00|G' 00]
+ *
+ * SELECTION:
+ *   pix3d_spans_init() (called by pix3d_init_global) asks the CPU once
+ *   (__builtin_cpu_supports, as crc32.c does) and sets g_pix3d_spans.
+ *   Until then, and on platforms with no vector unit the code knows
+ *   (Dreamcast, NDS, PSP, ...), the scalar table is used. Build with
+ *   -DPIX3D_SCALAR to keep the scalar loops everywhere.
+ *
+ *   WebAssembly cannot ask at run time: a module either uses SIMD128
+ *   or it does not load. The web build is made twice, with and without
+ *   -msimd128, and the page loads the first one its browser validates
+ *   (WebAssembly.validate() on a tiny SIMD module).
+ *
+ ******************************************************************************/
+
+#ifndef PIX3D_SPAN_H
+#define PIX3D_SPAN_H
+
+/*
+ * Pix3DTexture - Perspective state of one textured span
+ *
+ * u / w and v / w are the texel coordinates. They are divided out once
+ * per 8 pixels and stepped linearly in between:
+ *
+ *   pixel   0 ........ 7 | 8 ........ 15 | 16 ...
+ *   divide  ▲            ▲               ▲
+ *           cur → next: (next - cur) >> 3 per pixel
+ *
+ * size is log2 of the texture width: 6 (64x64, low memory) or 7
+ * (128x128); a texel is texels[(v & vmask) + (u >> size)] with
+ * vmask = (width - 1) << size. Bits 21-22 of shade pick one of the 4
+ * darker copies of the texture, bits 23+ shift the texel right.
+ */
+typedef struct {
+    int u, v, w;                    /* At the first pixel */
+    int uStride, vStride, wStride;  /* Change per 8 pixels */
+    int curU, curV;                 /* Kept where w >> (2 * size) is 0 */
+    int nextU, nextV;
+    int stepU, stepV;
+    int shade;                      /* Shade << 9 at the first pixel */
+    int shadeStride;                /* Change per 8 pixels */
+    int size;
+    int scroll;                     /* Added to every v: whole texel rows */
+} Pix3DTexture;
+
+/*
+ * Pix3DSpans - One instruction set's span kernels
+ *
+ * Every kernel fills dst[0 .. length). Colours are 8.8 fixed point
+ * palette positions (palette[color >> 8]); step is added per pixel
+ * (smooth) or per 4-pixel group (jagged). Blends take alpha in 1..256
+ * and keep alpha / 256 of the old pixel.
+ *
+ * Texture kernels start from the perspective state textureRaster() set
+ * up at the span's first pixel.
+ */
+typedef struct {
+    /* dst = rgb */
+    void (*fill)(int *dst, int length, int rgb);
+    /* dst = rgb + dst * alpha (rgb already scaled by 256 - alpha) */
+    void (*blend)(int *dst, int length, int rgb, int alpha);
+    /* Gouraud, one palette entry per 4 pixels */
+    void (*jagged)(int *dst, int length, int color, int step, const int *palette);
+    void (*jagged_blend)(int *dst, int length, int color, int step, const int *palette, int alpha);
+    /* Gouraud, one palette entry per pixel */
+    void (*smooth)(int *dst, int length, int color, int step, const int *palette);
+    void (*smooth_blend)(int *dst, int length, int color, int step, const int *palette, int alpha);
+    /* Textured (textureRaster), transparent leaving 0 texels undrawn */
+    void (*texture)(int *dst, int length, const int *texels, const Pix3DTexture *texture);
+    void (*texture_transparent)(int *dst, int length, const int *texels, const Pix3DTexture *texture);
+    const char *name;
+} Pix3DSpans;
+
+/* Kernels in use (the scalar table until pix3d_spans_init) */
+extern const Pix3DSpans *g_pix3d_spans;
+
+/*
+ * pix3d_spans_init - Pick the fastest kernels this CPU runs
+ */
+void pix3d_spans_init(void);
+
+/*
+ * pix3d_span_backend - Name of the kernels in use ("scalar", "sse2", ...)
+ */
+const char *pix3d_span_backend(void);
+
+#endif /* PIX3D_SPAN_H */
@@ -30,8 +30,15 @@ Pix8 *pix8_from_archive(Jagfile *jag, const char *name, int sprite) {
     char *filename = calloc(name_length, sizeof(char));
     snprintf(filename, name_length, "%s.dat", name);
 
-    Packet *dat = jagfile_to_packet(jag, filename);
-    Packet *idx = jagfile_to_packet(jag, "index.dat");
+    // custom: views into the archive, index.dat is read again for every sprite in it
+    Packet dat_view;
+    Packet idx_view;
+    if (!jagfile_view_packet(jag, filename, &dat_view) || !jagfile_view_packet(jag, "index.dat", &idx_view)) {
+        free(filename);
+        return NULL;
+    }
+    Packet *dat = &dat_view;
+    Packet *idx = &idx_view;
     idx->pos = g2(dat);
     const int crop_w = g2(idx);
     const int crop_h = g2(idx);
@@ -66,8 +73,6 @@ Pix8 *pix8_from_archive(Jagfile *jag, const char *name, int sprite) {
         }
     }
     free(filename);
-    packet_free(dat);
-    packet_free(idx);
     return pix8;
 }
 
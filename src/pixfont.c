@@ -3,6 +3,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "datastruct/lrucache.h"
 #include "defines.h"
 #include "jagfile.h"
 #include "packet.h"
@@ -31,6 +32,142 @@ void pixfont_init_global(void) {
 
 extern Pix2D _Pix2D;
 
+// A tagged string laid out once: the glyphs to draw, spaces and colour tags
+// already consumed. Chat lines, interface text and overhead chat are the
+// same strings frame after frame; drawing them again only walks glyphs.
+typedef struct {
+    int16_t x;   // pen x from the string's start
+    uint8_t c;   // mask index
+    int rgb;     // colour of the last tag before it, -1 for the caller's
+} PixFontGlyph;
+
+typedef struct {
+    DoublyLinkable link;
+    const PixFont *font;
+    char *str;
+    int width;   // stringWidth
+    int count;
+    PixFontGlyph glyphs[];
+} PixFontLayout;
+
+static LruCache *layout_cache;
+
+static void pixfont_layout_evicted(DoublyLinkable *value) {
+    free(((PixFontLayout *)value)->str);
+    free(value);
+}
+
+static int64_t pixfont_layout_key(const PixFont *pixfont, const char *str, size_t len) {
+    uint64_t hash = 0xcbf29ce484222325ull ^ ((uint64_t)(uintptr_t)pixfont * 0x9e3779b97f4a7c15ull);
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ (unsigned char)str[i]) * 0x100000001b3ull;
+    }
+    return (int64_t)hash;
+}
+
+static PixFontLayout *pixfont_layout_new(const PixFont *pixfont, const char *str, size_t len) {
+    PixFontLayout *layout = calloc(1, sizeof(PixFontLayout) + len * sizeof(PixFontGlyph));
+    if (!layout) {
+        return NULL;
+    }
+    layout->font = pixfont;
+
+    int x = 0;
+    int rgb = -1;
+    for (size_t i = 0; i < len; i++) {
+        if (str[i] == '@' && i + 4 < len && str[i + 4] == '@') {
+            char tag[4] = {str[i + 1], str[i + 2], str[i + 3], '\0'};
+            rgb = evaluateTag(tag);
+            i += 4;
+        } else {
+            int c = CHARCODESET[(unsigned char)str[i]];
+            if (c != 94) {
+                layout->glyphs[layout->count++] = (PixFontGlyph){(int16_t)x, (uint8_t)c, rgb};
+            }
+            x += pixfont->charAdvance[c];
+        }
+    }
+    layout->width = x;
+    return layout;
+}
+
+// the cached layout of str, or NULL with *scratch set to one the caller frees
+static PixFontLayout *pixfont_layout(const PixFont *pixfont, const char *str, PixFontLayout **scratch) {
+    size_t len = strlen(str);
+    *scratch = NULL;
+    if (!layout_cache) {
+        layout_cache = lrucache_new(PIXFONT_LAYOUT_CACHE);
+        lrucache_set_evicted(layout_cache, pixfont_layout_evicted);
+    }
+
+    int64_t key = pixfont_layout_key(pixfont, str, len);
+    PixFontLayout *cached = (PixFontLayout *)lrucache_get(layout_cache, key);
+    if (cached && cached->font == pixfont && strcmp(cached->str, str) == 0) {
+        return cached;
+    }
+
+    PixFontLayout *layout = pixfont_layout_new(pixfont, str, len);
+    if (!layout || cached) {
+        // another string hashed to this key: leave its entry be
+        *scratch = layout;
+        return NULL;
+    }
+    layout->str = malloc(len + 1);
+    if (!layout->str) {
+        *scratch = layout;
+        return NULL;
+    }
+    memcpy(layout->str, str, len + 1);
+    lrucache_put(layout_cache, key, &layout->link);
+    return layout;
+}
+
+static void pixfont_draw_layout(PixFont *pixfont, const PixFontLayout *layout, int x, int y, int rgb, bool shadowed) {
+    int offY = y - pixfont->height;
+    for (int i = 0; i < layout->count; i++) {
+        const PixFontGlyph *glyph = &layout->glyphs[i];
+        if (shadowed) {
+            drawGlyph(pixfont, glyph->c, x + glyph->x + 1, offY + 1, 0);
+        }
+        drawGlyph(pixfont, glyph->c, x + glyph->x, offY, glyph->rgb < 0 ? rgb : glyph->rgb);
+    }
+}
+
+// opaque runs of a w x h mask, see PixFont.charSpans
+static int16_t *pixfont_spans(const int8_t *mask, int w, int h) {
+    int count = h;
+    for (int i = 0; i < w * h; i++) {
+        if (mask[i] != 0 && (i % w == 0 || mask[i - 1] == 0)) {
+            count += 2;
+        }
+    }
+
+    int16_t *spans = malloc(count * sizeof(int16_t));
+    if (!spans) {
+        return NULL;
+    }
+    int16_t *out = spans;
+    for (int y = 0; y < h; y++) {
+        const int8_t *row = mask + y * w;
+        int16_t *runs = out++;
+        *runs = 0;
+        for (int x = 0; x < w;) {
+            if (row[x] == 0) {
+                x++;
+                continue;
+            }
+            int start = x;
+            while (x < w && row[x] != 0) {
+                x++;
+            }
+            *out++ = (int16_t)start;
+            *out++ = (int16_t)(x - start);
+            (*runs)++;
+        }
+    }
+    return spans;
+}
+
 PixFont *pixfont_new(void) {
     PixFont *pixfont = calloc(1, sizeof(PixFont));
     pixfont->charMask = malloc(94 * sizeof(int8_t *));
@@ -40,15 +177,22 @@ PixFont *pixfont_new(void) {
     pixfont->charOffsetY = malloc(94 * sizeof(int));
     pixfont->charAdvance = malloc(95 * sizeof(int));
     pixfont->drawWidth = malloc(256 * sizeof(int));
+    pixfont->charSpans = calloc(94, sizeof(int16_t *));
     pixfont->height = false;
     // pixfont->random;// = new Random(); // NOTE does this matter at all
     return pixfont;
 }
 
 void pixfont_free(PixFont *pixfont) {
+    // layouts point at their font; fonts are only freed together, at exit
+    if (layout_cache) {
+        lrucache_clear(layout_cache);
+    }
     for (int i = 0; i < 94; i++) {
         free(pixfont->charMask[i]);
+        free(pixfont->charSpans[i]);
     }
+    free(pixfont->charSpans);
     free(pixfont->charMask);
     free(pixfont->charMaskWidth);
     free(pixfont->charMaskHeight);
@@ -64,8 +208,15 @@ PixFont *pixfont_from_archive(Jagfile *title, const char *font) {
     size_t name_length = strlen(font) + 5;
     char *filename = malloc(name_length);
     snprintf(filename, name_length, "%s.dat", font);
-    Packet *dat = jagfile_to_packet(title, filename);
-    Packet *idx = jagfile_to_packet(title, "index.dat");
+    // custom: views into the archive, see pix8_from_archive
+    Packet dat_view;
+    Packet idx_view;
+    if (!jagfile_view_packet(title, filename, &dat_view) || !jagfile_view_packet(title, "index.dat", &idx_view)) {
+        free(filename);
+        return NULL;
+    }
+    Packet *dat = &dat_view;
+    Packet *idx = &idx_view;
     idx->pos = g2(dat) + 4;
 
     int off = g1(idx);
@@ -123,6 +274,8 @@ PixFont *pixfont_from_archive(Jagfile *title, const char *font) {
         if (space <= h / 7) {
             pixfont->charAdvance[i]--;
         }
+
+        pixfont->charSpans[i] = pixfont_spans(pixfont->charMask[i], w, h);
     }
 
     pixfont->charAdvance[94] = pixfont->charAdvance[8];
@@ -130,8 +283,6 @@ PixFont *pixfont_from_archive(Jagfile *title, const char *font) {
         pixfont->drawWidth[c] = pixfont->charAdvance[CHARCODESET[c]];
     }
     free(filename);
-    packet_free(dat);
-    packet_free(idx);
     return pixfont;
 }
 
@@ -148,16 +299,15 @@ int stringWidth(PixFont *pixfont, const char *str) {
         return 0;
     }
 
-    int size = 0;
-    for (size_t c = 0; c < strlen(str); c++) {
-        if (str[c] == '@' && c + 4 < strlen(str) && str[c + 4] == '@') {
-            c += 4;
-        } else {
-            size += pixfont->drawWidth[(unsigned char)str[c]];
-        }
+    PixFontLayout *scratch;
+    PixFontLayout *layout = pixfont_layout(pixfont, str, &scratch);
+    if (!layout) {
+        int size = scratch ? scratch->width : 0;
+        free(scratch);
+        return size;
     }
 
-    return size;
+    return layout->width;
 }
 
 void drawString(PixFont *pixfont, int x, int y, const char *str, int rgb) {
@@ -167,10 +317,10 @@ void drawString(PixFont *pixfont, int x, int y, const char *str, int rgb) {
 
     int offY = y - pixfont->height;
 
-    for (size_t i = 0; i < strlen(str); i++) {
+    for (size_t i = 0; str[i] != '\0'; i++) {
         int c = CHARCODESET[(unsigned char)str[i]];
         if (c != 94) {
-            drawChar(pixfont->charMask[c], x + pixfont->charOffsetX[c], offY + pixfont->charOffsetY[c], pixfont->charMaskWidth[c], pixfont->charMaskHeight[c], rgb);
+            drawGlyph(pixfont, c, x, offY, rgb);
         }
 
         x += pixfont->charAdvance[c];
@@ -193,7 +343,7 @@ void drawCenteredWave(PixFont *pixfont, int x, int y, const char *str, int rgb,
     x -= stringWidth(pixfont, str) / 2;
     int offY = y - pixfont->height;
 
-    for (size_t i = 0; i < strlen(str); i++) {
+    for (size_t i = 0; str[i] != '\0'; i++) {
         int c = CHARCODESET[(unsigned char)str[i]];
 
         if (c != 94) {
@@ -209,27 +359,15 @@ void drawStringTaggable(PixFont *pixfont, int x, int y, const char *str, int rgb
         return;
     }
 
-    int offY = y - pixfont->height;
-
-    for (size_t i = 0; i < strlen(str); i++) {
-        if (str[i] == '@' && i + 4 < strlen(str) && str[i + 4] == '@') {
-            char *sub = substring(str, i + 1, i + 4);
-            rgb = evaluateTag(sub);
-            free(sub);
-            i += 4;
-        } else {
-            int c = CHARCODESET[(unsigned char)str[i]];
-            if (c != 94) {
-                if (shadowed) {
-                    drawChar(pixfont->charMask[c], x + pixfont->charOffsetX[c] + 1, offY + pixfont->charOffsetY[c] + 1, pixfont->charMaskWidth[c], pixfont->charMaskHeight[c], 0);
-                }
-
-                drawChar(pixfont->charMask[c], x + pixfont->charOffsetX[c], offY + pixfont->charOffsetY[c], pixfont->charMaskWidth[c], pixfont->charMaskHeight[c], rgb);
-            }
-
-            x += pixfont->charAdvance[c];
-        }
+    PixFontLayout *scratch;
+    PixFontLayout *layout = pixfont_layout(pixfont, str, &scratch);
+    if (!layout) {
+        layout = scratch;
+    }
+    if (layout) {
+        pixfont_draw_layout(pixfont, layout, x, y, rgb, shadowed);
     }
+    free(scratch);
 }
 
 void drawStringTooltip(PixFont *pixfont, int x, int y, const char *str, int color, bool shadowed, int seed) {
@@ -242,11 +380,11 @@ void drawStringTooltip(PixFont *pixfont, int x, int y, const char *str, int colo
 
     int random = (rand() & 0x1f) + 192;
     int offY = y - pixfont->height;
-    for (size_t i = 0; i < strlen(str); i++) {
-        if (str[i] == '@' && i + 4 < strlen(str) && str[i + 4] == '@') {
-            char *sub = substring(str, i + 1, i + 4);
-            color = evaluateTag(sub);
-            free(sub);
+    size_t len = strlen(str);
+    for (size_t i = 0; i < len; i++) {
+        if (str[i] == '@' && i + 4 < len && str[i + 4] == '@') {
+            char tag[4] = {str[i + 1], str[i + 2], str[i + 3], '\0'};
+            color = evaluateTag(tag);
             i += 4;
         } else {
             int c = CHARCODESET[(unsigned char)str[i]];
@@ -347,6 +485,28 @@ void drawChar(int8_t *data, int x, int y, int w, int h, int rgb) {
     }
 }
 
+void drawGlyph(PixFont *pixfont, int c, int x, int y, int rgb) {
+    x += pixfont->charOffsetX[c];
+    y += pixfont->charOffsetY[c];
+    int w = pixfont->charMaskWidth[c];
+    int h = pixfont->charMaskHeight[c];
+    const int16_t *spans = pixfont->charSpans[c];
+    if (!spans || x < _Pix2D.left || y < _Pix2D.top || x + w >= _Pix2D.right || y + h >= _Pix2D.bottom) {
+        drawChar(pixfont->charMask[c], x, y, w, h, rgb);
+        return;
+    }
+
+    int *row = _Pix2D.pixels + x + y * _Pix2D.width;
+    for (int j = 0; j < h; j++, row += _Pix2D.width) {
+        for (int runs = *spans++; runs > 0; runs--, spans += 2) {
+            int *dst = row + spans[0];
+            for (int k = spans[1]; k > 0; k--) {
+                *dst++ = rgb;
+            }
+        }
+    }
+}
+
 void drawMask(int w, int h, int8_t *src, int srcOff, int srcStep, int *dst, int dstOff, int dstStep, int rgb) {
     int hw = -(w >> 2);
     w = -(w & 0x3);
@@ -19,8 +19,13 @@ typedef struct {
     int *charAdvance;
     int *drawWidth;
     int height;
+    // opaque runs of each mask, row by row: run count, then start and length of each
+    int16_t **charSpans;
 } PixFont;
 
+// laid out tagged strings kept for reuse (stringWidth, drawStringTaggable)
+#define PIXFONT_LAYOUT_CACHE 512
+
 PixFont *pixfont_new(void);
 void pixfont_free(PixFont *pixfont);
 void pixfont_init_global(void);
@@ -35,6 +40,8 @@ void drawStringTaggable(PixFont *pixfont, int x, int y, const char *str, int rgb
 void drawStringTooltip(PixFont *pixfont, int x, int y, const char *str, int color, bool shadowed, int seed);
 int evaluateTag(const char *tag);
 void drawChar(int8_t *data, int x, int y, int w, int h, int rgb);
+// a glyph of pixfont at x, y: its opaque runs filled when unclipped, else drawChar
+void drawGlyph(PixFont *pixfont, int c, int x, int y, int rgb);
 void drawMask(int w, int h, int8_t *src, int srcOff, int srcStep, int *dst, int dstOff, int dstStep, int rgb);
 void drawCharAlpha(int x, int y, int w, int h, int rgb, int alpha, int8_t *mask);
 void drawMaskAlpha(int w, int h, int *dst, int dstOff, int dstStep, int8_t *mask, int maskOff, int maskStep, int color, int alpha);
@@ -1,9 +1,12 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "defines.h"
 #include "pix2d.h"
 #include "pixmap.h"
 
+static int presented_epoch = 1;
+
 PixMap *pixmap_new(int width, int height) {
     PixMap *pixmap = calloc(1, sizeof(PixMap));
     pixmap->width = width;
@@ -16,6 +19,8 @@ PixMap *pixmap_new(int width, int height) {
 
 void pixmap_free(PixMap *pixmap) {
     platform_free_surface(pixmap->image);
+    free(pixmap->presented);
+    free(pixmap->layer);
     free(pixmap->pixels);
     free(pixmap);
 }
@@ -28,6 +33,87 @@ void pixmap_bind(PixMap *pixmap) {
     pix2d_bind(pixmap->width, pixmap->height, pixmap->pixels);
 }
 
+void pixmap_track_dirty(PixMap *pixmap, bool enabled) {
+#if PIXMAP_DIRTY_TRACKING
+    if (enabled && !pixmap->presented) {
+        pixmap->presented = malloc(pixmap->width * pixmap->height * sizeof(int));
+        pixmap->epoch = 0; // first draw blits it whole
+    } else if (!enabled) {
+        free(pixmap->presented);
+        pixmap->presented = NULL;
+    }
+#else
+    (void)pixmap;
+    (void)enabled;
+#endif
+}
+
+void pixmap_invalidate_all(void) {
+    presented_epoch++;
+}
+
+void pixmap_keep_layer(PixMap *pixmap, bool keep) {
+    pixmap->layer_kept = false;
+    if (!keep) {
+        return;
+    }
+    if (!pixmap->layer) {
+        pixmap->layer = malloc(pixmap->width * pixmap->height * sizeof(int));
+        if (!pixmap->layer) {
+            return;
+        }
+    }
+    memcpy(pixmap->layer, pixmap->pixels, pixmap->width * pixmap->height * sizeof(int));
+    pixmap->layer_kept = true;
+}
+
+bool pixmap_restore_layer(PixMap *pixmap) {
+    if (!pixmap->layer_kept) {
+        return false;
+    }
+    memcpy(pixmap->pixels, pixmap->layer, pixmap->width * pixmap->height * sizeof(int));
+    return true;
+}
+
 void pixmap_draw(PixMap *pixmap, int x, int y) {
-    platform_blit_surface(pixmap->image, x, y);
+    if (!pixmap->presented || pixmap->epoch != presented_epoch) {
+        if (pixmap->presented) {
+            memcpy(pixmap->presented, pixmap->pixels, pixmap->width * pixmap->height * sizeof(int));
+            pixmap->epoch = presented_epoch;
+        }
+        platform_blit_surface(pixmap->image, x, y);
+        return;
+    }
+
+    // diff against the last blit row by row, growing one bounding box
+    // (drawing code writes the pixels directly through pix2d, so the changes are only known here)
+    const int width = pixmap->width;
+    int top = -1, bottom = -1, left = width, right = -1;
+    for (int row = 0; row < pixmap->height; row++) {
+        const int *now = pixmap->pixels + row * width;
+        int *was = pixmap->presented + row * width;
+        if (memcmp(now, was, width * sizeof(int)) == 0) {
+            continue;
+        }
+        int first = 0;
+        while (now[first] == was[first]) {
+            first++;
+        }
+        int last = width - 1;
+        while (now[last] == was[last]) {
+            last--;
+        }
+        memcpy(was + first, now + first, (last - first + 1) * sizeof(int));
+        if (top < 0) {
+            top = row;
+        }
+        bottom = row;
+        left = MIN(left, first);
+        right = MAX(right, last);
+    }
+
+    if (top < 0) {
+        return; // unchanged: the window already shows it
+    }
+    platform_blit_surface_region(pixmap->image, x, y, left, top, right - left + 1, bottom - top + 1);
 }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <stdbool.h>
+
 #include "platform.h"
 
 struct PixMap {
@@ -7,6 +9,10 @@ struct PixMap {
     int height;
     Surface *image;
     int *pixels;
+    int *presented; // copy of the pixels last blitted, NULL if not tracking changes
+    int epoch;      // presented is valid while this matches pixmap_invalidate_all's count
+    int *layer;     // pixels saved by pixmap_keep_layer, NULL until first kept
+    bool layer_kept;
 };
 
 PixMap *pixmap_new(int width, int height);
@@ -14,3 +20,11 @@ void pixmap_free(PixMap *pixmap);
 void pixmap_clear(PixMap *pixmap);
 void pixmap_bind(PixMap *pixmap);
 void pixmap_draw(PixMap *pixmap, int x, int y);
+// blit only the bounding box of what changed since the last draw (for areas redrawn whole but mostly unchanged)
+void pixmap_track_dirty(PixMap *pixmap, bool enabled);
+// the window lost its contents: the next draw of every pixmap blits it whole
+void pixmap_invalidate_all(void);
+// save the pixels drawn so far (an interface about to be covered by a menu), or forget the saved ones
+void pixmap_keep_layer(PixMap *pixmap, bool keep);
+// put the saved pixels back instead of drawing them again; false if none are kept
+bool pixmap_restore_layer(PixMap *pixmap);
@@ -67,6 +67,14 @@ void platform_set_midi(const char *name, int crc, int len);
 void platform_stop_midi(void);
 void platform_poll_events(Client *c);
 void platform_blit_surface(Surface *surface, int x, int y);
+// blit only the part (sx, sy, w, h) of a surface drawn at x, y; presented by the next update_surface
+void platform_blit_surface_region(Surface *surface, int x, int y, int sx, int sy, int w, int h);
 void platform_update_surface(void);
+#if defined(PIX3D_GPU) && defined(SDL) && SDL > 1
+// a hidden GL ES 2 context for pix3d_gpu.h, separate from the window's renderer
+bool platform_gl_init(void);
+void *platform_gl_proc(const char *name);
+void platform_gl_make_current(void);
+#endif
 uint64_t rs2_now(void);
 void rs2_sleep(int ms);
@@ -29,16 +29,29 @@ void platform_blit_surface(Surface *surface, int x, int y) {
     platform_set_pixels(NULL, surface, x, y, false);
 }
 
+// only SDL 2/3 blit regions (PIXMAP_DIRTY_TRACKING): blit the whole surface
+void platform_blit_surface_region(Surface *surface, int x, int y, int sx, int sy, int w, int h) {
+    (void)sx;
+    (void)sy;
+    (void)w;
+    (void)h;
+    platform_blit_surface(surface, x, y);
+}
+
 void platform_poll_events(Client *c) {
     (void)c;
 }
 
+// no clock to read: time passes as the shell sleeps, so its tick deadlines
+// are met one after another without waiting
+static uint64_t dummy_now;
+
 uint64_t rs2_now(void) {
-    return 0;
+    return dummy_now;
 }
 
 void rs2_sleep(int ms) {
-    (void)ms;
+    dummy_now += ms;
 }
 
 void platform_set_wave_volume(int wavevol) {
@@ -3,6 +3,9 @@
 #include <emscripten.h>
 #include <emscripten/html5.h>
 #include <emscripten/key_codes.h>
+#ifdef __EMSCRIPTEN_PTHREADS__
+#include <emscripten/threading.h>
+#endif
 
 #include <malloc.h>
 
@@ -11,6 +14,7 @@
 #include "../gameshell.h"
 #include "../inputtracking.h"
 #include "../platform.h"
+#include "../sound/mix.h"
 
 extern ClientData _Client;
 extern InputTracking _InputTracking;
@@ -30,53 +34,47 @@ static tsf *g_TinySoundFont;
 static double g_Msec;              // current playback time
 static tml_message *g_MidiMessage; // next message to be played
 
+// The client can run on the page or, built with -pthread -sPROXY_TO_PTHREAD
+// -sOFFSCREENCANVAS_SUPPORT -sOFFSCREENCANVASES_TO_PTHREAD=#canvas, on a
+// worker: main() then runs off the page's thread, so page work and GC pauses
+// there no longer hold up a tick, and the canvas is an OffscreenCanvas that
+// Emscripten hands to the worker. The html5 callbacks below are registered
+// from whichever thread runs main(), so on the worker the browser events are
+// queued to it and run while it sleeps (rs2_sleep), between ticks.
+//
+// The 2D context is looked up once: on the worker there is no document, and
+// the transferred canvas is Module['canvas'] (or GL.offscreenCanvases).
+EM_JS(void, canvas_init_js, (void), {
+    const canvas = typeof document !== 'undefined' ? document.getElementById('canvas') : (Module['canvas'] || GL.offscreenCanvases['canvas'].offscreenCanvas);
+    Module['rs2Context'] = canvas.getContext('2d');
+})
+
 EM_JS(void, set_font_js, (const char* name, bool bold, int size), {
-    const canvas = document.getElementById('canvas');
-    const ctx = canvas.getContext('2d');
     const weight = bold ? 'bold ' : 'normal ';
-    ctx.font = weight + size + 'px Helvetica, sans-serif';
+    Module['rs2Context'].font = weight + size + 'px Helvetica, sans-serif';
 })
 
 EM_JS(void, set_color_js, (int color), {
-    const canvas = document.getElementById('canvas');
-    const ctx = canvas.getContext('2d');
+    const ctx = Module['rs2Context'];
     const hexColor = '#' + ('000000' + color.toString(16)).slice(-6);
     ctx.fillStyle = hexColor;
     ctx.strokeStyle = hexColor;
 })
 
 EM_JS(int, string_width_js, (const char* str), {
-    const canvas = document.getElementById('canvas');
-    const ctx = canvas.getContext('2d');
-    return ctx.measureText(UTF8ToString(str)).width;
+    return Module['rs2Context'].measureText(UTF8ToString(str)).width;
 })
 
 EM_JS(void, draw_string_js, (const char *str, int x, int y), {
-    const canvas = document.getElementById('canvas');
-    const ctx = canvas.getContext('2d');
-    ctx.fillText(UTF8ToString(str), x, y);
+    Module['rs2Context'].fillText(UTF8ToString(str), x, y);
 })
 
 EM_JS(void, draw_rect_js, (int x, int y, int w, int h), {
-    const ctx = document.getElementById('canvas').getContext('2d');
-    ctx.strokeRect(x, y, w, h);
+    Module['rs2Context'].strokeRect(x, y, w, h);
 })
 
 EM_JS(void, fill_rect_js, (int x, int y, int w, int h), {
-    const ctx = document.getElementById('canvas').getContext('2d');
-    ctx.fillRect(x, y, w, h);
-})
-
-EM_JS(float, frame_insets_left_js, (void), {
-    const canvas = document.getElementById('canvas');
-    const rect = canvas.getBoundingClientRect();
-    return rect.left;
-})
-
-EM_JS(float, frame_insets_top_js, (void), {
-    const canvas = document.getElementById('canvas');
-    const rect = canvas.getBoundingClientRect();
-    return rect.top;
+    Module['rs2Context'].fillRect(x, y, w, h);
 })
 
 EM_JS(void, set_pixels_js, (int x, int y, int width, int height, int *pixels), {
@@ -95,8 +93,7 @@ EM_JS(void, set_pixels_js, (int x, int y, int width, int height, int *pixels), {
         }
     }
 
-    const ctx = document.getElementById('canvas').getContext('2d');
-    ctx.putImageData(imageData, x, y);
+    Module['rs2Context'].putImageData(imageData, x, y);
 })
 
 static float *midi_buffer;
@@ -117,11 +114,7 @@ void platform_play_wave(int8_t *src, int length) {
         free(wave_buffer);
         return;
     }
-    if (g_wavevol != 128) {
-        for (uint32_t i = 0; i < wave_length; i++) {
-            wave_buffer[i] = (wave_buffer[i] - 128) * g_wavevol / 128 + 128;
-        }
-    }
+    mix_volume_u8(wave_buffer, wave_length, g_wavevol);
     const int wave_bytes_already_in_stream = SDL_GetAudioStreamAvailable(wave_stream);
     if (wave_bytes_already_in_stream == 0) {
         if (!SDL_PutAudioStreamData(wave_stream, wave_buffer, wave_length)) {
@@ -207,6 +200,21 @@ static bool onkeyup(int event_type, const EmscriptenKeyboardEvent *e, void *user
 
 void platform_new(GameShell *shell) {
     emscripten_set_canvas_element_size("#canvas", shell->screen_width, shell->screen_height);
+    canvas_init_js();
+#ifdef __EMSCRIPTEN_PTHREADS__
+    if (!emscripten_is_main_browser_thread()) {
+        // a worker's callbacks run after the event, too late for
+        // preventDefault: the page keeps the keys the game takes, except
+        // those the browser needs (reload, fullscreen, developer tools)
+        MAIN_THREAD_EM_ASM({
+            document.getElementById('canvas').addEventListener('keydown', (e) => {
+                if (e.key != 'F5' && e.key != 'F11' && e.key != 'F12') {
+                    e.preventDefault();
+                }
+            });
+        });
+    }
+#endif
 
     emscripten_set_mousemove_callback("#canvas", shell, false, onmousemove);
     emscripten_set_mousedown_callback("#canvas", shell, false, onmousedown);
@@ -342,8 +350,9 @@ void platform_stop_midi(void) {
 static bool onmousemove(int event_type, const EmscriptenMouseEvent *e, void *user_data) {
     (void)event_type;
     GameShell *shell = user_data;
-    int x = e->clientX - frame_insets_left_js();
-    int y = e->clientY - frame_insets_top_js();
+    // relative to the canvas, measured on the page for a worker too
+    int x = e->targetX;
+    int y = e->targetY;
 
     shell->idle_cycles = 0;
     shell->mouse_x = x;
@@ -358,8 +367,8 @@ static bool onmousemove(int event_type, const EmscriptenMouseEvent *e, void *use
 static bool onmousedown(int event_type, const EmscriptenMouseEvent *e, void *user_data) {
     (void)event_type;
     GameShell *shell = user_data;
-    int x = e->clientX - frame_insets_left_js();
-    int y = e->clientY - frame_insets_top_js();
+    int x = e->targetX;
+    int y = e->targetY;
 
     shell->idle_cycles = 0;
     shell->mouse_click_x = x;
@@ -587,6 +596,14 @@ void platform_poll_events(Client *c) {
 void platform_blit_surface(Surface *surface, int x, int y) {
     set_pixels_js(x, y, surface->w, surface->h, surface->pixels);
 }
+// only SDL 2/3 blit regions (PIXMAP_DIRTY_TRACKING): blit the whole surface
+void platform_blit_surface_region(Surface *surface, int x, int y, int sx, int sy, int w, int h) {
+    (void)sx;
+    (void)sy;
+    (void)w;
+    (void)h;
+    platform_blit_surface(surface, x, y);
+}
 int platform_string_width(const char* str) {
     return string_width_js(str);
 }
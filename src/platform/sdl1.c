@@ -210,6 +210,12 @@ void platform_blit_surface(Surface *surface, int x, int y) {
     SDL_BlitSurface(surface, NULL, window_surface, &dest);
 }
 
+void platform_blit_surface_region(Surface *surface, int x, int y, int sx, int sy, int w, int h) {
+    SDL_Rect src = {sx, sy, w, h};
+    SDL_Rect dest = {x + sx, y + sy, w, h};
+    SDL_BlitSurface(surface, &src, window_surface, &dest);
+}
+
 void platform_update_surface(void) {
     SDL_Flip(window_surface);
 }
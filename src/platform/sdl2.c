@@ -11,6 +11,8 @@
 #include "../gameshell.h"
 #include "../inputtracking.h"
 #include "../pixmap.h"
+#include "../sound/mix.h"
+#include "../spsc_ring.h"
 
 #include "../thirdparty/bzip.h"
 #define TSF_IMPLEMENTATION
@@ -35,6 +37,17 @@ static tsf *g_TinySoundFont;
 static double g_Msec;              // current playback time
 static tml_message *g_MidiMessage; // next message to be played
 
+// custom: songs are rendered ahead on their own thread into a PCM ring and the audio callback only copies out of
+// it, so a stretch of expensive voices spends time the producer has banked instead of underrunning the device
+#define MIDI_FRAME_BYTES (2 * sizeof(float)) // stereo interleaved
+#define MIDI_RING_FRAMES 16384               // ~370 ms at 44100 Hz: four of the device's 4096-sample callbacks
+static SpscRing midi_ring;
+static SDL_Thread *midi_thread;
+static SDL_mutex *midi_mutex; // g_TinySoundFont and the song position: the producer while rendering, the game
+                              // thread while it changes them
+static SDL_sem *midi_wake;    // posted by the callback when it has made room
+static SDL_atomic_t midi_running;
+
 static SDL_Window *window;
 static SDL_Surface *window_surface;
 static SDL_Texture *texture;
@@ -62,12 +75,7 @@ void platform_play_wave(int8_t *src, int length) {
 
     SDL_LoadWAV_RW(rw, 1, &wavSpec, &wavBuffer, &wavLength);
 
-    // TODO precompute volume table just for 128 96 64 32?
-    if (g_wavevol != 128) {
-        for (uint32_t i = 0; i < wavLength; i++) {
-            wavBuffer[i] = (wavBuffer[i] - 128) * g_wavevol / 128 + 128;
-        }
-    }
+    mix_volume_u8(wavBuffer, wavLength, g_wavevol);
 
     // TODO rm
     // rs2_log("wav %i %i %i\n", wavSpec.freq, wavSpec.samples, wavSpec.format);
@@ -79,23 +87,15 @@ void platform_play_wave(int8_t *src, int length) {
     SDL_FreeWAV(wavBuffer);
 }
 
-// TODO separate sdl1? or separate midi
-static void midi_callback(void *data, uint8_t *stream, int len) {
-    (void)data;
-// Number of samples to process
-#if SDL == 1
-    int SampleBlock, SampleCount = (len / (2 * sizeof(short))); // 2 output channels
-    for (SampleBlock = TSF_RENDER_EFFECTSAMPLEBLOCK; SampleCount; SampleCount -= SampleBlock, stream += (SampleBlock * (2 * sizeof(short)))) {
-#else
-    int SampleBlock, SampleCount = (len / (2 * sizeof(float))); // 2 output channels
-    for (SampleBlock = TSF_RENDER_EFFECTSAMPLEBLOCK; SampleCount; SampleCount -= SampleBlock, stream += (SampleBlock * (2 * sizeof(float)))) {
-#endif
+// advance the song and render frames of it, in blocks of TSF_RENDER_EFFECTSAMPLEBLOCK
+static void midi_render(float *out, int frames) {
+    for (int block = TSF_RENDER_EFFECTSAMPLEBLOCK; frames; frames -= block, out += block * 2) {
         // We progress the MIDI playback and then process TSF_RENDER_EFFECTSAMPLEBLOCK samples at once
-        if (SampleBlock > SampleCount)
-            SampleBlock = SampleCount;
+        if (block > frames)
+            block = frames;
 
         // Loop through all MIDI messages which need to be played up until the current playback time
-        for (g_Msec += SampleBlock * (1000.0 / 44100.0); g_MidiMessage && g_Msec >= g_MidiMessage->time; g_MidiMessage = g_MidiMessage->next) {
+        for (g_Msec += block * (1000.0 / 44100.0); g_MidiMessage && g_Msec >= g_MidiMessage->time; g_MidiMessage = g_MidiMessage->next) {
             switch (g_MidiMessage->type) {
             case TML_PROGRAM_CHANGE: // channel program (preset) change (special handling for 10th MIDI channel with drums)
                 tsf_channel_set_presetnumber(g_TinySoundFont, g_MidiMessage->channel, g_MidiMessage->program, (g_MidiMessage->channel == 9));
@@ -115,15 +115,104 @@ static void midi_callback(void *data, uint8_t *stream, int len) {
             }
         }
 
-// Render the block of audio samples in float format
-#if SDL == 1
-        tsf_render_short(g_TinySoundFont, (int16_t *)stream, SampleBlock, 0);
-#else
-        tsf_render_float(g_TinySoundFont, (float *)stream, SampleBlock, 0);
-#endif
+        // Render the block of audio samples in float format
+        tsf_render_float(g_TinySoundFont, out, block, 0);
     }
 }
 
+static int midi_produce(void *data) {
+    (void)data;
+    float block[TSF_RENDER_EFFECTSAMPLEBLOCK * 2];
+    while (SDL_AtomicGet(&midi_running)) {
+        while (spsc_ring_free_space(&midi_ring) >= sizeof(block)) {
+            // held across the push too: a song change resets the ring and must not see a block half added
+            SDL_LockMutex(midi_mutex);
+            midi_render(block, TSF_RENDER_EFFECTSAMPLEBLOCK);
+            spsc_ring_push(&midi_ring, (const u8 *)block, sizeof(block));
+            SDL_UnlockMutex(midi_mutex);
+        }
+        SDL_SemWaitTimeout(midi_wake, 50);
+    }
+    return 0;
+}
+
+static void midi_callback(void *data, uint8_t *stream, int len) {
+    (void)data;
+    if (!midi_thread) {
+        midi_render((float *)stream, len / MIDI_FRAME_BYTES);
+        return;
+    }
+
+    u32 copied = spsc_ring_pop(&midi_ring, stream, (u32)len);
+    if (copied < (u32)len) {
+        // the producer is behind (a song just started or it was starved): render the rest here as before, unless
+        // it is in the middle of a block; popping again under the lock keeps its blocks ahead of these frames
+        if (SDL_TryLockMutex(midi_mutex) == 0) {
+            copied += spsc_ring_pop(&midi_ring, stream + copied, (u32)len - copied);
+            midi_render((float *)(stream + copied), (len - copied) / MIDI_FRAME_BYTES);
+            SDL_UnlockMutex(midi_mutex);
+        } else {
+            memset(stream + copied, 0, len - copied);
+        }
+    }
+    if (SDL_SemValue(midi_wake) == 0) {
+        SDL_SemPost(midi_wake);
+    }
+}
+
+// keep the producer and the audio callback out while the song or the synth changes
+static void midi_lock(void) {
+    if (midi_thread) {
+        SDL_LockMutex(midi_mutex);
+    }
+    SDL_LockAudio();
+}
+
+// let both run again; flush discards what was rendered ahead of the old song
+static void midi_unlock(bool flush) {
+    if (midi_thread && flush) {
+        spsc_ring_reset(&midi_ring);
+    }
+    SDL_UnlockAudio();
+    if (midi_thread) {
+        SDL_UnlockMutex(midi_mutex);
+        SDL_SemPost(midi_wake);
+    }
+}
+
+static void midi_start_producer(void) {
+    if (!spsc_ring_init(&midi_ring, MIDI_RING_FRAMES * MIDI_FRAME_BYTES)) {
+        return;
+    }
+    midi_mutex = SDL_CreateMutex();
+    midi_wake = SDL_CreateSemaphore(0);
+    SDL_AtomicSet(&midi_running, 1);
+    if (midi_mutex && midi_wake) {
+        midi_thread = SDL_CreateThread(midi_produce, "midi", NULL);
+    }
+    if (!midi_thread) {
+        rs2_error("SDL2: MIDI thread creation failed, rendering in the audio callback: %s\n", SDL_GetError());
+    }
+}
+
+static void midi_stop_producer(void) {
+    if (midi_thread) {
+        SDL_AtomicSet(&midi_running, 0);
+        SDL_SemPost(midi_wake);
+        SDL_WaitThread(midi_thread, NULL);
+        midi_thread = NULL;
+    }
+    if (midi_mutex) {
+        SDL_DestroyMutex(midi_mutex);
+        midi_mutex = NULL;
+    }
+    if (midi_wake) {
+        SDL_DestroySemaphore(midi_wake);
+        midi_wake = NULL;
+    }
+    spsc_ring_free(&midi_ring);
+}
+
 bool platform_init(void) {
     SDL_SetHint(SDL_HINT_MOUSE_FOCUS_CLICKTHROUGH, "1");
     if (_Custom.resizable) {
@@ -256,6 +345,8 @@ void platform_new(GameShell *shell) {
 
         if (SDL_OpenAudio(&midiSpec, NULL) < 0) {
             rs2_error("Could not open the audio hardware or the desired audio output format\n");
+        } else {
+            midi_start_producer();
         }
         SDL_PauseAudio(0);
     }
@@ -273,6 +364,43 @@ void platform_new(GameShell *shell) {
     }
 }
 
+#ifdef PIX3D_GPU
+static SDL_Window *gl_window;
+static SDL_GLContext gl_context;
+
+bool platform_gl_init(void) {
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_ES);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 2);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 0);
+    // the scene is drawn offscreen (pix3d_gpu.c), this window is never shown
+    gl_window = SDL_CreateWindow("", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 1, 1, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+    if (gl_window) {
+        gl_context = SDL_GL_CreateContext(gl_window);
+    }
+    SDL_GL_ResetAttributes();
+    if (!gl_context) {
+        rs2_error("SDL2: GL ES 2 context creation failed: %s\n", SDL_GetError());
+        if (gl_window) {
+            SDL_DestroyWindow(gl_window);
+            gl_window = NULL;
+        }
+        return false;
+    }
+    return true;
+}
+
+void *platform_gl_proc(const char *name) {
+    return SDL_GL_GetProcAddress(name);
+}
+
+void platform_gl_make_current(void) {
+    // an OpenGL renderer makes its own context current on the same thread
+    if (SDL_GL_GetCurrentContext() != gl_context) {
+        SDL_GL_MakeCurrent(gl_window, gl_context);
+    }
+}
+#endif
+
 void platform_free(void) {
 #ifdef __vita__
     SDL_JoystickClose(0);
@@ -282,6 +410,13 @@ void platform_free(void) {
         SDL_DestroyRenderer(renderer);
     }
     SDL_DestroyWindow(window);
+#ifdef PIX3D_GPU
+    if (gl_context) {
+        SDL_GL_DeleteContext(gl_context);
+        SDL_DestroyWindow(gl_window);
+    }
+#endif
+    midi_stop_producer();
     SDL_Quit();
     tsf_close(g_TinySoundFont);
     tml_free(TinyMidiLoader);
@@ -292,15 +427,30 @@ void platform_set_midi_volume(float midivol) {
         return;
     }
     if (SDL_GetAudioStatus() != SDL_AUDIO_STOPPED) {
-        tsf_set_volume(g_TinySoundFont, midivol);
+        midi_lock();
+        tsf_set_volume(g_TinySoundFont, midivol); // reaches what is already rendered ahead ~370 ms later
+        midi_unlock(false);
     }
 }
 
-void platform_set_jingle(int8_t *src, int len) {
-    platform_stop_midi();
+static void midi_reset(void) {
+    midi_lock();
+    midi_reset();
+    midi_unlock(true);
+}
+
+// replace the song while neither the producer nor the callback is reading it
+static void midi_play(int8_t *src, int len) {
+    midi_lock();
+    midi_reset();
     tml_free(TinyMidiLoader);
     TinyMidiLoader = tml_load_memory(src, len);
     g_MidiMessage = TinyMidiLoader;
+    midi_unlock(true);
+}
+
+void platform_set_jingle(int8_t *src, int len) {
+    midi_play(src, len);
     free(src);
 }
 
@@ -338,10 +488,7 @@ void platform_set_midi(const char *name, int crc, int len) {
     int8_t *uncompressed = malloc(uncompressed_length);
     bzip_decompress(uncompressed, data, (int)data_len - 4, 4);
 
-    platform_stop_midi();
-    tml_free(TinyMidiLoader);
-    TinyMidiLoader = tml_load_memory(uncompressed, uncompressed_length);
-    g_MidiMessage = TinyMidiLoader;
+    midi_play(uncompressed, uncompressed_length);
 
     packet_free(packet);
     free(uncompressed);
@@ -356,49 +503,91 @@ void platform_stop_midi(void) {
     if (_Client.lowmem) {
         return;
     }
-    if (SDL_GetAudioStatus() != SDL_AUDIO_STOPPED) {
-        g_MidiMessage = NULL;
-        g_Msec = 0;
-        tsf_reset(g_TinySoundFont);
-        // Initialize preset on special 10th MIDI channel to use percussion sound bank (128) if available
-        tsf_channel_set_bank_preset(g_TinySoundFont, 9, 128, 0);
+    midi_lock();
+    midi_reset();
+    midi_unlock(true);
+}
+
+// rectangles blitted since the last present, in window (or texture) coordinates
+#define PRESENT_RECTS 32
+static SDL_Rect present_rects[PRESENT_RECTS];
+static int present_count;
+static bool present_all = true; // the whole window: first frame, resized, exposed or too many rects
+
+static void present_mark(int x, int y, int w, int h) {
+    if (present_all || w <= 0 || h <= 0) {
+        return;
+    }
+    if (present_count == PRESENT_RECTS) {
+        present_all = true;
+        return;
+    }
+    present_rects[present_count++] = (SDL_Rect){x, y, w, h};
+}
+
+// copy part of a surface drawn at x, y into the streaming texture, clipped to it
+static void texture_upload(Surface *surface, int x, int y, int sx, int sy, int w, int h) {
+    int tw = 0, th = 0;
+    SDL_QueryTexture(texture, NULL, NULL, &tw, &th);
+    int dx = x + sx, dy = y + sy;
+    if (dx < 0) {
+        sx -= dx;
+        w += dx;
+        dx = 0;
+    }
+    if (dy < 0) {
+        sy -= dy;
+        h += dy;
+        dy = 0;
+    }
+    w = MIN(w, tw - dx);
+    h = MIN(h, th - dy);
+    if (w <= 0 || h <= 0) {
+        return;
+    }
+    SDL_Rect rect = {dx, dy, w, h};
+    const uint8_t *src = (const uint8_t *)surface->pixels + sy * surface->pitch + sx * sizeof(int);
+    if (SDL_UpdateTexture(texture, &rect, src, surface->pitch) < 0) {
+        rs2_error("SDL2: SDL_UpdateTexture failed: %s\n", SDL_GetError());
+        return;
     }
+    present_mark(dx, dy, w, h);
 }
 
 void platform_blit_surface(Surface *surface, int x, int y) {
+    platform_blit_surface_region(surface, x, y, 0, 0, surface->w, surface->h);
+}
+
+void platform_blit_surface_region(Surface *surface, int x, int y, int sx, int sy, int w, int h) {
     if (!_Custom.resizable) {
         int xoff = (window_surface->w - SCREEN_WIDTH) / 2;
-        SDL_Rect dest = {xoff + x, y, surface->w, surface->h};
-        // SDL_BlitScaled(surface, NULL, window_surface, &dest);
-        SDL_BlitSurface(surface, NULL, window_surface, &dest);
+        SDL_Rect src = {sx, sy, w, h};
+        SDL_Rect dest = {xoff + x + sx, y + sy, w, h};
+        // SDL_BlitScaled(surface, &src, window_surface, &dest);
+        SDL_BlitSurface(surface, &src, window_surface, &dest); // clips dest to the window
+        present_mark(dest.x, dest.y, dest.w, dest.h);
     } else {
-        // Lock the texture (texture) so that we may write directly to the pixels:
-        int *pix_write = NULL;
-        int _pitch_unused = 0;
-        if (SDL_LockTexture(texture, NULL, (void **)&pix_write, &_pitch_unused) < 0) {
-            rs2_error("SDL2: SDL_LockTexture failed: %s\n", SDL_GetError());
-            return;
-        }
-        int row_size = surface->w * sizeof(int);
-        int *src_pixels = (int *)surface->pixels;
-        for (int src_y = y; src_y < (y + surface->h); src_y++) {
-            // Calculate offset in texture to write a single row of pixels
-            int *row = &pix_write[(src_y * SCREEN_WIDTH) + x];
-            // Copy a single row of pixels
-            memcpy(row, &src_pixels[(src_y - y) * surface->w], row_size);
-        }
-        // Unlock the texture so that it may be used elsewhere
-        SDL_UnlockTexture(texture);
-        SDL_RenderCopy(renderer, texture, NULL, NULL);
+        // only the changed texels go to the GPU, the whole texture is drawn once on present
+        texture_upload(surface, x, y, sx, sy, w, h);
     }
 }
 
 void platform_update_surface(void) {
+    if (!present_all && present_count == 0) {
+        return; // nothing blitted: the window still shows this frame
+    }
     if (!_Custom.resizable) {
-        SDL_UpdateWindowSurface(window);
+        if (present_all) {
+            SDL_UpdateWindowSurface(window);
+        } else {
+            SDL_UpdateWindowSurfaceRects(window, present_rects, present_count);
+        }
     } else {
+        SDL_RenderCopy(renderer, texture, NULL, NULL);
         SDL_RenderPresent(renderer);
     }
+    present_count = 0;
+    present_all = false;
 }
 
 static void platform_get_keycodes(SDL_Keysym *keysym, int *code, char *ch) {
@@ -870,8 +1059,12 @@ void platform_poll_events(Client *c) {
                     SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0xff);
                     SDL_RenderClear(renderer);
                 }
+                present_all = true;
                 c->redraw_background = true;
                 break;
+            case SDL_WINDOWEVENT_EXPOSED:
+                present_all = true;
+                break;
             case SDL_WINDOWEVENT_ENTER:
                 if (_InputTracking.enabled) {
                     inputtracking_mouse_entered(&_InputTracking);
@@ -885,6 +1078,7 @@ void platform_poll_events(Client *c) {
             case SDL_WINDOWEVENT_FOCUS_GAINED:
                 c->shell->has_focus = true; // mapview applet
                 c->shell->refresh = true;
+                present_all = true;
 #ifdef client
                 c->redraw_background = true;
 #endif
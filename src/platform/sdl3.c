@@ -11,6 +11,7 @@
 #include "../gameshell.h"
 #include "../inputtracking.h"
 #include "../pixmap.h"
+#include "../sound/mix.h"
 
 #include "../thirdparty/bzip.h"
 #define TSF_IMPLEMENTATION
@@ -56,11 +57,7 @@ void platform_play_wave(int8_t *src, int length) {
         free(wave_buffer);
         return;
     }
-    if (g_wavevol != 128) {
-        for (uint32_t i = 0; i < wave_length; i++) {
-            wave_buffer[i] = (wave_buffer[i] - 128) * g_wavevol / 128 + 128;
-        }
-    }
+    mix_volume_u8(wave_buffer, wave_length, g_wavevol);
     const int wave_bytes_already_in_stream = SDL_GetAudioStreamAvailable(wave_stream);
     if (wave_bytes_already_in_stream == 0) {
         if (!SDL_PutAudioStreamData(wave_stream, wave_buffer, wave_length)) {
@@ -242,6 +239,43 @@ void platform_new(GameShell *shell) {
     }
 }
 
+#ifdef PIX3D_GPU
+static SDL_Window *gl_window;
+static SDL_GLContext gl_context;
+
+bool platform_gl_init(void) {
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_ES);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 2);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 0);
+    // the scene is drawn offscreen (pix3d_gpu.c), this window is never shown
+    gl_window = SDL_CreateWindow("", 1, 1, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+    if (gl_window) {
+        gl_context = SDL_GL_CreateContext(gl_window);
+    }
+    SDL_GL_ResetAttributes();
+    if (!gl_context) {
+        rs2_error("SDL3: GL ES 2 context creation failed: %s\n", SDL_GetError());
+        if (gl_window) {
+            SDL_DestroyWindow(gl_window);
+            gl_window = NULL;
+        }
+        return false;
+    }
+    return true;
+}
+
+void *platform_gl_proc(const char *name) {
+    return (void *)SDL_GL_GetProcAddress(name);
+}
+
+void platform_gl_make_current(void) {
+    // an OpenGL renderer makes its own context current on the same thread
+    if (SDL_GL_GetCurrentContext() != gl_context) {
+        SDL_GL_MakeCurrent(gl_window, gl_context);
+    }
+}
+#endif
+
 void platform_free(void) {
     if (!_Client.lowmem) {
         SDL_DestroyAudioStream(midi_stream);
@@ -253,6 +287,12 @@ void platform_free(void) {
     SDL_DestroyTexture(texture);
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
+#ifdef PIX3D_GPU
+    if (gl_context) {
+        SDL_GL_DestroyContext(gl_context);
+        SDL_DestroyWindow(gl_window);
+    }
+#endif
     SDL_Quit();
 }
 
@@ -322,40 +362,90 @@ void platform_stop_midi(void) {
     }
 }
 
+// rectangles blitted since the last present, in window (or texture) coordinates
+#define PRESENT_RECTS 32
+static SDL_Rect present_rects[PRESENT_RECTS];
+static int present_count;
+static bool present_all = true; // the whole window: first frame, resized, exposed or too many rects
+
+static void present_mark(const SDL_Rect *rect, int bounds_w, int bounds_h) {
+    if (present_all) {
+        return;
+    }
+    SDL_Rect bounds = {0, 0, bounds_w, bounds_h};
+    SDL_Rect clipped;
+    if (!SDL_GetRectIntersection(rect, &bounds, &clipped)) {
+        return;
+    }
+    if (present_count == PRESENT_RECTS) {
+        present_all = true;
+        return;
+    }
+    present_rects[present_count++] = clipped;
+}
+
+// copy part of a surface drawn at x, y into the streaming texture, clipped to it
+static void texture_upload(Surface *surface, int x, int y, int sx, int sy, int w, int h) {
+    float tw = 0, th = 0;
+    SDL_GetTextureSize(texture, &tw, &th);
+    int dx = x + sx, dy = y + sy;
+    if (dx < 0) {
+        sx -= dx;
+        w += dx;
+        dx = 0;
+    }
+    if (dy < 0) {
+        sy -= dy;
+        h += dy;
+        dy = 0;
+    }
+    w = MIN(w, (int)tw - dx);
+    h = MIN(h, (int)th - dy);
+    if (w <= 0 || h <= 0) {
+        return;
+    }
+    SDL_Rect rect = {dx, dy, w, h};
+    const uint8_t *src = (const uint8_t *)surface->pixels + sy * surface->pitch + sx * sizeof(int);
+    if (!SDL_UpdateTexture(texture, &rect, src, surface->pitch)) {
+        rs2_error("SDL3: SDL_UpdateTexture failed: %s\n", SDL_GetError());
+        return;
+    }
+    present_mark(&rect, (int)tw, (int)th);
+}
+
 void platform_blit_surface(Surface *surface, int x, int y) {
+    platform_blit_surface_region(surface, x, y, 0, 0, surface->w, surface->h);
+}
+
+void platform_blit_surface_region(Surface *surface, int x, int y, int sx, int sy, int w, int h) {
     if (!_Custom.resizable) {
         int xoff = (window_surface->w - SCREEN_WIDTH) / 2;
-        SDL_Rect dest = {xoff + x, y, surface->w, surface->h};
-        // SDL_BlitSurfaceScaled(surface, NULL, window_surface, &dest, SDL_SCALEMODE_LINEAR);
-        // SDL_BlitSurfaceScaled(surface, NULL, window_surface, &dest, SDL_SCALEMODE_NEAREST);
-        SDL_BlitSurface(surface, NULL, window_surface, &dest);
+        SDL_Rect src = {sx, sy, w, h};
+        SDL_Rect dest = {xoff + x + sx, y + sy, w, h};
+        // SDL_BlitSurfaceScaled(surface, &src, window_surface, &dest, SDL_SCALEMODE_LINEAR);
+        // SDL_BlitSurfaceScaled(surface, &src, window_surface, &dest, SDL_SCALEMODE_NEAREST);
+        SDL_BlitSurface(surface, &src, window_surface, &dest);
+        present_mark(&dest, window_surface->w, window_surface->h);
     } else {
-        int *pix_write = NULL;
-        int _pitch_unused = 0;
-        if (!SDL_LockTexture(texture, NULL, (void **)&pix_write, &_pitch_unused) || pix_write == NULL) {
-            rs2_error("SDL3: SDL_LockTexture failed: %s\n", SDL_GetError());
-            return;
-        }
-        int row_size = surface->w * sizeof(int);
-        int *src_pixels = (int *)surface->pixels;
-        for (int src_y = y; src_y < (y + surface->h); src_y++) {
-            // Compute the starting index for the destination row
-            int *dest_row = &pix_write[(src_y * SCREEN_WIDTH) + x];
-
-            // Copy a row of pixels
-            memcpy(dest_row, &src_pixels[(src_y - y) * surface->w], row_size);
-        }
-        SDL_UnlockTexture(texture);
-        SDL_RenderTexture(renderer, texture, NULL, NULL);
+        // only the changed texels go to the GPU, the whole texture is drawn once on present
+        texture_upload(surface, x, y, sx, sy, w, h);
     }
 }
 
 void platform_update_surface(void) {
+    if (!present_all && present_count == 0) {
+        return; // nothing blitted: the window still shows this frame
+    }
     if (_Custom.resizable) {
+        SDL_RenderTexture(renderer, texture, NULL, NULL);
         SDL_RenderPresent(renderer);
-    } else {
+    } else if (present_all) {
         SDL_UpdateWindowSurface(window);
+    } else {
+        SDL_UpdateWindowSurfaceRects(window, present_rects, present_count);
     }
+    present_count = 0;
+    present_all = false;
 }
 
 static void platform_get_keycodes(const SDL_KeyboardEvent *e, int *code, char *ch) {
@@ -695,8 +785,12 @@ void platform_poll_events(Client *c) {
                     return;
                 }
             }
+            present_all = true;
             c->redraw_background = true;
             break;
+        case SDL_EVENT_WINDOW_EXPOSED:
+            present_all = true;
+            break;
         case SDL_EVENT_WINDOW_MOUSE_ENTER:
             if (_InputTracking.enabled) {
                 inputtracking_mouse_entered(&_InputTracking);
@@ -710,6 +804,7 @@ void platform_poll_events(Client *c) {
         case SDL_EVENT_WINDOW_FOCUS_GAINED:
             c->shell->has_focus = true; // mapview applet
             c->shell->refresh = true;
+            present_all = true;
 #ifdef client
             c->redraw_background = true;
 #endif
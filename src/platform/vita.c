@@ -223,6 +223,15 @@ void platform_blit_surface(Surface *surface, int x, int y) {
     platform_set_pixels(base, surface, x, y, true);
     sceKernelUnlockMutex(mutex, 1);
 }
+
+// only SDL 2/3 blit regions (PIXMAP_DIRTY_TRACKING): blit the whole surface
+void platform_blit_surface_region(Surface *surface, int x, int y, int sx, int sy, int w, int h) {
+    (void)sx;
+    (void)sy;
+    (void)w;
+    (void)h;
+    platform_blit_surface(surface, x, y);
+}
 void platform_update_surface(void) {
 }
 uint64_t rs2_now(void) {
@@ -355,6 +355,15 @@ void platform_blit_surface(Surface *surface, int x, int y) {
     platform_set_pixels(canvas, surface, x, y, true);
     JS_setPixelsAlpha(canvas);
 }
+
+// only SDL 2/3 blit regions (PIXMAP_DIRTY_TRACKING): blit the whole surface
+void platform_blit_surface_region(Surface *surface, int x, int y, int sx, int sy, int w, int h) {
+    (void)sx;
+    (void)sy;
+    (void)w;
+    (void)h;
+    platform_blit_surface(surface, x, y);
+}
 void platform_update_surface(void) {
     rs2_sleep(0); // return a slice of time to the main loop so it can update the progress bar
 }
@@ -41,7 +41,25 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <math.h>
 #include "map.h"
+#include "world.h"
+#include "constants.h"
+#include "network.h"
+#include "netio.h"
+#include "log.h"
+#include "server.h"
+#include "metrics.h"
+#include "packet_profile.h"
+#include "replay.h"
+#include "account_registry.h"
+#include "presence.h"
+#include "social.h"
+#include "supervisor.h"
+#include "script.h"
+#include "hooks.h"
+#include "occupancy.h"
+#include "traffic.h"
 #ifdef _WIN32
 #include <winsock2.h>   /* Windows socket API */
 #else
@@ -57,9 +75,10 @@
  * 
  * @param player  Pointer to Player struct to initialize
  * @param index   Player slot index in server array [0, MAX_PLAYERS)
+ * @param conn    The slot's socket buffers and ciphers (not NULL), reset too
  * 
  * ALGORITHM:
- *   1. Zero entire struct: memset(player, 0, sizeof(Player))
+ *   1. Zero both structs: memset(player), memset(conn); link player->conn
  *   2. Set index: player->index = index
  *   3. Set socket_fd: player->socket_fd = -1 (no connection)
  *   4. Set state: player->state = PLAYER_STATE_DISCONNECTED
@@ -121,16 +140,32 @@
  *   
  *   void init_server() {
  *     for (u32 i = 0; i < MAX_PLAYERS; i++) {
- *       player_init(&players[i], i);
+ *       player_init(&players[i], i, NULL);  // Pooled at player_set_socket()
  *     }
  *     printf("Initialized %u player slots\n", MAX_PLAYERS);
  *   }
  * 
  * COMPLEXITY: O(1) time - memset is constant for fixed struct size
  */
-void player_init(Player* player, u32 index) {
+u32 g_connection_out_bytes = CONNECTION_OUT_BYTES_DEFAULT;
+u32 g_connection_slab = CONNECTION_SLAB_DEFAULT;
+SlabPool* g_connection_pool = NULL;
+
+/* What every slot without a socket points at (see CONNECTION POOL) */
+static PlayerConnection g_idle_connection;
+
+void player_init(Player* player, u32 index, PlayerConnection* conn) {
     memset(player, 0, sizeof(Player));
+    if (conn) {
+        memset(conn, 0, sizeof(PlayerConnection));
+        conn->in_opcode = -1;
+        buffer_init_external(&conn->out_stream, NULL, 0);
+    } else {
+        conn = &g_idle_connection;
+    }
+    player->conn = conn;
     player->index = index;
+    player->slot = index;
     player->socket_fd = -1;
     player->state = PLAYER_STATE_DISCONNECTED;
     position_init(&player->position, 3222, 3218, 0);
@@ -138,6 +173,15 @@ void player_init(Player* player, u32 index) {
     player->primary_direction = -1;
     player->secondary_direction = -1;
     player->placement_ticks = 0;
+    player->inventory = item_container_create(PLAYER_INVENTORY_SIZE);
+    player->equipment = item_container_create(PLAYER_EQUIPMENT_SIZE);
+}
+
+void player_free(Player* player) {
+    item_container_destroy(player->inventory);
+    item_container_destroy(player->equipment);
+    player->inventory = NULL;
+    player->equipment = NULL;
 }
 
 /*
@@ -211,7 +255,7 @@ void player_init(Player* player, u32 index) {
  *   1. Player logout:
  *        save_player(player);
  *        player_destroy(player);
- *        player_init(player, player->index);  // Reset for reuse
+ *        player_init(player, player->index, NULL);  // Reset for reuse
  *   
  *   2. Player timeout:
  *        log_disconnect(player, "Timeout");
@@ -228,7 +272,32 @@ void player_init(Player* player, u32 index) {
  */
 void player_destroy(Player* player) {
     movement_destroy(&player->movement);
+    /* The slot's next player starts empty (and is sent a full list at login) */
+    item_container_clear(player->inventory);
+    item_container_clear(player->equipment);
+    item_container_clear_dirty(player->inventory);
+    item_container_clear_dirty(player->equipment);
+    memset(&player->pending, 0, sizeof(PendingState));
+    /* The slot's next client has no scene yet: its first LOAD_AREA must go out */
+    player->area_digest = 0;
+    player->prefetch_zone = 0;
+    if (player->conn == &g_idle_connection) return;  /* Never had a socket */
+    player->conn->map_queue_count = 0;
+    timer_cancel(g_timers, player->conn->reaper);
+    player->conn->reaper = TIMER_NONE;
+    /* Last chance for queued output (e.g. logout packet) to reach the client */
     if (player->socket_fd >= 0) {
+        player_flush(player);
+    }
+    /* Free a heap spill (if any) and point the arena back at out_buffer */
+    buffer_release(&player->conn->out_stream);
+    buffer_init_external(&player->conn->out_stream, player->conn->out_buffer,
+                         player->conn->out_buffer_size);
+    if (g_netio && (player->socket_fd >= 0 || player->linger_until)) {
+        /* Network thread owns the descriptor: it drains the ring, then closes */
+        netio_close(g_netio, player->slot);
+        player->socket_fd = -1;
+    } else if (player->socket_fd >= 0) {
 #ifdef _WIN32
         closesocket(player->socket_fd);
 #else
@@ -236,6 +305,14 @@ void player_destroy(Player* player) {
 #endif
         player->socket_fd = -1;
     }
+    player->linger_until = 0;
+    
+    /* Back to the pool: the slot shares the idle connection until its next socket */
+    if (player->conn_pooled) {
+        slab_pool_free(g_connection_pool, player->conn);
+        player->conn = &g_idle_connection;
+        player->conn_pooled = false;
+    }
 }
 
 /*
@@ -298,20 +375,58 @@ void player_destroy(Player* player) {
 void player_disconnect(Player* player) {
     /* Save player data if they were logged in */
     if (player->state == PLAYER_STATE_LOGGED_IN && player->username[0] != '\0') {
-        printf("Saving player '%s' before disconnect...\n", player->username);
-        if (!player_save(player)) {
-            printf("WARNING: Failed to save player '%s'\n", player->username);
+        /* Other worlds wait until this save is written (account_registry.h) */
+        account_registry_release(g_account_registry, player->username, g_world_id);
+        presence_offline(player);
+        social_player_logout(g_social, player);
+        LOG_INFO("Saving player '%s' before disconnect...\n", player->username);
+        if (!player_save_logout(player)) {
+            LOG_WARN("Failed to save player '%s'\n", player->username);
         }
     }
     
+    player_drop(player);
+}
+
+/*
+ * player_drop - Second half of player_disconnect(): free the slot, no save
+ *
+ * @param player  Player to drop (any state)
+ *
+ * For callers that have already saved the player another way, such as
+ * server_shutdown() saving everyone in one batch (player_save_all()).
+ */
+void player_drop(Player* player) {
+    if (g_replay.recording && player->state != PLAYER_STATE_DISCONNECTED) {
+        replay_record_disconnect(player->slot);
+    }
+    if (player->state == PLAYER_STATE_LOGGED_IN) hook_logout(player);
+    
+    /*
+     * Release the PID and zone grid entry. Without this the slot stays
+     * in the world list after logout and the same Player struct gets a
+     * second PID when the connection slot is reused.
+     */
+    world_unregister_player(g_world, player);
+    
+    /* A script waiting on a timer or a dialogue must not resume into the slot */
+    script_cancel(g_scripts, player);
+    
     player->state = PLAYER_STATE_DISCONNECTED;
     player_destroy(player);
+    
+    /* Back on the server's free slot list (no-op if the slot was not taken) */
+    if (g_server && player >= g_server->players && player < g_server->players + MAX_PLAYERS) {
+        slotmap_release(g_server->free_slots, (u32)(player - g_server->players));
+    }
 }
 
 /*******************************************************************************
  * CONNECTION MANAGEMENT
  ******************************************************************************/
 
+static void player_reaper_arm(Player* player, u64 delay);
+
 /*
  * player_set_socket - Assign socket to player and mark connected
  * 
@@ -377,9 +492,146 @@ void player_disconnect(Player* player) {
  * 
  * COMPLEXITY: O(1) time
  */
-void player_set_socket(Player* player, i32 socket_fd) {
+bool player_set_socket(Player* player, i32 socket_fd) {
+    /* A connection from the pool, its inline output arena right behind it */
+    if (player->conn == &g_idle_connection) {
+        PlayerConnection* conn = g_connection_pool
+            ? (PlayerConnection*)slab_pool_alloc(g_connection_pool) : NULL;
+        if (!conn) return false;
+        conn->out_buffer = (u8*)(conn + 1);
+        conn->out_buffer_size = g_connection_out_bytes;
+        buffer_init_external(&conn->out_stream, conn->out_buffer, conn->out_buffer_size);
+        player->conn = conn;
+        player->conn_pooled = true;
+    }
+    
     player->socket_fd = socket_fd;
     player->state = PLAYER_STATE_CONNECTED;
+    player->login_ticket = 0;
+    player->login_reconnect = false;
+    player->login_resumed = false;
+    
+    /* Slots are reused: never let a previous session's input leak in */
+    player->conn->in_buffer_size = 0;
+    player->conn->in_read = 0;
+    player->conn->in_opcode = -1;
+    player->conn->in_tokens = PACKET_BURST;
+    player->conn->in_refill_tick = g_server ? g_server->tick_count : 0;
+    player->conn->in_paused = false;
+    memset(&player->conn->ws, 0, sizeof(WsConn));
+    player->conn->ws_framed = 0;
+    player->conn->out_congested = false;
+    player->conn->out_congested_ticks = 0;
+    
+    /* The reaper (PLAYER_HANDSHAKE_TICKS): the login must complete in time */
+    player->conn->connect_tick = g_timers ? g_timers->now : 0;
+    player->conn->last_input_tick = player->conn->connect_tick;
+    player_reaper_arm(player, PLAYER_HANDSHAKE_TICKS);
+    return true;
+}
+
+/*
+ * player_reaper_fired - g_timers callback: the connection's deadline check
+ *
+ * @param ctx   The Player
+ * @param slot  Its slot (unused, ctx is enough)
+ */
+static void player_reaper_fired(void* ctx, u32 slot) {
+    (void)slot;
+    Player* player = (Player*)ctx;
+    PlayerConnection* conn = player->conn;
+    conn->reaper = TIMER_NONE;
+    
+    u64 now = g_timers->now;
+    if (player->linger_until) {
+        /* Lingering session (session.h): its client did not come back */
+        if (now < player->linger_until) {
+            player_reaper_arm(player, player->linger_until - now);
+            return;
+        }
+        LOG_INFO("Session of '%s' expired, logging out\n", player->username);
+        player_disconnect(player);
+        return;
+    }
+    if (player->socket_fd < 0) return;
+    
+    u64 deadline;
+    const char* reason;
+    if (player->state == PLAYER_STATE_CONNECTED) {
+        deadline = conn->connect_tick + PLAYER_HANDSHAKE_TICKS;
+        reason = "login not completed";
+    } else if (player->state == PLAYER_STATE_LOGGING_IN) {
+        deadline = now + PLAYER_HANDSHAKE_TICKS;
+        reason = "";
+    } else {
+        deadline = conn->last_input_tick + PLAYER_IDLE_TICKS;
+        reason = "idle";
+    }
+    
+    if (now < deadline) {
+        player_reaper_arm(player, deadline - now);
+        return;
+    }
+    LOG_INFO("Connection in slot %u reaped (%s)\n", player->slot, reason);
+    metrics_add(&g_metrics.connections_reaped, 1);
+    player_disconnect(player);
+}
+
+void player_linger(Player* player, u64 ticks) {
+    /* Nothing queued or requested for the old client can reach it now */
+    buffer_release(&player->conn->out_stream);
+    buffer_init_external(&player->conn->out_stream, player->conn->out_buffer,
+                         player->conn->out_buffer_size);
+    player->conn->ws_framed = 0;
+    player->conn->map_queue_count = 0;
+    player->conn->in_buffer_size = 0;
+    player->conn->in_read = 0;
+    player->conn->in_opcode = -1;
+    
+    /* Under the network thread the slot stays reserved until player_destroy() */
+    if (!g_netio && player->socket_fd >= 0) {
+#ifdef _WIN32
+        closesocket(player->socket_fd);
+#else
+        close(player->socket_fd);
+#endif
+    }
+    player->socket_fd = -1;
+    
+    u64 now = g_timers ? g_timers->now : 0;
+    player->linger_until = now + (ticks > 0 ? ticks : 1);
+    player_reaper_arm(player, player->linger_until - now);
+}
+
+void player_take_session(Player* player, Player* session) {
+    Player fresh = *player;
+    *player = *session;
+    
+    /* The new connection stays: socket, buffers, ciphers, slot */
+    player->slot = fresh.slot;
+    player->conn = fresh.conn;
+    player->conn_pooled = fresh.conn_pooled;
+    player->socket_fd = fresh.socket_fd;
+    player->login_ticket = fresh.login_ticket;
+    player->login_reconnect = fresh.login_reconnect;
+    player->session_uid = fresh.session_uid;
+    player->login_resumed = true;
+    player->linger_until = 0;
+    
+    /* Containers belong to the slot: the old slot gets the new one's (empty) */
+    session->inventory = fresh.inventory;
+    session->equipment = fresh.equipment;
+    
+    /* Its session goes on in player: no logout hook when the slot is dropped */
+    session->state = PLAYER_STATE_CONNECTED;
+}
+
+/*
+ * player_reaper_arm - (Re)schedule the connection's reaper delay ticks ahead
+ */
+static void player_reaper_arm(Player* player, u64 delay) {
+    timer_cancel(g_timers, player->conn->reaper);
+    player->conn->reaper = timer_schedule(g_timers, delay, player_reaper_fired, player, player->slot);
 }
 
 /*******************************************************************************
@@ -482,6 +734,7 @@ void player_set_position(Player* player, u32 x, u32 z, u32 height) {
     u32 old_mapsquare_z = position_get_mapsquare_z(&player->position);
     
     position_init(&player->position, x, z, height);
+    player->save_dirty = true;
     
     u32 new_mapsquare_x = position_get_mapsquare_x(&player->position);
     u32 new_mapsquare_z = position_get_mapsquare_z(&player->position);
@@ -491,6 +744,14 @@ void player_set_position(Player* player, u32 x, u32 z, u32 height) {
     }
     
     player->needs_placement = true;
+    player_mark_changed(player);
+    player_occupancy_sync(player);
+}
+
+void player_occupancy_sync(Player* player) {
+    if (!player->occupying || position_equals(&player->occupied, &player->position)) return;
+    occupancy_move(g_occupancy, &player->occupied, &player->position, 1);
+    player->occupied = player->position;
 }
 
 /*******************************************************************************
@@ -625,27 +886,40 @@ void player_set_position(Player* player, u32 x, u32 z, u32 height) {
  * COMPLEXITY: O(n) time where n = movement.waypoint_count
  */
 void player_process_movement(Player* player) {
+    if (player_step_movement(player)) {
+        player_reload_area(player);
+    }
+}
+
+/*
+ * player_step_movement - The part of player_process_movement() that sends nothing
+ * 
+ * Touches only the player itself, so players may be stepped on several
+ * threads at once (region_shard.h).
+ */
+bool player_step_movement(Player* player) {
     player->primary_direction = -1;
     player->secondary_direction = -1;
     
     if (!movement_is_moving(&player->movement)) {
-        return;
+        return false;
     }
     
-    u32 old_x = player->position.x;
-    u32 old_z = player->position.z;
+    u32 old_x = position_x(&player->position);
+    u32 old_z = position_z(&player->position);
     
-    i32 walk_dir = movement_get_next_direction(&player->movement, player->position.x, player->position.z);
+    i32 walk_dir = movement_get_next_direction(&player->movement, position_x(&player->position), position_z(&player->position));
     
     if (walk_dir != -1) {
         position_move(&player->position, 
                      DIRECTION_DELTA_X[walk_dir],
                      DIRECTION_DELTA_Z[walk_dir]);
         player->primary_direction = walk_dir;
+        player->save_dirty = true;
     }
     
     if (player->movement.running && movement_is_moving(&player->movement)) {
-        i32 run_dir = movement_get_next_direction(&player->movement, player->position.x, player->position.z);
+        i32 run_dir = movement_get_next_direction(&player->movement, position_x(&player->position), position_z(&player->position));
         if (run_dir != -1) {
             position_move(&player->position,
                          DIRECTION_DELTA_X[run_dir],
@@ -659,28 +933,35 @@ void player_process_movement(Player* player) {
     /* We use 32 tiles as the threshold for consistency */
     i32 origin_zone_x = player->origin_x >> 3;
     i32 origin_zone_z = player->origin_z >> 3;
-    i32 current_zone_x = player->position.x >> 3;
-    i32 current_zone_z = player->position.z >> 3;
+    i32 current_zone_x = position_get_zone_x(&player->position);
+    i32 current_zone_z = position_get_zone_z(&player->position);
     
     i32 reload_left_x = (origin_zone_x - 4) << 3;   /* 32 tiles left */
     i32 reload_right_x = (origin_zone_x + 5) << 3;  /* 40 tiles right */
     i32 reload_bottom_z = (origin_zone_z - 4) << 3; /* 32 tiles down */
     i32 reload_top_z = (origin_zone_z + 5) << 3;    /* 40 tiles up */
     
-    if (player->position.x < reload_left_x || 
-        player->position.x >= reload_right_x ||
-        player->position.z < reload_bottom_z ||
-        player->position.z >= reload_top_z) {
+    if (position_x(&player->position) < reload_left_x || 
+        position_x(&player->position) >= reload_right_x ||
+        position_z(&player->position) < reload_bottom_z ||
+        position_z(&player->position) >= reload_top_z) {
         
         player->region_changed = true;
-        printf("DEBUG: Player moved outside reload bounds, rebuilding area\n");
-        printf("  Old origin: (%u, %u), New position: (%u, %u)\n",
-               player->origin_x, player->origin_z, player->position.x, player->position.z);
-        
-        u32 new_mapsquare_x = position_get_mapsquare_x(&player->position);
-        u32 new_mapsquare_z = position_get_mapsquare_z(&player->position);
-        map_send_load_area(player, new_mapsquare_x, new_mapsquare_z);
+        LOG_DEBUG("Player moved outside reload bounds, rebuilding area\n"
+                  "  Old origin: (%u, %u), New position: (%u, %u)\n",
+                  player->origin_x, player->origin_z, position_x(&player->position), position_z(&player->position));
+        return true;
     }
+    return false;
+}
+
+/*
+ * player_reload_area - Send the map area around the player's mapsquare
+ */
+void player_reload_area(Player* player) {
+    u32 new_mapsquare_x = position_get_mapsquare_x(&player->position);
+    u32 new_mapsquare_z = position_get_mapsquare_z(&player->position);
+    map_send_load_area(player, new_mapsquare_x, new_mapsquare_z);
 }
 
 /*******************************************************************************
@@ -730,3 +1011,194 @@ void player_process_movement(Player* player) {
 bool player_is_active(const Player* player) {
     return player->state == PLAYER_STATE_LOGGED_IN;
 }
+
+/*
+ * player_appearance_changed - Bump appearance version and flag for update
+ * 
+ * @param player  Pointer to Player
+ * 
+ * See player.h. Version 0 is reserved for "viewer has never received an
+ * appearance", so the counter wraps from 255 back to 1. A viewer that lost
+ * sight of the player may still hold a stamp from before the wrap, which
+ * the new count would match after exactly 255 changes; so on the wrap
+ * every viewer's stamp for this PID is cleared (world_forget_appearance).
+ * 
+ * COMPLEXITY: O(1) time, O(MAX_PLAYERS) on the wrap (1 in 255 changes)
+ */
+void player_appearance_changed(Player* player) {
+    if (!player) return;
+    if (player->appearance_version == 255) {
+        player->appearance_version = 1;
+        world_forget_appearance(g_world, (u16)player->index);
+    } else {
+        player->appearance_version++;
+    }
+    player->appearance_dirty = true;
+    player->update_flags |= UPDATE_APPEARANCE;
+    player_mark_changed(player);
+}
+
+void player_queue_hit(Player* player, u8 damage, u8 type) {
+    if (!player) return;
+    player->hit_damage = damage;
+    player->hit_type = type;
+    player->update_flags |= UPDATE_HIT;
+    player_mark_changed(player);
+}
+
+/*
+ * player_base_level - See player.h
+ * 
+ * Level L + 1 needs floor(sum(floor(l + 300 * 2^(l / 7)), l = 1..L) / 4)
+ * experience; experience[] is stored in tenths (protocol 225), so the
+ * table is too. Built on first use.
+ */
+u8 player_base_level(const Player* player, u32 skill) {
+    static u32 table[99];       /* table[l - 1]: tenths needed for level l */
+    if (table[1] == 0) {
+        double points = 0;
+        for (u32 level = 1; level < 99; level++) {
+            points += (u32)(level + 300.0 * pow(2.0, level / 7.0));
+            table[level] = (u32)(points / 4) * 10;
+        }
+    }
+    if (!player || skill >= 21) return 1;
+    
+    u32 experience = player->experience[skill];
+    u32 low = 0, high = 99;     /* table[low] <= experience < table[high] */
+    while (high - low > 1) {
+        u32 mid = (low + high) / 2;
+        if (table[mid] <= experience) low = mid; else high = mid;
+    }
+    return (u8)(low + 1);
+}
+
+void player_mark_changed(Player* player) {
+    if (g_world) player_list_mark_changed(g_world->player_list, player);
+}
+
+StreamBuffer* player_out(Player* player) {
+    if (!player) return NULL;
+    return &player->conn->out_stream;
+}
+
+bool player_out_commit(Player* player) {
+    if (!player) return false;
+
+    if (g_packet_profile.enabled) packet_profile_out_settle(&player->conn->out_stream);
+    if (player->conn->out_stream.position >= PLAYER_OUT_FLUSH_THRESHOLD) {
+        return player_flush(player);
+    }
+    return true;
+}
+
+u32 player_out_backlog(const Player* player) {
+    u32 queued = player->conn->out_stream.position;
+    if (g_netio) queued += netio_backlog(g_netio, player->slot);
+    return queued;
+}
+
+bool player_out_watermark(Player* player, u32 backlog) {
+    PlayerConnection* conn = player->conn;
+    if (backlog >= PLAYER_OUT_HIGH_WATER) {
+        conn->out_congested = true;
+    } else if (backlog < PLAYER_OUT_LOW_WATER) {
+        conn->out_congested = false;
+        conn->out_congested_ticks = 0;
+    }
+    if (!conn->out_congested) return true;
+    return ++conn->out_congested_ticks < PLAYER_OUT_SLOW_TICKS;
+}
+
+/*
+ * player_frame_output - Put everything queued since the last flush in one
+ * WebSocket frame (websocket.h)
+ *
+ * The header goes in front of the new bytes, behind any framed tail a
+ * partial write left over; only those new bytes move.
+ */
+static bool player_frame_output(Player* player) {
+    StreamBuffer* out = &player->conn->out_stream;
+    u32 framed = player->conn->ws_framed;
+    u32 length = out->position - framed;
+    if (length == 0) return true;
+    
+    u8 header[10];
+    u32 header_length = ws_frame_header(header, length);
+    if (!buffer_reserve(out, header_length)) return false;
+    memmove(out->data + framed + header_length, out->data + framed, length);
+    memcpy(out->data + framed, header, header_length);
+    out->position += header_length;
+    player->conn->ws_framed = out->position;
+    return true;
+}
+
+bool player_flush(Player* player) {
+    if (!player) return false;
+
+    StreamBuffer* out = &player->conn->out_stream;
+    if (player->linger_until) {
+        /* Lingering session (session.h): no client to send to */
+        buffer_reset(out);
+        return true;
+    }
+    u32 sent = 0;
+    if (g_packet_profile.enabled) packet_profile_out_settle(out);
+    
+    /* The login seed waits behind the WebSocket handshake reply */
+    if (player->conn->ws.state == WS_STATE_HANDSHAKE) return true;
+    if (player->conn->ws.state != WS_STATE_NONE && !g_replay.replaying &&
+        !player_frame_output(player)) {
+        buffer_reset(out);
+        player->conn->ws_framed = 0;
+        return false;
+    }
+
+    /* Replay (replay.h): what would have been sent goes into the digest */
+    if (g_replay.replaying) {
+        replay_digest_output(player->slot, out->data, out->position);
+        buffer_reset(out);
+        return true;
+    }
+
+    /* Keep writing until the queue is empty or the kernel buffer is full */
+    while (sent < out->position) {
+        i32 n;
+        if (g_netio) {
+            /* Copy into the network thread's outbound ring (never blocks) */
+            n = netio_send(g_netio, player->slot, out->data + sent, out->position - sent);
+            if (n == 0) break;  /* Ring full: keep the tail like EWOULDBLOCK */
+        } else {
+            n = network_send(player->socket_fd, out->data + sent, out->position - sent);
+            if (n > 0) metrics_add(&g_metrics.bytes_sent, (u64)n);
+        }
+        if (n > 0) {
+            sent += (u32)n;
+            continue;
+        }
+        if (n < 0 && !g_netio && network_would_block()) break;
+
+        /* Hard error or peer closed: queued output can never be delivered */
+        buffer_reset(out);
+        return false;
+    }
+
+    traffic_add(player->conn, TRAFFIC_BYTES_OUT, sent);
+
+    u32 remaining = out->position - sent;
+    if (remaining > 0 && sent > 0) {
+        /* Partial write: keep the unsent tail for the next flush */
+        memmove(out->data, out->data + sent, remaining);
+    }
+    buffer_reset(out);
+    out->position = remaining;
+    if (player->conn->ws.state != WS_STATE_NONE) player->conn->ws_framed = remaining;
+
+    if (remaining > PLAYER_OUT_BACKLOG_LIMIT) {
+        LOG_WARN("Player %u output backlog %u bytes exceeds limit, dropping\n",
+                 player->index, remaining);
+        buffer_reset(out);
+        return false;
+    }
+    return true;
+}
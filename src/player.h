@@ -135,6 +135,11 @@
 #include "position.h"
 #include "movement.h"
 #include "isaac.h"
+#include "buffer.h"
+#include "item.h"
+#include "websocket.h"
+#include "timer_wheel.h"
+#include "slab_pool.h"
 
 /*******************************************************************************
  * PLAYERSTATE - Connection Lifecycle State Machine
@@ -177,25 +182,230 @@
  * │                                                                   │
  * └───────────────────────────────────────────────────────────────────┘
  * 
- * TIMEOUT HANDLING:
+ * TIMEOUT HANDLING (the reaper, see PLAYER_HANDSHAKE_TICKS):
  *   State         Timeout     Action
- *   CONNECTED     10s         Disconnect (no login attempt)
- *   LOGGING_IN    5s          Disconnect (login taking too long)
- *   LOGGED_IN     60s         Disconnect (no activity/keepalive)
+ *   CONNECTED     10s         Disconnect (no login completed since connect)
+ *   LOGGING_IN    -           None: the server is loading the save
+ *   LOGGED_IN     60s         Disconnect (no packet, not even NO_TIMEOUT)
  * 
  * INVARIANTS:
  *   - state == DISCONNECTED  →  socket_fd == -1
- *   - state != DISCONNECTED  →  socket_fd >= 0
+ *   - state != DISCONNECTED  →  socket_fd >= 0, except a lingering
+ *                               session (linger_until != 0, session.h)
  *   - state == LOGGED_IN     →  username[0] != '\0'
  * 
  ******************************************************************************/
 typedef enum {
     PLAYER_STATE_DISCONNECTED,   /* No connection, slot available */
     PLAYER_STATE_CONNECTED,      /* TCP connected, awaiting login */
-    PLAYER_STATE_LOGGING_IN,     /* Processing credentials */
+    PLAYER_STATE_LOGGING_IN,     /* Header accepted, save being loaded */
     PLAYER_STATE_LOGGED_IN       /* In game world */
 } PlayerState;
 
+/*******************************************************************************
+ * UPDATE BLOCK CACHE - Per-Tick Encoded Mask Segments
+ *******************************************************************************
+ * 
+ * PROBLEM:
+ *   A player with a pending mask (e.g. UPDATE_APPEARANCE) is written into
+ *   the PLAYER_INFO packet of every viewer that can see them. Encoding the
+ *   block per (viewer, subject) pair repeats identical work:
+ * 
+ *     200 viewers × append_appearance() = 200 identical encodings
+ * 
+ * SOLUTION:
+ *   Each mask bit's payload is encoded ONCE per tick into this slab, then
+ *   memcpy'd into every viewer's block buffer.
+ * 
+ *   data[]:   [appearance segment][chat segment]...  (append-only per tick)
+ *   offset[b] / length[b]: where mask bit b's segment lives in data[]
+ *   valid:    bit b set once segment b has been encoded this tick
+ * 
+ * LIFETIME:
+ *   Invalidated (valid = 0, used = 0) in world_process() phase 3 together
+ *   with update_flags, so the next tick re-encodes from fresh state.
+ ******************************************************************************/
+#define UPDATE_BLOCK_CACHE_SIZE 512
+
+/* Largest encoded appearance body (2 + 12*2 + 5 + 7*2 + 8 + 1 = 54 bytes) */
+#define APPEARANCE_BLOB_SIZE 64
+
+/* Varp changes held per player until the end of the tick */
+#define PLAYER_PENDING_VARPS 32
+
+/* Slots of the inventory tab and the worn equipment */
+#define PLAYER_INVENTORY_SIZE 28
+#define PLAYER_EQUIPMENT_SIZE 14
+
+/*
+ * PLAYER_OUT_FLUSH_THRESHOLD - Pending bytes that force an early flush
+ * 
+ * Normally queued packets wait for the end-of-iteration flush. Large
+ * bursts (map region data, login) flush as soon as this much is queued
+ * so the arena stays near its inline size.
+ */
+#define PLAYER_OUT_FLUSH_THRESHOLD MAX_PACKET_SIZE
+
+/*
+ * PLAYER_OUT_BACKLOG_LIMIT - Unsent bytes tolerated before dropping a client
+ * 
+ * A client that stops reading fills its kernel send buffer, and the rest
+ * of its output backs up here. Beyond this limit the connection is
+ * treated as dead rather than growing the backlog without bound.
+ */
+#define PLAYER_OUT_BACKLOG_LIMIT (256 * 1024)
+
+/*
+ * PLAYER_OUT_HIGH_WATER / PLAYER_OUT_LOW_WATER - Congestion watermarks
+ * 
+ * A connection whose unsent output (player_out_backlog) reaches the high
+ * watermark is congested until it drains below the low one:
+ * 
+ *   backlog   0 ──── LOW ──────────── HIGH ──────────── LIMIT
+ *             normal  │ stays congested │ congested       │ dropped at once
+ *                     └ clears here     └ set here
+ * 
+ * While congested the connection gets only what the game needs: map
+ * chunks wait (map.c) and other players' public chat is left out of its
+ * PLAYER_INFO (update.c). The gap between the two marks keeps a client
+ * hovering around one threshold from flapping in and out every tick.
+ */
+#define PLAYER_OUT_HIGH_WATER (64 * 1024)
+#define PLAYER_OUT_LOW_WATER  (16 * 1024)
+
+/*
+ * PLAYER_OUT_SLOW_TICKS - Ticks a connection may stay congested
+ * 
+ * A client that has not drained below the low watermark in this long
+ * (30 seconds) is a slow consumer and is disconnected, well before its
+ * backlog could reach PLAYER_OUT_BACKLOG_LIMIT on its own.
+ */
+#define PLAYER_OUT_SLOW_TICKS 50
+
+/*
+ * PLAYER_HANDSHAKE_TICKS / PLAYER_IDLE_TICKS - The connection reaper
+ * 
+ * A socket that connects and never completes the login, or a logged-in
+ * client that stops sending (cable pulled, phone asleep, a half-open
+ * connection whose FIN never arrives), would hold its slot and both
+ * 5000-byte buffers until a recv() finally failed - which for a half-open
+ * connection is never.
+ * 
+ * Each connection has ONE timer on g_timers (PlayerConnection.reaper),
+ * not a check per tick:
+ * 
+ *   connect          arm(PLAYER_HANDSHAKE_TICKS)
+ *   every packet     last_input_tick = now        (a store, no timer work)
+ *   timer fires      deadline = connect_tick + HANDSHAKE    still CONNECTED
+ *                             | last_input_tick + IDLE      LOGGED_IN
+ *                    now >= deadline → disconnect
+ *                    otherwise       → arm(deadline - now)
+ * 
+ * Packets only move the deadline; the timer finds out when it fires and
+ * re-arms for the rest, so a chatty client costs one timer per idle
+ * period rather than a cancel and reschedule per packet. The real client
+ * sends NO_TIMEOUT about once a second, so 60 seconds of silence means
+ * the connection is gone. While LOGGING_IN the wait is ours (login
+ * workers, the admission budget), so the timer only re-arms.
+ */
+#define PLAYER_HANDSHAKE_TICKS 17   /* ~10 seconds */
+#define PLAYER_IDLE_TICKS 100       /* 60 seconds */
+
+/*
+ * PLAYER_MAP_QUEUE - Map files one connection may have streaming at once
+ * 
+ * A LOAD_AREA asks for at most 18 (9 land + 9 loc); the rest leaves room
+ * for a second area requested before the first has finished. See map.h.
+ */
+#define PLAYER_MAP_QUEUE 32
+
+/*
+ * MapTransfer - One requested map file, sent a few chunks per tick
+ */
+typedef struct {
+    u8 type;                                /* MapFileType */
+    u8 file_x;
+    u8 file_z;
+    u16 next_chunk;                         /* First chunk not yet queued */
+    u32 crc;                                /* Version being sent (0 = no such file) */
+} MapTransfer;
+
+/*
+ * TrafficCounter - What traffic.h counts per connection
+ */
+typedef enum {
+    TRAFFIC_BYTES_IN,                       /* Client packets handled, with headers */
+    TRAFFIC_BYTES_OUT,                      /* Handed to the socket or network thread */
+    TRAFFIC_PACKETS_IN,
+    TRAFFIC_MAP_BYTES,                      /* Map file chunks (also in BYTES_OUT) */
+    TRAFFIC_INFO_BYTES,                     /* PLAYER_INFO packets (also in BYTES_OUT) */
+    TRAFFIC_HANDLER_NS,                     /* Time in this connection's packet handlers */
+    TRAFFIC_COUNTERS
+} TrafficCounter;
+
+/*
+ * ConnTraffic - One connection's counters (traffic.h)
+ *
+ * Written where the traffic happens, folded by traffic_tick() at the end
+ * of every tick. The PLAYER_INFO workers add to their own viewer's tick[]
+ * only, and are joined before the fold.
+ */
+typedef struct {
+    u64 tick[TRAFFIC_COUNTERS];             /* Since the last fold */
+    u64 window[TRAFFIC_COUNTERS];           /* This report window */
+    u64 peak[TRAFFIC_COUNTERS];             /* Largest single tick of the window */
+    u32 opcodes[256];                       /* Client packets by opcode, this window */
+} ConnTraffic;
+
+/*
+ * PendingState - Client state changed this tick, sent at its end
+ * 
+ * Scripts may set a varp, a skill or the run energy several times in one
+ * tick; only the last value matters to the client. queue_varp(),
+ * queue_stat() and queue_run_energy() (server_packets.h) record the
+ * change here, and send_pending_state() sends each key once:
+ * 
+ *   queue_varp(p, 173, 1)  queue_varp(p, 173, 0)  queue_stat(p, 8) x3
+ *     → end of tick: VARP_SMALL(173, 0), UPDATE_STAT(8)
+ * 
+ * Varps are a short list (a tick touches a handful), deduplicated by id;
+ * stats are one bit per skill, read from levels[]/experience[] when sent.
+ */
+typedef struct {
+    u16 varp_ids[PLAYER_PENDING_VARPS];
+    i32 varp_values[PLAYER_PENDING_VARPS];
+    u32 varp_count;
+    u32 stats;                              /* Bit per skill */
+    bool run_energy_pending;
+    u8 run_energy;                          /* Percent */
+} PendingState;
+
+/* The 225 client's limits ("Max of 100 hit") */
+#define SOCIAL_FRIENDS_MAX 100
+#define SOCIAL_IGNORES_MAX 100
+
+/*
+ * SocialList - Friend and ignore lists (social.h)
+ *
+ * Held in the player, not by index: a save is loaded before the player
+ * has an index (world_register_player() assigns it).
+ */
+typedef struct {
+    u64 friends[SOCIAL_FRIENDS_MAX];    /* Sorted base-37 names */
+    u8 worlds[SOCIAL_FRIENDS_MAX];      /* World byte last sent per friend */
+    u64 ignores[SOCIAL_IGNORES_MAX];    /* Sorted base-37 names */
+    u8 friend_count;
+    u8 ignore_count;
+} SocialList;
+
+typedef struct {
+    u8 data[UPDATE_BLOCK_CACHE_SIZE];       /* Encoded mask segments, back to back */
+    u16 offset[8];                          /* Segment start per mask bit */
+    u16 length[8];                          /* Segment length per mask bit */
+    u16 used;                               /* Bytes of data[] in use */
+    u8 valid;                               /* Bit b set = segment b encoded */
+} UpdateBlockCache;
+
 /*******************************************************************************
  * PLAYER - Complete Player Entity State
  *******************************************************************************
@@ -229,7 +439,7 @@ typedef enum {
  *                   Filled by client movement packets
  *                   Processed by player_process_movement()
  * 
- * === ENCRYPTION ===
+ * === ENCRYPTION (PlayerConnection, via conn) ===
  *   in_cipher:      ISAAC cipher for decrypting incoming packets
  *                   Initialized during login with client seed
  * 
@@ -260,20 +470,42 @@ typedef enum {
  *   secondary_direction: Run direction [0-7] or -1 (not running)
  *                        Only set when running (2 tiles per tick)
  * 
- * === PACKET BUFFERS ===
+ * === PACKET BUFFERS (PlayerConnection, via conn) ===
  *   in_buffer:      Accumulator for partial packets from recv()
  *                   TCP is stream-based, packets may arrive fragmented
  *                   Example: Packet size = 100 bytes
  *                            recv() returns 60 bytes → store in buffer
  *                            next recv() returns 40 bytes → complete packet
  * 
- *   in_buffer_size: Number of bytes currently in in_buffer
+ *   in_buffer_size: Write index - bytes received into in_buffer so far
+ * 
+ *   in_read:        Read index - packets in [in_read, in_buffer_size)
+ *                   are still undispatched. Consuming a packet just
+ *                   advances in_read; the leftover partial packet is
+ *                   moved to the front only when recv() runs out of room.
  * 
- *   out_buffer:     Builder for outgoing packets
+ *   in_opcode:      Opcode of a partially received packet, already
+ *                   ISAAC-decoded (-1 if none). Each opcode consumes one
+ *                   cipher key, so it must not be decoded twice.
+ * 
+ *   out_buffer:     Builder for outgoing packets, the tail of the pooled
+ *                   connection (see CONNECTION POOL)
  *                   Multiple small packets batched into one send()
  *                   Example: 10 NPC update packets → one send() call
  * 
- *   out_buffer_size: Number of bytes currently in out_buffer
+ *   out_buffer_size: Size of out_buffer (g_connection_out_bytes)
+ * 
+ *   out_stream:     StreamBuffer view over out_buffer (the output arena)
+ *                   Senders append via player_out() and mark the packet
+ *                   done with player_out_commit(). Packets queue up and
+ *                   are written with ONE send() by player_flush() at the
+ *                   end of the server loop iteration (or as soon as
+ *                   PLAYER_OUT_FLUSH_THRESHOLD bytes are pending).
+ *                   Bytes the kernel did not accept stay queued for the
+ *                   next flush. The arena is reused for every packet, so
+ *                   steady-state sending does no malloc/free. Oversized
+ *                   queues spill to the heap once and keep that block
+ *                   until player_destroy().
  * 
  * === UPDATE FLAGS ===
  *   update_flags:   Bitmask of changes this tick (see constants.h)
@@ -281,32 +513,46 @@ typedef enum {
  *                   Bit 1: Animation playing
  *                   Bit 2: Chat message sent
  *                   Bit 3: Forced movement (knockback)
- *                   Cleared after player update packet sent
+ *                   Cleared after player update packet sent; setting a
+ *                   flag goes with player_mark_changed()
+ * 
+ *   update_cache:   Mask segments encoded once and shared by all viewers
+ *                   (see UPDATE BLOCK CACHE above); invalidated when the
+ *                   player is marked changed and with update_flags
+ * 
+ *   appearance:     Encoded appearance body, kept across ticks and only
+ *                   rebuilt when appearance_dirty is set
+ * 
+ *   appearance_version: Stamp bumped by player_appearance_changed().
+ *                   Viewers remember the last version they received in
+ *                   PlayerTracking.appearance_hashes[] and skip the block
+ *                   when re-adding a player whose look hasn't changed
  * 
  *   login_time:     Unix timestamp (milliseconds) of login
  *                   Used for session duration tracking
  *                   Example: 1700000000000 (2023-11-15)
  * 
- * MEMORY LAYOUT EXAMPLE (actual addresses vary):
- * ┌─────────────────────────────────────────────────┐
- * │ Address   Field              Value              │
- * ├─────────────────────────────────────────────────┤
- * │ 0x1000    index              42                 │
- * │ 0x1004    socket_fd          5                  │
- * │ 0x1008    state              LOGGED_IN          │
- * │ 0x100C    username           "player1\0"        │
- * │ 0x1019    password           [hash bytes...]    │
- * │ 0x1059    position.x         3222               │
- * │ 0x105D    position.z         3218               │
- * │ 0x1061    position.height    0                  │
- * │ 0x1065    movement           [waypoint queue]   │
- * │ 0x2000    in_cipher          [ISAAC state]      │
- * │ 0x3000    out_cipher         [ISAAC state]      │
- * │ 0x4000    in_buffer          [packet bytes]     │
- * │ 0x5388    out_buffer         [packet bytes]     │
- * │ 0x6710    update_flags       0x00000008         │
- * │ 0x6714    login_time         1700000000000      │
- * └─────────────────────────────────────────────────┘
+ * HOT / COLD LAYOUT:
+ *   The tick phases (movement, visibility, PLAYER_INFO) touch a handful
+ *   of fields of every player. Those come first, so a pass over all
+ *   players reads the first cache lines of each Player and nothing else.
+ *   The 10KB of socket buffers and the ISAAC state live in a separate
+ *   PlayerConnection (taken from the connection pool while a socket is
+ *   open) that only the packet I/O code follows conn to reach.
+ * 
+ *   Player                              PlayerConnection
+ *   ┌───────────────────────────┐       ┌──────────────────────────┐
+ *   │ index, state, position    │ hot   │ in_cipher, out_cipher    │
+ *   │ directions, update_flags  │       │ in_buffer[5000]          │
+ *   │ placement, appearance_ver │       │ out_stream, in_read ...  │
+ *   │ conn ─────────────────────┼──────→│ out_buffer[out_bytes]    │
+ *   ├───────────────────────────┤       └──────────────────────────┘
+ *   │ movement, update_cache,   │ warm
+ *   │ appearance[]              │
+ *   ├───────────────────────────┤
+ *   │ socket_fd, username,      │ cold
+ *   │ skills, saved appearance  │
+ *   └───────────────────────────┘
  * 
  * TYPICAL VALUES AT RUNTIME:
  *   Active player:
@@ -315,53 +561,130 @@ typedef enum {
  *     username = "zezima"
  *     position = {3222, 3218, 0}  (Lumbridge)
  *     in_buffer_size = 0 (just processed)
- *     out_buffer_size = 120 (pending send)
+ *     out_stream.position = 120 (pending send)
  *     update_flags = 0x0001 (appearance updated)
  * 
  *   Disconnected slot:
  *     state = DISCONNECTED
  *     socket_fd = -1
  *     username = "" (empty)
- *     in_buffer_size = 0
- *     out_buffer_size = 0
+ *     conn = the shared idle connection (nothing pooled)
  *     update_flags = 0
  * 
  ******************************************************************************/
 typedef struct {
-    u32 index;                              /* Player array index [0, MAX_PLAYERS) */
-    i32 socket_fd;                          /* TCP socket (-1 if disconnected) */
-    PlayerState state;                      /* Connection lifecycle state */
+    ISAACCipher in_cipher;                  /* Decrypt incoming packets */
+    ISAACCipher out_cipher;                 /* Encrypt outgoing packets */
     
-    char username[MAX_USERNAME_LENGTH + 1]; /* Login name (null-terminated) */
-    char password[64];                      /* Hashed password */
+    u8 in_buffer[MAX_PACKET_SIZE];          /* Incoming packet accumulator */
+    u32 in_buffer_size;                     /* Bytes in in_buffer (write index) */
+    u32 in_read;                            /* First unconsumed byte (read index) */
+    i32 in_opcode;                          /* Decoded opcode of a partial packet, or -1 */
+    u32 in_tokens;                          /* Packet rate bucket (MAX_PACKETS_PER_SECOND) */
+    u64 in_refill_tick;                     /* Tick in_tokens was last topped up */
+    bool in_paused;                         /* Buffer full: unwatched until the tick drains it */
+    u64 in_tick;                            /* Tick in_tick_packets counts (packet_profile.h) */
+    u32 in_tick_packets;                    /* Packets handled in that tick */
     
-    Position position;                      /* World coordinates */
-    MovementHandler movement;               /* Waypoint queue */
+    u8* out_buffer;                         /* Outgoing packet builder (inline arena) */
+    u32 out_buffer_size;                    /* Its size */
+    StreamBuffer out_stream;                /* Reusable output arena (see player_out) */
+    bool out_want_write;                    /* Watching socket for writability (backlog) */
+    bool out_congested;                     /* Over PLAYER_OUT_HIGH_WATER, not yet drained */
+    u32 out_congested_ticks;                /* Ticks it has been congested */
     
-    u32 origin_x;                           /* Last LOAD_AREA origin X coordinate */
-    u32 origin_z;                           /* Last LOAD_AREA origin Z coordinate */
+    u64 connect_tick;                       /* Tick the socket was accepted */
+    u64 last_input_tick;                    /* Tick the last packet was handled */
+    TimerHandle reaper;                     /* Handshake / idle deadline (g_timers) */
     
-    ISAACCipher in_cipher;                  /* Decrypt incoming packets */
-    ISAACCipher out_cipher;                 /* Encrypt outgoing packets */
+    MapTransfer map_queue[PLAYER_MAP_QUEUE]; /* Requested map files, oldest first (map.h) */
+    u32 map_queue_count;
     
+    WsConn ws;                              /* WebSocket layer (state NONE for plain TCP) */
+    u32 ws_framed;                          /* Leading out_stream bytes already in frames */
+
+    ConnTraffic traffic;                    /* Bandwidth and handler time (traffic.h) */
+} PlayerConnection;
+
+/*
+ * CONNECTION POOL
+ * 
+ * A slot only holds a PlayerConnection while it has a socket:
+ * 
+ *   player_set_socket()   conn = slab_pool_alloc(g_connection_pool)
+ *   player_destroy()      slab_pool_free(...); conn = idle connection
+ * 
+ * A free slot's conn points at one shared, all-zero idle connection, so
+ * checks like conn->out_stream.position or conn->map_queue_count still
+ * read 0 without a NULL test. Nothing may write to it.
+ * 
+ * Each pooled object is a PlayerConnection followed by its inline output
+ * arena of g_connection_out_bytes. Slabs of g_connection_slab objects
+ * are added as the population grows (slab_pool.h), so a world with 20
+ * players holds 2 slabs, not 2048 connections.
+ */
+#define CONNECTION_OUT_BYTES_DEFAULT MAX_PACKET_SIZE
+#define CONNECTION_OUT_BYTES_MIN 512
+#define CONNECTION_SLAB_DEFAULT 16
+
+/* Inline output arena per connection, bytes (--out-arena BYTES) */
+extern u32 g_connection_out_bytes;
+
+/* Connections per slab (--conn-slab N) */
+extern u32 g_connection_slab;
+
+/* The server's pool (server_init), NULL without a server */
+extern SlabPool* g_connection_pool;
+
+typedef struct {
+    /* === HOT: read or written by every tick phase === */
+    u32 index;                              /* Player array index [0, MAX_PLAYERS) */
+    PlayerState state;                      /* Connection lifecycle state */
+    Position position;                      /* World coordinates */
+    i32 primary_direction;                  /* Walk direction this tick [-1, 7] */
+    i32 secondary_direction;                /* Run direction this tick [-1, 7] */
+    u32 update_flags;                       /* Dirty bits for synchronization */
     bool needs_placement;                   /* Requires full position update */
     bool teleporting;                       /* Teleport in progress */
     bool region_changed;                    /* Crossed region boundary */
     u8 placement_ticks;                     /* Placement delay counter */
+    u8 appearance_version;                  /* Bumped on each change [1, 255], 0 = never */
+    bool appearance_dirty;                  /* appearance[] must be re-encoded */
+    u8 appearance_length;                   /* Bytes used in appearance[] */
+    bool save_dirty;                        /* Persistent data changed since last save */
+    u32 origin_x;                           /* Last LOAD_AREA origin X coordinate */
+    u32 origin_z;                           /* Last LOAD_AREA origin Z coordinate */
+    u32 area_digest;                        /* Hash of the last LOAD_AREA (0 = none this session) */
+    u32 prefetch_zone;                      /* Predicted next origin zone already prefetched */
+    Position occupied;                      /* Tile marked in g_occupancy (occupancy.h) */
+    bool occupying;                         /* occupied is marked (in the world) */
+    PlayerConnection* conn;                 /* Socket buffers and ciphers (cold) */
+    bool conn_pooled;                       /* conn came from g_connection_pool */
     
-    i32 primary_direction;                  /* Walk direction this tick [-1, 7] */
-    i32 secondary_direction;                /* Run direction this tick [-1, 7] */
-    
-    u8 in_buffer[MAX_PACKET_SIZE];          /* Incoming packet accumulator */
-    u32 in_buffer_size;                     /* Bytes in in_buffer */
-    
-    u8 out_buffer[MAX_PACKET_SIZE];         /* Outgoing packet builder */
-    u32 out_buffer_size;                    /* Bytes in out_buffer */
+    MovementHandler movement;               /* Waypoint queue */
+    UpdateBlockCache update_cache;          /* This tick's encoded mask segments */
+    u8 hit_damage;                          /* UPDATE_HIT: this tick's hitsplat */
+    u8 hit_type;
+    u8 appearance[APPEARANCE_BLOB_SIZE];    /* Pre-encoded appearance body */
     
-    u32 update_flags;                       /* Dirty bits for synchronization */
+    /* === CONNECTION / IDENTITY === */
+    u32 slot;                               /* Fixed slot in server->players[] (netio connection) */
+    i32 socket_fd;                          /* TCP socket (-1 if disconnected) */
+    u32 login_ticket;                       /* Loader request while LOGGING_IN (load_queue.h) */
+    bool login_reconnect;                   /* Login type 18: the client's automatic reconnect */
+    bool login_resumed;                     /* This login took over a lingering session */
+    bool ghost;                             /* Read-only copy of a player on another node (cluster.h) */
+    u32 session_uid;                        /* Client uid from the login block (session.h) */
+    u64 linger_until;                       /* Tick a lost connection's session ends, 0 = connected */
     u64 login_time;                         /* Login timestamp (milliseconds) */
     
-    /* === PERSISTENT DATA (saved to disk) === */
+    char username[MAX_USERNAME_LENGTH + 1]; /* Login name (null-terminated) */
+    char password[64];                      /* Hashed password */
+    u8 rights;                              /* PLAYER_RIGHTS_* for this session (command.h) */
+    
+    /* === PERSISTENT DATA (saved to disk) ===
+     * Anything that changes these (or position) must set save_dirty so
+     * the autosave picks the player up (see server_autosave). */
     i8 body[7];                             /* Appearance: body parts (-1 = hidden) */
     u8 colors[5];                           /* Appearance: color indices */
     u8 gender;                              /* Gender: 0=male, 1=female */
@@ -372,6 +695,10 @@ typedef struct {
     u8 levels[21];                          /* Current skill levels (can be boosted) */
     
     u16 runenergy;                          /* Run energy (0-10000, 10000=100%) */
+    ItemContainer* inventory;               /* PLAYER_INVENTORY_SIZE slots (not saved yet) */
+    ItemContainer* equipment;               /* PLAYER_EQUIPMENT_SIZE slots (not saved yet) */
+    PendingState pending;                   /* Varps / stats / energy to send this tick */
+    SocialList social;                      /* Friends and ignores (social.h) */
     u32 playtime;                           /* Total ticks logged in */
     u64 last_login;                         /* Last login timestamp (milliseconds) */
 } Player;
@@ -385,9 +712,10 @@ typedef struct {
  * 
  * @param player  Pointer to Player struct to initialize
  * @param index   Player slot index in server array [0, MAX_PLAYERS)
+ * @param conn    The slot's socket buffers and ciphers (not NULL), reset too
  * 
  * ALGORITHM:
- *   1. Zero entire struct: memset(player, 0, sizeof(Player))
+ *   1. Zero both structs: memset(player), memset(conn); link player->conn
  *   2. Set index: player->index = index
  *   3. Set socket_fd: player->socket_fd = -1 (disconnected)
  *   4. Set state: player->state = PLAYER_STATE_DISCONNECTED
@@ -417,15 +745,27 @@ typedef struct {
  *   │ login_time         = 0                 │
  *   └────────────────────────────────────────┘
  * 
+ * @param conn    Connection the slot keeps for good (tools and benches),
+ *                or NULL: the slot shares the idle connection until
+ *                player_set_socket() takes one from g_connection_pool
+ * 
  * USAGE:
  *   Player players[MAX_PLAYERS];
  *   for (u32 i = 0; i < MAX_PLAYERS; i++) {
- *     player_init(&players[i], i);
+ *     player_init(&players[i], i, NULL);
  *   }
  * 
+ * Also allocates the slot's inventory and equipment containers, which
+ * stay with the slot (emptied on disconnect) until player_free().
+ * 
  * COMPLEXITY: O(1) time
  */
-void player_init(Player* player, u32 index);
+void player_init(Player* player, u32 index, PlayerConnection* conn);
+
+/*
+ * player_free - Free what player_init() allocated (server shutdown)
+ */
+void player_free(Player* player);
 
 /*
  * player_destroy - Clean up player resources
@@ -440,6 +780,7 @@ void player_init(Player* player, u32 index);
  * 
  * RESOURCE CLEANUP:
  *   - Frees all heap-allocated waypoints in movement queue
+ *   - Empties the inventory and equipment for the slot's next player
  *   - Closes TCP socket (sends FIN packet to client)
  *   - Does NOT zero struct (use player_init to reuse slot)
  * 
@@ -465,7 +806,7 @@ void player_init(Player* player, u32 index);
  *   void handle_logout(Player* player) {
  *     save_player_data(player);  // Persist to database
  *     player_destroy(player);    // Close socket, free memory
- *     player_init(player, player->index);  // Reset for reuse
+ *     player_init(player, player->index, player->conn);  // Reset for reuse
  *   }
  * 
  * COMPLEXITY: O(n) time where n = movement.waypoint_count
@@ -506,6 +847,41 @@ void player_destroy(Player* player);
  */
 void player_disconnect(Player* player);
 
+/*
+ * player_drop - Disconnect without saving
+ * 
+ * @param player  Pointer to Player to drop
+ * 
+ * Everything player_disconnect() does after the save: unregister from the
+ * world, DISCONNECTED, player_destroy(), slot back on the free list. The
+ * caller has already released the account and written the save, as
+ * server_shutdown() does for all players at once.
+ */
+void player_drop(Player* player);
+
+/*
+ * player_linger - Close the socket but keep the player in the world
+ * 
+ * @param player  LOGGED_IN player whose connection was lost
+ * @param ticks   Grace period; the reaper disconnects the player after it
+ * 
+ * Queued output is dropped and later output is thrown away at each flush.
+ * Under the network thread the slot's connection stays reserved (not
+ * netio_close()d) until player_destroy(). See session.h.
+ */
+void player_linger(Player* player, u64 ticks);
+
+/*
+ * player_take_session - Move a lingering session's game state into a slot
+ * 
+ * @param player   New connection (keeps its socket, conn, slot, ciphers)
+ * @param session  Lingering player: left CONNECTED with player's former
+ *                 containers, ready for player_drop() (no logout hook)
+ * 
+ * The caller repoints the PID (world_resume_player).
+ */
+void player_take_session(Player* player, Player* session);
+
 /*
  * player_set_socket - Assign socket to player and mark connected
  * 
@@ -529,11 +905,15 @@ void player_disconnect(Player* player);
  *   - socket_fd >= 0 (valid file descriptor)
  *   - player->state == DISCONNECTED (slot available)
  * 
- * POSTCONDITIONS:
+ * POSTCONDITIONS (on true):
  *   - player->socket_fd == socket_fd
  *   - player->state == CONNECTED
+ *   - player->conn is a zeroed connection from g_connection_pool
  *   - Player ready to receive login packet
  * 
+ * @return  false if no connection could be taken from the pool (the
+ *          slot is left as it was; the caller closes the socket)
+ * 
  * EXAMPLE - ACCEPT LOOP:
  *   while (running) {
  *     int fd = accept(server_socket, NULL, NULL);
@@ -550,7 +930,7 @@ void player_disconnect(Player* player);
  * 
  * COMPLEXITY: O(1) time
  */
-void player_set_socket(Player* player, i32 socket_fd);
+bool player_set_socket(Player* player, i32 socket_fd);
 
 /*
  * player_set_position - Update player position and check region change
@@ -615,6 +995,16 @@ void player_set_socket(Player* player, i32 socket_fd);
  */
 void player_set_position(Player* player, u32 x, u32 z, u32 height);
 
+/*
+ * player_occupancy_sync - Move the player's g_occupancy mark to their tile
+ *
+ * @param player  Player (no-op unless occupying, see world.c)
+ *
+ * Game thread only: player_step_movement() may run on a shard, so the
+ * steps are applied here when the tick's movement is merged.
+ */
+void player_occupancy_sync(Player* player);
+
 /*
  * player_process_movement - Process queued waypoints and update position
  * 
@@ -704,6 +1094,24 @@ void player_set_position(Player* player, u32 x, u32 z, u32 height);
  */
 void player_process_movement(Player* player);
 
+/*
+ * player_step_movement - Advance the player without sending anything
+ * 
+ * @param player  Player to move
+ * @return        true if the player left the reload bounds; the caller
+ *                must then call player_reload_area()
+ * 
+ * player_process_movement() is this followed by the reload. Split so the
+ * steps can run on shard threads and the sends stay on the game thread
+ * (see region_shard.h).
+ */
+bool player_step_movement(Player* player);
+
+/*
+ * player_reload_area - Send the map area around the player's current mapsquare
+ */
+void player_reload_area(Player* player);
+
 /*
  * player_is_active - Check if player is logged in
  * 
@@ -731,4 +1139,160 @@ void player_process_movement(Player* player);
  */
 bool player_is_active(const Player* player);
 
+/*
+ * player_appearance_changed - Mark player's look as changed
+ * 
+ * @param player  Pointer to Player
+ * 
+ * Call after modifying gender, body, colors or (later) worn equipment.
+ * 
+ * EFFECTS:
+ *   - appearance_version++ (wraps 255 → 1, 0 means "never encoded")
+ *   - appearance_dirty = true (blob re-encoded on next use)
+ *   - update_flags |= UPDATE_APPEARANCE (current viewers get the block)
+ * 
+ * Viewers that later re-add this player compare their stored version with
+ * appearance_version; a mismatch makes update.c send the block again.
+ * On the wrap every viewer's stored version is cleared, so a stamp cached
+ * 255 changes ago cannot match by accident.
+ * 
+ * COMPLEXITY: O(1) time
+ */
+void player_appearance_changed(Player* player);
+
+/*
+ * player_queue_hit - Show a hitsplat over the player this tick
+ * 
+ * @param player  Player that was hit (hitpoints already lowered)
+ * @param damage  Number on the splat
+ * @param type    Splat colour (COMBAT_HIT_* in combat.h)
+ * 
+ * Sets UPDATE_HIT; update.c sends damage, type and the current and base
+ * hitpoints to every viewer, the player included, as one cached segment.
+ * 
+ * COMPLEXITY: O(1) time
+ */
+void player_queue_hit(Player* player, u8 damage, u8 type);
+
+/*
+ * player_base_level - A skill's level from its experience (1-99)
+ * 
+ * @param player  Player
+ * @param skill   Skill index (SKILL_* in player_save.h)
+ * 
+ * levels[] holds the current, possibly drained or boosted, level; this
+ * is the one the experience has earned (e.g. full hitpoints).
+ * 
+ * COMPLEXITY: O(log 99) (binary search of the experience table)
+ */
+u8 player_base_level(const Player* player, u32 skill);
+
+/*
+ * player_mark_changed - Add player to the world's changed set this tick
+ * 
+ * Call with any change viewers must see besides a phase 1 step: new
+ * update_flags, needs_placement. Unmarked players are sent as one 0 bit
+ * and skipped by the end-of-tick cleanup (player_list_end_tick).
+ * 
+ * COMPLEXITY: O(1) time
+ */
+void player_mark_changed(Player* player);
+
+/*
+ * player_out - Get the player's output arena for appending a packet
+ * 
+ * @param player  Player to send to
+ * @return        Arena buffer positioned after any pending bytes
+ * 
+ * USAGE:
+ *   StreamBuffer* out = player_out(player);
+ *   buffer_write_header(out, SERVER_..., enc);
+ *   ...payload...
+ *   player_out_commit(player);
+ * 
+ * Replaces the buffer_create()/network_send()/buffer_destroy() triple:
+ * the arena lives inside the Player struct, so building a packet costs
+ * no allocation. Never destroy the returned buffer.
+ * 
+ * COMPLEXITY: O(1) time
+ */
+StreamBuffer* player_out(Player* player);
+
+/*
+ * player_out_commit - Finish a packet and queue it for sending
+ * 
+ * @param player  Player whose arena holds the finished packet
+ * @return        false only if an early flush found the connection broken
+ * 
+ * The packet stays in the arena until the next player_flush(). If the
+ * queue has reached PLAYER_OUT_FLUSH_THRESHOLD, it is flushed right away.
+ * 
+ * COMPLEXITY: O(1) time, O(n) when an early flush triggers
+ */
+bool player_out_commit(Player* player);
+
+/*
+ * player_out_backlog - Output bytes queued for this connection but not sent
+ * 
+ * @param player  Player to check
+ * @return        Bytes in the arena, plus those waiting in the network
+ *                thread's outbound ring when g_netio is set
+ * 
+ * What the client has yet to receive from us, short of the kernel's own
+ * send buffer: map.c fills only the room below MAP_TRANSFER_WINDOW.
+ * 
+ * COMPLEXITY: O(1) time
+ */
+u32 player_out_backlog(const Player* player);
+
+/*
+ * player_out_watermark - Once per tick: update the congestion state
+ * 
+ * @param player  Connected player
+ * @param backlog player_out_backlog() after the last flush
+ * @return        false if the connection has been congested for
+ *                PLAYER_OUT_SLOW_TICKS (caller should disconnect)
+ * 
+ * Sets out_congested at PLAYER_OUT_HIGH_WATER and clears it (and the
+ * tick count) below PLAYER_OUT_LOW_WATER; see the watermarks above.
+ * 
+ * COMPLEXITY: O(1) time
+ */
+bool player_out_watermark(Player* player, u32 backlog);
+
+/*
+ * player_out_congested - true while non-critical output should be held back
+ */
+static inline bool player_out_congested(const Player* player) {
+    return player->conn->out_congested;
+}
+
+/*
+ * player_flush - Write all queued output to the socket in one call
+ * 
+ * @param player  Player whose queue to flush
+ * @return        true if the connection is healthy (everything sent, or
+ *                the remainder is queued because the socket would block);
+ *                false if the socket failed or the backlog exceeded
+ *                PLAYER_OUT_BACKLOG_LIMIT (caller should disconnect)
+ * 
+ * PARTIAL WRITES:
+ *   A non-blocking send() may accept only part of the queue. The unsent
+ *   tail is moved to the front of the arena and retried on the next
+ *   flush, so no byte is ever silently dropped:
+ * 
+ *     queue: [pkt1][pkt2][pkt3]      send() accepts 2.5 packets
+ *     queue: [½pkt3]                 kept for next flush
+ * 
+ *   Flushes only happen between packets, so the tail is always a whole
+ *   number of packets plus at most one partially written one.
+ * 
+ * NETWORK THREAD (g_netio set):
+ *   Bytes are copied into the connection's outbound ring instead of
+ *   send(); a full ring behaves like EWOULDBLOCK.
+ * 
+ * COMPLEXITY: O(n) time where n = queued bytes
+ */
+bool player_flush(Player* player);
+
 #endif /* PLAYER_H */
@@ -13,10 +13,12 @@
  *   ┌─────────────────────────────────────────────────┐
  *   │ capacity: 2048   (MAX_PLAYERS)                  │
  *   │ count: 3         (currently online)             │
- *   │ next_pid: 4      (next allocation hint)         │
+ *   │ pids             (free PIDs, FIFO slot map)     │
  *   ├─────────────────────────────────────────────────┤
  *   │ players[2048]    Array of Player pointers       │
  *   │ occupied[2048]   Bitmap of occupied slots       │
+ *   │ active[2048]     Dense list, first count used   │
+ *   │ active_slot[2048] PID → position in active[]    │
  *   └─────────────────────────────────────────────────┘
  *           │
  *           v
@@ -28,6 +30,15 @@
  *   │  0  │  1  │  0   │  1   │  1   │  0   │...│  0   │ occupied[]
  *   └─────┴─────┴──────┴──────┴──────┴──────┴───┴──────┘
  *
+ *   Alongside it, a dense list of the same players for iteration:
+ *
+ *   active[]:       [ P1 | P2 | P3 ]        count = 3
+ *   active_slot[]:  PID 1 → 0, PID 3 → 1, PID 4 → 2
+ *
+ *   Add appends; remove moves the last entry into the hole and fixes
+ *   its active_slot. Both stay O(1), and a tick phase touches count
+ *   entries instead of scanning all 2048 PIDs.
+ *
  * WHY SPARSE ARRAY?
  *   Alternative 1: Dense array (shift on remove)
  *     ✗ Remove: O(n) - must shift all following elements
@@ -41,7 +52,7 @@
  *   
  *   Sparse array (chosen):
  *     ✓ Lookup by PID: O(1) - direct array access
- *     ✓ Add: O(1) average - next_pid hint minimizes search
+ *     ✓ Add: O(1) - free PID popped from a free list
  *     ✓ Remove: O(1) - just set slot to NULL
  *     ✓ Cache friendly - sequential memory
  *     ✗ Memory: Fixed 2048 slots regardless of player count
@@ -50,24 +61,24 @@
  *   PIDs are unique identifiers for players in the range [1, 2047].
  *   PID 0 is reserved as invalid/null marker.
  *
- *   ROUND-ROBIN ALLOCATION:
- *     1. Start search at next_pid (hint from last allocation)
- *     2. Scan forward for first unoccupied slot
- *     3. Wrap around to 1 if reaching capacity
- *     4. Update next_pid to (allocated_pid + 1)
- *     5. Return 0 if no free slots (server full)
- *
- *   EXAMPLE: Allocating PIDs with wraparound
- *     Initial: next_pid = 1, all slots empty
- *     Allocate: PID 1 → next_pid = 2
- *     Allocate: PID 2 → next_pid = 3
- *     Remove:   PID 1 freed (next_pid stays at 3)
- *     Allocate: PID 3 → next_pid = 4
- *     ...
- *     Allocate: PID 2047 → next_pid = 1 (wraparound)
- *     Allocate: PID 1 (reused freed slot) → next_pid = 2
- *
- *   This ensures even PID distribution and quick reuse of freed slots.
+ *   FREE-LIST ALLOCATION (datastruct/slotmap.h):
+ *     Free PIDs are kept in a FIFO list threaded through the slot map.
+ *     Add pops the head, remove pushes the PID on the tail, so both are
+ *     O(1) however full the server is. The old round-robin search walked
+ *     occupied[] from a next_pid hint, which near capacity meant scanning
+ *     most of the 2047 PIDs on every login.
+ *
+ *   EXAMPLE: Allocation order
+ *     Initial:  free = 1, 2, 3, ..., 2047
+ *     Allocate: PID 1        free = 2, 3, ..., 2047
+ *     Allocate: PID 2        free = 3, ..., 2047
+ *     Remove:   PID 1        free = 3, ..., 2047, 1
+ *     Allocate: PID 3        free = 4, ..., 2047, 1
+ *
+ *   FIFO keeps the round-robin property that mattered: a PID that was
+ *   just freed is the LAST to be handed out again, so a client still
+ *   holding the old player at that index has the longest time to drop
+ *   it before a new player appears there.
  *
  * PLAYER VISIBILITY SYSTEM:
  *   Determines which players a given player can see for multiplayer updates.
@@ -103,28 +114,28 @@
  *   Updated every game tick (600ms) before sending player update packets.
  *
  *   PlayerTracking structure:
- *     - local_players[2048]: Array of visible player PIDs
+ *     - local_players[255]: Visible player PIDs, in the client's order
  *     - local_count: Number of visible players
- *     - tracked[2048]: Bitmap for O(1) "is tracked" checks
+ *     - tracked: PlayerSet (256-byte bitset) of the same PIDs
  *
- *   ALGORITHM:
- *     1. Clear tracking arrays
- *     2. Iterate through all active players
- *     3. For each player, check visibility rules
- *     4. Add visible players to local_players array
- *     5. Mark as tracked in bitmap
+ *   ALGORITHM (per tick, see update_other_players):
+ *     1. visible = player_find_visible() (zone grid + player_can_see)
+ *     2. Walk local_players: drop those not in visible
+ *     3. adds = visible \ tracked, walked with ctz; append up to 255
  *
  * PERFORMANCE CHARACTERISTICS:
  *   - player_list_create(): O(1) - malloc + calloc
  *   - player_list_destroy(): O(1) - free
- *   - player_list_add(): O(1) average, O(n) worst case (full scan for PID)
- *   - player_list_remove(): O(1) - direct array access
+ *   - player_list_add(): O(1) - free list pop
+ *   - player_list_remove(): O(1) - direct array access + free list push
  *   - player_list_get(): O(1) - direct array access
  *   - player_can_see(): O(1) - distance calculation
- *   - player_update_local_players(): O(n) where n = capacity (scans all slots)
+ *   - player_find_visible(): O(c) where c = players in nearby zones
+ *   - player_set_difference(), player_set_count(): 32 word operations
  *
  * MEMORY USAGE:
- *   PlayerList: 8 bytes (capacity, count) + 8 bytes (next_pid, padding)
+ *   PlayerList: 8 bytes (capacity, count) + 8 bytes (pids pointer)
+ *   pids:       2048 × 6 bytes = 12,288 bytes (free links + generations)
  *   players[]:  2048 × 8 bytes = 16,384 bytes (64-bit pointers)
  *   occupied[]: 2048 × 1 byte = 2,048 bytes
  *   Total: ~18.4 KB per PlayerList
@@ -147,6 +158,8 @@
  ******************************************************************************/
 
 #include "player_list.h"
+#include "update.h"
+#include "log.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -163,8 +176,7 @@
  *     capacity:   4 bytes (u32)
  *     count:      4 bytes (u32)
  *     occupied:   8 bytes (pointer)
- *     next_pid:   4 bytes (u32)
- *     padding:    4 bytes (struct alignment to 32 bytes)
+ *     pids:       8 bytes (pointer)
  *     Total:     32 bytes
  *   
  *   Allocated arrays:
@@ -184,7 +196,7 @@
  *   Cache miss analysis:
  *     - Lookup by PID: ~0 misses (direct index, likely cached)
  *     - Iteration: ~32 misses per 2048 slots (1 miss per 64 bytes)
- *     - PID allocation: ~32 misses worst case (scanning occupied[])
+ *     - PID allocation: ~1 miss (free list head)
  *
  * ALTERNATIVE DESIGN CONSIDERATIONS:
  *   
@@ -247,8 +259,7 @@
  *   player_list_add        | ~150         | ~6.6M
  *   player_list_remove     | ~100         | ~10M
  *   player_list_get        | ~5           | ~200M
- *   player_list_get_next_pid (empty) | ~150 | ~6.6M
- *   player_list_get_next_pid (90% full) | ~800 | ~1.25M
+ *   player_list_get_next_pid | ~5       | ~200M (any fill level)
  *   player_can_see         | ~10          | ~100M
  *   player_update_local_players | ~15,000 | ~66,000
  *
@@ -311,8 +322,20 @@
  * HISTORICAL NOTE:
  *   Early RS2 versions used 16 tiles, but this caused players to appear/
  *   disappear when crossing region boundaries. Reduced to 15 for stability.
+ *
+ * Defined in player_list.h so the zone grid queries in update.c use the
+ * same radius as player_is_within_distance().
+ */
+
+/*
+ * g_local_player_budget - Local list size at which a viewer's radius shrinks
+ *
+ * The protocol caps the list at 255, but a list that full also means a
+ * ~25KB PLAYER_INFO per viewer per tick. A smaller budget (set with
+ * --local-player-budget) bounds both the packet and the encoding work in
+ * crowds; the nearest players are kept (see player_find_visible_adaptive).
  */
-#define MAX_VIEW_DISTANCE 15
+u32 g_local_player_budget = MAX_LOCAL_PLAYERS;
 
 /*******************************************************************************
  * PUBLIC API IMPLEMENTATION
@@ -328,7 +351,7 @@
  *   - players[capacity]: Array of Player pointers (all NULL initially)
  *   - occupied[capacity]: Bitmap of occupied slots (all false initially)
  *   - count: 0 (no players online)
- *   - next_pid: 1 (start allocating from PID 1)
+ *   - pids: every PID from 1 free (PID 0 reserved)
  *
  * MEMORY ALLOCATION:
  *   - PlayerList struct: ~24 bytes
@@ -354,9 +377,18 @@ PlayerList* player_list_create(u32 capacity) {
     
     list->players = calloc(capacity, sizeof(Player*));
     list->occupied = calloc(capacity, sizeof(bool));
-    if (!list->players || !list->occupied) {
+    list->active = calloc(capacity, sizeof(Player*));
+    list->active_slot = calloc(capacity, sizeof(u16));
+    list->changed_pids = calloc(capacity, sizeof(u16));
+    list->pids = slotmap_new(capacity, 1); /* PID 0 is reserved for NULL/invalid */
+    if (!list->players || !list->occupied || !list->active || !list->active_slot ||
+        !list->changed_pids || !list->pids) {
         free(list->players);
         free(list->occupied);
+        free(list->active);
+        free(list->active_slot);
+        free(list->changed_pids);
+        slotmap_free(list->pids);
         free(list);
         return NULL;
     }
@@ -364,14 +396,18 @@ PlayerList* player_list_create(u32 capacity) {
     /* Initialize list metadata */
     list->capacity = capacity;
     list->count = 0;
-    list->next_pid = 1; /* PIDs start at 1, 0 is reserved for NULL/invalid */
+    memset(&list->changed, 0, sizeof(PlayerSet));
+    list->changed_count = 0;
     
     /*
      * Memory layout after creation (capacity = 2048):
      *   PlayerList struct:   24 bytes
      *   players[2048]:       16,384 bytes (pointers initialized to NULL by calloc)
      *   occupied[2048]:      2,048 bytes (all false by calloc)
-     *   Total:              ~18,456 bytes
+     *   active[2048]:        16,384 bytes (dense, first count entries used)
+     *   active_slot[2048]:   4,096 bytes
+     *   changed_pids[2048]:  4,096 bytes (plus the 256-byte changed set)
+     *   Total:              ~43,288 bytes
      */
     
     return list;
@@ -384,7 +420,9 @@ PlayerList* player_list_create(u32 capacity) {
  *
  * Frees:
  *   - players[] array
- *   - occupied[] array  
+ *   - occupied[] array
+ *   - active[] and active_slot[] arrays
+ *   - pids slot map
  *   - PlayerList struct itself
  *
  * IMPORTANT: Does NOT free individual Player objects. Caller must
@@ -403,6 +441,10 @@ void player_list_destroy(PlayerList* list) {
      */
     free(list->players);
     free(list->occupied);
+    free(list->active);
+    free(list->active_slot);
+    free(list->changed_pids);
+    slotmap_free(list->pids);
     free(list);
     
     /*
@@ -424,11 +466,12 @@ void player_list_destroy(PlayerList* list) {
  *
  * ALGORITHM:
  *   1. Validate parameters (non-NULL, list not full)
- *   2. Allocate next available PID using round-robin search
+ *   2. Pop the next free PID from the pids free list
  *   3. Store player pointer at players[PID]
  *   4. Mark slot as occupied in bitmap
- *   5. Increment player count
- *   6. Set player->index = PID
+ *   5. Append to the dense active[] list
+ *   6. Increment player count
+ *   7. Set player->index = PID
  *
  * PID ASSIGNMENT:
  *   The allocated PID is stored in player->index. This is the player's
@@ -441,7 +484,7 @@ void player_list_destroy(PlayerList* list) {
  *   - list->count >= capacity (server full) → false
  *   - No available PIDs → false (prints error)
  *
- * COMPLEXITY: O(1) average, O(n) worst case (full scan for free PID)
+ * COMPLEXITY: O(1)
  */
 bool player_list_add(PlayerList* list, Player* player) {
     /* Validation: check for NULL pointers and capacity limits */
@@ -450,13 +493,13 @@ bool player_list_add(PlayerList* list, Player* player) {
     }
     
     /*
-     * Allocate next available PID using round-robin search.
-     * This call scans the occupied[] bitmap starting at next_pid.
+     * Take the PID that has been free the longest (see FREE-LIST
+     * ALLOCATION above). No scan: the free list is popped in O(1).
      */
-    u16 pid = player_list_get_next_pid(list);
-    if (pid == 0) {
+    u32 pid = slotmap_alloc(list->pids);
+    if (pid == SLOTMAP_NONE) {
         /* Server is full - all 2047 slots occupied */
-        printf("ERROR: No available PIDs (server full with %u players)\n", list->count);
+        LOG_ERROR("No available PIDs (server full with %u players)\n", list->count);
         return false;
     }
     
@@ -470,10 +513,12 @@ bool player_list_add(PlayerList* list, Player* player) {
     player->index = pid;
     list->players[pid] = player;
     list->occupied[pid] = true;
+    list->active_slot[pid] = (u16)list->count;
+    list->active[list->count] = player;
     list->count++;
     
-    printf("Added player %s with PID %u (total: %u)\n", 
-           player->username, pid, list->count);
+    LOG_INFO("Added player %s with PID %u (total: %u)\n", 
+             player->username, pid, list->count);
     return true;
 }
 
@@ -486,9 +531,11 @@ bool player_list_add(PlayerList* list, Player* player) {
  * Removes the player at the given PID slot:
  *   - Sets players[pid] = NULL
  *   - Sets occupied[pid] = false
+ *   - Moves the last active[] entry into the player's position
  *   - Decrements count
  *
- * The PID becomes available for reuse by player_list_add().
+ * The PID goes on the tail of the free list, to be reused by
+ * player_list_add() once every longer-free PID has been handed out.
  *
  * SAFE REMOVAL:
  *   - Validates PID range (1 ≤ pid < capacity)
@@ -497,7 +544,7 @@ bool player_list_add(PlayerList* list, Player* player) {
  *
  * NOTE: Does NOT free the Player object itself. Caller responsible.
  *
- * COMPLEXITY: O(1) - direct array access
+ * COMPLEXITY: O(1) - direct array access + free list push
  */
 void player_list_remove(PlayerList* list, u16 pid) {
     /*
@@ -514,8 +561,8 @@ void player_list_remove(PlayerList* list, u16 pid) {
     /* Log removal for debugging (access username before clearing pointer) */
     Player* player = list->players[pid];
     if (player) {
-        printf("Removed player %s with PID %u (remaining: %u)\n", 
-               player->username, pid, list->count - 1);
+        LOG_INFO("Removed player %s with PID %u (remaining: %u)\n", 
+                 player->username, pid, list->count - 1);
     }
     
     /*
@@ -524,11 +571,65 @@ void player_list_remove(PlayerList* list, u16 pid) {
      *   2. Mark slot as unoccupied in bitmap
      *   3. Decrement active player count
      * 
-     * PID becomes available for reuse immediately.
+     * The PID joins the tail of the free list.
+     * 
+     * The dense list stays packed: the last entry moves into the hole.
      */
+    u16 slot = list->active_slot[pid];
+    Player* last = list->active[list->count - 1];
+    list->active[slot] = last;
+    list->active_slot[last->index] = slot;
+    list->active[list->count - 1] = NULL;
+    
     list->players[pid] = NULL;
     list->occupied[pid] = false;
     list->count--;
+    slotmap_release(list->pids, pid);
+}
+
+/*
+ * player_list_replace - Point a listed PID at another Player
+ *
+ * @param list    PlayerList containing the PID
+ * @param pid     Listed PID
+ * @param player  Player now holding that PID (player->index == pid)
+ *
+ * The PID stays taken and keeps its place in the dense list; only the
+ * pointer changes (session.h moves a session into a new slot this way).
+ *
+ * COMPLEXITY: O(1)
+ */
+void player_list_replace(PlayerList* list, u16 pid, Player* player) {
+    if (!list || !player || pid == 0 || pid >= list->capacity || !list->occupied[pid]) {
+        return;
+    }
+    list->players[pid] = player;
+    list->active[list->active_slot[pid]] = player;
+}
+
+/*
+ * player_list_attach - Give a player a PID without entering active[]
+ *
+ * See player_list.h. Same free list as player_list_add().
+ */
+bool player_list_attach(PlayerList* list, Player* player) {
+    if (!list || !player) return false;
+    u32 pid = slotmap_alloc(list->pids);
+    if (pid == SLOTMAP_NONE) return false;
+    player->index = pid;
+    list->players[pid] = player;
+    list->occupied[pid] = true;
+    return true;
+}
+
+/*
+ * player_list_detach - Free an attached player's PID
+ */
+void player_list_detach(PlayerList* list, u16 pid) {
+    if (!list || pid == 0 || pid >= list->capacity || !list->occupied[pid]) return;
+    list->players[pid] = NULL;
+    list->occupied[pid] = false;
+    slotmap_release(list->pids, pid);
 }
 
 /*
@@ -570,78 +671,84 @@ Player* player_list_get(PlayerList* list, u16 pid) {
 }
 
 /*
- * player_list_get_next_pid - Find next available PID for allocation
+ * player_list_get_next_pid - PID the next player_list_add() will assign
  *
- * @param list  PlayerList to search
+ * @param list  PlayerList to query
  * @return      Next free PID (1-2047), or 0 if none available
  *
- * ROUND-ROBIN ALLOCATION ALGORITHM:
- *   1. Start at list->next_pid (hint from last allocation)
- *   2. Scan forward through array
- *   3. Return first unoccupied slot found
- *   4. Wrap around to PID 1 if reaching capacity
- *   5. Stop if we circle back to start (no free slots)
- *   6. Update next_pid to (found_pid + 1) for next call
- *
- * WHY ROUND-ROBIN?
- *   - Even distribution of PIDs over time
- *   - Quick reuse of recently freed slots
- *   - Avoids clustering at low PIDs
- *   - Better for debugging (PIDs increment predictably)
+ * Peeks at the head of the pids free list without taking it: the PID
+ * that has been free the longest. player_list_add() pops the same PID.
  *
  * EXAMPLE TRACE:
- *   Initial: next_pid=1, all empty
- *   Call 1: Finds PID 1, sets next_pid=2, returns 1
- *   Call 2: Finds PID 2, sets next_pid=3, returns 2
- *   [PID 1 logs out, slot freed]
- *   Call 3: Finds PID 3, sets next_pid=4, returns 3
- *   ...
- *   Call 2047: Finds PID 2047, sets next_pid=1 (wrap), returns 2047
- *   Call 2048: Finds PID 1 (reused), sets next_pid=2, returns 1
- *
- * COMPLEXITY: O(1) average if slots available, O(n) worst case (full scan)
+ *   Initial: free = 1, 2, 3, ...     returns 1
+ *   [PIDs 1 and 2 added]             returns 3
+ *   [PID 1 logs out: free = 3, ..., 2047, 1]
+ *                                    returns 3 (PID 1 waits its turn)
+ *
+ * COMPLEXITY: O(1)
  */
 u16 player_list_get_next_pid(PlayerList* list) {
-    /* Quick validation: list must exist and have free slots */
-    if (!list || list->count >= list->capacity) {
-        return 0;  /* No list or server full */
-    }
-    
-    /*
-     * Round-robin search algorithm:
-     * Start at next_pid (hint from last allocation) and scan forward.
-     * Wrap around to PID 1 if we reach capacity.
-     * Stop when we circle back to start position.
-     */
-    u32 start = list->next_pid;  /* Remember where we started */
-    u32 pid = start;              /* Current position in scan */
-    
-    do {
-        /* Check if current PID is free */
-        if (pid < list->capacity && !list->occupied[pid]) {
-            /*
-             * Found a free slot! Update next_pid hint for next allocation.
-             * Use modulo to wrap around, then skip PID 0 if we land on it.
-             */
-            list->next_pid = (pid + 1) % list->capacity;
-            if (list->next_pid == 0) {
-                list->next_pid = 1;  /* PID 0 is reserved, skip to 1 */
+    if (!list) return 0;
+
+    u32 pid = slotmap_peek(list->pids);
+    return pid == SLOTMAP_NONE ? 0 : (u16)pid;  /* 0: server full */
+}
+
+/*
+ * player_list_mark_changed - Add a player to this tick's changed set
+ *
+ * See player_list.h. Players not (yet) in the list are ignored: login
+ * sets flags before world_register_player(), which marks them itself.
+ *
+ * COMPLEXITY: O(1)
+ */
+void player_list_mark_changed(PlayerList* list, Player* player) {
+    if (!list || !player) return;
+    u32 pid = player->index;
+    if (pid == 0 || pid >= list->capacity || list->players[pid] != player) return;
+    if (player_set_has(&list->changed, pid)) return;
+
+    player_set_add(&list->changed, pid);
+    list->changed_pids[list->changed_count++] = (u16)pid;
+    update_invalidate_block_cache(player);
+}
+
+/*
+ * player_list_end_tick - Reset the changed players for the next tick
+ *
+ * PLACEMENT LIFECYCLE:
+ *   - Tick 0: needs_placement = true, placement_ticks = 0
+ *   - Tick 1: needs_placement = true, placement_ticks = 1
+ *   - Tick 2: needs_placement = false (cleared, player leaves the set)
+ *
+ * A PID whose player logged out this tick (slot empty or reused by a
+ * player who is marked again anyway) is just dropped.
+ *
+ * COMPLEXITY: O(changed players)
+ */
+void player_list_end_tick(PlayerList* list) {
+    u32 kept = 0;
+    for (u32 i = 0; i < list->changed_count; i++) {
+        u16 pid = list->changed_pids[i];
+        Player* player = list->players[pid];
+        if (player) {
+            if (player->needs_placement) {
+                player->placement_ticks++;
+                if (player->placement_ticks >= 2) {
+                    player->needs_placement = false;
+                }
+            }
+            /* Each change is sent exactly once */
+            player->update_flags = 0;
+            update_invalidate_block_cache(player);
+            if (player->needs_placement) {
+                list->changed_pids[kept++] = pid;
+                continue;
             }
-            return (u16)pid;  /* Return the allocated PID */
-        }
-        
-        /* Slot occupied, try next PID */
-        pid++;
-        if (pid >= list->capacity) {
-            pid = 1;  /* Wrap around to PID 1 (skip 0) */
         }
-    } while (pid != start);  /* Continue until we've checked all slots */
-    
-    /*
-     * If we reach here, we've scanned all PIDs and found no free slots.
-     * This should only happen if count == capacity (server full).
-     */
-    return 0;  /* No free PIDs - should be rare due to early check */
+        player_set_remove(&list->changed, pid);
+    }
+    list->changed_count = kept;
 }
 
 /*
@@ -736,17 +843,15 @@ bool player_is_within_distance(const Player* p1, const Player* p2) {
      * Height levels: 0 = ground floor, 1-3 = upper floors
      * This prevents "seeing through ceiling" in multi-story buildings.
      */
-    if (p1->position.height != p2->position.height) {
+    if (!position_same_height(&p1->position, &p2->position)) {
         return false;  /* Different floors = not visible */
     }
     
     /*
-     * MANHATTAN DISTANCE CHECK:
-     * Calculate absolute difference in X and Z coordinates.
-     * Cast to signed int to handle wraparound (e.g., 3 - 5 = -2 → abs → 2).
+     * DISTANCE CHECK:
+     * position_distance() is the larger of the absolute X and Z differences.
      */
-    i32 dx = abs((i32)p1->position.x - (i32)p2->position.x);
-    i32 dz = abs((i32)p1->position.z - (i32)p2->position.z);
+    u32 distance = position_distance(&p1->position, &p2->position);
     
     /*
      * Visibility range: 15 tiles in both X and Z directions.
@@ -762,101 +867,213 @@ bool player_is_within_distance(const Player* p1, const Player* p2) {
      * 
      * Total visible area: ~961 tiles (31×31 grid)
      */
-    return dx <= MAX_VIEW_DISTANCE && dz <= MAX_VIEW_DISTANCE;
+    return distance <= MAX_VIEW_DISTANCE;
+}
+
+/*
+ * player_set_difference - Members of a that are not in b
+ *
+ * @param out  Receives a & ~b (may be a)
+ * @param a    Set to take from
+ * @param b    Set to remove
+ *
+ * Used between ticks: visible \ tracked are the players to add,
+ * tracked \ visible the ones to remove.
+ *
+ * COMPLEXITY: O(PLAYER_SET_WORDS) = 32 word operations
+ */
+void player_set_difference(PlayerSet* out, const PlayerSet* a, const PlayerSet* b) {
+    for (u32 i = 0; i < PLAYER_SET_WORDS; i++) {
+        out->bits[i] = a->bits[i] & ~b->bits[i];
+    }
+}
+
+/*
+ * player_set_count - Number of members
+ *
+ * COMPLEXITY: O(PLAYER_SET_WORDS), one popcount per word
+ */
+u32 player_set_count(const PlayerSet* set) {
+    u32 count = 0;
+    for (u32 i = 0; i < PLAYER_SET_WORDS; i++) {
+        count += (u32)__builtin_popcountll(set->bits[i]);
+    }
+    return count;
+}
+
+/*
+ * player_view_candidates - Zone grid candidates and their packed positions
+ *
+ * Queries the zones around the viewer and gathers each candidate's
+ * position for position_view_mask(). Candidates player_can_see() would
+ * refuse for a reason other than distance (the viewer, hidden players,
+ * stale grid slots) are packed with POSITION_VIEW_HIDDEN. coords needs
+ * room for POSITION_VIEW_ROUND(MAX_PLAYERS).
+ */
+static u32 player_view_candidates(const Player* viewer, PlayerList* list, const ZoneGrid* zones,
+                                  u16* candidates, u32* coords) {
+    u32 count = zone_grid_query(zones, position_x(&viewer->position), position_z(&viewer->position),
+                                MAX_VIEW_DISTANCE, candidates, MAX_PLAYERS);
+    for (u32 i = 0; i < count; i++) {
+        Player* other = player_list_get(list, candidates[i]);
+        if (!other || !player_is_active(other) || other == viewer ||
+            (other->update_flags & (1 << 16))) {
+            coords[i] = POSITION_VIEW_HIDDEN;
+        } else {
+            coords[i] = position_view_coord(&other->position);
+        }
+    }
+    return count;
+}
+
+/*
+ * player_find_visible - Set of players a viewer can see this tick
+ *
+ * @param viewer   Player looking
+ * @param list     Global player list (all online players)
+ * @param zones    World zone grid (players filed by 8x8 zone)
+ * @param visible  Receives the PIDs (cleared first; never the viewer)
+ *
+ * Queries the zones around the viewer; the grid returns whole zones, so
+ * position_view_mask() still performs player_can_see()'s exact
+ * distance/height test, on all candidates at once. Clearing the set is
+ * 256 bytes, not a bool per PID.
+ *
+ * COMPLEXITY: O(c) where c = players filed in the nearby zones
+ */
+void player_find_visible(const Player* viewer, PlayerList* list, const ZoneGrid* zones, PlayerSet* visible) {
+    memset(visible, 0, sizeof(*visible));
+    if (!viewer || !list || !zones) return;
+    
+    u16 candidates[MAX_PLAYERS];
+    u32 coords[POSITION_VIEW_ROUND(MAX_PLAYERS)];
+    u64 mask[POSITION_VIEW_ROUND(MAX_PLAYERS) / POSITION_VIEW_LANES];
+    u32 candidate_count = player_view_candidates(viewer, list, zones, candidates, coords);
+    position_view_mask(&viewer->position, coords, candidate_count, MAX_VIEW_DISTANCE, mask);
+    
+    for (u32 w = 0; w * POSITION_VIEW_LANES < candidate_count; w++) {
+        for (u64 bits = mask[w]; bits; bits &= bits - 1) {
+            u32 i = w * POSITION_VIEW_LANES + (u32)__builtin_ctzll(bits);
+            player_set_add(visible, candidates[i]);
+        }
+    }
+}
+
+/*
+ * player_find_visible_adaptive - Visible players, nearest first within a budget
+ *
+ * @param viewer         Player looking
+ * @param list           Global player list
+ * @param zones          World zone grid
+ * @param budget         Most players to return (clamped to MAX_LOCAL_PLAYERS)
+ * @param view_distance  Viewer's radius, updated (0 = MAX_VIEW_DISTANCE)
+ * @param visible        Receives the PIDs (cleared first; never the viewer)
+ *
+ * player_find_visible() with a radius that shrinks in crowds. Scanning
+ * candidates in PID order and stopping at 255 keeps an arbitrary subset
+ * in a busy bank; here candidates are binned by ring (Chebyshev distance,
+ * as in player_is_within_distance) and the radius is the largest one
+ * whose rings all fit in the budget:
+ *
+ *   ring:       0   1   2   3   4   5 ...  15
+ *   players:    2   9  30  41  80  95 ...        budget 100
+ *   cumulative: 2  11  41  82 162 ...            → radius 3 (82 players)
+ *
+ * HYSTERESIS:
+ *   The radius drops to the fitting one at once (the budget is a hard
+ *   bound) but grows back by one ring per tick, so a crowd at the edge
+ *   of the radius does not make players pop in and out every tick.
+ *
+ * The radius never drops below 1 (0 marks an unset entry). If rings 0-1
+ * alone are over budget (a crowd on a few tiles) the caller's add loop
+ * still stops at the budget.
+ *
+ * COMPLEXITY: O(c) where c = players filed in the nearby zones
+ */
+void player_find_visible_adaptive(const Player* viewer, PlayerList* list, const ZoneGrid* zones,
+                                  u32 budget, u8* view_distance, PlayerSet* visible) {
+    memset(visible, 0, sizeof(*visible));
+    if (!viewer || !list || !zones || !view_distance) return;
+    if (budget > MAX_LOCAL_PLAYERS) budget = MAX_LOCAL_PLAYERS;
+    
+    u16 candidates[MAX_PLAYERS];
+    u32 coords[POSITION_VIEW_ROUND(MAX_PLAYERS)];
+    u64 mask[POSITION_VIEW_ROUND(MAX_PLAYERS) / POSITION_VIEW_LANES];
+    u8 rings[MAX_PLAYERS];
+    u32 candidate_count = player_view_candidates(viewer, list, zones, candidates, coords);
+    position_view_mask(&viewer->position, coords, candidate_count, MAX_VIEW_DISTANCE, mask);
+    
+    /* Keep only players the viewer can see, remembering each one's ring */
+    u32 ring_count[MAX_VIEW_DISTANCE + 1] = {0};
+    u32 seen = 0;
+    for (u32 w = 0; w * POSITION_VIEW_LANES < candidate_count; w++) {
+        for (u64 bits = mask[w]; bits; bits &= bits - 1) {
+            u32 i = w * POSITION_VIEW_LANES + (u32)__builtin_ctzll(bits);
+            const Player* other = list->players[candidates[i]];
+            u8 ring = (u8)position_distance(&viewer->position, &other->position);
+            candidates[seen] = candidates[i];
+            rings[seen] = ring;
+            ring_count[ring]++;
+            seen++;
+        }
+    }
+    
+    /* Largest radius whose rings fit in the budget */
+    u32 fit = 1;
+    u32 total = 0;
+    for (u32 r = 0; r <= MAX_VIEW_DISTANCE; r++) {
+        total += ring_count[r];
+        if (total > budget) break;
+        if (r > 0) fit = r;
+    }
+    
+    u32 radius = *view_distance;
+    if (radius == 0 || radius > MAX_VIEW_DISTANCE) radius = MAX_VIEW_DISTANCE;
+    if (fit < radius) {
+        radius = fit;
+    } else if (fit > radius) {
+        radius++;
+    }
+    *view_distance = (u8)radius;
+    
+    for (u32 i = 0; i < seen; i++) {
+        if (rings[i] <= radius) player_set_add(visible, candidates[i]);
+    }
 }
 
 /*
- * player_update_local_players - Update list of visible players for given player
+ * player_update_local_players - Rebuild a viewer's local list from scratch
  *
  * @param player    Player whose local list to update
  * @param list      Global player list (all online players)
+ * @param zones     World zone grid (players filed by 8x8 zone)
  * @param tracking  PlayerTracking structure to populate
  *
- * Scans all players in the server and builds a list of visible players
- * (those within view distance on same height level). This list is used
- * by the player update packet system to determine which players need
- * synchronization.
+ * Sets tracking->tracked to the visible set and lists its first
+ * MAX_LOCAL_PLAYERS members (lowest PIDs first) in local_players[].
+ * appearance_hashes[] is left alone.
  *
- * ALGORITHM:
- *   1. Clear tracking->local_count to 0
- *   2. Zero out tracking->tracked[] bitmap
- *   3. Iterate through all player slots (1 to capacity-1)
- *   4. For each active player:
- *      a. Skip if NULL or inactive
- *      b. Check if visible using player_can_see()
- *      c. If visible:
- *         - Add PID to tracking->local_players[]
- *         - Increment tracking->local_count
- *         - Set tracking->tracked[PID] = true
- *   5. Stop if local_count reaches MAX_PLAYERS
- *
- * TRACKING STRUCTURE:
- *   local_players[]: Array of PIDs for visible players
- *   local_count:     Number of entries in local_players[]
- *   tracked[]:       Bitmap for O(1) "is player tracked" checks
- *
- * WHEN TO CALL:
- *   Called once per game tick (600ms) before sending player update packets.
- *   Ensures player sees accurate positions of nearby players.
- *
- * PERFORMANCE:
- *   - Scans entire capacity (2048 slots) every call
- *   - Most slots are NULL (empty), so overhead is minimal
- *   - Could optimize with active player list, but unnecessary at current scale
- *
- * COMPLEXITY: O(n) where n = capacity (2048 in practice)
+ * update.c does not use this: PLAYER_INFO must keep the client's order
+ * and only append, so it diffs against the previous tick instead (see
+ * update_other_players). This is for starting a list over, e.g. after
+ * a teleport that leaves every tracked player behind.
+ *
+ * COMPLEXITY: O(c + PLAYER_SET_WORDS), c = players in nearby zones
  */
-void player_update_local_players(Player* player, PlayerList* list, PlayerTracking* tracking) {
+void player_update_local_players(Player* player, PlayerList* list, const ZoneGrid* zones, PlayerTracking* tracking) {
     /* Validate all parameters before proceeding */
-    if (!player || !list || !tracking) return;
+    if (!player || !list || !zones || !tracking) return;
     
-    /*
-     * Clear previous tracking state:
-     *   - local_count: reset to 0 (no visible players yet)
-     *   - tracked[]: zero entire bitmap (2048 bytes)
-     */
-    tracking->local_count = 0;
-    memset(tracking->tracked, 0, sizeof(tracking->tracked));
+    player_find_visible(player, list, zones, &tracking->tracked);
     
-    /*
-     * Scan all player slots to find visible players.
-     * 
-     * OPTIMIZATION OPPORTUNITIES (not yet implemented):
-     *   - Could maintain a dense "active players" list to avoid scanning
-     *     empty slots (would reduce from O(2048) to O(active_count))
-     *   - Could use spatial partitioning (region-based lookup)
-     *   - Current approach is simple and sufficient for typical server loads
-     */
-    for (u32 i = 1; i < list->capacity && tracking->local_count < MAX_PLAYERS; i++) {
-        Player* other = list->players[i];
-        
-        /* Skip empty slots and inactive players */
-        if (!other || !player_is_active(other)) {
+    tracking->local_count = 0;
+    for (u32 pid = player_set_next(&tracking->tracked, 0); pid < MAX_PLAYERS;
+         pid = player_set_next(&tracking->tracked, pid + 1)) {
+        if (tracking->local_count == MAX_LOCAL_PLAYERS) {
+            /* Keep the set equal to the list: drop what did not fit */
+            player_set_remove(&tracking->tracked, pid);
             continue;
         }
-        
-        /*
-         * Visibility test: distance, height, flags.
-         * If visible, add to tracking arrays.
-         */
-        if (player_can_see(player, other)) {
-            /*
-             * Add to local player list:
-             *   - local_players[]: array of PIDs for protocol encoding
-             *   - local_count: number of entries (also array index)
-             *   - tracked[PID]: O(1) lookup bitmap for "is tracked?"
-             */
-            tracking->local_players[tracking->local_count++] = other->index;
-            tracking->tracked[other->index] = true;
-        }
+        tracking->local_players[tracking->local_count++] = (u16)pid;
     }
-    
-    /*
-     * After this function:
-     *   - tracking->local_count = number of visible players
-     *   - tracking->local_players[0..local_count-1] = their PIDs
-     *   - tracking->tracked[PID] = true for each visible player
-     * 
-     * This data is used by update.c to construct the PLAYER_INFO packet.
-     */
-}
\ No newline at end of file
+}
@@ -3,6 +3,11 @@
 
 #include "types.h"
 #include "player.h"
+#include "zone_grid.h"
+#include "datastruct/slotmap.h"
+
+/* Maximum tile distance (each axis) at which players can see each other */
+#define MAX_VIEW_DISTANCE 15
 
 /* Player visibility constants */
 typedef enum {
@@ -11,21 +16,112 @@ typedef enum {
     VISIBILITY_HARD = 2     /* Hidden from other players */
 } PlayerVisibility;
 
+/* 64-bit words in a PlayerSet */
+#define PLAYER_SET_WORDS (MAX_PLAYERS / 64)
+
+/*
+ * PlayerSet - One bit per PID (256 bytes)
+ *
+ * Set operations run a word (64 PIDs) at a time; iteration skips empty
+ * words and finds set bits with count-trailing-zeros, so walking a set
+ * costs 32 word tests plus one step per member.
+ */
+typedef struct {
+    u64 bits[PLAYER_SET_WORDS];
+} PlayerSet;
+
+static inline bool player_set_has(const PlayerSet* set, u32 pid) {
+    return (set->bits[pid >> 6] >> (pid & 63)) & 1;
+}
+
+static inline void player_set_add(PlayerSet* set, u32 pid) {
+    set->bits[pid >> 6] |= (u64)1 << (pid & 63);
+}
+
+static inline void player_set_remove(PlayerSet* set, u32 pid) {
+    set->bits[pid >> 6] &= ~((u64)1 << (pid & 63));
+}
+
+/*
+ * player_set_next - First member >= pid, or MAX_PLAYERS if none
+ *
+ * USAGE:
+ *   for (u32 pid = player_set_next(&set, 0); pid < MAX_PLAYERS;
+ *        pid = player_set_next(&set, pid + 1)) { ... }
+ */
+static inline u32 player_set_next(const PlayerSet* set, u32 pid) {
+    if (pid >= MAX_PLAYERS) return MAX_PLAYERS;
+    u32 word = pid >> 6;
+    u64 bits = set->bits[word] & (~(u64)0 << (pid & 63));
+    while (!bits) {
+        if (++word == PLAYER_SET_WORDS) return MAX_PLAYERS;
+        bits = set->bits[word];
+    }
+    return (word << 6) | (u32)__builtin_ctzll(bits);
+}
+
+/* out = a \ b (members of a that are not in b); out may alias a */
+void player_set_difference(PlayerSet* out, const PlayerSet* a, const PlayerSet* b);
+
+/* Number of members (popcount over the words) */
+u32 player_set_count(const PlayerSet* set);
+
 /* Player list structure for efficient multiplayer tracking */
 typedef struct {
     Player** players;       /* Array of player pointers indexed by PID */
     u32 capacity;          /* Maximum number of players */
     u32 count;             /* Current number of active players */
     bool* occupied;        /* Bitmap of occupied slots */
-    u32 next_pid;          /* Next PID to try for allocation */
+    SlotMap* pids;         /* Free PIDs, longest-free first (PID 0 reserved) */
+    Player** active;       /* Listed players packed in [0, count), any order */
+    u16* active_slot;      /* PID -> position in active[] (valid while occupied) */
+    PlayerSet changed;     /* Moved, got update flags or being placed this tick */
+    u16* changed_pids;     /* The same PIDs, in the order they were marked */
+    u32 changed_count;
 } PlayerList;
 
-/* Player tracking info for each player */
+/* Most players in one viewer's local list (PLAYER_INFO sends an 8-bit count) */
+#define MAX_LOCAL_PLAYERS 255
+
+/*
+ * g_local_player_budget - Most players one viewer tracks (--local-player-budget)
+ *
+ * When more players than this are visible, the viewer's radius shrinks
+ * until the nearest ones fit (see player_find_visible_adaptive). Defaults
+ * to MAX_LOCAL_PLAYERS; values above it are clamped to it.
+ */
+extern u32 g_local_player_budget;
+
+/*
+ * PlayerTracking - What one viewer's client currently shows
+ *
+ * local_players[] is the client's local list in the client's order (the
+ * order PLAYER_INFO updates them in); tracked is the same players as a
+ * set, for O(1) membership and word-wide diffs against who is visible
+ * this tick. appearance_hashes[] outlives both: it remembers the last
+ * appearance version sent for every PID, so a player walking back into
+ * view without changing clothes is re-added without the block. Entries
+ * are zeroed when a PID changes hands or its version wraps
+ * (world_forget_appearance, world.h).
+ *
+ * view_distance is the viewer's current radius in tiles: MAX_VIEW_DISTANCE
+ * normally, smaller while the area is too crowded for the local player
+ * budget, never below 1. 0 (a freshly zeroed entry) means MAX_VIEW_DISTANCE.
+ *
+ * owed holds tracked players whose changed appearance did not fit in the
+ * viewer's PLAYER_INFO byte budget (g_player_info_budget, update.h); it is
+ * sent on a later tick even if they change nothing else.
+ *
+ * SIZE: 510 + 1 + 4 + 256 + 256 + 2048 = ~3KB (was 8KB with a u16 list
+ * and a bool per PID), 6.2MB for MAX_PLAYERS viewers.
+ */
 typedef struct {
-    u16 local_players[MAX_PLAYERS];     /* PIDs of players in local area */
-    u32 local_count;                    /* Number of local players */
-    bool tracked[MAX_PLAYERS];          /* Which players currently tracking */
-    u8 appearance_hashes[MAX_PLAYERS];  /* Appearance version tracking */
+    u16 local_players[MAX_LOCAL_PLAYERS];   /* PIDs of players in local area */
+    u8 view_distance;                       /* Current radius (0 = maximum) */
+    u32 local_count;                        /* Number of local players */
+    PlayerSet tracked;                      /* Same players, as a set */
+    PlayerSet owed;                         /* Tracked, appearance deferred */
+    u8 appearance_hashes[MAX_PLAYERS];      /* Appearance version tracking */
 } PlayerTracking;
 
 /* Player list functions */
@@ -33,12 +129,87 @@ PlayerList* player_list_create(u32 capacity);
 void player_list_destroy(PlayerList* list);
 bool player_list_add(PlayerList* list, Player* player);
 void player_list_remove(PlayerList* list, u16 pid);
+void player_list_replace(PlayerList* list, u16 pid, Player* player);
 Player* player_list_get(PlayerList* list, u16 pid);
 u16 player_list_get_next_pid(PlayerList* list);
 
+/*
+ * player_list_attach / player_list_detach - List a player by PID only
+ *
+ * An attached player takes a PID and resolves through player_list_get(),
+ * so viewers find and encode it like anyone else, but it is not in the
+ * dense active[] list or count: no tick phase moves it or sends it
+ * packets. The ghosts of players on other cluster nodes (cluster.h) are
+ * attached this way. Detach frees the PID; never player_list_remove()
+ * an attached player.
+ *
+ * COMPLEXITY: O(1)
+ */
+bool player_list_attach(PlayerList* list, Player* player);
+void player_list_detach(PlayerList* list, u16 pid);
+
+/*
+ * Tick phases iterate the dense list instead of scanning every PID:
+ *
+ *   for (u32 i = 0; i < list->count; i++) {
+ *       Player* player = list->active[i];
+ *       ...
+ *   }
+ *
+ * Removing a player moves the last entry into its place, so the list
+ * must not change during such a loop.
+ */
+
+/*
+ * CHANGED PLAYERS:
+ *
+ * Most players in a quiet world do nothing in most ticks: they stand
+ * still, say nothing and were placed long ago. The list keeps the PIDs
+ * that did something this tick, so the phases that only care about
+ * those touch nothing else:
+ *
+ *   marked by                               cleared by
+ *   ─────────                               ──────────
+ *   world_process() phase 1 (moved)         player_list_end_tick(), once
+ *   player_mark_changed() (update_flags,    their flags are reset and
+ *     appearance, teleport)                 their placement is over
+ *   world_register_player() (placement)
+ *
+ *   update_other_players()   a kept local not in the set is one 0 bit,
+ *                            without loading its Player
+ *   player_list_end_tick()   resets flags and ages placement for the
+ *                            marked players only
+ *
+ * Anything that sets update_flags, needs_placement or moves a player
+ * outside phase 1 must mark it, or viewers would miss the change.
+ */
+
+/*
+ * player_list_mark_changed - Add a player to this tick's changed set
+ *
+ * Also drops the player's cached mask segments (update_cache): they are
+ * kept across ticks only while nothing about the player changes.
+ *
+ * COMPLEXITY: O(1)
+ */
+void player_list_mark_changed(PlayerList* list, Player* player);
+
+/*
+ * player_list_end_tick - Reset the changed players for the next tick
+ *
+ * For each marked player: age needs_placement, clear update_flags and
+ * the mask segment cache. Players still being placed stay marked.
+ *
+ * COMPLEXITY: O(changed players)
+ */
+void player_list_end_tick(PlayerList* list);
+
 /* Player visibility functions */
 bool player_can_see(const Player* viewer, const Player* target);
 bool player_is_within_distance(const Player* p1, const Player* p2);
-void player_update_local_players(Player* player, PlayerList* list, PlayerTracking* tracking);
+void player_find_visible(const Player* viewer, PlayerList* list, const ZoneGrid* zones, PlayerSet* visible);
+void player_find_visible_adaptive(const Player* viewer, PlayerList* list, const ZoneGrid* zones,
+                                  u32 budget, u8* view_distance, PlayerSet* visible);
+void player_update_local_players(Player* player, PlayerList* list, const ZoneGrid* zones, PlayerTracking* tracking);
 
 #endif /* PLAYER_LIST_H */
\ No newline at end of file
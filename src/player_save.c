@@ -12,7 +12,7 @@
  *   │ HEADER (4 bytes)                                       │
  *   │  ├─ Magic Number: 0x2004 (u16, big-endian)           │
  *   │  │   Identifies file as RuneScape player save         │
- *   │  └─ Format Version: 6 (u16, big-endian)              │
+ *   │  └─ Format Version: 1-7 (u16, big-endian)            │
  *   │      Version history:                                 │
  *   │        v1: Initial format                             │
  *   │        v2: Extended playtime to u32                   │
@@ -20,6 +20,9 @@
  *   │        v4: Added chat mode preferences                │
  *   │        v5: Added inventory persistence                │
  *   │        v6: Added last login timestamp                 │
+ *   │        v7: Tagged varint sections (below)             │
+ *   ├────────────────────────────────────────────────────────┤
+ *   │ VERSIONS 1-6: the fixed-width fields below            │
  *   ├────────────────────────────────────────────────────────┤
  *   │ POSITION (5 bytes)                                     │
  *   │  ├─ X coordinate (u16): World X (0-6400)             │
@@ -81,8 +84,45 @@
  *   │      above (excludes CRC32 itself)                    │
  *   └────────────────────────────────────────────────────────┘
  *
- * MINIMUM FILE SIZE: ~170 bytes (new player with no extras)
- * TYPICAL FILE SIZE: ~200-500 bytes (with inventory/varps)
+ * VERSION 7 - TAGGED SECTIONS (what player_save_serialize() writes):
+ *
+ *   [magic:2][version:2 = 7]
+ *   [tag][length][payload: length bytes]     tag, length: varints
+ *   [tag][length][payload]
+ *   ...
+ *   [0]                                      end of sections
+ *   [crc32:4]
+ *
+ *   Numbers in payloads are unsigned LEB128 varints: 7 bits per byte,
+ *   low bits first, high bit set on every byte but the last:
+ *
+ *     0 → [00]      127 → [7F]      11540 → [94 5A]      13034431 → 4 bytes
+ *
+ *   A section whose fields all equal player_data_init()'s defaults is
+ *   not written at all; the loader starts from those defaults. A fresh
+ *   account is 16 bytes (position only) instead of 153, a typical one
+ *   40-80 and a maxed one about 140. Tags the loader does not know are skipped by their length,
+ *   so a section added later does not need a new version to stay
+ *   readable by this loader.
+ *
+ *   tag  section      payload
+ *   ───  ───────      ───────
+ *    1   POSITION     x, z varints; height byte                (always)
+ *    2   LOOK         design flag, gender, body[7], colors[5]  (bytes)
+ *    3   RUN_ENERGY   varint
+ *    4   PLAYTIME     varint
+ *    5   SKILLS       mask of skills off their default (varint),
+ *                     then per skill in the mask: xp varint, level byte
+ *    6   LAST_LOGIN   varint
+ *    7   FRIENDS      count varint, then each base-37 name varint,
+ *                     in ascending order (social.h)
+ *    8   IGNORES      the same, for the ignore list
+ *
+ *   Varps, inventories, AFK zones and chat modes, which versions 1-6
+ *   always wrote as empty, get tags when they are saved for real.
+ *
+ * MINIMUM FILE SIZE: 16 bytes (v7, new player); 153 bytes (v6)
+ * TYPICAL FILE SIZE: ~40-80 bytes (v7); ~200-500 bytes (v6 with extras)
  * MAXIMUM FILE SIZE: ~8KB (large inventory, many varps)
  *
  * ENDIANNESS:
@@ -102,8 +142,8 @@
  *   - Detects corruption from disk errors, partial writes, bit flips
  *
  * VERSION MIGRATION:
- *   - Loader supports reading all versions 1-6
- *   - Always saves in latest format (v6)
+ *   - Loader supports reading all versions 1-7
+ *   - Always saves in latest format (v7)
  *   - Old fields are skipped if present in older versions
  *   - New fields default to zero if missing in older versions
  *
@@ -113,18 +153,30 @@
  *   - Related: player.h (Player structure definition)
  *
  * THREAD SAFETY:
- *   Not thread-safe. Caller must ensure exclusive access to Player object
- *   during save/load operations. File I/O is inherently sequential.
+ *   player_save() / player_load() must run on the thread that owns the
+ *   Player (the game thread). They only serialize / parse there; the file
+ *   writes happen on the save writer thread (save_queue.h), which calls
+ *   player_save_write() with a private copy of the bytes.
  *
  * PERFORMANCE:
- *   - Save: O(1) - constant time, ~170 bytes written
+ *   - Save: O(1) - constant time, ~16-80 bytes written
  *   - Load: O(1) - constant time, single disk read
  *   - No dynamic allocations during save/load
  *
  ******************************************************************************/
 
+#define _POSIX_C_SOURCE 200112L
+
 #include "player_save.h"
+#include "log.h"
+#include "save_queue.h"
+#include "save_cache.h"
+#include "save_log.h"
+#include "replay.h"
 #include "crc32.h"
+#include "account_registry.h"
+#include "supervisor.h"
+#include "social.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -133,9 +185,13 @@
 
 #ifdef _WIN32
 #include <direct.h>
+#include <io.h>
 #define mkdir(path, mode) _mkdir(path)
 #else
 #include <sys/types.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <signal.h>
 #endif
 
 /*******************************************************************************
@@ -296,20 +352,6 @@ static void write_u32(u8* buffer, size_t* pos, u32 value) {
     buffer[(*pos)++] = value & 0xFF;
 }
 
-/*
- * write_u64 - Write unsigned 64-bit integer (big-endian)
- * @param buffer  Destination buffer
- * @param pos     Current position (auto-incremented by 8)
- * @param value   Value to write (0-2^64-1)
- * 
- * ENCODING: [high_u32][low_u32] - each u32 is big-endian
- * Uses write_u32() internally to ensure consistent byte order
- */
-static void write_u64(u8* buffer, size_t* pos, u64 value) {
-    write_u32(buffer, pos, (u32)(value >> 32));
-    write_u32(buffer, pos, (u32)(value & 0xFFFFFFFF));
-}
-
 /*
  * read_u8 - Read unsigned 8-bit integer
  * @param buffer  Source buffer
@@ -378,6 +420,88 @@ static u64 read_u64(const u8* buffer, size_t* pos) {
     return (high << 32) | low;
 }
 
+/*
+ * write_varint - Write unsigned LEB128 (version 7)
+ * @param buffer  Destination buffer
+ * @param pos     Current position (auto-incremented by 1-10)
+ * @param value   Value to write
+ * 
+ * ENCODING: 7 bits per byte, low bits first, 0x80 on all but the last
+ * Example: 300 → [0xAC][0x02]
+ */
+static void write_varint(u8* buffer, size_t* pos, u64 value) {
+    while (value >= 0x80) {
+        buffer[(*pos)++] = (u8)(value | 0x80);
+        value >>= 7;
+    }
+    buffer[(*pos)++] = (u8)value;
+}
+
+/*
+ * read_varint - Read unsigned LEB128, never past end (version 7)
+ * @param buffer  Source buffer
+ * @param end     First byte that may not be read
+ * @param pos     Current position (auto-incremented)
+ * @param value   Receives the value
+ * @return        false if end came first or the varint is over 10 bytes
+ */
+static bool read_varint(const u8* buffer, size_t end, size_t* pos, u64* value) {
+    u64 result = 0;
+    for (u32 shift = 0; shift < 70 && *pos < end; shift += 7) {
+        u8 byte = buffer[(*pos)++];
+        result |= (u64)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * read_byte - Read one byte, never past end (version 7)
+ */
+static bool read_byte(const u8* buffer, size_t end, size_t* pos, u8* value) {
+    if (*pos >= end) return false;
+    *value = buffer[(*pos)++];
+    return true;
+}
+
+/*******************************************************************************
+ * DEFAULTS
+ *******************************************************************************
+ * What player_data_init() sets, and what a version 7 save leaves out.
+ ******************************************************************************/
+
+/* Default male look: hair, beard, torso, arms, hands, legs, feet */
+static const i8 DEFAULT_BODY[7] = { 0, 10, 18, 26, 33, 36, 42 };
+
+/* Full run energy (centipercent) */
+#define DEFAULT_RUN_ENERGY 10000
+
+/* Hitpoints starts at level 10 (1154 XP, stored as 11540 in protocol 225) */
+#define DEFAULT_HITPOINTS_XP 11540
+#define DEFAULT_HITPOINTS_LEVEL 10
+
+static u32 default_experience(int skill) {
+    return skill == SKILL_HITPOINTS ? DEFAULT_HITPOINTS_XP : 0;
+}
+
+static u8 default_level(int skill) {
+    return skill == SKILL_HITPOINTS ? DEFAULT_HITPOINTS_LEVEL : 1;
+}
+
+static bool look_is_default(const Player* player) {
+    if (player->design_complete || player->gender != 0) return false;
+    for (int i = 0; i < 7; i++) {
+        if (player->body[i] != DEFAULT_BODY[i]) return false;
+    }
+    for (int i = 0; i < 5; i++) {
+        if (player->colors[i] != 0) return false;
+    }
+    return true;
+}
+
 /*
  * player_get_save_path - Construct filesystem path for player save file
  * 
@@ -479,13 +603,9 @@ static bool create_directory_recursive(const char* path) {
 void player_data_init(Player* player) {
     /* Default appearance: male, basic clothing */
     player->gender = 0;  /* Male */
-    player->body[0] = 0;  /* Hair */
-    player->body[1] = 10; /* Beard */
-    player->body[2] = 18; /* Torso */
-    player->body[3] = 26; /* Arms */
-    player->body[4] = 33; /* Hands */
-    player->body[5] = 36; /* Legs */
-    player->body[6] = 42; /* Feet */
+    for (int i = 0; i < 7; i++) {
+        player->body[i] = DEFAULT_BODY[i];
+    }
     
     /* Default colors */
     for (int i = 0; i < 5; i++) {
@@ -495,253 +615,171 @@ void player_data_init(Player* player) {
     /* New player - needs to complete character design */
     player->design_complete = false;
     
-    /* Initialize all skills to level 1 with 0 XP */
+    /* All skills at level 1 with 0 XP, except Hitpoints at level 10 */
     for (int i = 0; i < SKILL_COUNT; i++) {
-        player->experience[i] = 0;
-        player->levels[i] = 1;
+        player->experience[i] = default_experience(i);
+        player->levels[i] = default_level(i);
     }
     
-    /* Hitpoints starts at level 10 (1154 XP in protocol 225) */
-    player->experience[SKILL_HITPOINTS] = 11540;
-    player->levels[SKILL_HITPOINTS] = 10;
-    
     /* Full run energy */
-    player->runenergy = 10000;
+    player->runenergy = DEFAULT_RUN_ENERGY;
     
     /* Zero playtime */
     player->playtime = 0;
     
     /* Current timestamp */
     player->last_login = 0;  /* Will be set on login */
+    
+    /* No friends or ignores */
+    social_list_reset(&player->social);
 }
 
+/* Version 7 section tags (see the format at the top of this file) */
+enum {
+    SAVE_TAG_END = 0,
+    SAVE_TAG_POSITION = 1,
+    SAVE_TAG_LOOK = 2,
+    SAVE_TAG_RUN_ENERGY = 3,
+    SAVE_TAG_PLAYTIME = 4,
+    SAVE_TAG_SKILLS = 5,
+    SAVE_TAG_LAST_LOGIN = 6,
+    SAVE_TAG_FRIENDS = 7,
+    SAVE_TAG_IGNORES = 8
+};
+
+/* Largest section payload: a full FRIENDS list (1 + 100 names × 9) */
+#define SAVE_SECTION_MAX 1024
+
 /*
- * player_save - Serialize and atomically save player data to disk
- *
- * @param player  Player structure to save
- * @return        true on success, false on I/O error
+ * write_section - Append [tag][length][payload]
+ */
+static void write_section(u8* buffer, size_t* pos, u32 tag, const u8* payload, size_t length) {
+    write_varint(buffer, pos, tag);
+    write_varint(buffer, pos, length);
+    memcpy(buffer + *pos, payload, length);
+    *pos += length;
+}
+
+/*
+ * player_save_serialize - Encode a player in the current save format
  *
- * ATOMIC SAVE ALGORITHM:
- *   1. Serialize player data to memory buffer (~170 bytes)
- *   2. Calculate CRC32 checksum of serialized data
- *   3. Write buffer to temporary file (username.sav.tmp)
- *   4. Atomically rename temp file to final file (username.sav)
- *   5. On failure, temp file is removed, old save remains intact
+ * @param player  Player structure to encode
+ * @param buffer  Output buffer of at least PLAYER_SAVE_MAX_SIZE bytes
+ * @return        Bytes written (CRC32 footer included)
  *
- * This two-phase commit ensures save files are never corrupted by crashes
- * or power failures during write operations. The rename() operation is
- * atomic on both Unix and Windows filesystems.
- *
- * SERIALIZATION ORDER (see file format diagram in header):
+ * SERIALIZATION ORDER (version 7, see file format diagram in header):
  *   1. Header (magic + version)
- *   2. Position (x, z, height)
- *   3. Appearance (body parts + colors)
- *   4. Player data (gender, design flag, energy, playtime)
- *   5. Skills (21 × (experience + level))
- *   6. Varps (count + data) - currently always 0
- *   7. Inventories (count + data) - currently always 0
- *   8. AFK zones (count + data) - currently always 0
- *   9. Chat modes (packed byte) - currently always 0
- *  10. Last login timestamp (u64)
- *  11. CRC32 checksum (computed over all above data)
+ *   2. POSITION (always)
+ *   3. LOOK, RUN_ENERGY, PLAYTIME, SKILLS, LAST_LOGIN, FRIENDS, IGNORES -
+ *      each only if it differs from player_data_init()'s defaults
+ *   4. End tag
+ *   5. CRC32 checksum (computed over all above data)
  *
- * ERROR HANDLING:
- *   - Directory creation failure → returns false
- *   - File open failure → returns false
- *   - Incomplete write → removes temp file, returns false
- *   - Rename failure → removes temp file, returns false
+ * Each section's payload goes to a scratch array first, so its length
+ * can be written in front of it.
  *
- * COMPLEXITY: O(1) - constant ~170 byte write operation
+ * Pure CPU work on the caller's buffer: no I/O, safe on the game thread.
  *
- * CROSS-REF:
- *   - TypeScript: Player.save() in Player.ts
- *   - Related: crc32() for integrity checking
- *   - Related: player_load() for deserialization
+ * COMPLEXITY: O(1) - at most ~230 bytes, ~2KB with full friend and
+ *             ignore lists
  */
-bool player_save(const Player* player) {
-    /*
-     * Stack buffer for serialization. 8192 bytes is generous:
-     *   - Current format: ~170 bytes
-     *   - With full inventory/varps: ~2000 bytes
-     *   - Safety margin: 6000+ bytes
-     * 
-     * Stack allocation preferred over malloc for:
-     *   - Performance (no heap allocation overhead)
-     *   - Automatic cleanup (no memory leaks possible)
-     *   - Cache locality (stack is hot in L1 cache)
-     */
-    u8 buffer[8192];
+size_t player_save_serialize(const Player* player, u8* buffer) {
     size_t pos = 0;  /* Current write position in buffer */
+    u8 payload[SAVE_SECTION_MAX];
+    size_t n;
     
     /*
-     * PHASE 1: PREPARATION
-     * Ensure filesystem is ready to receive data.
-     */
-    
-    /* Create save directory if it doesn't exist (mkdir -p behavior) */
-    if (!create_directory_recursive(PLAYER_SAVE_DIR)) {
-        printf("Failed to create save directory: %s\n", PLAYER_SAVE_DIR);
-        return false;
-    }
-    
-    /*
-     * Generate file paths:
-     *   filepath:  data/players/Username.sav      (final destination)
-     *   temp_path: data/players/Username.sav.tmp  (temporary write target)
-     * 
-     * Using temporary file for atomic save:
-     *   1. Write complete data to .tmp file
-     *   2. Atomically rename .tmp to .sav
-     *   3. If crash occurs during write, old .sav remains valid
-     */
-    char filepath[512];
-    char temp_path[512];
-    player_get_save_path(player->username, filepath, sizeof(filepath));
-    snprintf(temp_path, sizeof(temp_path), "%s.tmp", filepath);
-    
-    /*
-     * PHASE 2: SERIALIZATION
-     * Write all player data to memory buffer in big-endian format.
-     */
-    
-    /*
-     * File header (4 bytes):
+     * File header (4 bytes), fixed width in every version:
      *   Magic:   0x2004 - identifies file type, prevents reading wrong files
-     *   Version: 6 - format version, enables backward compatibility
+     *   Version: 7 - format version, enables backward compatibility
      */
     write_u16(buffer, &pos, PLAYER_SAVE_MAGIC);   /* 0x2004 */
-    write_u16(buffer, &pos, PLAYER_SAVE_VERSION); /* 6 */
+    write_u16(buffer, &pos, PLAYER_SAVE_VERSION); /* 7 */
     
     /*
-     * Player position (5 bytes):
-     *   X: 0-6400 (world coordinates)
-     *   Z: 0-6400 (world coordinates)
-     *   Height: 0-3 (floor level)
-     * 
-     * Stored in absolute coordinates, not region-relative.
-     * This matches TypeScript server format.
+     * Position: absolute x, z (0-6400, two varint bytes past 127) and
+     * height (0-3). There is no default position, so always written.
      */
-    write_u16(buffer, &pos, player->position.x);
-    write_u16(buffer, &pos, player->position.z);
-    write_u8(buffer, &pos, player->position.height);
+    n = 0;
+    write_varint(payload, &n, position_x(&player->position));
+    write_varint(payload, &n, position_z(&player->position));
+    write_u8(payload, &n, position_height(&player->position));
+    write_section(buffer, &pos, SAVE_TAG_POSITION, payload, n);
     
     /*
-     * Appearance data (12 bytes total):
-     *   Body parts [7]: Hair, beard, torso, arms, hands, legs, feet
-     *   Colors [5]: Hair, torso, leg, feet, skin
-     * 
-     * Body part encoding:
-     *   -1 (i8) → 255 (u8) = hidden/not shown
-     *   0-254 = style index from IDK (identity kit) cache
-     * 
-     * Color encoding:
-     *   0-255 = index into client's color palette
+     * Look: design flag, gender, body parts (-1 stored as 255), colors.
+     * A player still in the design screen with the default look has
+     * nothing to save here.
      */
-    for (int i = 0; i < 7; i++) {
-        /*
-         * Signed to unsigned conversion for -1:
-         *   i8(-1) = 0xFF in two's complement
-         *   Store as u8(255) = 0xFF
-         *   On load: u8(255) → i8(-1)
-         */
-        u8 body_value = (player->body[i] == -1) ? 255 : (u8)player->body[i];
-        write_u8(buffer, &pos, body_value);
+    if (!look_is_default(player)) {
+        n = 0;
+        write_u8(payload, &n, player->design_complete ? 1 : 0);
+        write_u8(payload, &n, player->gender);
+        for (int i = 0; i < 7; i++) {
+            write_u8(payload, &n, (player->body[i] == -1) ? 255 : (u8)player->body[i]);
+        }
+        for (int i = 0; i < 5; i++) {
+            write_u8(payload, &n, player->colors[i]);
+        }
+        write_section(buffer, &pos, SAVE_TAG_LOOK, payload, n);
     }
     
-    /* Color palette indices (0-255 each) */
-    for (int i = 0; i < 5; i++) {
-        write_u8(buffer, &pos, player->colors[i]);
+    if (player->runenergy != DEFAULT_RUN_ENERGY) {
+        n = 0;
+        write_varint(payload, &n, player->runenergy);
+        write_section(buffer, &pos, SAVE_TAG_RUN_ENERGY, payload, n);
     }
     
-    /*
-     * Player metadata (8 bytes):
-     *   Gender: 0=male, 1=female
-     *   Design complete: 0=tutorial mode, 1=finished character creation
-     *   Run energy: 0-10000 (stored as centipercent, displayed as 0-100%)
-     *   Playtime: seconds played (4 billion seconds = 126 years max)
-     */
-    write_u8(buffer, &pos, player->gender);
-    write_u8(buffer, &pos, player->design_complete ? 1 : 0);
-    write_u16(buffer, &pos, player->runenergy);
-    write_u32(buffer, &pos, player->playtime);
+    if (player->playtime != 0) {
+        n = 0;
+        write_varint(payload, &n, player->playtime);
+        write_section(buffer, &pos, SAVE_TAG_PLAYTIME, payload, n);
+    }
     
     /*
-     * Skills data (105 bytes: 21 skills × 5 bytes each):
-     *   For each skill:
-     *     Experience: u32 (0 to 200,000,000 for level 99)
-     *     Level: u8 (1-99, can be boosted/drained)
-     * 
-     * Skill order (SKILL_COUNT = 21):
-     *   0:Attack, 1:Defense, 2:Strength, 3:Hitpoints, 4:Ranged,
-     *   5:Prayer, 6:Magic, 7:Cooking, 8:Woodcutting, 9:Fletching,
-     *   10:Fishing, 11:Firemaking, 12:Crafting, 13:Smithing, 14:Mining,
-     *   15:Herblore, 16:Agility, 17:Thieving, 18:Slayer, 19:Farming,
-     *   20:Runecraft
-     * 
-     * XP-to-Level formula: level = floor(sqrt(xp/75 + 1))
-     * Level 99 requires: 13,034,431 XP
+     * Skills: a mask of the skills that moved off their default (a
+     * varint, at most 3 bytes for 21 skills), then XP and level of each
+     * of those in skill order. A fresh account has no section; a maxed
+     * one still saves 2-4 bytes per skill less than 5 fixed ones.
      */
+    u32 changed = 0;
     for (int i = 0; i < SKILL_COUNT; i++) {
-        write_u32(buffer, &pos, player->experience[i]);
-        write_u8(buffer, &pos, player->levels[i]);
+        if (player->experience[i] != default_experience(i) ||
+            player->levels[i] != default_level(i)) changed |= 1u << i;
+    }
+    if (changed != 0) {
+        n = 0;
+        write_varint(payload, &n, changed);
+        for (int i = 0; i < SKILL_COUNT; i++) {
+            if (!(changed & (1u << i))) continue;
+            write_varint(payload, &n, player->experience[i]);
+            write_u8(payload, &n, player->levels[i]);
+        }
+        write_section(buffer, &pos, SAVE_TAG_SKILLS, payload, n);
     }
     
-    /*
-     * Varps (variable persistent settings) - NOT YET IMPLEMENTED
-     *   Count: u16 (currently 0)
-     *   Data: For each varp: u32 (varp_id << 16 | value)
-     * 
-     * Varps store quest progress, settings, unlocks.
-     * Example varps:
-     *   - Quest stages
-     *   - Music tracks unlocked
-     *   - Tutorial completion flags
-     *   - Interface settings
-     */
-    write_u16(buffer, &pos, 0);  /* No varps yet */
-    
-    /*
-     * Inventories - NOT YET IMPLEMENTED
-     *   Count: u8 (currently 0)
-     *   For each inventory:
-     *     Type: u16 (0=main inventory, 1=equipment, 2=bank, etc.)
-     *     Size: u16 (number of slots, e.g., 28 for main inventory)
-     *     Items: For each slot:
-     *       ID: u16 (0=empty, 1-65535=item ID)
-     *       Count: u8 or u32 (if count=255, followed by u32 for extended)
-     * 
-     * Total size with full inventory: ~100-500 bytes
-     */
-    write_u8(buffer, &pos, 0);  /* No inventories yet */
-    
-    /*
-     * AFK zones (anti-botting system) - NOT YET IMPLEMENTED
-     *   Count: u8 (currently 0)
-     *   Zones: For each: u32 packed coordinate
-     *   Counter: u16 (zone tracking counter)
-     * 
-     * Used to detect players who never leave certain areas (bots).
-     */
-    write_u8(buffer, &pos, 0);  /* No AFK zones yet */
+    if (player->last_login != 0) {
+        n = 0;
+        write_varint(payload, &n, player->last_login);
+        write_section(buffer, &pos, SAVE_TAG_LAST_LOGIN, payload, n);
+    }
     
-    /*
-     * Chat modes (1 byte packed):
-     *   Bits 0-1: Public chat (0=on, 1=friends, 2=off, 3=hide)
-     *   Bits 2-3: Private chat (0=on, 1=friends, 2=off)
-     *   Bits 4-5: Trade/compete (0=on, 1=friends, 2=off)
-     *   Bits 6-7: Reserved
-     * 
-     * Currently defaults to 0 (all chat modes on).
-     */
-    write_u8(buffer, &pos, 0);
+    /* Friend and ignore lists: already sorted, so saved as they are */
+    const SocialList* social = &player->social;
+    if (social->friend_count > 0) {
+        n = 0;
+        write_varint(payload, &n, social->friend_count);
+        for (u32 i = 0; i < social->friend_count; i++) write_varint(payload, &n, social->friends[i]);
+        write_section(buffer, &pos, SAVE_TAG_FRIENDS, payload, n);
+    }
+    if (social->ignore_count > 0) {
+        n = 0;
+        write_varint(payload, &n, social->ignore_count);
+        for (u32 i = 0; i < social->ignore_count; i++) write_varint(payload, &n, social->ignores[i]);
+        write_section(buffer, &pos, SAVE_TAG_IGNORES, payload, n);
+    }
     
-    /*
-     * Last login timestamp (8 bytes):
-     *   Unix timestamp in milliseconds since epoch (1970-01-01).
-     *   Used for tracking inactive accounts, showing "last seen" info.
-     *   Range: 0 to 2^64-1 (valid until year ~292,277,026,596)
-     */
-    write_u64(buffer, &pos, player->last_login);
+    write_varint(buffer, &pos, SAVE_TAG_END);
     
     /*
      * CRC32 integrity checksum (4 bytes):
@@ -758,17 +796,69 @@ bool player_save(const Player* player) {
     u32 checksum = crc32(buffer, pos);
     write_u32(buffer, &pos, checksum);
     
-    /*
-     * At this point:
-     *   - buffer[] contains complete serialized player data
-     *   - pos = total bytes written (~170 typical)
-     *   - Ready for atomic file write
-     */
+    return pos;
+}
+
+/*
+ * fsync_file - Flush a stdio file's descriptor to stable storage
+ */
+static int fsync_file(FILE* file) {
+#ifdef _WIN32
+    return _commit(_fileno(file));
+#else
+    return fsync(fileno(file));
+#endif
+}
+
+/*
+ * player_save_write - Atomically replace a save file with given bytes
+ *
+ * @param username  Save file owner
+ * @param data      Serialized save from player_save_serialize()
+ * @param size      Bytes in data
+ * @return          true on success, false on I/O error
+ *
+ * ATOMIC SAVE ALGORITHM:
+ *   1. Write buffer to temporary file (username.sav.tmp)
+ *   2. fflush() + fsync() so the bytes are on disk before the rename
+ *   3. Atomically rename temp file to final file (username.sav)
+ *   4. On failure, temp file is removed, old save remains intact
+ *
+ * This two-phase commit ensures save files are never corrupted by crashes
+ * or power failures during write operations. The rename() operation is
+ * atomic on both Unix and Windows filesystems.
+ *
+ * The save directory is only created when opening the temp file fails
+ * with ENOENT, so the steady state costs no mkdir() calls.
+ *
+ * Touches no Player state, so the save writer thread calls it directly.
+ *
+ * ERROR HANDLING:
+ *   - Directory creation failure → returns false
+ *   - File open failure → returns false
+ *   - Incomplete write or fsync failure → removes temp file, returns false
+ *   - Rename failure → removes temp file, returns false
+ */
+bool player_save_write(const char* username, const u8* data, size_t size) {
+    /* --save-log: one append to the shared log instead of tmp + rename */
+    if (g_save_log) {
+        if (!save_log_append(g_save_log, username, data, (u32)size)) {
+            LOG_ERROR("Failed to append save for '%s' to the save log\n", username);
+            return false;
+        }
+        LOG_INFO("Saved player '%s' (%zu bytes to save log)\n", username, size);
+        return true;
+    }
     
     /*
-     * PHASE 3: ATOMIC FILE WRITE
-     * Use two-phase commit to ensure save integrity.
+     * Generate file paths:
+     *   filepath:  data/players/Username.sav      (final destination)
+     *   temp_path: data/players/Username.sav.tmp  (temporary write target)
      */
+    char filepath[512];
+    char temp_path[512];
+    player_get_save_path(username, filepath, sizeof(filepath));
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", filepath);
     
     /*
      * Open temporary file for writing (binary mode).
@@ -781,8 +871,16 @@ bool player_save(const Player* player) {
      *   - Filesystem error
      */
     FILE* file = fopen(temp_path, "wb");
+    if (!file && errno == ENOENT) {
+        /* First save on this install: create the directory (mkdir -p) once */
+        if (!create_directory_recursive(PLAYER_SAVE_DIR)) {
+            LOG_ERROR("Failed to create save directory: %s\n", PLAYER_SAVE_DIR);
+            return false;
+        }
+        file = fopen(temp_path, "wb");
+    }
     if (!file) {
-        printf("Failed to open save file for writing: %s\n", temp_path);
+        LOG_ERROR("Failed to open save file for writing: %s\n", temp_path);
         return false;
     }
     
@@ -790,11 +888,20 @@ bool player_save(const Player* player) {
      * Write entire buffer to disk in one operation.
      * fwrite() returns number of bytes actually written.
      * 
-     * Buffered I/O: Data may still be in userspace buffer,
-     * not yet flushed to disk. fclose() will flush.
+     * Buffered I/O: Data may still be in userspace buffer
+     * until the fflush() below.
+     */
+    size_t written = fwrite(data, 1, size, file);
+    
+    /*
+     * fflush() moves the bytes to the kernel, fsync() to the disk. Without
+     * the fsync a crash shortly after rename() can leave an empty file
+     * under the final name on some filesystems.
      */
-    size_t written = fwrite(buffer, 1, pos, file);
-    fclose(file);  /* Implicit fflush() + close file descriptor */
+    if (fflush(file) != 0 || fsync_file(file) != 0) {
+        written = 0;
+    }
+    fclose(file);
     
     /*
      * Verify complete write: written must equal requested bytes.
@@ -803,18 +910,13 @@ bool player_save(const Player* player) {
      *   - I/O error
      *   - Signal interruption (EINTR)
      */
-    if (written != pos) {
-        printf("Failed to write complete save data (wrote %zu/%zu bytes)\n", 
-               written, pos);
+    if (written != size) {
+        LOG_ERROR("Failed to write complete save data (wrote %zu/%zu bytes)\n",
+                  written, size);
         remove(temp_path);  /* Delete corrupt temporary file */
         return false;
     }
     
-    /*
-     * PHASE 4: ATOMIC RENAME
-     * Replace old save with new save atomically.
-     */
-    
     /*
      * rename() is atomic on POSIX systems (Linux, macOS, BSD):
      *   - Either old file exists OR new file exists, never neither
@@ -842,8 +944,8 @@ bool player_save(const Player* player) {
      * On failure: Temp file remains, old save (if any) is intact
      */
     if (rename(temp_path, filepath) != 0) {
-        printf("Failed to rename save file: %s -> %s (errno=%d)\n", 
-               temp_path, filepath, errno);
+        LOG_ERROR("Failed to rename save file: %s -> %s (errno=%d)\n",
+                  temp_path, filepath, errno);
         remove(temp_path);  /* Cleanup failed temp file */
         return false;
     }
@@ -852,11 +954,204 @@ bool player_save(const Player* player) {
      * Success! Player data persisted to disk.
      * Log for debugging and audit trail.
      */
-    printf("Saved player '%s' (%zu bytes to %s)\n", 
-           player->username, pos, filepath);
+    LOG_INFO("Saved player '%s' (%zu bytes to %s)\n",
+             username, size, filepath);
     return true;
 }
 
+
+/*
+ * player_save - Save a player, in the background when possible
+ *
+ * @param player  Player structure to save
+ * @return        true if the save was queued or written, false on I/O error
+ *
+ * ALGORITHM:
+ *   1. Serialize into a stack buffer (the snapshot)
+ *   2. Hand the bytes to the save writer (save_queue.h), which coalesces
+ *      repeated saves of the same player; return immediately
+ *   3. If there is no writer, or its queue is full, write synchronously
+ *      with player_save_write()
+ *
+ * A queued save that later fails on disk is reported by the writer thread;
+ * the return value only covers what happened on this thread.
+ *
+ * COMPLEXITY: O(1) on the caller's thread when queued
+ *
+ * CROSS-REF:
+ *   - TypeScript: Player.save() in Player.ts
+ *   - Related: player_load() for deserialization
+ */
+/*
+ * save_player - player_save(), keeping the bytes for a relog if logout
+ */
+static bool save_player(const Player* player, bool logout) {
+    /* Replayed players are not real accounts (replay.h) */
+    if (g_replay.replaying) {
+        g_replay.saves++;
+        return true;
+    }
+    
+    u8 buffer[PLAYER_SAVE_MAX_SIZE];
+    size_t size = player_save_serialize(player, buffer);
+    
+    /* Before the queue: a login never finds the queue newer than the cache */
+    if (logout) save_cache_store(g_save_cache, player->username, buffer, (u32)size);
+    
+    if (save_queue_submit(g_save_queue, player->username, buffer, (u32)size)) {
+        return true;
+    }
+    bool ok = player_save_write(player->username, buffer, size);
+    save_log_sync(g_save_log);  /* No writer to batch the sync for us */
+    if (ok) account_registry_saved(g_account_registry, player->username, g_world_id);
+    return ok;
+}
+
+bool player_save(const Player* player) {
+    return save_player(player, false);
+}
+
+bool player_save_logout(const Player* player) {
+    return save_player(player, true);
+}
+
+/*
+ * SaveBatch - One player_save_all() call, shared by its threads
+ *
+ * Thread t saves players t, t + threads, t + 2 × threads, ... and writes
+ * only its own entries of ok[].
+ */
+typedef struct {
+    Player* const* players;
+    u32 count;
+    u32 threads;
+    bool* ok;
+} SaveBatch;
+
+typedef struct {
+    SaveBatch* batch;
+    u32 first;
+} SaveBatchWorker;
+
+/*
+ * save_batch_run - Serialize and write every threads-th player from first
+ */
+static void save_batch_run(SaveBatch* batch, u32 first) {
+    u8 buffer[PLAYER_SAVE_MAX_SIZE];
+    for (u32 i = first; i < batch->count; i += batch->threads) {
+        const Player* player = batch->players[i];
+        size_t size = player_save_serialize(player, buffer);
+        batch->ok[i] = player_save_write(player->username, buffer, size);
+    }
+}
+
+#ifndef _WIN32
+static void* save_batch_thread_main(void* arg) {
+    SaveBatchWorker* worker = (SaveBatchWorker*)arg;
+    save_batch_run(worker->batch, worker->first);
+    return NULL;
+}
+#endif
+
+/*
+ * player_save_all - Save many players at once, on several threads
+ *
+ * @param players  Players to save (read only; nothing may change them
+ *                 until this returns)
+ * @param count    Entries in players
+ * @return         Saves written
+ *
+ * ALGORITHM:
+ *   1. Start up to PLAYER_SAVE_BATCH_THREADS - 1 threads, one per
+ *      PLAYER_SAVE_BATCH_MIN players
+ *   2. Every thread, this one included, serializes its share into a
+ *      stack buffer and writes it with player_save_write()
+ *   3. Join, then one save_log_sync() for the whole batch and
+ *      account_registry_saved() for every save that reached the disk
+ *
+ * The save writer (save_queue.h) is bypassed: it has one thread and room
+ * for SAVE_QUEUE_CAPACITY jobs, so a full world would overflow it into
+ * one synchronous fsync after another on the caller's thread. Here the
+ * fsyncs overlap instead; with --save-log they become appends and a
+ * single sync. A save still queued for one of these players would be
+ * written after the batch and overwrite it with older bytes, so drain
+ * the writer first (save_queue_stop()).
+ *
+ * The writes wait on the disk rather than the CPU, so the thread count
+ * is not capped by the core count. If a thread cannot be started its
+ * share is saved by the caller.
+ *
+ * COMPLEXITY: O(count / threads) disk writes per thread
+ */
+u32 player_save_all(Player* const* players, u32 count) {
+    if (count == 0) return 0;
+    
+    /* Replayed players are not real accounts (replay.h) */
+    if (g_replay.replaying) {
+        g_replay.saves += count;
+        return count;
+    }
+    
+    bool* ok = (bool*)calloc(count, sizeof(bool));
+    if (!ok) {
+        /* No room for the batch: one at a time, as player_save() would */
+        u32 saved = 0;
+        for (u32 i = 0; i < count; i++) {
+            if (player_save(players[i])) saved++;
+        }
+        return saved;
+    }
+    
+    u32 threads = count / PLAYER_SAVE_BATCH_MIN + 1;
+    if (threads > PLAYER_SAVE_BATCH_THREADS) threads = PLAYER_SAVE_BATCH_THREADS;
+    SaveBatch batch = { players, count, threads, ok };
+    
+#ifndef _WIN32
+    SaveBatchWorker workers[PLAYER_SAVE_BATCH_THREADS];
+    pthread_t handles[PLAYER_SAVE_BATCH_THREADS];
+    bool started[PLAYER_SAVE_BATCH_THREADS] = { false };
+    
+    /* Signals stay on the game thread, as for the other pools */
+    sigset_t all, previous;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &previous);
+    for (u32 t = 1; t < threads; t++) {
+        workers[t].batch = &batch;
+        workers[t].first = t;
+        started[t] = pthread_create(&handles[t], NULL, save_batch_thread_main, &workers[t]) == 0;
+    }
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+    
+    save_batch_run(&batch, 0);
+    for (u32 t = 1; t < threads; t++) {
+        if (started[t]) {
+            pthread_join(handles[t], NULL);
+        } else {
+            save_batch_run(&batch, t);
+        }
+    }
+#else
+    for (u32 t = 0; t < threads; t++) {
+        save_batch_run(&batch, t);
+    }
+#endif
+    
+    /* One sync for every append of the batch (--save-log) */
+    save_log_sync(g_save_log);
+    
+    u32 saved = 0;
+    for (u32 i = 0; i < count; i++) {
+        if (ok[i]) {
+            account_registry_saved(g_account_registry, players[i]->username, g_world_id);
+            saved++;
+        } else {
+            LOG_WARN("WARNING: Failed to save player '%s'\n", players[i]->username);
+        }
+    }
+    free(ok);
+    return saved;
+}
+
 /*
  * player_load - Deserialize player data from disk with integrity checking
  *
@@ -868,7 +1163,7 @@ bool player_save(const Player* player) {
  *   2. If file doesn't exist → initialize as new player, return false
  *   3. Read entire file into memory buffer
  *   4. Verify magic number (0x2004)
- *   5. Check version number (must be ≤ 6)
+ *   5. Check version number (must be ≤ 7)
  *   6. Verify CRC32 checksum matches
  *   7. Deserialize all fields based on version
  *   8. Handle version migration (skip/default missing fields)
@@ -877,41 +1172,82 @@ bool player_save(const Player* player) {
  *   - Always backward-compatible: can load old saves
  *   - Fields missing in older versions get sensible defaults:
  *     * v1 → v2: playtime read as u16 instead of u32
- *     * v2 → v3: AFK zones default to empty
+ *     * v2 → v3: AFK zones default to empty; the u16 zone counter is
+ *       optional (files from before the writer emitted it lack it)
  *     * v3 → v4: Chat modes default to 0 (all on)
  *     * v4 → v5: Inventories default to empty
  *     * v5 → v6: Last login defaults to 0
+ *     * v7: tagged sections; any section not in the file keeps its
+ *       player_data_init() default
  *
  * INTEGRITY CHECKS:
  *   - Magic number mismatch → reject, initialize new player
  *   - Version too new → reject, initialize new player
  *   - CRC32 mismatch (corruption) → reject, initialize new player
- *   - File too small (<20 bytes) → reject, initialize new player
+ *   - File too small (<20 bytes, v7: <PLAYER_SAVE_MIN_SIZE) → reject,
+ *     initialize new player
+ *   - v7 section running past the end → reject, initialize new player
  *
  * SECURITY NOTES:
  *   - File size limited to 8KB to prevent DoS attacks
  *   - Username sanitization should be done by caller
  *   - No dynamic memory allocation (stack-only buffers)
  *
- * COMPLEXITY: O(1) - single file read + linear parse of ~170 bytes
+ * COMPLEXITY: O(1) - single file read + linear parse of at most ~230 bytes
  *
  * CROSS-REF:
  *   - TypeScript: Player.load() in Player.ts
  *   - Related: crc32() for integrity verification
  *   - Related: player_save() for serialization
  *   - Related: player_data_init() for new player defaults
+ *
+ * The two halves are separate functions so the login loader
+ * (load_queue.h) can do the file read on a worker thread and leave only
+ * the parse to the game thread:
+ *   player_load_read()    steps 1-3, touches no Player (thread-safe)
+ *   player_load_buffer()  steps 4-8
  */
 bool player_load(Player* player) {
+    u8 buffer[PLAYER_SAVE_MAX_SIZE];
+    u32 size;
+    
+    if (!player_load_read(player->username, buffer, sizeof(buffer), &size)) {
+        player_data_init(player);
+        return false;
+    }
+    return player_load_buffer(player, buffer, size);
+}
+
+/*
+ * player_load_read - Steps 1-3 of player_load(): fetch the save bytes
+ *
+ * Checks the save writer first, so a logout followed by an immediate
+ * login reads the bytes that have not reached the disk yet.
+ */
+bool player_load_read(const char* username, u8* buffer, u32 capacity, u32* size) {
     char filepath[512];
-    player_get_save_path(player->username, filepath, sizeof(filepath));
+    player_get_save_path(username, filepath, sizeof(filepath));
     
-    // printf("Loading player data: username='%s', filepath='%s'\n", player->username, filepath);
+    /* A relog right after logout: the logout save, from memory (save_cache.h) */
+    if (save_cache_take(g_save_cache, username, buffer, capacity, size)) {
+        LOG_TRACE(LOG_LOGIN, "Save for '%s' served from the save cache\n", username);
+        return true;
+    }
+    
+    /* A save still waiting for the writer is newer than the file on disk */
+    if (save_queue_lookup(g_save_queue, username, buffer, capacity, size)) {
+        return true;
+    }
+    
+    /* --save-log: the log has the newest save; .sav files are from before */
+    if (save_log_read(g_save_log, username, buffer, capacity, size)) {
+        return true;
+    }
     
     /* Check if save file exists */
     FILE* file = fopen(filepath, "rb");
     if (!file) {
-        printf("No save file found for '%s', creating new player\n", player->username);
-        player_data_init(player);
+        LOG_INFO("No save file found for '%s', creating new player\n", username);
         return false;  /* New player */
     }
     
@@ -920,20 +1256,148 @@ bool player_load(Player* player) {
     long file_size = ftell(file);
     fseek(file, 0, SEEK_SET);
     
-    if (file_size < 20) {
-        printf("Save file too small for '%s', creating new player\n", player->username);
+    if (file_size < PLAYER_SAVE_MIN_SIZE) {
+        LOG_WARN("Save file too small for '%s', creating new player\n", username);
+        fclose(file);
+        return false;
+    }
+    
+    /* Larger than any save we write: corrupt, and would overflow buffer */
+    if (file_size > (long)capacity) {
+        LOG_WARN("Save file too large for '%s', creating new player\n", username);
         fclose(file);
-        player_data_init(player);
         return false;
     }
     
     /* Read entire file */
-    u8 buffer[8192];
     size_t read_size = fread(buffer, 1, file_size, file);
     fclose(file);
     
     if (read_size != (size_t)file_size) {
-        printf("Failed to read complete save file for '%s'\n", player->username);
+        LOG_WARN("Failed to read complete save file for '%s'\n", username);
+        return false;
+    }
+    
+    *size = (u32)file_size;
+    return true;
+}
+
+/*
+ * load_sections - Parse version 7's tagged sections over the defaults
+ *
+ * @param player  Player to load into (reset to player_data_init() first)
+ * @param buffer  Save bytes
+ * @param pos     Offset of the first section (after the header)
+ * @param end     Offset of the CRC32 footer
+ * @return        false if a tag, length or field runs past its end
+ *
+ * Every read is bounded by its section, and every section by end: a
+ * section is parsed only as far as this version knows it, then skipped
+ * to by its length, so unknown tags and longer future sections cost
+ * nothing.
+ */
+static bool load_sections(Player* player, const u8* buffer, size_t pos, size_t end) {
+    player_data_init(player);
+    
+    for (;;) {
+        u64 tag, length;
+        if (!read_varint(buffer, end, &pos, &tag)) return false;
+        if (tag == SAVE_TAG_END) return true;
+        if (!read_varint(buffer, end, &pos, &length) || length > end - pos) return false;
+        
+        size_t section_end = pos + (size_t)length;
+        size_t at = pos;
+        u64 a, b;
+        u8 byte;
+        
+        switch (tag) {
+        case SAVE_TAG_POSITION:
+            if (!read_varint(buffer, section_end, &at, &a) ||
+                !read_varint(buffer, section_end, &at, &b) ||
+                !read_byte(buffer, section_end, &at, &byte)) return false;
+            position_init(&player->position, (u16)a, (u16)b, byte);
+            break;
+            
+        case SAVE_TAG_LOOK:
+            if (length < 14) return false;
+            player->design_complete = (buffer[at++] == 1);
+            player->gender = buffer[at++];
+            for (int i = 0; i < 7; i++) {
+                u8 body_value = buffer[at++];
+                player->body[i] = (body_value == 255) ? -1 : (i8)body_value;
+            }
+            for (int i = 0; i < 5; i++) {
+                player->colors[i] = buffer[at++];
+            }
+            break;
+            
+        case SAVE_TAG_RUN_ENERGY:
+            if (!read_varint(buffer, section_end, &at, &a)) return false;
+            player->runenergy = (u16)a;
+            break;
+            
+        case SAVE_TAG_PLAYTIME:
+            if (!read_varint(buffer, section_end, &at, &a)) return false;
+            player->playtime = (u32)a;
+            break;
+            
+        case SAVE_TAG_SKILLS: {
+            u64 changed;
+            if (!read_varint(buffer, section_end, &at, &changed)) return false;
+            for (u32 skill = 0; changed != 0; skill++, changed >>= 1) {
+                if (!(changed & 1)) continue;
+                if (!read_varint(buffer, section_end, &at, &a) ||
+                    !read_byte(buffer, section_end, &at, &byte)) return false;
+                if (skill < SKILL_COUNT) {  /* Skills this server lacks are dropped */
+                    player->experience[skill] = (u32)a;
+                    player->levels[skill] = byte;
+                }
+            }
+            break;
+        }
+            
+        case SAVE_TAG_LAST_LOGIN:
+            if (!read_varint(buffer, section_end, &at, &a)) return false;
+            player->last_login = a;
+            break;
+            
+        case SAVE_TAG_FRIENDS:
+        case SAVE_TAG_IGNORES: {
+            /* Re-inserted one by one: order, duplicates and size are checked */
+            SocialList* social = &player->social;
+            if (!read_varint(buffer, section_end, &at, &b)) return false;
+            for (u64 i = 0; i < b; i++) {
+                if (!read_varint(buffer, section_end, &at, &a)) return false;
+                if (tag == SAVE_TAG_FRIENDS) {
+                    social_list_add_friend(social, a);
+                } else {
+                    social_list_add_ignore(social, a);
+                }
+            }
+            break;
+        }
+            
+        default:
+            break;  /* Unknown tag: skipped by its length */
+        }
+        pos = section_end;
+    }
+}
+
+/*
+ * player_load_buffer - Deserialize save bytes into a player
+ *
+ * @param player  Player structure to populate
+ * @param buffer  Bytes from player_load_read()
+ * @param size    Bytes in buffer (>= 20)
+ * @return        true if loaded, false if the bytes were rejected (the
+ *                player is then initialized as new)
+ *
+ * Integrity checks and version migration as described for player_load().
+ */
+bool player_load_buffer(Player* player, const u8* buffer, u32 size) {
+    long file_size = (long)size;
+    if (!buffer || size < PLAYER_SAVE_MIN_SIZE) {
         player_data_init(player);
         return false;
     }
@@ -943,7 +1407,7 @@ bool player_load(Player* player) {
     /* Verify magic number */
     u16 magic = read_u16(buffer, &pos);
     if (magic != PLAYER_SAVE_MAGIC) {
-        printf("Invalid save file magic for '%s': 0x%04X\n", player->username, magic);
+        LOG_WARN("Invalid save file magic for '%s': 0x%04X\n", player->username, magic);
         player_data_init(player);
         return false;
     }
@@ -951,8 +1415,8 @@ bool player_load(Player* player) {
     /* Read version */
     u16 version = read_u16(buffer, &pos);
     if (version > PLAYER_SAVE_VERSION) {
-        printf("Save file version too new for '%s': %u > %u\n", 
-               player->username, version, PLAYER_SAVE_VERSION);
+        LOG_WARN("Save file version too new for '%s': %u > %u\n",
+                 player->username, version, PLAYER_SAVE_VERSION);
         player_data_init(player);
         return false;
     }
@@ -963,7 +1427,26 @@ bool player_load(Player* player) {
     u32 calculated_crc = crc32(buffer, file_size - 4);
     
     if (stored_crc != calculated_crc) {
-        printf("Save file corrupted for '%s' (CRC mismatch)\n", player->username);
+        LOG_WARN("Save file corrupted for '%s' (CRC mismatch)\n", player->username);
+        player_data_init(player);
+        return false;
+    }
+    
+    /* Version 7: tagged sections, each read bounded by its length */
+    if (version >= 7) {
+        if (!load_sections(player, buffer, pos, (size_t)(file_size - 4))) {
+            LOG_WARN("Save file corrupted for '%s' (bad section)\n", player->username);
+            player_data_init(player);
+            return false;
+        }
+        LOG_INFO("Loaded player '%s' (version %u, %ld bytes)\n",
+                 player->username, version, file_size);
+        return true;
+    }
+    
+    /* Versions 1-6: fixed-width fields, never shorter than 20 bytes */
+    if (file_size < 20) {
+        LOG_WARN("Save file too small for '%s', creating new player\n", player->username);
         player_data_init(player);
         return false;
     }
@@ -973,9 +1456,7 @@ bool player_load(Player* player) {
     u16 z = read_u16(buffer, &pos);
     u8 height = read_u8(buffer, &pos);
     
-    player->position.x = x;
-    player->position.z = z;
-    player->position.height = height;
+    position_init(&player->position, x, z, height);
     
     /* Read appearance */
     for (int i = 0; i < 7; i++) {
@@ -1036,7 +1517,16 @@ bool player_load(Player* player) {
         for (u8 i = 0; i < afk_count; i++) {
             read_u32(buffer, &pos);  /* Skip packed coord */
         }
-        read_u16(buffer, &pos);  /* Skip last afk zone counter */
+        /*
+         * Skip last afk zone counter. The fixed-width writer left it out
+         * until the format fix that came with the save benchmarks, so
+         * older version 3-6 files go straight on to chat modes; the two
+         * cases differ only in the bytes left before the CRC.
+         */
+        size_t tail = (version >= 4 ? 1 : 0) + (version >= 6 ? 8 : 0);
+        if ((size_t)(file_size - 4) >= pos + tail + 2) {
+            read_u16(buffer, &pos);
+        }
     }
     
     /* Read chat modes (added in version 4) */
@@ -1051,7 +1541,7 @@ bool player_load(Player* player) {
         player->last_login = 0;
     }
     
-    printf("Loaded player '%s' (version %u, %ld bytes)\n", 
-           player->username, version, file_size);
+    LOG_INFO("Loaded player '%s' (version %u, %ld bytes)\n",
+             player->username, version, file_size);
     return true;  /* Existing player loaded */
 }
@@ -4,7 +4,18 @@
  * 
  * Implements binary save/load format compatible with TypeScript server.
  * 
- * SAVE FILE FORMAT (Version 6):
+ * SAVE FILE FORMAT (Version 7, written):
+ * 
+ *   Header (4 bytes): uint16_t magic = 0x2004, uint16_t version = 7
+ *   Sections: [tag varint][length varint][payload], until tag 0
+ *     1 position, 2 look, 3 run energy, 4 playtime, 5 skills,
+ *     6 last login, 7 friends, 8 ignores; sections equal to the
+ *     defaults are left out
+ *   Footer (4 bytes): uint32_t crc32
+ * 
+ *   Details in player_save.c. A new player's save is 16 bytes.
+ * 
+ * SAVE FILE FORMAT (Version 6, still read):
  * 
  *   Header (4 bytes):
  *     uint16_t magic    = 0x2004
@@ -47,8 +58,14 @@
 
 /* Save file constants */
 #define PLAYER_SAVE_MAGIC   0x2004    /* Magic number identifier */
-#define PLAYER_SAVE_VERSION 6         /* Current save format version */
+#define PLAYER_SAVE_VERSION 7         /* Current save format version */
 #define PLAYER_SAVE_DIR     "data/players/default"
+#define PLAYER_SAVE_MAX_SIZE 8192     /* Largest save file accepted or written */
+#define PLAYER_SAVE_MIN_SIZE 9        /* Header, end tag and CRC32 (version 7) */
+
+/* player_save_all(): most threads, and players per extra thread */
+#define PLAYER_SAVE_BATCH_THREADS 8
+#define PLAYER_SAVE_BATCH_MIN 32
 
 /* Skill constants */
 #define SKILL_COUNT 21
@@ -113,13 +130,60 @@ typedef struct {
  * player_save - Save player data to disk
  * 
  * @param player  Player to save
- * @return        true on success, false on error
+ * @return        true on success (queued or written), false on error
  * 
  * Creates/overwrites save file at: data/players/default/{username}.sav
- * Uses atomic save (writes to .tmp file, then renames)
+ * Uses atomic save (writes to .tmp file, then renames). When the save
+ * writer is running (save_queue.h) only serialization happens on the
+ * caller's thread and the write is done in the background.
  */
 bool player_save(const Player* player);
 
+/*
+ * player_save_logout - player_save() for a player who is logging out
+ * 
+ * @param player  Player leaving the world
+ * @return        As player_save()
+ * 
+ * Also keeps the bytes in memory for a quick relog (save_cache.h).
+ */
+bool player_save_logout(const Player* player);
+
+/*
+ * player_save_all - Save a batch of players in parallel
+ * 
+ * @param players  Players to save, unchanged until this returns
+ * @param count    Number of players
+ * @return         Saves written
+ * 
+ * Serializes and writes on up to PLAYER_SAVE_BATCH_THREADS threads,
+ * bypassing the save writer, then syncs the save log once. Meant for
+ * server_shutdown(); stop the save writer first so no older queued save
+ * lands after the batch.
+ */
+u32 player_save_all(Player* const* players, u32 count);
+
+/*
+ * player_save_serialize - Encode a player in the current save format
+ * 
+ * @param player  Player to encode
+ * @param buffer  Output, at least PLAYER_SAVE_MAX_SIZE bytes
+ * @return        Bytes written, CRC32 footer included
+ */
+size_t player_save_serialize(const Player* player, u8* buffer);
+
+/*
+ * player_save_write - Atomically write serialized bytes as a save file
+ * 
+ * @param username  Save file owner
+ * @param data      Output of player_save_serialize()
+ * @param size      Bytes in data
+ * @return          true on success, false on I/O error
+ * 
+ * tmp file → fsync → rename. Thread-safe: touches no Player.
+ */
+bool player_save_write(const char* username, const u8* data, size_t size);
+
 /*
  * player_load - Load player data from disk
  * 
@@ -131,6 +195,32 @@ bool player_save(const Player* player);
  */
 bool player_load(Player* player);
 
+/*
+ * player_load_read - Fetch a player's save bytes without touching a Player
+ * 
+ * @param username  Save file owner
+ * @param buffer    Receives the bytes
+ * @param capacity  Size of buffer (PLAYER_SAVE_MAX_SIZE)
+ * @param size      Receives the byte count
+ * @return          true if a save was found; false means "new player"
+ * 
+ * A logout save kept in memory first (save_cache_take), then the newest
+ * queued save (save_queue_lookup), the save log, then the file.
+ * Thread-safe: used by the login loader thread (load_queue.h).
+ */
+bool player_load_read(const char* username, u8* buffer, u32 capacity, u32* size);
+
+/*
+ * player_load_buffer - Deserialize bytes from player_load_read()
+ * 
+ * @param player  Player to load data into
+ * @param buffer  Save bytes (NULL-safe: initializes a new player)
+ * @param size    Bytes in buffer
+ * @return        true if loaded, false if rejected (player initialized
+ *                with defaults, as for a missing file)
+ */
+bool player_load_buffer(Player* player, const u8* buffer, u32 size);
+
 /*
  * player_data_init - Initialize player data with defaults
  * 
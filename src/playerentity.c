@@ -299,7 +299,7 @@ Model *playerentity_get_sequencedmodel(PlayerEntity *entity) {
 
         model_create_label_references(model, true);
         model_calculate_normals(model, 64, 850, -30, -50, -30, true, true);
-        lrucache_put(_PlayerEntity.modelCache, hashCode, &model->link);
+        lrucache_put_sized(_PlayerEntity.modelCache, hashCode, &model->link, model_size(model));
     }
 
     if (entity->lowmem) {
@@ -310,7 +310,7 @@ Model *playerentity_get_sequencedmodel(PlayerEntity *entity) {
     if (primaryTransformId != -1 && secondaryTransformId != -1) {
         model_apply_transforms(tmp, primaryTransformId, secondaryTransformId, _SeqType.instances[entity->pathing_entity.primarySeqId]->walkmerge);
     } else if (primaryTransformId != -1) {
-        model_apply_transform(tmp, primaryTransformId);
+        model_apply_transform_cached(tmp, MODEL_FRAME_PLAYER, hashCode, primaryTransformId, false);
     }
 
     model_calculate_bounds_cylinder(tmp);
@@ -75,369 +75,15 @@
 #include <stdlib.h>
 
 /*******************************************************************************
- * POSITION LIFECYCLE
- ******************************************************************************/
-
-/*
- * position_init - Initialize position with absolute coordinates
- * 
- * @param pos     Position structure to initialize
- * @param x       East/West coordinate (0-16383)
- * @param z       North/South coordinate (0-16383)
- * @param height  Plane level (0-3)
- * 
- * MEMORY LAYOUT AFTER INITIALIZATION:
- *   ┌────────────┬────────────┬────────────┐
- *   │   x=3232   │   z=3232   │  height=0  │  12 bytes total
- *   └────────────┴────────────┴────────────┘
- * 
- * COORDINATE VALIDATION:
- *   This function does NOT validate coordinates!
- *   Caller should ensure:
- *     - x < 16384 (14-bit limit)
- *     - z < 16384 (14-bit limit)
- *     - height <= 3 (2-bit limit)
- * 
- * EXAMPLE USAGE:
- *   Position lumbridge_castle;
- *   position_init(&lumbridge_castle, 3222, 3218, 0);
- * 
- *   Position varrock_square;
- *   position_init(&varrock_square, 3212, 3424, 0);
- * 
- * COMPLEXITY: O(1) time, O(1) space (stack allocation)
- */
-void position_init(Position* pos, u32 x, u32 z, u32 height) {
-    /* Direct field assignment (no validation) */
-    pos->x = x;
-    pos->z = z;
-    pos->height = height;
-}
-
-/*******************************************************************************
- * POSITION MOVEMENT
- ******************************************************************************/
-
-/*
- * position_move - Apply relative movement to position
- * 
- * @param pos  Position to modify (in-place)
- * @param dx   X displacement (negative=west, positive=east)
- * @param dz   Z displacement (negative=south, positive=north)
- * 
- * ALGORITHM:
- *   Simple vector addition:
- *     new_x = old_x + dx
- *     new_z = old_z + dz
- * 
- * MOVEMENT VECTOR DIAGRAM:
- * 
- *   Before:                After:
- *   ┌─────────────┐        ┌─────────────┐
- *   │             │        │       * NEW │  NEW = (x+dx, z+dz)
- *   │             │        │      ↗      │
- *   │      * OLD  │        │  ↗          │  Vector: (dx, dz)
- *   │   (x, z)    │        │ * OLD       │
- *   └─────────────┘        └─────────────┘
- * 
- * EXAMPLE:
- *   Position pos;
- *   position_init(&pos, 3200, 3200, 0);
- * 
- *   // Move 5 tiles east, 3 tiles south
- *   position_move(&pos, 5, -3);
- * 
- *   // Result: pos.x = 3205, pos.z = 3197
- * 
- * DIRECTION MOVEMENT EXAMPLE:
- *   // Move one tile in direction DIR_NE (northeast)
- *   int dir = DIR_NE;
- *   int dx = DIRECTION_DELTA_X[dir];  // +1
- *   int dz = DIRECTION_DELTA_Z[dir];  // +1
- *   position_move(&pos, dx, dz);
- * 
- * SIGNED ARITHMETIC:
- *   dx and dz are signed (i32) to allow negative movement
- *   pos->x and pos->z are unsigned (u32)
- *   C automatically handles signed→unsigned conversion
- * 
- * OVERFLOW BEHAVIOR:
- *   If x + dx < 0, result wraps to large positive (undefined behavior)
- *   If x + dx > 16383, result may exceed valid map bounds
- *   Caller should validate before calling or after returning
- * 
- * COLLISION DETECTION:
- *   This function does NOT check:
- *     - Map boundaries
- *     - Walkable tiles
- *     - Object collisions
- *   These checks must be done separately in game logic
- * 
- * COMPLEXITY: O(1) time
- */
-void position_move(Position* pos, i32 dx, i32 dz) {
-    /* Apply displacement using signed addition */
-    pos->x += dx;  /* Implicit signed→unsigned conversion */
-    pos->z += dz;
-}
-
-/*******************************************************************************
- * COORDINATE TRANSFORMATIONS - Region Calculation
- ******************************************************************************/
-
-/*
- * position_get_region_x - Convert absolute X to region X coordinate
- * 
- * @param pos  Position with absolute coordinates
- * @return     Region X coordinate
- * 
- * ALGORITHM:
- *   region_x = (absolute_x >> 3) - 6
- * 
- * BREAKDOWN:
- *   Step 1: Divide by 8 using right shift
- *     absolute_x >> 3  ≡  floor(absolute_x / 8)
- * 
- *   Step 2: Subtract offset
- *     The -6 accounts for RuneScape's map origin offset
- *     (historical artifact from original game design)
- * 
- * BIT-LEVEL EXAMPLE:
- *   Input: absolute_x = 3232
- * 
- *   Binary representation:
- *     3232 = 0b110010100000  (12 bits)
- * 
- *   Right shift by 3:
- *     3232 >> 3 = 0b110010100 = 404
- * 
- *   Subtract offset:
- *     404 - 6 = 398
- * 
- *   Result: region_x = 398
- * 
- * REGION BOUNDARY CALCULATION:
- *   Each region covers 64 tiles (8 chunks × 8 tiles/chunk)
- * 
- *   Region 398 boundaries:
- *     Min X: 398 << 3 = 3184
- *     Max X: 3184 + 63 = 3247
- * 
- *   Therefore position 3232 is in region 398 ✓
- * 
- * WHY BIT SHIFT INSTEAD OF DIVISION?
- * 
- *   Performance comparison (typical x86-64):
- *     Division:   20-40 CPU cycles
- *     Bit shift:  1 CPU cycle
- * 
- *   Assembly comparison:
- *     Division:  MOV EAX, x
- *                MOV ECX, 8
- *                DIV ECX         ; slow operation
- * 
- *     Bit shift: MOV EAX, x
- *                SHR EAX, 3      ; single instruction
- * 
- * REGION SIZE DIAGRAM:
- * 
- *   ┌────────────────────────────────────────────┐
- *   │  Region 398 (64 tiles × 64 tiles)          │
- *   │  ┌──────────────────────────────────────┐  │
- *   │  │  Absolute coordinates:               │  │
- *   │  │    Min: (3184, 3184)                 │  │
- *   │  │    Max: (3247, 3247)                 │  │
- *   │  │                                      │  │
- *   │  │         * (3232, 3232)               │  │
- *   │  │      (example position)              │  │
- *   │  └──────────────────────────────────────┘  │
- *   └────────────────────────────────────────────┘
- * 
- * COMPLEXITY: O(1) time (single shift and subtract)
- */
-u32 position_get_zone_x(const Position* pos) {
-    return pos->x >> 3;
-}
-
-u32 position_get_zone_center_x(const Position* pos) {
-    return (pos->x >> 3) - 6;
-}
-
-u32 position_get_mapsquare_x(const Position* pos) {
-    return pos->x >> 6;
-}
-
-/*
- * position_get_region_z - Convert absolute Z to region Z coordinate
- * 
- * @param pos  Position with absolute coordinates
- * @return     Region Z coordinate
- * 
- * ALGORITHM: Same as position_get_region_x but for Z axis
- *   region_z = (absolute_z >> 3) - 6
- * 
- * EXAMPLE:
- *   Input: absolute_z = 3200
- * 
- *   Step 1: 3200 >> 3
- *     Binary: 0b110010000000 >> 3 = 0b110010000 = 400
- * 
- *   Step 2: 400 - 6 = 394
- * 
- *   Result: region_z = 394
- * 
- * REGION COVERAGE:
- *   Region 394 Z boundaries:
- *     Min Z: 394 << 3 = 3152
- *     Max Z: 3152 + 63 = 3215
+ * POSITION ACCESSORS
+ *******************************************************************************
  * 
- *   Position 3200 is in region 394 ✓
+ * position_init(), position_move() and the zone, mapsquare and local
+ * coordinate getters are static inline in position.h: each is a shift and
+ * a mask of Position.packed, cheaper inlined than called.
  * 
- * COMPLEXITY: O(1) time
- */
-u32 position_get_zone_z(const Position* pos) {
-    return pos->z >> 3;
-}
-
-u32 position_get_zone_center_z(const Position* pos) {
-    return (pos->z >> 3) - 6;
-}
-
-u32 position_get_mapsquare_z(const Position* pos) {
-    return pos->z >> 6;
-}
-
-/*******************************************************************************
- * COORDINATE TRANSFORMATIONS - Local Coordinates
  ******************************************************************************/
 
-/*
- * position_get_local_x - Get local X coordinate relative to base position
- * 
- * @param pos   Position to convert (e.g., NPC location)
- * @param base  Base position (e.g., player location)
- * @return      Local X offset relative to base's region
- * 
- * ALGORITHM:
- *   1. Calculate base's region:    region = (base->x >> 3) - 6
- *   2. Convert region to absolute: region_base = region << 3
- *   3. Calculate offset:           local = pos->x - region_base
- * 
- * STEP-BY-STEP EXAMPLE:
- *   Player position (base):  (3232, 3232)
- *   NPC position (pos):      (3240, 3235)
- * 
- *   Step 1: Calculate base's region X
- *     region_x = (3232 >> 3) - 6
- *     region_x = 404 - 6
- *     region_x = 398
- * 
- *   Step 2: Convert region back to absolute base
- *     region_base_x = 398 << 3
- *     region_base_x = 3184
- * 
- *   Step 3: Calculate local offset
- *     local_x = 3240 - 3184
- *     local_x = 56
- * 
- *   Result: NPC is at local X = 56 (within 0-63 range)
- * 
- * VISUAL DIAGRAM:
- * 
- *   ┌─────────────────────────────────────────────────┐
- *   │  Region 398 (base at 3184)                      │
- *   │  ┌───────────────────────────────────────────┐  │
- *   │  │ 0                                      63 │  │ Local X
- *   │  │ ├────────────────────────────────────────┤│  │
- *   │  │                                           │  │
- *   │  │           @ Player (local X = 48)         │  │
- *   │  │           (absolute X = 3232)             │  │
- *   │  │                                           │  │
- *   │  │                     * NPC (local X = 56)  │  │
- *   │  │                     (absolute X = 3240)   │  │
- *   │  └───────────────────────────────────────────┘  │
- *   │  3184                                    3247   │ Absolute X
- *   └─────────────────────────────────────────────────┘
- * 
- * NETWORK PROTOCOL OPTIMIZATION:
- * 
- *   Without local coordinates:
- *     Send absolute X: 3240 (requires 14 bits)
- * 
- *   With local coordinates:
- *     Send local X: 56 (requires 6 bits)
- * 
- *   Bandwidth savings: 14 - 6 = 8 bits per coordinate
- *   For 100 NPCs: 100 × 2 coords × 8 bits = 1600 bits = 200 bytes saved!
- * 
- * CROSS-REGION ENTITIES:
- *   If NPC is in different region than player:
- *     local_x may be < 0 or > 63
- *   Protocol handles this by:
- *     - Sending full absolute coordinates, OR
- *     - Using extended local coordinate format
- * 
- * BIT MANIPULATION BREAKDOWN:
- * 
- *   region_x calculation:
- *     (base->x >> 3) - 6
- *     = (3232 >> 3) - 6
- *     = 404 - 6
- *     = 398
- * 
- *   Region base calculation:
- *     region_x << 3
- *     = 398 << 3
- *     = 398 × 8
- *     = 3184
- * 
- *   Local offset:
- *     pos->x - region_base
- *     = 3240 - 3184
- *     = 56
- * 
- * COMPLEXITY: O(1) time (3 arithmetic operations)
- */
-u32 position_get_local_x(const Position* pos, const Position* base) {
-    return pos->x - (position_get_zone_center_x(base) << 3);
-}
-
-/*
- * position_get_local_z - Get local Z coordinate relative to base position
- * 
- * @param pos   Position to convert (e.g., NPC location)
- * @param base  Base position (e.g., player location)
- * @return      Local Z offset relative to base's region
- * 
- * ALGORITHM: Same as position_get_local_x but for Z axis
- *   1. region_z = (base->z >> 3) - 6
- *   2. region_base_z = region_z << 3
- *   3. local_z = pos->z - region_base_z
- * 
- * EXAMPLE:
- *   Player position (base):  (3232, 3232)
- *   NPC position (pos):      (3240, 3235)
- * 
- *   Step 1: region_z = (3232 >> 3) - 6 = 398
- *   Step 2: region_base_z = 398 << 3 = 3184
- *   Step 3: local_z = 3235 - 3184 = 51
- * 
- *   Result: NPC is at local Z = 51
- * 
- * COORDINATE PAIR:
- *   From previous examples:
- *     local_x = 56
- *     local_z = 51
- * 
- *   NPC is at (56, 51) in local coordinate space
- *   Relative to region base at (3184, 3184)
- * 
- * COMPLEXITY: O(1) time
- */
-u32 position_get_local_z(const Position* pos, const Position* base) {
-    return pos->z - (position_get_zone_center_z(base) << 3);
-}
-
 /*******************************************************************************
  * DIRECTION ENCODING
  ******************************************************************************/
@@ -578,8 +224,8 @@ i32 position_direction(i32 dx, i32 dz) {
  * @return       true if pos is visible from other, false otherwise
  * 
  * ALGORITHM: Rectangular bounds check (Manhattan distance)
- *   1. Calculate deltas: dx = other->x - pos->x
- *                        dz = other->z - pos->z
+ *   1. Calculate deltas: dx = x(other) - x(pos)
+ *                        dz = z(other) - z(pos)
  *   2. Check bounds:     -15 ≤ dx ≤ 14  AND  -15 ≤ dz ≤ 14
  * 
  * VIEWPORT DIMENSIONS:
@@ -718,13 +364,62 @@ i32 position_direction(i32 dx, i32 dz) {
  */
 bool position_is_viewable_from(const Position* pos, const Position* other) {
     /* Calculate displacement from pos to other */
-    i32 dx = other->x - pos->x;
-    i32 dz = other->z - pos->z;
+    i32 dx = (i32)position_x(other) - (i32)position_x(pos);
+    i32 dz = (i32)position_z(other) - (i32)position_z(pos);
     
     /* Check if displacement is within viewport rectangle */
     return dx <= 14 && dx >= -15 && dz <= 14 && dz >= -15;
 }
 
+/*
+ * view_lanes - One mask word: 64 candidates tested side by side
+ * 
+ * Each lane is the whole test with unsigned wrap-around doing both
+ * bounds: x - vx + r lands in [0, 2r] exactly when |x - vx| <= r, and
+ * anything left of the window wraps to a huge value. The loop has a
+ * fixed count and no branches, so gcc turns it into vector compares and
+ * ands (16 lanes per SSE2 step for the bytes written).
+ */
+static u64 view_lanes(const u32* restrict coords, u32 vx, u32 vz, u32 level, u32 radius) {
+    u8 hit[POSITION_VIEW_LANES];
+    u32 span = radius * 2;
+    for (u32 i = 0; i < POSITION_VIEW_LANES; i++) {
+        u32 c = coords[i];
+        u32 dx = ((c >> 14) & 0x3fff) - vx + radius;
+        u32 dz = (c & 0x3fff) - vz + radius;
+        hit[i] = (u8)((dx <= span) & (dz <= span) & ((c >> 28) == level));
+    }
+    
+    /* Eight 0/1 bytes to eight bits with one multiply: byte j lands in
+     * bit 56 + j of the product (the partial sums never carry) */
+    u64 word = 0;
+    for (u32 k = 0; k < POSITION_VIEW_LANES / 8; k++) {
+        u64 bytes = 0;
+        for (u32 j = 0; j < 8; j++) {
+            bytes |= (u64)hit[k * 8 + j] << (j * 8);
+        }
+        word |= ((bytes * 0x0102040810204080ull) >> 56) << (k * 8);
+    }
+    return word;
+}
+
+u32 position_view_mask(const Position* viewer, u32* coords, u32 count, u32 radius, u64* mask) {
+    u32 padded = POSITION_VIEW_ROUND(count);
+    for (u32 i = count; i < padded; i++) {
+        coords[i] = POSITION_VIEW_HIDDEN;
+    }
+    
+    u32 vx = position_x(viewer);
+    u32 vz = position_z(viewer);
+    u32 level = position_height(viewer);
+    u32 visible = 0;
+    for (u32 w = 0; w < padded / POSITION_VIEW_LANES; w++) {
+        mask[w] = view_lanes(coords + w * POSITION_VIEW_LANES, vx, vz, level, radius);
+        visible += (u32)__builtin_popcountll(mask[w]);
+    }
+    return visible;
+}
+
 /*******************************************************************************
  * POINT FUNCTIONS - Pathfinding Support
  ******************************************************************************/
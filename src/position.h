@@ -168,12 +168,11 @@
  * 
  * MEMORY LAYOUT:
  * 
- *   Position Structure (12 bytes on 32-bit, 12 bytes on 64-bit):
- *   ┌────────────┬────────────┬────────────┐
- *   │     x      │     z      │   height   │
- *   │  (4 bytes) │  (4 bytes) │  (4 bytes) │
- *   └────────────┴────────────┴────────────┘
- *     u32 (0-16383) u32 (0-16383) u32 (0-3)
+ *   Position Structure (4 bytes, coord_pack layout):
+ *   ┌─────────┬─────────┬─────────┬─────────┐
+ *   │  31-30  │  29-28  │  27-14  │  13-0   │
+ *   │ unused  │ height  │    x    │    z    │
+ *   └─────────┴─────────┴─────────┴─────────┘
  * 
  *   Point Structure (12 bytes on 32-bit, 16 bytes on 64-bit):
  *   ┌────────────┬────────────┬────────────┐
@@ -188,23 +187,27 @@
  *      Position pos;
  *      position_init(&pos, 3232, 3232, 0);
  * 
- *   2. Move by delta:
+ *   2. Read and compare:
+ *      u32 x = position_x(&pos);
+ *      bool same = position_equals(&pos, &other_pos);
+ * 
+ *   3. Move by delta:
  *      position_move(&pos, 5, -3);  // Move 5 east, 3 south
  * 
- *   3. Get region coordinates:
+ *   4. Get region coordinates:
  *      u32 region_x = position_get_region_x(&pos);
  *      u32 region_z = position_get_region_z(&pos);
  * 
- *   4. Get local coordinates (relative to base):
+ *   5. Get local coordinates (relative to base):
  *      Position base;
  *      position_init(&base, 3200, 3200, 0);
  *      u32 local_x = position_get_local_x(&pos, &base);
  *      u32 local_z = position_get_local_z(&pos, &base);
  * 
- *   5. Calculate direction from deltas:
+ *   6. Calculate direction from deltas:
  *      i32 dir = position_direction(1, 1);  // Returns DIR_NE (2)
  * 
- *   6. Check if position is visible from another:
+ *   7. Check if position is visible from another:
  *      bool visible = position_is_viewable_from(&pos, &other_pos);
  * 
  ******************************************************************************/
@@ -218,7 +221,7 @@
  * POSITION - Absolute 3D Coordinate in Game World
  *******************************************************************************
  * 
- * FIELDS:
+ * FIELDS (packed into one u32, read with position_x/z/height()):
  *   x:       East/West coordinate (0-16383 for full map)
  *   z:       North/South coordinate (0-16383 for full map)
  *   height:  Plane/floor level (0-3, where 0=ground, 1-3=upper floors)
@@ -237,18 +240,105 @@
  *   - Full addressable space: X,Z ∈ [0, 16383] (16K x 16K tiles)
  *   - Height levels: 0=ground, 1-3=upper floors
  * 
+ * PACKED FORM:
+ *   Every player, NPC, object and ground item holds its position, and the
+ *   update, view and zone code reads them all every tick. Three u32s were
+ *   12 bytes per entity and three compares per equality test; packed in
+ *   the coord_pack() layout (movement.h) they are 4 bytes and one compare:
+ * 
+ *     packed = z | x << 14 | height << 28
+ * 
+ *     x           (packed >> 14) & 0x3fff
+ *     zone x      (packed >> 17) & 0x7ff      (x >> 3)
+ *     mapsquare x (packed >> 20) & 0xff       (x >> 6)
+ * 
+ *   A packed position is also the coord_pack() key that the object, zone
+ *   and ground item tables hash, and the view test's candidate coordinate.
+ * 
  * INVARIANTS:
- *   - x, z should be < 16384 (14-bit values)
- *   - height should be 0-3 (2-bit value)
+ *   - x, z are kept mod 16384 (14-bit values)
+ *   - height is kept mod 4 (2-bit value)
+ *   - bits 30-31 are always 0
  * 
- * COMPLEXITY: O(1) storage (12 bytes)
+ * COMPLEXITY: O(1) storage (4 bytes)
  ******************************************************************************/
 typedef struct {
-    u32 x;      /* East/West coordinate (horizontal) */
-    u32 z;      /* North/South coordinate (horizontal, often called Y) */
-    u32 height; /* Plane level (vertical: 0=ground, 1-3=upper floors) */
+    u32 packed; /* z | x << 14 | height << 28 (coord_pack layout) */
 } Position;
 
+#define POSITION_COORD_MASK  0x3fffu
+#define POSITION_X_SHIFT     14
+#define POSITION_HEIGHT_SHIFT 28
+
+/*
+ * position_pack - Packed form of (x, z, height), out-of-range bits dropped
+ */
+static inline u32 position_pack(u32 x, u32 z, u32 height) {
+    return (z & POSITION_COORD_MASK) | ((x & POSITION_COORD_MASK) << POSITION_X_SHIFT) |
+           ((height & 0x3) << POSITION_HEIGHT_SHIFT);
+}
+
+/*
+ * position_x / position_z / position_height - Unpack one coordinate
+ */
+static inline u32 position_x(const Position* pos) {
+    return (pos->packed >> POSITION_X_SHIFT) & POSITION_COORD_MASK;
+}
+
+static inline u32 position_z(const Position* pos) {
+    return pos->packed & POSITION_COORD_MASK;
+}
+
+static inline u32 position_height(const Position* pos) {
+    return pos->packed >> POSITION_HEIGHT_SHIFT;
+}
+
+/*
+ * position_set_x / position_set_z / position_set_height - Replace one
+ * coordinate, leaving the other two
+ */
+static inline void position_set_x(Position* pos, u32 x) {
+    pos->packed = (pos->packed & ~(POSITION_COORD_MASK << POSITION_X_SHIFT)) |
+                  ((x & POSITION_COORD_MASK) << POSITION_X_SHIFT);
+}
+
+static inline void position_set_z(Position* pos, u32 z) {
+    pos->packed = (pos->packed & ~POSITION_COORD_MASK) | (z & POSITION_COORD_MASK);
+}
+
+static inline void position_set_height(Position* pos, u32 height) {
+    pos->packed = (pos->packed & ~(0x3u << POSITION_HEIGHT_SHIFT)) |
+                  ((height & 0x3) << POSITION_HEIGHT_SHIFT);
+}
+
+/*
+ * position_equals - Same tile on the same level (one compare)
+ */
+static inline bool position_equals(const Position* a, const Position* b) {
+    return a->packed == b->packed;
+}
+
+/*
+ * position_same_height - Same level, whatever the tiles
+ */
+static inline bool position_same_height(const Position* a, const Position* b) {
+    return ((a->packed ^ b->packed) >> POSITION_HEIGHT_SHIFT) == 0;
+}
+
+/*
+ * position_distance - Chebyshev distance in tiles, levels ignored
+ * 
+ * max(|dx|, |dz|): the number of steps a walk of diagonals and straights
+ * needs, and the measure every "within N tiles" check in the server uses.
+ */
+static inline u32 position_distance(const Position* a, const Position* b) {
+    i32 dx = (i32)position_x(a) - (i32)position_x(b);
+    i32 dz = (i32)position_z(a) - (i32)position_z(b);
+    u32 ax = (u32)(dx < 0 ? -dx : dx);
+    u32 az = (u32)(dz < 0 ? -dz : dz);
+    return ax > az ? ax : az;
+}
+
 /*******************************************************************************
  * POINT - Position with Direction for Pathfinding
  *******************************************************************************
@@ -375,6 +465,23 @@ enum {
 static const i32 DIRECTION_DELTA_X[8] = {-1, 0, 1, -1, 1, -1, 0, 1};
 static const i32 DIRECTION_DELTA_Z[8] = { 1, 1, 1,  0, 0, -1,-1,-1};
 
+/*
+ * DIRECTION_FROM_STEP - Direction of a one-tile step, by table
+ *
+ * The inverse of the delta arrays for steps already normalized to -1, 0
+ * or +1 (as movement_get_next_direction() does), indexed
+ * [(dz + 1) * 3 + (dx + 1)]; -1 where there is no step:
+ *
+ *            dx=-1  dx=0  dx=+1
+ *   dz=-1     SW     S     SE        5  6  7
+ *   dz= 0     W      -     E         3 -1  4
+ *   dz=+1     NW     N     NE        0  1  2
+ *
+ * One load instead of position_direction()'s nested branches, whose
+ * outcome changes every time a path turns.
+ */
+static const i8 DIRECTION_FROM_STEP[9] = { 5, 6, 7, 3, -1, 4, 0, 1, 2 };
+
 /*******************************************************************************
  * POSITION FUNCTIONS
  ******************************************************************************/
@@ -393,7 +500,9 @@ static const i32 DIRECTION_DELTA_Z[8] = { 1, 1, 1,  0, 0, -1,-1,-1};
  * 
  * COMPLEXITY: O(1) time
  */
-void position_init(Position* pos, u32 x, u32 z, u32 height);
+static inline void position_init(Position* pos, u32 x, u32 z, u32 height) {
+    pos->packed = position_pack(x, z, height);
+}
 
 /*
  * position_move - Apply relative movement to position
@@ -403,8 +512,7 @@ void position_init(Position* pos, u32 x, u32 z, u32 height);
  * @param dz   Z displacement (negative=south, positive=north)
  * 
  * EFFECTS:
- *   pos->x += dx
- *   pos->z += dz
+ *   x += dx, z += dz (mod 16384, height kept)
  * 
  * WARNING: Does not perform bounds checking or collision detection!
  * 
@@ -416,7 +524,10 @@ void position_init(Position* pos, u32 x, u32 z, u32 height);
  * 
  * COMPLEXITY: O(1) time
  */
-void position_move(Position* pos, i32 dx, i32 dz);
+static inline void position_move(Position* pos, i32 dx, i32 dz) {
+    pos->packed = position_pack(position_x(pos) + (u32)dx, position_z(pos) + (u32)dz,
+                                position_height(pos));
+}
 
 /*
  * position_get_region_x - Convert absolute X to region X coordinate
@@ -453,9 +564,17 @@ void position_move(Position* pos, i32 dx, i32 dz);
  * 
  * COMPLEXITY: O(1) time
  */
-u32 position_get_zone_x(const Position* pos);
-u32 position_get_zone_center_x(const Position* pos);
-u32 position_get_mapsquare_x(const Position* pos);
+static inline u32 position_get_zone_x(const Position* pos) {
+    return (pos->packed >> (POSITION_X_SHIFT + 3)) & (POSITION_COORD_MASK >> 3);
+}
+
+static inline u32 position_get_zone_center_x(const Position* pos) {
+    return position_get_zone_x(pos) - 6;
+}
+
+static inline u32 position_get_mapsquare_x(const Position* pos) {
+    return (pos->packed >> (POSITION_X_SHIFT + 6)) & (POSITION_COORD_MASK >> 6);
+}
 
 /*
  * position_get_region_z - Convert absolute Z to region Z coordinate
@@ -476,9 +595,17 @@ u32 position_get_mapsquare_x(const Position* pos);
  * 
  * COMPLEXITY: O(1) time
  */
-u32 position_get_zone_z(const Position* pos);
-u32 position_get_zone_center_z(const Position* pos);
-u32 position_get_mapsquare_z(const Position* pos);
+static inline u32 position_get_zone_z(const Position* pos) {
+    return (pos->packed & POSITION_COORD_MASK) >> 3;
+}
+
+static inline u32 position_get_zone_center_z(const Position* pos) {
+    return position_get_zone_z(pos) - 6;
+}
+
+static inline u32 position_get_mapsquare_z(const Position* pos) {
+    return (pos->packed & POSITION_COORD_MASK) >> 6;
+}
 
 /*
  * position_get_local_x - Get local X coordinate relative to base position
@@ -512,7 +639,9 @@ u32 position_get_mapsquare_z(const Position* pos);
  * 
  * COMPLEXITY: O(1) time
  */
-u32 position_get_local_x(const Position* pos, const Position* base);
+static inline u32 position_get_local_x(const Position* pos, const Position* base) {
+    return position_x(pos) - (position_get_zone_center_x(base) << 3);
+}
 
 /*
  * position_get_local_z - Get local Z coordinate relative to base position
@@ -535,7 +664,9 @@ u32 position_get_local_x(const Position* pos, const Position* base);
  * 
  * COMPLEXITY: O(1) time
  */
-u32 position_get_local_z(const Position* pos, const Position* base);
+static inline u32 position_get_local_z(const Position* pos, const Position* base) {
+    return position_z(pos) - (position_get_zone_center_z(base) << 3);
+}
 
 /*
  * position_direction - Calculate compass direction from X/Z deltas
@@ -662,6 +793,72 @@ i32 position_direction(i32 dx, i32 dz);
  */
 bool position_is_viewable_from(const Position* pos, const Position* other);
 
+/*******************************************************************************
+ * BATCHED VIEW TEST - One Viewer Against a Candidate Array
+ *******************************************************************************
+ * 
+ * A viewer's zone grid query returns dozens to hundreds of candidates,
+ * and each used to be tested on its own: a call, a height branch, two
+ * abs() and two compares, with the outcome changing candidate to
+ * candidate. position_view_mask() tests a whole array instead:
+ * 
+ *   coords  [ c0 c1 c2 ... c63 | c64 ... ]    coord_pack layout, gathered
+ *              │  per lane, no branches:
+ *              │    (x - vx + r) <= 2r   as unsigned (both sides at once)
+ *              │    (z - vz + r) <= 2r
+ *              │    level bits == viewer level
+ *              ▼
+ *   mask    [ 0b...0100110 | ... ]            bit i = candidate i visible
+ * 
+ * 64 candidates per mask word, each word's lanes one loop the compiler
+ * vectorizes (a fixed count, no remainder). Callers walk the set bits:
+ * those candidates go straight into the PlayerSet / NpcSet that the
+ * update encoders diff into adds and removes.
+ * 
+ * EXCLUDING CANDIDATES:
+ *   Bit 30 of a packed coordinate is unused by coord_pack. A candidate
+ *   packed with POSITION_VIEW_HIDDEN has level bits 4 or more and never
+ *   matches a viewer: hidden players, the viewer itself, stale slots.
+ * 
+ * SAME TEST AS player_is_within_distance():
+ *   Same height and at most radius tiles on each axis, for positions on
+ *   the map (x, z below 16384, height 0-3 - what coord_pack keeps).
+ * 
+ ******************************************************************************/
+
+/* Candidates per mask word (and the rounding of coords arrays) */
+#define POSITION_VIEW_LANES 64
+
+/* Bit set in a candidate's packed coordinate to keep it out of every view */
+#define POSITION_VIEW_HIDDEN 0x40000000u
+
+/* Entries a coords array of n candidates must have room for */
+#define POSITION_VIEW_ROUND(n) (((n) + POSITION_VIEW_LANES - 1) & ~(POSITION_VIEW_LANES - 1))
+
+/*
+ * position_view_coord - A candidate's packed coordinate (coord_pack layout)
+ */
+static inline u32 position_view_coord(const Position* pos) {
+    return pos->packed;
+}
+
+/*
+ * position_view_mask - Which candidates a viewer sees
+ * 
+ * @param viewer  Viewer's position
+ * @param coords  count packed coordinates, with room for
+ *                POSITION_VIEW_ROUND(count) (the tail is filled with
+ *                POSITION_VIEW_HIDDEN)
+ * @param count   Candidates
+ * @param radius  Tiles on each axis (at most 8191)
+ * @param mask    Receives POSITION_VIEW_ROUND(count) / 64 words; bit i of
+ *                word i / 64 is set if candidate i is visible
+ * @return        Number of visible candidates
+ * 
+ * COMPLEXITY: O(count) time, branch-free per candidate
+ */
+u32 position_view_mask(const Position* viewer, u32* coords, u32 count, u32 radius, u64* mask);
+
 /*******************************************************************************
  * POINT FUNCTIONS
  ******************************************************************************/
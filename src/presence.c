@@ -0,0 +1,420 @@
+/*******************************************************************************
+ * PRESENCE.C - Presence Directory and World Replicas
+ *******************************************************************************
+ *
+ * See presence.h for the frame format and who sends what.
+ *
+ ******************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "presence.h"
+#include "social.h"
+#include "update.h"
+#include "world.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+PresenceClient* g_presence = NULL;
+
+/*******************************************************************************
+ * NAME TABLE (directory and replicas)
+ ******************************************************************************/
+
+/* Base-37 names are dense in their low bits: mix before masking */
+static u32 table_home(const PresenceTable* table, u64 name) {
+    name ^= name >> 33;
+    name *= 0xff51afd7ed558ccdULL;
+    name ^= name >> 33;
+    return (u32)name & table->mask;
+}
+
+/* Slot holding name, or the empty slot where it would go */
+static u32 table_find(const PresenceTable* table, u64 name) {
+    u32 slot = table_home(table, name);
+    while (table->slots[slot].name && table->slots[slot].name != name) {
+        slot = (slot + 1) & table->mask;
+    }
+    return slot;
+}
+
+/* Empty a slot, shifting later entries of the probe run back (no tombstones) */
+static void table_remove(PresenceTable* table, u32 slot) {
+    u32 hole = slot;
+    for (u32 i = (slot + 1) & table->mask; table->slots[i].name; i = (i + 1) & table->mask) {
+        u32 home = table_home(table, table->slots[i].name);
+        if (((i - home) & table->mask) >= ((i - hole) & table->mask)) {
+            table->slots[hole] = table->slots[i];
+            hole = i;
+        }
+    }
+    table->slots[hole].name = 0;
+}
+
+/* Room for every world at MAX_PLAYERS, at most half full */
+static bool table_init(PresenceTable* table, u32 worlds) {
+    u32 capacity = 1;
+    while (capacity < worlds * MAX_PLAYERS * 2) capacity <<= 1;
+    table->slots = (PresenceSlot*)calloc(capacity, sizeof(PresenceSlot));
+    table->mask = capacity - 1;
+    return table->slots != NULL;
+}
+
+static void table_free(PresenceTable* table) {
+    free(table->slots);
+    table->slots = NULL;
+}
+
+/*
+ * table_apply - One update from world sender: online sets, offline clears
+ * only a name the sender still holds
+ */
+static void table_apply(PresenceTable* table, u64 name, u8 state, u32 sender) {
+    if (name == 0) return;
+    u32 slot = table_find(table, name);
+    if (state != 0) {
+        table->slots[slot].name = name;
+        table->slots[slot].world = state;
+    } else if (table->slots[slot].name && table->slots[slot].world == sender + 1) {
+        table_remove(table, slot);
+    }
+}
+
+/* notify: a replica tells this world's friend lists (social.h) */
+static u32 table_drop_world(PresenceTable* table, u32 world, bool notify) {
+    u32 dropped = 0;
+    u32 slot = 0;
+    while (slot <= table->mask) {
+        if (table->slots[slot].name && table->slots[slot].world == world + 1) {
+            if (notify) social_presence_changed(g_social, table->slots[slot].name, -1);
+            table_remove(table, slot);      /* Something may shift into this slot */
+            dropped++;
+        } else {
+            slot++;
+        }
+    }
+    return dropped;
+}
+
+#ifndef _WIN32
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/*******************************************************************************
+ * FRAMES
+ ******************************************************************************/
+
+static u32 frame_header(u8* frame, PresenceOp op, u32 world, u32 count) {
+    frame[0] = (u8)op;
+    frame[1] = (u8)world;
+    frame[2] = (u8)(count >> 8);
+    frame[3] = (u8)count;
+    return 4;
+}
+
+static u32 frame_put(u8* frame, u32 offset, u64 name, u8 state) {
+    for (int shift = 56; shift >= 0; shift -= 8) frame[offset++] = (u8)(name >> shift);
+    frame[offset++] = state;
+    return offset;
+}
+
+static u64 frame_name(const u8* entry) {
+    u64 name = 0;
+    for (int i = 0; i < 8; i++) name = (name << 8) | entry[i];
+    return name;
+}
+
+/* Entries in a received frame, or -1 if it is malformed */
+static i32 frame_count(const u8* frame, ssize_t length) {
+    if (length < 4) return -1;
+    u32 count = ((u32)frame[2] << 8) | frame[3];
+    if (count > PRESENCE_FRAME_ENTRIES || (size_t)length != 4 + (size_t)count * 9) return -1;
+    return (i32)count;
+}
+
+/*******************************************************************************
+ * SERVICE (supervisor)
+ ******************************************************************************/
+
+bool presence_service_create(PresenceService* service, u32 worlds) {
+    memset(service, 0, sizeof(PresenceService));
+    for (u32 i = 0; i < SUPERVISOR_MAX_WORLDS; i++) service->fds[i] = service->world_fds[i] = -1;
+    if (worlds == 0 || worlds > SUPERVISOR_MAX_WORLDS) return false;
+    service->worlds = worlds;
+
+    bool ok = table_init(&service->directory, worlds);
+    for (u32 i = 0; ok && i < worlds; i++) {
+        int pair[2];
+        if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, pair) != 0) {
+            perror("socketpair presence");
+            ok = false;
+            break;
+        }
+        service->fds[i] = pair[0];
+        service->world_fds[i] = pair[1];
+        fcntl(pair[0], F_SETFD, FD_CLOEXEC);
+    }
+    if (!ok) presence_service_destroy(service);
+    return ok;
+}
+
+void presence_service_forked(PresenceService* service) {
+    for (u32 i = 0; i < service->worlds; i++) {
+        if (service->world_fds[i] >= 0) close(service->world_fds[i]);
+        service->world_fds[i] = -1;
+    }
+}
+
+/* Send a frame to every world but skip (non-blocking; full sockets drop it) */
+static void service_forward(PresenceService* service, const u8* frame, size_t length, u32 skip) {
+    for (u32 i = 0; i < service->worlds; i++) {
+        if (i == skip || service->fds[i] < 0) continue;
+        if (send(service->fds[i], frame, length, MSG_DONTWAIT | MSG_NOSIGNAL) != (ssize_t)length) {
+            service->dropped++;
+        }
+    }
+}
+
+/* Drain one world's socket: apply each frame, pass it on */
+static void service_receive(PresenceService* service, u32 world) {
+    u8 frame[PRESENCE_FRAME_MAX];
+    for (;;) {
+        ssize_t length = recv(service->fds[world], frame, sizeof(frame), MSG_DONTWAIT);
+        if (length < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return;
+            length = 0;
+        }
+        if (length == 0) {                  /* World gone; waitpid reports it */
+            close(service->fds[world]);
+            service->fds[world] = -1;
+            return;
+        }
+        i32 count = frame_count(frame, length);
+        if (count < 0 || frame[0] != PRESENCE_OP_SET) continue;
+
+        frame[1] = (u8)world;               /* The socket says who sent it */
+        for (i32 e = 0; e < count; e++) {
+            const u8* entry = &frame[4 + e * 9];
+            /* A world may only place names on itself */
+            u8 state = entry[8] ? (u8)(world + 1) : 0;
+            frame[4 + e * 9 + 8] = state;
+            table_apply(&service->directory, frame_name(entry), state, world);
+        }
+        service->frames++;
+        service->updates += (u64)count;
+        service_forward(service, frame, (size_t)length, world);
+    }
+}
+
+void presence_service_poll(PresenceService* service, int timeout_ms) {
+    struct pollfd fds[SUPERVISOR_MAX_WORLDS];
+    u32 worlds[SUPERVISOR_MAX_WORLDS];
+    nfds_t count = 0;
+    for (u32 i = 0; i < service->worlds; i++) {
+        if (service->fds[i] < 0) continue;
+        fds[count].fd = service->fds[i];
+        fds[count].events = POLLIN;
+        fds[count].revents = 0;
+        worlds[count++] = i;
+    }
+    if (count == 0 || poll(fds, count, timeout_ms) <= 0) return;
+    for (nfds_t i = 0; i < count; i++) {
+        if (fds[i].revents) service_receive(service, worlds[i]);
+    }
+}
+
+u32 presence_service_world_down(PresenceService* service, u32 world) {
+    if (world >= service->worlds || !service->directory.slots) return 0;
+    if (service->fds[world] >= 0) {
+        close(service->fds[world]);
+        service->fds[world] = -1;
+    }
+    u32 dropped = table_drop_world(&service->directory, world, false);
+    u8 frame[4];
+    frame_header(frame, PRESENCE_OP_WORLD_DOWN, world, 0);
+    service_forward(service, frame, sizeof(frame), world);
+    return dropped;
+}
+
+void presence_service_destroy(PresenceService* service) {
+    for (u32 i = 0; i < SUPERVISOR_MAX_WORLDS; i++) {
+        if (service->fds[i] >= 0) close(service->fds[i]);
+        if (service->world_fds[i] >= 0) close(service->world_fds[i]);
+        service->fds[i] = service->world_fds[i] = -1;
+    }
+    if (service->frames > 0) {
+        printf("Presence directory: %llu frames, %llu updates, %llu frames dropped\n",
+               (unsigned long long)service->frames, (unsigned long long)service->updates,
+               (unsigned long long)service->dropped);
+    }
+    table_free(&service->directory);
+}
+
+/*******************************************************************************
+ * CLIENT (each world)
+ ******************************************************************************/
+
+static PresenceClient presence_client;
+
+void presence_service_enter_world(PresenceService* service, u32 world) {
+    int fd = service->world_fds[world];
+    service->world_fds[world] = -1;
+    for (u32 i = 0; i < SUPERVISOR_MAX_WORLDS; i++) {
+        if (service->fds[i] >= 0) close(service->fds[i]);
+        if (service->world_fds[i] >= 0) close(service->world_fds[i]);
+        service->fds[i] = service->world_fds[i] = -1;
+    }
+    table_free(&service->directory);  /* The supervisor's copy, not ours */
+    if (fd < 0) return;
+
+    memset(&presence_client, 0, sizeof(presence_client));
+    presence_client.fd = fd;
+    presence_client.world = world;
+    if (!table_init(&presence_client.replica, service->worlds)) {
+        close(fd);
+        return;
+    }
+    g_presence = &presence_client;
+}
+
+static void presence_queue(u64 name, u8 state) {
+    PresenceClient* client = g_presence;
+    if (name == 0) return;
+
+    social_presence_changed(g_social, name, state ? (i32)state - 1 : -1);
+    if (!client) return;
+
+    table_apply(&client->replica, name, state, client->world);
+    if (client->pending_count >= PRESENCE_PENDING_MAX) {
+        client->dropped++;
+        return;
+    }
+    client->pending[client->pending_count++] = (PresenceUpdate){ name, state };
+}
+
+void presence_online(const Player* player) {
+    if (!player) return;
+    presence_queue(username_to_base37(player->username), (u8)((g_presence ? g_presence->world : g_world_id) + 1));
+}
+
+void presence_offline(const Player* player) {
+    if (!player) return;
+    presence_queue(username_to_base37(player->username), 0);
+}
+
+void presence_disown(const char* username) {
+    u64 name = username_to_base37(username);
+    presence_queue(name, (u8)((g_presence ? g_presence->world : g_world_id) + 1));
+    presence_queue(name, 0);
+}
+
+/* Send queued updates until done or the socket is full */
+static void presence_flush(PresenceClient* client) {
+    u32 done = 0;
+    while (done < client->pending_count) {
+        u32 count = client->pending_count - done;
+        if (count > PRESENCE_FRAME_ENTRIES) count = PRESENCE_FRAME_ENTRIES;
+
+        u8 frame[PRESENCE_FRAME_MAX];
+        u32 length = frame_header(frame, PRESENCE_OP_SET, client->world, count);
+        for (u32 i = 0; i < count; i++) {
+            const PresenceUpdate* update = &client->pending[done + i];
+            length = frame_put(frame, length, update->name, update->state);
+        }
+        if (send(client->fd, frame, length, MSG_DONTWAIT | MSG_NOSIGNAL) != (ssize_t)length) break;
+        done += count;
+        client->sent += count;
+    }
+    if (done > 0) {
+        client->pending_count -= done;
+        memmove(client->pending, client->pending + done, client->pending_count * sizeof(PresenceUpdate));
+    }
+}
+
+void presence_pump(void) {
+    PresenceClient* client = g_presence;
+    if (!client) return;
+    presence_flush(client);
+
+    u8 frame[PRESENCE_FRAME_MAX];
+    for (;;) {
+        ssize_t length = recv(client->fd, frame, sizeof(frame), MSG_DONTWAIT);
+        if (length <= 0) return;            /* Nothing waiting (or the supervisor is gone) */
+        i32 count = frame_count(frame, length);
+        if (count < 0 || frame[1] == client->world) continue;
+
+        if (frame[0] == PRESENCE_OP_WORLD_DOWN) {
+            table_drop_world(&client->replica, frame[1], true);
+        } else if (frame[0] == PRESENCE_OP_SET) {
+            for (i32 e = 0; e < count; e++) {
+                const u8* entry = &frame[4 + e * 9];
+                u64 name = frame_name(entry);
+                table_apply(&client->replica, name, entry[8], frame[1]);
+                social_presence_changed(g_social, name, presence_find_name(name));
+            }
+            client->received += (u64)count;
+        }
+    }
+}
+
+void presence_client_close(void) {
+    PresenceClient* client = g_presence;
+    if (!client) return;
+    presence_flush(client);
+    printf("Presence: %llu updates sent, %llu received, %llu dropped\n",
+           (unsigned long long)client->sent, (unsigned long long)client->received,
+           (unsigned long long)client->dropped);
+    close(client->fd);
+    table_free(&client->replica);
+    g_presence = NULL;
+}
+
+#else /* _WIN32 */
+
+bool presence_service_create(PresenceService* service, u32 worlds) {
+    (void)worlds;
+    memset(service, 0, sizeof(PresenceService));
+    return false;
+}
+void presence_service_enter_world(PresenceService* service, u32 world) { (void)service; (void)world; }
+void presence_service_forked(PresenceService* service) { (void)service; }
+void presence_service_poll(PresenceService* service, int timeout_ms) { (void)service; (void)timeout_ms; }
+u32 presence_service_world_down(PresenceService* service, u32 world) {
+    (void)service; (void)world;
+    return 0;
+}
+void presence_service_destroy(PresenceService* service) { (void)service; }
+void presence_online(const Player* player) {
+    if (player) social_presence_changed(g_social, username_to_base37(player->username), (i32)g_world_id);
+}
+void presence_offline(const Player* player) {
+    if (player) social_presence_changed(g_social, username_to_base37(player->username), -1);
+}
+void presence_disown(const char* username) { (void)username; }
+void presence_pump(void) {}
+void presence_client_close(void) {}
+
+#endif /* _WIN32 */
+
+i32 presence_find(const char* username) {
+    return presence_find_name(username ? username_to_base37(username) : 0);
+}
+
+i32 presence_find_name(u64 name) {
+    if (name == 0) return -1;
+
+    if (g_presence) {
+        const PresenceTable* replica = &g_presence->replica;
+        const PresenceSlot* slot = &replica->slots[table_find(replica, name)];
+        return slot->name ? (i32)slot->world - 1 : -1;
+    }
+
+    /* One world: ask it directly */
+    return world_get_player_by_name(g_world, name) ? (i32)g_world_id : -1;
+}
@@ -0,0 +1,218 @@
+/*******************************************************************************
+ * PRESENCE.H - Who Is Online, on Which World (directory shared by all worlds)
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - A directory service hosted by the supervisor process
+ *   - Compact binary RPC over SOCK_SEQPACKET (one send = one frame)
+ *   - Batching updates per tick instead of one message per event
+ *   - Local replicas: reads never wait on the network
+ *
+ * THE PROBLEM:
+ *
+ * With several worlds (supervisor.h), "is my friend online, and where?"
+ * has no local answer: world_get_player() only sees this world. Asking
+ * another process on every lookup would put a round trip in the middle of
+ * a packet handler, or of login.
+ *
+ * THE SOLUTION - ONE DIRECTORY, A REPLICA IN EVERY WORLD:
+ *
+ *   world 0                   supervisor                    world 1
+ *   ───────                   ──────────                    ───────
+ *   login alice → pending     directory:                    replica:
+ *   logout bob  → pending       base37 → world               base37 → world
+ *   end of tick: one frame ──→  apply, forward frame ──────→ apply
+ *   replica updated at once
+ *
+ *   presence_find("alice") reads the local replica: O(1), no I/O, so
+ *   lookups never block a handler or login. A change reaches the other
+ *   worlds within a tick or two.
+ *
+ * WIRE FORMAT (big-endian, one datagram per frame):
+ *
+ *   [u8 op][u8 world][u16 count] count × ( [u64 base37 name][u8 state] )
+ *
+ *   op SET:        state = world index + 1 (online) or 0 (offline)
+ *   op WORLD_DOWN: the world has exited; count = 0
+ *
+ *   Names are the client's base-37 longs (username_to_base37), 9 bytes
+ *   per update with the state. The supervisor trusts the socket, not the
+ *   frame, for which world sent it.
+ *
+ * ORDERING:
+ *   An offline update only clears a name still held by the sender, so a
+ *   late "bob left world 0" cannot erase "bob is now on world 1". Which
+ *   world may actually hold an account is still decided by the account
+ *   registry (account_registry.h) at login; presence only reports it.
+ *
+ * BACKPRESSURE:
+ *   Every send is non-blocking. A world that cannot send keeps its updates
+ *   for the next tick (up to PRESENCE_PENDING_MAX); the supervisor drops a
+ *   frame for a world whose socket is full. Both are counted.
+ *
+ * SINGLE WORLD:
+ *   g_presence stays NULL and presence_find() searches this world only.
+ *
+ * FRIEND LISTS:
+ *   Every change, local or from another world, is passed on to
+ *   social_presence_changed() (social.h), which tells the players who
+ *   have the name on their friend list at the end of the tick.
+ *
+ * PLATFORM:
+ *   POSIX (socketpair). On Windows no service starts.
+ *
+ ******************************************************************************/
+
+#ifndef PRESENCE_H
+#define PRESENCE_H
+
+#include "types.h"
+#include "player.h"
+#include "supervisor.h"
+
+/* Updates per frame: 4 + 240 × 9 = 2164 bytes */
+#define PRESENCE_FRAME_ENTRIES 240
+#define PRESENCE_FRAME_MAX (4 + PRESENCE_FRAME_ENTRIES * 9)
+
+/* Updates a world may hold while its socket is full */
+#define PRESENCE_PENDING_MAX (MAX_PLAYERS * 2)
+
+/* How long the supervisor waits for frames between child checks */
+#define PRESENCE_POLL_MS 200
+
+typedef enum {
+    PRESENCE_OP_SET = 1,
+    PRESENCE_OP_WORLD_DOWN = 2
+} PresenceOp;
+
+/* One name per slot; name 0 = empty, world = world index + 1 */
+typedef struct {
+    u64 name;
+    u8 world;
+} PresenceSlot;
+
+typedef struct {
+    PresenceSlot* slots;
+    u32 mask;                   /* Capacity - 1 (power of two) */
+} PresenceTable;
+
+/* One queued change (state as on the wire) */
+typedef struct {
+    u64 name;
+    u8 state;
+} PresenceUpdate;
+
+/*
+ * PresenceService - The directory, run by the supervisor
+ */
+typedef struct {
+    int fds[SUPERVISOR_MAX_WORLDS];         /* Supervisor ends, -1 once closed */
+    int world_fds[SUPERVISOR_MAX_WORLDS];   /* World ends, closed after the forks */
+    u32 worlds;
+    PresenceTable directory;
+    u64 frames;                             /* Frames received */
+    u64 updates;                            /* Updates applied */
+    u64 dropped;                            /* Frames not forwarded (socket full) */
+} PresenceService;
+
+/*
+ * PresenceClient - One world's connection and replica
+ */
+typedef struct {
+    int fd;
+    u32 world;
+    PresenceTable replica;                  /* Every world's players, this one included */
+    PresenceUpdate pending[PRESENCE_PENDING_MAX];
+    u32 pending_count;
+    u64 sent;                               /* Updates sent */
+    u64 received;                           /* Updates applied from other worlds */
+    u64 dropped;                            /* Updates lost to a full queue */
+} PresenceClient;
+
+/* This world's client (NULL when running a single world) */
+extern PresenceClient* g_presence;
+
+/*
+ * presence_service_create - Directory plus one socket pair per world
+ *
+ * @return  false if the sockets or table could not be created; the
+ *          worlds then run without presence
+ *
+ * Call before the worlds are forked.
+ */
+bool presence_service_create(PresenceService* service, u32 worlds);
+
+/*
+ * presence_service_enter_world - In a forked world: keep only its socket
+ *
+ * Closes every other descriptor of the service and opens g_presence.
+ */
+void presence_service_enter_world(PresenceService* service, u32 world);
+
+/*
+ * presence_service_forked - In the supervisor: close the worlds' ends
+ */
+void presence_service_forked(PresenceService* service);
+
+/*
+ * presence_service_poll - Apply and forward frames for up to timeout_ms
+ */
+void presence_service_poll(PresenceService* service, int timeout_ms);
+
+/*
+ * presence_service_world_down - A world exited: drop its names, tell the others
+ *
+ * @return  Names dropped
+ */
+u32 presence_service_world_down(PresenceService* service, u32 world);
+
+void presence_service_destroy(PresenceService* service);
+
+/*
+ * presence_online / presence_offline - Queue a change for this world
+ *
+ * Applied to the local replica at once; sent by presence_pump(). Friend
+ * lists hear of it in both modes, with or without other worlds.
+ */
+void presence_online(const Player* player);
+void presence_offline(const Player* player);
+
+/*
+ * presence_disown - Clear a name another world still lists
+ *
+ * For a player handed to this world (cluster.h) who could not be taken
+ * in: the directory still names the sending world. Queued as online
+ * here, then offline, which clears it; an offline only clears an entry
+ * of the world that sends it (see ORDERING).
+ */
+void presence_disown(const char* username);
+
+/*
+ * presence_pump - Send queued changes, apply frames from other worlds
+ *
+ * Called once per tick by server_tick(). Never blocks.
+ */
+void presence_pump(void);
+
+/*
+ * presence_find - World a player is online on
+ *
+ * @param username  Name as typed (any case)
+ * @return          World index, or -1 if offline everywhere
+ *
+ * COMPLEXITY: O(1)
+ */
+i32 presence_find(const char* username);
+
+/*
+ * presence_find_name - presence_find() for a base-37 name
+ */
+i32 presence_find_name(u64 name);
+
+/*
+ * presence_client_close - Last send of queued changes, then close
+ */
+void presence_client_close(void);
+
+#endif /* PRESENCE_H */
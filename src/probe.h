@@ -0,0 +1,82 @@
+/*******************************************************************************
+ * PROBE.H - Static Tracepoints (USDT) for perf and bpftrace
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - User-level statically defined tracing (USDT, SystemTap SDT notes)
+ *   - Zero-cost-when-disabled instrumentation: a nop and an ELF note
+ *   - Naming work that the optimizer has inlined away
+ *
+ * THE PROBLEM:
+ *
+ * perf samples the server in production and reports cycles per symbol,
+ * but at -O2 server_dispatch_packet(), update_other_players() and the
+ * buffer_write_bits() calls inside them are inlined into their callers:
+ * the profile says "update_player_encode 61%" and cannot say which
+ * viewer, which opcode, or how many players were added. Logging the
+ * same facts means rebuilding and restarting with --log-level, and
+ * writes a line per event whether anyone reads it or not.
+ *
+ * THE SOLUTION - PROBES THE COMPILER KEEPS:
+ *
+ * A probe site compiles to one nop plus an ELF note recording the nop's
+ * address and where each argument lives (register or stack slot):
+ *
+ *   PROBE3(packet, pid, opcode, length);
+ *
+ *     .text:   nop                          ← probe address
+ *     .note.stapsdt:  provider "rs225", name "packet",
+ *                     args "2@%ax 1@%dl 4@%ecx"
+ *
+ * Nothing runs at the site until a tracer attaches: bpftrace or perf
+ * then patch the nop into a breakpoint and read the arguments from the
+ * registers the note names. Detached, the cost is the nop (and keeping
+ * the arguments computed), whatever the inlining did to the function.
+ *
+ *   sudo bpftrace -e 'usdt:./bin/rs225:rs225:packet { @[arg1] = count(); }'
+ *   sudo perf buildid-cache --add ./bin/rs225
+ *   sudo perf record -e sdt_rs225:tick__end -p <pid>
+ *
+ * BUILDING:
+ *   make PROBES=1 defines RS225_PROBES and includes <sys/sdt.h>
+ *   (systemtap-sdt-dev / systemtap-sdt-devel). Without it every PROBEn()
+ *   is empty and the binary is unchanged.
+ *
+ * PROBES (provider rs225):
+ *   tick__start    (tick)                       server_tick() entered
+ *   tick__end      (tick, work_ns)              tick_stats_end()
+ *   packet         (pid, opcode, length)        before a packet's handler
+ *   player__add    (viewer_pid, other_pid)      other enters viewer's view
+ *   player__remove (viewer_pid, other_pid)      other leaves viewer's view
+ *   login__accept  (slot, username)             save applied, player in world
+ *   save__done     (username, bytes, ok)        background save written
+ *
+ *   Double underscores are the SDT spelling of a dash: tracers list
+ *   tick__end as "tick-end" in some tools and "tick__end" in others.
+ *
+ * Arguments are evaluated only in a PROBES=1 build, so they must have no
+ * side effects (and nothing should be computed only for a probe).
+ *
+ ******************************************************************************/
+
+#ifndef PROBE_H
+#define PROBE_H
+
+#ifdef RS225_PROBES
+
+#include <sys/sdt.h>
+
+#define PROBE1(name, a)          DTRACE_PROBE1(rs225, name, a)
+#define PROBE2(name, a, b)       DTRACE_PROBE2(rs225, name, a, b)
+#define PROBE3(name, a, b, c)    DTRACE_PROBE3(rs225, name, a, b, c)
+
+#else
+
+#define PROBE1(name, a)          ((void)0)
+#define PROBE2(name, a, b)       ((void)0)
+#define PROBE3(name, a, b, c)    ((void)0)
+
+#endif /* RS225_PROBES */
+
+#endif /* PROBE_H */
@@ -0,0 +1,349 @@
+/*******************************************************************************
+ * REGION_SHARD.C - Movement Sharded by Mapsquare Implementation
+ *******************************************************************************
+ *
+ * See region_shard.h for the design.
+ *
+ * ONE TICK:
+ *
+ *   game thread                         shard k
+ *   ───────────                         ───────
+ *   rebalance (every N ticks)           lock
+ *   file players under shards           wait until generation != seen
+ *   lock                                unlock
+ *   generation++, pending = N-1         step shards[k].members
+ *   broadcast wake ──────────────────→  collect their zone changes
+ *   unlock                              lock
+ *   step shards[0].members, collect     pending-- → 0? signal done
+ *   lock                                (back to waiting)
+ *   wait until pending == 0  ←────────
+ *   unlock
+ *   merge the batches (list order)
+ *
+ * The same hand-off as update_pool.c: the mutex orders the partition
+ * before the shards read it, and every shard's steps before the merge.
+ *
+ ******************************************************************************/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include "region_shard.h"
+#include "position.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+RegionShards* g_region_shards = NULL;
+
+#ifndef _WIN32
+
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+
+#define SHARD_MUTEX(p)  ((pthread_mutex_t*)(p)->mutex)
+#define SHARD_WAKE(p)   ((pthread_cond_t*)(p)->wake)
+#define SHARD_DONE(p)   ((pthread_cond_t*)(p)->done)
+
+/* Index of the square a player stands on in the owner table */
+static u32 shard_square(const Player* player) {
+    u32 square_x = position_get_mapsquare_x(&player->position) & (REGION_SHARD_SQUARES - 1);
+    u32 square_z = position_get_mapsquare_z(&player->position) & (REGION_SHARD_SQUARES - 1);
+    return square_x * REGION_SHARD_SQUARES + square_z;
+}
+
+/*
+ * shard_step - Move one shard's players and flag their zone changes
+ * (runs on that shard's thread)
+ */
+static void shard_step(RegionShards* pool, RegionShard* shard) {
+    u8 self = (u8)(shard - pool->shards);
+    for (u32 i = 0; i < shard->member_count; i++) {
+        u32 order = shard->members[i];
+        Player* player = pool->list->active[order];
+        u8 flags = player_step_movement(player) ? MOVEMENT_BATCH_RELOAD : 0;
+        if (player->primary_direction != -1) flags |= MOVEMENT_BATCH_MOVED;
+        movement_batch_push(&shard->batch, player->index, order, &player->position, flags);
+        if (pool->owner[shard_square(player)] != self) shard->crossings++;
+    }
+    movement_batch_collect(&shard->batch, pool->grid);
+    shard->stepped += shard->member_count;
+}
+
+static void* shard_thread_main(void* arg) {
+    RegionShard* shard = (RegionShard*)arg;
+    RegionShards* pool = shard->pool;
+    u32 seen = 0;
+
+    pthread_mutex_lock(SHARD_MUTEX(pool));
+    for (;;) {
+        while (pool->generation == seen && pool->running) {
+            pthread_cond_wait(SHARD_WAKE(pool), SHARD_MUTEX(pool));
+        }
+        if (!pool->running) break;
+        seen = pool->generation;
+        pthread_mutex_unlock(SHARD_MUTEX(pool));
+
+        shard_step(pool, shard);
+
+        pthread_mutex_lock(SHARD_MUTEX(pool));
+        if (--pool->pending == 0) pthread_cond_signal(SHARD_DONE(pool));
+    }
+    pthread_mutex_unlock(SHARD_MUTEX(pool));
+    return NULL;
+}
+
+/* One occupied square while rebalancing */
+typedef struct {
+    u32 square;
+    u16 players;
+} SquareLoad;
+
+static int square_load_busiest_first(const void* a, const void* b) {
+    const SquareLoad* x = (const SquareLoad*)a;
+    const SquareLoad* y = (const SquareLoad*)b;
+    if (x->players != y->players) return x->players > y->players ? -1 : 1;
+    return x->square < y->square ? -1 : x->square > y->square;
+}
+
+/*
+ * shard_rebalance - Hand occupied squares out, busiest first, to the
+ * shard with the fewest players so far
+ */
+static void shard_rebalance(RegionShards* pool, const PlayerList* list) {
+    static SquareLoad squares[MAX_PLAYERS];
+    u32 square_count = 0;
+
+    for (u32 i = 0; i < list->count; i++) {
+        u32 square = shard_square(list->active[i]);
+        if (pool->load[square]++ == 0) squares[square_count++].square = square;
+    }
+    for (u32 i = 0; i < square_count; i++) {
+        squares[i].players = pool->load[squares[i].square];
+        pool->load[squares[i].square] = 0;
+    }
+    qsort(squares, square_count, sizeof(SquareLoad), square_load_busiest_first);
+
+    u32 assigned[REGION_SHARD_MAX] = { 0 };
+    for (u32 i = 0; i < square_count; i++) {
+        u32 lightest = 0;
+        for (u32 s = 1; s < pool->shard_count; s++) {
+            if (assigned[s] < assigned[lightest]) lightest = s;
+        }
+        pool->owner[squares[i].square] = (u8)lightest;
+        assigned[lightest] += squares[i].players;
+    }
+    pool->rebalances++;
+}
+
+/*
+ * region_shards_free - Release everything region_shards_start() allocated
+ */
+static void region_shards_free(RegionShards* pool) {
+    if (pool->shards) {
+        for (u32 i = 0; i < pool->shard_count; i++) {
+            free(pool->shards[i].members);
+            free(pool->shards[i].thread);
+            movement_batch_free(&pool->shards[i].batch);
+        }
+        free(pool->shards);
+    }
+    if (pool->mutex) pthread_mutex_destroy(SHARD_MUTEX(pool));
+    if (pool->wake) pthread_cond_destroy(SHARD_WAKE(pool));
+    if (pool->done) pthread_cond_destroy(SHARD_DONE(pool));
+    free(pool->mutex);
+    free(pool->wake);
+    free(pool->done);
+    free(pool->owner);
+    free(pool->load);
+    memset(pool, 0, sizeof(RegionShards));
+}
+
+bool region_shards_start(RegionShards* pool, u32 shards) {
+    if (!pool) return false;
+    memset(pool, 0, sizeof(RegionShards));
+
+    /* More shards than cores only adds switching */
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus > 0 && shards > (u32)cpus) shards = (u32)cpus;
+    if (shards > REGION_SHARD_MAX) shards = REGION_SHARD_MAX;
+    if (shards < 2) {
+        fprintf(stderr, "WARNING: Region sharding needs 2+ shards, movement stays serial\n");
+        return false;
+    }
+
+    pool->shards = (RegionShard*)calloc(shards, sizeof(RegionShard));
+    pool->owner = (u8*)malloc(REGION_SHARD_SQUARES * REGION_SHARD_SQUARES);
+    pool->load = (u16*)calloc(REGION_SHARD_SQUARES * REGION_SHARD_SQUARES, sizeof(u16));
+    pthread_mutex_t* mutex = (pthread_mutex_t*)malloc(sizeof(pthread_mutex_t));
+    pthread_cond_t* wake = (pthread_cond_t*)malloc(sizeof(pthread_cond_t));
+    pthread_cond_t* done = (pthread_cond_t*)malloc(sizeof(pthread_cond_t));
+
+    bool ok = pool->shards && pool->owner && pool->load && mutex && wake && done;
+    for (u32 i = 0; ok && i < shards; i++) {
+        pool->shards[i].members = (u16*)malloc(MAX_PLAYERS * sizeof(u16));
+        pool->shards[i].pool = pool;
+        pool->shard_count++;
+        ok = pool->shards[i].members != NULL &&
+             movement_batch_init(&pool->shards[i].batch, MAX_PLAYERS);
+    }
+    if (ok && pthread_mutex_init(mutex, NULL) == 0) {
+        pool->mutex = mutex;
+    } else {
+        free(mutex);
+        ok = false;
+    }
+    if (ok && pthread_cond_init(wake, NULL) == 0) {
+        pool->wake = wake;
+    } else {
+        free(wake);
+        ok = false;
+    }
+    if (ok && pthread_cond_init(done, NULL) == 0) {
+        pool->done = done;
+    } else {
+        free(done);
+        ok = false;
+    }
+    if (!ok) {
+        region_shards_free(pool);
+        fprintf(stderr, "WARNING: Region shards not started, movement stays serial\n");
+        return false;
+    }
+
+    /* Until the first rebalance, scatter squares so neighbours differ */
+    for (u32 square = 0; square < REGION_SHARD_SQUARES * REGION_SHARD_SQUARES; square++) {
+        u32 square_x = square / REGION_SHARD_SQUARES;
+        u32 square_z = square % REGION_SHARD_SQUARES;
+        pool->owner[square] = (u8)((square_x + square_z * 3) % shards);
+    }
+    pool->running = true;
+
+    /* Signals stay on the game thread, as for the network thread */
+    sigset_t all, previous;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &previous);
+    u32 started = 1;                /* shards[0] is the caller */
+    for (u32 i = 1; i < shards; i++) {
+        RegionShard* shard = &pool->shards[i];
+        pthread_t* thread = (pthread_t*)malloc(sizeof(pthread_t));
+        if (!thread || pthread_create(thread, NULL, shard_thread_main, shard) != 0) {
+            free(thread);
+            break;
+        }
+        shard->thread = thread;
+        started++;
+    }
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+    if (started < shards) {
+        /* Squares may be owned by a shard with no thread: stop the rest */
+        pthread_mutex_lock(SHARD_MUTEX(pool));
+        pool->running = false;
+        pthread_cond_broadcast(SHARD_WAKE(pool));
+        pthread_mutex_unlock(SHARD_MUTEX(pool));
+        for (u32 i = 1; i < started; i++) {
+            pthread_join(*(pthread_t*)pool->shards[i].thread, NULL);
+        }
+        region_shards_free(pool);
+        fprintf(stderr, "WARNING: Shard threads not started, movement stays serial\n");
+        return false;
+    }
+
+    g_region_shards = pool;
+    printf("Region shards started (%u shards, rebalanced every %u ticks)\n",
+           pool->shard_count, REGION_SHARD_REBALANCE_TICKS);
+    return true;
+}
+
+void region_shards_stop(RegionShards* pool) {
+    if (!pool || !pool->running) return;  /* Never started, or already stopped */
+    if (g_region_shards == pool) g_region_shards = NULL;
+
+    pthread_mutex_lock(SHARD_MUTEX(pool));
+    pool->running = false;
+    pthread_cond_broadcast(SHARD_WAKE(pool));
+    pthread_mutex_unlock(SHARD_MUTEX(pool));
+
+    for (u32 i = 1; i < pool->shard_count; i++) {
+        pthread_join(*(pthread_t*)pool->shards[i].thread, NULL);
+    }
+
+    printf("Region shards stopped (%llu ticks, %llu rebalances)\n",
+           (unsigned long long)pool->ticks, (unsigned long long)pool->rebalances);
+    for (u32 i = 0; i < pool->shard_count; i++) {
+        printf("  shard %u: %llu players stepped, %llu crossed a seam\n", i,
+               (unsigned long long)pool->shards[i].stepped,
+               (unsigned long long)pool->shards[i].crossings);
+    }
+    region_shards_free(pool);
+}
+
+void region_shards_run(RegionShards* pool, const PlayerList* list, const ZoneGrid* grid) {
+    if (!pool || !pool->running || !list || !grid) return;
+
+    if (pool->ticks++ % REGION_SHARD_REBALANCE_TICKS == 0) shard_rebalance(pool, list);
+
+    pool->list = list;
+    pool->grid = grid;
+    for (u32 s = 0; s < pool->shard_count; s++) {
+        pool->shards[s].member_count = 0;
+        movement_batch_clear(&pool->shards[s].batch);
+    }
+
+    /* Too few players to be worth waking anyone: step them all here */
+    if (list->count <= REGION_SHARD_MIN_PLAYERS) {
+        MovementBatch* batch = &pool->shards[0].batch;
+        for (u32 i = 0; i < list->count; i++) {
+            Player* player = list->active[i];
+            u8 flags = player_step_movement(player) ? MOVEMENT_BATCH_RELOAD : 0;
+            if (player->primary_direction != -1) flags |= MOVEMENT_BATCH_MOVED;
+            movement_batch_push(batch, player->index, i, &player->position, flags);
+        }
+        movement_batch_collect(batch, grid);
+        return;
+    }
+
+    for (u32 i = 0; i < list->count; i++) {
+        RegionShard* shard = &pool->shards[pool->owner[shard_square(list->active[i])]];
+        shard->members[shard->member_count++] = (u16)i;
+    }
+
+    pthread_mutex_lock(SHARD_MUTEX(pool));
+    pool->generation++;
+    pool->pending = pool->shard_count - 1;
+    pthread_cond_broadcast(SHARD_WAKE(pool));
+    pthread_mutex_unlock(SHARD_MUTEX(pool));
+
+    shard_step(pool, &pool->shards[0]);
+
+    pthread_mutex_lock(SHARD_MUTEX(pool));
+    while (pool->pending > 0) {
+        pthread_cond_wait(SHARD_DONE(pool), SHARD_MUTEX(pool));
+    }
+    pthread_mutex_unlock(SHARD_MUTEX(pool));
+}
+
+#else /* _WIN32 */
+
+/*
+ * Windows: no shard threads (pthreads unavailable with MSVC).
+ * g_region_shards stays NULL and world_process() moves players serially.
+ */
+bool region_shards_start(RegionShards* pool, u32 shards) {
+    (void)pool; (void)shards;
+    fprintf(stderr, "WARNING: Region sharding not supported on this platform, movement stays serial\n");
+    return false;
+}
+void region_shards_stop(RegionShards* pool) { (void)pool; }
+void region_shards_run(RegionShards* pool, const PlayerList* list, const ZoneGrid* grid) {
+    (void)pool; (void)list; (void)grid;
+}
+
+#endif /* _WIN32 */
+
+void region_shards_merge(const RegionShards* pool, MovementBatch* out) {
+    MovementBatch* batches[REGION_SHARD_MAX];
+    for (u32 s = 0; s < pool->shard_count; s++) batches[s] = &pool->shards[s].batch;
+    movement_batch_merge(out, batches, pool->shard_count);
+}
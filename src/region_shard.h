@@ -0,0 +1,191 @@
+/*******************************************************************************
+ * REGION_SHARD.H - Movement Sharded by Mapsquare
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Spatial partitioning: each thread owns a set of map regions
+ *   - Splitting a step into a private part and a shared part
+ *   - Rebalancing ownership by measured load (greedy bin packing)
+ *   - A serial merge phase that keeps results identical to one thread
+ *
+ * THE PROBLEM:
+ *
+ * Phase 1 of world_process() moves every player, one after another, on
+ * the game thread. Crowds gather in a few places, and the whole world
+ * waits while the game thread steps them all:
+ *
+ *   tick: |varrock ×600|falador ×500|lumbridge ×300| ... |npcs|update|
+ *
+ * THE SOLUTION - SHARD THE MAP, MERGE AT THE SEAMS:
+ *
+ *   bin/rs225 --tick-shards 4
+ *
+ * Every mapsquare (64x64 tiles, position_get_mapsquare_x/z) belongs to
+ * one shard. At the start of the tick each player is filed under the
+ * shard owning the square they stand on, and every shard steps its own
+ * players on its own thread:
+ *
+ *        ┌─────────┬─────────┐
+ *        │ shard 0 │ shard 1 │      GAME THREAD (shard 0)   SHARD THREADS
+ *        │ varrock │ falador │      partition by square
+ *        ├─────────┼─────────┤      wake ───────────────→  step own players
+ *        │ shard 2 │ shard 3 │      step own players       (player_step_movement)
+ *        │ lumbr.  │ draynor │      wait for all   ←─────  done
+ *        └─────────┴─────────┘      MERGE (list order)
+ *                                     reload areas, refile zone grid,
+ *                                     wake NPCs
+ *
+ * Each shard pushes its players into its own MovementBatch and flags the
+ * zone changes there (movement_batch.h), so the merge visits only the
+ * players that moved, reload or change zone.
+ *
+ * WHAT A SHARD MAY TOUCH:
+ *   player_step_movement() reads and writes only the player being moved
+ *   (position, waypoints, directions, run energy). Everything another
+ *   player or the network could see is left to the merge:
+ *     - map_send_load_area() writes the player's out arena and may flush
+ *       it into netio, which has a single producer
+ *     - zone_grid_update() relinks lists shared by every region
+ *     - npc_wake_near() edits the NPC system's awake set
+ *
+ * THE SEAMS:
+ *   A player who walks across a shard border this tick is still moved by
+ *   the shard they started in, and is filed under the new shard from the
+ *   next tick on. Whether players on either side of a seam can see each
+ *   other is decided afterwards by phase 2 from the zone grid, which the
+ *   merge has brought up to date, so the view across a seam is the same
+ *   as anywhere else. The shards' changes are merged back into player
+ *   list order, so packets and NPC wake-ups come out exactly as from the
+ *   serial loop.
+ *
+ * BALANCING:
+ *   A fixed map → shard split would put Varrock and Falador on one core
+ *   by bad luck. Every REGION_SHARD_REBALANCE_TICKS the squares that have
+ *   players are sorted by head count and handed out, busiest first, to
+ *   the shard with the fewest players so far (longest-processing-time
+ *   first). Empty squares keep their owner.
+ *
+ * WHAT STAYS ON ONE THREAD:
+ *   NPC processing shares the zone grid, the changed list and rand()
+ *   across the whole map, and PLAYER_INFO encoding has its own pool
+ *   (update_pool.h); both run as before.
+ *
+ * PLATFORM:
+ *   POSIX threads. On Windows region_shards_start() fails, g_region_shards
+ *   stays NULL and world_process() moves players serially.
+ *
+ ******************************************************************************/
+
+#ifndef REGION_SHARD_H
+#define REGION_SHARD_H
+
+#include "types.h"
+#include "player.h"
+#include "player_list.h"
+#include "movement_batch.h"
+#include "zone_grid.h"
+#include <stdbool.h>
+
+/* Upper bound on shards (one thread each, the first is the game thread;
+ * one batch each for movement_batch_merge) */
+#define REGION_SHARD_MAX MOVEMENT_BATCH_MERGE_MAX
+
+/* Mapsquares per axis covered by the owner table (x >> 6 for x < 16384) */
+#define REGION_SHARD_SQUARES 256
+
+/* Ticks between reassignments of squares to shards (one minute) */
+#define REGION_SHARD_REBALANCE_TICKS 100
+
+/* At or below this many players, waking the shards costs more than it saves */
+#define REGION_SHARD_MIN_PLAYERS 64
+
+/*
+ * RegionShard - One shard's players for the current tick
+ */
+typedef struct {
+    u16* members;               /* List positions of the players on this
+                                   shard's squares, ascending */
+    u32 member_count;
+    MovementBatch batch;        /* This tick's steps and their changes */
+    u64 stepped;                /* Players this shard has moved */
+    u64 crossings;              /* ... that ended their step on another shard */
+    void* thread;               /* pthread_t (NULL for shards[0]) */
+    struct RegionShards* pool;
+} RegionShard;
+
+/*
+ * RegionShards - Square ownership plus the shard threads
+ *
+ * owner is written by the game thread between runs; during a run each
+ * shard writes only its own batch and its own members' state.
+ */
+typedef struct RegionShards {
+    RegionShard* shards;
+    u32 shard_count;
+    u8* owner;                  /* Shard per square, [square_x * SQUARES + square_z] */
+    u16* load;                  /* Players per square (rebalance scratch) */
+    const PlayerList* list;     /* List of the current run */
+    const ZoneGrid* grid;       /* ... and the grid it is filed in (read) */
+    u64 ticks;
+    u64 rebalances;
+
+    u32 generation;             /* Bumped once per region_shards_run() */
+    u32 pending;                /* Shard threads still on this generation */
+    bool running;
+    void* mutex;                /* pthread_mutex_t (opaque, as in netio.h) */
+    void* wake;                 /* pthread_cond_t: new generation / stop */
+    void* done;                 /* pthread_cond_t: pending reached zero */
+} RegionShards;
+
+/*
+ * g_region_shards - Running shards, or NULL (players move serially)
+ */
+extern RegionShards* g_region_shards;
+
+/*
+ * region_shards_start - Start shards - 1 threads
+ *
+ * @param pool    Zeroed RegionShards to initialize
+ * @param shards  Shards including the game thread (2 or more, capped at
+ *                REGION_SHARD_MAX and the online CPU count)
+ * @return        true on success; sets g_region_shards
+ */
+bool region_shards_start(RegionShards* pool, u32 shards);
+
+/*
+ * region_shards_stop - Stop and join the shard threads
+ *
+ * Safe to call more than once. Clears g_region_shards.
+ */
+void region_shards_stop(RegionShards* pool);
+
+/*
+ * region_shards_run - Step every active player, each on its square's shard
+ *
+ * @param pool  Running shards
+ * @param list  World player list (active players are stepped)
+ * @param grid  Zone grid the players are filed in (only read)
+ *
+ * Calls player_step_movement() for each active player and pushes the
+ * result into its shard's batch, then collects each batch's changes on
+ * the shard's thread. The caller merges them back into list order with
+ * region_shards_merge(): player_reload_area() for MOVEMENT_BATCH_RELOAD,
+ * then the zone grid and NPC wake-ups for MOVEMENT_BATCH_ZONE.
+ *
+ * COMPLEXITY: O(players / shards) per tick plus O(squares log squares)
+ *             every REGION_SHARD_REBALANCE_TICKS
+ */
+void region_shards_run(RegionShards* pool, const PlayerList* list, const ZoneGrid* grid);
+
+/*
+ * region_shards_merge - Every shard's changes of the last run, list order
+ *
+ * @param pool  Shards after region_shards_run()
+ * @param out   Batch with room for MAX_PLAYERS changes (out->changes)
+ *
+ * COMPLEXITY: O(changes * shards)
+ */
+void region_shards_merge(const RegionShards* pool, MovementBatch* out);
+
+#endif /* REGION_SHARD_H */
@@ -0,0 +1,311 @@
+/*******************************************************************************
+ * REPLAY.C - Replay Log Writer, Reader and Output Digest
+ *******************************************************************************
+ *
+ * See replay.h for the format and what is recorded where. The replay
+ * driver itself is server_replay() in server.c, next to the tick it
+ * drives.
+ *
+ * WRITING:
+ *
+ *   Each record is assembled in a stack buffer and handed to a FILE*
+ *   with a REPLAY_WRITE_BUFFER buffer, so a tick's records cost one
+ *   write() per 64 KB instead of one per packet. The buffer is flushed
+ *   at close (server shutdown); a crash loses at most its contents.
+ *
+ ******************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "replay.h"
+#include "constants.h"
+#include "player_save.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+Replay g_replay;
+
+#define FILE_MAGIC      0x52535250u     /* "RSRP" */
+#define FILE_VERSION    1
+#define FILE_HEADER     8
+
+/* stdio buffer for the recording */
+#define REPLAY_WRITE_BUFFER (64 * 1024)
+
+/* Largest record: PACKET framing (1 + 2 + 1 + 5) plus a full packet */
+#define RECORD_MAX (9 + MAX_PACKET_SIZE)
+
+/* FNV-1a 64 */
+#define DIGEST_OFFSET   0xCBF29CE484222325ull
+#define DIGEST_PRIME    0x100000001B3ull
+
+static void put_u16(u8* p, u32 value) {
+    p[0] = (u8)(value >> 8);
+    p[1] = (u8)value;
+}
+
+static void put_u32(u8* p, u32 value) {
+    p[0] = (u8)(value >> 24);
+    p[1] = (u8)(value >> 16);
+    p[2] = (u8)(value >> 8);
+    p[3] = (u8)value;
+}
+
+static u32 get_u16(const u8* p) {
+    return ((u32)p[0] << 8) | p[1];
+}
+
+static u32 get_u32(const u8* p) {
+    return ((u32)p[0] << 24) | ((u32)p[1] << 16) | ((u32)p[2] << 8) | p[3];
+}
+
+/* LEB128: 7 bits per byte, high bit = more follows */
+static u32 put_varint(u8* p, u32 value) {
+    u32 n = 0;
+    while (value >= 0x80) {
+        p[n++] = (u8)(value | 0x80);
+        value >>= 7;
+    }
+    p[n++] = (u8)value;
+    return n;
+}
+
+/*******************************************************************************
+ * RECORDING
+ ******************************************************************************/
+
+bool replay_record_open(const char* path) {
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        perror(path);
+        return false;
+    }
+    setvbuf(file, NULL, _IOFBF, REPLAY_WRITE_BUFFER);
+
+    u8 header[FILE_HEADER];
+    put_u32(header, FILE_MAGIC);
+    put_u32(header + 4, FILE_VERSION);
+    fwrite(header, 1, sizeof(header), file);
+
+    g_replay.file = file;
+    g_replay.last_tick = 0;
+    g_replay.records = 0;
+    g_replay.recording = true;
+    printf("Recording client traffic to %s\n", path);
+    return true;
+}
+
+void replay_record_close(void) {
+    if (!g_replay.file) return;
+    fclose((FILE*)g_replay.file);
+    printf("Recording closed: %llu records\n", (unsigned long long)g_replay.records);
+    g_replay.file = NULL;
+    g_replay.recording = false;
+}
+
+static void record_write(const u8* record, u32 length) {
+    if (fwrite(record, 1, length, (FILE*)g_replay.file) != length) {
+        /* Disk full or similar: a partial log is worse than a short one */
+        fprintf(stderr, "WARNING: Replay recording failed, stopped\n");
+        replay_record_close();
+        return;
+    }
+    g_replay.records++;
+}
+
+void replay_record_tick(u32 tick) {
+    u8 record[6];
+    record[0] = REPLAY_TICK;
+    u32 n = 1 + put_varint(record + 1, tick - g_replay.last_tick);
+    g_replay.last_tick = tick;
+    record_write(record, n);
+}
+
+void replay_record_world(void) {
+    u8 record = REPLAY_WORLD;
+    record_write(&record, 1);
+}
+
+void replay_record_accept(u32 slot, const u32 seeds[4], const char* username) {
+    u8 record[4 + 16 + MAX_USERNAME_LENGTH];
+    u32 name_len = (u32)strnlen(username, MAX_USERNAME_LENGTH);
+    record[0] = REPLAY_ACCEPT;
+    put_u16(record + 1, slot);
+    for (u32 i = 0; i < 4; i++) put_u32(record + 3 + i * 4, seeds[i]);
+    record[19] = (u8)name_len;
+    memcpy(record + 20, username, name_len);
+    record_write(record, 20 + name_len);
+}
+
+void replay_record_complete(u32 slot, const u8* save, u32 size) {
+    u8 record[5 + PLAYER_SAVE_MAX_SIZE];
+    if (!save || size > PLAYER_SAVE_MAX_SIZE) size = 0;
+    record[0] = REPLAY_COMPLETE;
+    put_u16(record + 1, slot);
+    put_u16(record + 3, size);
+    if (size) memcpy(record + 5, save, size);
+    record_write(record, 5 + size);
+}
+
+void replay_record_packet(u32 slot, u8 opcode, const u8* payload, u32 length) {
+    u8 record[RECORD_MAX];
+    if (length > MAX_PACKET_SIZE) return;  /* Never framed by the server */
+    record[0] = REPLAY_PACKET;
+    put_u16(record + 1, slot);
+    record[3] = opcode;
+    u32 n = 4 + put_varint(record + 4, length);
+    memcpy(record + n, payload, length);
+    record_write(record, n + length);
+}
+
+void replay_record_disconnect(u32 slot) {
+    u8 record[3];
+    record[0] = REPLAY_DISCONNECT;
+    put_u16(record + 1, slot);
+    record_write(record, sizeof(record));
+}
+
+/*******************************************************************************
+ * READING
+ ******************************************************************************/
+
+bool replay_log_open(ReplayLog* log, const char* path) {
+    memset(log, 0, sizeof(*log));
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        perror(path);
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (size < FILE_HEADER || size > 0x7FFFFFFFL) {
+        fprintf(stderr, "%s: not a replay log\n", path);
+        fclose(file);
+        return false;
+    }
+
+    log->data = malloc((size_t)size);
+    if (!log->data || fread(log->data, 1, (size_t)size, file) != (size_t)size) {
+        fprintf(stderr, "%s: read failed\n", path);
+        fclose(file);
+        replay_log_close(log);
+        return false;
+    }
+    fclose(file);
+
+    if (get_u32(log->data) != FILE_MAGIC || get_u32(log->data + 4) != FILE_VERSION) {
+        fprintf(stderr, "%s: not a version %u replay log\n", path, FILE_VERSION);
+        replay_log_close(log);
+        return false;
+    }
+    log->size = (u32)size;
+    log->pos = FILE_HEADER;
+
+    /* A new replay: a new digest */
+    g_replay.digest = DIGEST_OFFSET;
+    g_replay.output_bytes = 0;
+    g_replay.saves = 0;
+    return true;
+}
+
+/* Bounds-checked reads: false once the record would run past the end */
+static bool take(ReplayLog* log, u32 n, const u8** out) {
+    if (log->size - log->pos < n) return false;
+    *out = log->data + log->pos;
+    log->pos += n;
+    return true;
+}
+
+static bool take_varint(ReplayLog* log, u32* value) {
+    *value = 0;
+    for (u32 shift = 0; shift < 35; shift += 7) {
+        const u8* b;
+        if (!take(log, 1, &b)) return false;
+        *value |= (u32)(*b & 0x7F) << shift;
+        if (!(*b & 0x80)) return true;
+    }
+    return false;
+}
+
+bool replay_log_next(ReplayLog* log, ReplayRecord* record) {
+    const u8* p;
+    u32 start = log->pos;
+    if (!take(log, 1, &p)) return false;
+
+    memset(record, 0, sizeof(*record));
+    record->kind = (ReplayKind)*p;
+    bool ok = true;
+
+    switch (record->kind) {
+        case REPLAY_TICK: {
+            u32 delta;
+            ok = take_varint(log, &delta);
+            log->tick += delta;
+            record->tick = log->tick;
+            break;
+        }
+        case REPLAY_WORLD:
+            break;
+        case REPLAY_ACCEPT: {
+            ok = take(log, 19, &p) && p[18] <= MAX_USERNAME_LENGTH;
+            if (!ok) break;
+            record->slot = get_u16(p);
+            for (u32 i = 0; i < 4; i++) record->seeds[i] = get_u32(p + 2 + i * 4);
+            u32 name_len = p[18];
+            ok = take(log, name_len, &p);
+            if (ok) memcpy(record->username, p, name_len);
+            break;
+        }
+        case REPLAY_COMPLETE:
+            ok = take(log, 4, &p);
+            if (!ok) break;
+            record->slot = get_u16(p);
+            record->length = get_u16(p + 2);
+            ok = take(log, record->length, &record->data);
+            break;
+        case REPLAY_PACKET:
+            ok = take(log, 3, &p);
+            if (!ok) break;
+            record->slot = get_u16(p);
+            record->opcode = p[2];
+            ok = take_varint(log, &record->length) && record->length <= MAX_PACKET_SIZE &&
+                 take(log, record->length, &record->data);
+            break;
+        case REPLAY_DISCONNECT:
+            ok = take(log, 2, &p);
+            if (ok) record->slot = get_u16(p);
+            break;
+        default:
+            ok = false;
+            break;
+    }
+
+    if (!ok || record->slot >= MAX_PLAYERS) {
+        fprintf(stderr, "WARNING: Replay log ends in a damaged record at byte %u\n", start);
+        log->pos = log->size;
+        return false;
+    }
+    return true;
+}
+
+void replay_log_close(ReplayLog* log) {
+    free(log->data);
+    memset(log, 0, sizeof(*log));
+}
+
+/*******************************************************************************
+ * DIGEST
+ ******************************************************************************/
+
+void replay_digest_output(u32 slot, const u8* data, u32 length) {
+    u64 h = g_replay.digest;
+    h = (h ^ (slot & 0xFF)) * DIGEST_PRIME;
+    h = (h ^ (slot >> 8)) * DIGEST_PRIME;
+    for (u32 i = 0; i < length; i++) {
+        h = (h ^ data[i]) * DIGEST_PRIME;
+    }
+    g_replay.digest = h;
+    g_replay.output_bytes += length;
+}
@@ -0,0 +1,204 @@
+/*******************************************************************************
+ * REPLAY.H - Recording Client Traffic and Replaying It Deterministically
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Record/replay: capture a system's inputs, not its state
+ *   - Choosing the recording point so a replay needs no network at all
+ *   - Digests as a cheap determinism check between two runs
+ *   - Compact binary logs (one-byte tags, varints)
+ *
+ * THE PROBLEM:
+ *
+ * A change to movement, PLAYER_INFO or the packet handlers can only be
+ * judged for speed under load, and real load is what players do: a
+ * synthetic bench (bench/hotpath_bench.c) or bots (bench/loadbot.c) never
+ * quite look like it. Live traffic cannot be rerun, so a regression is
+ * found after the deploy.
+ *
+ * THE SOLUTION - RECORD DECODED INPUT, REPLAY IT WITHOUT SOCKETS:
+ *
+ *   live (--record FILE)                 replay (--replay FILE)
+ *   ─────────────────────                ─────────────────────────────
+ *   server_tick starts   → TICK          TICK   → server_tick()
+ *   server_handle_packet → PACKET        PACKET → server_handle_packet()
+ *   packets done         → WORLD         WORLD  → world_process() ...
+ *   login_accept         → ACCEPT        ACCEPT → login_accept()
+ *   login_complete       → COMPLETE      COMPLETE → login_complete() +
+ *   player_disconnect    → DISCONNECT               initial packets
+ *                                        DISCONNECT → player_disconnect()
+ *
+ *   Packets are recorded after framing, ISAAC and the rate limit: the
+ *   replay hands each one to the same handler, in the same tick and the
+ *   same order, with no socket, cipher state or token bucket involved.
+ *   Logins are recorded as the ISAAC seeds (never the password) and the
+ *   save bytes the login was completed with, so a replay does not depend
+ *   on the save files on disk.
+ *
+ * THE REPLAY:
+ *
+ *   server_init(server, 0) builds the world as usual but binds no port.
+ *   Each replayed connection gets a /dev/null descriptor as its socket,
+ *   so every "is this player connected" check behaves as live, and
+ *   player_flush() folds the bytes into a digest instead of sending them:
+ *
+ *     digest = FNV-1a over (slot, bytes) of every flush, in flush order
+ *
+ *   Saves are counted and dropped (they carry wall-clock login times and
+ *   must not overwrite real accounts). rand() is seeded with
+ *   REPLAY_RAND_SEED before the world is built, so NPC wandering repeats.
+ *
+ *   Two replays of one log on one build give the same digest; a candidate
+ *   build that gives another digest changed behaviour, not just speed.
+ *   The digest is printed every REPLAY_DIGEST_INTERVAL ticks, so the
+ *   first tick where two builds diverge can be found by diffing output.
+ *   Tick work times go through tick_stats (the usual windowed report)
+ *   and a closing summary with percentiles.
+ *
+ *   Digests compare replays with each other, not with the live run: live
+ *   output also holds the pre-login handshake, and live NPCs drew from a
+ *   rand() that login seeding had touched.
+ *
+ * FILE FORMAT (big-endian, varint = LEB128, 7 bits per byte):
+ *
+ *   header:      [magic:4 "RSRP"][version:4]
+ *   TICK:        [1][tick delta:varint]     first delta is from tick 0
+ *   WORLD:       [2]
+ *   ACCEPT:      [3][slot:2][seeds:4x4][name_len:1][name]
+ *   COMPLETE:    [4][slot:2][save_size:2][save]     size 0 = new player
+ *   PACKET:      [5][slot:2][opcode:1][length:varint][payload]
+ *   DISCONNECT:  [6][slot:2]
+ *
+ *   A typical packet costs 5 bytes of framing plus its payload. A log cut
+ *   short by a crash replays up to its last whole record.
+ *
+ * THREADS:
+ *   Every recording hook runs on the game thread (packets are handled
+ *   and logins completed there in every mode), so the file needs no lock.
+ *
+ ******************************************************************************/
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "types.h"
+#include <stdbool.h>
+
+/* rand() seed for replays (the live server seeds from the clock) */
+#define REPLAY_RAND_SEED 225
+
+/* Ticks between digest lines during a replay */
+#define REPLAY_DIGEST_INTERVAL 100
+
+typedef enum {
+    REPLAY_TICK = 1,            /* server_tick() started */
+    REPLAY_WORLD = 2,           /* Tick's packets done, world_process() next */
+    REPLAY_ACCEPT = 3,          /* login_accept(): username and ISAAC seeds */
+    REPLAY_COMPLETE = 4,        /* login_complete(): save bytes */
+    REPLAY_PACKET = 5,          /* Handled client packet */
+    REPLAY_DISCONNECT = 6       /* player_disconnect() */
+} ReplayKind;
+
+/*
+ * ReplayRecord - One decoded record (data points into the loaded log)
+ */
+typedef struct {
+    ReplayKind kind;
+    u32 tick;                   /* TICK: absolute tick number */
+    u32 slot;                   /* Player slot (not the PID) */
+    u8 opcode;                  /* PACKET */
+    u32 length;                 /* PACKET payload / COMPLETE save bytes */
+    const u8* data;
+    u32 seeds[4];               /* ACCEPT */
+    char username[MAX_USERNAME_LENGTH + 1];
+} ReplayRecord;
+
+/*
+ * ReplayLog - A log loaded for reading
+ */
+typedef struct {
+    u8* data;
+    u32 size;
+    u32 pos;                    /* Next record */
+    u32 tick;                   /* Last TICK read */
+} ReplayLog;
+
+/*
+ * Replay - Recorder and replay state
+ */
+typedef struct {
+    bool recording;             /* --record: the hooks append records */
+    bool replaying;             /* --replay: output digested, saves dropped */
+    void* file;                 /* FILE* being recorded */
+    u32 last_tick;              /* Previous TICK (delta base) */
+    u64 records;                /* Records written */
+
+    ReplayLog log;              /* Log being replayed */
+    u64 digest;                 /* FNV-1a of (slot, output) in flush order */
+    u64 output_bytes;
+    u64 saves;                  /* Saves dropped */
+    u64 logins;                 /* Logins completed */
+    u64 packets;                /* Packets handled */
+} Replay;
+
+extern Replay g_replay;
+
+/*
+ * replay_record_open - Start recording to a file (--record)
+ *
+ * @param path  Log file (created or truncated)
+ * @return      false if the file could not be opened
+ */
+bool replay_record_open(const char* path);
+
+/*
+ * replay_record_close - Flush and close the recording (NULL-safe if off)
+ */
+void replay_record_close(void);
+
+/*
+ * Recording hooks - call only while g_replay.recording
+ */
+void replay_record_tick(u32 tick);
+void replay_record_world(void);
+void replay_record_accept(u32 slot, const u32 seeds[4], const char* username);
+void replay_record_complete(u32 slot, const u8* save, u32 size);
+void replay_record_packet(u32 slot, u8 opcode, const u8* payload, u32 length);
+void replay_record_disconnect(u32 slot);
+
+/*
+ * replay_log_open - Load a whole log for reading
+ *
+ * @param log   Receives the log
+ * @param path  Log file
+ * @return      false if missing, unreadable or not a replay log
+ *
+ * Also resets g_replay's digest and counters for the run.
+ */
+bool replay_log_open(ReplayLog* log, const char* path);
+
+/*
+ * replay_log_next - Decode the next record
+ *
+ * @param log     Open log
+ * @param record  Receives the record
+ * @return        false at the end of the log (or at a torn last record)
+ */
+bool replay_log_next(ReplayLog* log, ReplayRecord* record);
+
+/*
+ * replay_log_close - Free a loaded log
+ */
+void replay_log_close(ReplayLog* log);
+
+/*
+ * replay_digest_output - Fold a connection's flushed bytes into the digest
+ *
+ * @param slot    Player slot
+ * @param data    Bytes that would have been sent
+ * @param length  Byte count
+ */
+void replay_digest_output(u32 slot, const u8* data, u32 length);
+
+#endif /* REPLAY_H */
@@ -0,0 +1,610 @@
+/*******************************************************************************
+ * RSA_KEY.C - Server Private Key Implementation
+ *******************************************************************************
+ *
+ * See rsa_key.h for the math and the key file format.
+ *
+ * NUMBERS:
+ *
+ *   Little-endian arrays of u32 limbs with an explicit length; products
+ *   go through u64. Every buffer is a fixed-size stack array (at most
+ *   2 * RSA_MAX_LIMBS + 1 limbs), so nothing here allocates after load.
+ *
+ * LOAD-TIME HELPERS:
+ *
+ *   big_mod() reduces bit by bit (shift left, subtract if >= m). It is
+ *   far too slow for the hot path but only derives dP, dQ, R^2 and q mod p
+ *   when the key is loaded. qInv comes from Fermat, q^(p-2) mod p, with
+ *   the same Montgomery exponentiation the decryption uses, so no
+ *   extended Euclid is needed.
+ *
+ ******************************************************************************/
+
+#include "rsa_key.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+RsaKey* g_rsa_key = NULL;
+
+/* Exponent window (table of 2^WINDOW_BITS powers) */
+#define WINDOW_BITS 4
+#define WINDOW_SIZE (1u << WINDOW_BITS)
+
+/* Largest key file accepted */
+#define KEY_FILE_MAX 16384
+
+/*******************************************************************************
+ * MULTI-PRECISION HELPERS
+ ******************************************************************************/
+
+static int big_cmp(const u32* a, const u32* b, u32 n) {
+    for (u32 i = n; i-- > 0;) {
+        if (a[i] != b[i]) return a[i] > b[i] ? 1 : -1;
+    }
+    return 0;
+}
+
+static bool big_is_zero(const u32* a, u32 n) {
+    u32 acc = 0;
+    for (u32 i = 0; i < n; i++) acc |= a[i];
+    return acc == 0;
+}
+
+/* r = a - b, returns the borrow (r may alias a or b) */
+static u32 big_sub(u32* r, const u32* a, const u32* b, u32 n) {
+    u64 borrow = 0;
+    for (u32 i = 0; i < n; i++) {
+        u64 d = (u64)a[i] - b[i] - borrow;
+        r[i] = (u32)d;
+        borrow = (d >> 32) & 1;
+    }
+    return (u32)borrow;
+}
+
+/* r = a + b, returns the carry (r may alias a or b) */
+static u32 big_add(u32* r, const u32* a, const u32* b, u32 n) {
+    u64 carry = 0;
+    for (u32 i = 0; i < n; i++) {
+        u64 s = (u64)a[i] + b[i] + carry;
+        r[i] = (u32)s;
+        carry = s >> 32;
+    }
+    return (u32)carry;
+}
+
+/* Limbs up to and including the most significant non-zero one */
+static u32 big_limbs(const u32* a, u32 n) {
+    while (n > 0 && a[n - 1] == 0) n--;
+    return n;
+}
+
+static u32 big_bits(const u32* a, u32 n) {
+    n = big_limbs(a, n);
+    if (n == 0) return 0;
+    u32 top = a[n - 1];
+    u32 bits = 0;
+    while (top) {
+        bits++;
+        top >>= 1;
+    }
+    return (n - 1) * 32 + bits;
+}
+
+/* r[an + bn] = a * b (schoolbook; r must not alias a or b) */
+static void big_mul(u32* r, const u32* a, u32 an, const u32* b, u32 bn) {
+    memset(r, 0, (an + bn) * sizeof(u32));
+    for (u32 i = 0; i < bn; i++) {
+        u64 carry = 0;
+        for (u32 j = 0; j < an; j++) {
+            u64 t = (u64)a[j] * b[i] + r[i + j] + carry;
+            r[i + j] = (u32)t;
+            carry = t >> 32;
+        }
+        r[i + an] = (u32)carry;
+    }
+}
+
+/*
+ * big_mod - r[mn] = a[an] mod m[mn], one bit at a time (load time only)
+ *
+ * r stays below m; a shift that carries out of the top limb is still
+ * >= m, and the wrapped subtraction gives the right residue.
+ */
+static void big_mod(u32* r, const u32* a, u32 an, const u32* m, u32 mn) {
+    memset(r, 0, mn * sizeof(u32));
+    for (u32 bit = an * 32; bit-- > 0;) {
+        u32 carry = (a[bit / 32] >> (bit % 32)) & 1;
+        for (u32 i = 0; i < mn; i++) {
+            u32 top = r[i] >> 31;
+            r[i] = (r[i] << 1) | carry;
+            carry = top;
+        }
+        if (carry || big_cmp(r, m, mn) >= 0) {
+            big_sub(r, r, m, mn);
+        }
+    }
+}
+
+/*
+ * from_bytes - Big-endian bytes into n limbs
+ *
+ * @return  false if the value needs more than n limbs
+ */
+static bool from_bytes(u32* r, u32 n, const u8* in, u32 len) {
+    memset(r, 0, n * sizeof(u32));
+    while (len > 0 && in[0] == 0) {
+        in++;
+        len--;
+    }
+    if (len > n * 4) return false;
+    for (u32 i = 0; i < len; i++) {
+        u32 pos = len - 1 - i;  /* Byte significance */
+        r[pos / 4] |= (u32)in[i] << ((pos % 4) * 8);
+    }
+    return true;
+}
+
+/*
+ * to_bytes - n limbs to big-endian bytes without leading zeros
+ *
+ * @return  Bytes written, or -1 if out is too small
+ */
+static i32 to_bytes(const u32* a, u32 n, u8* out, u32 out_cap) {
+    u32 len = (big_bits(a, n) + 7) / 8;
+    if (len > out_cap) return -1;
+    for (u32 i = 0; i < len; i++) {
+        u32 pos = len - 1 - i;
+        out[i] = (u8)(a[pos / 4] >> ((pos % 4) * 8));
+    }
+    return (i32)len;
+}
+
+/*******************************************************************************
+ * MONTGOMERY ARITHMETIC
+ ******************************************************************************/
+
+/*
+ * mont_mul - r = a * b * R^-1 mod m (CIOS: multiply and reduce per limb)
+ *
+ * a, b < m (or a < R with b < m); r may alias a or b.
+ */
+static void mont_mul(const MontContext* ctx, u32* r, const u32* a, const u32* b) {
+    const u32 k = ctx->limbs;
+    u32 t[RSA_HALF_LIMBS + 2];
+    memset(t, 0, (k + 2) * sizeof(u32));
+
+    for (u32 i = 0; i < k; i++) {
+        /* t += a * b[i] */
+        u64 carry = 0;
+        for (u32 j = 0; j < k; j++) {
+            u64 s = (u64)a[j] * b[i] + t[j] + carry;
+            t[j] = (u32)s;
+            carry = s >> 32;
+        }
+        u64 s = (u64)t[k] + carry;
+        t[k] = (u32)s;
+        t[k + 1] = (u32)(s >> 32);
+
+        /* t = (t + u * m) / 2^32, with u chosen to zero the low limb */
+        u32 u = t[0] * ctx->m_inv;
+        s = (u64)u * ctx->m[0] + t[0];
+        carry = s >> 32;
+        for (u32 j = 1; j < k; j++) {
+            s = (u64)u * ctx->m[j] + t[j] + carry;
+            t[j - 1] = (u32)s;
+            carry = s >> 32;
+        }
+        s = (u64)t[k] + carry;
+        t[k - 1] = (u32)s;
+        t[k] = t[k + 1] + (u32)(s >> 32);
+    }
+
+    /* t < 2m: one conditional subtraction */
+    if (t[k] != 0 || big_cmp(t, ctx->m, k) >= 0) {
+        big_sub(r, t, ctx->m, k);
+    } else {
+        memcpy(r, t, k * sizeof(u32));
+    }
+}
+
+/*
+ * mont_reduce - r = x * R^-1 mod m for a double-width x < m * R
+ */
+static void mont_reduce(const MontContext* ctx, u32* r, const u32* x) {
+    const u32 k = ctx->limbs;
+    u32 t[2 * RSA_HALF_LIMBS + 1];
+    memcpy(t, x, 2 * k * sizeof(u32));
+    t[2 * k] = 0;
+
+    for (u32 i = 0; i < k; i++) {
+        u32 u = t[i] * ctx->m_inv;
+        u64 carry = 0;
+        for (u32 j = 0; j < k; j++) {
+            u64 s = (u64)u * ctx->m[j] + t[i + j] + carry;
+            t[i + j] = (u32)s;
+            carry = s >> 32;
+        }
+        for (u32 j = i + k; carry != 0 && j <= 2 * k; j++) {
+            u64 s = (u64)t[j] + carry;
+            t[j] = (u32)s;
+            carry = s >> 32;
+        }
+    }
+
+    if (t[2 * k] != 0 || big_cmp(t + k, ctx->m, k) >= 0) {
+        big_sub(r, t + k, ctx->m, k);
+    } else {
+        memcpy(r, t + k, k * sizeof(u32));
+    }
+}
+
+/*
+ * table_select - r = table[index], reading every entry (no secret-indexed load)
+ */
+static void table_select(u32* r, const u32 table[WINDOW_SIZE][RSA_HALF_LIMBS], u32 index, u32 k) {
+    memset(r, 0, k * sizeof(u32));
+    for (u32 w = 0; w < WINDOW_SIZE; w++) {
+        u32 mask = (u32)0 - (u32)(w == index);
+        for (u32 i = 0; i < k; i++) r[i] |= table[w][i] & mask;
+    }
+}
+
+/*
+ * mont_exp - r = base^exp in Montgomery form (base in Montgomery form)
+ *
+ * exp has ctx->limbs limbs; every window is processed (see rsa_key.h).
+ */
+static void mont_exp(const MontContext* ctx, u32* r, const u32* base, const u32* exp) {
+    const u32 k = ctx->limbs;
+    static const u32 one[RSA_HALF_LIMBS] = { 1 };
+    u32 table[WINDOW_SIZE][RSA_HALF_LIMBS];
+    u32 factor[RSA_HALF_LIMBS];
+    u32 acc[RSA_HALF_LIMBS];
+
+    mont_mul(ctx, table[0], ctx->r2, one);  /* R mod m: 1 in Montgomery form */
+    memcpy(table[1], base, k * sizeof(u32));
+    for (u32 w = 2; w < WINDOW_SIZE; w++) {
+        mont_mul(ctx, table[w], table[w - 1], base);
+    }
+
+    memcpy(acc, table[0], k * sizeof(u32));
+    for (u32 bit = k * 32; bit > 0; bit -= WINDOW_BITS) {
+        for (u32 s = 0; s < WINDOW_BITS; s++) mont_mul(ctx, acc, acc, acc);
+        u32 shift = bit - WINDOW_BITS;
+        u32 window = (exp[shift / 32] >> (shift % 32)) & (WINDOW_SIZE - 1);
+        table_select(factor, table, window, k);
+        mont_mul(ctx, acc, acc, factor);
+    }
+    memcpy(r, acc, k * sizeof(u32));
+}
+
+/*
+ * mont_init - Precompute the context for an odd modulus of k limbs
+ */
+static void mont_init(MontContext* ctx, const u32* m, u32 k) {
+    memset(ctx, 0, sizeof(MontContext));
+    ctx->limbs = k;
+    memcpy(ctx->m, m, k * sizeof(u32));
+
+    /* m^-1 mod 2^32 by Newton's iteration (each step doubles the bits) */
+    u32 inv = m[0];
+    for (u32 i = 0; i < 5; i++) inv *= 2 - m[0] * inv;
+    ctx->m_inv = (u32)0 - inv;
+
+    /* R^2 = 2^(64k) mod m */
+    u32 r2_wide[2 * RSA_HALF_LIMBS + 1];
+    memset(r2_wide, 0, sizeof(r2_wide));
+    r2_wide[2 * k] = 1;
+    big_mod(ctx->r2, r2_wide, 2 * k + 1, m, k);
+
+    /* R^3 = mont_mul(R^2, R^2) */
+    mont_mul(ctx, ctx->r3, ctx->r2, ctx->r2);
+}
+
+/*
+ * mont_enter - Double-width x < m * R to Montgomery form x * R mod m
+ */
+static void mont_enter(const MontContext* ctx, u32* r, const u32* x) {
+    mont_reduce(ctx, r, x);             /* x * R^-1 */
+    mont_mul(ctx, r, r, ctx->r3);       /* x * R^-1 * R^3 * R^-1 = x * R */
+}
+
+/*******************************************************************************
+ * KEY FILE
+ ******************************************************************************/
+
+/*
+ * parse_number - Decimal or 0x-hex digits into n limbs
+ *
+ * @return  false on a bad digit, no digits, or a value over n limbs
+ */
+static bool parse_number(const char* s, u32* r, u32 n) {
+    memset(r, 0, n * sizeof(u32));
+    u32 base = 10;
+    if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) {
+        base = 16;
+        s += 2;
+    }
+
+    u32 digits = 0;
+    for (; *s && !isspace((unsigned char)*s) && *s != '#'; s++) {
+        u32 digit;
+        if (*s >= '0' && *s <= '9') digit = (u32)(*s - '0');
+        else if (*s >= 'a' && *s <= 'f') digit = (u32)(*s - 'a' + 10);
+        else if (*s >= 'A' && *s <= 'F') digit = (u32)(*s - 'A' + 10);
+        else return false;
+        if (digit >= base) return false;
+
+        u64 carry = digit;  /* r = r * base + digit */
+        for (u32 i = 0; i < n; i++) {
+            u64 t = (u64)r[i] * base + carry;
+            r[i] = (u32)t;
+            carry = t >> 32;
+        }
+        if (carry != 0) return false;
+        digits++;
+    }
+    while (*s && isspace((unsigned char)*s)) s++;
+    return digits > 0 && (*s == '\0' || *s == '#');
+}
+
+/* One name = value field of the key file */
+typedef struct {
+    const char* name;
+    u32* value;
+    u32 limbs;
+    bool found;
+} KeyField;
+
+static bool parse_line(char* line, KeyField* fields, u32 count) {
+    char* eq = strchr(line, '=');
+    if (!eq) return false;
+    *eq = '\0';
+
+    char* name = line;
+    while (isspace((unsigned char)*name)) name++;
+    char* end = eq;
+    while (end > name && isspace((unsigned char)end[-1])) *--end = '\0';
+    char* value = eq + 1;
+    while (isspace((unsigned char)*value)) value++;
+
+    for (u32 i = 0; i < count; i++) {
+        if (strcmp(name, fields[i].name) == 0) {
+            if (!parse_number(value, fields[i].value, fields[i].limbs)) {
+                fprintf(stderr, "RSA key: bad value for '%s'\n", name);
+                return false;
+            }
+            fields[i].found = true;
+            return true;
+        }
+    }
+    fprintf(stderr, "RSA key: unknown field '%s'\n", name);
+    return false;
+}
+
+/*
+ * rsa_key_check - Encrypt then decrypt a test block with the public exponent
+ */
+static bool rsa_key_check(const RsaKey* key, u32 e) {
+    u8 message[RSA_MAX_BYTES];
+    u8 cipher[RSA_MAX_BYTES];
+    u8 plain[RSA_MAX_BYTES];
+
+    /* Shaped like a login block: opcode 10 then bytes, below n */
+    u32 len = key->bits / 8 - 1;
+    message[0] = 10;
+    for (u32 i = 1; i < len; i++) message[i] = (u8)(i * 37 + 11);
+
+    i32 clen = rsa_key_encrypt(key, e, message, len, cipher, sizeof(cipher));
+    if (clen < 0) return false;
+    i32 plen = rsa_key_decrypt(key, cipher, (u32)clen, plain, sizeof(plain));
+    return plen == (i32)len && memcmp(plain, message, len) == 0;
+}
+
+bool rsa_key_parse(RsaKey* key, const char* text) {
+    u32 p[RSA_MAX_LIMBS], q[RSA_MAX_LIMBS], d[RSA_MAX_LIMBS], e[1];
+    KeyField fields[] = {
+        { "p", p, RSA_MAX_LIMBS, false },
+        { "q", q, RSA_MAX_LIMBS, false },
+        { "d", d, RSA_MAX_LIMBS, false },
+        { "e", e, 1, false },
+    };
+    const u32 field_count = sizeof(fields) / sizeof(fields[0]);
+    memset(key, 0, sizeof(RsaKey));
+
+    /* Line by line on a copy (parse_line cuts lines up) */
+    char line[1024];
+    const char* s = text;
+    while (*s) {
+        const char* nl = strchr(s, '\n');
+        size_t len = nl ? (size_t)(nl - s) : strlen(s);
+        if (len >= sizeof(line)) {
+            fprintf(stderr, "RSA key: line too long\n");
+            return false;
+        }
+        memcpy(line, s, len);
+        line[len] = '\0';
+        s += nl ? len + 1 : len;
+
+        char* start = line;
+        while (isspace((unsigned char)*start)) start++;
+        if (*start == '\0' || *start == '#') continue;
+        if (!parse_line(start, fields, field_count)) return false;
+    }
+    for (u32 i = 0; i < 3; i++) {
+        if (!fields[i].found) {
+            fprintf(stderr, "RSA key: missing '%s'\n", fields[i].name);
+            return false;
+        }
+    }
+
+    u32 p_bits = big_bits(p, RSA_MAX_LIMBS);
+    u32 q_bits = big_bits(q, RSA_MAX_LIMBS);
+    if (p_bits < 2 || q_bits < 2 || p_bits > RSA_MAX_BITS / 2 || q_bits > RSA_MAX_BITS / 2 ||
+        (p[0] & 1) == 0 || (q[0] & 1) == 0 || big_cmp(p, q, RSA_MAX_LIMBS) == 0) {
+        fprintf(stderr, "RSA key: p and q must be distinct odd primes of at most %u bits\n",
+                RSA_MAX_BITS / 2);
+        return false;
+    }
+
+    /* Both halves share a limb count: the larger prime's */
+    u32 k = ((p_bits > q_bits ? p_bits : q_bits) + 31) / 32;
+
+    u32 n_wide[RSA_MAX_LIMBS];
+    big_mul(n_wide, p, k, q, k);
+    key->bits = big_bits(n_wide, 2 * k);
+    if (key->bits < 256 || key->bits > RSA_MAX_BITS) {
+        fprintf(stderr, "RSA key: modulus is %u bits (256-%u supported)\n", key->bits, RSA_MAX_BITS);
+        return false;
+    }
+    key->n_limbs = big_limbs(n_wide, 2 * k);
+    memcpy(key->n, n_wide, sizeof(key->n));
+
+    u32 d_limbs = big_limbs(d, RSA_MAX_LIMBS);
+    if (d_limbs == 0) {
+        fprintf(stderr, "RSA key: d is zero\n");
+        return false;
+    }
+
+    mont_init(&key->p, p, k);
+    mont_init(&key->q, q, k);
+
+    /* dP = d mod (p - 1), dQ = d mod (q - 1) (p, q odd: just clear bit 0) */
+    u32 pm1[RSA_HALF_LIMBS], qm1[RSA_HALF_LIMBS];
+    memcpy(pm1, p, k * sizeof(u32));
+    memcpy(qm1, q, k * sizeof(u32));
+    pm1[0] &= ~1u;
+    qm1[0] &= ~1u;
+    big_mod(key->dp, d, d_limbs, pm1, k);
+    big_mod(key->dq, d, d_limbs, qm1, k);
+
+    /* qInv = q^(p-2) mod p (Fermat; p is prime) */
+    static const u32 one[RSA_HALF_LIMBS] = { 1 };
+    u32 q_mod_p[RSA_HALF_LIMBS], pm2[RSA_HALF_LIMBS], two[RSA_HALF_LIMBS] = { 2 };
+    big_mod(q_mod_p, q, k, p, k);
+    big_sub(pm2, p, two, k);
+    mont_mul(&key->p, q_mod_p, q_mod_p, key->p.r2);
+    mont_exp(&key->p, key->q_inv, q_mod_p, pm2);
+    mont_mul(&key->p, key->q_inv, key->q_inv, one);
+    if (big_is_zero(key->q_inv, k)) {
+        fprintf(stderr, "RSA key: q has no inverse mod p (p not prime?)\n");
+        return false;
+    }
+
+    if (fields[3].found && !rsa_key_check(key, e[0])) {
+        fprintf(stderr, "RSA key: d does not match e for this modulus\n");
+        return false;
+    }
+    return true;
+}
+
+RsaKey* rsa_key_load(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return NULL;
+
+    char* text = (char*)malloc(KEY_FILE_MAX + 1);
+    RsaKey* key = (RsaKey*)malloc(sizeof(RsaKey));
+    size_t len = text ? fread(text, 1, KEY_FILE_MAX + 1, f) : 0;
+    fclose(f);
+
+    bool ok = text && key && len <= KEY_FILE_MAX;
+    if (ok) {
+        text[len] = '\0';
+        ok = rsa_key_parse(key, text);
+    } else if (len > KEY_FILE_MAX) {
+        fprintf(stderr, "RSA key: %s is larger than %u bytes\n", path, KEY_FILE_MAX);
+    }
+    if (text) {
+        memset(text, 0, KEY_FILE_MAX + 1);  /* Private key material */
+        free(text);
+    }
+
+    if (!ok) {
+        fprintf(stderr, "WARNING: Ignoring RSA key %s\n", path);
+        rsa_key_free(key);
+        return NULL;
+    }
+    printf("RSA login key loaded from %s (%u-bit modulus)\n", path, key->bits);
+    return key;
+}
+
+void rsa_key_free(RsaKey* key) {
+    if (!key) return;
+    memset(key, 0, sizeof(RsaKey));
+    free(key);
+}
+
+/*******************************************************************************
+ * RSA OPERATIONS
+ ******************************************************************************/
+
+i32 rsa_key_decrypt(const RsaKey* key, const u8* in, u32 in_len, u8* out, u32 out_cap) {
+    if (!key || !in || !out) return -1;
+    const u32 k = key->p.limbs;
+    static const u32 one[RSA_HALF_LIMBS] = { 1 };
+
+    /* c, zero-extended to 2k limbs, must be below n */
+    u32 c[RSA_MAX_LIMBS];
+    memset(c, 0, sizeof(c));
+    if (!from_bytes(c, key->n_limbs, in, in_len) || big_cmp(c, key->n, key->n_limbs) >= 0) {
+        return -1;
+    }
+
+    /* m1 = c^dP mod p (Montgomery form), m2 = c^dQ mod q (normal form) */
+    u32 cp[RSA_HALF_LIMBS], cq[RSA_HALF_LIMBS];
+    u32 m1[RSA_HALF_LIMBS], m2[RSA_HALF_LIMBS];
+    mont_enter(&key->p, cp, c);
+    mont_enter(&key->q, cq, c);
+    mont_exp(&key->p, m1, cp, key->dp);
+    mont_exp(&key->q, m2, cq, key->dq);
+    mont_mul(&key->q, m2, m2, one);
+
+    /* h = qInv * (m1 - m2) mod p; m2 enters p's Montgomery form first */
+    u32 m2p[RSA_HALF_LIMBS], h[RSA_HALF_LIMBS];
+    mont_mul(&key->p, m2p, m2, key->p.r2);
+    if (big_sub(h, m1, m2p, k)) big_add(h, h, key->p.m, k);
+    mont_mul(&key->p, h, h, key->q_inv);  /* (m1 - m2)R * qInv * R^-1 */
+
+    /* m = m2 + h * q */
+    u32 m[RSA_MAX_LIMBS + 1];
+    u32 m2_wide[RSA_MAX_LIMBS + 1];
+    big_mul(m, h, k, key->q.m, k);
+    m[2 * k] = 0;
+    memset(m2_wide, 0, sizeof(m2_wide));
+    memcpy(m2_wide, m2, k * sizeof(u32));
+    big_add(m, m, m2_wide, 2 * k + 1);
+
+    i32 len = to_bytes(m, 2 * k + 1, out, out_cap);
+
+    /* The intermediates are as secret as the plaintext */
+    memset(cp, 0, sizeof(cp));
+    memset(cq, 0, sizeof(cq));
+    memset(m1, 0, sizeof(m1));
+    memset(m2, 0, sizeof(m2));
+    memset(h, 0, sizeof(h));
+    memset(m, 0, sizeof(m));
+    return len;
+}
+
+i32 rsa_key_encrypt(const RsaKey* key, u32 e, const u8* in, u32 in_len, u8* out, u32 out_cap) {
+    if (!key || !in || !out || e == 0) return -1;
+    const u32 n = key->n_limbs;
+
+    u32 m[RSA_MAX_LIMBS];
+    if (!from_bytes(m, n, in, in_len) || big_cmp(m, key->n, n) >= 0) return -1;
+
+    /* Left-to-right square-and-multiply with big_mod (slow, load time only) */
+    u32 acc[RSA_MAX_LIMBS] = { 1 };
+    u32 wide[2 * RSA_MAX_LIMBS];
+    for (u32 bit = 32; bit-- > 0;) {
+        big_mul(wide, acc, n, acc, n);
+        big_mod(acc, wide, 2 * n, key->n, n);
+        if ((e >> bit) & 1) {
+            big_mul(wide, acc, n, m, n);
+            big_mod(acc, wide, 2 * n, key->n, n);
+        }
+    }
+    return to_bytes(acc, n, out, out_cap);
+}
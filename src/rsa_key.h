@@ -0,0 +1,173 @@
+/*******************************************************************************
+ * RSA_KEY.H - Server Private Key: CRT Decryption with Montgomery Arithmetic
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - RSA decryption with the Chinese Remainder Theorem (CRT)
+ *   - Montgomery multiplication: modular products without division
+ *   - Precomputing everything that depends only on the key
+ *   - Fixed-window exponentiation with a constant-time table lookup
+ *
+ * THE PROBLEM:
+ *
+ * The 225 client can RSA-encrypt the part of the login packet that holds
+ * the ISAAC seeds, username and password (client.c, rsaenc). The server
+ * read that block as plaintext, so a client with keys configured could
+ * not log in at all, and without keys the password crossed the wire in
+ * the clear. Decrypting means computing
+ *
+ *   m = c^d mod n          (n: 512-1024 bits, d about as long)
+ *
+ * for every login. Done the textbook way - square-and-multiply with a
+ * long division after every product, as thirdparty/bn.c does - that is
+ * ~1000 full-width divisions per login, and a reconnect storm after a
+ * restart queues thousands of them.
+ *
+ * THE SOLUTION - CRT + MONTGOMERY, KEY WORK DONE ONCE:
+ *
+ *   1. CRT: with n = p * q, work mod p and mod q separately:
+ *
+ *        m1 = c^dP mod p       dP = d mod (p - 1)
+ *        m2 = c^dQ mod q       dQ = d mod (q - 1)
+ *        h  = qInv * (m1 - m2) mod p       qInv = q^-1 mod p
+ *        m  = m2 + h * q
+ *
+ *      Half-size numbers make each product 4x cheaper and half-size
+ *      exponents halve the number of products: ~4x faster overall.
+ *
+ *   2. Montgomery: keep numbers as a*R mod p (R = 2^(32*limbs)). The
+ *      product of two such numbers is reduced with multiplies and shifts
+ *      only (mont_mul, CIOS form), never a division:
+ *
+ *        mont_mul(aR, bR) = aR * bR * R^-1 = abR  (mod p)
+ *
+ *   3. Precomputed context: R^2 mod p and R^3 mod p (to enter Montgomery
+ *      form), -p^-1 mod 2^32, dP, dQ and qInv are all derived once when
+ *      the key is loaded. A decryption is only the two exponentiations.
+ *
+ * EXPONENTIATION:
+ *
+ *   Fixed 4-bit windows over every bit of the exponent: 4 squarings then
+ *   one multiply by table[window], table[w] = c^w. The multiply happens
+ *   even for window 0, and the table entry is selected by reading all 16
+ *   entries with a mask, so neither the sequence of operations nor the
+ *   memory addresses touched depend on the private exponent. (mont_mul's
+ *   final conditional subtraction still does; this is a game server
+ *   login key, not an HSM.)
+ *
+ * KEY FILE (RSA_KEY_PATH):
+ *
+ *   # Lines of name = value; '#' starts a comment.
+ *   # Values in decimal, or hex with a 0x prefix.
+ *   p = 1033176811285662392492584499101456481931834006710764221618...
+ *   q = 1098124744329453699057572233232615765942480940705749196013...
+ *   d = 3634938093821617199572695223970766756227022633261645820799...
+ *   e = 65537                     (optional: enables a load-time check)
+ *
+ *   p, q and d are required. The client's config.ini takes the matching
+ *   public half: rsa_modulus = p * q and rsa_exponent = e, in decimal.
+ *   The modulus must be 256-1024 bits (the client's rsaenc writes at most
+ *   128 bytes), with neither prime over 512 bits.
+ *
+ * THREAD SAFETY:
+ *   An RsaKey is read-only after rsa_key_load(); rsa_key_decrypt() uses
+ *   only the stack, so any number of login workers can share one key.
+ *
+ ******************************************************************************/
+
+#ifndef RSA_KEY_H
+#define RSA_KEY_H
+
+#include "types.h"
+#include <stdbool.h>
+
+#define RSA_KEY_PATH "data/rsa.key"
+
+/* Largest modulus: the client's rsaenc output buffer is 128 bytes */
+#define RSA_MAX_BITS 1024
+#define RSA_MAX_BYTES (RSA_MAX_BITS / 8)
+#define RSA_MAX_LIMBS (RSA_MAX_BITS / 32)
+#define RSA_HALF_LIMBS (RSA_MAX_LIMBS / 2)
+
+/*
+ * MontContext - Montgomery arithmetic modulo one prime
+ *
+ * Limbs are little-endian u32 words; numbers are `limbs` words long.
+ */
+typedef struct {
+    u32 limbs;
+    u32 m[RSA_HALF_LIMBS];          /* Modulus (odd) */
+    u32 m_inv;                      /* -m^-1 mod 2^32 */
+    u32 r2[RSA_HALF_LIMBS];         /* R^2 mod m */
+    u32 r3[RSA_HALF_LIMBS];         /* R^3 mod m (double-width input → Montgomery form) */
+} MontContext;
+
+/*
+ * RsaKey - Private key with every CRT / Montgomery constant precomputed
+ */
+typedef struct {
+    u32 bits;                       /* Modulus size */
+    u32 n_limbs;
+    u32 n[RSA_MAX_LIMBS];           /* Modulus p * q */
+    MontContext p;
+    MontContext q;
+    u32 dp[RSA_HALF_LIMBS];         /* d mod (p - 1) */
+    u32 dq[RSA_HALF_LIMBS];         /* d mod (q - 1) */
+    u32 q_inv[RSA_HALF_LIMBS];      /* q^-1 mod p */
+} RsaKey;
+
+/*
+ * g_rsa_key - Login key, or NULL (login blocks are plaintext)
+ */
+extern RsaKey* g_rsa_key;
+
+/*
+ * rsa_key_load - Read a key file and precompute its context
+ *
+ * @param path  Key file (RSA_KEY_PATH)
+ * @return      New key, or NULL if the file is missing or invalid (the
+ *              reason is printed, except for a missing file)
+ */
+RsaKey* rsa_key_load(const char* path);
+
+/*
+ * rsa_key_parse - Build a key from key file text (see above)
+ *
+ * @param key   Receives the key
+ * @param text  NUL-terminated key file contents
+ * @return      false (with a message) if a value is missing or invalid
+ */
+bool rsa_key_parse(RsaKey* key, const char* text);
+
+/*
+ * rsa_key_free - Free a key from rsa_key_load() (NULL-safe)
+ */
+void rsa_key_free(RsaKey* key);
+
+/*
+ * rsa_key_decrypt - Private-key operation on one big-endian block
+ *
+ * @param key       Loaded key
+ * @param in        Ciphertext, big-endian (leading zero bytes allowed, as
+ *                  in Java's BigInteger.toByteArray)
+ * @param in_len    Bytes in in
+ * @param out       Receives the plaintext, big-endian, without leading zeros
+ * @param out_cap   Room in out (RSA_MAX_BYTES is always enough)
+ * @return          Plaintext length, or -1 if the ciphertext is not below
+ *                  the modulus or does not fit out
+ *
+ * COMPLEXITY: O(k^3) for a k-limb modulus - two exponentiations of
+ *             16k squarings and 4k multiplies, each on k/2 limbs
+ */
+i32 rsa_key_decrypt(const RsaKey* key, const u8* in, u32 in_len, u8* out, u32 out_cap);
+
+/*
+ * rsa_key_encrypt - Public-key operation (c = m^e mod n)
+ *
+ * For the load-time self check and for tests; the server never encrypts.
+ * Same conventions as rsa_key_decrypt. Not constant-time (e is public).
+ */
+i32 rsa_key_encrypt(const RsaKey* key, u32 e, const u8* in, u32 in_len, u8* out, u32 out_cap);
+
+#endif /* RSA_KEY_H */
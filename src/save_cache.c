@@ -0,0 +1,220 @@
+/*******************************************************************************
+ * SAVE_CACHE.C - Recent Logout Saves Kept in Memory Implementation
+ *******************************************************************************
+ *
+ * See save_cache.h for when entries are stored and taken.
+ *
+ * LAYOUT:
+ *
+ *   buckets[hash(name)] ──→ entry ──chain──→ entry ──→ NONE
+ *   newest ──older──→ entry ──older──→ ... ──→ oldest     (newer: back)
+ *   free_head ──chain──→ unused entry ──→ ...
+ *
+ * Every link is a u16 index into entries[]. An entry is in exactly one
+ * bucket chain and the LRU list while used, and in the free chain
+ * otherwise. The mutex is held for a few link updates and one copy of a
+ * few hundred bytes.
+ *
+ ******************************************************************************/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include "save_cache.h"
+#include "update.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+SaveCache* g_save_cache = NULL;
+
+#ifndef _WIN32
+#include <pthread.h>
+#define CACHE_LOCK(c)   pthread_mutex_lock((pthread_mutex_t*)(c)->mutex)
+#define CACHE_UNLOCK(c) pthread_mutex_unlock((pthread_mutex_t*)(c)->mutex)
+#else
+/* No login workers on Windows (load_queue.h): the game thread is alone */
+#define CACHE_LOCK(c)   ((void)0)
+#define CACHE_UNLOCK(c) ((void)0)
+#endif
+
+/*
+ * cache_bucket - Bucket of a base37 name (Fibonacci hashing)
+ */
+static u32 cache_bucket(u64 name) {
+    return (u32)((name * 0x9E3779B97F4A7C15ULL) >> 54) & (SAVE_CACHE_BUCKETS - 1);
+}
+
+/*
+ * cache_find - Entry for name, or SAVE_CACHE_NONE
+ */
+static u16 cache_find(const SaveCache* cache, u64 name) {
+    u16 e = cache->buckets[cache_bucket(name)];
+    while (e != SAVE_CACHE_NONE && cache->entries[e].name != name) {
+        e = cache->entries[e].chain;
+    }
+    return e;
+}
+
+/*
+ * cache_link_newest - Put a used entry at the new end of the LRU list
+ */
+static void cache_link_newest(SaveCache* cache, u16 e) {
+    SaveCacheEntry* entry = &cache->entries[e];
+    entry->newer = SAVE_CACHE_NONE;
+    entry->older = cache->newest;
+    if (cache->newest != SAVE_CACHE_NONE) cache->entries[cache->newest].newer = e;
+    cache->newest = e;
+    if (cache->oldest == SAVE_CACHE_NONE) cache->oldest = e;
+}
+
+/*
+ * cache_unlink_lru - Take an entry out of the LRU list
+ */
+static void cache_unlink_lru(SaveCache* cache, u16 e) {
+    SaveCacheEntry* entry = &cache->entries[e];
+    if (entry->newer != SAVE_CACHE_NONE) {
+        cache->entries[entry->newer].older = entry->older;
+    } else {
+        cache->newest = entry->older;
+    }
+    if (entry->older != SAVE_CACHE_NONE) {
+        cache->entries[entry->older].newer = entry->newer;
+    } else {
+        cache->oldest = entry->newer;
+    }
+}
+
+/*
+ * cache_remove - Unlink an entry everywhere and return it to the free chain
+ *
+ * Its data buffer stays allocated for the next account to use the entry.
+ */
+static void cache_remove(SaveCache* cache, u16 e) {
+    SaveCacheEntry* entry = &cache->entries[e];
+    u16* link = &cache->buckets[cache_bucket(entry->name)];
+    while (*link != e) link = &cache->entries[*link].chain;
+    *link = entry->chain;
+    cache_unlink_lru(cache, e);
+
+    entry->name = 0;
+    entry->size = 0;
+    entry->chain = cache->free_head;
+    cache->free_head = e;
+    cache->count--;
+}
+
+bool save_cache_start(SaveCache* cache) {
+    if (!cache) return false;
+    memset(cache, 0, sizeof(SaveCache));
+
+    cache->entries = (SaveCacheEntry*)calloc(SAVE_CACHE_ENTRIES, sizeof(SaveCacheEntry));
+    cache->buckets = (u16*)malloc(SAVE_CACHE_BUCKETS * sizeof(u16));
+#ifndef _WIN32
+    cache->mutex = malloc(sizeof(pthread_mutex_t));
+    bool locked = cache->mutex && pthread_mutex_init((pthread_mutex_t*)cache->mutex, NULL) == 0;
+#else
+    bool locked = true;
+#endif
+    if (!cache->entries || !cache->buckets || !locked) {
+        free(cache->entries);
+        free(cache->buckets);
+        free(cache->mutex);
+        memset(cache, 0, sizeof(SaveCache));
+        fprintf(stderr, "WARNING: Save cache not started, relogs read the disk\n");
+        return false;
+    }
+
+    for (u32 b = 0; b < SAVE_CACHE_BUCKETS; b++) cache->buckets[b] = SAVE_CACHE_NONE;
+    for (u32 e = 0; e < SAVE_CACHE_ENTRIES; e++) {
+        cache->entries[e].chain = e + 1 < SAVE_CACHE_ENTRIES ? (u16)(e + 1) : SAVE_CACHE_NONE;
+    }
+    cache->free_head = 0;
+    cache->newest = SAVE_CACHE_NONE;
+    cache->oldest = SAVE_CACHE_NONE;
+
+    g_save_cache = cache;
+    printf("Save cache started (%u logout saves)\n", SAVE_CACHE_ENTRIES);
+    return true;
+}
+
+void save_cache_stop(SaveCache* cache) {
+    if (!cache || !cache->entries) return;
+    if (g_save_cache == cache) g_save_cache = NULL;
+
+    printf("Save cache stopped (%llu stored, %llu relogs served, %llu evicted)\n",
+           (unsigned long long)cache->stores, (unsigned long long)cache->hits,
+           (unsigned long long)cache->evictions);
+    for (u32 e = 0; e < SAVE_CACHE_ENTRIES; e++) free(cache->entries[e].data);
+    free(cache->entries);
+    free(cache->buckets);
+#ifndef _WIN32
+    pthread_mutex_destroy((pthread_mutex_t*)cache->mutex);
+#endif
+    free(cache->mutex);
+    memset(cache, 0, sizeof(SaveCache));
+}
+
+void save_cache_store(SaveCache* cache, const char* username, const u8* data, u32 size) {
+    if (!cache || !username || !data) return;
+    u64 name = username_to_base37(username);
+    if (name == 0) return;
+
+    CACHE_LOCK(cache);
+    cache->stores++;
+
+    /* An older save of the same account is replaced, not kept twice */
+    u16 e = cache_find(cache, name);
+    if (e != SAVE_CACHE_NONE) cache_remove(cache, e);
+
+    /* Full: the save nobody came back for goes */
+    if (cache->free_head == SAVE_CACHE_NONE) {
+        cache_remove(cache, cache->oldest);
+        cache->evictions++;
+    }
+
+    e = cache->free_head;
+    SaveCacheEntry* entry = &cache->entries[e];
+    if (entry->data_capacity < size) {
+        u8* grown = (u8*)realloc(entry->data, size);
+        if (!grown) {
+            CACHE_UNLOCK(cache);
+            return;  /* The relog reads the disk, as without the cache */
+        }
+        entry->data = grown;
+        entry->data_capacity = size;
+    }
+    cache->free_head = entry->chain;
+
+    memcpy(entry->data, data, size);
+    entry->size = size;
+    entry->name = name;
+    u32 b = cache_bucket(name);
+    entry->chain = cache->buckets[b];
+    cache->buckets[b] = e;
+    cache_link_newest(cache, e);
+    cache->count++;
+
+    CACHE_UNLOCK(cache);
+}
+
+bool save_cache_take(SaveCache* cache, const char* username, u8* buffer, u32 capacity, u32* size) {
+    if (!cache || !username || !buffer || !size) return false;
+    u64 name = username_to_base37(username);
+    if (name == 0) return false;
+
+    CACHE_LOCK(cache);
+    u16 e = cache_find(cache, name);
+    bool found = false;
+    if (e != SAVE_CACHE_NONE) {
+        const SaveCacheEntry* entry = &cache->entries[e];
+        found = entry->size <= capacity;
+        if (found) {
+            memcpy(buffer, entry->data, entry->size);
+            *size = entry->size;
+            cache->hits++;
+        }
+        cache_remove(cache, e);
+    }
+    CACHE_UNLOCK(cache);
+    return found;
+}
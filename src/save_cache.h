@@ -0,0 +1,146 @@
+/*******************************************************************************
+ * SAVE_CACHE.H - Recent Logout Saves Kept in Memory for a Quick Relog
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Least-recently-used eviction with an intrusive doubly linked list
+ *   - Hash chains threaded through a fixed array (no allocation per entry)
+ *   - Keeping a cache consistent by construction: take, don't peek
+ *
+ * THE PROBLEM:
+ *
+ * A player who logs out and straight back in (a client restart, a misclick
+ * on the logout button) costs a save and then a load of the same bytes:
+ *
+ *   logout:  serialize → save queue → writer: tmp, fsync, rename
+ *   login:   worker: save_queue_lookup (mutex shared with the writer)
+ *            → fopen, fseek, fread, fclose the file just written
+ *
+ * The bytes were in memory a moment ago; the relog reads them back from
+ * disk, or queues behind the writer's lock if the write is still pending.
+ *
+ * THE SOLUTION - KEEP THE LOGOUT SAVE, HAND IT TO THE NEXT LOGIN:
+ *
+ *   GAME THREAD                           LOGIN WORKER
+ *   player_disconnect()                   player_load_read(name)
+ *     player_save_logout()                  save_cache_take(name) ── hit ──→ bytes
+ *       save_cache_store(name, bytes)         │ miss
+ *       save queue / write, as before         ▼
+ *                                           save queue, save log, file
+ *
+ *   name (base37) ──hash──→ bucket ──chain──→ entry { name, bytes }
+ *   LRU list:  newest ⇄ ... ⇄ oldest          (oldest evicted when full)
+ *
+ * CONSISTENCY:
+ *   Within one world the logout save is the newest save an account has:
+ *   no save of it can be made while it is offline. A login takes its
+ *   entry out of the cache (hit or refused login alike), so the entry can
+ *   never outlive a later autosave or logout. Only logout saves are
+ *   stored: autosaves of online players would push out the entries that
+ *   a relog can actually use.
+ *
+ * SEVERAL WORLDS:
+ *   With --worlds the account can play on another world and save there
+ *   while this world still holds its entry. The cache is not started when
+ *   worlds share an account registry (account_registry.h); hopping between
+ *   worlds reads the file as before.
+ *
+ * A replay stores nothing: its players are never saved (replay.h).
+ *
+ ******************************************************************************/
+
+#ifndef SAVE_CACHE_H
+#define SAVE_CACHE_H
+
+#include "types.h"
+#include <stdbool.h>
+
+/* Logout saves kept (the oldest goes when a new one arrives) */
+#define SAVE_CACHE_ENTRIES 512
+
+/* Hash buckets (power of two, twice the entries) */
+#define SAVE_CACHE_BUCKETS 1024
+
+/* No entry (end of a chain or of the LRU list) */
+#define SAVE_CACHE_NONE 0xFFFF
+
+/*
+ * SaveCacheEntry - One account's logout save
+ */
+typedef struct {
+    u64 name;                   /* username_to_base37(), 0 = unused */
+    u8* data;                   /* Serialized save (heap, reused between accounts) */
+    u32 size;                   /* Bytes in data */
+    u32 data_capacity;          /* Allocated bytes in data */
+    u16 chain;                  /* Next entry in the same bucket */
+    u16 newer;                  /* LRU neighbours */
+    u16 older;
+} SaveCacheEntry;
+
+/*
+ * SaveCache - Fixed table of entries, shared by the game thread (store)
+ * and the login workers (take) under one mutex
+ */
+typedef struct {
+    SaveCacheEntry* entries;
+    u16* buckets;               /* First entry per bucket */
+    u16 newest;                 /* LRU list ends */
+    u16 oldest;
+    u16 free_head;              /* Unused entries, chained through chain */
+    u32 count;
+
+    u64 stores;                 /* save_cache_store() calls */
+    u64 hits;                   /* Loads served from memory */
+    u64 evictions;              /* Entries pushed out unused */
+
+    void* mutex;                /* pthread_mutex_t (opaque, as in save_queue.h) */
+} SaveCache;
+
+/*
+ * g_save_cache - Running cache, or NULL (every load reads the disk)
+ */
+extern SaveCache* g_save_cache;
+
+/*
+ * save_cache_start - Allocate the table
+ *
+ * @param cache  Zeroed SaveCache to initialize
+ * @return       true on success; sets g_save_cache
+ */
+bool save_cache_start(SaveCache* cache);
+
+/*
+ * save_cache_stop - Free the table and every entry
+ *
+ * Call once nothing stores or takes any more. Clears g_save_cache.
+ */
+void save_cache_stop(SaveCache* cache);
+
+/*
+ * save_cache_store - Keep a logout save, replacing one for the same name
+ *
+ * @param cache     Cache (NULL-safe: does nothing)
+ * @param username  Account
+ * @param data      Serialized save (copied)
+ * @param size      Bytes in data
+ *
+ * COMPLEXITY: O(1) expected, O(size) copy
+ */
+void save_cache_store(SaveCache* cache, const char* username, const u8* data, u32 size);
+
+/*
+ * save_cache_take - Move an account's logout save out of the cache
+ *
+ * @param cache     Cache (NULL-safe: returns false)
+ * @param username  Account
+ * @param buffer    Receives the bytes
+ * @param capacity  Size of buffer
+ * @param size      Receives the byte count
+ * @return          true on a hit; the entry is gone either way
+ *
+ * COMPLEXITY: O(1) expected, O(size) copy
+ */
+bool save_cache_take(SaveCache* cache, const char* username, u8* buffer, u32 capacity, u32* size);
+
+#endif /* SAVE_CACHE_H */
@@ -0,0 +1,674 @@
+/*******************************************************************************
+ * SAVE_LOG.C - Append-Only Save Store Implementation
+ *******************************************************************************
+ *
+ * See save_log.h for the format and the compaction protocol.
+ *
+ * OPEN:
+ *
+ *   read whole file → check header
+ *   for each record: frame ok + CRC ok? → index[name] = offset
+ *                    otherwise          → truncate the file here, stop
+ *
+ * Records are framed so that a scan never needs the index, and the index
+ * never needs the file: both open and compaction use parse_record().
+ *
+ ******************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "save_log.h"
+#include "player_save.h"
+#include "crc32.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+SaveLog* g_save_log = NULL;
+
+#ifndef _WIN32
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define LOG_MUTEX(l)  ((pthread_mutex_t*)(l)->mutex)
+#define LOG_WAKE(l)   ((pthread_cond_t*)(l)->wake)
+
+#define FILE_MAGIC      0x52534C47u     /* "RSLG" */
+#define FILE_VERSION    1
+#define FILE_HEADER     8
+#define RECORD_MAGIC    0x534C          /* "SL" */
+
+/* Largest record we write: framing + longest name + largest save */
+#define RECORD_MAX (SAVE_LOG_RECORD_HEADER + MAX_USERNAME_LENGTH + PLAYER_SAVE_MAX_SIZE + \
+                    SAVE_LOG_RECORD_TRAILER)
+
+/* Output batching while compaction copies records */
+#define COPY_BUFFER_SIZE (64 * 1024)
+
+/*******************************************************************************
+ * RECORD FRAMING
+ ******************************************************************************/
+
+static u32 get_u32(const u8* p) {
+    return ((u32)p[0] << 24) | ((u32)p[1] << 16) | ((u32)p[2] << 8) | p[3];
+}
+
+static void put_u32(u8* p, u32 value) {
+    p[0] = (u8)(value >> 24);
+    p[1] = (u8)(value >> 16);
+    p[2] = (u8)(value >> 8);
+    p[3] = (u8)value;
+}
+
+/*
+ * encode_record - Frame one save as [magic][name_len][size][name][data][crc]
+ *
+ * @return  Record length
+ */
+static u32 encode_record(u8* out, const char* username, const u8* data, u32 size) {
+    u32 name_len = (u32)strlen(username);
+    u32 pos = 0;
+
+    out[pos++] = (u8)(RECORD_MAGIC >> 8);
+    out[pos++] = (u8)RECORD_MAGIC;
+    out[pos++] = (u8)name_len;
+    out[pos++] = (u8)(size >> 8);
+    out[pos++] = (u8)size;
+    memcpy(out + pos, username, name_len);
+    pos += name_len;
+    memcpy(out + pos, data, size);
+    pos += size;
+    put_u32(out + pos, crc32(out, pos));
+    return pos + SAVE_LOG_RECORD_TRAILER;
+}
+
+/*
+ * parse_record - Validate the record at p
+ *
+ * @param p          Record start
+ * @param available  Bytes readable at p
+ * @param username   Receives the owner (MAX_USERNAME_LENGTH + 1 bytes)
+ * @param data       Receives a pointer to the save bytes (may be NULL)
+ * @param size       Receives the save size (may be NULL)
+ * @return           Record length, or 0 if short, malformed or corrupt
+ */
+static u32 parse_record(const u8* p, u64 available, char* username, const u8** data, u32* size) {
+    if (available < SAVE_LOG_RECORD_HEADER + SAVE_LOG_RECORD_TRAILER) return 0;
+    if ((((u32)p[0] << 8) | p[1]) != RECORD_MAGIC) return 0;
+
+    u32 name_len = p[2];
+    u32 data_size = ((u32)p[3] << 8) | p[4];
+    if (name_len == 0 || name_len > MAX_USERNAME_LENGTH) return 0;
+
+    u32 body = SAVE_LOG_RECORD_HEADER + name_len + data_size;
+    u32 length = body + SAVE_LOG_RECORD_TRAILER;
+    if (available < length) return 0;
+    if (get_u32(p + body) != crc32(p, body)) return 0;
+
+    memcpy(username, p + SAVE_LOG_RECORD_HEADER, name_len);
+    username[name_len] = '\0';
+    if (data) *data = p + SAVE_LOG_RECORD_HEADER + name_len;
+    if (size) *size = data_size;
+    return length;
+}
+
+/*******************************************************************************
+ * INDEX
+ ******************************************************************************/
+
+/* FNV-1a: short strings, good spread, no multiplication table */
+static u32 hash_name(const char* name) {
+    u32 h = 2166136261u;
+    while (*name) {
+        h ^= (u8)*name++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/*
+ * index_slot - Slot holding name, or the empty slot where it would go
+ */
+static SaveLogEntry* index_slot(const SaveLogIndex* index, const char* name) {
+    u32 mask = index->capacity - 1;
+    for (u32 i = hash_name(name) & mask;; i = (i + 1) & mask) {
+        SaveLogEntry* entry = &index->slots[i];
+        if (entry->username[0] == '\0' || strcmp(entry->username, name) == 0) return entry;
+    }
+}
+
+static bool index_init(SaveLogIndex* index, u32 expected) {
+    u32 capacity = 256;
+    while (capacity * 7 / 10 < expected + 1) capacity *= 2;
+    index->slots = (SaveLogEntry*)calloc(capacity, sizeof(SaveLogEntry));
+    index->capacity = index->slots ? capacity : 0;
+    index->count = 0;
+    return index->slots != NULL;
+}
+
+static bool index_grow(SaveLogIndex* index) {
+    SaveLogIndex grown;
+    if (!index_init(&grown, index->capacity)) return false;
+    for (u32 i = 0; i < index->capacity; i++) {
+        if (index->slots[i].username[0] != '\0') {
+            *index_slot(&grown, index->slots[i].username) = index->slots[i];
+            grown.count++;
+        }
+    }
+    free(index->slots);
+    *index = grown;
+    return true;
+}
+
+/*
+ * index_put - Point name at a record
+ *
+ * @param replaced  Receives the length of the record it supersedes (0 if
+ *                  name is new)
+ */
+static bool index_put(SaveLogIndex* index, const char* name, u64 offset, u32 length, u32* replaced) {
+    SaveLogEntry* entry = index_slot(index, name);
+    if (entry->username[0] == '\0') {
+        if ((index->count + 1) > index->capacity * 7 / 10) {
+            if (!index_grow(index)) return false;
+            entry = index_slot(index, name);
+        }
+        snprintf(entry->username, sizeof(entry->username), "%s", name);
+        index->count++;
+        *replaced = 0;
+    } else {
+        *replaced = entry->length;
+    }
+    entry->offset = offset;
+    entry->length = length;
+    return true;
+}
+
+/*******************************************************************************
+ * FILE HELPERS
+ ******************************************************************************/
+
+/*
+ * write_all - write() until everything is out
+ */
+static bool write_all(i32 fd, const u8* data, u64 size) {
+    while (size > 0) {
+        ssize_t n = write(fd, data, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        size -= (u64)n;
+    }
+    return true;
+}
+
+static bool read_all(i32 fd, u8* data, u64 size, u64 offset) {
+    while (size > 0) {
+        ssize_t n = pread(fd, data, size, (off_t)offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        size -= (u64)n;
+        offset += (u64)n;
+    }
+    return true;
+}
+
+/*
+ * make_parent_directories - mkdir -p for everything before the last '/'
+ */
+static bool make_parent_directories(const char* path) {
+    char temp[256];
+    snprintf(temp, sizeof(temp), "%s", path);
+    for (char* p = temp + 1; *p; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        if (mkdir(temp, 0755) != 0 && errno != EEXIST) return false;
+        *p = '/';
+    }
+    return true;
+}
+
+/*
+ * sync_parent_directory - fsync the directory holding path
+ *
+ * Makes a rename() into that directory durable: without it a crash can
+ * bring back the old directory entry (the pre-compaction log) and lose
+ * everything appended to the new file since.
+ */
+static bool sync_parent_directory(const char* path) {
+    char dir[256];
+    snprintf(dir, sizeof(dir), "%s", path);
+    char* slash = strrchr(dir, '/');
+    if (slash) {
+        *slash = '\0';
+    } else {
+        snprintf(dir, sizeof(dir), ".");
+    }
+
+    i32 fd = open(dir[0] ? dir : "/", O_RDONLY);
+    if (fd < 0) return false;
+    bool ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+/*
+ * write_file_header - Start an empty log
+ */
+static bool write_file_header(i32 fd) {
+    u8 header[FILE_HEADER];
+    put_u32(header, FILE_MAGIC);
+    put_u32(header + 4, FILE_VERSION);
+    return write_all(fd, header, sizeof(header));
+}
+
+/*
+ * load_existing - Scan an existing log into the index (see OPEN above)
+ */
+static bool load_existing(SaveLog* log, u64 file_size) {
+    u8* contents = (u8*)malloc(file_size);
+    if (!contents) return false;
+    if (!read_all(log->fd, contents, file_size, 0)) {
+        free(contents);
+        return false;
+    }
+
+    if (file_size < FILE_HEADER || get_u32(contents) != FILE_MAGIC ||
+        get_u32(contents + 4) != FILE_VERSION) {
+        fprintf(stderr, "ERROR: %s is not a save log (version %u expected)\n",
+                log->path, FILE_VERSION);
+        free(contents);
+        return false;
+    }
+
+    u64 pos = FILE_HEADER;
+    u64 records = 0;
+    while (pos < file_size) {
+        char name[MAX_USERNAME_LENGTH + 1];
+        u32 length = parse_record(contents + pos, file_size - pos, name, NULL, NULL);
+        if (length == 0) break;
+
+        u32 replaced;
+        if (!index_put(&log->index, name, pos, length, &replaced)) {
+            free(contents);
+            return false;
+        }
+        log->live_bytes += length - replaced;
+        pos += length;
+        records++;
+    }
+    free(contents);
+
+    if (pos < file_size) {
+        /* Torn or corrupt tail: everything from here on is unreadable */
+        fprintf(stderr, "WARNING: %s: dropping %llu bytes after the last valid record\n",
+                log->path, (unsigned long long)(file_size - pos));
+        if (ftruncate(log->fd, (off_t)pos) != 0) return false;
+    }
+
+    log->end = pos;
+    printf("Save log %s: %llu records, %u players, %llu/%llu bytes live\n", log->path,
+           (unsigned long long)records, log->index.count,
+           (unsigned long long)log->live_bytes, (unsigned long long)log->end);
+    return true;
+}
+
+/*******************************************************************************
+ * COMPACTION
+ ******************************************************************************/
+
+static bool compaction_due(const SaveLog* log) {
+    return log->end >= log->compact_floor && log->live_bytes * 2 < log->end;
+}
+
+/*
+ * CopyState - New file being built by compact_locked()
+ */
+typedef struct {
+    i32 fd;
+    u64 end;                    /* Bytes written to the new file */
+    u8* out;                    /* Pending output */
+    u32 out_used;
+    SaveLogIndex index;         /* Offsets in the new file */
+} CopyState;
+
+static bool copy_flush(CopyState* copy) {
+    bool ok = write_all(copy->fd, copy->out, copy->out_used);
+    copy->out_used = 0;
+    return ok;
+}
+
+/*
+ * copy_record - Append one validated record to the new file
+ */
+static bool copy_record(CopyState* copy, const u8* record, u32 length, const char* name) {
+    if (copy->out_used + length > COPY_BUFFER_SIZE && !copy_flush(copy)) return false;
+    memcpy(copy->out + copy->out_used, record, length);
+    copy->out_used += length;
+
+    u32 replaced;
+    if (!index_put(&copy->index, name, copy->end, length, &replaced)) return false;
+    copy->end += length;
+    return true;
+}
+
+/*
+ * compact_locked - Rewrite the log with live records only
+ *
+ * Called and returns with the mutex held; drops it while copying the
+ * snapshot (steps in save_log.h).
+ */
+static bool compact_locked(SaveLog* log) {
+    /* Step 1: snapshot (old fd stays valid, only this thread replaces it) */
+    u32 count = log->index.count;
+    u64 snapshot_end = log->end;
+    u64 old_size = log->end;
+    i32 old_fd = log->fd;
+    SaveLogEntry* snapshot = (SaveLogEntry*)malloc((count ? count : 1) * sizeof(SaveLogEntry));
+    if (!snapshot) return false;
+    u32 n = 0;
+    for (u32 i = 0; i < log->index.capacity; i++) {
+        if (log->index.slots[i].username[0] != '\0') snapshot[n++] = log->index.slots[i];
+    }
+    pthread_mutex_unlock(LOG_MUTEX(log));
+
+    /* Step 2: copy the snapshot without blocking saves */
+    char temp_path[300];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", log->path);
+
+    CopyState copy;
+    memset(&copy, 0, sizeof(copy));
+    copy.fd = open(temp_path, O_RDWR | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    copy.out = (u8*)malloc(COPY_BUFFER_SIZE);
+    u8* record = (u8*)malloc(RECORD_MAX);
+    bool ok = copy.fd >= 0 && copy.out && record && index_init(&copy.index, n) &&
+              write_file_header(copy.fd);
+    copy.end = FILE_HEADER;
+
+    for (u32 i = 0; ok && i < n; i++) {
+        char name[MAX_USERNAME_LENGTH + 1];
+        ok = snapshot[i].length <= RECORD_MAX &&
+             read_all(old_fd, record, snapshot[i].length, snapshot[i].offset) &&
+             parse_record(record, snapshot[i].length, name, NULL, NULL) == snapshot[i].length &&
+             copy_record(&copy, record, snapshot[i].length, name);
+    }
+    if (ok) ok = copy_flush(&copy);
+    free(snapshot);
+
+    /* Step 3: tail appended meanwhile, then swap */
+    pthread_mutex_lock(LOG_MUTEX(log));
+    u64 pos = snapshot_end;
+    while (ok && pos < log->end) {
+        char name[MAX_USERNAME_LENGTH + 1];
+        u64 available = log->end - pos < RECORD_MAX ? log->end - pos : RECORD_MAX;
+        ok = read_all(log->fd, record, available, pos);
+        u32 length = ok ? parse_record(record, available, name, NULL, NULL) : 0;
+        ok = length > 0 && copy_record(&copy, record, length, name);
+        pos += length;
+    }
+    if (ok) ok = copy_flush(&copy) && fdatasync(copy.fd) == 0 &&
+                 rename(temp_path, log->path) == 0;
+    if (ok && !sync_parent_directory(log->path)) {
+        /* Renamed, so the swap must happen; only crash safety is weaker */
+        fprintf(stderr, "WARNING: Could not sync the directory of %s\n", log->path);
+    }
+    free(record);
+    free(copy.out);
+
+    if (!ok) {
+        if (copy.fd >= 0) close(copy.fd);
+        unlink(temp_path);
+        free(copy.index.slots);
+        return false;
+    }
+
+    close(log->fd);
+    log->fd = copy.fd;
+    log->end = copy.end;
+    log->dirty = false;     /* fdatasync'd above */
+    free(log->index.slots);
+    log->index = copy.index;
+
+    log->live_bytes = 0;
+    for (u32 i = 0; i < log->index.capacity; i++) {
+        log->live_bytes += log->index.slots[i].length;
+    }
+    log->compactions++;
+
+    printf("Save log compacted: %llu -> %llu bytes (%u players)\n",
+           (unsigned long long)old_size, (unsigned long long)log->end, log->index.count);
+    return true;
+}
+
+static void* save_log_thread_main(void* arg) {
+    SaveLog* log = (SaveLog*)arg;
+    pthread_mutex_lock(LOG_MUTEX(log));
+
+    for (;;) {
+        while (log->running && !compaction_due(log)) {
+            pthread_cond_wait(LOG_WAKE(log), LOG_MUTEX(log));
+        }
+        if (!log->running) break;
+
+        if (compact_locked(log)) {
+            log->compact_floor = SAVE_LOG_COMPACT_MIN_BYTES;
+        } else {
+            /* Disk trouble: retry once the log has doubled, not in a loop */
+            fprintf(stderr, "WARNING: Save log compaction failed, will retry later\n");
+            log->compact_floor = log->end * 2;
+        }
+    }
+
+    pthread_mutex_unlock(LOG_MUTEX(log));
+    return NULL;
+}
+
+/*******************************************************************************
+ * PUBLIC API
+ ******************************************************************************/
+
+/*
+ * save_log_free - Release everything save_log_open() allocated
+ */
+static void save_log_free(SaveLog* log) {
+    if (log->fd >= 0) close(log->fd);
+    free(log->index.slots);
+    if (log->mutex) pthread_mutex_destroy(LOG_MUTEX(log));
+    if (log->wake) pthread_cond_destroy(LOG_WAKE(log));
+    free(log->mutex);
+    free(log->wake);
+    free(log->thread);
+    free(log);
+}
+
+SaveLog* save_log_open(const char* path) {
+    if (!path || strlen(path) >= sizeof(((SaveLog*)0)->path)) return NULL;
+
+    SaveLog* log = (SaveLog*)calloc(1, sizeof(SaveLog));
+    if (!log) return NULL;
+    snprintf(log->path, sizeof(log->path), "%s", path);
+    log->compact_floor = SAVE_LOG_COMPACT_MIN_BYTES;
+
+    log->fd = -1;
+    if (make_parent_directories(path)) {
+        log->fd = open(path, O_RDWR | O_CREAT | O_APPEND, 0644);
+    }
+    if (log->fd < 0) {
+        fprintf(stderr, "ERROR: Cannot open save log %s: %s\n", path, strerror(errno));
+        save_log_free(log);
+        return NULL;
+    }
+
+    struct stat st;
+    bool ok = fstat(log->fd, &st) == 0 && index_init(&log->index, 0);
+    if (ok && st.st_size == 0) {
+        ok = write_file_header(log->fd) && fdatasync(log->fd) == 0;
+        log->end = FILE_HEADER;
+        printf("Save log %s created\n", path);
+    } else if (ok) {
+        ok = load_existing(log, (u64)st.st_size);
+    }
+
+    pthread_mutex_t* mutex = (pthread_mutex_t*)malloc(sizeof(pthread_mutex_t));
+    pthread_cond_t* wake = (pthread_cond_t*)malloc(sizeof(pthread_cond_t));
+    pthread_t* thread = (pthread_t*)malloc(sizeof(pthread_t));
+    if (ok && mutex && pthread_mutex_init(mutex, NULL) == 0) {
+        log->mutex = mutex;
+    } else {
+        free(mutex);
+        ok = false;
+    }
+    if (ok && wake && pthread_cond_init(wake, NULL) == 0) {
+        log->wake = wake;
+    } else {
+        free(wake);
+        ok = false;
+    }
+
+    if (ok && thread) {
+        log->thread = thread;
+        log->running = true;
+
+        /* Signals stay on the game thread, as for the network thread */
+        sigset_t all, previous;
+        sigfillset(&all);
+        pthread_sigmask(SIG_BLOCK, &all, &previous);
+        int rc = pthread_create(thread, NULL, save_log_thread_main, log);
+        pthread_sigmask(SIG_SETMASK, &previous, NULL);
+        if (rc != 0) {
+            log->running = false;
+            ok = false;
+        }
+    } else {
+        free(thread);
+        ok = false;
+    }
+
+    if (!ok) {
+        fprintf(stderr, "ERROR: Save log %s not opened\n", path);
+        save_log_free(log);
+        return NULL;
+    }
+    return log;
+}
+
+void save_log_close(SaveLog* log) {
+    if (!log) return;
+    if (g_save_log == log) g_save_log = NULL;
+
+    pthread_mutex_lock(LOG_MUTEX(log));
+    log->running = false;
+    pthread_cond_broadcast(LOG_WAKE(log));
+    pthread_mutex_unlock(LOG_MUTEX(log));
+    pthread_join(*(pthread_t*)log->thread, NULL);
+
+    save_log_sync(log);
+    printf("Save log closed (%llu records appended, %llu compactions)\n",
+           (unsigned long long)log->appended, (unsigned long long)log->compactions);
+    save_log_free(log);
+}
+
+bool save_log_append(SaveLog* log, const char* username, const u8* data, u32 size) {
+    if (!log || !username || !data) return false;
+    size_t name_len = strlen(username);
+    if (name_len == 0 || name_len > MAX_USERNAME_LENGTH || size > PLAYER_SAVE_MAX_SIZE) return false;
+
+    u8 record[RECORD_MAX];
+    u32 length = encode_record(record, username, data, size);
+
+    pthread_mutex_lock(LOG_MUTEX(log));
+    bool ok = write_all(log->fd, record, length);
+    u32 replaced = 0;
+    if (ok) ok = index_put(&log->index, username, log->end, length, &replaced);
+
+    if (ok) {
+        log->end += length;
+        log->live_bytes += length - replaced;
+        log->dirty = true;
+        log->appended++;
+        if (compaction_due(log)) pthread_cond_signal(LOG_WAKE(log));
+    } else if (ftruncate(log->fd, (off_t)log->end) != 0) {
+        /* Could not cut the partial record off: open() will on restart */
+        fprintf(stderr, "WARNING: Save log %s has a partial record at its end\n", log->path);
+    }
+
+    pthread_mutex_unlock(LOG_MUTEX(log));
+    return ok;
+}
+
+bool save_log_read(SaveLog* log, const char* username, u8* buffer, u32 capacity, u32* size) {
+    if (!log || !username || !buffer || !size) return false;
+
+    u8 record[RECORD_MAX];
+    bool found = false;
+
+    pthread_mutex_lock(LOG_MUTEX(log));
+    const SaveLogEntry* entry = index_slot(&log->index, username);
+    if (entry->username[0] != '\0' && entry->length <= RECORD_MAX &&
+        read_all(log->fd, record, entry->length, entry->offset)) {
+        char name[MAX_USERNAME_LENGTH + 1];
+        const u8* data;
+        u32 data_size;
+        found = parse_record(record, entry->length, name, &data, &data_size) == entry->length &&
+                strcmp(name, username) == 0 && data_size <= capacity;
+        if (found) {
+            memcpy(buffer, data, data_size);
+            *size = data_size;
+        } else {
+            fprintf(stderr, "WARNING: Save log record for '%s' failed its check\n", username);
+        }
+    }
+    pthread_mutex_unlock(LOG_MUTEX(log));
+    return found;
+}
+
+void save_log_sync(SaveLog* log) {
+    if (!log) return;
+
+    /*
+     * Sync a duplicate descriptor outside the lock: reads and appends are
+     * not held up by the disk flush, and if compaction swaps the file
+     * meanwhile its new file has already been synced.
+     */
+    pthread_mutex_lock(LOG_MUTEX(log));
+    i32 fd = log->dirty ? dup(log->fd) : -1;
+    log->dirty = false;
+    pthread_mutex_unlock(LOG_MUTEX(log));
+
+    if (fd >= 0) {
+        if (fdatasync(fd) != 0) {
+            fprintf(stderr, "WARNING: Save log sync failed: %s\n", strerror(errno));
+        }
+        close(fd);
+    }
+}
+
+#else /* _WIN32 */
+
+/*
+ * Windows: no pread/fdatasync/pthreads with MSVC. save_log_open() fails and
+ * saves stay one file per player.
+ */
+SaveLog* save_log_open(const char* path) {
+    (void)path;
+    fprintf(stderr, "WARNING: Save log not supported on this platform\n");
+    return NULL;
+}
+void save_log_close(SaveLog* log) { (void)log; }
+bool save_log_append(SaveLog* log, const char* username, const u8* data, u32 size) {
+    (void)log; (void)username; (void)data; (void)size;
+    return false;
+}
+bool save_log_read(SaveLog* log, const char* username, u8* buffer, u32 capacity, u32* size) {
+    (void)log; (void)username; (void)buffer; (void)capacity; (void)size;
+    return false;
+}
+void save_log_sync(SaveLog* log) { (void)log; }
+
+#endif /* _WIN32 */
@@ -0,0 +1,192 @@
+/*******************************************************************************
+ * SAVE_LOG.H - Append-Only, Checksummed Multi-Player Save Store
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Log-structured storage: never overwrite, always append
+ *   - Framing records so a torn write is detected and cut off
+ *   - An in-memory index over an on-disk log
+ *   - Compaction (garbage collection of superseded records)
+ *
+ * THE PROBLEM:
+ *
+ * With one file per player, every save is
+ *   open(tmp) write fsync close rename   (+ mkdir on first save)
+ * and the directory grows one inode per account ever created. Loading
+ * thousands of players (or migrating them) means thousands of opens.
+ *
+ * THE SOLUTION - ONE LOG, NEWEST RECORD WINS:
+ *
+ *   saves.log: [header][alice v1][bob v1][alice v2][carol v1][bob v2] ...
+ *                                 ↑ dead  ↑ live    ↑ live    ↑ live
+ *                       (alice v1 is dead too: superseded by v2)
+ *
+ *   index (in memory):  "alice" → offset of alice v2
+ *                       "bob"   → offset of bob v2
+ *                       "carol" → offset of carol v1
+ *
+ *   save:  build record in memory → ONE write() at the end of the file
+ *   load:  index lookup → ONE pread()
+ *
+ * Durability is batched: the save writer (save_queue.h) calls
+ * save_log_sync() once each time its queue drains, so a burst of N saves
+ * costs N writes and a single fdatasync (group commit).
+ *
+ * FILE FORMAT (big-endian):
+ *
+ *   header:  [magic:4 "RSLG"][version:4]
+ *   record:  [magic:2 0x534C][name_len:1][size:2][name][data][crc:4]
+ *            crc = crc32() of everything before it in the record
+ *
+ * RECOVERY:
+ *   save_log_open() reads the log once and verifies every record's CRC.
+ *   The first record that is short or fails its CRC (a crash in the
+ *   middle of a write) ends the log: the file is truncated there and
+ *   the index is built from everything before it.
+ *
+ * COMPACTION (background thread):
+ *   Once the log exceeds SAVE_LOG_COMPACT_MIN_BYTES and less than half
+ *   of it is live, the live records are copied into a new file:
+ *
+ *     1. lock:   snapshot the index and the current end of the log
+ *     2. unlock: copy every snapshot record into saves.log.tmp
+ *                (saves keep appending to the old log meanwhile)
+ *     3. lock:   copy the records appended since the snapshot (the
+ *                tail), fsync, rename over saves.log, swap index + fd
+ *
+ *   Saves only wait for step 3, which copies just the short tail.
+ *
+ * MIGRATION:
+ *   A username the log has never seen falls back to its .sav file, so
+ *   turning the log on keeps every existing account; each player moves
+ *   into the log with their next save.
+ *
+ * THREAD SAFETY:
+ *   Every function may be called from any thread (save writer, login
+ *   loader, game thread fallbacks); one mutex protects the fd, the end
+ *   offset and the index.
+ *
+ * PLATFORM:
+ *   POSIX (pread, fdatasync, threads). On Windows save_log_open() fails
+ *   and saves stay one file per player.
+ *
+ ******************************************************************************/
+
+#ifndef SAVE_LOG_H
+#define SAVE_LOG_H
+
+#include "types.h"
+#include <stdbool.h>
+
+/* Default location, next to the per-player directories */
+#define SAVE_LOG_PATH "data/players/saves.log"
+
+/* Logs smaller than this are never compacted */
+#define SAVE_LOG_COMPACT_MIN_BYTES (1024 * 1024)
+
+/* Record framing: magic(2) name_len(1) size(2) ... crc(4) */
+#define SAVE_LOG_RECORD_HEADER 5
+#define SAVE_LOG_RECORD_TRAILER 4
+
+/*
+ * SaveLogEntry - Index slot: where a username's newest record lives
+ */
+typedef struct {
+    char username[MAX_USERNAME_LENGTH + 1];  /* "" = empty slot */
+    u64 offset;             /* Start of the record in the log */
+    u32 length;             /* Whole record, framing included */
+} SaveLogEntry;
+
+/*
+ * SaveLogIndex - Open-addressing hash table keyed by username
+ *
+ * capacity is a power of two, kept at most 70% full; linear probing.
+ */
+typedef struct {
+    SaveLogEntry* slots;
+    u32 capacity;
+    u32 count;
+} SaveLogIndex;
+
+/*
+ * SaveLog - An open log plus its compaction thread
+ */
+typedef struct {
+    char path[256];
+    i32 fd;                 /* Opened O_APPEND */
+    u64 end;                /* File size = offset of the next record */
+    u64 live_bytes;         /* Sum of indexed record lengths */
+    bool dirty;             /* Written since the last save_log_sync() */
+    u64 compact_floor;      /* Don't compact below this size (backs off on failure) */
+    SaveLogIndex index;
+
+    u64 appended;           /* Records written since open */
+    u64 compactions;        /* Compactions completed */
+
+    bool running;
+    void* mutex;            /* pthread_mutex_t (opaque, as in netio.h) */
+    void* wake;             /* pthread_cond_t: compaction may be due / stop */
+    void* thread;           /* pthread_t */
+} SaveLog;
+
+/*
+ * g_save_log - Open save log, or NULL (one file per player)
+ */
+extern SaveLog* g_save_log;
+
+/*
+ * save_log_open - Open (or create) a log, rebuild its index, start compaction
+ *
+ * @param path  Log file (SAVE_LOG_PATH); parent directory is created
+ * @return      Log, or NULL on error (saves stay one file per player)
+ *
+ * Does not set g_save_log: the caller decides when saves switch over.
+ *
+ * COMPLEXITY: O(log size) time (one sequential read + CRC of the log)
+ */
+SaveLog* save_log_open(const char* path);
+
+/*
+ * save_log_close - Stop compaction, sync and close the log, free it
+ *
+ * @param log  Log (NULL-safe). Clears g_save_log if it points here.
+ */
+void save_log_close(SaveLog* log);
+
+/*
+ * save_log_append - Store a username's newest save
+ *
+ * @param log       Log (NULL-safe: returns false)
+ * @param username  Save owner
+ * @param data      Serialized save
+ * @param size      Bytes in data (<= PLAYER_SAVE_MAX_SIZE)
+ * @return          true if the record was written (not yet synced)
+ *
+ * COMPLEXITY: O(size) plus one write()
+ */
+bool save_log_append(SaveLog* log, const char* username, const u8* data, u32 size);
+
+/*
+ * save_log_read - Copy a username's newest save out of the log
+ *
+ * @param log       Log (NULL-safe: returns false)
+ * @param username  Save owner
+ * @param buffer    Receives the bytes
+ * @param capacity  Size of buffer
+ * @param size      Receives the byte count
+ * @return          true if the log has a record for username (that fit
+ *                  and passed its CRC)
+ *
+ * COMPLEXITY: O(1) expected lookup plus one pread()
+ */
+bool save_log_read(SaveLog* log, const char* username, u8* buffer, u32 capacity, u32* size);
+
+/*
+ * save_log_sync - Make every appended record durable (fdatasync)
+ *
+ * @param log  Log (NULL-safe). No syscall if nothing was appended.
+ */
+void save_log_sync(SaveLog* log);
+
+#endif /* SAVE_LOG_H */
@@ -0,0 +1,331 @@
+/*******************************************************************************
+ * SAVE_QUEUE.C - Background Player Save Writer Implementation
+ *******************************************************************************
+ *
+ * See save_queue.h for the design.
+ *
+ * WRITER THREAD LOOP:
+ *
+ *   lock
+ *   while running or jobs pending:
+ *       wait until a job is pending (or stop was requested)
+ *       take jobs[head]: swap its buffer with the writer's inflight buffer
+ *       unlock → player_save_write() → lock
+ *       queue drained? → wake save_queue_flush() waiters
+ *   unlock
+ *
+ * Taking a job swaps buffer pointers instead of copying, so the mutex is
+ * only ever held for a few pointer moves or one ~170 byte memcpy, never
+ * across disk I/O.
+ *
+ ******************************************************************************/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include "save_queue.h"
+#include "player_save.h"
+#include "save_log.h"
+#include "account_registry.h"
+#include "supervisor.h"
+#include "trace.h"
+#include "probe.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+SaveQueue* g_save_queue = NULL;
+
+#ifndef _WIN32
+
+#include <pthread.h>
+#include <signal.h>
+
+#define QUEUE_MUTEX(q)  ((pthread_mutex_t*)(q)->mutex)
+#define QUEUE_WAKE(q)   ((pthread_cond_t*)(q)->wake)
+#define QUEUE_IDLE(q)   ((pthread_cond_t*)(q)->idle)
+
+/*
+ * job_reserve - Make job->data hold at least size bytes
+ */
+static bool job_reserve(SaveJob* job, u32 size) {
+    if (job->data_capacity >= size) return true;
+    u8* grown = (u8*)realloc(job->data, size);
+    if (!grown) return false;
+    job->data = grown;
+    job->data_capacity = size;
+    return true;
+}
+
+/*
+ * find_pending - Index into jobs[] of the pending job for username, or -1
+ */
+static i32 find_pending(const SaveQueue* queue, const char* username) {
+    for (u32 i = 0; i < queue->count; i++) {
+        u32 slot = (queue->head + i) % queue->capacity;
+        if (strcmp(queue->jobs[slot].username, username) == 0) return (i32)slot;
+    }
+    return -1;
+}
+
+static void* save_queue_thread_main(void* arg) {
+    SaveQueue* queue = (SaveQueue*)arg;
+    trace_thread_name("save");
+    pthread_mutex_lock(QUEUE_MUTEX(queue));
+
+    for (;;) {
+        while (queue->count == 0 && queue->running) {
+            pthread_cond_wait(QUEUE_WAKE(queue), QUEUE_MUTEX(queue));
+        }
+        if (queue->count == 0) break;  /* Stopped and drained */
+
+        /* Take the oldest job by swapping buffers with inflight */
+        SaveJob* job = &queue->jobs[queue->head];
+        u8* data = queue->inflight.data;
+        u32 data_capacity = queue->inflight.data_capacity;
+        queue->inflight = *job;
+        job->data = data;
+        job->data_capacity = data_capacity;
+        job->size = 0;
+        job->username[0] = '\0';
+
+        queue->head = (queue->head + 1) % queue->capacity;
+        queue->count--;
+        queue->writing = true;
+        pthread_mutex_unlock(QUEUE_MUTEX(queue));
+
+        u64 trace_start = trace_begin();
+        bool ok = player_save_write(queue->inflight.username,
+                                    queue->inflight.data, queue->inflight.size);
+        trace_end(trace_start, "save_write", queue->inflight.size);
+        PROBE3(save__done, (const char*)queue->inflight.username, queue->inflight.size, ok);
+
+        /* Drained: one fdatasync for the whole batch (group commit) */
+        if (ok && g_save_log) {
+            pthread_mutex_lock(QUEUE_MUTEX(queue));
+            bool drained = queue->count == 0;
+            pthread_mutex_unlock(QUEUE_MUTEX(queue));
+            if (drained) save_log_sync(g_save_log);
+        }
+
+        pthread_mutex_lock(QUEUE_MUTEX(queue));
+        queue->writing = false;
+        if (ok) {
+            queue->written++;
+            /* Newest bytes for this account are on disk: a released claim can go */
+            if (find_pending(queue, queue->inflight.username) < 0) {
+                account_registry_saved(g_account_registry, queue->inflight.username, g_world_id);
+            }
+        } else {
+            queue->failed++;
+            LOG_WARN("Background save failed for '%s'\n", queue->inflight.username);
+        }
+        if (queue->count == 0) pthread_cond_broadcast(QUEUE_IDLE(queue));
+    }
+
+    pthread_cond_broadcast(QUEUE_IDLE(queue));
+    pthread_mutex_unlock(QUEUE_MUTEX(queue));
+    return NULL;
+}
+
+/*
+ * save_queue_free - Release everything save_queue_start() allocated
+ */
+static void save_queue_free(SaveQueue* queue) {
+    if (queue->jobs) {
+        for (u32 i = 0; i < queue->capacity; i++) free(queue->jobs[i].data);
+        free(queue->jobs);
+    }
+    free(queue->inflight.data);
+    if (queue->mutex) pthread_mutex_destroy(QUEUE_MUTEX(queue));
+    if (queue->wake) pthread_cond_destroy(QUEUE_WAKE(queue));
+    if (queue->idle) pthread_cond_destroy(QUEUE_IDLE(queue));
+    free(queue->mutex);
+    free(queue->wake);
+    free(queue->idle);
+    free(queue->thread);
+    memset(queue, 0, sizeof(SaveQueue));
+}
+
+bool save_queue_start(SaveQueue* queue) {
+    if (!queue) return false;
+    memset(queue, 0, sizeof(SaveQueue));
+
+    queue->capacity = SAVE_QUEUE_CAPACITY;
+    queue->jobs = (SaveJob*)calloc(queue->capacity, sizeof(SaveJob));
+    pthread_mutex_t* mutex = (pthread_mutex_t*)malloc(sizeof(pthread_mutex_t));
+    pthread_cond_t* wake = (pthread_cond_t*)malloc(sizeof(pthread_cond_t));
+    pthread_cond_t* idle = (pthread_cond_t*)malloc(sizeof(pthread_cond_t));
+    pthread_t* thread = (pthread_t*)malloc(sizeof(pthread_t));
+
+    bool ok = queue->jobs && mutex && wake && idle && thread;
+    if (ok && pthread_mutex_init(mutex, NULL) == 0) {
+        queue->mutex = mutex;
+    } else {
+        free(mutex);
+        ok = false;
+    }
+    if (ok && pthread_cond_init(wake, NULL) == 0) {
+        queue->wake = wake;
+    } else {
+        free(wake);
+        ok = false;
+    }
+    if (ok && pthread_cond_init(idle, NULL) == 0) {
+        queue->idle = idle;
+    } else {
+        free(idle);
+        ok = false;
+    }
+
+    if (ok) {
+        queue->thread = thread;
+        queue->running = true;
+
+        /* Signals stay on the game thread, as for the network thread */
+        sigset_t all, previous;
+        sigfillset(&all);
+        pthread_sigmask(SIG_BLOCK, &all, &previous);
+        int rc = pthread_create(thread, NULL, save_queue_thread_main, queue);
+        pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+        if (rc != 0) {
+            queue->running = false;
+            ok = false;
+        }
+    } else {
+        free(thread);
+    }
+
+    if (!ok) {
+        save_queue_free(queue);
+        fprintf(stderr, "WARNING: Save writer not started, saves are synchronous\n");
+        return false;
+    }
+
+    g_save_queue = queue;
+    printf("Save writer started (%u job queue)\n", queue->capacity);
+    return true;
+}
+
+void save_queue_stop(SaveQueue* queue) {
+    if (!queue || !queue->running) return;  /* Never started, or already stopped */
+    if (g_save_queue == queue) g_save_queue = NULL;
+
+    pthread_mutex_lock(QUEUE_MUTEX(queue));
+    queue->running = false;
+    pthread_cond_broadcast(QUEUE_WAKE(queue));
+    pthread_mutex_unlock(QUEUE_MUTEX(queue));
+
+    /* The thread drains every pending job before it exits */
+    pthread_join(*(pthread_t*)queue->thread, NULL);
+
+    printf("Save writer stopped (%llu saves written, %llu coalesced, %llu failed)\n",
+           (unsigned long long)queue->written, (unsigned long long)queue->coalesced,
+           (unsigned long long)queue->failed);
+    save_queue_free(queue);
+}
+
+bool save_queue_submit(SaveQueue* queue, const char* username, const u8* data, u32 size) {
+    if (!queue || !username || !data) return false;
+    if (strlen(username) > MAX_USERNAME_LENGTH) return false;
+
+    pthread_mutex_lock(QUEUE_MUTEX(queue));
+    bool queued = false;
+
+    if (queue->running) {
+        i32 slot = find_pending(queue, username);
+        if (slot >= 0) {
+            /* Newer snapshot of a save that has not been written yet */
+            SaveJob* job = &queue->jobs[slot];
+            if (job_reserve(job, size)) {
+                memcpy(job->data, data, size);
+                job->size = size;
+                queue->coalesced++;
+                queued = true;
+            }
+        } else if (queue->count < queue->capacity) {
+            SaveJob* job = &queue->jobs[(queue->head + queue->count) % queue->capacity];
+            if (job_reserve(job, size)) {
+                snprintf(job->username, sizeof(job->username), "%s", username);
+                memcpy(job->data, data, size);
+                job->size = size;
+                queue->count++;
+                pthread_cond_signal(QUEUE_WAKE(queue));
+                queued = true;
+            }
+        }
+        if (queued) queue->submitted++;
+    }
+
+    pthread_mutex_unlock(QUEUE_MUTEX(queue));
+    return queued;
+}
+
+bool save_queue_lookup(SaveQueue* queue, const char* username, u8* buffer, u32 capacity, u32* size) {
+    if (!queue || !username || !buffer || !size) return false;
+
+    pthread_mutex_lock(QUEUE_MUTEX(queue));
+    const SaveJob* job = NULL;
+
+    /* A pending job is always newer than the one being written */
+    i32 slot = find_pending(queue, username);
+    if (slot >= 0) {
+        job = &queue->jobs[slot];
+    } else if (queue->writing && strcmp(queue->inflight.username, username) == 0) {
+        job = &queue->inflight;
+    }
+
+    bool found = job && job->size <= capacity;
+    if (found) {
+        memcpy(buffer, job->data, job->size);
+        *size = job->size;
+    }
+
+    pthread_mutex_unlock(QUEUE_MUTEX(queue));
+    return found;
+}
+
+void save_queue_flush(SaveQueue* queue) {
+    if (!queue || !queue->running) return;
+
+    pthread_mutex_lock(QUEUE_MUTEX(queue));
+    while (queue->count > 0 || queue->writing) {
+        pthread_cond_wait(QUEUE_IDLE(queue), QUEUE_MUTEX(queue));
+    }
+    pthread_mutex_unlock(QUEUE_MUTEX(queue));
+}
+
+u32 save_queue_pending(SaveQueue* queue) {
+    if (!queue || !queue->running) return 0;
+
+    pthread_mutex_lock(QUEUE_MUTEX(queue));
+    u32 count = queue->count + (queue->writing ? 1 : 0);
+    pthread_mutex_unlock(QUEUE_MUTEX(queue));
+    return count;
+}
+
+#else /* _WIN32 */
+
+/*
+ * Windows: no writer thread (pthreads unavailable with MSVC). g_save_queue
+ * stays NULL and player_save() writes synchronously.
+ */
+bool save_queue_start(SaveQueue* queue) {
+    (void)queue;
+    fprintf(stderr, "WARNING: Save writer not supported on this platform, saves are synchronous\n");
+    return false;
+}
+void save_queue_stop(SaveQueue* queue) { (void)queue; }
+bool save_queue_submit(SaveQueue* queue, const char* username, const u8* data, u32 size) {
+    (void)queue; (void)username; (void)data; (void)size;
+    return false;
+}
+bool save_queue_lookup(SaveQueue* queue, const char* username, u8* buffer, u32 capacity, u32* size) {
+    (void)queue; (void)username; (void)buffer; (void)capacity; (void)size;
+    return false;
+}
+void save_queue_flush(SaveQueue* queue) { (void)queue; }
+u32 save_queue_pending(SaveQueue* queue) { (void)queue; return 0; }
+
+#endif /* _WIN32 */
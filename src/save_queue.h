@@ -0,0 +1,170 @@
+/*******************************************************************************
+ * SAVE_QUEUE.H - Background Player Save Writer
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Moving blocking I/O off a latency-critical thread
+ *   - Snapshotting: hand off immutable bytes, not live objects
+ *   - Bounded queues and back-pressure
+ *   - Write coalescing (last writer wins)
+ *
+ * THE PROBLEM:
+ *
+ * player_save() used to serialize, create the directory, write, fsync and
+ * rename the file on the caller's thread - the game thread, during logout
+ * or on the design screen. One slow disk turns every save into a stalled
+ * tick, and saving every online player periodically would freeze the
+ * server for the whole batch:
+ *
+ *   tick: |process|update|save A (fopen fwrite fsync rename)|save B ...|
+ *                                └──── milliseconds per player ────┘
+ *
+ * THE SOLUTION - SNAPSHOT ON THE TICK, WRITE ON A WORKER:
+ *
+ *   GAME THREAD                          SAVE WRITER THREAD
+ *   player_save()                        loop:
+ *     serialize → bytes (~170B)            wait for a job
+ *     save_queue_submit(name, bytes) ──→   take oldest job (pointer swap)
+ *     return (no syscalls)                 player_save_write(): tmp, fsync,
+ *                                          rename
+ *
+ * The game thread copies the already-serialized bytes into the queue, so
+ * the writer never touches a Player and needs no access to game state.
+ *
+ * COALESCING:
+ *   If a save for the same username is still waiting, its bytes are
+ *   replaced in place instead of queueing a second job. Repeated saves of
+ *   one player cost one disk write, and the queue holds at most one
+ *   pending job per player:
+ *
+ *   queue: [alice v1] [bob v1]   + submit(alice v2)
+ *      →   [alice v2] [bob v1]     (alice written once, with v2)
+ *
+ * BACK-PRESSURE:
+ *   The queue is bounded (SAVE_QUEUE_CAPACITY jobs). When it is full,
+ *   save_queue_submit() returns false and player_save() writes that save
+ *   synchronously: a save is never dropped, the tick only slows down when
+ *   the disk genuinely cannot keep up.
+ *
+ * READ-YOUR-WRITES:
+ *   A player who logs out and straight back in must not load the file
+ *   before their last save reaches it. save_queue_lookup() returns the
+ *   newest queued (or in-flight) bytes for a username, and player_load()
+ *   uses them instead of the file.
+ *
+ * PLATFORM:
+ *   POSIX threads. On Windows save_queue_start() fails, g_save_queue stays
+ *   NULL and every save is written synchronously as before.
+ *
+ ******************************************************************************/
+
+#ifndef SAVE_QUEUE_H
+#define SAVE_QUEUE_H
+
+#include "types.h"
+#include <stdbool.h>
+
+/* Pending jobs (at most one per player thanks to coalescing) */
+#define SAVE_QUEUE_CAPACITY 256
+
+/*
+ * SaveJob - One pending save: a username and its serialized bytes
+ */
+typedef struct {
+    char username[MAX_USERNAME_LENGTH + 1];
+    u8* data;               /* Serialized save (heap, reused between jobs) */
+    u32 size;               /* Bytes in data */
+    u32 data_capacity;      /* Allocated bytes in data */
+} SaveJob;
+
+/*
+ * SaveQueue - Bounded FIFO of jobs plus the writer thread
+ *
+ * jobs[] is a ring: the pending jobs are jobs[(head + i) % capacity] for
+ * i in [0, count). All fields except the writer's private buffer are
+ * protected by the mutex.
+ */
+typedef struct {
+    SaveJob* jobs;
+    u32 capacity;
+    u32 head;
+    u32 count;
+
+    SaveJob inflight;       /* Job being written (writer thread owns data) */
+    bool writing;           /* inflight is valid */
+
+    u64 submitted;          /* save_queue_submit() calls accepted */
+    u64 coalesced;          /* ...of which replaced a pending job */
+    u64 written;            /* Saves that reached the disk */
+    u64 failed;             /* Saves player_save_write() rejected */
+
+    bool running;
+    void* mutex;            /* pthread_mutex_t (opaque, as in netio.h) */
+    void* wake;             /* pthread_cond_t: job queued / stop requested */
+    void* idle;             /* pthread_cond_t: queue drained */
+    void* thread;           /* pthread_t */
+} SaveQueue;
+
+/*
+ * g_save_queue - Running save writer, or NULL (saves are synchronous)
+ */
+extern SaveQueue* g_save_queue;
+
+/*
+ * save_queue_start - Allocate the queue and start the writer thread
+ *
+ * @param queue  Zeroed SaveQueue to initialize
+ * @return       true on success; sets g_save_queue
+ */
+bool save_queue_start(SaveQueue* queue);
+
+/*
+ * save_queue_stop - Write every pending save, then stop the thread
+ *
+ * Blocks until the queue is empty. Safe to call more than once. Clears
+ * g_save_queue, so later saves are synchronous.
+ */
+void save_queue_stop(SaveQueue* queue);
+
+/*
+ * save_queue_submit - Queue serialized bytes for a username
+ *
+ * @param queue     Running queue (NULL-safe: returns false)
+ * @param username  Save file owner
+ * @param data      Serialized save (copied; caller keeps ownership)
+ * @param size      Bytes in data
+ * @return          true if queued or coalesced; false if the queue is
+ *                  full or not running (caller must write it itself)
+ *
+ * COMPLEXITY: O(pending jobs) to find a job to coalesce with, O(size) copy
+ */
+bool save_queue_submit(SaveQueue* queue, const char* username, const u8* data, u32 size);
+
+/*
+ * save_queue_lookup - Copy the newest not-yet-written save for a username
+ *
+ * @param queue     Queue (NULL-safe: returns false)
+ * @param username  Save file owner
+ * @param buffer    Receives the bytes
+ * @param capacity  Size of buffer
+ * @param size      Receives the byte count
+ * @return          true if a pending or in-flight save was found (and fit)
+ */
+bool save_queue_lookup(SaveQueue* queue, const char* username, u8* buffer, u32 capacity, u32* size);
+
+/*
+ * save_queue_flush - Block until every queued save has been written
+ *
+ * @param queue  Queue (NULL-safe)
+ */
+void save_queue_flush(SaveQueue* queue);
+
+/*
+ * save_queue_pending - Saves not yet on disk (queued plus in flight)
+ *
+ * @param queue  Queue (NULL-safe: 0)
+ */
+u32 save_queue_pending(SaveQueue* queue);
+
+#endif /* SAVE_QUEUE_H */
@@ -0,0 +1,271 @@
+/*******************************************************************************
+ * SCENE_DECODE.C - Map Square Decompression Implementation
+ *******************************************************************************
+ *
+ * See scene_decode.h for the design.
+ *
+ * ONE JOB PER FILE:
+ *
+ *   jobs[square * 2 + kind]
+ *
+ *   EMPTY ── submit ──→ PENDING ── worker or take ──→ RUNNING ──→ DONE
+ *     ↑                    ↑                                        │
+ *     └──── reset ─────────┴────────────── submit again ───────────┘
+ *
+ * Whoever moves a job to RUNNING decodes it with the mutex released and
+ * is the only thread touching its src and out meanwhile. Every other
+ * path that would change a RUNNING job (take, submit again, reset) waits
+ * on the done condition first.
+ *
+ ******************************************************************************/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "scene_decode.h"
+#include "thirdparty/bzip.h"
+
+typedef enum {
+    JOB_EMPTY = 0,
+    JOB_PENDING,
+    JOB_RUNNING,
+    JOB_DONE
+} JobState;
+
+typedef struct {
+    const int8_t *src;
+    int length;
+    int8_t *out;
+    JobState state;
+} DecodeJob;
+
+static struct {
+    DecodeJob *jobs;
+    int count;
+    bool running;
+} _Decode;
+
+#if (defined(__linux__) || defined(__APPLE__) || defined(__FreeBSD__)) && !defined(__EMSCRIPTEN__)
+
+#include <pthread.h>
+#include <signal.h>
+
+static pthread_mutex_t decode_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t decode_wake = PTHREAD_COND_INITIALIZER;  /* Job submitted / stop */
+static pthread_cond_t decode_done = PTHREAD_COND_INITIALIZER;  /* A RUNNING job finished */
+static pthread_t decode_thread;
+
+static void decode_lock(void) { pthread_mutex_lock(&decode_mutex); }
+static void decode_unlock(void) { pthread_mutex_unlock(&decode_mutex); }
+static void decode_wait_done(void) { pthread_cond_wait(&decode_done, &decode_mutex); }
+static void decode_finished(void) { pthread_cond_broadcast(&decode_done); }
+static void decode_submitted(void) { pthread_cond_signal(&decode_wake); }
+
+#else
+
+/* One thread: no job is ever seen RUNNING by anyone but its decoder */
+static void decode_lock(void) {}
+static void decode_unlock(void) {}
+static void decode_wait_done(void) {}
+static void decode_finished(void) {}
+static void decode_submitted(void) {}
+
+#endif
+
+/*
+ * decode_file - Decompress one map file (no shared state: any thread)
+ *
+ * The buffer keeps at least the length the file's header promises,
+ * zero-filled past the stream, as the shared 100000 byte buffer gave.
+ */
+static int8_t *decode_file(const int8_t *src, int length) {
+    if (!src || length < 4) {
+        return NULL;
+    }
+    int expected = (src[0] & 0xff) << 24 | (src[1] & 0xff) << 16 | (src[2] & 0xff) << 8 | (src[3] & 0xff);
+
+    int8_t *out = calloc(SCENE_DECODE_MAX_SIZE, sizeof(int8_t));
+    if (!out) {
+        return NULL;
+    }
+    int written = bzip_decompress_into((uint8_t *)out, SCENE_DECODE_MAX_SIZE, (const uint8_t *)src + 4, length - 4);
+    if (written < 0) {
+        free(out);
+        return NULL;
+    }
+
+    int keep = written > expected ? written : expected;
+    if (keep > SCENE_DECODE_MAX_SIZE) {
+        keep = SCENE_DECODE_MAX_SIZE;
+    }
+    if (keep < 1) {
+        keep = 1;
+    }
+    int8_t *shrunk = realloc(out, keep);
+    return shrunk ? shrunk : out;
+}
+
+/*
+ * job_at - Job of a square's file, or NULL out of range
+ */
+static DecodeJob *job_at(int square, SceneDecodeKind kind) {
+    int k = (int)kind;
+    int index = square * SCENE_DECODE_KINDS + k;
+    if (square < 0 || k < 0 || k >= SCENE_DECODE_KINDS || index >= _Decode.count) {
+        return NULL;
+    }
+    return &_Decode.jobs[index];
+}
+
+/*
+ * job_run - Decode a job the caller just moved to RUNNING (called locked)
+ */
+static void job_run(DecodeJob *job) {
+    const int8_t *src = job->src;
+    int length = job->length;
+    decode_unlock();
+    int8_t *out = decode_file(src, length);
+    decode_lock();
+    job->out = out;
+    job->state = JOB_DONE;
+    decode_finished();
+}
+
+static bool any_running(void) {
+    for (int i = 0; i < _Decode.count; i++) {
+        if (_Decode.jobs[i].state == JOB_RUNNING) {
+            return true;
+        }
+    }
+    return false;
+}
+
+#if (defined(__linux__) || defined(__APPLE__) || defined(__FreeBSD__)) && !defined(__EMSCRIPTEN__)
+
+static void *scene_decode_thread_main(void *arg) {
+    (void)arg;
+    decode_lock();
+    while (_Decode.running) {
+        DecodeJob *job = NULL;
+        for (int i = 0; i < _Decode.count && !job; i++) {
+            if (_Decode.jobs[i].state == JOB_PENDING) {
+                job = &_Decode.jobs[i];
+            }
+        }
+        if (!job) {
+            pthread_cond_wait(&decode_wake, &decode_mutex);
+            continue;
+        }
+        job->state = JOB_RUNNING;
+        job_run(job);
+    }
+    decode_unlock();
+    return NULL;
+}
+
+bool scene_decode_start(void) {
+    if (_Decode.running) {
+        return true;
+    }
+    _Decode.running = true;
+
+    /* Signals stay on the game thread */
+    sigset_t all, previous;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &previous);
+    int error = pthread_create(&decode_thread, NULL, scene_decode_thread_main, NULL);
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+    if (error != 0) {
+        _Decode.running = false;
+        fprintf(stderr, "WARNING: Scene decode thread not started, map files are decoded during the build\n");
+        return false;
+    }
+    return true;
+}
+
+void scene_decode_stop(void) {
+    if (_Decode.running) {
+        decode_lock();
+        _Decode.running = false;
+        pthread_cond_broadcast(&decode_wake);
+        decode_unlock();
+        pthread_join(decode_thread, NULL);
+    }
+    scene_decode_reset(0);
+}
+
+#else
+
+/*
+ * No POSIX threads (Windows, Emscripten, consoles): jobs stay PENDING
+ * until scene_decode_take() decodes them.
+ */
+bool scene_decode_start(void) {
+    fprintf(stderr, "WARNING: Scene decode thread not supported on this platform, map files are decoded during the build\n");
+    return false;
+}
+
+void scene_decode_stop(void) {
+    scene_decode_reset(0);
+}
+
+#endif
+
+void scene_decode_reset(int squares) {
+    decode_lock();
+    while (any_running()) {
+        decode_wait_done();
+    }
+    for (int i = 0; i < _Decode.count; i++) {
+        free(_Decode.jobs[i].out);
+    }
+    free(_Decode.jobs);
+    _Decode.jobs = NULL;
+    _Decode.count = 0;
+    if (squares > 0) {
+        _Decode.jobs = calloc(squares * SCENE_DECODE_KINDS, sizeof(DecodeJob));
+        if (_Decode.jobs) {
+            _Decode.count = squares * SCENE_DECODE_KINDS;
+        }
+    }
+    decode_unlock();
+}
+
+void scene_decode_submit(int square, SceneDecodeKind kind, const int8_t *src, int length) {
+    decode_lock();
+    DecodeJob *job = job_at(square, kind);
+    if (job) {
+        while (job->state == JOB_RUNNING) {
+            decode_wait_done();
+        }
+        free(job->out);
+        job->out = NULL;
+        job->src = src;
+        job->length = length;
+        job->state = JOB_PENDING;
+        decode_submitted();
+    }
+    decode_unlock();
+}
+
+const int8_t *scene_decode_take(int square, SceneDecodeKind kind) {
+    decode_lock();
+    DecodeJob *job = job_at(square, kind);
+    const int8_t *out = NULL;
+    if (job) {
+        while (job->state == JOB_RUNNING) {
+            decode_wait_done();
+        }
+        if (job->state == JOB_PENDING) {
+            job->state = JOB_RUNNING;
+            job_run(job);
+        }
+        out = job->out;
+    }
+    decode_unlock();
+    return out;
+}
@@ -0,0 +1,127 @@
+/*******************************************************************************
+ * SCENE_DECODE.H - Map Square Decompression Ahead of the Scene Build
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Starting work when its input arrives instead of when it is needed
+ *   - Splitting a job into a pure part (bytes → bytes) and a stateful part
+ *   - A consumer that helps out instead of waiting for an idle producer
+ *   - Keeping a result for the next time the same input is asked for
+ *
+ * THE PROBLEM:
+ *
+ * On a region change the server sends REBUILD_NORMAL, the client reads (or
+ * downloads) the land and loc files of up to 9 map squares, and on the
+ * next PLAYER_INFO client_build_scene() does all of this at once:
+ *
+ *   PLAYER_INFO ── bzip2 land ×9 ── load ground ── bzip2 locs ×9 ──
+ *                  load locs (models) ── world_build (lighting, normals)
+ *                  └────────────── one long frame: the game stalls ──────┘
+ *
+ * The bzip2 streams are decoded while the game waits, although the
+ * compressed bytes were complete (from the cache or the last DATA_*_DONE)
+ * a packet, often a whole frame, earlier.
+ *
+ * WHY NOT THE WHOLE BUILD ON A THREAD:
+ *   Everything after decompression touches shared client state: loading
+ *   locs goes through the LocType model caches and the scene arena,
+ *   world_build() lights models that the cache also hands to the
+ *   renderer, and REBUILD_NORMAL has already moved every entity to the
+ *   new base tile - the old scene cannot be drawn against it, and the
+ *   packets behind PLAYER_INFO (LOC_ADD, OBJ_ADD, ...) need the new scene
+ *   at once. A second World3D would have to copy or lock all of that.
+ *   Decompression reads only the file bytes and writes only its output.
+ *
+ * THE SOLUTION - DECODE EACH SQUARE WHEN ITS FILE IS COMPLETE:
+ *
+ *   GAME THREAD                              WORKER
+ *   REBUILD_NORMAL: scene_decode_reset(n)
+ *     cached file read ─ submit(i, LAND) ──→ bzip2 → job i done
+ *   DATA_LOC_DONE ────── submit(j, LOCS) ──→ bzip2 → job j done
+ *   ... frames drawn, packets read ...
+ *   PLAYER_INFO: client_build_scene()
+ *     scene_decode_take(i, LAND)  ← done: the buffer, no work
+ *     scene_decode_take(k, LOCS)  ← not started: decoded right here
+ *
+ * A job the worker has not reached is decoded by the game thread itself,
+ * so the build never waits behind a queue; it waits only for the one job
+ * the worker is in the middle of.
+ *
+ * KEPT UNTIL THE NEXT REGION:
+ *   Results live until scene_decode_reset(). In low memory mode a level
+ *   change rebuilds the scene from the same files, and takes the decoded
+ *   bytes again instead of decompressing all 18 files a second time.
+ *
+ * PLATFORM:
+ *   POSIX threads on Linux, macOS and the BSDs. Elsewhere (Windows,
+ *   Emscripten, the consoles) scene_decode_start() fails, submit only
+ *   records the file, and take decodes it on first use - still once per
+ *   region.
+ *
+ ******************************************************************************/
+
+#ifndef SCENE_DECODE_H
+#define SCENE_DECODE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Largest decompressed map file (the buffer client_build_scene used) */
+#define SCENE_DECODE_MAX_SIZE 100000
+
+/* Which of a square's two files */
+typedef enum {
+    SCENE_DECODE_LAND = 0,
+    SCENE_DECODE_LOCS,
+    SCENE_DECODE_KINDS
+} SceneDecodeKind;
+
+/*
+ * scene_decode_start - Start the worker thread
+ *
+ * @return  false if it could not run; files are decoded on first take
+ */
+bool scene_decode_start(void);
+
+/*
+ * scene_decode_stop - Stop the worker and free every result
+ */
+void scene_decode_stop(void);
+
+/*
+ * scene_decode_reset - Forget every job and size the table for a new region
+ *
+ * Waits for the job in progress, if any: afterwards no submitted file is
+ * read again, so the caller may free them.
+ *
+ * @param squares  Map squares of the new region (0 to just free)
+ */
+void scene_decode_reset(int squares);
+
+/*
+ * scene_decode_submit - Queue a complete file for decompression
+ *
+ * @param square  Index into the region's map squares
+ * @param kind    Land or locs
+ * @param src     Compressed file: 4-byte length, then the bzip2 stream.
+ *                Must stay unchanged until the next submit of the same
+ *                file or scene_decode_reset()
+ * @param length  Bytes in src
+ *
+ * Submitting a file again replaces its earlier result.
+ */
+void scene_decode_submit(int square, SceneDecodeKind kind, const int8_t *src, int length);
+
+/*
+ * scene_decode_take - Decompressed bytes of a submitted file
+ *
+ * Returns at once if the worker finished it, decodes it here if no one
+ * started it yet, or waits for the worker if it is decoding it now.
+ *
+ * @return  Buffer owned by this module until scene_decode_reset(), or
+ *          NULL if the file was not submitted or did not decode
+ */
+const int8_t *scene_decode_take(int square, SceneDecodeKind kind);
+
+#endif /* SCENE_DECODE_H */
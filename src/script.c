@@ -0,0 +1,552 @@
+/*******************************************************************************
+ * SCRIPT.C - Script Loader, Verifier and VM
+ *******************************************************************************
+ *
+ * See script.h for the instruction format and the suspension model.
+ *
+ ******************************************************************************/
+
+#include "script.h"
+#include "server_packets.h"
+#include "item.h"
+#include "map.h"
+#include "shop.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+ScriptRuntime* g_scripts = NULL;
+
+#define SCRIPT_OP_NAME(NAME, mnemonic, sig) mnemonic,
+#define SCRIPT_OP_SIG(NAME, mnemonic, sig)  sig,
+const char* const ScriptOpNames[SCRIPT_OP_COUNT] = { SCRIPT_OPS(SCRIPT_OP_NAME) };
+const char* const ScriptOpSignatures[SCRIPT_OP_COUNT] = { SCRIPT_OPS(SCRIPT_OP_SIG) };
+#undef SCRIPT_OP_NAME
+#undef SCRIPT_OP_SIG
+
+/*******************************************************************************
+ * LOADING AND VERIFICATION
+ ******************************************************************************/
+
+u32 script_name_hash(const char* name) {
+    u32 hash = 2166136261u;
+    for (const char* p = name; *p; p++) hash = (hash ^ (u8)*p) * 16777619u;
+    return hash;
+}
+
+static bool trigger_less(const ScriptTrigger* a, const ScriptTrigger* b) {
+    return a->kind < b->kind || (a->kind == b->kind && a->key < b->key);
+}
+
+/*
+ * verify_code - Check every instruction (see VERIFY ONCE in script.h)
+ *
+ * @param starts  Zeroed bitmap, one bit per code word: set for each
+ *                instruction start
+ */
+static bool verify_code(const ScriptProgram* program, u64* starts) {
+    const i32* code = program->code;
+    u32 words = program->code_words;
+    u32 last_op = SCRIPT_OP_COUNT;
+
+    /* Pass 1: decode, check operands, mark instruction starts */
+    for (u32 pc = 0; pc < words;) {
+        u32 word = (u32)code[pc];
+        u32 op = word & 0xFF;
+        u32 mask = (word >> 8) & 0xFF;
+        if (op >= SCRIPT_OP_COUNT || (word >> 16) != 0) return false;
+        const char* sig = ScriptOpSignatures[op];
+        u32 width = (u32)strlen(sig);
+        if (words - pc - 1 < width) return false;
+
+        for (u32 i = 0; i < width; i++) {
+            i32 operand = code[pc + 1 + i];
+            bool is_reg = (mask >> i) & 1;
+            switch (sig[i]) {
+                case 'r':
+                    if (!is_reg) return false;
+                    /* fall through */
+                case 'v':
+                    if (is_reg && (operand < 0 || operand >= SCRIPT_REGISTERS)) return false;
+                    break;
+                case 's':
+                    if (is_reg || operand < 0 || (u32)operand >= program->string_count) return false;
+                    break;
+                case 'l':
+                    if (is_reg || operand < 0 || (u32)operand >= words) return false;
+                    break;
+                default:
+                    return false;
+            }
+        }
+        if (mask >> width) return false;
+
+        starts[pc >> 6] |= 1ull << (pc & 63);
+        last_op = op;
+        pc += 1 + width;
+    }
+    if (last_op != SCRIPT_OP_END && last_op != SCRIPT_OP_JMP) return false;
+
+    /* Pass 2: jump targets land on instructions */
+    for (u32 pc = 0; pc < words;) {
+        u32 op = (u32)code[pc] & 0xFF;
+        const char* sig = ScriptOpSignatures[op];
+        u32 width = (u32)strlen(sig);
+        for (u32 i = 0; i < width; i++) {
+            if (sig[i] != 'l') continue;
+            u32 target = (u32)code[pc + 1 + i];
+            if (!(starts[target >> 6] & (1ull << (target & 63)))) return false;
+        }
+        pc += 1 + width;
+    }
+    return true;
+}
+
+/*
+ * verify_program - Sections, strings, triggers and code
+ */
+static bool verify_program(ScriptProgram* program) {
+    if (program->size < sizeof(ScriptFileHeader)) return false;
+    const ScriptFileHeader* header = (const ScriptFileHeader*)program->data;
+    if (header->magic != SCRIPT_MAGIC || header->version != SCRIPT_VERSION) return false;
+    if (header->code_words == 0 || (header->string_bytes & 3) != 0) return false;
+
+    u64 expected = sizeof(ScriptFileHeader) + (u64)header->trigger_count * sizeof(ScriptTrigger) +
+                   (u64)header->string_count * 4 + header->string_bytes +
+                   (u64)header->code_words * 4;
+    if (expected != program->size) return false;
+
+    u8* p = program->data + sizeof(ScriptFileHeader);
+    program->fingerprint = header->fingerprint;
+    program->triggers = (const ScriptTrigger*)p;
+    program->trigger_count = header->trigger_count;
+    p += (size_t)header->trigger_count * sizeof(ScriptTrigger);
+    program->string_offsets = (const u32*)p;
+    program->string_count = header->string_count;
+    p += (size_t)header->string_count * 4;
+    program->strings = (const char*)p;
+    p += header->string_bytes;
+    program->code = (const i32*)p;
+    program->code_words = header->code_words;
+
+    /* Strings: the table ends in a NUL, so every offset reads a terminated string */
+    if (header->string_count > 0 &&
+        (header->string_bytes == 0 || program->strings[header->string_bytes - 1] != '\0')) {
+        return false;
+    }
+    for (u32 i = 0; i < header->string_count; i++) {
+        if (program->string_offsets[i] >= header->string_bytes) return false;
+    }
+
+    u64* starts = (u64*)calloc((header->code_words + 63) / 64, sizeof(u64));
+    if (!starts) return false;
+    bool ok = verify_code(program, starts);
+
+    for (u32 i = 0; ok && i < header->trigger_count; i++) {
+        const ScriptTrigger* trigger = &program->triggers[i];
+        ok = trigger->kind < SCRIPT_TRIGGER_COUNT && trigger->entry < header->code_words &&
+             (starts[trigger->entry >> 6] & (1ull << (trigger->entry & 63))) &&
+             memchr(trigger->name, '\0', SCRIPT_NAME_MAX) != NULL &&
+             (i == 0 || !trigger_less(trigger, &program->triggers[i - 1]));
+    }
+    free(starts);
+    return ok;
+}
+
+ScriptProgram* script_program_load(u8* data, u32 size) {
+    ScriptProgram* program = (ScriptProgram*)calloc(1, sizeof(ScriptProgram));
+    if (!program) {
+        free(data);
+        return NULL;
+    }
+    program->data = data;
+    program->size = size;
+    if (!data || !verify_program(program)) {
+        script_program_destroy(program);
+        return NULL;
+    }
+    return program;
+}
+
+ScriptProgram* script_program_open(const char* path, u32 fingerprint) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return NULL;
+    u8* data = NULL;
+    long size = -1;
+    if (fseek(f, 0, SEEK_END) == 0) size = ftell(f);
+    if (size > 0 && size <= (long)UINT32_MAX && fseek(f, 0, SEEK_SET) == 0) {
+        data = (u8*)malloc((size_t)size);
+        if (data && fread(data, 1, (size_t)size, f) != (size_t)size) {
+            free(data);
+            data = NULL;
+        }
+    }
+    fclose(f);
+    if (!data) return NULL;
+
+    ScriptProgram* program = script_program_load(data, (u32)size);
+    if (!program) {
+        printf("Scripts %s are corrupt, recompiling\n", path);
+        return NULL;
+    }
+    if (fingerprint != 0 && program->fingerprint != fingerprint) {
+        printf("Scripts %s are stale, recompiling\n", path);
+        script_program_destroy(program);
+        return NULL;
+    }
+    return program;
+}
+
+bool script_program_save(const ScriptProgram* program, const char* path) {
+    char tmp[512];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE* f = fopen(tmp, "wb");
+    if (!f) return false;
+    bool ok = fwrite(program->data, 1, program->size, f) == program->size;
+    ok = (fclose(f) == 0) && ok;
+
+#ifdef _WIN32
+    remove(path);  /* rename() does not replace an existing file on Windows */
+#endif
+    if (!ok || rename(tmp, path) != 0) {
+        remove(tmp);
+        return false;
+    }
+    return true;
+}
+
+void script_program_destroy(ScriptProgram* program) {
+    if (!program) return;
+    free(program->data);
+    free(program);
+}
+
+const ScriptTrigger* script_find_trigger(const ScriptProgram* program, ScriptTriggerKind kind,
+                                         u32 key, const char* name) {
+    if (!program) return NULL;
+    if (kind == SCRIPT_TRIGGER_COMMAND) key = script_name_hash(name);
+    ScriptTrigger probe = { (u32)kind, key, 0, "" };
+
+    /* Lower bound of (kind, key), then the (rarely more than one) equal keys */
+    u32 lo = 0, hi = program->trigger_count;
+    while (lo < hi) {
+        u32 mid = lo + (hi - lo) / 2;
+        if (trigger_less(&program->triggers[mid], &probe)) lo = mid + 1;
+        else hi = mid;
+    }
+    for (; lo < program->trigger_count; lo++) {
+        const ScriptTrigger* trigger = &program->triggers[lo];
+        if (trigger->kind != (u32)kind || trigger->key != key) break;
+        if (kind != SCRIPT_TRIGGER_COMMAND || strcmp(trigger->name, name) == 0) return trigger;
+    }
+    return NULL;
+}
+
+/*******************************************************************************
+ * RUNTIME
+ ******************************************************************************/
+
+static void script_execute(ScriptRuntime* runtime, ScriptState* state);
+
+ScriptRuntime* script_runtime_create(ScriptProgram* program) {
+    ScriptRuntime* runtime = (ScriptRuntime*)calloc(1, sizeof(ScriptRuntime));
+    if (!runtime) {
+        script_program_destroy(program);
+        return NULL;
+    }
+    runtime->program = program;
+    return runtime;
+}
+
+/* End a script (finished, failed or cancelled) */
+static void script_stop(ScriptRuntime* runtime, ScriptState* state) {
+    if (state->wait != SCRIPT_WAIT_NONE) runtime->waiting--;
+    if (state->wait == SCRIPT_WAIT_DELAY) timer_cancel(g_timers, state->timer);
+    state->timer = TIMER_NONE;
+    state->wait = SCRIPT_WAIT_NONE;
+    state->player = NULL;
+}
+
+static void script_cancel_all(ScriptRuntime* runtime) {
+    for (u32 i = 0; i < MAX_PLAYERS; i++) {
+        if (runtime->states[i].player) script_stop(runtime, &runtime->states[i]);
+    }
+}
+
+void script_runtime_destroy(ScriptRuntime* runtime) {
+    if (!runtime) return;
+    script_cancel_all(runtime);
+    script_program_destroy(runtime->program);
+    free(runtime);
+}
+
+void script_runtime_swap(ScriptRuntime* runtime, ScriptProgram* program) {
+    if (!runtime) {
+        script_program_destroy(program);
+        return;
+    }
+    script_cancel_all(runtime);
+    script_program_destroy(runtime->program);
+    runtime->program = program;
+}
+
+static ScriptState* state_for(ScriptRuntime* runtime, const Player* player) {
+    if (!runtime || !player || player->index >= MAX_PLAYERS) return NULL;
+    return &runtime->states[player->index];
+}
+
+bool script_trigger(ScriptRuntime* runtime, Player* player, ScriptTriggerKind kind, u32 key,
+                    const char* name, const i32* args, u32 argc) {
+    ScriptState* state = state_for(runtime, player);
+    if (!state) return false;
+    const ScriptTrigger* trigger = script_find_trigger(runtime->program, kind, key, name);
+    if (!trigger) return false;
+
+    if (state->player) script_stop(runtime, state);
+    memset(state->regs, 0, sizeof(state->regs));
+    if (argc > SCRIPT_REGISTERS) argc = SCRIPT_REGISTERS;
+    if (args) memcpy(state->regs, args, argc * sizeof(i32));
+    state->player = player;
+    state->pc = trigger->entry;
+    runtime->runs++;
+    script_execute(runtime, state);
+    return true;
+}
+
+void script_resume_pause(ScriptRuntime* runtime, Player* player) {
+    ScriptState* state = state_for(runtime, player);
+    if (!state || state->player != player || state->wait != SCRIPT_WAIT_PAUSE) return;
+    state->wait = SCRIPT_WAIT_NONE;
+    runtime->waiting--;
+    script_execute(runtime, state);
+}
+
+void script_cancel(ScriptRuntime* runtime, Player* player) {
+    ScriptState* state = state_for(runtime, player);
+    if (state && state->player == player) script_stop(runtime, state);
+}
+
+/* g_timers callback: a delay is over (ctx = runtime, arg = player index) */
+static void script_timer_fired(void* ctx, u32 arg) {
+    ScriptRuntime* runtime = (ScriptRuntime*)ctx;
+    ScriptState* state = &runtime->states[arg];
+    if (!state->player || state->wait != SCRIPT_WAIT_DELAY) return;
+    state->timer = TIMER_NONE;
+    state->wait = SCRIPT_WAIT_NONE;
+    runtime->waiting--;
+    script_execute(runtime, state);
+}
+
+static void script_fail(ScriptRuntime* runtime, ScriptState* state, u32 pc, const char* reason) {
+    u32 op = (u32)runtime->program->code[pc] & 0xFF;
+    LOG_WARN("WARNING: Script for '%s' stopped at %u (%s): %s\n", state->player->username, pc,
+             ScriptOpNames[op], reason);
+    script_stop(runtime, state);
+}
+
+/*******************************************************************************
+ * OPERATIONS WITH SIDE EFFECTS
+ ******************************************************************************/
+
+static u32 inv_total(const ItemContainer* inv, i32 id) {
+    if (!inv || id <= 0) return 0;
+    u64 total = 0;
+    for (u32 slot = 0; slot < inv->capacity; slot++) {
+        if (inv->items[slot].id == (u32)id) total += inv->items[slot].amount;
+    }
+    return total > INT32_MAX ? INT32_MAX : (u32)total;
+}
+
+static void inv_del(ItemContainer* inv, i32 id, i32 amount) {
+    if (!inv || id <= 0 || amount <= 0) return;
+    u32 left = (u32)amount;
+    for (u32 slot = 0; slot < inv->capacity && left > 0; slot++) {
+        const Item* item = &inv->items[slot];
+        if (item->id != (u32)id || item->amount == 0) continue;
+        u32 take = item->amount < left ? item->amount : left;
+        if (item_container_remove(inv, slot, take)) left -= take;
+    }
+}
+
+static bool tele(Player* player, i32 x, i32 z, i32 level) {
+    if (x < 0 || x > 0x3FFF || z < 0 || z > 0x3FFF || level < 0 || level > 3) return false;
+    player_set_position(player, (u32)x, (u32)z, (u32)level);
+    map_send_load_area(player, (i32)position_get_mapsquare_x(&player->position),
+                       (i32)position_get_mapsquare_z(&player->position));
+    return true;
+}
+
+/*******************************************************************************
+ * INTERPRETER
+ ******************************************************************************/
+
+#if defined(__GNUC__)
+#define SCRIPT_COMPUTED_GOTO 1
+#endif
+
+/*
+ * script_execute - Run the state's script until it ends or waits
+ *
+ * The loader verified the code, so operands index registers and strings
+ * without checks (script.h, VERIFY ONCE).
+ */
+static void script_execute(ScriptRuntime* runtime, ScriptState* state) {
+    const ScriptProgram* program = runtime->program;
+    const i32* code = program->code;
+    i32* r = state->regs;
+    Player* player = state->player;
+    u32 pc = state->pc;
+    u32 jumps = 0;
+    u64 executed = 0;
+    u32 word;
+
+/* Operand i, as a raw word / as a value (register or immediate) / as a string */
+#define A(i)    code[pc + 1 + (i)]
+#define V(i)    (((word >> (8 + (i))) & 1) ? r[A(i)] : A(i))
+#define S(i)    (program->strings + program->string_offsets[A(i)])
+#define JUMP(target) do { \
+        if (++jumps > SCRIPT_JUMP_BUDGET) goto budget; \
+        pc = (u32)(target); \
+        DISPATCH(); \
+    } while (0)
+#define NEXT(NAME) do { pc += 1 + SCRIPT_WIDTH_##NAME; DISPATCH(); } while (0)
+
+#ifdef SCRIPT_COMPUTED_GOTO
+#define SCRIPT_OP_LABEL(NAME, mnemonic, sig) &&op_##NAME,
+    static void* const labels[SCRIPT_OP_COUNT] = { SCRIPT_OPS(SCRIPT_OP_LABEL) };
+#undef SCRIPT_OP_LABEL
+#define DISPATCH() do { executed++; word = (u32)code[pc]; goto *labels[word & 0xFF]; } while (0)
+#define OP(NAME) op_##NAME:
+    DISPATCH();
+#else
+#define DISPATCH() goto dispatch
+#define OP(NAME) case SCRIPT_OP_##NAME:
+dispatch:
+    executed++;
+    word = (u32)code[pc];
+    switch ((ScriptOp)(word & 0xFF)) {
+#endif
+
+    OP(END) {
+        script_stop(runtime, state);
+        goto done;
+    }
+    OP(SET) { r[A(0)] = V(1); NEXT(SET); }
+    OP(ADD) { r[A(0)] = (i32)((u32)V(1) + (u32)V(2)); NEXT(ADD); }
+    OP(SUB) { r[A(0)] = (i32)((u32)V(1) - (u32)V(2)); NEXT(SUB); }
+    OP(MUL) { r[A(0)] = (i32)((u32)V(1) * (u32)V(2)); NEXT(MUL); }
+    OP(DIV) {
+        i32 a = V(1), b = V(2);
+        if (b == 0) goto divide_by_zero;
+        r[A(0)] = (b == -1) ? (i32)(0u - (u32)a) : a / b;
+        NEXT(DIV);
+    }
+    OP(MOD) {
+        i32 a = V(1), b = V(2);
+        if (b == 0) goto divide_by_zero;
+        r[A(0)] = (b == -1) ? 0 : a % b;
+        NEXT(MOD);
+    }
+    OP(EQ) { r[A(0)] = V(1) == V(2); NEXT(EQ); }
+    OP(LT) { r[A(0)] = V(1) < V(2); NEXT(LT); }
+    OP(JMP) { JUMP(A(0)); }
+    OP(JZ) {
+        if (V(0) == 0) JUMP(A(1));
+        NEXT(JZ);
+    }
+    OP(JNZ) {
+        if (V(0) != 0) JUMP(A(1));
+        NEXT(JNZ);
+    }
+    OP(RAND) {
+        i32 n = V(1);
+        r[A(0)] = n > 0 ? rand() % n : 0;
+        NEXT(RAND);
+    }
+    OP(DELAY) {
+        i32 ticks = V(0);
+        state->pc = pc + 1 + SCRIPT_WIDTH_DELAY;
+        state->timer = timer_schedule(g_timers, ticks > 0 ? (u64)ticks : 1, script_timer_fired,
+                                      runtime, player->index);
+        if (state->timer == TIMER_NONE) {
+            script_fail(runtime, state, pc, "no timer");
+            goto done;
+        }
+        state->wait = SCRIPT_WAIT_DELAY;
+        runtime->waiting++;
+        goto done;
+    }
+    OP(PAUSE) {
+        state->pc = pc + 1 + SCRIPT_WIDTH_PAUSE;
+        state->wait = SCRIPT_WAIT_PAUSE;
+        runtime->waiting++;
+        goto done;
+    }
+    OP(MES) { send_player_message(player, S(0)); NEXT(MES); }
+    OP(MESINT) {
+        char line[128];
+        snprintf(line, sizeof(line), "%s%d", S(0), (int)V(1));
+        send_player_message(player, line);
+        NEXT(MESINT);
+    }
+    OP(IF_SETTEXT) { send_if_settext(player, V(0), S(1)); NEXT(IF_SETTEXT); }
+    OP(IF_OPENCHAT) { send_if_openbottom(player, V(0)); NEXT(IF_OPENCHAT); }
+    OP(IF_CLOSE) {
+        send_if_close(player);
+        shop_close(g_shops, player);
+        NEXT(IF_CLOSE);
+    }
+    OP(INV_ADD) {
+        i32 id = V(0), amount = V(1);
+        if (id > 0 && id <= 0xFFFF && amount > 0 && item_get_definition(g_items, (u16)id)) {
+            if (!item_container_add(player->inventory, (u16)id, (u32)amount)) {
+                send_player_message(player, "You don't have enough inventory space.");
+            }
+        }
+        NEXT(INV_ADD);
+    }
+    OP(INV_DEL) { inv_del(player->inventory, V(0), V(1)); NEXT(INV_DEL); }
+    OP(INV_TOTAL) { r[A(0)] = (i32)inv_total(player->inventory, V(1)); NEXT(INV_TOTAL); }
+    OP(STAT) {
+        i32 skill = V(1);
+        r[A(0)] = (skill >= 0 && skill < 21) ? player->levels[skill] : 0;
+        NEXT(STAT);
+    }
+    OP(TELE) {
+        if (!tele(player, V(0), V(1), V(2))) {
+            script_fail(runtime, state, pc, "bad coordinates");
+            goto done;
+        }
+        NEXT(TELE);
+    }
+    OP(SHOP_OPEN) {
+        if (!shop_open(g_shops, player, (u32)V(0))) {
+            script_fail(runtime, state, pc, "no such shop");
+            goto done;
+        }
+        NEXT(SHOP_OPEN);
+    }
+
+#ifndef SCRIPT_COMPUTED_GOTO
+        default:
+            goto done;  /* Unreachable: the loader checked every opcode */
+    }
+#endif
+
+divide_by_zero:
+    script_fail(runtime, state, pc, "division by zero");
+    goto done;
+budget:
+    script_fail(runtime, state, pc, "too many jumps");
+done:
+    runtime->instructions += executed;
+
+#undef A
+#undef V
+#undef S
+#undef JUMP
+#undef NEXT
+#undef DISPATCH
+#undef OP
+}
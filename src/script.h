@@ -0,0 +1,358 @@
+/*******************************************************************************
+ * SCRIPT.H - Bytecode Content Scripts with Suspendable Coroutines
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Register-based bytecode and a validating loader (verify once, run
+ *     without bounds checks)
+ *   - Threaded dispatch with computed goto (GCC labels as values)
+ *   - Coroutines as saved VM state: a script that waits is just a pc and
+ *     sixteen registers parked on the timer wheel
+ *   - Triggers: content bound to buttons, commands and login by data,
+ *     not by C
+ *
+ * THE PROBLEM:
+ *
+ * Gameplay is C: server_handle_if_button() compares component ids, and a
+ * new ::command is a handler plus a line in a table plus a rebuild. Timed
+ * content ("say this, wait 3 ticks, teleport") has nowhere to live at
+ * all: it would need a per-player countdown checked every tick, which is
+ * exactly what the timer wheel exists to avoid (timer_wheel.h). And a
+ * content change should not mean recompiling the server.
+ *
+ * THE SOLUTION - A SMALL VM THE CONTENT RUNS IN:
+ *
+ * Scripts are written as data/scripts/NAME.rs2 (script_asm.h), compiled to
+ * data/scripts.dat, and bound to triggers:
+ *
+ *   [command,home]                     ::home runs this
+ *       mes "You feel a tug..."
+ *       delay 3                        park for 3 ticks, the player plays on
+ *       tele 3222, 3218, 0
+ *       end
+ *
+ * The compiled code is an array of 32-bit words. Each instruction is an
+ * opcode word followed by its operands:
+ *
+ *   word 0:   [unused:16][register mask:8][opcode:8]
+ *   word 1..: operands; for a "v" operand, mask bit i set means operand i
+ *             is a register number, clear means it is the value itself
+ *
+ *   add r1, r1, 5      →   [ADD | 0b011 << 8] [1] [1] [5]
+ *
+ * Sixteen registers per script, all i32. Operands are typed by the op's
+ * signature in SCRIPT_OPS: r = register written, v = register or
+ * immediate, l = jump target (code word), s = string table index.
+ *
+ * DISPATCH:
+ *
+ * script_execute() jumps straight from one handler to the next through a
+ * table of label addresses, so each instruction ends in its own indirect
+ * jump (which the branch predictor learns per site) instead of all of
+ * them sharing the one jump at the top of a switch:
+ *
+ *   op_ADD:  r[A(0)] = V(1) + V(2);  pc += 4;  goto *labels[code[pc] & 0xFF];
+ *
+ * Compilers without labels as values get the same handlers in a switch.
+ *
+ * VERIFY ONCE:
+ *
+ * script_program_load() checks every instruction before anything runs:
+ * opcode in range, register numbers < 16, string indices in range, jump
+ * targets and trigger entries on instruction boundaries, and the last
+ * instruction an end or jmp so nothing can run off the code. The handlers
+ * then index code[], regs[] and strings[] without checks. What cannot be
+ * checked ahead (a division by a register holding 0, a loop that never
+ * ends) stops only the script: runs are limited to SCRIPT_JUMP_BUDGET
+ * backward-or-forward jumps.
+ *
+ * SUSPENDING:
+ *
+ * Each player runs at most one script; its state is a slot indexed by
+ * player->index (a new trigger replaces a waiting script):
+ *
+ *   delay n    save pc, timer_schedule(g_timers, n, resume): nothing is
+ *              looked at until the wheel fires it n ticks later
+ *   pause      save pc; RESUME_PAUSEBUTTON ("Click here to continue")
+ *              resumes it
+ *
+ * A thousand players waiting in scripts cost a thousand timer nodes and
+ * nothing per tick. player_drop() cancels the player's script, and
+ * script_runtime_swap() (::reloadscripts) cancels every one, since their
+ * saved pcs point into the old code.
+ *
+ * TRIGGERS:
+ *   [button,<component>]   IF_BUTTON on that component (r0 = component)
+ *   [command,<name>]       ::name, admin only; r0..r7 = numeric arguments
+ *   [login]                after the login packets (a hook_login subscriber)
+ *
+ * THREADS:
+ *   Game thread only.
+ *
+ ******************************************************************************/
+
+#ifndef SCRIPT_H
+#define SCRIPT_H
+
+#include "types.h"
+#include "player.h"
+#include "timer_wheel.h"
+#include <stdbool.h>
+
+/* Compiled program and its sources (see script_asm.h) */
+#define SCRIPT_PROGRAM_PATH "data/scripts.dat"
+#define SCRIPT_SOURCE_DIR   "data/scripts"
+
+#define SCRIPT_MAGIC        0x31435352u     /* "RSC1" little-endian */
+#define SCRIPT_VERSION      1
+
+#define SCRIPT_REGISTERS    16
+#define SCRIPT_MAX_OPERANDS 3
+
+/* Longest command trigger name (with NUL) */
+#define SCRIPT_NAME_MAX     16
+
+/* Jumps one run may take before the script is stopped */
+#define SCRIPT_JUMP_BUDGET  100000
+
+/*
+ * SCRIPT_OPS - Instruction set: X(NAME, mnemonic, operand signature)
+ *
+ *   Mnemonic     Operands        Effect
+ *   end                          stop
+ *   set          r, v            r = v
+ *   add/sub/mul  r, v, v         r = v op v (wrapping)
+ *   div/mod      r, v, v         r = v op v (stops the script on 0)
+ *   eq / lt      r, v, v         r = (v == v) / (v < v)
+ *   jmp          l               goto l
+ *   jz / jnz     v, l            goto l if v is zero / not zero
+ *   rand         r, v            r = random in [0, v)
+ *   delay        v               wait v ticks (at least 1)
+ *   pause                        wait for "Click here to continue"
+ *   mes          s               game message
+ *   mesint       s, v            game message: s followed by v
+ *   if_settext   v, s            set component v's text
+ *   if_openchat  v               open interface v in the chatbox
+ *   if_close                     close open interfaces (and the shop)
+ *   inv_add      v, v            add v2 of item v1 to the inventory
+ *   inv_del      v, v            remove up to v2 of item v1
+ *   inv_total    r, v            r = how many of item v the inventory holds
+ *   stat         r, v            r = current level of skill v (0 if none)
+ *   tele         v, v, v         move to x, z, level and send the region
+ *   shop_open    v               open shop v (shop.h)
+ */
+#define SCRIPT_OPS(X) \
+    X(END,         "end",         "")    \
+    X(SET,         "set",         "rv")  \
+    X(ADD,         "add",         "rvv") \
+    X(SUB,         "sub",         "rvv") \
+    X(MUL,         "mul",         "rvv") \
+    X(DIV,         "div",         "rvv") \
+    X(MOD,         "mod",         "rvv") \
+    X(EQ,          "eq",          "rvv") \
+    X(LT,          "lt",          "rvv") \
+    X(JMP,         "jmp",         "l")   \
+    X(JZ,          "jz",          "vl")  \
+    X(JNZ,         "jnz",         "vl")  \
+    X(RAND,        "rand",        "rv")  \
+    X(DELAY,       "delay",       "v")   \
+    X(PAUSE,       "pause",       "")    \
+    X(MES,         "mes",         "s")   \
+    X(MESINT,      "mesint",      "sv")  \
+    X(IF_SETTEXT,  "if_settext",  "vs")  \
+    X(IF_OPENCHAT, "if_openchat", "v")   \
+    X(IF_CLOSE,    "if_close",    "")    \
+    X(INV_ADD,     "inv_add",     "vv")  \
+    X(INV_DEL,     "inv_del",     "vv")  \
+    X(INV_TOTAL,   "inv_total",   "rv")  \
+    X(STAT,        "stat",        "rv")  \
+    X(TELE,        "tele",        "vvv") \
+    X(SHOP_OPEN,   "shop_open",   "v")
+
+#define SCRIPT_OP_ENUM(NAME, mnemonic, sig) SCRIPT_OP_##NAME,
+typedef enum {
+    SCRIPT_OPS(SCRIPT_OP_ENUM)
+    SCRIPT_OP_COUNT
+} ScriptOp;
+#undef SCRIPT_OP_ENUM
+
+/* Operand words after each opcode word (the signature's length) */
+#define SCRIPT_OP_WIDTH(NAME, mnemonic, sig) SCRIPT_WIDTH_##NAME = sizeof(sig) - 1,
+enum { SCRIPT_OPS(SCRIPT_OP_WIDTH) };
+#undef SCRIPT_OP_WIDTH
+
+extern const char* const ScriptOpNames[SCRIPT_OP_COUNT];
+extern const char* const ScriptOpSignatures[SCRIPT_OP_COUNT];
+
+/*
+ * ScriptTriggerKind - What starts a script
+ */
+typedef enum {
+    SCRIPT_TRIGGER_BUTTON = 0,          /* key = component id */
+    SCRIPT_TRIGGER_COMMAND,             /* key = FNV-1a of name */
+    SCRIPT_TRIGGER_LOGIN,               /* key = 0 */
+    SCRIPT_TRIGGER_COUNT
+} ScriptTriggerKind;
+
+/*
+ * ScriptTrigger - One script's entry point (sorted by kind, then key)
+ */
+typedef struct {
+    u32 kind;                           /* ScriptTriggerKind */
+    u32 key;
+    u32 entry;                          /* Code word of the first instruction */
+    char name[SCRIPT_NAME_MAX];         /* Command name, "" otherwise */
+} ScriptTrigger;
+
+/*
+ * ScriptFileHeader - Start of data/scripts.dat (native byte order)
+ *
+ * Followed by, each a multiple of 4 bytes:
+ *   ScriptTrigger triggers[trigger_count]
+ *   u32           string_offsets[string_count]
+ *   char          strings[string_bytes]        NUL-terminated, padded to 4
+ *   i32           code[code_words]
+ */
+typedef struct {
+    u32 magic;                          /* SCRIPT_MAGIC */
+    u32 version;                        /* SCRIPT_VERSION */
+    u32 fingerprint;                    /* Of the sources (script_sources_fingerprint) */
+    u32 code_words;
+    u32 string_count;
+    u32 string_bytes;                   /* Padded length */
+    u32 trigger_count;
+    u32 reserved;
+} ScriptFileHeader;
+
+/*
+ * ScriptProgram - Verified code, strings and triggers (one allocation)
+ */
+typedef struct {
+    u8* data;                           /* The file image, sections point into it */
+    u32 size;
+    u32 fingerprint;
+    const ScriptTrigger* triggers;
+    u32 trigger_count;
+    const u32* string_offsets;
+    const char* strings;
+    u32 string_count;
+    const i32* code;
+    u32 code_words;
+} ScriptProgram;
+
+/*
+ * ScriptState - One player's running or waiting script
+ */
+typedef struct {
+    Player* player;                     /* NULL = no script */
+    u32 pc;                             /* Next instruction when resumed */
+    u8 wait;                            /* SCRIPT_WAIT_* */
+    TimerHandle timer;                  /* Pending delay (g_timers) */
+    i32 regs[SCRIPT_REGISTERS];
+} ScriptState;
+
+#define SCRIPT_WAIT_NONE  0             /* Running (or about to start) */
+#define SCRIPT_WAIT_DELAY 1             /* On the timer wheel */
+#define SCRIPT_WAIT_PAUSE 2             /* Until RESUME_PAUSEBUTTON */
+
+/*
+ * ScriptRuntime - The program and every player's script state
+ */
+typedef struct {
+    ScriptProgram* program;
+    ScriptState states[MAX_PLAYERS];    /* By player->index */
+    u32 waiting;                        /* Scripts suspended right now */
+    u64 runs;                           /* Scripts started */
+    u64 instructions;                   /* Executed, all scripts */
+} ScriptRuntime;
+
+/*
+ * g_scripts - The server's runtime
+ *
+ * Created by server_init() when scripts loaded; NULL otherwise (every
+ * function below then does nothing).
+ */
+extern ScriptRuntime* g_scripts;
+
+/*
+ * script_program_load - Verify a program image and take ownership of it
+ *
+ * @param data  malloc()ed image (ScriptFileHeader first); freed on failure
+ * @param size  Bytes in data
+ * @return      Program, or NULL if the image fails verification
+ */
+ScriptProgram* script_program_load(u8* data, u32 size);
+
+/*
+ * script_program_open - Read and verify data/scripts.dat
+ *
+ * @param fingerprint  Expected source fingerprint (0 accepts any)
+ * @return             Program, or NULL if missing, stale or corrupt
+ */
+ScriptProgram* script_program_open(const char* path, u32 fingerprint);
+
+/*
+ * script_program_save - Write a program image (via a .tmp and rename)
+ */
+bool script_program_save(const ScriptProgram* program, const char* path);
+
+void script_program_destroy(ScriptProgram* program);
+
+/*
+ * script_find_trigger - Entry for a trigger
+ *
+ * @param name  Command name for SCRIPT_TRIGGER_COMMAND (key is ignored)
+ * @return      Trigger, or NULL if no script has it
+ *
+ * COMPLEXITY: O(log triggers)
+ */
+const ScriptTrigger* script_find_trigger(const ScriptProgram* program, ScriptTriggerKind kind,
+                                         u32 key, const char* name);
+
+/*
+ * script_name_hash - Command trigger key (FNV-1a, as command.h hashes)
+ */
+u32 script_name_hash(const char* name);
+
+/*
+ * script_runtime_create - Runtime over a program (takes ownership)
+ */
+ScriptRuntime* script_runtime_create(ScriptProgram* program);
+
+/*
+ * script_runtime_destroy - Cancel every script, free runtime and program
+ */
+void script_runtime_destroy(ScriptRuntime* runtime);
+
+/*
+ * script_runtime_swap - Replace the program (::reloadscripts)
+ *
+ * Every running script is cancelled first. The old program is freed.
+ */
+void script_runtime_swap(ScriptRuntime* runtime, ScriptProgram* program);
+
+/*
+ * script_trigger - Start the player's script for a trigger, if there is one
+ *
+ * @param args   Initial r0.. values (may be NULL)
+ * @param argc   Number of them (at most SCRIPT_REGISTERS)
+ * @return       true if a script was found (and has run up to its first
+ *               wait or its end)
+ *
+ * A script the player was waiting in is cancelled first.
+ */
+bool script_trigger(ScriptRuntime* runtime, Player* player, ScriptTriggerKind kind, u32 key,
+                    const char* name, const i32* args, u32 argc);
+
+/*
+ * script_resume_pause - RESUME_PAUSEBUTTON: continue a paused script
+ */
+void script_resume_pause(ScriptRuntime* runtime, Player* player);
+
+/*
+ * script_cancel - Stop the player's script (logout, replacement)
+ */
+void script_cancel(ScriptRuntime* runtime, Player* player);
+
+#endif /* SCRIPT_H */
@@ -0,0 +1,623 @@
+/*******************************************************************************
+ * SCRIPT_ASM.C - Script Compiler Implementation
+ *******************************************************************************
+ *
+ * See script_asm.h for the source format.
+ *
+ * One pass over the text emits code with jump operands to labels not yet
+ * seen left as 0 and remembered (a fixup); the end of each script fills
+ * them in from its label table. The triggers are then sorted for
+ * script_find_trigger()'s binary search and everything is laid out as
+ * the file image script_program_load() verifies.
+ *
+ ******************************************************************************/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include "script_asm.h"
+#include "crc32.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+
+/* Per script */
+#define ASM_MAX_LABELS 256
+#define ASM_MAX_FIXUPS 1024
+#define ASM_NAME_MAX   32
+
+typedef struct {
+    char name[ASM_NAME_MAX];
+    u32 pos;
+} AsmLabel;
+
+typedef struct {
+    char name[ASM_NAME_MAX];
+    u32 word;                   /* Code word to patch */
+    u32 line;
+} AsmFixup;
+
+typedef struct {
+    i32* code;
+    u32 code_words, code_cap;
+    char* strings;
+    u32 string_bytes, string_cap;
+    u32* offsets;
+    u32 string_count, offsets_cap;
+    ScriptTrigger* triggers;
+    u32 trigger_count, trigger_cap;
+
+    AsmLabel labels[ASM_MAX_LABELS];
+    u32 label_count;
+    AsmFixup fixups[ASM_MAX_FIXUPS];
+    u32 fixup_count;
+    bool in_script;
+    u32 last_op;                /* Last op emitted in the current script */
+
+    const char* file;
+    u32 line;
+    u32 errors;
+} Assembler;
+
+/*******************************************************************************
+ * SOURCE FILES
+ ******************************************************************************/
+
+typedef char SourceName[64];
+
+static int name_compare(const void* a, const void* b) {
+    return strcmp((const char*)a, (const char*)b);
+}
+
+static bool has_rs2_suffix(const char* name) {
+    size_t len = strlen(name);
+    return len > 4 && len < sizeof(SourceName) && strcmp(name + len - 4, ".rs2") == 0;
+}
+
+/*
+ * list_sources - .rs2 file names in dir, sorted
+ *
+ * @return  Number found, or -1 if dir cannot be read
+ */
+static i32 list_sources(const char* dir, SourceName* names) {
+    u32 count = 0;
+#ifdef _WIN32
+    char pattern[512];
+    snprintf(pattern, sizeof(pattern), "%s\\*.rs2", dir);
+    WIN32_FIND_DATAA entry;
+    HANDLE handle = FindFirstFileA(pattern, &entry);
+    if (handle == INVALID_HANDLE_VALUE) return -1;
+    do {
+        if (entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
+        if (!has_rs2_suffix(entry.cFileName) || count >= SCRIPT_MAX_FILES) continue;
+        snprintf(names[count++], sizeof(SourceName), "%s", entry.cFileName);
+    } while (FindNextFileA(handle, &entry));
+    FindClose(handle);
+#else
+    DIR* handle = opendir(dir);
+    if (!handle) return -1;
+    struct dirent* entry;
+    while ((entry = readdir(handle)) != NULL) {
+        if (!has_rs2_suffix(entry->d_name) || count >= SCRIPT_MAX_FILES) continue;
+        snprintf(names[count++], sizeof(SourceName), "%s", entry->d_name);
+    }
+    closedir(handle);
+#endif
+    qsort(names, count, sizeof(SourceName), name_compare);
+    return (i32)count;
+}
+
+/* Whole file, NUL-terminated (NULL if unreadable) */
+static char* read_source(const char* dir, const char* name, u32* size_out) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    FILE* f = fopen(path, "rb");
+    if (!f) return NULL;
+    char* text = NULL;
+    long size = -1;
+    if (fseek(f, 0, SEEK_END) == 0) size = ftell(f);
+    if (size >= 0 && fseek(f, 0, SEEK_SET) == 0) {
+        text = (char*)malloc((size_t)size + 1);
+        if (text && fread(text, 1, (size_t)size, f) != (size_t)size) {
+            free(text);
+            text = NULL;
+        }
+    }
+    fclose(f);
+    if (!text) return NULL;
+    text[size] = '\0';
+    *size_out = (u32)size;
+    return text;
+}
+
+u32 script_sources_fingerprint(const char* dir) {
+    static SourceName names[SCRIPT_MAX_FILES];
+    i32 count = list_sources(dir, names);
+    if (count < 0) return 0;
+
+    /* Chained in name order: renaming, editing or adding a file changes it */
+    u32 words[4] = { 0, (u32)count, SCRIPT_VERSION, 0 };
+    for (i32 i = 0; i < count; i++) {
+        u32 size = 0;
+        char* text = read_source(dir, names[i], &size);
+        u32 pair[3] = { words[0], crc32((const u8*)names[i], strlen(names[i])),
+                        text ? crc32((const u8*)text, size) : 0 };
+        free(text);
+        words[0] = crc32((const u8*)pair, sizeof(pair));
+    }
+    u32 crc = crc32((const u8*)words, sizeof(words));
+    return crc ? crc : 1;
+}
+
+/*******************************************************************************
+ * EMITTING
+ ******************************************************************************/
+
+static void asm_error(Assembler* as, const char* message) {
+    fprintf(stderr, "%s:%u: %s\n", as->file, as->line, message);
+    as->errors++;
+}
+
+/*
+ * grow - Make room for extra more elements in a growing array
+ *
+ * @return  The (possibly moved) array, or NULL (the old one is kept)
+ */
+static void* grow(Assembler* as, void* array, u32* cap, u32 count, u32 extra, size_t elem) {
+    if (count + extra <= *cap) return array;
+    u32 new_cap = *cap ? *cap * 2 : 256;
+    while (new_cap < count + extra) new_cap *= 2;
+    void* grown = realloc(array, (size_t)new_cap * elem);
+    if (!grown) {
+        asm_error(as, "out of memory");
+        return NULL;
+    }
+    *cap = new_cap;
+    return grown;
+}
+
+static bool emit(Assembler* as, i32 word) {
+    i32* code = (i32*)grow(as, as->code, &as->code_cap, as->code_words, 1, sizeof(i32));
+    if (!code) return false;
+    as->code = code;
+    as->code[as->code_words++] = word;
+    return true;
+}
+
+/* String table index of text (identical strings are stored once) */
+static i32 intern(Assembler* as, const char* text, u32 len) {
+    for (u32 i = 0; i < as->string_count; i++) {
+        const char* s = as->strings + as->offsets[i];
+        if (strlen(s) == len && memcmp(s, text, len) == 0) return (i32)i;
+    }
+    u32* offsets = (u32*)grow(as, as->offsets, &as->offsets_cap, as->string_count, 1, sizeof(u32));
+    if (!offsets) return -1;
+    as->offsets = offsets;
+    char* strings = (char*)grow(as, as->strings, &as->string_cap, as->string_bytes, len + 1, 1);
+    if (!strings) return -1;
+    as->strings = strings;
+    as->offsets[as->string_count] = as->string_bytes;
+    memcpy(as->strings + as->string_bytes, text, len);
+    as->strings[as->string_bytes + len] = '\0';
+    as->string_bytes += len + 1;
+    return (i32)as->string_count++;
+}
+
+/* Close the current script: implicit end, then patch its forward jumps */
+static void end_script(Assembler* as) {
+    if (!as->in_script) return;
+    if (as->last_op != SCRIPT_OP_END && as->last_op != SCRIPT_OP_JMP) {
+        emit(as, SCRIPT_OP_END);
+    }
+    for (u32 i = 0; i < as->fixup_count; i++) {
+        const AsmFixup* fixup = &as->fixups[i];
+        u32 l = 0;
+        while (l < as->label_count && strcmp(as->labels[l].name, fixup->name) != 0) l++;
+        if (l == as->label_count) {
+            as->line = fixup->line;
+            asm_error(as, "undefined label");
+            continue;
+        }
+        as->code[fixup->word] = (i32)as->labels[l].pos;
+    }
+    as->label_count = 0;
+    as->fixup_count = 0;
+    as->in_script = false;
+}
+
+/*******************************************************************************
+ * PARSING
+ ******************************************************************************/
+
+static const char* skip_space(const char* p) {
+    while (*p == ' ' || *p == '\t') p++;
+    return p;
+}
+
+static bool is_ident(char c) {
+    return isalnum((unsigned char)c) || c == '_';
+}
+
+/* Copy an identifier into out (NUL-terminated); returns the end or NULL */
+static const char* read_ident(const char* p, char* out, u32 max) {
+    u32 len = 0;
+    while (is_ident(*p)) {
+        if (len + 1 >= max) return NULL;
+        out[len++] = *p++;
+    }
+    out[len] = '\0';
+    return len ? p : NULL;
+}
+
+/*
+ * parse_trigger - "[button,123]", "[command,name]" or "[login]"
+ */
+static void parse_trigger(Assembler* as, const char* p) {
+    end_script(as);
+
+    char kind[16], key[ASM_NAME_MAX] = "";
+    p = read_ident(skip_space(p + 1), kind, sizeof(kind));
+    if (!p) {
+        asm_error(as, "expected trigger");
+        return;
+    }
+    p = skip_space(p);
+    if (*p == ',') {
+        p = read_ident(skip_space(p + 1), key, sizeof(key));
+        if (!p) {
+            asm_error(as, "expected trigger key");
+            return;
+        }
+        p = skip_space(p);
+    }
+    if (*p != ']' || *skip_space(p + 1) != '\0') {
+        asm_error(as, "expected ']'");
+        return;
+    }
+
+    ScriptTrigger trigger;
+    memset(&trigger, 0, sizeof(trigger));
+    if (strcmp(kind, "button") == 0) {
+        char* end;
+        unsigned long component = strtoul(key, &end, 10);
+        if (!key[0] || *end || component > 0xFFFF) {
+            asm_error(as, "button trigger needs a component id");
+            return;
+        }
+        trigger.kind = SCRIPT_TRIGGER_BUTTON;
+        trigger.key = (u32)component;
+    } else if (strcmp(kind, "command") == 0) {
+        size_t len = strlen(key);
+        bool lower = len > 0 && len < SCRIPT_NAME_MAX;
+        for (size_t i = 0; lower && i < len; i++) lower = !isupper((unsigned char)key[i]);
+        if (!lower) {
+            asm_error(as, "command trigger needs a lowercase name of at most 15 characters");
+            return;
+        }
+        trigger.kind = SCRIPT_TRIGGER_COMMAND;
+        trigger.key = script_name_hash(key);
+        memcpy(trigger.name, key, len + 1);
+    } else if (strcmp(kind, "login") == 0 && !key[0]) {
+        trigger.kind = SCRIPT_TRIGGER_LOGIN;
+    } else {
+        asm_error(as, "unknown trigger");
+        return;
+    }
+
+    ScriptTrigger* triggers = (ScriptTrigger*)grow(as, as->triggers, &as->trigger_cap,
+                                                   as->trigger_count, 1, sizeof(ScriptTrigger));
+    if (!triggers) return;
+    as->triggers = triggers;
+    trigger.entry = as->code_words;
+    as->triggers[as->trigger_count++] = trigger;
+    as->in_script = true;
+    as->last_op = SCRIPT_OP_COUNT;
+}
+
+/*
+ * parse_operand - One operand of the kind sig asks for
+ *
+ * @return  End of the operand, or NULL after reporting an error
+ */
+static const char* parse_operand(Assembler* as, const char* p, char sig, u32 index, i32* value,
+                                 bool* is_reg) {
+    *is_reg = false;
+    if (*p == '"') {
+        if (sig != 's') {
+            asm_error(as, "unexpected string");
+            return NULL;
+        }
+        char text[256];
+        u32 len = 0;
+        for (p++; *p && *p != '"'; p++) {
+            if (*p == '\\' && (p[1] == '"' || p[1] == '\\')) p++;
+            if (len + 1 >= sizeof(text)) {
+                asm_error(as, "string too long");
+                return NULL;
+            }
+            text[len++] = *p;
+        }
+        if (*p != '"') {
+            asm_error(as, "unterminated string");
+            return NULL;
+        }
+        *value = intern(as, text, len);
+        return *value < 0 ? NULL : p + 1;
+    }
+
+    if (*p == '-' || isdigit((unsigned char)*p)) {
+        char* end;
+        long number = strtol(p, &end, 10);
+        if (sig != 'v') {
+            asm_error(as, "unexpected number");
+            return NULL;
+        }
+        if (end == p || number < INT32_MIN || number > INT32_MAX) {
+            asm_error(as, "bad number");
+            return NULL;
+        }
+        *value = (i32)number;
+        return end;
+    }
+
+    char name[ASM_NAME_MAX];
+    const char* end = read_ident(p, name, sizeof(name));
+    if (!end) {
+        asm_error(as, "expected operand");
+        return NULL;
+    }
+    if (name[0] == 'r' && isdigit((unsigned char)name[1]) && (sig == 'r' || sig == 'v')) {
+        char* digits_end;
+        long reg = strtol(name + 1, &digits_end, 10);
+        if (*digits_end || reg >= SCRIPT_REGISTERS) {
+            asm_error(as, "registers are r0..r15");
+            return NULL;
+        }
+        *value = (i32)reg;
+        *is_reg = true;
+        return end;
+    }
+    if (sig != 'l') {
+        asm_error(as, sig == 'r' ? "expected register" : "unexpected label");
+        return NULL;
+    }
+    if (as->fixup_count == ASM_MAX_FIXUPS) {
+        asm_error(as, "too many jumps in one script");
+        return NULL;
+    }
+    AsmFixup* fixup = &as->fixups[as->fixup_count++];
+    memcpy(fixup->name, name, sizeof(name));
+    fixup->word = as->code_words + 1 + index;   /* Where the operand will be emitted */
+    fixup->line = as->line;
+    *value = 0;
+    return end;
+}
+
+/*
+ * parse_instruction - "mnemonic op, op, ..."
+ */
+static void parse_instruction(Assembler* as, const char* p) {
+    char mnemonic[ASM_NAME_MAX];
+    p = read_ident(p, mnemonic, sizeof(mnemonic));
+    u32 op = 0;
+    while (p && op < SCRIPT_OP_COUNT && strcmp(ScriptOpNames[op], mnemonic) != 0) op++;
+    if (!p || op == SCRIPT_OP_COUNT) {
+        asm_error(as, "unknown instruction");
+        return;
+    }
+    if (!as->in_script) {
+        asm_error(as, "instruction before the first trigger");
+        return;
+    }
+
+    const char* sig = ScriptOpSignatures[op];
+    u32 width = (u32)strlen(sig);
+    i32 operands[SCRIPT_MAX_OPERANDS];
+    u32 mask = 0;
+    for (u32 i = 0; i < width; i++) {
+        p = skip_space(p);
+        if (i > 0) {
+            if (*p != ',') {
+                asm_error(as, "expected ','");
+                return;
+            }
+            p = skip_space(p + 1);
+        }
+        bool is_reg;
+        p = parse_operand(as, p, sig[i], i, &operands[i], &is_reg);
+        if (!p) return;
+        if (is_reg) mask |= 1u << i;
+    }
+    if (*skip_space(p) != '\0') {
+        asm_error(as, "too many operands");
+        return;
+    }
+
+    emit(as, (i32)(op | (mask << 8)));
+    for (u32 i = 0; i < width; i++) emit(as, operands[i]);
+    as->last_op = op;
+}
+
+/*
+ * parse_line - Comment stripped, trimmed line
+ */
+static void parse_line(Assembler* as, char* line) {
+    /* Cut "//" comments that are not inside a string */
+    bool quoted = false;
+    for (char* p = line; *p; p++) {
+        if (*p == '\\' && quoted && p[1]) {
+            p++;
+        } else if (*p == '"') {
+            quoted = !quoted;
+        } else if (!quoted && p[0] == '/' && p[1] == '/') {
+            *p = '\0';
+            break;
+        }
+    }
+    size_t len = strlen(line);
+    while (len > 0 && isspace((unsigned char)line[len - 1])) line[--len] = '\0';
+    const char* p = skip_space(line);
+    if (!*p) return;
+
+    if (*p == '[') {
+        parse_trigger(as, p);
+        return;
+    }
+
+    /* "name:" defines a label */
+    char name[ASM_NAME_MAX];
+    const char* end = read_ident(p, name, sizeof(name));
+    if (end && *end == ':' && *skip_space(end + 1) == '\0') {
+        if (!as->in_script) {
+            asm_error(as, "label before the first trigger");
+            return;
+        }
+        for (u32 i = 0; i < as->label_count; i++) {
+            if (strcmp(as->labels[i].name, name) == 0) {
+                asm_error(as, "label defined twice");
+                return;
+            }
+        }
+        if (as->label_count == ASM_MAX_LABELS) {
+            asm_error(as, "too many labels in one script");
+            return;
+        }
+        memcpy(as->labels[as->label_count].name, name, sizeof(name));
+        as->labels[as->label_count++].pos = as->code_words;
+        /* Jumping to a label at the very end needs an instruction there */
+        as->last_op = SCRIPT_OP_COUNT;
+        return;
+    }
+
+    parse_instruction(as, p);
+}
+
+static void compile_file(Assembler* as, const char* dir, const char* name) {
+    as->file = name;
+    as->line = 0;
+    u32 size;
+    char* text = read_source(dir, name, &size);
+    if (!text) {
+        asm_error(as, "cannot read file");
+        return;
+    }
+    for (char* line = text; line;) {
+        char* next = strchr(line, '\n');
+        if (next) *next++ = '\0';
+        as->line++;
+        parse_line(as, line);
+        line = next;
+    }
+    end_script(as);
+    free(text);
+}
+
+/*******************************************************************************
+ * OUTPUT
+ ******************************************************************************/
+
+static int trigger_compare(const void* a, const void* b) {
+    const ScriptTrigger* x = (const ScriptTrigger*)a;
+    const ScriptTrigger* y = (const ScriptTrigger*)b;
+    if (x->kind != y->kind) return x->kind < y->kind ? -1 : 1;
+    if (x->key != y->key) return x->key < y->key ? -1 : 1;
+    return strcmp(x->name, y->name);
+}
+
+/* Lay the assembled sections out as a file image */
+static u8* build_image(Assembler* as, u32 fingerprint, u32* size_out) {
+    u32 string_bytes = (as->string_bytes + 3) & ~3u;
+    u64 size = sizeof(ScriptFileHeader) + (u64)as->trigger_count * sizeof(ScriptTrigger) +
+               (u64)as->string_count * 4 + string_bytes + (u64)as->code_words * 4;
+    if (size > UINT32_MAX) return NULL;
+    u8* image = (u8*)calloc(1, (size_t)size);
+    if (!image) return NULL;
+
+    ScriptFileHeader header = {
+        SCRIPT_MAGIC, SCRIPT_VERSION, fingerprint, as->code_words,
+        as->string_count, string_bytes, as->trigger_count, 0
+    };
+    u8* p = image;
+    memcpy(p, &header, sizeof(header));
+    p += sizeof(header);
+    if (as->trigger_count) memcpy(p, as->triggers, as->trigger_count * sizeof(ScriptTrigger));
+    p += as->trigger_count * sizeof(ScriptTrigger);
+    if (as->string_count) memcpy(p, as->offsets, as->string_count * 4);
+    p += as->string_count * 4;
+    if (as->string_bytes) memcpy(p, as->strings, as->string_bytes);
+    p += string_bytes;
+    memcpy(p, as->code, as->code_words * 4);
+    *size_out = (u32)size;
+    return image;
+}
+
+ScriptProgram* script_compile(const char* dir) {
+    static SourceName names[SCRIPT_MAX_FILES];
+    i32 count = list_sources(dir, names);
+    if (count < 0) {
+        fprintf(stderr, "%s: cannot read script directory\n", dir);
+        return NULL;
+    }
+
+    Assembler* as = (Assembler*)calloc(1, sizeof(Assembler));
+    if (!as) return NULL;
+    for (i32 i = 0; i < count; i++) compile_file(as, dir, names[i]);
+
+    /* No scripts at all still makes a valid (empty) program */
+    if (as->code_words == 0) emit(as, SCRIPT_OP_END);
+
+    qsort(as->triggers, as->trigger_count, sizeof(ScriptTrigger), trigger_compare);
+    for (u32 i = 1; i < as->trigger_count; i++) {
+        if (trigger_compare(&as->triggers[i - 1], &as->triggers[i]) == 0) {
+            fprintf(stderr, "%s: trigger defined twice (%s)\n", dir,
+                    as->triggers[i].name[0] ? as->triggers[i].name : "button or login");
+            as->errors++;
+        }
+    }
+
+    ScriptProgram* program = NULL;
+    if (as->errors == 0) {
+        u32 size = 0;
+        u8* image = build_image(as, script_sources_fingerprint(dir), &size);
+        program = script_program_load(image, size);
+        if (!program) fprintf(stderr, "%s: compiled program failed verification\n", dir);
+    } else {
+        fprintf(stderr, "%s: %u error(s), scripts not compiled\n", dir, as->errors);
+    }
+
+    free(as->code);
+    free(as->strings);
+    free(as->offsets);
+    free(as->triggers);
+    free(as);
+    return program;
+}
+
+ScriptProgram* script_load(const char* dir, const char* path) {
+    ScriptProgram* program = script_program_open(path, script_sources_fingerprint(dir));
+    if (program) return program;
+
+    program = script_compile(dir);
+    if (program && !script_program_save(program, path)) {
+        fprintf(stderr, "WARNING: Failed to write %s\n", path);
+    }
+    return program;
+}
+
+bool script_build(const char* dir, const char* path) {
+    ScriptProgram* program = script_compile(dir);
+    if (!program) return false;
+    bool ok = script_program_save(program, path);
+    if (ok) {
+        printf("Wrote scripts %s (%u triggers, %u code words, %u bytes)\n", path,
+               program->trigger_count, program->code_words, program->size);
+    }
+    script_program_destroy(program);
+    return ok;
+}
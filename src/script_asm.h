@@ -0,0 +1,94 @@
+/*******************************************************************************
+ * SCRIPT_ASM.H - Compiling data/scripts/NAME.rs2 into data/scripts.dat
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - A two-pass assembler: labels resolved by backpatching
+ *   - Build artifacts keyed on a fingerprint of their inputs
+ *   - One verifier for every producer (the compiler's output goes through
+ *     the same script_program_load() as a file from disk)
+ *
+ * THE PROBLEM:
+ *
+ * The VM (script.h) runs words, and nobody writes words. Compiling text
+ * at every boot is cheap for a handful of scripts but should not be the
+ * deploy path, and a stale compiled file must never run against changed
+ * sources.
+ *
+ * THE SOLUTION - SOURCE TEXT, COMPILED ONCE, CHECKED BY FINGERPRINT:
+ *
+ *   data/scripts/NAME.rs2  ──script_compile()──>  image  ──script_program_load()
+ *                                                │         (verify)
+ *                                                └─> data/scripts.dat
+ *
+ * make scripts (./bin/rs225 --build-scripts) writes data/scripts.dat;
+ * the server loads it at boot when its fingerprint (a CRC of every .rs2
+ * file's name and contents) matches, and otherwise compiles the sources
+ * and writes the file itself, as the world snapshot does (snapshot.h).
+ *
+ * SOURCE FORMAT:
+ *
+ *   // comment to end of line
+ *   [command,home]              trigger: button,<id> | command,<name> | login
+ *       mes "You feel a tug..."
+ *       set r1, 3
+ *   loop:                       label (local to its script)
+ *       mesint "Teleporting in ", r1
+ *       delay 1
+ *       sub r1, r1, 1
+ *       jnz r1, loop
+ *       tele 3222, 3218, 0
+ *       end
+ *
+ *   Operands are registers r0..r15, decimal integers, "strings" (with \"
+ *   and \\ escapes) or labels, as the op's signature asks (script.h).
+ *   A script that does not end in end or jmp gets an end appended.
+ *   Files are compiled in name order, so the output does not depend on
+ *   the directory listing.
+ *
+ * ERRORS:
+ *   Printed as file:line: message; nothing is written and the previous
+ *   program stays in use.
+ *
+ ******************************************************************************/
+
+#ifndef SCRIPT_ASM_H
+#define SCRIPT_ASM_H
+
+#include "script.h"
+
+/* Most .rs2 files read from one directory */
+#define SCRIPT_MAX_FILES 256
+
+/*
+ * script_sources_fingerprint - CRC of every .rs2 file's name and contents
+ *
+ * @return  Fingerprint (never 0), 0 if the directory cannot be read
+ */
+u32 script_sources_fingerprint(const char* dir);
+
+/*
+ * script_compile - Compile every .rs2 file in dir
+ *
+ * @return  Verified program, or NULL (errors printed)
+ */
+ScriptProgram* script_compile(const char* dir);
+
+/*
+ * script_load - The program for the sources in dir
+ *
+ * @param dir   Source directory (SCRIPT_SOURCE_DIR)
+ * @param path  Compiled program (SCRIPT_PROGRAM_PATH)
+ * @return      path's program if its fingerprint matches, otherwise the
+ *              freshly compiled sources (then written to path); NULL if
+ *              they do not compile
+ */
+ScriptProgram* script_load(const char* dir, const char* path);
+
+/*
+ * script_build - Compile dir and write path (--build-scripts)
+ */
+bool script_build(const char* dir, const char* path);
+
+#endif /* SCRIPT_ASM_H */
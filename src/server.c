@@ -48,14 +48,16 @@
  *   │          last_tick_time = current_time;                  │
  *   │      }                                                   │
  *   │                                                          │
+ *   │      flush queued output (one send() per connection)     │
+ *   │                                                          │
+ *   │      network_wait(until next tick);  // epoll/kqueue     │
+ *   │                                                          │
  *   │      ┌───────────────────────────────┐                   │
- *   │      │ NETWORK PROCESSING            │                   │
+ *   │      │ NETWORK PROCESSING (ready fds)│                   │
  *   │      │ - Accept new connections      │                   │
  *   │      │ - Read incoming packets       │                   │
  *   │      │ - Parse and dispatch packets  │                   │
  *   │      └───────────────────────────────┘                   │
- *   │                                                          │
- *   │      usleep(1000);  // 1ms sleep                         │
  *   │  }                                                       │
  *   └──────────────────────────────────────────────────────────┘
  * 
@@ -80,7 +82,7 @@
  *   Stage 3: Opcode Decryption
  *   ┌─────────────────────────────────────────────────────────┐
  *   │ encrypted_opcode = buffer[0]                            │
- *   │ key = isaac_get_next(player->in_cipher)                 │
+ *   │ key = isaac_get_next(player->conn->in_cipher)                 │
  *   │ opcode = (encrypted_opcode - key) & 0xFF                │
  *   └─────────────────────────────────────────────────────────┘
  *                             |
@@ -109,9 +111,9 @@
  *   Stage 6: Packet Dispatch
  *   ┌─────────────────────────────────────────────────────────┐
  *   │ switch (opcode) {                                       │
- *   │     case 93/165/181: handle_movement(...); break;       │
- *   │     case 52:  handle_player_design(...); break;         │
- *   │     case 158: handle_command(...); break;               │
+ *   │     case CLIENT_MOVE_*:  handle_movement(...); break;   │
+ *   │     case CLIENT_IF_PLAYERDESIGN: handle_design(...);    │
+ *   │     case CLIENT_CLIENT_CHEAT: handle_command(...);      │
  *   │     ...                                                 │
  *   │ }                                                       │
  *   └─────────────────────────────────────────────────────────┘
@@ -132,7 +134,7 @@
  * WIRE FORMAT:
  *   [opcode][ctrl_down][start_x][start_z][dx0][dz0][dx1][dz1]...
  *   
- *   opcode:    248, 165, 181, or 93 (different movement types)
+ *   opcode:    181, 165 or 93 (game click, minimap click, op click)
  *   ctrl_down: 1 if running, 0 if walking
  *   start_x:   16-bit absolute X coordinate (big-endian)
  *   start_z:   16-bit absolute Z coordinate (big-endian)
@@ -259,20 +261,64 @@
 #endif
 
 #include "server.h"
+#include "log.h"
 #include "buffer.h"
 #include "login.h"
 #include "update.h"
 #include "world.h"
 #include "map.h"
+#include "map_store.h"
+#include "world_collision.h"
+#include "pathfinder.h"
 #include "packets.h"
+#include "packet_codec.h"
 #include "constants.h"
 #include "server_packets.h"
 #include "cache.h"
+#include "def_store.h"
+#include "snapshot.h"
+#include "crc32.h"
 #include "item.h"
 #include "npc.h"
 #include "object.h"
+#include "ground_item.h"
 #include "player_save.h"
+#include "rsa_key.h"
+#include "timer_wheel.h"
+#include "tick_stats.h"
+#include "tick_governor.h"
+#include "metrics.h"
+#include "packet_profile.h"
+#include "replay.h"
+#include "broadcast.h"
+#include "chat.h"
+#include "chat_filter.h"
+#include "command.h"
+#include "account_registry.h"
+#include "presence.h"
+#include "supervisor.h"
+#include "trace.h"
+#include "probe.h"
+#include "mem_stats.h"
+#include "script.h"
+#include "script_asm.h"
+#include "hooks.h"
+#include "zone_update.h"
+#include "combat.h"
+#include "aggression.h"
+#include "instance.h"
+#include "asset_http.h"
+#include "session.h"
+#include "checkpoint.h"
+#include "occupancy.h"
+#include "activation.h"
+#include "static_locs.h"
+#include "social.h"
+#include "shop.h"
+#include "traffic.h"
+#include "cluster.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
@@ -310,6 +356,8 @@ static int win_clock_gettime(int clk_id, struct timespec* tp) {
 #define clock_gettime(clk_id, tp) win_clock_gettime(clk_id, tp)
 #define CLOCK_MONOTONIC 1
 #else
+#include <fcntl.h>
+#include <sys/resource.h>
 #include <unistd.h>
 #endif
 
@@ -319,12 +367,76 @@ static int win_clock_gettime(int clk_id, struct timespec* tp) {
  * These functions are static (file-scoped) to prevent namespace pollution.
  */
 static void server_handle_packet(Player* player, u8 opcode, StreamBuffer* buf, u32 packet_length);
+static void server_dispatch_packet(Player* player, u8 opcode, StreamBuffer* buf, u32 packet_length);
+static void server_process_slot_records(GameServer* server, u32 slot, bool tick);
+static void server_process_tick_input(GameServer* server);
+static void server_replay_tick_input(GameServer* server);
 static void server_handle_movement_packet(Player* player, StreamBuffer* buf, u32 packet_length, u8 opcode);
 static void server_handle_player_design(Player* player, StreamBuffer* buf);
 static void server_handle_if_button(Player* player, StreamBuffer* buf);
 static void server_handle_command(Player* player, StreamBuffer* buf, u32 packet_length);
+static void server_register_commands(void);
+static void server_register_script_commands(void);
+static void server_register_hooks(void);
 static void server_send_initial_game_packets(Player* player);
 
+/* World snapshot the map store, collision and definitions point into */
+static Snapshot* g_snapshot = NULL;
+
+TickCatchup g_tick_catchup = TICK_CATCHUP_SKIP;
+
+ServerLimits g_server_limits = {
+    .players = MAX_PLAYERS - 1,
+    .npcs = MAX_NPCS,
+    .ground_items = MAX_GROUND_ITEMS,
+    .waypoints = MAX_WAYPOINTS,
+    .tick_ms = TICK_RATE_MS,
+};
+
+static u32 clamp_limit(u32 value, u32 low, u32 high) {
+    return value < low ? low : value > high ? high : value;
+}
+
+void server_limits_clamp(ServerLimits* limits) {
+    limits->players = clamp_limit(limits->players, 1, MAX_PLAYERS - 1);
+    limits->npcs = clamp_limit(limits->npcs, 1, MAX_NPCS);
+    limits->ground_items = clamp_limit(limits->ground_items, 1, MAX_GROUND_ITEMS);
+    limits->waypoints = clamp_limit(limits->waypoints, 1, MAX_WAYPOINTS);
+    if (limits->tick_ms < SERVER_TICK_MS_MIN) limits->tick_ms = SERVER_TICK_MS_MIN;
+}
+
+/*
+ * snapshot_layout - Hash of the sizes of every struct stored in the snapshot
+ *
+ * Part of the fingerprint: a binary built with a different struct layout
+ * never reads a snapshot written by another.
+ */
+static u32 snapshot_layout(void) {
+    u32 sizes[] = {
+        sizeof(ItemDefinition), sizeof(DefText), sizeof(NpcDefinition),
+        sizeof(ObjectDefinition), sizeof(ObjectText), sizeof(MapFileRecord),
+        WORLD_PAGE_TILES * sizeof(u16), sizeof(StaticLoc)
+    };
+    return crc32((const u8*)sizes, sizeof(sizes));
+}
+
+/*
+ * server_write_snapshot - Save the loaded tables as the world snapshot
+ */
+static bool server_write_snapshot(const char* path, u32 fingerprint) {
+    SnapshotWriter writer;
+    memset(&writer, 0, sizeof(writer));
+
+    bool ok = fingerprint != 0 &&
+              def_store_snapshot(g_defs, &writer) &&
+              map_store_snapshot(g_map_store, &writer) &&
+              world_collision_snapshot(g_world_collision, &writer) &&
+              static_locs_snapshot(g_static_locs, &writer) &&
+              snapshot_writer_save(&writer, path, fingerprint);
+    snapshot_writer_free(&writer);
+    return ok;
+}
+
 /*******************************************************************************
  * SERVER LIFECYCLE MANAGEMENT
  ******************************************************************************/
@@ -334,7 +446,7 @@ static void server_send_initial_game_packets(Player* player);
  * 
  * INITIALIZATION ORDER:
  *   1. World (must exist before anything can reference it)
- *   2. Cache (needed for loading definitions)
+ *   2. Cache (needed for loading definitions; warmed on a worker pool)
  *   3. Item system (uses cache definitions)
  *   4. NPC system (uses cache definitions)
  *   5. Object system (uses cache definitions)
@@ -355,32 +467,97 @@ static void server_send_initial_game_packets(Player* player);
  * 
  * COMPLEXITY: O(1) time (all subsystems have constant init time)
  */
-bool server_init(GameServer* server, u16 port) {
-    printf("Initializing server..\n");
-    
-    /* Zero-initialize entire server structure */
-    memset(server, 0, sizeof(GameServer));
-    
-    /* Initialize world - central game state container */
-    printf("Creating world...\n");
-    g_world = world_create();
-    if (!g_world) {
-        fprintf(stderr, "ERROR: Failed to create world\n");
-        return false;
-    }
+/* Set once server_load_assets() has run (before any fork, supervisor.h) */
+static bool g_assets_loaded = false;
+
+bool server_load_assets(void) {
+    if (g_assets_loaded) return true;
     
     /* Initialize cache - loads item/NPC/object definitions from disk */
     printf("Creating cache system...\n");
     g_cache = cache_create();
     if (!g_cache) {
         fprintf(stderr, "ERROR: Failed to create cache\n");
-        world_destroy(g_world);
         return false;
     }
     if (!cache_init(g_cache, "data")) {
         fprintf(stderr, "WARNING: Cache initialization had issues\n");
     }
     
+    /* Decompress independent archives in parallel instead of on first use */
+    struct timespec warm_start, warm_end;
+    clock_gettime(CLOCK_MONOTONIC, &warm_start);
+    u32 archives = cache_warm(g_cache, CACHE_WARM_WORKERS);
+    clock_gettime(CLOCK_MONOTONIC, &warm_end);
+    printf("Cache warmed: %u archives, %llu bytes decompressed in %ld ms\n", archives,
+           (unsigned long long)g_cache->memo_bytes,
+           (long)((warm_end.tv_sec - warm_start.tv_sec) * 1000 +
+                  (warm_end.tv_nsec - warm_start.tv_nsec) / 1000000));
+    
+    /* Word lists for public chat, compiled once into the filter's automata */
+    g_chat_filter = chat_filter_create(g_cache);
+    if (g_chat_filter) {
+        printf("Chat filter compiled: %u states\n", chat_filter_states(g_chat_filter));
+    } else {
+        fprintf(stderr, "WARNING: Chat filter unavailable, public chat is not filtered\n");
+    }
+    
+    /* ::commands, looked up by hash from here on (command.h) */
+    server_register_commands();
+    
+    /* Prebuilt maps, collision and definitions, if they match this data */
+    u32 fingerprint = snapshot_fingerprint(g_cache, "data/maps", snapshot_layout());
+    g_snapshot = snapshot_open(SNAPSHOT_PATH, fingerprint);
+    
+    /* Load every map file and its CRC once, so region changes never hit disk */
+    printf("Loading map store...\n");
+    g_map_store = map_store_create_from_snapshot(g_snapshot);
+    if (!g_map_store) {
+        g_map_store = map_store_create("data/maps");
+    }
+    if (!g_map_store) {
+        fprintf(stderr, "WARNING: Failed to create map store\n");
+    }
+    
+    /* Decode walls and objects from the map files so server paths avoid them */
+    printf("Building world collision...\n");
+    g_world_collision = world_collision_create_from_snapshot(g_snapshot);
+    if (!g_world_collision) {
+        g_world_collision = world_collision_create(g_map_store, g_cache);
+    }
+    g_pathfinder = pathfinder_create();
+    
+    /* Every map loc, packed per mapsquare; runtime changes override it (static_locs.h) */
+    g_static_locs = static_locs_create_from_snapshot(g_snapshot);
+    if (!g_static_locs) {
+        g_static_locs = static_locs_create(g_map_store);
+    }
+    
+    /* Timer wheel for tick-scheduled events (respawns, despawns, delays) */
+    g_timers = timer_wheel_create(4096, 0);
+    if (!g_timers) {
+        fprintf(stderr, "WARNING: Failed to create timer wheel, timed events disabled\n");
+    }
+    
+    /* Content scripts: data/scripts.dat, or compiled from data/scripts (script.h) */
+    ScriptProgram* scripts = script_load(SCRIPT_SOURCE_DIR, SCRIPT_PROGRAM_PATH);
+    g_scripts = scripts ? script_runtime_create(scripts) : NULL;
+    if (g_scripts) {
+        server_register_script_commands();
+        printf("Scripts loaded: %u triggers, %u code words\n", scripts->trigger_count,
+               scripts->code_words);
+    } else {
+        fprintf(stderr, "WARNING: No content scripts loaded\n");
+    }
+    
+    /* Definition tables: mapped from the snapshot, or decoded below */
+    g_defs = def_store_create(g_snapshot);
+    if (!g_defs) {
+        fprintf(stderr, "WARNING: Failed to create definition store\n");
+    } else if (g_defs->snapshot) {
+        printf("Definitions mapped from %s\n", SNAPSHOT_PATH);
+    }
+    
     /* Initialize item system - manages item definitions and spawns */
     printf("Creating item system...\n");
     g_items = item_system_create();
@@ -392,52 +569,202 @@ bool server_init(GameServer* server, u16 port) {
         fprintf(stderr, "WARNING: Failed to create item system\n");
     }
     
+    /* Tiles NPCs and players stand on, before anything spawns (occupancy.h) */
+    g_occupancy = occupancy_create();
+    if (!g_occupancy) {
+        fprintf(stderr, "WARNING: Failed to create occupancy map, NPCs may stack\n");
+    }
+    
     /* Initialize NPC system - manages spawns and AI */
     printf("Creating NPC system...\n");
-    g_npcs = npc_system_create(MAX_NPCS);
+    g_npcs = npc_system_create(g_server_limits.npcs);
     if (g_npcs) {
         if (!npc_system_init(g_npcs)) {
             fprintf(stderr, "WARNING: NPC system initialization failed\n");
         }
         
-        /* Spawn test NPCs in Lumbridge (starting area) */
-        printf("Spawning test NPCs...\n");
-        npc_spawn(g_npcs, 0, 3222, 3218, 0);  /* Hans (NPC ID 0) */
-        npc_spawn(g_npcs, 1, 3220, 3220, 0);  /* Man (NPC ID 1) */
     } else {
         fprintf(stderr, "WARNING: Failed to create NPC system\n");
     }
     
     /* Initialize object system - manages scenery and interactive objects */
     printf("Creating object system...\n");
-    g_objects = object_system_create(MAX_GROUND_ITEMS);
+    g_objects = object_system_create(g_server_limits.ground_items);
     if (g_objects) {
         if (!object_system_init(g_objects)) {
             fprintf(stderr, "WARNING: Object system initialization failed\n");
         }
-        
-        /* Spawn test objects in Lumbridge */
-        printf("Spawning test objects...\n");
-        object_spawn(g_objects, 1519, 3220, 3210, 0, OBJECT_TYPE_WALL, 0);  /* Door */
-        object_spawn(g_objects, 1276, 3225, 3225, 0, OBJECT_TYPE_INTERACTABLE, 0);  /* Tree */
     } else {
         fprintf(stderr, "WARNING: Failed to create object system\n");
     }
     
+    /* Spawns are registered by mapsquare and made when a player comes
+     * near (activation.h); without the registry they are made now */
+    g_activation = activation_create();
+    if (!g_activation) {
+        fprintf(stderr, "WARNING: Failed to create activation map, spawning everything now\n");
+    }
+    
+    /* Friend lists told of logins and logouts once per tick (social.h) */
+    g_social = social_system_create();
+    if (!g_social) {
+        fprintf(stderr, "WARNING: Failed to create social system, friends will not see status\n");
+    }
+    
+    /* Shop stock, sent to its viewers as per-tick deltas (shop.h) */
+    g_shops = shop_system_create();
+    if (!g_shops) {
+        fprintf(stderr, "WARNING: Failed to create shops\n");
+    }
+    
+    /* Test NPCs and objects in Lumbridge (starting area) */
+    printf("Registering test spawns...\n");
+    activation_add_npc(g_activation, 0, 3222, 3218, 0);  /* Hans (NPC ID 0) */
+    activation_add_npc(g_activation, 1, 3220, 3220, 0);  /* Man (NPC ID 1) */
+    activation_add_loc(g_activation, 1519, 3220, 3210, 0, OBJECT_TYPE_WALL, 0);  /* Door */
+    activation_add_loc(g_activation, 1276, 3225, 3225, 0, OBJECT_TYPE_INTERACTABLE, 0);  /* Tree */
+    
+    /* Built anything this boot: write the snapshot so the next boot maps it */
+    bool rebuilt = !g_snapshot || (g_map_store && !g_map_store->from_snapshot) ||
+                   (g_world_collision && g_world_collision->page_pool) ||
+                   (g_static_locs && g_static_locs->owned_locs) ||
+                   (g_defs && !g_defs->snapshot);
+    if (rebuilt && fingerprint != 0 && !server_write_snapshot(SNAPSHOT_PATH, fingerprint)) {
+        fprintf(stderr, "WARNING: Failed to write %s\n", SNAPSHOT_PATH);
+    }
+    
+    /* Login block key: without data/rsa.key, blocks are read as plaintext */
+    g_rsa_key = rsa_key_load(RSA_KEY_PATH);
+    if (!g_rsa_key) {
+        printf("No RSA login key, login blocks are read as plaintext\n");
+    }
+    
+    g_assets_loaded = true;
+    return true;
+}
+
+bool server_init(GameServer* server, u16 port) {
+    printf("Initializing server..\n");
+    
+    /* Zero-initialize entire server structure */
+    memset(server, 0, sizeof(GameServer));
+    
+    /* Sizes this world runs with (--max-players ..., see RUNTIME LIMITS) */
+    server_limits_clamp(&g_server_limits);
+    g_movement_waypoints = g_server_limits.waypoints;
+    g_tick_stats.period_ms = g_server_limits.tick_ms;
+    printf("Limits: %u players, %u NPCs, %u ground items, %u waypoints, %u ms ticks\n",
+           g_server_limits.players, g_server_limits.npcs, g_server_limits.ground_items,
+           g_server_limits.waypoints, g_server_limits.tick_ms);
+    
+    /* Cache, maps, collision, definitions: already loaded by a supervisor */
+    if (!server_load_assets()) {
+        return false;
+    }
+    
+    /* Initialize world - central game state container */
+    printf("Creating world...\n");
+    g_world = world_create(g_server_limits.players + 1);  /* PID 0 is never used */
+    if (!g_world) {
+        fprintf(stderr, "ERROR: Failed to create world\n");
+        return false;
+    }
+    
+    /* Ground items - dropped items, filed by zone and sent as zone deltas */
+    g_ground_items = ground_item_system_create(g_server_limits.ground_items);
+    if (!g_ground_items) {
+        fprintf(stderr, "WARNING: Failed to create ground item system\n");
+    }
+    
+    /* Zone updates - projectiles, spot animations and loc changes per zone */
+    g_zone_updates = zone_update_system_create();
+    if (!g_zone_updates) {
+        fprintf(stderr, "WARNING: Failed to create zone update system\n");
+    }
+    
+    /* Combat - formula tables and per-fighter state; fights run on g_timers */
+    g_combat = combat_system_create();
+    if (!g_combat) {
+        fprintf(stderr, "WARNING: Failed to create combat system\n");
+    }
+    
+    /* Aggression - idle aggressive NPCs near players pick targets */
+    g_aggression = aggression_system_create();
+    if (!g_aggression) {
+        fprintf(stderr, "WARNING: Failed to create aggression system\n");
+    }
+    
+    /* Instances - copy-on-write private copies of mapsquares */
+    g_instances = instance_system_create();
+    if (!g_instances) {
+        fprintf(stderr, "WARNING: Failed to create instance system\n");
+    }
+    
+    /* This node's regions, ghosts and handoffs under --cluster (cluster.h) */
+    g_cluster = cluster_create();
+    
+    /* Write player saves on a background thread instead of the tick */
+    save_queue_start(&server->saves);
+    
+    /* Relogs load the logout save from memory; one world only (save_cache.h) */
+    if (!g_account_registry) save_cache_start(&server->save_cache);
+    
+    /* Ground items, spawned objects and NPCs, forked to disk (checkpoint.h) */
+    checkpoint_start(&server->checkpoint, g_world_id);
+    
+    /* Decrypt login blocks and read save files on background threads */
+    load_queue_start(&server->loads, g_load_queue_threads);
+    
+    /* Connections come from slabs as sockets arrive, each with its output arena */
+    slab_pool_init(&server->connection_pool, sizeof(PlayerConnection) + g_connection_out_bytes,
+                   g_connection_slab, g_server_limits.players + 1, MEM_BUFFER);
+    g_connection_pool = &server->connection_pool;
+    
     /* Initialize all player slots to disconnected state */
     printf("Initializing %d player slots...\n", MAX_PLAYERS);
     for (u32 i = 0; i < MAX_PLAYERS; i++) {
-        player_init(&server->players[i], i);
+        player_init(&server->players[i], i, NULL);
     }
     
-    /* Initialize network - create TCP listen socket */
-    printf("Initializing network on port %u...\n", port);
-    if (!network_init(&server->network, port)) {
-        fprintf(stderr, "ERROR: Failed to initialize network on port %u\n", port);
+    /*
+     * Every slot starts free (slot 0 included: PIDs are allocated
+     * separately). One slot more than --max-players, as PIDs have one
+     * less than slots: a full world still lets one login reach the
+     * "world full" response instead of a refused connection.
+     */
+    server->free_slots = slotmap_new(g_server_limits.players + 1, 0);
+    if (!server->free_slots) {
+        fprintf(stderr, "ERROR: Failed to allocate player slot list\n");
         world_destroy(g_world);
         return false;
     }
     
+    /* Initialize network - create TCP listen socket (port 0: none, a replay) */
+    server->network.server_fd = -1;
+    server->network.poll_fd = -1;
+    if (port != 0) {
+        printf("Initializing network on port %u...\n", port);
+        if (!network_init(&server->network, port)) {
+            fprintf(stderr, "ERROR: Failed to initialize network on port %u\n", port);
+            world_destroy(g_world);
+            return false;
+        }
+    }
+    
+    /* Metrics endpoint: watched in the same event set, before any net thread */
+    if (g_metrics_port != 0) {
+        metrics_listen(&server->network, g_metrics_port);
+    }
+    
+    /* Client archives over HTTP: the same event set */
+    if (g_asset_http_port != 0) {
+        asset_http_listen(&server->network, g_asset_http_port, "data");
+    }
+    
+    /* Extensions subscribe to events, then the tables are read-only (hooks.h) */
+    server_register_hooks();
+    hooks_freeze();
+
     /* Mark server as running and reset tick counter */
     server->running = true;
     server->tick_count = 0;
@@ -452,20 +779,38 @@ bool server_init(GameServer* server, u16 port) {
  * SHUTDOWN ORDER:
  *   Reverse of initialization to prevent use-after-free bugs
  *   
- *   1. Stop accepting new connections (set running = false)
- *   2. Disconnect all players (save data, close sockets)
- *   3. Close network socket
- *   4. Destroy objects (references world data)
- *   5. Destroy NPCs (references world data)
- *   6. Destroy items (references world data)
- *   7. Destroy cache (definitions no longer needed)
- *   8. Destroy world (last, as everything references it)
+ *   1. Set running = false, stop the login workers (pending logins
+ *      are abandoned), free the RSA key, close the listener
+ *   2. Send every logged-in player a logout packet, release their
+ *      accounts and presence, flush all of them in one pass
+ *   3. Drain the save writer (older queued saves reach disk first)
+ *   4. Save every logged-in player in one parallel batch
+ *      (player_save_all), then drop all slots and close a --record log
+ *   5. Close the save log (if enabled), stop the network thread, close
+ *      the network
+ *   6. Destroy objects (references world data)
+ *   7. Destroy NPCs (references world data)
+ *   8. Destroy items (references world data)
+ *   9. Destroy the pathfinder, collision grids and map store
+ *  10. Destroy cache (definitions no longer needed)
+ *  11. Destroy world (last, as everything references it)
  * 
  * GRACEFUL DISCONNECTION:
  *   Each player receives logout packet before socket close
  *   This allows client to show "You have been logged out" message
  *   instead of "Connection lost" error
  * 
+ * BULK SAVE:
+ *   Saving players one by one put 2000 synchronous fsyncs back to back
+ *   on this thread once the save writer's queue was full. The batch
+ *   overlaps them across threads (or turns them into save log appends
+ *   and one sync), which takes a full world from minutes to seconds:
+ * 
+ *     before:  save 1 ─ fsync ─ save 2 ─ fsync ─ ... ─ save 2000 ─ fsync
+ *     after:   thread 0: save 1, 9, 17 ...  ┐
+ *              ...                          ├─ join, one log sync
+ *              thread 7: save 8, 16, 24 ... ┘
+ * 
  * MEMORY LEAK PREVENTION:
  *   All subsystems set their global pointers to NULL after destroy
  *   This prevents use-after-free if shutdown is called twice
@@ -475,17 +820,120 @@ bool server_init(GameServer* server, u16 port) {
 void server_shutdown(GameServer* server) {
     server->running = false;
     
-    /* Disconnect all players - iterate all slots */
+    /* No more login results: LOGGING_IN players are dropped below */
+    load_queue_stop(&server->loads);
+    rsa_key_free(g_rsa_key);
+    g_rsa_key = NULL;
+    
+    /* No more ticks: release the PLAYER_INFO workers, drop a map reload */
+    update_pool_stop(&server->updates);
+    region_shards_stop(&server->shards);
+    asset_reload_stop(&server->reload);
+    
+    /* Refuse new connections now (the network thread owns the listener) */
+    if (!g_netio) network_stop_listening(&server->network);
+    
+    /*
+     * Log everyone out: logout packet, account and presence released,
+     * then one flush pass so the packets go out together
+     */
+    Player* online[MAX_PLAYERS];
+    u32 online_count = 0;
+    for (u32 i = 0; i < MAX_PLAYERS; i++) {
+        Player* player = &server->players[i];
+        if (player->state != PLAYER_STATE_LOGGED_IN || player->username[0] == '\0') continue;
+        send_logout(player);
+        account_registry_release(g_account_registry, player->username, g_world_id);
+        presence_offline(player);
+        online[online_count++] = player;
+    }
+    for (u32 i = 0; i < online_count; i++) {
+        player_flush(online[i]);
+    }
+    
+    /* Older queued saves first, so none lands on top of the batch */
+    save_queue_stop(&server->saves);
+    
+    /* Every logged-in player in one parallel batch */
+    if (online_count > 0) {
+        u64 mark = tick_stats_now();
+        u32 saved = player_save_all(online, online_count);
+        printf("Saved %u/%u players in %.1f ms\n", saved, online_count,
+               (double)(tick_stats_now() - mark) / 1e6);
+    }
+    
+    /* Tracing: the session up to these saves, as trace-<tick>.json */
+    if (trace_enabled()) {
+        trace_request_dump();
+        trace_poll(server->tick_count);
+    }
+    
+    /* Free every slot (saved above, or never logged in) */
     for (u32 i = 0; i < MAX_PLAYERS; i++) {
         if (server->players[i].state != PLAYER_STATE_DISCONNECTED) {
-            player_disconnect(&server->players[i]);
+            player_drop(&server->players[i]);
         }
     }
     
+    /* Those disconnects were the recording's last records (--record) */
+    replay_record_close();
+    
+    /* The other worlds learn of those logouts now, not from the supervisor */
+    presence_client_close();
+    
+    /* Ghosts hold PIDs in the world list: gone before the world is */
+    cluster_destroy(g_cluster, g_world);
+    g_cluster = NULL;
+    
+    /* Slot-owned allocations (inventory, equipment) */
+    for (u32 i = 0; i < MAX_PLAYERS; i++) {
+        player_free(&server->players[i]);
+    }
+    slab_pool_destroy(&server->connection_pool);
+    g_connection_pool = NULL;
+    
+    /* Nothing writes saves any more: sync and close the log */
+    save_log_close(server->save_log);
+    server->save_log = NULL;
+    save_cache_stop(&server->save_cache);
+    checkpoint_stop(&server->checkpoint);
+    
+    /* Stop the network thread (flushes and closes remaining sockets) */
+    netio_stop(&server->netio);
+    metrics_close();
+    asset_http_close();
+    
     /* Shutdown network - close listen socket */
     network_shutdown(&server->network);
     
+    /* Every slot is DISCONNECTED now; nothing allocates them any more */
+    slotmap_free(server->free_slots);
+    server->free_slots = NULL;
+    
+    /* Subscribers may point at what is destroyed below */
+    hooks_reset();
+
     /* Destroy subsystems in reverse initialization order */
+    instance_system_destroy(g_instances);
+    g_instances = NULL;
+    ground_item_system_destroy(g_ground_items);
+    g_ground_items = NULL;
+    zone_update_system_destroy(g_zone_updates);
+    g_zone_updates = NULL;
+    aggression_system_destroy(g_aggression);
+    g_aggression = NULL;
+    combat_system_destroy(g_combat);
+    g_combat = NULL;
+    
+    activation_destroy(g_activation);
+    g_activation = NULL;
+    
+    social_system_destroy(g_social);
+    g_social = NULL;
+    
+    shop_system_destroy(g_shops);
+    g_shops = NULL;
+    
     if (g_objects) {
         object_system_destroy(g_objects);
         g_objects = NULL;
@@ -495,12 +943,47 @@ void server_shutdown(GameServer* server) {
         npc_system_destroy(g_npcs);
         g_npcs = NULL;
     }
+    occupancy_destroy(g_occupancy);
+    g_occupancy = NULL;
     
     if (g_items) {
         item_system_destroy(g_items);
         g_items = NULL;
     }
     
+    /* After every system pointing into its tables */
+    def_store_destroy(g_defs);
+    g_defs = NULL;
+    
+    /* Waiting scripts hold timers: cancel them while the wheel exists */
+    script_runtime_destroy(g_scripts);
+    g_scripts = NULL;
+    
+    /* After the systems whose timers it holds (pending timers never fire) */
+    timer_wheel_destroy(g_timers);
+    g_timers = NULL;
+    
+    pathfinder_destroy(g_pathfinder);
+    g_pathfinder = NULL;
+    
+    static_locs_destroy(g_static_locs);
+    g_static_locs = NULL;
+    
+    world_collision_destroy(g_world_collision);
+    g_world_collision = NULL;
+    
+    if (g_map_store) {
+        map_store_destroy(g_map_store);
+        g_map_store = NULL;
+    }
+    
+    /* After the map store, collision, locs and definitions pointing into it */
+    snapshot_close(g_snapshot);
+    g_snapshot = NULL;
+    
+    chat_filter_destroy(g_chat_filter);
+    g_chat_filter = NULL;
+    
     if (g_cache) {
         cache_destroy(g_cache);
         g_cache = NULL;
@@ -510,91 +993,235 @@ void server_shutdown(GameServer* server) {
         world_destroy(g_world);
         g_world = NULL;
     }
+    g_assets_loaded = false;
+}
+
+/*
+ * server_build_snapshot - Build the world snapshot without starting the server
+ *
+ * Loads the cache, map store, collision and definition tables from data/
+ * (ignoring any existing snapshot), writes them to path and frees
+ * everything again. Nothing listens and no player system is created.
+ */
+bool server_build_snapshot(const char* path) {
+    g_cache = cache_create();
+    if (!g_cache) return false;
+    cache_init(g_cache, "data");
+
+    u32 fingerprint = snapshot_fingerprint(g_cache, "data/maps", snapshot_layout());
+    g_map_store = map_store_create("data/maps");
+    g_world_collision = world_collision_create(g_map_store, g_cache);
+    g_static_locs = static_locs_create(g_map_store);
+    g_defs = def_store_create(NULL);
+
+    g_items = item_system_create();
+    g_npcs = npc_system_create(MAX_NPCS);
+    g_objects = object_system_create(MAX_GROUND_ITEMS);
+    bool ok = g_map_store && g_world_collision && g_static_locs && g_defs && g_items && g_npcs && g_objects &&
+              item_system_init(g_items) && npc_system_init(g_npcs) &&
+              object_system_init(g_objects) &&
+              server_write_snapshot(path, fingerprint);
+
+    object_system_destroy(g_objects);
+    npc_system_destroy(g_npcs);
+    item_system_destroy(g_items);
+    g_objects = NULL;
+    g_npcs = NULL;
+    g_items = NULL;
+    def_store_destroy(g_defs);
+    g_defs = NULL;
+    static_locs_destroy(g_static_locs);
+    g_static_locs = NULL;
+    world_collision_destroy(g_world_collision);
+    g_world_collision = NULL;
+    map_store_destroy(g_map_store);
+    g_map_store = NULL;
+    cache_destroy(g_cache);
+    g_cache = NULL;
+    return ok;
 }
 
 /*******************************************************************************
  * MAIN GAME LOOP
  ******************************************************************************/
 
+/*
+ * server_next_deadline - Deadline of the tick after the one just run
+ * 
+ * @param deadline  Deadline of the tick that just ran (ns)
+ * @param now       Time the tick finished (ns)
+ * @param burst     Catch-up ticks run in a row (reset once on time)
+ * @return          deadline + TICK_RATE_MS, or a later deadline on the
+ *                  same grid if missed ticks are skipped (TickCatchup)
+ */
+static u64 server_next_deadline(u64 deadline, u64 now, u32* burst) {
+    const u64 period = (u64)g_server_limits.tick_ms * 1000000;
+    u64 next = deadline + period;
+    if (now < next) {
+        *burst = 0;
+        return next;
+    }
+    
+    /* Behind: `next` has passed already; burst it or skip to the grid */
+    if (g_tick_catchup == TICK_CATCHUP_BURST && *burst < TICK_CATCHUP_MAX) {
+        (*burst)++;
+        return next;
+    }
+    
+    u64 skipped = (now - next) / period + 1;
+    LOG_WARN("WARNING: Tick loop %llu ms behind, skipping %llu tick(s)\n",
+             (unsigned long long)((now - next) / 1000000), (unsigned long long)skipped);
+    *burst = 0;
+    return next + skipped * period;
+}
+
 /*
  * server_run - Main event loop (runs until shutdown)
  * 
  * LOOP STRUCTURE:
  * 
  *   Initialize timing:
- *     last_tick_time = current_time
+ *     next_tick = now + TICK_RATE_MS
  *   
  *   Main loop:
  *     while (server->running) {
- *         current_time = get_monotonic_time()
- *         elapsed = current_time - last_tick_time
+ *         now = get_monotonic_time()
  *         
- *         if (elapsed >= TICK_RATE_MS) {
+ *         if (now >= next_tick) {
  *             Execute game tick
- *             last_tick_time = current_time
+ *             next_tick = server_next_deadline(next_tick, ...)
  *         }
  *         
- *         Process new connections (non-blocking)
- *         Process incoming packets (non-blocking)
+ *         Flush queued output (one send() per connection)
  *         
- *         Sleep 1ms (prevent CPU spinning)
+ *         Wait for socket readiness, at most until the next tick
+ *         For each ready socket:
+ *             listener → accept every pending connection
+ *             player   → recv into that player's input buffer
  *     }
  * 
- * TIME CALCULATION:
+ * DEADLINES, NOT INTERVALS:
  * 
- *   struct timespec has two fields:
- *     tv_sec:  seconds (64-bit integer)
- *     tv_nsec: nanoseconds (0-999999999)
- *   
- *   To convert to milliseconds:
- *     ms = (sec_diff * 1000) + (nsec_diff / 1000000)
- *   
- *   Example:
- *     last_tick:   {tv_sec=1000, tv_nsec=500000000}  (1000.5 sec)
- *     current:     {tv_sec=1001, tv_nsec=200000000}  (1001.2 sec)
- *     sec_diff:    1001 - 1000 = 1 sec
- *     nsec_diff:   200000000 - 500000000 = -300000000 nsec
- *     elapsed_ms:  (1 * 1000) + (-300000000 / 1000000)
- *                = 1000 + (-300)
- *                = 700 ms
+ *   The loop used to set last_tick = now after each tick and wait for
+ *   600 ms to pass again. Whatever the tick took to notice (timeout
+ *   rounding, a packet being handled at the deadline) was added to that
+ *   period, so the real rate drifted above 600 ms and never recovered:
+ * 
+ *     interval:  0    601   1202   1803   2404  ...  tick 1000 at 601 s
+ *     deadline:  0    600   1200   1800   2400  ...  tick 1000 at 600 s
+ * 
+ *   Now the deadline advances by exactly TICK_RATE_MS from the previous
+ *   deadline, not from when the tick ran. Lateness of one tick is not
+ *   inherited by the next.
  * 
  * TICK RATE PRECISION:
  * 
- *   With 1ms loop granularity and 600ms tick rate:
- *   - Best case: exactly 600ms (tick fires immediately)
- *   - Worst case: 601ms (tick fires 1ms late)
- *   - Error: +/- 1ms = 0.16% deviation
- *   
- *   This is acceptable for game logic (players cannot perceive <10ms)
+ *   Time is kept in nanoseconds (tick_stats_now). network_wait() and
+ *   netio_wait() take milliseconds, so the time left is rounded UP: the
+ *   loop wakes at most 1 ms after the deadline, never before it (which
+ *   would only spin through another zero-length wait). Sockets stay
+ *   serviced right up to the deadline, so a dedicated clock_nanosleep
+ *   would not help: the wait already is the sleep.
+ * 
+ * FALLING BEHIND:
+ * 
+ *   When a tick ends past the next deadline, g_tick_catchup decides
+ *   whether the missed ticks run back to back or are skipped (see
+ *   TickCatchup in server.h). Input is read and output flushed between
+ *   catch-up ticks as between any others.
  * 
  * COMPLEXITY: Infinite loop (until shutdown)
  */
 void server_run(GameServer* server) {
-    struct timespec last_tick, current_time;
-    clock_gettime(CLOCK_MONOTONIC, &last_tick);
+    const u64 period = (u64)g_server_limits.tick_ms * 1000000;
+    u64 next_tick = tick_stats_now() + period;
+    u32 burst = 0;
+    
+    printf("Server running on port %u (%s)...\n", server->network.port,
+           network_backend_name());
     
-    printf("Server running on port %u...\n", server->network.port);
+    NetworkEvent events[NETWORK_MAX_EVENTS];
+    bool threaded = (g_netio == &server->netio);
+    trace_thread_name("game");
     
     while (server->running) {
-        /* Get current time using monotonic clock (never jumps backwards) */
-        clock_gettime(CLOCK_MONOTONIC, &current_time);
+        /* Monotonic clock (never jumps backwards), in nanoseconds */
+        u64 now = tick_stats_now();
         
-        /* Calculate elapsed time since last tick in milliseconds */
-        long elapsed_ms = (current_time.tv_sec - last_tick.tv_sec) * 1000 +
-                         (current_time.tv_nsec - last_tick.tv_nsec) / 1000000;
-        
-        /* Process game tick if 600ms elapsed */
-        if (elapsed_ms >= TICK_RATE_MS) {
+        /* Process game tick once its deadline has passed */
+        if (now >= next_tick) {
+            tick_stats_begin(now - next_tick);
             server_tick(server);
-            last_tick = current_time;  /* Reset tick timer */
+            tick_stats_end(server->tick_count);
+            tick_governor_observe(server->tick_count);
+            next_tick = server_next_deadline(next_tick, tick_stats_now(), &burst);
+            
+            /* ::trace dump or SIGUSR2: written here, between ticks */
+            trace_poll(server->tick_count);
         }
         
-        /* Process network events (non-blocking, returns immediately) */
-        server_process_connections(server);
-        server_process_packets(server);
+        /* Logins the workers have finished since the last pass */
+        u64 mark = tick_stats_now();
+        server_finish_logins(server);
+        tick_phase_end(TICK_PHASE_LOGINS, &mark);
         
-        /* Sleep briefly to prevent CPU spinning at 100% */
-        usleep(1000);  /* 1 millisecond = 1000 microseconds */
+        /*
+         * One send() per connection for everything queued since the last
+         * flush: this tick's updates and replies to the previous batch of
+         * input. Done before blocking so nothing waits for the next wakeup.
+         */
+        server_flush_outputs(server);
+        tick_phase_end(TICK_PHASE_FLUSH, &mark);
+        
+        /*
+         * The workers cannot wake us: poll while logins are waiting on
+         * them (not once the tick's login budget is spent - they wait
+         * for the next tick anyway)
+         */
+        now = tick_stats_now();
+        i32 wait_ms = now >= next_tick ? 0 : (i32)((next_tick - now + 999999) / 1000000);
+        if (wait_ms > LOAD_QUEUE_POLL_MS && login_admission_open() &&
+            load_queue_busy(&server->loads)) {
+            wait_ms = LOAD_QUEUE_POLL_MS;
+        }
+        
+        if (threaded) {
+            /*
+             * Network thread mode: output went into the outbound rings;
+             * wake the network thread once for all of it, then sleep until
+             * it has input for us or the next tick is due.
+             */
+            netio_commit(&server->netio);
+            netio_wait(&server->netio, wait_ms);
+            mark = tick_stats_now();
+            server_process_net_records(server);
+            tick_phase_end(TICK_PHASE_INPUT, &mark);
+            continue;
+        }
+        
+        /*
+         * Sleep in the kernel until a socket is ready or the next tick is
+         * due. Idle servers use no CPU; input is handled the moment it
+         * arrives instead of on the next 1ms poll.
+         */
+        i32 count = network_wait(&server->network, wait_ms,
+                                 events, NETWORK_MAX_EVENTS);
+        mark = tick_stats_now();
+        
+        for (i32 e = 0; e < count; e++) {
+            u32 token = events[e].token;
+            if (token == NETWORK_TOKEN_LISTENER || token == NETWORK_TOKEN_WS_LISTENER) {
+                server_process_connections(server);
+            } else if (metrics_owns_token(token)) {
+                metrics_handle_event(&events[e]);
+            } else if (asset_http_owns_token(token)) {
+                asset_http_handle_event(&events[e]);
+            } else if (token < MAX_PLAYERS && events[e].readable) {
+                server_process_player_input(&server->players[token]);
+            }
+            /* Writable-only events just let the flush above run again */
+        }
+        tick_phase_end(TICK_PHASE_INPUT, &mark);
     }
 }
 
@@ -603,7 +1230,10 @@ void server_run(GameServer* server) {
  * 
  * TICK PROCESSING:
  *   1. Increment global tick counter (used for timed events)
- *   2. Delegate to world_process() for main game logic:
+ *   2. Fire the timers due this tick (g_timers, see timer_wheel.h)
+ *   3. Handle the client packets queued since the last tick
+ *      (server_process_tick_input)
+ *   4. Delegate to world_process() for main game logic:
  *      - Player movement updates
  *      - Player visibility calculations
  *      - NPC AI and movement
@@ -611,10 +1241,28 @@ void server_run(GameServer* server) {
  *      - Item spawn/despawn timers
  *      - Send player/NPC update packets
  * 
+ * PACKETS AT THE TICK BOUNDARY:
+ * 
+ *   Packets used to be handled the moment they were read, in between
+ *   ticks, so game state changed at arbitrary points of the 600 ms gap
+ *   and handler time was spread over the wait loop. Now reading only
+ *   buffers them (in_buffer, or the network thread's inbound ring) and
+ *   lists the slot in input_pending:
+ * 
+ *     between ticks:  recv ─► in_buffer ─► input_pending += slot
+ *     tick:           TIMERS ─► PACKETS (all handlers, back to back)
+ *                             ─► MOVEMENT ...
+ * 
+ *   Every packet sent before the tick is seen by that tick's movement
+ *   and update, in slot then arrival order, and the handlers run as one
+ *   tight loop instead of one at a time between socket waits.
+ * 
  * TICK COUNTER USES:
  *   - Periodic events: if (tick_count % 100 == 0) -> every minute
- *   - Spawn timers: spawn_tick + 50 -> respawn after 30 seconds
- *   - Combat cooldowns: last_attack_tick + 4 -> attack every 2.4 sec
+ *   - One-off delays (respawns, despawns, cooldowns) are NOT checked
+ *     here or per entity: schedule them on g_timers, which is keyed on
+ *     tick_count and only visits the timers actually due:
+ *       timer_schedule(g_timers, 50, npc_respawn_cb, npcs, npc->index)
  * 
  * OVERFLOW HANDLING:
  *   u64 tick_count wraps after 2^64 ticks
@@ -626,18 +1274,160 @@ void server_run(GameServer* server) {
  *   M = average number of visible entities per player
  */
 void server_tick(GameServer* server) {
+    /* Connections that stopped reading, before the tick writes them more */
+    server_check_send_queues(server);
+    
     server->tick_count++;
+    PROBE1(tick__start, server->tick_count);
+    if (g_replay.recording) replay_record_tick((u32)server->tick_count);
+    
+    /* A fresh login budget: server_finish_logins() spends it */
+    login_admission_tick();
+    
+    /* Maps rebuilt in the background take effect here, between ticks */
+    asset_reload_poll(&server->reload, server->players, MAX_PLAYERS);
+    
+    /* Timed events first, so e.g. a respawned NPC is processed this tick */
+    u64 mark = tick_stats_now();
+    timer_wheel_advance(g_timers, server->tick_count);
+    tick_phase_end(TICK_PHASE_TIMERS, &mark);
     
-    /* Process world state - delegates to world.c */
+    /* Every packet queued since the last tick, before anything moves */
+    if (g_replay.replaying) {
+        server_replay_tick_input(server);
+    } else {
+        server_process_tick_input(server);
+    }
+    tick_phase_end(TICK_PHASE_PACKETS, &mark);
+    if (g_replay.recording) replay_record_world();
+    
+    /* Players handed over by other nodes, and their players near ours */
+    cluster_receive(g_cluster, g_world, server->tick_count);
+    
+    /* Process world state - delegates to world.c (times its own phases) */
     if (g_world) {
         world_process(g_world);
     }
+    
+    /* Map downloads in the room the tick's game packets left (map.h) */
+    mark = tick_stats_now();
+    map_pump_transfers(server->players, MAX_PLAYERS);
+    tick_phase_end(TICK_PHASE_MAPS, &mark);
+    
+    /* After the world: saves capture this tick's movement (deferred under load) */
+    if (!tick_governor_skip(GOVERNOR_DEFER_AUTOSAVE, server->tick_count, GOVERNOR_AUTOSAVE_EVERY)) {
+        server_autosave(server);
+    }
+    checkpoint_tick(&server->checkpoint, server->tick_count);
+    tick_phase_end(TICK_PHASE_AUTOSAVE, &mark);
+    
+    /* Players on other nodes' squares handed off, ours near them ghosted */
+    cluster_send(g_cluster, g_world, server->tick_count);
+    
+    /* This tick's logins and logouts to the other worlds, theirs to us */
+    presence_pump();
+    
+    /* ...and the friend lists of everyone watching those names */
+    social_tick(g_social);
+    
+    /* Packet profiler report, while profiling is on */
+    packet_profile_tick(server->tick_count);
+    
+    /* Per-connection traffic into this tick's aggregate, top talkers per window */
+    traffic_tick(server->players, g_server_limits.players + 1, server->tick_count);
+    
+    /* Gauges for the metrics endpoint (scrapes read only these copies) */
+    metrics_publish_tick(g_world ? g_world->player_list->count : 0,
+                         load_queue_pending(&server->loads), save_queue_pending(g_save_queue));
+
+    /* Extensions' per-tick work, whose packets go out with this tick's */
+    hook_tick_end(server->tick_count);
+}
+
+/*
+ * server_autosave - Staggered periodic save of dirty players
+ * 
+ * ALGORITHM (S = the slots in use, --max-players + 1; I = the interval):
+ *   for slots [phase × S / I, (phase + 1) × S / I):
+ *       if LOGGED_IN and save_dirty:
+ *           player_save()  → snapshot + queue (no disk I/O here)
+ *           save_dirty = false
+ *   autosave_phase advances (mod I)
+ * 
+ * With 2049 slots and a 500 tick interval that is 4 or 5 slots per tick:
+ * 
+ *   phase:  0      1      2           499    0 (tick 501)
+ *   slots: [0-3] [4-7] [8-11] ... [2044-2048] [0-3] ...
+ * 
+ * and with --max-players 5 (6 slots) one slot on 6 of the 500 ticks.
+ * Either way every slot is visited exactly once per interval, the save
+ * rate stays flat, and idle players (nothing changed) cost nothing.
+ */
+void server_autosave(GameServer* server) {
+    u64 slots = (u64)g_server_limits.players + 1;
+    u32 phase = server->autosave_phase;
+    u32 begin = (u32)(phase * slots / AUTOSAVE_INTERVAL_TICKS);
+    u32 end = (u32)((phase + 1) * slots / AUTOSAVE_INTERVAL_TICKS);
+    server->autosave_phase = (phase + 1) % AUTOSAVE_INTERVAL_TICKS;
+    
+    for (u32 slot = begin; slot < end; slot++) {
+        Player* player = &server->players[slot];
+        
+        if (player->state != PLAYER_STATE_LOGGED_IN || !player->save_dirty) continue;
+        if (player->username[0] == '\0') continue;
+        
+        if (player_save(player)) {
+            player->save_dirty = false;
+        }
+    }
 }
 
 /*******************************************************************************
  * CONNECTION HANDLING
  ******************************************************************************/
 
+Player* server_attach_socket(GameServer* server, i32 client_fd) {
+    /* Find free player slot */
+    Player* player = server_find_free_slot(server);
+    if (!player) {
+        /* Server full - reject connection */
+        network_close_socket(client_fd);
+        LOG_WARN("Server full, rejected connection\n");
+        return NULL;
+    }
+    
+    /* Event token = slot index (player->index becomes the PID at login) */
+    u32 slot = (u32)(player - server->players);
+    if (!network_watch(&server->network, client_fd, slot, false)) {
+        network_close_socket(client_fd);
+        slotmap_release(server->free_slots, slot);
+        LOG_WARN("Failed to watch socket fd=%d, rejected connection\n", client_fd);
+        return NULL;
+    }
+    
+    /* Slot available - assign socket */
+    if (!player_set_socket(player, client_fd)) {
+        network_unwatch(&server->network, client_fd);
+        network_close_socket(client_fd);
+        slotmap_release(server->free_slots, slot);
+        LOG_WARN("No connection buffers, rejected connection\n");
+        return NULL;
+    }
+    return player;
+}
+
+/*
+ * server_adopt_connection - Give an accepted socket a slot and start its login
+ */
+static void server_adopt_connection(GameServer* server, i32 client_fd, bool websocket) {
+    Player* player = server_attach_socket(server, client_fd);
+    if (!player) return;
+    if (websocket) player->conn->ws.state = WS_STATE_HANDSHAKE;
+    login_process_connection(player);
+    LOG_INFO("Player connected: index=%u fd=%d%s\n", player->index, client_fd,
+             websocket ? " (WebSocket)" : "");
+}
+
 /*
  * server_process_connections - Accept pending connection (non-blocking)
  * 
@@ -662,39 +1452,20 @@ void server_tick(GameServer* server) {
  *   - Alternative: Send "Server full" message before closing
  * 
  * SLOT ALLOCATION:
- *   Uses server_find_free_slot() which does linear search
- *   Optimization: Maintain free-list for O(1) allocation
- *   
- *   Free-list approach:
- *     int free_slots[MAX_PLAYERS];  // Stack of free indices
- *     int free_count = MAX_PLAYERS;
- *     
- *     On disconnect: free_slots[free_count++] = player_index
- *     On connect:    player_index = free_slots[--free_count]
- *   
- *   Trade-off: 8KB memory for O(1) vs O(N) allocation
+ *   server_find_free_slot() pops server->free_slots in O(1);
+ *   player_disconnect() pushes the slot back. A slot that fails
+ *   network_watch() is never connected, so it is handed back here.
  * 
- * COMPLEXITY: O(N) where N = MAX_PLAYERS (due to find_free_slot)
+ * COMPLEXITY: O(1) per accepted connection
  */
 void server_process_connections(GameServer* server) {
-    /* Try to accept connection (non-blocking) */
-    i32 client_fd = network_accept_connection(&server->network);
-    if (client_fd < 0) {
-        /* No pending connection or accept failed */
-        return;
+    /* Drain the whole accept backlog - one readiness event may cover many */
+    i32 client_fd;
+    while ((client_fd = network_accept_connection(&server->network)) >= 0) {
+        server_adopt_connection(server, client_fd, false);
     }
-    
-    /* Find free player slot */
-    Player* player = server_find_free_slot(server);
-    if (player) {
-        /* Slot available - assign socket and start login */
-        player_set_socket(player, client_fd);
-        login_process_connection(player);
-        printf("Player connected: index=%u fd=%d\n", player->index, client_fd);
-    } else {
-        /* Server full - reject connection */
-        network_close_socket(client_fd);
-        printf("Server full, rejected connection\n");
+    while ((client_fd = network_accept_websocket(&server->network)) >= 0) {
+        server_adopt_connection(server, client_fd, true);
     }
 }
 
@@ -739,14 +1510,14 @@ void server_process_connections(GameServer* server) {
  *     -2:   Variable short length (next 2 bytes are length)
  *   
  *   Example opcodes:
- *     PacketLengths[248] = -1   (movement packet, VAR_BYTE)
- *     PacketLengths[52]  = 13   (player design, 13 bytes)
- *     PacketLengths[158] = -1   (command packet, VAR_BYTE)
+ *     PacketLengths[181] = -1   (MOVE_GAMECLICK, VAR_BYTE)
+ *     PacketLengths[52]  = 13   (IF_PLAYERDESIGN, 13 bytes)
+ *     PacketLengths[4]   = -1   (CLIENT_CHEAT, VAR_BYTE)
  * 
  * OPCODE DECRYPTION:
  *   After login, all opcodes are encrypted with ISAAC cipher:
  *     encrypted_opcode = buffer[0]
- *     key = isaac_get_next(&player->in_cipher)
+ *     key = isaac_get_next(&player->conn->in_cipher)
  *     opcode = (encrypted_opcode - key) & 0xFF
  *   
  *   & 0xFF ensures result is 0-255 (handles negative wrap-around)
@@ -757,12 +1528,14 @@ void server_process_connections(GameServer* server) {
  *   VAR_SHORT:     header_size = 3 (opcode + length short)
  * 
  * BUFFER MANAGEMENT:
- *   After processing packet, remaining data is moved to buffer start:
- *     memmove(buffer, buffer + consumed, remaining)
+ *   recv() writes straight into in_buffer at in_buffer_size, and each
+ *   dispatched packet only advances the read index in_read:
+ *     Before: [packet1][packet2][packet3]...   in_read = 0
+ *     After:  [packet1][packet2][packet3]...   in_read = len(packet1)
  *   
- *   memmove() (not memcpy!) handles overlapping memory:
- *     Before: [packet1][packet2][packet3]...
- *     After:  [packet2][packet3]...
+ *   When everything is consumed both indices rewind to 0. Only when the
+ *   buffer is full is the remaining partial packet moved to the front
+ *   with memmove() (not memcpy! the ranges may overlap).
  * 
  * COMPLEXITY: O(N * P) where:
  *   N = number of players
@@ -770,131 +1543,723 @@ void server_process_connections(GameServer* server) {
  */
 void server_process_packets(GameServer* server) {
     for (u32 i = 0; i < MAX_PLAYERS; i++) {
-        Player* player = &server->players[i];
+        server_process_player_input(&server->players[i]);
+    }
+}
+
+/*
+ * server_try_login - Run the login handshake over the buffered bytes
+ * 
+ * @param player  Player in CONNECTED state with bytes in in_buffer
+ * @return        true if the login header was accepted (in_buffer
+ *                cleared); the player is then LOGGED_IN, or LOGGING_IN
+ *                until server_finish_logins() gets its save
+ */
+static bool server_try_login(Player* player) {
+    u32 available = player->conn->in_buffer_size - player->conn->in_read;
+    if (player->state != PLAYER_STATE_CONNECTED || available < 2) {
+        return false;
+    }
+    
+    /* Zero-copy read view over the accumulated bytes */
+    StreamBuffer view;
+    StreamBuffer* in = &view;
+    buffer_init_view(in, player->conn->in_buffer + player->conn->in_read, available);
+    
+    if (!login_process_header(player, in)) return false;
+    
+    /* Refused by login admission: already disconnected */
+    if (player->socket_fd < 0) return false;
+    
+    /* Login handled inline (no workers) - send initial game state now (a resumed session has it) */
+    if (player->state == PLAYER_STATE_LOGGED_IN && !player->login_resumed) {
+        server_send_initial_game_packets(player);
+    }
+    player->conn->in_buffer_size = 0;
+    player->conn->in_read = 0;
+    return true;
+}
+
+/*
+ * server_take_packet_token - Spend one packet from the connection's bucket
+ * 
+ * @param player  Logged-in player with a complete packet to handle
+ * @return        false if the bucket is empty: the packet must stay
+ *                queued, and the slot is listed for the next tick
+ * 
+ * Tops the bucket up first with PACKETS_PER_TICK for every tick since the
+ * last refill (capped at PACKET_BURST). See MAX_PACKETS_PER_SECOND.
+ */
+static bool server_take_packet_token(Player* player) {
+    PlayerConnection* conn = player->conn;
+    u64 tick = g_server->tick_count;
+    if (tick != conn->in_refill_tick) {
+        u64 refill = (tick - conn->in_refill_tick) * PACKETS_PER_TICK;
+        conn->in_tokens = refill >= PACKET_BURST - conn->in_tokens ? PACKET_BURST
+                                                                   : conn->in_tokens + (u32)refill;
+        conn->in_refill_tick = tick;
+    }
+    if (conn->in_tokens == 0) {
+        player_set_add(&g_server->input_pending, player->slot);
+        metrics_add(&g_metrics.packets_deferred, 1);
+        return false;
+    }
+    conn->in_tokens--;
+    return true;
+}
+
+/*
+ * server_dispatch_input - Frame and dispatch every complete buffered packet
+ * 
+ * @param player  Player with unconsumed bytes in [in_read, in_buffer_size)
+ * 
+ * Runs in the tick's PACKETS phase only (server_process_tick_input).
+ * 
+ * READ CURSOR:
+ * 
+ *   in_buffer: [ consumed ][ pkt ][ pkt ][ partial... ][  free  ]
+ *              0           ↑                           ↑
+ *                       in_read                 in_buffer_size
+ * 
+ *   Each packet is handed to its handler as a view pointing straight at
+ *   the payload, and consuming it only advances in_read. The old loop
+ *   memmove'd the whole remainder forward after every packet, so a burst
+ *   of small movement packets cost O(packets * buffered bytes).
+ *   The decoded opcode of a partial packet is kept in in_opcode so the
+ *   ISAAC stream is not advanced again when the rest arrives - and the
+ *   same holds for a complete packet the rate limit holds back.
+ */
+static void server_dispatch_input(Player* player) {
+    while (player->socket_fd >= 0 && player->state == PLAYER_STATE_LOGGED_IN &&
+           player->conn->in_read < player->conn->in_buffer_size) {
+        const u8* data = player->conn->in_buffer + player->conn->in_read;
+        u32 available = player->conn->in_buffer_size - player->conn->in_read;
         
-        /* Skip disconnected players */
-        if (player->socket_fd < 0) continue;
+        /* Decrypt opcode using ISAAC cipher (once per packet) */
+        if (player->conn->in_opcode < 0) {
+            u8 encrypted_opcode = data[0];
+            u8 opcode = encrypted_opcode;
+            if (player->conn->in_cipher.initialized) {
+                u32 isaac_key = isaac_get_next(&player->conn->in_cipher);
+                opcode = (encrypted_opcode - isaac_key) & 0xFF;
+                LOG_TRACE(LOG_PACKET, "ISAAC decrypt: encrypted=0x%02X - isaac_key=%u = opcode=%u\n", 
+                          encrypted_opcode, isaac_key, opcode);
+            }
+            player->conn->in_opcode = opcode;
+        }
+        u8 opcode = (u8)player->conn->in_opcode;
         
-        /* Try to receive data (non-blocking) - loop until EWOULDBLOCK */
-        u8 temp_buffer[MAX_PACKET_SIZE];
-        i32 bytes_read;
+        /* Lookup packet length from table */
+        i32 packet_length = PacketLengths[opcode];
+        u32 header_size = 1;
         
-        /* Keep reading until no more data available */
-        int recv_count = 0;
-        bool connection_closed = false;
+        if (packet_length == -1) {
+            /* VAR_BYTE: next byte is payload length */
+            if (available < 2) break;  /* Wait for length byte */
+            packet_length = data[1];
+            header_size = 2;
+        } else if (packet_length == -2) {
+            /* VAR_SHORT: next 2 bytes are payload length (big-endian) */
+            if (available < 3) break;  /* Wait for length bytes */
+            packet_length = (data[1] << 8) | data[2];
+            header_size = 3;
+        }
+        
+        /* Ensure length is non-negative */
+        if (packet_length < 0) packet_length = 0;
+        
+        /* Check if full packet received */
+        u32 total_size = header_size + (u32)packet_length;
+        if (available < total_size) {
+            break;  /* Partial packet, wait for more data */
+        }
         
-        bytes_read = network_receive(player->socket_fd, temp_buffer, sizeof(temp_buffer));
+        /* Over the rate limit: leave it buffered for the next tick */
+        if (!server_take_packet_token(player)) break;
         
-        while (bytes_read > 0) {
-            recv_count++;
-            printf("DEBUG: recv() call #%d - Received %d bytes from player %s, hex dump:\n  ", 
-                   recv_count, (int)bytes_read, player->username);
-            for (int i = 0; i < bytes_read && i < 32; i++) {
-                printf("%02X ", temp_buffer[i]);
-                if ((i + 1) % 16 == 0 && i + 1 < bytes_read) printf("\n  ");
+        /* Consume first: the handler may disconnect (and reset) the player */
+        player->conn->in_opcode = -1;
+        player->conn->in_read += total_size;
+        
+        /* Read view over the payload in place (no copy, no malloc) */
+        StreamBuffer view;
+        buffer_init_view(&view, data + header_size, (u32)packet_length);
+        
+        /* Dispatch to packet handler */
+        server_handle_packet(player, opcode, &view, (u32)packet_length);
+    }
+    
+    /* Everything consumed: rewind for free instead of moving bytes */
+    if (player->conn->in_read == player->conn->in_buffer_size) {
+        player->conn->in_read = 0;
+        player->conn->in_buffer_size = 0;
+    }
+}
+
+/*
+ * server_connection_lost - A player's socket closed or failed
+ * 
+ * @param player  Player whose connection is gone
+ * @param reason  For the log ("connection closed", "send failed")
+ * 
+ * A logged-in player lingers for a reconnect (session.h); anyone else,
+ * or everyone with --session-grace 0, is disconnected.
+ */
+static void server_connection_lost(Player* player, const char* reason) {
+    LOG_INFO("Player '%s' disconnected (%s)\n", player->username, reason);
+    if (!session_linger(player)) player_disconnect(player);
+}
+
+void server_process_player_input(Player* player) {
+    /* Skip disconnected players */
+    if (!player || player->socket_fd < 0) return;
+    
+    int recv_count = 0;
+    bool connection_closed = false;
+    
+    /* Keep reading until no more data available (EWOULDBLOCK) */
+    for (;;) {
+        /*
+         * No room left at the end: move the undispatched tail (at most one
+         * partial packet) to the front. This is the only memmove, and it
+         * happens once per buffer-full rather than once per packet.
+         */
+        if (player->conn->in_buffer_size == MAX_PACKET_SIZE) {
+            if (player->conn->in_read == 0) {
+                /* Full and nothing consumed yet: stop reading until the tick */
+                network_unwatch(&g_server->network, player->socket_fd);
+                player->conn->in_paused = true;
+                break;
             }
-            printf("\n");
-            /* Data received - append to input buffer */
-            if (player->in_buffer_size + bytes_read < MAX_PACKET_SIZE) {
-                memcpy(player->in_buffer + player->in_buffer_size, temp_buffer, bytes_read);
-                player->in_buffer_size += bytes_read;
-                printf("DEBUG: in_buffer_size now %u after append (total recv calls: %d)\n", player->in_buffer_size, recv_count);
+            u32 remaining = player->conn->in_buffer_size - player->conn->in_read;
+            memmove(player->conn->in_buffer, player->conn->in_buffer + player->conn->in_read, remaining);
+            player->conn->in_read = 0;
+            player->conn->in_buffer_size = remaining;
+        }
+        
+        /* recv() straight into the accumulator (no temp buffer copy) */
+        u8* dest = player->conn->in_buffer + player->conn->in_buffer_size;
+        i32 bytes_read = network_receive(player->socket_fd, dest,
+                                         MAX_PACKET_SIZE - player->conn->in_buffer_size);
+        if (bytes_read <= 0) {
+            /* 0 = peer closed gracefully, -1 = EWOULDBLOCK or error */
+            if (bytes_read == 0) connection_closed = true;
+            break;
+        }
+        metrics_add(&g_metrics.bytes_received, (u64)bytes_read);
+        
+        recv_count++;
+        LOG_TRACE(LOG_NET, "recv() call #%d - Received %d bytes from player %s\n",
+                  recv_count, (int)bytes_read, player->username);
+        LOG_HEX(LOG_NET, "RX", dest, (u32)bytes_read);
+        if (player->conn->ws.state != WS_STATE_NONE) {
+            /* Unframe in place (websocket.h): only stream bytes stay */
+            i32 kept = ws_input(&player->conn->ws, player->socket_fd, player->conn->in_buffer,
+                                player->conn->in_buffer_size,
+                                player->conn->in_buffer_size + (u32)bytes_read);
+            if (kept < 0) {
+                connection_closed = true;
+                break;
             }
-            
-            /* Try to recv more data */
-            bytes_read = network_receive(player->socket_fd, temp_buffer, sizeof(temp_buffer));
+            player->conn->in_buffer_size = (u32)kept;
+            if (!ws_ready(&player->conn->ws)) continue;
+        } else {
+            player->conn->in_buffer_size += (u32)bytes_read;
+        }
+        
+        /* The login handshake is answered now; game packets wait for the tick */
+        if (player->state == PLAYER_STATE_CONNECTED) {
+            server_try_login(player);
+            if (player->socket_fd < 0) return;  /* Refused */
+        } else {
+            player_set_add(&g_server->input_pending, player->slot);
         }
+    }
+    
+    if (recv_count > 0) {
+        LOG_TRACE(LOG_NET, "Finished recv loop after %d successful recv() calls, final buffer size=%u\n",
+                  recv_count, player->conn->in_buffer_size - player->conn->in_read);
+    }
+    
+    /* Check if connection was closed during recv loop */
+    if (connection_closed) {
+        /* Connection closed gracefully */
+        server_connection_lost(player, "connection closed");
+        return;
+    }
+}
+
+void server_flush_outputs(GameServer* server) {
+    for (u32 i = 0; i < MAX_PLAYERS; i++) {
+        Player* player = &server->players[i];
         
-        /* Check if connection was closed (recv returned 0) */
-        if (bytes_read == 0) {
-            printf("Player '%s' disconnected (connection closed)\n", player->username);
-            connection_closed = true;
+        /* Skip empty slots and connections with nothing queued (lingering ones discard theirs) */
+        if (player->conn->out_stream.position == 0) continue;
+        if (player->socket_fd < 0 && !player->linger_until) continue;
+        
+        if (!player_flush(player)) {
+            server_connection_lost(player, "send failed");
+            continue;
         }
+        if (player->socket_fd < 0) continue;
         
-        if (recv_count > 0) {
-            printf("DEBUG: Finished recv loop after %d successful recv() calls, final buffer size=%u\n", recv_count, player->in_buffer_size);
+        /*
+         * Backed-up output: ask to be woken when the socket drains so the
+         * remainder goes out before the next tick; stop asking once empty.
+         */
+        bool backed_up = player->conn->out_stream.position > 0;
+        if (g_netio) continue;  /* Network thread manages writability */
+        if (backed_up != player->conn->out_want_write) {
+            network_watch(&server->network, player->socket_fd, i, backed_up);
+            player->conn->out_want_write = backed_up;
         }
+    }
+}
+
+void server_check_send_queues(GameServer* server) {
+    u64 queued = 0;
+    u32 deepest = 0;
+    u32 congested = 0;
+    for (u32 i = 0; i < MAX_PLAYERS; i++) {
+        Player* player = &server->players[i];
+        if (player->socket_fd < 0) continue;
         
-        /* Process all buffered data if any was received */
-        if (player->in_buffer_size > 0) {
-            
-            /* Process login handshake if player is connecting */
-            if (player->state == PLAYER_STATE_CONNECTED && player->in_buffer_size >= 2) {
-                StreamBuffer* in = buffer_create(player->in_buffer_size);
-                buffer_write_bytes(in, player->in_buffer, player->in_buffer_size);
-                buffer_set_position(in, 0);
-                
-                if (login_process_header(player, in)) {
-                    /* Login successful - send initial game state */
-                    server_send_initial_game_packets(player);
-                    player->in_buffer_size = 0;
+        u32 backlog = player_out_backlog(player);
+        if (!player_out_watermark(player, backlog)) {
+            LOG_WARN("Player '%s' disconnected (slow consumer, %u bytes unsent)\n",
+                     player->username, backlog);
+            metrics_add(&g_metrics.slow_consumers, 1);
+            player_disconnect(player);
+            continue;
+        }
+        queued += backlog;
+        if (backlog > deepest) deepest = backlog;
+        congested += player_out_congested(player);
+    }
+    metrics_publish_output(queued, deepest, congested);
+}
+
+void server_process_net_records(GameServer* server) {
+    NetIo* io = &server->netio;
+    
+    /* Adopt connections the network thread accepted */
+    u32 slot;
+    i32 client_fd;
+    bool websocket;
+    while (netio_next_connection(io, &slot, &client_fd, &websocket)) {
+        Player* player = &server->players[slot];
+        if (player->state != PLAYER_STATE_DISCONNECTED) {
+            /* Cannot happen: a slot is only reused after netio_close() */
+            LOG_WARN("WARNING: netio slot %u still in use, rejecting fd=%d\n", slot, client_fd);
+            netio_close(io, slot);
+            continue;
+        }
+        if (!player_set_socket(player, client_fd)) {
+            LOG_WARN("No connection buffers, rejecting fd=%d\n", client_fd);
+            netio_close(io, slot);
+            continue;
+        }
+        /* The network thread does the handshake; output still needs frames */
+        if (websocket) player->conn->ws.state = WS_STATE_OPEN;
+        login_process_connection(player);
+        LOG_INFO("Player connected: index=%u fd=%d%s\n", player->index, client_fd,
+                 websocket ? " (WebSocket)" : "");
+    }
+    
+    for (u32 i = 0; i < MAX_PLAYERS; i++) {
+        server_process_slot_records(server, i, false);
+    }
+}
+
+/*
+ * server_process_tick_input - The tick's PACKETS phase
+ * 
+ * Handles the packets of every slot in input_pending, in slot order, in
+ * one pass right after the timers. A slot over its rate limit, or still
+ * waiting for its login to finish, lists itself again for the next tick.
+ * 
+ * A socket unwatched because its buffer filled (in_paused) is watched
+ * again once this pass has made room; if nothing at all could be taken
+ * from a full buffer, its first packet is larger than the buffer.
+ */
+static void server_process_tick_input(GameServer* server) {
+    PlayerSet pending = server->input_pending;
+    memset(&server->input_pending, 0, sizeof(server->input_pending));
+    
+    for (u32 i = player_set_next(&pending, 0); i < MAX_PLAYERS;
+         i = player_set_next(&pending, i + 1)) {
+        Player* player = &server->players[i];
+        if (player->socket_fd < 0) continue;
+        if (player->state == PLAYER_STATE_LOGGING_IN) {
+            player_set_add(&server->input_pending, i);
+            continue;
+        }
+        
+        if (g_netio == &server->netio) {
+            server_process_slot_records(server, i, true);
+            continue;
+        }
+        
+        server_dispatch_input(player);
+        if (player->socket_fd < 0 || !player->conn->in_paused) continue;
+        
+        bool full = player->conn->in_read == 0 && player->conn->in_buffer_size == MAX_PACKET_SIZE;
+        if (full && !player_set_has(&server->input_pending, i)) {
+            LOG_WARN("Player '%s' sent a packet larger than the input buffer\n", player->username);
+            player_disconnect(player);
+            continue;
+        }
+        if (!full) {
+            player->conn->in_paused = false;
+            network_watch(&server->network, player->socket_fd, i, player->conn->out_want_write);
+        }
+    }
+}
+
+/*
+ * server_process_slot_records - Dispatch one connection's inbound records
+ * 
+ * @param tick  false between ticks: stop at the first game packet and
+ *              list the slot for the tick's PACKETS phase; true in that
+ *              phase: handle packets until the rate limit holds one back
+ * 
+ * A record that is not handled stays queued in the ring.
+ */
+static void server_process_slot_records(GameServer* server, u32 i, bool tick) {
+    NetIo* io = &server->netio;
+    Player* player = &server->players[i];
+    NetIoRecord record;
+    
+    /* Payloads that wrap around the end of a ring are linearized here */
+    static u8 scratch[MAX_PACKET_SIZE];
+    
+    while (player->socket_fd >= 0 && netio_next_record(io, i, &record, scratch)) {
+        if (record.kind == NETIO_RECORD_CLOSED) {
+            server_connection_lost(player, "connection closed");
+            break;  /* Slot's rings now belong to the network thread (or wait for the session) */
+        }
+        
+        if (record.kind == NETIO_RECORD_RAW) {
+            /* Pre-login bytes: same accumulation as the inline path */
+            if (player->conn->in_buffer_size + record.length < MAX_PACKET_SIZE) {
+                memcpy(player->conn->in_buffer + player->conn->in_buffer_size, record.payload, record.length);
+                player->conn->in_buffer_size += record.length;
+            }
+            if (server_try_login(player) && player->state == PLAYER_STATE_LOGGED_IN) {
+                /* Cipher is seeded: the network thread frames from here on */
+                netio_begin_framing(io, i, &player->conn->in_cipher);
+            }
+        } else if (!tick) {
+            player_set_add(&server->input_pending, i);
+            break;
+        } else if (player->state == PLAYER_STATE_LOGGED_IN) {
+            if (!server_take_packet_token(player)) break;
+            StreamBuffer view;
+            buffer_init_view(&view, record.payload, record.length);
+            server_handle_packet(player, record.opcode, &view, record.length);
+        }
+        
+        /* A handler may have disconnected the player (e.g. logout) */
+        if (player->socket_fd < 0) break;
+        netio_release_record(io, i, &record);
+    }
+}
+
+/*
+ * server_finish_logins - Complete the logins the workers have finished
+ * 
+ * @param server  Running server
+ * 
+ * Results arrive in request order. One whose slot is no longer
+ * LOGGING_IN with the same ticket belonged to a client that dropped
+ * during the load (the slot may already serve someone else): it is
+ * discarded (freeing the account claim its worker took, see
+ * account_registry.h). A block that did not decode disconnects its
+ * client; an account online in another world is refused.
+ * 
+ * At most g_login_admission.budget logins complete per tick (login.h,
+ * LOGIN ADMISSION); the rest stay at the head of the queue, in order,
+ * until server_tick() refills the budget. Discarded, rejected and
+ * refused jobs cost no budget.
+ * 
+ * COMPLEXITY: O(finished loads), at most budget of them completed
+ */
+void server_finish_logins(GameServer* server) {
+    const LoadJob* job;
+    while ((job = load_queue_peek(&server->loads)) != NULL) {
+        Player* player = &server->players[job->slot];
+        
+        if (player->state == PLAYER_STATE_LOGGING_IN && player->login_ticket == job->ticket) {
+            if (job->status != LOAD_REJECTED && job->status != LOAD_ONLINE &&
+                !login_admission_open()) {
+                /* Tick's budget spent: the rest keep their place until the next */
+                break;
+            }
+            if (job->status == LOAD_REJECTED) {
+                LOG_WARN("Rejected login block from slot %u (%s)\n", player->slot,
+                         g_rsa_key ? "RSA decryption failed" : "malformed");
+                player_disconnect(player);
+                load_queue_pop(&server->loads);
+                continue;
+            }
+            if (job->status == LOAD_ONLINE) {
+                LOG_INFO("Refused login for '%s': online in another world\n", job->login.username);
+                login_refuse(player, LOGIN_RESPONSE_ACCOUNT_ONLINE);
+                load_queue_pop(&server->loads);
+                continue;
+            }
+            Player* online = world_get_player(g_world, job->login.username);
+            if (online && session_matches(online, &job->login)) {
+                /* Their lingering session (session.h): the loaded save is not needed */
+                login_accept(player, &job->login);
+                if (session_resume(online, player) && g_netio) {
+                    netio_begin_framing(g_netio, player->slot, &player->conn->in_cipher);
                 }
-                
-                buffer_destroy(in);
+                load_queue_pop(&server->loads);
+                continue;
+            }
+            if (online) {
+                /* Online here already; the claim the worker took is theirs */
+                LOG_INFO("Refused login for '%s': already online\n", job->login.username);
+                login_refuse(player, LOGIN_RESPONSE_ACCOUNT_ONLINE);
+                load_queue_pop(&server->loads);
+                continue;
             }
             
-            /* Process game packets if player is logged in */
-            while (player->in_buffer_size >= 1 && player->state == PLAYER_STATE_LOGGED_IN) {
-                /* Decrypt opcode using ISAAC cipher */
-                u8 encrypted_opcode = player->in_buffer[0];
-                u8 opcode = encrypted_opcode;
-                if (player->in_cipher.initialized) {
-                    u32 isaac_key = isaac_get_next(&player->in_cipher);
-                    opcode = (encrypted_opcode - isaac_key) & 0xFF;
-                    printf("DEBUG ISAAC decrypt: encrypted=0x%02X - isaac_key=%u = opcode=%u\n", 
-                           encrypted_opcode, isaac_key, opcode);
-                }
-                
-                /* Lookup packet length from table */
-                i32 packet_length = PacketLengths[opcode];
-                i32 header_size = 1;
-                
-                if (packet_length == -1) {
-                    /* VAR_BYTE: next byte is payload length */
-                    if (player->in_buffer_size < 2) break;  /* Wait for length byte */
-                    packet_length = player->in_buffer[1] & 0xFF;
-                    header_size = 2;
-                } else if (packet_length == -2) {
-                    /* VAR_SHORT: next 2 bytes are payload length (big-endian) */
-                    if (player->in_buffer_size < 3) break;  /* Wait for length bytes */
-                    packet_length = ((player->in_buffer[1] & 0xFF) << 8) | (player->in_buffer[2] & 0xFF);
-                    header_size = 3;
-                }
-                
-                /* Ensure length is non-negative */
-                if (packet_length < 0) packet_length = 0;
-                
-                /* Check if full packet received */
-                if (player->in_buffer_size < header_size + packet_length) {
-                    break;  /* Partial packet, wait for more data */
-                }
-                
-                /* Create buffer for packet payload */
-                StreamBuffer* buf = buffer_create(packet_length);
-                buffer_write_bytes(buf, player->in_buffer + header_size, packet_length);
-                buffer_set_position(buf, 0);
-                
-                /* Dispatch to packet handler */
-                server_handle_packet(player, opcode, buf, packet_length);
-                
-                buffer_destroy(buf);
-                
-                /* Remove packet from input buffer (move remaining data forward) */
-                u32 total_size = header_size + packet_length;
-                memmove(player->in_buffer, player->in_buffer + total_size, 
-                       player->in_buffer_size - total_size);
-                player->in_buffer_size -= total_size;
+            u64 trace_start = trace_begin();
+            login_accept(player, &job->login);
+            bool logged_in;
+            if (job->status == LOAD_FAILED) {
+                /* Worker could not hold the bytes: read them here instead */
+                u8 save[PLAYER_SAVE_MAX_SIZE];
+                u32 save_size = 0;
+                bool found = player_load_read(player->username, save, sizeof(save), &save_size);
+                logged_in = login_complete(player, found ? save : NULL, save_size);
+            } else {
+                logged_in = login_complete(player, job->status == LOAD_FOUND ? job->data : NULL,
+                                           job->size);
+            }
+            
+            if (logged_in) {
+                /* login_accept() seeded the cipher only now (see the inline case) */
+                if (g_netio) netio_begin_framing(g_netio, player->slot, &player->conn->in_cipher);
+                server_send_initial_game_packets(player);
+                PROBE2(login__accept, player->slot, (const char*)player->username);
+            } else {
+                LOG_INFO("Player '%s' disconnected during login\n", player->username);
+                player_disconnect(player);
             }
+            trace_end(trace_start, "login_accept", player->slot);
+        } else if (job->status != LOAD_REJECTED && job->status != LOAD_ONLINE &&
+                   !world_get_player(g_world, job->login.username)) {
+            /* The client left during the load: free the account the worker claimed */
+            account_registry_drop(g_account_registry, job->login.username, g_world_id);
         }
         
-        /* Check if connection was closed during recv loop */
-        if (connection_closed) {
-            /* Connection closed gracefully */
-            printf("Player '%s' disconnected (connection closed)\n", player->username);
-            player_disconnect(player);
-            continue;  /* Skip to next player */
+        load_queue_pop(&server->loads);
+    }
+}
+
+bool server_listen_websocket(GameServer* server, u16 port) {
+    if (!network_listen_websocket(&server->network, port)) return false;
+    printf("WebSocket clients on port %u\n", port);
+    return true;
+}
+
+bool server_start_net_thread(GameServer* server) {
+    return netio_start(&server->netio, &server->network, g_server_limits.players + 1);
+}
+
+bool server_start_update_pool(GameServer* server, u32 threads) {
+    return update_pool_start(&server->updates, threads);
+}
+
+bool server_start_region_shards(GameServer* server, u32 shards) {
+    return region_shards_start(&server->shards, shards);
+}
+
+bool server_open_save_log(GameServer* server, const char* path) {
+    server->save_log = save_log_open(path);
+    g_save_log = server->save_log;
+    return server->save_log != NULL;
+}
+
+/*******************************************************************************
+ * REPLAY (see replay.h)
+ ******************************************************************************/
+
+/*
+ * server_replay_apply - Redo one recorded login, packet or disconnect
+ * 
+ * @param server  Server built with server_init(server, 0)
+ * @param record  ACCEPT, COMPLETE, PACKET or DISCONNECT (others ignored)
+ * 
+ * Each record goes through the same function the live server called
+ * where it was recorded. A record for a slot in the wrong state (a
+ * packet for a player the replay already logged out) is skipped.
+ */
+static void server_replay_apply(GameServer* server, const ReplayRecord* record) {
+    Player* player = &server->players[record->slot];
+    
+    switch (record->kind) {
+        case REPLAY_ACCEPT: {
+            if (player->state != PLAYER_STATE_DISCONNECTED) player_disconnect(player);
+#ifndef _WIN32
+            /* A real descriptor: every "still connected?" check behaves as live */
+            i32 fd = open("/dev/null", O_WRONLY);
+#else
+            i32 fd = -1;
+#endif
+            if (fd < 0) {
+                fprintf(stderr, "WARNING: Replay login of '%s' skipped (no descriptor)\n",
+                        record->username);
+                break;
+            }
+            if (!player_set_socket(player, fd)) {
+                close(fd);
+                fprintf(stderr, "WARNING: Replay login of '%s' skipped (no connection)\n",
+                        record->username);
+                break;
+            }
+            
+            LoginBlock block;
+            memset(&block, 0, sizeof(block));
+            memcpy(block.seeds, record->seeds, sizeof(block.seeds));
+            memcpy(block.username, record->username, sizeof(block.username));
+            login_accept(player, &block);
+            break;
+        }
+        
+        case REPLAY_COMPLETE:
+            if (player->socket_fd < 0 || player->state == PLAYER_STATE_LOGGED_IN) break;
+            if (login_complete(player, record->length ? record->data : NULL, record->length)) {
+                server_send_initial_game_packets(player);
+                g_replay.logins++;
+            } else {
+                player_disconnect(player);
+            }
+            break;
+        
+        case REPLAY_PACKET: {
+            if (player->state != PLAYER_STATE_LOGGED_IN) break;
+            StreamBuffer view;
+            buffer_init_view(&view, record->data, record->length);
+            server_handle_packet(player, record->opcode, &view, record->length);
+            g_replay.packets++;
+            break;
+        }
+        
+        case REPLAY_DISCONNECT:
+            if (player->state != PLAYER_STATE_DISCONNECTED) player_disconnect(player);
+            break;
+        
+        default:
+            break;
+    }
+}
+
+/*
+ * server_replay_tick_input - The PACKETS phase of a replayed tick
+ * 
+ * Applies the records up to the tick's WORLD marker: the packets the live
+ * tick handled (and any login or disconnect that happened among them).
+ */
+static void server_replay_tick_input(GameServer* server) {
+    ReplayRecord record;
+    while (replay_log_next(&g_replay.log, &record) && record.kind != REPLAY_WORLD) {
+        server_replay_apply(server, &record);
+    }
+}
+
+static int compare_u64(const void* a, const void* b) {
+    u64 x = *(const u64*)a, y = *(const u64*)b;
+    return (x > y) - (x < y);
+}
+
+bool server_replay(GameServer* server, const char* path) {
+#ifdef _WIN32
+    (void)server;
+    fprintf(stderr, "ERROR: --replay needs POSIX (/dev/null descriptors)\n");
+    return false;
+#else
+    if (!replay_log_open(&g_replay.log, path)) return false;
+    
+    /* One descriptor per replayed connection: allow as many as live had */
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+    
+    g_replay.replaying = true;
+    g_replay.logins = 0;
+    g_replay.packets = 0;
+    printf("Replaying %s (%u bytes)\n", path, g_replay.log.size);
+    
+    u32 capacity = 1024, ticks = 0;
+    u64* work = malloc(capacity * sizeof(u64));
+    if (!work) {
+        replay_log_close(&g_replay.log);
+        return false;
+    }
+    
+    ReplayRecord record;
+    while (replay_log_next(&g_replay.log, &record)) {
+        if (record.kind != REPLAY_TICK) {
+            /* Between ticks: logins finishing, connections dropping */
+            server_replay_apply(server, &record);
+            continue;
+        }
+        
+        /* The recording may have started on a running server */
+        server->tick_count = record.tick - 1;
+        
+        u64 start = tick_stats_now();
+        tick_stats_begin(0);
+        server_tick(server);
+        tick_stats_end(server->tick_count);
+        
+        /* As server_run(): the tick's output goes out right after it */
+        u64 mark = tick_stats_now();
+        server_flush_outputs(server);
+        tick_phase_end(TICK_PHASE_FLUSH, &mark);
+        
+        if (ticks == capacity) {
+            u64* grown = realloc(work, capacity * 2 * sizeof(u64));
+            if (!grown) break;
+            work = grown;
+            capacity *= 2;
         }
+        work[ticks++] = tick_stats_now() - start;
+        
+        if (server->tick_count % REPLAY_DIGEST_INTERVAL == 0) {
+            printf("Replay tick %llu digest %016llx\n", (unsigned long long)server->tick_count,
+                   (unsigned long long)g_replay.digest);
+        }
+    }
+    server_flush_outputs(server);
+    
+    u64 total = 0;
+    for (u32 i = 0; i < ticks; i++) total += work[i];
+    qsort(work, ticks, sizeof(u64), compare_u64);
+    
+    printf("========================================\n");
+    printf("Replay of %s: %u ticks, %llu logins, %llu packets, %llu saves dropped\n", path, ticks,
+           (unsigned long long)g_replay.logins, (unsigned long long)g_replay.packets,
+           (unsigned long long)g_replay.saves);
+    printf("  digest %016llx over %llu output bytes\n", (unsigned long long)g_replay.digest,
+           (unsigned long long)g_replay.output_bytes);
+    if (ticks > 0) {
+        printf("  tick work ms: mean %.3f  p50 %.3f  p99 %.3f  max %.3f  (total %.1f)\n",
+               total / 1e6 / ticks, work[ticks / 2] / 1e6, work[(u64)ticks * 99 / 100] / 1e6,
+               work[ticks - 1] / 1e6, total / 1e6);
     }
+    printf("========================================\n");
+    
+    free(work);
+    replay_log_close(&g_replay.log);
+    return true;
+#endif
 }
 
 /*******************************************************************************
@@ -909,130 +2274,217 @@ void server_process_packets(GameServer* server) {
  * @param buf            Payload buffer (position=0, ready to read)
  * @param packet_length  Payload size in bytes
  * 
- * PACKET CATEGORIES:
+ * PACKET CATEGORIES (names from CLIENT_PACKET_LIST in packets.h):
  * 
- *   Movement (248, 165, 181, 93):
- *     Different opcodes indicate walk vs run, queue vs replace
+ *   Movement (MOVE_GAMECLICK 181, MOVE_MINIMAPCLICK 165, MOVE_OPCLICK 93):
+ *     Walk or run to a clicked tile
  *     All contain delta-encoded path data
  *   
- *   Player Design (52):
+ *   Player Design (IF_PLAYERDESIGN 52):
  *     Sent when player customizes appearance
  *     Contains gender, body parts, colors
  *   
- *   Map Requests (150, 81):
+ *   Map Requests (REBUILD_GETMAPS 150):
  *     Request map region data for specific areas
  *     Server responds with terrain and object data
  *   
- *   Commands (158):
+ *   Commands (CLIENT_CHEAT 4):
  *     Player-typed commands like "::tele 3200 3200 0"
  *     Used for admin/debug features
  *   
- *   Chat (108, 70, 85, ...):
- *     Public chat, private messages, clan chat
- *     Currently stubbed (skip payload)
+ *   Interfaces (IF_BUTTON 155):
+ *     Logout button, design screen "Accept"
  *   
- *   Items/Objects (175, 155, 31, ...):
- *     Drop item, pickup item, use item, etc.
- *     Currently stubbed (skip payload)
+ *   Idle logout (IDLE_TIMER 70):
+ *     The client reports it has been idle too long
  *   
- *   Interfaces (194, 8, 27, ...):
- *     Click button, close interface, etc.
- *     Currently stubbed (skip payload)
- * 
- * STUB HANDLERS:
- *   Many packets are not yet implemented, so they just skip payload
- *   This prevents desynchronization (important for ISAAC cipher!)
+ *   Public chat (MESSAGE_PUBLIC 158):
+ *     Wordpacked text, forwarded to viewers via PLAYER_INFO (chat.h)
+ *   
+ *   Friends (FRIENDLIST_ADD 118 / _DEL 11, IGNORELIST_ADD 79 / _DEL 171,
+ *   MESSAGE_PRIVATE 148):
+ *     List edits and private messages (social.h)
  *   
- *   Example: buffer_skip(buf, packet_length)
- *     Advances read position without processing data
- *     Ensures buffer is fully consumed
+ *   Shops (INV_BUTTON1-4 31 / 59 / 212 / 38, CLOSE_MODAL 231):
+ *     Value, buy and sell in an open shop; closing it (shop.h)
+ * 
+ * EVERYTHING ELSE:
+ *   Other item options, NPC and object options, anticheat reports, ... are
+ *   framed by PacketLengths[] like any packet and then ignored. The
+ *   payload is a view of the input bytes (buffer_init_view), so an
+ *   ignored packet needs no buffer_skip(): the next packet starts where
+ *   the framer says, whatever the handler read. Opcodes not in the
+ *   schema at all are logged at debug level.
  * 
  * DEBUG LOGGING:
- *   Prints every packet opcode and length
+ *   Prints every packet opcode and length (--log=packet)
  *   Useful for protocol reverse engineering
- *   Can be disabled in production for performance
+ *   Compiled out entirely below LOG_LEVEL_TRACE (see log.h)
  * 
  * COMPLEXITY: O(1) for most handlers, O(N) for movement (N = path length)
  */
+/*
+ * server_trace_packet - Record one handler as a span named for its packet
+ */
+static void server_trace_packet(const Player* player, u8 opcode, u64 start) {
+    const char* name = ClientPacketNames[opcode] ? ClientPacketNames[opcode] : "packet";
+    trace_end(start, name, player->index);
+}
+
 static void server_handle_packet(Player* player, u8 opcode, StreamBuffer* buf, u32 packet_length) {
-    static u32 movement_packet_count = 0;
-    if (opcode == 165 || opcode == 181 || opcode == 93) {
-        movement_packet_count++;
-        printf("[RX] MOVEMENT PACKET #%u: op=%u len=%d\n", movement_packet_count, (unsigned)opcode, (int)packet_length);
-    } else {
-        printf("[RX] op=%u len=%d\n", (unsigned)opcode, (int)packet_length);
+    if (g_replay.recording) {
+        replay_record_packet(player->slot, opcode, buf->data + buf->position, packet_length);
     }
+    metrics_add(&g_metrics.packets_in[opcode], 1);
+    metrics_add(&g_metrics.packet_bytes_in[opcode], packet_length);
+    PROBE3(packet, player->index, opcode, packet_length);
+    hook_packet(player, opcode, buf->data + buf->position, packet_length);
+    
+    /* Moves the reaper's idle deadline (player.h); the timer re-arms itself */
+    PlayerConnection* conn = player->conn;
+    if (g_timers) conn->last_input_tick = g_timers->now;
+    
+    /* The connection's own traffic (traffic.h): the whole packet as framed */
+    i32 framing = PacketLengths[opcode];
+    traffic_packet_in(conn, opcode, packet_length + 1 + (framing == -1 ? 1 : framing == -2 ? 2 : 0));
+    
+    /* Profiling: per-tick packet count against the spam limit */
+    if (g_packet_profile.enabled) {
+        if (conn->in_tick != g_server->tick_count) {
+            conn->in_tick = g_server->tick_count;
+            conn->in_tick_packets = 0;
+        }
+        u32 limit = PACKETS_PER_TICK;
+        if (++conn->in_tick_packets > limit) {
+            packet_profile_spam(conn->in_tick_packets == limit + 1);
+        }
+    }
+    
+    /* Handler time, always (traffic.h) and for the profiler and trace */
+    u64 start = tick_stats_now();
+    server_dispatch_packet(player, opcode, buf, packet_length);
+    u64 ns = tick_stats_now() - start;
+    
+    /* A handler that disconnected the player has given the connection back */
+    if (player->conn == conn) traffic_add(conn, TRAFFIC_HANDLER_NS, ns);
+    if (g_packet_profile.enabled) packet_profile_in(opcode, packet_length, ns);
+    if (trace_enabled()) server_trace_packet(player, opcode, start);
+}
 
-    switch (opcode) {
-        /* Movement packets (different types for walk/run) */
-        case 165: case 181: case 93:
+/*
+ * server_dispatch_packet - The opcode switch behind server_handle_packet()
+ */
+static void server_dispatch_packet(Player* player, u8 opcode, StreamBuffer* buf, u32 packet_length) {
+    if (LOG_SUBSYSTEM_ENABLED(LOG_PACKET)) {
+        const char* name = ClientPacketNames[opcode] ? ClientPacketNames[opcode] : "?";
+        LOG_TRACE(LOG_PACKET, "[RX] %s op=%u len=%d\n", name, (unsigned)opcode, (int)packet_length);
+    }
+
+    switch ((ClientPacket)opcode) {
+        case CLIENT_MOVE_GAMECLICK:
+        case CLIENT_MOVE_MINIMAPCLICK:
+        case CLIENT_MOVE_OPCLICK:
+            /* Walking away ends an attack (OPNPC2 after an OPCLICK starts one)
+             * and closes the shop */
+            combat_stop(g_combat, COMBAT_PLAYER(player->index));
+            shop_close(g_shops, player);
             server_handle_movement_packet(player, buf, packet_length, opcode);
             break;
 
-        /* Player appearance design */
-        case 52:
+        /* "Attack" on an NPC (combat.h) */
+        case CLIENT_OPNPC2: {
+            OpNpcPacket op;
+            if (decode_opnpc(buf, &op) && npc_get_by_index(g_npcs, op.npc_index)) {
+                combat_attack(g_combat, COMBAT_PLAYER(player->index), COMBAT_NPC(op.npc_index));
+            }
+            break;
+        }
+
+        case CLIENT_IF_PLAYERDESIGN:
             server_handle_player_design(player, buf);
             break;
 
-        /* Map region requests */
-        case 150: case 81:
+        case CLIENT_REBUILD_GETMAPS:
             map_handle_request(player, buf, packet_length);
             break;
 
-        /* Keepalive and misc packets */
-        case 224:
-        case 38:
-        case 0:
-            buffer_skip(buf, packet_length);
+        case CLIENT_IDLE_TIMER:
+            LOG_INFO("Player '%s' requested logout (idle timer)\n", player->username);
+            player_disconnect(player);
+            return;
+
+        case CLIENT_IF_BUTTON:
+            server_handle_if_button(player, buf);
             break;
 
-        case 79:
-            buffer_skip(buf, packet_length);
+        /* "Click here to continue": resumes a paused script (script.h) */
+        case CLIENT_RESUME_PAUSEBUTTON: {
+            ResumePauseButtonPacket resume;
+            if (decode_resume_pausebutton(buf, &resume)) script_resume_pause(g_scripts, player);
             break;
+        }
 
-        case 30:
-            printf("Player '%s' requested logout (idle timer)\n", player->username);
-            player_disconnect(player);
-            return;
-        
-        /* Chat packets (public, private, clan, etc.) */
-        case 108: case 70: case 85: case 215: case 236:
-        case 146: case 219: case 233: case 220: case 238:
-        case 17:  case 88: case 176: case 7:   case 66:
-        case 2:
-            buffer_skip(buf, packet_length);
+        /* Value / Buy / Sell in an open shop (shop.h) */
+        case CLIENT_INV_BUTTON1:
+            shop_handle_inv_button(g_shops, player, 1, buf);
             break;
 
-        /* Interface button clicks */
-        case 155:
-            server_handle_if_button(player, buf);
+        case CLIENT_INV_BUTTON2:
+            shop_handle_inv_button(g_shops, player, 2, buf);
             break;
-        
-        /* Item and object interaction packets */
-        case 175: case 31: case 59: case 212:
-        case 6:   case 159: case 231: case 235: case 237:
-            buffer_skip(buf, packet_length);
+
+        case CLIENT_INV_BUTTON3:
+            shop_handle_inv_button(g_shops, player, 3, buf);
             break;
 
-        /* Interface interaction packets */
-        case 194: case 8: case 27: case 113: case 100:
-        case 202: case 134:
-            buffer_skip(buf, packet_length);
+        case CLIENT_INV_BUTTON4:
+            shop_handle_inv_button(g_shops, player, 4, buf);
             break;
 
-        /* Command packets (::tele, ::item, etc.) */
-        case 158:
-            server_handle_command(player, buf, packet_length);
+        /* The client closed its interfaces */
+        case CLIENT_CLOSE_MODAL:
+            shop_close(g_shops, player);
             break;
-        
-        /* Miscellaneous unhandled packets */
-        case 189: case 190: case 4:
-            buffer_skip(buf, packet_length);
+
+        /* Public chat: packed text into the player's chat slot (chat.h) */
+        case CLIENT_MESSAGE_PUBLIC:
+            chat_handle_public(player, buf, packet_length);
+            break;
+
+        /* Friend and ignore lists, private messages (social.h) */
+        case CLIENT_FRIENDLIST_ADD:
+            social_handle_friend_add(g_social, player, buf);
+            break;
+
+        case CLIENT_FRIENDLIST_DEL:
+            social_handle_friend_del(g_social, player, buf);
+            break;
+
+        case CLIENT_IGNORELIST_ADD:
+            social_handle_ignore_add(player, buf);
+            break;
+
+        case CLIENT_IGNORELIST_DEL:
+            social_handle_ignore_del(player, buf);
+            break;
+
+        case CLIENT_MESSAGE_PRIVATE:
+            social_handle_private(g_social, player, buf, packet_length);
+            break;
+
+        /* ::commands (the client strips the "::") */
+        case CLIENT_CLIENT_CHEAT:
+            server_handle_command(player, buf, packet_length);
             break;
 
         default:
-            printf("Unhandled packet: opcode=%u, length=%u\n", opcode, packet_length);
-            buffer_skip(buf, packet_length);
+            /*
+             * Everything else is framed by PacketLengths[] and ignored:
+             * the payload is a view, so nothing has to be skipped.
+             */
+            if (!ClientPacketNames[opcode]) {
+                LOG_DEBUG("Unknown packet: opcode=%u, length=%u\n", opcode, packet_length);
+            }
             break;
     }
 }
@@ -1088,9 +2540,15 @@ static void server_handle_packet(Player* player, u8 opcode, StreamBuffer* buf, u
  *   If first step matches player's current position, skip it
  *   This prevents stationary "movement" when player clicks current tile
  * 
+ * VALIDATION:
+ *   VAR_BYTE, so the length is whatever the client says: anything
+ *   shorter than the 5-byte header (+ 14-byte minimap trailer) is
+ *   dropped before the first read, and the steps are read unchecked
+ *   (buffer_get_*, see buffer.h) inside the length that was verified.
+ * 
  * SIGNED DELTA PARSING:
- *   buffer_read_byte(buf, true) returns signed i8
- *   Must cast to signed before arithmetic to handle negative correctly
+ *   buffer_get_i8(buf) returns signed i8
+ *   Must be signed before arithmetic to handle negative correctly
  *   
  *   Example:
  *     delta_byte = 0xFF (unsigned = 255)
@@ -1098,35 +2556,54 @@ static void server_handle_packet(Player* player, u8 opcode, StreamBuffer* buf, u
  *     3200 + (-1) = 3199 (correct)
  *     3200 + 255 = 3455 (wrong!)
  * 
+ * PATH VALIDATION:
+ *   The client's path is not trusted: pathfinder_validate_steps() walks it
+ *   tile by tile over the collision pages and cuts it at the first step
+ *   through a wall, so the player stops there instead of clipping through.
+ *   Destination-only packets go through the pathfinder instead.
+ * 
  * COMPLEXITY: O(N) where N = number of steps (typically 5-25)
  */
 static void server_handle_movement_packet(Player* player, StreamBuffer* buf, u32 packet_length, u8 opcode) {
-    /* Read movement header */
-    u32 ctrl_down = buffer_read_byte(buf, false);
-    u32 start_x = buffer_read_short(buf, false, BYTE_ORDER_BIG);
-    u32 start_z = buffer_read_short(buf, false, BYTE_ORDER_BIG);
+    /* Minimap clicks have a 14-byte trailer after the steps */
+    u32 offset = (opcode == CLIENT_MOVE_MINIMAPCLICK) ? 14 : 0;
+    
+    /* VAR_BYTE: any length can arrive, so check the layout once */
+    MovePacket move;
+    if (packet_length < 5 + offset || !buffer_require(buf, packet_length) ||
+        !decode_move(buf, &move)) {
+        LOG_DEBUG("Malformed movement packet from %s: opcode %u, %u bytes\n",
+                  player->username, opcode, packet_length);
+        return;
+    }
+    
+    u32 ctrl_down = move.ctrl_down;
+    u32 start_x = move.start_x;
+    u32 start_z = move.start_z;
     
-    /* Calculate number of delta steps (minimap clicks have 14-byte offset at end) */
-    u32 offset = (opcode == 165) ? 14 : 0;  /* 165 = MOVE_MINIMAPCLICK */
+    /* Calculate number of delta steps */
     u32 count = (packet_length - 5 - offset) / 2;
     
     /* Validate distance (TypeScript uses max 104 tiles from player) */
-    i32 dx = (i32)start_x - (i32)player->position.x;
-    i32 dz = (i32)start_z - (i32)player->position.z;
+    i32 dx = (i32)start_x - (i32)position_x(&player->position);
+    i32 dz = (i32)start_z - (i32)position_z(&player->position);
     i32 distance = (dx < 0 ? -dx : dx) + (dz < 0 ? -dz : dz);  /* Manhattan distance */
     
-    printf("DEBUG: Movement packet received:\n");
-    printf("  Opcode: %u (%s)\n", opcode, 
-           opcode == 165 ? "MINIMAP" : opcode == 181 ? "VIEWPORT" : opcode == 93 ? "OPCLICK" : "UNKNOWN");
-    printf("  Player position: (%u, %u)\n", player->position.x, player->position.z);
-    printf("  Clicked destination: (%u, %u)\n", start_x, start_z);
-    printf("  Delta: dx=%d, dz=%d\n", dx, dz);
-    printf("  Manhattan distance: %d tiles\n", distance);
-    printf("  Control held: %u (0=walk, 1=run)\n", ctrl_down);
-    printf("  Delta waypoints: %u\n", count);
+    LOG_TRACE(LOG_MOVEMENT, "Movement packet received:\n"
+              "  Opcode: %u (%s)\n"
+              "  Player position: (%u, %u)\n"
+              "  Clicked destination: (%u, %u)\n"
+              "  Delta: dx=%d, dz=%d\n"
+              "  Manhattan distance: %d tiles\n"
+              "  Control held: %u (0=walk, 1=run)\n"
+              "  Delta waypoints: %u\n",
+              opcode,
+              ClientPacketNames[opcode],
+              position_x(&player->position), position_z(&player->position), start_x, start_z,
+              dx, dz, distance, ctrl_down, count);
     
     if (distance > 104) {
-        printf("WARNING: Movement rejected - distance exceeds max 104 tiles\n");
+        LOG_WARN("WARNING: Movement rejected - distance exceeds max 104 tiles\n");
         return;
     }
     
@@ -1142,15 +2619,15 @@ static void server_handle_movement_packet(Player* player, StreamBuffer* buf, u32
     
     /* Read delta steps and reconstruct absolute coordinates */
     for (u32 i = 0; i < count && step_count < MAX_WAYPOINTS; i++) {
-        i8 delta_x = (i8)buffer_read_byte(buf, true);  /* Signed 8-bit */
-        i8 delta_z = (i8)buffer_read_byte(buf, true);
+        i8 delta_x = buffer_get_i8(buf);  /* Signed 8-bit */
+        i8 delta_z = buffer_get_i8(buf);
         steps[step_count].x = steps[step_count - 1].x + delta_x;
         steps[step_count].z = steps[step_count - 1].z + delta_z;
         step_count++;
     }
     
-    printf("DEBUG: Player current pos=(%u,%u), path has %u steps\n", 
-           player->position.x, player->position.z, step_count);
+    LOG_TRACE(LOG_MOVEMENT, "Player current pos=(%u,%u), path has %u steps\n", 
+              position_x(&player->position), position_z(&player->position), step_count);
     
     /* Reset movement queue and configure run mode */
     movement_reset(&player->movement);
@@ -1158,23 +2635,39 @@ static void server_handle_movement_packet(Player* player, StreamBuffer* buf, u32
     
     /* Skip first step if it matches current position */
     i32 start_idx = 0;
-    if (step_count > 0 && steps[0].x == player->position.x && steps[0].z == player->position.z) {
+    if (step_count > 0 && steps[0].x == position_x(&player->position) && steps[0].z == position_z(&player->position)) {
         start_idx = 1;
-        printf("DEBUG: Skipping first step as it's current position\n");
+        LOG_TRACE(LOG_MOVEMENT, "Skipping first step as it's current position\n");
     }
     
     /* If client sent only destination (no intermediate deltas), calculate path */
     if (count == 0 && step_count == 1) {
-        printf("DEBUG: Client sent destination only, calculating naive path\n");
-        movement_naive_path(&player->movement, player->position.x, player->position.z, 
-                           steps[0].x, steps[0].z);
+        LOG_TRACE(LOG_MOVEMENT, "Client sent destination only, calculating path\n");
+        pathfinder_walk_to(&player->movement, position_height(&player->position),
+                           position_x(&player->position), position_z(&player->position), steps[0].x, steps[0].z);
     } else {
-        /* Client sent full path, use it directly */
-        for (i32 i = start_idx; i < step_count; i++) {
-            movement_add_step(&player->movement, steps[i].x, steps[i].z);
-            if (i == start_idx || i == step_count - 1) {
-                printf("DEBUG: Adding step[%d]=(%u,%u)\n", i, steps[i].x, steps[i].z);
-            }
+        /* Client sent full path: cut it at the first wall it walks through */
+        u32 path_x[MAX_WAYPOINTS];
+        u32 path_z[MAX_WAYPOINTS];
+        u32 path_count = 0;
+        for (i32 i = start_idx; i < (i32)step_count; i++) {
+            path_x[path_count] = steps[i].x;
+            path_z[path_count] = steps[i].z;
+            path_count++;
+        }
+
+        u32 valid = pathfinder_validate_steps(g_world_collision, position_height(&player->position),
+                                              position_x(&player->position), position_z(&player->position),
+                                              path_x, path_z, path_count);
+        if (valid < path_count) {
+            LOG_DEBUG("Path from %s cut at step %u of %u (blocked)\n",
+                      player->username, valid, path_count);
+        }
+
+        movement_add_path(&player->movement, path_x, path_z, valid);
+        if (valid > 0) {
+            LOG_TRACE(LOG_MOVEMENT, "Adding steps (%u,%u) .. (%u,%u)\n",
+                      path_x[0], path_z[0], path_x[valid - 1], path_z[valid - 1]);
         }
     }
     
@@ -1182,6 +2675,422 @@ static void server_handle_movement_packet(Player* player, StreamBuffer* buf, u32
     movement_finish(&player->movement);
 }
 
+/*
+ * ::COMMAND HANDLERS
+ *
+ * Registered with command.h by server_register_commands(); each gets its
+ * arguments already split (args->argv) and returns false for bad
+ * arguments, which sends the command's usage line.
+ *
+ *   Command                       Rights  Cooldown  Effect
+ *   ::tele <x> <z> <height>       admin   -         Move, then send the new map region
+ *   ::item <id> [amount]          admin   -         Add to the inventory (next tick's update)
+ *   ::profile on|off|dump         admin   -         Packet profiler (packet_profile.h)
+ *   ::top [in|out|packets|map|    admin   -         Busiest connections of the last
+ *         info|cpu]                                 minute (traffic.h), bytes out default
+ *   ::trace on|off|dump           admin   -         Span tracing (trace.h), dump to
+ *                                                   trace-<tick>.json after the tick
+ *   ::mem                         admin   -         Heap by subsystem, live and peak
+ *                                                   (mem_stats.h), and RSS
+ *   ::yell <text>                 player  5 ticks   Filtered game message to everyone
+ *                                                   (broadcast.h: encoded once)
+ *   ::find <name>                 player  2 ticks   World a player is online on (presence.h)
+ *   ::reloadmaps                  admin   -         Rebuild data/maps in the background,
+ *                                                   swap between ticks (asset_reload.h)
+ *   ::reloadscripts               admin   -         Recompile data/scripts if changed,
+ *                                                   cancel running scripts (script.h)
+ *   ::instance [leave]            admin   -         Enter a private copy of the current
+ *                                                   mapsquare, or leave it (instance.h)
+ *   ::cluster                     admin   -         This node, the owner of the current
+ *                                                   square, ghosts and handoffs (cluster.h)
+ *   ::<script> [numbers]          admin   -         [command,<script>] triggers, numbers
+ *                                                   in r0.. (command_script)
+ *
+ * REGION UPDATE:
+ *   After a teleport the client needs the new map region, or it shows
+ *   the old map (or a black void) around the new position:
+ *     map_send_load_area(player, mapsquare_x, mapsquare_z)
+ */
+static bool command_tele(Player* player, const CommandArgs* args) {
+    u32 x, z, height;
+    if (args->argc != 3 || !command_arg_u32(args, 0, &x) || !command_arg_u32(args, 1, &z) ||
+        !command_arg_u32(args, 2, &height) || height > 3) {
+        return false;
+    }
+    LOG_INFO("Teleporting %s to (%u, %u, %u)\n", player->username, x, z, height);
+    player_set_position(player, x, z, height);
+
+    i32 mapsquare_x = position_get_mapsquare_x(&player->position);
+    i32 mapsquare_z = position_get_mapsquare_z(&player->position);
+    map_send_load_area(player, mapsquare_x, mapsquare_z);
+    return true;
+}
+
+static bool command_item(Player* player, const CommandArgs* args) {
+    u32 id, amount = 1;
+    if (args->argc < 1 || args->argc > 2 || !command_arg_u32(args, 0, &id) ||
+        (args->argc == 2 && !command_arg_u32(args, 1, &amount))) {
+        return false;
+    }
+    if (id == 0 || id > 0xFFFF || !item_get_definition(g_items, (u16)id)) return false;
+    if (!item_container_add(player->inventory, (u16)id, amount)) {
+        send_player_message(player, "You don't have enough inventory space.");
+    }
+    return true;
+}
+
+/* ::gfx, ::proj and ::loc show zone_update.h at work around the caller */
+static bool command_gfx(Player* player, const CommandArgs* args) {
+    u32 id, height = 0;
+    if (args->argc < 1 || args->argc > 2 || !command_arg_u32(args, 0, &id) || id > 0xFFFF ||
+        (args->argc == 2 && (!command_arg_u32(args, 1, &height) || height > 0xFF))) {
+        return false;
+    }
+    zone_update_map_anim(g_zone_updates, &player->position, (u16)id, (u8)height, 0);
+    return true;
+}
+
+static bool command_proj(Player* player, const CommandArgs* args) {
+    u32 id, x, z;
+    if (args->argc != 3 || !command_arg_u32(args, 0, &id) || id > 0xFFFF ||
+        !command_arg_u32(args, 1, &x) || !command_arg_u32(args, 2, &z)) {
+        return false;
+    }
+    ZoneProjectile projectile = {
+        .from = player->position,
+        .to = { .packed = position_pack(x, z, position_height(&player->position)) },
+        .spotanim = (u16)id, .src_height = 43, .dst_height = 31,
+        .start_delay = 51, .end_delay = 81, .peak = 16, .arc = 64
+    };
+    if (!zone_update_projectile(g_zone_updates, &projectile)) {
+        send_player_message(player, "That tile is too far away.");
+    }
+    return true;
+}
+
+static bool command_loc(Player* player, const CommandArgs* args) {
+    u32 id = ZONE_LOC_REMOVED, shape = 10, angle = 0;
+    bool remove = args->argc >= 1 && strcmp(args->argv[0], "del") == 0;
+    if (args->argc < 1 || args->argc > 3 || (!remove && !command_arg_u32(args, 0, &id)) ||
+        id > 0xFFFF || (args->argc >= 2 && !command_arg_u32(args, 1, &shape)) ||
+        shape >= ZONE_LOC_SHAPES || (args->argc == 3 && !command_arg_u32(args, 2, &angle))) {
+        return false;
+    }
+    if (remove) {
+        zone_update_loc_del(g_zone_updates, &player->position, (u8)shape, (u8)angle);
+    } else {
+        zone_update_loc_add(g_zone_updates, &player->position, (u16)id, (u8)shape, (u8)angle);
+    }
+    return true;
+}
+
+/*
+ * ::instance - Enter a new copy of the caller's mapsquare, same tile
+ *
+ * ::instance leave goes back to the same tile of the base mapsquare; the
+ * last player out destroys the instance.
+ */
+static bool command_instance(Player* player, const CommandArgs* args) {
+    bool leave = args->argc == 1 && strcmp(args->argv[0], "leave") == 0;
+    if (args->argc > 1 || (args->argc == 1 && !leave)) return false;
+
+    Instance* instance = instance_at(g_instances, position_x(&player->position), position_z(&player->position));
+    Position to;
+    if (leave) {
+        if (!instance) {
+            send_player_message(player, "You are not in an instance.");
+            return true;
+        }
+        instance_base_position(instance, &player->position, &to);
+
+        /* Anyone else still inside keeps it alive */
+        u16 near[MAX_PLAYERS];
+        u32 count = zone_grid_query(g_world->zone_grid, instance->region_x * 64u + 32,
+                                    instance->region_z * 64u + 32, 31, near, MAX_PLAYERS);
+        bool alone = true;
+        for (u32 i = 0; i < count && alone; i++) {
+            const Player* other = player_list_get(g_world->player_list, near[i]);
+            alone = !other || other == player ||
+                    instance_at(g_instances, position_x(&other->position), position_z(&other->position)) != instance;
+        }
+        if (alone) instance_destroy(g_instances, instance);
+    } else {
+        if (instance) {
+            send_player_message(player, "You are already in an instance.");
+            return true;
+        }
+        instance = instance_create(g_instances, position_get_mapsquare_x(&player->position), position_get_mapsquare_z(&player->position));
+        if (!instance) {
+            send_player_message(player, "This area cannot be instanced.");
+            return true;
+        }
+        instance_position(instance, &player->position, &to);
+    }
+
+    player_set_position(player, position_x(&to), position_z(&to), position_height(&to));
+    map_send_load_area(player, position_get_mapsquare_x(&player->position),
+                       position_get_mapsquare_z(&player->position));
+    return true;
+}
+
+static bool command_profile(Player* player, const CommandArgs* args) {
+    if (args->argc != 1) return false;
+    const char* arg = args->argv[0];
+    if (strcmp(arg, "on") == 0) {
+        packet_profile_set(true, g_server->tick_count);
+        send_player_message(player, "Packet profiling on.");
+    } else if (strcmp(arg, "off") == 0) {
+        packet_profile_set(false, g_server->tick_count);
+        send_player_message(player, "Packet profiling off.");
+    } else if (strcmp(arg, "dump") == 0 && g_packet_profile.enabled) {
+        packet_profile_dump(g_server->tick_count);
+        send_player_message(player, "Packet profile written to the server log.");
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool command_top(Player* player, const CommandArgs* args) {
+    if (args->argc > 1) return false;
+    TrafficCounter counter = TRAFFIC_BYTES_OUT;
+    if (args->argc == 1 && !traffic_counter_parse(args->argv[0], &counter)) return false;
+    
+    if (!g_traffic.reported) {
+        send_player_message(player, "No traffic report yet, one comes every minute.");
+        return true;
+    }
+    char line[128];
+    snprintf(line, sizeof(line), "Top %s, ticks %llu-%llu, %u connections:",
+             traffic_counter_name(counter), (unsigned long long)g_traffic.report_start,
+             (unsigned long long)g_traffic.report_end, g_traffic.report_connections);
+    send_player_message(player, line);
+    for (u32 rank = 0; traffic_describe(counter, rank, line, sizeof(line)); rank++) {
+        send_player_message(player, line);
+    }
+    if (g_traffic.top_count[counter] == 0) send_player_message(player, "Nobody.");
+    return true;
+}
+
+static bool command_cluster(Player* player, const CommandArgs* args) {
+    if (args->argc != 0) return false;
+    if (!g_cluster) {
+        send_player_message(player, "This server is not a cluster node.");
+        return true;
+    }
+    char line[128];
+    snprintf(line, sizeof(line), "Node %u of %u. Square (%u, %u) is node %u's.", g_cluster->node,
+             g_cluster->nodes, position_get_mapsquare_x(&player->position),
+             position_get_mapsquare_z(&player->position), cluster_owner(g_cluster, &player->position));
+    send_player_message(player, line);
+    snprintf(line, sizeof(line), "Ghosts here: %u. Ghost frames: %llu sent, %llu dropped.",
+             g_cluster->ghost_count, (unsigned long long)g_cluster->ghost_frames_sent,
+             (unsigned long long)g_cluster->ghost_frames_dropped);
+    send_player_message(player, line);
+    snprintf(line, sizeof(line), "Handoffs: %llu out, %llu in, %llu failed.",
+             (unsigned long long)g_cluster->handoffs_out, (unsigned long long)g_cluster->handoffs_in,
+             (unsigned long long)g_cluster->handoffs_failed);
+    send_player_message(player, line);
+    return true;
+}
+
+static bool command_trace(Player* player, const CommandArgs* args) {
+    if (args->argc != 1) return false;
+    const char* arg = args->argv[0];
+    if (strcmp(arg, "on") == 0) {
+        trace_set(true);
+        send_player_message(player, "Tracing on.");
+    } else if (strcmp(arg, "off") == 0) {
+        trace_set(false);
+        send_player_message(player, "Tracing off.");
+    } else if (strcmp(arg, "dump") == 0) {
+        trace_request_dump();
+        send_player_message(player, "Trace will be written after this tick.");
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool command_mem(Player* player, const CommandArgs* args) {
+    if (args->argc != 0) return false;
+    char line[96];
+    u64 total = 0;
+    for (u32 t = 0; t < MEM_TAG_COUNT; t++) {
+        u64 live = mem_stats_live((MemTag)t);
+        total += live;
+        snprintf(line, sizeof(line), "%s: %.1f MB (peak %.1f MB)", mem_tag_name((MemTag)t),
+                 live / 1048576.0, mem_stats_peak((MemTag)t) / 1048576.0);
+        send_player_message(player, line);
+    }
+    snprintf(line, sizeof(line), "Tagged %.1f MB of %.1f MB resident.", total / 1048576.0,
+             mem_stats_rss() / 1048576.0);
+    send_player_message(player, line);
+    return true;
+}
+
+static bool command_yell(Player* player, const CommandArgs* args) {
+    if (!args->rest[0]) return false;
+    char line[256];
+    snprintf(line, sizeof(line), "%s: %s", player->username, args->rest);
+    if (g_chat_filter) chat_filter_apply(g_chat_filter, line);
+    broadcast_message_world(g_world, line);
+    return true;
+}
+
+static bool command_find(Player* player, const CommandArgs* args) {
+    if (!args->rest[0]) return false;
+    i32 world = presence_find(args->rest);
+    char line[96];
+    if (world < 0) {
+        snprintf(line, sizeof(line), "%.12s is offline.", args->rest);
+    } else if ((u32)world == g_world_id) {
+        snprintf(line, sizeof(line), "%.12s is online on this world.", args->rest);
+    } else {
+        snprintf(line, sizeof(line), "%.12s is online on world %d.", args->rest, world + 1);
+    }
+    send_player_message(player, line);
+    return true;
+}
+
+static bool command_reloadmaps(Player* player, const CommandArgs* args) {
+    if (args->argc != 0) return false;
+    if (asset_reload_start(&g_server->reload, player->username)) {
+        send_player_message(player, "Reloading maps in the background...");
+    } else {
+        send_player_message(player, "A map reload is already running or unavailable.");
+    }
+    return true;
+}
+
+static bool command_reloadscripts(Player* player, const CommandArgs* args) {
+    if (args->argc != 0) return false;
+    ScriptProgram* program = script_load(SCRIPT_SOURCE_DIR, SCRIPT_PROGRAM_PATH);
+    if (!program) {
+        send_player_message(player, "Scripts did not compile, see the server log.");
+        return true;
+    }
+    if (g_scripts) {
+        script_runtime_swap(g_scripts, program);
+    } else {
+        g_scripts = script_runtime_create(program);
+        if (!g_scripts) return true;
+    }
+    server_register_script_commands();
+
+    char line[96];
+    snprintf(line, sizeof(line), "Scripts reloaded: %u triggers, %u code words.",
+             program->trigger_count, program->code_words);
+    send_player_message(player, line);
+    return true;
+}
+
+/*
+ * command_script - Every [command,<name>] trigger's handler
+ *
+ * The arguments must be numbers; they start the script in r0, r1, ...
+ */
+static bool command_script(Player* player, const CommandArgs* args) {
+    i32 values[COMMAND_MAX_ARGS];
+    for (u32 i = 0; i < args->argc; i++) {
+        char* end;
+        long value = strtol(args->argv[i], &end, 10);
+        if (end == args->argv[i] || *end) return false;
+        values[i] = (i32)value;
+    }
+    if (!script_trigger(g_scripts, player, SCRIPT_TRIGGER_COMMAND, 0, args->name, values,
+                        args->argc)) {
+        send_player_message(player, "No script handles that command any more.");
+    }
+    return true;
+}
+
+/*
+ * server_register_script_commands - Register new [command,...] triggers
+ *
+ * The registry keeps name pointers, and a reload frees the program, so
+ * names are copied here. Commands whose script a reload removed stay
+ * registered and say so when used.
+ */
+static void server_register_script_commands(void) {
+    static char names[COMMAND_MAX][SCRIPT_NAME_MAX];
+    static u32 name_count = 0;
+    const ScriptProgram* program = g_scripts ? g_scripts->program : NULL;
+
+    for (u32 t = 0; program && t < program->trigger_count; t++) {
+        const ScriptTrigger* trigger = &program->triggers[t];
+        if (trigger->kind != SCRIPT_TRIGGER_COMMAND) continue;
+        bool known = false;
+        for (u32 i = 0; i < name_count && !known; i++) known = strcmp(names[i], trigger->name) == 0;
+        if (known) continue;
+        if (name_count == COMMAND_MAX) break;
+
+        memcpy(names[name_count], trigger->name, SCRIPT_NAME_MAX);
+        CommandDef def = { names[name_count], command_script, PLAYER_RIGHTS_ADMIN, 0,
+                           "Usage: the arguments of a script command are numbers" };
+        if (command_register(&def)) {
+            name_count++;
+        } else {
+            fprintf(stderr, "WARNING: Script command ::%s not registered (name taken or "
+                            "registry full)\n", trigger->name);
+        }
+    }
+}
+
+static void server_register_commands(void) {
+    static const CommandDef defs[] = {
+        { "tele",    command_tele,    PLAYER_RIGHTS_ADMIN, 0, "Usage: ::tele <x> <z> <height>" },
+        { "item",    command_item,    PLAYER_RIGHTS_ADMIN, 0, "Usage: ::item <id> [amount]" },
+        { "profile", command_profile, PLAYER_RIGHTS_ADMIN, 0, "Usage: ::profile on|off|dump" },
+        { "top", command_top, PLAYER_RIGHTS_ADMIN, 0, "Usage: ::top [in|out|packets|map|info|cpu]" },
+        { "trace",   command_trace,   PLAYER_RIGHTS_ADMIN, 0, "Usage: ::trace on|off|dump" },
+        { "mem",     command_mem,     PLAYER_RIGHTS_ADMIN, 0, "Usage: ::mem" },
+        { "yell",    command_yell,    PLAYER_RIGHTS_NONE,  5, "Usage: ::yell <text>" },
+        { "find",    command_find,    PLAYER_RIGHTS_NONE,  2, "Usage: ::find <name>" },
+        { "reloadmaps", command_reloadmaps, PLAYER_RIGHTS_ADMIN, 0, "Usage: ::reloadmaps" },
+        { "reloadscripts", command_reloadscripts, PLAYER_RIGHTS_ADMIN, 0, "Usage: ::reloadscripts" },
+        { "gfx",     command_gfx,     PLAYER_RIGHTS_ADMIN, 0, "Usage: ::gfx <spotanim> [height]" },
+        { "proj",    command_proj,    PLAYER_RIGHTS_ADMIN, 0, "Usage: ::proj <spotanim> <x> <z>" },
+        { "loc",     command_loc,     PLAYER_RIGHTS_ADMIN, 0, "Usage: ::loc <id>|del [shape] [angle]" },
+        { "instance", command_instance, PLAYER_RIGHTS_ADMIN, 0, "Usage: ::instance [leave]" },
+        { "cluster", command_cluster, PLAYER_RIGHTS_ADMIN, 0, "Usage: ::cluster" },
+    };
+    for (u32 i = 0; i < sizeof(defs) / sizeof(defs[0]); i++) command_register(&defs[i]);
+}
+
+/*
+ * EVENT SUBSCRIBERS
+ *
+ * Extensions that react to hooks.h events rather than being called from
+ * the code that fires them. A plugin adds its hook_add_*() calls to
+ * server_register_hooks(); server_init() freezes the tables right after.
+ */
+static void server_script_login(void* ctx, Player* player) {
+    (void)ctx;
+    script_trigger(g_scripts, player, SCRIPT_TRIGGER_LOGIN, 0, NULL, NULL, 0);
+}
+
+static void server_combat_logout(void* ctx, Player* player) {
+    (void)ctx;
+    combat_remove(g_combat, COMBAT_PLAYER(player->index));
+}
+
+static void server_shop_logout(void* ctx, Player* player) {
+    (void)ctx;
+    shop_close(g_shops, player);
+}
+
+static void server_register_hooks(void) {
+    /* [login] scripts (script.h) */
+    hook_add_login(server_script_login, NULL);
+    
+    /* A player leaving ends their fights and voids hits aimed at them */
+    hook_add_logout(server_combat_logout, NULL);
+    
+    /* ...and stops the shop they had open sending to their index */
+    hook_add_logout(server_shop_logout, NULL);
+}
+
 /*
  * server_handle_command - Process player-typed command
  * 
@@ -1190,94 +3099,31 @@ static void server_handle_movement_packet(Player* player, StreamBuffer* buf, u32
  * @param packet_length  String length
  * 
  * COMMAND FORMAT:
- *   Commands start with "::" prefix (e.g., "::tele 3200 3200 0")
- *   Sent as VAR_BYTE packet (opcode 158)
- *   Payload is raw ASCII string (not null-terminated!)
- * 
- * PARSING:
- *   Read packet_length bytes into char array
- *   Null-terminate manually (buffer_read_byte doesn't do this)
- *   Use sscanf() or strcmp() to parse command and arguments
- * 
- * IMPLEMENTED COMMANDS:
+ *   Commands are typed with a "::" prefix (e.g., "::tele 3200 3200 0")
+ *   Sent as CLIENT_CHEAT (opcode 4, VAR_BYTE) with the "::" stripped
+ *   Payload is a newline-terminated string: "tele 3200 3200 0\n"
  * 
- *   ::tele <x> <z> <height>
- *     Teleport player to coordinates
- *     Example: ::tele 3200 3200 0
- *     Sends map region update after teleport
- *   
- *   Future commands:
- *     ::item <id> <amount>  - Spawn item
- *     ::npc <id>            - Spawn NPC
- *     ::god                 - Toggle invincibility
- * 
- * ARGUMENT PARSING:
- *   sscanf(args, "%u %u %u", &x, &z, &height)
- *     Returns number of successfully parsed arguments
- *     Check return value to validate input
- *     
- *   Example:
- *     Input: "3200 3200 0"
- *     Return: 3 (success)
- *     x=3200, z=3200, height=0
- *     
- *     Input: "3200 abc 0"
- *     Return: 1 (failure, only x parsed)
- * 
- * REGION UPDATE:
- *   After teleport, must send new map region:
- *     region_x = position_get_region_x(&player->position)
- *     region_y = position_get_region_z(&player->position)
- *     map_send_load_area(player, region_x, region_y)
- *   
- *   This loads terrain and objects for new area
- *   Without it, player sees black void or old map
+ * The line is copied onto the stack and handed to command_dispatch(),
+ * which finds the command by hash and checks rights and cooldown before
+ * anything is parsed (command.h).
  * 
- * COMPLEXITY: O(N) where N = command length (typically <50 chars)
+ * COMPLEXITY: O(N) where N = command length (at most 255 bytes)
  */
 static void server_handle_command(Player* player, StreamBuffer* buf, u32 packet_length) {
-    if (packet_length < 1) return;
+    if (packet_length < 1 || !buffer_require(buf, packet_length)) return;
     
     /* Debug: Print raw bytes (useful for protocol analysis) */
-    printf("Command packet from %s, length=%u, raw bytes: ", player->username, packet_length);
-    for (u32 i = 0; i < packet_length && i < 20; i++) {
-        printf("%02X ", buf->data[buf->position + i]);
-    }
-    printf("\n");
+    LOG_HEX(LOG_PACKET, "command", buf->data + buf->position, packet_length < 20 ? packet_length : 20);
     
     /* Read command string from buffer */
     char message[256];
-    u32 pos = 0;
-    
-    while (pos < packet_length && pos < sizeof(message) - 1) {
-        message[pos] = buffer_read_byte(buf, false);
-        pos++;
-    }
+    u32 pos = packet_length < sizeof(message) - 1 ? packet_length : (u32)sizeof(message) - 1;
+    buffer_get_bytes(buf, (u8*)message, pos);
+    if (pos > 0 && message[pos - 1] == '\n') pos--;
     message[pos] = '\0';  /* Null-terminate string */
     
-    printf("Command from %s: '%s'\n", player->username, message);
-    
-    /* Parse and execute teleport command */
-    if (strncmp(message, "::tele ", 7) == 0 || strncmp(message, "tele ", 5) == 0) {
-        /* Find start of arguments (after "tele ") */
-        const char* args = strstr(message, "tele ") + 5;
-        u32 x = 0, z = 0, height = 0;
-        
-        /* Parse three unsigned integers */
-        if (sscanf(args, "%u %u %u", &x, &z, &height) == 3) {
-            printf("Teleporting %s to (%u, %u, %u)\n", player->username, x, z, height);
-            
-            /* Update player position */
-            player_set_position(player, x, z, height);
-            
-            /* Send new map region to client */
-            i32 mapsquare_x = position_get_mapsquare_x(&player->position);
-            i32 mapsquare_z = position_get_mapsquare_z(&player->position);
-            map_send_load_area(player, mapsquare_x, mapsquare_z);
-        } else {
-            /* Invalid arguments - send usage message */
-            send_player_message(player, "Usage: ::tele <x> <z> <height>");
-        }
+    if (!command_dispatch(player, message, g_server->tick_count)) {
+        LOG_DEBUG("Command from %s not run: '%s'\n", player->username, message);
     }
 }
 
@@ -1342,40 +3188,32 @@ static void server_handle_command(Player* player, StreamBuffer* buf, u32 packet_
  * COMPLEXITY: O(1) time (fixed-size packet)
  */
 static void server_handle_player_design(Player* player, StreamBuffer* buf) {
-    i32 gender = buffer_read_byte(buf, true);
-    i32 identikits[7];
-    for (int i = 0; i < 7; i++) {
-        identikits[i] = buffer_read_byte(buf, true);
-    }
-    i32 colors[5];
-    for (int i = 0; i < 5; i++) {
-        colors[i] = buffer_read_byte(buf, false);
-    }
+    /* [gender:1][identikits:7][colors:5], checked once */
+    PlayerDesignPacket design;
+    if (!decode_player_design(buf, &design)) return;
 
-    printf("IF_PLAYERDESIGN: gender=%d idkit=[%d,%d,%d,%d,%d,%d,%d] colors=[%d,%d,%d,%d,%d]\n", 
-           gender, identikits[0], identikits[1], identikits[2], identikits[3], identikits[4], identikits[5], identikits[6],
-           colors[0], colors[1], colors[2], colors[3], colors[4]);
+    LOG_INFO("IF_PLAYERDESIGN: gender=%d idkit=[%d,%d,%d,%d,%d,%d,%d] colors=[%d,%d,%d,%d,%d]\n",
+             design.gender, design.identikits[0], design.identikits[1], design.identikits[2],
+             design.identikits[3], design.identikits[4], design.identikits[5], design.identikits[6],
+             design.colors[0], design.colors[1], design.colors[2], design.colors[3], design.colors[4]);
     
     if (!player->allow_design) {
-        printf("WARNING: IF_PLAYERDESIGN rejected - allow_design is false\n");
+        LOG_WARN("WARNING: IF_PLAYERDESIGN rejected - allow_design is false\n");
         return;
     }
     
-    player->gender = (u8)gender;
-    for (int i = 0; i < 7; i++) {
-        player->body[i] = (i8)identikits[i];
-    }
-    for (int i = 0; i < 5; i++) {
-        player->colors[i] = (u8)colors[i];
-    }
+    player->gender = (u8)design.gender;
+    memcpy(player->body, design.identikits, sizeof(design.identikits));
+    memcpy(player->colors, design.colors, sizeof(design.colors));
     
     player->design_complete = true;
-    player->update_flags |= UPDATE_APPEARANCE;
+    player->save_dirty = true;
+    player_appearance_changed(player);
 
-    printf("Player design saved: gender=%d body=[%d,%d,%d,%d,%d,%d,%d] colors=[%d,%d,%d,%d,%d]\n",
-           player->gender, player->body[0], player->body[1], player->body[2], player->body[3],
-           player->body[4], player->body[5], player->body[6],
-           player->colors[0], player->colors[1], player->colors[2], player->colors[3], player->colors[4]);
+    LOG_INFO("Player design saved: gender=%d body=[%d,%d,%d,%d,%d,%d,%d] colors=[%d,%d,%d,%d,%d]\n",
+             player->gender, player->body[0], player->body[1], player->body[2], player->body[3],
+             player->body[4], player->body[5], player->body[6],
+             player->colors[0], player->colors[1], player->colors[2], player->colors[3], player->colors[4]);
 }
 
 /*
@@ -1391,20 +3229,22 @@ static void server_handle_player_design(Player* player, StreamBuffer* buf) {
  * on the character design screen.
  */
 static void server_handle_if_button(Player* player, StreamBuffer* buf) {
-    u16 component_id = buffer_read_short(buf, false, BYTE_ORDER_BIG);
+    IfButtonPacket button;
+    if (!decode_if_button(buf, &button)) return;
+    u16 component_id = button.component;
     
-    printf("IF_BUTTON: player='%s' component=%u design_complete=%d\n", 
-           player->username, component_id, player->design_complete);
+    LOG_INFO("IF_BUTTON: player='%s' component=%u design_complete=%d\n",
+             player->username, component_id, player->design_complete);
     
     /* Handle logout button (component 2458) */
     if (component_id == 2458) {
-        printf("Logout button clicked by player '%s'\n", player->username);
+        LOG_INFO("Logout button clicked by player '%s'\n", player->username);
         
         /* Save player data */
         if (player->username[0] != '\0') {
-            printf("Saving player '%s' before logout...\n", player->username);
+            LOG_INFO("Saving player '%s' before logout...\n", player->username);
             if (!player_save(player)) {
-                printf("WARNING: Failed to save player '%s'\n", player->username);
+                LOG_WARN("WARNING: Failed to save player '%s'\n", player->username);
             }
         }
         
@@ -1412,22 +3252,30 @@ static void server_handle_if_button(Player* player, StreamBuffer* buf) {
         send_logout(player);
         
         /* Disconnect player */
-        printf("Player '%s' logged out via logout button\n", player->username);
+        LOG_INFO("Player '%s' logged out via logout button\n", player->username);
         player_disconnect(player);
         
         return;
     }
     
+    /* A [button,<component>] script, with the component in r0 */
+    i32 component_arg = component_id;
+    if (script_trigger(g_scripts, player, SCRIPT_TRIGGER_BUTTON, component_id, NULL, &component_arg, 1)) {
+        return;
+    }
+    
     if (player->design_complete) {
         player->allow_design = false;
-        player->update_flags |= UPDATE_APPEARANCE;
+        player_appearance_changed(player);
         
         send_if_close(player);
         send_interfaces(player);
         
-        player_save(player);
+        if (player_save(player)) {
+            player->save_dirty = false;
+        }
         
-        printf("Closed design interface - player now in game world\n");
+        LOG_INFO("Closed design interface - player now in game world\n");
     }
 }
 
@@ -1439,11 +3287,8 @@ static void server_handle_if_button(Player* player, StreamBuffer* buf) {
  * INITIALIZATION SEQUENCE:
  *   1. Register player with world (adds to active player list)
  *   2. Send map region (terrain and objects for current area)
- *   3. Send player stats (skills, levels, experience)
- *   4. Send inventory contents
- *   5. Send equipment contents
- *   6. Send interface configurations
- *   7. Send welcome message
+ *   3-7. send_login_burst(): player stats (skills, levels, experience),
+ *        inventory, equipment, interface configurations, welcome message
  * 
  * MAP REGION:
  *   Player's position determines which 104x104 region to load
@@ -1475,7 +3320,7 @@ static void server_handle_if_button(Player* player, StreamBuffer* buf) {
  * COMPLEXITY: O(1) time (fixed number of packets)
  */
 static void server_send_initial_game_packets(Player* player) {
-    printf("Sending initial game packets to player '%s'\n", player->username);
+    LOG_INFO("Sending initial game packets to player '%s'\n", player->username);
 
     /* Register player with world (adds to active list) */
     login_send_initial_packets(player);
@@ -1485,27 +3330,29 @@ static void server_send_initial_game_packets(Player* player) {
     i32 mapsquare_z = position_get_mapsquare_z(&player->position);
     map_send_load_area(player, mapsquare_x, mapsquare_z);
 
-    /* Send player state */
-    send_player_stats(player);      /* Skills and levels */
-    send_inventory(player);         /* Inventory items */
-    send_equipment(player);         /* Equipped items */
-    send_interfaces(player);        /* UI configuration */
+    /*
+     * Stats, inventory, equipment, interfaces, the design screen (new
+     * players only) and the welcome messages: mostly the same bytes for
+     * everyone, copied from templates (send_login_burst)
+     */
+    send_login_burst(player);
+
+    /* Friend and ignore lists, with each friend's world */
+    social_player_login(g_social, player);
 
     /* Only open character design for new players */
     if (!player->design_complete) {
-        printf("New player '%s' - opening character design interface\n", player->username);
-        send_if_opentop(player, 3559);
+        LOG_INFO("New player '%s' - opening character design interface\n", player->username);
         player->allow_design = true;
     } else {
-        printf("Existing player '%s' - entering game world\n", player->username);
+        LOG_INFO("Existing player '%s' - entering game world\n", player->username);
         /* Game world is visible by default (no IF_OPENTOP needed) */
     }
 
-    /* Send welcome message */
-    send_player_message(player, "Welcome to RuneScape by JAGeX.");
-    send_player_message(player, "Protocol #225 Written in C (May 2004).");
+    /* Login subscribers ([login] scripts): after everything above */
+    hook_login(player);
 
-    printf("Initial game packets sent to '%s'\n", player->username);
+    LOG_INFO("Initial game packets sent to '%s'\n", player->username);
 }
 
 /*******************************************************************************
@@ -1555,42 +3402,28 @@ Player* server_get_player(GameServer* server, u32 index) {
  * @return        Pointer to free Player, or NULL if server full
  * 
  * ALGORITHM:
- *   Linear search from index 0 to MAX_PLAYERS-1
- *   Return first slot where state == PLAYER_STATE_DISCONNECTED
- *   Return NULL if all slots occupied
+ *   Pop the head of server->free_slots: the slot that has been
+ *   DISCONNECTED the longest. Return NULL if the list is empty.
  * 
- * BEST CASE:
- *   First slot is free -> O(1)
+ * WHY A FREE LIST:
+ *   The old linear search for state == PLAYER_STATE_DISCONNECTED was
+ *   O(1) on an empty server but scanned most of the 2048 slots on a
+ *   busy one - exactly when connections arrive fastest. Popping a free
+ *   list costs the same at any population.
  * 
- * WORST CASE:
- *   Server is full, scan all MAX_PLAYERS slots -> O(N)
+ * WHY LONGEST-FREE FIRST:
+ *   A slot released a moment ago may still have a close in flight on
+ *   the network thread; FIFO order gives it the most time to settle
+ *   before the slot is reused.
  * 
- * AVERAGE CASE:
- *   Server half full, scan MAX_PLAYERS/2 slots -> O(N/2) = O(N)
- * 
- * OPTIMIZATION:
- *   Maintain free-list for O(1) allocation:
- *   
- *   u32 free_slots[MAX_PLAYERS];  // Stack of free indices
- *   u32 free_count = MAX_PLAYERS; // Number of free slots
- *   
- *   Player* server_find_free_slot_optimized(GameServer* server) {
- *       if (free_count == 0) return NULL;
- *       u32 index = free_slots[--free_count];
- *       return &server->players[index];
- *   }
- *   
- *   void server_release_slot(GameServer* server, u32 index) {
- *       free_slots[free_count++] = index;
- *   }
+ * OWNERSHIP:
+ *   The returned slot is taken. player_disconnect() returns it; a caller
+ *   that gives up before connecting it must slotmap_release() it.
  * 
- * COMPLEXITY: O(N) where N = MAX_PLAYERS
+ * COMPLEXITY: O(1)
  */
 Player* server_find_free_slot(GameServer* server) {
-    for (u32 i = 0; i < MAX_PLAYERS; i++) {
-        if (server->players[i].state == PLAYER_STATE_DISCONNECTED) {
-            return &server->players[i];
-        }
-    }
-    return NULL;  /* Server full */
+    u32 slot = slotmap_alloc(server->free_slots);
+    if (slot == SLOTMAP_NONE) return NULL;  /* Server full */
+    return &server->players[slot];
 }
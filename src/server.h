@@ -200,16 +200,41 @@
 #include "types.h"
 #include "player.h"
 #include "network.h"
+#include "netio.h"
+#include "save_queue.h"
+#include "save_cache.h"
+#include "checkpoint.h"
+#include "load_queue.h"
+#include "save_log.h"
+#include "update_pool.h"
+#include "region_shard.h"
+#include "asset_reload.h"
+#include "player_list.h"
+#include "datastruct/slotmap.h"
+
+/*
+ * AUTOSAVE_INTERVAL_TICKS - Ticks between two autosaves of one player
+ *
+ * 500 ticks × 600ms = 5 minutes: the most progress a crash can lose.
+ * The scheduler spreads the slots in use (--max-players + 1) evenly over
+ * the interval (see server_autosave), so every slot comes round once per
+ * interval and the save rate stays flat instead of spiking every five
+ * minutes. Override at build time with -DAUTOSAVE_INTERVAL_TICKS=<ticks>.
+ */
+#ifndef AUTOSAVE_INTERVAL_TICKS
+#define AUTOSAVE_INTERVAL_TICKS 500
+#endif
 
 /*
  * GameServer - Central server state structure
  * 
  * MEMORY LAYOUT:
  * ┌─────────────────────────────────────────────────────────────┐
- * │ GameServer struct (approximately 8MB for 2048 players)      │
+ * │ GameServer struct (approximately 3MB for 2048 players)      │
  * ├─────────────────────────────────────────────────────────────┤
  * │ network:    NetworkServer (socket, port, etc.)              │
  * │ players:    Player[MAX_PLAYERS] (array of player slots)     │
+ * │ connection_pool: SlabPool (I/O of connected slots)          │
  * │ running:    bool (server running flag)                      │
  * │ tick_count: u64 (total ticks since startup)                 │
  * └─────────────────────────────────────────────────────────────┘
@@ -227,6 +252,13 @@
  *   - Each slot can be DISCONNECTED/CONNECTED/LOGGED_IN
  *   - Allows O(1) player lookup by index
  * 
+ * connection_pool (SlabPool):
+ *   - Socket buffers and ISAAC state, one per connected slot, taken by
+ *     player_set_socket() and returned by player_destroy() (player.h,
+ *     CONNECTION POOL)
+ *   - Kept out of Player so tick passes over players[] stay small;
+ *     reached through player->conn; g_connection_pool points here
+ * 
  * running (bool):
  *   - Set to true during initialization
  *   - Checked every iteration of main loop
@@ -237,38 +269,87 @@
  *   - Used for periodic events (e.g., every 100 ticks = 1 minute)
  *   - Wraps after 584 million years at 600ms tick rate
  * 
+ * netio (NetIo):
+ *   - Network I/O thread state (--net-thread), unused by default
+ *   - g_netio points here while the thread is running
+ * 
+ * saves (SaveQueue):
+ *   - Background save writer, started by server_init()
+ *   - g_save_queue points here while the thread is running
+ * 
+ * loads (LoadQueue):
+ *   - Login workers (RSA blocks decrypted and save files read off the
+ *     game thread, --login-threads N), started by server_init();
+ *     g_load_queue points here while they are running
+ * 
+ * updates (UpdatePool):
+ *   - PLAYER_INFO encoding workers (--update-threads N), unused by default
+ *   - g_update_pool points here while the workers are running
+ * 
+ * shards (RegionShards):
+ *   - Movement threads, one per group of mapsquares (--tick-shards N),
+ *     unused by default
+ *   - g_region_shards points here while the threads are running
+ * 
+ * save_log (SaveLog*):
+ *   - Shared append-only save store (--save-log), NULL by default
+ *   - g_save_log points here while it is open
+ * 
+ * autosave_phase (u32):
+ *   - Tick of the autosave interval [0, AUTOSAVE_INTERVAL_TICKS) the
+ *     staggered autosave runs next; it picks that tick's share of slots
+ * 
+ * free_slots (SlotMap*):
+ *   - Free list of slots in PLAYER_STATE_DISCONNECTED: popped by
+ *     server_find_free_slot(), pushed back by player_disconnect()
+ * 
  * SIZE ANALYSIS:
  *   sizeof(NetworkServer)    approximately 64 bytes
- *   sizeof(Player) * 2048    approximately 8MB
+ *   sizeof(Player) * 2048    approximately 2.7MB
+ *   sizeof(PlayerConnection) * connected  approximately 15KB each, in
+ *                            slabs of --conn-slab (not part of the struct)
  *   sizeof(bool)             1 byte
  *   sizeof(u64)              8 bytes
- *   Total:                   approximately 8MB + padding
+ *   Total:                   approximately 3MB + padding
  */
 typedef struct GameServer {
     NetworkServer network;              /* TCP listen socket */
-    Player players[MAX_PLAYERS];        /* Player slot array */
+    Player players[MAX_PLAYERS];        /* Player slot array (hot tick state) */
+    SlabPool connection_pool;           /* Socket buffers and ciphers (connected slots) */
     bool running;                       /* Server running flag */
     u64 tick_count;                     /* Total ticks elapsed */
+    NetIo netio;                        /* Network thread (if started) */
+    SaveQueue saves;                    /* Save writer thread (if started) */
+    SaveCache save_cache;               /* Logout saves for relogs (if started) */
+    Checkpoint checkpoint;              /* World checkpoints for crash recovery */
+    LoadQueue loads;                    /* Login worker threads (if started) */
+    UpdatePool updates;                 /* PLAYER_INFO workers (if started) */
+    RegionShards shards;                /* Movement shard threads (if started) */
+    AssetReload reload;                 /* ::reloadmaps builder (asset_reload.h) */
+    SaveLog* save_log;                  /* Append-only save store (if enabled) */
+    u32 autosave_phase;                 /* Interval tick for server_autosave() */
+    SlotMap* free_slots;                /* DISCONNECTED slots, longest-free first */
+    PlayerSet input_pending;            /* Slots with packets for the next tick (PACKETS phase) */
 } GameServer;
 
 /*
  * server_init - Initialize game server and all subsystems
  * 
  * @param server  Pointer to GameServer structure (caller-allocated)
- * @param port    TCP port to listen on (43594 for production)
+ * @param port    TCP port to listen on (43594 for production), 0 for
+ *                no listening socket (server_replay)
  * @return        true on success, false on failure
  * 
  * INITIALIZATION SEQUENCE:
  * 
  *   1. Zero-initialize server structure (memset)
- *   2. Create world state (regions, tiles, collision)
- *   3. Initialize cache system (load definitions)
- *   4. Initialize item system (definitions, spawns)
- *   5. Initialize NPC system (spawns, AI)
- *   6. Initialize object system (scenery, interactive objects)
- *   7. Initialize player slots (set all to DISCONNECTED)
- *   8. Create TCP listen socket on specified port
- *   9. Set server->running = true
+ *   2. server_load_assets(), unless a supervisor already did:
+ *      cache, maps, collision, definitions, items, NPCs, objects
+ *   3. Create world state (player list, zone grid)
+ *   4. Start the save writer and login workers
+ *   5. Initialize player slots (set all to DISCONNECTED)
+ *   6. Create TCP listen socket on specified port
+ *   7. Set server->running = true
  * 
  * ERROR HANDLING:
  *   If any subsystem fails to initialize, cleanup is performed
@@ -288,6 +369,20 @@ typedef struct GameServer {
  */
 bool server_init(GameServer* server, u16 port);
 
+/*
+ * server_load_assets - Load everything a world only reads
+ *
+ * @return  false if the cache could not be created
+ *
+ * Cache archives, the world snapshot (mapped), map store, collision,
+ * definitions, the chat filter, the command registry and the initial
+ * NPC and object spawns. server_init() calls it when needed; the
+ * --worlds supervisor calls it once before forking, so every world
+ * process shares these pages (supervisor.h). Idempotent until
+ * server_shutdown().
+ */
+bool server_load_assets(void);
+
 /*
  * server_shutdown - Cleanup and deallocate all server resources
  * 
@@ -316,6 +411,112 @@ bool server_init(GameServer* server, u16 port);
  */
 void server_shutdown(GameServer* server);
 
+/*
+ * server_build_snapshot - Write the world snapshot and exit (--build-snapshot)
+ *
+ * @param path  Output file (SNAPSHOT_PATH)
+ * @return      true if the snapshot was written
+ *
+ * Builds from data/ as a first boot would, without binding the port, so
+ * a deploy pipeline can ship the snapshot next to the binary.
+ */
+bool server_build_snapshot(const char* path);
+
+/*
+ * server_replay - Run a recorded log through the tick (--replay, replay.h)
+ * 
+ * @param server  Server initialized with server_init(server, 0)
+ * @param path    Log written by --record
+ * @return        false if the log could not be loaded
+ * 
+ * Runs every recorded tick back to back (no 600 ms wait), then prints
+ * the output digest and tick work percentiles. Output and saves stay
+ * diverted until the process exits; call server_shutdown() afterwards.
+ */
+bool server_replay(GameServer* server, const char* path);
+
+/*
+ * server_autosave - Save the next batch of dirty players
+ * 
+ * @param server  Running server
+ * 
+ * Called once per tick by server_tick(). Visits this tick's share of
+ * the slots in use (g_server_limits.players + 1, spread evenly), so
+ * every slot is visited once per AUTOSAVE_INTERVAL_TICKS. A visited player is saved
+ * only if logged in with save_dirty set; the write itself goes through
+ * the background save writer.
+ * 
+ * COMPLEXITY: O(slots / AUTOSAVE_INTERVAL_TICKS) per tick, rounded up
+ */
+void server_autosave(GameServer* server);
+
+/*
+ * server_listen_websocket - Accept browser clients on a WebSocket port
+ * 
+ * @param server  Initialized GameServer (before server_start_net_thread)
+ * @param port    TCP port for WebSocket connections
+ * @return        false if the port could not be opened
+ * 
+ * Connections from it get the same slots, login and packets as the game
+ * port, framed as WebSocket binary messages at the socket edge (see
+ * websocket.h). Works with and without the network thread.
+ */
+bool server_listen_websocket(GameServer* server, u16 port);
+
+/*
+ * server_start_net_thread - Hand socket I/O to a dedicated network thread
+ * 
+ * @param server  Initialized GameServer (before server_run)
+ * @return        true if the thread started; false leaves the server on
+ *                the single-threaded event loop
+ * 
+ * THREADED LOOP:
+ *   The network thread accepts, reads, frames and writes; server_run()
+ *   then only ticks, dispatches decoded packets from the per-connection
+ *   rings and queues output (see netio.h). Packet handlers, login and
+ *   world processing still run on the game thread only.
+ */
+bool server_start_net_thread(GameServer* server);
+
+/*
+ * server_start_update_pool - Encode PLAYER_INFO packets on several threads
+ * 
+ * @param server   Initialized GameServer (before server_run)
+ * @param threads  Total encoding threads, including the game thread
+ * @return         true if the workers started; false leaves phase 2 of
+ *                 world_process() serial
+ * 
+ * Only packet encoding moves to the workers; commits and flushes stay on
+ * the game thread (see update_pool.h).
+ */
+bool server_start_update_pool(GameServer* server, u32 threads);
+
+/*
+ * server_start_region_shards - Move players on several threads, by mapsquare
+ * 
+ * @param server  Initialized GameServer (before server_run)
+ * @param shards  Shards including the game thread
+ * @return        true if the shard threads started; false leaves phase 1
+ *                of world_process() serial
+ * 
+ * Only the steps move to the shards; map reloads, the zone grid and NPC
+ * wake-ups stay on the game thread (see region_shard.h).
+ */
+bool server_start_region_shards(GameServer* server, u32 shards);
+
+/*
+ * server_open_save_log - Store saves in one append-only log (save_log.h)
+ * 
+ * @param server  Initialized GameServer (before server_run)
+ * @param path    Log file (SAVE_LOG_PATH)
+ * @return        true if the log is open; false leaves saves as one
+ *                file per player
+ * 
+ * Players without a record in the log still load from their .sav file
+ * and move into the log with their next save.
+ */
+bool server_open_save_log(GameServer* server, const char* path);
+
 /*
  * server_run - Main event loop (runs until shutdown)
  * 
@@ -324,8 +525,9 @@ void server_shutdown(GameServer* server);
  * MAIN LOOP STRUCTURE:
  * 
  *   while (server->running) {
- *       // 1. Check if 600ms elapsed since last tick
- *       if (elapsed >= TICK_RATE_MS) {
+ *       // 1. Tick once the next deadline has passed; the deadline
+ *       //    then advances by exactly TICK_RATE_MS (see TickCatchup)
+ *       if (now >= next_tick) {
  *           server_tick(server);  // Process game tick
  *       }
  *       
@@ -386,7 +588,9 @@ void server_run(GameServer* server);
  * TICK BUDGET:
  *   Must complete within 600ms to maintain tick rate
  *   Target: <300ms for safety margin
- *   Monitoring: Should log slow ticks for optimization
+ *   Monitoring: every phase is timed (tick_stats.h); a tick over the
+ *   target logs a warning with its phase breakdown, and p50/p99/max
+ *   per phase are reported every 100 ticks
  * 
  * COMPLEXITY: O(N * M) where:
  *   N = number of players
@@ -395,22 +599,23 @@ void server_run(GameServer* server);
 void server_tick(GameServer* server);
 
 /*
- * server_process_connections - Accept pending connection (non-blocking)
+ * server_process_connections - Accept all pending connections (non-blocking)
  * 
  * @param server  Pointer to GameServer
  * 
- * ALGORITHM:
+ * ALGORITHM (repeated until accept() would block):
  *   1. Call network_accept_connection (non-blocking)
- *   2. If no pending connection, return immediately
+ *   2. If no pending connection, return
  *   3. Find free player slot (server_find_free_slot)
- *   4. If server full, close socket and return
- *   5. Assign socket to player slot
- *   6. Begin login handshake (login_process_connection)
+ *   4. If server full, close socket and try the next one
+ *   5. Register socket with the event backend (token = slot index)
+ *   6. Assign socket to player slot
+ *   7. Begin login handshake (login_process_connection)
  * 
  * NON-BLOCKING BEHAVIOR:
- *   - Returns immediately if no connection pending
+ *   - Returns as soon as the accept backlog is empty
  *   - Never blocks main loop
- *   - Accepts at most one connection per call
+ *   - Drains the whole backlog (a login rush is accepted in one wakeup)
  * 
  * CAPACITY HANDLING:
  *   When server is full (all slots occupied):
@@ -418,7 +623,7 @@ void server_tick(GameServer* server);
  *   - Client sees "Server is full" or connection reset
  *   - No data is sent (immediate FIN/RST)
  * 
- * COMPLEXITY: O(N) where N = MAX_PLAYERS (due to find_free_slot)
+ * COMPLEXITY: O(1) per accepted connection (free slot list)
  *             Optimization possible with free-list
  */
 void server_process_connections(GameServer* server);
@@ -434,7 +639,8 @@ void server_process_connections(GameServer* server);
  *     2. Try to recv() data (non-blocking)
  *     3. Append to input buffer
  *     4. If player is logging in, process login packet
- *     5. If player is logged in, parse and dispatch game packets
+ *     5. If player is logged in, list the slot in input_pending: its
+ *        game packets are parsed and dispatched by the next tick
  *     6. If recv() returns 0, player disconnected
  * 
  * PACKET PARSING:
@@ -449,9 +655,9 @@ void server_process_connections(GameServer* server);
  *      - VAR_SHORT (-2): next 2 bytes are payload length
  *   3. Check if full packet received (buffer size >= header + length)
  *   4. If incomplete, break and wait for more data
- *   5. Extract packet payload into StreamBuffer
+ *   5. Wrap packet payload in a zero-copy StreamBuffer view
  *   6. Dispatch to handler (server_handle_packet)
- *   7. Remove packet from input buffer (memmove remaining data)
+ *   7. Consume packet by advancing the read index (in_read)
  *   8. Repeat until buffer empty
  * 
  * PARTIAL PACKET HANDLING:
@@ -467,6 +673,9 @@ void server_process_connections(GameServer* server);
  *     in_buffer_size = 15
  *     packet_length = 15
  *     15 == 15, process packet!
+ *   
+ *   The opcode decoded in iteration 1 is kept in player->conn->in_opcode, so
+ *   the ISAAC cipher is advanced exactly once for the packet.
  * 
  * COMPLEXITY: O(N * P) where:
  *   N = number of players
@@ -474,6 +683,86 @@ void server_process_connections(GameServer* server);
  */
 void server_process_packets(GameServer* server);
 
+/*
+ * server_process_player_input - Read one player's input
+ * 
+ * @param player  Player slot whose socket is readable
+ * 
+ * The per-slot body of server_process_packets(). The event loop calls it
+ * only for sockets network_wait() reported ready, instead of trying
+ * recv() on every slot. Disconnects the player if the peer closed.
+ * 
+ * Login bytes are handled at once. Game packets stay in in_buffer until
+ * the tick's PACKETS phase; a full buffer stops reading until then.
+ * 
+ * COMPLEXITY: O(B) where B = bytes received
+ */
+void server_process_player_input(Player* player);
+
+/*
+ * server_process_net_records - Dispatch input queued by the network thread
+ * 
+ * @param server  Pointer to GameServer (network thread running)
+ * 
+ * Threaded counterpart of server_process_connections() plus
+ * server_process_player_input():
+ *   1. Adopt connections accepted by the network thread (CONNECT events)
+ *   2. For each connected slot, drain its inbound ring:
+ *        RAW     → append to in_buffer and run the login handshake
+ *        PACKET  → stop: list the slot in input_pending; the tick's
+ *                  PACKETS phase hands it to server_handle_packet()
+ *        CLOSED  → player_disconnect()
+ * 
+ * COMPLEXITY: O(N + P) where N = MAX_PLAYERS, P = records queued
+ */
+void server_process_net_records(GameServer* server);
+
+/*
+ * server_finish_logins - Complete logins the login workers have served
+ * 
+ * @param server  Running server
+ * 
+ * Called by server_run() on every loop pass. For each finished login:
+ * login_accept() (credentials, ISAAC seeds), login_complete() (response
+ * code, save applied, LOGGED_IN), then the initial game packets. A block
+ * that did not decode disconnects its client. Results for slots that
+ * disconnected meanwhile are dropped (see LoadJob.ticket).
+ */
+void server_finish_logins(GameServer* server);
+
+/*
+ * server_flush_outputs - Write every player's queued packets to its socket
+ * 
+ * @param server  Pointer to GameServer
+ * 
+ * Packet senders only queue bytes in the player's output arena (see
+ * player_out_commit). This flushes each connection with one send(), so a
+ * tick's PLAYER_INFO plus any replies to input, or a whole login burst
+ * of ~60 packets, costs one syscall instead of one per packet.
+ * 
+ * Players whose socket fails, or whose unsent backlog exceeds
+ * PLAYER_OUT_BACKLOG_LIMIT, are disconnected.
+ * 
+ * COMPLEXITY: O(N + B) where N = MAX_PLAYERS, B = bytes queued
+ */
+void server_flush_outputs(GameServer* server);
+
+/*
+ * server_check_send_queues - Once per tick: watermarks and slow consumers
+ * 
+ * @param server  Pointer to GameServer
+ * 
+ * Runs player_out_watermark() on every connection with what the last
+ * flush left unsent, disconnects the slow consumers it reports, and
+ * publishes the queue depths (metrics_publish_output). Called before the
+ * tick starts, so a congested connection's PLAYER_INFO and map chunks
+ * are thinned in that same tick, and a dropped one is recorded (replay.h)
+ * ahead of it.
+ * 
+ * COMPLEXITY: O(N) where N = MAX_PLAYERS
+ */
+void server_check_send_queues(GameServer* server);
+
 /*
  * server_process_players - Process all player logic
  * 
@@ -507,6 +796,21 @@ void server_process_players(GameServer* server);
  */
 Player* server_get_player(GameServer* server, u32 index);
 
+/*
+ * server_attach_socket - Give a connected socket a free slot
+ * 
+ * @param server     Pointer to GameServer
+ * @param client_fd  Socket (accepted, or handed over by another node)
+ * @return           The slot, CONNECTED and watched; NULL if none was free
+ *                   (the socket is closed then)
+ * 
+ * The first half of accepting a connection; the caller starts the login,
+ * or restores a player handed off by another cluster node (cluster.h).
+ * 
+ * COMPLEXITY: O(1)
+ */
+Player* server_attach_socket(GameServer* server, i32 client_fd);
+
 /*
  * server_find_free_slot - Find first available player slot
  * 
@@ -514,18 +818,12 @@ Player* server_get_player(GameServer* server, u32 index);
  * @return        Pointer to free Player slot, or NULL if server full
  * 
  * ALGORITHM:
- *   Linear search from index 0 to MAX_PLAYERS-1
- *   Return first slot where state == PLAYER_STATE_DISCONNECTED
- * 
- * OPTIMIZATION OPPORTUNITY:
- *   Could maintain a free-list for O(1) allocation:
- *   - Keep stack of free indices
- *   - Push on disconnect, pop on connect
- *   - Trade memory for speed (extra 2048 * 4 = 8KB)
+ *   Pop the slot that has been free the longest from server->free_slots
+ *   (datastruct/slotmap.h). The slot is taken: it must either be
+ *   connected or handed back with slotmap_release().
+ *   player_disconnect() hands slots back.
  * 
- * COMPLEXITY: O(N) where N = MAX_PLAYERS
- *             Worst case: server is full, scans all 2048 slots
- *             Average case: O(1) when server is not full
+ * COMPLEXITY: O(1), however full the server is
  */
 Player* server_find_free_slot(GameServer* server);
 
@@ -553,4 +851,94 @@ Player* server_find_free_slot(GameServer* server);
  */
 extern GameServer* g_server;
 
+/*
+ * TickCatchup - What server_run() does when it falls a whole period behind
+ * 
+ * The loop keeps a deadline grid: tick N is due at start + N * 600 ms,
+ * and each deadline is the previous one plus exactly TICK_RATE_MS. A tick
+ * that runs long (or a stalled host) can leave the loop past one or more
+ * deadlines:
+ * 
+ *   deadlines:  0      600    1200   1800   2400
+ *   ticks:      [──── 1500 ms tick ────]  ↑ now = 1550
+ *                                         1200 missed, 1800 next
+ * 
+ *   TICK_CATCHUP_SKIP   Missed deadlines are dropped; the next tick is
+ *                       the next deadline on the grid (1800). Game time
+ *                       loses the missed ticks, players see one stall.
+ *                       The default: never bursts work onto a server
+ *                       that is already overloaded.
+ * 
+ *   TICK_CATCHUP_BURST  Missed ticks run back to back (with input and
+ *                       flushing between them) until the loop is back on
+ *                       the grid, at most TICK_CATCHUP_MAX in a row;
+ *                       beyond that the rest are skipped. Game time
+ *                       (respawns, timers) keeps pace with wall time.
+ * 
+ * Either way the grid itself never moves, so processing time and
+ * timeout rounding are never added to the period (no drift).
+ */
+typedef enum {
+    TICK_CATCHUP_SKIP = 0,
+    TICK_CATCHUP_BURST
+} TickCatchup;
+
+/* Most missed ticks TICK_CATCHUP_BURST runs back to back */
+#define TICK_CATCHUP_MAX 5
+
+/*
+ * g_tick_catchup - Policy server_run() uses (--tick-catchup skip|burst)
+ */
+extern TickCatchup g_tick_catchup;
+
+/*******************************************************************************
+ * RUNTIME LIMITS
+ *******************************************************************************
+ *
+ * MAX_PLAYERS, MAX_NPCS, MAX_GROUND_ITEMS, MAX_WAYPOINTS and TICK_RATE_MS
+ * are the ceilings: the protocol's 11-bit player index, the client's NPC
+ * index, the size of fixed arrays. They used to be the sizes as well, so
+ * a world for 50 players allocated its tables for 2047.
+ *
+ * ServerLimits holds the sizes one world actually runs with, set from
+ * --max-players, --max-npcs, --max-ground-items, --max-waypoints and
+ * --tick-ms (or the same lines in a --config file, config_file.h) and
+ * read once by server_init():
+ *
+ *   players        PIDs, connection slots and everything sized per PID:
+ *                  the player list, tracking, zone grid, NPC and ground
+ *                  tracking, the network thread's connections
+ *   npcs           NPC system (slots, zone grid, walk batches)
+ *   ground_items   Ground item and object pools
+ *   waypoints      Steps one player or NPC may have queued
+ *   tick_ms        Tick period; every duration counted in ticks (respawns,
+ *                  timeouts, rate limits) scales with it
+ *
+ * Values are clamped to the ceilings, which stay compile-time: the slot
+ * array in GameServer and the per-PID bitsets keep their full size, the
+ * limits only decide how much of them is ever used.
+ */
+typedef struct {
+    u32 players;                /* Players online at once (1 .. MAX_PLAYERS - 1) */
+    u32 npcs;                   /* NPC capacity (1 .. MAX_NPCS) */
+    u32 ground_items;           /* Ground item / object capacity (1 .. MAX_GROUND_ITEMS) */
+    u32 waypoints;              /* Queued steps per entity (1 .. MAX_WAYPOINTS) */
+    u32 tick_ms;                /* Tick period in ms */
+} ServerLimits;
+
+/* Shortest tick --tick-ms accepts */
+#define SERVER_TICK_MS_MIN 50
+
+/*
+ * g_server_limits - Sizes this world runs with (defaults: the ceilings)
+ */
+extern ServerLimits g_server_limits;
+
+/*
+ * server_limits_clamp - Pull every limit into its valid range
+ *
+ * Called by server_init(); call it earlier to print the values in effect.
+ */
+void server_limits_clamp(ServerLimits* limits);
+
 #endif /* SERVER_H */
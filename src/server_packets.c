@@ -97,8 +97,8 @@
  *     // 2. Get cipher (if initialized)
  *     ISAACCipher* enc = enc_for(player);
  *     
- *     // 3. Allocate buffer (estimate size)
- *     StreamBuffer* out = buffer_create(estimated_size);
+ *     // 3. Take the player's reusable output arena (no allocation)
+ *     StreamBuffer* out = player_out(player);
  *     
  *     // 4. Write header (encrypted opcode + length if variable)
  *     buffer_write_header_var(out, OPCODE, enc, VAR_TYPE);
@@ -115,33 +115,32 @@
  *     // 7. Debug logging
  *     dbg_log_send("PACKET_NAME", OPCODE, "frame_type", payload_len, encrypted);
  *     
- *     // 8. Transmit to client
- *     network_send(player->socket_fd, out->data, out->position);
- *     
- *     // 9. Cleanup
- *     buffer_destroy(out);
+ *     // 8. Transmit to client and reset the arena for the next packet
+ *     player_out_commit(player);
  * }
- * 
- * BUFFER SIZE ESTIMATION:
- * 
- * Why estimate buffer size?
- *   - Reduces realloc() calls (better performance)
- *   - Prevents memory fragmentation
- *   - Allocation overhead is O(1) if size is correct
- * 
- * Estimation formula:
- *   size = header_size + payload_size + safety_margin
- *   
- *   Fixed:     1 + payload
- *   VAR_BYTE:  2 + payload
- *   VAR_SHORT: 3 + payload
- *   
- *   Safety margin: Add 8-16 bytes for worst-case alignment
- * 
- * Example:
- *   MESSAGE_GAME with 50-char message:
- *   size = 2 (header) + 50 (string) + 1 (terminator) + 8 (margin) = 61 bytes
- *   Round up to power of 2: 64 bytes
+ *
+ * FIXED-SIZE PACKETS:
+ *   Steps 4-6 are one generated call (packet_codec.h), built from the
+ *   packet's layout in packets.h and checked against its size there:
+ *
+ *     encode_varp_small(out, enc, id, value);   [150][id:2][value:1]
+ *
+ * OUTPUT ARENA:
+ * 
+ * Each connection carries an out_buffer arena (--out-arena bytes, default
+ * MAX_PACKET_SIZE) wrapped by a StreamBuffer (player->conn->out_stream). Every sender writes into that same arena instead
+ * of allocating a fresh buffer per packet:
+ * 
+ *   Old: buffer_create() → write → send → buffer_destroy()   (2 mallocs, 2 frees)
+ *   New: player_out()    → write → player_out_commit()       (0 mallocs)
+ * 
+ * A login burst sends ~60 packets and every tick sends at least one
+ * PLAYER_INFO per player, so this removes thousands of small heap
+ * round-trips per second on a busy server. Packets larger than the arena
+ * (map chunks, crowded PLAYER_INFO) spill to the heap once; the spill is
+ * kept and reused until the player slot is destroyed.
+ * 
+ * Per-packet "Total: N bytes" notes below document wire sizes only.
  * 
  * VARIABLE-LENGTH HEADER BACKFILLING:
  * 
@@ -241,15 +240,18 @@
  * 
  * COMPLEXITY ANALYSIS:
  *   Most functions: O(1) time, O(1) space
- *   send_player_stats(): O(N) where N = skill count (23)
- *   send_interfaces(): O(N) where N = tab count (13)
+ *   send_player_stats(): O(N) where N = skill count (21), one template copy
+ *   send_interfaces(): one template copy (13 tabs)
  * 
  ******************************************************************************/
 
 #include "server_packets.h"  /* brings in types/player + SERVER_* ids */
 #include "buffer.h"
+#include "packet_codec.h"
+#include "packet_template.h"
 #include "network.h"
 #include "server.h"
+#include "log.h"
 #include <string.h>
 
 /*******************************************************************************
@@ -273,7 +275,103 @@
  * COMPLEXITY: O(1)
  */
 static inline ISAACCipher* enc_for(Player* p) {
-    return (p && p->out_cipher.initialized) ? &p->out_cipher : NULL;
+    return (p && p->conn->out_cipher.initialized) ? &p->conn->out_cipher : NULL;
+}
+
+/*******************************************************************************
+ * LOGIN BURST TEMPLATES (packet_template.h)
+ ******************************************************************************/
+
+/* Skills the client shows (player->levels[] / experience[]) */
+#define STAT_COUNT 21
+
+/* One UPDATE_STAT: [44][skill:1][experience / 10:4][level:1] */
+#define STAT_PACKET_SIZE (1 + SERVER_UPDATE_STAT_SIZE)
+#define STAT_XP_AT 2
+#define STAT_LEVEL_AT 6
+
+/* Root interface a new player designs their character in */
+#define DESIGN_INTERFACE 3559
+
+/* Standard sidebar tabs, matching the official revision 225 layout */
+static const struct { u8 tab; u16 iface; } SIDEBAR_TABS[] = {
+    {0, 5855},  /* Combat styles */
+    {1, 3917},  /* Stats */
+    {2, 638},   /* Quest journal */
+    {3, 3213},  /* Inventory */
+    {4, 1644},  /* Equipment */
+    {5, 5608},  /* Prayer book */
+    {6, 1151},  /* Magic spellbook */
+    /* 7 reserved in 225 */
+    {8, 5065},  /* Friends */
+    {9, 5715},  /* Ignore */
+    {10, 2449}, /* Logout */
+    {11, 904},  /* Settings */
+    {12, 147},  /* Emotes */
+    {13, 962},  /* Music */
+};
+
+static const char* const WELCOME_MESSAGES[] = {
+    "Welcome to RuneScape by JAGeX.",
+    "Protocol #225 Written in C (May 2004).",
+};
+
+static PacketTemplate stats_template;   /* Every UPDATE_STAT, values patched in */
+static PacketTemplate tabs_template;    /* send_interfaces() */
+static PacketTemplate game_tail;        /* Tabs, welcome */
+static PacketTemplate design_tail;      /* Tabs, IF_OPENTOP design, welcome */
+static bool templates_ready = false;
+
+static void record_tabs(PacketTemplate* t) {
+    for (size_t i = 0; i < sizeof(SIDEBAR_TABS) / sizeof(SIDEBAR_TABS[0]); i++) {
+        StreamBuffer* b = packet_template_open(t, SERVER_IF_SETTAB);
+        buffer_reserve(b, SERVER_IF_SETTAB_SIZE);
+        buffer_put_u16(b, SIDEBAR_TABS[i].iface);  /* interface id first */
+        buffer_put_u8(b, SIDEBAR_TABS[i].tab);
+    }
+}
+
+static void record_welcome(PacketTemplate* t) {
+    for (size_t i = 0; i < sizeof(WELCOME_MESSAGES) / sizeof(WELCOME_MESSAGES[0]); i++) {
+        StreamBuffer* b = packet_template_open(t, SERVER_MESSAGE_GAME);
+        buffer_write_byte(b, (u8)(strlen(WELCOME_MESSAGES[i]) + 1));  /* VAR_BYTE length */
+        buffer_write_string(b, WELCOME_MESSAGES[i]);
+    }
+}
+
+/*
+ * login_templates_build - Record the templates on first use
+ *
+ * Plain opcodes, zero stats: nothing in them depends on a player. The
+ * largest, design_tail, is 129 bytes of a PacketTemplate's 512.
+ */
+static void login_templates_build(void) {
+    if (templates_ready) return;
+
+    packet_template_init(&stats_template);
+    for (u32 skill = 0; skill < STAT_COUNT; skill++) {
+        StreamBuffer* b = packet_template_open(&stats_template, SERVER_UPDATE_STAT);
+        buffer_reserve(b, SERVER_UPDATE_STAT_SIZE);
+        buffer_put_u8(b, (u8)skill);
+        buffer_put_u32(b, 0);  /* experience / 10, patched */
+        buffer_put_u8(b, 0);   /* level, patched */
+    }
+
+    packet_template_init(&tabs_template);
+    record_tabs(&tabs_template);
+
+    packet_template_init(&game_tail);
+    record_tabs(&game_tail);
+    record_welcome(&game_tail);
+
+    packet_template_init(&design_tail);
+    record_tabs(&design_tail);
+    StreamBuffer* b = packet_template_open(&design_tail, SERVER_IF_OPENTOP);
+    buffer_reserve(b, SERVER_IF_OPENTOP_SIZE);
+    buffer_put_u16(b, DESIGN_INTERFACE);
+    record_welcome(&design_tail);
+
+    templates_ready = true;
 }
 
 /*******************************************************************************
@@ -328,7 +426,7 @@ void send_player_message(Player* player, const char* msg) {
     if (!player || !msg) return;
     ISAACCipher* enc = enc_for(player);
 
-    StreamBuffer* out = buffer_create(3u + (u32)strlen(msg) + 2u);
+    StreamBuffer* out = player_out(player);
     buffer_write_header_var(out, SERVER_MESSAGE_GAME, enc, VAR_BYTE);
     u32 payload_start = out->position;
 
@@ -337,8 +435,7 @@ void send_player_message(Player* player, const char* msg) {
     buffer_finish_var_header(out, VAR_BYTE);
     dbg_log_send("MESSAGE_GAME", SERVER_MESSAGE_GAME, "varbyte", (int)(out->position - payload_start), enc != NULL);
 
-    network_send(player->socket_fd, out->data, out->position);
-    buffer_destroy(out);
+    player_out_commit(player);
 }
 
 /*******************************************************************************
@@ -362,14 +459,11 @@ void send_player_message(Player* player, const char* msg) {
  *   Specific skill names and order defined in client cache
  * 
  * ALGORITHM:
- *   For each skill (0 to 22):
- *     1. Create packet buffer (7 bytes: 1 header + 6 payload)
- *     2. Write encrypted opcode
- *     3. Write skill ID (1 byte)
- *     4. Write level (1 byte, typically 1-99)
- *     5. Write XP (4 bytes big-endian, typically 0 to 200M)
- *     6. Send packet
- *     7. Free buffer
+ *   1. Copy stats_template: all 21 packets, skill IDs filled in, opcodes
+ *      encrypted in one pass (packet_template_emit)
+ *   2. For each skill, write into its copy:
+ *        XP / 10 (4 bytes big-endian) at STAT_XP_AT
+ *        level (1 byte, typically 1-99) at STAT_LEVEL_AT
  * 
  * WHY SEPARATE PACKETS?
  *   Could send all stats in one packet, but:
@@ -397,46 +491,184 @@ void send_player_message(Player* player, const char* msg) {
  * 
  * COMPLEXITY: O(N) where N = skill count (23)
  */
+/* One UPDATE_STAT on its own (send_pending_state): 7 bytes */
+static void write_stat(Player* player, u32 skill) {
+    ISAACCipher* enc = enc_for(player);
+
+    /* [skill id][experience / 10][current level] */
+    StreamBuffer* out = player_out(player);
+    encode_update_stat(out, enc, (u8)skill, player->experience[skill] / 10, player->levels[skill]);
+
+    dbg_log_send("UPDATE_STAT", SERVER_UPDATE_STAT, "fixed", SERVER_UPDATE_STAT_SIZE, enc != NULL);
+
+    player_out_commit(player);
+}
+
 void send_player_stats(Player* player) {
     if (!player) return;
 
-    const i32 SKILL_COUNT   = 21;  /* Changed from 23 to match player.h SKILL_COUNT */
+    LOG_DEBUG("Sending player stats for '%s'\n", player->username);
+    login_templates_build();
 
-    printf("DEBUG: Sending player stats for '%s'\n", player->username);
-    
-    for (i32 skill = 0; skill < SKILL_COUNT; skill++) {
-        /* total = 1(opcode) + 6(payload) = 7 bytes */
-        StreamBuffer* out = buffer_create(7);
+    /* Copy the 21 packets, then write each skill's values into its copy */
+    ISAACCipher* enc = enc_for(player);
+    u8* packet = packet_template_emit(&stats_template, player_out(player), enc);
+    if (packet) {
+        for (u32 skill = 0; skill < STAT_COUNT; skill++, packet += STAT_PACKET_SIZE) {
+            u8 level = player->levels[skill];
+            u32 xp = player->experience[skill] / 10;
+            if (skill == 3) {  /* Hitpoints */
+                LOG_DEBUG("  Skill %u (HP): level=%u, xp=%u\n", skill, level,
+                          player->experience[skill]);
+            }
+            packet[STAT_XP_AT] = (u8)(xp >> 24);
+            packet[STAT_XP_AT + 1] = (u8)(xp >> 16);
+            packet[STAT_XP_AT + 2] = (u8)(xp >> 8);
+            packet[STAT_XP_AT + 3] = (u8)xp;
+            packet[STAT_LEVEL_AT] = level;
+        }
+    }
+    dbg_log_send("UPDATE_STAT", SERVER_UPDATE_STAT, "template",
+                 STAT_COUNT * SERVER_UPDATE_STAT_SIZE, enc != NULL);
+
+    player_out_commit(player);
+    player->pending.stats = 0;  /* All current now */
+}
 
-        buffer_write_header(out, SERVER_UPDATE_STAT,
-                            player->out_cipher.initialized ? &player->out_cipher : NULL);
+/*******************************************************************************
+ * INVENTORY PACKETS
+ ******************************************************************************/
 
-        u32 payload_start = buffer_get_position(out);
+/* 98 / 213: UPDATE_INV_FULL / UPDATE_INV_PARTIAL (varshort) – any container */
 
-        /* Read actual player data from levels[] and experience[] arrays */
-        u8 level = player->levels[skill];
-        u32 xp = player->experience[skill];
+/* Largest slot and slot count the inventory packets address (g1) */
+#define INV_WIRE_SLOTS 255
 
-        if (skill == 3) {  /* Hitpoints */
-            printf("DEBUG:   Skill %d (HP): level=%u, xp=%u\n", skill, level, xp);
+/* [id + 1:2][count:1, or 255 then count:4]; empty slot = id 0, count 0 */
+static void write_inv_item(StreamBuffer* out, const Item* item) {
+    buffer_write_short(out, item->id ? (u16)(item->id + 1) : 0, BYTE_ORDER_BIG);
+    if (item->amount >= 255) {
+        buffer_write_byte(out, 255);
+        buffer_write_int(out, item->amount, BYTE_ORDER_BIG);
+    } else {
+        buffer_write_byte(out, (u8)item->amount);
+    }
+}
+
+static inline u32 inv_item_size(const Item* item) {
+    return item->amount >= 255 ? 7 : 3;
+}
+
+/* Slots a full update lists: up to the last occupied one (the client empties the rest) */
+static u32 inv_full_slots(const ItemContainer* container) {
+    if (!container) return 0;
+    u32 slots = container->capacity < INV_WIRE_SLOTS ? container->capacity : INV_WIRE_SLOTS;
+    while (slots > 0 && container->items[slots - 1].id == 0) slots--;
+    return slots;
+}
+
+void write_container_full(StreamBuffer* out, u16 component, const ItemContainer* container) {
+    u32 slots = inv_full_slots(container);
+    buffer_write_short(out, component, BYTE_ORDER_BIG);
+    buffer_write_byte(out, (u8)slots);
+    for (u32 slot = 0; slot < slots; slot++) {
+        write_inv_item(out, &container->items[slot]);
+    }
+}
+
+void write_container_partial(StreamBuffer* out, u16 component, const ItemContainer* container) {
+    u32 dirty_count = 0;
+    const u32* dirty = item_container_dirty(container, &dirty_count);
+    buffer_write_short(out, component, BYTE_ORDER_BIG);
+    for (u32 i = 0; i < dirty_count; i++) {
+        buffer_write_byte(out, (u8)dirty[i]);
+        write_inv_item(out, &container->items[dirty[i]]);
+    }
+}
+
+bool container_update_partial(const ItemContainer* container) {
+    u32 dirty_count = 0;
+    const u32* dirty = item_container_dirty(container, &dirty_count);
+
+    /* Partial unless a slot is out of its g1 range or the full list is smaller */
+    bool partial = true;
+    u32 partial_size = 2;
+    for (u32 i = 0; i < dirty_count && partial; i++) {
+        partial = dirty[i] < INV_WIRE_SLOTS;
+        partial_size += 1 + inv_item_size(&container->items[dirty[i]]);
+    }
+    if (partial) {
+        u32 slots = inv_full_slots(container);
+        u32 full_size = 3;
+        for (u32 slot = 0; slot < slots && full_size < partial_size; slot++) {
+            full_size += inv_item_size(&container->items[slot]);
         }
+        partial = partial_size <= full_size;
+    }
+    return partial;
+}
+
+/*
+ * send_container_full - Every slot of a container (UPDATE_INV_FULL)
+ *
+ * A NULL container is sent as an empty list.
+ */
+void send_container_full(Player* player, u16 component, const ItemContainer* container) {
+    StreamBuffer* out = player_out(player);
+    buffer_write_header_var(out, SERVER_UPDATE_INV_FULL,
+                            player->conn->out_cipher.initialized ? &player->conn->out_cipher : NULL,
+                            VAR_SHORT);
+
+    u32 payload_start = buffer_get_position(out);
+    write_container_full(out, component, container);
+    buffer_finish_var_header(out, VAR_SHORT);
+
+    int payload_len = (int)(buffer_get_position(out) - payload_start);
+    dbg_log_send("UPDATE_INV_FULL", SERVER_UPDATE_INV_FULL, "varshort",
+                 payload_len, player->conn->out_cipher.initialized ? 1 : 0);
+
+    player_out_commit(player);
+}
+
+/*
+ * send_container_partial - Just the dirty slots (UPDATE_INV_PARTIAL)
+ */
+static void send_container_partial(Player* player, u16 component, const ItemContainer* container) {
+    StreamBuffer* out = player_out(player);
+    buffer_write_header_var(out, SERVER_UPDATE_INV_PARTIAL,
+                            player->conn->out_cipher.initialized ? &player->conn->out_cipher : NULL,
+                            VAR_SHORT);
+
+    u32 payload_start = buffer_get_position(out);
+    write_container_partial(out, component, container);
+    buffer_finish_var_header(out, VAR_SHORT);
+
+    int payload_len = (int)(buffer_get_position(out) - payload_start);
+    dbg_log_send("UPDATE_INV_PARTIAL", SERVER_UPDATE_INV_PARTIAL, "varshort",
+                 payload_len, player->conn->out_cipher.initialized ? 1 : 0);
+
+    player_out_commit(player);
+}
 
-        buffer_write_byte(out, (u8)skill);                 /* skill id      */
-        buffer_write_int(out, xp / 10, BYTE_ORDER_BIG);    /* experience / 10 */
-        buffer_write_byte(out, level);                     /* current level */
+void send_container_dirty(Player* player, u16 component, const ItemContainer* container) {
+    if (!player || !container) return;
 
-        int payload_len = (int)(buffer_get_position(out) - payload_start);
-        dbg_log_send("UPDATE_STAT", SERVER_UPDATE_STAT, "fixed",
-                     payload_len, player->out_cipher.initialized ? 1 : 0);
+    u32 dirty_count = 0;
+    item_container_dirty(container, &dirty_count);
+    if (dirty_count == 0) return;
 
-        network_send(player->socket_fd, out->data, out->position);
-        buffer_destroy(out);
+    if (container_update_partial(container)) {
+        send_container_partial(player, component, container);
+    } else {
+        send_container_full(player, component, container);
     }
 }
 
-/*******************************************************************************
- * INVENTORY PACKETS
- ******************************************************************************/
+void send_container_update(Player* player, u16 component, ItemContainer* container) {
+    if (!player || !container) return;
+    send_container_dirty(player, component, container);
+    item_container_clear_dirty(container);
+}
 
 /* 98: UPDATE_INV_FULL (varshort) – inventory (component 3214) */
 
@@ -454,13 +686,16 @@ void send_player_stats(Player* player) {
  *   Interface 3214: Inventory container (component within interface 3213)
  *   Contains 28 item slots
  * 
- * ITEM ENCODING (not implemented here, sends empty):
- *   For each item:
- *     [item_id:2][item_count:1 or 4]
+ * ITEM ENCODING (write_inv_item):
+ *   For each slot:
+ *     [item_id + 1:2][item_count:1 or 5]   (id 0 = empty slot)
  *   
  *   If count < 255: 1 byte
  *   If count >= 255: 1 byte 0xFF + 4 bytes actual count
  * 
+ * Sends every slot of player->inventory and clears its dirty slots; later
+ * changes go out as partial updates (send_container_update, once a tick).
+ * 
  * EMPTY INVENTORY:
  *   item_count = 0
  *   No item data follows
@@ -474,29 +709,12 @@ void send_player_stats(Player* player) {
  *   Example: [0xXX][0x00][0x03][0x0C][0x8E][0x00]
  *            opcode len=3    id=3214    count=0
  * 
- * COMPLEXITY: O(1) for empty, O(N) for N items
+ * COMPLEXITY: O(N) for N slots
  */
 void send_inventory(Player* player) {
     if (!player) return;
-
-    StreamBuffer* out = buffer_create(8);
-    buffer_write_header_var(out, SERVER_UPDATE_INV_FULL,
-                            player->out_cipher.initialized ? &player->out_cipher : NULL,
-                            VAR_SHORT);
-
-    u32 payload_start = buffer_get_position(out);
-
-    buffer_write_short(out, 3214, BYTE_ORDER_BIG);  /* inventory interface/component */
-    buffer_write_byte(out, 0);                      /* item count (0 for now)        */
-
-    buffer_finish_var_header(out, VAR_SHORT);
-
-    int payload_len = (int)(buffer_get_position(out) - payload_start);
-    dbg_log_send("UPDATE_INV_FULL(inv)", SERVER_UPDATE_INV_FULL, "varshort",
-                 payload_len, player->out_cipher.initialized ? 1 : 0);
-
-    network_send(player->socket_fd, out->data, out->position);
-    buffer_destroy(out);
+    send_container_full(player, INV_COMPONENT_INVENTORY, player->inventory);
+    item_container_clear_dirty(player->inventory);
 }
 
 /* 98: UPDATE_INV_FULL (varshort) – equipment (component 1688) */
@@ -521,25 +739,8 @@ void send_inventory(Player* player) {
  */
 void send_equipment(Player* player) {
     if (!player) return;
-
-    StreamBuffer* out = buffer_create(8);
-    buffer_write_header_var(out, SERVER_UPDATE_INV_FULL,
-                            player->out_cipher.initialized ? &player->out_cipher : NULL,
-                            VAR_SHORT);
-
-    u32 payload_start = buffer_get_position(out);
-
-    buffer_write_short(out, 1688, BYTE_ORDER_BIG);  /* equipment interface/component */
-    buffer_write_byte(out, 0);                      /* item count (0 for now)        */
-
-    buffer_finish_var_header(out, VAR_SHORT);
-
-    int payload_len = (int)(buffer_get_position(out) - payload_start);
-    dbg_log_send("UPDATE_INV_FULL(equip)", SERVER_UPDATE_INV_FULL, "varshort",
-                 payload_len, player->out_cipher.initialized ? 1 : 0);
-
-    network_send(player->socket_fd, out->data, out->position);
-    buffer_destroy(out);
+    send_container_full(player, INV_COMPONENT_EQUIPMENT, player->equipment);
+    item_container_clear_dirty(player->equipment);
 }
 
 /*******************************************************************************
@@ -589,21 +790,14 @@ void send_equipment(Player* player) {
 void send_sidebar_interface(Player* player, i32 tab_slot, i32 interface_id) {
     if (!player) return;
 
-    StreamBuffer* out = buffer_create(4);
-    buffer_write_header(out, SERVER_IF_SETTAB,
-                        player->out_cipher.initialized ? &player->out_cipher : NULL);
-
-    u32 payload_start = buffer_get_position(out);
+    ISAACCipher* enc = enc_for(player);
 
-    buffer_write_short(out, (u16)interface_id, BYTE_ORDER_BIG); /* interface id first */
-    buffer_write_byte(out, (u8)tab_slot);                       /* tab index second   */
+    StreamBuffer* out = player_out(player);
+    encode_if_settab(out, enc, (u16)interface_id, (u8)tab_slot);  /* interface id first */
 
-    int payload_len = (int)(buffer_get_position(out) - payload_start);
-    dbg_log_send("IF_SETTAB", SERVER_IF_SETTAB, "fixed",
-                 payload_len, player->out_cipher.initialized ? 1 : 0);
+    dbg_log_send("IF_SETTAB", SERVER_IF_SETTAB, "fixed", SERVER_IF_SETTAB_SIZE, enc != NULL);
 
-    network_send(player->socket_fd, out->data, out->position);
-    buffer_destroy(out);
+    player_out_commit(player);
 }
 
 /*
@@ -619,33 +813,48 @@ void send_sidebar_interface(Player* player, i32 tab_slot, i32 interface_id) {
  *   Matches official RuneScape revision 225 layout
  * 
  * ALGORITHM:
- *   For each (tab_slot, interface_id) pair:
- *     send_sidebar_interface(player, tab_slot, interface_id)
+ *   Copy the SIDEBAR_TABS template: one IF_SETTAB per (tab_slot,
+ *   interface_id) pair, the same bytes send_sidebar_interface() writes
  * 
- * COMPLEXITY: O(N) where N = 13 tabs
+ * COMPLEXITY: O(1) - one 52-byte copy and 13 opcode keys
  */
 void send_interfaces(Player* player) {
     if (!player) return;
+    login_templates_build();
 
-    const struct { u8 tab; u16 iface; } tabs[] = {
-        {0, 5855},  /* Combat styles */
-        {1, 3917},  /* Stats */
-        {2, 638},   /* Quest journal */
-        {3, 3213},  /* Inventory */
-        {4, 1644},  /* Equipment */
-        {5, 5608},  /* Prayer book */
-        {6, 1151},  /* Magic spellbook */
-        /* 7 reserved in 225 */
-        {8, 5065},  /* Friends */
-        {9, 5715},  /* Ignore */
-        {10, 2449}, /* Logout */
-        {11, 904},  /* Settings */
-        {12, 147},  /* Emotes */
-        {13, 962},  /* Music */
-    };
-    for (size_t i = 0; i < sizeof(tabs)/sizeof(tabs[0]); ++i) {
-        send_sidebar_interface(player, tabs[i].tab, tabs[i].iface);
-    }
+    ISAACCipher* enc = enc_for(player);
+    packet_template_emit(&tabs_template, player_out(player), enc);
+    dbg_log_send("IF_SETTAB", SERVER_IF_SETTAB, "template",
+                 (int)packet_template_length(&tabs_template), enc != NULL);
+    player_out_commit(player);
+}
+
+/*
+ * send_login_burst - Everything a player gets right after login, in order
+ *
+ * @param player  Newly logged in player (map area already sent)
+ *
+ * Stats, inventory, equipment, sidebar tabs, the character design screen
+ * for a new player, the welcome messages. Everything but the two
+ * containers is copied from templates (packet_template.h): the tabs, the
+ * design screen and the welcome messages as one copy.
+ *
+ * COMPLEXITY: O(1) packets built, three template copies
+ */
+void send_login_burst(Player* player) {
+    if (!player) return;
+    login_templates_build();
+
+    send_player_stats(player);
+    send_inventory(player);
+    send_equipment(player);
+
+    ISAACCipher* enc = enc_for(player);
+    const PacketTemplate* tail = player->design_complete ? &game_tail : &design_tail;
+    packet_template_emit(tail, player_out(player), enc);
+    dbg_log_send("LOGIN_TAIL", SERVER_IF_SETTAB, "template",
+                 (int)packet_template_length(tail), enc != NULL);
+    player_out_commit(player);
 }
 
 /*
@@ -674,15 +883,66 @@ void send_if_opentop(Player* player, i32 interface_id) {
     if (!player) return;
     ISAACCipher* enc = enc_for(player);
 
-    StreamBuffer* out = buffer_create(8);
-    buffer_write_header(out, SERVER_IF_OPENTOP, enc);
-    u32 payload_start = out->position;
+    StreamBuffer* out = player_out(player);
+    encode_if_opentop(out, enc, (u16)interface_id);
 
-    buffer_write_short(out, (u16)interface_id, BYTE_ORDER_BIG);
+    dbg_log_send("IF_OPENTOP", SERVER_IF_OPENTOP, "fixed", SERVER_IF_OPENTOP_SIZE, enc != NULL);
+    player_out_commit(player);
+}
+
+/*
+ * send_if_openbottom - Open an interface in the chatbox area
+ * 
+ * @param player        Target player
+ * @param interface_id  Chatbox interface (dialogues, "Click here to continue")
+ * 
+ * PACKET STRUCTURE:
+ *   Opcode: 14 (IF_OPENBOTTOM)
+ *   Type:   Fixed (2 bytes payload)
+ *   Payload: [interface_id:2]
+ * 
+ * The client answers a "Click here to continue" in it with
+ * RESUME_PAUSEBUTTON, which resumes a paused script (script.h).
+ * 
+ * COMPLEXITY: O(1)
+ */
+void send_if_openbottom(Player* player, i32 interface_id) {
+    if (!player) return;
+    ISAACCipher* enc = enc_for(player);
+
+    StreamBuffer* out = player_out(player);
+    encode_if_openbottom(out, enc, (u16)interface_id);
+
+    dbg_log_send("IF_OPENBOTTOM", SERVER_IF_OPENBOTTOM, "fixed", SERVER_IF_OPENBOTTOM_SIZE, enc != NULL);
+    player_out_commit(player);
+}
+
+/*
+ * send_if_opensub - Open a main interface and the sidebar that goes with it
+ * 
+ * @param player  Target player
+ * @param main    Game view interface (3824: shop)
+ * @param side    Sidebar interface (3822: the shop's inventory panel)
+ * 
+ * PACKET STRUCTURE:
+ *   Opcode: 28 (IF_OPENSUB)
+ *   Type:   Fixed (4 bytes payload)
+ *   Payload: [main:2][side:2]
+ * 
+ * The client closes its chatbox interface and shows side instead of the
+ * tabs until the interfaces are closed (CLOSE_MODAL).
+ * 
+ * COMPLEXITY: O(1)
+ */
+void send_if_opensub(Player* player, i32 main, i32 side) {
+    if (!player) return;
+    ISAACCipher* enc = enc_for(player);
 
-    dbg_log_send("IF_OPENTOP", SERVER_IF_OPENTOP, "fixed", (int)(out->position - payload_start), enc != NULL);
-    network_send(player->socket_fd, out->data, out->position);
-    buffer_destroy(out);
+    StreamBuffer* out = player_out(player);
+    encode_if_opensub(out, enc, (u16)main, (u16)side);
+
+    dbg_log_send("IF_OPENSUB", SERVER_IF_OPENSUB, "fixed", SERVER_IF_OPENSUB_SIZE, enc != NULL);
+    player_out_commit(player);
 }
 
 /*
@@ -708,7 +968,7 @@ void send_if_settext(Player* player, i32 interface_id, const char* text) {
     if (!player || !text) return;
     ISAACCipher* enc = enc_for(player);
 
-    StreamBuffer* out = buffer_create(8u + (u32)strlen(text) + 3u);
+    StreamBuffer* out = player_out(player);
     buffer_write_header_var(out, SERVER_IF_SETTEXT, enc, VAR_SHORT);
     u32 payload_start = out->position;
 
@@ -717,8 +977,7 @@ void send_if_settext(Player* player, i32 interface_id, const char* text) {
 
     buffer_finish_var_header(out, VAR_SHORT);
     dbg_log_send("IF_SETTEXT", SERVER_IF_SETTEXT, "varshort", (int)(out->position - payload_start), enc != NULL);
-    network_send(player->socket_fd, out->data, out->position);
-    buffer_destroy(out);
+    player_out_commit(player);
 }
 
 /*
@@ -730,8 +989,8 @@ void send_if_settext(Player* player, i32 interface_id, const char* text) {
  * 
  * PACKET STRUCTURE:
  *   Opcode: 26 (IF_SETHIDE)
- *   Type:   Fixed (6 bytes payload)
- *   Payload: [interface_id:2][hidden:4]
+ *   Type:   Fixed (3 bytes payload)
+ *   Payload: [interface_id:2][hidden:1]
  * 
  * HIDDEN VALUE:
  *   0: Component visible
@@ -743,16 +1002,11 @@ void send_if_sethide(Player* player, i32 interface_id, i32 hidden) {
     if (!player) return;
     ISAACCipher* enc = enc_for(player);
 
-    StreamBuffer* out = buffer_create(12);
-    buffer_write_header(out, SERVER_IF_SETHIDE, enc);
-    u32 payload_start = out->position;
+    StreamBuffer* out = player_out(player);
+    encode_if_sethide(out, enc, (u16)interface_id, hidden ? 1 : 0);
 
-    buffer_write_short(out, (u16)interface_id, BYTE_ORDER_BIG);
-    buffer_write_int(out, (u32)hidden, BYTE_ORDER_BIG);
-
-    dbg_log_send("IF_SETHIDE", SERVER_IF_SETHIDE, "fixed", (int)(out->position - payload_start), enc != NULL);
-    network_send(player->socket_fd, out->data, out->position);
-    buffer_destroy(out);
+    dbg_log_send("IF_SETHIDE", SERVER_IF_SETHIDE, "fixed", SERVER_IF_SETHIDE_SIZE, enc != NULL);
+    player_out_commit(player);
 }
 
 /*******************************************************************************
@@ -782,20 +1036,28 @@ void send_if_sethide(Player* player, i32 interface_id, i32 hidden) {
  * 
  * COMPLEXITY: O(1)
  */
+/* Forget a queued value for id (a direct send supersedes it) */
+static void pending_drop_varp(PendingState* pending, u16 id) {
+    for (u32 i = 0; i < pending->varp_count; i++) {
+        if (pending->varp_ids[i] == id) {
+            pending->varp_count--;
+            pending->varp_ids[i] = pending->varp_ids[pending->varp_count];
+            pending->varp_values[i] = pending->varp_values[pending->varp_count];
+            return;
+        }
+    }
+}
+
 void send_varp_small(Player* player, i32 id, i32 value) {
     if (!player) return;
     ISAACCipher* enc = enc_for(player);
+    pending_drop_varp(&player->pending, (u16)id);
 
-    StreamBuffer* out = buffer_create(8);
-    buffer_write_header(out, SERVER_VARP_SMALL, enc);
-    u32 payload_start = out->position;
+    StreamBuffer* out = player_out(player);
+    encode_varp_small(out, enc, (u16)id, (u8)value);
 
-    buffer_write_short(out, (u16)id, BYTE_ORDER_BIG);
-    buffer_write_byte(out, (u8)value);
-
-    dbg_log_send("VARP_SMALL", SERVER_VARP_SMALL, "fixed", (int)(out->position - payload_start), enc != NULL);
-    network_send(player->socket_fd, out->data, out->position);
-    buffer_destroy(out);
+    dbg_log_send("VARP_SMALL", SERVER_VARP_SMALL, "fixed", SERVER_VARP_SMALL_SIZE, enc != NULL);
+    player_out_commit(player);
 }
 
 /*
@@ -820,17 +1082,13 @@ void send_varp_small(Player* player, i32 id, i32 value) {
 void send_varp_large(Player* player, i32 id, i32 value) {
     if (!player) return;
     ISAACCipher* enc = enc_for(player);
+    pending_drop_varp(&player->pending, (u16)id);
 
-    StreamBuffer* out = buffer_create(12);
-    buffer_write_header(out, SERVER_VARP_LARGE, enc);
-    u32 payload_start = out->position;
-
-    buffer_write_short(out, (u16)id, BYTE_ORDER_BIG);
-    buffer_write_int(out, (u32)value, BYTE_ORDER_BIG);
+    StreamBuffer* out = player_out(player);
+    encode_varp_large(out, enc, (u16)id, (u32)value);
 
-    dbg_log_send("VARP_LARGE", SERVER_VARP_LARGE, "fixed", (int)(out->position - payload_start), enc != NULL);
-    network_send(player->socket_fd, out->data, out->position);
-    buffer_destroy(out);
+    dbg_log_send("VARP_LARGE", SERVER_VARP_LARGE, "fixed", SERVER_VARP_LARGE_SIZE, enc != NULL);
+    player_out_commit(player);
 }
 
 /*******************************************************************************
@@ -856,13 +1114,11 @@ void send_cam_reset(Player* player) {
     if (!player) return;
     ISAACCipher* enc = enc_for(player);
 
-    StreamBuffer* out = buffer_create(2);
-    buffer_write_header(out, SERVER_CAM_RESET, enc);
-    u32 payload_start = out->position;
+    StreamBuffer* out = player_out(player);
+    encode_cam_reset(out, enc);
 
-    dbg_log_send("CAM_RESET", SERVER_CAM_RESET, "fixed", (int)(out->position - payload_start), enc != NULL);
-    network_send(player->socket_fd, out->data, out->position);
-    buffer_destroy(out);
+    dbg_log_send("CAM_RESET", SERVER_CAM_RESET, "fixed", SERVER_CAM_RESET_SIZE, enc != NULL);
+    player_out_commit(player);
 }
 
 /*******************************************************************************
@@ -893,17 +1149,80 @@ void send_run_energy(Player* player, i32 energy) {
     ISAACCipher* enc = enc_for(player);
 
     u8 pct = (u8)energy;
+    player->pending.run_energy_pending = false;
 
-    StreamBuffer* out = buffer_create(4);
-    buffer_write_header(out, SERVER_UPDATE_RUNENERGY, enc);
-    u32 payload_start = out->position;
-
-    buffer_write_byte(out, pct);
+    StreamBuffer* out = player_out(player);
+    encode_update_runenergy(out, enc, pct);
 
     dbg_log_send("UPDATE_RUNENERGY", SERVER_UPDATE_RUNENERGY, "fixed",
-                 (int)(out->position - payload_start), enc != NULL);
-    network_send(player->socket_fd, out->data, out->position);
-    buffer_destroy(out);
+                 SERVER_UPDATE_RUNENERGY_SIZE, enc != NULL);
+    player_out_commit(player);
+}
+
+/*******************************************************************************
+ * PENDING STATE (ONE BATCH PER TICK)
+ ******************************************************************************/
+
+/*
+ * send_varp - VARP_SMALL if the client's g1b holds the value, else VARP_LARGE
+ */
+static void send_varp(Player* player, u16 id, i32 value) {
+    if (value >= -128 && value <= 127) {
+        send_varp_small(player, id, value);
+    } else {
+        send_varp_large(player, id, value);
+    }
+}
+
+void queue_varp(Player* player, u16 id, i32 value) {
+    if (!player) return;
+    PendingState* pending = &player->pending;
+
+    for (u32 i = 0; i < pending->varp_count; i++) {
+        if (pending->varp_ids[i] == id) {
+            pending->varp_values[i] = value;  /* Last value wins */
+            return;
+        }
+    }
+    if (pending->varp_count == PLAYER_PENDING_VARPS) {
+        /* More distinct varps than a tick normally touches: send one now */
+        send_varp(player, pending->varp_ids[0], pending->varp_values[0]);  /* Drops entry 0 */
+    }
+    pending->varp_ids[pending->varp_count] = id;
+    pending->varp_values[pending->varp_count] = value;
+    pending->varp_count++;
+}
+
+void queue_stat(Player* player, u32 skill) {
+    if (!player || skill >= STAT_COUNT) return;
+    player->pending.stats |= 1u << skill;
+}
+
+void queue_run_energy(Player* player, i32 energy) {
+    if (!player) return;
+    player->pending.run_energy = (u8)energy;
+    player->pending.run_energy_pending = true;
+}
+
+void send_pending_state(Player* player) {
+    if (!player) return;
+    PendingState* pending = &player->pending;
+
+    /* Each varp once, last value; send_varp() removes the entry it sends */
+    while (pending->varp_count > 0) {
+        send_varp(player, pending->varp_ids[0], pending->varp_values[0]);
+    }
+
+    for (u32 stats = pending->stats; stats != 0; stats &= stats - 1) {
+        u32 skill = 0;
+        while (!(stats & (1u << skill))) skill++;
+        write_stat(player, skill);
+    }
+    pending->stats = 0;
+
+    if (pending->run_energy_pending) {
+        send_run_energy(player, pending->run_energy);
+    }
 }
 
 /*******************************************************************************
@@ -940,24 +1259,20 @@ void send_if_close(Player* player) {
     if (!player) return;
     ISAACCipher* enc = enc_for(player);
 
-    StreamBuffer* out = buffer_create(2);
-    buffer_write_header(out, SERVER_IF_CLOSE, enc);
-    u32 payload_start = out->position;
+    StreamBuffer* out = player_out(player);
+    encode_if_close(out, enc);
 
-    dbg_log_send("IF_CLOSE", SERVER_IF_CLOSE, "fixed", (int)(out->position - payload_start), enc != NULL);
-    network_send(player->socket_fd, out->data, out->position);
-    buffer_destroy(out);
+    dbg_log_send("IF_CLOSE", SERVER_IF_CLOSE, "fixed", SERVER_IF_CLOSE_SIZE, enc != NULL);
+    player_out_commit(player);
 }
 
 void send_logout(Player* player) {
     if (!player) return;
     ISAACCipher* enc = enc_for(player);
 
-    StreamBuffer* out = buffer_create(2);
-    buffer_write_header(out, SERVER_LOGOUT, enc);
-    u32 payload_start = out->position;
+    StreamBuffer* out = player_out(player);
+    encode_logout(out, enc);
 
-    dbg_log_send("LOGOUT", SERVER_LOGOUT, "fixed", (int)(out->position - payload_start), enc != NULL);
-    network_send(player->socket_fd, out->data, out->position);
-    buffer_destroy(out);
+    dbg_log_send("LOGOUT", SERVER_LOGOUT, "fixed", SERVER_LOGOUT_SIZE, enc != NULL);
+    player_out_commit(player);
 }
@@ -17,7 +17,7 @@
  *   7. Destroy buffer
  * 
  * OPCODE ENCRYPTION:
- *   All opcodes encrypted with player->out_cipher (ISAAC cipher)
+ *   All opcodes encrypted with player->conn->out_cipher (ISAAC cipher)
  *   Encryption occurs in buffer_write_header() and buffer_write_header_var()
  * 
  * FRAME TYPES:
@@ -32,6 +32,11 @@
 
 #include "types.h"
 #include "player.h"
+#include "item.h"
+
+/* Inventory components the containers are shown in */
+#define INV_COMPONENT_INVENTORY 3214
+#define INV_COMPONENT_EQUIPMENT 1688
 #include "packets.h"
 
 /* Packet sending functions */
@@ -84,7 +89,7 @@ void send_player_stats(Player* player);
  * Opcode: SERVER_UPDATE_INV_FULL (98)
  * Frame:  VAR_SHORT
  * Payload: [interface_id:2][item_count:1][items...]
- * Current implementation sends empty inventory
+ * Sends all of player->inventory (at login) and clears its dirty slots
  */
 void send_inventory(Player* player);
 
@@ -95,10 +100,62 @@ void send_inventory(Player* player);
  * 
  * Opcode: SERVER_UPDATE_INV_FULL (98)
  * Frame:  VAR_SHORT
- * Sends equipment interface (1688) contents
+ * Sends equipment interface (1688) contents from player->equipment
  */
 void send_equipment(Player* player);
 
+/*
+ * send_container_update - Send a container's dirty slots, then clear them
+ * 
+ * @param player     Target player
+ * @param component  Inventory component showing the container (3214 for
+ *                   the inventory tab)
+ * @param container  Container (item_container_dirty() says what changed)
+ * 
+ * Opcode: SERVER_UPDATE_INV_PARTIAL (213) with [slot:1][id+1:2][count:1|5]
+ *         per dirty slot, or SERVER_UPDATE_INV_FULL (98) when that is
+ *         smaller or a dirty slot is past 254
+ * Frame:  VAR_SHORT
+ * 
+ * Both packets address at most 255 slots: larger containers need paging
+ * by the caller. Nothing is sent when no slot changed.
+ */
+void send_container_update(Player* player, u16 component, ItemContainer* container);
+
+/*
+ * send_container_dirty - send_container_update() without clearing
+ *
+ * For a container shown in a second component: the shop's side panel
+ * shows the inventory too (shop.h), and the tick's update of the
+ * inventory tab clears the slots afterwards.
+ */
+void send_container_dirty(Player* player, u16 component, const ItemContainer* container);
+
+/*
+ * send_container_full - Every slot of a container, dirty slots untouched
+ *
+ * Opcode: SERVER_UPDATE_INV_FULL (98)
+ * A NULL container is sent as an empty list.
+ */
+void send_container_full(Player* player, u16 component, const ItemContainer* container);
+
+/*
+ * write_container_full / write_container_partial - Inventory payloads
+ *
+ * The UPDATE_INV_FULL payload (every slot) and the UPDATE_INV_PARTIAL
+ * payload (the dirty slots), without a header: for encoding one update
+ * for many recipients (broadcast_container_begin).
+ */
+void write_container_full(StreamBuffer* out, u16 component, const ItemContainer* container);
+void write_container_partial(StreamBuffer* out, u16 component, const ItemContainer* container);
+
+/*
+ * container_update_partial - Are the dirty slots best sent as a partial?
+ *
+ * @return  false if the full list encodes smaller or a dirty slot is past 254
+ */
+bool container_update_partial(const ItemContainer* container);
+
 /*
  * send_if_opentop - Set root interface (main viewport)
  * 
@@ -111,6 +168,31 @@ void send_equipment(Player* player);
  */
 void send_if_opentop(Player* player, i32 interface_id);
 
+/*
+ * send_if_openbottom - Open an interface in the chatbox area
+ * 
+ * @param player        Target player
+ * @param interface_id  Chatbox interface
+ * 
+ * Opcode: SERVER_IF_OPENBOTTOM (14)
+ * Frame:  Fixed (2 bytes)
+ * Payload: [interface_id:2 big-endian]
+ */
+void send_if_openbottom(Player* player, i32 interface_id);
+
+/*
+ * send_if_opensub - Open a main interface with a sidebar beside it
+ *
+ * @param player  Target player
+ * @param main    Interface in the game view (a shop, a bank)
+ * @param side    Interface replacing the sidebar tabs while it is open
+ *
+ * Opcode: SERVER_IF_OPENSUB (28)
+ * Frame:  Fixed (4 bytes)
+ * Payload: [main:2][side:2]
+ */
+void send_if_opensub(Player* player, i32 main, i32 side);
+
 /*
  * send_cam_reset - Reset camera to default position
  * 
@@ -141,8 +223,11 @@ void send_run_energy(Player* player, i32 energy);
  * @param value   Value (0-127)
  * 
  * Opcode: SERVER_VARP_SMALL (150)
- * Frame:  Fixed (2 bytes)
- * Payload: [id:1][value:1 signed]
+ * Frame:  Fixed (3 bytes)
+ * Payload: [id:2 big-endian][value:1 signed]
+ * 
+ * Sent immediately (any queue_varp() value for id is dropped); prefer
+ * queue_varp() for changes made during the tick.
  */
 void send_varp_small(Player* player, i32 id, i32 value);
 
@@ -159,6 +244,30 @@ void send_varp_small(Player* player, i32 id, i32 value);
  */
 void send_varp_large(Player* player, i32 id, i32 value);
 
+/*
+ * queue_varp / queue_stat / queue_run_energy - Change client state this tick
+ * 
+ * @param player  Target player
+ * 
+ * Nothing is written until send_pending_state() at the end of the tick,
+ * which sends each varp, skill and the run energy once, with its last
+ * value (see PendingState in player.h). queue_stat() takes the skill's
+ * level and experience from the player when it is sent.
+ * 
+ * COMPLEXITY: O(1) (varps: O(PLAYER_PENDING_VARPS) dedupe)
+ */
+void queue_varp(Player* player, u16 id, i32 value);
+void queue_stat(Player* player, u32 skill);
+void queue_run_energy(Player* player, i32 energy);
+
+/*
+ * send_pending_state - Send the tick's queued varps, stats and run energy
+ * 
+ * Called once per player per tick by world_process(). Each varp picks
+ * VARP_SMALL when its value fits a signed byte, VARP_LARGE otherwise.
+ */
+void send_pending_state(Player* player);
+
 /*
  * send_if_settext - Update interface text label
  * 
@@ -217,4 +326,16 @@ void send_logout(Player* player);
  */
 void send_interfaces(Player* player);
 
+/*
+ * send_login_burst - Stats, containers, tabs and welcome after login
+ * 
+ * @param player  Newly logged in player
+ * 
+ * Same packets, in the same order, as send_player_stats(),
+ * send_inventory(), send_equipment(), send_interfaces(), IF_OPENTOP 3559
+ * (new players only) and two welcome messages; everything but the
+ * containers is copied from prebuilt templates (packet_template.h)
+ */
+void send_login_burst(Player* player);
+
 #endif /* SERVER_PACKETS_H */
\ No newline at end of file
@@ -0,0 +1,78 @@
+/*******************************************************************************
+ * SESSION.C - Keeping a Dropped Player's Session Implementation
+ *******************************************************************************
+ *
+ * See session.h for the linger and resume flow.
+ *
+ * RESUME, STEP BY STEP (slot A lingers, slot B is the new connection):
+ *
+ *   1. B answers LOGIN_RESPONSE_OK (B's ciphers were seeded by login_accept)
+ *   2. A's script is cancelled: it holds a Player* that is about to go stale
+ *   3. player_take_session(): A's game state is copied into B, B keeps its
+ *      socket, connection and slot; A keeps B's empty containers
+ *   4. world_resume_player(): the PID now names B, B's view starts empty
+ *   5. player_drop(A): A is CONNECTED now, so no logout hook, no save, and
+ *      the world still names B; A's netio connection is finally closed
+ *   6. B is sent LOAD_AREA and the full login burst, friend lists
+ *      included, and its shop is closed: reply 2 makes the client start
+ *      over, type 18 reconnect or not
+ *
+ ******************************************************************************/
+
+#include "session.h"
+#include "world.h"
+#include "map.h"
+#include "script.h"
+#include "server_packets.h"
+#include "social.h"
+#include "shop.h"
+#include "replay.h"
+#include "log.h"
+#include <string.h>
+
+u32 g_session_grace_ticks = SESSION_GRACE_TICKS;
+
+bool session_linger(Player* player) {
+    if (!player || g_session_grace_ticks == 0) return false;
+    if (player->state != PLAYER_STATE_LOGGED_IN) return false;
+    if (g_replay.recording || g_replay.replaying) return false;
+
+    player_linger(player, g_session_grace_ticks);
+    LOG_INFO("Player '%s' lost connection, session kept for %u ticks\n",
+             player->username, g_session_grace_ticks);
+    return true;
+}
+
+bool session_matches(const Player* session, const LoginBlock* block) {
+    if (!session || !block || session->linger_until == 0) return false;
+    return session->session_uid == block->uid && strcmp(session->password, block->password) == 0;
+}
+
+bool session_resume(Player* session, Player* player) {
+    StreamBuffer* out = player_out(player);
+    buffer_write_byte(out, LOGIN_RESPONSE_OK);
+    if (!player_out_commit(player)) {
+        player_disconnect(player);
+        return false;
+    }
+
+    script_cancel(g_scripts, session);
+    player_take_session(player, session);
+    world_resume_player(g_world, session, player);
+    player_drop(session);
+
+    map_send_load_area(player, position_get_mapsquare_x(&player->position),
+                       position_get_mapsquare_z(&player->position));
+    /*
+     * Reply 2 makes even a reconnecting (type 18) client start over
+     * (client_login): players, interfaces, friend count and chat are
+     * cleared. So both login types get everything a new client needs.
+     */
+    send_login_burst(player);
+    social_send_lists(player);
+    shop_close(g_shops, player);    /* The client closed it */
+
+    LOG_INFO("Player '%s' resumed session (%s)\n", player->username,
+             player->login_reconnect ? "reconnect" : "new client");
+    return true;
+}
@@ -0,0 +1,137 @@
+/*******************************************************************************
+ * SESSION.H - Keeping a Dropped Player's Session for a Fast Reconnect
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Separating a session (game state) from its transport (the socket)
+ *   - Grace periods: treating a dropped connection as probably temporary
+ *   - Moving live state between slots without breaking references to it
+ *
+ * THE PROBLEM:
+ *
+ * A phone switching cells loses its TCP connection for a second or two.
+ * The client notices and logs in again with login type 18 (reconnect),
+ * but the server saw the socket close and logged the player out at once:
+ * save, account release, unregister. The reconnect is then a full login:
+ *
+ *   drop:       save queued, account released, PID freed, NPCs forget them
+ *   reconnect:  login block → worker reads the save → player_load_buffer
+ *               → world_register_player (new PID, new tracking)
+ *               → LOAD_AREA, stats, containers, tabs, design check,
+ *                 welcome messages, [login] scripts
+ *
+ * and the other players see them vanish and reappear.
+ *
+ * THE SOLUTION - LINGER, THEN RE-ATTACH:
+ *
+ *   connection lost (closed, send failed)
+ *     └─ session_linger(): socket closed, player stays in the world
+ *        (same PID, same position, still fightable) for
+ *        g_session_grace_ticks; their output is thrown away
+ *
+ *   login for the same account within the grace period
+ *     └─ session_matches(): same password, same client uid
+ *        session_resume():  the game state moves into the new
+ *        connection's slot, the old slot is freed, and the client gets
+ *
+ *          LOGIN_RESPONSE_OK
+ *          LOAD_AREA
+ *          send_login_burst(), friend and ignore lists
+ *          placement (next PLAYER_INFO); any open shop is closed
+ *
+ *        whether it logged in with type 16 (fresh client) or type 18
+ *        (reconnect): reply 2 resets the 225 client either way, dropping
+ *        its players, interfaces, friend count and chat. The lighter
+ *        LOGIN_RESPONSE_RECONNECT (15), which keeps them, is not used:
+ *        while the session lingered its output was thrown away but its
+ *        tracking moved on, so what the client shows no longer matches.
+ *
+ *        No save is read or applied, nothing is registered, no [login]
+ *        hook runs: for the world the player never left.
+ *
+ *   grace period over
+ *     └─ the connection reaper (player.h) logs the session out normally:
+ *        save, account release, unregister, [logout] hook
+ *
+ * THE SESSION TOKEN:
+ *   The 225 login block has no room for a token the server could hand
+ *   out, so a session is recognized by what the client sends anyway: the
+ *   account's password and the client's uid (a per-install number). A
+ *   login that does not match is refused as "already online", as before.
+ *
+ * WHY MOVE THE STATE, NOT THE SOCKET:
+ *   A connection slot is the network thread's too (netio.h: slot index ==
+ *   player slot), and the new socket already has one. The session's Player
+ *   is copied into the new slot instead. Everything else refers to the
+ *   player by PID (zone grid, combat, aggression, viewers' tracking), and
+ *   the PID moves along; only the PID's list entry is repointed. Scripts,
+ *   which hold a Player*, are cancelled with the old slot.
+ *
+ *   The lingering slot keeps its netio connection (and its number)
+ *   reserved until it is freed, so the network thread cannot hand it to
+ *   another client while the session still sits in it.
+ *
+ * STATE MISSED WHILE OFFLINE:
+ *   Output to a lingering player is dropped. The resumed client starts
+ *   from nothing, so skills, containers, tabs and friend lists are sent
+ *   again, and everything in the area (players, NPCs, ground items) is
+ *   rebuilt from empty tracking.
+ *
+ * LIMITS:
+ *   --session-grace N ticks (default SESSION_GRACE_TICKS, 0 = log out at
+ *   once as before). Off while recording or replaying (replay.h): a
+ *   replay must not depend on when the recorded clients reconnected.
+ *
+ ******************************************************************************/
+
+#ifndef SESSION_H
+#define SESSION_H
+
+#include "types.h"
+#include "player.h"
+#include "login.h"
+#include <stdbool.h>
+
+/* Ticks a dropped session waits for its client (100 ticks = 60 seconds) */
+#define SESSION_GRACE_TICKS 100
+
+/* --session-grace: ticks a session lingers, 0 = never */
+extern u32 g_session_grace_ticks;
+
+/*
+ * session_linger - Keep a player whose connection was lost in the world
+ *
+ * @param player  Player whose socket closed or failed
+ * @return        true if the session lingers (socket closed here);
+ *                false if the caller must disconnect the player (not
+ *                logged in, grace disabled, recording or replaying)
+ */
+bool session_linger(Player* player);
+
+/*
+ * session_matches - Whether a login may take over an online player
+ *
+ * @param session  Online player with the login's username
+ * @param block    Decoded login block
+ * @return         true if session lingers and the credentials match
+ */
+bool session_matches(const Player* session, const LoginBlock* block);
+
+/*
+ * session_resume - Move a lingering session into a new connection
+ *
+ * @param session  Lingering player (session_matches said yes); freed
+ * @param player   New connection, LOGGING_IN or CONNECTED, after
+ *                 login_accept(): ciphers seeded
+ * @return         true if player is now the logged-in session; false if
+ *                 the response could not be sent (player disconnected,
+ *                 session keeps lingering)
+ *
+ * Queues the login response and the resync packets (table above). The
+ * caller publishes the cipher to the network thread, as after
+ * login_complete().
+ */
+bool session_resume(Player* session, Player* player);
+
+#endif /* SESSION_H */
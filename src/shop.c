@@ -0,0 +1,386 @@
+/*******************************************************************************
+ * SHOP.C - Shop Stock, Trades, Viewer Updates and Restock Timers
+ *******************************************************************************
+ *
+ * See shop.h for how changes reach the viewers.
+ *
+ * Trades move one item at a time, so a "Buy 10" that runs out of coins,
+ * space or stock halfway keeps the items already bought. Each step that
+ * cannot finish puts back what it took.
+ *
+ ******************************************************************************/
+
+#include "shop.h"
+#include "broadcast.h"
+#include "server_packets.h"
+#include "packet_codec.h"
+#include "world.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+ShopSystem* g_shops = NULL;
+
+/*******************************************************************************
+ * SHOP TABLE
+ ******************************************************************************/
+
+static const Item general_store_stock[] = {
+    { 1931, 5 },    /* Pot */
+    { 1935, 2 },    /* Jug */
+    { 1735, 2 },    /* Shears */
+    { 1925, 3 },    /* Bucket */
+    { 1923, 2 },    /* Bowl */
+    { 1887, 2 },    /* Cake tin */
+    { 590,  2 },    /* Tinderbox */
+    { 1755, 2 },    /* Chisel */
+    { 946,  2 },    /* Knife */
+    { 2347, 5 },    /* Hammer */
+};
+
+static const Item axe_shop_stock[] = {
+    { 1265, 5 },    /* Bronze pickaxe */
+    { 1351, 10 },   /* Bronze axe */
+    { 1349, 5 },    /* Iron axe */
+    { 1353, 3 },    /* Steel axe */
+    { 1363, 5 },    /* Iron battleaxe */
+    { 1365, 2 },    /* Steel battleaxe */
+    { 1369, 1 },    /* Mithril battleaxe */
+};
+
+#define SHOP_STOCK(items) items, sizeof(items) / sizeof(items[0])
+
+static const ShopDef shop_defs[] = {
+    { "Lumbridge General Store", true,  SHOP_STOCK(general_store_stock) },
+    { "Bob's Brilliant Axes",    false, SHOP_STOCK(axe_shop_stock) },
+};
+
+#define SHOP_DEF_COUNT (sizeof(shop_defs) / sizeof(shop_defs[0]))
+
+/* Default amount of an item in a shop, 0 if it does not stock it */
+static u32 shop_default(const ShopDef* def, u16 id) {
+    for (u32 i = 0; i < def->stock_count; i++) {
+        if (def->stock[i].id == id) return def->stock[i].amount;
+    }
+    return 0;
+}
+
+/*******************************************************************************
+ * CREATE / DESTROY
+ ******************************************************************************/
+
+ShopSystem* shop_system_create(void) {
+    ShopSystem* shops = (ShopSystem*)calloc(1, sizeof(ShopSystem));
+    if (!shops) return NULL;
+
+    shops->shops = (Shop*)calloc(SHOP_DEF_COUNT, sizeof(Shop));
+    shops->dirty = (u16*)malloc(SHOP_DEF_COUNT * sizeof(u16));
+    if (!shops->shops || !shops->dirty) {
+        shop_system_destroy(shops);
+        return NULL;
+    }
+
+    for (u32 i = 0; i < SHOP_DEF_COUNT; i++) {
+        Shop* shop = &shops->shops[i];
+        shop->def = &shop_defs[i];
+        shop->restock = TIMER_NONE;
+        shop->stock = item_container_create_ex(SHOP_SLOTS,
+                                               ITEM_CONTAINER_INDEXED | ITEM_CONTAINER_ALWAYS_STACK);
+        if (!shop->stock) {
+            shop_system_destroy(shops);
+            return NULL;
+        }
+        shops->shop_count++;
+        item_container_add_many(shop->stock, shop->def->stock, shop->def->stock_count);
+        item_container_clear_dirty(shop->stock);
+    }
+
+    printf("Shops: %u shops\n", shops->shop_count);
+    return shops;
+}
+
+void shop_system_destroy(ShopSystem* shops) {
+    if (!shops) return;
+    if (shops->updates > 0 || shops->trades > 0) {
+        printf("Shops: %llu trades, %llu stock updates encoded, %llu sent, %llu restock steps\n",
+               (unsigned long long)shops->trades, (unsigned long long)shops->updates,
+               (unsigned long long)shops->recipients, (unsigned long long)shops->restocks);
+    }
+
+    for (u32 i = 0; i < shops->shop_count; i++) {
+        timer_cancel(g_timers, shops->shops[i].restock);
+        item_container_destroy(shops->shops[i].stock);
+        free(shops->shops[i].viewers);
+    }
+    free(shops->shops);
+    free(shops->dirty);
+    free(shops);
+}
+
+/*******************************************************************************
+ * RESTOCK
+ ******************************************************************************/
+
+static void shop_changed(ShopSystem* shops, Shop* shop);
+
+/*
+ * restock_step - Move every item one step toward the default
+ *
+ * @return  true if anything is still off its default
+ */
+static bool restock_step(Shop* shop) {
+    ItemContainer* stock = shop->stock;
+    const ShopDef* def = shop->def;
+    bool off = false;
+
+    /* Items the shop stocks: up or down by one */
+    for (u32 i = 0; i < def->stock_count; i++) {
+        u32 slot = item_container_find(stock, def->stock[i].id);
+        u32 amount = slot == ITEM_SLOT_NONE ? 0 : stock->items[slot].amount;
+        if (amount < def->stock[i].amount) {
+            item_container_add(stock, def->stock[i].id, 1);
+            amount++;
+        } else if (amount > def->stock[i].amount) {
+            item_container_remove(stock, slot, 1);
+            amount--;
+        }
+        off |= amount != def->stock[i].amount;
+    }
+
+    /* Items sold to it: down by one until gone */
+    for (u32 slot = 0; slot < stock->capacity; slot++) {
+        const Item* item = &stock->items[slot];
+        if (item->id == 0 || shop_default(def, item->id) > 0) continue;
+        item_container_remove(stock, slot, 1);
+        off |= item->id != 0;
+    }
+    return off;
+}
+
+static void shop_restock_fired(void* ctx, u32 arg) {
+    ShopSystem* shops = (ShopSystem*)ctx;
+    Shop* shop = &shops->shops[arg];
+    shop->restock = TIMER_NONE;
+    shops->restocks++;
+
+    if (restock_step(shop)) {
+        shop_changed(shops, shop);
+    } else if (!shop->listed) {
+        /* Back to default: list the last step's slots, no new timer */
+        shops->dirty[shops->dirty_count++] = (u16)arg;
+        shop->listed = true;
+    }
+}
+
+/*
+ * shop_changed - List a shop for this tick's flush and arm its restock
+ */
+static void shop_changed(ShopSystem* shops, Shop* shop) {
+    u32 index = (u32)(shop - shops->shops);
+    if (!shop->listed) {
+        shops->dirty[shops->dirty_count++] = (u16)index;
+        shop->listed = true;
+    }
+    if (!timer_pending(g_timers, shop->restock)) {
+        shop->restock = timer_schedule(g_timers, SHOP_RESTOCK_TICKS, shop_restock_fired, shops, index);
+    }
+}
+
+/*******************************************************************************
+ * VIEWERS
+ ******************************************************************************/
+
+bool shop_open(ShopSystem* shops, Player* player, u32 index) {
+    if (!shops || !player || index >= shops->shop_count || player->index >= MAX_PLAYERS) {
+        return false;
+    }
+    shop_close(shops, player);
+
+    Shop* shop = &shops->shops[index];
+    if (shop->viewer_count == shop->viewer_capacity) {
+        u16 capacity = shop->viewer_capacity ? (u16)(shop->viewer_capacity * 2) : 8;
+        u16* grown = (u16*)realloc(shop->viewers, capacity * sizeof(u16));
+        if (!grown) return false;
+        shop->viewers = grown;
+        shop->viewer_capacity = capacity;
+    }
+    shops->viewer_at[player->index] = shop->viewer_count;
+    shops->viewing[player->index] = (u16)(index + 1);
+    shop->viewers[shop->viewer_count++] = (u16)player->index;
+
+    /* Everything once; from here on only the dirty slots (shop_flush) */
+    send_if_settext(player, SHOP_COMPONENT_TITLE, shop->def->name);
+    send_container_full(player, SHOP_COMPONENT_STOCK, shop->stock);
+    send_container_full(player, SHOP_COMPONENT_SIDE_INV, player->inventory);
+    send_if_opensub(player, SHOP_COMPONENT_MAIN, SHOP_COMPONENT_SIDE);
+    return true;
+}
+
+void shop_close(ShopSystem* shops, Player* player) {
+    if (!shops || !player || player->index >= MAX_PLAYERS) return;
+    u16 viewing = shops->viewing[player->index];
+    if (viewing == 0) return;
+
+    /* Swap-remove from the shop's viewers */
+    Shop* shop = &shops->shops[viewing - 1];
+    u16 at = shops->viewer_at[player->index];
+    u16 last = shop->viewers[--shop->viewer_count];
+    shop->viewers[at] = last;
+    shops->viewer_at[last] = at;
+    shops->viewing[player->index] = 0;
+}
+
+/* The shop the player has open, or NULL */
+static Shop* shop_viewed(ShopSystem* shops, const Player* player) {
+    if (!shops || player->index >= MAX_PLAYERS) return NULL;
+    u16 viewing = shops->viewing[player->index];
+    return viewing ? &shops->shops[viewing - 1] : NULL;
+}
+
+/*******************************************************************************
+ * TRADES
+ ******************************************************************************/
+
+static u32 buy_price(u16 id) {
+    const ItemDefinition* def = item_get_definition(g_items, id);
+    return def && def->value > 1 ? (u32)def->value : 1;
+}
+
+static u32 sell_price(u16 id) {
+    const ItemDefinition* def = item_get_definition(g_items, id);
+    return def && def->value > 0 ? (u32)((u64)def->value * SHOP_SELL_PERCENT / 100) : 0;
+}
+
+static void shop_buy(ShopSystem* shops, Player* player, Shop* shop, u32 slot, u16 id, u32 count) {
+    ItemContainer* inventory = player->inventory;
+    u32 price = buy_price(id);
+    u32 bought = 0;
+
+    for (; bought < count; bought++) {
+        const Item* item = item_container_get(shop->stock, slot);
+        if (!item || item->id != id) {
+            send_player_message(player, "The shop has run out of stock.");
+            break;
+        }
+        u32 coins = item_container_find(inventory, SHOP_COINS);
+        if (coins == ITEM_SLOT_NONE || inventory->items[coins].amount < price) {
+            send_player_message(player, "You don't have enough coins.");
+            break;
+        }
+        item_container_remove(inventory, coins, price);
+        if (!item_container_add(inventory, id, 1)) {
+            item_container_add(inventory, SHOP_COINS, price);
+            send_player_message(player, "You don't have enough inventory space.");
+            break;
+        }
+        item_container_remove(shop->stock, slot, 1);
+    }
+
+    if (bought > 0) {
+        shops->trades += bought;
+        shop_changed(shops, shop);
+    }
+}
+
+static void shop_sell(ShopSystem* shops, Player* player, Shop* shop, u32 slot, u16 id, u32 count) {
+    ItemContainer* inventory = player->inventory;
+    if (id == SHOP_COINS) {
+        send_player_message(player, "You can't sell this item to a shop.");
+        return;
+    }
+    if (!shop->def->general && shop_default(shop->def, id) == 0) {
+        send_player_message(player, "You can't sell this item to this shop.");
+        return;
+    }
+
+    u32 price = sell_price(id);
+    u32 sold = 0;
+    for (; sold < count; sold++) {
+        /* The clicked slot first; unstacked items continue in other slots */
+        if (inventory->items[slot].id != id) slot = item_container_find(inventory, id);
+        if (slot == ITEM_SLOT_NONE) break;
+
+        if (!item_container_add(shop->stock, id, 1)) {
+            send_player_message(player, "The shop is too full.");
+            break;
+        }
+        item_container_remove(inventory, slot, 1);
+        if (price > 0 && !item_container_add(inventory, SHOP_COINS, price)) {
+            item_container_add(inventory, id, 1);
+            item_container_remove(shop->stock, item_container_find(shop->stock, id), 1);
+            send_player_message(player, "You don't have enough inventory space.");
+            break;
+        }
+    }
+
+    if (sold > 0) {
+        shops->trades += sold;
+        shop_changed(shops, shop);
+    }
+}
+
+static void shop_value(Player* player, u16 id, bool buying) {
+    char line[96];
+    const char* name = item_get_name(g_items, id);
+    if (buying) {
+        snprintf(line, sizeof(line), "%s: currently costs %u coins.", name ? name : "It", buy_price(id));
+    } else if (id == SHOP_COINS) {
+        snprintf(line, sizeof(line), "You can't sell this item to a shop.");
+    } else {
+        snprintf(line, sizeof(line), "%s: shop will buy for %u coins.", name ? name : "It", sell_price(id));
+    }
+    send_player_message(player, line);
+}
+
+void shop_handle_inv_button(ShopSystem* shops, Player* player, u32 option, StreamBuffer* buf) {
+    InvButtonPacket button;
+    if (!decode_inv_button(buf, &button)) return;
+
+    Shop* shop = shop_viewed(shops, player);
+    if (!shop || !player->inventory || option < 1 || option > 4) return;
+
+    static const u32 amounts[5] = { 0, 0, 1, 5, 10 };
+    bool buying = button.component == SHOP_COMPONENT_STOCK;
+    if (!buying && button.component != SHOP_COMPONENT_SIDE_INV) return;
+
+    /* The client names the item it shows: it must still be there */
+    const Item* item = item_container_get(buying ? shop->stock : player->inventory, button.slot);
+    if (!item || item->id == 0 || item->id != button.item) return;
+
+    if (option == 1) {
+        shop_value(player, item->id, buying);
+    } else if (buying) {
+        shop_buy(shops, player, shop, button.slot, item->id, amounts[option]);
+    } else {
+        shop_sell(shops, player, shop, button.slot, item->id, amounts[option]);
+    }
+}
+
+/*******************************************************************************
+ * PER-TICK UPDATES
+ ******************************************************************************/
+
+void shop_flush(ShopSystem* shops) {
+    if (!shops) return;
+
+    for (u32 i = 0; i < shops->dirty_count; i++) {
+        Shop* shop = &shops->shops[shops->dirty[i]];
+        shop->listed = false;
+
+        Broadcast b;
+        if (shop->viewer_count > 0 && broadcast_container_begin(&b, SHOP_COMPONENT_STOCK, shop->stock)) {
+            shops->updates++;
+            for (u32 v = 0; v < shop->viewer_count; v++) {
+                Player* viewer = world_get_player_by_index(g_world, shop->viewers[v]);
+                if (viewer && broadcast_send(&b, viewer)) shops->recipients++;
+            }
+            broadcast_end(&b);
+        }
+        item_container_clear_dirty(shop->stock);
+    }
+    shops->dirty_count = 0;
+}
+
+void shop_send_side(ShopSystem* shops, Player* player) {
+    if (shop_viewed(shops, player)) send_container_dirty(player, SHOP_COMPONENT_SIDE_INV, player->inventory);
+}
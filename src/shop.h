@@ -0,0 +1,192 @@
+/*******************************************************************************
+ * SHOP.H - Shared Shop Stock with Per-Tick Viewer Updates
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Shared state with many observers: one container, a set of viewers
+ *   - Deltas instead of snapshots (dirty slots, not the whole shop)
+ *   - Encoding once per tick for every viewer (broadcast.h)
+ *   - Scheduling rare work on the timer wheel instead of polling for it
+ *
+ * THE PROBLEM:
+ *
+ * A shop's stock is one list that everyone with the shop open sees. A
+ * purchase changes it for all of them, so the naive shop re-sends the
+ * whole list to every viewer on every purchase:
+ *
+ *   20 players in the general store, each buying a few pots a tick
+ *     → 60 purchases × 20 viewers × 40 slots = 48000 slots a tick
+ *
+ * and restocking by looking at every shop every tick is work for the
+ * hundreds of shops nobody has touched since boot.
+ *
+ * THE SOLUTION - DIRTY SLOTS, ONE ENCODE, TIMERS:
+ *
+ *   Shop
+ *   ┌──────────────────────────────┐
+ *   │ stock    ItemContainer       │  indexed + always stacking: an id
+ *   │          (item.h)            │  finds its slot in O(1), every
+ *   │                              │  change marks its slot dirty
+ *   │ viewers  [ 12, 407, 1033 ]   │  player indices with it open
+ *   │ restock  timer handle        │  pending while stock is off default
+ *   └──────────────────────────────┘
+ *
+ *   buy / sell ──→ item_container_*() marks the slot dirty
+ *              └─→ shop listed dirty (once per tick)
+ *
+ *   end of tick, shop_flush():
+ *     for each dirty shop:
+ *       encode UPDATE_INV_PARTIAL of its dirty slots   once
+ *       copy it to each viewer (broadcast_send)        per viewer: one
+ *       clear the dirty slots                          ISAAC step + memcpy
+ *
+ *   60 purchases of 3 items: one partial of 3 slots, encoded once, copied
+ *   20 times, instead of 60 × 20 full lists.
+ *
+ * RESTOCK:
+ *   A shop whose stock leaves its default has a timer on the wheel
+ *   (timer_wheel.h). Every SHOP_RESTOCK_TICKS it moves each item one step
+ *   back toward the default (items the shop does not stock decay away)
+ *   and re-arms while anything is still off. An untouched shop costs
+ *   nothing per tick.
+ *
+ * INTERFACES:
+ *   3824 shop window, its stock in 3900 (Value, Buy 1, Buy 5, Buy 10),
+ *   title in 3901; 3822 replaces the sidebar, the inventory shown in 3823
+ *   (Value, Sell 1, Sell 5, Sell 10). The client sends INV_BUTTON1-4 for
+ *   those options and CLOSE_MODAL when the window is closed.
+ *
+ * THREAD SAFETY:
+ *   Game thread only.
+ *
+ ******************************************************************************/
+
+#ifndef SHOP_H
+#define SHOP_H
+
+#include "types.h"
+#include "buffer.h"
+#include "item.h"
+#include "player.h"
+#include "timer_wheel.h"
+#include <stdbool.h>
+
+#define SHOP_COMPONENT_MAIN     3824    /* Shop window */
+#define SHOP_COMPONENT_STOCK    3900    /* Its stock */
+#define SHOP_COMPONENT_TITLE    3901    /* Its name */
+#define SHOP_COMPONENT_SIDE     3822    /* Sidebar while the shop is open */
+#define SHOP_COMPONENT_SIDE_INV 3823    /* The inventory in that sidebar */
+
+/* Slots of the stock component (8 × 5) */
+#define SHOP_SLOTS 40
+
+/* Ticks between restock steps (a minute) */
+#define SHOP_RESTOCK_TICKS 100
+
+/* What a shop pays for an item, in percent of its value */
+#define SHOP_SELL_PERCENT 40
+
+#define SHOP_COINS 995
+
+/*
+ * ShopDef - What a shop stocks (shop.c holds the table)
+ */
+typedef struct {
+    const char* name;
+    bool general;                       /* Buys anything, not just its stock */
+    const Item* stock;                  /* Default amounts */
+    u32 stock_count;
+} ShopDef;
+
+/*
+ * Shop - One shop's live stock and who is looking at it
+ */
+typedef struct {
+    const ShopDef* def;
+    ItemContainer* stock;               /* SHOP_SLOTS, indexed, always stacking */
+    u16* viewers;                       /* Player indices with the shop open */
+    u16 viewer_count;
+    u16 viewer_capacity;
+    TimerHandle restock;                /* Pending while stock is off default */
+    bool listed;                        /* In ShopSystem.dirty this tick */
+} Shop;
+
+/*
+ * ShopSystem - Every shop, and which one each player has open
+ */
+typedef struct {
+    Shop* shops;
+    u32 shop_count;
+
+    u16* dirty;                         /* Shops changed this tick */
+    u32 dirty_count;
+
+    u16 viewing[MAX_PLAYERS];           /* Shop + 1 per player index, 0: none */
+    u16 viewer_at[MAX_PLAYERS];         /* Index in that shop's viewers */
+
+    u64 updates;                        /* Stock updates encoded */
+    u64 recipients;                     /* Copies sent */
+    u64 restocks;                       /* Restock steps */
+    u64 trades;                         /* Items bought and sold */
+} ShopSystem;
+
+/* The world's shops, or NULL */
+extern ShopSystem* g_shops;
+
+/*
+ * shop_system_create - Every shop of the table at its default stock
+ *
+ * @return  System, or NULL on allocation failure
+ */
+ShopSystem* shop_system_create(void);
+
+/*
+ * shop_system_destroy - Free the shops and cancel their restock timers
+ */
+void shop_system_destroy(ShopSystem* shops);
+
+/*
+ * shop_open - Show a shop to a player and start sending it its changes
+ *
+ * @param shop  Index in the table
+ * @return      false if there is no such shop
+ *
+ * Closes the shop the player had open, if any.
+ */
+bool shop_open(ShopSystem* shops, Player* player, u32 shop);
+
+/*
+ * shop_close - Stop sending a player a shop (NULL-safe, no packet)
+ *
+ * For the client closing the window, walking away, a script closing
+ * interfaces, and logout.
+ */
+void shop_close(ShopSystem* shops, Player* player);
+
+/*
+ * shop_handle_inv_button - INV_BUTTON1-4 on the stock or the side inventory
+ *
+ * @param option  1 Value, 2-4 buy or sell 1, 5 or 10
+ *
+ * Other components are ignored.
+ */
+void shop_handle_inv_button(ShopSystem* shops, Player* player, u32 option, StreamBuffer* buf);
+
+/*
+ * shop_flush - Send each changed shop's dirty slots to its viewers
+ *
+ * Called once per tick before the players' own container updates.
+ *
+ * COMPLEXITY: O(changed shops × viewers), one encode per changed shop
+ */
+void shop_flush(ShopSystem* shops);
+
+/*
+ * shop_send_side - Send the player's changed inventory slots to the shop sidebar
+ *
+ * Called per player before the inventory tab's update, which clears them.
+ */
+void shop_send_side(ShopSystem* shops, Player* player);
+
+#endif /* SHOP_H */
@@ -0,0 +1,85 @@
+/*******************************************************************************
+ * SLAB_POOL.C - Slab Pool Implementation
+ *******************************************************************************
+ *
+ * See slab_pool.h for the design.
+ *
+ * Slabs come from mem_calloc(): a slab's objects are only backed by memory
+ * once they are handed out and zeroed, so a large slab costs address
+ * space, not resident pages, until it fills.
+ *
+ ******************************************************************************/
+
+#include "slab_pool.h"
+#include <stdlib.h>
+#include <string.h>
+
+void slab_pool_init(SlabPool* pool, u32 object_size, u32 per_slab, u32 max_objects, MemTag tag) {
+    memset(pool, 0, sizeof(SlabPool));
+    if (object_size < sizeof(void*)) object_size = sizeof(void*);
+    pool->object_size = (object_size + 15) & ~15u;
+    pool->per_slab = per_slab > 0 ? per_slab : 1;
+    pool->max_objects = max_objects;
+    pool->tag = tag;
+}
+
+void slab_pool_destroy(SlabPool* pool) {
+    for (u32 i = 0; i < pool->slab_count; i++) {
+        mem_free(pool->slabs[i]);
+    }
+    mem_free(pool->slabs);
+    u32 object_size = pool->object_size;
+    u32 per_slab = pool->per_slab;
+    u32 max_objects = pool->max_objects;
+    slab_pool_init(pool, object_size, per_slab, max_objects, pool->tag);
+}
+
+/*
+ * add_slab - Allocate one slab and chain its objects onto the free list
+ */
+static bool add_slab(SlabPool* pool) {
+    u32 objects = pool->per_slab;
+    if (pool->max_objects > 0) {
+        u32 held = pool->slab_count * pool->per_slab;
+        if (held >= pool->max_objects) return false;
+        if (objects > pool->max_objects - held) objects = pool->max_objects - held;
+    }
+
+    if (pool->slab_count == pool->slab_capacity) {
+        u32 capacity = pool->slab_capacity ? pool->slab_capacity * 2 : 8;
+        void** slabs = (void**)mem_realloc(pool->tag, pool->slabs, capacity * sizeof(void*));
+        if (!slabs) return false;
+        pool->slabs = slabs;
+        pool->slab_capacity = capacity;
+    }
+
+    /* Always a whole slab, so slab_pool_reserved_bytes() stays exact */
+    u8* slab = (u8*)mem_calloc(pool->tag, pool->per_slab, pool->object_size);
+    if (!slab) return false;
+    pool->slabs[pool->slab_count++] = slab;
+
+    /* Last object first, so the slab is handed out front to back */
+    for (u32 i = objects; i-- > 0;) {
+        void* object = slab + (size_t)i * pool->object_size;
+        *(void**)object = pool->free_head;
+        pool->free_head = object;
+    }
+    return true;
+}
+
+void* slab_pool_alloc(SlabPool* pool) {
+    if (!pool->free_head && !add_slab(pool)) return NULL;
+
+    void* object = pool->free_head;
+    pool->free_head = *(void**)object;
+    memset(object, 0, pool->object_size);
+    pool->in_use++;
+    return object;
+}
+
+void slab_pool_free(SlabPool* pool, void* object) {
+    if (!object) return;
+    *(void**)object = pool->free_head;
+    pool->free_head = object;
+    pool->in_use--;
+}
@@ -0,0 +1,112 @@
+/*******************************************************************************
+ * SLAB_POOL.H - Fixed-Size Objects Carved from Slabs Allocated on Demand
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Slab allocation (many equal objects per malloc)
+ *   - Intrusive free lists (the free object itself holds the link)
+ *   - Paying for capacity when it is used, not when it is possible
+ *
+ * THE PROBLEM:
+ *
+ * Per-connection state was sized for the maximum population up front:
+ *
+ *   GameServer.connections[2048]     15 KB each (ciphers, 5000-byte in
+ *                                    and out buffers)        ~30 MB
+ *   World.player_tracking[2048]      2.8 KB each             ~5.8 MB
+ *
+ * Some of it only looked free. Every slot was initialized at startup,
+ * which touched a page of each connection. Each login cleared one byte
+ * in every viewer's tracking entry, which brought the whole tracking
+ * array into memory after the first login. A test world with three
+ * players paid for 2048, and so did every process on a --worlds host.
+ *
+ * THE SOLUTION - TAKE OBJECTS FROM SLABS AS CONNECTIONS ARRIVE:
+ *
+ *   slab_pool_alloc()    free list empty?  → calloc one slab of
+ *                                            per_slab objects and chain
+ *                                            them onto the free list
+ *                        pop the head, zero it, hand it out
+ *
+ *   slab_pool_free()     push the object back on the free list
+ *
+ *     slab 0  [obj][obj][obj][obj]      slab 1  [obj][obj][obj][obj]
+ *               ▲    │                            ▲
+ *     free ─────┘    └──► ... ────────────────────┘
+ *
+ * Memory follows the peak number of connections, one slab at a time.
+ * The free list is LIFO, so the object handed out next is the one most
+ * recently returned, which is most likely still in cache.
+ *
+ * WHAT IT DOES NOT DO:
+ *   Slabs are never returned to the system before slab_pool_destroy():
+ *   after a peak the objects wait on the free list for the next one.
+ *   Objects are for one thread (the tick thread): there is no lock.
+ *
+ ******************************************************************************/
+
+#ifndef SLAB_POOL_H
+#define SLAB_POOL_H
+
+#include "types.h"
+#include "mem_stats.h"
+#include <stdbool.h>
+
+/*
+ * SlabPool - Equal-sized objects, slabs allocated as needed
+ */
+typedef struct {
+    u32 object_size;            /* Bytes per object (rounded to 16) */
+    u32 per_slab;               /* Objects per slab */
+    u32 max_objects;            /* Objects the pool may hold at most */
+    void** slabs;               /* Every slab allocated */
+    u32 slab_count;
+    u32 slab_capacity;
+    void* free_head;            /* First free object (its first word links on) */
+    u32 in_use;                 /* Objects handed out */
+    MemTag tag;                 /* Slabs are charged to this (mem_stats.h) */
+} SlabPool;
+
+/*
+ * slab_pool_init - Empty pool (allocates nothing yet)
+ *
+ * @param pool         Pool to set up
+ * @param object_size  Bytes per object (at least a pointer)
+ * @param per_slab     Objects per slab (at least 1)
+ * @param max_objects  Cap on objects, including free ones (0 = no cap)
+ * @param tag          Subsystem the slabs count towards
+ */
+void slab_pool_init(SlabPool* pool, u32 object_size, u32 per_slab, u32 max_objects, MemTag tag);
+
+/*
+ * slab_pool_destroy - Free every slab (objects still out become invalid)
+ */
+void slab_pool_destroy(SlabPool* pool);
+
+/*
+ * slab_pool_alloc - Take one zeroed object
+ *
+ * @return  The object, or NULL when the cap is reached or a new slab
+ *          cannot be allocated
+ *
+ * COMPLEXITY: O(object_size) for the zeroing, plus O(per_slab) when a
+ *             slab is added
+ */
+void* slab_pool_alloc(SlabPool* pool);
+
+/*
+ * slab_pool_free - Return an object taken from this pool (NULL is ignored)
+ *
+ * COMPLEXITY: O(1)
+ */
+void slab_pool_free(SlabPool* pool, void* object);
+
+/*
+ * slab_pool_reserved_bytes - Bytes held in slabs, in use or free
+ */
+static inline u64 slab_pool_reserved_bytes(const SlabPool* pool) {
+    return (u64)pool->slab_count * pool->per_slab * pool->object_size;
+}
+
+#endif /* SLAB_POOL_H */
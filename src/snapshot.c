@@ -0,0 +1,281 @@
+/*******************************************************************************
+ * SNAPSHOT.C - Prebuilt World Snapshot Implementation
+ *******************************************************************************
+ *
+ * See snapshot.h for the format and why it exists.
+ *
+ * FINGERPRINT:
+ *
+ *   crc32 of {
+ *     CRC32 of obj.idx, obj.dat, npc.idx, npc.dat, loc.idx, loc.dat,
+ *     sum over map files of crc32(name, size, mtime), map file count,
+ *     layout, SNAPSHOT_VERSION
+ *   }
+ *
+ *   The per-file hashes are summed rather than chained so the result
+ *   does not depend on the order the directory lists them in.
+ *
+ ******************************************************************************/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include "snapshot.h"
+#include "crc32.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+#define SECTION_ALIGN 8
+
+/*******************************************************************************
+ * FINGERPRINT
+ ******************************************************************************/
+
+/* CRC of one directory entry's identity: name, size, modification time */
+static u32 entry_hash(const char* name, u64 size, u64 mtime) {
+    u8 buf[256 + 16];
+    u32 len = (u32)strlen(name);
+    if (len > 256) len = 256;
+    memcpy(buf, name, len);
+    for (u32 i = 0; i < 8; i++) {
+        buf[len + i] = (u8)(size >> (i * 8));
+        buf[len + 8 + i] = (u8)(mtime >> (i * 8));
+    }
+    return crc32(buf, len + 16);
+}
+
+/*
+ * map_dir_hash - Order-independent hash of a directory's files
+ */
+static void map_dir_hash(const char* dir, u32* sum, u32* count) {
+    *sum = 0;
+    *count = 0;
+    if (!dir) return;
+
+#ifdef _WIN32
+    char pattern[512];
+    snprintf(pattern, sizeof(pattern), "%s\\*", dir);
+    WIN32_FIND_DATAA entry;
+    HANDLE handle = FindFirstFileA(pattern, &entry);
+    if (handle == INVALID_HANDLE_VALUE) return;
+    do {
+        if (entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
+        u64 size = ((u64)entry.nFileSizeHigh << 32) | entry.nFileSizeLow;
+        u64 mtime = ((u64)entry.ftLastWriteTime.dwHighDateTime << 32) |
+                    entry.ftLastWriteTime.dwLowDateTime;
+        *sum += entry_hash(entry.cFileName, size, mtime);
+        (*count)++;
+    } while (FindNextFileA(handle, &entry));
+    FindClose(handle);
+#else
+    DIR* handle = opendir(dir);
+    if (!handle) return;
+    struct dirent* entry;
+    while ((entry = readdir(handle)) != NULL) {
+        char path[512];
+        struct stat st;
+        snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+        if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) continue;
+        *sum += entry_hash(entry->d_name, (u64)st.st_size, (u64)st.st_mtime);
+        (*count)++;
+    }
+    closedir(handle);
+#endif
+}
+
+static void put_u32(u8* p, u32 value) {
+    p[0] = (u8)(value >> 24);
+    p[1] = (u8)(value >> 16);
+    p[2] = (u8)(value >> 8);
+    p[3] = (u8)value;
+}
+
+u32 snapshot_fingerprint(CacheSystem* cache, const char* map_dir, u32 layout) {
+    static const char* const files[] = {
+        "obj.idx", "obj.dat", "npc.idx", "npc.dat", "loc.idx", "loc.dat"
+    };
+    enum { FILES = sizeof(files) / sizeof(files[0]) };
+    u8 buf[(FILES + 4) * 4];
+
+    if (!cache) return 0;
+    for (u32 i = 0; i < FILES; i++) {
+        u32 size = 0;
+        const u8* data = cache_get_file(cache, CACHE_ARCHIVE_CONFIG, files[i], &size);
+        if (!data) return 0;
+        put_u32(buf + i * 4, crc32(data, size));
+    }
+
+    u32 map_sum, map_count;
+    map_dir_hash(map_dir, &map_sum, &map_count);
+    put_u32(buf + FILES * 4, map_sum);
+    put_u32(buf + FILES * 4 + 4, map_count);
+    put_u32(buf + FILES * 4 + 8, layout);
+    put_u32(buf + FILES * 4 + 12, SNAPSHOT_VERSION);
+
+    u32 crc = crc32(buf, sizeof(buf));
+    return crc ? crc : 1;
+}
+
+/*******************************************************************************
+ * READING
+ ******************************************************************************/
+
+/*
+ * snapshot_check - Header, bounds and checksums of a mapped file
+ */
+static bool snapshot_check(const MappedFile* file, u32 fingerprint) {
+    if (file->size < sizeof(SnapshotHeader)) return false;
+
+    const SnapshotHeader* header = (const SnapshotHeader*)file->data;
+    if (header->magic != SNAPSHOT_MAGIC || header->version != SNAPSHOT_VERSION ||
+        header->file_size != file->size || header->fingerprint != fingerprint) {
+        return false;
+    }
+
+    for (u32 i = 0; i < SNAPSHOT_SECTION_COUNT; i++) {
+        u64 offset = header->sections[i].offset;
+        u64 bytes = (u64)header->sections[i].count * header->sections[i].elem_size;
+        if (header->sections[i].elem_size == 0 || offset % SECTION_ALIGN != 0 ||
+            offset < sizeof(SnapshotHeader) || offset + bytes > file->size) {
+            return false;
+        }
+        if (crc32(file->data + offset, (size_t)bytes) != header->sections[i].crc) {
+            return false;
+        }
+    }
+    return true;
+}
+
+Snapshot* snapshot_open(const char* path, u32 fingerprint) {
+    if (!path || fingerprint == 0) return NULL;
+
+    Snapshot* snapshot = calloc(1, sizeof(Snapshot));
+    if (!snapshot) return NULL;
+
+    if (!mapped_file_open(&snapshot->file, path)) {
+        free(snapshot);
+        return NULL;
+    }
+    if (!snapshot_check(&snapshot->file, fingerprint)) {
+        printf("Snapshot %s is stale or corrupt, rebuilding\n", path);
+        snapshot_close(snapshot);
+        return NULL;
+    }
+    snapshot->header = (const SnapshotHeader*)snapshot->file.data;
+    return snapshot;
+}
+
+void snapshot_close(Snapshot* snapshot) {
+    if (!snapshot) return;
+    mapped_file_close(&snapshot->file);
+    free(snapshot);
+}
+
+const void* snapshot_section(const Snapshot* snapshot, SnapshotSection section,
+                             u32 elem_size, u32* count) {
+    if (!snapshot || !snapshot->header || (u32)section >= SNAPSHOT_SECTION_COUNT) return NULL;
+    if (snapshot->header->sections[section].elem_size != elem_size) return NULL;
+
+    if (count) *count = snapshot->header->sections[section].count;
+    return snapshot->file.data + snapshot->header->sections[section].offset;
+}
+
+/*******************************************************************************
+ * WRITING
+ ******************************************************************************/
+
+void snapshot_writer_set(SnapshotWriter* writer, SnapshotSection section,
+                         const void* data, u32 elem_size, u32 count) {
+    if (!writer || (u32)section >= SNAPSHOT_SECTION_COUNT) return;
+    free(writer->owned[section]);
+    writer->owned[section] = NULL;
+    writer->data[section] = data;
+    writer->elem_size[section] = elem_size;
+    writer->count[section] = count;
+}
+
+void* snapshot_writer_alloc(SnapshotWriter* writer, SnapshotSection section,
+                            u32 elem_size, u32 count) {
+    if (!writer || (u32)section >= SNAPSHOT_SECTION_COUNT || elem_size == 0) return NULL;
+    /* At least one byte, so an empty section still has a valid pointer */
+    void* buffer = calloc(count ? count : 1, elem_size);
+    if (!buffer) return NULL;
+    snapshot_writer_set(writer, section, buffer, elem_size, count);
+    writer->owned[section] = buffer;
+    return buffer;
+}
+
+void snapshot_writer_free(SnapshotWriter* writer) {
+    if (!writer) return;
+    for (u32 i = 0; i < SNAPSHOT_SECTION_COUNT; i++) {
+        free(writer->owned[i]);
+    }
+    memset(writer, 0, sizeof(SnapshotWriter));
+}
+
+static inline u64 align_up(u64 value) {
+    return (value + SECTION_ALIGN - 1) & ~(u64)(SECTION_ALIGN - 1);
+}
+
+/* Zero bytes written between sections for alignment */
+static bool write_padding(FILE* f, u64 from, u64 to) {
+    static const u8 zeros[SECTION_ALIGN] = { 0 };
+    return to == from || fwrite(zeros, 1, (size_t)(to - from), f) == to - from;
+}
+
+bool snapshot_writer_save(const SnapshotWriter* writer, const char* path, u32 fingerprint) {
+    if (!writer || !path || fingerprint == 0) return false;
+
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = SNAPSHOT_MAGIC;
+    header.version = SNAPSHOT_VERSION;
+    header.fingerprint = fingerprint;
+
+    u64 offset = align_up(sizeof(SnapshotHeader));
+    for (u32 i = 0; i < SNAPSHOT_SECTION_COUNT; i++) {
+        if (!writer->data[i] || writer->elem_size[i] == 0) return false;  /* Only complete files */
+        u64 bytes = (u64)writer->count[i] * writer->elem_size[i];
+        header.sections[i].offset = (u32)offset;
+        header.sections[i].count = writer->count[i];
+        header.sections[i].elem_size = writer->elem_size[i];
+        header.sections[i].crc = crc32(writer->data[i], (size_t)bytes);
+        offset = align_up(offset + bytes);
+        if (offset > UINT32_MAX) return false;
+    }
+    header.file_size = (u32)offset;
+
+    char tmp[512];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE* f = fopen(tmp, "wb");
+    if (!f) return false;
+
+    u64 written = sizeof(header);
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+    for (u32 i = 0; ok && i < SNAPSHOT_SECTION_COUNT; i++) {
+        u64 bytes = (u64)writer->count[i] * writer->elem_size[i];
+        ok = write_padding(f, written, header.sections[i].offset) &&
+             fwrite(writer->data[i], 1, (size_t)bytes, f) == bytes;
+        written = header.sections[i].offset + bytes;
+    }
+    ok = ok && write_padding(f, written, header.file_size);
+    ok = (fclose(f) == 0) && ok;
+
+#ifdef _WIN32
+    remove(path);  /* rename() does not replace an existing file on Windows */
+#endif
+    if (!ok || rename(tmp, path) != 0) {
+        remove(tmp);
+        return false;
+    }
+    printf("Wrote snapshot %s (%u bytes, %u sections)\n", path, header.file_size,
+           (u32)SNAPSHOT_SECTION_COUNT);
+    return true;
+}
@@ -0,0 +1,192 @@
+/*******************************************************************************
+ * SNAPSHOT.H - Prebuilt World Snapshot: One Mapped File for Every Table
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Build-once / load-many data images (like a linker's output)
+ *   - Relocatable formats: offsets instead of pointers
+ *   - Validating untrusted bytes cheaply (fingerprint, then checksums)
+ *   - Atomic replacement of a file with write-then-rename
+ *
+ * THE PROBLEM:
+ *
+ * Every boot rebuilt the same derived data from data/ piece by piece:
+ *
+ *   map_store_create       open + map + CRC + chunk ~1450 map files
+ *   world_collision_create unpack every region, run the client's
+ *                          collision code, pack ~750 pages      (~150ms)
+ *   *_system_init          decode obj / npc / loc .dat
+ *
+ * None of it changes unless the cache or the maps change, yet a rolling
+ * restart paid for all of it before accepting a single login.
+ *
+ * THE SOLUTION - ONE SNAPSHOT FILE:
+ *
+ * After a boot that built the tables, they are written to one file:
+ *
+ *   ┌────────┬───────┬─────┬──────┬─────┬──────┬──────┬───────┬───────┐
+ *   │ header │ items │ ... │ pool │ map │ map  │ page │ pages │ (pad) │
+ *   │        │       │     │      │ rec │ bytes│ index│       │       │
+ *   └────────┴───────┴─────┴──────┴─────┴──────┴──────┴───────┴───────┘
+ *
+ * The next boot maps it read-only and every system points its arrays
+ * straight into the mapping. Sections refer to each other by offset only
+ * (map records hold offsets into the map bytes, text tables hold offsets
+ * into the pool), so the file works wherever it is mapped.
+ *
+ * VALIDATION:
+ *
+ *   1. fingerprint - CRC over what the tables are derived from: the
+ *      obj/npc/loc config files, the name, size and modification time of
+ *      every map file, the struct layout, and SNAPSHOT_VERSION. A new
+ *      cache, an edited map or a rebuilt server with a different struct
+ *      makes it mismatch, and the snapshot is rebuilt.
+ *   2. header     - magic, version, size, every section 8-byte aligned
+ *      and inside the file, with its element size.
+ *   3. checksums  - CRC32 of every section, checked once at open. A
+ *      truncated or corrupted file is rejected as a whole; it is never
+ *      half-used.
+ *
+ * BUILDING:
+ *
+ *   The server writes the snapshot itself after any boot that had to
+ *   build something (no snapshot, stale, corrupt). `make snapshot`
+ *   (rs225 --build-snapshot) does the same without starting the server,
+ *   for deploy pipelines that ship the file next to the binary.
+ *
+ ******************************************************************************/
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "types.h"
+#include "cache.h"
+#include "mapped_file.h"
+#include <stdbool.h>
+
+#define SNAPSHOT_PATH "data/world.snap"
+#define SNAPSHOT_MAGIC 0x50414E53u      /* "SNAP" little-endian */
+#define SNAPSHOT_VERSION 2              /* Bump when a section's meaning changes */
+
+/*
+ * SnapshotSection - Every table the snapshot holds
+ *
+ * The first six are DefStore's tables (def_store.h uses the same values).
+ */
+typedef enum {
+    SNAPSHOT_ITEMS,
+    SNAPSHOT_ITEM_TEXT,
+    SNAPSHOT_NPCS,
+    SNAPSHOT_NPC_TEXT,
+    SNAPSHOT_OBJECTS,
+    SNAPSHOT_OBJECT_TEXT,
+    SNAPSHOT_STRINGS,           /* DefStore string pool (elem_size 1) */
+    SNAPSHOT_MAP_FILES,         /* MapFileRecord per map file */
+    SNAPSHOT_MAP_BYTES,         /* Map file contents + encoded chunks */
+    SNAPSHOT_COLLISION_INDEX,   /* WorldCollision.page_index */
+    SNAPSHOT_COLLISION_PAGES,   /* One WORLD_PAGE_TILES page per element */
+    SNAPSHOT_STATIC_LOC_INDEX,  /* StaticLocs.first (STATIC_LOC_SQUARES + 1) */
+    SNAPSHOT_STATIC_LOCS,       /* StaticLoc per map loc */
+    SNAPSHOT_SECTION_COUNT
+} SnapshotSection;
+
+/*
+ * SnapshotHeader - First bytes of the snapshot file
+ */
+typedef struct {
+    u32 magic;
+    u32 version;
+    u32 fingerprint;            /* snapshot_fingerprint() it was built for */
+    u32 file_size;
+    struct {
+        u32 offset;
+        u32 count;
+        u32 elem_size;
+        u32 crc;                /* CRC32 of count * elem_size bytes */
+    } sections[SNAPSHOT_SECTION_COUNT];
+} SnapshotHeader;
+
+/*
+ * Snapshot - A validated, mapped snapshot file
+ */
+typedef struct {
+    MappedFile file;
+    const SnapshotHeader* header;
+} Snapshot;
+
+/*
+ * snapshot_fingerprint - Identity of the sources a snapshot is built from
+ *
+ * @param cache    Cache with the config archive
+ * @param map_dir  Map directory (e.g. "data/maps")
+ * @param layout   Caller's hash of the struct sizes stored in sections
+ * @return         Fingerprint, or 0 if the config files are missing
+ *                 (no snapshot is read or written then)
+ *
+ * Map files are identified by name, size and modification time, so the
+ * fingerprint costs one directory listing, not a read of every map.
+ */
+u32 snapshot_fingerprint(CacheSystem* cache, const char* map_dir, u32 layout);
+
+/*
+ * snapshot_open - Map and validate a snapshot
+ *
+ * @param path         Snapshot file (SNAPSHOT_PATH)
+ * @param fingerprint  Expected snapshot_fingerprint(); 0 never matches
+ * @return             Snapshot, or NULL if missing, stale or corrupt
+ *
+ * COMPLEXITY: O(file size) - one CRC pass over every section
+ */
+Snapshot* snapshot_open(const char* path, u32 fingerprint);
+
+/*
+ * snapshot_close - Unmap a snapshot (NULL-safe)
+ *
+ * Every table pointing into it must be gone first.
+ */
+void snapshot_close(Snapshot* snapshot);
+
+/*
+ * snapshot_section - One table of an open snapshot
+ *
+ * @param snapshot   Snapshot (NULL-safe)
+ * @param section    Table wanted
+ * @param elem_size  sizeof() the caller's element
+ * @param count      Receives the element count
+ * @return           Read-only table, or NULL if absent or elem_size differs
+ */
+const void* snapshot_section(const Snapshot* snapshot, SnapshotSection section,
+                             u32 elem_size, u32* count);
+
+/*
+ * SnapshotWriter - Sections collected for snapshot_writer_save()
+ *
+ * Sections either point at tables that stay alive until the save
+ * (snapshot_writer_set) or are buffers the writer owns
+ * (snapshot_writer_alloc), freed by snapshot_writer_free().
+ */
+typedef struct {
+    const void* data[SNAPSHOT_SECTION_COUNT];
+    u32 count[SNAPSHOT_SECTION_COUNT];
+    u32 elem_size[SNAPSHOT_SECTION_COUNT];
+    void* owned[SNAPSHOT_SECTION_COUNT];
+} SnapshotWriter;
+
+void snapshot_writer_set(SnapshotWriter* writer, SnapshotSection section,
+                         const void* data, u32 elem_size, u32 count);
+void* snapshot_writer_alloc(SnapshotWriter* writer, SnapshotSection section,
+                            u32 elem_size, u32 count);
+void snapshot_writer_free(SnapshotWriter* writer);
+
+/*
+ * snapshot_writer_save - Write every section to path
+ *
+ * @return  false if a section is missing, fingerprint is 0, or the write
+ *          fails. Writes path.tmp, then renames it over path, so a crash
+ *          mid-write never leaves a truncated snapshot behind (and a
+ *          process still mapping the old file keeps its view).
+ */
+bool snapshot_writer_save(const SnapshotWriter* writer, const char* path, u32 fingerprint);
+
+#endif /* SNAPSHOT_H */
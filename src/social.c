@@ -0,0 +1,412 @@
+/*******************************************************************************
+ * SOCIAL.C - Friend and Ignore Lists, Presence Fan-Out, Private Messages
+ *******************************************************************************
+ *
+ * See social.h for the reverse index and the per-tick flush.
+ *
+ * Watcher arrays are unordered (removal swaps the last index in): a
+ * name's watchers are only ever visited all together.
+ *
+ ******************************************************************************/
+
+#include "social.h"
+#include "chat.h"
+#include "command.h"
+#include "log.h"
+#include "packet_codec.h"
+#include "presence.h"
+#include "server_packets.h"
+#include "update.h"
+#include "world.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+SocialSystem* g_social = NULL;
+
+static inline ISAACCipher* social_cipher(Player* player) {
+    return player->conn->out_cipher.initialized ? &player->conn->out_cipher : NULL;
+}
+
+/* World byte the client shows for a world index (-1: offline) */
+static inline u8 social_world_byte(i32 world) {
+    return world < 0 ? 0 : (u8)(world + SOCIAL_WORLD_BASE);
+}
+
+/*******************************************************************************
+ * SORTED NAME ARRAYS
+ ******************************************************************************/
+
+/* Index of name, or where it would be inserted */
+static u32 names_lower_bound(const u64* names, u32 count, u64 name) {
+    u32 lo = 0, hi = count;
+    while (lo < hi) {
+        u32 mid = (lo + hi) / 2;
+        if (names[mid] < name) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/* Index of name, or -1 */
+static i32 names_find(const u64* names, u32 count, u64 name) {
+    u32 at = names_lower_bound(names, count, name);
+    return at < count && names[at] == name ? (i32)at : -1;
+}
+
+static inline bool name_valid(u64 name) {
+    return name != 0 && name <= SOCIAL_NAME_MAX;
+}
+
+void social_list_reset(SocialList* list) {
+    list->friend_count = 0;
+    list->ignore_count = 0;
+}
+
+bool social_list_add_friend(SocialList* list, u64 name) {
+    if (!name_valid(name) || list->friend_count >= SOCIAL_FRIENDS_MAX) return false;
+    u32 at = names_lower_bound(list->friends, list->friend_count, name);
+    if (at < list->friend_count && list->friends[at] == name) return false;
+
+    u32 tail = list->friend_count - at;
+    memmove(&list->friends[at + 1], &list->friends[at], tail * sizeof(u64));
+    memmove(&list->worlds[at + 1], &list->worlds[at], tail);
+    list->friends[at] = name;
+    list->worlds[at] = 0;
+    list->friend_count++;
+    return true;
+}
+
+bool social_list_add_ignore(SocialList* list, u64 name) {
+    if (!name_valid(name) || list->ignore_count >= SOCIAL_IGNORES_MAX) return false;
+    u32 at = names_lower_bound(list->ignores, list->ignore_count, name);
+    if (at < list->ignore_count && list->ignores[at] == name) return false;
+
+    memmove(&list->ignores[at + 1], &list->ignores[at], (list->ignore_count - at) * sizeof(u64));
+    list->ignores[at] = name;
+    list->ignore_count++;
+    return true;
+}
+
+static bool social_list_remove_friend(SocialList* list, u64 name) {
+    i32 at = names_find(list->friends, list->friend_count, name);
+    if (at < 0) return false;
+    u32 tail = list->friend_count - (u32)at - 1;
+    memmove(&list->friends[at], &list->friends[at + 1], tail * sizeof(u64));
+    memmove(&list->worlds[at], &list->worlds[at + 1], tail);
+    list->friend_count--;
+    return true;
+}
+
+static bool social_list_remove_ignore(SocialList* list, u64 name) {
+    i32 at = names_find(list->ignores, list->ignore_count, name);
+    if (at < 0) return false;
+    memmove(&list->ignores[at], &list->ignores[at + 1],
+            (list->ignore_count - (u32)at - 1) * sizeof(u64));
+    list->ignore_count--;
+    return true;
+}
+
+/*******************************************************************************
+ * SYSTEM
+ ******************************************************************************/
+
+SocialSystem* social_system_create(void) {
+    SocialSystem* social = (SocialSystem*)calloc(1, sizeof(SocialSystem));
+    if (!social) return NULL;
+
+    social->watchers = probetable_new(1024);
+    social->pending_index = probetable_new(256);
+    if (!social->watchers || !social->pending_index) {
+        social_system_destroy(social);
+        return NULL;
+    }
+    social->next_message_id = (u32)time(NULL) << 4;
+    return social;
+}
+
+void social_system_destroy(SocialSystem* social) {
+    if (!social) return;
+    if (social->changes > 0 || social->messages > 0) {
+        printf("Social: %llu presence changes, %llu status packets, %llu private messages\n",
+               (unsigned long long)social->changes, (unsigned long long)social->status_sent,
+               (unsigned long long)social->messages);
+    }
+
+    for (u32 i = 0; social->watchers && i <= social->watchers->mask; i++) {
+        SocialWatchers* set = (SocialWatchers*)social->watchers->slots[i].value;
+        if (!set) continue;
+        free(set->indices);
+        free(set);
+    }
+    probetable_free(social->watchers);
+    probetable_free(social->pending_index);
+    free(social->pending);
+    free(social);
+}
+
+/*******************************************************************************
+ * REVERSE INDEX
+ ******************************************************************************/
+
+static void watch(SocialSystem* social, u64 name, u16 index) {
+    SocialWatchers* set = (SocialWatchers*)probetable_get(social->watchers, (i64)name);
+    if (!set) {
+        set = (SocialWatchers*)calloc(1, sizeof(SocialWatchers));
+        if (!set) return;
+        set->name = name;
+        if (!probetable_put(social->watchers, (i64)name, set)) {
+            free(set);
+            return;
+        }
+        social->watched++;
+    }
+    if (set->count == set->capacity) {
+        u16 capacity = set->capacity ? (u16)(set->capacity * 2) : 4;
+        u16* grown = (u16*)realloc(set->indices, capacity * sizeof(u16));
+        if (!grown) return;
+        set->indices = grown;
+        set->capacity = capacity;
+    }
+    set->indices[set->count++] = index;
+}
+
+static void unwatch(SocialSystem* social, u64 name, u16 index) {
+    SocialWatchers* set = (SocialWatchers*)probetable_get(social->watchers, (i64)name);
+    if (!set) return;
+    for (u32 i = 0; i < set->count; i++) {
+        if (set->indices[i] != index) continue;
+        set->indices[i] = set->indices[--set->count];
+        break;
+    }
+    if (set->count == 0) {
+        probetable_remove(social->watchers, (i64)name, set);
+        free(set->indices);
+        free(set);
+        social->watched--;
+    }
+}
+
+/*******************************************************************************
+ * PACKETS
+ ******************************************************************************/
+
+static void send_friend_status(Player* player, u64 name, u8 world) {
+    StreamBuffer* out = player_out(player);
+    encode_update_friendlist(out, social_cipher(player), name, world);
+    dbg_log_send("UPDATE_FRIENDLIST", SERVER_UPDATE_FRIENDLIST, "fixed",
+                 SERVER_UPDATE_FRIENDLIST_SIZE, social_cipher(player) != NULL);
+    player_out_commit(player);
+}
+
+static void send_ignore_list(Player* player, const SocialList* list) {
+    ISAACCipher* enc = social_cipher(player);
+    StreamBuffer* out = player_out(player);
+    buffer_write_header_var(out, SERVER_UPDATE_IGNORELIST, enc, VAR_SHORT);
+    u32 payload_start = out->position;
+    for (u32 i = 0; i < list->ignore_count; i++) {
+        buffer_write_long(out, list->ignores[i]);
+    }
+    buffer_finish_var_header(out, VAR_SHORT);
+    dbg_log_send("UPDATE_IGNORELIST", SERVER_UPDATE_IGNORELIST, "varshort",
+                 (int)(out->position - payload_start), enc != NULL);
+    player_out_commit(player);
+}
+
+void social_send_lists(Player* player) {
+    if (!player || player->index >= MAX_PLAYERS) return;
+    SocialList* list = &player->social;
+
+    send_ignore_list(player, list);
+    for (u32 i = 0; i < list->friend_count; i++) {
+        list->worlds[i] = social_world_byte(presence_find_name(list->friends[i]));
+        send_friend_status(player, list->friends[i], list->worlds[i]);
+    }
+}
+
+/*******************************************************************************
+ * LOGIN / LOGOUT
+ ******************************************************************************/
+
+void social_player_login(SocialSystem* social, Player* player) {
+    if (!player || player->index >= MAX_PLAYERS) return;
+    const SocialList* list = &player->social;
+    for (u32 i = 0; social && i < list->friend_count; i++) {
+        watch(social, list->friends[i], (u16)player->index);
+    }
+    social_send_lists(player);
+}
+
+void social_player_logout(SocialSystem* social, const Player* player) {
+    if (!social || !player || player->index >= MAX_PLAYERS) return;
+    const SocialList* list = &player->social;
+    for (u32 i = 0; i < list->friend_count; i++) {
+        unwatch(social, list->friends[i], (u16)player->index);
+    }
+}
+
+/*******************************************************************************
+ * PRESENCE FAN-OUT
+ ******************************************************************************/
+
+void social_presence_changed(SocialSystem* social, u64 name, i32 world) {
+    if (!social || !name_valid(name)) return;
+    social->changes++;
+
+    /* Already pending this tick: the later state wins */
+    uintptr_t slot = (uintptr_t)probetable_get(social->pending_index, (i64)name);
+    if (slot) {
+        social->pending[slot - 1].world = world;
+        return;
+    }
+
+    if (social->pending_count == social->pending_capacity) {
+        u32 capacity = social->pending_capacity ? social->pending_capacity * 2 : 64;
+        SocialChange* grown = (SocialChange*)realloc(social->pending, capacity * sizeof(SocialChange));
+        if (!grown) return;
+        social->pending = grown;
+        social->pending_capacity = capacity;
+    }
+    if (!probetable_put(social->pending_index, (i64)name,
+                        (void*)(uintptr_t)(social->pending_count + 1))) {
+        return;
+    }
+    social->pending[social->pending_count++] = (SocialChange){ name, world };
+}
+
+/* Tell one name's watchers; returns the packets sent */
+static u32 fan_out(const SocialChange* change) {
+    SocialWatchers* set = (SocialWatchers*)probetable_get(g_social->watchers, (i64)change->name);
+    if (!set) return 0;
+
+    u8 world = social_world_byte(change->world);
+    u32 sent = 0;
+    for (u32 i = 0; i < set->count; i++) {
+        Player* watcher = world_get_player_by_index(g_world, set->indices[i]);
+        if (!watcher || watcher->state != PLAYER_STATE_LOGGED_IN) continue;
+
+        SocialList* list = &watcher->social;
+        i32 at = names_find(list->friends, list->friend_count, change->name);
+        if (at < 0 || list->worlds[at] == world) continue;     /* Flapped back, or known */
+        list->worlds[at] = world;
+        send_friend_status(watcher, change->name, world);
+        sent++;
+    }
+    return sent;
+}
+
+void social_tick(SocialSystem* social) {
+    if (!social || social->pending_count == 0) return;
+
+    /* Whole names until the budget is spent; the rest wait a tick */
+    u32 sent = 0;
+    u32 done = 0;
+    while (done < social->pending_count && sent < SOCIAL_FANOUT_PER_TICK) {
+        const SocialChange* change = &social->pending[done++];
+        probetable_remove(social->pending_index, (i64)change->name, (void*)(uintptr_t)done);
+        sent += fan_out(change);
+    }
+    social->status_sent += sent;
+
+    /* Slide the rest down and renumber them */
+    social->pending_count -= done;
+    memmove(social->pending, social->pending + done, social->pending_count * sizeof(SocialChange));
+    for (u32 i = 0; i < social->pending_count; i++) {
+        probetable_put(social->pending_index, (i64)social->pending[i].name, (void*)(uintptr_t)(i + 1));
+    }
+}
+
+/*******************************************************************************
+ * PACKET HANDLERS
+ ******************************************************************************/
+
+void social_handle_friend_add(SocialSystem* social, Player* player, StreamBuffer* buf) {
+    SocialNamePacket packet;
+    if (!decode_social_name(buf, &packet) || player->index >= MAX_PLAYERS) return;
+    if (packet.name == username_to_base37(player->username)) return;
+
+    SocialList* list = &player->social;
+    if (names_find(list->ignores, list->ignore_count, packet.name) >= 0) return;
+    if (!social_list_add_friend(list, packet.name)) return;
+    player->save_dirty = true;
+
+    /* The client listed the name as offline: correct it now */
+    if (social) watch(social, packet.name, (u16)player->index);
+    i32 at = names_find(list->friends, list->friend_count, packet.name);
+    list->worlds[at] = social_world_byte(presence_find_name(packet.name));
+    if (list->worlds[at] != 0) send_friend_status(player, packet.name, list->worlds[at]);
+}
+
+void social_handle_friend_del(SocialSystem* social, Player* player, StreamBuffer* buf) {
+    SocialNamePacket packet;
+    if (!decode_social_name(buf, &packet) || player->index >= MAX_PLAYERS) return;
+    if (!social_list_remove_friend(&player->social, packet.name)) return;
+    player->save_dirty = true;
+    if (social) unwatch(social, packet.name, (u16)player->index);
+}
+
+void social_handle_ignore_add(Player* player, StreamBuffer* buf) {
+    SocialNamePacket packet;
+    if (!decode_social_name(buf, &packet) || player->index >= MAX_PLAYERS) return;
+    SocialList* list = &player->social;
+    if (names_find(list->friends, list->friend_count, packet.name) >= 0) return;
+    if (social_list_add_ignore(list, packet.name)) player->save_dirty = true;
+}
+
+void social_handle_ignore_del(Player* player, StreamBuffer* buf) {
+    SocialNamePacket packet;
+    if (!decode_social_name(buf, &packet) || player->index >= MAX_PLAYERS) return;
+    if (social_list_remove_ignore(&player->social, packet.name)) {
+        player->save_dirty = true;
+    }
+}
+
+void social_handle_private(SocialSystem* social, Player* player, StreamBuffer* buf,
+                           u32 packet_length) {
+    /* [name:8] then at least one packed byte */
+    MessagePrivatePacket packet;
+    if (packet_length < 9 || packet_length - 8 > CHAT_PACKED_MAX ||
+        !buffer_require(buf, packet_length) || !decode_message_private(buf, &packet)) {
+        LOG_DEBUG("Dropping MESSAGE_PRIVATE from %s: length %u\n", player->username, packet_length);
+        return;
+    }
+    u8 packed[CHAT_PACKED_MAX];
+    u32 length = packet_length - 8;
+    buffer_get_bytes(buf, packed, length);
+
+    /* Only this world: presence frames carry no text (social.h) */
+    Player* to = world_get_player_by_name(g_world, packet.name);
+    if (!to || to->state != PLAYER_STATE_LOGGED_IN) {
+        send_player_message(player, "Unable to send message - player unavailable.");
+        return;
+    }
+
+    /* Ignored senders are told nothing, as if it went through */
+    u64 from = username_to_base37(player->username);
+    const SocialList* list = &to->social;
+    if (player->rights == PLAYER_RIGHTS_NONE &&
+        names_find(list->ignores, list->ignore_count, from) >= 0) {
+        return;
+    }
+
+    length = chat_filter_packed(packed, length);
+
+    /* [from:8][message id:4][rights:1][packed text] */
+    ISAACCipher* enc = social_cipher(to);
+    StreamBuffer* out = player_out(to);
+    buffer_write_header_var(out, SERVER_MESSAGE_PRIVATE, enc, VAR_BYTE);
+    u32 payload_start = out->position;
+    buffer_write_long(out, from);
+    buffer_write_int(out, social ? social->next_message_id++ : 0, BYTE_ORDER_BIG);
+    buffer_write_byte(out, player->rights);
+    buffer_write_bytes(out, packed, length);
+    buffer_finish_var_header(out, VAR_BYTE);
+    dbg_log_send("MESSAGE_PRIVATE", SERVER_MESSAGE_PRIVATE, "varbyte",
+                 (int)(out->position - payload_start), enc != NULL);
+    player_out_commit(to);
+    if (social) social->messages++;
+}
@@ -0,0 +1,215 @@
+/*******************************************************************************
+ * SOCIAL.H - Friend Lists, Ignore Lists and Private Messages
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Sorted arrays as small sets (binary search, no hashing, no nodes)
+ *   - Reverse indexes: answering "who has me?" without scanning everyone
+ *   - Coalescing events per tick (last write wins, flaps cancel out)
+ *   - Bounding a fan-out: a per-tick budget instead of a burst
+ *
+ * THE PROBLEM:
+ *
+ * A friend list is a list of names; the client shows each with the world
+ * its owner is on, and says "alice has logged in." when that changes. The
+ * change happens to alice, but the packets go to everyone who added her:
+ *
+ *   alice logs in ──→ who has alice on their list?
+ *                       scan 2000 players × 100 friends each = 200000
+ *                       compares, at every login and logout
+ *
+ * and answering at once, packet by packet, means a popular player logging
+ * in fires a thousand one-off sends in the middle of the login, and one
+ * who logs in and out in the same tick fires two thousand.
+ *
+ * THE SOLUTION - SORTED LISTS, A REVERSE INDEX, ONE FLUSH PER TICK:
+ *
+ *   SocialList (player.h, in the player and saved with it):
+ *     friends[]  sorted base-37 names ──→ binary search, O(log 100)
+ *     worlds[]   world last sent to the client, per friend
+ *     ignores[]  sorted base-37 names
+ *
+ *   watchers (ProbeTable, name → indices of players online here who
+ *   have that name on their list):
+ *
+ *     "alice" ──→ [ 12, 407, 1033 ]
+ *     "bob"   ──→ [ 12 ]
+ *
+ *   presence change (presence.h: login, logout, another world's frame)
+ *     └─→ social_presence_changed(): pending[name] = world   (no packet)
+ *
+ *   end of tick, social_tick():
+ *     for each pending name:          last state of the tick only
+ *       for each watcher:             reverse index, no scan
+ *         worlds[friend] differs?  ──→ UPDATE_FRIENDLIST into its output
+ *
+ *   Every packet joins the watcher's other output for the tick and leaves
+ *   with it in one send (player_flush). A name that came and went within
+ *   the tick is back where its watchers last saw it, so it sends nothing.
+ *
+ * BUDGET:
+ *   A tick sends at most SOCIAL_FANOUT_PER_TICK status packets. Names
+ *   past the budget stay pending for the next tick, so a mass login
+ *   (a world restart, every player coming back at once) is spread over
+ *   a few ticks instead of landing in one.
+ *
+ * PRIVATE MESSAGES:
+ *   MESSAGE_PRIVATE carries wordpacked text like public chat (chat.h) and
+ *   goes through the same filter. The recipient must be on this world
+ *   and not be ignoring the sender; presence frames carry no text, so a
+ *   friend on another world is answered as unavailable.
+ *
+ * WORLD NUMBERS:
+ *   The client counts worlds from SOCIAL_WORLD_BASE (its nodeid: world 1
+ *   is 10) and takes 0 as offline.
+ *
+ * THREAD SAFETY:
+ *   Game thread only. Saves read the lists (player_save.c) while the
+ *   player is serialized on the game thread.
+ *
+ ******************************************************************************/
+
+#ifndef SOCIAL_H
+#define SOCIAL_H
+
+#include "types.h"
+#include "buffer.h"
+#include "player.h"
+#include "datastruct/probetable.h"
+#include <stdbool.h>
+
+/* World byte of world index 0 (the client's nodeid) */
+#define SOCIAL_WORLD_BASE 10
+
+/* UPDATE_FRIENDLIST packets a tick may send */
+#define SOCIAL_FANOUT_PER_TICK 2048
+
+/* Largest base-37 name: twelve 'z's (37^12 - 1) */
+#define SOCIAL_NAME_MAX 6582952005840035280ULL
+
+/*
+ * SocialWatchers - Players online here with one name on their list
+ */
+typedef struct {
+    u64 name;
+    u16* indices;
+    u16 count;
+    u16 capacity;
+} SocialWatchers;
+
+/* One name whose world changed this tick */
+typedef struct {
+    u64 name;
+    i32 world;                          /* World index, -1 offline */
+} SocialChange;
+
+/*
+ * SocialSystem - Reverse index and this tick's changes
+ */
+typedef struct {
+    ProbeTable* watchers;               /* name → SocialWatchers* */
+    u32 watched;                        /* Names with watchers */
+
+    SocialChange* pending;              /* In arrival order, one per name */
+    u32 pending_count;
+    u32 pending_capacity;
+    ProbeTable* pending_index;          /* name → pending slot + 1 */
+
+    u32 next_message_id;
+    u64 changes;                        /* Changes coalesced into pending */
+    u64 status_sent;                    /* UPDATE_FRIENDLIST packets */
+    u64 messages;                       /* Private messages delivered */
+} SocialSystem;
+
+/* The world's social system, or NULL (lists are kept, nothing is told) */
+extern SocialSystem* g_social;
+
+/*
+ * social_system_create - Empty reverse index
+ *
+ * @return  System, or NULL on allocation failure
+ */
+SocialSystem* social_system_create(void);
+
+/*
+ * social_system_destroy - Free the index (NULL-safe); lists are untouched
+ */
+void social_system_destroy(SocialSystem* social);
+
+/*
+ * social_list_reset - Empty a player's lists (a new or reloaded player)
+ */
+void social_list_reset(SocialList* list);
+
+/*
+ * social_list_add_friend / social_list_add_ignore - Insert, keeping order
+ *
+ * @return  false if the name is invalid, present or the list full
+ *
+ * For the save loader: no watcher is registered.
+ */
+bool social_list_add_friend(SocialList* list, u64 name);
+bool social_list_add_ignore(SocialList* list, u64 name);
+
+/*
+ * social_player_login - Watch the player's friends and send both lists
+ *
+ * Called once the player is in the world. Each friend's world comes
+ * from presence_find_name().
+ *
+ * COMPLEXITY: O(friends) lookups and packets
+ */
+void social_player_login(SocialSystem* social, Player* player);
+
+/*
+ * social_send_lists - Send both lists again (a client that started over)
+ */
+void social_send_lists(Player* player);
+
+/*
+ * social_player_logout - Stop watching the player's friends
+ */
+void social_player_logout(SocialSystem* social, const Player* player);
+
+/*
+ * social_presence_changed - A name went online (world >= 0) or offline (-1)
+ *
+ * @param social  System (NULL: ignored)
+ *
+ * Nothing is sent until social_tick(); a later change of the same name
+ * in the tick replaces this one.
+ *
+ * COMPLEXITY: O(1) expected
+ */
+void social_presence_changed(SocialSystem* social, u64 name, i32 world);
+
+/*
+ * social_tick - Send this tick's changes to their watchers
+ *
+ * Called once per tick after presence_pump(), up to
+ * SOCIAL_FANOUT_PER_TICK packets.
+ *
+ * COMPLEXITY: O(changes + watchers × log(friends))
+ */
+void social_tick(SocialSystem* social);
+
+/*
+ * social_handle_friend_add / _friend_del / _ignore_add / _ignore_del
+ *
+ * @param buf  FRIENDLIST_ADD / _DEL, IGNORELIST_ADD / _DEL payload view
+ */
+void social_handle_friend_add(SocialSystem* social, Player* player, StreamBuffer* buf);
+void social_handle_friend_del(SocialSystem* social, Player* player, StreamBuffer* buf);
+void social_handle_ignore_add(Player* player, StreamBuffer* buf);
+void social_handle_ignore_del(Player* player, StreamBuffer* buf);
+
+/*
+ * social_handle_private - Deliver a MESSAGE_PRIVATE
+ *
+ * @param packet_length  Payload size (VAR_BYTE)
+ */
+void social_handle_private(SocialSystem* social, Player* player, StreamBuffer* buf,
+                           u32 packet_length);
+
+#endif /* SOCIAL_H */
@@ -23,29 +23,29 @@ void envelope_read(Envelope *env, Packet *dat) {
     }
 }
 
-void envelope_reset(Envelope *env) {
-    env->threshold = 0;
-    env->position = 0;
-    env->delta = 0;
-    env->amplitude = 0;
-    env->ticks = 0;
+void envelope_reset(EnvelopeCursor *cursor) {
+    cursor->threshold = 0;
+    cursor->position = 0;
+    cursor->delta = 0;
+    cursor->amplitude = 0;
+    cursor->ticks = 0;
 }
 
-int envelope_evaluate(Envelope *env, int delta) {
-    if (env->ticks >= env->threshold) {
-        env->amplitude = env->shapePeak[env->position++] << 15;
+int envelope_evaluate(const Envelope *env, EnvelopeCursor *cursor, int delta) {
+    if (cursor->ticks >= cursor->threshold) {
+        cursor->amplitude = env->shapePeak[cursor->position++] << 15;
 
-        if (env->position >= env->length) {
-            env->position = env->length - 1;
+        if (cursor->position >= env->length) {
+            cursor->position = env->length - 1;
         }
 
-        env->threshold = (int)((double)env->shapeDelta[env->position] / 65536.0 * (double)delta);
-        if (env->threshold > env->ticks) {
-            env->delta = ((env->shapePeak[env->position] << 15) - env->amplitude) / (env->threshold - env->ticks);
+        cursor->threshold = (int)((double)env->shapeDelta[cursor->position] / 65536.0 * (double)delta);
+        if (cursor->threshold > cursor->ticks) {
+            cursor->delta = ((env->shapePeak[cursor->position] << 15) - cursor->amplitude) / (cursor->threshold - cursor->ticks);
         }
     }
 
-    env->amplitude += env->delta;
-    env->ticks++;
-    return (env->amplitude - env->delta) >> 15;
+    cursor->amplitude += cursor->delta;
+    cursor->ticks++;
+    return (cursor->amplitude - cursor->delta) >> 15;
 }
@@ -9,14 +9,19 @@ typedef struct {
     int start;
     int end;
     int form;
+} Envelope;
+
+// where one synthesis is along an envelope: kept apart from the (read only)
+// Envelope so the same sound can be synthesized on two threads at once
+typedef struct {
     int threshold;
     int position;
     int delta;
     int amplitude;
     int ticks;
-} Envelope;
+} EnvelopeCursor;
 
 void envelope_free(Envelope *env);
 void envelope_read(Envelope *env, Packet *dat);
-void envelope_reset(Envelope *env);
-int envelope_evaluate(Envelope *env, int delta);
+void envelope_reset(EnvelopeCursor *cursor);
+int envelope_evaluate(const Envelope *env, EnvelopeCursor *cursor, int delta);
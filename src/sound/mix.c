@@ -0,0 +1,59 @@
+#include "mix.h"
+
+// Each kernel runs over whole MIX_LANES blocks, then the remainder. The
+// blocks' fixed trip count is what lets gcc vectorize them at plain -O2,
+// where its cost model skips loops that would need a scalar epilogue.
+#define MIX_LANES 16
+
+void mix_add_s8(int8_t *restrict dst, const int *restrict src, int count) {
+    int i = 0;
+    for (; i + MIX_LANES <= count; i += MIX_LANES) {
+        for (int j = 0; j < MIX_LANES; j++) {
+            dst[i + j] = (int8_t)(dst[i + j] + (src[i + j] >> 8));
+        }
+    }
+    for (; i < count; i++) {
+        dst[i] = (int8_t)(dst[i] + (src[i] >> 8));
+    }
+}
+
+void mix_clamp_s16(int *samples, int count) {
+    int i = 0;
+    for (; i + MIX_LANES <= count; i += MIX_LANES) {
+        for (int j = 0; j < MIX_LANES; j++) {
+            int value = samples[i + j];
+            value = value < -32768 ? -32768 : value;
+            samples[i + j] = value > 32767 ? 32767 : value;
+        }
+    }
+    for (; i < count; i++) {
+        int value = samples[i];
+        value = value < -32768 ? -32768 : value;
+        samples[i] = value > 32767 ? 32767 : value;
+    }
+}
+
+static inline uint8_t volume_u8(uint8_t sample, int16_t scale) {
+    // volume is at most 128, so the product fits 16 bits: narrow lanes
+    // hold twice as many samples as int would. / 128 rounds toward zero,
+    // which a shift does once negative products are biased by 127
+    int16_t scaled = (int16_t)((int16_t)(sample - 128) * scale);
+    return (uint8_t)(((scaled + (scaled >> 15 & 127)) >> 7) + 128);
+}
+
+void mix_volume_u8(uint8_t *samples, uint32_t count, int volume) {
+    if (volume == 128) {
+        return;
+    }
+    int16_t scale = (int16_t)volume;
+    uint32_t i = 0;
+    for (; i + MIX_LANES <= count; i += MIX_LANES) {
+        uint8_t *block = samples + i;
+        for (int j = 0; j < MIX_LANES; j++) {
+            block[j] = volume_u8(block[j], scale);
+        }
+    }
+    for (; i < count; i++) {
+        samples[i] = volume_u8(samples[i], scale);
+    }
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stdint.h>
+
+// Sample kernels shared by the synthesizer and the platform backends. Each
+// is one flat loop over a whole buffer with no branches or loop-carried
+// state, so the compiler turns it into SIMD (SSE2, NEON, wasm simd128) at
+// -O2/-O3 where the target has it, and into a tight scalar loop where not.
+// They give the same bytes as the sample-by-sample code they replaced.
+
+// dst[i] += src[i] >> 8, wrapping like the signed byte it is: a tone's
+// 16-bit samples summed into the 8-bit wave
+void mix_add_s8(int8_t *restrict dst, const int *restrict src, int count);
+
+// clamp 32-bit sums to 16 bits
+void mix_clamp_s16(int *samples, int count);
+
+// scale unsigned 8-bit PCM around its 128 midpoint by volume / 128 in place
+// (128 leaves it as it is)
+void mix_volume_u8(uint8_t *samples, uint32_t count, int volume);
@@ -1,8 +1,10 @@
 #include <math.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "../platform.h"
+#include "mix.h"
 #include "tone.h"
 
 static int generate(int amplitude, int phase, int form);
@@ -35,7 +37,6 @@ void tone_free(Tone *tone) {
 }
 
 void tone_free_global(void) {
-    free(_Tone.buffer);
     free(_Tone.noise);
     free(_Tone.sin);
 }
@@ -54,31 +55,87 @@ void tone_init_global(void) {
     for (int i = 0; i < 32768; i++) {
         _Tone.sin[i] = (int)(sin((double)i / 5215.1903) * 16384.0);
     }
+}
 
-    _Tone.buffer = calloc(220500, sizeof(int)); // 10s * 22050 KHz
+ToneScratch *tone_scratch_new(void) {
+    ToneScratch *scratch = calloc(1, sizeof(ToneScratch));
+    if (!scratch) {
+        return NULL;
+    }
+    scratch->buffer = calloc(TONE_MAX_SAMPLES, sizeof(int));
+    if (!scratch->buffer) {
+        free(scratch);
+        return NULL;
+    }
+    return scratch;
 }
 
-int *tone_generate(Tone *tone, int sampleCount, int length) {
-    for (int sample = 0; sample < sampleCount; sample++) {
-        _Tone.buffer[sample] = 0;
+void tone_scratch_free(ToneScratch *scratch) {
+    if (scratch) {
+        free(scratch->buffer);
+        free(scratch);
     }
+}
+
+// Adds one harmonic over a block: the waveform is picked once per block, so
+// each loop body is branch-free. The phase carries from sample to sample.
+static void mix_harmonic(int *out, const int *frequency, const int *amplitude, int count, int volume, int semitone, int start, int *phase, int form) {
+    int p = *phase;
+    switch (form) {
+    case 1:
+        for (int i = 0; i < count; i++) {
+            int a = amplitude[i] * volume >> 15;
+            out[i] += (p & 0x7fff) < 16384 ? a : -a;
+            p += (frequency[i] * semitone >> 16) + start;
+        }
+        break;
+    case 2:
+        for (int i = 0; i < count; i++) {
+            out[i] += _Tone.sin[p & 0x7fff] * (amplitude[i] * volume >> 15) >> 14;
+            p += (frequency[i] * semitone >> 16) + start;
+        }
+        break;
+    case 3:
+        for (int i = 0; i < count; i++) {
+            int a = amplitude[i] * volume >> 15;
+            out[i] += ((p & 0x7fff) * a >> 14) - a;
+            p += (frequency[i] * semitone >> 16) + start;
+        }
+        break;
+    case 4:
+        for (int i = 0; i < count; i++) {
+            out[i] += _Tone.noise[p / 2607 & 0x7fff] * (amplitude[i] * volume >> 15);
+            p += (frequency[i] * semitone >> 16) + start;
+        }
+        break;
+    default:
+        // silent: the phase is never read again
+        break;
+    }
+    *phase = p;
+}
+
+int *tone_generate(const Tone *tone, int sampleCount, int length, ToneScratch *scratch) {
+    int *buffer = scratch->buffer;
+    memset(buffer, 0, sampleCount * sizeof(int));
 
     if (length < 10) {
-        return _Tone.buffer;
+        return buffer;
     }
 
     double samplesPerStep = (double)sampleCount / ((double)length + 0.0);
 
-    envelope_reset(tone->frequencyBase);
-    envelope_reset(tone->amplitudeBase);
+    EnvelopeCursor frequencyBase, amplitudeBase, frequencyModRate, frequencyModRange, amplitudeModRate, amplitudeModRange;
+    envelope_reset(&frequencyBase);
+    envelope_reset(&amplitudeBase);
 
     int frequencyStart = 0;
     int frequencyDuration = 0;
     int frequencyPhase = 0;
 
     if (tone->frequencyModRate) {
-        envelope_reset(tone->frequencyModRate);
-        envelope_reset(tone->frequencyModRange);
+        envelope_reset(&frequencyModRate);
+        envelope_reset(&frequencyModRange);
         frequencyStart = (int)((double)(tone->frequencyModRate->end - tone->frequencyModRate->start) * 32.768 / samplesPerStep);
         frequencyDuration = (int)((double)tone->frequencyModRate->start * 32.768 / samplesPerStep);
     }
@@ -87,62 +144,76 @@ int *tone_generate(Tone *tone, int sampleCount, int length) {
     int amplitudeDuration = 0;
     int amplitudePhase = 0;
     if (tone->amplitudeModRate) {
-        envelope_reset(tone->amplitudeModRate);
-        envelope_reset(tone->amplitudeModRange);
+        envelope_reset(&amplitudeModRate);
+        envelope_reset(&amplitudeModRange);
         amplitudeStart = (int)((double)(tone->amplitudeModRate->end - tone->amplitudeModRate->start) * 32.768 / samplesPerStep);
         amplitudeDuration = (int)((double)tone->amplitudeModRate->start * 32.768 / samplesPerStep);
     }
 
     for (int harmonic = 0; harmonic < 5; harmonic++) {
         if (tone->harmonicVolume[harmonic] != 0) {
-            _Tone.tmpPhases[harmonic] = 0;
-            _Tone.tmpDelays[harmonic] = (int)((double)tone->harmonicDelay[harmonic] * samplesPerStep);
-            _Tone.tmpVolumes[harmonic] = (tone->harmonicVolume[harmonic] << 14) / 100;
-            _Tone.tmpSemitones[harmonic] = (int)((double)(tone->frequencyBase->end - tone->frequencyBase->start) * 32.768 * pow(1.0057929410678534, tone->harmonicSemitone[harmonic]) / samplesPerStep);
-            _Tone.tmpStarts[harmonic] = (int)((double)tone->frequencyBase->start * 32.768 / samplesPerStep);
+            scratch->tmpPhases[harmonic] = 0;
+            scratch->tmpDelays[harmonic] = (int)((double)tone->harmonicDelay[harmonic] * samplesPerStep);
+            scratch->tmpVolumes[harmonic] = (tone->harmonicVolume[harmonic] << 14) / 100;
+            scratch->tmpSemitones[harmonic] = (int)((double)(tone->frequencyBase->end - tone->frequencyBase->start) * 32.768 * pow(1.0057929410678534, tone->harmonicSemitone[harmonic]) / samplesPerStep);
+            scratch->tmpStarts[harmonic] = (int)((double)tone->frequencyBase->start * 32.768 / samplesPerStep);
         }
     }
 
-    for (int sample = 0; sample < sampleCount; sample++) {
-        int frequency = envelope_evaluate(tone->frequencyBase, sampleCount);
-        int amplitude = envelope_evaluate(tone->amplitudeBase, sampleCount);
+    // The envelopes are evaluated a block ahead, then every harmonic is
+    // mixed over the block on its own. Each harmonic's samples are summed
+    // in the same order as sample by sample, so the output is unchanged.
+    for (int block = 0; block < sampleCount; block += TONE_BLOCK) {
+        int count = sampleCount - block < TONE_BLOCK ? sampleCount - block : TONE_BLOCK;
+
+        for (int i = 0; i < count; i++) {
+            int frequency = envelope_evaluate(tone->frequencyBase, &frequencyBase, sampleCount);
+            int amplitude = envelope_evaluate(tone->amplitudeBase, &amplitudeBase, sampleCount);
+
+            if (tone->frequencyModRate) {
+                int rate = envelope_evaluate(tone->frequencyModRate, &frequencyModRate, sampleCount);
+                int range = envelope_evaluate(tone->frequencyModRange, &frequencyModRange, sampleCount);
+                frequency += generate(range, frequencyPhase, tone->frequencyModRate->form) >> 1;
+                frequencyPhase += (rate * frequencyStart >> 16) + frequencyDuration;
+            }
 
-        if (tone->frequencyModRate) {
-            int rate = envelope_evaluate(tone->frequencyModRate, sampleCount);
-            int range = envelope_evaluate(tone->frequencyModRange, sampleCount);
-            frequency += generate(range, frequencyPhase, tone->frequencyModRate->form) >> 1;
-            frequencyPhase += (rate * frequencyStart >> 16) + frequencyDuration;
-        }
+            if (tone->amplitudeModRate) {
+                int rate = envelope_evaluate(tone->amplitudeModRate, &amplitudeModRate, sampleCount);
+                int range = envelope_evaluate(tone->amplitudeModRange, &amplitudeModRange, sampleCount);
+                amplitude = amplitude * ((generate(range, amplitudePhase, tone->amplitudeModRate->form) >> 1) + 32768) >> 15;
+                amplitudePhase += (rate * amplitudeStart >> 16) + amplitudeDuration;
+            }
 
-        if (tone->amplitudeModRate) {
-            int rate = envelope_evaluate(tone->amplitudeModRate, sampleCount);
-            int range = envelope_evaluate(tone->amplitudeModRange, sampleCount);
-            amplitude = amplitude * ((generate(range, amplitudePhase, tone->amplitudeModRate->form) >> 1) + 32768) >> 15;
-            amplitudePhase += (rate * amplitudeStart >> 16) + amplitudeDuration;
+            scratch->frequency[i] = frequency;
+            scratch->amplitude[i] = amplitude;
         }
 
         for (int harmonic = 0; harmonic < 5; harmonic++) {
             if (tone->harmonicVolume[harmonic] != 0) {
-                int position = sample + _Tone.tmpDelays[harmonic];
-
-                if (position < sampleCount) {
-                    _Tone.buffer[position] += generate(amplitude * _Tone.tmpVolumes[harmonic] >> 15, _Tone.tmpPhases[harmonic], tone->frequencyBase->form);
-                    _Tone.tmpPhases[harmonic] += (frequency * _Tone.tmpSemitones[harmonic] >> 16) + _Tone.tmpStarts[harmonic];
+                // samples pushed past the end by the delay are dropped
+                int delay = scratch->tmpDelays[harmonic];
+                int mixed = sampleCount - delay - block;
+                if (mixed > count) {
+                    mixed = count;
+                }
+                if (mixed > 0) {
+                    mix_harmonic(buffer + block + delay, scratch->frequency, scratch->amplitude, mixed, scratch->tmpVolumes[harmonic], scratch->tmpSemitones[harmonic], scratch->tmpStarts[harmonic], &scratch->tmpPhases[harmonic], tone->frequencyBase->form);
                 }
             }
         }
     }
 
     if (tone->release) {
-        envelope_reset(tone->release);
-        envelope_reset(tone->attack);
+        EnvelopeCursor release, attack;
+        envelope_reset(&release);
+        envelope_reset(&attack);
 
         int counter = 0;
         bool muted = true;
 
         for (int sample = 0; sample < sampleCount; sample++) {
-            int releaseValue = envelope_evaluate(tone->release, sampleCount);
-            int attackValue = envelope_evaluate(tone->attack, sampleCount);
+            int releaseValue = envelope_evaluate(tone->release, &release, sampleCount);
+            int attackValue = envelope_evaluate(tone->attack, &attack, sampleCount);
 
             int threshold;
             if (muted) {
@@ -158,7 +229,7 @@ int *tone_generate(Tone *tone, int sampleCount, int length) {
             }
 
             if (muted) {
-                _Tone.buffer[sample] = 0;
+                buffer[sample] = 0;
             }
         }
     }
@@ -167,21 +238,12 @@ int *tone_generate(Tone *tone, int sampleCount, int length) {
         int start = (int)((double)tone->reverbDelay * samplesPerStep);
 
         for (int sample = start; sample < sampleCount; sample++) {
-            _Tone.buffer[sample] += _Tone.buffer[sample - start] * tone->reverbVolume / 100;
-        }
-    }
-
-    for (int sample = 0; sample < sampleCount; sample++) {
-        if (_Tone.buffer[sample] < -32768) {
-            _Tone.buffer[sample] = -32768;
-        }
-
-        if (_Tone.buffer[sample] > 32767) {
-            _Tone.buffer[sample] = 32767;
+            buffer[sample] += buffer[sample - start] * tone->reverbVolume / 100;
         }
     }
 
-    return _Tone.buffer;
+    mix_clamp_s16(buffer, sampleCount);
+    return buffer;
 }
 
 static int generate(int amplitude, int phase, int form) {
@@ -20,20 +20,35 @@ typedef struct {
     int start;
 } Tone;
 
+// longest tone: 10s at 22050 Hz
+#define TONE_MAX_SAMPLES 220500
+// samples whose envelopes are evaluated before the harmonics are mixed
+#define TONE_BLOCK 256
+
 typedef struct {
-    int *buffer;
     int *noise;
     int *sin;
+} ToneData;
+
+// one synthesizing thread's buffers: the output and the current block's
+// envelope values, so tone_generate keeps no state between calls
+typedef struct {
+    int *buffer;
+    int frequency[TONE_BLOCK];
+    int amplitude[TONE_BLOCK];
     int tmpPhases[5];
     int tmpDelays[5];
     int tmpVolumes[5];
     int tmpSemitones[5];
     int tmpStarts[5];
-} ToneData;
+} ToneScratch;
 
 Tone *tone_new(void);
 void tone_free(Tone *tone);
 void tone_free_global(void);
 void tone_init_global(void);
-int *tone_generate(Tone *tone, int sampleCount, int length);
+ToneScratch *tone_scratch_new(void);
+void tone_scratch_free(ToneScratch *scratch);
+// samples in scratch->buffer, valid until scratch is used again
+int *tone_generate(const Tone *tone, int sampleCount, int length, ToneScratch *scratch);
 void tone_read(Tone *tone, Packet *dat);
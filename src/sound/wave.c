@@ -1,24 +1,218 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "../packet.h"
+#include "mix.h"
 #include "wave.h"
 #include <stdbool.h>
 
 WaveData _Wave = {0};
-extern ToneData _Tone;
 
-static int generate(Wave *wave, int loopCount);
+static int generate(const Wave *wave, int loopCount, int8_t **out, ToneScratch *scratch);
 static void wave_free(Wave *wave);
 
+typedef enum {
+    JOB_EMPTY = 0,
+    JOB_PENDING,
+    JOB_RUNNING,
+    JOB_DONE
+} WaveJobState;
+
+typedef struct {
+    int id;
+    int loopCount;
+    Packet *out;
+    WaveJobState state;
+} WaveJob;
+
+static struct {
+    WaveJob jobs[WAVE_JOBS];
+    ToneScratch *scratch; // the wave thread's
+    bool running;
+} _WaveSynth;
+
+#if (defined(__linux__) || defined(__APPLE__) || defined(__FreeBSD__)) && !defined(__EMSCRIPTEN__)
+
+#include <pthread.h>
+#include <signal.h>
+
+static pthread_mutex_t synth_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t synth_wake = PTHREAD_COND_INITIALIZER; // job queued / stop
+static pthread_cond_t synth_done = PTHREAD_COND_INITIALIZER; // a RUNNING job finished
+static pthread_t synth_thread;
+
+static void synth_lock(void) { pthread_mutex_lock(&synth_mutex); }
+static void synth_unlock(void) { pthread_mutex_unlock(&synth_mutex); }
+static void synth_wait_done(void) { pthread_cond_wait(&synth_done, &synth_mutex); }
+static void synth_finished(void) { pthread_cond_broadcast(&synth_done); }
+static void synth_submitted(void) { pthread_cond_signal(&synth_wake); }
+
+#else
+
+// one thread: no job is ever seen RUNNING by anyone but its synthesizer
+static void synth_lock(void) {}
+static void synth_unlock(void) {}
+static void synth_wait_done(void) {}
+static void synth_finished(void) {}
+static void synth_submitted(void) {}
+
+#endif
+
+static void wave_evicted(DoublyLinkable *value) {
+    packet_free((Packet *)value);
+}
+
+static int64_t wave_key(int id, int loopCount) {
+    return (int64_t)id << 8 | (loopCount & 0xff);
+}
+
+// The wave thread only reads the tracks: tones, envelopes and the sin and
+// noise tables are read only once unpacked, everything written is in scratch
+static void job_run(WaveJob *job, ToneScratch *scratch) {
+    const Wave *track = _Wave.tracks[job->id];
+    int loopCount = job->loopCount;
+    synth_unlock();
+    Packet *out = wave_get_wave(track, loopCount, scratch);
+    synth_lock();
+    job->out = out;
+    job->state = JOB_DONE;
+    synth_finished();
+}
+
+static WaveJob *job_find(int id, int loopCount) {
+    for (int i = 0; i < WAVE_JOBS; i++) {
+        WaveJob *job = &_WaveSynth.jobs[i];
+        if (job->state != JOB_EMPTY && job->id == id && job->loopCount == loopCount) {
+            return job;
+        }
+    }
+    return NULL;
+}
+
+static void cache_put(int id, int loopCount, Packet *wave) {
+    if (!wave) {
+        return;
+    }
+    if (lrucache_get(_Wave.cache, wave_key(id, loopCount))) {
+        // already generated on the other thread too: keep the cached one
+        packet_free(wave);
+        return;
+    }
+    lrucache_put_sized(_Wave.cache, wave_key(id, loopCount), &wave->link, (int)sizeof(Packet) + wave->length);
+}
+
+// moves finished sounds into the cache and frees their job (called locked)
+static void jobs_collect(void) {
+    for (int i = 0; i < WAVE_JOBS; i++) {
+        WaveJob *job = &_WaveSynth.jobs[i];
+        if (job->state == JOB_DONE) {
+            cache_put(job->id, job->loopCount, job->out);
+            job->out = NULL;
+            job->state = JOB_EMPTY;
+        }
+    }
+}
+
+#if (defined(__linux__) || defined(__APPLE__) || defined(__FreeBSD__)) && !defined(__EMSCRIPTEN__)
+
+static void *wave_thread_main(void *arg) {
+    (void)arg;
+    synth_lock();
+    while (_WaveSynth.running) {
+        WaveJob *job = NULL;
+        for (int i = 0; i < WAVE_JOBS && !job; i++) {
+            if (_WaveSynth.jobs[i].state == JOB_PENDING) {
+                job = &_WaveSynth.jobs[i];
+            }
+        }
+        if (!job) {
+            pthread_cond_wait(&synth_wake, &synth_mutex);
+            continue;
+        }
+        job->state = JOB_RUNNING;
+        job_run(job, _WaveSynth.scratch);
+    }
+    synth_unlock();
+    return NULL;
+}
+
+bool wave_start(void) {
+    if (_WaveSynth.running) {
+        return true;
+    }
+    _WaveSynth.scratch = tone_scratch_new();
+    if (!_WaveSynth.scratch) {
+        fprintf(stderr, "WARNING: Wave thread not started, sounds are synthesized when played\n");
+        return false;
+    }
+    _WaveSynth.running = true;
+
+    // signals stay on the game thread
+    sigset_t all, previous;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &previous);
+    int error = pthread_create(&synth_thread, NULL, wave_thread_main, NULL);
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+    if (error != 0) {
+        _WaveSynth.running = false;
+        tone_scratch_free(_WaveSynth.scratch);
+        _WaveSynth.scratch = NULL;
+        fprintf(stderr, "WARNING: Wave thread not started, sounds are synthesized when played\n");
+        return false;
+    }
+    return true;
+}
+
+void wave_stop(void) {
+    if (_WaveSynth.running) {
+        synth_lock();
+        _WaveSynth.running = false;
+        pthread_cond_broadcast(&synth_wake);
+        synth_unlock();
+        pthread_join(synth_thread, NULL);
+        tone_scratch_free(_WaveSynth.scratch);
+        _WaveSynth.scratch = NULL;
+    }
+    for (int i = 0; i < WAVE_JOBS; i++) {
+        if (_WaveSynth.jobs[i].out) {
+            packet_free(_WaveSynth.jobs[i].out);
+        }
+        _WaveSynth.jobs[i] = (WaveJob){0};
+    }
+}
+
+#else
+
+// No POSIX threads (Windows, Emscripten, consoles): nothing is queued and
+// wave_generate() synthesizes every uncached sound itself.
+bool wave_start(void) {
+    fprintf(stderr, "WARNING: Wave thread not supported on this platform, sounds are synthesized when played\n");
+    return false;
+}
+
+void wave_stop(void) {
+}
+
+#endif
+
 void wave_free_global(void) {
+    wave_stop();
+    if (_Wave.cache) {
+        lrucache_clear(_Wave.cache);
+        lrucache_free(_Wave.cache);
+        _Wave.cache = NULL;
+    }
+    tone_scratch_free(_Wave.tone);
+    _Wave.tone = NULL;
     for (int i = 0; i < 1000; i++) {
         if (_Wave.tracks[i]) {
             wave_free(_Wave.tracks[i]);
         }
     }
-    if (_Wave.waveBuffer) { // it's low detail
-        packet_free(_Wave.waveBuffer);
-    }
 }
 
 static void wave_free(Wave *wave) {
@@ -31,8 +225,9 @@ static void wave_free(Wave *wave) {
 }
 
 void wave_unpack(Packet *dat) {
-    _Wave.waveBytes = calloc(441000, sizeof(int8_t));
-    _Wave.waveBuffer = packet_new(_Wave.waveBytes, 441000);
+    _Wave.tone = tone_scratch_new();
+    _Wave.cache = lrucache_new(WAVE_CACHE_SIZE);
+    lrucache_set_evicted(_Wave.cache, wave_evicted);
     tone_init_global();
 
     while (true) {
@@ -48,12 +243,59 @@ void wave_unpack(Packet *dat) {
 }
 
 Packet *wave_generate(int id, int loopCount) {
-    if (!_Wave.tracks[id]) {
+    if (id < 0 || id >= 1000 || !_Wave.tracks[id]) {
         return NULL;
     }
 
-    Wave *track = _Wave.tracks[id];
-    return wave_get_wave(track, loopCount);
+    Packet *wave = (Packet *)lrucache_get(_Wave.cache, wave_key(id, loopCount));
+    if (wave) {
+        return wave;
+    }
+
+    synth_lock();
+    WaveJob *job = job_find(id, loopCount);
+    if (job) {
+        while (job->state == JOB_RUNNING) {
+            synth_wait_done();
+        }
+        if (job->state == JOB_PENDING) {
+            // not reached yet: quicker here than behind the queue
+            job->state = JOB_RUNNING;
+            job_run(job, _Wave.tone);
+        }
+        wave = job->out;
+        job->out = NULL;
+        job->state = JOB_EMPTY;
+    }
+    synth_unlock();
+
+    if (!job) {
+        wave = wave_get_wave(_Wave.tracks[id], loopCount, _Wave.tone);
+    }
+    if (wave) {
+        lrucache_put_sized(_Wave.cache, wave_key(id, loopCount), &wave->link, (int)sizeof(Packet) + wave->length);
+    }
+    return wave;
+}
+
+void wave_prefetch(int id, int loopCount) {
+    if (!_WaveSynth.running || id < 0 || id >= 1000 || !_Wave.tracks[id]) {
+        return;
+    }
+
+    synth_lock();
+    jobs_collect();
+    if (!job_find(id, loopCount) && !lrucache_get(_Wave.cache, wave_key(id, loopCount))) {
+        for (int i = 0; i < WAVE_JOBS; i++) {
+            WaveJob *job = &_WaveSynth.jobs[i];
+            if (job->state == JOB_EMPTY) {
+                *job = (WaveJob){id, loopCount, NULL, JOB_PENDING};
+                synth_submitted();
+                break;
+            }
+        }
+    }
+    synth_unlock();
 }
 
 void wave_read(Wave *wave, Packet *dat) {
@@ -99,27 +341,34 @@ int wave_trim(Wave *wave) {
     return start;
 }
 
-Packet *wave_get_wave(Wave *wave, int loopCount) {
-    int length = generate(wave, loopCount);
-    _Wave.waveBuffer->pos = 0;
-    p4(_Wave.waveBuffer, 0x52494646);   // "RIFF" ChunkID
-    ip4(_Wave.waveBuffer, length + 36); // ChunkSize
-    p4(_Wave.waveBuffer, 0x57415645);   // "WAVE" format
-    p4(_Wave.waveBuffer, 0x666d7420);   // "fmt " chunk id
-    ip4(_Wave.waveBuffer, 16);          // chunk size
-    ip2(_Wave.waveBuffer, 1);           // audio format
-    ip2(_Wave.waveBuffer, 1);           // num channels
-    ip4(_Wave.waveBuffer, 22050);       // sample rate
-    ip4(_Wave.waveBuffer, 22050);       // byte rate
-    ip2(_Wave.waveBuffer, 1);           // block align
-    ip2(_Wave.waveBuffer, 8);           // bits per sample
-    p4(_Wave.waveBuffer, 0x64617461);   // "data"
-    ip4(_Wave.waveBuffer, length);
-    _Wave.waveBuffer->pos += length;
-    return _Wave.waveBuffer;
-}
-
-static int generate(Wave *wave, int loopCount) {
+Packet *wave_get_wave(const Wave *wave, int loopCount, ToneScratch *scratch) {
+    int8_t *bytes = NULL;
+    int length = generate(wave, loopCount, &bytes, scratch);
+    if (length < 0) {
+        return NULL;
+    }
+
+    Packet *buf = packet_new(bytes, length + 44);
+    p4(buf, 0x52494646);   // "RIFF" ChunkID
+    ip4(buf, length + 36); // ChunkSize
+    p4(buf, 0x57415645);   // "WAVE" format
+    p4(buf, 0x666d7420);   // "fmt " chunk id
+    ip4(buf, 16);          // chunk size
+    ip2(buf, 1);           // audio format
+    ip2(buf, 1);           // num channels
+    ip4(buf, 22050);       // sample rate
+    ip4(buf, 22050);       // byte rate
+    ip2(buf, 1);           // block align
+    ip2(buf, 8);           // bits per sample
+    p4(buf, 0x64617461);   // "data"
+    ip4(buf, length);
+    buf->pos += length;
+    return buf;
+}
+
+// Allocates *out with the 44 byte header space, the samples after it.
+// Returns the played sample count, or -1 if it would not fit WAVE_MAX_BYTES.
+static int generate(const Wave *wave, int loopCount, int8_t **out, ToneScratch *scratch) {
     int duration = 0;
     for (int tone = 0; tone < 10; tone++) {
         if (wave->tones[tone] && wave->tones[tone]->length + wave->tones[tone]->start > duration) {
@@ -127,10 +376,6 @@ static int generate(Wave *wave, int loopCount) {
         }
     }
 
-    if (duration == 0) {
-        return 0;
-    }
-
     int sampleCount = duration * 22050 / 1000;
     int loopStart = wave->loopBegin * 22050 / 1000;
     int loopStop = wave->loopEnd * 22050 / 1000;
@@ -138,20 +383,29 @@ static int generate(Wave *wave, int loopCount) {
         loopCount = 0;
     }
 
-    int totalSampleCount = sampleCount + (loopStop - loopStart) * (loopCount - 1);
-    for (int sample = 44; sample < totalSampleCount + 44; sample++) {
-        _Wave.waveBytes[sample] = -128;
+    int totalSampleCount = duration == 0 ? 0 : sampleCount + (loopStop - loopStart) * (loopCount - 1);
+    // the tones are mixed over the whole sound even when fewer samples play
+    int written = totalSampleCount > sampleCount ? totalSampleCount : sampleCount;
+    if (totalSampleCount < 0 || written + 44 > WAVE_MAX_BYTES) {
+        return -1;
+    }
+
+    int8_t *waveBytes = malloc(written + 44);
+    if (!waveBytes) {
+        return -1;
+    }
+    *out = waveBytes;
+    if (duration == 0) {
+        return 0;
     }
+    memset(waveBytes + 44, -128, written);
 
     for (int tone = 0; tone < 10; tone++) {
         if (wave->tones[tone]) {
             int toneSampleCount = wave->tones[tone]->length * 22050 / 1000;
             int start = wave->tones[tone]->start * 22050 / 1000;
-            int *samples = tone_generate(wave->tones[tone], toneSampleCount, wave->tones[tone]->length);
-
-            for (int sample = 0; sample < toneSampleCount; sample++) {
-                _Wave.waveBytes[sample + start + 44] += (int8_t)(samples[sample] >> 8);
-            }
+            const int *samples = tone_generate(wave->tones[tone], toneSampleCount, wave->tones[tone]->length, scratch);
+            mix_add_s8(waveBytes + start + 44, samples, toneSampleCount);
         }
     }
 
@@ -162,16 +416,11 @@ static int generate(Wave *wave, int loopCount) {
         totalSampleCount += 44;
 
         int endOffset = totalSampleCount - sampleCount;
-        for (int sample = sampleCount - 1; sample >= loopStop; sample--) {
-            _Wave.waveBytes[sample + endOffset] = _Wave.waveBytes[sample];
-        }
+        memmove(waveBytes + loopStop + endOffset, waveBytes + loopStop, sampleCount - loopStop);
 
         for (int loop = 1; loop < loopCount; loop++) {
             int offset = (loopStop - loopStart) * loop;
-
-            for (int sample = loopStart; sample < loopStop; sample++) {
-                _Wave.waveBytes[sample + offset] = _Wave.waveBytes[sample];
-            }
+            memcpy(waveBytes + loopStart + offset, waveBytes + loopStart, loopStop - loopStart);
         }
 
         totalSampleCount -= 44;
@@ -1,7 +1,9 @@
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
 
+#include "../datastruct/lrucache.h"
 #include "../packet.h"
 #include "tone.h"
 
@@ -12,16 +14,39 @@ typedef struct {
     int loopEnd;
 } Wave;
 
+// Generated sounds are kept by (id, loop count) in an LruCache whose bytes
+// count against the shared cache budget: the same hit or spell sound played
+// again is the cached WAV, not a new synthesis.
+//
+// SYNTH_SOUND arrives with a delay (and the sound's own trimmed silence), so
+// wave_prefetch() hands it to the wave thread at once; by the time
+// wave_generate() asks for it the PCM is usually done. A sound the thread
+// has not started yet is synthesized by the caller, one it is busy with is
+// waited for. Without POSIX threads everything is synthesized on demand.
+
+// generated sounds cached, besides the byte budget
+#define WAVE_CACHE_SIZE 64
+// sounds waiting for the thread: the client queues at most 50
+#define WAVE_JOBS 50
+// longest WAV, header included
+#define WAVE_MAX_BYTES 441000
+
 typedef struct {
     Wave *tracks[1000];
     int delays[1000];
-    int8_t *waveBytes;
-    Packet *waveBuffer;
+    ToneScratch *tone; // the game thread's, the wave thread has its own
+    LruCache *cache;   // id << 8 | loop count -> Packet
 } WaveData;
 
 void wave_free_global(void);
 void wave_unpack(Packet *dat);
+// the WAV in data[0, pos), owned by the cache: valid until the next
+// wave_generate or cache put. NULL for an unknown or overlong sound
 Packet *wave_generate(int id, int loopCount);
+// start generating a sound that will be played soon (game thread only)
+void wave_prefetch(int id, int loopCount);
+bool wave_start(void);
+void wave_stop(void);
 void wave_read(Wave *wave, Packet *dat);
 int wave_trim(Wave *wave);
-Packet *wave_get_wave(Wave *wave, int loopCount);
+Packet *wave_get_wave(const Wave *wave, int loopCount, ToneScratch *scratch);
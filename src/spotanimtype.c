@@ -99,6 +99,6 @@ Model *spotanimtype_get_model(SpotAnimType *spotanim) {
         }
     }
 
-    lrucache_put(_SpotAnimType.modelCache, spotanim->index, &model->link);
+    lrucache_put_sized(_SpotAnimType.modelCache, spotanim->index, &model->link, model_size(model));
     return model;
 }
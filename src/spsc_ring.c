@@ -0,0 +1,135 @@
+/*******************************************************************************
+ * SPSC_RING.C - Lock-Free Single-Producer/Single-Consumer Byte Ring
+ *******************************************************************************
+ *
+ * See spsc_ring.h for the algorithm and the memory-ordering argument.
+ *
+ * ATOMICS:
+ *   The tree is C99, which has no <stdatomic.h>. The GCC/Clang __atomic
+ *   builtins provide the same acquire/release semantics and are used only
+ *   for the head/tail indices; the byte copies themselves are plain.
+ *
+ ******************************************************************************/
+
+#include "spsc_ring.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define load_acquire(p)     __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define load_relaxed(p)     __atomic_load_n((p), __ATOMIC_RELAXED)
+#define store_release(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+bool spsc_ring_init(SpscRing* ring, u32 capacity) {
+    if (!ring || capacity == 0 || capacity > 0x80000000u) return false;
+
+    /* Round up to a power of two so indices can be masked */
+    u32 cap = 1;
+    while (cap < capacity) cap <<= 1;
+
+    ring->data = (u8*)malloc(cap);
+    if (!ring->data) return false;
+    ring->capacity = cap;
+    ring->head = 0;
+    ring->tail = 0;
+    return true;
+}
+
+void spsc_ring_free(SpscRing* ring) {
+    if (!ring) return;
+    free(ring->data);
+    ring->data = NULL;
+    ring->capacity = 0;
+    ring->head = 0;
+    ring->tail = 0;
+}
+
+void spsc_ring_reset(SpscRing* ring) {
+    if (!ring) return;
+    ring->head = 0;
+    ring->tail = 0;
+}
+
+/*
+ * copy_in - Write src at counter position pos, wrapping at the end
+ */
+static void copy_in(SpscRing* ring, u32 pos, const u8* src, u32 len) {
+    u32 index = pos & (ring->capacity - 1);
+    u32 first = ring->capacity - index;
+    if (first > len) first = len;
+    memcpy(ring->data + index, src, first);
+    memcpy(ring->data, src + first, len - first);
+}
+
+/*
+ * copy_out - Read len bytes at counter position pos, wrapping at the end
+ */
+static void copy_out(const SpscRing* ring, u32 pos, u8* dst, u32 len) {
+    u32 index = pos & (ring->capacity - 1);
+    u32 first = ring->capacity - index;
+    if (first > len) first = len;
+    memcpy(dst, ring->data + index, first);
+    memcpy(dst + first, ring->data, len - first);
+}
+
+u32 spsc_ring_free_space(const SpscRing* ring) {
+    u32 head = load_relaxed(&ring->head);   /* Our own index */
+    u32 tail = load_acquire(&ring->tail);   /* Consumer's index */
+    return ring->capacity - (head - tail);
+}
+
+bool spsc_ring_push(SpscRing* ring, const u8* src, u32 len) {
+    return spsc_ring_pushv(ring, src, len, NULL, 0);
+}
+
+bool spsc_ring_pushv(SpscRing* ring, const u8* a, u32 alen, const u8* b, u32 blen) {
+    if (!ring || !ring->data) return false;
+
+    u32 head = load_relaxed(&ring->head);
+    u32 tail = load_acquire(&ring->tail);
+    if (ring->capacity - (head - tail) < alen + blen) return false;
+
+    if (alen > 0) copy_in(ring, head, a, alen);
+    if (blen > 0) copy_in(ring, head + alen, b, blen);
+
+    /* Publish: bytes above become visible no later than the new head */
+    store_release(&ring->head, head + alen + blen);
+    return true;
+}
+
+u32 spsc_ring_used(const SpscRing* ring) {
+    u32 head = load_acquire(&ring->head);   /* Producer's index */
+    u32 tail = load_relaxed(&ring->tail);   /* Our own index */
+    return head - tail;
+}
+
+u32 spsc_ring_peek(const SpscRing* ring, u8* dst, u32 len) {
+    if (!ring || !ring->data) return 0;
+
+    u32 used = spsc_ring_used(ring);
+    if (len > used) len = used;
+    if (len > 0) copy_out(ring, load_relaxed(&ring->tail), dst, len);
+    return len;
+}
+
+u32 spsc_ring_peek_span(const SpscRing* ring, const u8** out) {
+    if (!ring || !ring->data || !out) return 0;
+
+    u32 used = spsc_ring_used(ring);
+    u32 index = load_relaxed(&ring->tail) & (ring->capacity - 1);
+    u32 span = ring->capacity - index;
+    *out = ring->data + index;
+    return used < span ? used : span;
+}
+
+void spsc_ring_consume(SpscRing* ring, u32 len) {
+    if (!ring) return;
+
+    /* Release: our reads of the bytes finish before the space is reused */
+    store_release(&ring->tail, load_relaxed(&ring->tail) + len);
+}
+
+u32 spsc_ring_pop(SpscRing* ring, u8* dst, u32 len) {
+    u32 n = spsc_ring_peek(ring, dst, len);
+    spsc_ring_consume(ring, n);
+    return n;
+}
@@ -0,0 +1,161 @@
+/*******************************************************************************
+ * SPSC_RING.H - Lock-Free Single-Producer/Single-Consumer Byte Ring
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Lock-free inter-thread communication
+ *   - Acquire/release memory ordering
+ *   - Free-running indices with power-of-two masking
+ *   - Record framing on top of a byte stream
+ *
+ * THE PROBLEM:
+ *
+ * The network thread produces bytes (decoded packets) that the game thread
+ * consumes, and the game thread produces bytes (outgoing packets) that the
+ * network thread writes to sockets. A mutex per hand-off would make the two
+ * threads contend on every packet.
+ *
+ * THE SOLUTION - ONE WRITER PER INDEX:
+ *
+ *   ┌───┬───┬───┬───┬───┬───┬───┬───┐
+ *   │   │ A │ B │ C │ D │   │   │   │   capacity = 8 (power of two)
+ *   └───┴───┴───┴───┴───┴───┴───┴───┘
+ *         ↑               ↑
+ *        tail            head
+ *     (consumer)      (producer)
+ *
+ *   head: total bytes ever written  - ONLY the producer stores it
+ *   tail: total bytes ever consumed - ONLY the consumer stores it
+ *
+ *   used  = head - tail          (u32 wrap-around makes this exact)
+ *   free  = capacity - used
+ *   index = counter & (capacity - 1)
+ *
+ * Because each index has exactly one writer, no compare-and-swap is needed.
+ * Correctness only depends on memory ordering:
+ *
+ *   Producer: copy bytes → store head (RELEASE)
+ *   Consumer: load head (ACQUIRE) → read bytes → store tail (RELEASE)
+ *   Producer: load tail (ACQUIRE) before reusing space
+ *
+ * The RELEASE store guarantees the bytes are visible before the new head
+ * is; the ACQUIRE load guarantees the consumer never reads ahead of them.
+ *
+ * RECORDS:
+ *   spsc_ring_push() and spsc_ring_pushv() are all-or-nothing, so a
+ *   producer that writes [header][payload] with one pushv() call never
+ *   exposes half a record to the consumer.
+ *
+ * USAGE RULE:
+ *   Exactly one thread may call the producer functions (push/pushv/
+ *   free_space) and exactly one other thread the consumer functions
+ *   (used/peek/consume/pop) for the lifetime of the ring.
+ *
+ * COMPLEXITY:
+ *   All operations O(1) + O(bytes copied); no locks, no allocation
+ *
+ ******************************************************************************/
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include "types.h"
+#include <stdbool.h>
+
+/*
+ * SpscRing - Fixed-capacity lock-free byte queue
+ */
+typedef struct {
+    u8* data;       /* Storage, capacity bytes */
+    u32 capacity;   /* Power of two */
+    u32 head;       /* Bytes written (producer-owned, atomic) */
+    u32 tail;       /* Bytes consumed (consumer-owned, atomic) */
+} SpscRing;
+
+/*
+ * spsc_ring_init - Allocate ring storage
+ *
+ * @param ring      Ring to initialize
+ * @param capacity  Requested size in bytes (rounded up to a power of two)
+ * @return          true on success, false on allocation failure
+ *
+ * Must complete before either thread starts using the ring.
+ */
+bool spsc_ring_init(SpscRing* ring, u32 capacity);
+
+/*
+ * spsc_ring_free - Release ring storage (no thread may be using it)
+ */
+void spsc_ring_free(SpscRing* ring);
+
+/*
+ * spsc_ring_reset - Empty the ring (no thread may be using it)
+ */
+void spsc_ring_reset(SpscRing* ring);
+
+/* ---- Producer side ---- */
+
+/*
+ * spsc_ring_free_space - Bytes the producer can push right now
+ */
+u32 spsc_ring_free_space(const SpscRing* ring);
+
+/*
+ * spsc_ring_push - Append len bytes, all or nothing
+ *
+ * @return  true if written, false if there was not enough space
+ */
+bool spsc_ring_push(SpscRing* ring, const u8* src, u32 len);
+
+/*
+ * spsc_ring_pushv - Append two pieces as one record, all or nothing
+ *
+ * @param a, alen  First piece (e.g. record header)
+ * @param b, blen  Second piece (e.g. payload), may be NULL when blen == 0
+ * @return         true if both were written, false if not enough space
+ *
+ * The consumer sees both pieces or neither.
+ */
+bool spsc_ring_pushv(SpscRing* ring, const u8* a, u32 alen, const u8* b, u32 blen);
+
+/* ---- Consumer side ---- */
+
+/*
+ * spsc_ring_used - Bytes available to the consumer right now
+ */
+u32 spsc_ring_used(const SpscRing* ring);
+
+/*
+ * spsc_ring_peek - Copy up to len bytes without consuming them
+ *
+ * @return  Bytes copied (min(len, used))
+ */
+u32 spsc_ring_peek(const SpscRing* ring, u8* dst, u32 len);
+
+/*
+ * spsc_ring_peek_span - Point at the next contiguous readable bytes
+ *
+ * @param ring  Ring to read
+ * @param out   Receives a pointer into the ring storage
+ * @return      Contiguous bytes available at *out (0 if empty)
+ *
+ * Zero-copy read: e.g. send() straight from the ring, then consume()
+ * what the socket accepted. Data that wraps past the end of storage is
+ * returned by a second call after consuming the first span.
+ */
+u32 spsc_ring_peek_span(const SpscRing* ring, const u8** out);
+
+/*
+ * spsc_ring_consume - Discard len bytes (len <= used)
+ */
+void spsc_ring_consume(SpscRing* ring, u32 len);
+
+/*
+ * spsc_ring_pop - Copy and consume up to len bytes
+ *
+ * @return  Bytes copied and consumed
+ */
+u32 spsc_ring_pop(SpscRing* ring, u8* dst, u32 len);
+
+#endif /* SPSC_RING_H */
@@ -0,0 +1,192 @@
+/*******************************************************************************
+ * STATIC_LOCS.C - Static Loc Table Build, Snapshot and Lookup
+ *******************************************************************************
+ *
+ * See static_locs.h for the layout.
+ *
+ * Squares are decoded in index order (x << 8 | z), each appended to one
+ * growing array and sorted in place, so first[] is written as a running
+ * prefix without a counting pass.
+ *
+ ******************************************************************************/
+
+#include "static_locs.h"
+#include "object.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+StaticLocs* g_static_locs = NULL;
+
+static int static_loc_compare(const void* a, const void* b) {
+    const StaticLoc* la = (const StaticLoc*)a;
+    const StaticLoc* lb = (const StaticLoc*)b;
+    if (la->tile != lb->tile) return la->tile < lb->tile ? -1 : 1;
+    if (la->info != lb->info) return la->info < lb->info ? -1 : 1;
+    return la->id < lb->id ? -1 : la->id > lb->id;
+}
+
+/*
+ * append_square - Decode one loc file onto the end of locs
+ *
+ * @return  false on allocation failure
+ */
+static bool append_square(StaticLocs* locs, u32* capacity, const u8* data, u32 size,
+                          i32 file_x, i32 file_z) {
+    MapLocReader reader;
+    map_loc_reader_init(&reader, data, size);
+    u32 start = locs->count;
+
+    MapLoc loc;
+    i32 status;
+    while ((status = map_loc_next(&reader, &loc)) > 0) {
+        if (loc.id < 0 || loc.id > 0xFFFF) continue;
+        if (locs->count == *capacity) {
+            u32 grown_capacity = *capacity ? *capacity * 2 : 65536;
+            StaticLoc* grown = (StaticLoc*)realloc(locs->owned_locs, grown_capacity * sizeof(StaticLoc));
+            if (!grown) return false;
+            locs->owned_locs = grown;
+            *capacity = grown_capacity;
+        }
+        StaticLoc* out = &locs->owned_locs[locs->count++];
+        out->id = (u16)loc.id;
+        out->tile = (u16)(loc.level << 12 | loc.x << 6 | loc.z);
+        out->info = (u8)(loc.shape << 2 | loc.rotation);
+        out->pad = 0;
+    }
+    if (status < 0) {
+        fprintf(stderr, "WARNING: Corrupt loc file l%d_%d, static locs cut short\n", file_x, file_z);
+    }
+
+    if (locs->count > start) {
+        qsort(&locs->owned_locs[start], locs->count - start, sizeof(StaticLoc), static_loc_compare);
+        locs->squares++;
+    }
+    return true;
+}
+
+StaticLocs* static_locs_create(const MapStore* store) {
+    if (!store) return NULL;
+
+    StaticLocs* locs = (StaticLocs*)calloc(1, sizeof(StaticLocs));
+    if (!locs) return NULL;
+    locs->owned_first = (u32*)malloc((STATIC_LOC_SQUARES + 1) * sizeof(u32));
+    if (!locs->owned_first) {
+        free(locs);
+        return NULL;
+    }
+
+    u8* buffer = NULL;
+    u32 buffer_capacity = 0;
+    u32 capacity = 0;
+    bool ok = true;
+    for (u32 square = 0; square < STATIC_LOC_SQUARES; square++) {
+        locs->owned_first[square] = locs->count;
+        if (!ok) continue;
+
+        i32 file_x = (i32)(square >> 8);
+        i32 file_z = (i32)(square & 0xFF);
+        const MapFile* file = map_store_get(store, MAP_FILE_LOC, file_x, file_z);
+        if (!file) continue;
+
+        u32 size = map_file_unpack(file, &buffer, &buffer_capacity);
+        if (size == 0) {
+            fprintf(stderr, "WARNING: Corrupt loc file l%d_%d, no static locs\n", file_x, file_z);
+            continue;
+        }
+        ok = append_square(locs, &capacity, buffer, size, file_x, file_z);
+    }
+    locs->owned_first[STATIC_LOC_SQUARES] = locs->count;
+    free(buffer);
+
+    if (!ok) {
+        static_locs_destroy(locs);
+        return NULL;
+    }
+
+    /* Give back the unused tail */
+    if (locs->count > 0) {
+        StaticLoc* fitted = (StaticLoc*)realloc(locs->owned_locs, locs->count * sizeof(StaticLoc));
+        if (fitted) locs->owned_locs = fitted;
+    }
+    locs->first = locs->owned_first;
+    locs->locs = locs->owned_locs;
+
+    u64 bytes = (u64)locs->count * sizeof(StaticLoc) + (STATIC_LOC_SQUARES + 1) * sizeof(u32);
+    printf("Static locs: %u locs in %u squares, %llu KB (%llu KB as GameObjects)\n",
+           locs->count, locs->squares, (unsigned long long)(bytes / 1024),
+           (unsigned long long)((u64)locs->count * sizeof(GameObject) / 1024));
+    return locs;
+}
+
+StaticLocs* static_locs_create_from_snapshot(const Snapshot* snapshot) {
+    u32 first_count = 0, count = 0;
+    const u32* first = snapshot_section(snapshot, SNAPSHOT_STATIC_LOC_INDEX, sizeof(u32), &first_count);
+    const StaticLoc* table = snapshot_section(snapshot, SNAPSHOT_STATIC_LOCS, sizeof(StaticLoc), &count);
+    if (!first || first_count != STATIC_LOC_SQUARES + 1 || first[0] != 0 ||
+        first[STATIC_LOC_SQUARES] != count || (count > 0 && !table)) {
+        return NULL;
+    }
+
+    /* Lookups index locs[] through first[]: it must never run backwards */
+    u32 squares = 0;
+    for (u32 i = 0; i < STATIC_LOC_SQUARES; i++) {
+        if (first[i + 1] < first[i]) return NULL;
+        if (first[i + 1] > first[i]) squares++;
+    }
+
+    StaticLocs* locs = (StaticLocs*)calloc(1, sizeof(StaticLocs));
+    if (!locs) return NULL;
+    locs->first = first;
+    locs->locs = table;
+    locs->count = count;
+    locs->squares = squares;
+    printf("Static locs mapped from the snapshot: %u locs in %u squares\n", count, squares);
+    return locs;
+}
+
+bool static_locs_snapshot(const StaticLocs* locs, SnapshotWriter* writer) {
+    if (!locs || !writer) return false;
+    snapshot_writer_set(writer, SNAPSHOT_STATIC_LOC_INDEX, locs->first, sizeof(u32),
+                        STATIC_LOC_SQUARES + 1);
+    snapshot_writer_set(writer, SNAPSHOT_STATIC_LOCS, locs->locs, sizeof(StaticLoc), locs->count);
+    return true;
+}
+
+void static_locs_destroy(StaticLocs* locs) {
+    if (!locs) return;
+    free(locs->owned_first);
+    free(locs->owned_locs);
+    free(locs);
+}
+
+const StaticLoc* static_locs_square(const StaticLocs* locs, u32 square_x, u32 square_z, u32* count) {
+    *count = 0;
+    if (!locs || square_x > 255 || square_z > 255) return NULL;
+
+    u32 square = square_x << 8 | square_z;
+    *count = locs->first[square + 1] - locs->first[square];
+    return *count ? &locs->locs[locs->first[square]] : NULL;
+}
+
+const StaticLoc* static_locs_at(const StaticLocs* locs, u32 x, u32 z, u32 level, u8 type) {
+    u32 count;
+    const StaticLoc* square = static_locs_square(locs, x >> 6, z >> 6, &count);
+    if (!square) return NULL;
+
+    /* Lower bound of the tile, then its few locs */
+    u16 tile = (u16)((level & 3) << 12 | (x & 63) << 6 | (z & 63));
+    u32 lo = 0, hi = count;
+    while (lo < hi) {
+        u32 mid = (lo + hi) / 2;
+        if (square[mid].tile < tile) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    for (u32 i = lo; i < count && square[i].tile == tile; i++) {
+        if (object_type_for_shape((i32)static_loc_shape(&square[i])) == type) return &square[i];
+    }
+    return NULL;
+}
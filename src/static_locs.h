@@ -0,0 +1,164 @@
+/*******************************************************************************
+ * STATIC_LOCS.H - Every Map Loc in Six Bytes, One Array per Mapsquare
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Struct packing: store what cannot be derived, derive the rest
+ *   - Immutable data beside a small mutable overlay (copy-on-write in
+ *     spirit: changes shadow the base, the base is never written)
+ *   - Prefix offsets (CSR layout) instead of per-bucket allocations
+ *   - Sharing read-only tables between processes through a mapped file
+ *
+ * THE PROBLEM:
+ *
+ * The l<x>_<z> map files place every tree, wall, door, table and flower
+ * of the world, hundreds of thousands of locs. Held as GameObjects
+ * (object.h) each one is 32 bytes plus its position table entry, most
+ * of it spent on fields a map loc never uses:
+ *
+ *   GameObject (32 bytes)                 a map loc needs
+ *   ┌─────────────────────────────┐
+ *   │ id              2           │       id
+ *   │ position        4 (+ pad)   │       tile in its mapsquare (the
+ *   │ type, rotation, temporary   │         square is where it is filed)
+ *   │ spawn_time      8           │       shape (type derives from it)
+ *   │ despawn_timer   4 (+ pad)   │       rotation
+ *   └─────────────────────────────┘
+ *
+ * and every world process builds its own copy of a table that is the
+ * same for all of them and never changes.
+ *
+ * THE SOLUTION - PACKED, SORTED, PER-SQUARE ARRAYS:
+ *
+ *   StaticLoc (6 bytes): id:16  tile:16 (level:2 x:6 z:6)  info:8 (shape:6 rot:2)
+ *
+ *   first[] (one per square, + 1)        locs[] (sorted by square, then tile)
+ *   ┌──────────────┐
+ *   │ (50,50): 1200├───────────────────→ [1200 .. 1843) the locs of 50,50
+ *   │ (50,51): 1843├──────┐                 sorted by tile, so the locs
+ *   │ (50,52): 1843│      └────────────→    of one tile are adjacent and
+ *   └──────────────┘                         found by binary search
+ *     a square without locs: first[s] == first[s + 1]
+ *
+ *   The tables live in the world snapshot (snapshot.h), so a second
+ *   world process on the same machine maps the same pages instead of
+ *   decoding the map files again: immutable, hence shareable.
+ *
+ * CHANGES ARE OVERRIDES, NOT EDITS:
+ *   A door opened, a tree cut, a loc spawned in play: GameObjects in the
+ *   object system (object.h) at that tile and type. object_loc_at()
+ *   asks the object system first and only falls back to this table:
+ *
+ *     object_loc_at(tile, type)
+ *       ├─ GameObject there, not removed → it (the override)
+ *       ├─ GameObject there, removed     → nothing (a static loc hidden)
+ *       └─ none                          → static_locs_at(tile, type)
+ *
+ * LEVELS:
+ *   Locs keep the level of their file. Collision moves locs under a
+ *   bridge down a level (world_collision.c); this table is what the map
+ *   says, and what the client is told it shows.
+ *
+ * THREAD SAFETY:
+ *   Immutable after creation: any thread may read it.
+ *
+ ******************************************************************************/
+
+#ifndef STATIC_LOCS_H
+#define STATIC_LOCS_H
+
+#include "types.h"
+#include "map_store.h"
+#include "snapshot.h"
+#include <stdbool.h>
+
+/* Mapsquares: one per possible map file */
+#define STATIC_LOC_SQUARES (256 * 256)
+
+/*
+ * StaticLoc - One map loc
+ */
+typedef struct {
+    u16 id;
+    u16 tile;               /* level << 12 | x << 6 | z, local to the square */
+    u8 info;                /* shape << 2 | rotation */
+    u8 pad;
+} StaticLoc;
+
+static inline u32 static_loc_level(const StaticLoc* loc) { return loc->tile >> 12 & 0x3; }
+static inline u32 static_loc_x(const StaticLoc* loc) { return loc->tile >> 6 & 0x3f; }
+static inline u32 static_loc_z(const StaticLoc* loc) { return loc->tile & 0x3f; }
+static inline u32 static_loc_shape(const StaticLoc* loc) { return loc->info >> 2; }
+static inline u32 static_loc_rotation(const StaticLoc* loc) { return loc->info & 0x3; }
+
+/*
+ * StaticLocs - Every map loc, filed by mapsquare
+ */
+typedef struct {
+    const u32* first;       /* STATIC_LOC_SQUARES + 1 offsets into locs */
+    const StaticLoc* locs;
+    u32 count;
+    u32 squares;            /* Squares with at least one loc */
+
+    u32* owned_first;       /* Built this boot (NULL if mapped) */
+    StaticLoc* owned_locs;
+} StaticLocs;
+
+/*
+ * g_static_locs - The world's map locs, or NULL (no map files)
+ */
+extern StaticLocs* g_static_locs;
+
+/*
+ * static_locs_create - Decode every loc file of a map store
+ *
+ * @param store  Map files (g_map_store)
+ * @return       Table, or NULL if store is NULL or allocation fails
+ *
+ * Corrupt loc files keep the locs read before the damage, with a warning.
+ *
+ * COMPLEXITY: O(map bytes + locs × log(locs per square))
+ */
+StaticLocs* static_locs_create(const MapStore* store);
+
+/*
+ * static_locs_create_from_snapshot - Point a table at a snapshot's locs
+ *
+ * @return  Table, or NULL if the sections are missing or inconsistent
+ *
+ * COMPLEXITY: O(squares) validation, no decoding
+ */
+StaticLocs* static_locs_create_from_snapshot(const Snapshot* snapshot);
+
+/*
+ * static_locs_snapshot - Add the table to a snapshot writer
+ */
+bool static_locs_snapshot(const StaticLocs* locs, SnapshotWriter* writer);
+
+/*
+ * static_locs_destroy - Free the table (NULL-safe)
+ */
+void static_locs_destroy(StaticLocs* locs);
+
+/*
+ * static_locs_square - The locs of one mapsquare, sorted by tile
+ *
+ * @param count  Receives the number of locs (0 if none)
+ * @return       First loc, or NULL if none
+ *
+ * COMPLEXITY: O(1)
+ */
+const StaticLoc* static_locs_square(const StaticLocs* locs, u32 square_x, u32 square_z, u32* count);
+
+/*
+ * static_locs_at - The map loc of a type at a world tile
+ *
+ * @param type  ObjectType (object.h), derived from each loc's shape
+ * @return      Loc, or NULL if the map has none there
+ *
+ * COMPLEXITY: O(log(locs in the square))
+ */
+const StaticLoc* static_locs_at(const StaticLocs* locs, u32 x, u32 z, u32 level, u8 type);
+
+#endif /* STATIC_LOCS_H */
@@ -0,0 +1,133 @@
+/*******************************************************************************
+ * SUPERVISOR.C - World Processes
+ *******************************************************************************
+ *
+ * See supervisor.h for what is shared between the worlds and why.
+ *
+ ******************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "supervisor.h"
+#include "account_registry.h"
+#include "presence.h"
+#include "cluster.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+u32 g_world_id = 0;
+
+#ifndef _WIN32
+
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/* Children still running (0 = exited); read by the signal handler */
+static volatile pid_t world_pids[SUPERVISOR_MAX_WORLDS];
+static u32 world_count = 0;
+
+/* Pass SIGINT / SIGTERM on to every world (kill is async-signal-safe) */
+static void supervisor_forward_signal(int sig) {
+    for (u32 i = 0; i < world_count; i++) {
+        if (world_pids[i] > 0) kill(world_pids[i], sig);
+    }
+}
+
+int supervisor_run(u32 worlds, WorldMain run, void* ctx) {
+    if (worlds == 0 || worlds > SUPERVISOR_MAX_WORLDS || !run) return 1;
+
+    struct sigaction forward;
+    memset(&forward, 0, sizeof(forward));
+    forward.sa_handler = supervisor_forward_signal;
+    sigemptyset(&forward.sa_mask);
+    sigaction(SIGINT, &forward, NULL);
+    sigaction(SIGTERM, &forward, NULL);
+
+    /* Buffered output would otherwise be printed once per child */
+    fflush(stdout);
+    fflush(stderr);
+
+    /* Presence directory: one socket pair per world, served from this loop */
+    static PresenceService presence;
+    bool directory = presence_service_create(&presence, worlds);
+    if (!directory) fprintf(stderr, "WARNING: Presence directory unavailable, worlds see only themselves\n");
+
+    world_count = worlds;
+    u32 running = 0;
+    for (u32 world = 0; world < worlds; world++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            /* The world installs its own shutdown handlers */
+            signal(SIGINT, SIG_DFL);
+            signal(SIGTERM, SIG_DFL);
+            g_world_id = world;
+            if (directory) presence_service_enter_world(&presence, world);
+            cluster_links_enter_node(world);
+            exit(run(world, ctx));
+        }
+        if (pid < 0) {
+            perror("fork");
+            world_pids[world] = 0;
+            continue;
+        }
+        world_pids[world] = pid;
+        running++;
+        printf("Supervisor: world %u started (pid %d)\n", world, (int)pid);
+        fflush(stdout);             /* Or the next child prints it again */
+    }
+
+    if (directory) presence_service_forked(&presence);
+    cluster_links_forked();
+
+    /* A failed fork stops the worlds already started */
+    int result = running == worlds ? 0 : 1;
+    if (result != 0) supervisor_forward_signal(SIGTERM);
+
+    /* With a directory to serve, check for exited worlds between polls */
+    while (running > 0) {
+        if (directory) presence_service_poll(&presence, PRESENCE_POLL_MS);
+        int status = 0;
+        pid_t pid = waitpid(-1, &status, directory ? WNOHANG : 0);
+        if (pid == 0) continue;
+        if (pid < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        for (u32 world = 0; world < worlds; world++) {
+            if (world_pids[world] != pid) continue;
+            world_pids[world] = 0;
+            running--;
+
+            u32 dropped = account_registry_drop_world(g_account_registry, world);
+            if (directory) presence_service_world_down(&presence, world);
+            if (WIFEXITED(status)) {
+                printf("Supervisor: world %u exited with %d (%u accounts released)\n",
+                       world, WEXITSTATUS(status), dropped);
+                if (WEXITSTATUS(status) != 0) result = 1;
+            } else if (WIFSIGNALED(status)) {
+                printf("Supervisor: world %u killed by signal %d (%u accounts released)\n",
+                       world, WTERMSIG(status), dropped);
+                result = 1;
+            }
+        }
+    }
+
+    if (directory) presence_service_destroy(&presence);
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    return result;
+}
+
+#else /* _WIN32 */
+
+int supervisor_run(u32 worlds, WorldMain run, void* ctx) {
+    (void)worlds; (void)run; (void)ctx;
+    fprintf(stderr, "ERROR: --worlds needs fork(), not available on this platform\n");
+    return 1;
+}
+
+#endif /* _WIN32 */
@@ -0,0 +1,106 @@
+/*******************************************************************************
+ * SUPERVISOR.H - Several Worlds per Host, One Copy of the Assets
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - fork() after loading: copy-on-write sharing of read-only data
+ *   - File-backed mappings shared through the page cache
+ *   - Supervising child processes (signals in, exit status out)
+ *
+ * THE PROBLEM:
+ *
+ * Running several worlds on one host used to mean several bin/rs225
+ * processes, each decompressing the same archives and building the
+ * same maps, collision and definitions:
+ *
+ *   world 1:  cache + maps + collision + defs + dynamic state
+ *   world 2:  cache + maps + collision + defs + dynamic state
+ *   world 3:  cache + maps + collision + defs + dynamic state
+ *             └──────── identical, N times ────────┘
+ *
+ * THE SOLUTION - LOAD ONCE, THEN FORK:
+ *
+ *   bin/rs225 --worlds 3
+ *
+ *   supervisor:  server_load_assets()          cache, snapshot mmap, maps,
+ *                account_registry_create()     collision, defs, spawns
+ *                fork() × 3 ────────┬──────────────┬──────────────┐
+ *                                   ▼              ▼              ▼
+ *                               world 0        world 1        world 2
+ *                               port 43594     port 43595     port 43596
+ *                               server_init()  (assets already loaded:
+ *                               own World, GameServer, players, threads)
+ *
+ *   Pages loaded before the fork are shared by every world until one
+ *   of them writes to a page (copy-on-write). The snapshot file is
+ *   mapped, so its pages are shared through the page cache in any case.
+ *   What each extra world adds is its own dynamic state: player slots,
+ *   world lists, NPC and ground item state, output buffers.
+ *
+ * ONE LOGIN/SAVE SERVICE:
+ *   Every world writes the same save directory. The account registry
+ *   (account_registry.h), mapped shared before the fork, lets only one
+ *   world hold an account and keeps it claimed until that world's
+ *   logout save is on disk.
+ *
+ * ONE PRESENCE DIRECTORY:
+ *   While it waits for the worlds, the supervisor serves the presence
+ *   directory (presence.h): who is online on which world, pushed to a
+ *   replica in every world once per tick.
+ *
+ * ONE WORLD ON SEVERAL NODES:
+ *   With --cluster N the children are not separate worlds but nodes of
+ *   one: each owns a band of the map, and players near a band edge or
+ *   crossing it are passed over links made before the fork (cluster.h).
+ *
+ * SIGNALS:
+ *   SIGINT / SIGTERM to the supervisor are passed on to every world,
+ *   which shuts down as a single server would. The supervisor returns
+ *   once all worlds have exited, freeing the claims of each as it goes.
+ *   A world that crashes is not restarted.
+ *
+ * WHY PROCESSES, NOT THREADS:
+ *   The game state lives in globals (g_world, g_server, g_npcs, ...).
+ *   Separate processes give each world its own copy of them for free,
+ *   and one world's crash cannot take the others down.
+ *
+ * PLATFORM:
+ *   POSIX (fork). On Windows supervisor_run() fails and returns 1.
+ *
+ ******************************************************************************/
+
+#ifndef SUPERVISOR_H
+#define SUPERVISOR_H
+
+#include "types.h"
+
+/* Most worlds one supervisor starts */
+#define SUPERVISOR_MAX_WORLDS 16
+
+/* This process's world (0 unless started by a supervisor) */
+extern u32 g_world_id;
+
+/*
+ * WorldMain - Run one world to completion in a child process
+ *
+ * @param world  World index [0, worlds)
+ * @param ctx    Caller's context
+ * @return       Exit code for the child
+ */
+typedef int (*WorldMain)(u32 world, void* ctx);
+
+/*
+ * supervisor_run - Fork the worlds and wait for them
+ *
+ * @param worlds  Number of worlds [1, SUPERVISOR_MAX_WORLDS]
+ * @param run     Body of each world (called in the child)
+ * @param ctx     Passed to run
+ * @return        0 if every world exited with 0, else 1
+ *
+ * Call after server_load_assets() and account_registry_create(), so both
+ * are inherited.
+ */
+int supervisor_run(u32 worlds, WorldMain run, void* ctx);
+
+#endif /* SUPERVISOR_H */
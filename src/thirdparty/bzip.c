@@ -29,6 +29,25 @@
     Manuel
 */
 
+/*
+    Table-driven rewrite for in-memory jagfile archives.
+
+    The decoder now works on whole buffers only (no file descriptors, no
+    setjmp/longjmp) and is organised around where the time actually goes:
+
+    - Huffman symbols are decoded with a per-group lookup table indexed by
+      the next HUFF_LOOKUP_BITS bits of input. Nearly every symbol resolves
+      with one load; longer codes fall back to the canonical limit/base walk.
+    - Input is read through a 64-bit bit buffer refilled a byte at a time
+      only when it drops below MAX_HUFCODE_BITS, instead of per call.
+    - MTF/RLE2 decoding and the byte histogram are a single pass over the
+      symbols; the inverse BWT walk, RLE1 expansion and CRC update are a
+      single fused pass that writes straight into the caller's buffer.
+    - The CRC table is a compile-time constant and the ~450KB decoder state
+      is reused between calls, so steady-state decompression allocates
+      nothing.
+*/
+
 #include "bzip.h"
 
 const char BZIP_HEADER[] = {'B', 'Z', 'h', '1'};
@@ -42,72 +61,204 @@ const char *bunzip_errors[] = {NULL,
                          "Out of memory",
                          "Obsolete (pre 0.9.5) bzip format not supported."};
 
-/* Return the next nnn bits of input.  All reads from the compressed input
-   are done through this function.  All reads are big endian */
-static uint32_t get_bits(bunzip_data *bd, uint8_t bits_wanted) {
-    uint32_t bits = 0;
-
-    /* If we need to get more data from the byte buffer, do so.  (Loop getting
-       one byte at a time to enforce endianness and avoid unaligned access.) */
-    while (bd->inbufBitCount < bits_wanted) {
-        /* If we need to read more data from file into byte buffer, do so */
-        if (bd->inbufPos == bd->inbufCount) {
-            #ifdef NXDK
-            if (!ReadFile((HANDLE)bd->in_fd, bd->inbuf, IOBUF_SIZE, (LPDWORD)&bd->inbufCount, NULL) || bd->inbufCount == 0) {
-            #elif defined(_WIN32)
-            if ((bd->inbufCount = _read(bd->in_fd, bd->inbuf, IOBUF_SIZE)) <= 0) {
-            #else
-            if ((bd->inbufCount = read(bd->in_fd, bd->inbuf, IOBUF_SIZE)) <= 0) {
-            #endif
-#if !defined(__wasm) || defined(__EMSCRIPTEN__)
-                longjmp(bd->jmpbuf, RETVAL_UNEXPECTED_INPUT_EOF);
-#endif
+/* Big-endian CRC32 (polynomial 0x04c11db7), as used by bzip2 */
+static const uint32_t crc32_table[256] = {
+    0x00000000, 0x04c11db7, 0x09823b6e, 0x0d4326d9, 0x130476dc, 0x17c56b6b,
+    0x1a864db2, 0x1e475005, 0x2608edb8, 0x22c9f00f, 0x2f8ad6d6, 0x2b4bcb61,
+    0x350c9b64, 0x31cd86d3, 0x3c8ea00a, 0x384fbdbd, 0x4c11db70, 0x48d0c6c7,
+    0x4593e01e, 0x4152fda9, 0x5f15adac, 0x5bd4b01b, 0x569796c2, 0x52568b75,
+    0x6a1936c8, 0x6ed82b7f, 0x639b0da6, 0x675a1011, 0x791d4014, 0x7ddc5da3,
+    0x709f7b7a, 0x745e66cd, 0x9823b6e0, 0x9ce2ab57, 0x91a18d8e, 0x95609039,
+    0x8b27c03c, 0x8fe6dd8b, 0x82a5fb52, 0x8664e6e5, 0xbe2b5b58, 0xbaea46ef,
+    0xb7a96036, 0xb3687d81, 0xad2f2d84, 0xa9ee3033, 0xa4ad16ea, 0xa06c0b5d,
+    0xd4326d90, 0xd0f37027, 0xddb056fe, 0xd9714b49, 0xc7361b4c, 0xc3f706fb,
+    0xceb42022, 0xca753d95, 0xf23a8028, 0xf6fb9d9f, 0xfbb8bb46, 0xff79a6f1,
+    0xe13ef6f4, 0xe5ffeb43, 0xe8bccd9a, 0xec7dd02d, 0x34867077, 0x30476dc0,
+    0x3d044b19, 0x39c556ae, 0x278206ab, 0x23431b1c, 0x2e003dc5, 0x2ac12072,
+    0x128e9dcf, 0x164f8078, 0x1b0ca6a1, 0x1fcdbb16, 0x018aeb13, 0x054bf6a4,
+    0x0808d07d, 0x0cc9cdca, 0x7897ab07, 0x7c56b6b0, 0x71159069, 0x75d48dde,
+    0x6b93dddb, 0x6f52c06c, 0x6211e6b5, 0x66d0fb02, 0x5e9f46bf, 0x5a5e5b08,
+    0x571d7dd1, 0x53dc6066, 0x4d9b3063, 0x495a2dd4, 0x44190b0d, 0x40d816ba,
+    0xaca5c697, 0xa864db20, 0xa527fdf9, 0xa1e6e04e, 0xbfa1b04b, 0xbb60adfc,
+    0xb6238b25, 0xb2e29692, 0x8aad2b2f, 0x8e6c3698, 0x832f1041, 0x87ee0df6,
+    0x99a95df3, 0x9d684044, 0x902b669d, 0x94ea7b2a, 0xe0b41de7, 0xe4750050,
+    0xe9362689, 0xedf73b3e, 0xf3b06b3b, 0xf771768c, 0xfa325055, 0xfef34de2,
+    0xc6bcf05f, 0xc27dede8, 0xcf3ecb31, 0xcbffd686, 0xd5b88683, 0xd1799b34,
+    0xdc3abded, 0xd8fba05a, 0x690ce0ee, 0x6dcdfd59, 0x608edb80, 0x644fc637,
+    0x7a089632, 0x7ec98b85, 0x738aad5c, 0x774bb0eb, 0x4f040d56, 0x4bc510e1,
+    0x46863638, 0x42472b8f, 0x5c007b8a, 0x58c1663d, 0x558240e4, 0x51435d53,
+    0x251d3b9e, 0x21dc2629, 0x2c9f00f0, 0x285e1d47, 0x36194d42, 0x32d850f5,
+    0x3f9b762c, 0x3b5a6b9b, 0x0315d626, 0x07d4cb91, 0x0a97ed48, 0x0e56f0ff,
+    0x1011a0fa, 0x14d0bd4d, 0x19939b94, 0x1d528623, 0xf12f560e, 0xf5ee4bb9,
+    0xf8ad6d60, 0xfc6c70d7, 0xe22b20d2, 0xe6ea3d65, 0xeba91bbc, 0xef68060b,
+    0xd727bbb6, 0xd3e6a601, 0xdea580d8, 0xda649d6f, 0xc423cd6a, 0xc0e2d0dd,
+    0xcda1f604, 0xc960ebb3, 0xbd3e8d7e, 0xb9ff90c9, 0xb4bcb610, 0xb07daba7,
+    0xae3afba2, 0xaafbe615, 0xa7b8c0cc, 0xa379dd7b, 0x9b3660c6, 0x9ff77d71,
+    0x92b45ba8, 0x9675461f, 0x8832161a, 0x8cf30bad, 0x81b02d74, 0x857130c3,
+    0x5d8a9099, 0x594b8d2e, 0x5408abf7, 0x50c9b640, 0x4e8ee645, 0x4a4ffbf2,
+    0x470cdd2b, 0x43cdc09c, 0x7b827d21, 0x7f436096, 0x7200464f, 0x76c15bf8,
+    0x68860bfd, 0x6c47164a, 0x61043093, 0x65c52d24, 0x119b4be9, 0x155a565e,
+    0x18197087, 0x1cd86d30, 0x029f3d35, 0x065e2082, 0x0b1d065b, 0x0fdc1bec,
+    0x3793a651, 0x3352bbe6, 0x3e119d3f, 0x3ad08088, 0x2497d08d, 0x2056cd3a,
+    0x2d15ebe3, 0x29d4f654, 0xc5a92679, 0xc1683bce, 0xcc2b1d17, 0xc8ea00a0,
+    0xd6ad50a5, 0xd26c4d12, 0xdf2f6bcb, 0xdbee767c, 0xe3a1cbc1, 0xe760d676,
+    0xea23f0af, 0xeee2ed18, 0xf0a5bd1d, 0xf464a0aa, 0xf9278673, 0xfde69bc4,
+    0x89b8fd09, 0x8d79e0be, 0x803ac667, 0x84fbdbd0, 0x9abc8bd5, 0x9e7d9662,
+    0x933eb0bb, 0x97ffad0c, 0xafb010b1, 0xab710d06, 0xa6322bdf, 0xa2f33668,
+    0xbcb4666d, 0xb8757bda, 0xb5365d03, 0xb1f740b4
+};
+
+/* Top up the bit buffer so at least 57 bits are available. Past the end of
+   the input, zero bytes are shifted in and counted in padBits. */
+static void refill_bits(bunzip_data *bd) {
+    while (bd->bitCount <= 56) {
+        uint64_t byte = 0;
+
+        if (bd->inPos < bd->inLen) {
+            byte = bd->in[bd->inPos++];
+        } else {
+            bd->padBits += 8;
+        }
+
+        bd->bitBuf |= byte << (56 - bd->bitCount);
+        bd->bitCount += 8;
+    }
+}
+
+/* Return the next bits_wanted (1-32) bits of input, big endian */
+static uint32_t get_bits(bunzip_data *bd, uint32_t bits_wanted) {
+    uint32_t bits;
+
+    if (bd->bitCount < bits_wanted) {
+        refill_bits(bd);
+    }
+
+    bits = (uint32_t)(bd->bitBuf >> (64 - bits_wanted));
+    bd->bitBuf <<= bits_wanted;
+    bd->bitCount -= bits_wanted;
+    return bits;
+}
+
+/* True once the decoder has consumed padding instead of real input */
+static int input_overrun(const bunzip_data *bd) {
+    return bd->bitCount < bd->padBits;
+}
+
+/* Build lookup[], limit[], base[] and permute[] for one group from its code
+   lengths. Codes are canonical: shorter codes first, ties by symbol. */
+static int build_group(struct group_data *g, const uint8_t *length,
+                       uint32_t symCount) {
+    uint32_t count[MAX_HUFCODE_BITS + 1] = {0};
+    uint32_t minLen = MAX_HUFCODE_BITS, maxLen = 0, i, len, pp, code;
+
+    for (i = 0; i < symCount; i++) {
+        count[length[i]]++;
+
+        if (length[i] < minLen)
+            minLen = length[i];
+        if (length[i] > maxLen)
+            maxLen = length[i];
+    }
+
+    g->minLen = minLen;
+    g->maxLen = maxLen;
+    memset(g->lookup, 0, sizeof(g->lookup));
+
+    pp = code = 0;
+
+    for (len = minLen; len <= maxLen; len++) {
+        uint32_t first = code;
+
+        g->base[len] = (int32_t)pp - (int32_t)first;
+
+        for (i = 0; i < symCount; i++) {
+            if (length[i] == len) {
+                g->permute[pp++] = (uint16_t)i;
             }
+        }
 
-            bd->inbufPos = 0;
+        code += count[len];
+
+        /* Over-subscribed code: lengths do not describe a prefix code */
+        if (code > (1u << len)) {
+            return RETVAL_DATA_ERROR;
         }
 
-        /* Avoid 32-bit overflow (dump bit buffer to top of output) */
-        if (bd->inbufBitCount >= 24) {
-            bits = bd->inbufBits & ((1 << bd->inbufBitCount) - 1);
-            bits_wanted -= bd->inbufBitCount;
-            bits <<= bits_wanted;
-            bd->inbufBitCount = 0;
+        g->limit[len] = (int32_t)code;
+
+        /* Short codes: replicate into every table slot they prefix */
+        if (len <= HUFF_LOOKUP_BITS) {
+            uint32_t shift = HUFF_LOOKUP_BITS - len, c;
+
+            for (c = first; c < code; c++) {
+                uint16_t entry = (uint16_t)((g->permute[c + g->base[len]] << 5) | len);
+                uint32_t slot = c << shift, end = (c + 1) << shift;
+
+                while (slot < end) {
+                    g->lookup[slot++] = entry;
+                }
+            }
         }
 
-        /* Grab next 8 bits of input from buffer. */
-        bd->inbufBits = (bd->inbufBits << 8) | bd->inbuf[bd->inbufPos++];
-        bd->inbufBitCount += 8;
+        code <<= 1;
     }
 
-    /* Calculate result */
-    bd->inbufBitCount -= bits_wanted;
-    bits |= (bd->inbufBits >> bd->inbufBitCount) & ((1 << bits_wanted) - 1);
+    return RETVAL_OK;
+}
 
-    return bits;
+/* Decode one Huffman symbol with group g, or return -1 on a bad code */
+static int decode_symbol(bunzip_data *bd, const struct group_data *g,
+                         uint32_t symCount) {
+    uint32_t entry, len, c;
+    int32_t idx;
+
+    if (bd->bitCount < MAX_HUFCODE_BITS) {
+        refill_bits(bd);
+    }
+
+    entry = g->lookup[bd->bitBuf >> (64 - HUFF_LOOKUP_BITS)];
+
+    if (entry) {
+        len = entry & 31;
+        bd->bitBuf <<= len;
+        bd->bitCount -= len;
+        return (int)(entry >> 5);
+    }
+
+    /* Longer than the table: walk the canonical limits */
+    len = g->minLen > HUFF_LOOKUP_BITS ? g->minLen : HUFF_LOOKUP_BITS + 1;
+
+    for (; len <= g->maxLen; len++) {
+        c = (uint32_t)(bd->bitBuf >> (64 - len));
+
+        if ((int32_t)c < g->limit[len]) {
+            idx = (int32_t)c + g->base[len];
+
+            if (idx < 0 || (uint32_t)idx >= symCount) {
+                return -1;
+            }
+
+            bd->bitBuf <<= len;
+            bd->bitCount -= len;
+            return g->permute[idx];
+        }
+    }
+
+    return -1;
 }
 
-/* Unpacks the next block and sets up for the inverse burrows-wheeler step. */
+/* Unpacks the next block into dbuf and sets up for the inverse BWT. */
 static int get_next_block(bunzip_data *bd) {
-    struct group_data *hufGroup;
-    uint32_t dbufCount, nextSym, dbufSize, groupCount, *base, *limit, selector,
-        i, j, k, t, runPos, symCount, symTotal, nSelectors, byteCount[256];
+    const struct group_data *hufGroup = NULL;
+    uint32_t dbufCount, groupCount, selector, i, j, k, t, runPos, symCount,
+        symTotal, nSelectors, groupLeft, byteCount[256];
     uint8_t uc, symToByte[256], mtfSymbol[256], *selectors;
     uint32_t *dbuf, origPtr;
+    int nextSym;
 
     dbuf = bd->dbuf;
-    dbufSize = bd->dbufSize;
     selectors = bd->selectors;
 
-    /* Reset longjmp I/O error handling */
-#if !defined(__wasm) || defined(__EMSCRIPTEN__)
-    i = setjmp(bd->jmpbuf);
-
-    if (i) {
-        return i;
-    }
-#endif
-
     /* Read in header signature and CRC, then validate signature.
        (last block signature means CRC is for whole file, return now) */
     i = get_bits(bd, 24);
@@ -115,6 +266,10 @@ static int get_next_block(bunzip_data *bd) {
 
     bd->headerCRC = get_bits(bd, 32);
 
+    if (input_overrun(bd)) {
+        return RETVAL_UNEXPECTED_INPUT_EOF;
+    }
+
     if ((i == 0x177245) && (j == 0x385090)) {
         return RETVAL_LAST_BLOCK;
     }
@@ -123,22 +278,18 @@ static int get_next_block(bunzip_data *bd) {
         return RETVAL_NOT_BZIP_DATA;
     }
 
-    /* We can add support for blockRandomised if anybody complains.  There was
-       some code for this in busybox 1.0.0-pre3, but nobody ever noticed that
-       it didn't actually work. */
+    /* Randomised blocks have not been produced since bzip2 0.9.5 */
     if (get_bits(bd, 1)) {
         return RETVAL_OBSOLETE_INPUT;
     }
 
-    if ((origPtr = get_bits(bd, 24)) > dbufSize) {
+    if ((origPtr = get_bits(bd, 24)) > BZIP_BLOCK_SIZE) {
         return RETVAL_DATA_ERROR;
     }
 
-    /* mapping table: if some byte values are never used (encoding things
-       like ascii text), the compression code removes the gaps to have fewer
-       symbols to deal with, and writes a sparse bitfield indicating which
-       values were present.  We make a translation table to convert the symbols
-       back to the corresponding bytes. */
+    /* mapping table: a sparse bitfield of which byte values occur in the
+       block. We make a translation table to convert the symbols back to the
+       corresponding bytes. */
     t = get_bits(bd, 16);
     symTotal = 0;
 
@@ -148,7 +299,7 @@ static int get_next_block(bunzip_data *bd) {
 
             for (j = 0; j < 16; j++) {
                 if (k & (1 << (15 - j))) {
-                    symToByte[symTotal++] = (16 * i) + j;
+                    symToByte[symTotal++] = (uint8_t)((16 * i) + j);
                 }
             }
         }
@@ -162,26 +313,22 @@ static int get_next_block(bunzip_data *bd) {
     }
 
     /* nSelectors: Every GROUP_SIZE many symbols we select a new huffman coding
-       group.  Read in the group selector list, which is stored as MTF encoded
-       bit runs.  (MTF=Move To Front, as each value is used it's moved to the
-       start of the list.) */
+       group. The selector list is stored as MTF encoded unary runs. */
     if (!(nSelectors = get_bits(bd, 15))) {
         return RETVAL_DATA_ERROR;
     }
 
     for (i = 0; i < groupCount; i++) {
-        mtfSymbol[i] = i;
+        mtfSymbol[i] = (uint8_t)i;
     }
 
     for (i = 0; i < nSelectors; i++) {
-        /* Get next value */
         for (j = 0; get_bits(bd, 1); j++) {
-            if (j >= groupCount) {
+            if (j >= groupCount - 1) {
                 return RETVAL_DATA_ERROR;
             }
         }
 
-        /* Decode MTF to get the next selector */
         uc = mtfSymbol[j];
 
         for (; j; j--) {
@@ -191,219 +338,103 @@ static int get_next_block(bunzip_data *bd) {
         mtfSymbol[0] = selectors[i] = uc;
     }
 
+    if (input_overrun(bd)) {
+        return RETVAL_UNEXPECTED_INPUT_EOF;
+    }
+
     /* Read the huffman coding tables for each group, which code for symTotal
        literal symbols, plus two run symbols (RUNA, RUNB) */
     symCount = symTotal + 2;
 
     for (j = 0; j < groupCount; j++) {
-        uint8_t length[MAX_SYMBOLS], temp[MAX_HUFCODE_BITS + 1];
-        uint32_t minLen, maxLen, pp;
+        uint8_t length[MAX_SYMBOLS];
+        int ret;
 
-        /* Read huffman code lengths for each symbol.  They're stored in
-           a way similar to mtf; record a starting value for the first symbol,
-           and an offset from the previous value for everys symbol after that.
-           (Subtracting 1 before the loop and then adding it back at the end is
-           an optimization that makes the test inside the loop simpler: symbol
-           length 0 becomes negative, so an unsigned inequality catches it.) */
-        t = get_bits(bd, 5) - 1;
+        /* Delta-coded lengths: a start value, then per symbol a run of
+           "10" (+1) / "11" (-1) pairs terminated by a single 0 bit */
+        t = get_bits(bd, 5);
 
         for (i = 0; i < symCount; i++) {
             for (;;) {
-                if (((unsigned)t) > (MAX_HUFCODE_BITS - 1)) {
+                if (t < 1 || t > MAX_HUFCODE_BITS) {
                     return RETVAL_DATA_ERROR;
                 }
 
-                /* If first bit is 0, stop.  Else second bit indicates whether
-                   to increment or decrement the value.  Optimization: grab 2
-                   bits and unget the second if the first was 0. */
-                k = get_bits(bd, 2);
+                if (bd->bitCount < 2) {
+                    refill_bits(bd);
+                }
+
+                k = (uint32_t)(bd->bitBuf >> 62);
 
                 if (k < 2) {
-                    bd->inbufBitCount++;
+                    bd->bitBuf <<= 1;
+                    bd->bitCount -= 1;
                     break;
                 }
 
-                /* Add one if second bit 1, else subtract 1.  Avoids if/else */
-                t += (((k + 1) & 2) - 1);
+                bd->bitBuf <<= 2;
+                bd->bitCount -= 2;
+                t += (k == 2) ? 1 : (uint32_t)-1;
             }
 
-            /* Correct for the initial -1, to get the final symbol length */
-            length[i] = t + 1;
+            length[i] = (uint8_t)t;
         }
 
-        /* Find largest and smallest lengths in this group */
-        minLen = maxLen = length[0];
-
-        for (i = 1; i < symCount; i++) {
-            if (length[i] > maxLen)
-                maxLen = length[i];
-            else if (length[i] < minLen)
-                minLen = length[i];
-        }
-
-        /* Calculate permute[], base[], and limit[] tables from length[].
-         *
-         * permute[] is the lookup table for converting huffman coded symbols
-         * into decoded symbols.  base[] is the amount to subtract from the
-         * value of a huffman symbol of a given length when using permute[].
-         *
-         * limit[] indicates the largest numerical value a symbol with a given
-         * number of bits can have.  This is how the huffman codes can vary in
-         * length: each code with a value>limit[length] needs another bit.
-         */
-        hufGroup = bd->groups + j;
-        hufGroup->minLen = minLen;
-        hufGroup->maxLen = maxLen;
-
-        /* Note that minLen can't be smaller than 1, so we adjust the base
-           and limit array pointers so we're not always wasting the first
-           entry.  We do this again when using them (during symbol decoding).*/
-        base = hufGroup->base;
-        limit = hufGroup->limit;
-
-        /* Calculate permute[].  Concurently, initialize temp[] and limit[]. */
-        pp = 0;
-
-        for (i = minLen; i <= maxLen; i++) {
-            temp[i] = limit[i] = 0;
-
-            for (t = 0; t < symCount; t++) {
-                if (length[t] == i) {
-                    hufGroup->permute[pp++] = t;
-                }
-            }
+        if ((ret = build_group(bd->groups + j, length, symCount)) < 0) {
+            return ret;
         }
-
-        /* Count symbols coded for at each bit length */
-        for (i = 0; i < symCount; i++) {
-            temp[length[i]]++;
-        }
-
-        /* Calculate limit[] (the largest symbol-coding value at each bit
-         * length, which is (previous limit<<1)+symbols at this level), and
-         * base[] (number of symbols to ignore at each bit length, which is
-         * limit minus the cumulative count of symbols coded for already). */
-        pp = t = 0;
-
-        for (i = minLen; i < maxLen; i++) {
-            pp += temp[i];
-            /* We read the largest possible symbol size and then unget bits
-               after determining how many we need, and those extra bits could
-               be set to anything.  (They're noise from future symbols.)  At
-               each level we're really only interested in the first few bits,
-               so here we set all the trailing to-be-ignored bits to 1 so they
-               don't affect the value>limit[length] comparison. */
-            limit[i] = (pp << (maxLen - i)) - 1;
-            pp <<= 1;
-            base[i + 1] = pp - (t += temp[i]);
-        }
-
-        limit[maxLen + 1] = INT_MAX; /* Sentinal value for reading next sym. */
-        limit[maxLen] = pp + temp[maxLen] - 1;
-        base[minLen] = 0;
     }
 
-    /* We've finished reading and digesting the block header.  Now read this
-       block's huffman coded symbols from the file and undo the huffman coding
-       and run length encoding, saving the result into dbuf[dbufCount++]=uc */
+    if (input_overrun(bd)) {
+        return RETVAL_UNEXPECTED_INPUT_EOF;
+    }
 
-    /* Initialize symbol occurrence counters and symbol Move To Front table */
+    /* Single pass over the symbols: Huffman decode, undo RLE2 (RUNA/RUNB)
+       and MTF, store bytes in dbuf and count them for the BWT step. */
     for (i = 0; i < 256; i++) {
         byteCount[i] = 0;
         mtfSymbol[i] = (uint8_t)i;
     }
 
-    /* Loop through compressed symbols. */
-    runPos = dbufCount = symCount = selector = 0;
+    runPos = dbufCount = selector = groupLeft = t = 0;
 
     for (;;) {
         /* Determine which huffman coding group to use. */
-        if (!(symCount--)) {
-            symCount = GROUP_SIZE - 1;
+        if (!groupLeft--) {
+            groupLeft = GROUP_SIZE - 1;
 
-            if (selector >= nSelectors) {
+            if (selector >= nSelectors || input_overrun(bd)) {
                 return RETVAL_DATA_ERROR;
             }
 
             hufGroup = bd->groups + selectors[selector++];
-            base = hufGroup->base;
-            limit = hufGroup->limit;
-        }
-
-        /* Read next huffman-coded symbol. */
-        /* Note: It is far cheaper to read maxLen bits and back up than it is
-           to read minLen bits and then an additional bit at a time, testing
-           as we go.  Because there is a trailing last block (with file CRC),
-           there is no danger of the overread causing an unexpected EOF for a
-           valid compressed file.  As a further optimization, we do the read
-           inline (falling back to a call to get_bits if the buffer runs
-           dry).  The following (up to got_huff_bits:) is equivalent to
-           j=get_bits(bd,hufGroup->maxLen);
-         */
-        while (bd->inbufBitCount < hufGroup->maxLen) {
-            if (bd->inbufPos == bd->inbufCount) {
-                j = get_bits(bd, (uint8_t)hufGroup->maxLen);
-                goto got_huff_bits;
-            }
-
-            bd->inbufBits = (bd->inbufBits << 8) | bd->inbuf[bd->inbufPos++];
-            bd->inbufBitCount += 8;
-        };
-
-        bd->inbufBitCount -= hufGroup->maxLen;
-
-        j = (bd->inbufBits >> bd->inbufBitCount) &
-            ((1 << hufGroup->maxLen) - 1);
-    got_huff_bits:
-        /* Figure how how many bits are in next symbol and unget extras */
-        i = hufGroup->minLen;
-
-        while (j > limit[i]) {
-            ++i;
         }
 
-        bd->inbufBitCount += (hufGroup->maxLen - i);
-
-        /* Huffman decode value to get nextSym (with bounds checking) */
-        if ((i > hufGroup->maxLen) ||
-            (((unsigned)(j = (j >> (hufGroup->maxLen - i)) - base[i])) >=
-             MAX_SYMBOLS)) {
+        if ((nextSym = decode_symbol(bd, hufGroup, symCount)) < 0) {
             return RETVAL_DATA_ERROR;
         }
 
-        nextSym = hufGroup->permute[j];
-
-        /* We have now decoded the symbol, which indicates either a new literal
-           byte, or a repeated run of the most recent literal byte.  First,
-           check if nextSym indicates a repeated run, and if so loop collecting
-           how many times to repeat the last literal. */
-        if (((unsigned)nextSym) <= SYMBOL_RUNB) { /* RUNA or RUNB */
-            /* If this is the start of a new run, zero out counter */
+        if (nextSym <= SYMBOL_RUNB) { /* RUNA or RUNB */
+            /* Bijective base-2 run length: RUNA adds runPos, RUNB 2*runPos */
             if (!runPos) {
                 runPos = 1;
                 t = 0;
             }
 
-            /* Neat trick that saves 1 symbol: instead of or-ing 0 or 1 at
-               each bit position, add 1 or 2 instead.  For example,
-               1011 is 1<<0 + 1<<1 + 2<<2.  1010 is 2<<0 + 2<<1 + 1<<2.
-               You can make any bit pattern that way using 1 less symbol than
-               the basic or 0/1 method (except all bits 0, which would use no
-               symbols, but a run of length 0 doesn't mean anything in this
-               context).  Thus space is saved. */
-            t += (runPos << nextSym); /* +runPos if RUNA; +2*runPos if RUNB */
+            t += (runPos << nextSym);
             runPos <<= 1;
+
+            if (t > BZIP_BLOCK_SIZE) {
+                return RETVAL_DATA_ERROR;
+            }
             continue;
         }
 
-        /* When we hit the first non-run symbol after a run, we now know
-           how many times to repeat the last literal, so append that many
-           copies to our buffer of decoded symbols (dbuf) now.  (The last
-           literal used is the one at the head of the mtfSymbol array.) */
+        /* First non-run symbol after a run: emit the run of the MTF head */
         if (runPos) {
             runPos = 0;
 
-            if (dbufCount + t >= dbufSize) {
+            if (dbufCount + t > BZIP_BLOCK_SIZE) {
                 return RETVAL_DATA_ERROR;
             }
 
@@ -416,48 +447,40 @@ static int get_next_block(bunzip_data *bd) {
         }
 
         /* Is this the terminating symbol? */
-        if (nextSym > symTotal) {
+        if ((uint32_t)nextSym > symTotal) {
             break;
         }
 
-        /* At this point, nextSym indicates a new literal character.  Subtract
-           one to get the position in the MTF array at which this literal is
-           currently to be found.  (Note that the result can't be -1 or 0,
-           because 0 and 1 are RUNA and RUNB.  But another instance of the
-           first symbol in the mtf array, position 0, would have been handled
-           as part of a run above.  Therefore 1 unused mtf position minus
-           2 non-literal nextSym values equals -1.) */
-        if (dbufCount >= dbufSize) {
+        if (dbufCount >= BZIP_BLOCK_SIZE) {
             return RETVAL_DATA_ERROR;
         }
 
-        i = nextSym - 1;
+        /* Literal: MTF position nextSym - 1 (position 0 is always a run) */
+        i = (uint32_t)nextSym - 1;
         uc = mtfSymbol[i];
 
-        /* Adjust the MTF array.  Since we typically expect to move only a
-         * small number of symbols, and are bound by 256 in any case, using
-         * memmove here would typically be bigger and slower due to function
-         * call overhead and other assorted setup costs. */
-        do {
-            mtfSymbol[i] = mtfSymbol[i - 1];
-        } while (--i);
+        /* Most moves are short; long ones are cheaper as one memmove */
+        if (i < 16) {
+            do {
+                mtfSymbol[i] = mtfSymbol[i - 1];
+            } while (--i);
+        } else {
+            memmove(mtfSymbol + 1, mtfSymbol, i);
+        }
 
         mtfSymbol[0] = uc;
         uc = symToByte[uc];
 
-        /* We have our literal byte.  Save it into dbuf. */
         byteCount[uc]++;
         dbuf[dbufCount++] = (uint32_t)uc;
     }
 
-    /* At this point, we've read all the huffman-coded symbols (and repeated
-   runs) for this block from the input stream, and decoded them into the
-       intermediate buffer.  There are dbufCount many decoded bytes in dbuf[].
-       Now undo the Burrows-Wheeler transform on dbuf.
-       See http://dogma.net/markn/articles/bwt/bwt.htm
-     */
+    if (input_overrun(bd)) {
+        return RETVAL_UNEXPECTED_INPUT_EOF;
+    }
 
-    /* Turn byteCount into cumulative occurrence counts of 0 to n-1. */
+    /* Inverse BWT setup: turn byteCount into cumulative counts, then link
+       every byte to its successor in the high 24 bits of dbuf. */
     j = 0;
 
     for (i = 0; i < 256; i++) {
@@ -466,213 +489,178 @@ static int get_next_block(bunzip_data *bd) {
         j = k;
     }
 
-    /* Figure out what order dbuf would be in if we sorted it. */
     for (i = 0; i < dbufCount; i++) {
         uc = (uint8_t)(dbuf[i] & 0xff);
         dbuf[byteCount[uc]] |= (i << 8);
         byteCount[uc]++;
     }
 
-    /* Decode first byte by hand to initialize "previous" byte.  Note that it
-       doesn't get output, and if the first three characters are identical
-       it doesn't qualify as a run (hence writeRunCountdown=5). */
-    if (dbufCount) {
-        if (origPtr >= dbufCount) {
-            return RETVAL_DATA_ERROR;
-        }
-
-        bd->writePos = dbuf[origPtr];
-        bd->writeCurrent = (uint8_t)(bd->writePos & 0xff);
-        bd->writePos >>= 8;
-        bd->writeRunCountdown = 5;
+    if (dbufCount && origPtr >= dbufCount) {
+        return RETVAL_DATA_ERROR;
     }
 
-    bd->writeCount = dbufCount;
-
+    bd->origPtr = origPtr;
+    bd->dbufCount = dbufCount;
     return RETVAL_OK;
 }
 
-/* Undo burrows-wheeler transform on intermediate buffer to produce output.
-   If start_bunzip was initialized with out_fd=-1, then up to len bytes of
-   data are written to outbuf.  Return value is number of bytes written or
-   error (all errors are negative numbers).  If out_fd!=-1, outbuf and len
-   are ignored, data is written to out_fd and return is RETVAL_OK or error.
-*/
-
-static int read_bunzip(bunzip_data *bd, int8_t *outbuf, int len) {
-    const uint32_t *dbuf;
-    int pos, current, previous, gotcount;
+/* Fused output pass: follow the BWT links, undo RLE1 (four equal bytes are
+   followed by a repeat count) and update the CRC, writing into out.
+   Returns bytes written or a negative RETVAL. */
+static int write_block(bunzip_data *bd, uint8_t *out, uint32_t out_len) {
+    const uint32_t *dbuf = bd->dbuf;
+    uint32_t count = bd->dbufCount, crc = 0xffffffff, o = 0, pos, e;
+    uint32_t run = 0, last = 256;
 
-    /* If last read was short due to end of file, return last block now */
-    if (bd->writeCount < 0) {
-        return bd->writeCount;
-    }
+    /* The origin entry itself is not output, only its link */
+    pos = count ? dbuf[bd->origPtr] >> 8 : 0;
 
-    gotcount = 0;
-    dbuf = bd->dbuf;
-    pos = bd->writePos;
-    current = bd->writeCurrent;
-
-    /* We will always have pending decoded data to write into the output
-       buffer unless this is the very first call (in which case we haven't
-       huffman-decoded a block into the intermediate buffer yet). */
-
-    if (bd->writeCopies) {
-        /* Inside the loop, writeCopies means extra copies (beyond 1) */
-        --bd->writeCopies;
-
-        /* Loop outputting bytes */
-        for (;;) {
-            /* If the output buffer is full, snapshot state and return */
-            if (gotcount >= len) {
-                bd->writePos = pos;
-                bd->writeCurrent = current;
-                bd->writeCopies++;
-                return len;
-            }
+    while (count--) {
+        uint32_t b;
 
-            /* Write next byte into output buffer, updating CRC */
-            outbuf[gotcount++] = current;
+        e = dbuf[pos];
+        b = e & 0xff;
+        pos = e >> 8;
 
-            bd->writeCRC = (((bd->writeCRC) << 8) ^
-                            bd->crc32Table[((bd->writeCRC) >> 24) ^ current]);
-
-            /* Loop now if we're outputting multiple copies of this byte */
-            if (bd->writeCopies) {
-                --bd->writeCopies;
-                continue;
-            }
-        decode_next_byte:
-            if (!bd->writeCount--) {
-                break;
+        if (run == 4) {
+            /* b is a repeat count for last */
+            if (b > out_len - o) {
+                return RETVAL_UNEXPECTED_OUTPUT_EOF;
             }
 
-            /* Follow sequence vector to undo Burrows-Wheeler transform */
-            previous = current;
-            pos = dbuf[pos];
-            current = pos & 0xff;
-            pos >>= 8;
-
-            /* After 3 consecutive copies of the same byte, the 4th is a repeat
-               count.  We count down from 4 instead
-             * of counting up because testing for non-zero is faster */
-            if (--bd->writeRunCountdown) {
-                if (current != previous) {
-                    bd->writeRunCountdown = 4;
-                }
-            } else {
-                /* We have a repeated run, this byte indicates the count */
-                bd->writeCopies = current;
-                current = previous;
-                bd->writeRunCountdown = 5;
-
-                /* Sometimes there are just 3 bytes (run length 0) */
-                if (!bd->writeCopies) {
-                    goto decode_next_byte;
-                }
-
-                /* Subtract the 1 copy we'd output anyway to get extras */
-                --bd->writeCopies;
+            while (b--) {
+                out[o++] = (uint8_t)last;
+                crc = (crc << 8) ^ crc32_table[(crc >> 24) ^ last];
             }
+
+            run = 0;
+            continue;
         }
 
-        /* Decompression of this block completed successfully */
-        bd->writeCRC = ~bd->writeCRC;
+        if (o == out_len) {
+            return RETVAL_UNEXPECTED_OUTPUT_EOF;
+        }
 
-        bd->totalCRC =
-            ((bd->totalCRC << 1) | (bd->totalCRC >> 31)) ^ bd->writeCRC;
+        out[o++] = (uint8_t)b;
+        crc = (crc << 8) ^ crc32_table[(crc >> 24) ^ b];
 
-        /* If this block had a CRC error, force file level CRC error. */
-        if (bd->writeCRC != bd->headerCRC) {
-            bd->totalCRC = bd->headerCRC + 1;
-            return RETVAL_LAST_BLOCK;
+        if (b == last) {
+            run++;
+        } else {
+            run = 1;
+            last = b;
         }
     }
 
-    /* Refill the intermediate buffer by huffman-decoding next block of input */
-    /* (previous is just a convenient unused temp variable here) */
-    previous = get_next_block(bd);
+    crc = ~crc;
 
-    if (previous) {
-        bd->writeCount = previous;
-        return (previous != RETVAL_LAST_BLOCK) ? previous : gotcount;
+    if (crc != bd->headerCRC) {
+        return RETVAL_DATA_ERROR;
     }
 
-    bd->writeCRC = 0xffffffffUL;
-    pos = bd->writePos;
-    current = bd->writeCurrent;
-
-    goto decode_next_byte;
+    bd->totalCRC = ((bd->totalCRC << 1) | (bd->totalCRC >> 31)) ^ crc;
+    return (int)o;
 }
 
-/* Allocate the structure, read file header.  If in_fd==-1, inbuf must contain
-   a complete bunzip file (len bytes long).  If in_fd!=-1, inbuf and len are
-   ignored, and data is read from file handle into temporary buffer. */
-static int start_bunzip(bunzip_data **bdp, int in_fd, uint8_t *inbuf, int len) {
+/* One decoder state is parked here between calls. Concurrent callers
+   (e.g. the cache warm-up workers) that find it taken allocate their own
+   and free it afterwards if the slot was refilled meanwhile. */
+static bunzip_data *spare_state = NULL;
+
+static bunzip_data *acquire_state(void) {
     bunzip_data *bd;
-    uint32_t i, j, c;
-    const uint32_t BZh0 = (((uint32_t)'B') << 24) + (((uint32_t)'Z') << 16) +
-                          (((uint32_t)'h') << 8) + (uint32_t)'0';
 
-    /* Figure out how much data to allocate */
-    i = sizeof(bunzip_data);
+#if defined(__GNUC__) || defined(__clang__)
+    bd = __atomic_exchange_n(&spare_state, NULL, __ATOMIC_ACQUIRE);
+#else
+    bd = spare_state;
+    spare_state = NULL;
+#endif
 
-    if (in_fd != -1) {
-        i += IOBUF_SIZE;
+    if (bd) {
+        return bd;
     }
 
-    /* Allocate bunzip_data.  Most fields initialize to zero. */
-    if (!(bd = *bdp = malloc(i))) {
-        return RETVAL_OUT_OF_MEMORY;
-    }
+    bd = malloc(sizeof(bunzip_data));
 
-    memset(bd, 0, sizeof(bunzip_data));
+    if (!bd) {
+        return NULL;
+    }
 
-    /* Setup input buffer */
+    bd->dbuf = malloc(BZIP_BLOCK_SIZE * sizeof(uint32_t));
 
-    if (-1 == (bd->in_fd = in_fd)) {
-        bd->inbuf = inbuf;
-        bd->inbufCount = len;
-    } else {
-        bd->inbuf = (uint8_t *)(bd + 1);
+    if (!bd->dbuf) {
+        free(bd);
+        return NULL;
     }
 
-    /* Init the CRC32 table (big endian) */
-    for (i = 0; i < 256; i++) {
-        c = i << 24;
+    return bd;
+}
 
-        for (j = 8; j; j--) {
-            c = c & 0x80000000 ? (c << 1) ^ 0x04c11db7 : (c << 1);
-        }
+static void release_state(bunzip_data *bd) {
+#if defined(__GNUC__) || defined(__clang__)
+    bunzip_data *expected = NULL;
 
-        bd->crc32Table[i] = c;
+    if (__atomic_compare_exchange_n(&spare_state, &expected, bd, 0,
+                                    __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+        return;
     }
-
-    /* Setup for I/O error handling via longjmp */
-#if !defined(__wasm) || defined(__EMSCRIPTEN__)
-    i = setjmp(bd->jmpbuf);
-
-    if (i) {
-        return i;
+#else
+    if (!spare_state) {
+        spare_state = bd;
+        return;
     }
 #endif
 
-    /* Ensure that file starts with "BZh['1'-'9']." */
-    i = get_bits(bd, 32);
+    free(bd->dbuf);
+    free(bd);
+}
 
-    if (((uint32_t)(i - BZh0 - 1)) >= 9) {
-        return RETVAL_NOT_BZIP_DATA;
-    }
+int bzip_decompress_into(uint8_t *dst, int dst_len, const uint8_t *src,
+                         int src_len) {
+    bunzip_data *bd;
+    int written = 0, ret;
 
-    /* Fourth byte (ascii '1'-'9'), indicates block size in units of 100k of
-       uncompressed data.  Allocate intermediate buffer for block. */
-    bd->dbufSize = 100000 * (i - BZh0);
+    if (!dst || !src || dst_len < 0 || src_len < 0) {
+        return RETVAL_DATA_ERROR;
+    }
 
-    if (!(bd->dbuf = malloc(bd->dbufSize * sizeof(uint32_t)))) {
+    if (!(bd = acquire_state())) {
         return RETVAL_OUT_OF_MEMORY;
     }
 
-    return RETVAL_OK;
+    bd->in = src;
+    bd->inLen = (uint32_t)src_len;
+    bd->inPos = 0;
+    bd->bitBuf = 0;
+    bd->bitCount = 0;
+    bd->padBits = 0;
+    bd->totalCRC = 0;
+
+    for (;;) {
+        ret = get_next_block(bd);
+
+        if (ret == RETVAL_LAST_BLOCK) {
+            /* End-of-stream marker carries the combined CRC */
+            ret = bd->headerCRC == bd->totalCRC ? written : RETVAL_DATA_ERROR;
+            break;
+        }
+
+        if (ret < 0) {
+            break;
+        }
+
+        ret = write_block(bd, dst + written, (uint32_t)(dst_len - written));
+
+        if (ret < 0) {
+            break;
+        }
+
+        written += ret;
+    }
+
+    release_state(bd);
+    return ret;
 }
 
 static void bzip_fatal(int retval) {
@@ -682,42 +670,11 @@ static void bzip_fatal(int retval) {
 
 void bzip_decompress(int8_t *file_data, int8_t *archive_data, int archive_size,
                      int offset) {
-    uint8_t *headered = malloc(archive_size + 4);
-    memcpy(headered, BZIP_HEADER, 4);
-    memcpy(headered + 4, archive_data + offset, archive_size);
-
-    bunzip_data *bd;
-    int retval;
+    int retval = bzip_decompress_into((uint8_t *)file_data, INT_MAX,
+                                      (const uint8_t *)archive_data + offset,
+                                      archive_size);
 
-    if ((retval = start_bunzip(&bd, -1, headered, archive_size + 4)) < 0) {
-        free(headered);
-        free(bd->dbuf);
-        free(bd);
+    if (retval < 0) {
         bzip_fatal(retval);
     }
-
-    int write_offset = 0;
-
-    while (1) {
-        retval = read_bunzip(bd, file_data + write_offset, IOBUF_SIZE);
-
-        /* finished */
-        if (retval == -1) {
-            free(bd->dbuf);
-            free(bd);
-            free(headered);
-            return;
-        }
-
-        /* error */
-        if (retval < 0) {
-            free(headered);
-            free(bd->dbuf);
-            free(bd);
-            bzip_fatal(retval);
-            return;
-        }
-
-        write_offset += IOBUF_SIZE;
-    }
 }
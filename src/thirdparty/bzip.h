@@ -2,9 +2,6 @@
 #define _H_BZIP
 
 #include <limits.h>
-#if !defined(__wasm) || defined(__EMSCRIPTEN__)
-#include <setjmp.h>
-#endif
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -29,6 +26,12 @@
 #define SYMBOL_RUNA 0
 #define SYMBOL_RUNB 1
 
+/* Codes up to this many bits decode with a single table lookup */
+#define HUFF_LOOKUP_BITS 10
+
+/* Jagfile streams are always "BZh1": 100k block size */
+#define BZIP_BLOCK_SIZE 100000
+
 /* Status return values */
 #define RETVAL_OK 0
 #define RETVAL_LAST_BLOCK (-1)
@@ -39,48 +42,58 @@
 #define RETVAL_OUT_OF_MEMORY (-6)
 #define RETVAL_OBSOLETE_INPUT (-7)
 
-/* Other housekeeping constants */
-#define IOBUF_SIZE 4096
-
 /* This is what we know about each huffman coding group */
 struct group_data {
-    /* We have an extra slot at the end of limit[] for a sentinal value. */
-    uint32_t limit[MAX_HUFCODE_BITS + 1], base[MAX_HUFCODE_BITS],
-        permute[MAX_SYMBOLS];
+    /* lookup[next HUFF_LOOKUP_BITS bits] = (symbol << 5) | length, or 0 if
+       the code is longer than HUFF_LOOKUP_BITS (then use limit/base) */
+    uint16_t lookup[1 << HUFF_LOOKUP_BITS];
+
+    /* Canonical decoding for long codes: a code of length n is the n-bit
+       value c < limit[n], and its symbol is permute[c + base[n]] */
+    int32_t limit[MAX_HUFCODE_BITS + 1], base[MAX_HUFCODE_BITS + 1];
+    uint16_t permute[MAX_SYMBOLS];
 
     uint32_t minLen, maxLen;
 };
 
-/* Structure holding all the housekeeping data, including IO buffers and
-   memory that persists between calls to bunzip */
+/* Decoder state. One is kept between calls so steady-state decompression
+   does no allocation (see bzip_decompress_into). */
 typedef struct {
-    /* State for interrupting output loop */
-    int writeCopies, writePos, writeRunCountdown, writeCount, writeCurrent;
-
-    /* I/O tracking data (file handles, buffers, positions, etc.) */
-    int in_fd, out_fd, inbufCount, inbufPos;
-    uint8_t *inbuf;
-    uint32_t inbufBitCount, inbufBits;
+    /* Input: 64-bit bit buffer, next bit in the top position. Reads past
+       the end shift in zeros and count padBits so overruns are detected. */
+    const uint8_t *in;
+    uint32_t inLen, inPos;
+    uint64_t bitBuf;
+    uint32_t bitCount, padBits;
 
     /* The CRC values stored in the block header and calculated from the data */
-    uint32_t crc32Table[256], headerCRC, totalCRC, writeCRC;
+    uint32_t headerCRC, totalCRC;
+
+    /* Current block: BWT origin and decoded symbol count */
+    uint32_t origPtr, dbufCount;
 
-    /* Intermediate buffer and its size (in bytes) */
-    uint32_t *dbuf, dbufSize;
+    /* Intermediate buffer: byte in the low 8 bits, BWT link above */
+    uint32_t *dbuf;
 
     /* These things are a bit too big to go on the stack */
     uint8_t selectors[32768];             /* nSelectors=15 bits */
     struct group_data groups[MAX_GROUPS]; /* huffman coding tables */
-
-    /* For I/O error handling */
-#if !defined(__wasm) || defined(__EMSCRIPTEN__)
-    jmp_buf jmpbuf;
-#endif
 } bunzip_data;
 
 extern const char BZIP_HEADER[];
 extern const char *bunzip_errors[];
 
+/* Decompress a headerless ("BZh1" stripped) bzip2 stream of src_len bytes
+   into dst, writing at most dst_len bytes. Returns the number of bytes
+   written, or a negative RETVAL_* code (bunzip_errors[-code]) on corrupt,
+   truncated or oversized input. Block and stream CRCs are verified.
+   Thread-safe. */
+int bzip_decompress_into(uint8_t *dst, int dst_len, const uint8_t *src,
+                         int src_len);
+
+/* Legacy entry point: decompress archive_size bytes starting at
+   archive_data + offset into file_data (which must be large enough).
+   Exits the process on corrupt input. */
 void bzip_decompress(int8_t *file_data, int8_t *archive_data, int archive_size,
                      int offset);
 
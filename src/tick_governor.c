@@ -0,0 +1,112 @@
+/*******************************************************************************
+ * TICK_GOVERNOR.C - Shedding Optional Work When Ticks Run Long
+ *******************************************************************************
+ *
+ * See tick_governor.h for the ladder and the thresholds.
+ *
+ * SMOOTHING:
+ *
+ *   avg += (work - avg) / 4
+ *
+ *   One 400 ms spike moves the average a quarter of the way, not past
+ *   the threshold on its own; three or four long ticks in a row do. The
+ *   hold time between steps keeps a burst from climbing the whole ladder
+ *   before the first throttle has had a chance to help.
+ *
+ ******************************************************************************/
+
+#include "tick_governor.h"
+#include "tick_stats.h"
+#include "login.h"
+#include "map.h"
+#include "player_list.h"
+#include "log.h"
+
+TickGovernor g_tick_governor = {
+    .enabled = true,
+};
+
+static const char* const LEVEL_NAMES[GOVERNOR_LEVELS] = {
+    "normal", "autosaves deferred", "idle NPC hunts halved", "map downloads halved",
+    "login budget quartered", "local player budget halved",
+};
+
+/*
+ * governor_engage - Put on the throttle of one rung
+ */
+static void governor_engage(TickGovernor* gov, u32 level) {
+    switch (level) {
+    case GOVERNOR_SLOW_MAPS:
+        /* Unpaced (0) is paced at half the default rate instead */
+        gov->saved_map_bytes = g_map_transfer_tick_bytes;
+        g_map_transfer_tick_bytes = g_map_transfer_tick_bytes
+            ? (g_map_transfer_tick_bytes + 1) / 2
+            : MAP_TRANSFER_TICK_BYTES(MAP_TRANSFER_RATE_DEFAULT, g_tick_stats.period_ms) / 2;
+        break;
+    case GOVERNOR_SLOW_LOGINS:
+        /* Unlimited (0) is limited to a quarter of the default */
+        gov->saved_login_budget = g_login_admission.budget;
+        g_login_admission.budget = g_login_admission.budget
+            ? (g_login_admission.budget + 3) / 4
+            : LOGIN_BUDGET_PER_TICK / 4;
+        break;
+    case GOVERNOR_NARROW_VIEW:
+        gov->saved_local_budget = g_local_player_budget;
+        g_local_player_budget = (g_local_player_budget + 1) / 2;
+        break;
+    default:
+        /* Autosaves and hunts ask tick_governor_skip() */
+        break;
+    }
+}
+
+/*
+ * governor_release - Take off the throttle of one rung
+ */
+static void governor_release(TickGovernor* gov, u32 level) {
+    switch (level) {
+    case GOVERNOR_SLOW_MAPS:
+        g_map_transfer_tick_bytes = gov->saved_map_bytes;
+        break;
+    case GOVERNOR_SLOW_LOGINS:
+        g_login_admission.budget = gov->saved_login_budget;
+        break;
+    case GOVERNOR_NARROW_VIEW:
+        g_local_player_budget = gov->saved_local_budget;
+        break;
+    default:
+        break;
+    }
+}
+
+void tick_governor_observe(u64 tick) {
+    TickGovernor* gov = &g_tick_governor;
+    const TickStats* stats = &g_tick_stats;
+    if (!gov->enabled || stats->filled == 0) return;
+
+    /* tick_stats_end() has just stored the sample and moved head past it */
+    u32 last = (stats->head + TICK_STATS_WINDOW - 1) % TICK_STATS_WINDOW;
+    u64 work_us = stats->samples[TICK_SERIES_WORK][last];
+    gov->avg_us = (u64)((i64)gov->avg_us + ((i64)work_us - (i64)gov->avg_us) / 4);
+    gov->ticks_at_level++;
+
+    u64 budget_us = (u64)(stats->budget_ms ? stats->budget_ms : stats->period_ms / 2) * 1000;
+    if (gov->level + 1 < GOVERNOR_LEVELS && gov->ticks_at_level >= GOVERNOR_HOLD_TICKS &&
+        gov->avg_us * 100 > budget_us * GOVERNOR_RAISE_PCT) {
+        gov->level++;
+        gov->ticks_at_level = 0;
+        gov->raises++;
+        governor_engage(gov, gov->level);
+        LOG_WARN("WARNING: Tick %llu: work averages %.1f ms (budget %llu), level %u: %s\n",
+                 (unsigned long long)tick, gov->avg_us / 1000.0,
+                 (unsigned long long)(budget_us / 1000), gov->level, LEVEL_NAMES[gov->level]);
+    } else if (gov->level > GOVERNOR_NORMAL && gov->ticks_at_level >= GOVERNOR_RESTORE_TICKS &&
+               gov->avg_us * 100 < budget_us * GOVERNOR_LOWER_PCT) {
+        governor_release(gov, gov->level);
+        LOG_INFO("Tick %llu: work averages %.1f ms, lifted '%s', level %u\n",
+                 (unsigned long long)tick, gov->avg_us / 1000.0,
+                 LEVEL_NAMES[gov->level], gov->level - 1);
+        gov->level--;
+        gov->ticks_at_level = 0;
+    }
+}
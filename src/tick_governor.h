@@ -0,0 +1,137 @@
+/*******************************************************************************
+ * TICK_GOVERNOR.H - Shedding Optional Work When Ticks Run Long
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Feedback control: measure, compare with a target, adjust
+ *   - Graceful degradation: drop the least visible work first
+ *   - Hysteresis: separate engage and release thresholds, so a load near
+ *     one threshold does not flap between two levels every tick
+ *   - Smoothing a noisy signal with an exponential moving average
+ *
+ * THE PROBLEM:
+ *
+ * tick_stats.h measures every tick and warns when one overruns its
+ * budget, but nothing acts on it. When a crowd arrives, work grows until
+ * ticks run late, and then every player sees the lag, not just the
+ * players in the crowd. Much of a tick is work that may wait: autosaves
+ * that are only insurance, hunts by idle NPCs, map downloads, new logins,
+ * and the far edge of a crowded view.
+ *
+ * THE SOLUTION - A LADDER OF THROTTLES:
+ *
+ * After every tick the governor smooths the tick's work time and steps
+ * one rung up or down the ladder:
+ *
+ *   level  throttle added (all lower ones stay on)       who notices
+ *   ─────  ─────────────────────────────────────────      ───────────
+ *     0    none                                           -
+ *     1    autosave every GOVERNOR_AUTOSAVE_EVERY ticks   nobody (saves
+ *          (the interval per player stretches)            on logout stay)
+ *     2    idle NPC hunts every other tick (aggression.h) NPCs react later
+ *     3    map download rate halved (map.h)               slower area loads
+ *     4    login budget quartered (login.h)               more TRY_AGAIN
+ *     5    local player budget halved (player_list.h)     crowds look smaller
+ *
+ *   avg work (EWMA)
+ *     ▲
+ *     │ ── budget ─────────────────────────────────────────────────
+ *     │ ── GOVERNOR_RAISE_PCT ──────  ↑ one rung per HOLD ticks
+ *     │
+ *     │ ── GOVERNOR_LOWER_PCT ──────  ↓ one rung per RESTORE ticks
+ *     └──────────────────────────────────────────────────────────► ticks
+ *
+ * The budget is tick_stats' overrun budget (--tick-budget, default half
+ * the tick period). Rungs go up quickly, so the tick is back under the
+ * budget within seconds, and come down slowly, so that a fading crowd
+ * does not undo each throttle right after it took effect. Every step is
+ * logged: WARN going up, INFO coming down.
+ *
+ * The throttles lower the configured values (--map-rate, --login-budget,
+ * --local-player-budget) and put back the values they found when the
+ * level drops below their rung.
+ *
+ * DETERMINISM:
+ *   Only server_run() feeds the governor. A --replay never degrades, so
+ *   its digest does not depend on how fast the machine is.
+ *
+ * Off with --no-tick-governor.
+ *
+ ******************************************************************************/
+
+#ifndef TICK_GOVERNOR_H
+#define TICK_GOVERNOR_H
+
+#include "types.h"
+#include <stdbool.h>
+
+/* Ladder rungs (see table above) */
+#define GOVERNOR_NORMAL          0
+#define GOVERNOR_DEFER_AUTOSAVE  1
+#define GOVERNOR_SLOW_HUNTS      2
+#define GOVERNOR_SLOW_MAPS       3
+#define GOVERNOR_SLOW_LOGINS     4
+#define GOVERNOR_NARROW_VIEW     5
+#define GOVERNOR_LEVELS          6
+
+/* Step up when the average passes this share of the budget... */
+#define GOVERNOR_RAISE_PCT 80
+
+/* ...and down when it falls under this one */
+#define GOVERNOR_LOWER_PCT 50
+
+/* Ticks at a level before the next step up (a throttle needs a tick to show) */
+#define GOVERNOR_HOLD_TICKS 5
+
+/* Ticks at a level before the next step down (30 seconds) */
+#define GOVERNOR_RESTORE_TICKS 50
+
+/* While autosaves are deferred, they run on one tick in this many */
+#define GOVERNOR_AUTOSAVE_EVERY 4
+
+/*
+ * TickGovernor - Controller state (game thread only)
+ */
+typedef struct {
+    bool enabled;               /* --no-tick-governor clears it */
+    u32 level;                  /* GOVERNOR_* rung in force */
+    u64 avg_us;                 /* Smoothed tick work (EWMA, 1/4 per tick) */
+    u32 ticks_at_level;         /* Ticks since the last step */
+    u64 raises;                 /* Steps up since start */
+
+    /* Values the throttles replaced, put back when they come off */
+    u32 saved_map_bytes;
+    u32 saved_login_budget;
+    u32 saved_local_budget;
+} TickGovernor;
+
+extern TickGovernor g_tick_governor;
+
+/*
+ * tick_governor_observe - Feed one finished tick to the controller
+ *
+ * @param tick  Number of the tick that tick_stats_end() just recorded
+ *
+ * Reads the tick's work time from g_tick_stats and moves at most one
+ * rung. Call after tick_stats_end().
+ *
+ * COMPLEXITY: O(1)
+ */
+void tick_governor_observe(u64 tick);
+
+/*
+ * tick_governor_skip - Whether a throttled task sits this tick out
+ *
+ * @param level  Rung that throttles the task
+ * @param tick   Current tick number
+ * @param every  The task still runs on one tick in this many
+ * @return       true to skip the task this tick
+ *
+ *   if (!tick_governor_skip(GOVERNOR_SLOW_HUNTS, tick, 2)) aggression_process(...);
+ */
+static inline bool tick_governor_skip(u32 level, u64 tick, u32 every) {
+    return g_tick_governor.level >= level && tick % every != 0;
+}
+
+#endif /* TICK_GOVERNOR_H */
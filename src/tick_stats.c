@@ -0,0 +1,167 @@
+/*******************************************************************************
+ * TICK_STATS.C - Tick Phase Timing, Rolling Percentiles and Overrun Warnings
+ *******************************************************************************
+ *
+ * See tick_stats.h for the design.
+ *
+ * PERCENTILES:
+ *
+ *   Nearest rank over the sorted window: pN = sorted[ceil(n * N / 100) - 1].
+ *   With 100 samples p99 is the second largest tick of the minute - one
+ *   bad tick shows in max, a pattern of them in p99.
+ *
+ ******************************************************************************/
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "tick_stats.h"
+#include "log.h"
+#include "metrics.h"
+#include "probe.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+TickStats g_tick_stats = {
+    .budget_ms = TICK_RATE_MS / 2,
+    .period_ms = TICK_RATE_MS,
+};
+
+static const char* const SERIES_NAMES[TICK_SERIES_COUNT] = {
+    "input", "logins", "flush", "timers", "packets", "movement", "npcs",
+    "update", "zones", "state", "cleanup", "maps", "autosave",
+    "work", "late",
+};
+
+u64 tick_stats_now(void) {
+#ifdef _WIN32
+    LARGE_INTEGER freq, count;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+    return (u64)(count.QuadPart / freq.QuadPart) * 1000000000ull +
+           (u64)(count.QuadPart % freq.QuadPart) * 1000000000ull / (u64)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+#endif
+}
+
+void tick_stats_begin(u64 late_ns) {
+    g_tick_stats.tick_start = tick_stats_now();
+    g_tick_stats.late_ns = late_ns;
+}
+
+static int compare_u32(const void* a, const void* b) {
+    u32 x = *(const u32*)a;
+    u32 y = *(const u32*)b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * series_percentiles - p50, p99 and max of one series' window
+ */
+static void series_percentiles(const TickStats* stats, u32 series, u32* p50, u32* p99, u32* max) {
+    u32 sorted[TICK_STATS_WINDOW];
+    u32 n = stats->filled;
+    memcpy(sorted, stats->samples[series], n * sizeof(u32));
+    qsort(sorted, n, sizeof(u32), compare_u32);
+    *p50 = sorted[(n * 50 + 99) / 100 - 1];
+    *p99 = sorted[(n * 99 + 99) / 100 - 1];
+    *max = sorted[n - 1];
+}
+
+/*
+ * tick_stats_report - One summary line, plus a line per phase at DEBUG
+ */
+static void tick_stats_report(const TickStats* stats, u64 last_tick) {
+    u32 p50, p99, max, late50, late99, late_max;
+    series_percentiles(stats, TICK_SERIES_WORK, &p50, &p99, &max);
+    series_percentiles(stats, TICK_SERIES_LATE, &late50, &late99, &late_max);
+    LOG_INFO("Ticks %llu-%llu: work p50 %.1f p99 %.1f max %.1f ms, late p99 %.1f ms, "
+             "overruns %u (total %llu)\n",
+             (unsigned long long)stats->first_tick, (unsigned long long)last_tick,
+             p50 / 1000.0, p99 / 1000.0, max / 1000.0, late99 / 1000.0,
+             stats->window_overruns, (unsigned long long)stats->overruns);
+
+    if (!LOG_ENABLED(LOG_LEVEL_DEBUG)) return;
+    for (u32 s = 0; s < TICK_PHASE_COUNT; s++) {
+        series_percentiles(stats, s, &p50, &p99, &max);
+        LOG_DEBUG("  %-9s p50 %8.3f  p99 %8.3f  max %8.3f ms  (max ever %.3f)\n",
+                  SERIES_NAMES[s], p50 / 1000.0, p99 / 1000.0, max / 1000.0,
+                  stats->max_us[s] / 1000.0);
+    }
+}
+
+/*
+ * tick_stats_warn - Overrun warning naming the phases that took the time
+ */
+static void tick_stats_warn(const TickStats* stats, u64 tick, const u32* sample) {
+    char line[512];
+    i32 len = snprintf(line, sizeof(line), "WARNING: Tick %llu took %.1f ms (budget %u):",
+                       (unsigned long long)tick, sample[TICK_SERIES_WORK] / 1000.0,
+                       stats->budget_ms);
+
+    /* Largest phases first, skipping the ones under a millisecond */
+    bool used[TICK_PHASE_COUNT] = { false };
+    for (u32 n = 0; n < TICK_PHASE_COUNT && len > 0 && (u32)len < sizeof(line); n++) {
+        u32 best = TICK_PHASE_COUNT;
+        for (u32 s = 0; s < TICK_PHASE_COUNT; s++) {
+            if (!used[s] && (best == TICK_PHASE_COUNT || sample[s] > sample[best])) best = s;
+        }
+        if (sample[best] < 1000) break;
+        used[best] = true;
+        len += snprintf(line + len, sizeof(line) - (u32)len, "%s %s %.1f",
+                        n == 0 ? "" : ",", SERIES_NAMES[best], sample[best] / 1000.0);
+    }
+    LOG_WARN("%s\n", line);
+}
+
+void tick_phase_trace(TickPhase phase, u64 start_ns, u64 end_ns) {
+    /* The idle loop passes through these every millisecond */
+    bool between_ticks = phase <= TICK_PHASE_FLUSH;
+    if (between_ticks && end_ns - start_ns < TRACE_IDLE_MIN_NS) return;
+    trace_record(SERIES_NAMES[phase], start_ns, end_ns - start_ns, 0);
+}
+
+void tick_stats_end(u64 tick) {
+    TickStats* stats = &g_tick_stats;
+    u64 work_ns = tick_stats_now() - stats->tick_start;
+    if (trace_enabled()) trace_record("tick", stats->tick_start, work_ns, (u32)tick);
+    PROBE2(tick__end, tick, work_ns);
+
+    u32 sample[TICK_SERIES_COUNT];
+    for (u32 s = 0; s < TICK_PHASE_COUNT; s++) {
+        sample[s] = (u32)(stats->current[s] / 1000);
+        stats->current[s] = 0;
+    }
+    sample[TICK_SERIES_WORK] = (u32)(work_ns / 1000);
+    sample[TICK_SERIES_LATE] = (u32)(stats->late_ns / 1000);
+
+    if (stats->filled == 0 && stats->head == 0) stats->first_tick = tick;
+    for (u32 s = 0; s < TICK_SERIES_COUNT; s++) {
+        stats->samples[s][stats->head] = sample[s];
+        if (sample[s] > stats->max_us[s]) stats->max_us[s] = sample[s];
+    }
+    if (stats->filled < TICK_STATS_WINDOW) stats->filled++;
+    metrics_observe_tick(work_ns);
+
+    if (stats->budget_ms > 0 && work_ns > (u64)stats->budget_ms * 1000000ull) {
+        stats->overruns++;
+        stats->window_overruns++;
+        tick_stats_warn(stats, tick, sample);
+    }
+
+    /* Full window: report it, and the ring starts the next one */
+    if (++stats->head == TICK_STATS_WINDOW) {
+        tick_stats_report(stats, tick);
+        stats->head = 0;
+        stats->first_tick = tick + 1;
+        stats->window_overruns = 0;
+    }
+}
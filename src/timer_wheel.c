@@ -0,0 +1,243 @@
+/*******************************************************************************
+ * TIMER_WHEEL.C - Hierarchical Timer Wheel Implementation
+ *******************************************************************************
+ *
+ * See timer_wheel.h for the design.
+ *
+ * BUCKET CHOICE:
+ *
+ *   delay = due - now
+ *   level = first L with delay < 64^(L+1)     (level 3 if none)
+ *   slot  = (due >> (6 * level)) % 64
+ *
+ *   A level L bucket is cascaded when now reaches a multiple of 64^L whose
+ *   level L digit equals the slot, i.e. at the start of the 64^L-tick
+ *   block containing due. Cascading higher levels before lower ones lets a
+ *   timer fall through several levels on the same tick.
+ *
+ ******************************************************************************/
+
+#include "timer_wheel.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define NODE_NONE 0xFFFFFFFFu
+#define GENERATION_MASK ((1u << (32 - TIMER_INDEX_BITS)) - 1)
+
+TimerWheel* g_timers = NULL;
+
+/*
+ * timer_pool_link - Chain nodes [from, to) onto the free list
+ */
+static void timer_pool_link(TimerWheel* wheel, u32 from, u32 to) {
+    for (u32 i = from; i < to; i++) {
+        wheel->nodes[i].fn = NULL;
+        wheel->nodes[i].generation = 1;
+        wheel->nodes[i].next = (i + 1 < to) ? i + 1 : wheel->free_head;
+    }
+    if (from < to) wheel->free_head = from;
+}
+
+TimerWheel* timer_wheel_create(u32 capacity, u64 now) {
+    if (capacity == 0) capacity = 64;
+    if (capacity > TIMER_MAX_NODES) capacity = TIMER_MAX_NODES;
+
+    TimerWheel* wheel = calloc(1, sizeof(TimerWheel));
+    if (!wheel) return NULL;
+
+    wheel->nodes = calloc(capacity, sizeof(TimerNode));
+    if (!wheel->nodes) {
+        free(wheel);
+        return NULL;
+    }
+    wheel->capacity = capacity;
+    wheel->free_head = NODE_NONE;
+    wheel->now = now;
+    memset(wheel->heads, 0xFF, sizeof(wheel->heads));
+    timer_pool_link(wheel, 0, capacity);
+    return wheel;
+}
+
+void timer_wheel_destroy(TimerWheel* wheel) {
+    if (!wheel) return;
+    free(wheel->nodes);
+    free(wheel);
+}
+
+/*
+ * timer_pool_grow - Double the node pool (indices stay valid)
+ */
+static bool timer_pool_grow(TimerWheel* wheel) {
+    if (wheel->capacity >= TIMER_MAX_NODES) return false;
+    u32 capacity = wheel->capacity * 2;
+    if (capacity > TIMER_MAX_NODES) capacity = TIMER_MAX_NODES;
+
+    TimerNode* nodes = realloc(wheel->nodes, capacity * sizeof(TimerNode));
+    if (!nodes) return false;
+    wheel->nodes = nodes;
+    timer_pool_link(wheel, wheel->capacity, capacity);
+    wheel->capacity = capacity;
+    return true;
+}
+
+static inline TimerHandle timer_handle(const TimerWheel* wheel, u32 index) {
+    return ((TimerHandle)wheel->nodes[index].generation << TIMER_INDEX_BITS) | index;
+}
+
+/*
+ * timer_lookup - Node of a pending timer, or NULL if the handle is stale
+ */
+static TimerNode* timer_lookup(const TimerWheel* wheel, TimerHandle handle) {
+    if (!wheel || handle == TIMER_NONE) return NULL;
+    u32 index = handle & (TIMER_MAX_NODES - 1);
+    if (index >= wheel->capacity) return NULL;
+
+    TimerNode* node = &wheel->nodes[index];
+    if (!node->fn || node->generation != (handle >> TIMER_INDEX_BITS)) return NULL;
+    return node;
+}
+
+/*
+ * timer_file - Link a node into the bucket for its due tick
+ */
+static void timer_file(TimerWheel* wheel, u32 index) {
+    TimerNode* node = &wheel->nodes[index];
+    u64 delay = node->due - wheel->now;
+
+    u32 level = 0;
+    while (level < TIMER_WHEEL_LEVELS - 1 &&
+           delay >= ((u64)1 << (TIMER_WHEEL_BITS * (level + 1)))) {
+        level++;
+    }
+
+    /* Beyond the top level: park in its furthest bucket, re-filed later */
+    u64 due = node->due;
+    u64 top_span = (u64)1 << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS);
+    if (delay >= top_span) due = wheel->now + top_span - 1;
+
+    u32 slot = (u32)(due >> (TIMER_WHEEL_BITS * level)) & (TIMER_WHEEL_SLOTS - 1);
+    u32 bucket = level * TIMER_WHEEL_SLOTS + slot;
+
+    node->bucket = (u16)bucket;
+    node->prev = NODE_NONE;
+    node->next = wheel->heads[bucket];
+    if (node->next != NODE_NONE) wheel->nodes[node->next].prev = index;
+    wheel->heads[bucket] = index;
+}
+
+static void timer_unlink(TimerWheel* wheel, u32 index) {
+    TimerNode* node = &wheel->nodes[index];
+    if (node->prev != NODE_NONE) {
+        wheel->nodes[node->prev].next = node->next;
+    } else {
+        wheel->heads[node->bucket] = node->next;
+    }
+    if (node->next != NODE_NONE) wheel->nodes[node->next].prev = node->prev;
+}
+
+/*
+ * timer_free - Return a node to the pool, invalidating its handle
+ */
+static void timer_free(TimerWheel* wheel, u32 index) {
+    TimerNode* node = &wheel->nodes[index];
+    node->fn = NULL;
+    node->generation = (u16)((node->generation & GENERATION_MASK) + 1);
+    if (node->generation > GENERATION_MASK) node->generation = 1;  /* Never 0 */
+    node->next = wheel->free_head;
+    wheel->free_head = index;
+    wheel->count--;
+}
+
+TimerHandle timer_schedule(TimerWheel* wheel, u64 delay, TimerCallback fn, void* ctx, u32 arg) {
+    if (!wheel || !fn) return TIMER_NONE;
+    if (wheel->free_head == NODE_NONE && !timer_pool_grow(wheel)) return TIMER_NONE;
+    if (delay == 0) delay = 1;
+
+    u32 index = wheel->free_head;
+    TimerNode* node = &wheel->nodes[index];
+    wheel->free_head = node->next;
+    wheel->count++;
+
+    node->due = wheel->now + delay;
+    node->fn = fn;
+    node->ctx = ctx;
+    node->arg = arg;
+    timer_file(wheel, index);
+    return timer_handle(wheel, index);
+}
+
+bool timer_cancel(TimerWheel* wheel, TimerHandle handle) {
+    TimerNode* node = timer_lookup(wheel, handle);
+    if (!node) return false;
+
+    u32 index = (u32)(node - wheel->nodes);
+    timer_unlink(wheel, index);
+    timer_free(wheel, index);
+    return true;
+}
+
+bool timer_pending(const TimerWheel* wheel, TimerHandle handle) {
+    return timer_lookup(wheel, handle) != NULL;
+}
+
+u64 timer_remaining(const TimerWheel* wheel, TimerHandle handle) {
+    const TimerNode* node = timer_lookup(wheel, handle);
+    return node ? node->due - wheel->now : 0;
+}
+
+/*
+ * timer_cascade - Re-file every timer in one bucket of a higher level
+ */
+static void timer_cascade(TimerWheel* wheel, u32 level) {
+    u32 slot = (u32)(wheel->now >> (TIMER_WHEEL_BITS * level)) & (TIMER_WHEEL_SLOTS - 1);
+    u32 bucket = level * TIMER_WHEEL_SLOTS + slot;
+
+    u32 index = wheel->heads[bucket];
+    wheel->heads[bucket] = NODE_NONE;
+    while (index != NODE_NONE) {
+        u32 next = wheel->nodes[index].next;
+        timer_file(wheel, index);
+        index = next;
+    }
+}
+
+/*
+ * timer_tick - Advance one tick: cascade, then fire level 0's bucket
+ */
+static void timer_tick(TimerWheel* wheel) {
+    wheel->now++;
+
+    /* Highest level whose block starts on this tick, cascaded downwards */
+    u32 top = 0;
+    while (top < TIMER_WHEEL_LEVELS - 1 &&
+           (wheel->now & (((u64)1 << (TIMER_WHEEL_BITS * (top + 1))) - 1)) == 0) {
+        top++;
+    }
+    for (u32 level = top; level >= 1; level--) {
+        timer_cascade(wheel, level);
+    }
+
+    /*
+     * Fire level 0. Pop from the head each time: a callback may cancel
+     * other timers in this bucket or schedule new ones (never due now).
+     */
+    u32 bucket = (u32)wheel->now & (TIMER_WHEEL_SLOTS - 1);
+    while (wheel->heads[bucket] != NODE_NONE) {
+        u32 index = wheel->heads[bucket];
+        TimerNode* node = &wheel->nodes[index];
+        TimerCallback fn = node->fn;
+        void* ctx = node->ctx;
+        u32 arg = node->arg;
+
+        timer_unlink(wheel, index);
+        timer_free(wheel, index);
+        fn(ctx, arg);
+    }
+}
+
+void timer_wheel_advance(TimerWheel* wheel, u64 now) {
+    if (!wheel) return;
+    while (wheel->now < now) {
+        timer_tick(wheel);
+    }
+}
@@ -0,0 +1,208 @@
+/*******************************************************************************
+ * TIMER_WHEEL.H - Hierarchical Timer Wheel for Tick-Scheduled Events
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Timer wheels (hashing deadlines into time buckets)
+ *   - Hierarchical wheels and cascading (coarse buckets for far deadlines)
+ *   - Generation-checked handles (safe cancel after the timer fired)
+ *   - Index-linked node pools (no allocation per timer)
+ *
+ * THE PROBLEM:
+ *
+ * Games are full of "do X in N ticks": respawn this NPC in 25 ticks,
+ * remove that tree stump in 100, let this player act again in 3. The
+ * obvious implementation stores a deadline on each entity and checks it
+ * every tick:
+ *
+ *   for each NPC (8191):    if dead and tick >= respawn_tick: respawn
+ *   for each object (10k+): if temporary and tick >= expire: despawn
+ *
+ * Almost every check fails, and the cost grows with the number of
+ * entities rather than with the number of events actually due.
+ *
+ * THE SOLUTION - A WHEEL OF BUCKETS:
+ *
+ * A single wheel hashes each deadline into one of 64 buckets by its low 6
+ * bits. Each tick visits one bucket and fires what is in it:
+ *
+ *   tick:    ...  1000   1001   1002  ...
+ *   bucket:        40     41     42           (tick % 64)
+ *
+ * That only works for deadlines less than 64 ticks away. For longer
+ * ones, a HIERARCHY of wheels, each 64 times coarser than the one below:
+ *
+ *   level 0: 64 buckets x 1 tick          deadlines < 64 ticks away
+ *   level 1: 64 buckets x 64 ticks        < 4,096 ticks    (~41 min)
+ *   level 2: 64 buckets x 4,096 ticks     < 262,144        (~44 hours)
+ *   level 3: 64 buckets x 262,144 ticks   < 16,777,216     (~116 days)
+ *
+ * A timer 300 ticks away goes into level 1. When time reaches the start
+ * of its 64-tick block, the level 1 bucket is CASCADED: each timer in it
+ * is re-filed by its remaining delay, which now lands in level 0, and
+ * fires on its exact tick:
+ *
+ *   now = 1000, schedule(+300) → due 1300, level 1 bucket (1300 >> 6) % 64
+ *   now = 1280 (1300 & ~63): cascade level 1 bucket → level 0 bucket 20
+ *   now = 1300: fire
+ *
+ * Each timer is cascaded at most once per level, so the total cost is
+ * O(1) per timer no matter how far away it is. Deadlines beyond level 3
+ * wait in level 3's furthest bucket and are re-filed each time it comes
+ * round.
+ *
+ * HANDLES:
+ *
+ * Timers live in a node pool inside the wheel and are referred to by a
+ * TimerHandle = [generation:12][node index:20]. Firing or cancelling a
+ * timer frees its node and bumps the generation, so an old handle kept by
+ * an entity can never cancel an unrelated timer that reused the node:
+ *
+ *   h = schedule(...)    node 5, generation 3  → handle (3 << 20) | 5
+ *   (timer fires)        node 5 now generation 4
+ *   timer_cancel(h)      generation mismatch → false, nothing happens
+ *
+ * TIME BASE:
+ *
+ * The server's wheel (g_timers) is keyed on GameServer.tick_count and
+ * advanced by server_tick() before world_process(), so callbacks run at
+ * the start of the tick they are due on.
+ *
+ * COMPLEXITY:
+ *   - schedule / cancel:  O(1)
+ *   - advance one tick:   O(timers due) + O(timers cascaded)
+ *   - memory:             capacity * 32 bytes + 256 bucket heads
+ *
+ ******************************************************************************/
+
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include "types.h"
+#include <stdbool.h>
+
+/* Buckets per level (2^6) and number of levels */
+#define TIMER_WHEEL_BITS 6
+#define TIMER_WHEEL_SLOTS (1u << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_LEVELS 4
+
+/* Handle layout: [generation:12][node index:20]; 0 is never a valid handle */
+#define TIMER_INDEX_BITS 20
+#define TIMER_MAX_NODES (1u << TIMER_INDEX_BITS)
+#define TIMER_NONE 0
+
+/*
+ * TimerHandle - Identifies one scheduled timer
+ *
+ * Store it on the entity that owns the timer to cancel it later.
+ * TIMER_NONE means "no timer".
+ */
+typedef u32 TimerHandle;
+
+/*
+ * TimerCallback - Called once when a timer fires
+ *
+ * @param ctx  Pointer given to timer_schedule() (usually a subsystem)
+ * @param arg  Value given to timer_schedule() (usually an entity index)
+ *
+ * The timer is already freed when the callback runs, so the callback may
+ * schedule new timers (including a repeat of itself) and cancel others.
+ */
+typedef void (*TimerCallback)(void* ctx, u32 arg);
+
+/*
+ * TimerNode - One timer in the pool (free nodes are chained via next)
+ */
+typedef struct {
+    u64 due;                    /* Tick the timer fires on */
+    TimerCallback fn;           /* NULL while the node is free */
+    void* ctx;
+    u32 arg;
+    u32 next;                   /* Next node in bucket / free list */
+    u32 prev;                   /* Previous node in bucket (NONE = head) */
+    u16 generation;             /* Bumped each time the node is freed */
+    u16 bucket;                 /* level * TIMER_WHEEL_SLOTS + slot */
+} TimerNode;
+
+/*
+ * TimerWheel - Four-level wheel plus its node pool
+ */
+typedef struct {
+    u32 heads[TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS];
+    TimerNode* nodes;
+    u32 capacity;               /* Nodes allocated (grows by doubling) */
+    u32 free_head;              /* First free node */
+    u32 count;                  /* Timers pending */
+    u64 now;                    /* Last tick advanced to */
+} TimerWheel;
+
+/*
+ * g_timers - The server's wheel, keyed on GameServer.tick_count
+ *
+ * Created by server_init(), advanced by server_tick(). NULL when no
+ * server is running (subsystems then simply schedule nothing).
+ */
+extern TimerWheel* g_timers;
+
+/*
+ * timer_wheel_create - Create an empty wheel
+ *
+ * @param capacity  Initial node count (the pool doubles when full, up to
+ *                  TIMER_MAX_NODES)
+ * @param now       Current tick
+ * @return          New wheel, or NULL on allocation failure
+ */
+TimerWheel* timer_wheel_create(u32 capacity, u64 now);
+
+/*
+ * timer_wheel_destroy - Free a wheel (pending timers never fire)
+ */
+void timer_wheel_destroy(TimerWheel* wheel);
+
+/*
+ * timer_schedule - Call fn(ctx, arg) delay ticks from now
+ *
+ * @param wheel  Wheel
+ * @param delay  Ticks from wheel->now (0 is treated as 1: the next tick)
+ * @param fn     Callback
+ * @param ctx    Callback context
+ * @param arg    Callback argument
+ * @return       Handle for timer_cancel(), or TIMER_NONE if the pool is
+ *               full or wheel/fn is NULL
+ *
+ * COMPLEXITY: O(1) (amortized when the pool grows)
+ */
+TimerHandle timer_schedule(TimerWheel* wheel, u64 delay, TimerCallback fn, void* ctx, u32 arg);
+
+/*
+ * timer_cancel - Cancel a pending timer
+ *
+ * @return  true if the timer was pending; false for TIMER_NONE, a timer
+ *          that already fired or was cancelled, or a NULL wheel
+ *
+ * COMPLEXITY: O(1)
+ */
+bool timer_cancel(TimerWheel* wheel, TimerHandle handle);
+
+/*
+ * timer_pending - Is the timer still waiting to fire?
+ */
+bool timer_pending(const TimerWheel* wheel, TimerHandle handle);
+
+/*
+ * timer_remaining - Ticks until a pending timer fires (0 if not pending)
+ */
+u64 timer_remaining(const TimerWheel* wheel, TimerHandle handle);
+
+/*
+ * timer_wheel_advance - Move time forward, firing every timer due
+ *
+ * @param wheel  Wheel
+ * @param now    New current tick (ticks in between are stepped through)
+ *
+ * Timers due on the same tick fire in no particular order.
+ */
+void timer_wheel_advance(TimerWheel* wheel, u64 now);
+
+#endif /* TIMER_WHEEL_H */
@@ -0,0 +1,152 @@
+/*******************************************************************************
+ * TRACE.C - Span Tracing Implementation
+ *******************************************************************************
+ *
+ * See trace.h for the design.
+ *
+ * Registry: a thread claims an index with one atomic increment and then
+ * publishes its ring there with a release store; the dumper reads the
+ * count and each pointer with acquire loads and skips entries not yet
+ * published.
+ *
+ ******************************************************************************/
+
+#include "trace.h"
+#include "tick_stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+TraceState g_trace;
+
+/* The calling thread's ring (NULL: none yet; FULL: registry was full) */
+static __thread TraceRing* tls_ring;
+static __thread char tls_name[32];
+static TraceRing ring_full;
+
+u64 trace_now(void) {
+    return tick_stats_now();
+}
+
+void trace_thread_name(const char* name) {
+    snprintf(tls_name, sizeof(tls_name), "%s", name);
+}
+
+/*
+ * ring_claim - Allocate and register the calling thread's ring
+ */
+static TraceRing* ring_claim(void) {
+    u32 index = __atomic_fetch_add(&g_trace.ring_count, 1, __ATOMIC_RELAXED);
+    TraceRing* ring = index < TRACE_MAX_THREADS ? (TraceRing*)calloc(1, sizeof(TraceRing)) : NULL;
+    if (!ring) return &ring_full;
+
+    ring->tid = index;
+    if (tls_name[0]) {
+        snprintf(ring->thread_name, sizeof(ring->thread_name), "%s", tls_name);
+    } else {
+        snprintf(ring->thread_name, sizeof(ring->thread_name), "thread %u", index);
+    }
+    __atomic_store_n(&g_trace.rings[index], ring, __ATOMIC_RELEASE);
+    return ring;
+}
+
+void trace_record(const char* name, u64 start_ns, u64 dur_ns, u32 arg) {
+    if (!trace_enabled()) return;
+    TraceRing* ring = tls_ring;
+    if (!ring) ring = tls_ring = ring_claim();
+    if (ring == &ring_full) return;
+
+    u64 head = ring->head;
+    TraceEvent* event = &ring->events[head & (TRACE_RING_EVENTS - 1)];
+    event->name = name;
+    event->start_ns = start_ns;
+    event->dur_ns = dur_ns;
+    event->arg = arg;
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+void trace_set(bool enabled) {
+    if (enabled && !trace_enabled()) g_trace.since_ns = trace_now();
+    __atomic_store_n(&g_trace.enabled, enabled, __ATOMIC_RELAXED);
+}
+
+/*
+ * dump_ring - Copy one ring and write its still-valid events
+ *
+ * @return  Events written
+ */
+static u64 dump_ring(FILE* f, const TraceRing* ring, TraceEvent* copy, u64 base_ns, bool* first) {
+    u64 head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    u64 oldest = head > TRACE_RING_EVENTS ? head - TRACE_RING_EVENTS : 0;
+    for (u64 i = oldest; i < head; i++) {
+        copy[i - oldest] = ring->events[i & (TRACE_RING_EVENTS - 1)];
+    }
+
+    /* Whatever the writer reached meanwhile may have overwritten the oldest */
+    u64 from = oldest;
+    u64 now_head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    if (now_head >= TRACE_RING_EVENTS && now_head - TRACE_RING_EVENTS + 1 > from) {
+        from = now_head - TRACE_RING_EVENTS + 1;
+    }
+
+    fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+               "\"args\":{\"name\":\"%s\"}}",
+            *first ? "" : ",\n", ring->tid, ring->thread_name);
+    *first = false;
+
+    u64 written = 0;
+    for (u64 i = from; i < head; i++) {
+        const TraceEvent* event = &copy[i - oldest];
+        if (event->start_ns < g_trace.since_ns) continue;
+        fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                   "\"pid\":1,\"tid\":%u,\"args\":{\"arg\":%u}}",
+                event->name, (event->start_ns - base_ns) / 1000.0, event->dur_ns / 1000.0,
+                ring->tid, event->arg);
+        written++;
+    }
+    return written;
+}
+
+i64 trace_dump(const char* path) {
+    FILE* f = fopen(path, "w");
+    if (!f) return -1;
+    TraceEvent* copy = (TraceEvent*)malloc(TRACE_RING_EVENTS * sizeof(TraceEvent));
+    if (!copy) {
+        fclose(f);
+        return -1;
+    }
+
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", f);
+    u32 count = __atomic_load_n(&g_trace.ring_count, __ATOMIC_ACQUIRE);
+    if (count > TRACE_MAX_THREADS) count = TRACE_MAX_THREADS;
+    bool first = true;
+    u64 written = 0;
+    for (u32 i = 0; i < count; i++) {
+        const TraceRing* ring = __atomic_load_n(&g_trace.rings[i], __ATOMIC_ACQUIRE);
+        if (ring) written += dump_ring(f, ring, copy, g_trace.since_ns, &first);
+    }
+    fputs("\n]}\n", f);
+
+    free(copy);
+    bool ok = !ferror(f);
+    if (fclose(f) != 0) ok = false;
+    return ok ? (i64)written : -1;
+}
+
+void trace_request_dump(void) {
+    __atomic_store_n(&g_trace.dump_requested, 1, __ATOMIC_RELAXED);
+}
+
+void trace_poll(u64 tick) {
+    if (!__atomic_load_n(&g_trace.dump_requested, __ATOMIC_RELAXED)) return;
+    __atomic_store_n(&g_trace.dump_requested, 0, __ATOMIC_RELAXED);
+
+    char path[64];
+    snprintf(path, sizeof(path), "trace-%llu.json", (unsigned long long)tick);
+    i64 events = trace_dump(path);
+    if (events < 0) {
+        fprintf(stderr, "WARNING: Trace dump to %s failed\n", path);
+    } else {
+        printf("Trace: %lld events written to %s\n", (long long)events, path);
+    }
+}
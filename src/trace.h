@@ -0,0 +1,209 @@
+/*******************************************************************************
+ * TRACE.H - Per-Thread Event Rings, Dumped as Chrome Trace JSON
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Span tracing: individual events instead of aggregates
+ *   - Single-producer rings per thread (no locks, no shared cache lines)
+ *   - Reading a ring that is still being written (validating by index)
+ *   - The Chrome trace_event format (chrome://tracing, ui.perfetto.dev)
+ *
+ * THE PROBLEM:
+ *
+ * tick_stats.h says a tick took 412 ms and that 380 of them were in the
+ * UPDATE phase. It cannot say which viewer's PLAYER_INFO took them, or
+ * whether the update pool's workers were busy or idle meanwhile, or that
+ * a save file write on another thread was stalling at the same moment.
+ * Aggregates smooth exactly the one event that matters away.
+ *
+ * THE SOLUTION - RECORD SPANS, LOOK AT THEM LATER:
+ *
+ * Instrumented code brackets its work:
+ *
+ *   u64 t = trace_begin();                     0 while tracing is off
+ *   update_player(viewer, ...);
+ *   trace_end(t, "update_player", viewer->index);
+ *
+ * and trace_end() appends one complete event {name, start, duration, arg}
+ * to the calling thread's ring:
+ *
+ *   game thread     [tick][movement][update_player 12][update_player 40]...
+ *   update worker   [update_player 7][update_player 99]...
+ *   save writer     [save_write 5120]...
+ *   login worker    [login_decode][login_read]...
+ *
+ *   ring: events[TRACE_RING_EVENTS], head counts every event ever written
+ *         slot = head % TRACE_RING_EVENTS: the newest events overwrite the
+ *         oldest, so the ring always holds the last few seconds
+ *
+ * Only the owning thread writes its ring, so recording is a few plain
+ * stores and one release store of head - no lock, no atomic read-modify-
+ * write, no cache line shared with another writer.
+ *
+ * DUMPING:
+ *
+ * trace_dump() (::trace dump, SIGUSR2, or at shutdown while tracing)
+ * copies every ring, then re-reads its head: an event the writer may have
+ * overwritten during the copy (index <= new head - TRACE_RING_EVENTS) is
+ * dropped instead of printed torn. The copy is written as:
+ *
+ *   {"traceEvents":[
+ *     {"name":"tick","ph":"X","ts":1200.000,"dur":3.412,"pid":1,"tid":0,
+ *      "args":{"arg":18233}},
+ *     ...]}
+ *
+ * which chrome://tracing and Perfetto open directly: one row per thread,
+ * spans nested by time, a slow tick and the viewer inside it one click
+ * apart.
+ *
+ * WHAT IS TRACED:
+ *   tick            server_tick() (arg: tick number)
+ *   tick phases     timers, packets, movement, npcs, update, zones, state,
+ *                   cleanup, maps, autosave; between ticks input, logins
+ *                   and flush when longer than TRACE_IDLE_MIN_NS
+ *   <packet name>   one client packet's handler (arg: PID)
+ *   update_player   one viewer's PLAYER_INFO (arg: PID), on whichever
+ *                   thread encoded it
+ *   map_send_*      load area (arg: PID), land and loc data
+ *                   (arg: file x << 8 | z)
+ *   login_decode    login block decryption (login worker, arg: slot)
+ *   login_read      save file read (login worker, arg: bytes)
+ *   login_accept    ciphers, save applied, initial packets (game, arg: slot)
+ *   save_write      one save file or log record (arg: bytes)
+ *
+ * USAGE:
+ *   --trace                   start with tracing on
+ *   ::trace on|off|dump       admin command
+ *   kill -USR2 <pid>          dump to trace-<tick>.json after the next tick
+ *
+ * COST:
+ *   Off (the default): one relaxed load and a branch per site.
+ *   On: two clock reads and a 32-byte store per span, and a 2MB ring per
+ *   thread that records anything (allocated on its first event).
+ *
+ ******************************************************************************/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "types.h"
+#include <stdbool.h>
+
+/* Events per thread ring (a power of two: 2MB at 32 bytes each) */
+#define TRACE_RING_EVENTS (1u << 16)
+
+/* Threads that can record (later threads are not traced) */
+#define TRACE_MAX_THREADS 64
+
+/* Between-tick phases shorter than this are not recorded (idle loop passes) */
+#define TRACE_IDLE_MIN_NS 50000
+
+/*
+ * TraceEvent - One complete span
+ */
+typedef struct {
+    const char* name;           /* Static string */
+    u64 start_ns;               /* trace_now() at the start */
+    u64 dur_ns;
+    u32 arg;                    /* Site-specific: PID, tick, bytes */
+} TraceEvent;
+
+/*
+ * TraceRing - One thread's last TRACE_RING_EVENTS spans
+ */
+typedef struct {
+    TraceEvent events[TRACE_RING_EVENTS];
+    u64 head;                   /* Events written (owner stores, dumper loads) */
+    u32 tid;                    /* Row in the trace */
+    char thread_name[32];
+} TraceRing;
+
+/*
+ * TraceState - Switch and ring registry
+ */
+typedef struct {
+    bool enabled;               /* Read relaxed on every thread */
+    u64 since_ns;               /* Events before this are from an earlier session */
+    TraceRing* rings[TRACE_MAX_THREADS];
+    u32 ring_count;             /* Claimed registry entries */
+    int dump_requested;         /* Set by trace_request_dump() */
+} TraceState;
+
+extern TraceState g_trace;
+
+/*
+ * trace_now - The trace clock (tick_stats_now(): monotonic nanoseconds)
+ */
+u64 trace_now(void);
+
+/*
+ * trace_enabled - Is tracing on (any thread)
+ */
+static inline bool trace_enabled(void) {
+    return __atomic_load_n(&g_trace.enabled, __ATOMIC_RELAXED);
+}
+
+/*
+ * trace_record - Append a finished span to the calling thread's ring
+ *
+ * @param name      Static string (stored as a pointer)
+ * @param start_ns  trace_now() at the start
+ * @param dur_ns    Duration
+ * @param arg       Shown as args.arg
+ *
+ * Allocates the thread's ring on its first event. Does nothing while
+ * tracing is off or when TRACE_MAX_THREADS rings exist.
+ */
+void trace_record(const char* name, u64 start_ns, u64 dur_ns, u32 arg);
+
+/*
+ * trace_begin - Start a span
+ *
+ * @return  Start time, 0 while tracing is off (trace_end() then skips)
+ */
+static inline u64 trace_begin(void) {
+    return trace_enabled() ? trace_now() : 0;
+}
+
+/*
+ * trace_end - Finish a span started by trace_begin()
+ */
+static inline void trace_end(u64 start, const char* name, u32 arg) {
+    if (start) trace_record(name, start, trace_now() - start, arg);
+}
+
+/*
+ * trace_set - Turn tracing on or off
+ *
+ * Turning it on starts a new session: a dump shows nothing recorded
+ * before that moment. Rings are kept (and reused) either way.
+ */
+void trace_set(bool enabled);
+
+/*
+ * trace_thread_name - Name the calling thread's row (before its first event)
+ */
+void trace_thread_name(const char* name);
+
+/*
+ * trace_dump - Write every ring as Chrome trace_event JSON
+ *
+ * @param path  Output file
+ * @return      Events written, or -1 if the file cannot be written
+ *
+ * Safe while other threads record (see DUMPING above).
+ */
+i64 trace_dump(const char* path);
+
+/*
+ * trace_request_dump - Ask the game thread for a dump (async-signal-safe)
+ */
+void trace_request_dump(void);
+
+/*
+ * trace_poll - Write a requested dump to trace-<tick>.json (game thread)
+ */
+void trace_poll(u64 tick);
+
+#endif /* TRACE_H */
@@ -0,0 +1,171 @@
+/*******************************************************************************
+ * TRAFFIC.C - Per-Connection Traffic Accounting and Top Talkers
+ *******************************************************************************
+ *
+ * See traffic.h for what is counted where.
+ *
+ * RANKING:
+ *
+ *   One pass over the connections keeps, per counter, the TRAFFIC_TOP
+ *   largest windows in a short list, largest first. A window that beats
+ *   the last entry is inserted by shifting the smaller ones down:
+ *
+ *   top (N = 4)   [ 900, 400, 250, 100 ]    next: 300
+ *                 [ 900, 400, 300, 250 ]    100 falls off
+ *
+ *   Most windows are below the last entry and cost one compare. The
+ *   busiest opcode is only looked up for the connections that made a list.
+ *
+ ******************************************************************************/
+
+#include "traffic.h"
+#include <stdio.h>
+#include <string.h>
+
+Traffic g_traffic;
+
+static const char* const COUNTER_NAMES[TRAFFIC_COUNTERS] = {
+    "bytes_in", "bytes_out", "packets_in", "map_bytes", "player_info_bytes", "handler_ns",
+};
+
+static const char* const COUNTER_WORDS[TRAFFIC_COUNTERS] = {
+    "in", "out", "packets", "map", "info", "cpu",
+};
+
+const char* traffic_counter_name(TrafficCounter counter) {
+    return counter < TRAFFIC_COUNTERS ? COUNTER_NAMES[counter] : "unknown";
+}
+
+bool traffic_counter_parse(const char* word, TrafficCounter* counter) {
+    for (u32 c = 0; c < TRAFFIC_COUNTERS; c++) {
+        if (strcmp(word, COUNTER_WORDS[c]) == 0 || strcmp(word, COUNTER_NAMES[c]) == 0) {
+            *counter = (TrafficCounter)c;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * rank_window - Close the window: rank every counter, then reset the windows
+ */
+static void rank_window(Player* players, u32 count, u64 tick) {
+    Traffic* t = &g_traffic;
+    u16 ranked[TRAFFIC_COUNTERS][TRAFFIC_TOP];
+    u64 values[TRAFFIC_COUNTERS][TRAFFIC_TOP];
+    u32 ranked_count[TRAFFIC_COUNTERS] = { 0 };
+    u32 connections = 0;
+
+    for (u32 i = 0; i < count; i++) {
+        if (!players[i].conn_pooled) continue;
+        const ConnTraffic* traffic = &players[i].conn->traffic;
+        connections++;
+        for (u32 c = 0; c < TRAFFIC_COUNTERS; c++) {
+            u64 value = traffic->window[c];
+            u32 n = ranked_count[c];
+            if (value == 0 || (n == TRAFFIC_TOP && value <= values[c][n - 1])) continue;
+            u32 at = n < TRAFFIC_TOP ? n : TRAFFIC_TOP - 1;
+            while (at > 0 && values[c][at - 1] < value) {
+                values[c][at] = values[c][at - 1];
+                ranked[c][at] = ranked[c][at - 1];
+                at--;
+            }
+            values[c][at] = value;
+            ranked[c][at] = (u16)i;
+            if (n < TRAFFIC_TOP) ranked_count[c]++;
+        }
+    }
+
+    for (u32 c = 0; c < TRAFFIC_COUNTERS; c++) {
+        for (u32 r = 0; r < ranked_count[c]; r++) {
+            const Player* player = &players[ranked[c][r]];
+            const ConnTraffic* traffic = &player->conn->traffic;
+            TrafficTalker* talker = &t->top[c][r];
+            talker->index = (u16)player->index;
+            snprintf(talker->name, sizeof(talker->name), "%s", player->username);
+            talker->value = traffic->window[c];
+            talker->peak = traffic->peak[c];
+            talker->opcode = 0;
+            talker->opcode_count = 0;
+            for (u32 op = 0; op < 256; op++) {
+                if (traffic->opcodes[op] > talker->opcode_count) {
+                    talker->opcode = (u8)op;
+                    talker->opcode_count = traffic->opcodes[op];
+                }
+            }
+        }
+        t->top_count[c] = ranked_count[c];
+    }
+
+    t->reported = true;
+    t->report_start = t->window_start;
+    t->report_end = tick;
+    t->report_connections = connections;
+    memcpy(t->report_total, t->window_total, sizeof(t->report_total));
+    memset(t->window_total, 0, sizeof(t->window_total));
+    t->window_start = tick + 1;
+
+    for (u32 i = 0; i < count; i++) {
+        if (!players[i].conn_pooled) continue;
+        ConnTraffic* traffic = &players[i].conn->traffic;
+        memset(traffic->window, 0, sizeof(traffic->window));
+        memset(traffic->peak, 0, sizeof(traffic->peak));
+        memset(traffic->opcodes, 0, sizeof(traffic->opcodes));
+    }
+}
+
+void traffic_tick(Player* players, u32 count, u64 tick) {
+    Traffic* t = &g_traffic;
+    memset(t->tick_total, 0, sizeof(t->tick_total));
+
+    for (u32 i = 0; i < count; i++) {
+        if (!players[i].conn_pooled) continue;
+        ConnTraffic* traffic = &players[i].conn->traffic;
+        for (u32 c = 0; c < TRAFFIC_COUNTERS; c++) {
+            u64 value = traffic->tick[c];
+            traffic->window[c] += value;
+            if (value > traffic->peak[c]) traffic->peak[c] = value;
+            t->tick_total[c] += value;
+        }
+        memset(traffic->tick, 0, sizeof(traffic->tick));
+    }
+    for (u32 c = 0; c < TRAFFIC_COUNTERS; c++) t->window_total[c] += t->tick_total[c];
+
+    if (tick + 1 - t->window_start >= TRAFFIC_WINDOW_TICKS) rank_window(players, count, tick);
+}
+
+/*
+ * format_value - A counter's value in the unit a reader expects
+ */
+static void format_value(TrafficCounter counter, u64 value, char* out, u32 size) {
+    if (counter == TRAFFIC_HANDLER_NS) {
+        if (value >= 1000000) snprintf(out, size, "%.1f ms", value / 1e6);
+        else snprintf(out, size, "%.0f us", value / 1e3);
+    } else if (counter == TRAFFIC_PACKETS_IN) {
+        snprintf(out, size, "%llu", (unsigned long long)value);
+    } else if (value >= 1024 * 1024) {
+        snprintf(out, size, "%.1f MB", value / (1024.0 * 1024.0));
+    } else if (value >= 1024) {
+        snprintf(out, size, "%.1f KB", value / 1024.0);
+    } else {
+        snprintf(out, size, "%llu B", (unsigned long long)value);
+    }
+}
+
+bool traffic_describe(TrafficCounter counter, u32 rank, char* out, u32 size) {
+    const Traffic* t = &g_traffic;
+    if (counter >= TRAFFIC_COUNTERS || rank >= t->top_count[counter]) return false;
+
+    const TrafficTalker* talker = &t->top[counter][rank];
+    char value[24], peak[24];
+    format_value(counter, talker->value, value, sizeof(value));
+    format_value(counter, talker->peak, peak, sizeof(peak));
+    u64 total = t->report_total[counter];
+    i32 n = snprintf(out, size, "%u. %s: %s (%.0f%%), peak %s/tick", rank + 1,
+                     talker->name[0] ? talker->name : "(login)", value,
+                     total ? 100.0 * talker->value / total : 0.0, peak);
+    if (talker->opcode_count && n > 0 && (u32)n < size) {
+        snprintf(out + n, size - (u32)n, ", op %u x%u", talker->opcode, talker->opcode_count);
+    }
+    return true;
+}
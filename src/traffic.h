@@ -0,0 +1,160 @@
+/*******************************************************************************
+ * TRAFFIC.H - Per-Connection Traffic Accounting and Top Talkers
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Attributing load to its source, not just totalling it
+ *   - Cheap counters on the hot path, the expensive part once a window
+ *   - Top-N selection without sorting everyone (a small insertion list)
+ *
+ * THE PROBLEM:
+ *
+ * metrics.h says how many bytes the server sent and packet_profile.h
+ * which opcodes they were, but neither says who. Ten bot clients spamming
+ * clicks, one player standing in a crowd of 200 (a huge PLAYER_INFO every
+ * tick) and a client re-requesting maps look the same in the totals:
+ *
+ *   rs225_sent_bytes_total   +4 MB/min      from whom?
+ *   packet 165 × 9120/min                   one client, or everyone?
+ *
+ * THE SOLUTION - COUNTERS IN THE CONNECTION, A RANKING PER WINDOW:
+ *
+ *   where it happens                     ConnTraffic.tick[] (player.h)
+ *   ─────────────────────────────────    ───────────────────────────────
+ *   server_handle_packet()   ──────────→ BYTES_IN, PACKETS_IN, opcodes[],
+ *                                        HANDLER_NS (clock around dispatch)
+ *   player_flush()           ──────────→ BYTES_OUT
+ *   map_send_chunks()        ──────────→ MAP_BYTES
+ *   update_player_encode()   ──────────→ INFO_BYTES (PLAYER_INFO worker,
+ *                                        its own viewer only)
+ *
+ *   end of every tick, traffic_tick():
+ *     per connection:  window += tick,  peak = max(peak, tick),  tick = 0
+ *     all of them:     g_traffic.tick_total[] (the tick's aggregate)
+ *
+ *   every TRAFFIC_WINDOW_TICKS:
+ *     per counter, keep the TRAFFIC_TOP largest windows   O(connections × N)
+ *     snapshot name, value, peak tick, busiest opcode     → g_traffic.top
+ *     reset the windows
+ *
+ *   ::top [in|out|packets|map|info|cpu] and the metrics endpoint
+ *   (rs225_top_talker) read the snapshot, so a report costs no walk over
+ *   the connections and describes one complete minute.
+ *
+ * WHAT TO LOOK FOR:
+ *   Many names with the same busiest opcode and near-equal packet counts
+ *   are a bot farm. INFO bytes tell what the view radius costs the
+ *   players in crowds; MAP bytes far above the rest are a client asking
+ *   for areas over and over.
+ *
+ * COST:
+ *   Two clock reads per handled packet, one add per counter at each site,
+ *   and six adds per connection per tick. The 1 KB of opcode counts lives
+ *   in the pooled PlayerConnection, so it only exists while a socket does.
+ *
+ * THREAD SAFETY:
+ *   Game thread, except INFO_BYTES (see ConnTraffic). The endpoint is
+ *   served on the game thread too (metrics_handle_event).
+ *
+ ******************************************************************************/
+
+#ifndef TRAFFIC_H
+#define TRAFFIC_H
+
+#include "types.h"
+#include "player.h"
+#include <stdbool.h>
+
+/* Ticks per report window (a minute) */
+#define TRAFFIC_WINDOW_TICKS 100
+
+/* Connections ranked per counter */
+#define TRAFFIC_TOP 10
+
+/*
+ * TrafficTalker - One ranked connection of the last window
+ */
+typedef struct {
+    u16 index;                          /* Player index */
+    char name[MAX_USERNAME_LENGTH + 1]; /* "" while logging in */
+    u64 value;                          /* Over the window */
+    u64 peak;                           /* Most in one tick */
+    u8 opcode;                          /* Its most frequent client packet */
+    u32 opcode_count;
+} TrafficTalker;
+
+/*
+ * Traffic - This window's aggregate and the last window's ranking
+ */
+typedef struct {
+    u64 window_start;                       /* First tick of the current window */
+    u64 tick_total[TRAFFIC_COUNTERS];       /* Last tick, every connection */
+    u64 window_total[TRAFFIC_COUNTERS];     /* Current window so far */
+
+    bool reported;                          /* A window has completed */
+    u64 report_start;                       /* Ticks of the last completed window */
+    u64 report_end;
+    u32 report_connections;
+    u64 report_total[TRAFFIC_COUNTERS];
+    TrafficTalker top[TRAFFIC_COUNTERS][TRAFFIC_TOP];   /* Largest first */
+    u32 top_count[TRAFFIC_COUNTERS];
+} Traffic;
+
+extern Traffic g_traffic;
+
+/*
+ * traffic_add - Count traffic against a connection (this tick)
+ */
+static inline void traffic_add(PlayerConnection* conn, TrafficCounter counter, u64 n) {
+    conn->traffic.tick[counter] += n;
+}
+
+/*
+ * traffic_packet_in - Count one handled client packet
+ *
+ * @param bytes  Whole packet: opcode, length bytes and payload
+ *
+ * Handler time is added separately, after the handler has run.
+ */
+static inline void traffic_packet_in(PlayerConnection* conn, u8 opcode, u32 bytes) {
+    conn->traffic.tick[TRAFFIC_BYTES_IN] += bytes;
+    conn->traffic.tick[TRAFFIC_PACKETS_IN]++;
+    conn->traffic.opcodes[opcode]++;
+}
+
+/*
+ * traffic_tick - Fold every connection's tick, rank when the window ends
+ *
+ * @param players  Player slots
+ * @param count    Number of slots
+ * @param tick     Tick that just ran
+ *
+ * COMPLEXITY: O(connections), O(connections × TRAFFIC_TOP) at window end
+ */
+void traffic_tick(Player* players, u32 count, u64 tick);
+
+/*
+ * traffic_counter_name - Stable name of a counter ("bytes_out", ...)
+ */
+const char* traffic_counter_name(TrafficCounter counter);
+
+/*
+ * traffic_counter_parse - Counter for a ::top argument
+ *
+ * @return  false if the word names none
+ *
+ * Takes the short words (in, out, packets, map, info, cpu) and the
+ * names traffic_counter_name() returns.
+ */
+bool traffic_counter_parse(const char* word, TrafficCounter* counter);
+
+/*
+ * traffic_describe - One line of the last window's ranking
+ *
+ * @param rank  0-based
+ * @return      false past the end of the ranking
+ */
+bool traffic_describe(TrafficCounter counter, u32 rank, char* out, u32 size);
+
+#endif /* TRAFFIC_H */
@@ -61,11 +61,9 @@
  *   │ BYTE-ALIGNED SECTION (extended update blocks)             │
  *   │  For each player with update_flags != 0:                  │
  *   │   ┌─ Update mask: 1 byte (which updates present)         │ │
- *   │   └─ Update data blocks (in flag order):                 │ │
- *   │      ├─ UPDATE_APPEARANCE (0x01): Appearance block       │ │
- *   │      ├─ UPDATE_ANIMATION (0x02): Animation data          │ │
- *   │      ├─ UPDATE_GRAPHIC (0x04): Spotanim/graphics         │ │
- *   │      └─ UPDATE_CHAT (0x08): Public chat message          │ │
+ *   │   └─ Update data blocks (in mask bit order):             │ │
+ *   │      ├─ 0x01 (UPDATE_APPEARANCE): Appearance block       │ │
+ *   │      └─ 0x40 (UPDATE_CHAT): Public chat message          │ │
  *   └────────────────────────────────────────────────────────────┘
  *
  * BIT PACKING RATIONALE:
@@ -101,25 +99,29 @@
  *     Example: Teleport to (45, 67, height 0) with update
  *       → [11][0101101][1000011][00][1] = 20 bits
  *
- * UPDATE FLAGS (BITMASK):
- *   Each flag enables a corresponding update block in byte section.
+ * UPDATE MASK (BITMASK):
+ *   Each client mask bit enables a corresponding update block in the
+ *   byte section. The server's update_flags (constants.h) are mapped
+ *   onto these bits by player_update_mask().
  *   
- *   UPDATE_APPEARANCE (0x01): Visual appearance changed
+ *   0x01 (UPDATE_APPEARANCE): Visual appearance changed
  *     - Gender, body parts, colors, equipment
  *     - Most common update (players login, change gear)
  *     - Size: 50-100 bytes typically
  *   
- *   UPDATE_ANIMATION (0x02): Playing animation
- *     - Animation ID, delay
- *     - Size: 3 bytes
+ *   0x10 (UPDATE_HIT): Hitsplat and health bar
+ *     - Damage, type, current and base hitpoints (combat.h)
+ *     - Size: 4 bytes, sent to the player hit as well
  *   
- *   UPDATE_GRAPHIC (0x04): Spot animation (graphics overlay)
- *     - Graphic ID, height, delay
- *     - Size: 5 bytes
+ *   0x40 (UPDATE_CHAT): Public chat message
+ *     - Color, effect, rights, wordpacked text (chat.h)
+ *     - Size: 5-84 bytes
+ *     - Never sent to the speaker: the client shows its own line
+ *       when it sends it
  *   
- *   UPDATE_CHAT (0x08): Public chat message
- *     - Packed text, color, effect
- *     - Size: 10-80 bytes
+ *   Other bits (animation 0x02, face entity 0x04, forced chat 0x08,
+ *   hit 0x10, face tile 0x20, spotanim 0x100 behind the 0x80
+ *   extension) are not sent yet.
  *
  * ALGORITHM (DETAILED):
  *
@@ -191,10 +193,15 @@
  ******************************************************************************/
 
 #include "update.h"
+#include "log.h"
 #include "server.h"
 #include "network.h"
 #include "buffer.h"
 #include "position.h"
+#include "chat.h"
+#include "player_save.h"  /* SKILL_HITPOINTS */
+#include "probe.h"
+#include "traffic.h"
 #include <string.h>
 #include <stdio.h>
 
@@ -241,28 +248,22 @@
  *   
  *   Space complexity:
  *     - Output buffer: O(V) - proportional to visible players
- *     - Tracking arrays: O(N) - 2048 entries × 3 bytes = 6KB per player
- *     - Total per player: ~6KB + packet size (100-500 bytes typical)
+ *     - Tracking: 255-entry list + 256-byte set + 2KB appearance versions
+ *     - Total per player: ~2.8KB + packet size (100-500 bytes typical)
  *
  * DATA STRUCTURE CHOICES:
  *   
  *   PlayerTracking structure:
- *     local_players[MAX_PLAYERS]:  Array of PIDs (sparse, indexed)
+ *     local_players[255]:          PIDs in the client's order (protocol cap)
  *     local_count:                 Counter (dense)
- *     tracked[MAX_PLAYERS]:        Bitmap (sparse, boolean array)
+ *     tracked:                     PlayerSet, one bit per PID (256 bytes)
  *   
- *   Why array instead of hash table for tracking?
- *     ✓ O(1) lookup by PID (direct indexing)
- *     ✓ Cache-friendly (sequential memory)
- *     ✓ Simple implementation (no hash collisions)
- *     ✗ Wastes memory for low player counts (2KB per player)
- *   
- *   Alternative: Bitmap for tracked[] (would save 7/8 memory):
- *     tracked: bool[2048] = 2048 bytes
- *     vs tracked: u8[256] = 256 bytes (8 bits per byte)
- *     Savings: 1792 bytes per player
- *     Cost: Bit manipulation overhead (shifts, masks)
- *     Current choice: Prioritize speed over memory
+ *   Why a bitset for tracked?
+ *     ✓ O(1) membership test by PID (shift and mask)
+ *     ✓ Whole-set operations 64 PIDs at a time: the tick's additions
+ *       are visible & ~tracked, 32 word operations
+ *     ✓ Iteration with ctz touches only members and empty-word tests
+ *     ✓ 256 bytes instead of a 2KB bool array; clearing it is cheap
  *
  * STREAMING BUFFER ARCHITECTURE:
  *   
@@ -284,17 +285,15 @@
  * BIT ACCESS PATTERNS:
  *   
  *   Bit writing (buffer_write_bits):
- *     1. Shift value left by (32 - num_bits) to align MSB
- *     2. Right-shift by bit_position to position in current byte
- *     3. OR with existing byte (accumulate bits)
- *     4. Advance bit_position, wrap at byte boundary
+ *     1. Shift the field into a 64-bit accumulator (MSB first)
+ *     2. Every 32 bits, store one big-endian word to the buffer
+ *     3. buffer_finish_bit_access() stores the last partial word
  *   
- *   Example: Writing 3-bit value 5 (binary 101) at bit position 2:
- *     Current byte: 0000 00XX (2 bits already used)
- *     Value: 101
- *     Result: 0010 1XXX (5 bits now used)
+ *   Records made of several small fields (removal, walk, run, add) are
+ *   combined with bits_pack() and written in one call:
+ *     walk = [1][type:2=1][dir:3][update:1] → buffer_write_bits(out, 7, walk)
  *   
- *   Complexity: O(1) per bit write, O(k) to write k-bit value
+ *   Complexity: O(1) per field, one store per 32 bits
  *
  * PACKET SIZE ESTIMATION:
  *   
@@ -313,15 +312,39 @@
  *     Total:           ~1625 bytes
  *   
  *   Worst case (200 players, all with appearance updates):
- *     ~16 KB packet (happens on login to crowded area)
+ *     ~16 KB before the byte budget, more than the client's 5000-byte
+ *     packet buffer (happens on login to crowded area)
+ *
+ * BYTE BUDGET (g_player_info_budget, plan_player_info):
+ *   
+ *   The order of the update blocks is not free: the client reads one
+ *   block for each update bit, in bit-section order. What a viewer's
+ *   budget decides is which blocks ride this tick:
+ *   
+ *     always     movement bits, removals, the viewer's own block
+ *     then       hits and chat of tracked players, nearest first
+ *     then       appearances and adds, nearest first
+ *   
+ *   A player whose blocks are left out is encoded with its update bit
+ *   clear. A left-out appearance is owed (PlayerTracking.owed) and
+ *   sent on a later tick, a left-out add is simply added later; a hit
+ *   or chat line is dropped. The client sees fewer changes in a dense
+ *   crowd, never a malformed packet.
+ *   
+ *     200 players logging in around one viewer, 5000-byte budget:
+ *       tick 1:  200 adds wanted (~12 KB), the ~80 nearest added
+ *       tick 2:  ~80 more, and so on; chat of tracked players first
  *
  ******************************************************************************/
 
-/* Update masks (bitmask flags for update blocks) */
-#define UPDATE_APPEARANCE 0x1  /* Visual appearance changed (50-100 bytes) */
-#define UPDATE_ANIMATION 0x2   /* Playing animation (3 bytes) */
-#define UPDATE_GRAPHIC 0x4     /* Spot animation/graphics overlay (5 bytes) */
-#define UPDATE_CHAT 0x8        /* Public chat message (10-80 bytes) */
+/*
+ * Client mask bits (225 client PLAYER_INFO masks, not the server
+ * UPDATE_* flags in constants.h; player_update_mask() maps one onto
+ * the other, like npc_update.c does for NPCs)
+ */
+#define PLAYER_MASK_APPEARANCE 0x01  /* [length:1][appearance] (50-100 bytes) */
+#define PLAYER_MASK_HIT 0x10         /* [damage:1][type:1][hitpoints:1][max hitpoints:1] */
+#define PLAYER_MASK_CHAT 0x40        /* [color<<8|effect:2][rights:1][length:1][packed] */
 
 /* Movement types for bit-packed encoding */
 #define MOVEMENT_NONE 0      /* Standing still: 1 bit [0] */
@@ -329,20 +352,67 @@
 #define MOVEMENT_RUN 2       /* Run two tiles: 12 bits [10][dir1:3][dir2:3][upd:1] */
 #define MOVEMENT_TELEPORT 3  /* Instant position change: 20 bits [11][x:7][y:7][h:2][upd:1] */
 
+/* Bits a PLAYER_INFO always spends: tracked count, own placement, end marker */
+#define INFO_FIXED_BITS (8 + 21 + 11)
+
+/* Bytes an add costs in the bit section (23 bits, rounded up) */
+#define INFO_ADD_BYTES 3
+
+u32 g_player_info_budget = MAX_PACKET_SIZE;
+
+/*
+ * InfoCandidate - One other player whose blocks compete for the budget
+ */
+typedef struct {
+    Player* player;
+    u16 slot;                   /* Tracked index, or index in InfoPlan.adds */
+    u8 distance;                /* Chebyshev tiles from the viewer */
+    u8 want;                    /* Mask bits it has pending for the viewer */
+    bool add;
+} InfoCandidate;
+
+/*
+ * InfoPlan - What one viewer's PLAYER_INFO carries this tick
+ *
+ * Filled by plan_player_info() before the bit section is written, so
+ * update_other_players() only encodes decisions already made.
+ */
+typedef struct {
+    u8 tracked_mask[MAX_LOCAL_PLAYERS];     /* Granted mask by tracked index */
+    u16 adds[MAX_LOCAL_PLAYERS];            /* PIDs added this tick, PID order */
+    u8 add_mask[MAX_LOCAL_PLAYERS];
+    u32 add_count;
+    InfoCandidate candidates[MAX_LOCAL_PLAYERS * 2];
+    u32 candidate_count;
+} InfoPlan;
+
 /*******************************************************************************
  * FORWARD DECLARATIONS
  ******************************************************************************/
 
-static u64 username_to_base37(const char* username);
 static void update_local_player_movement(Player* player, StreamBuffer* out);
 static void append_placement(StreamBuffer* out, u32 local_x, u32 local_y, u32 z, bool reset_move, bool update);
 static void append_walk(StreamBuffer* out, i32 direction, bool update);
 static void append_run(StreamBuffer* out, i32 dir1, i32 dir2, bool update);
 static void append_stand(StreamBuffer* out);
 static void append_appearance(Player* player, StreamBuffer* out);
-static void update_other_players(Player* viewer, Player* all_players[], u32 player_count, StreamBuffer* out, StreamBuffer* block, PlayerTracking* tracking);
-static void append_player_add(StreamBuffer* out, Player* player, Player* viewer);
+static void update_other_players(Player* viewer, PlayerList* list, const ZoneGrid* zones, StreamBuffer* out, StreamBuffer* block, PlayerTracking* tracking);
+static void append_player_add(StreamBuffer* out, Player* player, Player* viewer, bool update);
 static void append_player_update_block(Player* player, StreamBuffer* block, u8 mask);
+static void append_cached_segment(Player* player, StreamBuffer* block, u8 bit);
+static u8 player_update_mask(const Player* player, bool self);
+static u32 update_block_size(Player* player, u8 mask);
+static void refresh_appearance_blob(Player* player);
+
+/*
+ * Update block scratch - appended after the bit-packed section
+ *
+ * Reused by every update_player() call instead of allocating 2KB per
+ * viewer per tick. Grows onto the heap once if a crowded area needs more.
+ */
+static u8 block_storage[2048];
+static StreamBuffer block_scratch;
+static bool block_scratch_ready = false;
 
 /*******************************************************************************
  * HELPER FUNCTIONS
@@ -355,7 +425,7 @@ static void append_player_update_block(Player* player, StreamBuffer* block, u8 m
  * NULL otherwise (pre-login state uses unencrypted packets).
  */
 static inline ISAACCipher* enc_for(Player* p) {
-    return (p && p->out_cipher.initialized) ? &p->out_cipher : NULL;
+    return (p && p->conn->out_cipher.initialized) ? &p->conn->out_cipher : NULL;
 }
 
 /*******************************************************************************
@@ -378,9 +448,9 @@ static inline ISAACCipher* enc_for(Player* p) {
 void send_player_info_empty(Player* player) {
     if (!player) return;
 
-    ISAACCipher* enc = (player->out_cipher.initialized ? &player->out_cipher : NULL);
+    ISAACCipher* enc = (player->conn->out_cipher.initialized ? &player->conn->out_cipher : NULL);
 
-    StreamBuffer* out = buffer_create(4);
+    StreamBuffer* out = player_out(player);
     buffer_write_header_var(out, SERVER_PLAYER_INFO, enc, VAR_SHORT);
 
 
@@ -389,8 +459,7 @@ void send_player_info_empty(Player* player) {
     dbg_log_send("PLAYER_INFO(empty)", SERVER_PLAYER_INFO, "varshort",
                  0, enc != NULL);
 
-    network_send(player->socket_fd, out->data, out->position);
-    buffer_destroy(out);
+    player_out_commit(player);
 }
 
 /*
@@ -503,15 +572,15 @@ void send_player_info_empty(Player* player) {
  *   Compression ratio: 7.6× (87% bandwidth reduction)
  */
 static void update_local_player_movement(Player* player, StreamBuffer* out) {
-    bool has_update = (player && player->update_flags);
+    bool has_update = (player && player_update_mask(player, true) != 0);
     
     if (player && player->needs_placement) {
         buffer_write_bits(out, 1, 1);
         Position origin;
-        position_init(&origin, player->origin_x, player->origin_z, player->position.height);
+        position_init(&origin, player->origin_x, player->origin_z, position_height(&player->position));
         u32 local_x = position_get_local_x(&player->position, &origin);
         u32 local_y = position_get_local_z(&player->position, &origin);
-        u32 z = player->position.height & 0x3;
+        u32 z = position_height(&player->position) & 0x3;
         append_placement(out, local_x, local_y, z, false, has_update);
     } else if (player && player->secondary_direction != -1) {
         buffer_write_bits(out, 1, 1);
@@ -533,9 +602,9 @@ static void update_local_player_movement(Player* player, StreamBuffer* out) {
  * update_player - Construct and send full player update packet
  * 
  * @param player         Viewing player (packet recipient)
- * @param all_players    Array of all active players
- * @param player_count   Count of active players
  * @param tracking       Player's tracking state (local player list)
+ * @param list           World player list (PID → Player* lookup)
+ * @param zones          World zone grid (nearby player candidates)
  * 
  * HIGH-LEVEL ALGORITHM (10 PHASES):
  * 
@@ -677,27 +746,65 @@ static void update_local_player_movement(Player* player, StreamBuffer* out) {
  *   Note: RS2 protocol has no integrity checking or authentication
  *   Modern alternatives: TLS 1.3, DTLS for UDP, message authentication codes
  */
-void update_player(Player* player, Player* all_players[], u32 player_count, PlayerTracking* tracking) {
-    if (!player || !tracking) return;
+void update_player(Player* player, PlayerTracking* tracking, PlayerList* list, const ZoneGrid* zones) {
+    /*
+     * block: file-scope scratch shared by all viewers; on this path players
+     *        are updated one at a time on the game thread, so one buffer
+     *        suffices and any heap growth it needs is kept for later ticks
+     */
+    if (!block_scratch_ready) {
+        buffer_init_external(&block_scratch, block_storage, sizeof(block_storage));
+        block_scratch_ready = true;
+    }
+    if (update_player_encode(player, tracking, list, zones, &block_scratch)) {
+        player_out_commit(player);
+    }
+}
+
+/*
+ * update_player_encode - Write one viewer's PLAYER_INFO into its out arena
+ *
+ * @param player    Viewer
+ * @param tracking  Viewer's tracking state
+ * @param list      World player list
+ * @param zones     World zone grid
+ * @param block     Caller-owned update block scratch (reset here)
+ * @return          false if an argument was NULL (nothing written)
+ *
+ * The body of update_player() without player_out_commit(), so the packet
+ * sits in player->conn->out_stream until the caller commits it.
+ *
+ * THREAD SAFETY (see update_pool.h):
+ *   Writes only the viewer (out arena, out cipher, region_changed), its
+ *   tracking entry and block. Other players are read-only once
+ *   update_prepare_blocks() has run for each of them this tick, so
+ *   different viewers may be encoded on different threads as long as
+ *   each thread brings its own block buffer.
+ */
+bool update_player_encode(Player* player, PlayerTracking* tracking, PlayerList* list,
+                          const ZoneGrid* zones, StreamBuffer* block) {
+    if (!player || !tracking || !list || !zones || !block) return false;
 
-    StreamBuffer* out   = buffer_create(4096);
-    StreamBuffer* block = buffer_create(2048);
+    /* out: the player's own output arena (no allocation per tick) */
+    StreamBuffer* out = player_out(player);
+    buffer_reset(block);
 
-    ISAACCipher* enc = player->out_cipher.initialized ? &player->out_cipher : NULL;
+    ISAACCipher* enc = player->conn->out_cipher.initialized ? &player->conn->out_cipher : NULL;
     buffer_write_header_var(out, SERVER_PLAYER_INFO, enc, VAR_SHORT);
 
     u32 payload_start = buffer_get_position(out);
 
     /* Write local player's update block FIRST (before any others) */
-    if (player->update_flags != 0) {
-        append_player_update_block(player, block, player->update_flags & 0xFF);
+    u8 self_mask = player_update_mask(player, true);
+    if (self_mask != 0) {
+        append_player_update_block(player, block, self_mask);
     }
 
     buffer_start_bit_access(out);
 
     update_local_player_movement(player, out);
 
-    update_other_players(player, all_players, player_count, out, block, tracking);
+    update_other_players(player, list, zones, out, block, tracking);
 
     buffer_finish_bit_access(out);
 
@@ -709,21 +816,196 @@ void update_player(Player* player, Player* all_players[], u32 player_count, Play
 
     int payload_len = (int)(buffer_get_position(out) - payload_start);
     dbg_log_send("PLAYER_INFO", SERVER_PLAYER_INFO, "varshort", payload_len, enc != NULL);
+    traffic_add(player->conn, TRAFFIC_INFO_BYTES, (u64)payload_len + 3);
 
-    network_send(player->socket_fd, out->data, out->position);
+    player->region_changed  = false;
+    return true;
+}
 
-    buffer_destroy(block);
-    buffer_destroy(out);
+/* Chebyshev distance in tiles, capped at MAX_VIEW_DISTANCE (a sort key) */
+static u8 info_distance(const Player* viewer, const Player* other) {
+    i32 dx = (i32)position_x(&other->position) - (i32)position_x(&viewer->position);
+    i32 dz = (i32)position_z(&other->position) - (i32)position_z(&viewer->position);
+    if (dx < 0) dx = -dx;
+    if (dz < 0) dz = -dz;
+    i32 distance = dx > dz ? dx : dz;
+    return (u8)(distance < MAX_VIEW_DISTANCE ? distance : MAX_VIEW_DISTANCE);
+}
 
-    player->region_changed  = false;
+/*
+ * plan_player_info - Decide which blocks fit in the viewer's byte budget
+ *
+ * @param viewer      Local player
+ * @param list        World player list
+ * @param tracking    Viewer's tracking state (owed is updated here)
+ * @param visible     PIDs the viewer can see this tick
+ * @param keep_mask   Mask bits the viewer takes at all (congestion)
+ * @param local_max   Most players the local list may hold
+ * @param self_bytes  Bytes of the viewer's own block, already written
+ * @param plan        Filled: granted masks and the players to add
+ *
+ * Walks the tracked list and the additions the way update_other_players()
+ * encodes them, totalling the bit section (always sent) and every block
+ * wanted. Under g_player_info_budget everything is granted. Over it the
+ * candidates are ordered by distance (a counting sort, distances are at
+ * most MAX_VIEW_DISTANCE) and granted in two rounds: hits and chat of
+ * tracked players, then appearances and adds. What does not fit waits:
+ * tracked players' appearances go into tracking->owed, adds are left out
+ * of plan->adds and stay in visible \ tracked for the next tick.
+ *
+ * COMPLEXITY: O(T + A) for T tracked players and A additions; players
+ * neither changed nor owed cost one bit test, as in update_other_players
+ */
+static void plan_player_info(Player* viewer, PlayerList* list, PlayerTracking* tracking,
+                             const PlayerSet* visible, u8 keep_mask, u32 local_max,
+                             u32 self_bytes, InfoPlan* plan) {
+    u32 bits = INFO_FIXED_BITS;
+    u32 wanted = 0;
+    u32 kept = 0;
+    plan->add_count = 0;
+    plan->candidate_count = 0;
+    
+    for (u32 i = 0; i < tracking->local_count; i++) {
+        u16 pid = tracking->local_players[i];
+        plan->tracked_mask[i] = 0;
+        bool seen = player_set_has(visible, pid);
+        if (seen && !player_set_has(&list->changed, pid) && !player_set_has(&tracking->owed, pid)) {
+            bits += 1;
+            kept++;
+            continue;
+        }
+        Player* other = seen ? player_list_get(list, pid) : NULL;
+        if (!other) {
+            bits += 3;  /* Removal */
+            continue;
+        }
+        kept++;
+        bits += other->primary_direction != -1 ? 12 : 3;
+        
+        u8 want = player_update_mask(other, false) & keep_mask;
+        if (player_set_has(&tracking->owed, pid)) want |= PLAYER_MASK_APPEARANCE;
+        plan->tracked_mask[i] = want;
+        if (want == 0) continue;
+        
+        wanted += update_block_size(other, want);
+        InfoCandidate* c = &plan->candidates[plan->candidate_count++];
+        c->player = other;
+        c->slot = (u16)i;
+        c->want = want;
+        c->add = false;
+        c->distance = info_distance(viewer, other);
+    }
+    
+    /*
+     * Additions: visible \ tracked in PID order, skipping players still
+     * being placed (teleporting or logging in: their position settles
+     * next tick, and adding them now would make them appear, vanish and
+     * reappear)
+     */
+    PlayerSet adds;
+    player_set_difference(&adds, visible, &tracking->tracked);
+    for (u32 pid = player_set_next(&adds, 0);
+         pid < MAX_PLAYERS && kept + plan->add_count < local_max;
+         pid = player_set_next(&adds, pid + 1)) {
+        Player* other = player_list_get(list, (u16)pid);
+        if (other->needs_placement) {
+            LOG_TRACE(LOG_UPDATE, "[SERVER]     -> Skipping %s (needs_placement)\n", other->username);
+            continue;
+        }
+        
+        /*
+         * UPDATE_APPEARANCE unless the viewer already holds this player's
+         * current appearance_version (see appearance_hashes below), plus
+         * any masks the player has pending this tick
+         */
+        bool appearance_known = other->appearance_version != 0 &&
+            tracking->appearance_hashes[pid] == other->appearance_version;
+        u8 want = player_update_mask(other, false) & keep_mask;
+        if (!appearance_known) want |= PLAYER_MASK_APPEARANCE;
+        
+        u32 n = plan->add_count++;
+        plan->adds[n] = (u16)pid;
+        plan->add_mask[n] = want;
+        wanted += INFO_ADD_BYTES + (want ? update_block_size(other, want) : 0);
+        
+        InfoCandidate* c = &plan->candidates[plan->candidate_count++];
+        c->player = other;
+        c->slot = (u16)n;
+        c->want = want;
+        c->add = true;
+        c->distance = info_distance(viewer, other);
+    }
+    
+    u32 fixed = (bits + 7) / 8 + self_bytes;
+    if (fixed + wanted <= g_player_info_budget) return;
+    
+    /* Over budget: nearest first (counting sort by distance) */
+    u32 starts[MAX_VIEW_DISTANCE + 2] = { 0 };
+    for (u32 i = 0; i < plan->candidate_count; i++) starts[plan->candidates[i].distance + 1]++;
+    for (u32 d = 1; d < MAX_VIEW_DISTANCE + 2; d++) starts[d] += starts[d - 1];
+    u16 order[MAX_LOCAL_PLAYERS * 2];
+    for (u32 i = 0; i < plan->candidate_count; i++) {
+        order[starts[plan->candidates[i].distance]++] = (u16)i;
+    }
+    
+    u32 room = g_player_info_budget > fixed ? g_player_info_budget - fixed : 0;
+    
+    /* Round 1: hits and chat of tracked players (they only exist this tick) */
+    for (u32 k = 0; k < plan->candidate_count; k++) {
+        InfoCandidate* c = &plan->candidates[order[k]];
+        if (c->add) continue;
+        u8 events = c->want & (PLAYER_MASK_HIT | PLAYER_MASK_CHAT);
+        plan->tracked_mask[c->slot] = 0;
+        if (events == 0) continue;
+        u32 cost = update_block_size(c->player, events);
+        if (cost > room) continue;
+        plan->tracked_mask[c->slot] = events;
+        room -= cost;
+    }
+    
+    /* Round 2: appearances, and whole additions */
+    for (u32 k = 0; k < plan->candidate_count; k++) {
+        InfoCandidate* c = &plan->candidates[order[k]];
+        if (c->add) {
+            u32 cost = INFO_ADD_BYTES + (c->want ? update_block_size(c->player, c->want) : 0);
+            if (cost <= room) {
+                room -= cost;
+            } else {
+                plan->add_mask[c->slot] = 0;
+                plan->adds[c->slot] = 0;        /* Deferred: PID 0 is never a player */
+            }
+            continue;
+        }
+        if (!(c->want & PLAYER_MASK_APPEARANCE)) continue;
+        u8 granted = plan->tracked_mask[c->slot];
+        u32 cost = update_block_size(c->player, PLAYER_MASK_APPEARANCE) - (granted ? 1 : 0);
+        if (cost <= room) {
+            plan->tracked_mask[c->slot] = granted | PLAYER_MASK_APPEARANCE;
+            room -= cost;
+        } else {
+            player_set_add(&tracking->owed, c->player->index);
+        }
+    }
+    
+    /* Close the gaps of deferred additions, keeping PID order */
+    u32 write = 0;
+    for (u32 i = 0; i < plan->add_count; i++) {
+        if (plan->adds[i] == 0) continue;
+        plan->adds[write] = plan->adds[i];
+        plan->add_mask[write] = plan->add_mask[i];
+        write++;
+    }
+    LOG_TRACE(LOG_UPDATE, "[SERVER] %s over budget: %u bytes wanted, %u of %u adds kept\n",
+              viewer->username, fixed + wanted, write, plan->add_count);
+    plan->add_count = write;
 }
 
 /*
  * update_other_players - Update tracked player list and encode changes
  * 
  * @param viewer        Local player (observer)
- * @param all_players   All active players on server
- * @param player_count  Count of active players
+ * @param list          World player list (PID-indexed Player* array)
+ * @param zones         World zone grid (players filed by 8x8 zone)
  * @param out           Bit-packed output buffer
  * @param block         Update block buffer (byte-aligned)
  * @param tracking      Viewer's tracking state
@@ -736,10 +1018,10 @@ void update_player(Player* player, Player* all_players[], u32 player_count, Play
  * 
  * Phase 2: Update existing tracked players (REMOVAL AND MOVEMENT)
  *   For each tracked player:
- *     1. Linear search all_players[] to find current instance (O(P) per player)
- *     2. If not found OR out of view range:
+ *     1. Test the PID against this tick's visible set (one bit)
+ *     2. If not visible (logged out, inactive, out of range):
  *        - Encode removal: [1:1][3:2] (3 bits)
- *        - Unmark tracked[pid] = false
+ *        - Remove pid from the tracked set
  *        - Do NOT increment write_idx (compact array)
  *     3. If still visible:
  *        - Check movement state (primary_direction, secondary_direction)
@@ -752,46 +1034,49 @@ void update_player(Player* player, Player* all_players[], u32 player_count, Play
  *        - If has update flags, append to block buffer
  * 
  * Phase 3: Add new players entering view range (ADDITIONS)
- *   For each player in all_players[]:
- *     1. Skip if self (viewer)
- *     2. Skip if already tracked[index] = true
- *     3. Skip if needs_placement (player still teleporting)
- *     4. Test visibility with player_can_see():
- *        - Manhattan distance ≤ 15 tiles
- *        - Same height level
- *     5. If visible and space available (local_count < 255):
+ *   For each PID in visible \ tracked (PID order):
+ *     (visible never holds the viewer; it was built from the zones
+ *      around the viewer with player_can_see(): distance ≤ the viewer's
+ *      view_distance, 15 tiles unless crowding shrank it, same height level)
+ *     1. Skip if needs_placement (player still teleporting)
+ *     2. If space available (local_count < g_local_player_budget, max 255):
  *        - Encode addition: [index:11][delta_z:5][delta_x:5][jump:1][upd:1]
- *        - Mark tracked[index] = true
+ *        - Add index to the tracked set
  *        - Add to local_players[local_count++]
- *        - ALWAYS append UPDATE_APPEARANCE block for new adds
+ *        - Append UPDATE_APPEARANCE unless the viewer's appearance_hashes[pid]
+ *          already equals the player's appearance_version (nonzero): a player
+ *          walking back into view in the same clothes costs only the 23 bits
  * 
  * Phase 4: Write end marker
  *   [2047:11] - all 11 bits set signals end of player additions list
  * 
  * ALGORITHMIC COMPLEXITY ANALYSIS:
  * 
- *   Let P = total online players (player_count)
+ *   Let P = total online players
  *   Let T = tracked players (tracking->local_count, max 255)
+ *   Let C = players filed in the 5x5 zones around the viewer
  *   Let V = players in view range (~10-30 typical)
  * 
  *   Phase 1: O(1) - write 8-bit count
  * 
  *   Phase 2 (update tracked):
- *     Outer loop: O(T) iterations over tracked players
- *     Inner loop: O(P) linear search to find player instance
+ *     Loop: O(T) iterations over tracked players
+ *     PID lookup: O(1) direct index into list->players[]
  *     Per-player work: O(1) bit encoding
- *     Total: O(T × P) worst case
- *     Optimization potential: Use hash map all_players indexed by PID → O(T)
+ *     Total: O(T)
+ * 
+ *   Visible set (before phase 2):
+ *     O(C) iterations over zone grid candidates, player_can_see() each
  * 
  *   Phase 3 (add new):
- *     Outer loop: O(P) iterations over all players
- *     player_can_see(): O(1) Manhattan distance check
+ *     Set difference: 32 word operations
+ *     Loop: one ctz per new player, plus empty-word tests
  *     Per-player work: O(1) bit encoding + O(A) appearance block (A ≈ 80 bytes)
- *     Total: O(P) iterations, O(V) additions (early termination at local_count=255)
+ *     Total: O(V) additions (early termination at local_count=255)
  * 
- *   Combined: O(T × P + P) = O(P × (T + 1))
- *   Typical: T=20, P=100 → ~2000 comparisons per update (600ms tick)
- *   Worst case: T=255, P=2048 → ~522,240 comparisons (acceptable for 600ms budget)
+ *   Combined: O(T + C), independent of P
+ *   Typical: T=20, C=30 → ~50 checks per update (600ms tick)
+ *   Worst case: everyone in one spot, T=255, C=P
  * 
  *   Space complexity: O(T + V) for output buffers
  * 
@@ -813,22 +1098,20 @@ void update_player(Player* player, Player* all_players[], u32 player_count, Play
  * 
  *   1. Tracked player list remains consistent between ticks
  *   2. Players cannot be added and removed in same tick (single state transition)
- *   3. New players ALWAYS get appearance block (client requirement)
+ *   3. New players get an appearance block unless this viewer already
+ *      holds their current appearance_version (appearance_hashes[pid])
  *   4. Removals are processed before additions (prevents double-counting)
  *   5. Local player count never exceeds 255 (protocol limit)
  * 
- * OPTIMIZATION OPPORTUNITIES:
+ * CHANGED-SET FAST PATH:
  * 
- *   1. Replace linear search with hash map: all_players[pid] → O(1) lookup
- *      Current bottleneck: O(T × P) → O(T)
- *   2. Spatial partitioning: Quadtree for player_can_see() → O(log P)
- *      Current: O(P) full scan
- *   3. Dirty flags: Only check tracking for players who moved
- *      Current: Always scan all P players
- *   4. Appearance caching: Track appearance hash, skip block if unchanged
- *      Implemented: appearance_hashes[] array (not used in this function)
+ *   The player list's changed set holds the PIDs that moved, got update
+ *   flags or are being placed this tick (player_mark_changed()). A tracked
+ *   player that is still visible, outside that set and not owed an
+ *   appearance is written as one 0 bit without loading its Player, so a
+ *   crowd standing still costs T bit tests rather than T player visits.
  */
-static void update_other_players(Player* viewer, Player* all_players[], u32 player_count, 
+static void update_other_players(Player* viewer, PlayerList* list, const ZoneGrid* zones,
                                 StreamBuffer* out, StreamBuffer* block, PlayerTracking* tracking) {
     // printf("DEBUG: player=%s (idx=%u) local_count=%u bit_pos=%u tracking_ptr=%p\n", 
     //        viewer->username, viewer->index, tracking->local_count, out->bit_position, (void*)tracking);
@@ -845,6 +1128,26 @@ static void update_other_players(Player* viewer, Player* all_players[], u32 play
      */
     buffer_write_bits(out, 8, tracking->local_count);
     
+    /*
+     * Who the viewer can see this tick, as a PID set. Phase 2 keeps the
+     * tracked players in it; phase 3 adds visible \ tracked.
+     * 
+     * In a crowd the viewer's radius shrinks so that at most
+     * g_local_player_budget of the nearest players are visible (see
+     * player_find_visible_adaptive); tracked players beyond the new
+     * radius are removed by phase 2 like any player walking out of view.
+     */
+    u32 budget = g_local_player_budget < MAX_LOCAL_PLAYERS ? g_local_player_budget : MAX_LOCAL_PLAYERS;
+    PlayerSet visible;
+    player_find_visible_adaptive(viewer, list, zones, budget, &tracking->view_distance, &visible);
+    
+    /* A congested viewer (player.h) is spared other players' public chat */
+    u8 keep_mask = player_out_congested(viewer) ? (u8)~PLAYER_MASK_CHAT : 0xFF;
+    
+    /* Which blocks and additions fit in g_player_info_budget (see above) */
+    InfoPlan plan;
+    plan_player_info(viewer, list, tracking, &visible, keep_mask, budget, block->position, &plan);
+    
     /*
      * PHASE 2: Update existing tracked players
      * 
@@ -857,42 +1160,30 @@ static void update_other_players(Player* viewer, Player* all_players[], u32 play
      *   - Kept players: copied to write_idx position (array compacted)
      *   - Result: local_players[0..write_idx-1] contains only still-visible players
      * 
-     * Complexity: O(T × P) due to nested loop with linear search
+     * Complexity: O(T) - each tracked PID resolves with a single array load
      */
     u32 write_idx = 0;  /* Compaction write position */
     for (u32 read_idx = 0; read_idx < tracking->local_count; read_idx++) {
         u16 pid = tracking->local_players[read_idx];
-        Player* other = NULL;
-        
-        /*
-         * Linear search to find player instance by PID
-         * 
-         * BOTTLENECK: O(P) search repeated T times = O(T × P)
-         * OPTIMIZATION: Replace with hash map all_players[pid] → O(1) lookup
-         * 
-         * Why linear search?
-         *   - all_players[] is not sorted or indexed by PID
-         *   - PIDs can be non-contiguous (1, 5, 100, 2047)
-         *   - Hash map would add memory overhead: ~16 KB for 2048 buckets
-         */
-        for (u32 j = 0; j < player_count; j++) {
-            if (all_players[j]->index == pid) {
-                other = all_players[j];
-                break;  /* Found player, exit search early */
-            }
-        }
         
         /*
          * Decision: Remove or keep player?
          * 
-         * Remove if:
-         *   1. Player not found (logged out or disconnected)
-         *   2. Out of view range (moved >15 tiles away or changed height)
-         * 
-         * Keep if:
-         *   Still visible and in range
+         * The visible set already excludes players who logged out, left
+         * LOGGED_IN, moved >15 tiles away or changed height, so this is
+         * one bit test; only kept players are resolved (a single load,
+         * the world player list is indexed by PID). A kept player outside
+         * the list's changed set neither moved nor has update flags: one
+         * 0 bit, without loading the Player at all.
          */
-        if (!other || !player_can_see(viewer, other)) {
+        bool seen = player_set_has(&visible, pid);
+        if (seen && !player_set_has(&list->changed, pid) && !player_set_has(&tracking->owed, pid)) {
+            tracking->local_players[write_idx++] = pid;
+            buffer_write_bits(out, 1, 0);  /* No update */
+            continue;
+        }
+        Player* other = seen ? player_list_get(list, pid) : NULL;
+        if (!other) {
             /*
              * REMOVAL ENCODING:
              *   [update_required:1 = 1][movement_type:2 = 3]
@@ -901,9 +1192,10 @@ static void update_other_players(Player* viewer, Player* all_players[], u32 play
              * Movement type 3 is reserved for removal (teleport is encoded differently)
              * Client interprets [1][3] as "remove this player from local list"
              */
-            buffer_write_bits(out, 1, 1);  /* Update required flag */
-            buffer_write_bits(out, 2, 3);  /* Movement type 3 = removal */
-            tracking->tracked[pid] = false;  /* Unmark from tracking bitmap */
+            buffer_write_bits(out, 3, bits_pack(1, 2, 3));  /* Update required, type 3 = removal */
+            player_set_remove(&tracking->tracked, pid);  /* Unmark from tracking set */
+            player_set_remove(&tracking->owed, pid);     /* Re-adding checks the version */
+            PROBE2(player__remove, viewer->index, pid);
             /* Note: write_idx NOT incremented - creates gap in array */
         } else {
             /*
@@ -918,7 +1210,8 @@ static void update_other_players(Player* viewer, Player* all_players[], u32 play
             tracking->local_players[write_idx++] = pid;
             
             bool has_moved = (other->primary_direction != -1);
-            bool has_update = (other->update_flags != 0);
+            u8 mask = plan.tracked_mask[read_idx];
+            bool has_update = (mask != 0);
             
             if (has_moved) {
                 /*
@@ -936,23 +1229,29 @@ static void update_other_players(Player* viewer, Player* all_players[], u32 play
                  *   Example: Walk east with appearance update:
                  *     [1][01][010][1]
                  */
-                buffer_write_bits(out, 1, 1);  /* Update required */
+                /* Whole movement record packed into one write (see bits_pack) */
                 if (other->secondary_direction != -1) {
-                    /* Run: both directions set */
-                    buffer_write_bits(out, 2, 2);  /* Movement type 2 = run */
-                    buffer_write_bits(out, 3, other->primary_direction);    /* First step */
-                    buffer_write_bits(out, 3, other->secondary_direction);  /* Second step */
-                    buffer_write_bits(out, 1, has_update ? 1 : 0);         /* Extended info flag */
+                    /* Run: update required, type 2, both steps, extended info flag */
+                    u32 run = bits_pack(1, 2, 2);
+                    run = bits_pack(run, 3, (u32)other->primary_direction);
+                    run = bits_pack(run, 3, (u32)other->secondary_direction);
+                    run = bits_pack(run, 1, has_update ? 1 : 0);
+                    buffer_write_bits(out, 10, run);
                 } else {
-                    /* Walk: only primary direction */
-                    buffer_write_bits(out, 2, 1);  /* Movement type 1 = walk */
-                    buffer_write_bits(out, 3, other->primary_direction);
-                    buffer_write_bits(out, 1, has_update ? 1 : 0);
+                    /* Walk: update required, type 1, only primary direction */
+                    u32 walk = bits_pack(1, 2, 1);
+                    walk = bits_pack(walk, 3, (u32)other->primary_direction);
+                    walk = bits_pack(walk, 1, has_update ? 1 : 0);
+                    buffer_write_bits(out, 7, walk);
                 }
                 
                 /* Append update block if player has visual changes */
                 if (has_update) {
-                    append_player_update_block(other, block, other->update_flags & 0xFF);
+                    append_player_update_block(other, block, mask);
+                    if (mask & PLAYER_MASK_APPEARANCE) {
+                        tracking->appearance_hashes[pid] = other->appearance_version;
+                        player_set_remove(&tracking->owed, pid);
+                    }
                 }
             } else {
                 /*
@@ -967,9 +1266,12 @@ static void update_other_players(Player* viewer, Player* all_players[], u32 play
                  *   Total: 1 bit (most common case - ~70% of players)
                  */
                 if (has_update) {
-                    buffer_write_bits(out, 1, 1);  /* Update required */
-                    buffer_write_bits(out, 2, 0);  /* Movement type 0 = stand */
-                    append_player_update_block(other, block, other->update_flags & 0xFF);
+                    buffer_write_bits(out, 3, bits_pack(1, 2, 0));  /* Update required, type 0 = stand */
+                    append_player_update_block(other, block, mask);
+                    if (mask & PLAYER_MASK_APPEARANCE) {
+                        tracking->appearance_hashes[pid] = other->appearance_version;
+                        player_set_remove(&tracking->owed, pid);
+                    }
                 } else {
                     /* Optimal case: player unchanged, single bit encoding */
                     buffer_write_bits(out, 1, 0);  /* No update */
@@ -991,145 +1293,91 @@ static void update_other_players(Player* viewer, Player* all_players[], u32 play
     /*
      * PHASE 3: Add new players entering view range
      * 
-     * Scans ALL online players to find new players who:
-     *   1. Are NOT the viewer (cannot see self)
-     *   2. Are NOT already tracked (prevent duplicates)
-     *   3. Are NOT in placement mode (teleporting/logging in)
-     *   4. ARE within view range (Manhattan distance ≤ 15, same height)
+     * adds = visible \ tracked: players the viewer can see (the zone
+     * grid query and player_can_see() filter ran in player_find_visible:
+     * distance ≤ 15, same height, active) that are not in the local list
+     * yet. That also excludes the viewer, who is never in visible. The
+     * set is walked a 64-PID word at a time, count-trailing-zeros
+     * finding each member, so new players are added in PID order.
      * 
-     * Loop termination conditions:
-     *   - Early termination: local_count reaches 255 (protocol limit)
-     *   - Normal termination: all players scanned
+     * plan_player_info() already walked it: plan.adds holds the members
+     * to add this tick, without
+     *   - players in placement mode (teleporting/logging in)
+     *   - members past the local list budget (at most 255, the protocol
+     *     limit; only hit when the few nearest rings alone exceed it)
+     *   - additions deferred by the byte budget (added on a later tick)
      * 
-     * Complexity: O(P) where P = player_count
+     * Complexity: O(32 + A) word tests and additions
      * Average additions: ~5-10 players per tick (players walking into range)
      */
-    printf("[SERVER] Third pass START - viewer=%s player_count=%u local_count=%u\n", 
-           viewer->username, player_count, tracking->local_count);
+    LOG_TRACE(LOG_UPDATE, "[SERVER] Third pass START - viewer=%s new=%u local_count=%u\n", 
+                          viewer->username, plan.add_count, tracking->local_count);
     
-    for (u32 i = 0; i < player_count && tracking->local_count < 255; i++) {
-        Player* other = all_players[i];
-        printf("[SERVER]   Checking all_players[%u]: index=%u username=%s state=%d needs_placement=%d pos=(%u,%u)\n", 
-               i, other->index, other->username, other->state, other->needs_placement,
-               other->position.x, other->position.z);
+    for (u32 i = 0; i < plan.add_count; i++) {
+        u16 pid = plan.adds[i];
+        Player* other = player_list_get(list, pid);
         
-        /*
-         * FILTER 1: Skip self
-         * 
-         * Player cannot see themselves in the multiplayer list.
-         * Local player is handled separately in update_local_player_movement().
-         */
-        if (other == viewer) {
-            printf("[SERVER]     -> Skipping (self)\n");
-            continue;
-        }
+        LOG_TRACE(LOG_UPDATE, "[SERVER] ADDING %s (idx=%u) to %s's local list\n", 
+                              other->username, other->index, viewer->username);
         
         /*
-         * FILTER 2: Skip already tracked
+         * PLAYER ADDITION SEQUENCE:
          * 
-         * tracked[] is a bitmap (bool array) marking which PIDs are in local_players[].
-         * If tracked[pid] = true, player is already in our list from phase 2.
+         * 1. Encode addition in bit-packed section (23 bits)
+         *    [index:11][delta_z:5][delta_x:5][jump:1][update:1]
          * 
-         * This prevents duplicate additions: same player cannot be both updated and added.
-         */
-        if (tracking->tracked[other->index]) {
-            printf("[SERVER]     -> Skipping (already tracked)\n");
-            continue;
-        }
-        
-        /*
-         * FILTER 3: Skip players in placement mode
-         * 
-         * needs_placement flag indicates player is:
-         *   - Just logged in (initial spawn)
-         *   - Teleporting between regions
-         *   - Changing height levels
+         * 2. Mark player as tracked
+         *    player_set_add(tracked) keeps the set equal to the list
          * 
-         * During placement, player's exact position is uncertain (client-side animation).
-         * Adding them during placement causes visual glitches (player appears, disappears, reappears).
+         * 3. Add to local_players[] array
+         *    local_players[local_count++] = PID
          * 
-         * Wait until placement completes (next tick), then add with stable position.
+         * 4. Append update block if needed
+         *    UPDATE_APPEARANCE unless the viewer already holds this
+         *    player's current appearance_version (see below), plus any
+         *    masks the player has pending this tick
          */
-        if (other->needs_placement) {
-            printf("[SERVER]     -> Skipping (needs_placement=%d)\n", other->needs_placement);
-            continue;
-        }
+        u8 add_mask = plan.add_mask[i];
+        
+        append_player_add(out, other, viewer, add_mask != 0);
+        player_set_add(&tracking->tracked, pid);
+        player_set_remove(&tracking->owed, pid);
+        tracking->local_players[tracking->local_count++] = pid;
+        PROBE2(player__add, viewer->index, pid);
         
         /*
-         * VISIBILITY CHECK: player_can_see()
+         * APPEARANCE BLOCK: Required on first sighting
          * 
-         * Tests if target is within viewer's update range:
-         *   1. Manhattan distance: |Δx| + |Δz| ≤ 15 tiles
-         *   2. Same height level (floor 0-3)
-         *   3. Visibility flags (not hidden by admin powers)
+         * appearance_hashes[pid] remembers the version this viewer last
+         * received. The client keeps that appearance buffer per index
+         * even after the player leaves view, so re-adding someone with
+         * an unchanged version costs only the 23 add bits.
          * 
-         * Complexity: O(1) - simple arithmetic comparison
+         * UPDATE_APPEARANCE (0x1) contains:
+         *   - Gender (male/female)
+         *   - Body part styles (hair, beard, torso, arms, legs, feet)
+         *   - Body colors (hair, torso, legs, feet, skin)
+         *   - Equipment (weapons, armor)
+         *   - Combat level
+         *   - Skill level (total level)
+         *   - Username (base37 encoded)
          * 
-         * Why Manhattan distance instead of Euclidean?
-         *   - RS2 regions are square grids (8×8 chunks)
-         *   - Manhattan distance matches region loading system
-         *   - Faster: no square root calculation
-         *   - Diamond-shaped view range (not circular)
+         * Size: ~80-100 bytes typical
+         * 
+         * Client behavior without appearance:
+         *   - Shows default male model (bald, grey skin, no equipment)
+         *   - Displays "null" as username
+         *   - Combat level shows as 3
          */
-        bool can_see = player_can_see(viewer, other);
-        printf("[SERVER]     -> player_can_see=%d (viewer pos=%u,%u other pos=%u,%u)\n",
-               can_see, viewer->position.x, viewer->position.z, other->position.x, other->position.z);
-        
-        if (can_see) {
-            printf("[SERVER] ADDING %s (idx=%u) to %s's local list\n", 
-                   other->username, other->index, viewer->username);
-            
-            /*
-             * PLAYER ADDITION SEQUENCE:
-             * 
-             * 1. Encode addition in bit-packed section (23 bits)
-             *    [index:11][delta_z:5][delta_x:5][jump:1][update:1]
-             * 
-             * 2. Mark player as tracked
-             *    tracked[index] = true prevents re-adding in same tick
-             * 
-             * 3. Add to local_players[] array
-             *    local_players[local_count++] = PID
-             *    Increments count, enforcing limit (loop condition checks < 255)
-             * 
-             * 4. Append UPDATE_APPEARANCE block
-             *    New players ALWAYS get appearance block (client requirement)
-             *    Without appearance, client shows player as invisible/default model
-             */
-            // u32 bit_before_add = out->bit_position;
-            append_player_add(out, other, viewer);
-            // printf("DEBUG: Player add wrote %u bits (from %u to %u)\n", 
-            //        out->bit_position - bit_before_add, bit_before_add, out->bit_position);
-            tracking->tracked[other->index] = true;
-            tracking->local_players[tracking->local_count++] = other->index;
-            
-            /*
-             * APPEARANCE BLOCK: Mandatory for new additions
-             * 
-             * UPDATE_APPEARANCE (0x1) contains:
-             *   - Gender (male/female)
-             *   - Body part styles (hair, beard, torso, arms, legs, feet)
-             *   - Body colors (hair, torso, legs, feet, skin)
-             *   - Equipment (weapons, armor)
-             *   - Combat level
-             *   - Skill level (total level)
-             *   - Username (base37 encoded)
-             * 
-             * Size: ~80-100 bytes typical
-             * 
-             * Client behavior without appearance:
-             *   - Shows default male model (bald, grey skin, no equipment)
-             *   - Displays "null" as username
-             *   - Combat level shows as 3
-             */
-            // u32 block_pos_before = block->position;
-            append_player_update_block(other, block, UPDATE_APPEARANCE);
-            // printf("DEBUG: Appearance block wrote %u bytes (from %u to %u), total block size=%u\n", 
-            //        block->position - block_pos_before, block_pos_before, block->position, block->position);
+        if (add_mask != 0) {
+            append_player_update_block(other, block, add_mask);
+        }
+        if (add_mask & PLAYER_MASK_APPEARANCE) {
+            tracking->appearance_hashes[pid] = other->appearance_version;
         }
     }
     
-    printf("[SERVER] Third pass END - added %u players\n", tracking->local_count - write_idx);
+    LOG_TRACE(LOG_UPDATE, "[SERVER] Third pass END - added %u players\n", tracking->local_count - write_idx);
     
     /*
      * PHASE 4: Write end marker
@@ -1180,9 +1428,8 @@ static void update_other_players(Player* viewer, Player* all_players[], u32 play
  *     - Prevents movement glitches from previous session
  * 
  *   update_required (1 bit):
- *     - Always 1 for new additions
- *     - Tells client to expect update block (appearance data)
- *     - Without this, client won't read appearance block
+ *     - 1 if an update block follows (first sighting, or changed look)
+ *     - 0 if the viewer already holds the current appearance version
  * 
  * COORDINATE DELTA ENCODING:
  * 
@@ -1227,7 +1474,7 @@ static void update_other_players(Player* viewer, Player* all_players[], u32 play
  *     Relative: 10 × 10 bits = 100 bits = 12.5 bytes
  *     Bandwidth saved: 22.5 bytes per update
  */
-static void append_player_add(StreamBuffer* out, Player* player, Player* viewer) {
+static void append_player_add(StreamBuffer* out, Player* player, Player* viewer, bool update) {
     /*
      * FIELD 1: Player index (11 bits)
      * 
@@ -1236,7 +1483,7 @@ static void append_player_add(StreamBuffer* out, Player* player, Player* viewer)
      * 
      * Range: 1-2047 (2048 max players, PID 0 reserved)
      */
-    buffer_write_bits(out, 11, player->index);
+    u32 add = player->index & 0x7FF;
     
     /*
      * FIELD 2-3: Position deltas (5 bits each)
@@ -1245,8 +1492,8 @@ static void append_player_add(StreamBuffer* out, Player* player, Player* viewer)
      * Client will add these deltas to viewer position to determine
      * where to spawn the new player on screen.
      */
-    i32 delta_x = player->position.x - viewer->position.x;
-    i32 delta_z = player->position.z - viewer->position.z;
+    i32 delta_x = position_x(&player->position) - position_x(&viewer->position);
+    i32 delta_z = position_z(&player->position) - position_z(&viewer->position);
     
     /*
      * Encode deltas as 5-bit two's complement signed values
@@ -1255,8 +1502,8 @@ static void append_player_add(StreamBuffer* out, Player* player, Player* viewer)
      *   Positive: 0-15 → 0b00000-0b01111
      *   Negative: -16 to -1 → 0b10000-0b11111
      */
-    buffer_write_bits(out, 5, delta_x & 0x1F);
-    buffer_write_bits(out, 5, delta_z & 0x1F);
+    add = bits_pack(add, 5, (u32)delta_x & 0x1F);
+    add = bits_pack(add, 5, (u32)delta_z & 0x1F);
     
     /*
      * FIELD 4: Discard walking queue (1 bit)
@@ -1267,22 +1514,25 @@ static void append_player_add(StreamBuffer* out, Player* player, Player* viewer)
      * Prevents visual glitch: Without this, client might show player
      * walking from their last known position (from previous session).
      */
-    buffer_write_bits(out, 1, 1);
+    add = bits_pack(add, 1, 1);
     
     /*
      * FIELD 5: Update required flag (1 bit)
      * 
-     * Always set to 1 for new player additions.
-     * Signals client to read update block (appearance data) for this player.
-     * 
-     * Protocol requirement: New players MUST have appearance block.
-     * Without appearance, client shows default model (grey, bald, nude).
+     * Set when an update block follows for this player. A viewer seeing
+     * a player for the first time always needs the appearance block, but
+     * a viewer re-adding someone whose appearance version it already
+     * holds can rely on the client's cached appearance buffer
+     * (player_appearance_buffer[index]) and skip it.
      */
-    buffer_write_bits(out, 1, 1);
+    add = bits_pack(add, 1, update ? 1 : 0);
+    
+    /* All five fields leave in one 23-bit write */
+    buffer_write_bits(out, 23, add);
     
-    printf("[SERVER] append_player_add: player=%s (idx=%u) delta_z=%d delta_x=%d viewer=%s pos=(%u,%u) player_pos=(%u,%u)\n", 
-           player->username, player->index, delta_z, delta_x, viewer->username,
-           viewer->position.x, viewer->position.z, player->position.x, player->position.z);
+    LOG_TRACE(LOG_UPDATE, "[SERVER] append_player_add: player=%s (idx=%u) delta_z=%d delta_x=%d viewer=%s pos=(%u,%u) player_pos=(%u,%u)\n", 
+                          player->username, player->index, delta_z, delta_x, viewer->username,
+                          position_x(&viewer->position), position_z(&viewer->position), position_x(&player->position), position_z(&player->position));
 }
 
 /*
@@ -1290,49 +1540,42 @@ static void append_player_add(StreamBuffer* out, Player* player, Player* viewer)
  * 
  * @param player  Player with updates
  * @param block   Output buffer (byte-aligned)
- * @param mask    Update flags bitmask
+ * @param mask    Client mask bits (player_update_mask())
  * 
  * BLOCK STRUCTURE (variable length):
  * 
  *   [mask:1 byte]  Bitmask of which updates are present
- *   [blocks...]    Update data in flag order
+ *   [blocks...]    Update data in mask bit order
  * 
- * UPDATE MASK FLAGS (processed in this order):
+ * UPDATE MASK BITS (processed in this order):
  * 
- *   UPDATE_APPEARANCE (0x01):
+ *   PLAYER_MASK_APPEARANCE (0x01):
  *     [length:1][appearance_data:length]
  *     Size: 46-100 bytes typical
  *     Contains: Gender, body parts, colors, animations, username, combat level
  * 
- *   UPDATE_ANIMATION (0x02):
- *     [animation_id:2 big-endian][delay:1]
- *     Size: 3 bytes
- *     Examples: Attack swing (422), Death (836), Emote (855-862)
+ *   PLAYER_MASK_HIT (0x10):
+ *     [damage:1][type:1][hitpoints:1][max hitpoints:1]
+ *     Size: 4 bytes; the client draws the splat and the health bar
  * 
- *   UPDATE_GRAPHIC (0x04):
- *     [graphic_id:2 big-endian][height:2][delay:1]
- *     Size: 5 bytes
- *     Examples: Teleport graphic (308), Level up (199), Prayer activate (83)
- * 
- *   UPDATE_CHAT (0x08):
- *     [type_and_effect:1][color:1][length:1][packed_text:length]
- *     Size: 10-80 bytes
- *     Text packed using wordpack compression
+ *   PLAYER_MASK_CHAT (0x40):
+ *     [color<<8 | effect:2][rights:1][length:1][packed_text:length]
+ *     Size: 5-84 bytes
+ *     Text packed by the sending client with wordpack, forwarded as-is
  * 
  * MASK PROCESSING ORDER:
  * 
- *   Protocol specification requires blocks in flag bit order:
+ *   Protocol specification requires blocks in mask bit order:
  *     1. Appearance (if mask & 0x01)
- *     2. Animation (if mask & 0x02)
- *     3. Graphic (if mask & 0x04)
- *     4. Chat (if mask & 0x08)
+ *     2. Hit (if mask & 0x10)
+ *     3. Chat (if mask & 0x40)
  * 
  *   Client reads blocks in same order, using mask to determine which to expect.
  *   Out-of-order blocks cause client to read wrong data → crash or corruption.
  * 
  * LENGTH-PREFIXED ENCODING:
  * 
- *   Only appearance uses length prefix (variable-length data).
+ *   Appearance and chat carry a length (variable-length data).
  *   Other updates have fixed sizes (client knows exact byte count).
  * 
  *   Why length prefix for appearance?
@@ -1351,43 +1594,26 @@ static void append_player_add(StreamBuffer* out, Player* player, Player* viewer)
  *     mask=0x01, appearance=80 bytes
  *     Total: 1 + 1 + 80 = 82 bytes
  * 
- *   Appearance + Animation:
- *     mask=0x03, appearance=80, animation=3
- *     Total: 1 + 1 + 80 + 3 = 85 bytes
- * 
- *   Animation + Graphic (combat hit):
- *     mask=0x06, animation=3, graphic=5
- *     Total: 1 + 3 + 5 = 9 bytes
- * 
- *   Chat only:
- *     mask=0x08, chat=20
- *     Total: 1 + 20 = 21 bytes
+ *   Appearance + Chat (someone logs in and speaks):
+ *     mask=0x41, appearance=80, chat=4+7
+ *     Total: 1 + 1 + 80 + 11 = 93 bytes
  * 
- * BUFFER MANAGEMENT:
+ *   Chat only ("hello world", 7 packed bytes):
+ *     mask=0x40, chat=4+7
+ *     Total: 1 + 11 = 12 bytes
  * 
- *   Appearance requires temporary buffer:
- *     1. Create 128-byte buffer (max appearance size)
- *     2. Write appearance data to temp buffer
- *     3. Write length byte to main block
- *     4. Copy temp buffer contents to main block
- *     5. Destroy temp buffer
+ * SHARED ENCODING (player->update_cache):
  * 
- *   Why temporary buffer?
- *     - Need to know final size before writing length prefix
- *     - Can't write length until appearance is fully encoded
- *     - Alternative: Pre-calculate size (complex, error-prone)
+ *   The same subject appears in many viewers' packets in one tick, and its
+ *   blocks are identical in all of them. Each mask bit's segment is
+ *   therefore encoded once per tick into the subject's UpdateBlockCache
+ *   and memcpy'd for every further viewer:
  * 
- * MEMORY ALLOCATION:
+ *     First viewer:   encode appearance → cache slab → copy into block
+ *     Other viewers:  copy from cache slab into block
  * 
- *   128-byte temp buffer allocation:
- *     Per appearance update: ~128 bytes heap allocation
- *     Typical: 20 players with appearance = 20 × 128 = 2.56 KB
- *     
- *   Optimization opportunity:
- *     - Pre-allocate buffer pool (reusable 128-byte buffers)
- *     - Current: malloc/free per appearance
- *     - Optimized: Borrow from pool, return when done
- *     - Savings: Eliminate 20-30 malloc calls per tick
+ *   200 viewers of one changed player: 1 encoding + 200 memcpy instead of
+ *   200 encodings (each with base37 and body/equipment bytes).
  */
 static void append_player_update_block(Player* player, StreamBuffer* block, u8 mask) {
     /*
@@ -1395,7 +1621,7 @@ static void append_player_update_block(Player* player, StreamBuffer* block, u8 m
      * 
      * Client reads this first to determine which update blocks follow.
      * Each bit set in mask corresponds to an update block present.
-     * Client processes blocks in flag bit order (0x01, 0x02, 0x04, 0x08).
+     * Client processes blocks in mask bit order (0x01, 0x10, 0x40).
      */
     buffer_write_byte(block, mask);
     
@@ -1412,35 +1638,205 @@ static void append_player_update_block(Player* player, StreamBuffer* block, u8 m
      *   4. Copy appearance data from temp to main block
      *   5. Free temporary buffer
      */
-    if (mask & UPDATE_APPEARANCE) {
-        StreamBuffer* appearance_buf = buffer_create(128);
-        append_appearance(player, appearance_buf);
-        
-        /* Write length prefix (u8, max 255 bytes) */
-        buffer_write_byte(block, (u8)appearance_buf->position);
-        
-        /* Copy appearance data to main block */
-        buffer_write_bytes(block, appearance_buf->data, appearance_buf->position);
-        
-        /* Free temporary buffer */
-        buffer_destroy(appearance_buf);
+    if (mask & PLAYER_MASK_APPEARANCE) {
+        append_cached_segment(player, block, PLAYER_MASK_APPEARANCE);
     }
     
     /*
-     * TODO: Implement remaining update types
-     * 
-     * UPDATE_ANIMATION (0x02):
-     *   buffer_write_short(block, animation_id, BIG_ENDIAN);
-     *   buffer_write_byte(block, delay);
+     * HIT UPDATE (0x10)
      * 
-     * UPDATE_GRAPHIC (0x04):
-     *   buffer_write_short(block, graphic_id, BIG_ENDIAN);
-     *   buffer_write_short(block, height, BIG_ENDIAN);
-     *   buffer_write_byte(block, delay);
+     * Hitsplat and health bar (combat.h), fixed 4 bytes, cached like the
+     * others so a fight watched by a crowd is encoded once.
+     */
+    if (mask & PLAYER_MASK_HIT) {
+        append_cached_segment(player, block, PLAYER_MASK_HIT);
+    }
+    
+    /*
+     * CHAT UPDATE (0x40)
      * 
-     * UPDATE_CHAT (0x08):
-     *   Removed in recent changes (chat system reverted)
+     * The sender's wordpacked bytes from its chat slot, behind color,
+     * effect, rights and length. Encoded once per tick like appearance.
      */
+    if (mask & PLAYER_MASK_CHAT) {
+        append_cached_segment(player, block, PLAYER_MASK_CHAT);
+    }
+}
+
+/*
+ * player_update_mask - Client mask bits for a player's pending updates
+ * 
+ * @param player  Subject
+ * @param self    true for the viewer's own block
+ * 
+ * Maps the server's update_flags onto PLAYER_INFO mask bits. Chat is
+ * left out of a player's own block: the client already showed the line
+ * when it sent MESSAGE_PUBLIC, and would otherwise show it twice. A hit
+ * is in both: the client only draws a player's own splats from here.
+ */
+static u8 player_update_mask(const Player* player, bool self) {
+    u32 flags = player->update_flags;
+    u8 mask = 0;
+    if (flags & UPDATE_APPEARANCE) mask |= PLAYER_MASK_APPEARANCE;
+    if (flags & UPDATE_HIT) mask |= PLAYER_MASK_HIT;
+    if ((flags & UPDATE_CHAT) && !self) mask |= PLAYER_MASK_CHAT;
+    return mask;
+}
+
+/*
+ * update_block_size - Bytes append_player_update_block() writes for mask
+ *
+ * @param player  Subject
+ * @param mask    Client mask bits
+ *
+ * The mask byte plus each segment, as append_cached_segment() encodes it.
+ * Only reads the subject once update_prepare_blocks() has run for it
+ * (its appearance blob is then clean).
+ */
+static u32 update_block_size(Player* player, u8 mask) {
+    u32 size = 1;
+    if (mask & PLAYER_MASK_APPEARANCE) {
+        refresh_appearance_blob(player);
+        size += 1 + player->appearance_length;
+    }
+    if (mask & PLAYER_MASK_HIT) size += 4;
+    if (mask & PLAYER_MASK_CHAT) size += 4 + chat_get(player)->length;
+    return size;
+}
+
+/*
+ * refresh_appearance_blob - Re-encode player->appearance if it is stale
+ * 
+ * @param player  Player whose blob to refresh
+ * 
+ * The blob survives across ticks; it is only rebuilt after
+ * player_appearance_changed() (design screen, equipment, login), so the
+ * common case of re-adding an unchanged player never touches
+ * append_appearance() or username_to_base37().
+ * 
+ * COMPLEXITY: O(1) when clean, O(appearance size) when dirty
+ */
+static void refresh_appearance_blob(Player* player) {
+    if (!player->appearance_dirty && player->appearance_length > 0) return;
+    
+    BUFFER_ON_STACK(tmp, APPEARANCE_BLOB_SIZE);
+    append_appearance(player, &tmp);
+    u32 length = tmp.position < APPEARANCE_BLOB_SIZE ? tmp.position : APPEARANCE_BLOB_SIZE;
+    memcpy(player->appearance, tmp.data, length);
+    player->appearance_length = (u8)length;
+    player->appearance_dirty = false;
+    buffer_release(&tmp);
+}
+
+/*
+ * append_cached_segment - Copy one mask bit's payload from the tick cache
+ * 
+ * @param player  Subject whose block is being written
+ * @param block   Viewer's update block buffer (destination), or NULL to
+ *                only fill the cache (update_prepare_blocks)
+ * @param bit     Single mask bit (e.g. PLAYER_MASK_APPEARANCE)
+ * 
+ * ALGORITHM:
+ *   1. If segment for bit is already in player->update_cache: memcpy it
+ *   2. Otherwise encode it once into a temp buffer:
+ *        PLAYER_MASK_APPEARANCE → [length:1][player->appearance blob]
+ *        PLAYER_MASK_HIT        → [damage:1][type:1][hitpoints:1][max:1]
+ *        PLAYER_MASK_CHAT       → [color<<8|effect:2][rights:1][length:1][packed]
+ *   3. Store in the cache slab (if it fits) and copy to block
+ * 
+ *   A segment that does not fit in the slab is still written to the block,
+ *   just not cached, so output is never affected by the cache size.
+ * 
+ * COMPLEXITY: O(segment size) time, one encoding per subject per tick
+ */
+static void append_cached_segment(Player* player, StreamBuffer* block, u8 bit) {
+    UpdateBlockCache* cache = &player->update_cache;
+    
+    /* Slot index = position of the single set bit (0-7) */
+    u32 slot = 0;
+    while (slot < 8 && !(bit & (1u << slot))) slot++;
+    if (slot >= 8) return;
+    
+    if (cache->valid & bit) {
+        if (block) buffer_write_bytes(block, cache->data + cache->offset[slot], cache->length[slot]);
+        return;
+    }
+    
+    BUFFER_ON_STACK(scratch, 128);
+    StreamBuffer* segment = &scratch;
+    if (bit == PLAYER_MASK_APPEARANCE) {
+        /* Persistent blob: only re-encoded after player_appearance_changed() */
+        refresh_appearance_blob(player);
+        buffer_write_byte(segment, player->appearance_length);
+        buffer_write_bytes(segment, player->appearance, player->appearance_length);
+    } else if (bit == PLAYER_MASK_HIT) {
+        buffer_write_byte(segment, player->hit_damage);
+        buffer_write_byte(segment, player->hit_type);
+        buffer_write_byte(segment, player->levels[SKILL_HITPOINTS]);
+        buffer_write_byte(segment, player_base_level(player, SKILL_HITPOINTS));
+    } else if (bit == PLAYER_MASK_CHAT) {
+        /* Packed text exactly as the sender's client produced it (chat.c) */
+        const ChatMessage* chat = chat_get(player);
+        buffer_write_short(segment, (u16)(chat->color << 8 | chat->effect), BYTE_ORDER_BIG);
+        buffer_write_byte(segment, 0);  /* Rights: 0 = player (no crown) */
+        buffer_write_byte(segment, chat->length);
+        buffer_write_bytes(segment, chat->packed, chat->length);
+    }
+    
+    if (cache->used + segment->position <= UPDATE_BLOCK_CACHE_SIZE) {
+        memcpy(cache->data + cache->used, segment->data, segment->position);
+        cache->offset[slot] = cache->used;
+        cache->length[slot] = (u16)segment->position;
+        cache->used += (u16)segment->position;
+        cache->valid |= bit;
+    }
+    
+    if (block) buffer_write_bytes(block, segment->data, segment->position);
+    buffer_release(segment);
+}
+
+/*
+ * update_prepare_blocks - Encode a player's shared segments ahead of time
+ *
+ * @param player  Subject that viewers may add or update this tick
+ *
+ * append_cached_segment() normally fills the cache lazily, on the first
+ * viewer that needs a segment - a write to a player other than that
+ * viewer. Before viewers are encoded in parallel, the game thread calls
+ * this once per active player so the appearance blob and its cache slab
+ * are already filled and every viewer only reads them.
+ *
+ * The appearance segment is encoded unconditionally because any viewer
+ * adding this player needs it, whatever update_flags says; the hit and
+ * chat segments only when the player was hit or spoke this tick.
+ *
+ * COMPLEXITY: O(1) for a clean player already cached this tick
+ */
+void update_prepare_blocks(Player* player) {
+    if (!player) return;
+    append_cached_segment(player, NULL, PLAYER_MASK_APPEARANCE);
+    if (player->update_flags & UPDATE_HIT) {
+        append_cached_segment(player, NULL, PLAYER_MASK_HIT);
+    }
+    if (player->update_flags & UPDATE_CHAT) {
+        append_cached_segment(player, NULL, PLAYER_MASK_CHAT);
+    }
+}
+
+/*
+ * update_invalidate_block_cache - Drop this tick's encoded mask segments
+ * 
+ * @param player  Player whose cache to reset
+ * 
+ * Called together with update_flags = 0 so next tick's blocks are encoded
+ * from the player's new state. Only resets bookkeeping, no memset needed.
+ * 
+ * COMPLEXITY: O(1) time
+ */
+void update_invalidate_block_cache(Player* player) {
+    if (!player) return;
+    player->update_cache.valid = 0;
+    player->update_cache.used = 0;
 }
 
 /*******************************************************************************
@@ -1847,13 +2243,11 @@ static void append_stand(StreamBuffer* out) {
  * APPEARANCE CACHING OPTIMIZATION:
  * 
  *   Client caches appearance by player index.
- *   If appearance_hash unchanged, server can skip sending appearance.
- *   
- *   appearance_hash calculation (simple hash):
- *     hash = gender ^ (body[0]<<1) ^ (body[1]<<2) ^ ... ^ combat_level
- * 
- *   PlayerTracking has appearance_hashes[] array (not currently used).
- *   Future optimization: Track hash, only send when changed.
+ *   Instead of hashing the fields, each player carries appearance_version,
+ *   bumped by player_appearance_changed(). PlayerTracking.appearance_hashes[pid]
+ *   holds the version this viewer last received; update_other_players()
+ *   re-adds a player without this block when the two match (and the
+ *   version is nonzero), and stores the version whenever the block is sent.
  */
 static void append_appearance(Player* player, StreamBuffer* out) {
     u32 start_pos = out->position;
@@ -1924,11 +2318,11 @@ static void append_appearance(Player* player, StreamBuffer* out) {
         player->body[1]   /* Slot 11: Body part - Jaw/beard */
     };
     
-    printf("[APPEARANCE] %s: gender=%d body=[%d,%d,%d,%d,%d,%d,%d] colors=[%d,%d,%d,%d,%d]\n",
-           player->username, player->gender,
-           player->body[0], player->body[1], player->body[2], player->body[3],
-           player->body[4], player->body[5], player->body[6],
-           player->colors[0], player->colors[1], player->colors[2], player->colors[3], player->colors[4]);
+    LOG_TRACE(LOG_UPDATE, "[APPEARANCE] %s: gender=%d body=[%d,%d,%d,%d,%d,%d,%d] colors=[%d,%d,%d,%d,%d]\n",
+                          player->username, player->gender,
+                          player->body[0], player->body[1], player->body[2], player->body[3],
+                          player->body[4], player->body[5], player->body[6],
+                          player->colors[0], player->colors[1], player->colors[2], player->colors[3], player->colors[4]);
     
     /*
      * Encode each of 12 body slots:
@@ -2135,7 +2529,7 @@ static void append_appearance(Player* player, StreamBuffer* out) {
  *     3 / 37⁰    = 3 remainder 0  → 'c'
  *     Result: "abc"
  */
-static u64 username_to_base37(const char* username) {
+u64 username_to_base37(const char* username) {
     u64 value = 0;
     
     /*
@@ -5,15 +5,45 @@
 #include "player.h"
 #include "player_list.h"
 #include "buffer.h"
+#include "zone_grid.h"
 
 struct GameServer;
 
+/*
+ * g_player_info_budget - Most payload bytes in one viewer's PLAYER_INFO
+ *
+ * The movement bits and the viewer's own block are always sent; other
+ * players' blocks are granted by priority (hits and chat before
+ * appearances and adds, nearest first) until the budget is spent. A
+ * deferred appearance or add goes out on a later tick; a hit or chat
+ * line that does not fit is dropped (it only exists for this tick).
+ * Defaults to MAX_PACKET_SIZE, the client's packet buffer
+ * (--player-info-budget).
+ */
+extern u32 g_player_info_budget;
+
 void update_players(struct GameServer* server);
 
 /* Minimal per-tick empty player-info (keeps client in sync pre-placement). */
 void send_player_info_empty(Player* player);
 
-/* Full "player info" frame used each tick after first-second settling. */
-void update_player(Player* player, Player* all_players[], u32 player_count, PlayerTracking* tracking);
+/* Full "player info" frame used each tick after first-second settling.
+ * Tracked PIDs resolve directly through list; new locals come from zones. */
+void update_player(Player* player, PlayerTracking* tracking, PlayerList* list, const ZoneGrid* zones);
+
+/* update_player() without the commit: encodes into player's out arena using the
+ * caller's block scratch. Safe to run for different viewers on different
+ * threads once update_prepare_blocks() has run for every active player. */
+bool update_player_encode(Player* player, PlayerTracking* tracking, PlayerList* list,
+                          const ZoneGrid* zones, StreamBuffer* block);
+
+/* Fill player's shared update-block cache so viewers only read it. */
+void update_prepare_blocks(Player* player);
+
+/* Reset the per-tick shared update-block cache (call when update_flags clears). */
+void update_invalidate_block_cache(Player* player);
+
+/* Username as the client's base-37 long (letters and digits; see update.c). */
+u64 username_to_base37(const char* username);
 
 #endif /* UPDATE_H */
\ No newline at end of file
@@ -0,0 +1,271 @@
+/*******************************************************************************
+ * UPDATE_POOL.C - Parallel PLAYER_INFO Encoding Implementation
+ *******************************************************************************
+ *
+ * See update_pool.h for the design.
+ *
+ * ONE TICK:
+ *
+ *   game thread                         worker k
+ *   ───────────                         ────────
+ *   store job, next = 0                 lock
+ *   lock                                wait until generation != seen
+ *   generation++, pending = N-1         unlock
+ *   broadcast wake ──────────────────→  drain chunks
+ *   unlock                              lock
+ *   drain chunks (as workers[0])        pending-- → 0? signal done
+ *   lock                                (back to waiting)
+ *   wait until pending == 0  ←────────
+ *   unlock
+ *
+ * The mutex hand-off on both sides orders the job fields before the
+ * workers read them and every worker's writes before the caller commits.
+ *
+ ******************************************************************************/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include "update_pool.h"
+#include "update.h"
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+UpdatePool* g_update_pool = NULL;
+
+#ifndef _WIN32
+
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+
+#define POOL_MUTEX(p)  ((pthread_mutex_t*)(p)->mutex)
+#define POOL_WAKE(p)   ((pthread_cond_t*)(p)->wake)
+#define POOL_DONE(p)   ((pthread_cond_t*)(p)->done)
+
+/*
+ * update_pool_drain - Claim chunks of viewers until none are left
+ */
+static void update_pool_drain(UpdatePool* pool, UpdateWorker* worker) {
+    for (;;) {
+        u32 start = __atomic_fetch_add(&pool->next, UPDATE_POOL_CHUNK, __ATOMIC_RELAXED);
+        if (start >= pool->viewer_count) break;
+        u32 end = start + UPDATE_POOL_CHUNK;
+        if (end > pool->viewer_count) end = pool->viewer_count;
+
+        for (u32 i = start; i < end; i++) {
+            Player* viewer = pool->viewers[i];
+            u64 trace_start = trace_begin();
+            update_player_encode(viewer, pool->tracking[viewer->index],
+                                 pool->list, pool->zones, &worker->block);
+            trace_end(trace_start, "update_player", viewer->index);
+            if (pool->npc_tracking) {
+                npc_update_encode(viewer, &pool->npc_tracking[viewer->index],
+                                  pool->npcs, &worker->block);
+            }
+        }
+        worker->viewers += end - start;
+    }
+}
+
+static void* update_pool_thread_main(void* arg) {
+    UpdateWorker* worker = (UpdateWorker*)arg;
+    UpdatePool* pool = worker->pool;
+    u32 seen = 0;
+    trace_thread_name("update");
+
+    pthread_mutex_lock(POOL_MUTEX(pool));
+    for (;;) {
+        while (pool->generation == seen && pool->running) {
+            pthread_cond_wait(POOL_WAKE(pool), POOL_MUTEX(pool));
+        }
+        if (!pool->running) break;
+        seen = pool->generation;
+        pthread_mutex_unlock(POOL_MUTEX(pool));
+
+        update_pool_drain(pool, worker);
+
+        pthread_mutex_lock(POOL_MUTEX(pool));
+        if (--pool->pending == 0) pthread_cond_signal(POOL_DONE(pool));
+    }
+    pthread_mutex_unlock(POOL_MUTEX(pool));
+    return NULL;
+}
+
+/*
+ * update_pool_free - Release everything update_pool_start() allocated
+ */
+static void update_pool_free(UpdatePool* pool) {
+    if (pool->workers) {
+        for (u32 i = 0; i < pool->worker_count; i++) {
+            buffer_release(&pool->workers[i].block);
+            free(pool->workers[i].thread);
+        }
+        free(pool->workers);
+    }
+    if (pool->mutex) pthread_mutex_destroy(POOL_MUTEX(pool));
+    if (pool->wake) pthread_cond_destroy(POOL_WAKE(pool));
+    if (pool->done) pthread_cond_destroy(POOL_DONE(pool));
+    free(pool->mutex);
+    free(pool->wake);
+    free(pool->done);
+    memset(pool, 0, sizeof(UpdatePool));
+}
+
+bool update_pool_start(UpdatePool* pool, u32 threads) {
+    if (!pool) return false;
+    memset(pool, 0, sizeof(UpdatePool));
+
+    /* More threads than cores only adds switching */
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus > 0 && threads > (u32)cpus) threads = (u32)cpus;
+    if (threads > UPDATE_POOL_MAX_THREADS) threads = UPDATE_POOL_MAX_THREADS;
+    if (threads < 2) {
+        fprintf(stderr, "WARNING: Update pool needs 2+ threads, player updates stay serial\n");
+        return false;
+    }
+
+    pool->workers = (UpdateWorker*)calloc(threads, sizeof(UpdateWorker));
+    pthread_mutex_t* mutex = (pthread_mutex_t*)malloc(sizeof(pthread_mutex_t));
+    pthread_cond_t* wake = (pthread_cond_t*)malloc(sizeof(pthread_cond_t));
+    pthread_cond_t* done = (pthread_cond_t*)malloc(sizeof(pthread_cond_t));
+
+    bool ok = pool->workers && mutex && wake && done;
+    if (ok && pthread_mutex_init(mutex, NULL) == 0) {
+        pool->mutex = mutex;
+    } else {
+        free(mutex);
+        ok = false;
+    }
+    if (ok && pthread_cond_init(wake, NULL) == 0) {
+        pool->wake = wake;
+    } else {
+        free(wake);
+        ok = false;
+    }
+    if (ok && pthread_cond_init(done, NULL) == 0) {
+        pool->done = done;
+    } else {
+        free(done);
+        ok = false;
+    }
+    if (!ok) {
+        update_pool_free(pool);
+        fprintf(stderr, "WARNING: Update pool not started, player updates stay serial\n");
+        return false;
+    }
+
+    for (u32 i = 0; i < threads; i++) {
+        UpdateWorker* worker = &pool->workers[i];
+        buffer_init_external(&worker->block, worker->storage, sizeof(worker->storage));
+        worker->pool = pool;
+    }
+    pool->worker_count = 1;         /* workers[0] is the caller */
+    pool->running = true;
+
+    /* Signals stay on the game thread, as for the network thread */
+    sigset_t all, previous;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &previous);
+    for (u32 i = 1; i < threads; i++) {
+        UpdateWorker* worker = &pool->workers[i];
+        pthread_t* thread = (pthread_t*)malloc(sizeof(pthread_t));
+        if (!thread || pthread_create(thread, NULL, update_pool_thread_main, worker) != 0) {
+            free(thread);
+            break;
+        }
+        worker->thread = thread;
+        pool->worker_count++;
+    }
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+    if (pool->worker_count < 2) {
+        pool->running = false;
+        update_pool_free(pool);
+        fprintf(stderr, "WARNING: Update workers not started, player updates stay serial\n");
+        return false;
+    }
+
+    g_update_pool = pool;
+    printf("Update pool started (%u threads, %u viewers per chunk)\n",
+           pool->worker_count, UPDATE_POOL_CHUNK);
+    return true;
+}
+
+void update_pool_stop(UpdatePool* pool) {
+    if (!pool || !pool->running) return;  /* Never started, or already stopped */
+    if (g_update_pool == pool) g_update_pool = NULL;
+
+    pthread_mutex_lock(POOL_MUTEX(pool));
+    pool->running = false;
+    pthread_cond_broadcast(POOL_WAKE(pool));
+    pthread_mutex_unlock(POOL_MUTEX(pool));
+
+    for (u32 i = 1; i < pool->worker_count; i++) {
+        pthread_join(*(pthread_t*)pool->workers[i].thread, NULL);
+    }
+
+    /* Share of the work done by the caller vs. the workers */
+    u64 total = 0;
+    for (u32 i = 0; i < pool->worker_count; i++) total += pool->workers[i].viewers;
+    printf("Update pool stopped (%llu viewers encoded, %llu on the game thread)\n",
+           (unsigned long long)total, (unsigned long long)pool->workers[0].viewers);
+    update_pool_free(pool);
+}
+
+void update_pool_run(UpdatePool* pool, Player** viewers, u32 count,
+                     PlayerTracking* const* tracking, PlayerList* list, const ZoneGrid* zones,
+                     NpcTracking* npc_tracking, const NpcSystem* npcs) {
+    if (!pool || !pool->running || count == 0) return;
+
+    pool->viewers = viewers;
+    pool->viewer_count = count;
+    pool->tracking = tracking;
+    pool->list = list;
+    pool->zones = zones;
+    pool->npc_tracking = npcs ? npc_tracking : NULL;
+    pool->npcs = npcs;
+    pool->next = 0;
+
+    /* Too few viewers to be worth waking anyone */
+    if (count <= UPDATE_POOL_CHUNK) {
+        update_pool_drain(pool, &pool->workers[0]);
+        return;
+    }
+
+    pthread_mutex_lock(POOL_MUTEX(pool));
+    pool->generation++;
+    pool->pending = pool->worker_count - 1;
+    pthread_cond_broadcast(POOL_WAKE(pool));
+    pthread_mutex_unlock(POOL_MUTEX(pool));
+
+    update_pool_drain(pool, &pool->workers[0]);
+
+    pthread_mutex_lock(POOL_MUTEX(pool));
+    while (pool->pending > 0) {
+        pthread_cond_wait(POOL_DONE(pool), POOL_MUTEX(pool));
+    }
+    pthread_mutex_unlock(POOL_MUTEX(pool));
+}
+
+#else /* _WIN32 */
+
+/*
+ * Windows: no workers (pthreads unavailable with MSVC). g_update_pool
+ * stays NULL and world_process() encodes viewers serially.
+ */
+bool update_pool_start(UpdatePool* pool, u32 threads) {
+    (void)pool; (void)threads;
+    fprintf(stderr, "WARNING: Update pool not supported on this platform, player updates stay serial\n");
+    return false;
+}
+void update_pool_stop(UpdatePool* pool) { (void)pool; }
+void update_pool_run(UpdatePool* pool, Player** viewers, u32 count,
+                     PlayerTracking* const* tracking, PlayerList* list, const ZoneGrid* zones,
+                     NpcTracking* npc_tracking, const NpcSystem* npcs) {
+    (void)pool; (void)viewers; (void)count; (void)tracking; (void)list; (void)zones;
+    (void)npc_tracking; (void)npcs;
+}
+
+#endif /* _WIN32 */
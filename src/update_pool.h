@@ -0,0 +1,170 @@
+/*******************************************************************************
+ * UPDATE_POOL.H - Parallel PLAYER_INFO Encoding
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Data parallelism over independent outputs (one packet per viewer)
+ *   - Dynamic load balancing with a shared atomic counter
+ *   - Persistent worker threads woken once per tick
+ *   - Turning shared lazy writes into a serial prepare pass
+ *
+ * THE PROBLEM:
+ *
+ * Phase 2 of world_process() builds one PLAYER_INFO packet per online
+ * player, on the game thread, one after another. The cost grows with
+ * players x visible players, so a crowded world spends most of its tick
+ * here while every other core sits idle:
+ *
+ *   tick: |movement|viewer 0|viewer 1|viewer 2| ... |viewer 1999|cleanup|
+ *
+ * THE SOLUTION - ENCODE VIEWERS IN PARALLEL:
+ *
+ * Each viewer's packet depends on the world state (read-only during phase
+ * 2) and writes only that viewer's out arena, out cipher and tracking
+ * entry. Viewers can therefore be split across threads:
+ *
+ *   GAME THREAD                       WORKERS 1..N-1
+ *   update_prepare_blocks(every P)
+ *   npc_update_prepare()
+ *   update_pool_run() ──── wake ───→  claim chunk: next += CHUNK
+ *     claims chunks as worker 0        update_player_encode(viewers...)
+ *                                      npc_update_encode(viewers...)
+ *     waits for pending == 0   ←────  no chunks left: pending--
+ *   player_out_commit(every P)
+ *
+ * WHAT IS SHARED, AND WHY IT IS SAFE:
+ *   - Other players (positions, flags, appearance): read-only. The only
+ *     lazy writes in the encoder - the appearance blob and the per-tick
+ *     block cache - are filled beforehand by update_prepare_blocks().
+ *   - Update block scratch: update.c's single file-scope buffer is
+ *     replaced by one buffer per worker (a thread-local arena that keeps
+ *     its heap growth across ticks).
+ *   - ISAAC: ciphers live in each viewer's PlayerConnection, so a viewer's
+ *     opcode keystream is consumed by exactly one thread.
+ *   - Sending: player_out_commit() can flush into netio, whose request ring
+ *     has a single producer. Commits stay on the game thread after the
+ *     workers have finished.
+ *
+ * LOAD BALANCING:
+ *   Viewers in a crowd cost far more than viewers alone in a field, so a
+ *   static split (thread t gets viewers [t*n/N, (t+1)*n/N)) leaves threads
+ *   waiting on the unlucky one. Instead workers claim UPDATE_POOL_CHUNK
+ *   viewers at a time from a shared counter, as cache_warm() does for
+ *   archives: a thread that finishes early simply takes the next chunk.
+ *
+ * PLATFORM:
+ *   POSIX threads. On Windows update_pool_start() fails, g_update_pool
+ *   stays NULL and world_process() encodes viewers serially as before.
+ *
+ ******************************************************************************/
+
+#ifndef UPDATE_POOL_H
+#define UPDATE_POOL_H
+
+#include "types.h"
+#include "buffer.h"
+#include "player.h"
+#include "player_list.h"
+#include "zone_grid.h"
+#include "npc_update.h"
+#include <stdbool.h>
+
+/* Upper bound on threads, including the game thread */
+#define UPDATE_POOL_MAX_THREADS 32
+
+/* Viewers claimed per fetch_add; small enough to balance, large enough
+ * that the shared counter is not touched per viewer */
+#define UPDATE_POOL_CHUNK 8
+
+/* Initial update block scratch per worker (grows onto the heap if needed) */
+#define UPDATE_POOL_SCRATCH_SIZE 2048
+
+/*
+ * UpdateWorker - One thread's private state
+ *
+ * workers[0] belongs to the thread calling update_pool_run().
+ */
+typedef struct {
+    u8 storage[UPDATE_POOL_SCRATCH_SIZE];
+    StreamBuffer block;         /* Update block scratch over storage */
+    u64 viewers;                /* Viewers this worker has encoded */
+    void* thread;               /* pthread_t (NULL for workers[0]) */
+    struct UpdatePool* pool;
+} UpdateWorker;
+
+/*
+ * UpdatePool - Fixed set of workers plus the job of the current tick
+ *
+ * The job fields (viewers ... zones) are written by update_pool_run()
+ * before workers are woken and only read while they run. next is the
+ * shared work counter; generation and pending are protected by the mutex.
+ */
+typedef struct UpdatePool {
+    UpdateWorker* workers;
+    u32 worker_count;           /* Threads including the caller */
+
+    Player** viewers;           /* Current job */
+    u32 viewer_count;
+    PlayerTracking* const* tracking;
+    PlayerList* list;
+    const ZoneGrid* zones;
+    NpcTracking* npc_tracking;  /* NULL: no NPC_INFO this tick */
+    const NpcSystem* npcs;
+    u32 next;                   /* Next unclaimed viewer (atomic) */
+
+    u32 generation;             /* Bumped once per update_pool_run() */
+    u32 pending;                /* Workers still on this generation */
+    bool running;
+    void* mutex;                /* pthread_mutex_t (opaque, as in netio.h) */
+    void* wake;                 /* pthread_cond_t: new generation / stop */
+    void* done;                 /* pthread_cond_t: pending reached zero */
+} UpdatePool;
+
+/*
+ * g_update_pool - Running pool, or NULL (viewers are encoded serially)
+ */
+extern UpdatePool* g_update_pool;
+
+/*
+ * update_pool_start - Start threads - 1 workers
+ *
+ * @param pool     Zeroed UpdatePool to initialize
+ * @param threads  Total threads including the caller (2 or more, capped
+ *                 at UPDATE_POOL_MAX_THREADS and the online CPU count)
+ * @return         true on success; sets g_update_pool
+ */
+bool update_pool_start(UpdatePool* pool, u32 threads);
+
+/*
+ * update_pool_stop - Stop and join the workers
+ *
+ * Safe to call more than once. Clears g_update_pool.
+ */
+void update_pool_stop(UpdatePool* pool);
+
+/*
+ * update_pool_run - Encode PLAYER_INFO for every viewer, in parallel
+ *
+ * @param pool      Running pool
+ * @param viewers   Viewers to encode (the dense active list)
+ * @param count     Entries in viewers
+ * @param tracking  World tracking pointers, indexed by PID
+ * @param list      World player list
+ * @param zones     World zone grid
+ * @param npc_tracking  World NPC tracking array (NULL: skip NPC_INFO)
+ * @param npcs      NPC system
+ *
+ * Calls update_player_encode() and then npc_update_encode() for each
+ * viewer and returns once all are done. The caller must have run
+ * update_prepare_blocks() on every player a viewer may see and
+ * npc_update_prepare() on the NPCs, and commits the packets
+ * (player_out_commit) itself.
+ *
+ * COMPLEXITY: O(total encode work / threads) plus one wake-up per worker
+ */
+void update_pool_run(UpdatePool* pool, Player** viewers, u32 count,
+                     PlayerTracking* const* tracking, PlayerList* list, const ZoneGrid* zones,
+                     NpcTracking* npc_tracking, const NpcSystem* npcs);
+
+#endif /* UPDATE_POOL_H */
@@ -0,0 +1,264 @@
+/*******************************************************************************
+ * WANDER.C - Wander Set Fill and Walks
+ *******************************************************************************
+ *
+ * See wander.h for the set layout and the path through the BFS tree.
+ *
+ * A set's arrays are sized by its radius, not by what the fill reached:
+ * parent[] and depth[] are side² each (radius 5: 121 tiles, under 1KB
+ * with tiles[]), and a refill reuses them.
+ *
+ ******************************************************************************/
+
+#include "wander.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * The pathfinder's eight moves, in its order, with the masks that must be
+ * clear on the destination tile and, for diagonals, on the two tiles
+ * beside it (pathfinder.c)
+ */
+static const struct {
+    i8 dx;
+    i8 dz;
+    u16 mask;
+    u16 side_x;
+    u16 side_z;
+} WANDER_STEPS[8] = {
+    { -1,  0, STEP_BLOCK_WEST,       0,               0                },
+    {  1,  0, STEP_BLOCK_EAST,       0,               0                },
+    {  0, -1, STEP_BLOCK_SOUTH,      0,               0                },
+    {  0,  1, STEP_BLOCK_NORTH,      0,               0                },
+    { -1, -1, STEP_BLOCK_SOUTH_WEST, STEP_BLOCK_WEST, STEP_BLOCK_SOUTH },
+    {  1, -1, STEP_BLOCK_SOUTH_EAST, STEP_BLOCK_EAST, STEP_BLOCK_SOUTH },
+    { -1,  1, STEP_BLOCK_NORTH_WEST, STEP_BLOCK_WEST, STEP_BLOCK_NORTH },
+    {  1,  1, STEP_BLOCK_NORTH_EAST, STEP_BLOCK_EAST, STEP_BLOCK_NORTH },
+};
+
+static inline i64 wander_key(u32 spawn, u32 radius) {
+    return (i64)((u64)spawn | (u64)radius << 32);
+}
+
+WanderTable* wander_table_create(void) {
+    WanderTable* table = (WanderTable*)calloc(1, sizeof(WanderTable));
+    if (!table) return NULL;
+
+    table->index = probetable_new(256);
+    if (!table->index) {
+        free(table);
+        return NULL;
+    }
+    return table;
+}
+
+static void wander_set_free(WanderSet* set) {
+    free(set->tiles);
+    free(set->parent);
+    free(set->depth);
+    free(set);
+}
+
+void wander_table_destroy(WanderTable* table) {
+    if (!table) return;
+    if (table->walks > 0) {
+        printf("Wander: %u sets, %llu fills, %llu walks\n", table->set_count,
+               (unsigned long long)table->fills, (unsigned long long)table->walks);
+    }
+
+    WanderSet* set = table->sets;
+    while (set) {
+        WanderSet* next = set->next;
+        wander_set_free(set);
+        set = next;
+    }
+    probetable_free(table->index);
+    free(table->path);
+    free(table);
+}
+
+/*
+ * wander_fill - BFS from the spawn over the window, into set
+ *
+ * Steps leaving the window are not taken. A spawn on an unmapped region
+ * leaves the set empty.
+ */
+static void wander_fill(WanderTable* table, WanderSet* set, const WorldCollision* collision) {
+    const Position spawn = { .packed = set->spawn };
+    const u32 side = set->side;
+    const u32 level = position_height(&spawn);
+    const i32 origin_x = (i32)position_x(&spawn) - set->radius;
+    const i32 origin_z = (i32)position_z(&spawn) - set->radius;
+
+    memset(set->parent, 0xFF, side * side * sizeof(u16));
+    set->collision = collision;
+    set->revision = collision->revision;
+    set->count = 0;
+    table->fills++;
+
+    if (!world_collision_mapped(collision, level, (i32)position_x(&spawn), (i32)position_z(&spawn))) {
+        return;
+    }
+
+    /* tiles[] is the queue: each tile enters once, in BFS order */
+    u16 start = (u16)(set->radius * side + set->radius);
+    set->parent[start] = start;
+    set->depth[start] = 0;
+    set->tiles[set->count++] = start;
+
+    for (u32 head = 0; head < set->count; head++) {
+        u16 tile = set->tiles[head];
+        i32 x = (i32)(tile / side);
+        i32 z = (i32)(tile % side);
+
+        for (u32 i = 0; i < 8; i++) {
+            i32 nx = x + WANDER_STEPS[i].dx;
+            i32 nz = z + WANDER_STEPS[i].dz;
+            if (nx < 0 || nz < 0 || nx >= (i32)side || nz >= (i32)side) continue;
+            if (origin_x + nx < 0 || origin_z + nz < 0) continue;
+
+            u16 n = (u16)((u32)nx * side + (u32)nz);
+            if (set->parent[n] != WANDER_UNREACHED) continue;
+            if (world_collision_flags(collision, level, origin_x + nx, origin_z + nz) &
+                WANDER_STEPS[i].mask) continue;
+            if (WANDER_STEPS[i].side_x &&
+                ((world_collision_flags(collision, level, origin_x + nx, origin_z + z) &
+                  WANDER_STEPS[i].side_x) ||
+                 (world_collision_flags(collision, level, origin_x + x, origin_z + nz) &
+                  WANDER_STEPS[i].side_z))) continue;
+
+            set->parent[n] = tile;
+            set->depth[n] = (u16)(set->depth[tile] + 1);
+            set->tiles[set->count++] = n;
+        }
+    }
+}
+
+WanderSet* wander_set_get(WanderTable* table, const WorldCollision* collision,
+                          const Position* spawn, u32 radius) {
+    if (!table || !collision || !spawn || radius == 0 || radius > WANDER_RADIUS_MAX) return NULL;
+
+    i64 key = wander_key(spawn->packed, radius);
+    WanderSet* set = (WanderSet*)probetable_get(table->index, key);
+    if (set) {
+        if (set->collision != collision || set->revision != collision->revision) {
+            wander_fill(table, set, collision);
+        }
+        return set;
+    }
+
+    u32 side = radius * 2 + 1;
+    set = (WanderSet*)calloc(1, sizeof(WanderSet));
+    if (!set) return NULL;
+    set->spawn = spawn->packed;
+    set->radius = (u16)radius;
+    set->side = (u16)side;
+    set->tiles = (u16*)malloc(side * side * sizeof(u16));
+    set->parent = (u16*)malloc(side * side * sizeof(u16));
+    set->depth = (u16*)malloc(side * side * sizeof(u16));
+
+    /* A walk is at most two climbs of the deepest tile */
+    bool grown = true;
+    if (table->path_capacity < 2 * side * side) {
+        u16* path = (u16*)realloc(table->path, 2 * side * side * sizeof(u16));
+        if (path) {
+            table->path = path;
+            table->path_capacity = 2 * side * side;
+        } else {
+            grown = false;
+        }
+    }
+
+    if (!set->tiles || !set->parent || !set->depth || !grown ||
+        !probetable_put(table->index, key, set)) {
+        wander_set_free(set);
+        return NULL;
+    }
+    set->next = table->sets;
+    table->sets = set;
+    table->set_count++;
+
+    wander_fill(table, set, collision);
+    return set;
+}
+
+bool wander_walk(WanderTable* table, const WorldCollision* collision, const Position* spawn,
+                 u32 radius, const Position* position, MovementHandler* movement) {
+    if (!collision || !position || !movement) return false;
+
+    WanderSet* set = wander_set_get(table, collision, spawn, radius);
+    if (!set || set->count == 0) return false;
+
+    /* Where the NPC stands, in the window */
+    const u32 side = set->side;
+    i32 origin_x = (i32)position_x(spawn) - set->radius;
+    i32 origin_z = (i32)position_z(spawn) - set->radius;
+    i32 x = (i32)position_x(position) - origin_x;
+    i32 z = (i32)position_z(position) - origin_z;
+    if (!position_same_height(position, spawn) ||
+        x < 0 || z < 0 || x >= (i32)side || z >= (i32)side) {
+        return false;
+    }
+    u16 from = (u16)((u32)x * side + (u32)z);
+    if (set->parent[from] == WANDER_UNREACHED) return false;
+
+    u16 to = set->tiles[(u32)rand() % set->count];
+    if (to == from) return true;
+
+    /* Lowest common ancestor: lift the deeper end, then both together */
+    u16 a = from;
+    u16 b = to;
+    while (set->depth[a] > set->depth[b]) a = set->parent[a];
+    while (set->depth[b] > set->depth[a]) b = set->parent[b];
+    while (a != b) {
+        a = set->parent[a];
+        b = set->parent[b];
+    }
+    u32 up = set->depth[from] - set->depth[a];
+    u32 down = set->depth[to] - set->depth[a];
+
+    /* Tiles after from: its parents up to the ancestor, then the target's
+     * parents below it in reverse */
+    u16* path = table->path;
+    u16 tile = from;
+    for (u32 i = 0; i < up; i++) {
+        tile = set->parent[tile];
+        path[i] = tile;
+    }
+    tile = to;
+    for (u32 i = 0; i < down; i++) {
+        path[up + down - 1 - i] = tile;
+        tile = set->parent[tile];
+    }
+
+    /* Waypoints: the tiles where the direction changes, and the last */
+    u32 wx[MAX_WAYPOINTS];
+    u32 wz[MAX_WAYPOINTS];
+    u32 count = 0;
+    u32 length = up + down;
+    i32 last_dx = 0;
+    i32 last_dz = 0;
+    u16 prev = from;
+    for (u32 i = 0; i < length && count < MAX_WAYPOINTS; i++) {
+        i32 dx = (i32)(path[i] / side) - (i32)(prev / side);
+        i32 dz = (i32)(path[i] % side) - (i32)(prev % side);
+        if (i > 0 && (dx != last_dx || dz != last_dz)) {
+            wx[count] = (u32)(origin_x + (i32)(prev / side));
+            wz[count] = (u32)(origin_z + (i32)(prev % side));
+            count++;
+        }
+        last_dx = dx;
+        last_dz = dz;
+        prev = path[i];
+    }
+    if (count < MAX_WAYPOINTS) {
+        wx[count] = (u32)(origin_x + (i32)(prev / side));
+        wz[count] = (u32)(origin_z + (i32)(prev % side));
+        count++;
+    }
+
+    movement_add_path(movement, wx, wz, count);
+    table->walks++;
+    return true;
+}
@@ -0,0 +1,175 @@
+/*******************************************************************************
+ * WANDER.H - Reachable Tiles Around a Spawn, Filled Once and Shared
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Precomputation: one flood fill instead of a search per query
+ *   - Sharing derived data between instances with the same inputs
+ *   - Shortest-path trees (BFS parents) and the lowest common ancestor
+ *   - Lazy invalidation with a revision counter
+ *
+ * THE PROBLEM:
+ *
+ * An NPC with a walk radius picks a random tile near its spawn every few
+ * seconds and walks there. Done naively, each walk is a guess and a
+ * pathfinder search:
+ *
+ *   wander ──→ random (x, z) in the square ──→ BFS over 128x128 window
+ *                  │                               │
+ *                  └── a wall, a tree, a river ────┴──→ unreachable:
+ *                      search ran to exhaustion for nothing
+ *
+ * Hundreds of awake NPCs wander, the spawn never moves, the walls rarely
+ * do, and twenty goblins spawned on the same tile ask the same question.
+ *
+ * THE SOLUTION - FLOOD FILL THE SQUARE ONCE PER (SPAWN, RADIUS):
+ *
+ *   radius 2 around S            window (side 2r+1)     tiles (BFS order)
+ *   ┌───┬───┬───┬───┬───┐
+ *   │ . │ . │ # │ . │ . │        parent[i]: the tile    [S, a, b, c, ...]
+ *   ├───┼───┼───┼───┼───┤        the fill reached i      │
+ *   │ . │ a │ # │ x │ x │        from (S is its own)     └─ wander target =
+ *   ├───┼───┼───┼───┼───┤        depth[i]: steps from S     tiles[rand % count]
+ *   │ . │ b │ S │ # │ x │
+ *   ├───┼───┼───┼───┼───┤        # blocked, x walled off: never in tiles[],
+ *   │ . │ . │ c │ # │ x │          so every target is reachable
+ *   └───┴───┴───┴───┴───┘
+ *
+ *   The fill steps like the pathfinder (same eight moves, same collision
+ *   masks) but stays inside the square, so "reachable" means reachable
+ *   without leaving the wander area.
+ *
+ * THE PATH - UP THE TREE AND DOWN AGAIN:
+ *   The parents form a shortest-path tree rooted at the spawn. An NPC
+ *   standing on a tile of the set reaches any other tile of it by
+ *   climbing its parents to the lowest common ancestor and descending
+ *   the target's:
+ *
+ *              S                 from A to B:
+ *             / \                  A → p → q   (climb to q)
+ *            q   r                 q → t → B   (target's parents, reversed)
+ *           / \
+ *          p   t                 Not always the shortest path between A
+ *          |   |                 and B, but a valid one, found in
+ *          A   B                 depth(A) + depth(B) parent reads
+ *
+ *   The tiles where the direction changes become waypoints, as the
+ *   pathfinder's trace does. No search runs on a wander.
+ *
+ * SHARING AND STALENESS:
+ *   Sets are keyed by (spawn tile, radius) in a ProbeTable, so every NPC
+ *   spawned with the same parameters walks the same set. Each set
+ *   remembers the collision (and its revision) it was filled from; a door
+ *   opening, an instance region released or a reload refills it on its
+ *   next use.
+ *
+ * WHEN THE SET DOES NOT APPLY:
+ *   No collision loaded, a spawn on an unmapped region, a radius past
+ *   WANDER_RADIUS_MAX, or an NPC not standing on a tile of its set (a
+ *   chase left it outside): wander_walk() returns false and the caller
+ *   falls back to the pathfinder, which walks it back in.
+ *
+ * THREAD SAFETY:
+ *   Game thread only (NPC timers).
+ *
+ ******************************************************************************/
+
+#ifndef WANDER_H
+#define WANDER_H
+
+#include "types.h"
+#include "position.h"
+#include "movement.h"
+#include "world_collision.h"
+#include "datastruct/probetable.h"
+#include <stdbool.h>
+
+/* Largest radius with a set: the window index must fit in a u16 */
+#define WANDER_RADIUS_MAX 63
+
+/* parent[] of a tile the fill did not reach */
+#define WANDER_UNREACHED 0xFFFF
+
+/*
+ * WanderSet - Tiles reachable from one spawn within one radius
+ *
+ * Window index i is tile (spawn_x - radius + i / side,
+ *                         spawn_z - radius + i % side).
+ */
+typedef struct WanderSet {
+    u32 spawn;                      /* Position.packed of the spawn tile */
+    u16 radius;
+    u16 side;                       /* 2 * radius + 1 */
+
+    const WorldCollision* collision;    /* Filled from, at revision */
+    u32 revision;
+
+    u16 count;                      /* Reachable tiles (0: spawn unmapped) */
+    u16* tiles;                     /* count window indices, BFS order */
+    u16* parent;                    /* side² : BFS parent or WANDER_UNREACHED */
+    u16* depth;                     /* side² : steps from the spawn */
+
+    struct WanderSet* next;         /* WanderTable.sets */
+} WanderSet;
+
+/*
+ * WanderTable - Every set filled so far
+ */
+typedef struct {
+    ProbeTable* index;              /* spawn | radius << 32 → WanderSet* */
+    WanderSet* sets;                /* All sets, for destroy */
+    u32 set_count;
+
+    u16* path;                      /* Scratch: one walk's tiles */
+    u32 path_capacity;
+
+    u64 fills;                      /* Flood fills (first use + refills) */
+    u64 walks;                      /* Walks queued from a set */
+} WanderTable;
+
+/*
+ * wander_table_create - Empty table (sets are filled on first use)
+ *
+ * @return  Table, or NULL on allocation failure
+ */
+WanderTable* wander_table_create(void);
+
+/*
+ * wander_table_destroy - Free every set and the table (NULL-safe)
+ */
+void wander_table_destroy(WanderTable* table);
+
+/*
+ * wander_set_get - The set for (spawn, radius), filled or refilled as needed
+ *
+ * @param table      Table
+ * @param collision  Collision to fill from (not NULL)
+ * @param spawn      Spawn tile (its height is the level filled)
+ * @param radius     Walk radius, 1 .. WANDER_RADIUS_MAX
+ * @return           Set, or NULL (radius out of range, out of memory)
+ *
+ * COMPLEXITY: O(1) when the set is current, O(side²) for a fill
+ */
+WanderSet* wander_set_get(WanderTable* table, const WorldCollision* collision,
+                          const Position* spawn, u32 radius);
+
+/*
+ * wander_walk - Queue a walk from position to a random tile of the set
+ *
+ * @param table      Table
+ * @param collision  g_world_collision (NULL: returns false)
+ * @param spawn      NPC's spawn tile
+ * @param radius     NPC's walk radius
+ * @param position   Where the NPC stands
+ * @param movement   NPC's movement, empty (waypoints are appended)
+ * @return           true if handled (a walk queued, or the pick was the
+ *                   tile it stands on); false if the caller must path
+ *                   itself (see WHEN THE SET DOES NOT APPLY)
+ *
+ * COMPLEXITY: O(depth) parent reads, no search
+ */
+bool wander_walk(WanderTable* table, const WorldCollision* collision, const Position* spawn,
+                 u32 radius, const Position* position, MovementHandler* movement);
+
+#endif /* WANDER_H */
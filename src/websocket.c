@@ -0,0 +1,296 @@
+/*******************************************************************************
+ * WEBSOCKET.C - WebSocket Handshake and Framing Implementation
+ *******************************************************************************
+ *
+ * See websocket.h for where these layers sit.
+ *
+ * FRAME LAYOUT (RFC 6455 section 5.2):
+ *
+ *   byte 0:  FIN(1) RSV(3) opcode(4)        0x82 = final binary frame
+ *   byte 1:  MASK(1) length(7)              126 → 16-bit length follows
+ *                                           127 → 64-bit length follows
+ *   [extended length] [mask key: 4 bytes, client frames only] payload
+ *
+ *   Client frames must be masked: payload[i] ^= mask[i % 4].
+ *
+ ******************************************************************************/
+
+#include "websocket.h"
+#include "network.h"
+#include <stdio.h>
+#include <string.h>
+
+#define WS_OP_CONTINUATION 0x0
+#define WS_OP_CLOSE        0x8
+
+/* Appended to the client's key before hashing (RFC 6455 section 1.3) */
+static const char WS_GUID[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+/*******************************************************************************
+ * SHA-1 AND BASE64 (handshake only)
+ ******************************************************************************/
+
+static u32 rol32(u32 x, u32 n) {
+    return (x << n) | (x >> (32 - n));
+}
+
+/*
+ * sha1 - SHA-1 digest of a short message (the key plus GUID, ~60 bytes)
+ */
+static void sha1(const u8* message, u32 length, u8 digest[20]) {
+    u32 h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+    u64 bits = (u64)length * 8;
+    u32 total = ((length + 8) / 64 + 1) * 64;
+
+    for (u32 block = 0; block < total; block += 64) {
+        u8 chunk[64];
+        for (u32 i = 0; i < 64; i++) {
+            u32 at = block + i;
+            if (at < length) chunk[i] = message[at];
+            else if (at == length) chunk[i] = 0x80;
+            else if (at >= total - 8) chunk[i] = (u8)(bits >> (8 * (total - 1 - at)));
+            else chunk[i] = 0;
+        }
+
+        u32 w[80];
+        for (u32 i = 0; i < 16; i++) {
+            w[i] = ((u32)chunk[i * 4] << 24) | ((u32)chunk[i * 4 + 1] << 16) |
+                   ((u32)chunk[i * 4 + 2] << 8) | chunk[i * 4 + 3];
+        }
+        for (u32 i = 16; i < 80; i++) w[i] = rol32(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+        u32 a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (u32 i = 0; i < 80; i++) {
+            u32 f, k;
+            if (i < 20)      { f = (b & c) | (~b & d);          k = 0x5A827999; }
+            else if (i < 40) { f = b ^ c ^ d;                   k = 0x6ED9EBA1; }
+            else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+            else             { f = b ^ c ^ d;                   k = 0xCA62C1D6; }
+            u32 t = rol32(a, 5) + f + e + k + w[i];
+            e = d; d = c; c = rol32(b, 30); b = a; a = t;
+        }
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+    }
+
+    for (u32 i = 0; i < 5; i++) {
+        digest[i * 4] = (u8)(h[i] >> 24);
+        digest[i * 4 + 1] = (u8)(h[i] >> 16);
+        digest[i * 4 + 2] = (u8)(h[i] >> 8);
+        digest[i * 4 + 3] = (u8)h[i];
+    }
+}
+
+static void base64(const u8* data, u32 length, char* out) {
+    static const char ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    u32 o = 0;
+    for (u32 i = 0; i < length; i += 3) {
+        u32 v = (u32)data[i] << 16;
+        if (i + 1 < length) v |= (u32)data[i + 1] << 8;
+        if (i + 2 < length) v |= data[i + 2];
+        out[o++] = ALPHABET[(v >> 18) & 63];
+        out[o++] = ALPHABET[(v >> 12) & 63];
+        out[o++] = i + 1 < length ? ALPHABET[(v >> 6) & 63] : '=';
+        out[o++] = i + 2 < length ? ALPHABET[v & 63] : '=';
+    }
+    out[o] = '\0';
+}
+
+/*******************************************************************************
+ * HANDSHAKE
+ ******************************************************************************/
+
+/*
+ * header_value - Value of an HTTP header, trimmed (NULL if absent)
+ *
+ * @param request  Request text, NUL-terminated
+ * @param name     Header name with the colon, matched case-insensitively
+ * @param length   Receives the value's length
+ */
+static const char* header_value(const char* request, const char* name, u32* length) {
+    u32 name_length = (u32)strlen(name);
+    for (const char* line = strstr(request, "\r\n"); line; line = strstr(line, "\r\n")) {
+        line += 2;
+        u32 i = 0;
+        while (i < name_length && line[i] && (line[i] | 0x20) == (name[i] | 0x20)) i++;
+        if (i < name_length) continue;
+
+        const char* value = line + name_length;
+        while (*value == ' ' || *value == '\t') value++;
+        const char* stop = strstr(value, "\r\n");
+        if (!stop) return NULL;
+        while (stop > value && (stop[-1] == ' ' || stop[-1] == '\t')) stop--;
+        *length = (u32)(stop - value);
+        return value;
+    }
+    return NULL;
+}
+
+/*
+ * ws_handshake - Answer a complete upgrade request
+ *
+ * @return  false if it is not a WebSocket request or the reply could
+ *          not be sent whole
+ */
+static bool ws_handshake(i32 fd, char* request) {
+    if (strncmp(request, "GET ", 4) != 0) return false;
+
+    u32 key_length = 0;
+    const char* key = header_value(request, "Sec-WebSocket-Key:", &key_length);
+    if (!key || key_length == 0 || key_length > 64) return false;
+
+    char accept_input[64 + sizeof(WS_GUID)];
+    memcpy(accept_input, key, key_length);
+    memcpy(accept_input + key_length, WS_GUID, sizeof(WS_GUID) - 1);
+    u8 digest[20];
+    sha1((const u8*)accept_input, key_length + (u32)sizeof(WS_GUID) - 1, digest);
+    char accept[32];
+    base64(digest, 20, accept);
+
+    /* Echo the first subprotocol offered, if any */
+    u32 protocol_length = 0;
+    const char* protocol = header_value(request, "Sec-WebSocket-Protocol:", &protocol_length);
+    if (protocol) {
+        u32 n = 0;
+        while (n < protocol_length && protocol[n] != ',' && protocol[n] != ' ') n++;
+        protocol_length = n < 64 ? n : 64;
+    }
+
+    char reply[256];
+    int length = snprintf(reply, sizeof(reply),
+                          "HTTP/1.1 101 Switching Protocols\r\n"
+                          "Upgrade: websocket\r\n"
+                          "Connection: Upgrade\r\n"
+                          "Sec-WebSocket-Accept: %s\r\n"
+                          "%s%.*s%s"
+                          "\r\n",
+                          accept,
+                          protocol_length ? "Sec-WebSocket-Protocol: " : "",
+                          (int)protocol_length, protocol_length ? protocol : "",
+                          protocol_length ? "\r\n" : "");
+    if (length <= 0 || (u32)length >= sizeof(reply)) return false;
+    return network_send(fd, (const u8*)reply, (u32)length) == length;
+}
+
+/*******************************************************************************
+ * FRAMES
+ ******************************************************************************/
+
+/*
+ * header_needed - Full length of a client frame header from its first 2 bytes
+ */
+static u32 header_needed(const u8* header) {
+    u32 length7 = header[1] & 0x7F;
+    return 2 + (length7 == 126 ? 2 : length7 == 127 ? 8 : 0) + 4;
+}
+
+/*
+ * ws_begin_frame - Parse a complete header held in ws->header
+ *
+ * @return  false for an unmasked frame, an absurd length or a close
+ */
+static bool ws_begin_frame(WsConn* ws) {
+    const u8* h = ws->header;
+    if (!(h[1] & 0x80)) return false;   /* Client frames must be masked */
+
+    u64 length = h[1] & 0x7F;
+    u32 at = 2;
+    if (length == 126) {
+        length = ((u32)h[2] << 8) | h[3];
+        at = 4;
+    } else if (length == 127) {
+        length = 0;
+        for (u32 i = 0; i < 8; i++) length = (length << 8) | h[2 + i];
+        at = 10;
+    }
+    if (length > 0x7FFFFFFF) return false;
+
+    memcpy(ws->mask, h + at, 4);
+    ws->mask_pos = 0;
+    ws->remaining = (u32)length;
+
+    /* A continuation carries on the data frame it continues */
+    u8 opcode = h[0] & 0x0F;
+    if (opcode != WS_OP_CONTINUATION) ws->opcode = opcode;
+    return opcode != WS_OP_CLOSE;
+}
+
+static i32 ws_decode(WsConn* ws, u8* buffer, u32 start, u32 end) {
+    u32 r = start;      /* Next raw byte */
+    u32 w = start;      /* Next stream byte (never ahead of r) */
+
+    while (r < end) {
+        if (ws->remaining == 0) {
+            /* Gather the header; it may straddle two recv() calls */
+            u32 needed = ws->header_len < 2 ? 2 : header_needed(ws->header);
+            while (ws->header_len < needed && r < end) {
+                ws->header[ws->header_len++] = buffer[r++];
+                if (ws->header_len == 2) needed = header_needed(ws->header);
+            }
+            if (ws->header_len < needed) break;
+            ws->header_len = 0;
+            if (!ws_begin_frame(ws)) return -1;
+            continue;
+        }
+
+        u32 n = end - r < ws->remaining ? end - r : ws->remaining;
+        if (ws->opcode >= WS_OP_CLOSE) {
+            /* Control frame (ping/pong): not part of the stream */
+            r += n;
+        } else {
+            /* Unmask where the bytes lie, sliding them over the headers */
+            for (u32 i = 0; i < n; i++) {
+                buffer[w + i] = buffer[r + i] ^ ws->mask[(ws->mask_pos + i) & 3];
+            }
+            w += n;
+            r += n;
+            ws->mask_pos = (u8)((ws->mask_pos + n) & 3);
+        }
+        ws->remaining -= n;
+    }
+    return (i32)w;
+}
+
+i32 ws_input(WsConn* ws, i32 fd, u8* buffer, u32 start, u32 end) {
+    if (ws->state == WS_STATE_OPEN) return ws_decode(ws, buffer, start, end);
+    if (ws->state != WS_STATE_HANDSHAKE) return (i32)end;
+
+    /* The request so far is buffer[0..end) */
+    u32 request_end = 0;
+    for (u32 i = 3; i < end; i++) {
+        if (buffer[i - 3] == '\r' && buffer[i - 2] == '\n' && buffer[i - 1] == '\r' && buffer[i] == '\n') {
+            request_end = i + 1;
+            break;
+        }
+    }
+    if (request_end == 0) return end < WS_HANDSHAKE_MAX ? (i32)end : -1;
+    if (request_end > WS_HANDSHAKE_MAX) return -1;
+
+    char request[WS_HANDSHAKE_MAX + 1];
+    memcpy(request, buffer, request_end);
+    request[request_end] = '\0';
+    if (!ws_handshake(fd, request)) return -1;
+    ws->state = WS_STATE_OPEN;
+
+    /* Frames sent right behind the request */
+    memmove(buffer, buffer + request_end, end - request_end);
+    return ws_decode(ws, buffer, 0, end - request_end);
+}
+
+u32 ws_frame_header(u8* header, u32 payload_length) {
+    header[0] = 0x82;   /* FIN, binary */
+    if (payload_length < 126) {
+        header[1] = (u8)payload_length;
+        return 2;
+    }
+    if (payload_length <= 0xFFFF) {
+        header[1] = 126;
+        header[2] = (u8)(payload_length >> 8);
+        header[3] = (u8)payload_length;
+        return 4;
+    }
+    header[1] = 127;
+    for (u32 i = 0; i < 8; i++) {
+        header[2 + i] = (u8)((u64)payload_length >> (8 * (7 - i)));
+    }
+    return 10;
+}
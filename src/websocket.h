@@ -0,0 +1,144 @@
+/*******************************************************************************
+ * WEBSOCKET.H - Browser Clients Without a Proxy (RFC 6455, binary frames)
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - The WebSocket opening handshake (HTTP Upgrade, SHA-1 accept key)
+ *   - Frame parsing that survives any split across recv() calls
+ *   - Unmasking in place: the payload never leaves the receive buffer
+ *   - Wrapping a byte stream in frames at the last moment (one per flush)
+ *
+ * THE PROBLEM:
+ *
+ * The Emscripten / WebAssembly builds of the client can only open
+ * WebSockets, and the server speaks raw TCP. Browser players went through
+ * a proxy (websockify and the like) in front of the game port:
+ *
+ *   browser ──ws──► proxy ──tcp──► server
+ *                   └─ one more hop, and two sockets plus buffers per
+ *                      player held by another process
+ *
+ * THE SOLUTION - A SECOND LISTENER THAT SPEAKS WEBSOCKET:
+ *
+ *   bin/rs225 --ws-port 43595
+ *
+ *   browser ──ws──► server (43595)     same slots, login and packets
+ *   client  ──tcp─► server (43594)     as before
+ *
+ * The game protocol is a byte stream either way; WebSocket only adds
+ * frames around it. So a WebSocket connection is an ordinary connection
+ * with two thin layers at the socket edge:
+ *
+ *   INBOUND (recv → stream)
+ *     [hdr][masked payload][hdr][masked pay|load]  ← as received
+ *     [payload][payload][pay|                      ← after ws_input()
+ *      └── unmasked where it lies, moved down over the headers
+ *
+ *     ws_input() works on the bytes just appended to the receive buffer
+ *     (the player's in_buffer, or the network thread's rx, netio.h) and
+ *     leaves only stream bytes behind, so the login handshake and the
+ *     packet framing above it never know. A header cut off by the end
+ *     of a recv() waits in WsConn until the rest arrives.
+ *
+ *   OUTBOUND (stream → send)
+ *     player_flush() turns everything queued since the last flush into
+ *     one binary frame, by writing a 2-10 byte header in front of it:
+ *
+ *       out: [framed, still unsent][new packets ...]
+ *                                  ↑ header inserted here
+ *
+ *     One frame per flush, not one per packet: a tick's PLAYER_INFO,
+ *     zone updates and map chunks all share a single header.
+ *
+ * HANDSHAKE:
+ *
+ *   GET / HTTP/1.1                      HTTP/1.1 101 Switching Protocols
+ *   Upgrade: websocket                  Upgrade: websocket
+ *   Connection: Upgrade           ──►   Connection: Upgrade
+ *   Sec-WebSocket-Key: <base64>         Sec-WebSocket-Accept:
+ *   Sec-WebSocket-Protocol: binary        base64(SHA-1(key + GUID))
+ *                                       Sec-WebSocket-Protocol: binary
+ *
+ *   The first offered subprotocol is echoed: browsers drop a connection
+ *   that offered one and got none back. The reply is written straight to
+ *   the socket (it is tiny and the socket is new), by whichever thread
+ *   reads it.
+ *
+ * WHAT IS NOT SUPPORTED:
+ *   - TLS (wss://): terminate it in front (a load balancer) as usual
+ *   - Extensions (permessage-deflate): never negotiated
+ *   - Ping: browsers do not send them from script; they are skipped.
+ *     A close frame closes the connection.
+ *
+ ******************************************************************************/
+
+#ifndef WEBSOCKET_H
+#define WEBSOCKET_H
+
+#include "types.h"
+#include <stdbool.h>
+
+/* Largest frame header: 2 + 8 (length) + 4 (mask) */
+#define WS_MAX_HEADER 14
+
+/* Largest opening handshake accepted (browsers send ~500 bytes) */
+#define WS_HANDSHAKE_MAX 4096
+
+typedef enum {
+    WS_STATE_NONE = 0,          /* Plain TCP connection */
+    WS_STATE_HANDSHAKE,         /* Waiting for the HTTP upgrade request */
+    WS_STATE_OPEN               /* Frames in both directions */
+} WsState;
+
+/*
+ * WsConn - WebSocket state of one connection (inbound side)
+ */
+typedef struct {
+    u8 state;                   /* WsState */
+    u8 opcode;                  /* Current frame's opcode */
+    u8 header_len;              /* Bytes of a split header held in header[] */
+    u8 mask_pos;                /* Mask offset of the next payload byte */
+    u8 header[WS_MAX_HEADER];
+    u8 mask[4];
+    u32 remaining;              /* Payload bytes of the current frame still to come */
+} WsConn;
+
+/*
+ * ws_input - Turn freshly received bytes into stream bytes, in place
+ *
+ * @param ws      Connection state
+ * @param fd      Socket, for the handshake reply
+ * @param buffer  Receive buffer
+ * @param start   End of the stream bytes already in buffer; the new
+ *                bytes begin here
+ * @param end     End of the new bytes
+ * @return        New end of the stream bytes (start..return are the
+ *                payload that arrived), or -1 to close the connection
+ *                (bad handshake or frame, or a close frame)
+ *
+ * While the handshake is incomplete, buffer[0..end) is the request so
+ * far and end is returned: keep it, but do not treat it as stream bytes
+ * until ws_ready().
+ *
+ * COMPLEXITY: O(end - start)
+ */
+i32 ws_input(WsConn* ws, i32 fd, u8* buffer, u32 start, u32 end);
+
+/*
+ * ws_ready - Whether buffered bytes are game stream bytes yet
+ */
+static inline bool ws_ready(const WsConn* ws) {
+    return ws->state != WS_STATE_HANDSHAKE;
+}
+
+/*
+ * ws_frame_header - Header of a server → client binary frame
+ *
+ * @param header          Receives up to 10 bytes (server frames are unmasked)
+ * @param payload_length  Bytes that follow the header
+ * @return                Header length: 2, 4 or 10
+ */
+u32 ws_frame_header(u8* header, u32 payload_length);
+
+#endif /* WEBSOCKET_H */
@@ -48,6 +48,21 @@
 
 #include "world.h"
 #include "update.h"
+#include "update_pool.h"
+#include "region_shard.h"
+#include "npc_update.h"
+#include "server_packets.h"
+#include "map.h"
+#include "log.h"
+#include "tick_stats.h"
+#include "tick_governor.h"
+#include "mem_stats.h"
+#include "hooks.h"
+#include "zone_update.h"
+#include "aggression.h"
+#include "occupancy.h"
+#include "activation.h"
+#include "shop.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -132,16 +147,85 @@ World* g_world = NULL;
  * LIFECYCLE MANAGEMENT
  ******************************************************************************/
 
+/*******************************************************************************
+ * USERNAME INDEX
+ *******************************************************************************
+ * 
+ * world->names maps base-37 usernames to PIDs (see world_get_player in
+ * world.h). Linear probing; removal shifts the rest of the probe run
+ * back instead of leaving tombstones, so lookups never slow down with
+ * login churn.
+ */
+
+/* Consecutive names differ only in their low digits: mix before masking */
+static u32 world_name_home(u64 name) {
+    name ^= name >> 33;
+    name *= 0xff51afd7ed558ccdULL;
+    name ^= name >> 33;
+    return (u32)name & (WORLD_NAME_SLOTS - 1);
+}
+
+/* Slot holding name, or the empty slot where it would go */
+static u32 world_name_find(const World* world, u64 name) {
+    u32 slot = world_name_home(name);
+    while (world->names[slot].name && world->names[slot].name != name) {
+        slot = (slot + 1) & (WORLD_NAME_SLOTS - 1);
+    }
+    return slot;
+}
+
+/* Latest registration wins if the name is somehow there already */
+static void world_name_insert(World* world, u64 name, u16 pid) {
+    if (name == 0) return;
+    u32 slot = world_name_find(world, name);
+    world->names[slot].name = name;
+    world->names[slot].pid = pid;
+}
+
+/* Remove name only while it still points at pid */
+static void world_name_remove(World* world, u64 name, u16 pid) {
+    if (name == 0) return;
+    u32 slot = world_name_find(world, name);
+    if (!world->names[slot].name || world->names[slot].pid != pid) return;
+    
+    u32 hole = slot;
+    for (u32 i = (slot + 1) & (WORLD_NAME_SLOTS - 1); world->names[i].name;
+         i = (i + 1) & (WORLD_NAME_SLOTS - 1)) {
+        u32 home = world_name_home(world->names[i].name);
+        /* Move it if the hole lies on its probe path (home .. i) */
+        if (((i - home) & (WORLD_NAME_SLOTS - 1)) >= ((i - hole) & (WORLD_NAME_SLOTS - 1))) {
+            world->names[hole] = world->names[i];
+            hole = i;
+        }
+    }
+    world->names[hole].name = 0;
+}
+
+/* Mark the player's tile in g_occupancy while they are in the world */
+static void world_occupy(Player* player) {
+    if (player->occupying) return;
+    occupancy_add(g_occupancy, &player->position, 1);
+    player->occupied = player->position;
+    player->occupying = true;
+}
+
+static void world_vacate(Player* player) {
+    if (!player->occupying) return;
+    occupancy_remove(g_occupancy, &player->occupied, 1);
+    player->occupying = false;
+}
+
 /*
  * world_create - Allocate and initialize game world
  * 
  * ALLOCATION SEQUENCE:
  *   1. Allocate World struct (32 bytes)
  *   2. Create PlayerList (~18KB)
- *   3. Allocate PlayerTracking array (~16MB)
+ *   3. Allocate PlayerTracking pointers (16KB) and their empty pool
  *   4. Initialize counters (tick_count, last_position_log)
  * 
- * TOTAL MEMORY: ~16MB heap allocation
+ * TOTAL MEMORY: well under 1MB until players log in (tracking is taken
+ * from the pool per login, ~2.8KB each)
  * 
  * ERROR HANDLING:
  *   If any allocation fails:
@@ -155,10 +239,10 @@ World* g_world = NULL;
  *   - tick_count = 0 (server just started)
  *   - last_position_log = 0 (never logged yet)
  * 
- * COMPLEXITY: O(MAX_PLAYERS) time (calloc zeros memory)
- *             O(MAX_PLAYERS) space (heap allocations)
+ * COMPLEXITY: O(capacity) time (calloc zeros memory)
+ *             O(capacity) space (heap allocations)
  */
-World* world_create() {
+World* world_create(u32 capacity) {
     /*
      * Step 1: Allocate World struct
      * 
@@ -182,46 +266,131 @@ World* world_create() {
      * FAILURE HANDLING:
      *   If allocation fails, must free World before returning NULL
      */
-    world->player_list = player_list_create(MAX_PLAYERS);
+    world->player_list = player_list_create(capacity);
     if (!world->player_list) {
         free(world);  /* Clean up partial allocation */
         return NULL;
     }
     
     /*
-     * Step 3: Allocate PlayerTracking array
+     * Step 3: Allocate PlayerTracking pointers
      * 
-     * One PlayerTracking struct per player slot (2048 elements).
+     * One pointer per player slot (2048 elements), NULL until the PID
+     * logs in: world_register_player() takes the struct from
+     * tracking_pool and world_unregister_player() returns it.
      * 
      * Each PlayerTracking contains:
-     *   - local_players[MAX_PLAYERS]: u16 array (4KB)
+     *   - local_players[MAX_LOCAL_PLAYERS]: u16 array (510 bytes)
      *   - local_count: u32 (4 bytes)
-     *   - tracked[MAX_PLAYERS]: bool array (2KB)
+     *   - tracked: PlayerSet bitset (256 bytes)
+     *   - owed: PlayerSet bitset (256 bytes)
      *   - appearance_hashes[MAX_PLAYERS]: u8 array (2KB)
-     *   Total per struct: ~8KB
+     *   Total per struct: ~3KB
      * 
-     * Total allocation: 2048 * 8KB = 16MB
-     * 
-     * calloc() ensures all memory is zeroed:
+     * Fully populated: 2048 * 3KB = 6.2MB, but only online PIDs pay.
+     * The pool hands out zeroed structs:
      *   - local_count = 0 (no players tracked)
-     *   - tracked[] = all false (no players visible)
+     *   - tracked = empty set (no players visible)
      *   - appearance_hashes[] = all 0 (no cached appearances)
      * 
      * WHY SO LARGE?:
      *   - Must track up to 2048 other players (worst case: all nearby)
-     *   - Bitmap approach (bool array) is memory-efficient
+     *   - Bitset approach (one bit per PID) is memory-efficient
      *   - Alternative (hash map) would be similar size with more complexity
      * 
      * FAILURE HANDLING:
      *   If allocation fails, must clean up World and PlayerList
      */
-    world->player_tracking = calloc(MAX_PLAYERS, sizeof(PlayerTracking));
+    slab_pool_init(&world->tracking_pool, sizeof(PlayerTracking),
+                   WORLD_TRACKING_SLAB, capacity, MEM_TRACKING);
+    world->player_tracking = mem_calloc(MEM_TRACKING, capacity, sizeof(PlayerTracking*));
     if (!world->player_tracking) {
         player_list_destroy(world->player_list);  /* Free PlayerList */
         free(world);                              /* Free World struct */
         return NULL;
     }
     
+    /*
+     * Step 3.5: Allocate zone grid (spatial index keyed by PID)
+     * 
+     * Lets visibility queries visit only the zones around a viewer.
+     */
+    world->zone_grid = zone_grid_create(capacity);
+    if (!world->zone_grid) {
+        mem_free(world->player_tracking);
+        player_list_destroy(world->player_list);
+        free(world);
+        return NULL;
+    }
+    
+    /*
+     * Step 3.6: Allocate NPC tracking (what each client shows of NPCs)
+     * 
+     * ~1.5KB per PID (see npc_update.h), zeroed like player_tracking.
+     */
+    if (!movement_batch_init(&world->movement, capacity)) {
+        zone_grid_destroy(world->zone_grid);
+        mem_free(world->player_tracking);
+        player_list_destroy(world->player_list);
+        free(world);
+        return NULL;
+    }
+    
+    world->npc_tracking = mem_calloc(MEM_TRACKING, capacity, sizeof(NpcTracking));
+    if (!world->npc_tracking) {
+        movement_batch_free(&world->movement);
+        zone_grid_destroy(world->zone_grid);
+        mem_free(world->player_tracking);
+        player_list_destroy(world->player_list);
+        free(world);
+        return NULL;
+    }
+    
+    /*
+     * Step 3.7: Allocate ground item tracking (zone revisions per client)
+     */
+    world->ground_tracking = mem_calloc(MEM_TRACKING, capacity, sizeof(GroundTracking));
+    if (!world->ground_tracking) {
+        mem_free(world->npc_tracking);
+        movement_batch_free(&world->movement);
+        zone_grid_destroy(world->zone_grid);
+        mem_free(world->player_tracking);
+        player_list_destroy(world->player_list);
+        free(world);
+        return NULL;
+    }
+    
+    /*
+     * Step 3.75: Allocate changed-loc tracking (zone revisions per client)
+     */
+    world->zone_tracking = mem_calloc(MEM_TRACKING, capacity, sizeof(ZoneTracking));
+    if (!world->zone_tracking) {
+        mem_free(world->ground_tracking);
+        mem_free(world->npc_tracking);
+        movement_batch_free(&world->movement);
+        zone_grid_destroy(world->zone_grid);
+        mem_free(world->player_tracking);
+        player_list_destroy(world->player_list);
+        free(world);
+        return NULL;
+    }
+    
+    /*
+     * Step 3.8: Allocate the username index (world_get_player)
+     */
+    world->names = calloc(WORLD_NAME_SLOTS, sizeof(WorldName));
+    if (!world->names) {
+        mem_free(world->zone_tracking);
+        mem_free(world->ground_tracking);
+        mem_free(world->npc_tracking);
+        movement_batch_free(&world->movement);
+        zone_grid_destroy(world->zone_grid);
+        mem_free(world->player_tracking);
+        player_list_destroy(world->player_list);
+        free(world);
+        return NULL;
+    }
+    
     /*
      * Step 4: Initialize timestamps
      * 
@@ -258,7 +427,7 @@ World* world_create() {
  *   3. Free PlayerTracking array
  *   4. Free World struct
  * 
- * MEMORY FREED: ~16MB + (n * 18KB) where n = active players
+ * MEMORY FREED: ~6MB + (n * 18KB) where n = active players
  * 
  * NULL SAFETY:
  *   Safe to call with world = NULL (no-op)
@@ -333,17 +502,25 @@ void world_destroy(World* world) {
     }
     
     /*
-     * Step 2: Free PlayerTracking array
+     * Step 2: Free PlayerTracking pointers and the pool behind them
      * 
-     * This is the largest single allocation (~16MB).
+     * The pool's slabs were the largest allocation (up to ~5.7MB).
      * 
      * Must be freed before World struct, since World owns this pointer.
      * 
      * NULL-safe: free(NULL) is safe no-op in C standard.
      */
     if (world->player_tracking) {
-        free(world->player_tracking);
+        mem_free(world->player_tracking);
     }
+    slab_pool_destroy(&world->tracking_pool);
+    
+    zone_grid_destroy(world->zone_grid);
+    movement_batch_free(&world->movement);
+    mem_free(world->npc_tracking);
+    mem_free(world->ground_tracking);
+    mem_free(world->zone_tracking);
+    free(world->names);
     
     /*
      * Step 3: Free World struct itself
@@ -409,6 +586,9 @@ void world_process(World* world) {
     /* NULL-safe: allow calling on NULL world (no-op) */
     if (!world || !world->player_list) return;
     
+    /* Phase boundaries below charge their time to g_tick_stats */
+    u64 mark = tick_stats_now();
+    
     /*
      * PHASE 1: MOVEMENT PROCESSING
      * 
@@ -418,67 +598,116 @@ void world_process(World* world) {
      *   3. Set primary_direction and secondary_direction
      *   4. Check for region changes (crossing 64x64 boundary)
      * 
-     * START AT INDEX 1:
-     *   - Index 0 is reserved (never used)
-     *   - Valid player indices: [1, capacity)
-     * 
-     * ACTIVE PLAYER CHECK:
-     *   player_is_active() returns true if:
-     *     player->state == PLAYER_STATE_LOGGED_IN
-     *   
-     *   Skips players in states:
-     *     - DISCONNECTED (slot empty)
-     *     - CONNECTED (awaiting login)
-     *     - LOGGING_IN (credentials being verified)
+     * DENSE ACTIVE LIST:
+     *   player_list->active[0, count) holds exactly the registered
+     *   (LOGGED_IN) players, maintained by player_list_add/remove. Every
+     *   phase walks it instead of scanning all MAX_PLAYERS PIDs, so a
+     *   tick with 20 players online touches 20 entries, not 2048.
+     *   Nothing in world_process() logs players in or out, so the list
+     *   is stable for the whole tick.
+     * 
+     * STEP, THEN MERGE (see movement_batch.h):
+     *   Every player is stepped first and pushed into a movement batch,
+     *   which flags the ones that left their reload bounds or their 8x8
+     *   zone. Only those reach the second loop, in list order: a step
+     *   touches nothing but its own player, so stepping everyone before
+     *   merging anyone sends exactly what one loop doing both would.
+     * 
+     * SHARDED PATH (--tick-shards, see region_shard.h):
+     *   The steps run on the shard owning each player's mapsquare, each
+     *   shard into its own batch; their changes are merged back into
+     *   list order.
      */
-    for (u32 i = 1; i < world->player_list->capacity; i++) {
-        Player* player = world->player_list->players[i];
-        if (player && player_is_active(player)) {
+    PlayerList* list = world->player_list;
+    MovementBatch* movement = &world->movement;
+    if (g_region_shards) {
+        region_shards_run(g_region_shards, list, world->zone_grid);
+        region_shards_merge(g_region_shards, movement);
+    } else {
+        movement_batch_clear(movement);
+        for (u32 i = 0; i < list->count; i++) {
+            Player* player = list->active[i];
             /*
-             * Process player movement
+             * player_step_movement() pops the waypoint queue and moves
+             * the player one tile (walking) or two (running), setting
+             * primary/secondary_direction; it returns true when the
+             * player left the reload bounds of their loaded area.
              * 
-             * player_process_movement() does:
-             *   1. Pop waypoint from queue
-             *   2. Calculate direction (0-7 or -1 for none)
-             *   3. Update position (x, z coordinates)
-             *   4. Set primary_direction (walk)
-             *   5. If running: repeat for secondary_direction
-             *   6. Check region change (send new map data if needed)
-             * 
-             * WALKING vs RUNNING:
-             *   - Walk: 1 tile per tick (primary_direction set)
-             *   - Run: 2 tiles per tick (primary + secondary set)
-             * 
-             * REGION CHANGE:
-             *   If player crosses 64x64 region boundary:
-             *     - Set region_changed = true
-             *     - Triggers map data packet next update
-             * 
-             * COMPLEXITY: O(n) where n = waypoints in queue
+             * COMPLEXITY: O(n) where n = waypoints already reached
              */
-            player_process_movement(player);
+            u8 flags = player_step_movement(player) ? MOVEMENT_BATCH_RELOAD : 0;
+            if (player->primary_direction != -1) flags |= MOVEMENT_BATCH_MOVED;
+            movement_batch_push(movement, player->index, i, &player->position, flags);
+        }
+        movement_batch_collect(movement, world->zone_grid);
+    }
+    for (u32 c = 0; c < movement->change_count; c++) {
+        const MovementChange* change = &movement->changes[c];
+        Player* player = list->active[change->order];
+        
+        /* Moved: viewers get a walk or run record (see player_list.h) */
+        if (change->flags & MOVEMENT_BATCH_MOVED) {
+            player_list_mark_changed(list, player);
+            player_occupancy_sync(player);
+        }
+        
+        /* Left the reload bounds: send the area around the new square */
+        if (change->flags & MOVEMENT_BATCH_RELOAD) {
+            player_reload_area(player);
+        }
+        
+        /*
+         * Refile in the zone grid. Only players that crossed a zone
+         * boundary (or teleported, or were never filed) are flagged;
+         * relinking them is O(1).
+         * 
+         * Entering a new zone is also the only way new NPCs come into
+         * range, so that is when the mapsquares in range are activated
+         * (activation.h), the NPCs around the player are woken, and the
+         * next map area is prefetched if one is close.
+         */
+        if ((change->flags & MOVEMENT_BATCH_ZONE) &&
+            zone_grid_update(world->zone_grid, player->index, &player->position)) {
+            activation_enter(g_activation, &player->position, world->tick_count);
+            if (g_npcs) npc_wake_near(g_npcs, &player->position);
+            map_prefetch_ahead(player);
+            hook_zone_enter(player, position_get_zone_x(&player->position), position_get_zone_z(&player->position));
         }
     }
     
+    /* Squares nobody has been near for a while give their spawns back */
+    activation_sweep(g_activation, world->zone_grid, world->tick_count);
+    tick_phase_end(TICK_PHASE_MOVEMENT, &mark);
+    
     /*
-     * PHASE 2: PLAYER UPDATE PACKETS
+     * PHASE 1.5: NPC PROCESSING
      * 
-     * Build list of active players, then send update packet to each.
+     * Process the awake NPCs (those near players; the rest sleep) and
+     * collect the ones whose state changed this tick on g_npcs->changed,
+     * then encode each changed NPC's mask block once. Phase 2 copies
+     * those blocks into every viewer's NPC_INFO.
      * 
-     * WHY BUILD LIST FIRST?:
-     *   - update_player() needs array of all active players
-     *   - Used to calculate nearby players (viewport)
-     *   - Building once is more efficient than recalculating per player
-     * 
-     * ACTIVE PLAYERS ARRAY:
-     *   - Stack allocation (16KB on 64-bit systems)
-     *   - Holds Player* pointers (not Player structs)
-     *   - Filled by world_get_active_players()
+     * Aggressive NPCs near players pick their targets in between (see
+     * aggression.h), once everyone has moved, so the turn to face the
+     * target is in this tick's mask blocks. Under load the hunts run
+     * every other tick (tick_governor.h).
      */
-    Player* active_players[MAX_PLAYERS];
-    u32 active_count = 0;
-    world_get_active_players(world, active_players, &active_count);
+    if (g_npcs) {
+        npc_system_process(g_npcs, world->zone_grid);
+        if (!tick_governor_skip(GOVERNOR_SLOW_HUNTS, world->tick_count, 2)) {
+            aggression_process(g_aggression, g_npcs, world->player_list, world->zone_grid);
+        }
+        npc_update_prepare(g_npcs);
+    }
+    tick_phase_end(TICK_PHASE_NPCS, &mark);
     
+    /*
+     * PHASE 2: PLAYER UPDATE PACKETS
+     * 
+     * Send an update packet to each player on the dense active list.
+     * update_player() itself resolves other players by PID through
+     * player_list and finds nearby ones through the zone grid.
+     */
     /*
      * Send update packet to each active player
      * 
@@ -491,7 +720,7 @@ void world_process(World* world) {
      *   6. Send appearance updates if changed
      * 
      * TRACKING DATA:
-     *   &world->player_tracking[p->index] is per-player state:
+     *   world->player_tracking[p->index] is per-player state:
      *     - local_players: Array of nearby player indices
      *     - local_count: Number of nearby players
      *     - tracked: Bitmap of which players we know about
@@ -501,32 +730,110 @@ void world_process(World* world) {
      *   "DEBUG: Before update alice - tracking[1].local_count=3"
      *   This shows player username and number of nearby players.
      */
-    for (u32 i = 0; i < active_count; i++) {
-        Player* p = active_players[i];
+    /*
+     * NPC_INFO follows each viewer's PLAYER_INFO: the client places new
+     * NPCs relative to the local player, whose position PLAYER_INFO has
+     * just updated.
+     * 
+     * PARALLEL PATH (--update-threads, see update_pool.h):
+     *   1. Encode every player's shared update segments here, so viewers
+     *      on worker threads only read other players
+     *   2. Encode all viewers' packets across the pool
+     *   3. Commit (and possibly flush) each packet back on this thread
+     */
+    if (g_update_pool) {
+        PlayerList* list = world->player_list;
+        for (u32 i = 0; i < list->count; i++) {
+            update_prepare_blocks(list->active[i]);
+        }
+        update_pool_run(g_update_pool, list->active, list->count,
+                        world->player_tracking, list, world->zone_grid,
+                        world->npc_tracking, g_npcs);
+        for (u32 i = 0; i < list->count; i++) {
+            player_out_commit(list->active[i]);
+        }
+    } else {
+        for (u32 i = 0; i < world->player_list->count; i++) {
+            Player* p = world->player_list->active[i];
         
-        /*
-         * Debug: Print tracking state before update
-         * 
-         * Helps diagnose viewport issues:
-         *   - If local_count = 0: Player sees no one (isolation bug?)
-         *   - If local_count > 100: Too many players (clustering issue?)
-         */
-        printf("DEBUG: Before update %s - tracking[%u].local_count=%u\n", 
-               p->username, p->index, world->player_tracking[p->index].local_count);
+            /*
+             * Debug: Print tracking state before update
+             * 
+             * Helps diagnose viewport issues:
+             *   - If local_count = 0: Player sees no one (isolation bug?)
+             *   - If local_count > 100: Too many players (clustering issue?)
+             */
+            LOG_TRACE(LOG_WORLD, "Before update %s - tracking[%u].local_count=%u\n", 
+                      p->username, p->index, world->player_tracking[p->index]->local_count);
         
-        /*
-         * Send player info packet (opcode 184)
-         * 
-         * PACKET FORMAT:
-         *   [Opcode 184] [Variable-length header]
-         *   [Bit-packed movement data]
-         *   [Update flags and delta updates]
-         * 
-         * COMPLEXITY: O(n) where n = nearby players
-         */
-        update_player(p, active_players, active_count, &world->player_tracking[p->index]);
+            /*
+             * Send player info packet (opcode 184)
+             * 
+             * PACKET FORMAT:
+             *   [Opcode 184] [Variable-length header]
+             *   [Bit-packed movement data]
+             *   [Update flags and delta updates]
+             * 
+             * COMPLEXITY: O(n) where n = nearby players
+             */
+            u64 trace_start = trace_begin();
+            update_player(p, world->player_tracking[p->index],
+                          world->player_list, world->zone_grid);
+            trace_end(trace_start, "update_player", p->index);
+            if (g_npcs) {
+                npc_update_player(p, &world->npc_tracking[p->index], g_npcs);
+            }
+        }
     }
-    
+    tick_phase_end(TICK_PHASE_UPDATE, &mark);
+
+    /*
+     * PHASE 2.5: ZONE UPDATES
+     *
+     * Bring each client's ground items up to date (see ground_item.h):
+     * zones that changed get only the logged changes since the revision
+     * the client has, zones new to its scene the full contents. When
+     * nothing changed anywhere this is one comparison per player.
+     *
+     * Then this tick's projectiles, spot animations and loc changes (see
+     * zone_update.h): encoded once per zone, copied to every viewer whose
+     * scene holds the zone. Ground items go first: their full zone sends
+     * reset the client's changed locs, which the zone updates put back.
+     */
+    zone_update_encode(g_zone_updates);
+    for (u32 i = 0; i < world->player_list->count; i++) {
+        Player* p = world->player_list->active[i];
+        ground_item_update_player(g_ground_items, p, &world->ground_tracking[p->index]);
+        zone_update_player(g_zone_updates, p, &world->zone_tracking[p->index],
+                           g_ground_items ? &world->ground_tracking[p->index] : NULL);
+        player_out_commit(p);
+    }
+    zone_update_end_tick(g_zone_updates);
+    tick_phase_end(TICK_PHASE_ZONES, &mark);
+
+    /*
+     * PHASE 2.6: INVENTORY AND STATE UPDATES
+     *
+     * Send each container's slots changed this tick, once, however many
+     * times they changed: a skilling loop that turns one log into a
+     * plank per tick sends one slot, not all 28. send_container_update()
+     * falls back to the full list when that encodes smaller. Queued
+     * varps, stats and run energy go out the same way: the last value
+     * per key, once (send_pending_state). Shops send their changed slots
+     * the same way, encoded once for all their viewers (shop_flush); a
+     * player with a shop open sees the inventory in its sidebar too.
+     */
+    shop_flush(g_shops);
+    for (u32 i = 0; i < world->player_list->count; i++) {
+        Player* p = world->player_list->active[i];
+        send_pending_state(p);
+        shop_send_side(g_shops, p);
+        send_container_update(p, INV_COMPONENT_INVENTORY, p->inventory);
+        send_container_update(p, INV_COMPONENT_EQUIPMENT, p->equipment);
+        player_out_commit(p);
+    }
+    tick_phase_end(TICK_PHASE_STATE, &mark);
+
     /*
      * PHASE 3: CLEANUP FLAGS
      * 
@@ -535,6 +842,10 @@ void world_process(World* world) {
      *   2. Clear needs_placement after 2 ticks
      *   3. Reset update_flags = 0
      * 
+     * Only players on the list's changed set can have any of these: the
+     * ones that moved, got update flags or are being placed this tick
+     * (player_list.h). The rest are not touched.
+     * 
      * WHY RESET FLAGS?:
      *   - Each change should be sent exactly once
      *   - If not reset, same update sent every tick (spam)
@@ -544,51 +855,11 @@ void world_process(World* world) {
      *   Reset AFTER sending updates (not before).
      *   Otherwise, update packet would see flags = 0 (no updates sent).
      */
-    for (u32 i = 1; i < world->player_list->capacity; i++) {
-        Player* player = world->player_list->players[i];
-        if (player && player_is_active(player)) {
-            /*
-             * Placement tick management
-             * 
-             * PLACEMENT LIFECYCLE:
-             *   - Tick 0: needs_placement = true, placement_ticks = 0
-             *   - Tick 1: needs_placement = true, placement_ticks = 1
-             *   - Tick 2: needs_placement = false (cleared)
-             * 
-             * INCREMENT LOGIC:
-             *   Only increment if needs_placement is true.
-             *   Otherwise, placement_ticks stays at 0.
-             * 
-             * CLEAR CONDITION:
-             *   After 2 ticks, clear needs_placement flag.
-             *   Player now receives delta updates (not full placement).
-             */
-            if (player->needs_placement) {
-                player->placement_ticks++;
-                if (player->placement_ticks >= 2) {
-                    player->needs_placement = false;
-                }
-            }
-            
-            /*
-             * Reset update flags for next tick
-             * 
-             * BEFORE RESET:
-             *   player->update_flags might be:
-             *     0x1 (appearance changed)
-             *     0x8 (animation playing)
-             *     0x9 (appearance + animation)
-             * 
-             * AFTER RESET:
-             *   player->update_flags = 0 (clean slate)
-             * 
-             * NEXT TICK:
-             *   Only new changes will set flags:
-             *     player->update_flags |= UPDATE_CHAT;  // New chat message
-             */
-            player->update_flags = 0;
-        }
-    }
+    player_list_end_tick(world->player_list);
+    
+    /* NPCs: clear flags, walk and mask block of this tick's changed NPCs */
+    if (g_npcs) npc_system_end_tick(g_npcs);
+    tick_phase_end(TICK_PHASE_CLEANUP, &mark);
     
     /*
      * PHASE 4: DEBUG LOGGING
@@ -616,30 +887,28 @@ void world_process(World* world) {
      *     - Indicates movement packet not received
      */
     u64 now = (u64)time(NULL);
-    if (now - world->last_position_log >= 5) {
+    if (LOG_ENABLED(LOG_LEVEL_DEBUG) && now - world->last_position_log >= 5) {
         /*
          * Print all active player positions
          * 
          * Only prints players in LOGGED_IN state.
          * Skips DISCONNECTED, CONNECTED, LOGGING_IN states.
          */
-        for (u32 i = 1; i < world->player_list->capacity; i++) {
-            Player* player = world->player_list->players[i];
-            if (player && player_is_active(player)) {
-                /*
-                 * Print position
-                 * 
-                 * FORMAT: "Player: <username> Position: (<x>, <z>)"
-                 * 
-                 * NOTE: Uses x and z (not y).
-                 * RuneScape uses:
-                 *   - x: East-West coordinate
-                 *   - z: North-South coordinate
-                 *   - height: Plane (0-3, not printed here)
-                 */
-                printf("Player: %s Position: (%u, %u)\n", 
-                       player->username, player->position.x, player->position.z);
-            }
+        for (u32 i = 0; i < world->player_list->count; i++) {
+            Player* player = world->player_list->active[i];
+            /*
+             * Print position
+             * 
+             * FORMAT: "Player: <username> Position: (<x>, <z>)"
+             * 
+             * NOTE: Uses x and z (not y).
+             * RuneScape uses:
+             *   - x: East-West coordinate
+             *   - z: North-South coordinate
+             *   - height: Plane (0-3, not printed here)
+             */
+            LOG_DEBUG("Player: %s Position: (%u, %u)\n", 
+                      player->username, position_x(&player->position), position_z(&player->position));
         }
         
         /*
@@ -693,14 +962,13 @@ void world_process(World* world) {
  *   - Safe for strcmp() and printf()
  * 
  * INDEX ASSIGNMENT:
- *   - player_list_add() finds first free slot
- *   - Uses next_pid hint for O(1) average case
+ *   - player_list_add() pops the longest-free PID in O(1)
  *   - Returns false if world full (all 2047 slots occupied)
  * 
  * STATE TRANSITION:
  *   Before: LOGGING_IN → After: LOGGED_IN
  * 
- * COMPLEXITY: O(n) worst case, O(1) average case
+ * COMPLEXITY: O(1)
  */
 bool world_register_player(World* world, Player* player, const char* username) {
     /* Validate inputs (NULL checks) */
@@ -731,16 +999,22 @@ bool world_register_player(World* world, Player* player, const char* username) {
     strncpy(player->username, username, sizeof(player->username) - 1);
     player->username[sizeof(player->username) - 1] = '\0';  /* Ensure null termination */
     
+    /* Tracking comes from the pool (zeroed); the PID is not known yet */
+    PlayerTracking* tracking = (PlayerTracking*)slab_pool_alloc(&world->tracking_pool);
+    if (!tracking) {
+        LOG_ERROR("Failed to register player %s: out of memory!\n", username);
+        return false;
+    }
+    
     /*
      * Step 2: Add to player list
      * 
      * player_list_add() does:
-     *   1. Find free slot (occupied[i] == false)
+     *   1. Pop free PID i from the free list
      *   2. Set players[i] = player
      *   3. Set occupied[i] = true
      *   4. Set player->index = i
      *   5. Increment count
-     *   6. Update next_pid = i + 1 (hint for next allocation)
      * 
      * FAILURE CASE:
      *   If world full (all 2047 slots occupied):
@@ -748,9 +1022,7 @@ bool world_register_player(World* world, Player* player, const char* username) {
      *     - Prints error message
      *     - Player NOT added to world
      * 
-     * COMPLEXITY:
-     *   - Best case: O(1) (next_pid is free)
-     *   - Worst case: O(n) (must scan all slots)
+     * COMPLEXITY: O(1)
      */
     if (!player_list_add(world->player_list, player)) {
         /*
@@ -764,9 +1036,11 @@ bool world_register_player(World* world, Player* player, const char* username) {
          *   - Destroy player struct (wasn't added)
          *   - Close socket
          */
-        printf("Failed to register player %s: world is full!\n", username);
+        LOG_WARN("Failed to register player %s: world is full!\n", username);
+        slab_pool_free(&world->tracking_pool, tracking);
         return false;
     }
+    world_name_insert(world, username_to_base37(player->username), (u16)player->index);
     
     /*
      * Step 2.5: Clear tracking data for this player slot
@@ -784,9 +1058,28 @@ bool world_register_player(World* world, Player* player, const char* username) {
      *   - "Third pass" skips adding players (already tracked check)
      *   - Result: New player can't see anyone!
      * 
-     * FIX: Zero the entire PlayerTracking struct for this slot
+     * FIX: Every login gets a fresh, zeroed PlayerTracking from the pool
      */
-    memset(&world->player_tracking[player->index], 0, sizeof(PlayerTracking));
+    world->player_tracking[player->index] = tracking;
+    memset(&world->npc_tracking[player->index], 0, sizeof(NpcTracking));
+    memset(&world->ground_tracking[player->index], 0, sizeof(GroundTracking));
+    memset(&world->zone_tracking[player->index], 0, sizeof(ZoneTracking));
+    
+    /* Slot may be reused: never serve a previous session's encoded blocks */
+    update_invalidate_block_cache(player);
+    
+    /*
+     * PID may have belonged to someone else: every viewer must treat this
+     * player's appearance as unseen (see appearance_hashes in update.c)
+     */
+    world_forget_appearance(world, (u16)player->index);
+    
+    /* File the player under their login zone so others can find them,
+     * with the squares around it made and their NPCs awake */
+    zone_grid_insert(world->zone_grid, player->index, &player->position);
+    activation_enter(g_activation, &player->position, world->tick_count);
+    if (g_npcs) npc_wake_near(g_npcs, &player->position);
+    world_occupy(player);
     
     /*
      * Step 3: Set player state
@@ -823,6 +1116,7 @@ bool world_register_player(World* world, Player* player, const char* username) {
      */
     player->needs_placement = true;
     player->placement_ticks = 0;
+    player_list_mark_changed(world->player_list, player);
     
     /*
      * Step 5: Print debug message
@@ -836,7 +1130,7 @@ bool world_register_player(World* world, Player* player, const char* username) {
      *   - Debugging index assignment
      *   - Server activity logging
      */
-    printf("Registered new player: %s Index: %u\n", username, player->index);
+    LOG_INFO("Registered new player: %s Index: %u\n", username, player->index);
     
     /*
      * Return success
@@ -853,7 +1147,7 @@ bool world_register_player(World* world, Player* player, const char* username) {
  * world_remove_player - Remove player from world by username
  * 
  * REMOVAL PROCESS:
- *   1. Find player by username (linear search)
+ *   1. Find player by username (username index)
  *   2. Save player index
  *   3. Clear tracking data (memset to 0)
  *   4. Set player state to DISCONNECTED
@@ -869,7 +1163,7 @@ bool world_register_player(World* world, Player* player, const char* username) {
  * SOCKET HANDLING:
  *   Does NOT close socket (caller must call player_destroy separately)
  * 
- * COMPLEXITY: O(n) time (username lookup)
+ * COMPLEXITY: O(1) expected time (username lookup)
  */
 void world_remove_player(World* world, const char* username) {
     /* Validate inputs (NULL checks) */
@@ -878,16 +1172,7 @@ void world_remove_player(World* world, const char* username) {
     /*
      * Step 1: Find player by username
      * 
-     * world_get_player() does linear search:
-     *   for i = 1 to MAX_PLAYERS:
-     *     if players[i] && strcmp(players[i]->username, username) == 0:
-     *       return players[i]
-     * 
-     * COMPLEXITY: O(n) where n = active players
-     * 
-     * OPTIMIZATION:
-     *   Could use hash map: username -> index (O(1) lookup)
-     *   Trade-off: Extra memory and complexity
+     * world_get_player() probes the username index (world->names), O(1).
      */
     Player* player = world_get_player(world, username);
     if (player) {
@@ -912,7 +1197,8 @@ void world_remove_player(World* world, const char* username) {
         /*
          * Step 3: Clear tracking data
          * 
-         * memset(&world->player_tracking[pid], 0, ...) zeroes:
+         * The PlayerTracking goes back to the pool (zeroed when next
+         * handed out), which drops:
          *   - local_players[] array
          *   - local_count
          *   - tracked[] bitmap
@@ -928,9 +1214,19 @@ void world_remove_player(World* world, const char* username) {
          *   Could clear on registration instead of removal.
          *   But clearing on removal is safer (no leftover state).
          * 
-         * COMPLEXITY: O(n) where n = sizeof(PlayerTracking) = ~8KB
+         * COMPLEXITY: O(1) for the tracking, O(n) for the NPC and ground
+         * tracking memsets
          */
-        memset(&world->player_tracking[pid], 0, sizeof(PlayerTracking));
+        slab_pool_free(&world->tracking_pool, world->player_tracking[pid]);
+        world->player_tracking[pid] = NULL;
+        memset(&world->npc_tracking[pid], 0, sizeof(NpcTracking));
+        memset(&world->ground_tracking[pid], 0, sizeof(GroundTracking));
+        memset(&world->zone_tracking[pid], 0, sizeof(ZoneTracking));
+        
+        /* Unlink from the zone grid so visibility queries stop finding them */
+        zone_grid_remove(world->zone_grid, pid);
+        world_vacate(player);
+        world_name_remove(world, username_to_base37(player->username), pid);
         
         /*
          * Step 4: Set player state
@@ -973,7 +1269,7 @@ void world_remove_player(World* world, const char* username) {
          *   - Debugging removal issues
          *   - Server activity logging
          */
-        printf("Removed player: %s\n", username);
+        LOG_INFO("Removed player: %s\n", username);
     } else {
         /*
          * Player not found
@@ -991,93 +1287,124 @@ void world_remove_player(World* world, const char* username) {
          * OUTPUT:
          *   "Tried to remove non-existing player: charlie"
          */
-        printf("Tried to remove non-existing player: %s\n", username);
+        LOG_WARN("Tried to remove non-existing player: %s\n", username);
     }
 }
 
 /*
- * world_get_player - Find player by username
+ * world_unregister_player - Remove a specific Player struct from the world
  * 
- * SEARCH ALGORITHM:
- *   Linear search through player_list array.
+ * @param world   World instance
+ * @param player  Player to remove
  * 
- * STRING COMPARISON:
- *   strcmp() returns 0 if strings match.
+ * Same cleanup as world_remove_player(), but keyed by the struct itself
+ * instead of username. Used by player_disconnect(): a connection that is
+ * mid-login may carry the same username as an online player, so a name
+ * lookup could remove the wrong one.
  * 
- * CASE SENSITIVITY:
- *   This implementation is CASE-SENSITIVE.
- *   "Alice" != "alice"
+ * Does nothing unless player_list->players[player->index] == player,
+ * which makes it safe to call on slots that never finished logging in.
  * 
- * COMPLEXITY: O(n) time where n = active players
+ * COMPLEXITY: O(1) time
  */
-Player* world_get_player(World* world, const char* username) {
-    /* Validate inputs (NULL checks) */
-    if (!world || !world->player_list || !username) return NULL;
+void world_unregister_player(World* world, Player* player) {
+    if (!world || !world->player_list || !player) return;
     
-    /*
-     * Linear search through all player slots
-     * 
-     * START AT INDEX 1:
-     *   - Index 0 is reserved (never used for players)
-     *   - Valid player indices: [1, capacity)
-     * 
-     * CHECK SEQUENCE:
-     *   1. players[i] != NULL (slot occupied?)
-     *   2. strcmp(username, ...) == 0 (name matches?)
-     * 
-     * SHORT-CIRCUIT EVALUATION:
-     *   If players[i] == NULL, strcmp is NOT called (prevents crash).
-     * 
-     * EARLY RETURN:
-     *   As soon as match found, return player (don't search rest).
-     * 
-     * COMPLEXITY:
-     *   - Best case: O(1) (player at index 1)
-     *   - Average case: O(n/2) (player in middle)
-     *   - Worst case: O(n) (player at end or not found)
-     */
-    for (u32 i = 1; i < world->player_list->capacity; i++) {
-        Player* player = world->player_list->players[i];
-        
-        /*
-         * Check if slot occupied and username matches
-         * 
-         * strcmp() performs lexicographic comparison:
-         *   - Returns 0 if strings equal (found!)
-         *   - Returns <0 if str1 < str2
-         *   - Returns >0 if str1 > str2
-         * 
-         * EXAMPLE:
-         *   strcmp("alice", "alice") = 0  (match!)
-         *   strcmp("alice", "bob") = -1   (no match)
-         */
-        if (player && strcmp(player->username, username) == 0) {
-            /*
-             * Found matching player
-             * 
-             * RETURN:
-             *   - Non-NULL Player* (valid pointer)
-             *   - Caller should check for NULL (no match)
-             */
-            return player;
+    u16 pid = (u16)player->index;
+    if (player_list_get(world->player_list, pid) != player) return;
+    
+    slab_pool_free(&world->tracking_pool, world->player_tracking[pid]);
+    world->player_tracking[pid] = NULL;
+    memset(&world->npc_tracking[pid], 0, sizeof(NpcTracking));
+    memset(&world->ground_tracking[pid], 0, sizeof(GroundTracking));
+    memset(&world->zone_tracking[pid], 0, sizeof(ZoneTracking));
+    zone_grid_remove(world->zone_grid, pid);
+    world_vacate(player);
+    world_name_remove(world, username_to_base37(player->username), pid);
+    player->state = PLAYER_STATE_DISCONNECTED;
+    player_list_remove(world->player_list, pid);
+    LOG_INFO("Removed player: %s\n", player->username);
+}
+
+void world_forget_appearance(World* world, u16 pid) {
+    if (!world || !world->player_list || pid >= world->player_list->capacity) return;
+    for (u32 v = 0; v < world->player_list->capacity; v++) {
+        if (world->player_tracking[v]) {
+            world->player_tracking[v]->appearance_hashes[pid] = 0;
         }
     }
+}
+
+bool world_attach_ghost(World* world, Player* ghost) {
+    if (!world || !world->player_list || !ghost) return false;
+    if (!player_list_attach(world->player_list, ghost)) return false;
     
-    /*
-     * No matching player found
-     * 
-     * RETURN:
-     *   - NULL (not found)
-     * 
-     * CALLER MUST CHECK:
-     *   Player* p = world_get_player(g_world, "alice");
-     *   if (p) {
-     *       // Use p
-     *   } else {
-     *       // Player not online
-     *   }
-     */
-    return NULL;
+    world_forget_appearance(world, (u16)ghost->index);
+    update_invalidate_block_cache(ghost);
+    zone_grid_insert(world->zone_grid, ghost->index, &ghost->position);
+    ghost->state = PLAYER_STATE_LOGGED_IN;
+    ghost->needs_placement = false;
+    ghost->update_flags |= UPDATE_APPEARANCE;
+    player_list_mark_changed(world->player_list, ghost);
+    return true;
+}
+
+void world_detach_ghost(World* world, Player* ghost) {
+    if (!world || !world->player_list || !ghost) return;
+    
+    u16 pid = (u16)ghost->index;
+    if (player_list_get(world->player_list, pid) != ghost) return;
+    zone_grid_remove(world->zone_grid, pid);
+    player_list_detach(world->player_list, pid);
+    ghost->state = PLAYER_STATE_DISCONNECTED;
+}
+
+void world_resume_player(World* world, Player* from, Player* to) {
+    if (!world || !world->player_list || !from || !to) return;
+    
+    u16 pid = (u16)to->index;
+    if (player_list_get(world->player_list, pid) != from) return;
+    player_list_replace(world->player_list, pid, to);
+    from->occupying = false;  /* The mark is to's now (same tile) */
+    
+    /* The client starts from an empty scene: nobody and nothing is shown yet */
+    memset(world->player_tracking[pid], 0, sizeof(PlayerTracking));
+    memset(&world->npc_tracking[pid], 0, sizeof(NpcTracking));
+    memset(&world->ground_tracking[pid], 0, sizeof(GroundTracking));
+    memset(&world->zone_tracking[pid], 0, sizeof(ZoneTracking));
+    update_invalidate_block_cache(to);
+    
+    /* Its own player entity is new too: position and appearance */
+    to->area_digest = 0;
+    to->prefetch_zone = 0;
+    to->region_changed = true;
+    to->needs_placement = true;
+    to->placement_ticks = 0;
+    to->update_flags |= UPDATE_APPEARANCE;
+    player_list_mark_changed(world->player_list, to);
+}
+
+/*
+ * world_get_player - Find player by username
+ * 
+ * Probes world->names from the hash of the base-37 name (see world.h).
+ * The PID found is checked against the list, so an entry can never hand
+ * back a slot that has since been freed.
+ * 
+ * COMPLEXITY: O(1) expected time
+ */
+Player* world_get_player(World* world, const char* username) {
+    /* Validate inputs (NULL checks) */
+    if (!username) return NULL;
+    return world_get_player_by_name(world, username_to_base37(username));
+}
+
+Player* world_get_player_by_name(World* world, u64 name) {
+    if (!world || !world->player_list || !world->names || name == 0) return NULL;
+    
+    const WorldName* entry = &world->names[world_name_find(world, name)];
+    if (!entry->name) return NULL;
+    return player_list_get(world->player_list, entry->pid);
 }
 
 /*
@@ -1126,13 +1453,13 @@ Player* world_get_player_by_index(World* world, u32 index) {
  * world_get_free_index - Find next available player slot
  * 
  * SEARCH STRATEGY:
- *   Circular search starting at next_pid hint.
+ *   None needed: the head of the free PID list.
  * 
  * RETURN VALUE:
  *   - [1-2047]: Valid free slot
  *   - -1: World full (no free slots)
  * 
- * COMPLEXITY: O(n) worst case, O(1) average case
+ * COMPLEXITY: O(1)
  */
 i32 world_get_free_index(World* world) {
     /* Validate inputs (NULL checks) */
@@ -1141,20 +1468,8 @@ i32 world_get_free_index(World* world) {
     /*
      * Get next free player index
      * 
-     * player_list_get_next_pid() does:
-     *   1. Start at next_pid (hint from last allocation)
-     *   2. Search for occupied[i] == false
-     *   3. Wrap around if needed (circular search)
-     *   4. Return index if found, or 0 if full
-     * 
-     * CIRCULAR SEARCH:
-     *   next_pid = 5
-     *   Search order: 5, 6, 7, ..., 2047, 1, 2, 3, 4
-     * 
-     * COMPLEXITY:
-     *   - Best case: O(1) (next_pid is free)
-     *   - Average case: O(1) (few slots checked)
-     *   - Worst case: O(n) (world nearly full)
+     * player_list_get_next_pid() peeks at the free PID list:
+     * the PID that has been free the longest, or 0 if full. O(1).
      */
     u16 pid = player_list_get_next_pid(world->player_list);
     
@@ -1226,99 +1541,25 @@ u32 world_get_player_count(World* world) {
  ******************************************************************************/
 
 /*
- * world_get_active_players - Build array of all logged-in players
+ * world_get_active_players - Copy out all logged-in players
  * 
  * ACTIVE PLAYER DEFINITION:
- *   player->state == PLAYER_STATE_LOGGED_IN
+ *   Registered in player_list (state == PLAYER_STATE_LOGGED_IN)
  * 
  * OUTPUT FORMAT:
- *   - out_players[] filled with Player* pointers
+ *   - out_players[] filled with Player* pointers, in active[] order
  *   - *out_count set to number of active players
  * 
- * ARRAY BOUNDS:
- *   Stops at MAX_PLAYERS to prevent overflow.
+ * Tick code iterates player_list->active directly; this copy is for
+ * callers that need a snapshot that survives logins and logouts.
  * 
- * COMPLEXITY: O(n) time where n = MAX_PLAYERS
+ * COMPLEXITY: O(n) time where n = players online
  */
 void world_get_active_players(World* world, Player** out_players, u32* out_count) {
     /* Validate inputs (NULL checks) */
     if (!world || !world->player_list || !out_players || !out_count) return;
     
-    /*
-     * Initialize output count
-     * 
-     * Must set to 0 before loop (incremented for each active player).
-     */
-    *out_count = 0;
-    
-    /*
-     * Scan all player slots
-     * 
-     * START AT INDEX 1:
-     *   - Index 0 is reserved (never used)
-     *   - Valid player indices: [1, capacity)
-     * 
-     * STOP CONDITIONS:
-     *   1. i >= capacity (scanned all slots)
-     *   2. *out_count >= MAX_PLAYERS (array full)
-     * 
-     * OVERFLOW PREVENTION:
-     *   If *out_count >= MAX_PLAYERS: break
-     *   Prevents writing past end of out_players array.
-     */
-    for (u32 i = 1; i < world->player_list->capacity && *out_count < MAX_PLAYERS; i++) {
-        Player* player = world->player_list->players[i];
-        
-        /*
-         * Check if player is active
-         * 
-         * player_is_active() returns true if:
-         *   player->state == PLAYER_STATE_LOGGED_IN
-         * 
-         * Excludes players in states:
-         *   - DISCONNECTED (slot empty)
-         *   - CONNECTED (awaiting login)
-         *   - LOGGING_IN (credentials being verified)
-         * 
-         * WHY CHECK BOTH player AND player_is_active()?:
-         *   - player != NULL: Slot is occupied
-         *   - player_is_active(): Player is in LOGGED_IN state
-         *   
-         *   A player can exist but not be active:
-         *     - State = CONNECTED (just connected, awaiting login)
-         *     - State = LOGGING_IN (credentials being verified)
-         */
-        if (player && player_is_active(player)) {
-            /*
-             * Add player to output array
-             * 
-             * out_players[*out_count] = player:
-             *   - Store Player* pointer at current index
-             *   - Index is *out_count (current number of active players)
-             * 
-             * (*out_count)++:
-             *   - Increment count (found another active player)
-             *   - Parentheses ensure ++ applies to dereferenced pointer
-             *   - Equivalent to: *out_count = *out_count + 1;
-             * 
-             * EXAMPLE:
-             *   Before: *out_count = 3
-             *           out_players = [Player1*, Player2*, Player3*, ???, ...]
-             *   
-             *   After:  *out_count = 4
-             *           out_players = [Player1*, Player2*, Player3*, Player4*, ...]
-             */
-            out_players[(*out_count)++] = player;
-        }
-    }
-    
-    /*
-     * Return (out_players filled, out_count set)
-     * 
-     * CALLER CAN NOW:
-     *   for (u32 i = 0; i < count; i++) {
-     *       Player* p = active_players[i];
-     *       // Process active player
-     *   }
-     */
+    /* The dense list never holds more than capacity (<= MAX_PLAYERS) */
+    *out_count = world->player_list->count;
+    memcpy(out_players, world->player_list->active, *out_count * sizeof(Player*));
 }
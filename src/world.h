@@ -120,7 +120,7 @@
  *   │         │                   │ (64-bit)   │ PlayerList    │
  *   ├─────────┼───────────────────┼────────────┼───────────────┤
  *   │ 8       │ player_tracking   │ 8 bytes    │ Pointer to    │
- *   │         │                   │            │ tracking array│
+ *   │         │                   │            │ tracking ptrs │
  *   ├─────────┼───────────────────┼────────────┼───────────────┤
  *   │ 16      │ last_position_log │ 8 bytes    │ Unix timestamp│
  *   ├─────────┼───────────────────┼────────────┼───────────────┤
@@ -135,8 +135,8 @@
  *     - occupied bitmap: 2048 * 1 byte = 2KB (flags)
  *     Total: ~18KB
  * 
- *   PlayerTracking array:
- *     - 2048 players * sizeof(PlayerTracking)
+ *   PlayerTracking (one per online player, from tracking_pool):
+ *     - online players * sizeof(PlayerTracking)
  *     - Each PlayerTracking: ~10KB (local_players + tracked + hashes)
  *     Total: ~20MB (largest memory consumer!)
  * 
@@ -202,9 +202,28 @@
 #include "types.h"
 #include "player.h"
 #include "player_list.h"
+#include "zone_grid.h"
+#include "movement_batch.h"
+#include "npc_update.h"
+#include "ground_item.h"
 #include "constants.h"
+#include "slab_pool.h"
 #include <stdbool.h>
 
+/* PlayerTracking structs allocated together when the pool runs dry */
+#define WORLD_TRACKING_SLAB 32
+
+/* Slots in the username index: a power of two, at most half full */
+#define WORLD_NAME_SLOTS (MAX_PLAYERS * 2)
+
+/*
+ * WorldName - One username index entry (name 0 = empty)
+ */
+typedef struct {
+    u64 name;                   /* username_to_base37() */
+    u16 pid;
+} WorldName;
+
 /*******************************************************************************
  * WORLD STRUCTURE
  *******************************************************************************
@@ -218,14 +237,16 @@
  * 
  * OWNERSHIP:
  *   - World owns PlayerList (allocated on heap)
- *   - World owns PlayerTracking array (allocated on heap)
+ *   - World owns the PlayerTracking pointers and the pool behind them
  *   - World does NOT own individual Player structs (managed by PlayerList)
  * 
  * INVARIANTS:
  *   - player_list is never NULL after successful creation
  *   - player_tracking is never NULL after successful creation
- *   - player_list->capacity == MAX_PLAYERS
- *   - player_tracking has exactly MAX_PLAYERS elements
+ *   - player_list->capacity == the capacity given to world_create()
+ *     (<= MAX_PLAYERS)
+ *   - player_tracking has exactly that many elements, non-NULL exactly
+ *     for the PIDs in player_list
  *   - tick_count increments monotonically (never decreases)
  * 
  ******************************************************************************/
@@ -239,7 +260,7 @@ typedef struct {
      *   - players[i]: Pointer to Player at index i (or NULL if slot empty)
      *   - occupied[i]: Boolean flag (true if slot i has player)
      *   - count: Number of active players (cached for O(1) access)
-     *   - next_pid: Hint for next free slot (optimization)
+     *   - pids: Free list of unused PIDs (O(1) allocation)
      * 
      * INDEXING:
      *   - Player indices are 1-based: [1, MAX_PLAYERS)
@@ -258,7 +279,7 @@ typedef struct {
      *   players[5-2047]: NULL    (empty)
      *   
      *   occupied: [F, T, F, T, T, F, F, ...]
-     *   next_pid: 2 (next free slot to try)
+     *   pids: 5, 6, ..., 2047, 2 (free PIDs, longest-free first)
      * 
      * THREAD SAFETY:
      *   - NOT thread-safe (requires external synchronization)
@@ -270,47 +291,55 @@ typedef struct {
     /*
      * player_tracking - Per-player viewport and synchronization state
      * 
-     * TYPE: PlayerTracking* (heap-allocated array of MAX_PLAYERS elements)
+     * TYPE: PlayerTracking** (heap-allocated array of MAX_PLAYERS pointers)
      * 
      * INDEXED BY PLAYER INDEX:
-     *   player_tracking[i] = tracking data for player at index i
+     *   player_tracking[i] = tracking data for player at index i, taken
+     *   from tracking_pool at login, NULL while PID i is offline
      * 
      * EACH PlayerTracking CONTAINS:
-     *   - local_players[MAX_PLAYERS]: Array of nearby player indices
-     *   - local_count: Number of players in local_players (0-2047)
-     *   - tracked[MAX_PLAYERS]: Bitmap of which players we know about
+     *   - local_players[MAX_LOCAL_PLAYERS]: Array of nearby player indices
+     *   - local_count: Number of players in local_players (0-255)
+     *   - tracked: PlayerSet, one bit per PID, of the same players
      *   - appearance_hashes[MAX_PLAYERS]: Cached appearance to detect changes
      * 
      * MEMORY USAGE:
-     *   sizeof(PlayerTracking) = 2048*2 + 4 + 2048*1 + 2048*1 = ~8KB per player
-     *   Total: 2048 * 8KB = 16MB (significant memory cost!)
+     *   sizeof(PlayerTracking) = 255*2 + 4 + 256 + 2048 = ~2.8KB per player
+     *   Total: online players * 2.8KB (5.7MB if every PID is online)
      * 
-     * WHY SO LARGE?:
-     *   - Need to track all 2048 possible players (worst case: everyone nearby)
-     *   - Bitmap approach (tracked[]) is more memory-efficient than hash map
-     *   - Appearance hashing avoids re-sending unchanged data (bandwidth savings)
+     *   A flat array of all 2048 did not stay cheap: every login clears
+     *   one appearance_hashes byte in every viewer's struct, which
+     *   touched every page of the array after the first login.
+     * 
+     * WHY THIS SHAPE?:
+     *   - The protocol caps the local list at 255, so the list is bounded
+     *   - A 256-byte bitset covers all 2048 PIDs and diffs 64 at a time
+     *   - Appearance hashing avoids re-sending unchanged data (bandwidth
+     *     savings); it is per PID because it must outlive the local list
      * 
      * EXAMPLE - PLAYER 5's TRACKING:
-     *   player_tracking[5].local_players = [1, 12, 43, 99, 150, 0, 0, ...]
-     *   player_tracking[5].local_count = 5
-     *   player_tracking[5].tracked[1] = true    (Player 1 is visible)
-     *   player_tracking[5].tracked[2] = false   (Player 2 is not visible)
-     *   player_tracking[5].appearance_hashes[1] = 0xAB  (last known appearance)
+     *   player_tracking[5]->local_players = [1, 12, 43, 99, 150, 0, 0, ...]
+     *   player_tracking[5]->local_count = 5
+     *   player_set_has(&player_tracking[5]->tracked, 1) (Player 1 is visible)
+     *   !player_set_has(&player_tracking[5]->tracked, 2) (Player 2 is not)
+     *   player_tracking[5]->appearance_hashes[1] = 0xAB  (last known appearance)
      * 
      * UPDATE ALGORITHM:
      *   Every tick, for player P at index I:
      *     1. Calculate which players are within 15 tiles
      *     2. Compare to player_tracking[I].local_players (previous tick)
-     *     3. New players: Send "add player" packet, set tracked[pid] = true
-     *     4. Departed players: Send "remove player" packet, set tracked[pid] = false
+     *     3. New players: Send "add player" packet, add pid to tracked
+     *     4. Departed players: Send "remove player" packet, remove from tracked
      *     5. Existing players: Send delta updates (movement, appearance, etc.)
      *     6. Update local_players[] with current nearby players
      * 
      * CLEARING POLICY:
-     *   When player disconnects, memset(&player_tracking[pid], 0, sizeof(...))
-     *   Ensures no stale data when slot is reused for new player
+     *   When player disconnects, the struct goes back to tracking_pool and
+     *   player_tracking[pid] becomes NULL; the pool zeroes it when it is
+     *   handed out again, so a reused slot never sees stale data
      */
-    PlayerTracking* player_tracking;
+    PlayerTracking** player_tracking;
+    SlabPool tracking_pool;             /* Backs player_tracking[] */
     
     /*
      * last_position_log - Timestamp of last debug position printout
@@ -375,6 +404,72 @@ typedef struct {
      *   - If tick_count_A < tick_count_B, then A happened before B
      */
     u64 tick_count;
+    
+    /*
+     * zone_grid - Spatial index of logged-in players by 8x8 zone
+     * 
+     * TYPE: ZoneGrid* (heap-allocated, see zone_grid.h)
+     * 
+     * KEYED BY: player PID (same index as player_list->players[])
+     * 
+     * MAINTENANCE:
+     *   - world_register_player(): insert at login position
+     *   - world_process() phase 1: refile the players the movement batch
+     *     flags (only those that crossed a zone boundary)
+     *   - world_remove_player(): unlink on logout/disconnect
+     * 
+     * USED BY:
+     *   update_other_players() and player_update_local_players() query the
+     *   5x5 zones around a viewer instead of scanning every player, turning
+     *   the per-tick visibility pass from O(N^2) into O(N * nearby).
+     */
+    ZoneGrid* zone_grid;
+    
+    /*
+     * movement - Phase 1's steps and zone changes (movement_batch.h)
+     * 
+     * Capacity MAX_PLAYERS. Without region shards the players are pushed
+     * here; with them, the shards' changes are merged into its changes[].
+     */
+    MovementBatch movement;
+    
+    /*
+     * npc_tracking - Per-player NPC viewport (NPC_INFO), indexed by PID
+     * 
+     * NpcTracking is ~1.5KB (see npc_update.h), 3.1MB for all PIDs.
+     * Zeroed on login and logout (player_tracking is re-pooled then).
+     * Still one flat array: calloc'd pages that no PID has used stay
+     * unbacked, and no login touches other PIDs' entries.
+     */
+    NpcTracking* npc_tracking;
+    
+    /*
+     * ground_tracking - Per-player ground item zone revisions, by PID
+     * 
+     * GroundTracking is ~700 bytes (see ground_item.h), 1.4MB for all
+     * PIDs. Zeroed with the other tracking arrays on login and logout,
+     * which makes the next update resend every zone holding items.
+     */
+    GroundTracking* ground_tracking;
+    
+    /*
+     * zone_tracking - Per-player changed-loc zone revisions, by PID
+     * 
+     * ZoneTracking is the same size as GroundTracking and reset with it
+     * (see zone_update.h, which includes this header).
+     */
+    struct ZoneTracking* zone_tracking;
+    
+    /*
+     * names - Registered players by username, for world_get_player()
+     * 
+     * Open addressing over WORLD_NAME_SLOTS entries (64KB), keyed by the
+     * base-37 name the client itself uses, so "Zezima" and "zezima" are
+     * one account. Filled by world_register_player(), emptied by
+     * world_remove_player() and world_unregister_player(); a lookup is a
+     * hash and a probe or two instead of a walk over every PID.
+     */
+    WorldName* names;
 } World;
 
 /*
@@ -416,20 +511,23 @@ extern World* g_world;
 /*
  * world_create - Allocate and initialize a new game world
  * 
+ * @param capacity  PIDs the world holds, PID 0 included (at most
+ *                  MAX_PLAYERS; --max-players N gives N + 1): sizes the
+ *                  player list and every table indexed by PID
  * @return  Pointer to new World, or NULL if allocation failed
  * 
  * ALGORITHM:
  *   1. Allocate World struct: calloc(1, sizeof(World))
- *   2. Create player list: player_list_create(MAX_PLAYERS)
- *   3. Allocate tracking array: calloc(MAX_PLAYERS, sizeof(PlayerTracking))
+ *   2. Create player list: player_list_create(capacity)
+ *   3. Allocate tracking pointers: calloc(capacity, sizeof(PlayerTracking*))
  *   4. Initialize timestamps: last_position_log = 0, tick_count = 0
  *   5. If any allocation fails, clean up and return NULL
  * 
  * MEMORY ALLOCATIONS:
  *   - World struct: 32 bytes
  *   - PlayerList: ~18KB (player pointers + occupied bitmap)
- *   - PlayerTracking array: ~16MB (2048 * 8KB)
- *   Total: ~16MB heap memory
+ *   - PlayerTracking pointers: 16KB (the structs come per login)
+ *   Total: well under 1MB before anyone logs in
  * 
  * INITIAL STATE:
  *   - player_list->count = 0 (no players online)
@@ -441,7 +539,7 @@ extern World* g_world;
  *   Returns NULL if:
  *     - calloc(World) fails (out of memory)
  *     - player_list_create() fails (out of memory)
- *     - calloc(PlayerTracking) fails (out of memory)
+ *     - calloc(PlayerTracking*) fails (out of memory)
  * 
  * PARTIAL CLEANUP ON FAILURE:
  *   If allocation fails midway:
@@ -451,7 +549,7 @@ extern World* g_world;
  * 
  * USAGE - SERVER STARTUP:
  *   int main() {
- *       g_world = world_create();
+ *       g_world = world_create(MAX_PLAYERS);
  *       if (!g_world) {
  *           fprintf(stderr, "Failed to create world!\n");
  *           return 1;
@@ -466,10 +564,10 @@ extern World* g_world;
  *       return 0;
  *   }
  * 
- * COMPLEXITY: O(MAX_PLAYERS) time (zeroing tracking array)
- *             O(MAX_PLAYERS) space (heap allocations)
+ * COMPLEXITY: O(capacity) time (zeroing tracking pointers)
+ *             O(capacity) space (heap allocations)
  */
-World* world_create();
+World* world_create(u32 capacity);
 
 /*
  * world_destroy - Free all world memory and disconnect players
@@ -480,14 +578,15 @@ World* world_create();
  *   1. For each player in player_list:
  *        a. Call player_destroy(player) to close socket and free resources
  *   2. Destroy player list: player_list_destroy(world->player_list)
- *   3. Free tracking array: free(world->player_tracking)
+ *   3. Free tracking pointers and pool: free(world->player_tracking),
+ *      slab_pool_destroy(&world->tracking_pool)
  *   4. Free world struct: free(world)
  * 
  * RESOURCE CLEANUP:
  *   - All player sockets closed (TCP FIN sent to clients)
  *   - All player movement queues freed
  *   - PlayerList freed
- *   - PlayerTracking array freed
+ *   - PlayerTracking pointers and slabs freed
  *   - World struct freed
  * 
  * GRACEFUL SHUTDOWN:
@@ -510,7 +609,7 @@ World* world_create();
  *     -> player_list_destroy()
  *          -> free(players array)
  *          -> free(occupied bitmap)
- *     -> free(player_tracking)
+ *     -> free(player_tracking), slab_pool_destroy(tracking_pool)
  *     -> free(world)
  * 
  * MEMORY LEAK PREVENTION:
@@ -555,7 +654,7 @@ void world_destroy(World* world);
  *   2. UPDATE PHASE:
  *        a. Gather all active players into temporary array
  *        b. For each active player P:
- *             i. update_player(P, all_active_players, count, tracking)
+ *             i. update_player(P, tracking, player_list, zone_grid)
  *            ii. Sends player info packet (184) with nearby player updates
  * 
  *   3. CLEANUP PHASE:
@@ -708,15 +807,12 @@ void world_process(World* world);
  * 
  * INDEX ASSIGNMENT:
  * 
- * player_list_add() finds first free slot:
- *   Occupied: [F, T, F, T, F, F, ...]
- *   Indices:   0  1  2  3  4  5
+ * player_list_add() pops the PID that has been free the longest:
+ *   Free list: 4, 5, ..., 2047, 2   (PID 2 logged out recently)
  *   
- *   Start at next_pid = 2 (hint from last allocation)
- *   Check occupied[2] = F (free!)
- *   Assign player->index = 2
- *   Set occupied[2] = T
- *   Update next_pid = 3 (next guess)
+ *   Pop 4 → free list: 5, ..., 2047, 2
+ *   Assign player->index = 4
+ *   Set occupied[4] = T
  * 
  * FAILURE CASES:
  * 
@@ -788,9 +884,7 @@ void world_process(World* world);
  *       send_initial_packets(player);  // Skills, inventory, interface, etc.
  *   }
  * 
- * COMPLEXITY: O(n) time where n = MAX_PLAYERS
- *             (worst case: scan all slots to find free one)
- *             O(1) average case (next_pid hint usually correct)
+ * COMPLEXITY: O(1) (free list pop)
  */
 bool world_register_player(World* world, Player* player, const char* username);
 
@@ -806,7 +900,7 @@ bool world_register_player(World* world, Player* player, const char* username);
  *        Print: "Tried to remove non-existing player: <username>"
  *        Return (no-op)
  *   3. Save player index: pid = player->index
- *   4. Clear tracking data: memset(&world->player_tracking[pid], 0, ...)
+ *   4. Return tracking data to the pool: player_tracking[pid] = NULL
  *   5. Set player state: PLAYER_STATE_DISCONNECTED
  *   6. Remove from list: player_list_remove(world->player_list, pid)
  *        a. Set players[pid] = NULL
@@ -833,19 +927,22 @@ bool world_register_player(World* world, Player* player, const char* username);
  * TRACKING DATA CLEANUP:
  * 
  *   Before removal:
- *     player_tracking[pid].local_count = 5
- *     player_tracking[pid].tracked[...] = various flags
+ *     player_tracking[pid]->local_count = 5
+ *     player_tracking[pid]->tracked[...] = various flags
  *   
- *   After memset:
- *     player_tracking[pid].local_count = 0
- *     player_tracking[pid].tracked[...] = all false
- *     player_tracking[pid].appearance_hashes[...] = all 0
+ *   After removal:
+ *     player_tracking[pid] = NULL (struct back in tracking_pool)
+ *   
+ *   Next login on pid:
+ *     player_tracking[pid]->local_count = 0
+ *     player_tracking[pid]->tracked[...] = all false
+ *     player_tracking[pid]->appearance_hashes[...] = all 0
  *   
  *   WHY CLEAR?:
  *     When slot is reused for new player, stale data could cause bugs:
  *       - New player sees phantom players from previous session
  *       - Appearance updates sent to wrong players
- *     Zeroing ensures clean slate.
+ *     The pool zeroes every struct it hands out: a clean slate.
  * 
  * STATE TRANSITION:
  * 
@@ -920,10 +1017,75 @@ bool world_register_player(World* world, Player* player, const char* username);
  *       }
  *   }
  * 
- * COMPLEXITY: O(n) time where n = active players (due to username lookup)
+ * COMPLEXITY: O(1) expected (username index, see world_get_player)
  */
 void world_remove_player(World* world, const char* username);
 
+/*
+ * world_unregister_player - Remove a specific Player struct from the world
+ * 
+ * @param world   World instance
+ * @param player  Player to remove (ignored if not registered under its PID)
+ * 
+ * Clears tracking, unlinks from the zone grid and frees the PID. Unlike
+ * world_remove_player() it never matches a different player that happens
+ * to share the username (e.g. a duplicate login still in progress).
+ * 
+ * COMPLEXITY: O(1) time
+ */
+void world_unregister_player(World* world, Player* player);
+
+/*
+ * world_forget_appearance - Make every viewer treat a PID's look as unseen
+ * 
+ * @param world   World instance
+ * @param pid     Player index whose cached appearance versions to clear
+ * 
+ * Zeroes appearance_hashes[pid] in every viewer's tracking, so the next
+ * add sends UPDATE_APPEARANCE whatever version was cached. Needed when
+ * a PID changes hands and when appearance_version wraps (255 → 1): a
+ * cached stamp from before the wrap could otherwise match again.
+ * 
+ * COMPLEXITY: O(MAX_PLAYERS) time
+ */
+void world_forget_appearance(World* world, u16 pid);
+
+/*
+ * world_attach_ghost - Show a read-only player from another node
+ * 
+ * @param world   World instance
+ * @param ghost   Player struct owned by the cluster (cluster.h)
+ * @return        false if no PID is free
+ * 
+ * The ghost gets a PID (player_list_attach) and a place in the zone
+ * grid, so nearby viewers add it like any player. It has no tracking,
+ * no name entry and no tile mark, and no tick phase moves it: the
+ * cluster sets its position and directions from the owning node.
+ * 
+ * COMPLEXITY: O(MAX_PLAYERS) (viewers' appearance hashes)
+ */
+bool world_attach_ghost(World* world, Player* ghost);
+
+/*
+ * world_detach_ghost - Remove a ghost; viewers drop it on their next tick
+ */
+void world_detach_ghost(World* world, Player* ghost);
+
+/*
+ * world_resume_player - Hand a registered PID over to another Player
+ * 
+ * @param world    World instance
+ * @param from     Registered player (its lingering session, session.h)
+ * @param to       Player that took over from's state (same PID)
+ * 
+ * The PID's list entry now points at to; zone grid, names and other
+ * viewers' tracking stay as they are. to's own view starts empty (its
+ * client cleared its lists), and it is placed again with its appearance.
+ * 
+ * COMPLEXITY: O(1) time
+ */
+void world_resume_player(World* world, Player* from, Player* to);
+
 /*
  * world_get_player - Find player by username
  * 
@@ -933,62 +1095,25 @@ void world_remove_player(World* world, const char* username);
  * 
  * ALGORITHM:
  *   1. Validate inputs (world, player_list, username not NULL)
- *   2. Linear search:
- *        for i = 1 to MAX_PLAYERS:
- *          if players[i] != NULL && strcmp(players[i]->username, username) == 0:
- *            return players[i]
- *   3. Return NULL (not found)
- * 
- * STRING COMPARISON:
- * 
- *   strcmp() performs lexicographic comparison:
- *     strcmp("alice", "alice") = 0  (equal)
- *     strcmp("alice", "bob")   < 0  (alice < bob)
- *     strcmp("bob", "alice")   > 0  (bob > alice)
- *   
- *   Returns 0 if strings match (found!)
+ *   2. key = username_to_base37(username)
+ *   3. Probe world->names from hash(key) until key or an empty slot:
+ *        ┌──────────┬──────────┬──────────┬──────────┐
+ *        │  empty   │ alice→1  │  bob→5   │  empty   │
+ *        └──────────┴──────────┴──────────┴──────────┘
+ *                     home(bob) ──→ found on 2nd probe
+ *   4. Return player_list->players[pid]
  * 
  * CASE SENSITIVITY:
  * 
- *   This implementation is CASE-SENSITIVE:
- *     world_get_player(world, "Alice") != world_get_player(world, "alice")
- *   
- *   Original RuneScape is case-insensitive:
+ *   Names compare as base-37, as in the original game:
  *     "Zezima", "zezima", "ZEZIMA" all refer to same player
- *   
- *   TO MAKE CASE-INSENSITIVE:
- *     1. Store usernames as lowercase during registration
- *     2. Convert search term to lowercase before strcmp
- *     Example:
- *       char lower_username[13];
- *       strncpy(lower_username, username, 12);
- *       to_lowercase(lower_username);  // Custom function
- *       ...strcmp(player->username, lower_username)...
+ *   Characters base-37 cannot hold (see update.c) are ignored.
  * 
  * PERFORMANCE:
  * 
- *   Best case: O(1) - player at index 1
- *   Average case: O(n/2) - player in middle
- *   Worst case: O(n) - player at index 2047 or not found
- *   
- *   Where n = MAX_PLAYERS = 2048
- * 
- * OPTIMIZATION:
- * 
- *   Hash map approach:
- *     unordered_map<string, u32> username_to_index;
- *     username_to_index["alice"] = 1;
- *     username_to_index["bob"] = 5;
- *     
- *     Player* world_get_player(world, username) {
- *         u32 index = username_to_index[username];  // O(1) lookup
- *         return world->player_list->players[index];
- *     }
- *   
- *   Trade-off:
- *     + O(1) lookup time
- *     - Extra memory (hash table overhead)
- *     - Must maintain map on add/remove
+ *   O(1) expected: the index is at most half full (WORLD_NAME_SLOTS),
+ *   and the base-37 key is mixed before masking so neighbouring names
+ *   ("bot1", "bot2", ...) do not share a probe run.
  * 
  * USAGE PATTERNS:
  * 
@@ -1038,11 +1163,20 @@ void world_remove_player(World* world, const char* username);
  *         // Player not online
  *     }
  * 
- * COMPLEXITY: O(n) time where n = active players (linear search)
+ * COMPLEXITY: O(1) expected time (username index)
  *             O(1) space (no allocations)
  */
 Player* world_get_player(World* world, const char* username);
 
+/*
+ * world_get_player_by_name - world_get_player() for a base-37 name
+ * 
+ * @param name  username_to_base37() of the name (0: NULL)
+ * 
+ * COMPLEXITY: O(1) expected time
+ */
+Player* world_get_player_by_name(World* world, u64 name);
+
 /*
  * world_get_player_by_index - Retrieve player by slot index
  * 
@@ -1130,30 +1264,12 @@ Player* world_get_player_by_index(World* world, u32 index);
  * ALGORITHM:
  *   1. Validate inputs (world, player_list not NULL)
  *   2. Call player_list_get_next_pid(world->player_list)
- *        a. Start at next_pid (hint from last allocation)
- *        b. Search for occupied[i] == false
- *        c. Wrap around if needed (circular search)
- *        d. Return index if found, or 0 if full
+ *        (peeks at the head of the free PID list)
  *   3. If pid == 0: return -1 (world full)
  *   4. Else: return pid
  * 
- * SEARCH STRATEGY:
- * 
- *   Circular search with hint:
- *     next_pid = 5 (last allocation was slot 5)
- *     Search order: 5, 6, 7, ..., 2047, 1, 2, 3, 4
- *     
- *     occupied: [F, T, T, T, F, T, T, F, ...]
- *     indices:   0  1  2  3  4  5  6  7
- *     
- *     Start at 5: occupied[5] = T (taken)
- *     Try 6: occupied[6] = T (taken)
- *     Try 7: occupied[7] = F (free!) → return 7
- * 
- * WHY START AT next_pid?:
- *   - Optimization: Recently freed slots likely still free
- *   - Avoids always checking from index 1
- *   - Spreads players across index range (better cache locality)
+ * The index returned is the one the next world_register_player() will
+ * assign: the PID that has been free the longest.
  * 
  * RETURN VALUE:
  * 
@@ -1179,19 +1295,11 @@ Player* world_get_player_by_index(World* world, u32 index);
  *         disable_new_connections();
  *     }
  * 
- * PERFORMANCE:
- * 
- *   Best case: O(1) - next_pid is free
- *   Average case: O(1) - few slots checked
- *   Worst case: O(n) - must scan all slots (world nearly full)
- * 
  * WORLD FULL SCENARIO:
  * 
- *   All slots occupied:
- *     occupied: [F, T, T, T, ..., T]  (indices 1-2047 all true)
- *     Search wraps around entire array
- *     Returns 0 (no free slot found)
- *     world_get_free_index() converts 0 to -1
+ *   All slots occupied: the free list is empty, so
+ *   player_list_get_next_pid() returns 0 and world_get_free_index()
+ *   converts it to -1
  * 
  * SIGNED VS UNSIGNED:
  * 
@@ -1203,8 +1311,7 @@ Player* world_get_player_by_index(World* world, u32 index);
  *     if (pid == 0) return -1;  // Cast 0 to -1 (error sentinel)
  *     return (i32)pid;          // Cast u16 to i32 (safe, pid < 2048)
  * 
- * COMPLEXITY: O(n) worst case where n = MAX_PLAYERS
- *             O(1) average case (hint usually correct)
+ * COMPLEXITY: O(1)
  */
 i32 world_get_free_index(World* world);
 
@@ -1315,8 +1422,8 @@ u32 world_get_player_count(World* world);
  *   Caller must allocate array with MAX_PLAYERS capacity:
  *     Player* active[MAX_PLAYERS];  // 2048 pointers (16KB on 64-bit)
  *   
- *   This function will NOT overflow (stops at MAX_PLAYERS):
- *     if (*out_count >= MAX_PLAYERS) break;
+ *   This function will NOT overflow: the dense list it copies holds
+ *   at most player_list->capacity (MAX_PLAYERS) entries.
  * 
  * USE CASES:
  * 
@@ -1329,14 +1436,8 @@ u32 world_get_player_count(World* world);
  *         send_server_message(all_players[i], "Server restarting in 5 minutes!");
  *     }
  *   
- *   Update tick processing:
- *     Player* active[MAX_PLAYERS];
- *     u32 count;
- *     world_get_active_players(g_world, active, &count);
- *     
- *     for (u32 i = 0; i < count; i++) {
- *         update_player(active[i], active, count, &g_world->player_tracking[i]);
- *     }
+ *   Tick processing does not copy: it walks player_list->active[0,
+ *   count) in place (see world_process).
  *   
  *   Statistics:
  *     Player* active[MAX_PLAYERS];
@@ -1381,7 +1482,8 @@ u32 world_get_player_count(World* world);
  *     // Use active array...
  *     pthread_mutex_unlock(&world_mutex);
  * 
- * COMPLEXITY: O(n) time where n = MAX_PLAYERS (scan entire array)
+ * COMPLEXITY: O(n) time where n = players online (copied from the
+ *             dense player_list->active list, no slot scan)
  *             O(1) space (no heap allocations, uses caller's array)
  */
 void world_get_active_players(World* world, Player** out_players, u32* out_count);
@@ -1,4 +1,5 @@
 #include <math.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -11,6 +12,8 @@
 #include "occlude.h"
 #include "pix2d.h"
 #include "pix3d.h"
+#include "pix3d_bin.h"
+#include "pix3d_gpu.h"
 #include "platform.h"
 #include "world3d.h"
 #include "allocator.h"
@@ -461,7 +464,10 @@ bool world3d_add_loc2(World3D *world3d, int x, int z, int y, int level, int tile
             }
         }
     }
-    Location *loc = rs2_calloc(!temporary, 1, sizeof(Location));
+    Location *loc = temporary ? arena_alloc(ARENA_FRAME, sizeof(Location)) : rs2_calloc(true, 1, sizeof(Location));
+    if (!loc) {
+        return false;
+    }
     loc->bitset = bitset;
     loc->info = info;
     loc->level = level;
@@ -515,10 +521,10 @@ void world3d_clear_temporarylocs(World3D *world3d) {
         Location *loc = world3d->temporaryLocs[i];
         world3d_remove_loc2(world3d, loc);
         world3d->temporaryLocs[i] = NULL;
-        free(loc);
     }
 
     world3d->temporaryLocCount = 0;
+    arena_reset(ARENA_FRAME);
 }
 
 void world3d_remove_loc2(World3D *world3d, Location *loc) {
@@ -921,6 +927,45 @@ void world3d_merge_locnormals(World3D *world3d, int level, int tileX, int tileZ,
     }
 }
 
+// slot of a vertex position in the merge hash
+static inline int world3d_merge_slot(int x, int y, int z) {
+    return (int)(((unsigned)x * 73856093u ^ (unsigned)y * 19349663u ^ (unsigned)z * 83492791u) & (WORLD3D_MERGE_HASH_SIZE - 1));
+}
+
+// chain modelB's vertices by position (merge cycle tmpMergeIndex)
+static void world3d_merge_hash(World3D *world3d, Model *model) {
+    for (int vertex = model->vertex_count - 1; vertex >= 0; vertex--) {
+        if (model->vertex_normal_original[vertex]->w == 0) {
+            continue;
+        }
+
+        int slot = world3d_merge_slot(model->vertices_x[vertex], model->vertices_y[vertex], model->vertices_z[vertex]);
+        if (world3d->mergeHashCycle[slot] != world3d->tmpMergeIndex) {
+            world3d->mergeHashCycle[slot] = world3d->tmpMergeIndex;
+            world3d->mergeHashHead[slot] = -1;
+        }
+        world3d->mergeHashNext[vertex] = world3d->mergeHashHead[slot];
+        world3d->mergeHashHead[slot] = vertex;
+    }
+}
+
+static inline void world3d_merge_vertex(World3D *world3d, Model *modelA, int vertexA, Model *modelB, int vertexB) {
+    VertexNormal *normalA = modelA->vertex_normal[vertexA];
+    VertexNormal *originalNormalA = modelA->vertex_normal_original[vertexA];
+    VertexNormal *normalB = modelB->vertex_normal[vertexB];
+    VertexNormal *originalNormalB = modelB->vertex_normal_original[vertexB];
+    normalA->x += originalNormalB->x;
+    normalA->y += originalNormalB->y;
+    normalA->z += originalNormalB->z;
+    normalA->w += originalNormalB->w;
+    normalB->x += originalNormalA->x;
+    normalB->y += originalNormalA->y;
+    normalB->z += originalNormalA->z;
+    normalB->w += originalNormalA->w;
+    world3d->mergeIndexA[vertexA] = world3d->tmpMergeIndex;
+    world3d->mergeIndexB[vertexB] = world3d->tmpMergeIndex;
+}
+
 void world3d_merge_normals(World3D *world3d, Model *modelA, Model *modelB, int offsetX, int offsetY, int offsetZ, bool allowFaceRemoval) {
     world3d->tmpMergeIndex++;
 
@@ -928,8 +973,13 @@ void world3d_merge_normals(World3D *world3d, Model *modelA, Model *modelB, int o
     int *vertexX = modelB->vertices_x;
     int vertexCountB = modelB->vertex_count;
 
+    // a vertex pair merges when its positions are equal, so with enough
+    // vertices in modelB look them up by position instead of scanning all
+    // of modelB for each vertex of modelA (the sums come out the same)
+    bool useHash = vertexCountB >= WORLD3D_MERGE_HASH_MIN && vertexCountB <= 10000;
+    bool hashed = false;
+
     for (int vertexA = 0; vertexA < modelA->vertex_count; vertexA++) {
-        VertexNormal *normalA = modelA->vertex_normal[vertexA];
         VertexNormal *originalNormalA = modelA->vertex_normal_original[vertexA];
         if (originalNormalA->w != 0) {
             int y = modelA->vertices_y[vertexA] - offsetY;
@@ -947,24 +997,36 @@ void world3d_merge_normals(World3D *world3d, Model *modelA, Model *modelB, int o
                 continue;
             }
 
+            if (useHash) {
+                if (!hashed) {
+                    world3d_merge_hash(world3d, modelB);
+                    hashed = true;
+                }
+
+                int slot = world3d_merge_slot(x, y, z);
+                if (world3d->mergeHashCycle[slot] != world3d->tmpMergeIndex) {
+                    continue;
+                }
+
+                for (int vertexB = world3d->mergeHashHead[slot]; vertexB != -1; vertexB = world3d->mergeHashNext[vertexB]) {
+                    if (x != vertexX[vertexB] || z != modelB->vertices_z[vertexB] || y != modelB->vertices_y[vertexB]) {
+                        continue;
+                    }
+
+                    world3d_merge_vertex(world3d, modelA, vertexA, modelB, vertexB);
+                    merged++;
+                }
+                continue;
+            }
+
             for (int vertexB = 0; vertexB < vertexCountB; vertexB++) {
-                VertexNormal *normalB = modelB->vertex_normal[vertexB];
                 VertexNormal *originalNormalB = modelB->vertex_normal_original[vertexB];
                 if (x != vertexX[vertexB] || z != modelB->vertices_z[vertexB] || y != modelB->vertices_y[vertexB] || originalNormalB->w == 0) {
                     continue;
                 }
 
-                normalA->x += originalNormalB->x;
-                normalA->y += originalNormalB->y;
-                normalA->z += originalNormalB->z;
-                normalA->w += originalNormalB->w;
-                normalB->x += originalNormalA->x;
-                normalB->y += originalNormalA->y;
-                normalB->z += originalNormalA->z;
-                normalB->w += originalNormalA->w;
+                world3d_merge_vertex(world3d, modelA, vertexA, modelB, vertexB);
                 merged++;
-                world3d->mergeIndexA[vertexA] = world3d->tmpMergeIndex;
-                world3d->mergeIndexB[vertexB] = world3d->tmpMergeIndex;
             }
         }
     }
@@ -1064,7 +1126,7 @@ void world3d_click(int mouseX, int mouseY) {
     _World3D.clickTileZ = -1;
 }
 
-void world3d_draw(World3D *world3d, int eyeX, int eyeY, int eyeZ, int topLevel, int eyeYaw, int eyePitch, int loopCycle) {
+static void world3d_draw_scene(World3D *world3d, int eyeX, int eyeY, int eyeZ, int topLevel, int eyeYaw, int eyePitch, int loopCycle) {
     if (eyeX < 0) {
         eyeX = 0;
     } else if (eyeX >= world3d->maxTileX * 128) {
@@ -1245,6 +1307,20 @@ void world3d_draw(World3D *world3d, int eyeX, int eyeY, int eyeZ, int topLevel,
     }
 }
 
+/*
+ * world3d_draw - Draw the scene; with binned rendering on (pix3d_bin.h)
+ * its triangles are recorded here and rasterized by every raster thread
+ * before this returns, with GPU rendering on (pix3d_gpu.h) they are drawn
+ * by the GPU and read back (the GPU takes them first)
+ */
+void world3d_draw(World3D *world3d, int eyeX, int eyeY, int eyeZ, int topLevel, int eyeYaw, int eyePitch, int loopCycle) {
+    pix3d_gpu_begin();
+    pix3d_bin_begin();
+    world3d_draw_scene(world3d, eyeX, eyeY, eyeZ, topLevel, eyeYaw, eyePitch, loopCycle);
+    pix3d_bin_end();
+    pix3d_gpu_end();
+}
+
 void world3d_draw_tile(World3D *world3d, Ground *next, bool checkAdjacent, int loopCycle) {
     linklist_add_tail(_World3D.drawTileQueue, &next->link);
 
@@ -1325,7 +1401,7 @@ void world3d_draw_tile(World3D *world3d, Ground *next, bool checkAdjacent, int l
 
                 Wall *wall = bridge->wall;
                 if (wall) {
-                    model_draw(wall->modelA, 0, _World3D.sinEyePitch, _World3D.cosEyePitch, _World3D.sinEyeYaw, _World3D.cosEyeYaw, wall->x - _World3D.eyeX, wall->y - _World3D.eyeY, wall->z - _World3D.eyeZ, wall->bitset);
+                    model_draw_static(wall->modelA, 0, _World3D.sinEyePitch, _World3D.cosEyePitch, _World3D.sinEyeYaw, _World3D.cosEyeYaw, wall->x - _World3D.eyeX, wall->y - _World3D.eyeY, wall->z - _World3D.eyeZ, wall->bitset);
                 }
 
                 for (int i = 0; i < bridge->locCount; i++) {
@@ -1339,7 +1415,7 @@ void world3d_draw_tile(World3D *world3d, Ground *next, bool checkAdjacent, int l
                             _free = true;
                         }
 
-                        model_draw(model, loc->yaw, _World3D.sinEyePitch, _World3D.cosEyePitch, _World3D.sinEyeYaw, _World3D.cosEyeYaw, loc->x - _World3D.eyeX, loc->y - _World3D.eyeY, loc->z - _World3D.eyeZ, loc->bitset);
+                        (_free ? model_draw : model_draw_static)(model, loc->yaw, _World3D.sinEyePitch, _World3D.cosEyePitch, _World3D.sinEyeYaw, _World3D.cosEyeYaw, loc->x - _World3D.eyeX, loc->y - _World3D.eyeY, loc->z - _World3D.eyeZ, loc->bitset);
                         if (_free) {
                             entity_draw_free(loc->entity, model, loopCycle);
                         }
@@ -1403,17 +1479,17 @@ void world3d_draw_tile(World3D *world3d, Ground *next, bool checkAdjacent, int l
                 }
 
                 if ((wall->typeA & frontWallTypes) != 0 && !world3d_wall_visible(world3d, occludeLevel, tileX, tileZ, wall->typeA)) {
-                    model_draw(wall->modelA, 0, _World3D.sinEyePitch, _World3D.cosEyePitch, _World3D.sinEyeYaw, _World3D.cosEyeYaw, wall->x - _World3D.eyeX, wall->y - _World3D.eyeY, wall->z - _World3D.eyeZ, wall->bitset);
+                    model_draw_static(wall->modelA, 0, _World3D.sinEyePitch, _World3D.cosEyePitch, _World3D.sinEyeYaw, _World3D.cosEyeYaw, wall->x - _World3D.eyeX, wall->y - _World3D.eyeY, wall->z - _World3D.eyeZ, wall->bitset);
                 }
 
                 if ((wall->typeB & frontWallTypes) != 0 && !world3d_wall_visible(world3d, occludeLevel, tileX, tileZ, wall->typeB)) {
-                    model_draw(wall->modelB, 0, _World3D.sinEyePitch, _World3D.cosEyePitch, _World3D.sinEyeYaw, _World3D.cosEyeYaw, wall->x - _World3D.eyeX, wall->y - _World3D.eyeY, wall->z - _World3D.eyeZ, wall->bitset);
+                    model_draw_static(wall->modelB, 0, _World3D.sinEyePitch, _World3D.cosEyePitch, _World3D.sinEyeYaw, _World3D.cosEyeYaw, wall->x - _World3D.eyeX, wall->y - _World3D.eyeY, wall->z - _World3D.eyeZ, wall->bitset);
                 }
             }
 
             if (decor && !world3d_visible(world3d, occludeLevel, tileX, tileZ, decor->model->max_y)) {
                 if ((decor->type & frontWallTypes) != 0) {
-                    model_draw(decor->model, decor->angle, _World3D.sinEyePitch, _World3D.cosEyePitch, _World3D.sinEyeYaw, _World3D.cosEyeYaw, decor->x - _World3D.eyeX, decor->y - _World3D.eyeY, decor->z - _World3D.eyeZ, decor->bitset);
+                    model_draw_static(decor->model, decor->angle, _World3D.sinEyePitch, _World3D.cosEyePitch, _World3D.sinEyeYaw, _World3D.cosEyeYaw, decor->x - _World3D.eyeX, decor->y - _World3D.eyeY, decor->z - _World3D.eyeZ, decor->bitset);
                 } else if ((decor->type & 0x300) != 0) {
                     int x = decor->x - _World3D.eyeX;
                     int y = decor->y - _World3D.eyeY;
@@ -1437,13 +1513,13 @@ void world3d_draw_tile(World3D *world3d, Ground *next, bool checkAdjacent, int l
                     if ((decor->type & 0x100) != 0 && nearestZ < nearestX) {
                         int drawX = x + WALL_DECORATION_INSET_X[rotation];
                         int drawZ = z + WALL_DECORATION_INSET_Z[rotation];
-                        model_draw(decor->model, rotation * 512 + 256, _World3D.sinEyePitch, _World3D.cosEyePitch, _World3D.sinEyeYaw, _World3D.cosEyeYaw, drawX, y, drawZ, decor->bitset);
+                        model_draw_static(decor->model, rotation * 512 + 256, _World3D.sinEyePitch, _World3D.cosEyePitch, _World3D.sinEyeYaw, _World3D.cosEyeYaw, drawX, y, drawZ, decor->bitset);
                     }
 
                     if ((decor->type & 0x200) != 0 && nearestZ > nearestX) {
                         int drawX = x + WALL_DECORATION_OUTSET_X[rotation];
                         int drawZ = z + WALL_DECORATION_OUTSET_Z[rotation];
-                        model_draw(decor->model, rotation * 512 + 1280 & 0x7ff, _World3D.sinEyePitch, _World3D.cosEyePitch, _World3D.sinEyeYaw, _World3D.cosEyeYaw, drawX, y, drawZ, decor->bitset);
+                        model_draw_static(decor->model, rotation * 512 + 1280 & 0x7ff, _World3D.sinEyePitch, _World3D.cosEyePitch, _World3D.sinEyeYaw, _World3D.cosEyeYaw, drawX, y, drawZ, decor->bitset);
                     }
                 }
             }
@@ -1451,7 +1527,7 @@ void world3d_draw_tile(World3D *world3d, Ground *next, bool checkAdjacent, int l
             if (tileDrawn) {
                 GroundDecor *groundDecor = tile->groundDecor;
                 if (groundDecor) {
-                    model_draw(groundDecor->model, 0, _World3D.sinEyePitch, _World3D.cosEyePitch, _World3D.sinEyeYaw, _World3D.cosEyeYaw, groundDecor->x - _World3D.eyeX, groundDecor->y - _World3D.eyeY, groundDecor->z - _World3D.eyeZ, groundDecor->bitset);
+                    model_draw_static(groundDecor->model, 0, _World3D.sinEyePitch, _World3D.cosEyePitch, _World3D.sinEyeYaw, _World3D.cosEyeYaw, groundDecor->x - _World3D.eyeX, groundDecor->y - _World3D.eyeY, groundDecor->z - _World3D.eyeZ, groundDecor->bitset);
                 }
 
                 GroundObject *objs = tile->groundObj;
@@ -1516,7 +1592,7 @@ void world3d_draw_tile(World3D *world3d, Ground *next, bool checkAdjacent, int l
                 Wall *wall = tile->wall;
 
                 if (!world3d_wall_visible(world3d, occludeLevel, tileX, tileZ, wall->typeA)) {
-                    model_draw(wall->modelA, 0, _World3D.sinEyePitch, _World3D.cosEyePitch, _World3D.sinEyeYaw, _World3D.cosEyeYaw, wall->x - _World3D.eyeX, wall->y - _World3D.eyeY, wall->z - _World3D.eyeZ, wall->bitset);
+                    model_draw_static(wall->modelA, 0, _World3D.sinEyePitch, _World3D.cosEyePitch, _World3D.sinEyeYaw, _World3D.cosEyeYaw, wall->x - _World3D.eyeX, wall->y - _World3D.eyeY, wall->z - _World3D.eyeZ, wall->bitset);
                 }
 
                 tile->checkLocSpans = 0;
@@ -1592,6 +1668,10 @@ void world3d_draw_tile(World3D *world3d, Ground *next, bool checkAdjacent, int l
             iterate_locs:;
             }
 
+            // locs stay one model each rather than merged per tile block: tiles
+            // are painted back to front, each loc keeps its own bitset for picking
+            // and can be removed on its own, and a static loc (model_draw_static)
+            // already replays its projection while the camera holds still
             while (true) {
                 int farthestDistance = -50;
                 int farthestIndex = -1;
@@ -1622,7 +1702,7 @@ void world3d_draw_tile(World3D *world3d, Ground *next, bool checkAdjacent, int l
                 }
 
                 if (!world3d_loc_visible(world3d, occludeLevel, farthest->minSceneTileX, farthest->maxSceneTileX, farthest->minSceneTileZ, farthest->maxSceneTileZ, model->max_y)) {
-                    model_draw(model, farthest->yaw, _World3D.sinEyePitch, _World3D.cosEyePitch, _World3D.sinEyeYaw, _World3D.cosEyeYaw, farthest->x - _World3D.eyeX, farthest->y - _World3D.eyeY, farthest->z - _World3D.eyeZ, farthest->bitset);
+                    (_free ? model_draw : model_draw_static)(model, farthest->yaw, _World3D.sinEyePitch, _World3D.cosEyePitch, _World3D.sinEyeYaw, _World3D.cosEyeYaw, farthest->x - _World3D.eyeX, farthest->y - _World3D.eyeY, farthest->z - _World3D.eyeZ, farthest->bitset);
                 }
                 if (_free) {
                     entity_draw_free(farthest->entity, model, loopCycle);
@@ -1701,7 +1781,7 @@ void world3d_draw_tile(World3D *world3d, Ground *next, bool checkAdjacent, int l
 
             if (decor && !world3d_visible(world3d, occludeLevel, tileX, tileZ, decor->model->max_y)) {
                 if ((decor->type & tile->backWallTypes) != 0) {
-                    model_draw(decor->model, decor->angle, _World3D.sinEyePitch, _World3D.cosEyePitch, _World3D.sinEyeYaw, _World3D.cosEyeYaw, decor->x - _World3D.eyeX, decor->y - _World3D.eyeY, decor->z - _World3D.eyeZ, decor->bitset);
+                    model_draw_static(decor->model, decor->angle, _World3D.sinEyePitch, _World3D.cosEyePitch, _World3D.sinEyeYaw, _World3D.cosEyeYaw, decor->x - _World3D.eyeX, decor->y - _World3D.eyeY, decor->z - _World3D.eyeZ, decor->bitset);
                 } else if ((decor->type & 0x300) != 0) {
                     int x = decor->x - _World3D.eyeX;
                     int y = decor->y - _World3D.eyeY;
@@ -1725,13 +1805,13 @@ void world3d_draw_tile(World3D *world3d, Ground *next, bool checkAdjacent, int l
                     if ((decor->type & 0x100) != 0 && nearestZ >= nearestX) {
                         int drawX = x + WALL_DECORATION_INSET_X[rotation];
                         int drawZ = z + WALL_DECORATION_INSET_Z[rotation];
-                        model_draw(decor->model, rotation * 512 + 256, _World3D.sinEyePitch, _World3D.cosEyePitch, _World3D.sinEyeYaw, _World3D.cosEyeYaw, drawX, y, drawZ, decor->bitset);
+                        model_draw_static(decor->model, rotation * 512 + 256, _World3D.sinEyePitch, _World3D.cosEyePitch, _World3D.sinEyeYaw, _World3D.cosEyeYaw, drawX, y, drawZ, decor->bitset);
                     }
 
                     if ((decor->type & 0x200) != 0 && nearestZ <= nearestX) {
                         int drawX = x + WALL_DECORATION_OUTSET_X[rotation];
                         int drawZ = z + WALL_DECORATION_OUTSET_Z[rotation];
-                        model_draw(decor->model, rotation * 512 + 1280 & 0x7ff, _World3D.sinEyePitch, _World3D.cosEyePitch, _World3D.sinEyeYaw, _World3D.cosEyeYaw, drawX, y, drawZ, decor->bitset);
+                        model_draw_static(decor->model, rotation * 512 + 1280 & 0x7ff, _World3D.sinEyePitch, _World3D.cosEyePitch, _World3D.sinEyeYaw, _World3D.cosEyeYaw, drawX, y, drawZ, decor->bitset);
                     }
                 }
             }
@@ -1739,11 +1819,11 @@ void world3d_draw_tile(World3D *world3d, Ground *next, bool checkAdjacent, int l
             Wall *wall = tile->wall;
             if (wall) {
                 if ((wall->typeB & tile->backWallTypes) != 0 && !world3d_wall_visible(world3d, occludeLevel, tileX, tileZ, wall->typeB)) {
-                    model_draw(wall->modelB, 0, _World3D.sinEyePitch, _World3D.cosEyePitch, _World3D.sinEyeYaw, _World3D.cosEyeYaw, wall->x - _World3D.eyeX, wall->y - _World3D.eyeY, wall->z - _World3D.eyeZ, wall->bitset);
+                    model_draw_static(wall->modelB, 0, _World3D.sinEyePitch, _World3D.cosEyePitch, _World3D.sinEyeYaw, _World3D.cosEyeYaw, wall->x - _World3D.eyeX, wall->y - _World3D.eyeY, wall->z - _World3D.eyeZ, wall->bitset);
                 }
 
                 if ((wall->typeA & tile->backWallTypes) != 0 && !world3d_wall_visible(world3d, occludeLevel, tileX, tileZ, wall->typeA)) {
-                    model_draw(wall->modelA, 0, _World3D.sinEyePitch, _World3D.cosEyePitch, _World3D.sinEyeYaw, _World3D.cosEyeYaw, wall->x - _World3D.eyeX, wall->y - _World3D.eyeY, wall->z - _World3D.eyeZ, wall->bitset);
+                    model_draw_static(wall->modelA, 0, _World3D.sinEyePitch, _World3D.cosEyePitch, _World3D.sinEyeYaw, _World3D.cosEyeYaw, wall->x - _World3D.eyeX, wall->y - _World3D.eyeY, wall->z - _World3D.eyeZ, wall->bitset);
                 }
             }
         }
@@ -1785,6 +1865,10 @@ void world3d_draw_tile(World3D *world3d, Ground *next, bool checkAdjacent, int l
     }
 }
 
+// each tile projects its own corners, though up to four tiles share one: a
+// per-frame grid of projected corners (filled in batches, or on first use)
+// measured no faster, as the divides it saves are a small part of a tile and
+// the grid costs loads and an unpredictable projected-yet branch per corner
 void world3d_draw_tileunderlay(World3D *world3d, TileUnderlay *underlay, int level, int tileX, int tileZ, int sinEyePitch, int cosEyePitch, int sinEyeYaw, int cosEyeYaw) {
     int x3;
     int x0 = x3 = (tileX << 7) - _World3D.eyeX;
@@ -2118,12 +2202,192 @@ void world3d_update_activeoccluders(void) {
     }
 }
 
+/*
+ * BLOCK OCCLUSION
+ *
+ * Every occlusion test (world3d_occluded) used to walk the whole active
+ * occluder list, and a dense city keeps hundreds of them active while the
+ * tests run four to a tile. Each occluder hides a wedge behind it that is
+ * linear in the distance from its plane, so over a block of 8x8 tiles its
+ * reach can be bounded from the two ends of the block:
+ *
+ *   eye ----> |occluder|  ........ wedge .........
+ *                         [block A]          [block B]
+ *                          partly             inside the wedge
+ *                          covered            (hidden)
+ *
+ *   - An occluder whose wedge misses a block's x/z square is left off that
+ *     block's list; points in the block test only the rest.
+ *   - A block whose whole box (x/z square by ground height range) lies in
+ *     one wedge is hidden: every tile in it is occluded, with no test per
+ *     corner.
+ *
+ * Both are conservative - a point gets the same answer it did when every
+ * occluder was tried - so the scene draws exactly as before. Lists are
+ * built the first time a block is tested in a frame.
+ */
+
+/*
+ * world3d_block_occluders - Active occluders that can hide a point of a block
+ *
+ * @return  Indices into activeOccluders, or NULL if every one applies
+ */
+static const short *world3d_block_occluders(int blockX, int blockZ, int *count) {
+    if (blockX < 0 || blockZ < 0 || blockX >= WORLD3D_BLOCKS || blockZ >= WORLD3D_BLOCKS) {
+        return NULL;
+    }
+    if (_World3D.blockOccluderPoolCycle != _World3D.cycle) {
+        _World3D.blockOccluderPoolCycle = _World3D.cycle;
+        _World3D.blockOccluderPoolSize = 0;
+    }
+    if (_World3D.blockCycle[blockX][blockZ] != _World3D.cycle) {
+        _World3D.blockCycle[blockX][blockZ] = _World3D.cycle;
+        int minX = blockX << (WORLD3D_BLOCK_SHIFT + 7);
+        int minZ = blockZ << (WORLD3D_BLOCK_SHIFT + 7);
+        int maxX = minX + (128 << WORLD3D_BLOCK_SHIFT) - 1;
+        int maxZ = minZ + (128 << WORLD3D_BLOCK_SHIFT) - 1;
+        int start = _World3D.blockOccluderPoolSize;
+        int n = 0;
+        for (int i = 0; i < _World3D.activeOccluderCount; i++) {
+            Occlude *occluder = _World3D.activeOccluders[i];
+            if (occluder->mode >= 1 && occluder->mode <= 4) {
+                // distances to the plane at the block's near and far sides
+                bool alongX = occluder->mode <= 2;
+                int plane = alongX ? occluder->minX : occluder->minZ;
+                int low = alongX ? minX : minZ;
+                int high = alongX ? maxX : maxZ;
+                int nearest = (occluder->mode & 1) ? plane - high : low - plane;
+                int farthest = (occluder->mode & 1) ? plane - low : high - plane;
+                if (farthest <= 0) {
+                    continue;
+                }
+                if (nearest < 1) {
+                    nearest = 1;
+                }
+                int across0 = alongX ? occluder->minZ : occluder->minX;
+                int across1 = alongX ? occluder->maxZ : occluder->maxX;
+                int delta0 = alongX ? occluder->minDeltaZ : occluder->minDeltaX;
+                int delta1 = alongX ? occluder->maxDeltaZ : occluder->maxDeltaX;
+                int64_t reachLow = across0 + ((int64_t)delta0 * (delta0 < 0 ? farthest : nearest) >> 8);
+                int64_t reachHigh = across1 + ((int64_t)delta1 * (delta1 < 0 ? nearest : farthest) >> 8);
+                int blockLow = alongX ? minZ : minX;
+                int blockHigh = alongX ? maxZ : maxX;
+                if (reachHigh < blockLow || reachLow > blockHigh) {
+                    continue;
+                }
+            }
+            if (start + n >= WORLD3D_BLOCK_POOL) {
+                n = -1;
+                break;
+            }
+            _World3D.blockOccluderPool[start + n++] = (short)i;
+        }
+        _World3D.blockOccluderStart[blockX][blockZ] = (short)start;
+        _World3D.blockOccluderCount[blockX][blockZ] = (short)n;
+        if (n > 0) {
+            _World3D.blockOccluderPoolSize += n;
+        }
+    }
+    *count = _World3D.blockOccluderCount[blockX][blockZ];
+    return *count < 0 ? NULL : &_World3D.blockOccluderPool[_World3D.blockOccluderStart[blockX][blockZ]];
+}
+
+/*
+ * occluder_contains - Whether an occluder hides a point, before rounding
+ *
+ * Exact in 64 bits, with a unit of margin on the far bounds: inside here
+ * means inside the rounded test of world3d_occluded too. The region is
+ * convex, so a box with all 8 corners inside is wholly inside.
+ */
+static bool occluder_contains(const Occlude *occluder, int x, int y, int z) {
+    int64_t d;
+    int64_t u;
+    int64_t v;
+    int uMin;
+    int uMax;
+    int vMin;
+    int vMax;
+    int64_t uDeltaMin;
+    int64_t uDeltaMax;
+    int64_t vDeltaMin;
+    int64_t vDeltaMax;
+    switch (occluder->mode) {
+    case 1:
+    case 2:
+        d = occluder->mode == 1 ? occluder->minX - x : x - occluder->minX;
+        u = z, uMin = occluder->minZ, uMax = occluder->maxZ, uDeltaMin = occluder->minDeltaZ, uDeltaMax = occluder->maxDeltaZ;
+        v = y, vMin = occluder->minY, vMax = occluder->maxY, vDeltaMin = occluder->minDeltaY, vDeltaMax = occluder->maxDeltaY;
+        break;
+    case 3:
+    case 4:
+        d = occluder->mode == 3 ? occluder->minZ - z : z - occluder->minZ;
+        u = x, uMin = occluder->minX, uMax = occluder->maxX, uDeltaMin = occluder->minDeltaX, uDeltaMax = occluder->maxDeltaX;
+        v = y, vMin = occluder->minY, vMax = occluder->maxY, vDeltaMin = occluder->minDeltaY, vDeltaMax = occluder->maxDeltaY;
+        break;
+    case 5:
+        d = y - occluder->minY;
+        u = x, uMin = occluder->minX, uMax = occluder->maxX, uDeltaMin = occluder->minDeltaX, uDeltaMax = occluder->maxDeltaX;
+        v = z, vMin = occluder->minZ, vMax = occluder->maxZ, vDeltaMin = occluder->minDeltaZ, vDeltaMax = occluder->maxDeltaZ;
+        break;
+    default:
+        return false;
+    }
+    return d > 0 && (u - uMin) * 256 >= uDeltaMin * d && (u - uMax + 1) * 256 <= uDeltaMax * d && (v - vMin) * 256 >= vDeltaMin * d && (v - vMax + 1) * 256 <= vDeltaMax * d;
+}
+
+/*
+ * world3d_block_hidden - Whether one occluder hides every tile of a block
+ */
+static bool world3d_block_hidden(World3D *world3d, int level, int blockX, int blockZ) {
+    int cycle = _World3D.levelBlockHiddenCycles[level][blockX][blockZ];
+    if (cycle == _World3D.cycle || cycle == -_World3D.cycle) {
+        return cycle == _World3D.cycle;
+    }
+    _World3D.levelBlockHiddenCycles[level][blockX][blockZ] = -_World3D.cycle;
+
+    int count;
+    const short *list = world3d_block_occluders(blockX, blockZ, &count);
+    if (!list || count == 0) {
+        return false;
+    }
+    int tileX = blockX << WORLD3D_BLOCK_SHIFT;
+    int tileZ = blockZ << WORLD3D_BLOCK_SHIFT;
+    int maxTileX = tileX + (1 << WORLD3D_BLOCK_SHIFT) < world3d->maxTileX ? tileX + (1 << WORLD3D_BLOCK_SHIFT) : world3d->maxTileX;
+    int maxTileZ = tileZ + (1 << WORLD3D_BLOCK_SHIFT) < world3d->maxTileZ ? tileZ + (1 << WORLD3D_BLOCK_SHIFT) : world3d->maxTileZ;
+    int minY = world3d->levelHeightmaps[level][tileX][tileZ];
+    int maxY = minY;
+    for (int x = tileX; x <= maxTileX; x++) {
+        for (int z = tileZ; z <= maxTileZ; z++) {
+            int y = world3d->levelHeightmaps[level][x][z];
+            minY = y < minY ? y : minY;
+            maxY = y > maxY ? y : maxY;
+        }
+    }
+    // tile corners are tested 1 unit inside the tile
+    int minX = (tileX << 7) + 1;
+    int minZ = (tileZ << 7) + 1;
+    int maxX = (maxTileX << 7) - 1;
+    int maxZ = (maxTileZ << 7) - 1;
+    for (int i = 0; i < count; i++) {
+        const Occlude *occluder = _World3D.activeOccluders[list[i]];
+        if (occluder_contains(occluder, minX, minY, minZ) && occluder_contains(occluder, maxX, minY, minZ) && occluder_contains(occluder, minX, minY, maxZ) && occluder_contains(occluder, maxX, minY, maxZ) &&
+            occluder_contains(occluder, minX, maxY, minZ) && occluder_contains(occluder, maxX, maxY, minZ) && occluder_contains(occluder, minX, maxY, maxZ) && occluder_contains(occluder, maxX, maxY, maxZ)) {
+            _World3D.levelBlockHiddenCycles[level][blockX][blockZ] = _World3D.cycle;
+            return true;
+        }
+    }
+    return false;
+}
+
 bool world3d_tile_visible(World3D *world3d, int level, int x, int z) {
     int cycle = world3d->levelTileOcclusionCycles[level][x][z];
     if (cycle == -_World3D.cycle) {
         return false;
     } else if (cycle == _World3D.cycle) {
         return true;
+    } else if (world3d_block_hidden(world3d, level, x >> WORLD3D_BLOCK_SHIFT, z >> WORLD3D_BLOCK_SHIFT)) {
+        world3d->levelTileOcclusionCycles[level][x][z] = _World3D.cycle;
+        return true;
     } else {
         int sx = x << 7;
         int sz = z << 7;
@@ -2299,8 +2563,13 @@ bool world3d_loc_visible(World3D *world3d, int level, int minX, int maxX, int mi
 }
 
 bool world3d_occluded(int x, int y, int z) {
-    for (int i = 0; i < _World3D.activeOccluderCount; i++) {
-        Occlude *occluder = _World3D.activeOccluders[i];
+    int count;
+    const short *list = world3d_block_occluders(x >> (WORLD3D_BLOCK_SHIFT + 7), z >> (WORLD3D_BLOCK_SHIFT + 7), &count);
+    if (!list) {
+        count = _World3D.activeOccluderCount;
+    }
+    for (int i = 0; i < count; i++) {
+        Occlude *occluder = _World3D.activeOccluders[list ? list[i] : i];
 
         if (occluder->mode == 1) {
             int dx = occluder->minX - x;
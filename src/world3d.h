@@ -8,6 +8,16 @@
 
 #define LEVEL_COUNT 4
 
+// occlusion is culled per block of 8x8 tiles first (world3d_occluded)
+#define WORLD3D_BLOCK_SHIFT 3
+#define WORLD3D_BLOCKS ((104 >> WORLD3D_BLOCK_SHIFT) + 1)
+#define WORLD3D_BLOCK_POOL 8192
+
+// world3d_merge_normals finds shared vertices through a hash of their
+// positions once the second model has this many vertices
+#define WORLD3D_MERGE_HASH_MIN 16
+#define WORLD3D_MERGE_HASH_SIZE 4096
+
 // name taken from rsc
 typedef struct {
     int maxLevel;
@@ -22,6 +32,9 @@ typedef struct {
     int mergeIndexA[10000];
     int mergeIndexB[10000];
     int tmpMergeIndex;
+    int mergeHashCycle[WORLD3D_MERGE_HASH_SIZE]; // == tmpMergeIndex: mergeHashHead is set
+    int mergeHashHead[WORLD3D_MERGE_HASH_SIZE];
+    int mergeHashNext[10000];
 } World3D;
 
 typedef struct {
@@ -52,6 +65,13 @@ typedef struct {
     Occlude *levelOccluders[LEVEL_COUNT][500];
     int activeOccluderCount;
     Occlude *activeOccluders[500];
+    int blockCycle[WORLD3D_BLOCKS][WORLD3D_BLOCKS];
+    short blockOccluderStart[WORLD3D_BLOCKS][WORLD3D_BLOCKS];
+    short blockOccluderCount[WORLD3D_BLOCKS][WORLD3D_BLOCKS]; // -1: every active occluder
+    short blockOccluderPool[WORLD3D_BLOCK_POOL];
+    int blockOccluderPoolCycle;
+    int blockOccluderPoolSize;
+    int levelBlockHiddenCycles[LEVEL_COUNT][WORLD3D_BLOCKS][WORLD3D_BLOCKS]; // +cycle hidden, -cycle not
     LinkList *drawTileQueue;   // = new LinkList();
     bool (*visibilityMatrix)[32][51][51]; //[8][32][51][51];
     bool (*visibilityMap)[51];
@@ -0,0 +1,662 @@
+/*******************************************************************************
+ * WORLD_COLLISION.C - Server-Side Collision Grid Builder
+ *******************************************************************************
+ *
+ * See world_collision.h for the design.
+ *
+ * STARTUP:
+ *
+ *   loc.idx / loc.dat → locs[id] = { width, length, blockwalk, ... }
+ *   every region with a land file → page_index = OPEN on every level
+ *   for each of those regions:
+ *       clear the 66x66 scratch CollisionMaps (region + 1 tile border)
+ *       decode m<x>_<z> → tile flags[4][64][64]
+ *            blocked tiles → collisionmap_set_blocked (bridges shift down)
+ *       decode l<x>_<z> → walls / locs / ground decor
+ *       pack every non-zero scratch tile and OR it into its page,
+ *       allocating the page on its first non-zero tile
+ *
+ * MAP FILE FORMATS (after the 4-byte length + headerless bzip2 wrapper):
+ *
+ *   LAND: for level 0-3, x 0-63, z 0-63, one opcode stream per tile:
+ *           0        end of tile (height derived)
+ *           1 h      height, end of tile
+ *           2-49 o   overlay o
+ *           50-81    tile flags = opcode - 49 (1 = blocked, 2 = bridge)
+ *           82+      underlay = opcode - 81
+ *
+ *   LOC:  read with map_loc_next() (map_store.h, LOC FILE DECODING)
+ *
+ ******************************************************************************/
+
+#include "world_collision.h"
+#include "collisionmap.h"
+#include "loctype.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+WorldCollision* g_world_collision = NULL;
+
+/* Tile flag bits in land files */
+#define TILE_FLAG_BLOCKED 0x1
+#define TILE_FLAG_BRIDGE  0x2
+
+/*
+ * Reader - Bounds-checked cursor over a decoded file
+ *
+ * Reads past the end return 0 and set overrun, so one check after a
+ * loop replaces a check per byte.
+ */
+typedef struct {
+    const u8* data;
+    u32 size;
+    u32 pos;
+    bool overrun;
+} Reader;
+
+static u32 read_g1(Reader* r) {
+    if (r->pos >= r->size) {
+        r->overrun = true;
+        return 0;
+    }
+    return r->data[r->pos++];
+}
+
+static u32 read_g2(Reader* r) {
+    u32 hi = read_g1(r);
+    return (hi << 8) | read_g1(r);
+}
+
+static void read_skip(Reader* r, u32 bytes) {
+    if (bytes > r->size - r->pos) {
+        r->pos = r->size;
+        r->overrun = true;
+    } else {
+        r->pos += bytes;
+    }
+}
+
+/* Strings in config files end with '\n' (see gjstr) */
+static void read_skip_string(Reader* r) {
+    while (!r->overrun && read_g1(r) != 10) {
+    }
+}
+
+/*
+ * decode_loc - Keep the collision fields of one loc definition
+ *
+ * Mirrors loctype_decode() (client), skipping everything else. "active"
+ * follows the same default: set by opcode 19, else true if the loc has
+ * options or its first model is a centrepiece.
+ *
+ * @return  false on an unknown opcode or a truncated definition
+ */
+static bool decode_loc(Reader* r, LocCollision* loc) {
+    loc->width = 1;
+    loc->length = 1;
+    loc->forceapproach = 0;
+    loc->blockwalk = true;
+    loc->blockrange = true;
+
+    i32 active = -1;
+    bool has_ops = false;
+    i32 first_shape = -1;
+
+    for (;;) {
+        u32 code = read_g1(r);
+        if (r->overrun) return false;
+        if (code == 0) break;
+
+        if (code == 1) {
+            u32 count = read_g1(r);
+            for (u32 i = 0; i < count; i++) {
+                read_g2(r);
+                u32 shape = read_g1(r);
+                if (i == 0) first_shape = (i32)shape;
+            }
+        } else if (code == 2 || code == 3) {
+            read_skip_string(r);
+        } else if (code == 14) {
+            loc->width = (u8)read_g1(r);
+        } else if (code == 15) {
+            loc->length = (u8)read_g1(r);
+        } else if (code == 17) {
+            loc->blockwalk = false;
+        } else if (code == 18) {
+            loc->blockrange = false;
+        } else if (code == 19) {
+            active = (i32)read_g1(r);
+        } else if (code == 21 || code == 22 || code == 23 || code == 25 ||
+                   code == 62 || code == 64 || code == 73) {
+            /* Flags without a payload */
+        } else if (code == 28 || code == 29 || code == 39) {
+            read_skip(r, 1);
+        } else if (code >= 30 && code < 39) {
+            read_skip_string(r);
+            has_ops = true;
+        } else if (code == 40) {
+            read_skip(r, read_g1(r) * 4);
+        } else if (code == 24 || code == 60 || (code >= 65 && code <= 68) ||
+                   (code >= 70 && code <= 72)) {
+            read_skip(r, 2);
+        } else if (code == 69) {
+            loc->forceapproach = (u8)read_g1(r);
+        } else {
+            return false;
+        }
+    }
+
+    if (active == -1) {
+        loc->active = first_shape == CENTREPIECE_STRAIGHT || has_ops;
+    } else {
+        loc->active = active == 1;
+    }
+    return !r->overrun;
+}
+
+/*
+ * load_locs - Decode the collision table from loc.idx / loc.dat
+ */
+static bool load_locs(WorldCollision* collision, CacheSystem* cache) {
+    u32 idx_size = 0;
+    u32 dat_size = 0;
+    const u8* idx = cache_get_file(cache, CACHE_ARCHIVE_CONFIG, "loc.idx", &idx_size);
+    const u8* dat = cache_get_file(cache, CACHE_ARCHIVE_CONFIG, "loc.dat", &dat_size);
+    if (!idx || !dat) return false;
+
+    Reader index = { idx, idx_size, 0, false };
+    u32 count = read_g2(&index);
+    if (index.overrun || count == 0) return false;
+
+    collision->locs = (LocCollision*)calloc(count, sizeof(LocCollision));
+    if (!collision->locs) return false;
+    collision->loc_count = count;
+
+    u32 offset = 2;
+    u32 bad = 0;
+    for (u32 id = 0; id < count; id++) {
+        u32 length = read_g2(&index);
+        Reader def = { dat, dat_size, offset, false };
+        if (index.overrun || !decode_loc(&def, &collision->locs[id])) {
+            /* Unknown: collide as a plain 1x1 obstacle */
+            collision->locs[id] = (LocCollision){ 1, 1, 0, true, true, false };
+            bad++;
+        }
+        offset += length;
+    }
+
+    if (bad > 0) {
+        fprintf(stderr, "WARNING: %u loc definitions could not be decoded\n", bad);
+    }
+    return true;
+}
+
+/*
+ * decode_land - Tile flags of one region (TILE_FLAG_*)
+ *
+ * @return  false if the file is truncated
+ */
+static bool decode_land(const u8* data, u32 size,
+                        u8 flags[WORLD_COLLISION_LEVELS][WORLD_REGION_SIZE][WORLD_REGION_SIZE]) {
+    Reader r = { data, size, 0, false };
+
+    for (u32 level = 0; level < WORLD_COLLISION_LEVELS; level++) {
+        for (u32 x = 0; x < WORLD_REGION_SIZE; x++) {
+            for (u32 z = 0; z < WORLD_REGION_SIZE; z++) {
+                for (;;) {
+                    u32 op = read_g1(&r);
+                    if (r.overrun) return false;
+                    if (op == 0) break;
+                    if (op == 1) {
+                        read_g1(&r);
+                        break;
+                    }
+                    if (op <= 49) {
+                        read_g1(&r);
+                    } else if (op <= 81) {
+                        flags[level][x][z] = (u8)(op - 49);
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+/*
+ * apply_loc - Add one loc's collision, as the client's scene builder does
+ *
+ * @return  true if the loc blocks anything
+ */
+static bool apply_loc(CollisionMap* map, const LocCollision* loc, i32 x, i32 z, u32 shape, u32 rotation) {
+    if (!loc->blockwalk) return false;
+
+    if (shape == GROUNDDECOR) {
+        if (!loc->active) return false;
+        collisionmap_set_blocked(map, x, z);
+    } else if (shape == WALL_DIAGONAL || shape >= CENTREPIECE_STRAIGHT) {
+        /* Diagonal walls, centrepieces and roofs occupy their footprint */
+        collisionmap_add_loc(map, x, z, loc->width, loc->length, (int)rotation, loc->blockrange);
+    } else if (shape <= WALL_SQUARECORNER) {
+        collisionmap_add_wall(map, x, z, (int)shape, (int)rotation, loc->blockrange);
+    } else {
+        return false;  /* Wall decoration (4-8) never blocks */
+    }
+    return true;
+}
+
+/*
+ * decode_locs - Apply every loc in one region's loc file
+ *
+ * @param scratch  Per-level scratch maps covering the region
+ * @return         Locs that added collision, or -1 if the file is corrupt
+ *                 (locs before the corruption stay applied)
+ */
+static i32 decode_locs(const WorldCollision* collision, CollisionMap** scratch,
+                       const u8* data, u32 size, i32 origin_x, i32 origin_z,
+                       u8 flags[WORLD_COLLISION_LEVELS][WORLD_REGION_SIZE][WORLD_REGION_SIZE]) {
+    MapLocReader reader;
+    map_loc_reader_init(&reader, data, size);
+    i32 applied = 0;
+
+    MapLoc loc;
+    i32 status;
+    while ((status = map_loc_next(&reader, &loc)) > 0) {
+        i32 level = (i32)loc.level;
+        if (loc.id < 0 || (u32)loc.id >= collision->loc_count) continue;
+        if (flags[1][loc.x][loc.z] & TILE_FLAG_BRIDGE) level--;
+        if (level < 0) continue;
+
+        if (apply_loc(scratch[level], &collision->locs[loc.id],
+                      origin_x + (i32)loc.x, origin_z + (i32)loc.z, loc.shape, loc.rotation)) {
+            applied++;
+        }
+    }
+    return status < 0 ? -1 : applied;
+}
+
+/*
+ * pack_tile - CollisionMap flags → packed tile bits (TILE_*)
+ */
+static u16 pack_tile(int flags) {
+    u16 packed = (u16)(flags & (0xFF | TILE_LOC));
+    if (flags & 0x200000) packed |= TILE_BLOCKED;
+    return packed;
+}
+
+/*
+ * writable_tile - Tile in a page of its own, allocating the page
+ *
+ * @return  Tile, or NULL if the region has no map (BLOCKED stays shared)
+ *          or the page could not be allocated
+ */
+static u16* writable_tile(WorldCollision* collision, u32 level, i32 x, i32 z) {
+    if (x < 0 || z < 0 || x >= WORLD_REGIONS_PER_AXIS * WORLD_REGION_SIZE ||
+        z >= WORLD_REGIONS_PER_AXIS * WORLD_REGION_SIZE) return NULL;
+
+    u16* slot = &collision->page_index[level][(x >> 6) << 8 | (z >> 6)];
+    if (*slot == WORLD_PAGE_BLOCKED) return NULL;
+
+    if (*slot == WORLD_PAGE_OPEN) {
+        if (collision->page_count >= 0xFFFF) return NULL;
+        if (collision->page_count == collision->page_capacity) {
+            u32 capacity = collision->page_capacity * 2;
+            u16* grown = (u16*)realloc(collision->page_pool, (size_t)capacity * WORLD_PAGE_TILES * sizeof(u16));
+            if (!grown) return NULL;
+            collision->page_pool = grown;
+            collision->page_capacity = capacity;
+        }
+        memset(&collision->page_pool[(size_t)collision->page_count * WORLD_PAGE_TILES], 0,
+               WORLD_PAGE_TILES * sizeof(u16));
+        *slot = (u16)collision->page_count++;
+    }
+
+    return &collision->page_pool[(size_t)*slot * WORLD_PAGE_TILES + ((x & 63) << 6 | (z & 63))];
+}
+
+/*
+ * merge_scratch - OR every non-zero scratch tile into the pages
+ *
+ * Includes the border ring, so a wall on a region's edge also reaches
+ * the neighbouring region's page.
+ */
+static void merge_scratch(WorldCollision* collision, CollisionMap** scratch) {
+    for (u32 level = 0; level < WORLD_COLLISION_LEVELS; level++) {
+        CollisionMap* map = scratch[level];
+        for (i32 x = 0; x < map->sizeX; x++) {
+            for (i32 z = 0; z < map->sizeZ; z++) {
+                int flags = map->flags[x][z];
+                if (flags == 0) continue;
+                u16 packed = pack_tile(flags);
+                if (packed == 0) continue;
+                u16* tile = writable_tile(collision, level, map->offsetX + x, map->offsetZ + z);
+                if (tile) *tile |= packed;
+            }
+        }
+    }
+}
+
+/*
+ * build_region - Apply one region's land and loc files
+ *
+ * @return  false if the land file is corrupt (the caller blocks the region)
+ */
+static bool build_region(WorldCollision* collision, CollisionMap** scratch, const MapStore* store,
+                         i32 file_x, i32 file_z, u8** buffer, u32* capacity) {
+    i32 origin_x = file_x * WORLD_REGION_SIZE;
+    i32 origin_z = file_z * WORLD_REGION_SIZE;
+
+    const MapFile* land = map_store_get(store, MAP_FILE_LAND, file_x, file_z);
+    const MapFile* locs = map_store_get(store, MAP_FILE_LOC, file_x, file_z);
+
+    static u8 flags[WORLD_COLLISION_LEVELS][WORLD_REGION_SIZE][WORLD_REGION_SIZE];
+    memset(flags, 0, sizeof(flags));
+
+    u32 size = map_file_unpack(land, buffer, capacity);
+    if (size == 0 || !decode_land(*buffer, size, flags)) {
+        fprintf(stderr, "WARNING: Corrupt land file m%d_%d, region left blocked\n", file_x, file_z);
+        return false;
+    }
+
+    /* Scratch covers the region plus one tile on every side, all clear */
+    for (u32 level = 0; level < WORLD_COLLISION_LEVELS; level++) {
+        CollisionMap* map = scratch[level];
+        map->offsetX = origin_x - 1;
+        map->offsetZ = origin_z - 1;
+        for (i32 x = 0; x < map->sizeX; x++) {
+            memset(map->flags[x], 0, (size_t)map->sizeZ * sizeof(int));
+        }
+    }
+
+    for (i32 level = 0; level < WORLD_COLLISION_LEVELS; level++) {
+        for (i32 x = 0; x < WORLD_REGION_SIZE; x++) {
+            for (i32 z = 0; z < WORLD_REGION_SIZE; z++) {
+                if (!(flags[level][x][z] & TILE_FLAG_BLOCKED)) continue;
+                i32 target = level;
+                if (flags[1][x][z] & TILE_FLAG_BRIDGE) target--;
+                if (target < 0) continue;
+                collisionmap_set_blocked(scratch[target], origin_x + x, origin_z + z);
+            }
+        }
+    }
+
+    if (locs) {
+        size = map_file_unpack(locs, buffer, capacity);
+        i32 applied = size > 0 ? decode_locs(collision, scratch, *buffer, size, origin_x, origin_z, flags) : -1;
+        if (applied < 0) {
+            fprintf(stderr, "WARNING: Corrupt loc file l%d_%d, some objects have no collision\n",
+                    file_x, file_z);
+        } else {
+            collision->loc_count_applied += (u32)applied;
+        }
+    }
+
+    merge_scratch(collision, scratch);
+    collision->regions++;
+    return true;
+}
+
+WorldCollision* world_collision_create(const MapStore* store, CacheSystem* cache) {
+    if (!store || !cache) return NULL;
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    WorldCollision* collision = (WorldCollision*)calloc(1, sizeof(WorldCollision));
+    if (!collision) return NULL;
+
+    if (!load_locs(collision, cache)) {
+        fprintf(stderr, "WARNING: No loc definitions, server paths ignore scenery\n");
+        world_collision_destroy(collision);
+        return NULL;
+    }
+
+    /* The two shared pages; page_index is already all BLOCKED (0) */
+    collision->page_capacity = 64;
+    collision->page_pool = (u16*)malloc((size_t)collision->page_capacity * WORLD_PAGE_TILES * sizeof(u16));
+    CollisionMap* scratch[WORLD_COLLISION_LEVELS] = { NULL };
+    for (u32 level = 0; level < WORLD_COLLISION_LEVELS; level++) {
+        scratch[level] = collisionmap_new(WORLD_REGION_SIZE + 2, WORLD_REGION_SIZE + 2);
+    }
+    if (!collision->page_pool) {
+        for (u32 level = 0; level < WORLD_COLLISION_LEVELS; level++) collisionmap_free(scratch[level]);
+        world_collision_destroy(collision);
+        return NULL;
+    }
+    for (u32 i = 0; i < WORLD_PAGE_TILES; i++) {
+        collision->page_pool[WORLD_PAGE_BLOCKED * WORLD_PAGE_TILES + i] = TILE_ALL;
+        collision->page_pool[WORLD_PAGE_OPEN * WORLD_PAGE_TILES + i] = 0;
+    }
+    collision->page_count = 2;
+
+    /* Every mapped region starts OPEN, so neighbours can write its border */
+    for (i32 fx = 0; fx < WORLD_REGIONS_PER_AXIS; fx++) {
+        for (i32 fz = 0; fz < WORLD_REGIONS_PER_AXIS; fz++) {
+            if (!map_store_get(store, MAP_FILE_LAND, fx, fz)) continue;
+            for (u32 level = 0; level < WORLD_COLLISION_LEVELS; level++) {
+                collision->page_index[level][fx << 8 | fz] = WORLD_PAGE_OPEN;
+            }
+        }
+    }
+
+    u8* buffer = NULL;
+    u32 capacity = 0;
+    for (i32 fx = 0; fx < WORLD_REGIONS_PER_AXIS; fx++) {
+        for (i32 fz = 0; fz < WORLD_REGIONS_PER_AXIS; fz++) {
+            if (collision->page_index[0][fx << 8 | fz] == WORLD_PAGE_BLOCKED) continue;
+            if (build_region(collision, scratch, store, fx, fz, &buffer, &capacity)) continue;
+            for (u32 level = 0; level < WORLD_COLLISION_LEVELS; level++) {
+                collision->page_index[level][fx << 8 | fz] = WORLD_PAGE_BLOCKED;
+            }
+        }
+    }
+    free(buffer);
+    for (u32 level = 0; level < WORLD_COLLISION_LEVELS; level++) collisionmap_free(scratch[level]);
+
+    /* Give back the unused tail of the page pool */
+    u16* fitted = (u16*)realloc(collision->page_pool, (size_t)collision->page_count * WORLD_PAGE_TILES * sizeof(u16));
+    if (fitted) {
+        collision->page_pool = fitted;
+        collision->page_capacity = collision->page_count;
+    }
+    collision->pages = collision->page_pool;
+    collision->base_page_count = collision->page_count;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    u64 bytes = sizeof(collision->page_index) + (u64)collision->page_count * WORLD_PAGE_TILES * sizeof(u16);
+    printf("World collision built: %u regions, %u locs, %u loc types, %u pages (%llu KB) in %ld ms\n",
+           collision->regions, collision->loc_count_applied, collision->loc_count,
+           collision->page_count, (unsigned long long)(bytes / 1024),
+           (long)((end.tv_sec - start.tv_sec) * 1000 + (end.tv_nsec - start.tv_nsec) / 1000000));
+    return collision;
+}
+
+WorldCollision* world_collision_create_from_snapshot(const Snapshot* snapshot) {
+    u32 index_count = 0, page_count = 0;
+    const u16* index = snapshot_section(snapshot, SNAPSHOT_COLLISION_INDEX, sizeof(u16), &index_count);
+    const u16* pages = snapshot_section(snapshot, SNAPSHOT_COLLISION_PAGES,
+                                        WORLD_PAGE_TILES * sizeof(u16), &page_count);
+    if (!index || !pages || index_count != WORLD_COLLISION_LEVELS * WORLD_REGIONS_PER_AXIS * WORLD_REGIONS_PER_AXIS ||
+        page_count < 2 || page_count > 0xFFFF) {
+        return NULL;
+    }
+
+    WorldCollision* collision = (WorldCollision*)calloc(1, sizeof(WorldCollision));
+    if (!collision) return NULL;
+    memcpy(collision->page_index, index, sizeof(collision->page_index));
+
+    /* world_collision_flags() does not bounds-check: every entry must name a page */
+    const u16* entry = &collision->page_index[0][0];
+    for (u32 i = 0; i < index_count; i++) {
+        if (entry[i] >= page_count) {
+            free(collision);
+            return NULL;
+        }
+    }
+
+    collision->pages = pages;
+    collision->page_count = page_count;
+    collision->page_capacity = page_count;
+    collision->base_page_count = page_count;
+    printf("World collision mapped from the snapshot: %u pages\n", page_count);
+    return collision;
+}
+
+bool world_collision_snapshot(const WorldCollision* collision, SnapshotWriter* writer) {
+    if (!collision || !writer || !collision->pages) return false;
+    snapshot_writer_set(writer, SNAPSHOT_COLLISION_INDEX, collision->page_index, sizeof(u16),
+                        WORLD_COLLISION_LEVELS * WORLD_REGIONS_PER_AXIS * WORLD_REGIONS_PER_AXIS);
+    snapshot_writer_set(writer, SNAPSHOT_COLLISION_PAGES, collision->pages,
+                        WORLD_PAGE_TILES * sizeof(u16), collision->page_count);
+    return true;
+}
+
+void world_collision_destroy(WorldCollision* collision) {
+    if (!collision) return;
+    free(collision->page_pool);
+    free(collision->free_pages);
+    free(collision->locs);
+    free(collision);
+}
+
+bool world_collision_mapped(const WorldCollision* collision, u32 level, i32 x, i32 z) {
+    if (!collision) return false;
+    u32 ux = (u32)x & 0x3FFF;
+    u32 uz = (u32)z & 0x3FFF;
+    return collision->page_index[level & 3][(ux >> 6) << 8 | (uz >> 6)] != WORLD_PAGE_BLOCKED;
+}
+
+/*******************************************************************************
+ * PRIVATE PAGES
+ ******************************************************************************/
+
+/*
+ * private_pool - Make room for one more page in an owned pool
+ *
+ * A mapped collision gets its pool here: the mapped pages are copied
+ * once, and pages points at the heap copy from then on.
+ */
+static bool private_pool(WorldCollision* collision) {
+    size_t page_bytes = WORLD_PAGE_TILES * sizeof(u16);
+    if (!collision->page_pool) {
+        u32 capacity = collision->page_count + 64;
+        u16* pool = (u16*)malloc((size_t)capacity * page_bytes);
+        if (!pool) return false;
+        memcpy(pool, collision->pages, (size_t)collision->page_count * page_bytes);
+        collision->page_pool = pool;
+        collision->page_capacity = capacity;
+        collision->pages = pool;
+    }
+    if (collision->page_count == collision->page_capacity) {
+        u32 capacity = collision->page_capacity * 2;
+        u16* grown = (u16*)realloc(collision->page_pool, (size_t)capacity * page_bytes);
+        if (!grown) return false;
+        collision->page_pool = grown;
+        collision->page_capacity = capacity;
+        collision->pages = grown;
+    }
+    return true;
+}
+
+/*
+ * private_page - A new private page holding a copy of tiles
+ *
+ * @return  Page number, or WORLD_PAGE_BLOCKED if none could be had
+ *
+ * tiles may point into the pool: it is copied before the pool can move.
+ */
+static u16 private_page(WorldCollision* collision, const u16* tiles) {
+    u16 copy[WORLD_PAGE_TILES];
+    memcpy(copy, tiles, sizeof(copy));
+
+    u32 page;
+    if (collision->free_page_count > 0) {
+        page = collision->free_pages[--collision->free_page_count];
+    } else {
+        if (collision->page_count >= 0xFFFF || !private_pool(collision)) return WORLD_PAGE_BLOCKED;
+        page = collision->page_count++;
+    }
+    memcpy(&collision->page_pool[(size_t)page * WORLD_PAGE_TILES], copy, sizeof(copy));
+    return (u16)page;
+}
+
+static void release_page(WorldCollision* collision, u16* slot) {
+    if (*slot >= collision->base_page_count) {
+        if (!collision->free_pages) {
+            collision->free_pages = (u16*)malloc(0x10000 * sizeof(u16));
+        }
+        /* Without the list the page is only lost until the next reload */
+        if (collision->free_pages) collision->free_pages[collision->free_page_count++] = *slot;
+    }
+    *slot = WORLD_PAGE_BLOCKED;
+}
+
+static inline u32 region_slot(u32 region_x, u32 region_z) {
+    return (region_x & 0xFF) << 8 | (region_z & 0xFF);
+}
+
+void world_collision_release_region(WorldCollision* collision, u32 region_x, u32 region_z) {
+    if (!collision) return;
+    for (u32 level = 0; level < WORLD_COLLISION_LEVELS; level++) {
+        release_page(collision, &collision->page_index[level][region_slot(region_x, region_z)]);
+    }
+    collision->revision++;
+}
+
+bool world_collision_share_region(WorldCollision* collision, u32 region_x, u32 region_z,
+                                  u32 source_x, u32 source_z) {
+    if (!collision) return false;
+    world_collision_release_region(collision, region_x, region_z);
+
+    for (u32 level = 0; level < WORLD_COLLISION_LEVELS; level++) {
+        u16 page = collision->page_index[level][region_slot(source_x, source_z)];
+        if (page >= collision->base_page_count) {
+            page = private_page(collision, &collision->pages[(size_t)page * WORLD_PAGE_TILES]);
+            if (page == WORLD_PAGE_BLOCKED) {
+                world_collision_release_region(collision, region_x, region_z);
+                return false;
+            }
+        }
+        collision->page_index[level][region_slot(region_x, region_z)] = page;
+    }
+    return true;
+}
+
+bool world_collision_modify(WorldCollision* collision, u32 level, i32 x, i32 z,
+                            u16 add, u16 remove) {
+    if (!collision || x < 0 || z < 0 || x >= WORLD_REGIONS_PER_AXIS * WORLD_REGION_SIZE ||
+        z >= WORLD_REGIONS_PER_AXIS * WORLD_REGION_SIZE) {
+        return false;
+    }
+
+    u16* slot = &collision->page_index[level & 3][region_slot((u32)x >> 6, (u32)z >> 6)];
+    if (*slot == WORLD_PAGE_BLOCKED) return false;
+    if (*slot < collision->base_page_count) {
+        u16 page = private_page(collision, &collision->pages[(size_t)*slot * WORLD_PAGE_TILES]);
+        if (page == WORLD_PAGE_BLOCKED) return false;
+        *slot = page;
+    }
+
+    u16* tile = &collision->page_pool[(size_t)*slot * WORLD_PAGE_TILES + ((x & 63) << 6 | (z & 63))];
+    *tile = (u16)((*tile | add) & ~remove);
+    collision->revision++;
+    return true;
+}
+
+bool world_collision_keep_private(WorldCollision* collision, const WorldCollision* from,
+                                  u32 region_x, u32 region_z) {
+    if (!collision || !from) return false;
+    for (u32 level = 0; level < WORLD_COLLISION_LEVELS; level++) {
+        u16 old = from->page_index[level][region_slot(region_x, region_z)];
+        if (old < from->base_page_count) continue;
+
+        u16* slot = &collision->page_index[level][region_slot(region_x, region_z)];
+        u16 page = private_page(collision, &from->pages[(size_t)old * WORLD_PAGE_TILES]);
+        if (page == WORLD_PAGE_BLOCKED) return false;
+        release_page(collision, slot);
+        *slot = page;
+    }
+    return true;
+}
@@ -0,0 +1,334 @@
+/*******************************************************************************
+ * WORLD_COLLISION.H - Server-Side Collision, Paged and Packed per Region
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Reusing one data model on both ends of a protocol (client CollisionMap)
+ *   - Decoding compact binary formats (smart integers, opcode streams)
+ *   - Sparse storage: a page table over fixed-size pages
+ *   - Bit packing: keeping only the bits the queries need
+ *   - Sentinel pages instead of NULL checks (branch-free lookups)
+ *
+ * THE PROBLEM:
+ *
+ * The client knows where every wall, tree and table is: it builds a
+ * CollisionMap (collisionmap.h) for the 104x104 scene around the player
+ * and runs its own BFS before sending a path. The server needs the same
+ * knowledge for the whole world, but a CollisionMap is an int per tile
+ * over a rectangle: the 225 world's bounding box is ~14M tiles per
+ * level, 222MB for four levels, most of it ocean and empty upper floors.
+ *
+ * THE SOLUTION - PAGES OF PACKED TILES:
+ *
+ *   page_index[level][region]            pages (8KB each)
+ *   ┌──────────────────────────┐         ┌──────────────────────┐
+ *   │ (50,50) ─────────────────┼───────→ │ 2: Lumbridge level 0 │
+ *   │ (50,51) ─────────────────┼───────→ │ 3: ...               │
+ *   │ (12,80) → 0 (no map) ────┼───┐     │ ...                  │
+ *   │ (50,50) level 3 → 1 ─────┼─┐ │     ├──────────────────────┤
+ *   └──────────────────────────┘ │ └───→ │ 0: BLOCKED (shared)  │
+ *      region = x >> 6, z >> 6   └─────→ │ 1: OPEN    (shared)  │
+ *                                        └──────────────────────┘
+ *
+ *   - A page is one 64x64 region on one level: 4096 tiles x 16 bits.
+ *   - Pages exist only for regions with a land file, and only on levels
+ *     where something blocks; an empty upper floor shares the OPEN page.
+ *   - Every other region (sea, unmapped) shares the BLOCKED page.
+ *
+ * Every index points at a real page, so a lookup is two loads and no
+ * branch, whichever page boundary the search crosses:
+ *
+ *   flags = pages[page_index[level][(x >> 6) << 8 | z >> 6] * 4096
+ *                 + ((x & 63) << 6 | (z & 63))]
+ *
+ * PACKED TILE (16 bits; CollisionMap equivalent in brackets):
+ *
+ *   bit 0-7   walls on the tile's edges and corners   [0x1 - 0x80]
+ *   bit 8     occupied by a loc                       [0x100]
+ *   bit 9     floor blocked                           [0x200000]
+ *
+ *   Projectile (blockrange) bits are not kept: nothing on the server
+ *   tests line of sight yet. There are spare bits when it does.
+ *
+ * MEMORY (225 world):
+ *   page index   4 levels x 65536 x 2 bytes           512KB
+ *   pages        ~8KB per mapped region and level     ~6MB
+ *   vs. 222MB as dense CollisionMaps.
+ *
+ * BUILDING:
+ *   Each region is still built with the client's collisionmap_* code,
+ *   on a scratch CollisionMap one tile larger than the region on every
+ *   side (walls on an edge also mark the neighbouring tile), then packed
+ *   and ORed into the pages:
+ *
+ *   m<x>_<z> (land):  tile flag 1 (blocked)       → collisionmap_set_blocked
+ *   l<x>_<z> (locs):  walls (shapes 0-3)          → collisionmap_add_wall
+ *                     diagonal walls, centrepieces,
+ *                     roofs (9-21)                → collisionmap_add_loc
+ *                     active ground decor (22)    → collisionmap_set_blocked
+ *                     wall decoration (4-8)       → no collision
+ *
+ *   Loc sizes and blockwalk come from loc.dat in the config archive (only
+ *   the fields collision needs are kept).
+ *
+ * BRIDGES:
+ *   A tile whose level-1 flags have bit 2 set is a bridge: everything on
+ *   it is moved down one level, so the deck is walkable on level 0 and
+ *   the river below it is not.
+ *
+ * THREAD SAFETY:
+ *   Built once by world_collision_create() and only read afterwards, so
+ *   any number of threads (or worlds) may share one.
+ *
+ ******************************************************************************/
+
+#ifndef WORLD_COLLISION_H
+#define WORLD_COLLISION_H
+
+#include "types.h"
+#include "map_store.h"
+#include "cache.h"
+#include "snapshot.h"
+#include <stdbool.h>
+
+/* Height levels with their own pages */
+#define WORLD_COLLISION_LEVELS 4
+
+/* Tiles along one side of a map region (= one page) */
+#define WORLD_REGION_SIZE 64
+
+/* Tiles in one page */
+#define WORLD_PAGE_TILES (WORLD_REGION_SIZE * WORLD_REGION_SIZE)
+
+/* Regions along one axis: coordinates are 14 bits (see coord_pack) */
+#define WORLD_REGIONS_PER_AXIS 256
+
+/* Shared pages every unloaded (or empty) page index points at */
+#define WORLD_PAGE_BLOCKED 0
+#define WORLD_PAGE_OPEN    1
+
+/*
+ * Packed tile bits (see PACKED TILE above)
+ */
+#define TILE_WALL_NORTH_WEST 0x001
+#define TILE_WALL_NORTH      0x002
+#define TILE_WALL_NORTH_EAST 0x004
+#define TILE_WALL_EAST       0x008
+#define TILE_WALL_SOUTH_EAST 0x010
+#define TILE_WALL_SOUTH      0x020
+#define TILE_WALL_SOUTH_WEST 0x040
+#define TILE_WALL_WEST       0x080
+#define TILE_LOC             0x100
+#define TILE_BLOCKED         0x200
+#define TILE_ALL             0x3FF
+
+/*
+ * Step masks - Bits of the tile being entered that forbid a step
+ *
+ * Stepping west enters a tile through its east edge, so its east wall
+ * blocks, as does anything occupying it. Diagonal steps additionally
+ * need both cardinal steps they cut between to be open (the client's
+ * client_try_move() masks, packed).
+ */
+#define STEP_BLOCK_WEST       (TILE_WALL_EAST | TILE_LOC | TILE_BLOCKED)
+#define STEP_BLOCK_EAST       (TILE_WALL_WEST | TILE_LOC | TILE_BLOCKED)
+#define STEP_BLOCK_SOUTH      (TILE_WALL_NORTH | TILE_LOC | TILE_BLOCKED)
+#define STEP_BLOCK_NORTH      (TILE_WALL_SOUTH | TILE_LOC | TILE_BLOCKED)
+#define STEP_BLOCK_SOUTH_WEST (TILE_WALL_NORTH | TILE_WALL_NORTH_EAST | TILE_WALL_EAST | TILE_LOC | TILE_BLOCKED)
+#define STEP_BLOCK_SOUTH_EAST (TILE_WALL_NORTH_WEST | TILE_WALL_NORTH | TILE_WALL_WEST | TILE_LOC | TILE_BLOCKED)
+#define STEP_BLOCK_NORTH_WEST (TILE_WALL_EAST | TILE_WALL_SOUTH_EAST | TILE_WALL_SOUTH | TILE_LOC | TILE_BLOCKED)
+#define STEP_BLOCK_NORTH_EAST (TILE_WALL_SOUTH | TILE_WALL_SOUTH_WEST | TILE_WALL_WEST | TILE_LOC | TILE_BLOCKED)
+
+/*
+ * PRIVATE PAGES (copy-on-write, for instance.h):
+ *
+ * A region can be made to share another region's pages by copying four
+ * page_index entries, so a copy of a mapsquare costs 8 bytes and no tile
+ * is touched. The first write to a shared page gives the writing region
+ * a private copy (8KB) and only that entry is repointed:
+ *
+ *   page_index[0][instance] ─┐                    ┌→ base page 812
+ *   page_index[0][base] ─────┴→ 812   write →     │
+ *                                                 └─ page_index[0][instance] → 3001 (copy)
+ *
+ * Private pages come from the same pool as the built ones, so
+ * world_collision_flags() stays two loads with no branch. A collision
+ * mapped from the snapshot has no pool: the first private page copies
+ * the mapped pages onto the heap once (~6MB) and they live there after.
+ *
+ * Game thread only, between the parallel phases: growing the pool moves
+ * it. A snapshot is written before any instance exists.
+ */
+
+/*
+ * LocCollision - The part of a loc definition collision needs
+ */
+typedef struct {
+    u8 width;               /* Tiles along x at rotation 0 */
+    u8 length;              /* Tiles along z at rotation 0 */
+    u8 forceapproach;       /* Sides it may not be approached from */
+    bool blockwalk;         /* Blocks movement */
+    bool blockrange;        /* Blocks projectiles */
+    bool active;            /* Has options (ground decor only blocks if so) */
+} LocCollision;
+
+/*
+ * WorldCollision - Page table, pages, and the loc table
+ */
+typedef struct {
+    u16 page_index[WORLD_COLLISION_LEVELS][WORLD_REGIONS_PER_AXIS * WORLD_REGIONS_PER_AXIS];
+    const u16* pages;       /* page_count x WORLD_PAGE_TILES packed tiles */
+    u16* page_pool;         /* pages while building (owned); NULL if mapped */
+    u32 page_count;         /* Including the two shared pages */
+    u32 page_capacity;
+
+    /* Pages [0, base_page_count) are the world as built or mapped, never
+     * written again. Pages past it are private copies (see PRIVATE
+     * PAGES), each named by exactly one page_index entry */
+    u32 base_page_count;
+    u16* free_pages;        /* Released private pages, reused first */
+    u32 free_page_count;
+
+    LocCollision* locs;     /* Indexed by loc id */
+    u32 loc_count;
+
+    u32 regions;            /* Regions applied */
+    u32 loc_count_applied;  /* Locs that added collision */
+
+    /* Bumped by every change after the build (modify, region release):
+     * caches derived from the flags (wander.h) refill when it moves */
+    u32 revision;
+} WorldCollision;
+
+/*
+ * g_world_collision - Collision for the loaded world, or NULL
+ *
+ * NULL when there are no map files or loc definitions: movement then
+ * falls back to obstacle-free paths (movement_naive_path).
+ */
+extern WorldCollision* g_world_collision;
+
+/*
+ * world_collision_create - Build every mapped region's pages
+ *
+ * @param store  Map files (g_map_store)
+ * @param cache  Cache holding loc.dat / loc.idx in the config archive
+ * @return       Collision, or NULL if store/cache is missing, there are
+ *               no loc definitions, or allocation fails
+ *
+ * Corrupt map files are skipped with a warning; the rest still load.
+ *
+ * COMPLEXITY: O(map bytes + mapped tiles)
+ */
+WorldCollision* world_collision_create(const MapStore* store, CacheSystem* cache);
+
+/*
+ * world_collision_create_from_snapshot - Use a snapshot's pages as they are
+ *
+ * @param snapshot  Validated snapshot (must outlive the collision)
+ * @return          Collision, or NULL if the sections are missing or the
+ *                  index names a page that is not there
+ *
+ * The page index (512KB) is copied; the pages are used in place. The loc
+ * table is not kept: only building needs it.
+ *
+ * COMPLEXITY: O(page index entries), no decoding
+ */
+WorldCollision* world_collision_create_from_snapshot(const Snapshot* snapshot);
+
+/*
+ * world_collision_snapshot - Add the page index and pages to a writer
+ */
+bool world_collision_snapshot(const WorldCollision* collision, SnapshotWriter* writer);
+
+/*
+ * world_collision_destroy - Free the pages and the loc table
+ *
+ * @param collision  Collision to free (NULL-safe)
+ */
+void world_collision_destroy(WorldCollision* collision);
+
+/*
+ * world_collision_flags - Packed flags of one tile (TILE_*)
+ *
+ * @param collision  Collision (not NULL)
+ * @param level      Height level (taken & 3)
+ * @param x, z       World tile (taken modulo 16384, like coord_pack)
+ * @return           Flags; TILE_ALL in regions without a map
+ *
+ * No branches: the hot loop of the pathfinder.
+ *
+ * COMPLEXITY: O(1), two dependent loads
+ */
+static inline u16 world_collision_flags(const WorldCollision* collision, u32 level, i32 x, i32 z) {
+    u32 ux = (u32)x & 0x3FFF;
+    u32 uz = (u32)z & 0x3FFF;
+    u32 page = collision->page_index[level & 3][(ux >> 6) << 8 | (uz >> 6)];
+    return collision->pages[page * WORLD_PAGE_TILES + ((ux & 63) << 6 | (uz & 63))];
+}
+
+/*
+ * world_collision_share_region - Point a region at another region's pages
+ *
+ * @param collision  Collision
+ * @param region_x   Region to set (x >> 6)
+ * @param region_z
+ * @param source_x   Region whose pages it gets
+ * @param source_z
+ * @return           false if a private page of the source could not be
+ *                   copied (the region is then released)
+ *
+ * Base pages are shared; a source page that is itself private is copied,
+ * since a private page belongs to one region. Whatever private pages the
+ * region held before are released.
+ *
+ * COMPLEXITY: O(levels) for base pages
+ */
+bool world_collision_share_region(WorldCollision* collision, u32 region_x, u32 region_z,
+                                  u32 source_x, u32 source_z);
+
+/*
+ * world_collision_modify - Set and clear bits of one tile, copying on write
+ *
+ * @param collision  Collision
+ * @param level      Height level 0-3
+ * @param x, z       World tile
+ * @param add        TILE_* bits to set
+ * @param remove     TILE_* bits to clear
+ * @return           false if the region has no map or no page could be
+ *                   allocated
+ *
+ * COMPLEXITY: O(1), plus one 8KB copy on the first write to a shared page
+ */
+bool world_collision_modify(WorldCollision* collision, u32 level, i32 x, i32 z,
+                            u16 add, u16 remove);
+
+/*
+ * world_collision_keep_private - Carry a region's private pages over
+ *
+ * @param collision  Collision to write (a freshly rebuilt one)
+ * @param from       Collision the region was modified in
+ *
+ * Every level the region had a private page for in from gets a private
+ * copy of that page here; its other levels are left as they are. Used to
+ * keep instances' changes across a map reload.
+ */
+bool world_collision_keep_private(WorldCollision* collision, const WorldCollision* from,
+                                  u32 region_x, u32 region_z);
+
+/*
+ * world_collision_release_region - Unmap a region, freeing its private pages
+ *
+ * The region reads as BLOCKED afterwards.
+ */
+void world_collision_release_region(WorldCollision* collision, u32 region_x, u32 region_z);
+
+/*
+ * world_collision_mapped - Whether a tile's region has a map
+ *
+ * @return  false for NULL collision or a region on the BLOCKED page
+ */
+bool world_collision_mapped(const WorldCollision* collision, u32 level, i32 x, i32 z);
+
+#endif /* WORLD_COLLISION_H */
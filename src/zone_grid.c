@@ -0,0 +1,210 @@
+/*******************************************************************************
+ * ZONE_GRID.C - Spatial Zone Index Implementation
+ *******************************************************************************
+ *
+ * PURPOSE:
+ *   Maintains a hashed 8x8-tile zone index of entities (players, NPCs) so
+ *   visibility code can ask "who is near (x, z)?" without scanning every
+ *   entity on the server.
+ *
+ * DATA STRUCTURE: Hash Buckets + Intrusive Doubly-Linked Lists
+ *
+ *   heads[]                 next[] / prev[] (indexed by entity)
+ *   ┌──────┐
+ *   │  ... │
+ *   │ b=17 │──→ [12] ⇄ [7] ⇄ [301] ──→ NONE
+ *   │  ... │
+ *   │ b=90 │──→ [44] ──→ NONE
+ *   │  ... │
+ *   └──────┘
+ *
+ *   Each entity also remembers (zone_x, zone_z) it was filed under so
+ *   that update() can detect zone crossings and query() can reject hash
+ *   collisions from distant zones that share a bucket.
+ *
+ * HASH FUNCTION:
+ *   bucket = (zx * 73856093 ^ zz * 19349663) & (BUCKETS - 1)
+ *
+ *   The two large primes are the classic spatial-hash constants; they
+ *   scatter neighbouring zones into unrelated buckets so a crowded city
+ *   does not pile into one chain.
+ *
+ ******************************************************************************/
+
+#include "zone_grid.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * zone_bucket - Hash zone coordinates to a bucket index
+ *
+ * @param zone_x  Zone X (tile x >> 3)
+ * @param zone_z  Zone Z (tile z >> 3)
+ * @return        Bucket index [0, ZONE_GRID_BUCKETS)
+ *
+ * COMPLEXITY: O(1) time
+ */
+static inline u32 zone_bucket(u32 zone_x, u32 zone_z) {
+    return ((zone_x * 73856093u) ^ (zone_z * 19349663u)) & (ZONE_GRID_BUCKETS - 1);
+}
+
+/*
+ * zone_grid_link - Push entity onto the head of its zone's bucket chain
+ *
+ * @param grid    Target grid
+ * @param index   Entity index (must not already be linked)
+ * @param zone_x  Zone X to file under
+ * @param zone_z  Zone Z to file under
+ */
+static void zone_grid_link(ZoneGrid* grid, u32 index, u32 zone_x, u32 zone_z) {
+    u32 bucket = zone_bucket(zone_x, zone_z);
+    u16 head = grid->heads[bucket];
+
+    grid->next[index] = head;
+    grid->prev[index] = ZONE_GRID_NONE;
+    if (head != ZONE_GRID_NONE) {
+        grid->prev[head] = (u16)index;
+    }
+    grid->heads[bucket] = (u16)index;
+
+    grid->zone_x[index] = (u16)zone_x;
+    grid->zone_z[index] = (u16)zone_z;
+    grid->filed[index] = zone_grid_pack(zone_x << 3, zone_z << 3);
+    grid->linked[index] = true;
+    grid->count++;
+}
+
+/*
+ * zone_grid_unlink - Remove entity from its current bucket chain
+ *
+ * @param grid   Target grid
+ * @param index  Entity index (must be linked)
+ *
+ * ALGORITHM (standard doubly-linked removal):
+ *   prev ─→ [index] ─→ next      becomes      prev ─→ next
+ *   If index was the head, the bucket head moves to next.
+ */
+static void zone_grid_unlink(ZoneGrid* grid, u32 index) {
+    u16 prev = grid->prev[index];
+    u16 next = grid->next[index];
+
+    if (prev != ZONE_GRID_NONE) {
+        grid->next[prev] = next;
+    } else {
+        grid->heads[zone_bucket(grid->zone_x[index], grid->zone_z[index])] = next;
+    }
+    if (next != ZONE_GRID_NONE) {
+        grid->prev[next] = prev;
+    }
+
+    grid->next[index] = ZONE_GRID_NONE;
+    grid->prev[index] = ZONE_GRID_NONE;
+    grid->filed[index] = ZONE_GRID_UNFILED;
+    grid->linked[index] = false;
+    grid->count--;
+}
+
+ZoneGrid* zone_grid_create(u32 capacity) {
+    /* Entity indices must fit in u16 with NONE reserved */
+    if (capacity == 0 || capacity >= ZONE_GRID_NONE) return NULL;
+
+    ZoneGrid* grid = calloc(1, sizeof(ZoneGrid));
+    if (!grid) return NULL;
+
+    grid->next = malloc(capacity * sizeof(u16));
+    grid->prev = malloc(capacity * sizeof(u16));
+    grid->zone_x = calloc(capacity, sizeof(u16));
+    grid->zone_z = calloc(capacity, sizeof(u16));
+    grid->linked = calloc(capacity, sizeof(bool));
+    grid->filed = malloc(capacity * sizeof(u32));
+    if (!grid->next || !grid->prev || !grid->zone_x || !grid->zone_z || !grid->linked ||
+        !grid->filed) {
+        zone_grid_destroy(grid);
+        return NULL;
+    }
+
+    /* 0xFF bytes → every u16 becomes ZONE_GRID_NONE */
+    memset(grid->heads, 0xFF, sizeof(grid->heads));
+    memset(grid->next, 0xFF, capacity * sizeof(u16));
+    memset(grid->prev, 0xFF, capacity * sizeof(u16));
+    for (u32 i = 0; i < capacity; i++) grid->filed[i] = ZONE_GRID_UNFILED;
+
+    grid->capacity = capacity;
+    grid->count = 0;
+    return grid;
+}
+
+void zone_grid_destroy(ZoneGrid* grid) {
+    if (!grid) return;
+    free(grid->next);
+    free(grid->prev);
+    free(grid->zone_x);
+    free(grid->zone_z);
+    free(grid->linked);
+    free(grid->filed);
+    free(grid);
+}
+
+void zone_grid_insert(ZoneGrid* grid, u32 index, const Position* pos) {
+    if (!grid || !pos || index >= grid->capacity) return;
+
+    if (grid->linked[index]) {
+        /* Already filed - treat as a move */
+        zone_grid_update(grid, index, pos);
+        return;
+    }
+    zone_grid_link(grid, index, position_get_zone_x(pos), position_get_zone_z(pos));
+}
+
+void zone_grid_remove(ZoneGrid* grid, u32 index) {
+    if (!grid || index >= grid->capacity || !grid->linked[index]) return;
+    zone_grid_unlink(grid, index);
+}
+
+bool zone_grid_update(ZoneGrid* grid, u32 index, const Position* pos) {
+    if (!grid || !pos || index >= grid->capacity) return false;
+
+    u32 zone_x = position_get_zone_x(pos);
+    u32 zone_z = position_get_zone_z(pos);
+
+    if (grid->linked[index]) {
+        /* Fast path: still inside the same 8x8 zone */
+        if (grid->zone_x[index] == zone_x && grid->zone_z[index] == zone_z) {
+            return false;
+        }
+        zone_grid_unlink(grid, index);
+    }
+    zone_grid_link(grid, index, zone_x, zone_z);
+    return true;
+}
+
+u32 zone_grid_query(const ZoneGrid* grid, u32 x, u32 z, u32 radius,
+                    u16* out, u32 max_out) {
+    if (!grid || !out || max_out == 0) return 0;
+
+    /*
+     * Convert the tile-space square [x-r, x+r] into a zone-space range.
+     * Clamp at 0 so positions near the map edge do not underflow.
+     */
+    u32 min_zone_x = (x > radius ? x - radius : 0) >> 3;
+    u32 min_zone_z = (z > radius ? z - radius : 0) >> 3;
+    u32 max_zone_x = (x + radius) >> 3;
+    u32 max_zone_z = (z + radius) >> 3;
+
+    u32 count = 0;
+    for (u32 zx = min_zone_x; zx <= max_zone_x; zx++) {
+        for (u32 zz = min_zone_z; zz <= max_zone_z; zz++) {
+            u16 index = grid->heads[zone_bucket(zx, zz)];
+
+            while (index != ZONE_GRID_NONE) {
+                /* Skip hash collisions from zones outside the range */
+                if (grid->zone_x[index] == zx && grid->zone_z[index] == zz) {
+                    out[count++] = index;
+                    if (count >= max_out) return count;
+                }
+                index = grid->next[index];
+            }
+        }
+    }
+    return count;
+}
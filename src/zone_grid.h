@@ -0,0 +1,227 @@
+/*******************************************************************************
+ * ZONE_GRID.H - Spatial Zone Index for Entity Visibility Queries
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Spatial hashing (bucketing entities by coarse grid cell)
+ *   - Intrusive doubly-linked lists (O(1) insert/remove without allocation)
+ *   - Incremental index maintenance (only touch entities that changed cell)
+ *   - Range queries over a uniform grid
+ *
+ * THE PROBLEM:
+ *
+ * Every tick, each player needs the list of other players within 15 tiles.
+ * The naive approach compares every viewer with every other player:
+ *
+ *   for each viewer (N):
+ *       for each other player (N):
+ *           if within 15 tiles: visible
+ *
+ *   N = 2000 players → 4,000,000 distance checks per 600ms tick
+ *
+ * When everyone stands in one city the work is unavoidable, but when
+ * players are spread across the map almost all of those checks fail.
+ *
+ * THE SOLUTION - ZONE BUCKETS:
+ *
+ * The world is already divided into 8x8 tile "zones" (position >> 3, see
+ * position_get_zone_x/z). We file each entity under its zone:
+ *
+ *   ┌────────┬────────┬────────┬────────┬────────┐
+ *   │ zone   │ zone   │ zone   │ zone   │ zone   │
+ *   │ 400,401│ 401,401│ 402,401│ 403,401│ 404,401│
+ *   ├────────┼────────┼────────┼────────┼────────┤
+ *   │        │  A  B  │        │        │        │
+ *   │        │        │   V    │   C    │        │  V = viewer
+ *   ├────────┼────────┼────────┼────────┼────────┤
+ *   │        │        │        │        │      D │
+ *   └────────┴────────┴────────┴────────┴────────┘
+ *
+ * A viewer sees 15 tiles in each direction, which spans at most 5 zones
+ * per axis (15 tiles = 1.875 zones, plus the viewer's own partial zone).
+ * A query therefore visits at most 5 x 5 = 25 buckets and only compares
+ * against the entities filed there.
+ *
+ * STORAGE LAYOUT:
+ *
+ * The world map is large (x, z up to 12800 → 1600 x 1600 zones), so a
+ * dense array of bucket heads would waste memory on empty ocean. Instead,
+ * zone coordinates are hashed into a fixed power-of-two number of buckets.
+ * Two distant zones may share a bucket; queries re-check the exact zone
+ * stored for each entity so collisions only cost time, never correctness.
+ *
+ *   heads[bucket] ─→ entity 12 ─→ entity 7 ─→ entity 301 ─→ NONE
+ *                       ↑             │
+ *                       └── prev ─────┘
+ *
+ * Links are stored in parallel arrays indexed by entity index (player PID
+ * or NPC index), so moving an entity between zones never allocates:
+ *   - unlink from old bucket:  O(1) via prev/next
+ *   - link into new bucket:    O(1) push to head
+ *
+ * INCREMENTAL MAINTENANCE:
+ *
+ * zone_grid_update() compares the entity's current zone against the zone
+ * it is filed under. Walking inside a zone (the common case) is a single
+ * comparison; only zone crossings touch the linked lists.
+ *
+ * COMPLEXITY:
+ *   - insert/remove/update:  O(1)
+ *   - query:                 O(25 + entities in those buckets)
+ *   - memory:                capacity * 14 bytes + buckets * 2 bytes
+ *
+ ******************************************************************************/
+
+#ifndef ZONE_GRID_H
+#define ZONE_GRID_H
+
+#include "types.h"
+#include "position.h"
+#include <stdbool.h>
+
+/*
+ * ZONE_GRID_BUCKETS - Number of hash buckets (must be a power of two)
+ *
+ * 4096 buckets comfortably covers every populated area of the map with
+ * few collisions while costing only 8KB for the head array.
+ */
+#define ZONE_GRID_BUCKETS 4096
+
+/*
+ * ZONE_GRID_NONE - Sentinel entity index meaning "no entity"
+ *
+ * Used for empty buckets and list terminators. 0xFFFF is outside the
+ * valid range of both player PIDs (1-2047) and NPC indices (0-8190).
+ */
+#define ZONE_GRID_NONE 0xFFFF
+
+/*
+ * ZONE_GRID_UNFILED - ZoneGrid.filed of an entity not in the grid
+ *
+ * Bit 31 is never set in a packed position (coord_pack uses bits 0-29),
+ * so an unfiled entity differs from every position it could stand on.
+ */
+#define ZONE_GRID_UNFILED 0x80000000u
+
+/*
+ * ZONE_GRID_PACKED_MASK - Bits of a packed position that name its zone
+ *
+ * coord_pack() puts x in bits 14-27 and z in bits 0-13; dropping the low
+ * 3 bits of each (the tile within the zone) and the level leaves the
+ * zone. Two packed positions are in the same zone exactly when
+ *
+ *   ((a ^ b) & ZONE_GRID_PACKED_MASK) == 0
+ *
+ * which is one XOR and one AND per entity, with no branch (see
+ * movement_batch.h).
+ */
+#define ZONE_GRID_PACKED_MASK (ZONE_GRID_UNFILED | (0x3ff8u << 14) | 0x3ff8u)
+
+/*
+ * ZoneGrid - Hashed zone buckets with intrusive per-entity links
+ *
+ * All per-entity arrays are indexed by entity index and sized to capacity.
+ */
+typedef struct {
+    u16 heads[ZONE_GRID_BUCKETS];  /* First entity in each bucket (or NONE) */
+    u16* next;                     /* Next entity in same bucket */
+    u16* prev;                     /* Previous entity in same bucket */
+    u16* zone_x;                   /* Zone X the entity is filed under */
+    u16* zone_z;                   /* Zone Z the entity is filed under */
+    bool* linked;                  /* Entity currently filed in the grid */
+    u32* filed;                    /* Zone filed under, packed (or UNFILED) */
+    u32 capacity;                  /* Number of entity indices supported */
+    u32 count;                     /* Number of entities currently filed */
+} ZoneGrid;
+
+/*
+ * zone_grid_pack - The zone bits of a tile in coord_pack() layout
+ *
+ * @param x  Tile X (taken modulo 16384, like coord_pack)
+ * @param z  Tile Z
+ * @return   coord_pack(0, x, z) with the tile within the zone cleared
+ */
+static inline u32 zone_grid_pack(u32 x, u32 z) {
+    return ((x & 0x3ff8u) << 14) | (z & 0x3ff8u);
+}
+
+/*
+ * zone_grid_create - Allocate an empty grid
+ *
+ * @param capacity  Number of entity indices (e.g. MAX_PLAYERS, MAX_NPCS)
+ * @return          Heap-allocated grid, or NULL on allocation failure
+ *
+ * COMPLEXITY: O(capacity) time (initializes link arrays)
+ */
+ZoneGrid* zone_grid_create(u32 capacity);
+
+/*
+ * zone_grid_destroy - Free grid and all link arrays
+ *
+ * @param grid  Grid to free (NULL-safe)
+ */
+void zone_grid_destroy(ZoneGrid* grid);
+
+/*
+ * zone_grid_insert - File entity under the zone containing pos
+ *
+ * @param grid   Target grid
+ * @param index  Entity index [0, capacity)
+ * @param pos    Entity's current position
+ *
+ * If the entity is already filed it is moved instead (same as update).
+ *
+ * COMPLEXITY: O(1) time
+ */
+void zone_grid_insert(ZoneGrid* grid, u32 index, const Position* pos);
+
+/*
+ * zone_grid_remove - Unlink entity from whatever zone it is filed under
+ *
+ * @param grid   Target grid
+ * @param index  Entity index (ignored if not filed)
+ *
+ * COMPLEXITY: O(1) time
+ */
+void zone_grid_remove(ZoneGrid* grid, u32 index);
+
+/*
+ * zone_grid_update - Refile entity if it has crossed a zone boundary
+ *
+ * @param grid   Target grid
+ * @param index  Entity index
+ * @param pos    Entity's current position
+ * @return       true if the entity changed zone (or was newly filed)
+ *
+ * USAGE:
+ *   Call after any position change (walking, running, teleporting).
+ *   Movement within the same 8x8 zone costs two comparisons.
+ *
+ * COMPLEXITY: O(1) time
+ */
+bool zone_grid_update(ZoneGrid* grid, u32 index, const Position* pos);
+
+/*
+ * zone_grid_query - Collect entities filed in zones near a position
+ *
+ * @param grid       Grid to search
+ * @param x          Center tile X
+ * @param z          Center tile Z
+ * @param radius     Search radius in tiles (e.g. 15 for player view)
+ * @param out        Output array of entity indices
+ * @param max_out    Capacity of out
+ * @return           Number of indices written
+ *
+ * RESULT SET:
+ *   Every entity whose zone overlaps [x-radius, x+radius] x [z-radius,
+ *   z+radius]. This is a superset of the entities within radius, so
+ *   callers still apply their exact visibility test (height, distance,
+ *   hidden flag). Order is by zone, then most-recently-filed first.
+ *
+ * COMPLEXITY: O(zones in range + entities in those zones)
+ */
+u32 zone_grid_query(const ZoneGrid* grid, u32 x, u32 z, u32 radius,
+                    u16* out, u32 max_out);
+
+#endif /* ZONE_GRID_H */
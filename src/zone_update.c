@@ -0,0 +1,580 @@
+/*******************************************************************************
+ * ZONE_UPDATE.C - Per-Zone Event Queues Encoded Once per Tick
+ *******************************************************************************
+ *
+ * See zone_update.h for the design.
+ *
+ * DATA LAYOUT:
+ *
+ *   loc_zones[]    dense array of LocZone, never shrinks; loc_table maps
+ *                  coord_pack(level, zone_x, zone_z) to an index
+ *   active[]       zones with events this tick; active_table maps keys to
+ *                  indices and is emptied at the end of the tick
+ *   events[]       this tick's sub-packets, chained per zone by index
+ *   blocks[]       this tick's encoded UPDATE_ZONE_PARTIAL_ENCLOSED
+ *                  payloads, sized before the first one is started
+ *
+ * Both tables are open addressing with linear probing, kept at most
+ * half full; nothing is ever deleted from one except by emptying it.
+ *
+ ******************************************************************************/
+
+#include "zone_update.h"
+#include "movement.h"  /* coord_pack */
+#include "packets.h"
+#include "mem_stats.h"
+#include <stdlib.h>
+#include <string.h>
+
+ZoneUpdateSystem* g_zone_updates = NULL;
+
+/* Layer replaced by each loc shape (the client's LOC_SHAPE_TO_LAYER) */
+static const u8 zone_shape_layer[ZONE_LOC_SHAPES] = {
+    0, 0, 0, 0, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 3
+};
+
+/*******************************************************************************
+ * ZONE TABLES
+ ******************************************************************************/
+
+static inline u32 slot_hash(u32 key) {
+    u32 h = key * 0x9E3779B1u;  /* Fibonacci hashing */
+    return h ^ (h >> 16);
+}
+
+static u32 slot_find(const ZoneSlot* table, u32 mask, u32 key) {
+    u32 i = slot_hash(key) & mask;
+    while (table[i].index != ZONE_NONE) {
+        if (table[i].key == key) return table[i].index;
+        i = (i + 1) & mask;
+    }
+    return ZONE_NONE;
+}
+
+static void slot_insert(ZoneSlot* table, u32 mask, u32 key, u32 index) {
+    u32 i = slot_hash(key) & mask;
+    while (table[i].index != ZONE_NONE) {
+        i = (i + 1) & mask;
+    }
+    table[i].key = key;
+    table[i].index = index;
+}
+
+static ZoneSlot* slot_table_new(u32 size) {
+    ZoneSlot* table = mem_alloc(MEM_OBJECT, size * sizeof(ZoneSlot));
+    if (table) memset(table, 0xFF, size * sizeof(ZoneSlot));  /* index = ZONE_NONE */
+    return table;
+}
+
+/*
+ * slot_reserve - Room for one more key, doubling the table past half full
+ */
+static bool slot_reserve(ZoneSlot** table, u32* mask, u32 count) {
+    u32 size = *mask + 1;
+    if ((count + 1) * 2 <= size) return true;
+
+    ZoneSlot* bigger = slot_table_new(size * 2);
+    if (!bigger) return false;
+    for (u32 i = 0; i < size; i++) {
+        if ((*table)[i].index != ZONE_NONE) {
+            slot_insert(bigger, size * 2 - 1, (*table)[i].key, (*table)[i].index);
+        }
+    }
+    mem_free(*table);
+    *table = bigger;
+    *mask = size * 2 - 1;
+    return true;
+}
+
+/*
+ * zone_grow - Make room for one more element of an array
+ *
+ * @return  The (possibly moved) array, or NULL with the old one intact
+ */
+static void* zone_grow(void* array, u32 count, u32* capacity, u32 size) {
+    if (count < *capacity) return array;
+    u32 grown = *capacity ? *capacity * 2 : 64;
+    void* moved = mem_realloc(MEM_OBJECT, array, (size_t)grown * size);
+    if (moved) *capacity = grown;
+    return moved;
+}
+
+static inline u32 zone_key(const Position* position) {
+    return coord_pack(position_height(position), position_get_zone_x(position), position_get_zone_z(position));
+}
+
+static inline u8 wire_tile(const Position* position) {
+    return (u8)(((position_x(position) & 7) << 4) | (position_z(position) & 7));
+}
+
+/*******************************************************************************
+ * LIFECYCLE
+ ******************************************************************************/
+
+ZoneUpdateSystem* zone_update_system_create(void) {
+    ZoneUpdateSystem* sys = mem_calloc(MEM_OBJECT, 1, sizeof(ZoneUpdateSystem));
+    if (!sys) return NULL;
+
+    sys->loc_table = slot_table_new(256);
+    sys->active_table = slot_table_new(256);
+    if (!sys->loc_table || !sys->active_table) {
+        zone_update_system_destroy(sys);
+        return NULL;
+    }
+    sys->loc_table_mask = 255;
+    sys->active_table_mask = 255;
+    return sys;
+}
+
+void zone_update_system_destroy(ZoneUpdateSystem* sys) {
+    if (!sys) return;
+    zone_update_end_tick(sys);
+    for (u32 i = 0; i < sys->loc_zone_count; i++) {
+        mem_free(sys->loc_zones[i].locs);
+    }
+    mem_free(sys->loc_zones);
+    mem_free(sys->loc_table);
+    mem_free(sys->active);
+    mem_free(sys->active_table);
+    mem_free(sys->events);
+    mem_free(sys->blocks);
+    mem_free(sys);
+}
+
+/*******************************************************************************
+ * QUEUEING
+ ******************************************************************************/
+
+/*
+ * zone_active_get - This tick's queue for a position's zone
+ *
+ * Remembers the zone's loc revision as it was before anything this tick
+ * changed it: a viewer holding that revision needs only the block.
+ */
+static ZoneActive* zone_active_get(ZoneUpdateSystem* sys, const Position* position) {
+    u32 key = zone_key(position);
+    u32 index = slot_find(sys->active_table, sys->active_table_mask, key);
+    if (index != ZONE_NONE) return &sys->active[index];
+
+    ZoneActive* active = zone_grow(sys->active, sys->active_count, &sys->active_capacity,
+                                   sizeof(ZoneActive));
+    if (!active) return NULL;
+    sys->active = active;
+    if (!slot_reserve(&sys->active_table, &sys->active_table_mask, sys->active_count)) {
+        return NULL;
+    }
+
+    index = sys->active_count++;
+    slot_insert(sys->active_table, sys->active_table_mask, key, index);
+
+    u32 loc_index = slot_find(sys->loc_table, sys->loc_table_mask, key);
+    ZoneActive* zone = &sys->active[index];
+    memset(zone, 0, sizeof(ZoneActive));
+    zone->key = key;
+    zone->zone_x = (u16)position_get_zone_x(position);
+    zone->zone_z = (u16)position_get_zone_z(position);
+    zone->level = (u8)position_height(position);
+    zone->first = ZONE_NONE;
+    zone->last = ZONE_NONE;
+    zone->loc_revision = loc_index == ZONE_NONE ? 0 : sys->loc_zones[loc_index].revision;
+    return zone;
+}
+
+/*
+ * zone_queue - Append one sub-packet (opcode first) to its zone's queue
+ */
+static void zone_queue(ZoneUpdateSystem* sys, const Position* position,
+                       const u8* bytes, u8 length) {
+    ZoneActive* zone = zone_active_get(sys, position);
+    if (!zone) return;
+
+    ZoneEvent* events = zone_grow(sys->events, sys->event_count, &sys->event_capacity,
+                                  sizeof(ZoneEvent));
+    if (!events) return;
+    sys->events = events;
+
+    u32 index = sys->event_count++;
+    ZoneEvent* event = &sys->events[index];
+    event->next = ZONE_NONE;
+    event->length = length;
+    memcpy(event->bytes, bytes, length);
+
+    if (zone->last == ZONE_NONE) {
+        zone->first = index;
+    } else {
+        sys->events[zone->last].next = index;
+    }
+    zone->last = index;
+}
+
+/*
+ * loc_zone_get - Index of a zone's changed locs, created on first use
+ */
+static u32 loc_zone_get(ZoneUpdateSystem* sys, u32 key) {
+    u32 index = slot_find(sys->loc_table, sys->loc_table_mask, key);
+    if (index != ZONE_NONE) return index;
+
+    LocZone* zones = zone_grow(sys->loc_zones, sys->loc_zone_count, &sys->loc_zone_capacity,
+                               sizeof(LocZone));
+    if (!zones) return ZONE_NONE;
+    sys->loc_zones = zones;
+    if (!slot_reserve(&sys->loc_table, &sys->loc_table_mask, sys->loc_zone_count)) {
+        return ZONE_NONE;
+    }
+
+    index = sys->loc_zone_count++;
+    memset(&sys->loc_zones[index], 0, sizeof(LocZone));
+    sys->loc_zones[index].key = key;
+    slot_insert(sys->loc_table, sys->loc_table_mask, key, index);
+    return index;
+}
+
+/*
+ * loc_record - Make a tile's layer hold loc_id (or nothing) from now on
+ */
+static void loc_record(ZoneUpdateSystem* sys, const Position* position, u8 info, u16 loc_id) {
+    u32 index = loc_zone_get(sys, zone_key(position));
+    if (index == ZONE_NONE) return;
+
+    LocZone* zone = &sys->loc_zones[index];
+    u8 tile = wire_tile(position);
+    u8 layer = zone_shape_layer[info >> 2];
+    ZoneLoc* loc = NULL;
+    for (u32 i = 0; i < zone->loc_count && !loc; i++) {
+        if (zone->locs[i].tile == tile && zone->locs[i].layer == layer) loc = &zone->locs[i];
+    }
+    if (!loc) {
+        ZoneLoc* locs = zone_grow(zone->locs, zone->loc_count, &zone->loc_capacity,
+                                  sizeof(ZoneLoc));
+        if (!locs) return;
+        zone->locs = locs;
+        loc = &zone->locs[zone->loc_count++];
+        loc->tile = tile;
+        loc->layer = layer;
+    }
+    loc->info = info;
+    loc->loc_id = loc_id;
+    zone->revision++;
+    sys->loc_changes++;
+}
+
+/* LOC_ADD or LOC_DEL in wire form; returns its length */
+static u8 loc_wire(u8* bytes, u8 tile, u8 info, u16 loc_id) {
+    bytes[1] = tile;
+    bytes[2] = info;
+    if (loc_id == ZONE_LOC_REMOVED) {
+        bytes[0] = SERVER_LOC_DEL;
+        return 1 + SERVER_LOC_DEL_SIZE;
+    }
+    bytes[0] = SERVER_LOC_ADD;
+    bytes[3] = (u8)(loc_id >> 8);
+    bytes[4] = (u8)loc_id;
+    return 1 + SERVER_LOC_ADD_SIZE;
+}
+
+static void zone_loc_change(ZoneUpdateSystem* sys, const Position* position, u16 loc_id,
+                            u8 shape, u8 angle) {
+    if (!sys || !position || shape >= ZONE_LOC_SHAPES) return;
+    u8 info = ZONE_LOC_INFO(shape, angle);
+    u8 bytes[8];
+    u8 length = loc_wire(bytes, wire_tile(position), info, loc_id);
+
+    /* Queue first: the queue remembers the revision before this change */
+    zone_queue(sys, position, bytes, length);
+    loc_record(sys, position, info, loc_id);
+}
+
+void zone_update_loc_add(ZoneUpdateSystem* sys, const Position* position, u16 loc_id,
+                         u8 shape, u8 angle) {
+    if (loc_id == ZONE_LOC_REMOVED) return;
+    zone_loc_change(sys, position, loc_id, shape, angle);
+}
+
+void zone_update_loc_del(ZoneUpdateSystem* sys, const Position* position, u8 shape, u8 angle) {
+    zone_loc_change(sys, position, ZONE_LOC_REMOVED, shape, angle);
+}
+
+void zone_update_loc_forget(ZoneUpdateSystem* sys, u32 region_x, u32 region_z) {
+    if (!sys) return;
+    for (u32 level = 0; level < 4; level++) {
+        for (u32 x = 0; x < 8; x++) {
+            for (u32 z = 0; z < 8; z++) {
+                u32 key = coord_pack(level, region_x * 8 + x, region_z * 8 + z);
+                u32 index = slot_find(sys->loc_table, sys->loc_table_mask, key);
+                if (index == ZONE_NONE || sys->loc_zones[index].loc_count == 0) continue;
+                sys->loc_zones[index].loc_count = 0;
+                sys->loc_zones[index].revision++;
+                sys->loc_changes++;
+            }
+        }
+    }
+}
+
+void zone_update_loc_anim(ZoneUpdateSystem* sys, const Position* position, u8 shape, u8 angle,
+                          u16 seq_id) {
+    if (!sys || !position || shape >= ZONE_LOC_SHAPES) return;
+    u8 bytes[1 + SERVER_LOC_ANIM_SIZE] = {
+        SERVER_LOC_ANIM, wire_tile(position), ZONE_LOC_INFO(shape, angle),
+        (u8)(seq_id >> 8), (u8)seq_id
+    };
+    zone_queue(sys, position, bytes, sizeof(bytes));
+}
+
+void zone_update_map_anim(ZoneUpdateSystem* sys, const Position* position, u16 spotanim,
+                          u8 height, u16 delay) {
+    if (!sys || !position) return;
+    /* packets.h's SPOTANIM_SPECIFIC (191) is the client's MAP_ANIM */
+    u8 bytes[1 + SERVER_SPOTANIM_SPECIFIC_SIZE] = {
+        SERVER_SPOTANIM_SPECIFIC, wire_tile(position),
+        (u8)(spotanim >> 8), (u8)spotanim, height, (u8)(delay >> 8), (u8)delay
+    };
+    zone_queue(sys, position, bytes, sizeof(bytes));
+}
+
+bool zone_update_projectile(ZoneUpdateSystem* sys, const ZoneProjectile* p) {
+    if (!sys || !p) return false;
+    i32 dx = (i32)position_x(&p->to) - (i32)position_x(&p->from);
+    i32 dz = (i32)position_z(&p->to) - (i32)position_z(&p->from);
+    if (dx < -128 || dx > 127 || dz < -128 || dz > 127) return false;
+
+    u8 bytes[1 + SERVER_MAP_PROJANIM_SIZE] = {
+        SERVER_MAP_PROJANIM, wire_tile(&p->from), (u8)(i8)dx, (u8)(i8)dz,
+        (u8)((u16)p->target >> 8), (u8)p->target,
+        (u8)(p->spotanim >> 8), (u8)p->spotanim,
+        p->src_height, p->dst_height,
+        (u8)(p->start_delay >> 8), (u8)p->start_delay,
+        (u8)(p->end_delay >> 8), (u8)p->end_delay,
+        p->peak, p->arc
+    };
+    zone_queue(sys, &p->from, bytes, sizeof(bytes));
+    return true;
+}
+
+/*******************************************************************************
+ * ENCODING
+ ******************************************************************************/
+
+void zone_update_encode(ZoneUpdateSystem* sys) {
+    if (!sys || sys->active_count == 0) return;
+
+    /*
+     * Every block but a zone's last holds more than LIMIT - 16 bytes, so
+     * this bounds the count. blocks[] is sized before the first
+     * broadcast_begin(): a started Broadcast must not move.
+     */
+    u32 needed = 0;
+    for (u32 i = 0; i < sys->active_count; i++) {
+        u32 bytes = 0;
+        for (u32 e = sys->active[i].first; e != ZONE_NONE; e = sys->events[e].next) {
+            bytes += sys->events[e].length;
+        }
+        needed += bytes / (ZONE_BLOCK_LIMIT - 16) + 1;
+    }
+    if (needed > sys->block_capacity) {
+        Broadcast* blocks = mem_realloc(MEM_OBJECT, sys->blocks, needed * sizeof(Broadcast));
+        if (!blocks) return;
+        sys->blocks = blocks;
+        sys->block_capacity = needed;
+    }
+
+    for (u32 i = 0; i < sys->active_count; i++) {
+        ZoneActive* zone = &sys->active[i];
+        StreamBuffer* payload = NULL;
+        zone->block = sys->block_count;
+        zone->block_count = 0;
+
+        for (u32 e = zone->first; e != ZONE_NONE; e = sys->events[e].next) {
+            const ZoneEvent* event = &sys->events[e];
+            if (!payload || payload->position + event->length > ZONE_BLOCK_LIMIT) {
+                payload = broadcast_begin(&sys->blocks[sys->block_count++],
+                                          SERVER_UPDATE_ZONE_PARTIAL_ENCLOSED);
+                zone->block_count++;
+            }
+            buffer_write_bytes(payload, event->bytes, event->length);
+        }
+    }
+}
+
+void zone_update_end_tick(ZoneUpdateSystem* sys) {
+    if (!sys) return;
+    for (u32 i = 0; i < sys->block_count; i++) {
+        broadcast_end(&sys->blocks[i]);
+    }
+    sys->block_count = 0;
+    if (sys->active_count > 0) {
+        memset(sys->active_table, 0xFF, (sys->active_table_mask + 1) * sizeof(ZoneSlot));
+        sys->active_count = 0;
+    }
+    sys->event_count = 0;
+}
+
+/*******************************************************************************
+ * VIEWER UPDATES
+ ******************************************************************************/
+
+/*
+ * zone_send_locs - A zone's changed locs, encoded for one viewer
+ *
+ * Only for viewers that missed changes (new to the scene, reverted by
+ * UPDATE_ZONE_FULL_FOLLOWS, or out of range when they happened).
+ */
+static void zone_send_locs(Player* player, const LocZone* zone, u8 base_x, u8 base_z) {
+    ISAACCipher* enc = player->conn->out_cipher.initialized ? &player->conn->out_cipher : NULL;
+    StreamBuffer* out = player_out(player);
+    u32 start = 0;
+    bool open = false;
+
+    for (u32 i = 0; i < zone->loc_count; i++) {
+        u8 bytes[8];
+        const ZoneLoc* loc = &zone->locs[i];
+        u8 length = loc_wire(bytes, loc->tile, loc->info, loc->loc_id);
+
+        if (open && out->position - start + length > ZONE_BLOCK_LIMIT) {
+            buffer_finish_var_header(out, VAR_SHORT);
+            open = false;
+        }
+        if (!open) {
+            buffer_write_header_var(out, SERVER_UPDATE_ZONE_PARTIAL_ENCLOSED, enc, VAR_SHORT);
+            start = out->position;
+            buffer_write_byte(out, base_x);
+            buffer_write_byte(out, base_z);
+            open = true;
+        }
+        buffer_write_bytes(out, bytes, length);
+    }
+    if (open) buffer_finish_var_header(out, VAR_SHORT);
+}
+
+/*
+ * zone_tracking_shift - Follow the client's rebuild to a new origin
+ *
+ * The client moves its changed locs with the scene and drops those that
+ * leave it, exactly as it does its item stacks (ground_tracking_shift).
+ */
+static void zone_tracking_shift(ZoneTracking* t, u32 origin_zone_x, u32 origin_zone_z) {
+    i32 dx = (i32)origin_zone_x - (i32)t->origin_zone_x;
+    i32 dz = (i32)origin_zone_z - (i32)t->origin_zone_z;
+    u32 shifted[GROUND_SCENE_ZONES][GROUND_SCENE_ZONES];
+
+    for (i32 x = 0; x < GROUND_SCENE_ZONES; x++) {
+        for (i32 z = 0; z < GROUND_SCENE_ZONES; z++) {
+            i32 old_x = x + dx;
+            i32 old_z = z + dz;
+            bool inside = old_x >= 0 && old_z >= 0 &&
+                          old_x < GROUND_SCENE_ZONES && old_z < GROUND_SCENE_ZONES;
+            shifted[x][z] = inside ? t->revision[old_x][old_z] : GROUND_REVISION_UNKNOWN;
+        }
+    }
+    memcpy(t->revision, shifted, sizeof(shifted));
+    t->origin_zone_x = origin_zone_x;
+    t->origin_zone_z = origin_zone_z;
+}
+
+/*
+ * zone_sync_locs - Bring the viewer's changed locs up to this tick's start
+ *
+ * Zones whose only news is this tick's changes are left to the block.
+ */
+static void zone_sync_locs(ZoneUpdateSystem* sys, Player* player, ZoneTracking* tracking,
+                           i32 base_zone_x, i32 base_zone_z) {
+    for (i32 x = 0; x < GROUND_SCENE_ZONES; x++) {
+        for (i32 z = 0; z < GROUND_SCENE_ZONES; z++) {
+            if (base_zone_x + x < 0 || base_zone_z + z < 0) continue;
+
+            u32 key = coord_pack(tracking->level, (u32)(base_zone_x + x), (u32)(base_zone_z + z));
+            u32 index = slot_find(sys->loc_table, sys->loc_table_mask, key);
+            if (index == ZONE_NONE) {
+                tracking->revision[x][z] = 0;
+                continue;
+            }
+
+            const LocZone* zone = &sys->loc_zones[index];
+            u32 known = tracking->revision[x][z];
+            if (known == zone->revision) continue;
+
+            u32 active = slot_find(sys->active_table, sys->active_table_mask, key);
+            if (active == ZONE_NONE || sys->active[active].loc_revision != known ||
+                sys->active[active].block_count == 0) {
+                zone_send_locs(player, zone, (u8)(x << 3), (u8)(z << 3));
+            }
+            tracking->revision[x][z] = zone->revision;
+        }
+    }
+}
+
+static void zone_send_blocks(const ZoneUpdateSystem* sys, const ZoneActive* zone,
+                             Player* player, i32 x, i32 z) {
+    u8 base[2] = { (u8)(x << 3), (u8)(z << 3) };
+    for (u32 b = zone->block; b < zone->block + zone->block_count; b++) {
+        broadcast_send_prefixed(&sys->blocks[b], player, base, sizeof(base));
+    }
+}
+
+void zone_update_player(ZoneUpdateSystem* sys, Player* player, ZoneTracking* tracking,
+                        const GroundTracking* ground) {
+    if (!sys || !player || !tracking) return;
+
+    u32 level = position_height(&player->position);
+    u32 origin_zone_x = player->origin_x >> 3;
+    u32 origin_zone_z = player->origin_z >> 3;
+    bool rescan = false;
+
+    if (!tracking->valid || tracking->level != level) {
+        for (u32 x = 0; x < GROUND_SCENE_ZONES; x++) {
+            for (u32 z = 0; z < GROUND_SCENE_ZONES; z++) {
+                tracking->revision[x][z] = GROUND_REVISION_UNKNOWN;
+            }
+        }
+        tracking->valid = true;
+        tracking->level = level;
+        tracking->origin_zone_x = origin_zone_x;
+        tracking->origin_zone_z = origin_zone_z;
+        rescan = true;
+    } else if (tracking->origin_zone_x != origin_zone_x || tracking->origin_zone_z != origin_zone_z) {
+        zone_tracking_shift(tracking, origin_zone_x, origin_zone_z);
+        rescan = true;
+    }
+
+    /* UPDATE_ZONE_FULL_FOLLOWS put those zones' locs back to the map's */
+    for (u32 x = 0; ground && x < GROUND_SCENE_ZONES; x++) {
+        if (!ground->cleared[x]) continue;
+        for (u32 z = 0; z < GROUND_SCENE_ZONES; z++) {
+            if (ground->cleared[x] & (1u << z)) tracking->revision[x][z] = GROUND_REVISION_UNKNOWN;
+        }
+        rescan = true;
+    }
+
+    i32 base_zone_x = (i32)origin_zone_x - 6;
+    i32 base_zone_z = (i32)origin_zone_z - 6;
+
+    /* No loc changed anywhere and the scene did not move: nothing to sync */
+    if (rescan || tracking->changes_seen != sys->loc_changes) {
+        tracking->changes_seen = sys->loc_changes;
+        zone_sync_locs(sys, player, tracking, base_zone_x, base_zone_z);
+    }
+
+    if (sys->block_count == 0) return;
+
+    /* Walk whichever is shorter: this tick's zones or the scene's */
+    if (sys->active_count <= GROUND_SCENE_ZONES * GROUND_SCENE_ZONES) {
+        for (u32 i = 0; i < sys->active_count; i++) {
+            const ZoneActive* zone = &sys->active[i];
+            i32 x = (i32)zone->zone_x - base_zone_x;
+            i32 z = (i32)zone->zone_z - base_zone_z;
+            if (zone->level != level || x < 0 || z < 0 ||
+                x >= GROUND_SCENE_ZONES || z >= GROUND_SCENE_ZONES) {
+                continue;
+            }
+            zone_send_blocks(sys, zone, player, x, z);
+        }
+    } else {
+        for (i32 x = 0; x < GROUND_SCENE_ZONES; x++) {
+            for (i32 z = 0; z < GROUND_SCENE_ZONES; z++) {
+                if (base_zone_x + x < 0 || base_zone_z + z < 0) continue;
+                u32 key = coord_pack(level, (u32)(base_zone_x + x), (u32)(base_zone_z + z));
+                u32 index = slot_find(sys->active_table, sys->active_table_mask, key);
+                if (index != ZONE_NONE) zone_send_blocks(sys, &sys->active[index], player, x, z);
+            }
+        }
+    }
+}
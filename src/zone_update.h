@@ -0,0 +1,300 @@
+/*******************************************************************************
+ * ZONE_UPDATE.H - Per-Zone Event Queues Encoded Once per Tick
+ *******************************************************************************
+ *
+ * EDUCATIONAL PURPOSE:
+ * This file demonstrates fundamental concepts in:
+ *   - Batching by destination: events grouped by the zone they happen in,
+ *     not by the player who sees them
+ *   - Encode once, copy per viewer (broadcast.h) with a viewer-relative
+ *     header
+ *   - Persistent state vs transient effects: a changed door must still be
+ *     changed for someone who walks up later, a spell's projectile not
+ *
+ * THE PROBLEM:
+ *
+ * The client draws projectiles, spot animations, animated locs and
+ * added or removed locs from zone packets (client readZonePacket), and
+ * the server had nothing that sent them. Sending each event straight to
+ * every player who can see it costs one encode per viewer per event:
+ *
+ *   PvP fight, 40 players in range, 60 projectiles + 60 spotanims a tick
+ *     → 40 x 120 = 4800 sub-packets encoded, each one ISAAC step
+ *
+ * THE SOLUTION - QUEUE BY ZONE, ENCODE AT TICK END:
+ *
+ *   during the tick:  zone_update_projectile(...)    appended to the queue
+ *                     zone_update_map_anim(...)      of the event's 8x8 zone
+ *
+ *   tick end:         zone_update_encode()
+ *                       zone (402, 403): [MAP_PROJANIM ...][MAP_ANIM ...]...
+ *                       → one UPDATE_ZONE_PARTIAL_ENCLOSED payload, once
+ *
+ *   per viewer:       zone_update_player()
+ *                       for each encoded zone in the viewer's scene:
+ *                         [op ^ isaac][len][base_x][base_z][shared block]
+ *                                           └─ per viewer ─┘└─ memcpy ──┘
+ *
+ * Sub-packets inside UPDATE_ZONE_PARTIAL_ENCLOSED carry plain opcodes
+ * (no ISAAC), so the whole block is the same bytes for everyone; only
+ * the zone corner (base_x, base_z, relative to each viewer's LOAD_AREA)
+ * differs, and broadcast_send_prefixed() writes those two bytes ahead of
+ * the copy. The fight above costs 120 encodes and 40 x (a few) memcpys.
+ *
+ * ZONE PACKETS (positions relative to the zone, tile = (x & 7) << 4 | z & 7):
+ *
+ *   LOC_ADD     (59)   tile, info, g2 loc         add or replace a loc
+ *   LOC_DEL     (76)   tile, info                 remove the loc on that layer
+ *   LOC_ANIM    (42)   tile, info, g2 seq         play an animation on a loc
+ *   MAP_PROJANIM(69)   tile, g1b dx, g1b dz, g2b target, g2 spotanim,
+ *                      g1 src height, g1 dst height, g2 start, g2 end,
+ *                      g1 peak, g1 arc
+ *   MAP_ANIM   (191)   tile, g2 spotanim, g1 height, g2 delay
+ *
+ *   info = shape << 2 | angle; the shape picks the layer (wall, wall
+ *   decoration, loc, ground decoration). packets.h calls 191
+ *   SPOTANIM_SPECIFIC; the client reads it as MAP_ANIM.
+ *
+ * CHANGED LOCS PERSIST:
+ *
+ * Added and removed locs are also kept per zone, one entry per tile and
+ * layer with the latest state, and every change bumps the zone's
+ * revision. Each viewer remembers the revision it holds per scene zone
+ * (ZoneTracking, like GroundTracking), so a viewer whose scene gains the
+ * zone, or whose client just reverted it (UPDATE_ZONE_FULL_FOLLOWS from
+ * the ground items, GroundTracking.cleared), is sent the zone's locs
+ * before this tick's block. A viewer that held the revision from before
+ * this tick's changes gets only the shared block. Reverting a loc is
+ * another LOC_ADD of the original, so the entry never needs removing.
+ *
+ * VIEW:
+ *   The viewer's whole 13x13-zone scene on its level, the same area the
+ *   client keeps ground items and changed locs for.
+ *
+ * COMPLEXITY (per tick):
+ *   - queue an event:    O(1) average (zone hash)
+ *   - encode:            O(events)
+ *   - per viewer:        O(min(active zones, 169)) plus a copy per block
+ *                        sent; the loc sync is one comparison unless a
+ *                        loc changed anywhere or the scene moved
+ *
+ * THREADS:
+ *   Game thread only.
+ *
+ ******************************************************************************/
+
+#ifndef ZONE_UPDATE_H
+#define ZONE_UPDATE_H
+
+#include "types.h"
+#include "position.h"
+#include "player.h"
+#include "broadcast.h"
+#include "ground_item.h"
+#include <stdbool.h>
+
+/* LOC_ADD / LOC_DEL / ... info byte */
+#define ZONE_LOC_INFO(shape, angle) ((u8)(((shape) << 2) | ((angle) & 3)))
+
+/* Loc shapes (loctype.h), 0-22 */
+#define ZONE_LOC_SHAPES 23
+
+/* ZoneLoc.loc_id of a removed loc */
+#define ZONE_LOC_REMOVED 0xFFFF
+
+/* MAP_PROJANIM target: 0 = none, NPC index + 1, -(player PID + 1) */
+#define ZONE_TARGET_NPC(index)   ((i16)((index) + 1))
+#define ZONE_TARGET_PLAYER(pid)  ((i16)(-(i32)(pid) - 1))
+
+/* Sub-packet bytes per encoded block, well inside the client's
+ * 5000-byte packet buffer; a busier zone gets several blocks */
+#define ZONE_BLOCK_LIMIT 4000
+
+#define ZONE_NONE UINT32_MAX
+
+/*
+ * ZoneLoc - The current state of one changed loc (tile + layer)
+ */
+typedef struct {
+    u8 tile;                    /* (x & 7) << 4 | (z & 7) */
+    u8 layer;                   /* 0-3, from the shape */
+    u8 info;                    /* shape << 2 | angle */
+    u16 loc_id;                 /* ZONE_LOC_REMOVED: LOC_DEL */
+} ZoneLoc;
+
+/*
+ * LocZone - Changed locs of one zone
+ *
+ * Kept for the server's lifetime once created, so revisions never go
+ * back (same reasoning as GroundZone).
+ */
+typedef struct {
+    u32 key;                    /* coord_pack(level, zone_x, zone_z) */
+    u32 revision;               /* Loc changes so far */
+    ZoneLoc* locs;
+    u32 loc_count;
+    u32 loc_capacity;
+} LocZone;
+
+/*
+ * ZoneEvent - One queued sub-packet, already in wire form
+ */
+typedef struct {
+    u32 next;                   /* Next event of the same zone, or ZONE_NONE */
+    u8 length;                  /* opcode + body */
+    u8 bytes[16];               /* MAP_PROJANIM is the longest: 1 + 15 */
+} ZoneEvent;
+
+/*
+ * ZoneActive - A zone with events this tick
+ */
+typedef struct {
+    u32 key;
+    u16 zone_x, zone_z;
+    u8 level;
+    u32 first, last;            /* Event chain, in order queued */
+    u32 loc_revision;           /* LocZone.revision before this tick's changes */
+    u32 block, block_count;     /* Encoded blocks (zone_update_encode) */
+} ZoneActive;
+
+/*
+ * ZoneTracking - Loc revisions one client holds, per scene zone (by PID)
+ *
+ * All zeroes (login) means nothing sent yet, like GroundTracking.
+ */
+typedef struct ZoneTracking {
+    bool valid;
+    u32 origin_zone_x;
+    u32 origin_zone_z;
+    u32 level;
+    u32 changes_seen;           /* ZoneUpdateSystem.loc_changes last synced */
+    u32 revision[GROUND_SCENE_ZONES][GROUND_SCENE_ZONES];
+} ZoneTracking;
+
+/* Open-addressing slot: zone key → array index */
+typedef struct {
+    u32 key;
+    u32 index;                  /* ZONE_NONE: empty */
+} ZoneSlot;
+
+/*
+ * ZoneUpdateSystem - Changed locs plus this tick's queues
+ */
+typedef struct {
+    LocZone* loc_zones;
+    u32 loc_zone_count, loc_zone_capacity;
+    ZoneSlot* loc_table;
+    u32 loc_table_mask;
+    u32 loc_changes;            /* Bumped on every loc change anywhere */
+
+    ZoneActive* active;         /* Zones with events this tick */
+    u32 active_count, active_capacity;
+    ZoneSlot* active_table;     /* Emptied at the end of every tick */
+    u32 active_table_mask;
+
+    ZoneEvent* events;
+    u32 event_count, event_capacity;
+
+    Broadcast* blocks;          /* Encoded once per tick; never moved while
+                                   in use (payloads point into them) */
+    u32 block_count, block_capacity;
+} ZoneUpdateSystem;
+
+/*
+ * ZoneProjectile - One MAP_PROJANIM
+ *
+ * Timings are client cycles (20ms) from when the packet arrives;
+ * heights are above the ground, peak is the launch slope and arc the
+ * start offset along the path, as in the client's ProjectileEntity.
+ */
+typedef struct {
+    Position from;              /* Launch tile (its level is used for both) */
+    Position to;                /* Within 127 tiles of from on each axis */
+    u16 spotanim;
+    i16 target;                 /* ZONE_TARGET_*, 0 to fly to the tile */
+    u8 src_height, dst_height;
+    u16 start_delay, end_delay;
+    u8 peak, arc;
+} ZoneProjectile;
+
+extern ZoneUpdateSystem* g_zone_updates;
+
+ZoneUpdateSystem* zone_update_system_create(void);
+void zone_update_system_destroy(ZoneUpdateSystem* sys);
+
+/*
+ * zone_update_loc_add / zone_update_loc_del - Change a loc for everyone
+ *
+ * @param position  Tile (and level)
+ * @param loc_id    New loc (loc_add)
+ * @param shape     Loc shape 0-22; its layer is the one replaced
+ * @param angle     Rotation 0-3
+ *
+ * Recorded as the tile's state for that layer and queued for this tick.
+ * Only what clients draw changes: collision is the caller's.
+ */
+void zone_update_loc_add(ZoneUpdateSystem* sys, const Position* position, u16 loc_id,
+                         u8 shape, u8 angle);
+void zone_update_loc_del(ZoneUpdateSystem* sys, const Position* position, u8 shape, u8 angle);
+
+/*
+ * zone_update_loc_forget - Drop the changed locs of one 64x64 region
+ *
+ * @param region_x, region_z  Region (x >> 6, z >> 6), all four levels
+ *
+ * For a region whose map is about to mean something else (an instance
+ * slot being reused): nobody is sent anything now, and a client that
+ * loads the region later sees its map files as they are. The zones keep
+ * their revisions moving forward, like every other change.
+ */
+void zone_update_loc_forget(ZoneUpdateSystem* sys, u32 region_x, u32 region_z);
+
+/*
+ * zone_update_loc_anim - Play an animation on the loc of a tile's layer
+ */
+void zone_update_loc_anim(ZoneUpdateSystem* sys, const Position* position, u8 shape, u8 angle,
+                          u16 seq_id);
+
+/*
+ * zone_update_map_anim - A spot animation on a tile
+ *
+ * @param height  Above the ground
+ * @param delay   Client cycles before it starts
+ */
+void zone_update_map_anim(ZoneUpdateSystem* sys, const Position* position, u16 spotanim,
+                          u8 height, u16 delay);
+
+/*
+ * zone_update_projectile - Launch a projectile
+ *
+ * @return  false if the target tile is out of the packet's range
+ */
+bool zone_update_projectile(ZoneUpdateSystem* sys, const ZoneProjectile* projectile);
+
+/*
+ * zone_update_encode - Encode this tick's queues, one block set per zone
+ *
+ * Call once per tick before the zone_update_player() calls.
+ */
+void zone_update_encode(ZoneUpdateSystem* sys);
+
+/*
+ * zone_update_player - Send a viewer its scene's changed locs and blocks
+ *
+ * @param sys       Zone updates (encoded this tick)
+ * @param player    Viewer (origin_x/origin_z from its last LOAD_AREA)
+ * @param tracking  Viewer's ZoneTracking (World.zone_tracking[pid])
+ * @param ground    Viewer's GroundTracking, updated this tick (its
+ *                  cleared zones need their locs again)
+ *
+ * Appends to the player's output arena; the caller commits.
+ */
+void zone_update_player(ZoneUpdateSystem* sys, Player* player, ZoneTracking* tracking,
+                        const GroundTracking* ground);
+
+/*
+ * zone_update_end_tick - Drop this tick's queues and blocks
+ */
+void zone_update_end_tick(ZoneUpdateSystem* sys);
+
+#endif /* ZONE_UPDATE_H */